@@ -7,7 +7,9 @@
 
 #pragma once
 
+#include <cstddef>
 #include <memory>
+#include <new>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -27,6 +29,45 @@ class BoundMethodPackBase
 {
 public:
 	virtual ~BoundMethodPackBase() = default;
+
+	static void *allocate(std::size_t size);
+	static void deallocate(void *ptr);
+};
+
+template<typename T>
+class BoundMethodPackAllocator
+{
+public:
+	using value_type = T;
+
+	BoundMethodPackAllocator() = default;
+
+	template<typename U>
+	BoundMethodPackAllocator(const BoundMethodPackAllocator<U> &)
+	{
+	}
+
+	T *allocate(std::size_t n)
+	{
+		if constexpr (alignof(T) > alignof(std::max_align_t))
+			return static_cast<T *>(::operator new(n * sizeof(T),
+							       std::align_val_t(alignof(T))));
+		else
+			return static_cast<T *>(BoundMethodPackBase::allocate(n * sizeof(T)));
+	}
+
+	void deallocate(T *ptr, [[maybe_unused]] std::size_t n)
+	{
+		if constexpr (alignof(T) > alignof(std::max_align_t))
+			::operator delete(ptr, std::align_val_t(alignof(T)));
+		else
+			BoundMethodPackBase::deallocate(ptr);
+	}
+
+	template<typename U>
+	bool operator==(const BoundMethodPackAllocator<U> &) const { return true; }
+	template<typename U>
+	bool operator!=(const BoundMethodPackAllocator<U> &) const { return false; }
 };
 
 template<typename R, typename... Args>
@@ -72,6 +113,9 @@ public:
 	}
 	virtual ~BoundMethodBase() = default;
 
+	static void *operator new(std::size_t size);
+	static void operator delete(void *ptr);
+
 	template<typename T, std::enable_if_t<!std::is_same<Object, T>::value> * = nullptr>
 	bool match(T *obj) { return obj == obj_; }
 	bool match(Object *object) { return object == object_; }
@@ -79,6 +123,11 @@ public:
 	Object *object() const { return object_; }
 
 	virtual void invokePack(BoundMethodPackBase *pack) = 0;
+	virtual void invokeSharedPack(BoundMethodPackBase *pack) = 0;
+
+	ConnectionType resolveConnectionType() const;
+	void activateSharedPack(const std::shared_ptr<BoundMethodPackBase> &pack,
+				ConnectionType type);
 
 protected:
 	bool activatePack(std::shared_ptr<BoundMethodPackBase> pack,
@@ -115,6 +164,18 @@ private:
 		invoke(std::get<I>(args->args_)...);
 	}
 
+	template<std::size_t... I>
+	void invokeSharedPack(BoundMethodPackBase *pack, std::index_sequence<I...>)
+	{
+		/*
+		 * Shared packs are always created without storage for the
+		 * return value, which is discarded.
+		 */
+		using SharedPackType = BoundMethodPack<void, Args...>;
+		SharedPackType *args [[gnu::unused]] = static_cast<SharedPackType *>(pack);
+		invoke(std::get<I>(args->args_)...);
+	}
+
 public:
 	BoundMethodArgs(void *obj, Object *object, ConnectionType type)
 		: BoundMethodBase(obj, object, type) {}
@@ -124,6 +185,11 @@ public:
 		invokePack(pack, std::make_index_sequence<sizeof...(Args)>{});
 	}
 
+	void invokeSharedPack(BoundMethodPackBase *pack) override
+	{
+		invokeSharedPack(pack, std::make_index_sequence<sizeof...(Args)>{});
+	}
+
 	virtual R activate(Args... args, bool deleteMethod = false) = 0;
 	virtual R invoke(Args... args) = 0;
 };
@@ -145,7 +211,8 @@ public:
 		if (!this->object_)
 			return func_(args...);
 
-		auto pack = std::make_shared<PackType>(args...);
+		auto pack = std::allocate_shared<PackType>(BoundMethodPackAllocator<PackType>(),
+							 args...);
 		bool sync = BoundMethodBase::activatePack(pack, deleteMethod);
 		return sync ? pack->returnValue() : R();
 	}
@@ -180,7 +247,8 @@ public:
 			return (obj->*func_)(args...);
 		}
 
-		auto pack = std::make_shared<PackType>(args...);
+		auto pack = std::allocate_shared<PackType>(BoundMethodPackAllocator<PackType>(),
+							 args...);
 		bool sync = BoundMethodBase::activatePack(pack, deleteMethod);
 		return sync ? pack->returnValue() : R();
 	}
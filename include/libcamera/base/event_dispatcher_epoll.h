@@ -0,0 +1,70 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * event_dispatcher_epoll.h - Epoll-based event dispatcher
+ */
+
+#pragma once
+
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+#include <libcamera/base/private.h>
+
+#include <libcamera/base/event_dispatcher.h>
+#include <libcamera/base/timer_queue.h>
+#include <libcamera/base/unique_fd.h>
+#include <libcamera/base/utils.h>
+
+struct epoll_event;
+
+namespace libcamera {
+
+class EventNotifier;
+class Timer;
+
+class EventDispatcherEpoll final : public EventDispatcher
+{
+public:
+	EventDispatcherEpoll();
+	~EventDispatcherEpoll();
+
+	void registerEventNotifier(EventNotifier *notifier);
+	void unregisterEventNotifier(EventNotifier *notifier);
+
+	void registerTimer(Timer *timer);
+	void unregisterTimer(Timer *timer);
+
+	void processEvents();
+	void interrupt();
+
+private:
+	struct EventNotifierSetEpoll {
+		uint32_t events() const;
+		bool empty() const;
+		EventNotifier *notifiers[3];
+		uint32_t registered;
+	};
+
+	void updateNotifierSet(int fd, EventNotifierSetEpoll &set);
+	void armTimer();
+	void processInterrupt();
+	void processTimerfd();
+	void processNotifiers(const struct epoll_event &event);
+	void processTimers();
+
+	std::map<int, EventNotifierSetEpoll> notifiers_;
+	std::vector<int> staleNotifiers_;
+	TimerQueue timers_;
+	utils::time_point armedDeadline_;
+
+	UniqueFD epollfd_;
+	UniqueFD eventfd_;
+	UniqueFD timerfd_;
+
+	bool processingEvents_;
+};
+
+} /* namespace libcamera */
@@ -105,12 +105,46 @@ LogMessage _log(const LogCategory *category, LogSeverity severity,
 		unsigned int line = __builtin_LINE());
 
 #ifndef __DOXYGEN__
+#ifndef LIBCAMERA_LOG_MIN_SEVERITY
+#define LIBCAMERA_LOG_MIN_SEVERITY LogDebug
+#endif
+
 #define _LOG_CATEGORY(name) logCategory##name
 
+/*
+ * Convert the log stream to void, to match the type of the other branch of the
+ * conditional operator in the _LOG1() and _LOG2() macros. The operator& has a
+ * lower precedence than operator<< and a higher precedence than operator?:,
+ * which makes it bind to the whole stream expression.
+ */
+class LogVoidify
+{
+public:
+	void operator&(std::ostream &) {}
+};
+
+/*
+ * Skip creation of the log message, and evaluation of all the stream operands,
+ * when the severity is below the compile-time minimum or the category log
+ * level. Messages below the compile-time minimum are removed at compile time.
+ */
+template<LogSeverity severity>
+inline bool _logDisabled(const LogCategory &category)
+{
+	if constexpr (severity < LIBCAMERA_LOG_MIN_SEVERITY)
+		return true;
+	else
+		return severity < category.severity();
+}
+
 #define _LOG1(severity) \
-	_log(nullptr, Log##severity).stream()
+	_logDisabled<Log##severity>(LogCategory::defaultCategory()) ? \
+	(void)0 : libcamera::LogVoidify() & \
+		  _log(nullptr, Log##severity).stream()
 #define _LOG2(category, severity) \
-	_log(&_LOG_CATEGORY(category)(), Log##severity).stream()
+	_logDisabled<Log##severity>(_LOG_CATEGORY(category)()) ? \
+	(void)0 : libcamera::LogVoidify() & \
+		  _log(&_LOG_CATEGORY(category)(), Log##severity).stream()
 
 /*
  * Expand the LOG() macro to _LOG1() or _LOG2() based on the number of
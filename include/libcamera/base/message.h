@@ -8,6 +8,7 @@
 #pragma once
 
 #include <atomic>
+#include <cstddef>
 
 #include <libcamera/base/private.h>
 
@@ -34,16 +35,21 @@ public:
 	Message(Type type);
 	virtual ~Message();
 
+	static void *operator new(std::size_t size);
+	static void operator delete(void *ptr);
+
 	Type type() const { return type_; }
 	Object *receiver() const { return receiver_; }
 
 	static Type registerMessageType();
 
 private:
+	friend class MessageQueue;
 	friend class Thread;
 
 	Type type_;
 	Object *receiver_;
+	Message *next_;
 
 	static std::atomic_uint nextUserType_;
 };
@@ -54,7 +60,8 @@ public:
 	InvokeMessage(BoundMethodBase *method,
 		      std::shared_ptr<BoundMethodPackBase> pack,
 		      Semaphore *semaphore = nullptr,
-		      bool deleteMethod = false);
+		      bool deleteMethod = false,
+		      bool sharedPack = false);
 	~InvokeMessage();
 
 	Semaphore *semaphore() const { return semaphore_; }
@@ -66,6 +73,7 @@ private:
 	std::shared_ptr<BoundMethodPackBase> pack_;
 	Semaphore *semaphore_;
 	bool deleteMethod_;
+	bool sharedPack_;
 };
 
 } /* namespace libcamera */
@@ -0,0 +1,32 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * message_pool.h - Per-thread memory pool for messages
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <libcamera/base/private.h>
+
+namespace libcamera {
+
+class MessagePool
+{
+public:
+	struct Statistics {
+		uint64_t allocations;
+		uint64_t systemAllocations;
+		uint64_t remoteFrees;
+	};
+
+	static void *allocate(size_t size);
+	static void deallocate(void *ptr);
+
+	static Statistics statistics();
+};
+
+} /* namespace libcamera */
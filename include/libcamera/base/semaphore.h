@@ -7,9 +7,10 @@
 
 #pragma once
 
-#include <libcamera/base/private.h>
+#include <atomic>
+#include <stdint.h>
 
-#include <libcamera/base/mutex.h>
+#include <libcamera/base/private.h>
 
 namespace libcamera {
 
@@ -18,15 +19,19 @@ class Semaphore
 public:
 	Semaphore(unsigned int n = 0);
 
-	unsigned int available() LIBCAMERA_TSA_EXCLUDES(mutex_);
-	void acquire(unsigned int n = 1) LIBCAMERA_TSA_EXCLUDES(mutex_);
-	bool tryAcquire(unsigned int n = 1) LIBCAMERA_TSA_EXCLUDES(mutex_);
-	void release(unsigned int n = 1) LIBCAMERA_TSA_EXCLUDES(mutex_);
+	unsigned int available();
+	void acquire(unsigned int n = 1);
+	bool tryAcquire(unsigned int n = 1);
+	void release(unsigned int n = 1);
+
+	void setSpinCount(unsigned int count);
 
 private:
-	Mutex mutex_;
-	ConditionVariable cv_;
-	unsigned int available_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	static constexpr uint32_t kWaiters = 1U << 31;
+	static constexpr uint32_t kCountMask = kWaiters - 1;
+
+	std::atomic<uint32_t> state_;
+	std::atomic<unsigned int> spinCount_;
 };
 
 } /* namespace libcamera */
@@ -29,7 +29,7 @@ protected:
 	void connect(BoundMethodBase *slot);
 	void disconnect(std::function<bool(SlotList::iterator &)> match);
 
-	SlotList slots();
+	std::vector<BoundMethodBase *> slots();
 
 private:
 	SlotList slots_;
@@ -146,12 +146,53 @@ public:
 
 	void emit(Args... args)
 	{
+		/*
+		 * Arguments passed by non-const reference may be modified by
+		 * slots, and can't be shared between slots running in
+		 * different threads.
+		 */
+		constexpr bool shareable =
+			(!(std::is_lvalue_reference_v<Args> &&
+			   !std::is_const_v<std::remove_reference_t<Args>>) && ...);
+
+		std::shared_ptr<BoundMethodPackBase> pack;
+
 		/*
 		 * Make a copy of the slots list as the slot could call the
 		 * disconnect operation, invalidating the iterator.
 		 */
-		for (BoundMethodBase *slot : slots())
-			static_cast<BoundMethodArgs<void, Args...> *>(slot)->activate(args...);
+		for (BoundMethodBase *slot : slots()) {
+			auto method = static_cast<BoundMethodArgs<void, Args...> *>(slot);
+
+			if (!slot->object()) {
+				method->activate(args...);
+				continue;
+			}
+
+			/* Call slots in the emitter's thread without packing. */
+			const ConnectionType type = slot->resolveConnectionType();
+			if (type == ConnectionTypeDirect) {
+				method->invoke(args...);
+				continue;
+			}
+
+			if (!shareable) {
+				method->activate(args...);
+				continue;
+			}
+
+			/*
+			 * Pack the arguments once and share the pack between
+			 * all slots invoked in another thread.
+			 */
+			if (!pack) {
+				using PackType = BoundMethodPack<void, Args...>;
+				pack = std::allocate_shared<PackType>(BoundMethodPackAllocator<PackType>(),
+								      args...);
+			}
+
+			slot->activateSharedPack(pack, type);
+		}
 	}
 };
 
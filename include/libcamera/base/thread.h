@@ -8,6 +8,7 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <sys/types.h>
 #include <thread>
 
@@ -15,6 +16,7 @@
 
 #include <libcamera/base/message.h>
 #include <libcamera/base/signal.h>
+#include <libcamera/base/span.h>
 #include <libcamera/base/utils.h>
 
 namespace libcamera {
@@ -28,9 +30,14 @@ class ThreadMain;
 class Thread
 {
 public:
-	Thread();
+	Thread(const std::string &name = {});
 	virtual ~Thread();
 
+	const std::string &name() const;
+
+	int setSchedulingPolicy(int policy, int priority = 0);
+	int setThreadAffinity(Span<const unsigned int> cpus);
+
 	void start();
 	void exit(int code = 0);
 	bool wait(utils::duration duration = utils::duration::max());
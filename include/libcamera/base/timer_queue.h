@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * timer_queue.h - Deadline-ordered timer queue
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <libcamera/base/private.h>
+
+#include <libcamera/base/utils.h>
+
+namespace libcamera {
+
+class Timer;
+
+class TimerQueue
+{
+public:
+	TimerQueue();
+
+	void push(Timer *timer);
+	void remove(Timer *timer);
+	void pop();
+
+	Timer *top() const { return heap_.empty() ? nullptr : heap_.front().timer; }
+	bool empty() const { return heap_.empty(); }
+	size_t size() const { return heap_.size(); }
+
+private:
+	struct Entry {
+		bool operator<(const Entry &other) const
+		{
+			if (deadline != other.deadline)
+				return deadline < other.deadline;
+			return sequence < other.sequence;
+		}
+
+		utils::time_point deadline;
+		uint64_t sequence;
+		Timer *timer;
+	};
+
+	void place(size_t index, const Entry &entry);
+	void siftUp(size_t index);
+	void siftDown(size_t index);
+	void erase(size_t index);
+
+	std::vector<Entry> heap_;
+	uint64_t sequence_;
+};
+
+} /* namespace libcamera */
@@ -8,11 +8,13 @@
 #pragma once
 
 #include <initializer_list>
+#include <map>
 #include <memory>
 #include <optional>
 #include <set>
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 #include <libcamera/base/class.h>
 #include <libcamera/base/flags.h>
@@ -31,6 +33,7 @@ class FrameBuffer;
 class FrameBufferAllocator;
 class PipelineHandler;
 class Request;
+class RequestPool;
 
 class SensorConfiguration
 {
@@ -65,6 +68,11 @@ public:
 		Invalid,
 	};
 
+	enum class RequestOrder {
+		Submission,
+		Completion,
+	};
+
 	using iterator = std::vector<StreamConfiguration>::iterator;
 	using const_iterator = std::vector<StreamConfiguration>::const_iterator;
 
@@ -94,6 +102,9 @@ public:
 
 	std::optional<SensorConfiguration> sensorConfig;
 	Orientation orientation;
+	RequestOrder requestOrder;
+	unsigned int maxQueuedRequests;
+	unsigned int internalBufferCount;
 
 protected:
 	CameraConfiguration();
@@ -123,6 +134,7 @@ public:
 	const std::string &id() const;
 
 	Signal<Request *, FrameBuffer *> bufferCompleted;
+	Signal<Request *, const ControlList &> metadataAvailable;
 	Signal<Request *> requestCompleted;
 	Signal<> disconnected;
 
@@ -146,6 +158,8 @@ public:
 	int configure(CameraConfiguration *config);
 
 	std::unique_ptr<Request> createRequest(uint64_t cookie = 0);
+	std::unique_ptr<RequestPool>
+	createRequestPool(const std::map<const Stream *, std::vector<FrameBuffer *>> &buffers);
 	int queueRequest(Request *request);
 
 	int start(const ControlList *controls = nullptr);
@@ -163,6 +177,7 @@ private:
 	void requestComplete(Request *request);
 
 	friend class FrameBufferAllocator;
+	int canAllocateFrameBuffers(Stream *stream, bool allowRunning = false) const;
 	int exportFrameBuffers(Stream *stream,
 			       std::vector<std::unique_ptr<FrameBuffer>> *buffers);
 };
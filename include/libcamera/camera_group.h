@@ -0,0 +1,63 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * camera_group.h - Synchronized capture from multiple cameras
+ */
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+#include <libcamera/base/class.h>
+#include <libcamera/base/signal.h>
+#include <libcamera/base/span.h>
+
+namespace libcamera {
+
+class Camera;
+class CameraManager;
+class ControlList;
+class Request;
+
+class CameraGroup
+{
+public:
+	~CameraGroup();
+
+	const std::vector<std::shared_ptr<Camera>> &cameras() const { return cameras_; }
+
+	int start(const ControlList *controls = nullptr);
+	int stop();
+
+	int queueRequests(Span<Request *const> requests);
+
+	static int64_t timestampSkew(Span<Request *const> requests);
+
+	Signal<const std::vector<Request *> &> requestsCompleted;
+
+private:
+	LIBCAMERA_DISABLE_COPY_AND_MOVE(CameraGroup)
+
+	friend class CameraManager;
+
+	struct Batch {
+		std::vector<Request *> requests;
+		unsigned int pending;
+	};
+
+	CameraGroup(const std::vector<std::shared_ptr<Camera>> &cameras);
+
+	void requestComplete(Request *request);
+
+	std::vector<std::shared_ptr<Camera>> cameras_;
+
+	std::mutex mutex_;
+	std::deque<Batch> batches_;
+};
+
+} /* namespace libcamera */
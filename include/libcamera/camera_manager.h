@@ -16,9 +16,12 @@
 #include <libcamera/base/object.h>
 #include <libcamera/base/signal.h>
 
+#include <libcamera/metrics.h>
+
 namespace libcamera {
 
 class Camera;
+class CameraGroup;
 
 class CameraManager : public Object, public Extensible
 {
@@ -33,6 +36,11 @@ public:
 	std::vector<std::shared_ptr<Camera>> cameras() const;
 	std::shared_ptr<Camera> get(const std::string &id);
 
+	std::unique_ptr<CameraGroup>
+	createGroup(const std::vector<std::shared_ptr<Camera>> &cameras);
+
+	MetricsSnapshot metrics() const;
+
 	static const std::string &version() { return version_; }
 
 	Signal<std::shared_ptr<Camera>> cameraAdded;
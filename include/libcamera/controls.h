@@ -13,6 +13,7 @@
 #include <stdint.h>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <libcamera/base/class.h>
@@ -45,50 +46,60 @@ struct control_type {
 template<>
 struct control_type<void> {
 	static constexpr ControlType value = ControlTypeNone;
+	static constexpr std::size_t size = 0;
 };
 
 template<>
 struct control_type<bool> {
 	static constexpr ControlType value = ControlTypeBool;
+	static constexpr std::size_t size = 0;
 };
 
 template<>
 struct control_type<uint8_t> {
 	static constexpr ControlType value = ControlTypeByte;
+	static constexpr std::size_t size = 0;
 };
 
 template<>
 struct control_type<int32_t> {
 	static constexpr ControlType value = ControlTypeInteger32;
+	static constexpr std::size_t size = 0;
 };
 
 template<>
 struct control_type<int64_t> {
 	static constexpr ControlType value = ControlTypeInteger64;
+	static constexpr std::size_t size = 0;
 };
 
 template<>
 struct control_type<float> {
 	static constexpr ControlType value = ControlTypeFloat;
+	static constexpr std::size_t size = 0;
 };
 
 template<>
 struct control_type<std::string> {
 	static constexpr ControlType value = ControlTypeString;
+	static constexpr std::size_t size = 0;
 };
 
 template<>
 struct control_type<Rectangle> {
 	static constexpr ControlType value = ControlTypeRectangle;
+	static constexpr std::size_t size = 0;
 };
 
 template<>
 struct control_type<Size> {
 	static constexpr ControlType value = ControlTypeSize;
+	static constexpr std::size_t size = 0;
 };
 
 template<typename T, std::size_t N>
 struct control_type<Span<T, N>> : public control_type<std::remove_cv_t<T>> {
+	static constexpr std::size_t size = N;
 };
 
 } /* namespace details */
@@ -126,7 +137,9 @@ public:
 	~ControlValue();
 
 	ControlValue(const ControlValue &other);
+	ControlValue(ControlValue &&other) noexcept;
 	ControlValue &operator=(const ControlValue &other);
+	ControlValue &operator=(ControlValue &&other) noexcept;
 
 	ControlType type() const { return type_; }
 	bool isNone() const { return type_ == ControlTypeNone; }
@@ -197,11 +210,13 @@ public:
 		     std::size_t numElements = 1);
 
 private:
+	static constexpr std::size_t kInlineSize = 40;
+
 	ControlType type_ : 8;
 	bool isArray_;
 	std::size_t numElements_ : 32;
 	union {
-		uint64_t value_;
+		uint64_t value_[kInlineSize / sizeof(uint64_t)];
 		void *storage_;
 	};
 
@@ -213,14 +228,17 @@ private:
 class ControlId
 {
 public:
-	ControlId(unsigned int id, const std::string &name, ControlType type)
-		: id_(id), name_(name), type_(type)
+	ControlId(unsigned int id, const std::string &name, ControlType type,
+		  std::size_t size = 0)
+		: id_(id), name_(name), type_(type), size_(size)
 	{
 	}
 
 	unsigned int id() const { return id_; }
 	const std::string &name() const { return name_; }
 	ControlType type() const { return type_; }
+	bool isArray() const { return size_ > 0; }
+	std::size_t size() const { return size_; }
 
 private:
 	LIBCAMERA_DISABLE_COPY_AND_MOVE(ControlId)
@@ -228,6 +246,7 @@ private:
 	unsigned int id_;
 	std::string name_;
 	ControlType type_;
+	std::size_t size_;
 };
 
 static inline bool operator==(unsigned int lhs, const ControlId &rhs)
@@ -257,7 +276,8 @@ public:
 	using type = T;
 
 	Control(unsigned int id, const char *name)
-		: ControlId(id, name, details::control_type<std::remove_cv_t<T>>::value)
+		: ControlId(id, name, details::control_type<std::remove_cv_t<T>>::value,
+			    details::control_type<std::remove_cv_t<T>>::size)
 	{
 	}
 
@@ -308,12 +328,14 @@ public:
 	using Map = std::unordered_map<const ControlId *, ControlInfo>;
 
 	ControlInfoMap() = default;
-	ControlInfoMap(const ControlInfoMap &other) = default;
+	ControlInfoMap(const ControlInfoMap &other);
+	ControlInfoMap(ControlInfoMap &&other);
 	ControlInfoMap(std::initializer_list<Map::value_type> init,
 		       const ControlIdMap &idmap);
 	ControlInfoMap(Map &&info, const ControlIdMap &idmap);
 
-	ControlInfoMap &operator=(const ControlInfoMap &other) = default;
+	ControlInfoMap &operator=(const ControlInfoMap &other);
+	ControlInfoMap &operator=(ControlInfoMap &&other);
 
 	using Map::key_type;
 	using Map::mapped_type;
@@ -341,23 +363,33 @@ public:
 	const ControlIdMap &idmap() const { return *idmap_; }
 
 private:
+	using ControlInfoMapIndex = std::vector<std::pair<unsigned int, Map::iterator>>;
+
 	bool validate();
+	void buildIndex();
+	ControlInfoMapIndex::const_iterator indexOf(unsigned int id) const;
 
 	const ControlIdMap *idmap_ = nullptr;
+	ControlInfoMapIndex index_;
 };
 
 class ControlList
 {
 private:
-	using ControlListMap = std::unordered_map<unsigned int, ControlValue>;
+	using ControlListEntries = std::vector<std::pair<const unsigned int, ControlValue>>;
 
 public:
 	ControlList();
 	ControlList(const ControlIdMap &idmap, const ControlValidator *validator = nullptr);
 	ControlList(const ControlInfoMap &infoMap, const ControlValidator *validator = nullptr);
+	ControlList(const ControlList &other) = default;
+	ControlList(ControlList &&other) = default;
+
+	ControlList &operator=(const ControlList &other);
+	ControlList &operator=(ControlList &&other) = default;
 
-	using iterator = ControlListMap::iterator;
-	using const_iterator = ControlListMap::const_iterator;
+	using iterator = ControlListEntries::iterator;
+	using const_iterator = ControlListEntries::const_iterator;
 
 	iterator begin() { return controls_.begin(); }
 	iterator end() { return controls_.end(); }
@@ -367,20 +399,20 @@ public:
 	bool empty() const { return controls_.empty(); }
 	std::size_t size() const { return controls_.size(); }
 
-	void clear() { controls_.clear(); }
+	void clear();
 	void merge(const ControlList &source);
+	void merge(ControlList &&source);
 
 	bool contains(unsigned int id) const;
 
 	template<typename T>
 	std::optional<T> get(const Control<T> &ctrl) const
 	{
-		const auto entry = controls_.find(ctrl.id());
-		if (entry == controls_.end())
+		const ControlValue *val = lookup(ctrl.id());
+		if (!val)
 			return std::nullopt;
 
-		const ControlValue &val = entry->second;
-		return val.get<T>();
+		return val->get<T>();
 	}
 
 	template<typename T, typename V>
@@ -405,11 +437,16 @@ public:
 
 	const ControlValue &get(unsigned int id) const;
 	void set(unsigned int id, const ControlValue &value);
+	void set(unsigned int id, ControlValue &&value);
 
 	const ControlInfoMap *infoMap() const { return infoMap_; }
 	const ControlIdMap *idMap() const { return idmap_; }
 
 private:
+	using ControlListIndex = std::vector<std::pair<unsigned int, unsigned int>>;
+
+	ControlListIndex::const_iterator indexOf(unsigned int id) const;
+	const ControlValue *lookup(unsigned int id) const;
 	const ControlValue *find(unsigned int id) const;
 	ControlValue *find(unsigned int id);
 
@@ -417,7 +454,8 @@ private:
 	const ControlIdMap *idmap_;
 	const ControlInfoMap *infoMap_;
 
-	ControlListMap controls_;
+	ControlListEntries controls_;
+	ControlListIndex index_;
 };
 
 } /* namespace libcamera */
@@ -22,10 +22,26 @@ class Stream;
 class FrameBufferAllocator
 {
 public:
+	enum class Source {
+		Device,
+		ContiguousHeap,
+		SystemHeap,
+		UncachedSystemHeap,
+	};
+
+	struct Hints {
+		int numaNode = -1;
+	};
+
 	FrameBufferAllocator(std::shared_ptr<Camera> camera);
 	~FrameBufferAllocator();
 
+	void setHints(const Hints &hints) { hints_ = hints; }
+	const Hints &hints() const { return hints_; }
+
 	int allocate(Stream *stream);
+	int allocate(Stream *stream, Source source);
+	int allocate(Stream *stream, Source source, unsigned int count);
 	int free(Stream *stream);
 
 	bool allocated() const { return !buffers_.empty(); }
@@ -34,7 +50,11 @@ public:
 private:
 	LIBCAMERA_DISABLE_COPY(FrameBufferAllocator)
 
+	int allocateFromHeap(Stream *stream, Source source, unsigned int count,
+			     std::vector<std::unique_ptr<FrameBuffer>> *buffers);
+
 	std::shared_ptr<Camera> camera_;
+	Hints hints_;
 	std::map<Stream *, std::vector<std::unique_ptr<FrameBuffer>>> buffers_;
 };
 
@@ -8,19 +8,24 @@
 #pragma once
 
 #include <atomic>
-#include <list>
 #include <memory>
+#include <optional>
 #include <set>
 #include <string>
 
 #include <libcamera/base/class.h>
+#include <libcamera/base/utils.h>
 
 #include <libcamera/camera.h>
 
+#include "libcamera/internal/frame_timing.h"
+#include "libcamera/internal/request_queue.h"
+
 namespace libcamera {
 
 class CameraControlValidator;
 class PipelineHandler;
+class Request;
 class Stream;
 
 class Camera::Private : public Extensible::Private
@@ -33,14 +38,25 @@ public:
 
 	PipelineHandler *pipe() { return pipe_.get(); }
 
-	std::list<Request *> queuedRequests_;
+	RequestQueue queuedRequests_;
 	ControlInfoMap controlInfo_;
 	ControlList properties_;
 
 	uint32_t requestSequence_;
+	CameraConfiguration::RequestOrder requestOrder_;
+	std::optional<uint32_t> nextFrame_;
+	unsigned int framesDropped_;
+	unsigned int maxQueuedRequests_;
+	std::optional<utils::time_point> startTime_;
+	FrameTiming frameTiming_;
 
 	const CameraControlValidator *validator() const { return validator_.get(); }
 
+	bool isRunning() const;
+
+	int validateRequest(Request *request,
+			    const char *from = __builtin_FUNCTION()) const;
+
 private:
 	enum State {
 		CameraAvailable,
@@ -51,7 +67,6 @@ private:
 	};
 
 	bool isAcquired() const;
-	bool isRunning() const;
 	int isAccessAllowed(State state, bool allowDisconnected = false,
 			    const char *from = __builtin_FUNCTION()) const;
 	int isAccessAllowed(State low, State high,
@@ -26,6 +26,7 @@ namespace libcamera {
 
 class Camera;
 class DeviceEnumerator;
+class PipelineHandler;
 
 class CameraManager::Private : public Extensible::Private, public Thread
 {
@@ -44,6 +45,7 @@ protected:
 private:
 	int init();
 	void createPipelineHandlers();
+	void stopPipelineThreads(bool all);
 	void cleanup() LIBCAMERA_TSA_EXCLUDES(mutex_);
 
 	/*
@@ -60,6 +62,15 @@ private:
 	int status_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
 
 	std::unique_ptr<DeviceEnumerator> enumerator_;
+	bool matched_;
+
+	struct PipelineThread {
+		std::unique_ptr<Thread> thread;
+		std::weak_ptr<PipelineHandler> pipe;
+	};
+
+	bool threadedPipelines_;
+	std::vector<PipelineThread> pipelineThreads_;
 
 	IPAManager ipaManager_;
 	ProcessManager processManager_;
@@ -13,6 +13,7 @@
 
 #include <libcamera/base/class.h>
 #include <libcamera/base/log.h>
+#include <libcamera/base/span.h>
 
 #include <libcamera/control_ids.h>
 #include <libcamera/controls.h>
@@ -39,6 +40,13 @@ enum class Orientation;
 class CameraSensor : protected Loggable
 {
 public:
+	struct Mode {
+		unsigned int mbusCode;
+		Size size;
+		unsigned int bitDepth;
+		double aspectRatio;
+	};
+
 	explicit CameraSensor(const MediaEntity *entity);
 	~CameraSensor();
 
@@ -49,6 +57,8 @@ public:
 	const MediaEntity *entity() const { return entity_; }
 	const std::vector<unsigned int> &mbusCodes() const { return mbusCodes_; }
 	std::vector<Size> sizes(unsigned int mbusCode) const;
+	const std::vector<Mode> &modes() const { return modes_; }
+	Span<const Mode> modes(unsigned int mbusCode) const;
 	Size resolution() const;
 	const std::vector<controls::draft::TestPatternModeEnum> &testPatternModes() const
 	{
@@ -108,6 +118,7 @@ private:
 	V4L2Subdevice::Formats formats_;
 	std::vector<unsigned int> mbusCodes_;
 	std::vector<Size> sizes_;
+	std::vector<Mode> modes_;
 	std::vector<controls::draft::TestPatternModeEnum> testPatternModes_;
 	controls::draft::TestPatternModeEnum testPatternMode_;
 
@@ -9,6 +9,8 @@
 
 #include <map>
 #include <memory>
+#include <stdint.h>
+#include <utility>
 #include <vector>
 
 #include <libcamera/controls.h>
@@ -29,6 +31,8 @@ public:
 
 	void reset();
 
+	void setDeltaEncoding(bool enable);
+
 	static size_t binarySize(const ControlInfoMap &infoMap);
 	static size_t binarySize(const ControlList &list);
 
@@ -41,6 +45,19 @@ public:
 	bool isCached(const ControlInfoMap &infoMap);
 
 private:
+	struct DeltaBaseline {
+		const ControlValue *find(unsigned int id) const;
+		void update(const ControlList &list, uint32_t seq);
+
+		uint32_t sequence = 0;
+		std::vector<std::pair<unsigned int, ControlValue>> values;
+	};
+
+	using DeltaBaselineKey = std::pair<uint32_t, uint32_t>;
+
+	uint32_t headerFlags() const;
+	void parseHeaderFlags(uint32_t flags);
+
 	static size_t binarySize(const ControlValue &value);
 	static size_t binarySize(const ControlInfo &info);
 
@@ -57,6 +74,12 @@ private:
 	std::vector<std::unique_ptr<ControlIdMap>> controlIdMaps_;
 	std::map<unsigned int, ControlInfoMap> infoMaps_;
 	std::map<const ControlInfoMap *, unsigned int> infoMapHandles_;
+
+	bool deltaEnabled_;
+	bool peerDeltaCapable_;
+	bool resyncRequested_;
+	std::map<DeltaBaselineKey, DeltaBaseline> txBaselines_;
+	std::map<DeltaBaselineKey, DeltaBaseline> rxBaselines_;
 };
 
 } /* namespace libcamera */
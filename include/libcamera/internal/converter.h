@@ -55,6 +55,8 @@ public:
 	virtual int queueBuffers(FrameBuffer *input,
 				 const std::map<unsigned int, FrameBuffer *> &outputs) = 0;
 
+	virtual int setInputCrop(unsigned int output, Rectangle *rect);
+
 	Signal<FrameBuffer *> inputBufferReady;
 	Signal<FrameBuffer *> outputBufferReady;
 
@@ -73,6 +75,7 @@ public:
 	const std::vector<std::string> &compatibles() const { return compatibles_; }
 
 	static std::unique_ptr<Converter> create(MediaDevice *media);
+	static std::unique_ptr<Converter> create(const std::string &name);
 	static std::vector<ConverterFactoryBase *> &factories();
 	static std::vector<std::string> names();
 
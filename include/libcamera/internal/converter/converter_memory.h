@@ -0,0 +1,65 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * converter_memory.h - Base class for converters without a device
+ */
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <libcamera/base/object.h>
+
+#include <libcamera/stream.h>
+
+#include "libcamera/internal/converter.h"
+#include "libcamera/internal/dma_buf_allocator.h"
+
+namespace libcamera {
+
+class FrameBuffer;
+class MediaDevice;
+
+class MemoryConverter : public Converter, public Object
+{
+public:
+	MemoryConverter(MediaDevice *media, const std::string &name);
+
+	int exportBuffers(unsigned int output, unsigned int count,
+			  std::vector<std::unique_ptr<FrameBuffer>> *buffers);
+
+	int start();
+
+protected:
+	struct Job {
+		virtual ~Job() = default;
+
+		FrameBuffer *input;
+		std::map<unsigned int, FrameBuffer *> outputs;
+		std::atomic<bool> done;
+	};
+
+	int validateOutputs(const std::map<unsigned int, FrameBuffer *> &outputs) const;
+	Job *pushJob(std::unique_ptr<Job> job);
+	void finishJob(Job *job);
+	void flushJobs();
+
+	virtual void completeJob(Job *job);
+
+	DmaBufAllocator dmaHeap_;
+	std::vector<StreamConfiguration> outputConfigs_;
+
+private:
+	void jobDone();
+
+	std::string name_;
+	std::queue<std::unique_ptr<Job>> jobs_;
+};
+
+} /* namespace libcamera */
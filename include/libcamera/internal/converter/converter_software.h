@@ -0,0 +1,102 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * converter_software.h - CPU-based format converter
+ */
+
+#pragma once
+
+#include <array>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <libcamera/base/shared_fd.h>
+#include <libcamera/base/signal.h>
+
+#include <libcamera/pixel_format.h>
+#include <libcamera/stream.h>
+
+#include "libcamera/internal/converter/converter_memory.h"
+#include "libcamera/internal/converter/debayer_cpu.h"
+#include "libcamera/internal/converter/software_statistics.h"
+#include "libcamera/internal/dma_buf_allocator.h"
+#include "libcamera/internal/mapped_framebuffer.h"
+#include "libcamera/internal/shared_mem_object.h"
+#include "libcamera/internal/thread_pool.h"
+
+namespace libcamera {
+
+class FrameBuffer;
+class MediaDevice;
+class Size;
+class SizeRange;
+
+class SoftwareConverter : public MemoryConverter
+{
+public:
+	SoftwareConverter(MediaDevice *media);
+	~SoftwareConverter();
+
+	int loadConfiguration([[maybe_unused]] const std::string &filename) { return 0; }
+	bool isValid() const { return dmaHeap_.isValid() && stats_; }
+
+	std::vector<PixelFormat> formats(PixelFormat input);
+	SizeRange sizes(const Size &input);
+
+	std::tuple<unsigned int, unsigned int>
+	strideAndFrameSize(const PixelFormat &pixelFormat, const Size &size);
+
+	int configure(const StreamConfiguration &inputCfg,
+		      const std::vector<std::reference_wrapper<StreamConfiguration>> &outputCfgs);
+
+	void stop();
+
+	int queueBuffers(FrameBuffer *input,
+			 const std::map<unsigned int, FrameBuffer *> &outputs);
+
+	const SharedFD &statistics() const { return stats_.fd(); }
+
+	Signal<uint32_t> statisticsReady;
+
+private:
+	static constexpr unsigned int kMaxThreads = 4;
+
+	struct Job : public MemoryConverter::Job {
+		std::vector<MappedFrameBuffer> maps;
+		std::vector<DmaSyncer> syncers;
+		std::vector<DebayerCpu::Output> destinations;
+
+		std::shared_ptr<const DebayerCpu::Tables> tables;
+		std::array<SoftwareStatistics, kMaxThreads> stats;
+	};
+
+	struct Strip {
+		DebayerCpu debayer;
+		unsigned int start;
+		unsigned int end;
+	};
+
+	void processStrip(Job *job, unsigned int index);
+	void completeJob(MemoryConverter::Job *job) override;
+	void updateTables();
+
+	std::vector<Strip> strips_;
+
+	unsigned int bitDepth_;
+
+	std::array<uint8_t, 1024> gamma_;
+	std::array<double, 3> gains_;
+	std::shared_ptr<const DebayerCpu::Tables> tables_;
+
+	SharedMemObject<SoftwareStatistics> stats_;
+
+	/* Destroyed first, as the strips being processed use the above. */
+	ThreadPool pool_;
+};
+
+} /* namespace libcamera */
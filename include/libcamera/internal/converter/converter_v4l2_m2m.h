@@ -11,12 +11,15 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <queue>
 #include <string>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include <libcamera/base/log.h>
 #include <libcamera/base/signal.h>
+#include <libcamera/base/utils.h>
 
 #include <libcamera/pixel_format.h>
 
@@ -26,6 +29,7 @@ namespace libcamera {
 
 class FrameBuffer;
 class MediaDevice;
+class Rectangle;
 class Size;
 class SizeRange;
 struct StreamConfiguration;
@@ -34,6 +38,16 @@ class V4L2M2MDevice;
 class V4L2M2MConverter : public Converter
 {
 public:
+	struct Statistics {
+		unsigned int frames;
+		unsigned int maxQueueDepth;
+		utils::Duration busyTime;
+		utils::Duration latency;
+		utils::Duration activeTime;
+
+		double utilization() const;
+	};
+
 	V4L2M2MConverter(MediaDevice *media);
 
 	int loadConfiguration([[maybe_unused]] const std::string &filename) { return 0; }
@@ -56,6 +70,10 @@ public:
 	int queueBuffers(FrameBuffer *input,
 			 const std::map<unsigned int, FrameBuffer *> &outputs);
 
+	int setInputCrop(unsigned int output, Rectangle *rect);
+
+	Statistics statistics(unsigned int output) const;
+
 private:
 	class Stream : protected Loggable
 	{
@@ -63,6 +81,7 @@ private:
 		Stream(V4L2M2MConverter *converter, unsigned int index);
 
 		bool isValid() const { return m2m_ != nullptr; }
+		bool isReady() const;
 
 		int configure(const StreamConfiguration &inputCfg,
 			      const StreamConfiguration &outputCfg);
@@ -72,12 +91,20 @@ private:
 		int start();
 		void stop();
 
-		int queueBuffers(FrameBuffer *input, FrameBuffer *output);
+		int setInputCrop(Rectangle *rect);
+
+		void addJob(FrameBuffer *input, FrameBuffer *output);
+		void queueJob();
+
+		Statistics statistics() const;
 
 	protected:
 		std::string logPrefix() const override;
 
 	private:
+		void cancelJob(FrameBuffer *input, FrameBuffer *output);
+		void releaseInput(FrameBuffer *buffer);
+
 		void captureBufferReady(FrameBuffer *buffer);
 		void outputBufferReady(FrameBuffer *buffer);
 
@@ -87,12 +114,24 @@ private:
 
 		unsigned int inputBufferCount_;
 		unsigned int outputBufferCount_;
+
+		std::queue<std::pair<FrameBuffer *, FrameBuffer *>> pending_;
+		std::queue<utils::time_point> inFlight_;
+		unsigned int queuedInputs_;
+
+		Statistics stats_;
+		utils::time_point startTime_;
 	};
 
+	void schedule();
+
 	std::unique_ptr<V4L2M2MDevice> m2m_;
 
 	std::vector<Stream> streams_;
 	std::map<FrameBuffer *, unsigned int> queue_;
+
+	unsigned int nextStream_;
+	utils::time_point lastCompletion_;
 };
 
 } /* namespace libcamera */
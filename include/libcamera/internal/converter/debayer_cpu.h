@@ -0,0 +1,89 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * debayer_cpu.h - CPU implementation of Bayer to RGB conversion
+ */
+
+#pragma once
+
+#include <array>
+#include <stdint.h>
+#include <vector>
+
+#include <libcamera/base/span.h>
+
+#include <libcamera/geometry.h>
+#include <libcamera/pixel_format.h>
+
+#include "libcamera/internal/bayer_format.h"
+#include "libcamera/internal/converter/software_statistics.h"
+
+namespace libcamera {
+
+class DebayerCpu
+{
+public:
+	enum Colour {
+		Red = 0,
+		Green = 1,
+		Blue = 2,
+	};
+
+	struct Tables {
+		std::array<std::vector<uint8_t>, 3> lut;
+	};
+
+	struct Output {
+		uint8_t *data;
+		unsigned int stride;
+		PixelFormat format;
+	};
+
+	static bool isSupportedInput(const PixelFormat &format);
+	static bool isSupportedOutput(const PixelFormat &format);
+	static const std::vector<PixelFormat> &outputFormats();
+
+	int configure(const PixelFormat &inputFormat, const Size &size,
+		      unsigned int stride);
+
+	unsigned int bitDepth() const { return bayer_.bitDepth; }
+
+	void process(const uint8_t *input, Span<const Output> outputs,
+		     unsigned int start, unsigned int end,
+		     const Tables &tables, SoftwareStatistics *stats);
+
+private:
+	using PackFunction = void (*)(uint8_t *dst, const uint8_t *r,
+				      const uint8_t *g, const uint8_t *b,
+				      unsigned int width);
+
+	static PackFunction packFunction(const PixelFormat &format);
+
+	void unpackLine(const uint8_t *src, uint16_t *dst) const;
+	void interpolateLine(const uint16_t *prev, const uint16_t *cur,
+			     const uint16_t *next);
+	void lookupLine(unsigned int y, const uint16_t *cur, const Tables &tables);
+	void statsQuads(unsigned int y, const uint16_t *top,
+			const uint16_t *bottom, SoftwareStatistics *stats) const;
+
+	unsigned int mirror(int y) const;
+
+	BayerFormat bayer_;
+	Size size_;
+	unsigned int stride_ = 0;
+	Colour colours_[2][2];
+	unsigned int redPosition_;
+	unsigned int greenPositions_[2];
+	unsigned int bluePosition_;
+	std::vector<uint8_t> zoneColumns_;
+
+	std::array<std::vector<uint16_t>, 3> lines_;
+	std::vector<uint16_t> horizontal_;
+	std::vector<uint16_t> vertical_;
+	std::vector<uint16_t> cross_;
+	std::vector<uint16_t> diagonal_;
+	std::array<std::vector<uint8_t>, 3> rgb_;
+};
+
+} /* namespace libcamera */
@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * software_statistics.h - Statistics generated by the software converter
+ */
+
+#pragma once
+
+#include <array>
+#include <stdint.h>
+
+namespace libcamera {
+
+struct SoftwareStatistics {
+	static constexpr unsigned int kGridWidth = 16;
+	static constexpr unsigned int kGridHeight = 12;
+	static constexpr unsigned int kNumZones = kGridWidth * kGridHeight;
+	static constexpr unsigned int kHistogramBins = 64;
+
+	std::array<uint64_t, 3> sum;
+	std::array<uint64_t, 3> count;
+
+	std::array<std::array<uint64_t, 3>, kNumZones> zoneSums;
+	std::array<uint32_t, kNumZones> zoneCounts;
+	std::array<uint32_t, kHistogramBins> histogram;
+};
+
+} /* namespace libcamera */
@@ -7,8 +7,10 @@
 
 #pragma once
 
+#include <array>
 #include <stdint.h>
 #include <unordered_map>
+#include <vector>
 
 #include <libcamera/controls.h>
 
@@ -27,10 +29,11 @@ public:
 	DelayedControls(V4L2Device *device,
 			const std::unordered_map<uint32_t, ControlParams> &controlParams);
 
-	void reset();
+	void reset(unsigned int cookie = 0);
 
-	bool push(const ControlList &controls);
+	bool push(const ControlList &controls, unsigned int cookie = 0);
 	ControlList get(uint32_t sequence);
+	unsigned int cookie(uint32_t sequence) const;
 
 	void applyControls(uint32_t sequence);
 
@@ -53,29 +56,41 @@ private:
 
 	/* \todo Make the listSize configurable at instance creation time. */
 	static constexpr int listSize = 16;
-	class ControlRingBuffer : public std::array<Info, listSize>
+	template<typename T>
+	class RingBuffer : public std::array<T, listSize>
 	{
 	public:
-		Info &operator[](unsigned int index)
+		T &operator[](unsigned int index)
 		{
-			return std::array<Info, listSize>::operator[](index % listSize);
+			return std::array<T, listSize>::operator[](index % listSize);
 		}
 
-		const Info &operator[](unsigned int index) const
+		const T &operator[](unsigned int index) const
 		{
-			return std::array<Info, listSize>::operator[](index % listSize);
+			return std::array<T, listSize>::operator[](index % listSize);
 		}
 	};
 
+	struct Slot {
+		const ControlId *id;
+		ControlParams params;
+		RingBuffer<Info> values;
+	};
+
+	Slot *findSlot(unsigned int id);
+
 	V4L2Device *device_;
-	/* \todo Evaluate if we should index on ControlId * or unsigned int */
-	std::unordered_map<const ControlId *, ControlParams> controlParams_;
 	unsigned int maxDelay_;
 
 	uint32_t queueCount_;
 	uint32_t writeCount_;
-	/* \todo Evaluate if we should index on ControlId * or unsigned int */
-	std::unordered_map<const ControlId *, ControlRingBuffer> values_;
+
+	/* Sorted by control numerical id */
+	std::vector<Slot> slots_;
+	RingBuffer<unsigned int> cookies_;
+
+	ControlList controls_;
+	ControlList priorityControls_;
 };
 
 } /* namespace libcamera */
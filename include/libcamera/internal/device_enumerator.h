@@ -42,16 +42,21 @@ public:
 	virtual int enumerate() = 0;
 
 	std::shared_ptr<MediaDevice> search(const DeviceMatch &dm);
+	std::vector<std::shared_ptr<MediaDevice>> takeAddedDevices();
 
 	Signal<> devicesAdded;
 
 protected:
 	std::unique_ptr<MediaDevice> createDevice(const std::string &deviceNode);
+	std::vector<std::unique_ptr<MediaDevice>>
+	createDevices(const std::vector<std::string> &deviceNodes);
 	void addDevice(std::unique_ptr<MediaDevice> media);
 	void removeDevice(const std::string &deviceNode);
+	void notifyDevicesAdded();
 
 private:
 	std::vector<std::shared_ptr<MediaDevice>> devices_;
+	std::vector<std::weak_ptr<MediaDevice>> addedDevices_;
 };
 
 } /* namespace libcamera */
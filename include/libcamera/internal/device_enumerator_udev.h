@@ -7,12 +7,16 @@
 
 #pragma once
 
+#include <chrono>
 #include <list>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
 #include <sys/types.h>
+#include <vector>
+
+#include <libcamera/base/timer.h>
 
 #include "libcamera/internal/device_enumerator.h"
 
@@ -54,17 +58,23 @@ private:
 		DependencyMap deps_;
 	};
 
-	int addUdevDevice(struct udev_device *dev);
+	int addUdevDevice(struct udev_device *dev,
+			  std::unique_ptr<MediaDevice> media = nullptr);
 	int populateMediaDevice(MediaDevice *media, DependencyMap *deps);
 	std::string lookupDeviceNode(dev_t devnum);
 
 	int addV4L2Device(dev_t devnum);
 	void udevNotify();
+	void processEvents();
 
 	struct udev *udev_;
 	struct udev_monitor *monitor_;
 	EventNotifier *notifier_;
 
+	std::vector<struct udev_device *> events_;
+	std::chrono::steady_clock::time_point batchStart_;
+	Timer batchTimer_;
+
 	std::set<dev_t> orphans_;
 	std::list<MediaDeviceDeps> pending_;
 	std::map<dev_t, MediaDeviceDeps *> devMap_;
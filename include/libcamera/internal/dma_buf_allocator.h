@@ -0,0 +1,71 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * dma_buf_allocator.h - DMA-BUF heap allocator
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <libcamera/base/class.h>
+#include <libcamera/base/flags.h>
+#include <libcamera/base/shared_fd.h>
+#include <libcamera/base/unique_fd.h>
+
+namespace libcamera {
+
+class DmaBufAllocator
+{
+public:
+	enum class DmaBufAllocatorFlag {
+		CmaHeap = 1 << 0,
+		SystemHeap = 1 << 1,
+		SystemUncachedHeap = 1 << 2,
+	};
+
+	using DmaBufAllocatorFlags = Flags<DmaBufAllocatorFlag>;
+
+	DmaBufAllocator(DmaBufAllocatorFlags type = DmaBufAllocatorFlag::CmaHeap);
+	~DmaBufAllocator();
+
+	bool isValid() const { return providerHandle_.isValid(); }
+
+	UniqueFD alloc(const char *name, std::size_t size);
+
+private:
+	LIBCAMERA_DISABLE_COPY_AND_MOVE(DmaBufAllocator)
+
+	UniqueFD providerHandle_;
+};
+
+LIBCAMERA_FLAGS_ENABLE_OPERATORS(DmaBufAllocator::DmaBufAllocatorFlag)
+
+class DmaSyncer final
+{
+public:
+	enum class SyncType {
+		Read = 0,
+		Write,
+		ReadWrite,
+	};
+
+	explicit DmaSyncer(SharedFD fd, SyncType type = SyncType::ReadWrite);
+
+	DmaSyncer(DmaSyncer &&other) = default;
+	DmaSyncer &operator=(DmaSyncer &&other) = default;
+
+	~DmaSyncer();
+
+private:
+	LIBCAMERA_DISABLE_COPY(DmaSyncer)
+
+	void sync(uint64_t step);
+
+	SharedFD fd_;
+	uint64_t flags_ = 0;
+};
+
+} /* namespace libcamera */
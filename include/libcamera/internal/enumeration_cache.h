@@ -0,0 +1,70 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * enumeration_cache.h - Persistent cache of device enumeration results
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <libcamera/base/class.h>
+#include <libcamera/base/mutex.h>
+#include <libcamera/base/span.h>
+#include <libcamera/base/thread_annotations.h>
+
+#include <libcamera/geometry.h>
+
+namespace libcamera {
+
+class MediaDevice;
+
+class CacheFile
+{
+public:
+	static bool enabled();
+	static std::string path(const std::string &name);
+	static std::string sanitize(const std::string &name);
+	static int write(const std::string &path, Span<const uint8_t> data);
+};
+
+class EnumerationCache
+{
+public:
+	using Formats = std::map<unsigned int, std::vector<SizeRange>>;
+
+	static std::unique_ptr<EnumerationCache> create(const MediaDevice &media);
+
+	uint64_t key() const { return key_; }
+
+	std::optional<Formats> formats(unsigned int entity, unsigned int pad) const;
+	void setFormats(unsigned int entity, unsigned int pad,
+			const Formats &formats);
+
+private:
+	LIBCAMERA_DISABLE_COPY_AND_MOVE(EnumerationCache)
+
+	EnumerationCache(const std::string &path, uint64_t key);
+
+	void load();
+	int flush() LIBCAMERA_TSA_REQUIRES(mutex_);
+
+	static uint64_t topologyKey(const MediaDevice &media);
+
+	std::string path_;
+	uint64_t key_;
+
+	mutable Mutex mutex_;
+	std::map<std::pair<unsigned int, unsigned int>, Formats> formats_
+		LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	bool dirty_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+};
+
+} /* namespace libcamera */
@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * fence_waiter.h - Wait for multiple fences with a single event notifier
+ */
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <utility>
+
+#include <libcamera/base/class.h>
+#include <libcamera/base/timer.h>
+#include <libcamera/base/unique_fd.h>
+#include <libcamera/base/utils.h>
+
+#include <libcamera/request.h>
+
+namespace libcamera {
+
+class EventNotifier;
+class FrameBuffer;
+
+class FenceWaiter
+{
+public:
+	FenceWaiter();
+	~FenceWaiter();
+
+	bool isValid() const { return epollFd_.isValid(); }
+
+	int add(FrameBuffer *buffer);
+	void remove(FrameBuffer *buffer);
+
+	void startTimeout(Request::Private *request, std::chrono::milliseconds timeout);
+	void stopTimeout(Request::Private *request);
+
+private:
+	LIBCAMERA_DISABLE_COPY_AND_MOVE(FenceWaiter)
+
+	void fencesReady();
+	void timeout();
+	void updateTimer();
+
+	UniqueFD epollFd_;
+	std::unique_ptr<EventNotifier> notifier_;
+
+	Timer timer_;
+	std::deque<std::pair<utils::time_point, Request::Private *>> deadlines_;
+};
+
+} /* namespace libcamera */
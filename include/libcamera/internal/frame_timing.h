@@ -0,0 +1,41 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * frame_timing.h - Camera frame timing model
+ */
+
+#pragma once
+
+#include <optional>
+#include <stdint.h>
+
+namespace libcamera {
+
+class FrameTiming
+{
+public:
+	FrameTiming();
+
+	void reset();
+
+	void addFrame(int64_t timestamp,
+		      std::optional<int64_t> frameDuration = std::nullopt,
+		      unsigned int framesDropped = 0);
+
+	bool isValid() const;
+	int64_t frameInterval() const;
+	int64_t jitter() const { return static_cast<int64_t>(jitter_); }
+	std::optional<int64_t> frameStart(unsigned int frames = 1) const;
+
+private:
+	std::optional<int64_t> lastTimestamp_;
+	int64_t lastDuration_;
+
+	unsigned int samples_;
+	double scale_;
+	double interval_;
+	double jitter_;
+};
+
+} /* namespace libcamera */
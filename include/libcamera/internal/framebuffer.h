@@ -9,14 +9,21 @@
 
 #include <memory>
 #include <utility>
+#include <vector>
+
+#include <sys/types.h>
 
 #include <libcamera/base/class.h>
+#include <libcamera/base/mutex.h>
+#include <libcamera/base/thread_annotations.h>
 
 #include <libcamera/fence.h>
 #include <libcamera/framebuffer.h>
 
 namespace libcamera {
 
+struct FrameBufferMapping;
+
 class FrameBuffer::Private : public Extensible::Private
 {
 	LIBCAMERA_DECLARE_PUBLIC(FrameBuffer)
@@ -27,6 +34,7 @@ public:
 
 	void setRequest(Request *request) { request_ = request; }
 	bool isContiguous() const { return isContiguous_; }
+	const std::vector<ino_t> &inodes() const { return inodes_; }
 
 	Fence *fence() const { return fence_.get(); }
 	void setFence(std::unique_ptr<Fence> fence) { fence_ = std::move(fence); }
@@ -35,6 +43,9 @@ public:
 
 	FrameMetadata &metadata() { return metadata_; }
 
+	std::shared_ptr<FrameBufferMapping> mapping() const;
+	void setMapping(std::shared_ptr<FrameBufferMapping> mapping) const;
+
 private:
 	std::vector<Plane> planes_;
 	FrameMetadata metadata_;
@@ -43,6 +54,11 @@ private:
 	std::unique_ptr<Fence> fence_;
 	Request *request_;
 	bool isContiguous_;
+	std::vector<ino_t> inodes_;
+
+	mutable Mutex mappingLock_;
+	mutable std::shared_ptr<FrameBufferMapping> mapping_
+		LIBCAMERA_TSA_GUARDED_BY(mappingLock_);
 };
 
 } /* namespace libcamera */
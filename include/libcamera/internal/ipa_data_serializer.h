@@ -12,6 +12,7 @@
 #include <string.h>
 #include <tuple>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <libcamera/base/flags.h>
@@ -41,6 +42,19 @@ void appendPOD(std::vector<uint8_t> &vec, T val)
 	memcpy(&*(vec.end() - byteWidth), &val, byteWidth);
 }
 
+/*
+ * Overwrite a value previously appended at position \a pos, used to backpatch
+ * sizes that are only known once the data that follows has been serialized.
+ */
+template<typename T,
+	 std::enable_if_t<std::is_arithmetic_v<T>> * = nullptr>
+void writePOD(std::vector<uint8_t> &vec, size_t pos, T val)
+{
+	ASSERT(pos + sizeof(val) <= vec.size());
+
+	memcpy(vec.data() + pos, &val, sizeof(val));
+}
+
 template<typename T,
 	 std::enable_if_t<std::is_arithmetic_v<T>> * = nullptr>
 T readPOD(std::vector<uint8_t>::const_iterator it, size_t pos,
@@ -69,6 +83,9 @@ class IPADataSerializer
 public:
 	static std::tuple<std::vector<uint8_t>, std::vector<SharedFD>>
 	serialize(const T &data, ControlSerializer *cs = nullptr);
+	static void serialize(const T &data, std::vector<uint8_t> &dataVec,
+			      std::vector<SharedFD> &fdsVec,
+			      ControlSerializer *cs = nullptr);
 
 	static T deserialize(const std::vector<uint8_t> &data,
 			     ControlSerializer *cs = nullptr);
@@ -111,26 +128,46 @@ public:
 		std::vector<uint8_t> dataVec;
 		std::vector<SharedFD> fdsVec;
 
+		serialize(data, dataVec, fdsVec, cs);
+
+		return { std::move(dataVec), std::move(fdsVec) };
+	}
+
+	static void serialize(const std::vector<V> &data, std::vector<uint8_t> &dataVec,
+			      std::vector<SharedFD> &fdsVec, ControlSerializer *cs = nullptr)
+	{
 		/* Serialize the length. */
 		uint32_t vecLen = data.size();
 		appendPOD<uint32_t>(dataVec, vecLen);
 
+		if constexpr (std::is_arithmetic_v<V>)
+			dataVec.reserve(dataVec.size() + vecLen * (8 + sizeof(V)));
+
 		/* Serialize the members. */
 		for (auto const &it : data) {
-			std::vector<uint8_t> dvec;
-			std::vector<SharedFD> fvec;
-
-			std::tie(dvec, fvec) =
-				IPADataSerializer<V>::serialize(it, cs);
-
-			appendPOD<uint32_t>(dataVec, dvec.size());
-			appendPOD<uint32_t>(dataVec, fvec.size());
-
-			dataVec.insert(dataVec.end(), dvec.begin(), dvec.end());
-			fdsVec.insert(fdsVec.end(), fvec.begin(), fvec.end());
+			/*
+			 * Arithmetic elements have a known size and are written
+			 * directly, other elements are serialized in place and
+			 * their sizes backpatched.
+			 */
+			if constexpr (std::is_arithmetic_v<V>) {
+				appendPOD<uint32_t>(dataVec, sizeof(V));
+				appendPOD<uint32_t>(dataVec, 0);
+				appendPOD<V>(dataVec, it);
+			} else {
+				size_t sizePos = dataVec.size();
+				appendPOD<uint32_t>(dataVec, 0);
+				appendPOD<uint32_t>(dataVec, 0);
+
+				size_t dataStart = dataVec.size();
+				size_t fdsStart = fdsVec.size();
+
+				IPADataSerializer<V>::serialize(it, dataVec, fdsVec, cs);
+
+				writePOD<uint32_t>(dataVec, sizePos, dataVec.size() - dataStart);
+				writePOD<uint32_t>(dataVec, sizePos + 4, fdsVec.size() - fdsStart);
+			}
 		}
-
-		return { dataVec, fdsVec };
 	}
 
 	static std::vector<V> deserialize(std::vector<uint8_t> &data, ControlSerializer *cs = nullptr)
@@ -168,11 +205,19 @@ public:
 			uint32_t sizeofFds  = readPOD<uint32_t>(dataIter, 4, dataEnd);
 			dataIter += 8;
 
-			ret[i] = IPADataSerializer<V>::deserialize(dataIter,
-								   dataIter + sizeofData,
-								   fdIter,
-								   fdIter + sizeofFds,
-								   cs);
+			/*
+			 * Read arithmetic elements directly from the buffer
+			 * instead of going through the out-of-line
+			 * IPADataSerializer<V> specialization for each element.
+			 */
+			if constexpr (std::is_arithmetic_v<V>)
+				ret[i] = readPOD<V>(dataIter, 0, dataEnd);
+			else
+				ret[i] = IPADataSerializer<V>::deserialize(dataIter,
+									   dataIter + sizeofData,
+									   fdIter,
+									   fdIter + sizeofFds,
+									   cs);
 
 			dataIter += sizeofData;
 			fdIter += sizeofFds;
@@ -208,35 +253,23 @@ public:
 		std::vector<uint8_t> dataVec;
 		std::vector<SharedFD> fdsVec;
 
+		serialize(data, dataVec, fdsVec, cs);
+
+		return { std::move(dataVec), std::move(fdsVec) };
+	}
+
+	static void serialize(const std::map<K, V> &data, std::vector<uint8_t> &dataVec,
+			      std::vector<SharedFD> &fdsVec, ControlSerializer *cs = nullptr)
+	{
 		/* Serialize the length. */
 		uint32_t mapLen = data.size();
 		appendPOD<uint32_t>(dataVec, mapLen);
 
 		/* Serialize the members. */
 		for (auto const &it : data) {
-			std::vector<uint8_t> dvec;
-			std::vector<SharedFD> fvec;
-
-			std::tie(dvec, fvec) =
-				IPADataSerializer<K>::serialize(it.first, cs);
-
-			appendPOD<uint32_t>(dataVec, dvec.size());
-			appendPOD<uint32_t>(dataVec, fvec.size());
-
-			dataVec.insert(dataVec.end(), dvec.begin(), dvec.end());
-			fdsVec.insert(fdsVec.end(), fvec.begin(), fvec.end());
-
-			std::tie(dvec, fvec) =
-				IPADataSerializer<V>::serialize(it.second, cs);
-
-			appendPOD<uint32_t>(dataVec, dvec.size());
-			appendPOD<uint32_t>(dataVec, fvec.size());
-
-			dataVec.insert(dataVec.end(), dvec.begin(), dvec.end());
-			fdsVec.insert(fdsVec.end(), fvec.begin(), fvec.end());
+			serializeMember<K>(it.first, dataVec, fdsVec, cs);
+			serializeMember<V>(it.second, dataVec, fdsVec, cs);
 		}
-
-		return { dataVec, fdsVec };
 	}
 
 	static std::map<K, V> deserialize(std::vector<uint8_t> &data, ControlSerializer *cs = nullptr)
@@ -287,12 +320,19 @@ public:
 			sizeofFds  = readPOD<uint32_t>(dataIter, 4, dataEnd);
 			dataIter += 8;
 
-			const V value = IPADataSerializer<V>::deserialize(dataIter,
-									  dataIter + sizeofData,
-									  fdIter,
-									  fdIter + sizeofFds,
-									  cs);
-			ret.insert({ key, value });
+			V value = IPADataSerializer<V>::deserialize(dataIter,
+								    dataIter + sizeofData,
+								    fdIter,
+								    fdIter + sizeofFds,
+								    cs);
+
+			/*
+			 * The map has been serialized in key order, insert
+			 * at the end to avoid searching the tree, and move
+			 * the key and value to avoid copying nested
+			 * containers.
+			 */
+			ret.emplace_hint(ret.end(), std::move(key), std::move(value));
 
 			dataIter += sizeofData;
 			fdIter += sizeofFds;
@@ -300,6 +340,25 @@ public:
 
 		return ret;
 	}
+
+private:
+	/* Serialize a key or value in place and backpatch its sizes. */
+	template<typename M>
+	static void serializeMember(const M &member, std::vector<uint8_t> &dataVec,
+				    std::vector<SharedFD> &fdsVec, ControlSerializer *cs)
+	{
+		size_t sizePos = dataVec.size();
+		appendPOD<uint32_t>(dataVec, 0);
+		appendPOD<uint32_t>(dataVec, 0);
+
+		size_t dataStart = dataVec.size();
+		size_t fdsStart = fdsVec.size();
+
+		IPADataSerializer<M>::serialize(member, dataVec, fdsVec, cs);
+
+		writePOD<uint32_t>(dataVec, sizePos, dataVec.size() - dataStart);
+		writePOD<uint32_t>(dataVec, sizePos + 4, fdsVec.size() - fdsStart);
+	}
 };
 
 /* Serialization format for Flags is same as for PODs */
@@ -317,6 +376,13 @@ public:
 		return { dataVec, {} };
 	}
 
+	static void serialize(const Flags<E> &data, std::vector<uint8_t> &dataVec,
+			      [[maybe_unused]] std::vector<SharedFD> &fdsVec,
+			      [[maybe_unused]] ControlSerializer *cs = nullptr)
+	{
+		appendPOD<uint32_t>(dataVec, static_cast<typename Flags<E>::Type>(data));
+	}
+
 	static Flags<E> deserialize(std::vector<uint8_t> &data,
 				    [[maybe_unused]] ControlSerializer *cs = nullptr)
 	{
@@ -7,15 +7,23 @@
 
 #pragma once
 
+#include <map>
+#include <memory>
 #include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <tuple>
 #include <vector>
 
 #include <libcamera/base/log.h>
+#include <libcamera/base/mutex.h>
+#include <libcamera/base/thread_annotations.h>
 
 #include <libcamera/ipa/ipa_interface.h>
 #include <libcamera/ipa/ipa_module_info.h>
 
 #include "libcamera/internal/ipa_module.h"
+#include "libcamera/internal/ipc_pipe_unixsocket.h"
 #include "libcamera/internal/pipeline_handler.h"
 #include "libcamera/internal/pub_key.h"
 
@@ -47,6 +55,12 @@ public:
 		return proxy;
 	}
 
+	static std::unique_ptr<IPCPipeUnixSocket>
+	createIPCPipe(const IPAModule *ipam, const std::string &workerPath,
+		      IPCPipeUnixSocket::Transport transport);
+
+	void releaseSpareWorkers();
+
 #if HAVE_IPA_PUBKEY
 	static const PubKey &pubKey()
 	{
@@ -57,6 +71,13 @@ public:
 private:
 	static IPAManager *self_;
 
+	/* Identity of a module file: device, inode, mtime (s, ns) and size. */
+	using FileId = std::tuple<dev_t, ino_t, time_t, long, off_t>;
+
+	/* Proxy worker process: module path, worker path and transport. */
+	using WorkerId = std::tuple<std::string, std::string,
+				    IPCPipeUnixSocket::Transport>;
+
 	void parseDir(const char *libDir, unsigned int maxDepth,
 		      std::vector<std::string> &files);
 	unsigned int addDir(const char *libDir, unsigned int maxDepth = 0);
@@ -66,7 +87,15 @@ private:
 
 	bool isSignatureValid(IPAModule *ipa) const;
 
-	std::vector<IPAModule *> modules_;
+	mutable Mutex mutex_;
+	std::vector<std::string> moduleFiles_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	unsigned int nextModuleFile_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	std::vector<IPAModule *> modules_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	mutable std::map<FileId, bool> signatures_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+
+	bool prewarmWorkers_;
+	std::map<WorkerId, std::unique_ptr<IPCPipeUnixSocket>> spareWorkers_
+		LIBCAMERA_TSA_GUARDED_BY(mutex_);
 
 #if HAVE_IPA_PUBKEY
 	static const uint8_t publicKeyData_[];
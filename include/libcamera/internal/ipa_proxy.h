@@ -13,6 +13,8 @@
 
 #include <libcamera/ipa/ipa_interface.h>
 
+#include "libcamera/internal/ipc_pipe_unixsocket.h"
+
 namespace libcamera {
 
 class IPAModule;
@@ -35,6 +37,7 @@ public:
 
 protected:
 	std::string resolvePath(const std::string &file) const;
+	IPCPipeUnixSocket::Transport ipcTransport() const;
 
 	bool valid_;
 	ProxyState state_;
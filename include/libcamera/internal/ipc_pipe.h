@@ -7,10 +7,13 @@
 
 #pragma once
 
+#include <array>
+#include <functional>
 #include <vector>
 
 #include <libcamera/base/shared_fd.h>
 #include <libcamera/base/signal.h>
+#include <libcamera/base/span.h>
 
 #include "libcamera/internal/ipc_unixsocket.h"
 
@@ -31,6 +34,9 @@ public:
 
 	IPCUnixSocket::Payload payload() const;
 
+	int send(IPCUnixSocket &socket) const;
+	int queue(IPCUnixSocket &socket) const;
+
 	Header &header() { return header_; }
 	std::vector<uint8_t> &data() { return data_; }
 	std::vector<SharedFD> &fds() { return fds_; }
@@ -40,6 +46,9 @@ public:
 	const std::vector<SharedFD> &fds() const { return fds_; }
 
 private:
+	std::array<Span<const uint8_t>, 2> buffers() const;
+	std::vector<int32_t> rawFds() const;
+
 	Header header_;
 
 	std::vector<uint8_t> data_;
@@ -59,6 +68,9 @@ public:
 
 	virtual int sendAsync(const IPCMessage &data) = 0;
 
+	using ReplyHandler = std::function<void(int ret, const IPCMessage &reply)>;
+	virtual int sendCall(const IPCMessage &in, ReplyHandler handler) = 0;
+
 	Signal<const IPCMessage &> recv;
 
 protected:
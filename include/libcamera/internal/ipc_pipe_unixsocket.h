@@ -11,6 +11,10 @@
 #include <memory>
 #include <vector>
 
+#include <libcamera/base/object.h>
+#include <libcamera/base/timer.h>
+#include <libcamera/base/utils.h>
+
 #include "libcamera/internal/ipc_pipe.h"
 #include "libcamera/internal/ipc_unixsocket.h"
 
@@ -18,10 +22,16 @@ namespace libcamera {
 
 class Process;
 
-class IPCPipeUnixSocket : public IPCPipe
+class IPCPipeUnixSocket : public IPCPipe, public Object
 {
 public:
-	IPCPipeUnixSocket(const char *ipaModulePath, const char *ipaProxyWorkerPath);
+	enum class Transport {
+		Socket,
+		SharedMemory,
+	};
+
+	IPCPipeUnixSocket(const char *ipaModulePath, const char *ipaProxyWorkerPath,
+			  Transport transport = Transport::Socket);
 	~IPCPipeUnixSocket();
 
 	int sendSync(const IPCMessage &in,
@@ -29,19 +39,26 @@ public:
 
 	int sendAsync(const IPCMessage &data) override;
 
+	int sendCall(const IPCMessage &in, ReplyHandler handler) override;
+
 private:
 	struct CallData {
 		IPCUnixSocket::Payload *response;
 		bool done;
+		ReplyHandler handler;
+		utils::time_point deadline;
 	};
 
 	void readyRead();
-	int call(const IPCUnixSocket::Payload &message,
-		 IPCUnixSocket::Payload *response, uint32_t seq);
+	void flush();
+	void callTimeout();
+	int call(const IPCMessage &message, IPCUnixSocket::Payload *response);
 
 	std::unique_ptr<Process> proc_;
 	std::unique_ptr<IPCUnixSocket> socket_;
 	std::map<uint32_t, CallData> callData_;
+	Timer callTimer_;
+	bool flushPending_;
 };
 
 } /* namespace libcamera */
@@ -7,11 +7,14 @@
 
 #pragma once
 
+#include <deque>
+#include <memory>
 #include <stdint.h>
 #include <sys/types.h>
 #include <vector>
 
 #include <libcamera/base/signal.h>
+#include <libcamera/base/span.h>
 #include <libcamera/base/unique_fd.h>
 
 namespace libcamera {
@@ -34,26 +37,51 @@ public:
 	void close();
 	bool isBound() const;
 
+	int enableSharedMemory(size_t size);
+
 	int send(const Payload &payload);
+	int send(Span<const Span<const uint8_t>> data, Span<const int32_t> fds);
+	int queue(const Payload &payload);
+	int queue(Span<const Span<const uint8_t>> data, Span<const int32_t> fds);
+	int flush();
 	int receive(Payload *payload);
 
 	Signal<> readyRead;
+	Signal<> disconnected;
 
 private:
+	class SharedRing;
+
 	struct Header {
 		uint32_t data;
 		uint8_t fds;
+		uint8_t flags;
 	};
 
-	int sendData(const void *buffer, size_t length, const int32_t *fds, unsigned int num);
+	static size_t payloadSize(Span<const Span<const uint8_t>> data);
+
+	int sendPayload(Span<const Span<const uint8_t>> data,
+			Span<const int32_t> fds, uint8_t flags);
+	int sendData(Span<const Span<const uint8_t>> data, Span<const int32_t> fds);
 	int recvData(void *buffer, size_t length, int32_t *fds, unsigned int num);
+	int recvHeader();
+	int receivePayload(Payload *payload);
+	int splitBatch(Payload &batch);
 
 	void dataNotifier();
+	void dispatch();
 
 	UniqueFD fd_;
 	bool headerReceived_;
 	struct Header header_;
+	std::vector<int32_t> headerFds_;
 	EventNotifier *notifier_;
+	std::unique_ptr<SharedRing> ring_;
+
+	std::vector<uint8_t> batchData_;
+	std::vector<UniqueFD> batchFds_;
+	std::deque<Payload> pending_;
+	unsigned int received_;
 };
 
 } /* namespace libcamera */
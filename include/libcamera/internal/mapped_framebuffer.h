@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <map>
+#include <memory>
 #include <stdint.h>
 #include <vector>
 
@@ -43,6 +45,13 @@ private:
 	LIBCAMERA_DISABLE_COPY(MappedBuffer)
 };
 
+struct FrameBufferMapping {
+	~FrameBufferMapping();
+
+	int prot = 0;
+	std::map<int, Span<uint8_t>> maps;
+};
+
 class MappedFrameBuffer : public MappedBuffer
 {
 public:
@@ -55,6 +64,11 @@ public:
 	using MapFlags = Flags<MapFlag>;
 
 	MappedFrameBuffer(const FrameBuffer *buffer, MapFlags flags);
+
+private:
+	std::shared_ptr<FrameBufferMapping> map(const FrameBuffer *buffer, int prot);
+
+	std::shared_ptr<const FrameBufferMapping> mapping_;
 };
 
 LIBCAMERA_FLAGS_ENABLE_OPERATORS(MappedFrameBuffer::MapFlag)
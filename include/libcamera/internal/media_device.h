@@ -8,6 +8,7 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -15,25 +16,31 @@
 #include <linux/media.h>
 
 #include <libcamera/base/log.h>
+#include <libcamera/base/mutex.h>
 #include <libcamera/base/signal.h>
+#include <libcamera/base/span.h>
+#include <libcamera/base/thread_annotations.h>
 #include <libcamera/base/unique_fd.h>
 
 #include "libcamera/internal/media_object.h"
 
 namespace libcamera {
 
+class EnumerationCache;
+class MediaRequest;
+
 class MediaDevice : protected Loggable
 {
 public:
 	MediaDevice(const std::string &deviceNode);
 	~MediaDevice();
 
-	bool acquire();
-	void release();
-	bool busy() const { return acquired_; }
+	bool acquire() LIBCAMERA_TSA_EXCLUDES(mutex_);
+	void release() LIBCAMERA_TSA_EXCLUDES(mutex_);
+	bool busy() const LIBCAMERA_TSA_EXCLUDES(mutex_);
 
-	bool lock();
-	void unlock();
+	bool lock() LIBCAMERA_TSA_EXCLUDES(mutex_);
+	void unlock() LIBCAMERA_TSA_EXCLUDES(mutex_);
 
 	int populate();
 	bool isValid() const { return valid_; }
@@ -41,6 +48,8 @@ public:
 	const std::string &driver() const { return driver_; }
 	const std::string &deviceNode() const { return deviceNode_; }
 	const std::string &model() const { return model_; }
+	const std::string &serial() const { return serial_; }
+	const std::string &busInfo() const { return busInfo_; }
 	unsigned int version() const { return version_; }
 	unsigned int hwRevision() const { return hwRevision_; }
 
@@ -52,7 +61,12 @@ public:
 	MediaLink *link(const MediaEntity *source, unsigned int sourceIdx,
 			const MediaEntity *sink, unsigned int sinkIdx);
 	MediaLink *link(const MediaPad *source, const MediaPad *sink);
-	int disableLinks();
+	int disableLinks(Span<MediaLink *const> keep = {});
+	unsigned int linkGeneration() const { return linkGeneration_; }
+
+	std::unique_ptr<MediaRequest> createRequest();
+
+	EnumerationCache *cache() const { return cache_.get(); }
 
 	Signal<> disconnected;
 
@@ -62,6 +76,7 @@ protected:
 private:
 	int open();
 	void close();
+	int updateLinks();
 
 	MediaObject *object(unsigned int id);
 	bool addObject(MediaObject *object);
@@ -80,15 +95,28 @@ private:
 	std::string driver_;
 	std::string deviceNode_;
 	std::string model_;
+	std::string serial_;
+	std::string busInfo_;
 	unsigned int version_;
 	unsigned int hwRevision_;
 
 	UniqueFD fd_;
 	bool valid_;
-	bool acquired_;
+	bool linksSynced_;
+	unsigned int linkGeneration_;
+
+	/*
+	 * Media devices are shared between pipeline handlers, which may run
+	 * in different threads. The mutex serializes the claiming and locking
+	 * of the device.
+	 */
+	mutable Mutex mutex_;
+	bool acquired_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
 
 	std::map<unsigned int, MediaObject *> objects_;
 	std::vector<MediaEntity *> entities_;
+
+	std::unique_ptr<EnumerationCache> cache_;
 };
 
 } /* namespace libcamera */
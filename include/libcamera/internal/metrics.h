@@ -0,0 +1,91 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * metrics.h - Lightweight performance metrics
+ */
+
+#pragma once
+
+#include <atomic>
+#include <initializer_list>
+#include <stdint.h>
+#include <vector>
+
+#include <libcamera/base/class.h>
+#include <libcamera/base/utils.h>
+
+#include <libcamera/metrics.h>
+
+namespace libcamera {
+
+class MetricCounter
+{
+public:
+	MetricCounter(const char *name);
+
+	void add(uint64_t value = 1);
+
+private:
+	LIBCAMERA_DISABLE_COPY_AND_MOVE(MetricCounter)
+
+	unsigned int slot_;
+};
+
+class MetricGauge
+{
+public:
+	MetricGauge(const char *name);
+	~MetricGauge();
+
+	void set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+	void add(int64_t delta) { value_.fetch_add(delta, std::memory_order_relaxed); }
+	int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+	LIBCAMERA_DISABLE_COPY_AND_MOVE(MetricGauge)
+
+	std::atomic<int64_t> value_;
+};
+
+class MetricHistogram
+{
+public:
+	MetricHistogram(const char *name);
+	MetricHistogram(const char *name, std::initializer_list<uint64_t> bounds);
+
+	void record(uint64_t value);
+
+	const std::vector<uint64_t> &bounds() const { return bounds_; }
+
+private:
+	LIBCAMERA_DISABLE_COPY_AND_MOVE(MetricHistogram)
+
+	std::vector<uint64_t> bounds_;
+	unsigned int slot_;
+};
+
+class MetricTimer
+{
+public:
+	MetricTimer(MetricHistogram &histogram)
+		: histogram_(histogram), start_(utils::clock::now())
+	{
+	}
+
+	~MetricTimer();
+
+private:
+	LIBCAMERA_DISABLE_COPY_AND_MOVE(MetricTimer)
+
+	MetricHistogram &histogram_;
+	utils::time_point start_;
+};
+
+namespace metrics {
+
+MetricsSnapshot snapshot();
+
+} /* namespace metrics */
+
+} /* namespace libcamera */
@@ -29,6 +29,7 @@ class CameraConfiguration;
 class CameraManager;
 class DeviceEnumerator;
 class DeviceMatch;
+class FenceWaiter;
 class FrameBuffer;
 class MediaDevice;
 class PipelineHandler;
@@ -38,7 +39,8 @@ class PipelineHandler : public std::enable_shared_from_this<PipelineHandler>,
 			public Object
 {
 public:
-	PipelineHandler(CameraManager *manager);
+	PipelineHandler(CameraManager *manager,
+			unsigned int maxQueuedRequestsDevice = 32);
 	virtual ~PipelineHandler();
 
 	virtual bool match(DeviceEnumerator *enumerator) = 0;
@@ -61,8 +63,11 @@ public:
 
 	void registerRequest(Request *request);
 	void queueRequest(Request *request);
+	void queueRequests(const std::vector<Request *> &requests);
 
 	bool completeBuffer(Request *request, FrameBuffer *buffer);
+	void metadataAvailable(Request *request, const ControlList &metadata);
+	void framesDropped(Camera *camera, unsigned int count);
 	void completeRequest(Request *request);
 
 	std::string configurationFile(const std::string &subdir,
@@ -70,10 +75,14 @@ public:
 
 	const char *name() const { return name_; }
 
+	unsigned int maxQueuedRequestsDevice() const { return maxQueuedRequestsDevice_; }
+
 protected:
 	void registerCamera(std::shared_ptr<Camera> camera);
 	void hotplugMediaDevice(MediaDevice *media);
 
+	void frameStarted(Camera *camera, uint32_t sequence);
+
 	virtual int queueRequestDevice(Camera *camera, Request *request) = 0;
 	virtual void stopDevice(Camera *camera) = 0;
 
@@ -88,14 +97,17 @@ private:
 	virtual void disconnect();
 
 	void doQueueRequest(Request *request);
+	bool holdRequest(Request *request);
 	void doQueueRequests();
 
 	std::vector<std::shared_ptr<MediaDevice>> mediaDevices_;
 	std::vector<std::weak_ptr<Camera>> cameras_;
 
 	std::queue<Request *> waitingRequests_;
+	std::unique_ptr<FenceWaiter> fenceWaiter_;
 
 	const char *name_;
+	unsigned int maxQueuedRequestsDevice_;
 
 	Mutex lock_;
 	unsigned int useCount_ LIBCAMERA_TSA_GUARDED_BY(lock_);
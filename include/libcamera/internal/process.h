@@ -11,7 +11,9 @@
 #include <string>
 #include <vector>
 
+#include <libcamera/base/mutex.h>
 #include <libcamera/base/signal.h>
+#include <libcamera/base/thread_annotations.h>
 #include <libcamera/base/unique_fd.h>
 
 namespace libcamera {
@@ -60,7 +62,7 @@ public:
 	ProcessManager();
 	~ProcessManager();
 
-	void registerProcess(Process *proc);
+	void registerProcess(Process *proc) LIBCAMERA_TSA_EXCLUDES(mutex_);
 
 	static ProcessManager *instance();
 
@@ -71,9 +73,10 @@ public:
 private:
 	static ProcessManager *self_;
 
-	void sighandler();
+	void sighandler() LIBCAMERA_TSA_EXCLUDES(mutex_);
 
-	std::list<Process *> processes_;
+	Mutex mutex_;
+	std::list<Process *> processes_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
 
 	struct sigaction oldsa_;
 
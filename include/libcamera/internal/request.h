@@ -8,11 +8,11 @@
 #pragma once
 
 #include <chrono>
-#include <map>
 #include <memory>
+#include <optional>
+#include <vector>
 
-#include <libcamera/base/event_notifier.h>
-#include <libcamera/base/timer.h>
+#include <libcamera/base/signal.h>
 
 #include <libcamera/request.h>
 
@@ -21,6 +21,7 @@ using namespace std::chrono_literals;
 namespace libcamera {
 
 class Camera;
+class FenceWaiter;
 class FrameBuffer;
 
 class Request::Private : public Extensible::Private
@@ -39,26 +40,29 @@ public:
 	void cancel();
 	void reset();
 
-	void prepare(std::chrono::milliseconds timeout = 0ms);
+	void prepare(FenceWaiter *waiter, std::chrono::milliseconds timeout = 0ms);
 	Signal<> prepared;
 
 private:
+	friend class FenceWaiter;
 	friend class PipelineHandler;
 	friend std::ostream &operator<<(std::ostream &out, const Request &r);
 
 	void doCancelRequest();
 	void emitPrepareCompleted();
-	void notifierActivated(FrameBuffer *buffer);
+	void fenceSignalled(FrameBuffer *buffer);
+	void stopWaiting();
 	void timeout();
 
 	Camera *camera_;
 	bool cancelled_;
 	uint32_t sequence_ = 0;
+	std::optional<uint32_t> targetSequence_;
 	bool prepared_ = false;
 
-	std::unordered_set<FrameBuffer *> pending_;
-	std::map<FrameBuffer *, std::unique_ptr<EventNotifier>> notifiers_;
-	std::unique_ptr<Timer> timer_;
+	std::vector<FrameBuffer *> pending_;
+	FenceWaiter *fenceWaiter_ = nullptr;
+	unsigned int pendingFences_ = 0;
 };
 
 } /* namespace libcamera */
@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * request_queue.h - Ring buffer of in-flight requests
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace libcamera {
+
+class Request;
+
+class RequestQueue
+{
+public:
+	RequestQueue(unsigned int capacity = 32);
+
+	bool empty() const { return size_ == 0; }
+	size_t size() const { return size_; }
+
+	void push(uint32_t sequence, Request *request);
+	Request *front() const;
+	void pop();
+	void remove(uint32_t sequence);
+
+private:
+	Request *&slot(uint32_t sequence)
+	{
+		return slots_[sequence & (slots_.size() - 1)];
+	}
+
+	void grow();
+	void skipHoles();
+
+	std::vector<Request *> slots_;
+	uint32_t head_;
+	uint32_t tail_;
+	size_t size_;
+};
+
+} /* namespace libcamera */
@@ -19,8 +19,6 @@
 
 namespace libcamera {
 
-namespace RPi {
-
 template<class T>
 class SharedMemObject
 {
@@ -123,6 +121,4 @@ private:
 	T *obj_;
 };
 
-} /* namespace RPi */
-
 } /* namespace libcamera */
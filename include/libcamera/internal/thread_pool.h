@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * thread_pool.h - Worker threads for CPU-based image processing
+ */
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <libcamera/base/class.h>
+#include <libcamera/base/mutex.h>
+#include <libcamera/base/thread.h>
+
+namespace libcamera {
+
+class ThreadPool
+{
+public:
+	using Task = std::function<void()>;
+	using StripTask = std::function<void(unsigned int index, unsigned int count)>;
+
+	ThreadPool(const std::string &name, unsigned int maxThreads);
+	~ThreadPool();
+
+	unsigned int threads() const { return workers_.size(); }
+
+	void queue(Task task);
+	void queueStrips(StripTask task, Task done);
+	void runStrips(const StripTask &task);
+	void wait();
+
+private:
+	LIBCAMERA_DISABLE_COPY_AND_MOVE(ThreadPool)
+
+	class Worker : public Thread
+	{
+	public:
+		Worker(ThreadPool *pool, unsigned int index,
+		       const std::string &name);
+
+	protected:
+		void run() override;
+
+	private:
+		ThreadPool *pool_;
+		unsigned int index_;
+	};
+
+	struct Entry {
+		Task task;
+		/* The runStrips() call the entry belongs to, if any. */
+		const void *caller;
+	};
+
+	void run(unsigned int index);
+	void runEntry(MutexLocker &locker, Entry &entry)
+		LIBCAMERA_TSA_REQUIRES(mutex_);
+
+	Mutex mutex_;
+	ConditionVariable workCondition_;
+	ConditionVariable doneCondition_;
+
+	std::deque<Entry> queue_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	std::vector<std::deque<Task>> strips_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	unsigned int active_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	bool stopping_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+
+	std::vector<std::unique_ptr<Worker>> workers_;
+};
+
+} /* namespace libcamera */
@@ -10,6 +10,7 @@
 #include <map>
 #include <memory>
 #include <optional>
+#include <unordered_map>
 #include <vector>
 
 #include <linux/videodev2.h>
@@ -27,6 +28,7 @@
 namespace libcamera {
 
 class EventNotifier;
+class MediaRequest;
 
 class V4L2Device : protected Loggable
 {
@@ -37,7 +39,7 @@ public:
 	const ControlInfoMap &controls() const { return controls_; }
 
 	ControlList getControls(const std::vector<uint32_t> &ids);
-	int setControls(ControlList *ctrls);
+	int setControls(ControlList *ctrls, MediaRequest *request = nullptr);
 
 	const struct v4l2_query_ext_ctrl *controlInfo(uint32_t id) const;
 
@@ -60,6 +62,8 @@ protected:
 
 	int fd() const { return fd_.get(); }
 
+	virtual void layoutChanged() {}
+
 	template<typename T>
 	static std::optional<ColorSpace> toColorSpace(const T &v4l2Format,
 						      PixelFormatInfo::ColourEncoding colourEncoding);
@@ -76,6 +80,7 @@ private:
 	void listControls();
 	void updateControls(ControlList *ctrls,
 			    Span<const v4l2_ext_control> v4l2Ctrls);
+	void cacheControls(const ControlList &ctrls, const MediaRequest *request);
 
 	void eventAvailable();
 
@@ -88,6 +93,11 @@ private:
 
 	EventNotifier *fdEventNotifier_;
 	bool frameStartEnabled_;
+
+	std::vector<v4l2_ext_control> v4l2Ctrls_;
+	std::unordered_map<unsigned int, ControlValue> values_;
+	unsigned int skippedControls_;
+	unsigned int skippedWrites_;
 };
 
 } /* namespace libcamera */
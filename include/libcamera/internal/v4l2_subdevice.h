@@ -7,10 +7,12 @@
 
 #pragma once
 
+#include <map>
 #include <memory>
 #include <optional>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <linux/v4l2-subdev.h>
@@ -80,6 +82,7 @@ public:
 			 Rectangle *rect);
 
 	Formats formats(unsigned int pad);
+	void invalidateFormats();
 
 	int getFormat(unsigned int pad, V4L2SubdeviceFormat *format,
 		      Whence whence = ActiveFormat);
@@ -97,6 +100,7 @@ public:
 
 protected:
 	std::string logPrefix() const override;
+	void layoutChanged() override;
 
 private:
 	LIBCAMERA_DISABLE_COPY(V4L2Subdevice)
@@ -108,10 +112,18 @@ private:
 	std::vector<SizeRange> enumPadSizes(unsigned int pad,
 					    unsigned int code);
 
+	bool hasSinkPads() const;
+	void dropStaleFormats();
+
 	const MediaEntity *entity_;
 
 	std::string model_;
 	struct V4L2SubdeviceCapability caps_;
+
+	std::map<unsigned int, Formats> formats_;
+	std::map<std::pair<unsigned int, unsigned int>, Rectangle> selections_;
+	unsigned int linkGeneration_;
+	bool layoutModified_;
 };
 
 } /* namespace libcamera */
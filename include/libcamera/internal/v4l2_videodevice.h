@@ -8,12 +8,14 @@
 #pragma once
 
 #include <array>
-#include <atomic>
+#include <list>
 #include <memory>
 #include <optional>
 #include <ostream>
 #include <stdint.h>
 #include <string>
+#include <sys/types.h>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -21,7 +23,9 @@
 
 #include <libcamera/base/class.h>
 #include <libcamera/base/log.h>
+#include <libcamera/base/mutex.h>
 #include <libcamera/base/signal.h>
+#include <libcamera/base/span.h>
 #include <libcamera/base/timer.h>
 #include <libcamera/base/unique_fd.h>
 #include <libcamera/base/utils.h>
@@ -38,6 +42,7 @@
 namespace libcamera {
 
 class EventNotifier;
+class MediaRequest;
 class MediaDevice;
 class MediaEntity;
 
@@ -132,36 +137,47 @@ public:
 	int get(const FrameBuffer &buffer);
 	void put(unsigned int index);
 
+	unsigned int hits() const { return hits_; }
+	unsigned int misses() const { return misses_; }
+
 private:
+	struct Plane {
+		bool operator==(const Plane &other) const
+		{
+			return inode == other.inode && offset == other.offset &&
+			       length == other.length;
+		}
+
+		ino_t inode;
+		unsigned int offset;
+		unsigned int length;
+	};
+
+	using Key = std::vector<Plane>;
+
+	struct KeyHash {
+		std::size_t operator()(const Key &key) const;
+	};
+
 	class Entry
 	{
 	public:
 		Entry();
-		Entry(bool free, uint64_t lastUsed, const FrameBuffer &buffer);
-
-		bool operator==(const FrameBuffer &buffer) const;
 
 		bool free_;
-		uint64_t lastUsed_;
-
-	private:
-		struct Plane {
-			Plane(const FrameBuffer::Plane &plane)
-				: fd(plane.fd.get()), length(plane.length)
-			{
-			}
-
-			int fd;
-			unsigned int length;
-		};
-
-		std::vector<Plane> planes_;
+		Key key_;
+		std::list<unsigned int>::iterator lru_;
 	};
 
-	std::atomic<uint64_t> lastUsedCounter_;
+	static Key key(const FrameBuffer &buffer);
+	void assign(unsigned int index, Key &&key);
+
 	std::vector<Entry> cache_;
-	/* \todo Expose the miss counter through an instrumentation API. */
-	unsigned int missCounter_;
+	std::unordered_map<Key, unsigned int, KeyHash> index_;
+	std::list<unsigned int> lru_;
+
+	unsigned int hits_;
+	unsigned int misses_;
 };
 
 class V4L2DeviceFormat
@@ -189,6 +205,28 @@ class V4L2VideoDevice : public V4L2Device
 public:
 	using Formats = std::map<V4L2PixelFormat, std::vector<SizeRange>>;
 
+	struct Statistics {
+		struct Latency {
+			void add(utils::Duration value);
+			utils::Duration average() const;
+
+			uint64_t count = 0;
+			utils::Duration min{};
+			utils::Duration max{};
+			utils::Duration total{};
+		};
+
+		std::vector<uint64_t> queueDepth;
+		Latency timeInDriver;
+		Latency signalLatency;
+		uint64_t watchdogExpirations = 0;
+	};
+
+	struct FrameDrops {
+		uint64_t noBuffer = 0;
+		uint64_t skipped = 0;
+	};
+
 	explicit V4L2VideoDevice(const std::string &deviceNode);
 	explicit V4L2VideoDevice(const MediaEntity *entity);
 	~V4L2VideoDevice();
@@ -210,6 +248,10 @@ public:
 
 	int setSelection(unsigned int target, Rectangle *rect);
 
+	std::vector<utils::Duration> frameIntervals(V4L2PixelFormat pixelFormat,
+						    const Size &size);
+	int setFrameInterval(utils::Duration *interval);
+
 	int allocateBuffers(unsigned int count,
 			    std::vector<std::unique_ptr<FrameBuffer>> *buffers);
 	int exportBuffers(unsigned int count,
@@ -217,15 +259,25 @@ public:
 	int importBuffers(unsigned int count);
 	int releaseBuffers();
 
-	int queueBuffer(FrameBuffer *buffer);
+	int queueBuffer(FrameBuffer *buffer, MediaRequest *request = nullptr);
+	int queueBuffers(Span<FrameBuffer *const> buffers);
 	Signal<FrameBuffer *> bufferReady;
 
 	int streamOn();
 	int streamOff();
+	static int streamOn(Span<V4L2VideoDevice *const> devices);
+	static int streamOff(Span<V4L2VideoDevice *const> devices);
 
 	void setDequeueTimeout(utils::Duration timeout);
 	Signal<> dequeueTimeout;
 
+	void enableStatistics(bool enable);
+	const Statistics &statistics() const { return stats_; }
+	void resetStatistics();
+
+	const FrameDrops &frameDrops() const { return frameDrops_; }
+	unsigned int lastFrameDrops() const { return lastFrameDrops_; }
+
 	static std::unique_ptr<V4L2VideoDevice>
 	fromEntityName(const MediaDevice *media, const std::string &entity);
 
@@ -263,10 +315,19 @@ private:
 	std::unique_ptr<FrameBuffer> createBuffer(unsigned int index);
 	UniqueFD exportDmabufFd(unsigned int index, unsigned int plane);
 
+	static std::vector<int> ioctlConcurrent(Span<V4L2VideoDevice *const> devices,
+						unsigned long request);
+	void prepareStreamOn();
+	int completeStreamOn(int ret);
+	bool prepareStreamOff();
+	int completeStreamOff(int ret);
+
 	void bufferAvailable();
+	bool bufferPending() const;
 	FrameBuffer *dequeueBuffer();
 
 	void watchdogExpired();
+	void accountFrameDrops(uint32_t sequence, bool underrun);
 
 	template<typename T>
 	static std::optional<ColorSpace> toColorSpace(const T &v4l2Format);
@@ -289,6 +350,21 @@ private:
 
 	Timer watchdog_;
 	utils::Duration watchdogDuration_;
+
+	bool statsEnabled_;
+	bool monotonicTimestamps_;
+	Statistics stats_;
+	std::map<unsigned int, utils::time_point> queueTimes_;
+
+	std::optional<uint32_t> lastSequence_;
+	bool queueUnderrun_;
+	unsigned int lastFrameDrops_;
+	FrameDrops frameDrops_;
+
+	bool tryFormatCacheEnabled_;
+	Mutex tryFormatCacheLock_;
+	std::map<std::vector<uint32_t>, std::pair<int, V4L2DeviceFormat>> tryFormatCache_
+		LIBCAMERA_TSA_GUARDED_BY(tryFormatCacheLock_);
 };
 
 class V4L2M2MDevice
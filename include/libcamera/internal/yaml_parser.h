@@ -14,12 +14,14 @@
 #include <vector>
 
 #include <libcamera/base/class.h>
+#include <libcamera/base/span.h>
 
 #include <libcamera/geometry.h>
 
 namespace libcamera {
 
 class File;
+class YamlObjectCache;
 class YamlParserContext;
 
 class YamlObject
@@ -203,6 +205,21 @@ public:
 #endif
 	std::optional<std::vector<T>> getList() const;
 
+#ifndef __DOXYGEN__
+	template<typename T,
+		 std::enable_if_t<
+			 std::is_same_v<double, T> ||
+			 std::is_same_v<int8_t, T> ||
+			 std::is_same_v<uint8_t, T> ||
+			 std::is_same_v<int16_t, T> ||
+			 std::is_same_v<uint16_t, T> ||
+			 std::is_same_v<int32_t, T> ||
+			 std::is_same_v<uint32_t, T>> * = nullptr>
+#else
+	template<typename T>
+#endif
+	bool getList(Span<T> values) const;
+
 	DictAdapter asDict() const { return DictAdapter{ list_ }; }
 	ListAdapter asList() const { return ListAdapter{ list_ }; }
 
@@ -214,6 +231,7 @@ public:
 private:
 	LIBCAMERA_DISABLE_COPY_AND_MOVE(YamlObject)
 
+	friend class YamlObjectCache;
 	friend class YamlParserContext;
 
 	enum class Type {
@@ -17,6 +17,12 @@ extern "C" {
 
 #define IPA_CONTROLS_FORMAT_VERSION	1
 
+#define IPA_CONTROLS_FLAG_DELTA_CAPABLE	(1 << 0)
+#define IPA_CONTROLS_FLAG_DELTA		(1 << 1)
+#define IPA_CONTROLS_FLAG_RESYNC	(1 << 2)
+
+#define IPA_CONTROL_VALUE_ENTRY_REMOVED	(1 << 0)
+
 enum ipa_controls_id_map_type {
 	IPA_CONTROL_ID_MAP_CONTROLS,
 	IPA_CONTROL_ID_MAP_PROPERTIES,
@@ -30,7 +36,8 @@ struct ipa_controls_header {
 	uint32_t size;
 	uint32_t data_offset;
 	enum ipa_controls_id_map_type id_map_type;
-	uint32_t reserved[2];
+	uint32_t flags;
+	uint32_t sequence;
 };
 
 struct ipa_control_value_entry {
@@ -39,7 +46,7 @@ struct ipa_control_value_entry {
 	uint8_t is_array;
 	uint16_t count;
 	uint32_t offset;
-	uint32_t padding[1];
+	uint32_t flags;
 };
 
 struct ipa_control_info_entry {
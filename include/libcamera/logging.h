@@ -14,9 +14,11 @@ enum LoggingTarget {
 	LoggingTargetSyslog,
 	LoggingTargetFile,
 	LoggingTargetStream,
+	LoggingTargetBinaryFile,
 };
 
 int logSetFile(const char *path, bool color = false);
+int logSetBinaryFile(const char *path);
 int logSetStream(std::ostream *stream, bool color = false);
 int logSetTarget(LoggingTarget target);
 void logSetLevel(const char *category, const char *level);
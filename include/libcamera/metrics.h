@@ -0,0 +1,30 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * metrics.h - Performance metrics snapshot
+ */
+
+#pragma once
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace libcamera {
+
+struct MetricsSnapshot {
+	struct Histogram {
+		std::vector<uint64_t> bounds;
+		std::vector<uint64_t> buckets;
+		uint64_t count;
+		uint64_t sum;
+	};
+
+	std::map<std::string, uint64_t> counters;
+	std::map<std::string, int64_t> gauges;
+	std::map<std::string, Histogram> histograms;
+};
+
+} /* namespace libcamera */
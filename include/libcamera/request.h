@@ -9,6 +9,7 @@
 
 #include <map>
 #include <memory>
+#include <optional>
 #include <ostream>
 #include <stdint.h>
 #include <string>
@@ -58,6 +59,8 @@ public:
 	FrameBuffer *findBuffer(const Stream *stream) const;
 
 	uint32_t sequence() const;
+	void setTargetSequence(std::optional<uint32_t> sequence);
+	std::optional<uint32_t> targetSequence() const;
 	uint64_t cookie() const { return cookie_; }
 	Status status() const { return status_; }
 
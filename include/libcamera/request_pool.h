@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * request_pool.h - Pool of reusable capture requests
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <libcamera/base/class.h>
+
+namespace libcamera {
+
+class Camera;
+class Request;
+
+class RequestPool
+{
+public:
+	~RequestPool();
+
+	Request *acquire();
+	void release(Request *request);
+
+	unsigned int size() const { return requests_.size(); }
+	unsigned int available() const;
+
+	const std::vector<std::unique_ptr<Request>> &requests() const { return requests_; }
+
+private:
+	LIBCAMERA_DISABLE_COPY_AND_MOVE(RequestPool)
+
+	friend class Camera;
+
+	RequestPool(std::vector<std::unique_ptr<Request>> requests);
+
+	std::vector<std::unique_ptr<Request>> requests_;
+
+	mutable std::mutex mutex_;
+	std::vector<Request *> free_;
+};
+
+} /* namespace libcamera */
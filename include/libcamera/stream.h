@@ -29,13 +29,18 @@ public:
 	StreamFormats();
 	StreamFormats(const std::map<PixelFormat, std::vector<SizeRange>> &formats);
 
-	std::vector<PixelFormat> pixelformats() const;
-	std::vector<Size> sizes(const PixelFormat &pixelformat) const;
+	const std::vector<PixelFormat> &pixelformats() const;
+	const std::vector<Size> &sizes(const PixelFormat &pixelformat) const;
 
 	SizeRange range(const PixelFormat &pixelformat) const;
 
 private:
-	std::map<PixelFormat, std::vector<SizeRange>> formats_;
+	struct Format;
+	struct Data;
+
+	const Format *find(const PixelFormat &pixelformat) const;
+
+	std::shared_ptr<const Data> data_;
 };
 
 struct StreamConfiguration {
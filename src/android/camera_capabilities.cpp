@@ -10,17 +10,24 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <errno.h>
+#include <fstream>
 #include <map>
+#include <sstream>
+#include <string.h>
 #include <type_traits>
 
 #include <hardware/camera3.h>
 
 #include <libcamera/base/log.h>
+#include <libcamera/base/utils.h>
 
+#include <libcamera/camera_manager.h>
 #include <libcamera/control_ids.h>
 #include <libcamera/controls.h>
 #include <libcamera/property_ids.h>
 
+#include "libcamera/internal/enumeration_cache.h"
 #include "libcamera/internal/formats.h"
 
 using namespace libcamera;
@@ -220,6 +227,14 @@ std::vector<U> setMetadata(CameraMetadata *metadata, uint32_t tag,
 	return values;
 }
 
+/*
+ * Version of the stream configurations cache file format. Increment it when
+ * the format or the probing logic changes to invalidate existing cache files.
+ */
+constexpr unsigned int kCacheFormatVersion = 1;
+
+constexpr char kCacheMagic[] = "libcamera-android-capabilities";
+
 } /* namespace */
 
 bool CameraCapabilities::validateManualSensorCapability()
@@ -414,10 +429,15 @@ int CameraCapabilities::initialize(std::shared_ptr<Camera> camera,
 		return ret;
 	}
 
-	ret = initializeStreamConfigurations();
+	ret = loadStreamConfigurations();
 	if (ret) {
-		camera_->release();
-		return ret;
+		ret = initializeStreamConfigurations();
+		if (ret) {
+			camera_->release();
+			return ret;
+		}
+
+		saveStreamConfigurations();
 	}
 
 	ret = initializeStaticMetadata();
@@ -655,6 +675,9 @@ int CameraCapabilities::initializeStreamConfigurations()
 			if (ret)
 				return ret;
 
+			lastConfiguredFormat_ = cfg.pixelFormat;
+			lastConfiguredSize_ = cfg.size;
+
 			const ControlInfoMap &controls = camera_->controls();
 			const auto frameDurations = controls.find(
 				&controls::FrameDurationLimits);
@@ -756,6 +779,188 @@ int CameraCapabilities::initializeStreamConfigurations()
 	return 0;
 }
 
+/*
+ * Probing the stream configurations validates the camera configuration for
+ * every candidate Android format and resolution, which can take a significant
+ * amount of time with pipeline handlers that search for the best sensor and
+ * ISP configuration on every validation. When the LIBCAMERA_CACHE_DIR
+ * environment variable is set, the results are stored in a cache file per
+ * camera in that directory and reused on the next HAL initialization.
+ *
+ * The cache is keyed by the libcamera version, which covers changes to the
+ * pipeline handlers and to the probing logic, the camera ID and the sensor
+ * model and pixel array size. The static metadata is not cached, as it is
+ * built from the camera controls and properties without any validation.
+ */
+std::string CameraCapabilities::cacheKey() const
+{
+	const ControlList &properties = camera_->properties();
+	const auto model = properties.get(properties::Model);
+	const auto pixelArraySize = properties.get(properties::PixelArraySize);
+
+	std::ostringstream key;
+	key << CameraManager::version() << "\n"
+	    << camera_->id() << "\n"
+	    << (model ? *model : "") << "\n"
+	    << (pixelArraySize ? *pixelArraySize : Size{});
+
+	return key.str();
+}
+
+std::string CameraCapabilities::cachePath() const
+{
+	return CacheFile::path("android-" + CacheFile::sanitize(camera_->id()) + ".cache");
+}
+
+int CameraCapabilities::loadStreamConfigurations()
+{
+	std::string path = cachePath();
+	if (path.empty())
+		return -ENOENT;
+
+	std::ifstream file(path);
+	if (!file.is_open())
+		return -ENOENT;
+
+	std::string line;
+	std::string magic;
+	unsigned int version = 0;
+
+	if (std::getline(file, line)) {
+		std::istringstream header(line);
+		header >> magic >> version;
+	}
+
+	/* The key spans multiple lines, compare them one by one. */
+	bool valid = magic == kCacheMagic && version == kCacheFormatVersion;
+	std::istringstream key(cacheKey());
+	std::string keyLine;
+	while (valid && std::getline(key, keyLine))
+		valid = std::getline(file, line) && line == keyLine;
+
+	if (!valid) {
+		LOG(HAL, Debug) << "Discarding stale cache " << path;
+		return -EINVAL;
+	}
+
+	bool rawStreamAvailable = false;
+	int64_t maxFrameDuration = 0;
+	unsigned int maxJpegBufferSize = 0;
+	PixelFormat lastConfiguredFormat;
+	Size lastConfiguredSize;
+	std::map<int, PixelFormat> formatsMap;
+	std::vector<Camera3StreamConfiguration> streamConfigurations;
+
+	while (std::getline(file, line)) {
+		std::istringstream stream(line);
+		std::string type;
+		stream >> type;
+
+		if (type == "limits") {
+			stream >> rawStreamAvailable >> maxFrameDuration
+			       >> maxJpegBufferSize;
+		} else if (type == "configured") {
+			uint32_t fourcc;
+			uint64_t modifier;
+			stream >> fourcc >> modifier >> lastConfiguredSize.width
+			       >> lastConfiguredSize.height;
+			lastConfiguredFormat = PixelFormat(fourcc, modifier);
+		} else if (type == "format") {
+			int androidFormat;
+			uint32_t fourcc;
+			uint64_t modifier;
+			stream >> androidFormat >> fourcc >> modifier;
+			formatsMap[androidFormat] = PixelFormat(fourcc, modifier);
+		} else if (type == "stream") {
+			Camera3StreamConfiguration config;
+			stream >> config.resolution.width >> config.resolution.height
+			       >> config.androidFormat >> config.minFrameDurationNsec
+			       >> config.maxFrameDurationNsec;
+			streamConfigurations.push_back(config);
+		} else {
+			stream.setstate(std::ios::failbit);
+		}
+
+		if (!stream) {
+			LOG(HAL, Warning) << "Discarding corrupted cache " << path;
+			return -EINVAL;
+		}
+	}
+
+	/*
+	 * The static metadata is built from the camera controls, which depend
+	 * on the last configuration applied while probing. Apply it again.
+	 */
+	if (lastConfiguredFormat.isValid()) {
+		std::unique_ptr<CameraConfiguration> cameraConfig =
+			camera_->generateConfiguration({ StreamRole::StillCapture });
+		if (!cameraConfig)
+			return -EINVAL;
+
+		StreamConfiguration &cfg = cameraConfig->at(0);
+		cfg.pixelFormat = lastConfiguredFormat;
+		cfg.size = lastConfiguredSize;
+
+		if (cameraConfig->validate() == CameraConfiguration::Invalid ||
+		    camera_->configure(cameraConfig.get())) {
+			LOG(HAL, Warning) << "Failed to apply cached configuration";
+			return -EINVAL;
+		}
+	}
+
+	rawStreamAvailable_ = rawStreamAvailable;
+	maxFrameDuration_ = maxFrameDuration;
+	maxJpegBufferSize_ = maxJpegBufferSize;
+	lastConfiguredFormat_ = lastConfiguredFormat;
+	lastConfiguredSize_ = lastConfiguredSize;
+	formatsMap_ = std::move(formatsMap);
+	streamConfigurations_ = std::move(streamConfigurations);
+
+	LOG(HAL, Debug)
+		<< "Loaded " << streamConfigurations_.size()
+		<< " stream configurations from " << path;
+
+	return 0;
+}
+
+void CameraCapabilities::saveStreamConfigurations() const
+{
+	std::string path = cachePath();
+	if (path.empty())
+		return;
+
+	std::ostringstream data;
+
+	data << kCacheMagic << " " << kCacheFormatVersion << "\n"
+	     << cacheKey() << "\n";
+
+	data << "limits " << rawStreamAvailable_ << " " << maxFrameDuration_
+	     << " " << maxJpegBufferSize_ << "\n";
+
+	if (lastConfiguredFormat_.isValid())
+		data << "configured " << lastConfiguredFormat_.fourcc() << " "
+		     << lastConfiguredFormat_.modifier() << " "
+		     << lastConfiguredSize_.width << " "
+		     << lastConfiguredSize_.height << "\n";
+
+	for (const auto &[androidFormat, format] : formatsMap_)
+		data << "format " << androidFormat << " " << format.fourcc()
+		     << " " << format.modifier() << "\n";
+
+	for (const Camera3StreamConfiguration &config : streamConfigurations_)
+		data << "stream " << config.resolution.width << " "
+		     << config.resolution.height << " " << config.androidFormat
+		     << " " << config.minFrameDurationNsec << " "
+		     << config.maxFrameDurationNsec << "\n";
+
+	std::string contents = data.str();
+	int ret = CacheFile::write(path, { reinterpret_cast<const uint8_t *>(contents.data()),
+					   contents.size() });
+	if (ret)
+		LOG(HAL, Warning)
+			<< "Failed to write " << path << ": " << strerror(-ret);
+}
+
 int CameraCapabilities::initializeStaticMetadata()
 {
 	staticMetadata_ = std::make_unique<CameraMetadata>(64, 1024);
@@ -1380,9 +1585,8 @@ int CameraCapabilities::initializeStaticMetadata()
 	staticMetadata_->addEntry(ANDROID_SCALER_CROPPING_TYPE, croppingType);
 
 	/* Request static metadata. */
-	int32_t partialResultCount = 1;
 	staticMetadata_->addEntry(ANDROID_REQUEST_PARTIAL_RESULT_COUNT,
-				  partialResultCount);
+				  kPartialResultCount);
 
 	{
 		/* Default the value to 2 if not reported by the camera. */
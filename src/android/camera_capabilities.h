@@ -10,6 +10,7 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <string>
 #include <vector>
 
 #include <libcamera/base/class.h>
@@ -23,6 +24,12 @@
 class CameraCapabilities
 {
 public:
+	/*
+	 * Capture results are split in the metadata known when the libcamera
+	 * request completes, and the metadata produced by post-processing.
+	 */
+	static constexpr int32_t kPartialResultCount = 2;
+
 	CameraCapabilities() = default;
 
 	int initialize(std::shared_ptr<libcamera::Camera> camera,
@@ -64,6 +71,11 @@ private:
 	initializeRawResolutions(const libcamera::PixelFormat &pixelFormat);
 	int initializeStreamConfigurations();
 
+	std::string cacheKey() const;
+	std::string cachePath() const;
+	int loadStreamConfigurations();
+	void saveStreamConfigurations() const;
+
 	int initializeStaticMetadata();
 
 	std::shared_ptr<libcamera::Camera> camera_;
@@ -77,6 +89,9 @@ private:
 
 	std::vector<Camera3StreamConfiguration> streamConfigurations_;
 	std::map<int, libcamera::PixelFormat> formatsMap_;
+	/* The last configuration applied when probing stream configurations. */
+	libcamera::PixelFormat lastConfiguredFormat_;
+	libcamera::Size lastConfiguredSize_;
 	std::unique_ptr<CameraMetadata> staticMetadata_;
 	unsigned int maxJpegBufferSize_;
 
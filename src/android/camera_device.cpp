@@ -10,7 +10,9 @@
 #include <algorithm>
 #include <fstream>
 #include <set>
+#include <string.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <vector>
 
@@ -163,6 +165,136 @@ void sortCamera3StreamConfigs(std::vector<Camera3StreamConfig> &unsortedConfigs,
 	unsortedConfigs = sortedConfigs;
 }
 
+/*
+ * Estimate the per-frame memory traffic, in pixels, of producing a stream of
+ * size \a dst by scaling a stream of size \a src in software. Bilinear
+ * down-scaling reads at most two source lines per destination line.
+ */
+uint64_t scalingCost(const Size &src, const Size &dst)
+{
+	return static_cast<uint64_t>(dst.height) * (2 * src.width + dst.width);
+}
+
+/*
+ * Reduce the number of libcamera streams by one, producing the streams of a
+ * configuration by scaling another configuration in software with the YUV
+ * post-processor.
+ *
+ * Only NV12 configurations can be scaled, from a Direct configuration with a
+ * larger or equal size and the same aspect ratio. Configurations used to
+ * produce a JPEG stream are not considered, as the JPEG encoder requires a
+ * source of the same size. Among the candidates, the one with the lowest
+ * scaling cost is selected.
+ *
+ * \return True if two configurations have been merged, false otherwise
+ */
+bool mergeCamera3StreamConfigs(std::vector<Camera3StreamConfig> &streamConfigs,
+			       const camera3_stream_t *jpegStream)
+{
+	auto scalable = [](const Camera3StreamConfig &streamConfig) {
+		return streamConfig.config.pixelFormat == formats::NV12 &&
+		       streamConfig.streams[0].type == CameraStream::Type::Direct;
+	};
+
+	auto hasJpeg = [jpegStream](const Camera3StreamConfig &streamConfig) {
+		const auto &streams = streamConfig.streams;
+		return std::find_if(streams.begin(), streams.end(),
+				    [jpegStream](const auto &stream) {
+					    return stream.stream == jpegStream;
+				    }) != streams.end();
+	};
+
+	uint64_t bestCost = UINT64_MAX;
+	size_t bestDst = 0;
+	size_t bestSrc = 0;
+
+	for (size_t i = 0; i < streamConfigs.size(); ++i) {
+		const Camera3StreamConfig &dst = streamConfigs[i];
+		if (!scalable(dst) || hasJpeg(dst))
+			continue;
+
+		for (size_t j = 0; j < streamConfigs.size(); ++j) {
+			const Camera3StreamConfig &src = streamConfigs[j];
+			if (i == j || !scalable(src))
+				continue;
+
+			const Size &srcSize = src.config.size;
+			const Size &dstSize = dst.config.size;
+			if (srcSize.width < dstSize.width ||
+			    srcSize.height < dstSize.height ||
+			    static_cast<uint64_t>(srcSize.width) * dstSize.height !=
+			    static_cast<uint64_t>(dstSize.width) * srcSize.height)
+				continue;
+
+			uint64_t cost = scalingCost(srcSize, dstSize) *
+					dst.streams.size();
+
+			LOG(HAL, Debug)
+				<< "Producing " << dst.config.toString()
+				<< " from " << src.config.toString()
+				<< " costs " << cost;
+
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestDst = i;
+				bestSrc = j;
+			}
+		}
+	}
+
+	if (bestCost == UINT64_MAX)
+		return false;
+
+	Camera3StreamConfig &src = streamConfigs[bestSrc];
+	Camera3StreamConfig &dst = streamConfigs[bestDst];
+
+	LOG(HAL, Info)
+		<< "Producing " << dst.config.toString() << " by scaling "
+		<< src.config.toString() << " in software";
+
+	/*
+	 * Add usage to scale the buffer in src.streams[0] to the streams. The
+	 * scaled streams may also be read to produce smaller ones.
+	 */
+	src.streams[0].stream->usage |= GRALLOC_USAGE_SW_READ_OFTEN;
+	for (auto &stream : dst.streams) {
+		stream.stream->usage |= GRALLOC_USAGE_SW_READ_OFTEN |
+					GRALLOC_USAGE_SW_WRITE_OFTEN;
+		src.streams.push_back({ stream.stream, CameraStream::Type::Mapped });
+	}
+
+	streamConfigs.erase(streamConfigs.begin() + bestDst);
+
+	return true;
+}
+
+/*
+ * Check if the entry for \a tag differs between \a settings and \a previous.
+ * All entries are considered as changed if there are no previous settings.
+ */
+bool entryChanged(const CameraMetadata &settings, const CameraMetadata *previous,
+		  uint32_t tag)
+{
+	if (!previous)
+		return true;
+
+	camera_metadata_ro_entry_t entry;
+	camera_metadata_ro_entry_t previousEntry;
+	bool found = settings.getEntry(tag, &entry);
+	bool previousFound = previous->getEntry(tag, &previousEntry);
+
+	if (found != previousFound)
+		return true;
+	if (!found)
+		return false;
+
+	if (entry.type != previousEntry.type || entry.count != previousEntry.count)
+		return true;
+
+	return memcmp(entry.data.u8, previousEntry.data.u8,
+		      entry.count * camera_metadata_type_size[entry.type]) != 0;
+}
+
 const char *rotationToString(int rotation)
 {
 	switch (rotation) {
@@ -248,7 +380,8 @@ bool validateCropRotate(const camera3_stream_configuration_t &streamList)
 
 CameraDevice::CameraDevice(unsigned int id, std::shared_ptr<Camera> camera)
 	: id_(id), state_(State::Stopped), camera_(std::move(camera)),
-	  facing_(CAMERA_FACING_FRONT), orientation_(0)
+	  facing_(CAMERA_FACING_FRONT), orientation_(0),
+	  postProcessingWorkers_(1)
 {
 	camera_->requestCompleted.connect(this, &CameraDevice::requestComplete);
 
@@ -376,6 +509,9 @@ int CameraDevice::initialize(const CameraConfigData *cameraConfigData)
 		orientation_ = 0;
 	}
 
+	if (cameraConfigData)
+		postProcessingWorkers_ = cameraConfigData->postProcessingWorkers;
+
 	return capabilities_.initialize(camera_, orientation_, facing_);
 }
 
@@ -440,10 +576,11 @@ void CameraDevice::stop()
 
 	{
 		MutexLocker descriptorsLock(descriptorsMutex_);
-		descriptors_ = {};
+		descriptors_.clear();
 	}
 
 	streams_.clear();
+	frameBuffers_.clear();
 
 	state_ = State::Stopped;
 }
@@ -528,6 +665,9 @@ int CameraDevice::configureStreams(camera3_stream_configuration_t *stream_list)
 	/* Before any configuration attempt, stop the camera. */
 	stop();
 
+	/* Buffers of the previous configuration will not be used anymore. */
+	frameBuffers_.clear();
+
 	if (stream_list->num_streams == 0) {
 		LOG(HAL, Error) << "No streams in configuration";
 		return -EINVAL;
@@ -538,16 +678,6 @@ int CameraDevice::configureStreams(camera3_stream_configuration_t *stream_list)
 		return -EINVAL;
 #endif
 
-	/*
-	 * Generate an empty configuration, and construct a StreamConfiguration
-	 * for each camera3_stream to add to it.
-	 */
-	std::unique_ptr<CameraConfiguration> config = camera_->generateConfiguration();
-	if (!config) {
-		LOG(HAL, Error) << "Failed to generate camera configuration";
-		return -EINVAL;
-	}
-
 	/*
 	 * Clear and remove any existing configuration from previous calls, and
 	 * ensure the required entries are available without further
@@ -618,23 +748,9 @@ int CameraDevice::configureStreams(camera3_stream_configuration_t *stream_list)
 		stream->usage |= GRALLOC_USAGE_HW_CAMERA_WRITE;
 
 		/*
-		 * If a CameraStream with the same size and format as the
-		 * current stream has already been requested, associate the two.
+		 * Produce all streams in hardware first. Streams are merged
+		 * below if the camera can't produce them all.
 		 */
-		auto iter = std::find_if(
-			streamConfigs.begin(), streamConfigs.end(),
-			[&size, &format](const Camera3StreamConfig &streamConfig) {
-				return streamConfig.config.size == size &&
-				       streamConfig.config.pixelFormat == format;
-			});
-		if (iter != streamConfigs.end()) {
-			/* Add usage to copy the buffer in streams[0] to stream. */
-			iter->streams[0].stream->usage |= GRALLOC_USAGE_SW_READ_OFTEN;
-			stream->usage |= GRALLOC_USAGE_SW_WRITE_OFTEN;
-			iter->streams.push_back({ stream, CameraStream::Type::Mapped });
-			continue;
-		}
-
 		Camera3StreamConfig streamConfig;
 		streamConfig.streams = { { stream, CameraStream::Type::Direct } };
 		streamConfig.config.size = size;
@@ -705,15 +821,47 @@ int CameraDevice::configureStreams(camera3_stream_configuration_t *stream_list)
 		streamConfigs[index].streams.push_back({ jpegStream, type });
 	}
 
-	sortCamera3StreamConfigs(streamConfigs, jpegStream);
-	for (const auto &streamConfig : streamConfigs) {
-		config->addConfiguration(streamConfig.config);
+	/*
+	 * Generate an empty configuration, and add a StreamConfiguration for
+	 * each Camera3StreamConfig to it. If the camera can't produce all of
+	 * them, merge the configurations that are the cheapest to produce in
+	 * software and try again.
+	 */
+	std::unique_ptr<CameraConfiguration> config;
+	while (true) {
+		sortCamera3StreamConfigs(streamConfigs, jpegStream);
+
+		config = camera_->generateConfiguration();
+		if (!config) {
+			LOG(HAL, Error) << "Failed to generate camera configuration";
+			return -EINVAL;
+		}
+
+		for (const auto &streamConfig : streamConfigs)
+			config->addConfiguration(streamConfig.config);
+
+		CameraConfiguration::Status status = config->validate();
+		if (status == CameraConfiguration::Valid)
+			break;
+
+		if (status == CameraConfiguration::Adjusted) {
+			LOG(HAL, Info) << "Camera configuration adjusted";
 
+			for (const StreamConfiguration &cfg : *config)
+				LOG(HAL, Info) << " - " << cfg.toString();
+		} else {
+			LOG(HAL, Info) << "Camera configuration invalid";
+		}
+
+		if (!mergeCamera3StreamConfigs(streamConfigs, jpegStream))
+			return -EINVAL;
+	}
+
+	for (const auto &[index, streamConfig] : utils::enumerate(streamConfigs)) {
 		CameraStream *sourceStream = nullptr;
 		for (auto &stream : streamConfig.streams) {
 			streams_.emplace_back(this, config.get(), stream.type,
-					      stream.stream, sourceStream,
-					      config->size() - 1);
+					      stream.stream, sourceStream, index);
 			stream.stream->priv = static_cast<void *>(&streams_.back());
 
 			/*
@@ -729,19 +877,38 @@ int CameraDevice::configureStreams(camera3_stream_configuration_t *stream_list)
 		}
 	}
 
-	switch (config->validate()) {
-	case CameraConfiguration::Valid:
-		break;
-	case CameraConfiguration::Adjusted:
-		LOG(HAL, Info) << "Camera configuration adjusted";
+	/*
+	 * Group the mapped NV12 streams produced from the same source, to scale
+	 * them in a single pass. See CameraStream::groupLeader().
+	 */
+	for (CameraStream &cameraStream : streams_) {
+		if (cameraStream.type() != CameraStream::Type::Mapped ||
+		    capabilities_.toPixelFormat(cameraStream.camera3Stream()->format) != formats::NV12)
+			continue;
 
-		for (const StreamConfiguration &cfg : *config)
-			LOG(HAL, Info) << " - " << cfg.toString();
+		CameraStream *leader = nullptr;
+		for (CameraStream &other : streams_) {
+			if (&other == &cameraStream)
+				break;
 
-		return -EINVAL;
-	case CameraConfiguration::Invalid:
-		LOG(HAL, Info) << "Camera configuration invalid";
-		return -EINVAL;
+			if (other.sourceStream() == cameraStream.sourceStream() &&
+			    other.groupLeader()) {
+				leader = other.groupLeader();
+				break;
+			}
+		}
+
+		if (!leader) {
+			cameraStream.setGroupLeader(&cameraStream);
+			continue;
+		}
+
+		cameraStream.setGroupLeader(leader);
+		LOG(HAL, Debug)
+			<< "Producing " << cameraStream.camera3Stream()->width << "x"
+			<< cameraStream.camera3Stream()->height
+			<< " along with " << leader->camera3Stream()->width << "x"
+			<< leader->camera3Stream()->height;
 	}
 
 	/*
@@ -768,14 +935,55 @@ int CameraDevice::configureStreams(camera3_stream_configuration_t *stream_list)
 		}
 	}
 
+	/*
+	 * Create the result metadata template for the new configuration, and
+	 * drop the metadata packs recycled from the previous one.
+	 */
+	resultTemplate_ = createResultTemplate();
+	if (!resultTemplate_)
+		return -ENOMEM;
+
+	{
+		MutexLocker locker(resultMetadataMutex_);
+		resultMetadataPool_.clear();
+	}
+
 	config_ = std::move(config);
 	return 0;
 }
 
-std::unique_ptr<HALFrameBuffer>
-CameraDevice::createFrameBuffer(const buffer_handle_t camera3buffer,
-				PixelFormat pixelFormat, const Size &size)
+/*
+ * Retrieve the frame buffer wrapping \a camera3buffer, creating it if needed.
+ *
+ * Frame buffers are cached by native handle, to avoid duplicating the dmabuf
+ * fds and creating a new FrameBuffer for every capture request. As the
+ * framework may free a native handle and import a new buffer at the same
+ * address, cache hits are validated by comparing the dmabuf inodes. The
+ * cached frame buffer holds a reference to its dmabufs, so their inodes can't
+ * be reused by a different buffer.
+ */
+HALFrameBuffer *CameraDevice::getFrameBuffer(const buffer_handle_t camera3buffer,
+					     PixelFormat pixelFormat, const Size &size)
 {
+	std::vector<ino_t> inodes(camera3buffer->numFds);
+	for (int i = 0; i < camera3buffer->numFds; ++i) {
+		struct stat st;
+		if (fstat(camera3buffer->data[i], &st) < 0) {
+			LOG(HAL, Fatal) << "No valid fd";
+			return nullptr;
+		}
+
+		inodes[i] = st.st_ino;
+	}
+
+	auto it = frameBuffers_.find(camera3buffer);
+	if (it != frameBuffers_.end()) {
+		if (it->second.inodes == inodes)
+			return it->second.buffer.get();
+
+		frameBuffers_.erase(it);
+	}
+
 	CameraBuffer buf(camera3buffer, pixelFormat, size, PROT_READ);
 	if (!buf.isValid()) {
 		LOG(HAL, Fatal) << "Failed to create CameraBuffer";
@@ -795,19 +1003,36 @@ CameraDevice::createFrameBuffer(const buffer_handle_t camera3buffer,
 		planes[i].length = buf.size(i);
 	}
 
-	return std::make_unique<HALFrameBuffer>(planes, camera3buffer);
+	CachedFrameBuffer &entry = frameBuffers_[camera3buffer];
+	entry.buffer = std::make_unique<HALFrameBuffer>(planes, camera3buffer);
+	entry.inodes = std::move(inodes);
+
+	return entry.buffer.get();
 }
 
+/*
+ * Translate the Android request settings to libcamera controls.
+ *
+ * libcamera controls stay in effect until they are changed. As Android repeats
+ * the same settings in most requests, only the settings that differ from the
+ * previously translated ones are converted.
+ */
 int CameraDevice::processControls(Camera3RequestDescriptor *descriptor)
 {
-	const CameraMetadata &settings = descriptor->settings_;
+	const CameraMetadata &settings = *descriptor->settings_;
 	if (!settings.isValid())
 		return 0;
 
-	/* Translate the Android request settings to libcamera controls. */
+	/* Requests without settings share the previous settings. */
+	if (descriptor->settings_ == appliedSettings_)
+		return 0;
+
+	const CameraMetadata *applied = appliedSettings_.get();
 	ControlList &controls = descriptor->request_->controls();
 	camera_metadata_ro_entry_t entry;
-	if (settings.getEntry(ANDROID_SCALER_CROP_REGION, &entry)) {
+
+	if (entryChanged(settings, applied, ANDROID_SCALER_CROP_REGION) &&
+	    settings.getEntry(ANDROID_SCALER_CROP_REGION, &entry)) {
 		const int32_t *data = entry.data.i32;
 		Rectangle cropRegion{ data[0], data[1],
 				      static_cast<unsigned int>(data[2]),
@@ -815,7 +1040,8 @@ int CameraDevice::processControls(Camera3RequestDescriptor *descriptor)
 		controls.set(controls::ScalerCrop, cropRegion);
 	}
 
-	if (settings.getEntry(ANDROID_SENSOR_TEST_PATTERN_MODE, &entry)) {
+	if (entryChanged(settings, applied, ANDROID_SENSOR_TEST_PATTERN_MODE) &&
+	    settings.getEntry(ANDROID_SENSOR_TEST_PATTERN_MODE, &entry)) {
 		const int32_t data = *entry.data.i32;
 		int32_t testPatternMode = controls::draft::TestPatternModeOff;
 		switch (data) {
@@ -853,6 +1079,8 @@ int CameraDevice::processControls(Camera3RequestDescriptor *descriptor)
 		controls.set(controls::draft::TestPatternMode, testPatternMode);
 	}
 
+	appliedSettings_ = descriptor->settings_;
+
 	return 0;
 }
 
@@ -938,11 +1166,23 @@ int CameraDevice::processCaptureRequest(camera3_capture_request_t *camera3Reques
 
 	/*
 	 * Save the request descriptors for use at completion time.
-	 * The descriptor and the associated memory reserved here are freed
-	 * at request complete time.
+	 * The descriptor is returned to the pool once its capture result has
+	 * been sent, reuse one if available.
 	 */
-	auto descriptor = std::make_unique<Camera3RequestDescriptor>(camera_.get(),
-								     camera3Request);
+	std::unique_ptr<Camera3RequestDescriptor> descriptor;
+	{
+		MutexLocker poolLock(descriptorPoolMutex_);
+		if (!descriptorPool_.empty()) {
+			descriptor = std::move(descriptorPool_.back());
+			descriptorPool_.pop_back();
+		}
+	}
+
+	if (descriptor)
+		descriptor->reuse(camera3Request);
+	else
+		descriptor = std::make_unique<Camera3RequestDescriptor>(camera_.get(),
+									camera3Request);
 
 	/*
 	 * \todo The Android request model is incremental, settings passed in
@@ -950,10 +1190,12 @@ int CameraDevice::processCaptureRequest(camera3_capture_request_t *camera3Reques
 	 * a new request. Do we need to cache settings incrementally here, or is
 	 * it handled by the Android camera service ?
 	 */
-	if (camera3Request->settings)
-		lastSettings_ = camera3Request->settings;
-	else
+	if (descriptor->settings_)
+		lastSettings_ = descriptor->settings_;
+	else if (lastSettings_)
 		descriptor->settings_ = lastSettings_;
+	else
+		descriptor->settings_ = std::make_shared<const CameraMetadata>();
 
 	LOG(HAL, Debug) << "Queueing request " << descriptor->request_->cookie()
 			<< " with " << descriptor->buffers_.size() << " streams";
@@ -999,10 +1241,10 @@ int CameraDevice::processCaptureRequest(camera3_capture_request_t *camera3Reques
 			 * lifetime management only.
 			 */
 			buffer.frameBuffer =
-				createFrameBuffer(*buffer.camera3Buffer,
-						  cameraStream->configuration().pixelFormat,
-						  cameraStream->configuration().size);
-			frameBuffer = buffer.frameBuffer.get();
+				getFrameBuffer(*buffer.camera3Buffer,
+					       cameraStream->configuration().pixelFormat,
+					       cameraStream->configuration().size);
+			frameBuffer = buffer.frameBuffer;
 			acquireFence = std::move(buffer.fence);
 			LOG(HAL, Debug) << ss.str() << " (direct)";
 			break;
@@ -1080,14 +1322,6 @@ int CameraDevice::processCaptureRequest(camera3_capture_request_t *camera3Reques
 		requestedStreams.insert(sourceStream);
 	}
 
-	/*
-	 * Translate controls from Android to libcamera and queue the request
-	 * to the camera.
-	 */
-	int ret = processControls(descriptor.get());
-	if (ret)
-		return ret;
-
 	/*
 	 * If flush is in progress set the request status to error and place it
 	 * on the queue to be later completed. If the camera has been stopped we
@@ -1099,7 +1333,7 @@ int CameraDevice::processCaptureRequest(camera3_capture_request_t *camera3Reques
 		Camera3RequestDescriptor *rawDescriptor = descriptor.get();
 		{
 			MutexLocker descriptorsLock(descriptorsMutex_);
-			descriptors_.push(std::move(descriptor));
+			descriptors_.push_back(std::move(descriptor));
 		}
 		abortRequest(rawDescriptor);
 		completeDescriptor(rawDescriptor);
@@ -1107,6 +1341,18 @@ int CameraDevice::processCaptureRequest(camera3_capture_request_t *camera3Reques
 		return 0;
 	}
 
+	/*
+	 * Translate controls from Android to libcamera and queue the request
+	 * to the camera. Controls set before the camera was stopped may not
+	 * have been applied, translate all the settings again after a restart.
+	 */
+	if (state_ == State::Stopped)
+		appliedSettings_.reset();
+
+	int ret = processControls(descriptor.get());
+	if (ret)
+		return ret;
+
 	if (state_ == State::Stopped) {
 		ret = camera_->start();
 		if (ret) {
@@ -1121,7 +1367,7 @@ int CameraDevice::processCaptureRequest(camera3_capture_request_t *camera3Reques
 
 	{
 		MutexLocker descriptorsLock(descriptorsMutex_);
-		descriptors_.push(std::move(descriptor));
+		descriptors_.push_back(std::move(descriptor));
 	}
 
 	camera_->queueRequest(request);
@@ -1208,6 +1454,35 @@ void CameraDevice::requestComplete(Request *request)
 		descriptor->resultMetadata_ = std::make_unique<CameraMetadata>(0, 0);
 	}
 
+	/*
+	 * The metadata produced by the post-processors is collected separately,
+	 * to be sent as the final partial result once post-processing
+	 * completes, while the rest of the result is sent right away.
+	 *
+	 * Reserve space for the JPEG metadata set by the post-processor.
+	 * Currently:
+	 * ANDROID_JPEG_GPS_COORDINATES (double x 3) = 24 bytes
+	 * ANDROID_JPEG_GPS_PROCESSING_METHOD (byte x 32) = 32 bytes
+	 * ANDROID_JPEG_GPS_TIMESTAMP (int64) = 8 bytes
+	 * ANDROID_JPEG_SIZE (int32_t) = 4 bytes
+	 * ANDROID_JPEG_QUALITY (byte) = 1 byte
+	 * ANDROID_JPEG_ORIENTATION (int32_t) = 4 bytes
+	 * ANDROID_JPEG_THUMBNAIL_QUALITY (byte) = 1 byte
+	 * ANDROID_JPEG_THUMBNAIL_SIZE (int32 x 2) = 8 bytes
+	 * Total bytes for JPEG metadata: 82
+	 */
+	bool postProcessing;
+	{
+		MutexLocker locker(descriptor->streamsProcessMutex_);
+		postProcessing = !descriptor->pendingStreamsToProcess_.empty();
+	}
+
+	if (postProcessing)
+		descriptor->postProcessingMetadata_ =
+			std::make_unique<CameraMetadata>(8, 82);
+
+	sendEarlyResult(descriptor);
+
 	/* Handle post-processing. */
 	MutexLocker locker(descriptor->streamsProcessMutex_);
 
@@ -1217,26 +1492,67 @@ void CameraDevice::requestComplete(Request *request)
 	 * this critical section. This helps to handle synchronous errors here
 	 * itself.
 	 */
-	auto iter = descriptor->pendingStreamsToProcess_.begin();
-	while (iter != descriptor->pendingStreamsToProcess_.end()) {
+	auto &pending = descriptor->pendingStreamsToProcess_;
+
+	/*
+	 * Attach the buffers of grouped streams to the buffer of their group
+	 * leader when it is part of the request, to produce them in a single
+	 * post-processing job.
+	 */
+	std::set<CameraStream *> attached;
+	for (auto iter = pending.begin(); iter != pending.end();) {
 		CameraStream *stream = iter->first;
 		Camera3RequestDescriptor::StreamBuffer *buffer = iter->second;
+		CameraStream *leader = stream->groupLeader();
+
+		auto leaderIter = leader != stream ? pending.find(leader) : pending.end();
+		if (leaderIter == pending.end()) {
+			++iter;
+			continue;
+		}
+
+		int ret = stream->prepareBuffer(buffer);
+		if (ret) {
+			setBufferStatus(*buffer, Camera3RequestDescriptor::Status::Error);
+			iter = pending.erase(iter);
+			continue;
+		}
 
+		leaderIter->second->dependents.push_back(buffer);
+		attached.insert(stream);
+		++iter;
+	}
+
+	std::vector<std::pair<CameraStream *, Camera3RequestDescriptor::StreamBuffer *>> jobs;
+	for (const auto &[stream, buffer] : pending) {
+		if (!attached.count(stream))
+			jobs.emplace_back(stream, buffer);
+	}
+
+	auto fail = [&](Camera3RequestDescriptor::StreamBuffer *buffer)
+		LIBCAMERA_TSA_REQUIRES(descriptor->streamsProcessMutex_) {
+		for (auto *dependent : buffer->dependents) {
+			setBufferStatus(*dependent, Camera3RequestDescriptor::Status::Error);
+			pending.erase(dependent->stream);
+		}
+
+		setBufferStatus(*buffer, Camera3RequestDescriptor::Status::Error);
+		pending.erase(buffer->stream);
+	};
+
+	for (const auto &[stream, buffer] : jobs) {
 		FrameBuffer *src = request->findBuffer(stream->stream());
 		if (!src) {
 			LOG(HAL, Error) << "Failed to find a source stream buffer";
-			setBufferStatus(*buffer, Camera3RequestDescriptor::Status::Error);
-			iter = descriptor->pendingStreamsToProcess_.erase(iter);
+			fail(buffer);
 			continue;
 		}
 
 		buffer->srcBuffer = src;
 
-		++iter;
 		int ret = stream->process(buffer);
 		if (ret) {
-			setBufferStatus(*buffer, Camera3RequestDescriptor::Status::Error);
-			descriptor->pendingStreamsToProcess_.erase(stream);
+			fail(buffer);
 
 			/*
 			 * If the framebuffer is internal to CameraStream return
@@ -1277,10 +1593,11 @@ void CameraDevice::completeDescriptor(Camera3RequestDescriptor *descriptor)
  *
  * Iterate over the descriptors queue to send completed descriptors back to the
  * framework, in the same order as they have been queued. For each complete
- * descriptor, populate a locally-scoped camera3_capture_result_t from the
- * descriptor, send the capture result back by calling the
- * process_capture_result() callback, and remove the descriptor from the queue.
- * Stop iterating if the descriptor at the front of the queue is not complete.
+ * descriptor, send the buffers that haven't been returned by
+ * sendEarlyResult() along with the final partial result metadata by calling
+ * the process_capture_result() callback, and remove the descriptor from the
+ * queue. Stop iterating if the descriptor at the front of the queue is not
+ * complete.
  *
  * This function should never be called directly in the codebase. Use
  * completeDescriptor() instead.
@@ -1289,44 +1606,129 @@ void CameraDevice::sendCaptureResults()
 {
 	while (!descriptors_.empty() && !descriptors_.front()->isPending()) {
 		auto descriptor = std::move(descriptors_.front());
-		descriptors_.pop();
+		descriptors_.pop_front();
+
+		/*
+		 * If the early result hasn't been sent, the metadata known at
+		 * request completion time is sent now as the first partial
+		 * result.
+		 */
+		const CameraMetadata *metadata = descriptor->resultMetadata_.get();
+		if (descriptor->postProcessingMetadata_) {
+			if (!descriptor->earlyResultSent_)
+				sendCaptureResult(descriptor.get(), metadata, 1, false);
 
-		camera3_capture_result_t captureResult = {};
+			metadata = descriptor->postProcessingMetadata_.get();
+		}
 
-		captureResult.frame_number = descriptor->frameNumber_;
+		sendCaptureResult(descriptor.get(), metadata,
+				  CameraCapabilities::kPartialResultCount, false);
 
+		/* The framework copies the result metadata, recycle it. */
 		if (descriptor->resultMetadata_)
-			captureResult.result =
-				descriptor->resultMetadata_->getMetadata();
+			recycleResultMetadata(std::move(descriptor->resultMetadata_));
 
-		std::vector<camera3_stream_buffer_t> resultBuffers;
-		resultBuffers.reserve(descriptor->buffers_.size());
+		MutexLocker poolLock(descriptorPoolMutex_);
+		descriptorPool_.push_back(std::move(descriptor));
+	}
+}
 
-		for (auto &buffer : descriptor->buffers_) {
-			camera3_buffer_status status = CAMERA3_BUFFER_STATUS_ERROR;
+/**
+ * \brief Send the buffers of a request that don't need post-processing
+ * \param[in] descriptor The Camera3RequestDescriptor whose libcamera request
+ * has completed
+ *
+ * Return the buffers of the streams of type Direct to the framework as soon as
+ * the libcamera request completes, without waiting for post-processing of the
+ * other streams and for the completion of the previous requests. If the
+ * request has streams to post-process, the metadata known at this time is
+ * returned as the first partial result, and the metadata produced by the
+ * post-processors later as the final one.
+ *
+ * Buffers must be returned in order for each stream. The early result is thus
+ * only sent if all previous requests have returned their Direct buffers. A
+ * request at the front of the queue without post-processing is completed
+ * right away, the early result is skipped to return everything at once.
+ */
+void CameraDevice::sendEarlyResult(Camera3RequestDescriptor *descriptor)
+{
+	MutexLocker lock(descriptorsMutex_);
 
-			if (buffer.status == Camera3RequestDescriptor::Status::Success)
-				status = CAMERA3_BUFFER_STATUS_OK;
+	for (const auto &queued : descriptors_) {
+		if (queued.get() == descriptor)
+			break;
 
-			/*
-			 * Pass the buffer fence back to the camera framework as
-			 * a release fence. This instructs the framework to wait
-			 * on the acquire fence in case we haven't done so
-			 * ourselves for any reason.
-			 */
-			resultBuffers.push_back({ buffer.stream->camera3Stream(),
-						  buffer.camera3Buffer, status,
-						  -1, buffer.fence.release() });
-		}
+		if (!queued->earlyResultSent_)
+			return;
+	}
+
+	if (descriptors_.front().get() == descriptor &&
+	    !descriptor->postProcessingMetadata_)
+		return;
+
+	const CameraMetadata *metadata = descriptor->postProcessingMetadata_
+				       ? descriptor->resultMetadata_.get()
+				       : nullptr;
+
+	sendCaptureResult(descriptor, metadata, 1, true);
+	descriptor->earlyResultSent_ = true;
+}
+
+/*
+ * Send a capture result with the buffers that haven't been returned yet, only
+ * the ones of streams of type Direct if \a directOnly is true, and the
+ * \a metadata partial result.
+ */
+void CameraDevice::sendCaptureResult(Camera3RequestDescriptor *descriptor,
+				     const CameraMetadata *metadata,
+				     uint32_t partialResult, bool directOnly)
+{
+	camera3_capture_result_t captureResult = {};
 
-		captureResult.num_output_buffers = resultBuffers.size();
-		captureResult.output_buffers = resultBuffers.data();
+	captureResult.frame_number = descriptor->frameNumber_;
 
-		if (descriptor->status_ == Camera3RequestDescriptor::Status::Success)
-			captureResult.partial_result = 1;
+	if (metadata)
+		captureResult.result = metadata->getMetadata();
 
-		callbacks_->process_capture_result(callbacks_, &captureResult);
+	std::vector<camera3_stream_buffer_t> resultBuffers;
+	resultBuffers.reserve(descriptor->buffers_.size());
+
+	for (auto &buffer : descriptor->buffers_) {
+		if (buffer.returned)
+			continue;
+
+		if (directOnly && buffer.stream->type() != CameraStream::Type::Direct)
+			continue;
+
+		camera3_buffer_status status = CAMERA3_BUFFER_STATUS_ERROR;
+
+		if (buffer.status == Camera3RequestDescriptor::Status::Success)
+			status = CAMERA3_BUFFER_STATUS_OK;
+
+		/*
+		 * Pass the buffer fence back to the camera framework as
+		 * a release fence. This instructs the framework to wait
+		 * on the acquire fence in case we haven't done so
+		 * ourselves for any reason.
+		 */
+		resultBuffers.push_back({ buffer.stream->camera3Stream(),
+					  buffer.camera3Buffer, status,
+					  -1, buffer.fence.release() });
+		buffer.returned = true;
 	}
+
+	/* A capture result must contain buffers or metadata. */
+	if (resultBuffers.empty() && !captureResult.result)
+		return;
+
+	captureResult.num_output_buffers = resultBuffers.size();
+	captureResult.output_buffers = resultBuffers.data();
+
+	/* The partial result number must be 0 when no metadata is included. */
+	if (captureResult.result)
+		captureResult.partial_result = partialResult;
+
+	callbacks_->process_capture_result(callbacks_, &captureResult);
 }
 
 void CameraDevice::setBufferStatus(Camera3RequestDescriptor::StreamBuffer &streamBuffer,
@@ -1412,36 +1814,23 @@ void CameraDevice::notifyError(uint32_t frameNumber, camera3_stream_t *stream,
 }
 
 /*
- * Produce a set of fixed result metadata.
+ * Create the result metadata template.
+ *
+ * The template holds the entries with fixed values, and slots for the entries
+ * reported in every result. It is sorted to speed up the lookups of the slots,
+ * which are updated in place for every capture result. Its capacity accounts
+ * for the optional entries added by getResultMetadata().
  */
-std::unique_ptr<CameraMetadata>
-CameraDevice::getResultMetadata(const Camera3RequestDescriptor &descriptor) const
+std::unique_ptr<CameraMetadata> CameraDevice::createResultTemplate() const
 {
-	const ControlList &metadata = descriptor.request_->metadata();
-	const CameraMetadata &settings = descriptor.settings_;
-	camera_metadata_ro_entry_t entry;
-	bool found;
-
 	/*
 	 * \todo Keep this in sync with the actual number of entries.
 	 * Currently: 40 entries, 156 bytes
-	 *
-	 * Reserve more space for the JPEG metadata set by the post-processor.
-	 * Currently:
-	 * ANDROID_JPEG_GPS_COORDINATES (double x 3) = 24 bytes
-	 * ANDROID_JPEG_GPS_PROCESSING_METHOD (byte x 32) = 32 bytes
-	 * ANDROID_JPEG_GPS_TIMESTAMP (int64) = 8 bytes
-	 * ANDROID_JPEG_SIZE (int32_t) = 4 bytes
-	 * ANDROID_JPEG_QUALITY (byte) = 1 byte
-	 * ANDROID_JPEG_ORIENTATION (int32_t) = 4 bytes
-	 * ANDROID_JPEG_THUMBNAIL_QUALITY (byte) = 1 byte
-	 * ANDROID_JPEG_THUMBNAIL_SIZE (int32 x 2) = 8 bytes
-	 * Total bytes for JPEG metadata: 82
 	 */
 	std::unique_ptr<CameraMetadata> resultMetadata =
-		std::make_unique<CameraMetadata>(88, 166);
+		std::make_unique<CameraMetadata>(40, 156);
 	if (!resultMetadata->isValid()) {
-		LOG(HAL, Error) << "Failed to allocate result metadata";
+		LOG(HAL, Error) << "Failed to allocate result metadata template";
 		return nullptr;
 	}
 
@@ -1468,18 +1857,8 @@ CameraDevice::getResultMetadata(const Camera3RequestDescriptor &descriptor) cons
 	value = ANDROID_CONTROL_AE_MODE_ON;
 	resultMetadata->addEntry(ANDROID_CONTROL_AE_MODE, value);
 
-	if (settings.getEntry(ANDROID_CONTROL_AE_TARGET_FPS_RANGE, &entry))
-		/*
-		 * \todo Retrieve the AE FPS range from the libcamera metadata.
-		 * As libcamera does not support that control, as a temporary
-		 * workaround return what the framework asked.
-		 */
-		resultMetadata->addEntry(ANDROID_CONTROL_AE_TARGET_FPS_RANGE,
-					 entry.data.i32, 2);
-
-	found = settings.getEntry(ANDROID_CONTROL_AE_PRECAPTURE_TRIGGER, &entry);
-	value = found ? *entry.data.u8 :
-			(uint8_t)ANDROID_CONTROL_AE_PRECAPTURE_TRIGGER_IDLE;
+	/* Slot updated from the request settings. */
+	value = ANDROID_CONTROL_AE_PRECAPTURE_TRIGGER_IDLE;
 	resultMetadata->addEntry(ANDROID_CONTROL_AE_PRECAPTURE_TRIGGER, value);
 
 	value = ANDROID_CONTROL_AE_STATE_CONVERGED;
@@ -1524,9 +1903,6 @@ CameraDevice::getResultMetadata(const Camera3RequestDescriptor &descriptor) cons
 	value = ANDROID_FLASH_STATE_UNAVAILABLE;
 	resultMetadata->addEntry(ANDROID_FLASH_STATE, value);
 
-	if (settings.getEntry(ANDROID_LENS_APERTURE, &entry))
-		resultMetadata->addEntry(ANDROID_LENS_APERTURE, entry.data.f, 1);
-
 	float focal_length = 1.0;
 	resultMetadata->addEntry(ANDROID_LENS_FOCAL_LENGTH, focal_length);
 
@@ -1537,6 +1913,7 @@ CameraDevice::getResultMetadata(const Camera3RequestDescriptor &descriptor) cons
 	resultMetadata->addEntry(ANDROID_LENS_OPTICAL_STABILIZATION_MODE,
 				 value);
 
+	/* Slot updated from the libcamera metadata. */
 	value32 = ANDROID_SENSOR_TEST_PATTERN_MODE_OFF;
 	resultMetadata->addEntry(ANDROID_SENSOR_TEST_PATTERN_MODE, value32);
 
@@ -1561,9 +1938,84 @@ CameraDevice::getResultMetadata(const Camera3RequestDescriptor &descriptor) cons
 	resultMetadata->addEntry(ANDROID_SENSOR_ROLLING_SHUTTER_SKEW,
 				 rolling_shutter_skew);
 
+	/* Slot updated from the libcamera metadata. */
+	const int64_t timestamp = 0;
+	resultMetadata->addEntry(ANDROID_SENSOR_TIMESTAMP, timestamp);
+
+	if (!resultMetadata->isValid()) {
+		LOG(HAL, Error) << "Failed to construct result metadata template";
+		return nullptr;
+	}
+
+	resultMetadata->sort();
+
+	return resultMetadata;
+}
+
+/*
+ * Produce the result metadata for a completed request.
+ *
+ * The metadata pack is filled from the result template, reusing the memory of
+ * a pack recycled from a previous capture result when available.
+ */
+std::unique_ptr<CameraMetadata>
+CameraDevice::getResultMetadata(const Camera3RequestDescriptor &descriptor)
+{
+	const ControlList &metadata = descriptor.request_->metadata();
+	const CameraMetadata &settings = *descriptor.settings_;
+	camera_metadata_ro_entry_t entry;
+	bool found;
+
+	if (!resultTemplate_)
+		return nullptr;
+
+	std::unique_ptr<CameraMetadata> resultMetadata;
+
+	{
+		MutexLocker locker(resultMetadataMutex_);
+		if (!resultMetadataPool_.empty()) {
+			resultMetadata = std::move(resultMetadataPool_.back());
+			resultMetadataPool_.pop_back();
+		}
+	}
+
+	if (!resultMetadata)
+		resultMetadata = std::make_unique<CameraMetadata>();
+
+	if (!resultMetadata->assign(*resultTemplate_)) {
+		LOG(HAL, Error) << "Failed to allocate result metadata";
+		return nullptr;
+	}
+
+	/*
+	 * Update the slots first, while the entries are still sorted, then
+	 * add the optional entries.
+	 */
+	found = settings.getEntry(ANDROID_CONTROL_AE_PRECAPTURE_TRIGGER, &entry);
+	uint8_t value = found ? *entry.data.u8 :
+				(uint8_t)ANDROID_CONTROL_AE_PRECAPTURE_TRIGGER_IDLE;
+	resultMetadata->updateEntry(ANDROID_CONTROL_AE_PRECAPTURE_TRIGGER, value);
+
 	/* Add metadata tags reported by libcamera. */
 	const int64_t timestamp = metadata.get(controls::SensorTimestamp).value_or(0);
-	resultMetadata->addEntry(ANDROID_SENSOR_TIMESTAMP, timestamp);
+	resultMetadata->updateEntry(ANDROID_SENSOR_TIMESTAMP, timestamp);
+
+	const auto &testPatternMode = metadata.get(controls::draft::TestPatternMode);
+	if (testPatternMode)
+		resultMetadata->updateEntry(ANDROID_SENSOR_TEST_PATTERN_MODE,
+					    *testPatternMode);
+
+	if (settings.getEntry(ANDROID_CONTROL_AE_TARGET_FPS_RANGE, &entry))
+		/*
+		 * \todo Retrieve the AE FPS range from the libcamera metadata.
+		 * As libcamera does not support that control, as a temporary
+		 * workaround return what the framework asked.
+		 */
+		resultMetadata->addEntry(ANDROID_CONTROL_AE_TARGET_FPS_RANGE,
+					 entry.data.i32, 2);
+
+	if (settings.getEntry(ANDROID_LENS_APERTURE, &entry))
+		resultMetadata->addEntry(ANDROID_LENS_APERTURE, entry.data.f, 1);
 
 	const auto &pipelineDepth = metadata.get(controls::draft::PipelineDepth);
 	if (pipelineDepth)
@@ -1590,11 +2042,6 @@ CameraDevice::getResultMetadata(const Camera3RequestDescriptor &descriptor) cons
 		resultMetadata->addEntry(ANDROID_SCALER_CROP_REGION, cropRect);
 	}
 
-	const auto &testPatternMode = metadata.get(controls::draft::TestPatternMode);
-	if (testPatternMode)
-		resultMetadata->addEntry(ANDROID_SENSOR_TEST_PATTERN_MODE,
-					 *testPatternMode);
-
 	/*
 	 * Return the result metadata pack even is not valid: get() will return
 	 * nullptr.
@@ -1612,3 +2059,13 @@ CameraDevice::getResultMetadata(const Camera3RequestDescriptor &descriptor) cons
 
 	return resultMetadata;
 }
+
+/*
+ * Return a result metadata pack to the pool once the framework has copied it,
+ * to reuse its memory for a later capture result.
+ */
+void CameraDevice::recycleResultMetadata(std::unique_ptr<CameraMetadata> metadata)
+{
+	MutexLocker locker(resultMetadataMutex_);
+	resultMetadataPool_.push_back(std::move(metadata));
+}
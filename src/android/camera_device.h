@@ -9,9 +9,11 @@
 
 #include <map>
 #include <memory>
-#include <queue>
+#include <deque>
 #include <vector>
 
+#include <sys/types.h>
+
 #include <hardware/camera3.h>
 
 #include <libcamera/base/class.h>
@@ -57,6 +59,7 @@ public:
 	const std::string &model() const { return model_; }
 	int facing() const { return facing_; }
 	int orientation() const { return orientation_; }
+	unsigned int postProcessingWorkers() const { return postProcessingWorkers_; }
 	unsigned int maxJpegBufferSize() const;
 
 	void setCallbacks(const camera3_callback_ops_t *callbacks);
@@ -84,23 +87,33 @@ private:
 
 	void stop() LIBCAMERA_TSA_EXCLUDES(stateMutex_);
 
-	std::unique_ptr<HALFrameBuffer>
-	createFrameBuffer(const buffer_handle_t camera3buffer,
-			  libcamera::PixelFormat pixelFormat,
-			  const libcamera::Size &size);
+	HALFrameBuffer *getFrameBuffer(const buffer_handle_t camera3buffer,
+				       libcamera::PixelFormat pixelFormat,
+				       const libcamera::Size &size);
 	void abortRequest(Camera3RequestDescriptor *descriptor) const;
 	bool isValidRequest(camera3_capture_request_t *request) const;
 	void notifyShutter(uint32_t frameNumber, uint64_t timestamp);
 	void notifyError(uint32_t frameNumber, camera3_stream_t *stream,
 			 camera3_error_msg_code code) const;
-	int processControls(Camera3RequestDescriptor *descriptor);
+	int processControls(Camera3RequestDescriptor *descriptor)
+		LIBCAMERA_TSA_REQUIRES(stateMutex_);
 	void completeDescriptor(Camera3RequestDescriptor *descriptor)
 		LIBCAMERA_TSA_EXCLUDES(descriptorsMutex_);
+	void sendEarlyResult(Camera3RequestDescriptor *descriptor)
+		LIBCAMERA_TSA_EXCLUDES(descriptorsMutex_);
 	void sendCaptureResults() LIBCAMERA_TSA_REQUIRES(descriptorsMutex_);
+	void sendCaptureResult(Camera3RequestDescriptor *descriptor,
+			       const CameraMetadata *metadata,
+			       uint32_t partialResult, bool directOnly)
+		LIBCAMERA_TSA_REQUIRES(descriptorsMutex_);
 	void setBufferStatus(Camera3RequestDescriptor::StreamBuffer &buffer,
 			     Camera3RequestDescriptor::Status status);
+	std::unique_ptr<CameraMetadata> createResultTemplate() const;
 	std::unique_ptr<CameraMetadata> getResultMetadata(
-		const Camera3RequestDescriptor &descriptor) const;
+		const Camera3RequestDescriptor &descriptor)
+		LIBCAMERA_TSA_EXCLUDES(resultMetadataMutex_);
+	void recycleResultMetadata(std::unique_ptr<CameraMetadata> metadata)
+		LIBCAMERA_TSA_EXCLUDES(resultMetadataMutex_);
 
 	unsigned int id_;
 	camera3_device_t camera3Device_;
@@ -117,15 +130,43 @@ private:
 
 	std::vector<CameraStream> streams_;
 
+	/*
+	 * Frame buffers wrapping the buffers of direct streams, cached by
+	 * native handle for the lifetime of the stream configuration.
+	 */
+	struct CachedFrameBuffer {
+		std::unique_ptr<HALFrameBuffer> buffer;
+		std::vector<ino_t> inodes;
+	};
+	std::map<buffer_handle_t, CachedFrameBuffer> frameBuffers_;
+
 	libcamera::Mutex descriptorsMutex_ LIBCAMERA_TSA_ACQUIRED_AFTER(stateMutex_);
-	std::queue<std::unique_ptr<Camera3RequestDescriptor>> descriptors_
+	std::deque<std::unique_ptr<Camera3RequestDescriptor>> descriptors_
 		LIBCAMERA_TSA_GUARDED_BY(descriptorsMutex_);
 
+	/*
+	 * Result metadata template for the current stream configuration, and
+	 * metadata packs released by completed requests for reuse.
+	 */
+	std::unique_ptr<CameraMetadata> resultTemplate_;
+	libcamera::Mutex resultMetadataMutex_ LIBCAMERA_TSA_ACQUIRED_AFTER(descriptorsMutex_);
+	std::vector<std::unique_ptr<CameraMetadata>> resultMetadataPool_
+		LIBCAMERA_TSA_GUARDED_BY(resultMetadataMutex_);
+
 	std::string maker_;
 	std::string model_;
 
 	int facing_;
 	int orientation_;
+	unsigned int postProcessingWorkers_;
+
+	std::shared_ptr<const CameraMetadata> lastSettings_;
+	/* Settings last translated to libcamera controls. */
+	std::shared_ptr<const CameraMetadata> appliedSettings_
+		LIBCAMERA_TSA_GUARDED_BY(stateMutex_);
 
-	CameraMetadata lastSettings_;
+	/* Descriptors whose capture results have been sent, for reuse. */
+	libcamera::Mutex descriptorPoolMutex_ LIBCAMERA_TSA_ACQUIRED_AFTER(descriptorsMutex_);
+	std::vector<std::unique_ptr<Camera3RequestDescriptor>> descriptorPool_
+		LIBCAMERA_TSA_GUARDED_BY(descriptorPoolMutex_);
 };
@@ -33,6 +33,8 @@ private:
 	int parseCameraConfigData(const std::string &cameraId, const YamlObject &);
 	int parseLocation(const YamlObject &, CameraConfigData &cameraConfigData);
 	int parseRotation(const YamlObject &, CameraConfigData &cameraConfigData);
+	int parsePostProcessingWorkers(const YamlObject &,
+				       CameraConfigData &cameraConfigData);
 
 	std::map<std::string, CameraConfigData> *cameras_;
 };
@@ -55,6 +57,7 @@ int CameraHalConfig::Private::parseConfigFile(File &file,
 	 *   "camera0 id":
 	 *     location: value
 	 *     rotation: value
+	 *     post_processing_workers: value (optional)
 	 *     ...
 	 *
 	 *   "camera1 id":
@@ -106,6 +109,10 @@ int CameraHalConfig::Private::parseCameraConfigData(const std::string &cameraId,
 	if (parseRotation(cameraObject, cameraConfigData))
 		return -EINVAL;
 
+	/* Parse property "post_processing_workers" */
+	if (parsePostProcessingWorkers(cameraObject, cameraConfigData))
+		return -EINVAL;
+
 	return 0;
 }
 
@@ -145,6 +152,27 @@ int CameraHalConfig::Private::parseRotation(const YamlObject &cameraObject,
 	return 0;
 }
 
+int CameraHalConfig::Private::parsePostProcessingWorkers(const YamlObject &cameraObject,
+							 CameraConfigData &cameraConfigData)
+{
+	if (!cameraObject.contains("post_processing_workers"))
+		return 0;
+
+	/*
+	 * The number of post-processing workers bounds how many frames of a
+	 * stream can be post-processed concurrently.
+	 */
+	uint32_t workers = cameraObject["post_processing_workers"].get<uint32_t>(0);
+	if (workers < 1 || workers > 8) {
+		LOG(HALConfig, Error)
+			<< "Invalid number of post-processing workers: " << workers;
+		return -EINVAL;
+	}
+
+	cameraConfigData.postProcessingWorkers = workers;
+	return 0;
+}
+
 CameraHalConfig::CameraHalConfig()
 	: Extensible(std::make_unique<Private>()), exists_(false), valid_(false)
 {
@@ -57,6 +57,63 @@ CameraMetadata &CameraMetadata::operator=(const CameraMetadata &other)
 	return *this;
 }
 
+/*
+ * \brief Replace the content of the container with a copy of \a other
+ * \param[in] other The metadata to copy
+ *
+ * Unlike the copy assignment operator, the memory of the container is reused
+ * if its capacity is large enough, and the capacity of \a other is preserved
+ * otherwise. This allows filling a metadata pack from a template without any
+ * allocation, and adding entries to it without resizing.
+ *
+ * \return True on success, false otherwise
+ */
+bool CameraMetadata::assign(const CameraMetadata &other)
+{
+	if (this == &other)
+		return valid_;
+
+	const camera_metadata_t *src = other.getMetadata();
+	if (!src) {
+		valid_ = false;
+		return false;
+	}
+
+	size_t entryCapacity = get_camera_metadata_entry_capacity(src);
+	size_t dataCapacity = get_camera_metadata_data_capacity(src);
+
+	if (metadata_ &&
+	    get_camera_metadata_entry_capacity(metadata_) >= entryCapacity &&
+	    get_camera_metadata_data_capacity(metadata_) >= dataCapacity) {
+		/* Empty the container in place, keeping its capacity. */
+		metadata_ = place_camera_metadata(metadata_,
+						  get_camera_metadata_size(metadata_),
+						  get_camera_metadata_entry_capacity(metadata_),
+						  get_camera_metadata_data_capacity(metadata_));
+	} else {
+		if (metadata_)
+			free_camera_metadata(metadata_);
+
+		metadata_ = allocate_camera_metadata(entryCapacity, dataCapacity);
+	}
+
+	valid_ = metadata_ && !append_camera_metadata(metadata_, src);
+	resized_ = false;
+
+	return valid_;
+}
+
+/*
+ * \brief Sort the entries by tag to speed up lookups
+ *
+ * The sorted state is lost when adding entries.
+ */
+void CameraMetadata::sort()
+{
+	if (valid_)
+		sort_camera_metadata(metadata_);
+}
+
 std::tuple<size_t, size_t> CameraMetadata::usage() const
 {
 	size_t currentEntryCount = get_camera_metadata_entry_count(metadata_);
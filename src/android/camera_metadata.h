@@ -23,6 +23,9 @@ public:
 
 	CameraMetadata &operator=(const CameraMetadata &other);
 
+	bool assign(const CameraMetadata &other);
+	void sort();
+
 	std::tuple<size_t, size_t> usage() const;
 	bool resized() const { return resized_; }
 
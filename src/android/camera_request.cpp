@@ -110,6 +110,47 @@ using namespace libcamera;
 
 Camera3RequestDescriptor::Camera3RequestDescriptor(
 	Camera *camera, const camera3_capture_request_t *camera3Request)
+{
+	/*
+	 * Create the CaptureRequest, stored as a unique_ptr<> to tie its
+	 * lifetime to the descriptor. The request is reused along with the
+	 * descriptor, see reuse().
+	 */
+	request_ = camera->createRequest(reinterpret_cast<uint64_t>(this));
+
+	init(camera3Request);
+}
+
+Camera3RequestDescriptor::~Camera3RequestDescriptor() = default;
+
+/*
+ * Reset the descriptor to track a new capture request. Descriptors are
+ * recycled once their capture result has been sent to the framework, to avoid
+ * creating a new libcamera::Request and reallocating the buffers vector for
+ * every capture request.
+ */
+void Camera3RequestDescriptor::reuse(const camera3_capture_request_t *camera3Request)
+{
+	{
+		MutexLocker locker(streamsProcessMutex_);
+		pendingStreamsToProcess_.clear();
+	}
+
+	buffers_.clear();
+	settings_.reset();
+	resultMetadata_.reset();
+	postProcessingMetadata_.reset();
+
+	earlyResultSent_ = false;
+	complete_ = false;
+	status_ = Status::Success;
+
+	request_->reuse();
+
+	init(camera3Request);
+}
+
+void Camera3RequestDescriptor::init(const camera3_capture_request_t *camera3Request)
 {
 	frameNumber_ = camera3Request->frame_number;
 
@@ -128,18 +169,15 @@ Camera3RequestDescriptor::Camera3RequestDescriptor(
 		buffers_.emplace_back(stream, buffer, this);
 	}
 
-	/* Clone the controls associated with the camera3 request. */
-	settings_ = CameraMetadata(camera3Request->settings);
-
 	/*
-	 * Create the CaptureRequest, stored as a unique_ptr<> to tie its
-	 * lifetime to the descriptor.
+	 * Clone the controls associated with the camera3 request. Requests
+	 * without settings share the settings of the previous request, see
+	 * CameraDevice::processCaptureRequest().
 	 */
-	request_ = camera->createRequest(reinterpret_cast<uint64_t>(this));
+	if (camera3Request->settings)
+		settings_ = std::make_shared<const CameraMetadata>(camera3Request->settings);
 }
 
-Camera3RequestDescriptor::~Camera3RequestDescriptor() = default;
-
 /**
  * \struct Camera3RequestDescriptor::StreamBuffer
  * \brief Group information for per-stream buffer of Camera3RequestDescriptor
@@ -160,6 +198,9 @@ Camera3RequestDescriptor::~Camera3RequestDescriptor() = default;
  * \brief Encapsulate the dmabuf handle inside a libcamera::FrameBuffer for
  * direct streams
  *
+ * The frame buffer is owned by the CameraDevice, which caches it for reuse by
+ * later requests for the same buffer.
+ *
  * \var Camera3RequestDescriptor::StreamBuffer::fence
  * \brief Acquire fence of the buffer
  *
@@ -175,8 +216,22 @@ Camera3RequestDescriptor::~Camera3RequestDescriptor() = default;
  * \var Camera3RequestDescriptor::StreamBuffer::dstBuffer
  * \brief Pointer to the destination frame buffer used for post-processing
  *
+ * The buffer mapping is cached by the CameraStream and shared with the
+ * StreamBuffer until the request completes.
+ *
+ * \var Camera3RequestDescriptor::StreamBuffer::dependents
+ * \brief Buffers of other streams produced from the same source in the same
+ * post-processing job
+ *
+ * The dependent buffers are completed by the post-processor along with this
+ * buffer, see CameraStream::groupLeader().
+ *
  * \var Camera3RequestDescriptor::StreamBuffer::request
  * \brief Back pointer to the Camera3RequestDescriptor to which the StreamBuffer belongs
+ *
+ * \var Camera3RequestDescriptor::StreamBuffer::returned
+ * \brief Track if the buffer has been returned to the framework in a capture
+ * result
  */
 Camera3RequestDescriptor::StreamBuffer::StreamBuffer(
 	CameraStream *cameraStream, const camera3_stream_buffer_t &buffer,
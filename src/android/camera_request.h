@@ -45,13 +45,15 @@ public:
 
 		CameraStream *stream;
 		buffer_handle_t *camera3Buffer;
-		std::unique_ptr<HALFrameBuffer> frameBuffer;
+		HALFrameBuffer *frameBuffer = nullptr;
 		libcamera::UniqueFD fence;
 		Status status = Status::Success;
 		libcamera::FrameBuffer *internalBuffer = nullptr;
 		const libcamera::FrameBuffer *srcBuffer = nullptr;
-		std::unique_ptr<CameraBuffer> dstBuffer;
+		std::shared_ptr<CameraBuffer> dstBuffer;
+		std::vector<StreamBuffer *> dependents;
 		Camera3RequestDescriptor *request;
+		bool returned = false;
 
 	private:
 		LIBCAMERA_DISABLE_COPY(StreamBuffer)
@@ -66,19 +68,25 @@ public:
 				 const camera3_capture_request_t *camera3Request);
 	~Camera3RequestDescriptor();
 
+	void reuse(const camera3_capture_request_t *camera3Request);
+
 	bool isPending() const { return !complete_; }
 
 	uint32_t frameNumber_ = 0;
 
 	std::vector<StreamBuffer> buffers_;
 
-	CameraMetadata settings_;
+	std::shared_ptr<const CameraMetadata> settings_;
 	std::unique_ptr<libcamera::Request> request_;
 	std::unique_ptr<CameraMetadata> resultMetadata_;
+	std::unique_ptr<CameraMetadata> postProcessingMetadata_;
 
+	bool earlyResultSent_ = false;
 	bool complete_ = false;
 	Status status_ = Status::Success;
 
 private:
 	LIBCAMERA_DISABLE_COPY(Camera3RequestDescriptor)
+
+	void init(const camera3_capture_request_t *camera3Request);
 };
@@ -7,10 +7,12 @@
 
 #include "camera_stream.h"
 
+#include <algorithm>
 #include <errno.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/poll.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <libcamera/formats.h>
@@ -56,7 +58,7 @@ CameraStream::CameraStream(CameraDevice *const cameraDevice,
 			   CameraStream *const sourceStream, unsigned int index)
 	: cameraDevice_(cameraDevice), config_(config), type_(type),
 	  camera3Stream_(camera3Stream), sourceStream_(sourceStream),
-	  index_(index)
+	  groupLeader_(nullptr), index_(index)
 {
 }
 
@@ -92,40 +94,54 @@ int CameraStream::configure()
 		output.size.width = camera3Stream_->width;
 		output.size.height = camera3Stream_->height;
 
-		switch (outFormat) {
-		case formats::NV12:
-			postProcessor_ = std::make_unique<PostProcessorYuv>();
-			break;
+		/*
+		 * Create one post-processor per request that can be processed
+		 * concurrently, as post-processors are not reentrant.
+		 */
+		unsigned int numProcessors = cameraDevice_->postProcessingWorkers();
+		std::vector<PostProcessor *> processors;
 
-		case formats::MJPEG:
-			postProcessor_ = std::make_unique<PostProcessorJpeg>(cameraDevice_);
-			break;
+		for (unsigned int i = 0; i < numProcessors; ++i) {
+			std::unique_ptr<PostProcessor> postProcessor;
 
-		default:
-			LOG(HAL, Error) << "Unsupported format: " << outFormat;
-			return -EINVAL;
-		}
+			switch (outFormat) {
+			case formats::NV12:
+				postProcessor = std::make_unique<PostProcessorYuv>();
+				break;
 
-		int ret = postProcessor_->configure(configuration(), output);
-		if (ret)
-			return ret;
+			case formats::MJPEG:
+				postProcessor = std::make_unique<PostProcessorJpeg>(cameraDevice_);
+				break;
+
+			default:
+				LOG(HAL, Error) << "Unsupported format: " << outFormat;
+				return -EINVAL;
+			}
 
-		worker_ = std::make_unique<PostProcessorWorker>(postProcessor_.get());
-		postProcessor_->processComplete.connect(
-			this, [&](Camera3RequestDescriptor::StreamBuffer *streamBuffer,
-				  PostProcessor::Status status) {
-				Camera3RequestDescriptor::Status bufferStatus;
+			int ret = postProcessor->configure(configuration(), output);
+			if (ret)
+				return ret;
 
-				if (status == PostProcessor::Status::Success)
-					bufferStatus = Camera3RequestDescriptor::Status::Success;
-				else
-					bufferStatus = Camera3RequestDescriptor::Status::Error;
+			postProcessor->processComplete.connect(
+				this, [&](Camera3RequestDescriptor::StreamBuffer *streamBuffer,
+					  PostProcessor::Status status) {
+					Camera3RequestDescriptor::Status bufferStatus;
 
-				cameraDevice_->streamProcessingComplete(streamBuffer,
-									bufferStatus);
-			});
+					if (status == PostProcessor::Status::Success)
+						bufferStatus = Camera3RequestDescriptor::Status::Success;
+					else
+						bufferStatus = Camera3RequestDescriptor::Status::Error;
 
-		worker_->start();
+					cameraDevice_->streamProcessingComplete(streamBuffer,
+										bufferStatus);
+				});
+
+			processors.push_back(postProcessor.get());
+			postProcessors_.push_back(std::move(postProcessor));
+		}
+
+		postProcessorQueue_ = std::make_unique<PostProcessorQueue>(processors);
+		postProcessorQueue_->start();
 	}
 
 	allocator_ = std::make_unique<PlatformFrameBufferAllocator>(cameraDevice_);
@@ -165,7 +181,20 @@ int CameraStream::waitFence(int fence)
 	return -errno;
 }
 
-int CameraStream::process(Camera3RequestDescriptor::StreamBuffer *streamBuffer)
+/*
+ * Mapped NV12 streams produced from the same source stream are grouped, and
+ * when several of them are part of the same request, they are produced in a
+ * single post-processing job run by the group leader. The buffers of the other
+ * streams are prepared with prepareBuffer() and attached to the leader's
+ * buffer as dependents before it is processed. Streams that are not part of a
+ * group have a null group leader.
+ */
+
+/*
+ * Wait for the acquire fence of the destination buffer and map it, to make it
+ * ready for post-processing.
+ */
+int CameraStream::prepareBuffer(Camera3RequestDescriptor::StreamBuffer *streamBuffer)
 {
 	ASSERT(type_ != Type::Direct);
 
@@ -182,26 +211,92 @@ int CameraStream::process(Camera3RequestDescriptor::StreamBuffer *streamBuffer)
 		streamBuffer->fence.reset();
 	}
 
-	const StreamConfiguration &output = configuration();
-	streamBuffer->dstBuffer = std::make_unique<CameraBuffer>(
-		*streamBuffer->camera3Buffer, output.pixelFormat, output.size,
-		PROT_READ | PROT_WRITE);
-	if (!streamBuffer->dstBuffer->isValid()) {
+	streamBuffer->dstBuffer = mappedBuffer(*streamBuffer->camera3Buffer);
+	if (!streamBuffer->dstBuffer) {
 		LOG(HAL, Error) << "Failed to create destination buffer";
 		return -EINVAL;
 	}
 
-	worker_->queueRequest(streamBuffer);
+	return 0;
+}
+
+int CameraStream::process(Camera3RequestDescriptor::StreamBuffer *streamBuffer)
+{
+	int ret = prepareBuffer(streamBuffer);
+	if (ret)
+		return ret;
+
+	postProcessorQueue_->queueRequest(streamBuffer);
 
 	return 0;
 }
 
+/*
+ * Retrieve the CameraBuffer for a destination buffer handle.
+ *
+ * The framework cycles through a small set of buffers for each stream. Mapping
+ * them on every frame is expensive, so the CameraBuffer instances are cached
+ * for the lifetime of the stream configuration and reused when the same handle
+ * is queued again.
+ *
+ * A handle freed by the framework may be recycled for a new buffer. The cache
+ * entry is only reused if the handle still refers to the same dmabuf, as
+ * identified by the inode of its first file descriptor. The cache size is
+ * bounded to release the mappings of buffers the framework doesn't use anymore.
+ * Evicted buffers stay mapped until the requests that use them complete.
+ *
+ * This function is only called from the thread that completes libcamera
+ * requests, the cache thus doesn't need locking.
+ */
+std::shared_ptr<CameraBuffer> CameraStream::mappedBuffer(buffer_handle_t handle)
+{
+	struct stat st = {};
+	for (int i = 0; i < handle->numFds; i++) {
+		if (handle->data[i] == -1)
+			continue;
+
+		if (fstat(handle->data[i], &st) < 0)
+			return nullptr;
+		break;
+	}
+
+	for (auto it = mappedBuffers_.begin(); it != mappedBuffers_.end(); ++it) {
+		if (it->handle != handle)
+			continue;
+
+		if (it->device == st.st_dev && it->inode == st.st_ino) {
+			mappedBuffers_.splice(mappedBuffers_.begin(),
+					      mappedBuffers_, it);
+			return it->buffer;
+		}
+
+		/* The handle has been recycled, drop the stale mapping. */
+		mappedBuffers_.erase(it);
+		break;
+	}
+
+	const StreamConfiguration &output = configuration();
+	auto buffer = std::make_shared<CameraBuffer>(handle, output.pixelFormat,
+						     output.size,
+						     PROT_READ | PROT_WRITE);
+	if (!buffer->isValid())
+		return nullptr;
+
+	const size_t maxBuffers = std::max(2 * camera3Stream_->max_buffers, 4u);
+	if (mappedBuffers_.size() >= maxBuffers)
+		mappedBuffers_.pop_back();
+
+	mappedBuffers_.push_front({ handle, st.st_dev, st.st_ino, buffer });
+
+	return buffer;
+}
+
 void CameraStream::flush()
 {
-	if (!postProcessor_)
+	if (!postProcessorQueue_)
 		return;
 
-	worker_->flush();
+	postProcessorQueue_->flush();
 }
 
 FrameBuffer *CameraStream::getBuffer()
@@ -243,99 +338,3 @@ void CameraStream::putBuffer(FrameBuffer *buffer)
 
 	buffers_.push_back(buffer);
 }
-
-/**
- * \class CameraStream::PostProcessorWorker
- * \brief Post-process a CameraStream in an internal thread
- *
- * If the association between CameraStream and camera3_stream_t dictated by
- * CameraStream::Type is internal or mapped, the stream is generated by post
- * processing of a libcamera stream. Such a request is queued to a
- * PostProcessorWorker in CameraStream::process(). A queue of post-processing
- * requests is maintained by the PostProcessorWorker and it will run the
- * post-processing on an internal thread as soon as any request is available on
- * its queue.
- */
-CameraStream::PostProcessorWorker::PostProcessorWorker(PostProcessor *postProcessor)
-	: postProcessor_(postProcessor)
-{
-}
-
-CameraStream::PostProcessorWorker::~PostProcessorWorker()
-{
-	{
-		MutexLocker lock(mutex_);
-		state_ = State::Stopped;
-	}
-
-	cv_.notify_one();
-	wait();
-}
-
-void CameraStream::PostProcessorWorker::start()
-{
-	{
-		MutexLocker lock(mutex_);
-		ASSERT(state_ != State::Running);
-		state_ = State::Running;
-	}
-
-	Thread::start();
-}
-
-void CameraStream::PostProcessorWorker::queueRequest(Camera3RequestDescriptor::StreamBuffer *dest)
-{
-	{
-		MutexLocker lock(mutex_);
-		ASSERT(state_ == State::Running);
-		requests_.push(dest);
-	}
-
-	cv_.notify_one();
-}
-
-void CameraStream::PostProcessorWorker::run()
-{
-	MutexLocker locker(mutex_);
-
-	while (1) {
-		cv_.wait(locker, [&]() LIBCAMERA_TSA_REQUIRES(mutex_) {
-			return state_ != State::Running || !requests_.empty();
-		});
-
-		if (state_ != State::Running)
-			break;
-
-		Camera3RequestDescriptor::StreamBuffer *streamBuffer = requests_.front();
-		requests_.pop();
-		locker.unlock();
-
-		postProcessor_->process(streamBuffer);
-
-		locker.lock();
-	}
-
-	if (state_ == State::Flushing) {
-		std::queue<Camera3RequestDescriptor::StreamBuffer *> requests =
-			std::move(requests_);
-		locker.unlock();
-
-		while (!requests.empty()) {
-			postProcessor_->processComplete.emit(
-				requests.front(), PostProcessor::Status::Error);
-			requests.pop();
-		}
-
-		locker.lock();
-		state_ = State::Stopped;
-	}
-}
-
-void CameraStream::PostProcessorWorker::flush()
-{
-	MutexLocker lock(mutex_);
-	state_ = State::Flushing;
-	lock.unlock();
-
-	cv_.notify_one();
-}
@@ -7,14 +7,15 @@
 
 #pragma once
 
+#include <list>
 #include <memory>
-#include <queue>
 #include <vector>
 
+#include <sys/types.h>
+
 #include <hardware/camera3.h>
 
 #include <libcamera/base/mutex.h>
-#include <libcamera/base/thread.h>
 
 #include <libcamera/camera.h>
 #include <libcamera/framebuffer.h>
@@ -23,6 +24,7 @@
 
 #include "camera_request.h"
 #include "post_processor.h"
+#include "post_processor_pool.h"
 
 class CameraDevice;
 class PlatformFrameBufferAllocator;
@@ -125,52 +127,33 @@ public:
 	const libcamera::StreamConfiguration &configuration() const;
 	libcamera::Stream *stream() const;
 	CameraStream *sourceStream() const { return sourceStream_; }
+	CameraStream *groupLeader() const { return groupLeader_; }
+	void setGroupLeader(CameraStream *leader) { groupLeader_ = leader; }
 
 	int configure();
+	int prepareBuffer(Camera3RequestDescriptor::StreamBuffer *streamBuffer);
 	int process(Camera3RequestDescriptor::StreamBuffer *streamBuffer);
 	libcamera::FrameBuffer *getBuffer();
 	void putBuffer(libcamera::FrameBuffer *buffer);
 	void flush();
 
 private:
-	class PostProcessorWorker : public libcamera::Thread
-	{
-	public:
-		enum class State {
-			Stopped,
-			Running,
-			Flushing,
-		};
-
-		PostProcessorWorker(PostProcessor *postProcessor);
-		~PostProcessorWorker();
-
-		void start();
-		void queueRequest(Camera3RequestDescriptor::StreamBuffer *request);
-		void flush();
-
-	protected:
-		void run() override;
-
-	private:
-		PostProcessor *postProcessor_;
-
-		libcamera::Mutex mutex_;
-		libcamera::ConditionVariable cv_;
-
-		std::queue<Camera3RequestDescriptor::StreamBuffer *> requests_
-			LIBCAMERA_TSA_GUARDED_BY(mutex_);
-
-		State state_ LIBCAMERA_TSA_GUARDED_BY(mutex_) = State::Stopped;
+	struct CachedBuffer {
+		buffer_handle_t handle;
+		dev_t device;
+		ino_t inode;
+		std::shared_ptr<CameraBuffer> buffer;
 	};
 
 	int waitFence(int fence);
+	std::shared_ptr<CameraBuffer> mappedBuffer(buffer_handle_t handle);
 
 	CameraDevice *const cameraDevice_;
 	const libcamera::CameraConfiguration *config_;
 	const Type type_;
 	camera3_stream_t *camera3Stream_;
 	CameraStream *const sourceStream_;
+	CameraStream *groupLeader_;
 	const unsigned int index_;
 
 	std::unique_ptr<PlatformFrameBufferAllocator> allocator_;
@@ -181,7 +164,11 @@ private:
 	 * an std::vector in CameraDevice.
 	 */
 	std::unique_ptr<libcamera::Mutex> mutex_;
-	std::unique_ptr<PostProcessor> postProcessor_;
 
-	std::unique_ptr<PostProcessorWorker> worker_;
+	/* Destination buffers mappings, most recently used first. */
+	std::list<CachedBuffer> mappedBuffers_;
+
+	std::vector<std::unique_ptr<PostProcessor>> postProcessors_;
+
+	std::unique_ptr<PostProcessorQueue> postProcessorQueue_;
 };
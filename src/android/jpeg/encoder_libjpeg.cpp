@@ -7,6 +7,8 @@
 
 #include "encoder_libjpeg.h"
 
+#include <algorithm>
+#include <atomic>
 #include <fcntl.h>
 #include <iomanip>
 #include <iostream>
@@ -15,12 +17,19 @@
 #include <unistd.h>
 #include <vector>
 
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <libcamera/base/log.h>
 
 #include <libcamera/camera.h>
 #include <libcamera/formats.h>
 #include <libcamera/pixel_format.h>
 
+#include "libcamera/internal/dma_buf_allocator.h"
 #include "libcamera/internal/formats.h"
 #include "libcamera/internal/mapped_framebuffer.h"
 
@@ -68,9 +77,45 @@ const struct JPEGPixelFormatInfo &findPixelInfo(const PixelFormat &format)
 	return iter->second;
 }
 
+/*
+ * Split a row of interleaved chroma samples into separate planar rows. The
+ * count is the number of samples written to each output row.
+ */
+void deinterleaveRow(const uint8_t *src, uint8_t *dst0, uint8_t *dst1,
+		     unsigned int count)
+{
+#if defined(__ARM_NEON)
+	for (; count >= 16; count -= 16, src += 32, dst0 += 16, dst1 += 16) {
+		uint8x16x2_t in = vld2q_u8(src);
+		vst1q_u8(dst0, in.val[0]);
+		vst1q_u8(dst1, in.val[1]);
+	}
+#elif defined(__SSE2__)
+	const __m128i mask = _mm_set1_epi16(0x00ff);
+
+	for (; count >= 16; count -= 16, src += 32, dst0 += 16, dst1 += 16) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16));
+		__m128i even = _mm_packus_epi16(_mm_and_si128(a, mask),
+						_mm_and_si128(b, mask));
+		__m128i odd = _mm_packus_epi16(_mm_srli_epi16(a, 8),
+					       _mm_srli_epi16(b, 8));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst0), even);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst1), odd);
+	}
+#endif
+
+	for (; count; count--, src += 2) {
+		*dst0++ = src[0];
+		*dst1++ = src[1];
+	}
+}
+
 } /* namespace */
 
 EncoderLibJpeg::EncoderLibJpeg()
+	: pool_(PostProcessorPool::instance())
 {
 	/* \todo Expand error handling coverage with a custom handler. */
 	compress_.err = jpeg_std_error(&jerr_);
@@ -89,33 +134,67 @@ int EncoderLibJpeg::configure(const StreamConfiguration &cfg)
 	if (info.colorSpace == JCS_UNKNOWN)
 		return -ENOTSUP;
 
-	compress_.image_width = cfg.size.width;
-	compress_.image_height = cfg.size.height;
-	compress_.in_color_space = info.colorSpace;
-
-	compress_.input_components = info.colorSpace == JCS_GRAYSCALE ? 1 : 3;
-
-	jpeg_set_defaults(&compress_);
-
 	pixelFormatInfo_ = &info.pixelFormatInfo;
 
+	colorSpace_ = info.colorSpace;
 	nv_ = pixelFormatInfo_->numPlanes() == 2;
 	nvSwap_ = info.nvSwap;
 
+	/*
+	 * Feed 4:2:0 formats to libjpeg as raw downsampled data, which
+	 * avoids the colour conversion and downsampling stages entirely. The
+	 * raw data path requires the chroma width to be a multiple of the DCT
+	 * block size, other sizes use the scanline path.
+	 */
+	raw_ = false;
+	if (nv_) {
+		unsigned int c_stride = pixelFormatInfo_->stride(cfg.size.width, 1);
+		unsigned int horzSubSample = 2 * cfg.size.width / c_stride;
+		unsigned int vertSubSample = pixelFormatInfo_->planes[1].verticalSubSampling;
+
+		raw_ = horzSubSample == 2 && vertSubSample == 2 &&
+		       cfg.size.width % (2 * DCTSIZE) == 0;
+	}
+
+	setupCompress(&compress_, cfg.size.width, cfg.size.height);
+
 	return 0;
 }
 
-void EncoderLibJpeg::compressRGB(const std::vector<Span<uint8_t>> &planes)
+void EncoderLibJpeg::setupCompress(struct jpeg_compress_struct *compress,
+				   unsigned int width, unsigned int height)
+{
+	compress->image_width = width;
+	compress->image_height = height;
+	compress->in_color_space = colorSpace_;
+
+	compress->input_components = colorSpace_ == JCS_GRAYSCALE ? 1 : 3;
+
+	jpeg_set_defaults(compress);
+
+	if (raw_) {
+		compress->raw_data_in = TRUE;
+		compress->comp_info[0].h_samp_factor = 2;
+		compress->comp_info[0].v_samp_factor = 2;
+		compress->comp_info[1].h_samp_factor = 1;
+		compress->comp_info[1].v_samp_factor = 1;
+		compress->comp_info[2].h_samp_factor = 1;
+		compress->comp_info[2].v_samp_factor = 1;
+	}
+}
+
+void EncoderLibJpeg::compressRGB(struct jpeg_compress_struct *compress,
+				 const std::vector<Span<uint8_t>> &planes)
 {
 	unsigned char *src = const_cast<unsigned char *>(planes[0].data());
 	/* \todo Stride information should come from buffer configuration. */
-	unsigned int stride = pixelFormatInfo_->stride(compress_.image_width, 0);
+	unsigned int stride = pixelFormatInfo_->stride(compress->image_width, 0);
 
 	JSAMPROW row_pointer[1];
 
-	while (compress_.next_scanline < compress_.image_height) {
-		row_pointer[0] = &src[compress_.next_scanline * stride];
-		jpeg_write_scanlines(&compress_, row_pointer, 1);
+	while (compress->next_scanline < compress->image_height) {
+		row_pointer[0] = &src[compress->next_scanline * stride];
+		jpeg_write_scanlines(compress, row_pointer, 1);
 	}
 }
 
@@ -123,22 +202,19 @@ void EncoderLibJpeg::compressRGB(const std::vector<Span<uint8_t>> &planes)
  * Compress the incoming buffer from a supported NV format.
  * This naively unpacks the semi-planar NV12 to a YUV888 format for libjpeg.
  */
-void EncoderLibJpeg::compressNV(const std::vector<Span<uint8_t>> &planes)
+void EncoderLibJpeg::compressNV(struct jpeg_compress_struct *compress,
+				const std::vector<Span<uint8_t>> &planes)
 {
-	uint8_t tmprowbuf[compress_.image_width * 3];
+	uint8_t tmprowbuf[compress->image_width * 3];
 
 	/*
-	 * \todo Use the raw api, and only unpack the cb/cr samples to new line
-	 * buffers. If possible, see if we can set appropriate pixel strides
-	 * too to save even that copy.
-	 *
-	 * Possible hints at:
-	 * https://sourceforge.net/p/libjpeg/mailman/message/30815123/
+	 * \todo Extend the raw data path to 4:2:2 and 4:4:4 formats, and to
+	 * image widths that are not a multiple of the MCU width.
 	 */
-	unsigned int y_stride = pixelFormatInfo_->stride(compress_.image_width, 0);
-	unsigned int c_stride = pixelFormatInfo_->stride(compress_.image_width, 1);
+	unsigned int y_stride = pixelFormatInfo_->stride(compress->image_width, 0);
+	unsigned int c_stride = pixelFormatInfo_->stride(compress->image_width, 1);
 
-	unsigned int horzSubSample = 2 * compress_.image_width / c_stride;
+	unsigned int horzSubSample = 2 * compress->image_width / c_stride;
 	unsigned int vertSubSample = pixelFormatInfo_->planes[1].verticalSubSampling;
 
 	unsigned int c_inc = horzSubSample == 1 ? 2 : 0;
@@ -151,14 +227,14 @@ void EncoderLibJpeg::compressNV(const std::vector<Span<uint8_t>> &planes)
 	JSAMPROW row_pointer[1];
 	row_pointer[0] = &tmprowbuf[0];
 
-	for (unsigned int y = 0; y < compress_.image_height; y++) {
+	for (unsigned int y = 0; y < compress->image_height; y++) {
 		unsigned char *dst = &tmprowbuf[0];
 
 		const unsigned char *src_y = src + y * y_stride;
 		const unsigned char *src_cb = src_c + (y / vertSubSample) * c_stride + cb_pos;
 		const unsigned char *src_cr = src_c + (y / vertSubSample) * c_stride + cr_pos;
 
-		for (unsigned int x = 0; x < compress_.image_width; x += 2) {
+		for (unsigned int x = 0; x < compress->image_width; x += 2) {
 			dst[0] = *src_y;
 			dst[1] = *src_cb;
 			dst[2] = *src_cr;
@@ -176,7 +252,64 @@ void EncoderLibJpeg::compressNV(const std::vector<Span<uint8_t>> &planes)
 			dst += 3;
 		}
 
-		jpeg_write_scanlines(&compress_, row_pointer, 1);
+		jpeg_write_scanlines(compress, row_pointer, 1);
+	}
+}
+
+/*
+ * Compress the incoming buffer from a 4:2:0 NV format using the libjpeg raw
+ * data API. The luma rows are passed to libjpeg in place, and only the chroma
+ * samples are deinterleaved to planar line buffers, one MCU row at a time.
+ */
+void EncoderLibJpeg::compressNVRaw(struct jpeg_compress_struct *compress,
+				   const std::vector<Span<uint8_t>> &planes)
+{
+	unsigned int width = compress->image_width;
+	unsigned int height = compress->image_height;
+	unsigned int c_width = width / 2;
+	unsigned int c_height = (height + 1) / 2;
+
+	unsigned int y_stride = pixelFormatInfo_->stride(width, 0);
+	unsigned int c_stride = pixelFormatInfo_->stride(width, 1);
+
+	const unsigned char *src = planes[0].data();
+	const unsigned char *src_c = planes[1].data();
+
+	std::vector<uint8_t> cbBuffer(c_width * DCTSIZE);
+	std::vector<uint8_t> crBuffer(c_width * DCTSIZE);
+
+	JSAMPROW yRows[2 * DCTSIZE];
+	JSAMPROW cbRows[DCTSIZE];
+	JSAMPROW crRows[DCTSIZE];
+	JSAMPARRAY data[3] = { yRows, cbRows, crRows };
+
+	for (unsigned int i = 0; i < DCTSIZE; i++) {
+		cbRows[i] = &cbBuffer[i * c_width];
+		crRows[i] = &crBuffer[i * c_width];
+	}
+
+	JSAMPROW *firstRows = nvSwap_ ? crRows : cbRows;
+	JSAMPROW *secondRows = nvSwap_ ? cbRows : crRows;
+
+	while (compress->next_scanline < height) {
+		unsigned int y = compress->next_scanline;
+
+		/*
+		 * Replicate the last line to pad the image to a multiple of the
+		 * MCU height.
+		 */
+		for (unsigned int i = 0; i < 2 * DCTSIZE; i++) {
+			unsigned int line = std::min(y + i, height - 1);
+			yRows[i] = const_cast<JSAMPROW>(src + line * y_stride);
+		}
+
+		for (unsigned int i = 0; i < DCTSIZE; i++) {
+			unsigned int line = std::min(y / 2 + i, c_height - 1);
+			deinterleaveRow(src_c + line * c_stride, firstRows[i],
+					secondRows[i], c_width);
+		}
+
+		jpeg_write_raw_data(compress, data, 2 * DCTSIZE);
 	}
 }
 
@@ -192,14 +325,38 @@ int EncoderLibJpeg::encode(Camera3RequestDescriptor::StreamBuffer *buffer,
 		return frame.error();
 	}
 
+	std::vector<DmaSyncer> syncers;
+	for (const FrameBuffer::Plane &plane : buffer->srcBuffer->planes())
+		syncers.emplace_back(plane.fd, DmaSyncer::SyncType::Read);
+
 	return encode(frame.planes(), buffer->dstBuffer->plane(0),
 		      exifData, quality);
 }
 
+void EncoderLibJpeg::compress(struct jpeg_compress_struct *compress,
+			      const std::vector<Span<uint8_t>> &planes)
+{
+	if (raw_)
+		compressNVRaw(compress, planes);
+	else if (nv_)
+		compressNV(compress, planes);
+	else
+		compressRGB(compress, planes);
+}
+
 int EncoderLibJpeg::encode(const std::vector<Span<uint8_t>> &src,
 			   Span<uint8_t> dest, Span<const uint8_t> exifData,
 			   unsigned int quality)
 {
+	ASSERT(src.size() == pixelFormatInfo_->numPlanes());
+
+	LOG(JPEG, Debug) << "JPEG Encode Starting:" << compress_.image_width
+			 << "x" << compress_.image_height;
+
+	unsigned int stripHeight = this->stripHeight();
+	if (stripHeight)
+		return encodeStrips(src, dest, exifData, quality, stripHeight);
+
 	unsigned char *destination = dest.data();
 	unsigned long size = dest.size();
 
@@ -223,17 +380,204 @@ int EncoderLibJpeg::encode(const std::vector<Span<uint8_t>> &src,
 				  static_cast<const JOCTET *>(exifData.data()),
 				  exifData.size());
 
-	LOG(JPEG, Debug) << "JPEG Encode Starting:" << compress_.image_width
-			 << "x" << compress_.image_height;
-
-	ASSERT(src.size() == pixelFormatInfo_->numPlanes());
-
-	if (nv_)
-		compressNV(src);
-	else
-		compressRGB(src);
+	compress(&compress_, src);
 
 	jpeg_finish_compress(&compress_);
 
 	return size;
 }
+
+/*
+ * Compute the height of the strips to encode the image in parallel, or 0 if
+ * the image is too small to benefit from parallel encoding.
+ *
+ * Strips span a multiple of 8 MCU rows, to simplify renumbering of the
+ * restart markers when stitching them (see encodeStrips()).
+ */
+unsigned int EncoderLibJpeg::stripHeight() const
+{
+	/*
+	 * Strips are encoded by the post-processing threads, sized according
+	 * to the number of CPUs. The caller is usually one of them.
+	 */
+	unsigned int numThreads = pool_->threads().threads();
+	if (numThreads < 2)
+		return 0;
+
+	unsigned int mcuHeight = compress_.comp_info[0].v_samp_factor * DCTSIZE;
+	unsigned int unitHeight = mcuHeight * kRestartMarkers;
+	unsigned int units = (compress_.image_height + unitHeight - 1) / unitHeight;
+	unsigned int numStrips = std::min({ numThreads, units,
+					    compress_.image_height / kMinStripLines });
+	if (numStrips < 2)
+		return 0;
+
+	unsigned int unitsPerStrip = (units + numStrips - 1) / numStrips;
+
+	return unitsPerStrip * unitHeight;
+}
+
+/*
+ * Encode lines [firstLine, firstLine + lines[ of the image as a standalone
+ * JPEG image with a restart marker after every MCU row. The output buffer is
+ * allocated by libjpeg and must be freed by the caller.
+ */
+void EncoderLibJpeg::encodeStrip(const std::vector<Span<uint8_t>> &src,
+				 unsigned int firstLine, unsigned int lines,
+				 Span<const uint8_t> exifData, unsigned int quality,
+				 unsigned char **output, unsigned long *size)
+{
+	struct jpeg_compress_struct compress;
+	struct jpeg_error_mgr jerr;
+
+	compress.err = jpeg_std_error(&jerr);
+	jpeg_create_compress(&compress);
+
+	setupCompress(&compress, compress_.image_width, lines);
+	jpeg_set_quality(&compress, quality, TRUE);
+	compress.restart_in_rows = 1;
+
+	*output = nullptr;
+	*size = 0;
+	jpeg_mem_dest(&compress, output, size);
+
+	jpeg_start_compress(&compress, TRUE);
+
+	if (exifData.size())
+		jpeg_write_marker(&compress, JPEG_APP0 + 1,
+				  static_cast<const JOCTET *>(exifData.data()),
+				  exifData.size());
+
+	std::vector<Span<uint8_t>> planes;
+	for (unsigned int i = 0; i < src.size(); i++) {
+		unsigned int stride = pixelFormatInfo_->stride(compress_.image_width, i);
+		unsigned int line = firstLine / pixelFormatInfo_->planes[i].verticalSubSampling;
+
+		planes.push_back(src[i].subspan(line * stride));
+	}
+
+	this->compress(&compress, planes);
+
+	jpeg_finish_compress(&compress);
+	jpeg_destroy_compress(&compress);
+}
+
+/*
+ * Encode the image in horizontal strips on multiple threads, and stitch the
+ * strips in a single JPEG image.
+ *
+ * Each strip is encoded as a standalone image with a restart interval of one
+ * MCU row. As the DC predictors are reset at restart markers, the entropy
+ * coded data of the strips can be concatenated, separated by restart
+ * markers. Restart markers are numbered modulo 8, and strips span a multiple
+ * of 8 MCU rows, so the marker between two strips is always RST7 and the
+ * markers within the strips don't need to be renumbered.
+ *
+ * The headers of the first strip, which include the Exif data, are used for
+ * the whole image, with the image height patched in the frame header.
+ */
+int EncoderLibJpeg::encodeStrips(const std::vector<Span<uint8_t>> &src,
+				 Span<uint8_t> dest, Span<const uint8_t> exifData,
+				 unsigned int quality, unsigned int stripHeight)
+{
+	struct Strip {
+		~Strip() { free(data); }
+
+		unsigned char *data = nullptr;
+		unsigned long size = 0;
+	};
+
+	unsigned int height = compress_.image_height;
+	unsigned int numStrips = (height + stripHeight - 1) / stripHeight;
+	std::vector<Strip> strips(numStrips);
+	std::atomic<unsigned int> next = 0;
+
+	auto worker = [&]() {
+		unsigned int index;
+
+		while ((index = next.fetch_add(1, std::memory_order_relaxed)) < numStrips) {
+			unsigned int firstLine = index * stripHeight;
+			unsigned int lines = std::min(stripHeight, height - firstLine);
+
+			encodeStrip(src, firstLine, lines,
+				    index == 0 ? exifData : Span<const uint8_t>{},
+				    quality, &strips[index].data,
+				    &strips[index].size);
+		}
+	};
+
+	pool_->threads().runStrips([&]([[maybe_unused]] unsigned int index,
+				       [[maybe_unused]] unsigned int count) {
+		worker();
+	});
+
+	/*
+	 * Locate the entropy coded data of each strip, which starts after the
+	 * SOS segment and ends with the EOI marker.
+	 */
+	std::vector<Span<const uint8_t>> scans;
+	unsigned long headerSize = 0;
+	unsigned long sofOffset = 0;
+	size_t total = 0;
+
+	for (const Strip &strip : strips) {
+		unsigned long offset = 2;
+
+		while (offset + 4 <= strip.size && strip.data[offset] == 0xff) {
+			uint8_t marker = strip.data[offset + 1];
+			unsigned long length = (strip.data[offset + 2] << 8) |
+					       strip.data[offset + 3];
+
+			if (scans.empty() &&
+			    (marker == 0xc0 || marker == 0xc1 || marker == 0xc2))
+				sofOffset = offset;
+
+			offset += 2 + length;
+			if (marker == 0xda)
+				break;
+		}
+
+		if (offset + 2 > strip.size ||
+		    strip.data[strip.size - 2] != 0xff ||
+		    strip.data[strip.size - 1] != 0xd9) {
+			LOG(JPEG, Error) << "Malformed JPEG strip";
+			return -EINVAL;
+		}
+
+		if (scans.empty())
+			headerSize = offset;
+
+		scans.push_back({ strip.data + offset, strip.size - 2 - offset });
+		total += scans.back().size() + 2;
+	}
+
+	total += headerSize;
+	if (total > dest.size()) {
+		LOG(JPEG, Error)
+			<< "JPEG image size " << total
+			<< " exceeds the destination buffer size " << dest.size();
+		return -ENOSPC;
+	}
+
+	uint8_t *out = dest.data();
+
+	memcpy(out, strips[0].data, headerSize);
+	out[sofOffset + 5] = height >> 8;
+	out[sofOffset + 6] = height & 0xff;
+	out += headerSize;
+
+	for (unsigned int i = 0; i < scans.size(); i++) {
+		if (i) {
+			*out++ = 0xff;
+			*out++ = JPEG_RST0 + kRestartMarkers - 1;
+		}
+
+		memcpy(out, scans[i].data(), scans[i].size());
+		out += scans[i].size();
+	}
+
+	*out++ = 0xff;
+	*out++ = JPEG_EOI;
+
+	return total;
+}
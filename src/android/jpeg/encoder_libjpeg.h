@@ -9,10 +9,13 @@
 
 #include "encoder.h"
 
+#include <memory>
 #include <vector>
 
 #include "libcamera/internal/formats.h"
 
+#include "../post_processor_pool.h"
+
 #include <jpeglib.h>
 
 class EncoderLibJpeg : public Encoder
@@ -31,14 +34,41 @@ public:
 		   unsigned int quality);
 
 private:
-	void compressRGB(const std::vector<libcamera::Span<uint8_t>> &planes);
-	void compressNV(const std::vector<libcamera::Span<uint8_t>> &planes);
+	static constexpr unsigned int kMinStripLines = 256;
+	static constexpr unsigned int kRestartMarkers = 8;
+
+	void setupCompress(struct jpeg_compress_struct *compress,
+			   unsigned int width, unsigned int height);
+
+	void compress(struct jpeg_compress_struct *compress,
+		      const std::vector<libcamera::Span<uint8_t>> &planes);
+	void compressRGB(struct jpeg_compress_struct *compress,
+			 const std::vector<libcamera::Span<uint8_t>> &planes);
+	void compressNV(struct jpeg_compress_struct *compress,
+			const std::vector<libcamera::Span<uint8_t>> &planes);
+	void compressNVRaw(struct jpeg_compress_struct *compress,
+			   const std::vector<libcamera::Span<uint8_t>> &planes);
+
+	unsigned int stripHeight() const;
+	void encodeStrip(const std::vector<libcamera::Span<uint8_t>> &src,
+			 unsigned int firstLine, unsigned int lines,
+			 libcamera::Span<const uint8_t> exifData,
+			 unsigned int quality, unsigned char **output,
+			 unsigned long *size);
+	int encodeStrips(const std::vector<libcamera::Span<uint8_t>> &src,
+			 libcamera::Span<uint8_t> dest,
+			 libcamera::Span<const uint8_t> exifData,
+			 unsigned int quality, unsigned int stripHeight);
 
 	struct jpeg_compress_struct compress_;
 	struct jpeg_error_mgr jerr_;
 
 	const libcamera::PixelFormatInfo *pixelFormatInfo_;
 
+	J_COLOR_SPACE colorSpace_;
 	bool nv_;
 	bool nvSwap_;
+	bool raw_;
+
+	std::shared_ptr<PostProcessorPool> pool_;
 };
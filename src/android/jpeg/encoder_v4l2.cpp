@@ -0,0 +1,490 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * encoder_v4l2.cpp - JPEG encoding using a V4L2 memory-to-memory encoder
+ */
+
+#include "encoder_v4l2.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <linux/videodev2.h>
+
+#include <libcamera/base/log.h>
+
+#include <libcamera/formats.h>
+
+#include "../camera_buffer.h"
+
+using namespace libcamera;
+
+LOG_DECLARE_CATEGORY(JPEG)
+
+namespace {
+
+/* Time to wait for the encoder to complete a frame. */
+constexpr int kEncodeTimeoutMs = 1000;
+
+int xioctl(int fd, unsigned long request, void *arg)
+{
+	int ret;
+
+	do {
+		ret = ioctl(fd, request, arg);
+	} while (ret < 0 && errno == EINTR);
+
+	return ret < 0 ? -errno : 0;
+}
+
+bool hasFormat(int fd, uint32_t type, uint32_t pixelformat)
+{
+	struct v4l2_fmtdesc desc = {};
+	desc.type = type;
+
+	for (desc.index = 0; !xioctl(fd, VIDIOC_ENUM_FMT, &desc); desc.index++) {
+		if (desc.pixelformat == pixelformat)
+			return true;
+	}
+
+	return false;
+}
+
+} /* namespace */
+
+/*
+ * The V4L2 encoder drives a memory-to-memory JPEG encoder, such as the Hantro
+ * or i.MX8 JPEG encoders, through the multi-planar V4L2 API. The source frame
+ * is imported as a dmabuf and read by the device directly, while the JPEG
+ * bitstream is captured to a single mmap()ed buffer and copied to the
+ * destination buffer with the Exif data inserted.
+ *
+ * The encoder is driven synchronously with raw ioctls, as it runs in the post
+ * processor worker thread which has no event loop to dispatch buffer
+ * completion events from a V4L2VideoDevice.
+ */
+
+EncoderV4L2::EncoderV4L2()
+	: sourcePlanes_(0), quality_(-1), jpeg_(nullptr), jpegLength_(0)
+{
+}
+
+EncoderV4L2::~EncoderV4L2()
+{
+	releaseBuffers();
+}
+
+/*
+ * Locate a usable encoder device. The probe is performed once, the first time
+ * an encoder is configured.
+ */
+const std::string &EncoderV4L2::deviceNode()
+{
+	static const std::string node = probeDevices();
+	return node;
+}
+
+std::string EncoderV4L2::probeDevices()
+{
+	DIR *dir = opendir("/dev");
+	if (!dir)
+		return {};
+
+	std::string node;
+	struct dirent *ent;
+
+	while ((ent = readdir(dir)) != nullptr) {
+		if (strncmp(ent->d_name, "video", 5))
+			continue;
+
+		std::string path = std::string("/dev/") + ent->d_name;
+		UniqueFD fd(::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC));
+		if (!fd.isValid())
+			continue;
+
+		struct v4l2_capability caps = {};
+		if (xioctl(fd.get(), VIDIOC_QUERYCAP, &caps))
+			continue;
+
+		uint32_t deviceCaps = caps.capabilities & V4L2_CAP_DEVICE_CAPS
+				    ? caps.device_caps : caps.capabilities;
+		if (!(deviceCaps & V4L2_CAP_VIDEO_M2M_MPLANE) ||
+		    !(deviceCaps & V4L2_CAP_STREAMING))
+			continue;
+
+		if (!hasFormat(fd.get(), V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE,
+			       V4L2_PIX_FMT_JPEG))
+			continue;
+
+		if (!hasFormat(fd.get(), V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+			       V4L2_PIX_FMT_NV12) &&
+		    !hasFormat(fd.get(), V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+			       V4L2_PIX_FMT_NV12M))
+			continue;
+
+		LOG(JPEG, Info)
+			<< "Using V4L2 JPEG encoder " << path << " ("
+			<< reinterpret_cast<const char *>(caps.card) << ")";
+		node = path;
+		break;
+	}
+
+	closedir(dir);
+
+	if (node.empty())
+		LOG(JPEG, Debug) << "No V4L2 JPEG encoder found";
+
+	return node;
+}
+
+int EncoderV4L2::configure(const StreamConfiguration &cfg)
+{
+	if (cfg.pixelFormat != formats::NV12)
+		return -ENOTSUP;
+
+	const std::string &node = deviceNode();
+	if (node.empty())
+		return -ENODEV;
+
+	releaseBuffers();
+
+	fd_ = UniqueFD(::open(node.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC));
+	if (!fd_.isValid()) {
+		int ret = -errno;
+		LOG(JPEG, Error)
+			<< "Failed to open " << node << ": " << strerror(-ret);
+		return ret;
+	}
+
+	int ret = setFormats(cfg);
+	if (!ret)
+		ret = allocateBuffers();
+	if (ret) {
+		releaseBuffers();
+		return ret;
+	}
+
+	quality_ = -1;
+
+	return 0;
+}
+
+int EncoderV4L2::setFormats(const StreamConfiguration &cfg)
+{
+	/*
+	 * Prefer the contiguous NV12 format, which matches the layout of the
+	 * buffers allocated by libcamera, and fall back to NV12M.
+	 */
+	struct v4l2_format format = {};
+	format.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+
+	struct v4l2_pix_format_mplane &pix = format.fmt.pix_mp;
+	pix.width = cfg.size.width;
+	pix.height = cfg.size.height;
+	pix.field = V4L2_FIELD_NONE;
+
+	if (hasFormat(fd_.get(), format.type, V4L2_PIX_FMT_NV12)) {
+		pix.pixelformat = V4L2_PIX_FMT_NV12;
+		pix.num_planes = 1;
+	} else {
+		pix.pixelformat = V4L2_PIX_FMT_NV12M;
+		pix.num_planes = 2;
+		pix.plane_fmt[1].bytesperline = cfg.stride;
+	}
+	pix.plane_fmt[0].bytesperline = cfg.stride;
+
+	int ret = xioctl(fd_.get(), VIDIOC_S_FMT, &format);
+	if (ret) {
+		LOG(JPEG, Error) << "Failed to set source format: " << strerror(-ret);
+		return ret;
+	}
+
+	if (pix.width != cfg.size.width || pix.height != cfg.size.height ||
+	    pix.plane_fmt[0].bytesperline != cfg.stride) {
+		LOG(JPEG, Debug)
+			<< "Encoder doesn't support " << cfg.size << " with stride "
+			<< cfg.stride;
+		return -ENOTSUP;
+	}
+
+	sourcePlanes_ = pix.num_planes;
+
+	format = {};
+	format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	pix.width = cfg.size.width;
+	pix.height = cfg.size.height;
+	pix.pixelformat = V4L2_PIX_FMT_JPEG;
+	pix.field = V4L2_FIELD_NONE;
+	pix.num_planes = 1;
+
+	ret = xioctl(fd_.get(), VIDIOC_S_FMT, &format);
+	if (ret || pix.pixelformat != V4L2_PIX_FMT_JPEG) {
+		LOG(JPEG, Error) << "Failed to set JPEG format";
+		return ret ? ret : -EINVAL;
+	}
+
+	return 0;
+}
+
+int EncoderV4L2::allocateBuffers()
+{
+	struct v4l2_requestbuffers rb = {};
+	rb.count = 1;
+	rb.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+	rb.memory = V4L2_MEMORY_DMABUF;
+
+	int ret = xioctl(fd_.get(), VIDIOC_REQBUFS, &rb);
+	if (ret || rb.count < 1) {
+		LOG(JPEG, Error) << "Failed to request source buffers";
+		return ret ? ret : -ENOMEM;
+	}
+
+	rb = {};
+	rb.count = 1;
+	rb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	rb.memory = V4L2_MEMORY_MMAP;
+
+	ret = xioctl(fd_.get(), VIDIOC_REQBUFS, &rb);
+	if (ret || rb.count < 1) {
+		LOG(JPEG, Error) << "Failed to request JPEG buffers";
+		return ret ? ret : -ENOMEM;
+	}
+
+	struct v4l2_plane plane = {};
+	struct v4l2_buffer buf = {};
+	buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	buf.memory = V4L2_MEMORY_MMAP;
+	buf.index = 0;
+	buf.m.planes = &plane;
+	buf.length = 1;
+
+	ret = xioctl(fd_.get(), VIDIOC_QUERYBUF, &buf);
+	if (ret) {
+		LOG(JPEG, Error) << "Failed to query JPEG buffer: " << strerror(-ret);
+		return ret;
+	}
+
+	void *mem = mmap(nullptr, plane.length, PROT_READ, MAP_SHARED,
+			 fd_.get(), plane.m.mem_offset);
+	if (mem == MAP_FAILED) {
+		ret = -errno;
+		LOG(JPEG, Error) << "Failed to map JPEG buffer: " << strerror(-ret);
+		return ret;
+	}
+
+	jpeg_ = static_cast<uint8_t *>(mem);
+	jpegLength_ = plane.length;
+
+	for (uint32_t type : { V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+			       V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE }) {
+		ret = xioctl(fd_.get(), VIDIOC_STREAMON, &type);
+		if (ret) {
+			LOG(JPEG, Error) << "Failed to start streaming: " << strerror(-ret);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+void EncoderV4L2::releaseBuffers()
+{
+	if (!fd_.isValid())
+		return;
+
+	for (uint32_t type : { V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE,
+			       V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE })
+		xioctl(fd_.get(), VIDIOC_STREAMOFF, &type);
+
+	if (jpeg_) {
+		munmap(jpeg_, jpegLength_);
+		jpeg_ = nullptr;
+		jpegLength_ = 0;
+	}
+
+	fd_.reset();
+}
+
+int EncoderV4L2::queueSource(const FrameBuffer &source)
+{
+	const std::vector<FrameBuffer::Plane> &planes = source.planes();
+	struct v4l2_plane v4l2Planes[2] = {};
+
+	if (sourcePlanes_ == 1) {
+		/* The contiguous format requires all planes in one dmabuf. */
+		const FrameBuffer::Plane &last = planes.back();
+		for (const FrameBuffer::Plane &plane : planes) {
+			if (plane.fd.get() != planes[0].fd.get())
+				return -ENOTSUP;
+		}
+
+		if (planes[0].offset != 0)
+			return -ENOTSUP;
+
+		v4l2Planes[0].m.fd = planes[0].fd.get();
+		v4l2Planes[0].length = last.offset + last.length;
+		v4l2Planes[0].bytesused = v4l2Planes[0].length;
+	} else {
+		if (planes.size() != sourcePlanes_)
+			return -ENOTSUP;
+
+		for (unsigned int i = 0; i < sourcePlanes_; i++) {
+			if (planes[i].offset != 0)
+				return -ENOTSUP;
+
+			v4l2Planes[i].m.fd = planes[i].fd.get();
+			v4l2Planes[i].length = planes[i].length;
+			v4l2Planes[i].bytesused = planes[i].length;
+		}
+	}
+
+	struct v4l2_buffer buf = {};
+	buf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+	buf.memory = V4L2_MEMORY_DMABUF;
+	buf.index = 0;
+	buf.m.planes = v4l2Planes;
+	buf.length = sourcePlanes_;
+
+	return xioctl(fd_.get(), VIDIOC_QBUF, &buf);
+}
+
+int EncoderV4L2::waitForJpeg(unsigned int *size)
+{
+	struct v4l2_plane plane = {};
+	struct v4l2_buffer buf = {};
+	buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	buf.memory = V4L2_MEMORY_MMAP;
+	buf.m.planes = &plane;
+	buf.length = 1;
+
+	int ret;
+	while ((ret = xioctl(fd_.get(), VIDIOC_DQBUF, &buf)) == -EAGAIN) {
+		struct pollfd pfd = { fd_.get(), POLLIN, 0 };
+
+		ret = poll(&pfd, 1, kEncodeTimeoutMs);
+		if (ret == 0)
+			return -ETIMEDOUT;
+		if (ret < 0 && errno != EINTR)
+			return -errno;
+	}
+
+	if (ret)
+		return ret;
+
+	/* Dequeue the source buffer, which has been consumed. */
+	struct v4l2_plane sourcePlanes[2] = {};
+	struct v4l2_buffer sourceBuf = {};
+	sourceBuf.type = V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE;
+	sourceBuf.memory = V4L2_MEMORY_DMABUF;
+	sourceBuf.m.planes = sourcePlanes;
+	sourceBuf.length = sourcePlanes_;
+	xioctl(fd_.get(), VIDIOC_DQBUF, &sourceBuf);
+
+	if (buf.flags & V4L2_BUF_FLAG_ERROR)
+		return -EIO;
+
+	*size = plane.bytesused - plane.data_offset;
+
+	return 0;
+}
+
+int EncoderV4L2::encode(Camera3RequestDescriptor::StreamBuffer *buffer,
+			Span<const uint8_t> exifData, unsigned int quality)
+{
+	if (!fd_.isValid())
+		return -ENODEV;
+
+	if (quality_ != static_cast<int>(quality)) {
+		struct v4l2_control ctrl = {};
+		ctrl.id = V4L2_CID_JPEG_COMPRESSION_QUALITY;
+		ctrl.value = quality;
+
+		int ret = xioctl(fd_.get(), VIDIOC_S_CTRL, &ctrl);
+		if (ret)
+			LOG(JPEG, Warning)
+				<< "Failed to set JPEG quality: " << strerror(-ret);
+
+		quality_ = quality;
+	}
+
+	int ret = queueSource(*buffer->srcBuffer);
+	if (ret) {
+		LOG(JPEG, Debug) << "Failed to queue source buffer: " << strerror(-ret);
+		return ret;
+	}
+
+	struct v4l2_plane plane = {};
+	struct v4l2_buffer buf = {};
+	buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+	buf.memory = V4L2_MEMORY_MMAP;
+	buf.index = 0;
+	buf.m.planes = &plane;
+	buf.length = 1;
+
+	ret = xioctl(fd_.get(), VIDIOC_QBUF, &buf);
+	if (ret) {
+		LOG(JPEG, Error) << "Failed to queue JPEG buffer: " << strerror(-ret);
+		releaseBuffers();
+		return ret;
+	}
+
+	unsigned int size;
+	ret = waitForJpeg(&size);
+	if (ret) {
+		LOG(JPEG, Error) << "JPEG encoding failed: " << strerror(-ret);
+		/* Drop the encoder, the buffers may still be owned by the driver. */
+		releaseBuffers();
+		return ret;
+	}
+
+	const uint8_t *jpeg = jpeg_ + plane.data_offset;
+	if (size < 2 || jpeg[0] != 0xff || jpeg[1] != 0xd8) {
+		LOG(JPEG, Error) << "Invalid JPEG bitstream from encoder";
+		return -EINVAL;
+	}
+
+	/*
+	 * Insert the Exif data in an APP1 segment right after the SOI marker,
+	 * as the hardware encoders don't support writing application markers.
+	 */
+	if (exifData.size() > 0xffff - 2) {
+		LOG(JPEG, Error) << "Exif data too large";
+		return -EINVAL;
+	}
+
+	Span<uint8_t> dest = buffer->dstBuffer->plane(0);
+	size_t exifSize = exifData.empty() ? 0 : exifData.size() + 4;
+	size_t total = size + exifSize;
+
+	if (total > dest.size()) {
+		LOG(JPEG, Error)
+			<< "JPEG image size " << total
+			<< " exceeds the destination buffer size " << dest.size();
+		return -ENOSPC;
+	}
+
+	uint8_t *out = dest.data();
+	memcpy(out, jpeg, 2);
+	out += 2;
+
+	if (exifSize) {
+		size_t length = exifData.size() + 2;
+
+		*out++ = 0xff;
+		*out++ = 0xe1;
+		*out++ = length >> 8;
+		*out++ = length & 0xff;
+		memcpy(out, exifData.data(), exifData.size());
+		out += exifData.size();
+	}
+
+	memcpy(out, jpeg + 2, size - 2);
+
+	return total;
+}
@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * encoder_v4l2.h - JPEG encoding using a V4L2 memory-to-memory encoder
+ */
+
+#pragma once
+
+#include <string>
+
+#include <libcamera/base/unique_fd.h>
+
+#include "encoder.h"
+
+class EncoderV4L2 : public Encoder
+{
+public:
+	EncoderV4L2();
+	~EncoderV4L2();
+
+	int configure(const libcamera::StreamConfiguration &cfg) override;
+	int encode(Camera3RequestDescriptor::StreamBuffer *buffer,
+		   libcamera::Span<const uint8_t> exifData,
+		   unsigned int quality) override;
+
+private:
+	static const std::string &deviceNode();
+	static std::string probeDevices();
+
+	int setFormats(const libcamera::StreamConfiguration &cfg);
+	int allocateBuffers();
+	void releaseBuffers();
+	int queueSource(const libcamera::FrameBuffer &source);
+	int waitForJpeg(unsigned int *size);
+
+	libcamera::UniqueFD fd_;
+	unsigned int sourcePlanes_;
+	int quality_;
+
+	uint8_t *jpeg_;
+	size_t jpegLength_;
+};
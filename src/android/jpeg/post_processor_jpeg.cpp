@@ -14,9 +14,9 @@
 #include "../camera_request.h"
 #if defined(OS_CHROMEOS)
 #include "encoder_jea.h"
-#else /* !defined(OS_CHROMEOS) */
-#include "encoder_libjpeg.h"
 #endif
+#include "encoder_libjpeg.h"
+#include "encoder_v4l2.h"
 #include "exif.h"
 
 #include <libcamera/base/log.h>
@@ -50,13 +50,41 @@ int PostProcessorJpeg::configure(const StreamConfiguration &inCfg,
 
 	thumbnailer_.configure(inCfg.size, inCfg.pixelFormat);
 
+	/*
+	 * Select the first encoder that supports the configuration, in order
+	 * of preference. Hardware encoders are preferred to save CPU time, and
+	 * libjpeg is used as a fallback.
+	 */
+	std::vector<std::unique_ptr<Encoder>> encoders;
 #if defined(OS_CHROMEOS)
-	encoder_ = std::make_unique<EncoderJea>();
-#else /* !defined(OS_CHROMEOS) */
-	encoder_ = std::make_unique<EncoderLibJpeg>();
+	encoders.push_back(std::make_unique<EncoderJea>());
 #endif
+	encoders.push_back(std::make_unique<EncoderV4L2>());
+
+	encoder_.reset();
 
-	return encoder_->configure(inCfg);
+	for (std::unique_ptr<Encoder> &encoder : encoders) {
+		if (!encoder->configure(inCfg)) {
+			encoder_ = std::move(encoder);
+			break;
+		}
+	}
+
+	/*
+	 * The libjpeg encoder is also kept as a fallback for frames that the
+	 * hardware encoder fails to process.
+	 */
+	fallbackEncoder_ = std::make_unique<EncoderLibJpeg>();
+	int ret = fallbackEncoder_->configure(inCfg);
+	if (!encoder_) {
+		encoder_ = std::move(fallbackEncoder_);
+		return ret;
+	}
+
+	if (ret)
+		fallbackEncoder_.reset();
+
+	return 0;
 }
 
 void PostProcessorJpeg::generateThumbnail(const FrameBuffer &source,
@@ -64,22 +92,19 @@ void PostProcessorJpeg::generateThumbnail(const FrameBuffer &source,
 					  unsigned int quality,
 					  std::vector<unsigned char> *thumbnail)
 {
-	/* Stores the raw scaled-down thumbnail bytes. */
-	std::vector<unsigned char> rawThumbnail;
-
-	thumbnailer_.createThumbnail(source, targetSize, &rawThumbnail);
+	thumbnailer_.createThumbnail(source, targetSize, &rawThumbnail_);
 
 	StreamConfiguration thCfg;
 	thCfg.size = targetSize;
 	thCfg.pixelFormat = thumbnailer_.pixelFormat();
 	int ret = thumbnailEncoder_.configure(thCfg);
 
-	if (!rawThumbnail.empty() && !ret) {
+	if (!rawThumbnail_.empty() && !ret) {
 		/*
 		 * \todo Avoid value-initialization of all elements of the
 		 * vector.
 		 */
-		thumbnail->resize(rawThumbnail.size());
+		thumbnail->resize(rawThumbnail_.size());
 
 		/*
 		 * Split planes manually as the encoder expects a vector of
@@ -93,8 +118,8 @@ void PostProcessorJpeg::generateThumbnail(const FrameBuffer &source,
 		const PixelFormatInfo &formatNV12 = PixelFormatInfo::info(formats::NV12);
 		size_t yPlaneSize = formatNV12.planeSize(targetSize, 0);
 		size_t uvPlaneSize = formatNV12.planeSize(targetSize, 1);
-		thumbnailPlanes.push_back({ rawThumbnail.data(), yPlaneSize });
-		thumbnailPlanes.push_back({ rawThumbnail.data() + yPlaneSize, uvPlaneSize });
+		thumbnailPlanes.push_back({ rawThumbnail_.data(), yPlaneSize });
+		thumbnailPlanes.push_back({ rawThumbnail_.data() + yPlaneSize, uvPlaneSize });
 
 		int jpeg_size = thumbnailEncoder_.encode(thumbnailPlanes,
 							 *thumbnail, {}, quality);
@@ -115,8 +140,9 @@ void PostProcessorJpeg::process(Camera3RequestDescriptor::StreamBuffer *streamBu
 
 	ASSERT(destination->numPlanes() == 1);
 
-	const CameraMetadata &requestMetadata = streamBuffer->request->settings_;
-	CameraMetadata *resultMetadata = streamBuffer->request->resultMetadata_.get();
+	const CameraMetadata &requestMetadata = *streamBuffer->request->settings_;
+	const CameraMetadata *resultMetadata = streamBuffer->request->resultMetadata_.get();
+	CameraMetadata *jpegMetadata = streamBuffer->request->postProcessingMetadata_.get();
 	camera_metadata_ro_entry_t entry;
 	int ret;
 
@@ -128,7 +154,7 @@ void PostProcessorJpeg::process(Camera3RequestDescriptor::StreamBuffer *streamBu
 	ret = requestMetadata.getEntry(ANDROID_JPEG_ORIENTATION, &entry);
 
 	const uint32_t jpegOrientation = ret ? *entry.data.i32 : 0;
-	resultMetadata->addEntry(ANDROID_JPEG_ORIENTATION, jpegOrientation);
+	jpegMetadata->addEntry(ANDROID_JPEG_ORIENTATION, jpegOrientation);
 	exif.setOrientation(jpegOrientation);
 
 	exif.setSize(streamSize_);
@@ -156,8 +182,8 @@ void PostProcessorJpeg::process(Camera3RequestDescriptor::StreamBuffer *streamBu
 	ret = requestMetadata.getEntry(ANDROID_JPEG_GPS_TIMESTAMP, &entry);
 	if (ret) {
 		exif.setGPSDateTimestamp(*entry.data.i64);
-		resultMetadata->addEntry(ANDROID_JPEG_GPS_TIMESTAMP,
-					 *entry.data.i64);
+		jpegMetadata->addEntry(ANDROID_JPEG_GPS_TIMESTAMP,
+				       *entry.data.i64);
 	}
 
 	ret = requestMetadata.getEntry(ANDROID_JPEG_THUMBNAIL_SIZE, &entry);
@@ -168,7 +194,7 @@ void PostProcessorJpeg::process(Camera3RequestDescriptor::StreamBuffer *streamBu
 
 		ret = requestMetadata.getEntry(ANDROID_JPEG_THUMBNAIL_QUALITY, &entry);
 		uint8_t quality = ret ? *entry.data.u8 : 95;
-		resultMetadata->addEntry(ANDROID_JPEG_THUMBNAIL_QUALITY, quality);
+		jpegMetadata->addEntry(ANDROID_JPEG_THUMBNAIL_QUALITY, quality);
 
 		if (thumbnailSize != Size(0, 0)) {
 			std::vector<unsigned char> thumbnail;
@@ -177,22 +203,22 @@ void PostProcessorJpeg::process(Camera3RequestDescriptor::StreamBuffer *streamBu
 				exif.setThumbnail(std::move(thumbnail), Exif::Compression::JPEG);
 		}
 
-		resultMetadata->addEntry(ANDROID_JPEG_THUMBNAIL_SIZE, data, 2);
+		jpegMetadata->addEntry(ANDROID_JPEG_THUMBNAIL_SIZE, data, 2);
 	}
 
 	ret = requestMetadata.getEntry(ANDROID_JPEG_GPS_COORDINATES, &entry);
 	if (ret) {
 		exif.setGPSLocation(entry.data.d);
-		resultMetadata->addEntry(ANDROID_JPEG_GPS_COORDINATES,
-					 entry.data.d, 3);
+		jpegMetadata->addEntry(ANDROID_JPEG_GPS_COORDINATES,
+				       entry.data.d, 3);
 	}
 
 	ret = requestMetadata.getEntry(ANDROID_JPEG_GPS_PROCESSING_METHOD, &entry);
 	if (ret) {
 		std::string method(entry.data.u8, entry.data.u8 + entry.count);
 		exif.setGPSMethod(method);
-		resultMetadata->addEntry(ANDROID_JPEG_GPS_PROCESSING_METHOD,
-					 entry.data.u8, entry.count);
+		jpegMetadata->addEntry(ANDROID_JPEG_GPS_PROCESSING_METHOD,
+				       entry.data.u8, entry.count);
 	}
 
 	if (exif.generate() != 0)
@@ -200,9 +226,15 @@ void PostProcessorJpeg::process(Camera3RequestDescriptor::StreamBuffer *streamBu
 
 	ret = requestMetadata.getEntry(ANDROID_JPEG_QUALITY, &entry);
 	const uint8_t quality = ret ? *entry.data.u8 : 95;
-	resultMetadata->addEntry(ANDROID_JPEG_QUALITY, quality);
+	jpegMetadata->addEntry(ANDROID_JPEG_QUALITY, quality);
 
 	int jpeg_size = encoder_->encode(streamBuffer, exif.data(), quality);
+	if (jpeg_size < 0 && fallbackEncoder_) {
+		LOG(JPEG, Warning)
+			<< "Hardware JPEG encoding failed, falling back to libjpeg";
+		jpeg_size = fallbackEncoder_->encode(streamBuffer, exif.data(), quality);
+	}
+
 	if (jpeg_size < 0) {
 		LOG(JPEG, Error) << "Failed to encode stream image";
 		processComplete.emit(streamBuffer, PostProcessor::Status::Error);
@@ -218,6 +250,6 @@ void PostProcessorJpeg::process(Camera3RequestDescriptor::StreamBuffer *streamBu
 	blob->jpeg_size = jpeg_size;
 
 	/* Update the JPEG result Metadata. */
-	resultMetadata->addEntry(ANDROID_JPEG_SIZE, jpeg_size);
+	jpegMetadata->addEntry(ANDROID_JPEG_SIZE, jpeg_size);
 	processComplete.emit(streamBuffer, PostProcessor::Status::Success);
 }
@@ -32,7 +32,11 @@ private:
 
 	CameraDevice *const cameraDevice_;
 	std::unique_ptr<Encoder> encoder_;
+	std::unique_ptr<Encoder> fallbackEncoder_;
 	libcamera::Size streamSize_;
 	EncoderLibJpeg thumbnailEncoder_;
 	Thumbnailer thumbnailer_;
+
+	/* Raw scaled-down thumbnail, reused across captures. */
+	std::vector<unsigned char> rawThumbnail_;
 };
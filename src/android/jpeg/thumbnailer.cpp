@@ -7,10 +7,13 @@
 
 #include "thumbnailer.h"
 
+#include <libyuv/scale.h>
+
 #include <libcamera/base/log.h>
 
 #include <libcamera/formats.h>
 
+#include "libcamera/internal/dma_buf_allocator.h"
 #include "libcamera/internal/mapped_framebuffer.h"
 
 using namespace libcamera;
@@ -54,43 +57,39 @@ void Thumbnailer::createThumbnail(const FrameBuffer &source,
 		return;
 	}
 
-	const unsigned int sw = sourceSize_.width;
-	const unsigned int sh = sourceSize_.height;
+	std::vector<DmaSyncer> syncers;
+	for (const FrameBuffer::Plane &plane : source.planes())
+		syncers.emplace_back(plane.fd, DmaSyncer::SyncType::Read);
+
 	const unsigned int tw = targetSize.width;
 	const unsigned int th = targetSize.height;
 
 	ASSERT(frame.planes().size() == 2);
 	ASSERT(tw % 2 == 0 && th % 2 == 0);
 
-	/* Image scaling block implementing nearest-neighbour algorithm. */
-	unsigned char *src = frame.planes()[0].data();
-	unsigned char *srcC = frame.planes()[1].data();
-	unsigned char *srcCb, *srcCr;
-	unsigned char *dstY, *srcY;
-
-	size_t dstSize = (th * tw) + ((th / 2) * tw);
-	destination->resize(dstSize);
+	/*
+	 * Scale the image with a box filter to avoid aliasing, as thumbnails
+	 * are typically an order of magnitude smaller than the source. The
+	 * destination vector is reused by the caller across captures, resizing
+	 * it to the same size doesn't reallocate memory.
+	 */
+	const PixelFormatInfo &info = PixelFormatInfo::info(formats::NV12);
+	const size_t yPlaneSize = info.planeSize(targetSize, 0);
+	const size_t uvPlaneSize = info.planeSize(targetSize, 1);
+
+	destination->resize(yPlaneSize + uvPlaneSize);
 	unsigned char *dst = destination->data();
-	unsigned char *dstC = dst + th * tw;
-
-	for (unsigned int y = 0; y < th; y += 2) {
-		unsigned int sourceY = (sh * y + th / 2) / th;
-
-		dstY = dst + y * tw;
-		srcY = src + sw * sourceY;
-		srcCb = srcC + (sourceY / 2) * sw + 0;
-		srcCr = srcC + (sourceY / 2) * sw + 1;
-
-		for (unsigned int x = 0; x < tw; x += 2) {
-			unsigned int sourceX = (sw * x + tw / 2) / tw;
-
-			dstY[x] = srcY[sourceX];
-			dstY[tw + x] = srcY[sw + sourceX];
-			dstY[x + 1] = srcY[sourceX + 1];
-			dstY[tw + x + 1] = srcY[sw + sourceX + 1];
 
-			dstC[(y / 2) * tw + x + 0] = srcCb[(sourceX / 2) * 2];
-			dstC[(y / 2) * tw + x + 1] = srcCr[(sourceX / 2) * 2];
-		}
+	int ret = libyuv::NV12Scale(frame.planes()[0].data(),
+				    info.stride(sourceSize_.width, 0),
+				    frame.planes()[1].data(),
+				    info.stride(sourceSize_.width, 1),
+				    sourceSize_.width, sourceSize_.height,
+				    dst, info.stride(tw, 0),
+				    dst + yPlaneSize, info.stride(tw, 1),
+				    tw, th, libyuv::FilterMode::kFilterBox);
+	if (ret) {
+		LOG(Thumbnailer, Error) << "Failed NV12 scaling: " << ret;
+		destination->clear();
 	}
 }
@@ -0,0 +1,192 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * post_processor_pool.cpp - Thread pool shared by post-processed streams
+ */
+
+#include "post_processor_pool.h"
+
+#include <libcamera/base/log.h>
+
+#include "post_processor.h"
+
+using namespace libcamera;
+
+/**
+ * \class PostProcessorQueue
+ * \brief Queue of post-processing requests for a CameraStream
+ *
+ * If the association between CameraStream and camera3_stream_t dictated by
+ * CameraStream::Type is internal or mapped, the stream is generated by post
+ * processing of a libcamera stream. Such a request is queued to the stream's
+ * PostProcessorQueue in CameraStream::process(), and run by the threads of the
+ * PostProcessorPool shared by all streams.
+ *
+ * Post-processors are not reentrant. The queue is created with a set of
+ * identically configured post-processors, one per request that may be
+ * processed concurrently for the stream. Requests thus complete out of order
+ * when more than one post-processor is available, CameraDevice takes care of
+ * sending capture results to the framework in order.
+ */
+
+PostProcessorQueue::PostProcessorQueue(const std::vector<PostProcessor *> &processors)
+	: processors_(processors), pool_(PostProcessorPool::instance()),
+	  idle_(processors), active_(0), state_(State::Stopped)
+{
+	ASSERT(!processors.empty());
+
+	MutexLocker locker(pool_->mutex_);
+	pool_->queues_.push_back(this);
+}
+
+PostProcessorQueue::~PostProcessorQueue()
+{
+	MutexLocker locker(pool_->mutex_);
+	state_ = State::Stopped;
+
+	/* Wait for the requests being processed to complete. */
+	pool_->cv_.wait(locker, [&]() LIBCAMERA_TSA_REQUIRES(pool_->mutex_) {
+		return active_ == 0;
+	});
+
+	pool_->queues_.remove(this);
+}
+
+void PostProcessorQueue::start()
+{
+	MutexLocker locker(pool_->mutex_);
+	ASSERT(state_ != State::Running);
+	state_ = State::Running;
+}
+
+void PostProcessorQueue::queueRequest(Camera3RequestDescriptor::StreamBuffer *request)
+{
+	{
+		MutexLocker locker(pool_->mutex_);
+		ASSERT(state_ == State::Running);
+		requests_.push(request);
+	}
+
+	PostProcessorPool *pool = pool_.get();
+	pool->threads_.queue([pool]() { pool->processRequests(); });
+}
+
+/*
+ * Complete all the requests that haven't started processing with an error.
+ * The queue must be started again before queuing new requests.
+ */
+void PostProcessorQueue::flush()
+{
+	std::queue<Camera3RequestDescriptor::StreamBuffer *> requests;
+
+	{
+		MutexLocker locker(pool_->mutex_);
+		std::swap(requests, requests_);
+		state_ = State::Stopped;
+	}
+
+	while (!requests.empty()) {
+		Camera3RequestDescriptor::StreamBuffer *request = requests.front();
+
+		for (Camera3RequestDescriptor::StreamBuffer *dependent : request->dependents)
+			processors_[0]->processComplete.emit(dependent,
+							     PostProcessor::Status::Error);
+		processors_[0]->processComplete.emit(request,
+						     PostProcessor::Status::Error);
+		requests.pop();
+	}
+}
+
+/**
+ * \class PostProcessorPool
+ * \brief Threads running the post-processing requests of all streams
+ *
+ * A single pool is shared by all the streams of all cameras, to bound the
+ * total number of post-processing threads. Streams with pending requests are
+ * served in a round-robin fashion.
+ *
+ * The requests are processed by a ThreadPool, which post-processors can also
+ * use to split their work in strips.
+ *
+ * The pool is created when the first PostProcessorQueue is created, and
+ * destroyed with the last one.
+ */
+
+std::shared_ptr<PostProcessorPool> PostProcessorPool::instance()
+{
+	static Mutex mutex;
+	static std::weak_ptr<PostProcessorPool> instance;
+
+	MutexLocker locker(mutex);
+
+	std::shared_ptr<PostProcessorPool> pool = instance.lock();
+	if (pool)
+		return pool;
+
+	pool = std::shared_ptr<PostProcessorPool>(new PostProcessorPool());
+	instance = pool;
+
+	return pool;
+}
+
+PostProcessorPool::PostProcessorPool()
+	: threads_("PostProcessor", kMaxThreads)
+{
+}
+
+/**
+ * \fn PostProcessorPool::threads()
+ * \brief Retrieve the threads of the pool
+ * \return The ThreadPool running the post-processing requests
+ */
+
+PostProcessorQueue *PostProcessorPool::nextQueue()
+{
+	for (auto it = queues_.begin(); it != queues_.end(); ++it) {
+		PostProcessorQueue *queue = *it;
+
+		if (queue->state_ != PostProcessorQueue::State::Running ||
+		    queue->requests_.empty() || queue->idle_.empty())
+			continue;
+
+		/* Serve the other streams first next time. */
+		queues_.splice(queues_.end(), queues_, it);
+		return queue;
+	}
+
+	return nullptr;
+}
+
+/*
+ * Process requests until no stream has both a pending request and an idle
+ * post-processor. A task is queued to the thread pool for every request, the
+ * task that finds a post-processor busy leaves the request to the one that
+ * completes with it.
+ */
+void PostProcessorPool::processRequests()
+{
+	MutexLocker locker(mutex_);
+	PostProcessorQueue *queue;
+
+	while ((queue = nextQueue())) {
+		Camera3RequestDescriptor::StreamBuffer *request = queue->requests_.front();
+		queue->requests_.pop();
+
+		PostProcessor *processor = queue->idle_.back();
+		queue->idle_.pop_back();
+		queue->active_++;
+
+		locker.unlock();
+
+		processor->process(request);
+
+		locker.lock();
+
+		queue->idle_.push_back(processor);
+		queue->active_--;
+
+		/* Wake up a queue waiting for completion. */
+		cv_.notify_all();
+	}
+}
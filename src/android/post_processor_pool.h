@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * post_processor_pool.h - Thread pool shared by post-processed streams
+ */
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <queue>
+#include <vector>
+
+#include <libcamera/base/mutex.h>
+
+#include "libcamera/internal/thread_pool.h"
+
+#include "camera_request.h"
+
+class PostProcessor;
+class PostProcessorPool;
+
+class PostProcessorQueue
+{
+public:
+	PostProcessorQueue(const std::vector<PostProcessor *> &processors);
+	~PostProcessorQueue();
+
+	void start();
+	void queueRequest(Camera3RequestDescriptor::StreamBuffer *request);
+	void flush();
+
+private:
+	friend class PostProcessorPool;
+
+	enum class State {
+		Stopped,
+		Running,
+	};
+
+	const std::vector<PostProcessor *> processors_;
+	std::shared_ptr<PostProcessorPool> pool_;
+
+	/* The members below are protected by the pool mutex. */
+	std::vector<PostProcessor *> idle_;
+	std::queue<Camera3RequestDescriptor::StreamBuffer *> requests_;
+	unsigned int active_;
+	State state_;
+};
+
+class PostProcessorPool
+{
+public:
+	static std::shared_ptr<PostProcessorPool> instance();
+
+	libcamera::ThreadPool &threads() { return threads_; }
+
+private:
+	friend class PostProcessorQueue;
+
+	static constexpr unsigned int kMaxThreads = 4;
+
+	PostProcessorPool();
+
+	void processRequests();
+	PostProcessorQueue *nextQueue() LIBCAMERA_TSA_REQUIRES(mutex_);
+
+	libcamera::Mutex mutex_;
+	libcamera::ConditionVariable cv_;
+
+	std::list<PostProcessorQueue *> queues_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+
+	/* Destroyed first, as the requests being processed use the above. */
+	libcamera::ThreadPool threads_;
+};
@@ -7,6 +7,9 @@
 
 #include "post_processor_yuv.h"
 
+#include <algorithm>
+#include <iterator>
+
 #include <libyuv/scale.h>
 
 #include <libcamera/base/log.h>
@@ -15,9 +18,12 @@
 #include <libcamera/geometry.h>
 #include <libcamera/pixel_format.h>
 
+#include "libcamera/internal/dma_buf_allocator.h"
 #include "libcamera/internal/formats.h"
 #include "libcamera/internal/mapped_framebuffer.h"
 
+#include "../camera_stream.h"
+
 using namespace libcamera;
 
 LOG_DEFINE_CATEGORY(YUV)
@@ -49,57 +55,112 @@ int PostProcessorYuv::configure(const StreamConfiguration &inCfg,
 	return 0;
 }
 
+/*
+ * When several mapped NV12 streams are produced from the same source stream,
+ * the buffers of all streams but one are attached as dependents to the buffer
+ * of the remaining stream, and they are all produced in a single job. The
+ * source is mapped and synchronized once, and the outputs are produced from
+ * the largest to the smallest, each of them being scaled from the smallest
+ * output already produced that is large enough, or from the source. As the
+ * streams have the same aspect ratio, the outputs nest and the full source is
+ * only read once, for the largest output.
+ */
 void PostProcessorYuv::process(Camera3RequestDescriptor::StreamBuffer *streamBuffer)
 {
 	const FrameBuffer &source = *streamBuffer->srcBuffer;
-	CameraBuffer *destination = streamBuffer->dstBuffer.get();
 
-	if (!isValidBuffers(source, *destination)) {
-		processComplete.emit(streamBuffer, PostProcessor::Status::Error);
-		return;
+	outputs_.clear();
+	outputs_.push_back({ streamBuffer, destinationSize_, {}, {},
+			     PostProcessor::Status::Error });
+
+	for (Camera3RequestDescriptor::StreamBuffer *dependent : streamBuffer->dependents) {
+		const camera3_stream_t *stream = dependent->stream->camera3Stream();
+		outputs_.push_back({ dependent, Size(stream->width, stream->height),
+				     {}, {}, PostProcessor::Status::Error });
 	}
 
+	std::stable_sort(outputs_.begin(), outputs_.end(),
+			 [](const Output &a, const Output &b) {
+				 return a.size.width * a.size.height >
+					b.size.width * b.size.height;
+			 });
+
+	for (Output &output : outputs_)
+		calculateOutput(output);
+
+	if (isValidSource(source))
+		scale(source);
+
+	for (const Output &output : outputs_)
+		processComplete.emit(output.streamBuffer, output.status);
+}
+
+void PostProcessorYuv::scale(const FrameBuffer &source)
+{
 	const MappedFrameBuffer sourceMapped(&source, MappedFrameBuffer::MapFlag::Read);
 	if (!sourceMapped.isValid()) {
 		LOG(YUV, Error) << "Failed to mmap camera frame buffer";
-		processComplete.emit(streamBuffer, PostProcessor::Status::Error);
 		return;
 	}
 
-	int ret = libyuv::NV12Scale(sourceMapped.planes()[0].data(),
-				    sourceStride_[0],
-				    sourceMapped.planes()[1].data(),
-				    sourceStride_[1],
-				    sourceSize_.width, sourceSize_.height,
-				    destination->plane(0).data(),
-				    destinationStride_[0],
-				    destination->plane(1).data(),
-				    destinationStride_[1],
-				    destinationSize_.width,
-				    destinationSize_.height,
-				    libyuv::FilterMode::kFilterBilinear);
-	if (ret) {
-		LOG(YUV, Error) << "Failed NV12 scaling: " << ret;
-		processComplete.emit(streamBuffer, PostProcessor::Status::Error);
-		return;
+	std::vector<DmaSyncer> syncers;
+	for (const FrameBuffer::Plane &plane : source.planes())
+		syncers.emplace_back(plane.fd, DmaSyncer::SyncType::Read);
+
+	for (auto it = outputs_.begin(); it != outputs_.end(); ++it) {
+		Output &output = *it;
+		CameraBuffer *destination = output.streamBuffer->dstBuffer.get();
+
+		if (!isValidDestination(output))
+			continue;
+
+		const uint8_t *srcY = sourceMapped.planes()[0].data();
+		const uint8_t *srcUV = sourceMapped.planes()[1].data();
+		const unsigned int *srcStride = sourceStride_;
+		Size srcSize = sourceSize_;
+
+		/* Outputs are sorted by decreasing size, search backwards. */
+		for (auto prev = std::make_reverse_iterator(it);
+		     prev != outputs_.rend(); ++prev) {
+			if (prev->status != PostProcessor::Status::Success ||
+			    prev->size.width < output.size.width ||
+			    prev->size.height < output.size.height)
+				continue;
+
+			CameraBuffer *intermediate = prev->streamBuffer->dstBuffer.get();
+			srcY = intermediate->plane(0).data();
+			srcUV = intermediate->plane(1).data();
+			srcStride = prev->stride;
+			srcSize = prev->size;
+			break;
+		}
+
+		int ret = libyuv::NV12Scale(srcY, srcStride[0],
+					    srcUV, srcStride[1],
+					    srcSize.width, srcSize.height,
+					    destination->plane(0).data(),
+					    output.stride[0],
+					    destination->plane(1).data(),
+					    output.stride[1],
+					    output.size.width,
+					    output.size.height,
+					    libyuv::FilterMode::kFilterBilinear);
+		if (ret) {
+			LOG(YUV, Error) << "Failed NV12 scaling: " << ret;
+			continue;
+		}
+
+		output.status = PostProcessor::Status::Success;
 	}
-
-	processComplete.emit(streamBuffer, PostProcessor::Status::Success);
 }
 
-bool PostProcessorYuv::isValidBuffers(const FrameBuffer &source,
-				      const CameraBuffer &destination) const
+bool PostProcessorYuv::isValidSource(const FrameBuffer &source) const
 {
 	if (source.planes().size() != 2) {
 		LOG(YUV, Error) << "Invalid number of source planes: "
 				<< source.planes().size();
 		return false;
 	}
-	if (destination.numPlanes() != 2) {
-		LOG(YUV, Error) << "Invalid number of destination planes: "
-				<< destination.numPlanes();
-		return false;
-	}
 
 	if (source.planes()[0].length < sourceLength_[0] ||
 	    source.planes()[1].length < sourceLength_[1]) {
@@ -112,15 +173,29 @@ bool PostProcessorYuv::isValidBuffers(const FrameBuffer &source,
 			<< sourceLength_[1] << "}";
 		return false;
 	}
-	if (destination.plane(0).size() < destinationLength_[0] ||
-	    destination.plane(1).size() < destinationLength_[1]) {
+
+	return true;
+}
+
+bool PostProcessorYuv::isValidDestination(const Output &output) const
+{
+	const CameraBuffer &destination = *output.streamBuffer->dstBuffer;
+
+	if (destination.numPlanes() != 2) {
+		LOG(YUV, Error) << "Invalid number of destination planes: "
+				<< destination.numPlanes();
+		return false;
+	}
+
+	if (destination.plane(0).size() < output.length[0] ||
+	    destination.plane(1).size() < output.length[1]) {
 		LOG(YUV, Error)
 			<< "The destination planes lengths are too small, actual size: {"
 			<< destination.plane(0).size() << ", "
 			<< destination.plane(1).size()
 			<< "}, expected size: {"
-			<< sourceLength_[0] << ", "
-			<< sourceLength_[1] << "}";
+			<< output.length[0] << ", "
+			<< output.length[1] << "}";
 		return false;
 	}
 
@@ -136,11 +211,17 @@ void PostProcessorYuv::calculateLengths(const StreamConfiguration &inCfg,
 	const PixelFormatInfo &nv12Info = PixelFormatInfo::info(formats::NV12);
 	for (unsigned int i = 0; i < 2; i++) {
 		sourceStride_[i] = inCfg.stride;
-		destinationStride_[i] = nv12Info.stride(destinationSize_.width, i, 1);
-
 		sourceLength_[i] = nv12Info.planeSize(sourceSize_.height, i,
 						      sourceStride_[i]);
-		destinationLength_[i] = nv12Info.planeSize(destinationSize_.height, i,
-							   destinationStride_[i]);
+	}
+}
+
+void PostProcessorYuv::calculateOutput(Output &output)
+{
+	const PixelFormatInfo &nv12Info = PixelFormatInfo::info(formats::NV12);
+	for (unsigned int i = 0; i < 2; i++) {
+		output.stride[i] = nv12Info.stride(output.size.width, i, 1);
+		output.length[i] = nv12Info.planeSize(output.size.height, i,
+						      output.stride[i]);
 	}
 }
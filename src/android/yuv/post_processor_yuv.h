@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "../post_processor.h"
 
 #include <libcamera/geometry.h>
@@ -21,15 +23,25 @@ public:
 	void process(Camera3RequestDescriptor::StreamBuffer *streamBuffer) override;
 
 private:
-	bool isValidBuffers(const libcamera::FrameBuffer &source,
-			    const CameraBuffer &destination) const;
+	struct Output {
+		Camera3RequestDescriptor::StreamBuffer *streamBuffer;
+		libcamera::Size size;
+		unsigned int length[2];
+		unsigned int stride[2];
+		PostProcessor::Status status;
+	};
+
+	void scale(const libcamera::FrameBuffer &source);
+	bool isValidSource(const libcamera::FrameBuffer &source) const;
+	bool isValidDestination(const Output &output) const;
 	void calculateLengths(const libcamera::StreamConfiguration &inCfg,
 			      const libcamera::StreamConfiguration &outCfg);
+	static void calculateOutput(Output &output);
 
 	libcamera::Size sourceSize_;
 	libcamera::Size destinationSize_;
 	unsigned int sourceLength_[2] = {};
-	unsigned int destinationLength_[2] = {};
 	unsigned int sourceStride_[2] = {};
-	unsigned int destinationStride_[2] = {};
+
+	std::vector<Output> outputs_;
 };
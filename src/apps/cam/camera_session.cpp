@@ -18,6 +18,7 @@
 
 #include "camera_session.h"
 #include "capture_script.h"
+#include "capture_stats.h"
 #include "file_sink.h"
 #ifdef HAVE_KMS
 #include "kms_sink.h"
@@ -100,12 +101,6 @@ CameraSession::CameraSession(CameraManager *cm,
 			return;
 		}
 
-		if (roles.size() != 1) {
-			std::cerr << "Display doesn't support multiple streams"
-				  << std::endl;
-			return;
-		}
-
 		if (roles[0] != StreamRole::Viewfinder) {
 			std::cerr << "Display requires a viewfinder stream"
 				  << std::endl;
@@ -214,6 +209,12 @@ int CameraSession::start()
 
 	camera_->requestCompleted.connect(this, &CameraSession::requestComplete);
 
+	if (options_.isSet(OptStats))
+		stats_ = std::make_unique<CaptureStats>(streamNames_,
+							options_[OptStats].toString());
+	else
+		stats_.reset();
+
 #ifdef HAVE_KMS
 	if (options_.isSet(OptDisplay))
 		sink_ = std::make_unique<KMSSink>(options_[OptDisplay].toString());
@@ -262,6 +263,9 @@ void CameraSession::stop()
 
 	sink_.reset();
 
+	if (stats_)
+		stats_->stop();
+
 	requests_.clear();
 
 	allocator_.reset();
@@ -324,6 +328,9 @@ int CameraSession::startCapture()
 		}
 	}
 
+	if (stats_)
+		stats_->start();
+
 	ret = camera_->start();
 	if (ret) {
 		std::cout << "Failed to start capture" << std::endl;
@@ -361,7 +368,7 @@ int CameraSession::queueRequest(Request *request)
 		return 0;
 
 	if (script_)
-		request->controls() = script_->frameControls(queueCount_);
+		request->controls().merge(script_->frameControls(queueCount_));
 
 	queueCount_++;
 
@@ -373,6 +380,10 @@ void CameraSession::requestComplete(Request *request)
 	if (request->status() == Request::RequestCancelled)
 		return;
 
+	/* Record statistics as close as possible to the completion time. */
+	if (stats_)
+		stats_->record(request);
+
 	/*
 	 * Defer processing of the completed request to the event loop, to avoid
 	 * blocking the camera manager thread.
@@ -392,6 +403,40 @@ void CameraSession::processRequest(Request *request)
 	if (captureLimit_ && captureCount_ >= captureLimit_)
 		return;
 
+	bool requeue = true;
+
+	if (sink_) {
+		if (!sink_->processRequest(request))
+			requeue = false;
+	}
+
+	/* Per-frame lines would disturb the statistics, skip them. */
+	if (!stats_)
+		printRequest(request);
+
+	/*
+	 * Notify the user that capture is complete if the limit has just been
+	 * reached.
+	 */
+	captureCount_++;
+	if (captureLimit_ && captureCount_ >= captureLimit_) {
+		captureDone.emit();
+		return;
+	}
+
+	/*
+	 * If the frame sink holds on the request, we'll requeue it later in the
+	 * complete handler.
+	 */
+	if (!requeue)
+		return;
+
+	request->reuse(Request::ReuseBuffers);
+	queueRequest(request);
+}
+
+void CameraSession::printRequest(Request *request)
+{
 	const Request::BufferMap &buffers = request->buffers();
 
 	/*
@@ -403,8 +448,6 @@ void CameraSession::processRequest(Request *request)
 	fps = last_ != 0 && fps ? 1000000000.0 / fps : 0.0;
 	last_ = ts;
 
-	bool requeue = true;
-
 	std::stringstream info;
 	info << ts / 1000000000 << "."
 	     << std::setw(6) << std::setfill('0') << ts / 1000 % 1000000
@@ -425,11 +468,6 @@ void CameraSession::processRequest(Request *request)
 		}
 	}
 
-	if (sink_) {
-		if (!sink_->processRequest(request))
-			requeue = false;
-	}
-
 	std::cout << info.str() << std::endl;
 
 	if (printMetadata_) {
@@ -440,26 +478,6 @@ void CameraSession::processRequest(Request *request)
 				  << value.toString() << std::endl;
 		}
 	}
-
-	/*
-	 * Notify the user that capture is complete if the limit has just been
-	 * reached.
-	 */
-	captureCount_++;
-	if (captureLimit_ && captureCount_ >= captureLimit_) {
-		captureDone.emit();
-		return;
-	}
-
-	/*
-	 * If the frame sink holds on the request, we'll requeue it later in the
-	 * complete handler.
-	 */
-	if (!requeue)
-		return;
-
-	request->reuse(Request::ReuseBuffers);
-	queueRequest(request);
 }
 
 void CameraSession::sinkRelease(Request *request)
@@ -7,15 +7,39 @@
 
 #include "capture_script.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
+#include <type_traits>
 
 using namespace libcamera;
 
+namespace {
+
+/* Number of frames compiled in one go when the script is read past its end. */
+constexpr unsigned int kCompileChunk = 256;
+
+template<typename T>
+ControlValue interpolate(const ControlValue &from, const ControlValue &to,
+			 double position)
+{
+	double start = from.get<T>();
+	double end = to.get<T>();
+	double value = start + (end - start) * position;
+
+	if constexpr (std::is_integral_v<T>)
+		value = std::round(value);
+
+	return ControlValue(static_cast<T>(value));
+}
+
+} /* namespace */
+
 CaptureScript::CaptureScript(std::shared_ptr<Camera> camera,
 			     const std::string &fileName)
-	: camera_(camera), loop_(0), valid_(false)
+	: numFrames_(0), camera_(camera), loop_(0), valid_(false)
 {
 	FILE *fh = fopen(fileName.c_str(), "r");
 	if (!fh) {
@@ -50,11 +74,79 @@ const ControlList &CaptureScript::frameControls(unsigned int frame)
 	if (loop_)
 		idx = frame % loop_;
 
-	auto it = frameControls_.find(idx);
-	if (it == frameControls_.end())
+	if (idx >= numFrames_)
 		return controls;
 
-	return it->second;
+	if (idx >= frameControls_.size())
+		compileFrames(std::min(idx + kCompileChunk, numFrames_));
+
+	return frameControls_[idx];
+}
+
+/*
+ * Compile the frame ranges into per-frame control lists, up to (but not
+ * including) frame 'end'. Frames are compiled lazily, in chunks, as the
+ * capture progresses, so that long scripts don't delay the start of the
+ * capture or use memory for frames that are never reached. Ramp values are
+ * interpolated here, once, and the resulting control lists are reused when
+ * the script loops.
+ *
+ * When multiple ranges set the same control for a frame, the range listed last
+ * in the script takes precedence.
+ */
+void CaptureScript::compileFrames(unsigned int end)
+{
+	unsigned int begin = frameControls_.size();
+	if (end <= begin)
+		return;
+
+	frameControls_.resize(end);
+
+	for (const FrameRange &range : frameRanges_) {
+		if (range.last < begin || range.first >= end)
+			continue;
+
+		unsigned int frame = range.first;
+		if (frame < begin)
+			frame += (begin - frame + range.step - 1) / range.step * range.step;
+
+		unsigned int last = std::min(range.last, end - 1);
+		double length = range.last - range.first;
+
+		for (; frame <= last; frame += range.step) {
+			ControlList &controls = frameControls_[frame];
+			double position = length ? (frame - range.first) / length : 0.0;
+
+			for (const ControlAction &action : range.actions) {
+				if (action.end.isNone()) {
+					controls.set(action.id->id(), action.value);
+					continue;
+				}
+
+				ControlValue value;
+
+				switch (action.id->type()) {
+				case ControlTypeByte:
+					value = interpolate<uint8_t>(action.value, action.end, position);
+					break;
+				case ControlTypeInteger32:
+					value = interpolate<int32_t>(action.value, action.end, position);
+					break;
+				case ControlTypeInteger64:
+					value = interpolate<int64_t>(action.value, action.end, position);
+					break;
+				case ControlTypeFloat:
+					value = interpolate<float>(action.value, action.end, position);
+					break;
+				default:
+					value = action.value;
+					break;
+				}
+
+				controls.set(action.id->id(), value);
+			}
+		}
+	}
 }
 
 CaptureScript::EventPtr CaptureScript::nextEvent(yaml_event_type_t expectedType)
@@ -258,10 +350,14 @@ int CaptureScript::parseFrame(EventPtr event)
 	if (key.empty())
 		return -EINVAL;
 
-	unsigned int frameId = atoi(key.c_str());
-	if (loop_ && frameId >= loop_) {
+	FrameRange range;
+	int ret = parseFrameRange(key, &range);
+	if (ret)
+		return ret;
+
+	if (loop_ && range.last >= loop_) {
 		std::cerr
-			<< "Frame id (" << frameId << ") shall be smaller than"
+			<< "Frame id (" << range.last << ") shall be smaller than"
 			<< "loop limit (" << loop_ << ")" << std::endl;
 		return -EINVAL;
 	}
@@ -270,8 +366,6 @@ int CaptureScript::parseFrame(EventPtr event)
 	if (!event)
 		return -EINVAL;
 
-	ControlList controls{};
-
 	while (1) {
 		event = nextEvent();
 		if (!event)
@@ -280,12 +374,13 @@ int CaptureScript::parseFrame(EventPtr event)
 		if (event->type == YAML_MAPPING_END_EVENT)
 			break;
 
-		int ret = parseControl(std::move(event), controls);
+		ret = parseControl(std::move(event), range.actions);
 		if (ret)
 			return ret;
 	}
 
-	frameControls_[frameId] = std::move(controls);
+	numFrames_ = std::max(numFrames_, range.last + 1);
+	frameRanges_.push_back(std::move(range));
 
 	event = nextEvent(YAML_MAPPING_END_EVENT);
 	if (!event)
@@ -294,7 +389,44 @@ int CaptureScript::parseFrame(EventPtr event)
 	return 0;
 }
 
-int CaptureScript::parseControl(EventPtr event, ControlList &controls)
+/*
+ * Parse a frame key, which is either a single frame number "N", a range of
+ * frames "N-M" (inclusive), or every S-th frame of a range "N-M/S".
+ */
+int CaptureScript::parseFrameRange(const std::string &key, FrameRange *range)
+{
+	const char *str = key.c_str();
+	char *end;
+
+	range->first = strtoul(str, &end, 10);
+	range->last = range->first;
+	range->step = 1;
+
+	if (*end == '-') {
+		str = end + 1;
+		range->last = strtoul(str, &end, 10);
+		if (end == str)
+			goto error;
+	}
+
+	if (*end == '/') {
+		str = end + 1;
+		range->step = strtoul(str, &end, 10);
+		if (end == str || !range->step)
+			goto error;
+	}
+
+	if (end == key.c_str() || *end != '\0' || range->last < range->first)
+		goto error;
+
+	return 0;
+
+error:
+	std::cerr << "Invalid frame range '" << key << "'" << std::endl;
+	return -EINVAL;
+}
+
+int CaptureScript::parseControl(EventPtr event, std::vector<ControlAction> &actions)
 {
 	/* We expect a value after a key. */
 	std::string name = eventScalarValue(event);
@@ -310,14 +442,15 @@ int CaptureScript::parseControl(EventPtr event, ControlList &controls)
 
 	const ControlId *controlId = it->second;
 
-	ControlValue val = unpackControl(controlId);
+	ControlValue end;
+	ControlValue val = unpackControl(controlId, &end);
 	if (val.isNone()) {
 		std::cerr << "Error unpacking control '" << name << "'"
 			  << std::endl;
 		return -EINVAL;
 	}
 
-	controls.set(controlId->id(), val);
+	actions.push_back({ controlId, std::move(val), std::move(end) });
 
 	return 0;
 }
@@ -429,6 +562,64 @@ std::vector<std::string> CaptureScript::parseSingleArray()
 	}
 }
 
+/*
+ * Parse a ramp, expressed as a mapping with 'from' and 'to' values, that is
+ * linearly interpolated over the frames of a range. Return the start value and
+ * store the end value in 'end'.
+ */
+ControlValue CaptureScript::parseRamp(const ControlId *id, ControlValue *end)
+{
+	switch (id->type()) {
+	case ControlTypeByte:
+	case ControlTypeInteger32:
+	case ControlTypeInteger64:
+	case ControlTypeFloat:
+		break;
+	default:
+		std::cerr << "Ramps are only supported for numerical controls"
+			  << std::endl;
+		return {};
+	}
+
+	ControlValue from;
+	ControlValue to;
+
+	while (1) {
+		EventPtr event = nextEvent();
+		if (!event)
+			return {};
+
+		if (event->type == YAML_MAPPING_END_EVENT)
+			break;
+
+		if (!checkEvent(event, YAML_SCALAR_EVENT))
+			return {};
+
+		std::string key = eventScalarValue(event);
+		std::string repr = parseScalar();
+		if (repr.empty())
+			return {};
+
+		if (key == "from") {
+			from = parseScalarControl(id, repr);
+		} else if (key == "to") {
+			to = parseScalarControl(id, repr);
+		} else {
+			std::cerr << "Unsupported ramp key '" << key << "'"
+				  << std::endl;
+			return {};
+		}
+	}
+
+	if (from.isNone() || to.isNone()) {
+		std::cerr << "Ramps require 'from' and 'to' values" << std::endl;
+		return {};
+	}
+
+	*end = std::move(to);
+	return from;
+}
+
 void CaptureScript::unpackFailure(const ControlId *id, const std::string &repr)
 {
 	static const std::map<unsigned int, const char *> typeNames = {
@@ -609,7 +800,8 @@ ControlValue CaptureScript::parseArrayControl(const ControlId *id,
 	return value;
 }
 
-ControlValue CaptureScript::unpackControl(const ControlId *id)
+ControlValue CaptureScript::unpackControl(const ControlId *id,
+					  ControlValue *end)
 {
 	/* Parse complex types. */
 	switch (id->type()) {
@@ -642,6 +834,8 @@ ControlValue CaptureScript::unpackControl(const ControlId *id)
 
 		return parseArrayControl(id, array);
 	}
+	case YAML_MAPPING_START_EVENT:
+		return parseRamp(id, end);
 	default:
 		std::cerr << "Unexpected event type: " << event->type << std::endl;
 		return {};
@@ -10,6 +10,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <libcamera/camera.h>
 #include <libcamera/controls.h>
@@ -36,8 +37,24 @@ private:
 	};
 	using EventPtr = std::unique_ptr<yaml_event_t, EventDeleter>;
 
+	struct ControlAction {
+		const libcamera::ControlId *id;
+		libcamera::ControlValue value;
+		/* Value at the end of the frame range for ramps, none otherwise */
+		libcamera::ControlValue end;
+	};
+
+	struct FrameRange {
+		unsigned int first;
+		unsigned int last;
+		unsigned int step;
+		std::vector<ControlAction> actions;
+	};
+
 	std::map<std::string, const libcamera::ControlId *> controls_;
-	std::map<unsigned int, libcamera::ControlList> frameControls_;
+	std::vector<FrameRange> frameRanges_;
+	std::vector<libcamera::ControlList> frameControls_;
+	unsigned int numFrames_;
 	std::shared_ptr<libcamera::Camera> camera_;
 	yaml_parser_t parser_;
 	unsigned int loop_;
@@ -54,7 +71,8 @@ private:
 	int parseProperty();
 	int parseFrames();
 	int parseFrame(EventPtr event);
-	int parseControl(EventPtr event, libcamera::ControlList &controls);
+	int parseFrameRange(const std::string &key, FrameRange *range);
+	int parseControl(EventPtr event, std::vector<ControlAction> &actions);
 
 	libcamera::ControlValue parseScalarControl(const libcamera::ControlId *id,
 						   const std::string repr);
@@ -65,9 +83,14 @@ private:
 	libcamera::ControlValue parseRectangles();
 	std::vector<std::vector<std::string>> parseArrays();
 	std::vector<std::string> parseSingleArray();
+	libcamera::ControlValue parseRamp(const libcamera::ControlId *id,
+					  libcamera::ControlValue *end);
+
+	void compileFrames(unsigned int end);
 
 	void unpackFailure(const libcamera::ControlId *id,
 			   const std::string &repr);
-	libcamera::ControlValue unpackControl(const libcamera::ControlId *id);
+	libcamera::ControlValue unpackControl(const libcamera::ControlId *id,
+					      libcamera::ControlValue *end);
 	libcamera::Rectangle unpackRectangle(const std::vector<std::string> &strVec);
 };
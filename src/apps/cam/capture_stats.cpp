@@ -0,0 +1,185 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * capture_stats.cpp - Capture latency and jitter statistics
+ */
+
+#include "capture_stats.h"
+
+#include <errno.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include <libcamera/control_ids.h>
+#include <libcamera/framebuffer.h>
+
+#include "../common/sample_stats.h"
+
+using namespace libcamera;
+
+namespace {
+
+/* Print the min, p50, p90, p99 and max of values in nanoseconds, in ms. */
+void printPercentiles(const char *label, std::vector<int64_t> values)
+{
+	if (values.empty())
+		return;
+
+	SampleStats stats(std::move(values));
+
+	std::cout << "\t" << std::setw(9) << std::left << label << std::right
+		  << " min " << stats.min
+		  << " p50 " << stats.p50
+		  << " p90 " << stats.p90
+		  << " p99 " << stats.p99
+		  << " max " << stats.max << " ms" << std::endl;
+}
+
+} /* namespace */
+
+/*
+ * Statistics are recorded when requests complete, in the camera manager
+ * thread, and reported once the camera has been stopped. Per-frame samples are
+ * kept in memory and only written to the CSV file when stopping, to avoid
+ * slowing down the capture.
+ *
+ * The latency is measured from the SensorTimestamp metadata to the completion
+ * of the request, both on CLOCK_BOOTTIME. If the pipeline handler doesn't
+ * report the sensor timestamp, the buffer timestamp is used instead with
+ * CLOCK_MONOTONIC. The jitter is the absolute difference between the
+ * interval separating two consecutive frames and the mean frame interval.
+ */
+CaptureStats::CaptureStats(const std::map<const Stream *, std::string> &streamNames,
+			   const std::string &csvFile)
+	: streamNames_(streamNames), csvFile_(csvFile), cpuStart_(0),
+	  wallStart_(0)
+{
+}
+
+void CaptureStats::start()
+{
+	streams_.clear();
+
+	cpuStart_ = cpuTime();
+	wallStart_ = clockNs(CLOCK_MONOTONIC);
+}
+
+void CaptureStats::record(Request *request)
+{
+	const auto sensorTimestamp = request->metadata().get(controls::SensorTimestamp);
+	uint64_t now = clockNs(sensorTimestamp ? CLOCK_BOOTTIME : CLOCK_MONOTONIC);
+
+	for (const auto &[stream, buffer] : request->buffers()) {
+		const FrameMetadata &metadata = buffer->metadata();
+		if (metadata.status != FrameMetadata::FrameSuccess)
+			continue;
+
+		StreamStats &stats = streams_[stream];
+
+		if (!stats.samples.empty()) {
+			uint32_t last = stats.samples.back().sequence;
+			if (metadata.sequence > last + 1)
+				stats.dropped += metadata.sequence - last - 1;
+		} else {
+			stats.samples.reserve(1024);
+			stats.dropped = 0;
+		}
+
+		uint64_t timestamp = sensorTimestamp ? *sensorTimestamp
+						     : metadata.timestamp;
+		stats.samples.push_back({ metadata.sequence, metadata.timestamp,
+					  static_cast<int64_t>(now - timestamp) });
+	}
+}
+
+void CaptureStats::stop()
+{
+	double cpu = cpuTime() - cpuStart_;
+	double wall = (clockNs(CLOCK_MONOTONIC) - wallStart_) / 1e9;
+
+	for (const auto &[stream, stats] : streams_) {
+		auto name = streamNames_.find(stream);
+		report(name != streamNames_.end() ? name->second : "unknown", stats);
+	}
+
+	std::stringstream usage;
+	usage << "CPU time " << std::fixed << std::setprecision(3) << cpu
+	      << " s in " << wall << " s (" << std::setprecision(1)
+	      << (wall > 0 ? cpu / wall * 100 : 0.0) << " %)";
+	std::cout << usage.str() << std::endl;
+
+	if (!csvFile_.empty())
+		writeCsv();
+}
+
+void CaptureStats::report(const std::string &name, const StreamStats &stats) const
+{
+	const std::vector<Sample> &samples = stats.samples;
+
+	std::cout << name << ": " << samples.size() << " frames, "
+		  << stats.dropped << " dropped" << std::endl;
+
+	std::vector<int64_t> latencies;
+	latencies.reserve(samples.size());
+	for (const Sample &sample : samples)
+		latencies.push_back(sample.latency);
+
+	std::vector<int64_t> intervals;
+	for (size_t i = 1; i < samples.size(); ++i)
+		intervals.push_back(samples[i].timestamp - samples[i - 1].timestamp);
+
+	std::vector<int64_t> jitter;
+	if (!intervals.empty()) {
+		int64_t mean = std::accumulate(intervals.begin(), intervals.end(),
+					       int64_t{ 0 }) / static_cast<int64_t>(intervals.size());
+
+		std::cout << "\tfps       " << (mean ? 1e9 / mean : 0.0) << std::endl;
+
+		for (int64_t interval : intervals)
+			jitter.push_back(std::abs(interval - mean));
+	}
+
+	printPercentiles("latency", std::move(latencies));
+	printPercentiles("interval", std::move(intervals));
+	printPercentiles("jitter", std::move(jitter));
+}
+
+int CaptureStats::writeCsv() const
+{
+	std::ofstream file(csvFile_);
+	if (!file.is_open()) {
+		std::cerr << "Failed to open statistics file " << csvFile_
+			  << std::endl;
+		return -EINVAL;
+	}
+
+	file << "stream,sequence,timestamp_ns,latency_ns" << std::endl;
+
+	for (const auto &[stream, stats] : streams_) {
+		auto name = streamNames_.find(stream);
+		const std::string &streamName = name != streamNames_.end()
+					      ? name->second : "unknown";
+
+		for (const Sample &sample : stats.samples)
+			file << streamName << "," << sample.sequence << ","
+			     << sample.timestamp << "," << sample.latency << "\n";
+	}
+
+	return 0;
+}
+
+double CaptureStats::cpuTime()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+	       usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
@@ -0,0 +1,52 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * capture_stats.h - Capture latency and jitter statistics
+ */
+
+#pragma once
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <libcamera/request.h>
+#include <libcamera/stream.h>
+
+class CaptureStats
+{
+public:
+	CaptureStats(const std::map<const libcamera::Stream *, std::string> &streamNames,
+		     const std::string &csvFile);
+
+	void start();
+	void record(libcamera::Request *request);
+	void stop();
+
+private:
+	struct Sample {
+		uint32_t sequence;
+		uint64_t timestamp;
+		int64_t latency;
+	};
+
+	struct StreamStats {
+		std::vector<Sample> samples;
+		unsigned int dropped;
+	};
+
+	void report(const std::string &name, const StreamStats &stats) const;
+	int writeCsv() const;
+
+	static double cpuTime();
+
+	const std::map<const libcamera::Stream *, std::string> &streamNames_;
+	std::string csvFile_;
+
+	std::map<const libcamera::Stream *, StreamStats> streams_;
+
+	double cpuStart_;
+	uint64_t wallStart_;
+};
@@ -307,7 +307,7 @@ FrameBuffer::~FrameBuffer()
 }
 
 AtomicRequest::AtomicRequest(Device *dev)
-	: dev_(dev), valid_(true)
+	: dev_(dev), valid_(true), sequence_(0), timestamp_(0)
 {
 	request_ = drmModeAtomicAlloc();
 	if (!request_)
@@ -705,12 +705,12 @@ void Device::drmEvent()
 }
 
 void Device::pageFlipComplete([[maybe_unused]] int fd,
-			      [[maybe_unused]] unsigned int sequence,
-			      [[maybe_unused]] unsigned int tv_sec,
-			      [[maybe_unused]] unsigned int tv_usec,
-			      void *user_data)
+			      unsigned int sequence, unsigned int tv_sec,
+			      unsigned int tv_usec, void *user_data)
 {
 	AtomicRequest *request = static_cast<AtomicRequest *>(user_data);
+	request->sequence_ = sequence;
+	request->timestamp_ = tv_sec * 1000000000ULL + tv_usec * 1000ULL;
 	request->device()->requestComplete.emit(request);
 }
 
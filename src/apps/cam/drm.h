@@ -260,6 +260,10 @@ public:
 	Device *device() const { return dev_; }
 	bool isValid() const { return valid_; }
 
+	/* Sequence and timestamp in ns of the vblank the request completed at. */
+	unsigned int sequence() const { return sequence_; }
+	uint64_t timestamp() const { return timestamp_; }
+
 	int addProperty(const Object *object, const std::string &property,
 			uint64_t value);
 	int addProperty(const Object *object, const std::string &property,
@@ -267,6 +271,8 @@ public:
 	int commit(unsigned int flags = 0);
 
 private:
+	friend class Device;
+
 	AtomicRequest(const AtomicRequest &) = delete;
 	AtomicRequest(const AtomicRequest &&) = delete;
 	AtomicRequest &operator=(const AtomicRequest &) = delete;
@@ -278,6 +284,9 @@ private:
 	bool valid_;
 	drmModeAtomicReq *request_;
 	std::list<std::unique_ptr<Blob>> blobs_;
+
+	unsigned int sequence_;
+	uint64_t timestamp_;
 };
 
 class Device
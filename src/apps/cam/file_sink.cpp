@@ -5,17 +5,22 @@
  * file_sink.cpp - File Sink
  */
 
+#include <algorithm>
 #include <assert.h>
 #include <fcntl.h>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <string.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include <vector>
 
 #include <libcamera/camera.h>
 
 #include "../common/dng_writer.h"
+#include "../common/event_loop.h"
+#include "../common/frame_stream.h"
 #include "../common/image.h"
 
 #include "file_sink.h"
@@ -29,12 +34,14 @@ FileSink::FileSink([[maybe_unused]] const libcamera::Camera *camera,
 #ifdef HAVE_TIFF
 	  camera_(camera),
 #endif
-	  streamNames_(streamNames), pattern_(pattern)
+	  streamNames_(streamNames), pattern_(pattern), stopping_(false),
+	  handle_(std::make_shared<FileSink *>(this))
 {
 }
 
 FileSink::~FileSink()
 {
+	stop();
 }
 
 int FileSink::configure(const libcamera::CameraConfiguration &config)
@@ -43,6 +50,19 @@ int FileSink::configure(const libcamera::CameraConfiguration &config)
 	if (ret < 0)
 		return ret;
 
+	/* Write all frames to a single container file. */
+	const std::string extension = ".lcfs";
+	if (pattern_.size() > extension.size() &&
+	    pattern_.compare(pattern_.size() - extension.size(), extension.size(),
+			     extension) == 0) {
+		container_ = std::make_unique<FrameStream::Writer>();
+		ret = container_->open(pattern_, config, streamNames_);
+		if (ret < 0) {
+			container_.reset();
+			return ret;
+		}
+	}
+
 	return 0;
 }
 
@@ -55,12 +75,149 @@ void FileSink::mapBuffer(FrameBuffer *buffer)
 	mappedBuffers_[buffer] = std::move(image);
 }
 
+/*
+ * Frames are written by a dedicated thread, to avoid blocking the event loop
+ * on slow storage. The sink holds the requests until their frames are written,
+ * which bounds the queue to the number of requests. When storage can't keep
+ * up, the camera runs out of requests and drops frames, instead of the queue
+ * growing without limits.
+ */
+int FileSink::start()
+{
+	stopping_ = false;
+
+	/*
+	 * Frames written to separate DNG files don't need to be written in
+	 * order. Packing the RAW data is CPU-bound, use multiple threads to
+	 * write successive frames in parallel.
+	 */
+	unsigned int numWriters = 1;
+
+#ifdef HAVE_TIFF
+	bool dng = pattern_.size() > 4 &&
+		   pattern_.compare(pattern_.size() - 4, 4, ".dng") == 0;
+	if (dng && !container_ && pattern_.find('#') != std::string::npos)
+		numWriters = std::clamp(std::thread::hardware_concurrency(),
+					1U, kMaxDngWriters);
+#endif /* HAVE_TIFF */
+
+	for (unsigned int i = 0; i < numWriters; ++i)
+		writers_.emplace_back(&FileSink::run, this);
+
+	return 0;
+}
+
+int FileSink::stop()
+{
+	if (writers_.empty())
+		return 0;
+
+	{
+		std::unique_lock<std::mutex> locker(mutex_);
+		stopping_ = true;
+	}
+	cv_.notify_all();
+
+	for (std::thread &writer : writers_)
+		writer.join();
+	writers_.clear();
+
+	for (auto &[filename, file] : appendFiles_) {
+		close(file.fd);
+		fclose(file.index);
+	}
+	appendFiles_.clear();
+
+	if (container_)
+		container_->close();
+
+	return 0;
+}
+
 bool FileSink::processRequest(Request *request)
 {
-	for (auto [stream, buffer] : request->buffers())
-		writeBuffer(stream, buffer, request->metadata());
+	{
+		std::unique_lock<std::mutex> locker(mutex_);
+		queue_.push_back(request);
+	}
+	cv_.notify_one();
+
+	return false;
+}
+
+void FileSink::run()
+{
+	std::weak_ptr<FileSink *> handle = handle_;
+
+	while (true) {
+		Request *request;
+
+		{
+			std::unique_lock<std::mutex> locker(mutex_);
+			cv_.wait(locker, [&] { return stopping_ || !queue_.empty(); });
+
+			/* Write all queued frames before stopping. */
+			if (queue_.empty())
+				return;
 
-	return true;
+			request = queue_.front();
+			queue_.pop_front();
+		}
+
+		for (auto [stream, buffer] : request->buffers()) {
+			if (container_)
+				container_->write(stream, buffer,
+						  mappedBuffers_.at(buffer).get(),
+						  request->metadata());
+			else
+				writeBuffer(stream, buffer, request->metadata());
+		}
+
+		EventLoop::instance()->callLater([handle, request]() {
+			std::shared_ptr<FileSink *> sink = handle.lock();
+			if (sink)
+				(*sink)->requestProcessed.emit(request);
+		});
+	}
+}
+
+/*
+ * Frames written to a file name without a '#' are appended to a single file,
+ * kept open for the whole capture. Each frame is recorded in an index file
+ * named after the data file with an '.idx' suffix, as a line containing the
+ * stream name, frame sequence number, timestamp in nanoseconds, and offset
+ * and size of the frame in bytes.
+ */
+FileSink::AppendFile *FileSink::appendFile(const std::string &filename)
+{
+	auto it = appendFiles_.find(filename);
+	if (it != appendFiles_.end())
+		return &it->second;
+
+	int fd = open(filename.c_str(), O_CREAT | O_WRONLY | O_APPEND,
+		      S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+	if (fd == -1) {
+		int ret = -errno;
+		std::cerr << "failed to open file " << filename << ": "
+			  << strerror(-ret) << std::endl;
+		return nullptr;
+	}
+
+	std::string indexName = filename + ".idx";
+	FILE *index = fopen(indexName.c_str(), "a");
+	if (!index) {
+		int ret = -errno;
+		std::cerr << "failed to open index " << indexName << ": "
+			  << strerror(-ret) << std::endl;
+		close(fd);
+		return nullptr;
+	}
+
+	off_t offset = lseek(fd, 0, SEEK_END);
+	AppendFile &file = appendFiles_[filename];
+	file = { fd, index, offset, offset };
+
+	return &file;
 }
 
 void FileSink::writeBuffer(const Stream *stream, FrameBuffer *buffer,
@@ -83,12 +240,12 @@ void FileSink::writeBuffer(const Stream *stream, FrameBuffer *buffer,
 	pos = filename.find_first_of('#');
 	if (pos != std::string::npos) {
 		std::stringstream ss;
-		ss << streamNames_[stream] << "-" << std::setw(6)
+		ss << streamNames_.at(stream) << "-" << std::setw(6)
 		   << std::setfill('0') << buffer->metadata().sequence;
 		filename.replace(pos, 1, ss.str());
 	}
 
-	Image *image = mappedBuffers_[buffer].get();
+	Image *image = mappedBuffers_.at(buffer).get();
 
 #ifdef HAVE_TIFF
 	if (dng) {
@@ -103,16 +260,28 @@ void FileSink::writeBuffer(const Stream *stream, FrameBuffer *buffer,
 	}
 #endif /* HAVE_TIFF */
 
-	fd = open(filename.c_str(), O_CREAT | O_WRONLY |
-		  (pos == std::string::npos ? O_APPEND : O_TRUNC),
-		  S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
-	if (fd == -1) {
-		ret = -errno;
-		std::cerr << "failed to open file " << filename << ": "
-			  << strerror(-ret) << std::endl;
-		return;
+	AppendFile *file = nullptr;
+
+	if (pos == std::string::npos) {
+		file = appendFile(filename);
+		if (!file)
+			return;
+
+		fd = file->fd;
+	} else {
+		fd = open(filename.c_str(), O_CREAT | O_WRONLY | O_TRUNC,
+			  S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+		if (fd == -1) {
+			ret = -errno;
+			std::cerr << "failed to open file " << filename << ": "
+				  << strerror(-ret) << std::endl;
+			return;
+		}
 	}
 
+	std::vector<struct iovec> iov;
+	size_t size = 0;
+
 	for (unsigned int i = 0; i < buffer->planes().size(); ++i) {
 		/*
 		 * This was formerly a local "const FrameMetadata::Plane &"
@@ -129,19 +298,44 @@ void FileSink::writeBuffer(const Stream *stream, FrameBuffer *buffer,
 				  << " larger than plane size " << data.size()
 				  << std::endl;
 
-		ret = ::write(fd, data.data(), length);
-		if (ret < 0) {
-			ret = -errno;
-			std::cerr << "write error: " << strerror(-ret)
-				  << std::endl;
-			break;
-		} else if (ret != (int)length) {
-			std::cerr << "write error: only " << ret
-				  << " bytes written instead of "
-				  << length << std::endl;
-			break;
-		}
+		iov.push_back({ data.data(), length });
+		size += length;
 	}
 
-	close(fd);
+	/*
+	 * Reserve space for appended frames in large chunks, to limit
+	 * fragmentation of the file. Failures are not fatal, the file system
+	 * may not support preallocation.
+	 */
+	if (file && file->offset + static_cast<off_t>(size) > file->allocated) {
+		constexpr off_t kPreallocSize = 256 << 20;
+
+		if (!fallocate(fd, FALLOC_FL_KEEP_SIZE, file->allocated,
+			       std::max<off_t>(kPreallocSize, size)))
+			file->allocated += std::max<off_t>(kPreallocSize, size);
+		else
+			file->allocated = file->offset + size;
+	}
+
+	ssize_t written = ::writev(fd, iov.data(), iov.size());
+	if (written < 0) {
+		ret = -errno;
+		std::cerr << "write error: " << strerror(-ret) << std::endl;
+	} else if (static_cast<size_t>(written) != size) {
+		std::cerr << "write error: only " << written
+			  << " bytes written instead of " << size << std::endl;
+	}
+
+	if (!file) {
+		close(fd);
+		return;
+	}
+
+	if (written > 0) {
+		fprintf(file->index, "%s %u %llu %llu %zd\n",
+			streamNames_.at(stream).c_str(), buffer->metadata().sequence,
+			static_cast<unsigned long long>(buffer->metadata().timestamp),
+			static_cast<unsigned long long>(file->offset), written);
+		file->offset += written;
+	}
 }
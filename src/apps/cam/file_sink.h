@@ -7,9 +7,15 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
 
 #include <libcamera/stream.h>
 
@@ -17,6 +23,10 @@
 
 class Image;
 
+namespace FrameStream {
+class Writer;
+} /* namespace FrameStream */
+
 class FileSink : public FrameSink
 {
 public:
@@ -29,12 +39,28 @@ public:
 
 	void mapBuffer(libcamera::FrameBuffer *buffer) override;
 
+	int start() override;
+	int stop() override;
+
 	bool processRequest(libcamera::Request *request) override;
 
 private:
+	/* Maximum number of threads writing DNG files in parallel. */
+	static constexpr unsigned int kMaxDngWriters = 4;
+
+	/* A file frames are appended to, along with its index. */
+	struct AppendFile {
+		int fd;
+		FILE *index;
+		off_t offset;
+		off_t allocated;
+	};
+
+	void run();
 	void writeBuffer(const libcamera::Stream *stream,
 			 libcamera::FrameBuffer *buffer,
 			 const libcamera::ControlList &metadata);
+	AppendFile *appendFile(const std::string &filename);
 
 #ifdef HAVE_TIFF
 	const libcamera::Camera *camera_;
@@ -42,4 +68,21 @@ private:
 	std::map<const libcamera::Stream *, std::string> streamNames_;
 	std::string pattern_;
 	std::map<libcamera::FrameBuffer *, std::unique_ptr<Image>> mappedBuffers_;
+
+	std::unique_ptr<FrameStream::Writer> container_;
+
+	/* Only accessed by the writer thread. */
+	std::map<std::string, AppendFile> appendFiles_;
+
+	std::vector<std::thread> writers_;
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	std::deque<libcamera::Request *> queue_;
+	bool stopping_;
+
+	/*
+	 * Requests are released from the event loop, after the sink may have
+	 * been destroyed. The handle is checked to skip them in that case.
+	 */
+	std::shared_ptr<FileSink *> handle_;
 };
@@ -23,8 +23,34 @@
 
 #include "drm.h"
 
+namespace {
+
+/*
+ * Return the variant of a format without alpha channel, or an invalid format
+ * if the format has no alpha channel.
+ */
+libcamera::PixelFormat opaqueFormat(const libcamera::PixelFormat &format)
+{
+	switch (format) {
+	case libcamera::formats::ABGR8888:
+		return libcamera::formats::XBGR8888;
+	case libcamera::formats::ARGB8888:
+		return libcamera::formats::XRGB8888;
+	case libcamera::formats::BGRA8888:
+		return libcamera::formats::BGRX8888;
+	case libcamera::formats::RGBA8888:
+		return libcamera::formats::RGBX8888;
+	default:
+		return {};
+	}
+}
+
+} /* namespace */
+
 KMSSink::KMSSink(const std::string &connectorName)
-	: connector_(nullptr), crtc_(nullptr), plane_(nullptr), mode_(nullptr)
+	: connector_(nullptr), crtc_(nullptr), mode_(nullptr), displayed_(0),
+	  dropped_(0), totalLatency_(0), maxLatency_(0), lastVblank_(0),
+	  totalPeriod_(0)
 {
 	int ret = dev_.init();
 	if (ret < 0)
@@ -66,14 +92,23 @@ KMSSink::KMSSink(const std::string &connectorName)
 	dev_.requestComplete.connect(this, &KMSSink::requestComplete);
 }
 
-void KMSSink::mapBuffer(libcamera::FrameBuffer *buffer)
+DRM::FrameBuffer *KMSSink::drmBuffer(const Layer &layer,
+				     libcamera::FrameBuffer *buffer)
 {
+	auto iter = buffers_.find(buffer);
+	if (iter != buffers_.end())
+		return iter->second.get();
+
+	/*
+	 * The DRM frame buffers are created on first use, as the stream a
+	 * buffer belongs to isn't known when the buffers are mapped.
+	 */
 	std::array<uint32_t, 4> strides = {};
 
 	/* \todo Should libcamera report per-plane strides ? */
 	unsigned int uvStrideMultiplier;
 
-	switch (format_) {
+	switch (layer.format) {
 	case libcamera::formats::NV24:
 	case libcamera::formats::NV42:
 		uvStrideMultiplier = 4;
@@ -88,18 +123,17 @@ void KMSSink::mapBuffer(libcamera::FrameBuffer *buffer)
 		break;
 	}
 
-	strides[0] = stride_;
+	strides[0] = layer.stride;
 	for (unsigned int i = 1; i < buffer->planes().size(); ++i)
-		strides[i] = stride_ * uvStrideMultiplier / 2;
+		strides[i] = layer.stride * uvStrideMultiplier / 2;
 
 	std::unique_ptr<DRM::FrameBuffer> drmBuffer =
-		dev_.createFrameBuffer(*buffer, format_, size_, strides);
+		dev_.createFrameBuffer(*buffer, layer.format, layer.size, strides);
 	if (!drmBuffer)
-		return;
+		return nullptr;
 
-	buffers_.emplace(std::piecewise_construct,
-			 std::forward_as_tuple(buffer),
-			 std::forward_as_tuple(std::move(drmBuffer)));
+	iter = buffers_.emplace(buffer, std::move(drmBuffer)).first;
+	return iter->second.get();
 }
 
 int KMSSink::configure(const libcamera::CameraConfiguration &config)
@@ -108,12 +142,13 @@ int KMSSink::configure(const libcamera::CameraConfiguration &config)
 		return -EINVAL;
 
 	crtc_ = nullptr;
-	plane_ = nullptr;
 	mode_ = nullptr;
+	layers_.clear();
+	buffers_.clear();
 
 	const libcamera::StreamConfiguration &cfg = config.at(0);
 
-	/* Find the best mode for the stream size. */
+	/* Find the best mode for the size of the first stream. */
 	const std::vector<DRM::Mode> &modes = connector_->modes();
 
 	unsigned int cfgArea = cfg.size.width * cfg.size.height;
@@ -146,15 +181,31 @@ int KMSSink::configure(const libcamera::CameraConfiguration &config)
 	if (ret < 0)
 		return ret;
 
-	size_ = cfg.size;
-	stride_ = cfg.stride;
+	Layer &primary = layers_.front();
+	primary.stream = cfg.stream();
+	primary.size = cfg.size;
+	primary.stride = cfg.stride;
+	configureColorSpace(primary, cfg);
+
+	/* Display the other streams on overlay planes. */
+	for (unsigned int i = 1; i < config.size(); ++i) {
+		ret = configureOverlay(config.at(i));
+		if (ret < 0)
+			return ret;
+	}
 
-	/* Configure color space. */
-	colorEncoding_ = std::nullopt;
-	colorRange_ = std::nullopt;
+	return 0;
+}
 
-	if (cfg.colorSpace->ycbcrEncoding == libcamera::ColorSpace::YcbcrEncoding::None)
-		return 0;
+void KMSSink::configureColorSpace(Layer &layer,
+				  const libcamera::StreamConfiguration &cfg)
+{
+	layer.colorEncoding = std::nullopt;
+	layer.colorRange = std::nullopt;
+
+	if (!cfg.colorSpace ||
+	    cfg.colorSpace->ycbcrEncoding == libcamera::ColorSpace::YcbcrEncoding::None)
+		return;
 
 	/*
 	 * The encoding and range enums are defined in the kernel but not
@@ -171,8 +222,8 @@ int KMSSink::configure(const libcamera::CameraConfiguration &config)
 		DRM_COLOR_YCBCR_FULL_RANGE,
 	};
 
-	const DRM::Property *colorEncoding = plane_->property("COLOR_ENCODING");
-	const DRM::Property *colorRange = plane_->property("COLOR_RANGE");
+	const DRM::Property *colorEncoding = layer.plane->property("COLOR_ENCODING");
+	const DRM::Property *colorRange = layer.plane->property("COLOR_RANGE");
 
 	if (colorEncoding) {
 		drm_color_encoding encoding;
@@ -192,7 +243,7 @@ int KMSSink::configure(const libcamera::CameraConfiguration &config)
 
 		for (const auto &[id, name] : colorEncoding->enums()) {
 			if (id == encoding) {
-				colorEncoding_ = encoding;
+				layer.colorEncoding = encoding;
 				break;
 			}
 		}
@@ -213,18 +264,16 @@ int KMSSink::configure(const libcamera::CameraConfiguration &config)
 
 		for (const auto &[id, name] : colorRange->enums()) {
 			if (id == range) {
-				colorRange_ = range;
+				layer.colorRange = range;
 				break;
 			}
 		}
 	}
 
-	if (!colorEncoding_ || !colorRange_)
+	if (!layer.colorEncoding || !layer.colorRange)
 		std::cerr << "Color space " << cfg.colorSpace->toString()
 			  << " not supported by the display device."
 			  << " Colors may be wrong." << std::endl;
-
-	return 0;
 }
 
 int KMSSink::selectPipeline(const libcamera::PixelFormat &format)
@@ -233,27 +282,12 @@ int KMSSink::selectPipeline(const libcamera::PixelFormat &format)
 	 * If the requested format has an alpha channel, also consider the X
 	 * variant.
 	 */
-	libcamera::PixelFormat xFormat;
-
-	switch (format) {
-	case libcamera::formats::ABGR8888:
-		xFormat = libcamera::formats::XBGR8888;
-		break;
-	case libcamera::formats::ARGB8888:
-		xFormat = libcamera::formats::XRGB8888;
-		break;
-	case libcamera::formats::BGRA8888:
-		xFormat = libcamera::formats::BGRX8888;
-		break;
-	case libcamera::formats::RGBA8888:
-		xFormat = libcamera::formats::RGBX8888;
-		break;
-	}
+	libcamera::PixelFormat xFormat = opaqueFormat(format);
 
 	/*
 	 * Find a CRTC and plane suitable for the request format and the
 	 * connector at the end of the pipeline. Restrict the search to primary
-	 * planes for now.
+	 * planes, overlay planes are then picked for the other streams.
 	 */
 	for (const DRM::Encoder *encoder : connector_->encoders()) {
 		for (const DRM::Crtc *crtc : encoder->possibleCrtcs()) {
@@ -261,19 +295,21 @@ int KMSSink::selectPipeline(const libcamera::PixelFormat &format)
 				if (plane->type() != DRM::Plane::TypePrimary)
 					continue;
 
-				if (plane->supportsFormat(format)) {
-					crtc_ = crtc;
-					plane_ = plane;
-					format_ = format;
-					return 0;
-				}
-
-				if (plane->supportsFormat(xFormat)) {
-					crtc_ = crtc;
-					plane_ = plane;
-					format_ = xFormat;
-					return 0;
-				}
+				libcamera::PixelFormat planeFormat;
+				if (plane->supportsFormat(format))
+					planeFormat = format;
+				else if (xFormat.isValid() && plane->supportsFormat(xFormat))
+					planeFormat = xFormat;
+				else
+					continue;
+
+				crtc_ = crtc;
+
+				Layer layer{};
+				layer.plane = plane;
+				layer.format = planeFormat;
+				layers_.push_back(layer);
+				return 0;
 			}
 		}
 	}
@@ -293,14 +329,60 @@ int KMSSink::configurePipeline(const libcamera::PixelFormat &format)
 	}
 
 	std::cout
-		<< "Using KMS plane " << plane_->id() << ", CRTC " << crtc_->id()
-		<< ", connector " << connector_->name()
+		<< "Using KMS plane " << layers_.front().plane->id() << ", CRTC "
+		<< crtc_->id() << ", connector " << connector_->name()
 		<< " (" << connector_->id() << "), mode " << mode_->hdisplay
 		<< "x" << mode_->vdisplay << "@" << mode_->vrefresh << std::endl;
 
 	return 0;
 }
 
+int KMSSink::configureOverlay(const libcamera::StreamConfiguration &cfg)
+{
+	libcamera::PixelFormat xFormat = opaqueFormat(cfg.pixelFormat);
+
+	for (const DRM::Plane *plane : crtc_->planes()) {
+		if (plane->type() != DRM::Plane::TypeOverlay)
+			continue;
+
+		bool used = std::any_of(layers_.begin(), layers_.end(),
+					[plane](const Layer &layer) {
+						return layer.plane == plane;
+					});
+		if (used)
+			continue;
+
+		libcamera::PixelFormat planeFormat;
+		if (plane->supportsFormat(cfg.pixelFormat))
+			planeFormat = cfg.pixelFormat;
+		else if (xFormat.isValid() && plane->supportsFormat(xFormat))
+			planeFormat = xFormat;
+		else
+			continue;
+
+		Layer layer{};
+		layer.stream = cfg.stream();
+		layer.plane = plane;
+		layer.format = planeFormat;
+		layer.size = cfg.size;
+		layer.stride = cfg.stride;
+		configureColorSpace(layer, cfg);
+		layers_.push_back(layer);
+
+		std::cout
+			<< "Using KMS overlay plane " << plane->id()
+			<< " for stream " << cfg.toString() << std::endl;
+
+		return 0;
+	}
+
+	std::cerr
+		<< "Unable to find overlay plane for format "
+		<< cfg.pixelFormat << std::endl;
+
+	return -EPIPE;
+}
+
 int KMSSink::start()
 {
 	int ret = FrameSink::start();
@@ -337,8 +419,14 @@ int KMSSink::stop()
 	request.addProperty(connector_, "CRTC_ID", 0);
 	request.addProperty(crtc_, "ACTIVE", 0);
 	request.addProperty(crtc_, "MODE_ID", 0);
-	request.addProperty(plane_, "CRTC_ID", 0);
-	request.addProperty(plane_, "FB_ID", 0);
+
+	for (const Layer &layer : layers_) {
+		if (!layer.plane)
+			continue;
+
+		request.addProperty(layer.plane, "CRTC_ID", 0);
+		request.addProperty(layer.plane, "FB_ID", 0);
+	}
 
 	int ret = request.commit(DRM::AtomicRequest::FlagAllowModeset);
 	if (ret < 0) {
@@ -348,36 +436,76 @@ int KMSSink::stop()
 		return ret;
 	}
 
+	if (displayed_) {
+		std::cout
+			<< "KMS: " << displayed_ << " frames displayed, "
+			<< dropped_ << " dropped, latency avg "
+			<< totalLatency_ / displayed_ / 1000 << " us, max "
+			<< maxLatency_ / 1000 << " us";
+		if (displayed_ > 1)
+			std::cout << ", flip period avg "
+				  << totalPeriod_ / (displayed_ - 1) / 1000 << " us";
+		std::cout << std::endl;
+	}
+
 	/* Free all buffers. */
-	pending_.reset();
+	pending_.clear();
 	queued_.reset();
 	active_.reset();
 	buffers_.clear();
 
+	displayed_ = 0;
+	dropped_ = 0;
+	totalLatency_ = 0;
+	maxLatency_ = 0;
+	lastVblank_ = 0;
+	totalPeriod_ = 0;
+
 	return FrameSink::stop();
 }
 
+void KMSSink::addPipeline(DRM::AtomicRequest *request)
+{
+	request->addProperty(connector_, "CRTC_ID", crtc_->id());
+
+	request->addProperty(crtc_, "ACTIVE", 1);
+	request->addProperty(crtc_, "MODE_ID", mode_->toBlob(&dev_));
+}
+
+void KMSSink::addLayer(DRM::AtomicRequest *request, const Layer &layer,
+		       const DRM::FrameBuffer *drmBuffer)
+{
+	const DRM::Plane *plane = layer.plane;
+
+	request->addProperty(plane, "CRTC_ID", crtc_->id());
+	request->addProperty(plane, "FB_ID", drmBuffer->id());
+	request->addProperty(plane, "SRC_X", layer.src.x << 16);
+	request->addProperty(plane, "SRC_Y", layer.src.y << 16);
+	request->addProperty(plane, "SRC_W", layer.src.width << 16);
+	request->addProperty(plane, "SRC_H", layer.src.height << 16);
+	request->addProperty(plane, "CRTC_X", layer.dst.x);
+	request->addProperty(plane, "CRTC_Y", layer.dst.y);
+	request->addProperty(plane, "CRTC_W", layer.dst.width);
+	request->addProperty(plane, "CRTC_H", layer.dst.height);
+
+	if (layer.colorEncoding)
+		request->addProperty(plane, "COLOR_ENCODING", *layer.colorEncoding);
+	if (layer.colorRange)
+		request->addProperty(plane, "COLOR_RANGE", *layer.colorRange);
+}
+
 bool KMSSink::testModeSet(DRM::FrameBuffer *drmBuffer,
 			  const libcamera::Rectangle &src,
 			  const libcamera::Rectangle &dst)
 {
 	DRM::AtomicRequest drmRequest{ &dev_ };
 
-	drmRequest.addProperty(connector_, "CRTC_ID", crtc_->id());
-
-	drmRequest.addProperty(crtc_, "ACTIVE", 1);
-	drmRequest.addProperty(crtc_, "MODE_ID", mode_->toBlob(&dev_));
+	Layer layer = layers_.front();
+	layer.src = src;
+	layer.dst = dst;
 
-	drmRequest.addProperty(plane_, "CRTC_ID", crtc_->id());
-	drmRequest.addProperty(plane_, "FB_ID", drmBuffer->id());
-	drmRequest.addProperty(plane_, "SRC_X", src.x << 16);
-	drmRequest.addProperty(plane_, "SRC_Y", src.y << 16);
-	drmRequest.addProperty(plane_, "SRC_W", src.width << 16);
-	drmRequest.addProperty(plane_, "SRC_H", src.height << 16);
-	drmRequest.addProperty(plane_, "CRTC_X", dst.x);
-	drmRequest.addProperty(plane_, "CRTC_Y", dst.y);
-	drmRequest.addProperty(plane_, "CRTC_W", dst.width);
-	drmRequest.addProperty(plane_, "CRTC_H", dst.height);
+	addPipeline(&drmRequest);
+	addLayer(&drmRequest, layer, drmBuffer);
 
 	return !drmRequest.commit(DRM::AtomicRequest::FlagAllowModeset |
 				  DRM::AtomicRequest::FlagTestOnly);
@@ -389,7 +517,8 @@ bool KMSSink::setupComposition(DRM::FrameBuffer *drmBuffer)
 	 * Test composition options, from most to least desirable, to select the
 	 * best one.
 	 */
-	const libcamera::Rectangle framebuffer{ size_ };
+	Layer &primary = layers_.front();
+	const libcamera::Rectangle framebuffer{ primary.size };
 	const libcamera::Rectangle display{ 0, 0, mode_->hdisplay, mode_->vdisplay };
 
 	/* 1. Scale the frame buffer to full screen, preserving aspect ratio. */
@@ -400,8 +529,8 @@ bool KMSSink::setupComposition(DRM::FrameBuffer *drmBuffer)
 	if (testModeSet(drmBuffer, src, dst)) {
 		std::cout << "KMS: full-screen scaled output, square pixels"
 			  << std::endl;
-		src_ = src;
-		dst_ = dst;
+		primary.src = src;
+		primary.dst = dst;
 		return true;
 	}
 
@@ -415,8 +544,8 @@ bool KMSSink::setupComposition(DRM::FrameBuffer *drmBuffer)
 	if (testModeSet(drmBuffer, src, dst)) {
 		std::cout << "KMS: full-screen scaled output, non-square pixels"
 			  << std::endl;
-		src_ = src;
-		dst_ = dst;
+		primary.src = src;
+		primary.dst = dst;
 		return true;
 	}
 
@@ -426,8 +555,8 @@ bool KMSSink::setupComposition(DRM::FrameBuffer *drmBuffer)
 
 	if (testModeSet(drmBuffer, src, dst)) {
 		std::cout << "KMS: centered output" << std::endl;
-		src_ = src;
-		dst_ = dst;
+		primary.src = src;
+		primary.dst = dst;
 		return true;
 	}
 
@@ -437,71 +566,128 @@ bool KMSSink::setupComposition(DRM::FrameBuffer *drmBuffer)
 
 	if (testModeSet(drmBuffer, src, dst)) {
 		std::cout << "KMS: top-left aligned output" << std::endl;
-		src_ = src;
-		dst_ = dst;
+		primary.src = src;
+		primary.dst = dst;
 		return true;
 	}
 
 	return false;
 }
 
-bool KMSSink::processRequest(libcamera::Request *camRequest)
+bool KMSSink::setupOverlay(Layer &layer, DRM::FrameBuffer *drmBuffer,
+			   DRM::FrameBuffer *primaryBuffer, unsigned int *bottom)
 {
 	/*
-	 * Perform a very crude rate adaptation by simply dropping the request
-	 * if the display queue is full.
+	 * Stack the overlays from the bottom-right corner of the display, as
+	 * pictures-in-picture scaled down to a third of the display size. Fall
+	 * back to cropping if the plane can't scale.
 	 */
-	if (pending_)
-		return true;
+	const libcamera::Rectangle framebuffer{ layer.size };
+	const libcamera::Size area{ mode_->hdisplay / 3U, mode_->vdisplay / 3U };
 
-	libcamera::FrameBuffer *buffer = camRequest->buffers().begin()->second;
-	auto iter = buffers_.find(buffer);
-	if (iter == buffers_.end())
-		return true;
+	std::array<std::pair<libcamera::Rectangle, libcamera::Size>, 2> options{ {
+		{ framebuffer, area.boundedToAspectRatio(layer.size) },
+		{ framebuffer.size().boundedTo(area).centeredTo(framebuffer.center()),
+		  layer.size.boundedTo(area) },
+	} };
+
+	for (const auto &[src, size] : options) {
+		if (size.isNull() || size.height > *bottom)
+			continue;
 
-	DRM::FrameBuffer *drmBuffer = iter->second.get();
+		layer.src = src;
+		layer.dst = libcamera::Rectangle(mode_->hdisplay - size.width,
+						 *bottom - size.height, size);
+
+		DRM::AtomicRequest drmRequest{ &dev_ };
+
+		addPipeline(&drmRequest);
+		addLayer(&drmRequest, layers_.front(), primaryBuffer);
+		addLayer(&drmRequest, layer, drmBuffer);
+
+		if (!drmRequest.commit(DRM::AtomicRequest::FlagAllowModeset |
+				       DRM::AtomicRequest::FlagTestOnly)) {
+			*bottom = layer.dst.y;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool KMSSink::processRequest(libcamera::Request *camRequest)
+{
+	std::lock_guard<std::mutex> lock(lock_);
 
 	unsigned int flags = DRM::AtomicRequest::FlagAsync;
 	std::unique_ptr<DRM::AtomicRequest> drmRequest =
 		std::make_unique<DRM::AtomicRequest>(&dev_);
-	drmRequest->addProperty(plane_, "FB_ID", drmBuffer->id());
 
-	if (!active_ && !queued_) {
-		/* Enable the display pipeline on the first frame. */
-		if (!setupComposition(drmBuffer)) {
+	if (!active_ && !queued_ && pending_.empty()) {
+		/*
+		 * Enable the display pipeline on the first frame, which must
+		 * contain a buffer for the primary plane. Overlays without a
+		 * buffer in the first frame are disabled.
+		 */
+		Layer &primary = layers_.front();
+		libcamera::FrameBuffer *buffer = camRequest->findBuffer(primary.stream);
+		DRM::FrameBuffer *primaryBuffer = buffer ? drmBuffer(primary, buffer) : nullptr;
+		if (!primaryBuffer)
+			return true;
+
+		if (!setupComposition(primaryBuffer)) {
 			std::cerr << "Failed to setup composition" << std::endl;
 			return true;
 		}
 
-		drmRequest->addProperty(connector_, "CRTC_ID", crtc_->id());
+		unsigned int bottom = mode_->vdisplay;
 
-		drmRequest->addProperty(crtc_, "ACTIVE", 1);
-		drmRequest->addProperty(crtc_, "MODE_ID", mode_->toBlob(&dev_));
+		for (Layer &layer : layers_) {
+			if (&layer == &primary || !layer.plane)
+				continue;
 
-		drmRequest->addProperty(plane_, "CRTC_ID", crtc_->id());
-		drmRequest->addProperty(plane_, "SRC_X", src_.x << 16);
-		drmRequest->addProperty(plane_, "SRC_Y", src_.y << 16);
-		drmRequest->addProperty(plane_, "SRC_W", src_.width << 16);
-		drmRequest->addProperty(plane_, "SRC_H", src_.height << 16);
-		drmRequest->addProperty(plane_, "CRTC_X", dst_.x);
-		drmRequest->addProperty(plane_, "CRTC_Y", dst_.y);
-		drmRequest->addProperty(plane_, "CRTC_W", dst_.width);
-		drmRequest->addProperty(plane_, "CRTC_H", dst_.height);
+			buffer = camRequest->findBuffer(layer.stream);
+			DRM::FrameBuffer *overlayBuffer = buffer ? drmBuffer(layer, buffer) : nullptr;
+			if (overlayBuffer &&
+			    setupOverlay(layer, overlayBuffer, primaryBuffer, &bottom))
+				continue;
 
-		if (colorEncoding_)
-			drmRequest->addProperty(plane_, "COLOR_ENCODING", *colorEncoding_);
-		if (colorRange_)
-			drmRequest->addProperty(plane_, "COLOR_RANGE", *colorRange_);
+			std::cerr
+				<< "Failed to setup composition for overlay plane "
+				<< layer.plane->id() << ", disabling it" << std::endl;
+			layer.plane = nullptr;
+		}
 
+		addPipeline(drmRequest.get());
 		flags |= DRM::AtomicRequest::FlagAllowModeset;
 	}
 
-	pending_ = std::make_unique<Request>(std::move(drmRequest), camRequest);
+	/* Update all the planes in a single atomic commit. */
+	bool empty = true;
 
-	std::lock_guard<std::mutex> lock(lock_);
+	for (const Layer &layer : layers_) {
+		if (!layer.plane)
+			continue;
+
+		libcamera::FrameBuffer *buffer = camRequest->findBuffer(layer.stream);
+		if (!buffer)
+			continue;
+
+		DRM::FrameBuffer *fb = drmBuffer(layer, buffer);
+		if (!fb)
+			continue;
+
+		addLayer(drmRequest.get(), layer, fb);
+		empty = false;
+	}
+
+	if (empty)
+		return true;
+
+	auto request = std::make_unique<Request>(std::move(drmRequest), camRequest);
 
 	if (!queued_) {
-		int ret = pending_->drmRequest_->commit(flags);
+		int ret = request->drmRequest_->commit(flags);
 		if (ret < 0) {
 			std::cerr
 				<< "Failed to commit atomic request: "
@@ -509,18 +695,52 @@ bool KMSSink::processRequest(libcamera::Request *camRequest)
 			/* \todo Implement error handling */
 		}
 
-		queued_ = std::move(pending_);
+		queued_ = std::move(request);
+		return false;
+	}
+
+	/*
+	 * A page flip is pending, queue the request until it completes. Drop
+	 * the oldest requests if the queue is full.
+	 */
+	pending_.push_back(std::move(request));
+
+	while (pending_.size() > kMaxPending) {
+		requestProcessed.emit(pending_.front()->camRequest_);
+		pending_.pop_front();
+		dropped_++;
 	}
 
 	return false;
 }
 
-void KMSSink::requestComplete([[maybe_unused]] DRM::AtomicRequest *request)
+void KMSSink::requestComplete(DRM::AtomicRequest *request)
 {
 	std::lock_guard<std::mutex> lock(lock_);
 
 	assert(queued_ && queued_->drmRequest_.get() == request);
 
+	/*
+	 * Measure the display latency from the capture timestamp of the first
+	 * buffer to the vblank at which the frame was displayed. Both use
+	 * CLOCK_MONOTONIC.
+	 */
+	uint64_t vblank = request->timestamp();
+	const libcamera::Request::BufferMap &buffers = queued_->camRequest_->buffers();
+	if (!buffers.empty()) {
+		uint64_t timestamp = buffers.begin()->second->metadata().timestamp;
+		if (vblank > timestamp) {
+			uint64_t latency = vblank - timestamp;
+			totalLatency_ += latency;
+			maxLatency_ = std::max(maxLatency_, latency);
+		}
+	}
+
+	if (lastVblank_ && vblank > lastVblank_)
+		totalPeriod_ += vblank - lastVblank_;
+	lastVblank_ = vblank;
+	displayed_++;
+
 	/* Complete the active request, if any. */
 	if (active_)
 		requestProcessed.emit(active_->camRequest_);
@@ -528,9 +748,22 @@ void KMSSink::requestComplete([[maybe_unused]] DRM::AtomicRequest *request)
 	/* The queued request becomes active. */
 	active_ = std::move(queued_);
 
-	/* Queue the pending request, if any. */
-	if (pending_) {
-		pending_->drmRequest_->commit(DRM::AtomicRequest::FlagAsync);
-		queued_ = std::move(pending_);
+	if (pending_.empty())
+		return;
+
+	/*
+	 * Queue the most recent pending request for the next vblank, and
+	 * release the older ones, to minimize the display latency when the
+	 * camera runs faster than the display.
+	 */
+	while (pending_.size() > 1) {
+		requestProcessed.emit(pending_.front()->camRequest_);
+		pending_.pop_front();
+		dropped_++;
 	}
+
+	queued_ = std::move(pending_.front());
+	pending_.pop_front();
+
+	queued_->drmRequest_->commit(DRM::AtomicRequest::FlagAsync);
 }
@@ -7,17 +7,22 @@
 
 #pragma once
 
+#include <deque>
 #include <list>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <stdint.h>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <libcamera/base/signal.h>
 
 #include <libcamera/geometry.h>
 #include <libcamera/pixel_format.h>
+#include <libcamera/stream.h>
 
 #include "drm.h"
 #include "frame_sink.h"
@@ -27,8 +32,6 @@ class KMSSink : public FrameSink
 public:
 	KMSSink(const std::string &connectorName);
 
-	void mapBuffer(libcamera::FrameBuffer *buffer) override;
-
 	int configure(const libcamera::CameraConfiguration &config) override;
 	int start() override;
 	int stop() override;
@@ -36,6 +39,9 @@ public:
 	bool processRequest(libcamera::Request *request) override;
 
 private:
+	/* Maximum number of requests waiting to be committed. */
+	static constexpr unsigned int kMaxPending = 2;
+
 	class Request
 	{
 	public:
@@ -49,12 +55,39 @@ private:
 		libcamera::Request *camRequest_;
 	};
 
+	/* A stream displayed on a KMS plane. */
+	struct Layer {
+		const libcamera::Stream *stream;
+		const DRM::Plane *plane;
+
+		libcamera::PixelFormat format;
+		libcamera::Size size;
+		unsigned int stride;
+		std::optional<unsigned int> colorEncoding;
+		std::optional<unsigned int> colorRange;
+
+		libcamera::Rectangle src;
+		libcamera::Rectangle dst;
+	};
+
 	int selectPipeline(const libcamera::PixelFormat &format);
 	int configurePipeline(const libcamera::PixelFormat &format);
+	int configureOverlay(const libcamera::StreamConfiguration &cfg);
+	void configureColorSpace(Layer &layer,
+				 const libcamera::StreamConfiguration &cfg);
+
+	DRM::FrameBuffer *drmBuffer(const Layer &layer,
+				    libcamera::FrameBuffer *buffer);
+	void addPipeline(DRM::AtomicRequest *request);
+	void addLayer(DRM::AtomicRequest *request, const Layer &layer,
+		      const DRM::FrameBuffer *drmBuffer);
+
 	bool testModeSet(DRM::FrameBuffer *drmBuffer,
 			 const libcamera::Rectangle &src,
 			 const libcamera::Rectangle &dst);
 	bool setupComposition(DRM::FrameBuffer *drmBuffer);
+	bool setupOverlay(Layer &layer, DRM::FrameBuffer *drmBuffer,
+			  DRM::FrameBuffer *primaryBuffer, unsigned int *bottom);
 
 	void requestComplete(DRM::AtomicRequest *request);
 
@@ -62,22 +95,27 @@ private:
 
 	const DRM::Connector *connector_;
 	const DRM::Crtc *crtc_;
-	const DRM::Plane *plane_;
 	const DRM::Mode *mode_;
 
-	libcamera::PixelFormat format_;
-	libcamera::Size size_;
-	unsigned int stride_;
-	std::optional<unsigned int> colorEncoding_;
-	std::optional<unsigned int> colorRange_;
-
-	libcamera::Rectangle src_;
-	libcamera::Rectangle dst_;
+	/*
+	 * The first layer is displayed on the primary plane, the other ones on
+	 * overlay planes. Layers whose composition can't be set up have a null
+	 * plane.
+	 */
+	std::vector<Layer> layers_;
 
 	std::map<libcamera::FrameBuffer *, std::unique_ptr<DRM::FrameBuffer>> buffers_;
 
 	std::mutex lock_;
-	std::unique_ptr<Request> pending_;
+	std::deque<std::unique_ptr<Request>> pending_;
 	std::unique_ptr<Request> queued_;
 	std::unique_ptr<Request> active_;
+
+	/* Display statistics, to evaluate the latency. */
+	unsigned int displayed_;
+	unsigned int dropped_;
+	uint64_t totalLatency_;
+	uint64_t maxLatency_;
+	uint64_t lastVblank_;
+	uint64_t totalPeriod_;
 };
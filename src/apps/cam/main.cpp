@@ -140,7 +140,8 @@ int CamApp::parseOptions(int argc, char *argv[])
 			 OptCamera);
 #ifdef HAVE_KMS
 	parser.addOption(OptDisplay, OptionString,
-			 "Display viewfinder through DRM/KMS on specified connector",
+			 "Display viewfinder through DRM/KMS on specified connector. Additional\n"
+			 "streams are displayed on overlay planes",
 			 "display", ArgumentOptional, "connector", false,
 			 OptCamera);
 #endif
@@ -150,6 +151,10 @@ int CamApp::parseOptions(int argc, char *argv[])
 			 "to write files, using the default file name. Otherwise it sets the\n"
 			 "full file path and name. The first '#' character in the file name\n"
 			 "is expanded to the camera index, stream name and frame sequence number.\n"
+			 "Without a '#', all frames are appended to the same file, and indexed\n"
+			 "in a file with the same name and an '.idx' suffix.\n"
+			 "If the file name ends with '.lcfs', all frames are written to a single\n"
+			 "memory-mappable container file, along with their metadata.\n"
 #ifdef HAVE_TIFF
 			 "If the file name ends with '.dng', then the frame will be written to\n"
 			 "the output file(s) in DNG format.\n"
@@ -176,6 +181,12 @@ int CamApp::parseOptions(int argc, char *argv[])
 			 "Load a capture session configuration script from a file",
 			 "script", ArgumentRequired, "script", false,
 			 OptCamera);
+	parser.addOption(OptStats, OptionString,
+			 "Report per-stream latency, frame interval, jitter and dropped frames\n"
+			 "statistics when the capture stops, instead of printing a line per frame.\n"
+			 "If a file name is given, per-frame samples are written to it in CSV format",
+			 "stats", ArgumentOptional, "csv-file", false,
+			 OptCamera);
 
 	options_ = parser.parse(argc, argv);
 	if (!options_.valid())
@@ -10,6 +10,7 @@
 #include <iostream>
 #include <setjmp.h>
 #include <stdio.h>
+#include <vector>
 
 #include <jpeglib.h>
 
@@ -38,15 +39,24 @@ struct JpegErrorManager : public jpeg_error_mgr {
 };
 
 SDLTextureMJPG::SDLTextureMJPG(const SDL_Rect &rect)
-	: SDLTexture(rect, SDL_PIXELFORMAT_RGB24, rect.w * 3),
-	  rgb_(std::make_unique<unsigned char[]>(stride_ * rect.h))
+	: SDLTexture(rect, SDL_PIXELFORMAT_RGB24, rect.w * 3)
 {
 }
 
-int SDLTextureMJPG::decompress(Span<const uint8_t> data)
+int SDLTextureMJPG::decompress(Span<const uint8_t> data, unsigned char *pixels,
+			       int pitch)
 {
 	struct jpeg_decompress_struct cinfo;
 
+	/*
+	 * Decode straight to the texture memory, letting libjpeg process as
+	 * many lines as it can in each call. The row pointers are set up
+	 * before setjmp() as longjmp() must not skip their destructor.
+	 */
+	std::vector<JSAMPROW> rows(rect_.h);
+	for (int i = 0; i < rect_.h; ++i)
+		rows[i] = pixels + i * pitch;
+
 	JpegErrorManager errorManager;
 	if (setjmp(errorManager.escape_)) {
 		/* libjpeg found an error */
@@ -62,13 +72,24 @@ int SDLTextureMJPG::decompress(Span<const uint8_t> data)
 
 	jpeg_read_header(&cinfo, TRUE);
 
+	cinfo.out_color_space = JCS_RGB;
+
 	jpeg_start_decompress(&cinfo);
 
-	for (int i = 0; cinfo.output_scanline < cinfo.output_height; ++i) {
-		JSAMPROW rowptr = rgb_.get() + i * stride_;
-		jpeg_read_scanlines(&cinfo, &rowptr, 1);
+	if (cinfo.output_width != static_cast<unsigned int>(rect_.w) ||
+	    cinfo.output_height != static_cast<unsigned int>(rect_.h) ||
+	    cinfo.output_components != 3) {
+		std::cerr << "Unexpected JPEG frame size "
+			  << cinfo.output_width << "x" << cinfo.output_height
+			  << std::endl;
+		jpeg_destroy_decompress(&cinfo);
+		return -EINVAL;
 	}
 
+	while (cinfo.output_scanline < cinfo.output_height)
+		jpeg_read_scanlines(&cinfo, &rows[cinfo.output_scanline],
+				    cinfo.output_height - cinfo.output_scanline);
+
 	jpeg_finish_decompress(&cinfo);
 
 	jpeg_destroy_decompress(&cinfo);
@@ -78,6 +99,16 @@ int SDLTextureMJPG::decompress(Span<const uint8_t> data)
 
 void SDLTextureMJPG::update(const std::vector<libcamera::Span<const uint8_t>> &data)
 {
-	decompress(data[0]);
-	SDL_UpdateTexture(ptr_, nullptr, rgb_.get(), stride_);
+	void *pixels;
+	int pitch;
+
+	if (SDL_LockTexture(ptr_, nullptr, &pixels, &pitch)) {
+		std::cerr << "Failed to lock SDL texture: " << SDL_GetError()
+			  << std::endl;
+		return;
+	}
+
+	decompress(data[0], static_cast<unsigned char *>(pixels), pitch);
+
+	SDL_UnlockTexture(ptr_);
 }
@@ -17,7 +17,6 @@ public:
 	void update(const std::vector<libcamera::Span<const uint8_t>> &data) override;
 
 private:
-	int decompress(libcamera::Span<const uint8_t> data);
-
-	std::unique_ptr<unsigned char[]> rgb_;
+	int decompress(libcamera::Span<const uint8_t> data, unsigned char *pixels,
+		       int pitch);
 };
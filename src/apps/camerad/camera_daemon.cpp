@@ -0,0 +1,157 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * camera_daemon.cpp - camerad socket server
+ */
+
+#include "camera_daemon.h"
+
+#include <errno.h>
+#include <iostream>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "client.h"
+#include "shared_camera.h"
+
+using namespace camerad;
+using namespace libcamera;
+
+CameraDaemon::CameraDaemon(CameraManager *cm, const OptionValue &streams,
+			   unsigned int bufferCount)
+	: cm_(cm), streams_(streams), bufferCount_(bufferCount)
+{
+}
+
+CameraDaemon::~CameraDaemon()
+{
+	/* Clients detach from their camera when deleted, delete them first. */
+	for (Client *client : clients_)
+		delete client;
+	clients_.clear();
+
+	cameras_.clear();
+
+	if (socket_.isValid())
+		unlink(path_.c_str());
+}
+
+int CameraDaemon::listen(const std::string &path)
+{
+	struct sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+
+	if (path.size() >= sizeof(addr.sun_path)) {
+		std::cerr << "Socket path " << path << " too long" << std::endl;
+		return -ENAMETOOLONG;
+	}
+
+	memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+	/*
+	 * Sequenced packets preserve message boundaries, as required by
+	 * IPCUnixSocket, and report clients closing their connection.
+	 */
+	UniqueFD fd(socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+	if (!fd.isValid()) {
+		int ret = -errno;
+		std::cerr << "Failed to create socket: " << strerror(-ret) << std::endl;
+		return ret;
+	}
+
+	/* Remove the socket left behind by a previous instance, if any. */
+	struct stat st;
+	if (!lstat(path.c_str(), &st) && S_ISSOCK(st.st_mode))
+		unlink(path.c_str());
+
+	if (bind(fd.get(), reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) ||
+	    ::listen(fd.get(), SOMAXCONN)) {
+		int ret = -errno;
+		std::cerr << "Failed to listen on " << path << ": "
+			  << strerror(-ret) << std::endl;
+		return ret;
+	}
+
+	path_ = path;
+	socket_ = std::move(fd);
+
+	notifier_ = std::make_unique<EventNotifier>(socket_.get(), EventNotifier::Read);
+	notifier_->activated.connect(this, &CameraDaemon::acceptClient);
+
+	std::cout << "Listening on " << path_ << std::endl;
+
+	return 0;
+}
+
+void CameraDaemon::acceptClient()
+{
+	UniqueFD fd(accept4(socket_.get(), nullptr, nullptr,
+			    SOCK_NONBLOCK | SOCK_CLOEXEC));
+	if (!fd.isValid()) {
+		if (errno != EAGAIN)
+			std::cerr << "Failed to accept connection: "
+				  << strerror(errno) << std::endl;
+		return;
+	}
+
+	Client *client = new Client(std::move(fd));
+	if (client->init()) {
+		delete client;
+		return;
+	}
+
+	client->hello.connect(this, &CameraDaemon::clientHello);
+	client->closed.connect(this, &CameraDaemon::clientClosed);
+	clients_.insert(client);
+
+	std::cout << "Client " << client->pid() << " connected" << std::endl;
+}
+
+void CameraDaemon::clientHello(Client *client, const HelloMessage &message)
+{
+	SharedCamera *camera = findCamera(message.camera);
+	if (!camera) {
+		std::cerr << "Client " << client->pid() << ": camera '"
+			  << message.camera << "' not found" << std::endl;
+		client->sendError(-ENODEV);
+		client->disconnect();
+		return;
+	}
+
+	int ret = camera->addClient(client, message.maxFrames);
+	if (ret) {
+		client->sendError(ret);
+		client->disconnect();
+	}
+}
+
+void CameraDaemon::clientClosed(Client *client)
+{
+	clients_.erase(client);
+	client->deleteLater();
+}
+
+SharedCamera *CameraDaemon::findCamera(const std::string &id)
+{
+	std::shared_ptr<Camera> camera;
+
+	if (id.empty()) {
+		if (!cm_->cameras().empty())
+			camera = cm_->cameras()[0];
+	} else {
+		camera = cm_->get(id);
+	}
+
+	if (!camera)
+		return nullptr;
+
+	std::unique_ptr<SharedCamera> &shared = cameras_[camera->id()];
+	if (!shared)
+		shared = std::make_unique<SharedCamera>(camera, streams_, bufferCount_);
+
+	return shared.get();
+}
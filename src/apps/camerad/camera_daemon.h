@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * camera_daemon.h - camerad socket server
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include <libcamera/base/event_notifier.h>
+#include <libcamera/base/unique_fd.h>
+
+#include <libcamera/camera_manager.h>
+
+#include "../common/options.h"
+
+#include "protocol.h"
+
+class Client;
+class SharedCamera;
+
+class CameraDaemon
+{
+public:
+	CameraDaemon(libcamera::CameraManager *cm, const OptionValue &streams,
+		     unsigned int bufferCount);
+	~CameraDaemon();
+
+	int listen(const std::string &path);
+
+private:
+	void acceptClient();
+	void clientHello(Client *client, const camerad::HelloMessage &message);
+	void clientClosed(Client *client);
+
+	SharedCamera *findCamera(const std::string &id);
+
+	libcamera::CameraManager *cm_;
+	OptionValue streams_;
+	unsigned int bufferCount_;
+
+	std::string path_;
+	libcamera::UniqueFD socket_;
+	std::unique_ptr<libcamera::EventNotifier> notifier_;
+
+	std::set<Client *> clients_;
+	std::map<std::string, std::unique_ptr<SharedCamera>> cameras_;
+};
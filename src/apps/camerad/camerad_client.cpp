@@ -0,0 +1,274 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * camerad_client.cpp - camerad-client - Receive frames from camerad
+ */
+
+#include <errno.h>
+#include <iomanip>
+#include <iostream>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <vector>
+
+#include <libcamera/base/event_dispatcher.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/unique_fd.h>
+
+#include <libcamera/pixel_format.h>
+
+#include "libcamera/internal/ipc_unixsocket.h"
+
+#include "../common/options.h"
+
+#include "protocol.h"
+
+using namespace camerad;
+using namespace libcamera;
+
+enum {
+	OptCamera = 'c',
+	OptCapture = 'C',
+	OptHelp = 'h',
+	OptMaxFrames = 'm',
+	OptRate = 'r',
+	OptSocket = 'S',
+};
+
+namespace {
+
+class CameradClient
+{
+public:
+	CameradClient(unsigned int frames)
+		: frames_(frames), received_(0), exit_(false), exitCode_(EXIT_FAILURE)
+	{
+		socket_.readyRead.connect(this, &CameradClient::readyRead);
+		socket_.disconnected.connect(this, &CameradClient::disconnected);
+	}
+
+	int connect(const std::string &path)
+	{
+		struct sockaddr_un addr = {};
+		addr.sun_family = AF_UNIX;
+
+		if (path.size() >= sizeof(addr.sun_path))
+			return -ENAMETOOLONG;
+
+		memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+		UniqueFD fd(socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+		if (!fd.isValid())
+			return -errno;
+
+		if (::connect(fd.get(), reinterpret_cast<struct sockaddr *>(&addr),
+			      sizeof(addr)))
+			return -errno;
+
+		return socket_.bind(std::move(fd));
+	}
+
+	int hello(const std::string &camera, unsigned int maxFrameRate,
+		  unsigned int maxFrames)
+	{
+		HelloMessage message = {};
+		message.version = kProtocolVersion;
+		message.maxFrameRate = maxFrameRate;
+		message.maxFrames = maxFrames;
+		strncpy(message.camera, camera.c_str(), sizeof(message.camera) - 1);
+
+		return sendMessage(socket_, MessageType::Hello, message);
+	}
+
+	int run()
+	{
+		EventDispatcher *dispatcher = Thread::current()->eventDispatcher();
+
+		while (!exit_)
+			dispatcher->processEvents();
+
+		socket_.close();
+
+		return exitCode_;
+	}
+
+private:
+	void readyRead()
+	{
+		IPCUnixSocket::Payload payload;
+		if (socket_.receive(&payload))
+			return;
+
+		std::vector<UniqueFD> fds;
+		for (int32_t fd : payload.fds)
+			fds.emplace_back(fd);
+
+		switch (messageType(payload)) {
+		case MessageType::StreamInfo: {
+			StreamInfoMessage message;
+			if (!parseMessage(payload, &message))
+				break;
+
+			std::cout << "Stream " << message.width << "x" << message.height
+				  << "-" << PixelFormat(message.fourcc, message.modifier)
+				  << ", stride " << message.stride << ", "
+				  << message.bufferCount << " buffers, holding up to "
+				  << message.maxFrames << " frames" << std::endl;
+
+			buffers_.resize(message.bufferCount);
+			return;
+		}
+
+		case MessageType::Buffer: {
+			BufferMessage message;
+			if (!parseMessage(payload, &message) ||
+			    message.index >= buffers_.size() ||
+			    message.numPlanes != fds.size())
+				break;
+
+			/* The planes could be mapped here to access the frames. */
+			buffers_[message.index] = std::move(fds);
+			return;
+		}
+
+		case MessageType::Frame: {
+			FrameMessage message;
+			if (!parseMessage(payload, &message) ||
+			    message.index >= buffers_.size())
+				break;
+
+			std::cout << message.timestamp / 1000000000 << "."
+				  << std::setw(6) << std::setfill('0')
+				  << message.timestamp / 1000 % 1000000
+				  << " (" << std::setfill(' ') << std::setw(6)
+				  << message.sequence << ") buffer " << message.index
+				  << " bytesused " << message.bytesused[0] << std::endl;
+
+			ReleaseMessage release = { message.index };
+			if (sendMessage(socket_, MessageType::Release, release)) {
+				stop(EXIT_FAILURE);
+				return;
+			}
+
+			if (frames_ && ++received_ >= frames_)
+				stop(EXIT_SUCCESS);
+			return;
+		}
+
+		case MessageType::Error: {
+			ErrorMessage message;
+			if (!parseMessage(payload, &message))
+				break;
+
+			std::cerr << "Error from camerad: " << strerror(-message.error)
+				  << std::endl;
+			stop(EXIT_FAILURE);
+			return;
+		}
+
+		default:
+			break;
+		}
+
+		std::cerr << "Protocol error" << std::endl;
+		stop(EXIT_FAILURE);
+	}
+
+	void disconnected()
+	{
+		std::cerr << "Disconnected from camerad" << std::endl;
+		stop(frames_ ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+
+	void stop(int code)
+	{
+		exitCode_ = code;
+		exit_ = true;
+	}
+
+	IPCUnixSocket socket_;
+	std::vector<std::vector<UniqueFD>> buffers_;
+
+	unsigned int frames_;
+	unsigned int received_;
+	bool exit_;
+	int exitCode_;
+};
+
+int parseOptions(int argc, char **argv, OptionsParser::Options *options)
+{
+	OptionsParser parser;
+	parser.addOption(OptCamera, OptionString,
+			 "Camera id, the first camera is used by default",
+			 "camera", ArgumentRequired, "camera");
+	parser.addOption(OptCapture, OptionInteger,
+			 "Exit after receiving the given number of frames",
+			 "capture", ArgumentRequired, "count");
+	parser.addOption(OptHelp, OptionNone, "Display this help message",
+			 "help");
+	parser.addOption(OptMaxFrames, OptionInteger,
+			 "Maximum number of frames held at any time",
+			 "max-frames", ArgumentRequired, "count");
+	parser.addOption(OptRate, OptionInteger,
+			 "Maximum frame rate, in frames per second",
+			 "rate", ArgumentRequired, "fps");
+	parser.addOption(OptSocket, OptionString,
+			 "Path of the camerad socket (default /run/camerad.sock)",
+			 "socket", ArgumentRequired, "path");
+
+	*options = parser.parse(argc, argv);
+	if (!options->valid())
+		return -EINVAL;
+
+	if (options->isSet(OptHelp)) {
+		parser.usage();
+		return -EINTR;
+	}
+
+	return 0;
+}
+
+} /* namespace */
+
+int main(int argc, char **argv)
+{
+	OptionsParser::Options options;
+
+	int ret = parseOptions(argc, argv, &options);
+	if (ret == -EINTR)
+		return EXIT_SUCCESS;
+	if (ret < 0)
+		return EXIT_FAILURE;
+
+	std::string path = options.isSet(OptSocket)
+			 ? options[OptSocket].toString() : kDefaultSocketPath;
+	std::string camera = options.isSet(OptCamera)
+			   ? options[OptCamera].toString() : "";
+	unsigned int frames = options.isSet(OptCapture)
+			    ? options[OptCapture].toInteger() : 0;
+	unsigned int rate = options.isSet(OptRate)
+			  ? options[OptRate].toInteger() : 0;
+	unsigned int maxFrames = options.isSet(OptMaxFrames)
+			       ? options[OptMaxFrames].toInteger() : 0;
+
+	signal(SIGPIPE, SIG_IGN);
+
+	CameradClient client(frames);
+
+	ret = client.connect(path);
+	if (ret) {
+		std::cerr << "Failed to connect to " << path << ": "
+			  << strerror(-ret) << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	ret = client.hello(camera, rate, maxFrames);
+	if (ret)
+		return EXIT_FAILURE;
+
+	return client.run();
+}
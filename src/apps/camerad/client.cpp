@@ -0,0 +1,249 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * client.cpp - camerad client connection
+ */
+
+#include "client.h"
+
+#include <errno.h>
+#include <iostream>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "shared_camera.h"
+
+using namespace camerad;
+using namespace libcamera;
+
+Client::Client(UniqueFD fd)
+	: fd_(std::move(fd)), pid_(0), closing_(false), camera_(nullptr),
+	  maxFrames_(0), frameInterval_(0), nextFrame_(0), delivered_(0),
+	  dropped_(0)
+{
+}
+
+Client::~Client()
+{
+	detach();
+}
+
+int Client::init()
+{
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+	if (!getsockopt(fd_.get(), SOL_SOCKET, SO_PEERCRED, &cred, &len))
+		pid_ = cred.pid;
+
+	socket_.readyRead.connect(this, &Client::readyRead);
+	socket_.disconnected.connect(this, &Client::disconnect);
+
+	return socket_.bind(std::move(fd_));
+}
+
+/*
+ * Close the connection. This is called from signal handlers of the socket and
+ * while the shared camera iterates over its clients, the connection is thus
+ * closed asynchronously.
+ */
+void Client::disconnect()
+{
+	if (closing_)
+		return;
+
+	closing_ = true;
+	invokeMethod(&Client::close, ConnectionTypeQueued);
+}
+
+void Client::close()
+{
+	socket_.close();
+	detach();
+
+	std::cout << "Client " << pid_ << " disconnected, " << delivered_
+		  << " frames delivered, " << dropped_ << " dropped" << std::endl;
+
+	closed.emit(this);
+}
+
+/*
+ * Attach the client to a started camera, and send it the stream information
+ * and the buffers it will receive frames in.
+ */
+int Client::attach(SharedCamera *camera, const StreamInfoMessage &info,
+		   const std::vector<std::unique_ptr<FrameBuffer>> &buffers)
+{
+	int ret = sendMessage(socket_, MessageType::StreamInfo, info);
+	if (ret)
+		return ret;
+
+	for (unsigned int i = 0; i < buffers.size(); ++i) {
+		const std::vector<FrameBuffer::Plane> &planes = buffers[i]->planes();
+		if (planes.size() > kMaxPlanes)
+			return -EINVAL;
+
+		BufferMessage message = {};
+		std::vector<int32_t> fds;
+
+		message.index = i;
+		message.numPlanes = planes.size();
+		for (unsigned int j = 0; j < planes.size(); ++j) {
+			message.planes[j].offset = planes[j].offset;
+			message.planes[j].length = planes[j].length;
+			fds.push_back(planes[j].fd.get());
+		}
+
+		ret = sendMessage(socket_, MessageType::Buffer, message, fds);
+		if (ret)
+			return ret;
+	}
+
+	camera_ = camera;
+	maxFrames_ = info.maxFrames;
+
+	return 0;
+}
+
+/* Detach the client from its camera, releasing all the frames it holds. */
+void Client::detach()
+{
+	if (!camera_)
+		return;
+
+	SharedCamera *camera = camera_;
+	std::set<unsigned int> held = std::move(held_);
+
+	camera_ = nullptr;
+	held_.clear();
+
+	camera->removeClient(this, held);
+}
+
+/*
+ * Decide whether to deliver the frame captured at \a timestamp, based on the
+ * number of frames held by the client and its maximum frame rate. Frames are
+ * delivered on a fixed cadence, tolerating a quarter of the interval of
+ * jitter, so that decimating e.g. 30fps to 10fps delivers every third frame.
+ */
+bool Client::wantsFrame(uint64_t timestamp)
+{
+	if (closing_ || !camera_)
+		return false;
+
+	if (frameInterval_) {
+		if (timestamp + frameInterval_ / 4 < nextFrame_)
+			return false;
+
+		nextFrame_ += frameInterval_;
+		if (nextFrame_ <= timestamp)
+			nextFrame_ = timestamp + frameInterval_;
+	}
+
+	/* A client that doesn't keep up loses frames, but doesn't stall others. */
+	if (held_.size() >= maxFrames_) {
+		dropped_++;
+		return false;
+	}
+
+	return true;
+}
+
+int Client::sendFrame(unsigned int index, const FrameMetadata &metadata)
+{
+	FrameMessage message = {};
+	message.timestamp = metadata.timestamp;
+	message.index = index;
+	message.sequence = metadata.sequence;
+	message.status = metadata.status;
+
+	Span<const FrameMetadata::Plane> planes = metadata.planes();
+	for (unsigned int i = 0; i < planes.size() && i < kMaxPlanes; ++i)
+		message.bytesused[i] = planes[i].bytesused;
+
+	/*
+	 * The socket is non-blocking, a send failure means that the client
+	 * doesn't read its messages. Drop it.
+	 */
+	int ret = sendMessage(socket_, MessageType::Frame, message);
+	if (ret) {
+		std::cerr << "Client " << pid_ << ": failed to send frame: "
+			  << strerror(-ret) << std::endl;
+		disconnect();
+		return ret;
+	}
+
+	held_.insert(index);
+	delivered_++;
+
+	return 0;
+}
+
+void Client::sendError(int error)
+{
+	ErrorMessage message = { error };
+	sendMessage(socket_, MessageType::Error, message);
+}
+
+void Client::readyRead()
+{
+	IPCUnixSocket::Payload payload;
+
+	int ret = socket_.receive(&payload);
+	if (ret)
+		return;
+
+	/* Clients have no reason to send file descriptors. */
+	for (int32_t fd : payload.fds)
+		::close(fd);
+
+	if (closing_)
+		return;
+
+	switch (messageType(payload)) {
+	case MessageType::Hello: {
+		HelloMessage message;
+		if (camera_ || !parseMessage(payload, &message))
+			break;
+
+		if (message.version != kProtocolVersion) {
+			std::cerr << "Client " << pid_ << ": unsupported protocol version "
+				  << message.version << std::endl;
+			sendError(-EPROTONOSUPPORT);
+			disconnect();
+			return;
+		}
+
+		message.camera[sizeof(message.camera) - 1] = '\0';
+
+		if (message.maxFrameRate)
+			frameInterval_ = 1000000000ULL / message.maxFrameRate;
+
+		hello.emit(this, message);
+		return;
+	}
+
+	case MessageType::Release: {
+		ReleaseMessage message;
+		if (!camera_ || !parseMessage(payload, &message))
+			break;
+
+		if (!held_.erase(message.index)) {
+			std::cerr << "Client " << pid_ << ": frame " << message.index
+				  << " released but not held" << std::endl;
+			return;
+		}
+
+		camera_->release(message.index);
+		return;
+	}
+
+	default:
+		break;
+	}
+
+	std::cerr << "Client " << pid_ << ": protocol error" << std::endl;
+	sendError(-EPROTO);
+	disconnect();
+}
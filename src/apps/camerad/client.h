@@ -0,0 +1,71 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * client.h - camerad client connection
+ */
+
+#pragma once
+
+#include <memory>
+#include <set>
+#include <stdint.h>
+#include <sys/types.h>
+#include <vector>
+
+#include <libcamera/base/object.h>
+#include <libcamera/base/signal.h>
+#include <libcamera/base/unique_fd.h>
+
+#include <libcamera/framebuffer.h>
+
+#include "libcamera/internal/ipc_unixsocket.h"
+
+#include "protocol.h"
+
+class SharedCamera;
+
+class Client : public libcamera::Object
+{
+public:
+	Client(libcamera::UniqueFD fd);
+	~Client();
+
+	int init();
+	void disconnect();
+
+	pid_t pid() const { return pid_; }
+	SharedCamera *camera() const { return camera_; }
+	const std::set<unsigned int> &heldFrames() const { return held_; }
+
+	int attach(SharedCamera *camera, const camerad::StreamInfoMessage &info,
+		   const std::vector<std::unique_ptr<libcamera::FrameBuffer>> &buffers);
+	void detach();
+
+	bool wantsFrame(uint64_t timestamp);
+	int sendFrame(unsigned int index, const libcamera::FrameMetadata &metadata);
+	void sendError(int error);
+
+	libcamera::Signal<Client *, const camerad::HelloMessage &> hello;
+	libcamera::Signal<Client *> closed;
+
+private:
+	void readyRead();
+	void close();
+
+	libcamera::UniqueFD fd_;
+	libcamera::IPCUnixSocket socket_;
+	pid_t pid_;
+	bool closing_;
+
+	SharedCamera *camera_;
+	std::set<unsigned int> held_;
+	unsigned int maxFrames_;
+
+	/* Frame rate decimation, in nanoseconds */
+	uint64_t frameInterval_;
+	uint64_t nextFrame_;
+
+	unsigned int delivered_;
+	unsigned int dropped_;
+};
@@ -0,0 +1,148 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * main.cpp - camerad - Share cameras between multiple processes
+ */
+
+#include <atomic>
+#include <errno.h>
+#include <iostream>
+#include <memory>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libcamera/base/event_dispatcher.h>
+#include <libcamera/base/thread.h>
+
+#include <libcamera/libcamera.h>
+
+#include "../common/options.h"
+#include "../common/stream_options.h"
+
+#include "camera_daemon.h"
+#include "protocol.h"
+
+using namespace libcamera;
+
+enum {
+	OptBuffers = 'b',
+	OptHelp = 'h',
+	OptList = 'l',
+	OptSocket = 'S',
+	OptStream = 's',
+};
+
+namespace {
+
+std::atomic<bool> exitRequested;
+EventDispatcher *dispatcher;
+
+void signalHandler([[maybe_unused]] int signal)
+{
+	exitRequested = true;
+	dispatcher->interrupt();
+}
+
+int parseOptions(int argc, char **argv, StreamKeyValueParser *streamKeyValue,
+		 OptionsParser::Options *options)
+{
+	OptionsParser parser;
+	parser.addOption(OptBuffers, OptionInteger,
+			 "Number of buffers to allocate for each camera. Clients hold\n"
+			 "buffers while processing frames, more buffers than the\n"
+			 "pipeline handler default may be needed to avoid frame drops",
+			 "buffers", ArgumentRequired, "count");
+	parser.addOption(OptHelp, OptionNone, "Display this help message",
+			 "help");
+	parser.addOption(OptList, OptionNone, "List all cameras", "list");
+	parser.addOption(OptSocket, OptionString,
+			 "Path of the socket clients connect to (default /run/camerad.sock)",
+			 "socket", ArgumentRequired, "path");
+	parser.addOption(OptStream, streamKeyValue,
+			 "Set configuration of the camera stream shared with clients",
+			 "stream", true);
+
+	*options = parser.parse(argc, argv);
+	if (!options->valid())
+		return -EINVAL;
+
+	if (options->isSet(OptHelp)) {
+		parser.usage();
+		return -EINTR;
+	}
+
+	if (options->isSet(OptStream) && (*options)[OptStream].toArray().size() > 1) {
+		std::cerr << "Only one stream can be shared" << std::endl;
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+} /* namespace */
+
+int main(int argc, char **argv)
+{
+	StreamKeyValueParser streamKeyValue;
+	OptionsParser::Options options;
+
+	int ret = parseOptions(argc, argv, &streamKeyValue, &options);
+	if (ret == -EINTR)
+		return EXIT_SUCCESS;
+	if (ret < 0)
+		return EXIT_FAILURE;
+
+	std::unique_ptr<CameraManager> cm = std::make_unique<CameraManager>();
+
+	ret = cm->start();
+	if (ret) {
+		std::cerr << "Failed to start camera manager: "
+			  << strerror(-ret) << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (options.isSet(OptList)) {
+		std::cout << "Available cameras:" << std::endl;
+
+		for (const std::shared_ptr<Camera> &cam : cm->cameras())
+			std::cout << "- " << cam->id() << std::endl;
+
+		cm->stop();
+		return EXIT_SUCCESS;
+	}
+
+	unsigned int bufferCount = options.isSet(OptBuffers)
+				 ? options[OptBuffers].toInteger() : 0;
+	std::string path = options.isSet(OptSocket)
+			 ? options[OptSocket].toString()
+			 : camerad::kDefaultSocketPath;
+
+	{
+		CameraDaemon daemon(cm.get(), options[OptStream], bufferCount);
+
+		ret = daemon.listen(path);
+		if (ret) {
+			cm->stop();
+			return EXIT_FAILURE;
+		}
+
+		/* Writing to a client that has disconnected shall not kill us. */
+		signal(SIGPIPE, SIG_IGN);
+
+		dispatcher = Thread::current()->eventDispatcher();
+
+		struct sigaction sa = {};
+		sa.sa_handler = &signalHandler;
+		sigaction(SIGINT, &sa, nullptr);
+		sigaction(SIGTERM, &sa, nullptr);
+
+		while (!exitRequested)
+			dispatcher->processEvents();
+	}
+
+	cm->stop();
+
+	return EXIT_SUCCESS;
+}
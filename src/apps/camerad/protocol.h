@@ -0,0 +1,134 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * protocol.h - camerad client protocol
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <libcamera/base/span.h>
+
+#include "libcamera/internal/ipc_unixsocket.h"
+
+/*
+ * Clients connect to the daemon through a SOCK_SEQPACKET Unix socket, over
+ * which messages are exchanged with IPCUnixSocket. Each message is made of a
+ * MessageType followed by the corresponding structure. Both sides run on the
+ * same machine, structures are thus transported in native layout.
+ *
+ * A client starts by sending a Hello message that selects the camera and sets
+ * the client's frame rate and in-flight frames limits. The daemon replies with
+ * a StreamInfo message, followed by one Buffer message per buffer carrying the
+ * dmabuf file descriptors of the buffer planes, or with an Error message.
+ *
+ * The daemon then sends a Frame message for every completed frame delivered to
+ * the client. The buffer is owned by the client until it sends a Release
+ * message, and is requeued to the camera once released by all clients.
+ */
+
+namespace camerad {
+
+constexpr uint32_t kProtocolVersion = 1;
+constexpr const char *kDefaultSocketPath = "/run/camerad.sock";
+constexpr unsigned int kMaxPlanes = 4;
+
+enum class MessageType : uint32_t {
+	/* Client to daemon */
+	Hello = 1,
+	Release = 2,
+
+	/* Daemon to client */
+	StreamInfo = 16,
+	Buffer = 17,
+	Frame = 18,
+	Error = 19,
+};
+
+struct HelloMessage {
+	uint32_t version;
+	/* Maximum frame rate in frames per second, 0 for the camera frame rate */
+	uint32_t maxFrameRate;
+	/* Maximum number of frames held by the client at any time */
+	uint32_t maxFrames;
+	/* NUL-terminated camera id, empty for the first camera */
+	char camera[256];
+};
+
+struct ReleaseMessage {
+	uint32_t index;
+};
+
+struct StreamInfoMessage {
+	uint64_t modifier;
+	uint32_t fourcc;
+	uint32_t width;
+	uint32_t height;
+	uint32_t stride;
+	uint32_t frameSize;
+	uint32_t bufferCount;
+	/* Maximum number of frames the client may hold, after clamping */
+	uint32_t maxFrames;
+};
+
+/* The plane file descriptors are transported with the message. */
+struct BufferMessage {
+	uint32_t index;
+	uint32_t numPlanes;
+	struct {
+		uint32_t offset;
+		uint32_t length;
+	} planes[kMaxPlanes];
+};
+
+struct FrameMessage {
+	uint64_t timestamp;
+	uint32_t index;
+	uint32_t sequence;
+	/* libcamera::FrameMetadata::Status */
+	uint32_t status;
+	uint32_t bytesused[kMaxPlanes];
+};
+
+struct ErrorMessage {
+	/* Negative error code */
+	int32_t error;
+};
+
+template<typename T>
+int sendMessage(libcamera::IPCUnixSocket &socket, MessageType type,
+		const T &message, libcamera::Span<const int32_t> fds = {})
+{
+	const libcamera::Span<const uint8_t> data[] = {
+		{ reinterpret_cast<const uint8_t *>(&type), sizeof(type) },
+		{ reinterpret_cast<const uint8_t *>(&message), sizeof(message) },
+	};
+
+	return socket.send(data, fds);
+}
+
+inline MessageType messageType(const libcamera::IPCUnixSocket::Payload &payload)
+{
+	MessageType type{};
+
+	if (payload.data.size() >= sizeof(type))
+		memcpy(&type, payload.data.data(), sizeof(type));
+
+	return type;
+}
+
+template<typename T>
+bool parseMessage(const libcamera::IPCUnixSocket::Payload &payload, T *message)
+{
+	if (payload.data.size() != sizeof(MessageType) + sizeof(*message))
+		return false;
+
+	memcpy(message, payload.data.data() + sizeof(MessageType), sizeof(*message));
+
+	return true;
+}
+
+} /* namespace camerad */
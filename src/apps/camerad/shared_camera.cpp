@@ -0,0 +1,303 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * shared_camera.cpp - camerad camera shared between clients
+ */
+
+#include "shared_camera.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <iostream>
+#include <string.h>
+
+#include "../common/stream_options.h"
+
+#include "client.h"
+
+using namespace camerad;
+using namespace libcamera;
+
+/*
+ * The camera is acquired and started when the first client attaches, and
+ * stopped and released when the last client detaches, to let other processes
+ * use it when it isn't shared.
+ *
+ * Every completed frame is delivered to all the clients that want it, and the
+ * request is requeued once all of them have released the buffer. A buffer that
+ * no client wants is requeued immediately.
+ */
+SharedCamera::SharedCamera(std::shared_ptr<Camera> camera,
+			   const OptionValue &streams, unsigned int bufferCount)
+	: camera_(std::move(camera)), streams_(streams),
+	  bufferCount_(bufferCount), stream_(nullptr), info_{}, running_(false)
+{
+}
+
+SharedCamera::~SharedCamera()
+{
+	if (running_)
+		stop();
+}
+
+int SharedCamera::addClient(Client *client, unsigned int maxFrames)
+{
+	if (clients_.empty()) {
+		int ret = start();
+		if (ret)
+			return ret;
+	}
+
+	/*
+	 * Make sure a single client can't starve the camera of buffers. Other
+	 * clients are still stalled when all clients hold their maximum, but
+	 * recover as soon as buffers are released.
+	 */
+	StreamInfoMessage info = info_;
+	unsigned int limit = std::max(info.bufferCount / 2, 1U);
+	info.maxFrames = maxFrames ? std::min(maxFrames, limit) : limit;
+
+	int ret = client->attach(this, info, allocator_->buffers(stream_));
+	if (ret) {
+		if (clients_.empty())
+			stop();
+		return ret;
+	}
+
+	clients_.push_back(client);
+
+	std::cout << "Client " << client->pid() << " attached to " << id()
+		  << ", holding up to " << info.maxFrames << " frames"
+		  << std::endl;
+
+	return 0;
+}
+
+void SharedCamera::removeClient(Client *client, const std::set<unsigned int> &held)
+{
+	auto iter = std::find(clients_.begin(), clients_.end(), client);
+	if (iter == clients_.end())
+		return;
+
+	clients_.erase(iter);
+
+	if (clients_.empty()) {
+		stop();
+		return;
+	}
+
+	for (unsigned int index : held)
+		release(index);
+}
+
+void SharedCamera::release(unsigned int index)
+{
+	if (index >= users_.size() || !users_[index])
+		return;
+
+	if (!--users_[index])
+		queueRequest(index);
+}
+
+int SharedCamera::start()
+{
+	int ret = camera_->acquire();
+	if (ret) {
+		std::cerr << "Failed to acquire camera " << id() << std::endl;
+		return ret;
+	}
+
+	ret = configure();
+	if (ret) {
+		teardown();
+		return ret;
+	}
+
+	/*
+	 * Requests complete in the camera manager thread. Queue them for
+	 * processing in the main thread, where clients live.
+	 */
+	camera_->requestCompleted.connect(this, &SharedCamera::requestComplete,
+					  ConnectionTypeDirect);
+
+	ret = camera_->start();
+	if (ret) {
+		std::cerr << "Failed to start camera " << id() << std::endl;
+		camera_->requestCompleted.disconnect(this);
+		teardown();
+		return ret;
+	}
+
+	running_ = true;
+
+	for (unsigned int i = 0; i < requests_.size(); ++i)
+		queueRequest(i);
+
+	return 0;
+}
+
+void SharedCamera::stop()
+{
+	std::cout << "Stopping " << id() << std::endl;
+
+	running_ = false;
+	camera_->stop();
+	camera_->requestCompleted.disconnect(this);
+
+	/* Drop requests that completed but haven't been processed yet. */
+	{
+		MutexLocker locker(mutex_);
+		completed_ = {};
+	}
+
+	teardown();
+}
+
+int SharedCamera::configure()
+{
+	config_ = camera_->generateConfiguration(StreamKeyValueParser::roles(streams_));
+	if (!config_ || config_->size() != 1) {
+		std::cerr << "Failed to generate a single stream configuration"
+			  << std::endl;
+		return -EINVAL;
+	}
+
+	int ret = StreamKeyValueParser::updateConfiguration(config_.get(), streams_);
+	if (ret)
+		return ret;
+
+	StreamConfiguration &cfg = config_->at(0);
+	if (bufferCount_)
+		cfg.bufferCount = bufferCount_;
+
+	switch (config_->validate()) {
+	case CameraConfiguration::Valid:
+		break;
+	case CameraConfiguration::Adjusted:
+		std::cout << "Camera configuration adjusted" << std::endl;
+		break;
+	case CameraConfiguration::Invalid:
+		std::cerr << "Camera configuration invalid" << std::endl;
+		return -EINVAL;
+	}
+
+	ret = camera_->configure(config_.get());
+	if (ret) {
+		std::cerr << "Failed to configure camera " << id() << std::endl;
+		return ret;
+	}
+
+	stream_ = cfg.stream();
+
+	allocator_ = std::make_unique<FrameBufferAllocator>(camera_);
+	ret = allocator_->allocate(stream_);
+	if (ret < 0) {
+		std::cerr << "Failed to allocate buffers" << std::endl;
+		return ret;
+	}
+
+	const std::vector<std::unique_ptr<FrameBuffer>> &buffers =
+		allocator_->buffers(stream_);
+
+	for (unsigned int i = 0; i < buffers.size(); ++i) {
+		std::unique_ptr<Request> request = camera_->createRequest(i);
+		if (!request)
+			return -ENOMEM;
+
+		ret = request->addBuffer(stream_, buffers[i].get());
+		if (ret)
+			return ret;
+
+		requests_.push_back(std::move(request));
+	}
+
+	users_.assign(requests_.size(), 0);
+
+	info_ = {};
+	info_.fourcc = cfg.pixelFormat.fourcc();
+	info_.modifier = cfg.pixelFormat.modifier();
+	info_.width = cfg.size.width;
+	info_.height = cfg.size.height;
+	info_.stride = cfg.stride;
+	info_.frameSize = cfg.frameSize;
+	info_.bufferCount = buffers.size();
+
+	std::cout << "Starting " << id() << " with " << cfg.toString() << ", "
+		  << buffers.size() << " buffers" << std::endl;
+
+	return 0;
+}
+
+void SharedCamera::teardown()
+{
+	users_.clear();
+	requests_.clear();
+	allocator_.reset();
+	config_.reset();
+	stream_ = nullptr;
+	camera_->release();
+}
+
+/* \context This function is called from the camera manager thread. */
+void SharedCamera::requestComplete(Request *request)
+{
+	/* Requests are only cancelled when stopping the camera. */
+	if (request->status() == Request::RequestCancelled)
+		return;
+
+	{
+		MutexLocker locker(mutex_);
+		completed_.push(request);
+	}
+
+	invokeMethod(&SharedCamera::processRequests, ConnectionTypeQueued);
+}
+
+void SharedCamera::processRequests()
+{
+	while (running_) {
+		Request *request;
+
+		{
+			MutexLocker locker(mutex_);
+			if (completed_.empty())
+				break;
+
+			request = completed_.front();
+			completed_.pop();
+		}
+
+		unsigned int index = request->cookie();
+		const FrameMetadata &metadata = request->findBuffer(stream_)->metadata();
+
+		if (metadata.status == FrameMetadata::FrameSuccess) {
+			for (Client *client : clients_) {
+				if (!client->wantsFrame(metadata.timestamp))
+					continue;
+
+				if (client->sendFrame(index, metadata))
+					continue;
+
+				users_[index]++;
+			}
+		}
+
+		if (!users_[index])
+			queueRequest(index);
+	}
+}
+
+void SharedCamera::queueRequest(unsigned int index)
+{
+	if (!running_)
+		return;
+
+	Request *request = requests_[index].get();
+	request->reuse(Request::ReuseBuffers);
+
+	int ret = camera_->queueRequest(request);
+	if (ret)
+		std::cerr << "Failed to queue request " << index << ": "
+			  << strerror(-ret) << std::endl;
+}
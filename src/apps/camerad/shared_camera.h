@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * shared_camera.h - camerad camera shared between clients
+ */
+
+#pragma once
+
+#include <memory>
+#include <queue>
+#include <set>
+#include <vector>
+
+#include <libcamera/base/mutex.h>
+#include <libcamera/base/object.h>
+
+#include <libcamera/camera.h>
+#include <libcamera/framebuffer_allocator.h>
+#include <libcamera/request.h>
+#include <libcamera/stream.h>
+
+#include "../common/options.h"
+
+#include "protocol.h"
+
+class Client;
+
+class SharedCamera : public libcamera::Object
+{
+public:
+	SharedCamera(std::shared_ptr<libcamera::Camera> camera,
+		     const OptionValue &streams, unsigned int bufferCount);
+	~SharedCamera();
+
+	const std::string &id() const { return camera_->id(); }
+
+	int addClient(Client *client, unsigned int maxFrames);
+	void removeClient(Client *client, const std::set<unsigned int> &held);
+	void release(unsigned int index);
+
+private:
+	int start();
+	void stop();
+	int configure();
+	void teardown();
+
+	void requestComplete(libcamera::Request *request);
+	void processRequests();
+	void queueRequest(unsigned int index);
+
+	std::shared_ptr<libcamera::Camera> camera_;
+	OptionValue streams_;
+	unsigned int bufferCount_;
+
+	std::unique_ptr<libcamera::CameraConfiguration> config_;
+	libcamera::Stream *stream_;
+	std::unique_ptr<libcamera::FrameBufferAllocator> allocator_;
+	std::vector<std::unique_ptr<libcamera::Request>> requests_;
+	camerad::StreamInfoMessage info_;
+	bool running_;
+
+	/* Number of clients holding each buffer */
+	std::vector<unsigned int> users_;
+	std::vector<Client *> clients_;
+
+	libcamera::Mutex mutex_;
+	std::queue<libcamera::Request *> completed_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+};
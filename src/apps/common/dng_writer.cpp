@@ -10,6 +10,12 @@
 #include <algorithm>
 #include <iostream>
 #include <map>
+#include <string.h>
+#include <vector>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #include <tiffio.h>
 
@@ -17,6 +23,8 @@
 #include <libcamera/formats.h>
 #include <libcamera/property_ids.h>
 
+#include "pisp_decompress.h"
+
 using namespace libcamera;
 
 enum CFAPatternColour : uint8_t {
@@ -35,6 +43,9 @@ struct FormatInfo {
 			      unsigned int stride);
 };
 
+/* Target size of the RAW image strips, in bytes. */
+constexpr unsigned int kStripSize = 1024 * 1024;
+
 struct Matrix3d {
 	Matrix3d()
 	{
@@ -134,13 +145,50 @@ void packScanlineSBGGR8(void *output, const void *input, unsigned int width)
 	std::copy(in, in + width, out);
 }
 
+/*
+ * The packing functions convert lines from the CSI-2 packed formats, which
+ * store the most significant bits of each pixel in a byte followed by the
+ * least significant bits of a group of pixels, to the DNG bit stream, which
+ * stores the pixels contiguously, most significant bit first.
+ *
+ * The 10-bit groups of 4 pixels span 5 bytes, which doesn't map to NEON
+ * structure loads or to SSE2 vectors without byte shuffles. They are converted
+ * in a 64-bit register instead, one group at a time. The 12-bit groups of 2
+ * pixels span 3 bytes, and are converted 16 groups at a time with NEON
+ * structure loads and stores, or 2 groups at a time in a 64-bit register
+ * otherwise.
+ *
+ * The 64-bit loads read past the end of the group, the fast paths stop early
+ * enough not to read past the end of the line, and leave the last groups to
+ * the byte-based loops.
+ */
 void packScanlineSBGGR10P(void *output, const void *input, unsigned int width)
 {
 	const uint8_t *in = static_cast<const uint8_t *>(input);
 	uint8_t *out = static_cast<uint8_t *>(output);
+	unsigned int x = 0;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	for (; x + 8 <= width; x += 4) {
+		uint64_t v;
+		memcpy(&v, in, sizeof(v));
 
-	/* \todo Can this be made more efficient? */
-	for (unsigned int x = 0; x < width; x += 4) {
+		uint64_t lsb = (v >> 32) & 0xff;
+		uint64_t w = (v & 0xff) << 32 | (lsb & 0x03) << 30 |
+			     ((v >> 8) & 0xff) << 22 | (lsb & 0x0c) << 18 |
+			     ((v >> 16) & 0xff) << 12 | (lsb & 0x30) << 6 |
+			     ((v >> 24) & 0xff) << 2 | (lsb & 0xc0) >> 6;
+
+		/* Store the 40 bits in big-endian order. */
+		w = __builtin_bswap64(w << 24);
+		memcpy(out, &w, 5);
+
+		in += 5;
+		out += 5;
+	}
+#endif
+
+	for (; x < width; x += 4) {
 		*out++ = in[0];
 		*out++ = (in[4] & 0x03) << 6 | in[1] >> 2;
 		*out++ = (in[1] & 0x03) << 6 | (in[4] & 0x0c) << 2 | in[2] >> 4;
@@ -154,9 +202,44 @@ void packScanlineSBGGR12P(void *output, const void *input, unsigned int width)
 {
 	const uint8_t *in = static_cast<const uint8_t *>(input);
 	uint8_t *out = static_cast<uint8_t *>(output);
+	unsigned int i = 0;
+
+#if defined(__ARM_NEON)
+	/*
+	 * The first byte of the group is copied, the nibbles of the second and
+	 * third bytes are swapped across bytes.
+	 */
+	for (; i + 32 <= width; i += 32) {
+		uint8x16x3_t v = vld3q_u8(in);
+		uint8x16_t b1 = v.val[1];
 
-	/* \todo Can this be made more efficient? */
-	for (unsigned int i = 0; i < width; i += 2) {
+		v.val[1] = vorrq_u8(vshlq_n_u8(v.val[2], 4), vshrq_n_u8(b1, 4));
+		v.val[2] = vorrq_u8(vshlq_n_u8(b1, 4), vshrq_n_u8(v.val[2], 4));
+		vst3q_u8(out, v);
+
+		in += 48;
+		out += 48;
+	}
+#elif __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	/*
+	 * The second and third bytes of each group, read as a little-endian
+	 * 16-bit value, are rotated right by 4 bits.
+	 */
+	for (; i + 6 <= width; i += 4) {
+		uint64_t v;
+		memcpy(&v, in, sizeof(v));
+
+		uint64_t w = (v & 0x00000000ff0000ffULL) |
+			     ((v >> 4) & 0x00000fff000fff00ULL) |
+			     ((v << 12) & 0x0000f00000f00000ULL);
+		memcpy(out, &w, 6);
+
+		in += 6;
+		out += 6;
+	}
+#endif
+
+	for (; i < width; i += 2) {
 		*out++ = in[0];
 		*out++ = (in[2] & 0x0f) << 4 | in[1] >> 4;
 		*out++ = (in[1] & 0x0f) << 4 | in[2] >> 4;
@@ -282,6 +365,37 @@ void thumbScanlineIPU3([[maybe_unused]] const FormatInfo &info, void *output,
 	}
 }
 
+void packScanlinePiSPComp1(void *output, const void *input, unsigned int width)
+{
+	const uint8_t *in = static_cast<const uint8_t *>(input);
+	uint16_t *out = static_cast<uint16_t *>(output);
+
+	PiSP::decompressLine(out, in, width);
+}
+
+void thumbScanlinePiSPComp1([[maybe_unused]] const FormatInfo &info, void *output,
+			    const void *input, unsigned int width,
+			    unsigned int stride)
+{
+	const uint8_t *in = static_cast<const uint8_t *>(input);
+	uint8_t *out = static_cast<uint8_t *>(output);
+
+	/* Compressed data takes one byte per pixel, in blocks of 8 pixels. */
+	for (unsigned int x = 0; x < width; x++) {
+		uint16_t row0[PiSP::CompressedBlockPixels];
+		uint16_t row1[PiSP::CompressedBlockPixels];
+
+		PiSP::decompressBlock(row0, in);
+		PiSP::decompressBlock(row1, in + stride);
+
+		uint8_t value = (row0[0] + row0[1] + row1[0] + row1[1]) >> 10;
+		*out++ = value;
+		*out++ = value;
+		*out++ = value;
+		in += 16;
+	}
+}
+
 static const std::map<PixelFormat, FormatInfo> formatInfo = {
 	{ formats::SBGGR8, {
 		.bitsPerSample = 8,
@@ -379,6 +493,30 @@ static const std::map<PixelFormat, FormatInfo> formatInfo = {
 		.packScanline = packScanlineIPU3,
 		.thumbScanline = thumbScanlineIPU3,
 	} },
+	{ formats::BGGR16_PISP_COMP1, {
+		.bitsPerSample = 16,
+		.pattern = { CFAPatternBlue, CFAPatternGreen, CFAPatternGreen, CFAPatternRed },
+		.packScanline = packScanlinePiSPComp1,
+		.thumbScanline = thumbScanlinePiSPComp1,
+	} },
+	{ formats::GBRG16_PISP_COMP1, {
+		.bitsPerSample = 16,
+		.pattern = { CFAPatternGreen, CFAPatternBlue, CFAPatternRed, CFAPatternGreen },
+		.packScanline = packScanlinePiSPComp1,
+		.thumbScanline = thumbScanlinePiSPComp1,
+	} },
+	{ formats::GRBG16_PISP_COMP1, {
+		.bitsPerSample = 16,
+		.pattern = { CFAPatternGreen, CFAPatternRed, CFAPatternBlue, CFAPatternGreen },
+		.packScanline = packScanlinePiSPComp1,
+		.thumbScanline = thumbScanlinePiSPComp1,
+	} },
+	{ formats::RGGB16_PISP_COMP1, {
+		.bitsPerSample = 16,
+		.pattern = { CFAPatternRed, CFAPatternGreen, CFAPatternGreen, CFAPatternBlue },
+		.packScanline = packScanlinePiSPComp1,
+		.thumbScanline = thumbScanlinePiSPComp1,
+	} },
 };
 
 int DNGWriter::write(const char *filename, const Camera *camera,
@@ -403,11 +541,20 @@ int DNGWriter::write(const char *filename, const Camera *camera,
 	}
 
 	/*
-	 * Scanline buffer, has to be large enough to store both a RAW scanline
-	 * or a thumbnail scanline. The latter will always be much smaller than
-	 * the former as we downscale by 16 in both directions.
+	 * Images are written in strips of multiple lines, to reduce the number
+	 * of write calls. The strip buffer has to be large enough to store
+	 * both a RAW strip and the thumbnail, which is written as a single
+	 * strip. The latter is much smaller as we downscale by 16 in both
+	 * directions.
 	 */
-	uint8_t scanline[(config.size.width * info->bitsPerSample + 7) / 8];
+	const unsigned int rawLineSize = (config.size.width * info->bitsPerSample + 7) / 8;
+	const unsigned int thumbLineSize = config.size.width / 16 * 3;
+	const unsigned int thumbHeight = config.size.height / 16;
+	const unsigned int rowsPerStrip =
+		std::clamp(kStripSize / rawLineSize, 1U, config.size.height);
+
+	std::vector<uint8_t> strip(std::max(rawLineSize * rowsPerStrip,
+					    thumbLineSize * thumbHeight));
 
 	toff_t rawIFDOffset = 0;
 	toff_t exifIFDOffset = 0;
@@ -440,7 +587,8 @@ int DNGWriter::write(const char *filename, const Camera *camera,
 	 */
 	TIFFSetField(tif, TIFFTAG_SUBFILETYPE, FILETYPE_REDUCEDIMAGE);
 	TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, config.size.width / 16);
-	TIFFSetField(tif, TIFFTAG_IMAGELENGTH, config.size.height / 16);
+	TIFFSetField(tif, TIFFTAG_IMAGELENGTH, thumbHeight);
+	TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, std::max(thumbHeight, 1U));
 	TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 8);
 	TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_NONE);
 	TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
@@ -506,20 +654,19 @@ int DNGWriter::write(const char *filename, const Camera *camera,
 
 	/* Write the thumbnail. */
 	const uint8_t *row = static_cast<const uint8_t *>(data);
-	for (unsigned int y = 0; y < config.size.height / 16; y++) {
-		info->thumbScanline(*info, &scanline, row,
+	for (unsigned int y = 0; y < thumbHeight; y++) {
+		info->thumbScanline(*info, strip.data() + y * thumbLineSize, row,
 				    config.size.width / 16, config.stride);
-
-		if (TIFFWriteScanline(tif, &scanline, y, 0) != 1) {
-			std::cerr << "Failed to write thumbnail scanline"
-				  << std::endl;
-			TIFFClose(tif);
-			return -EINVAL;
-		}
-
 		row += config.stride * 16;
 	}
 
+	if (thumbHeight &&
+	    TIFFWriteRawStrip(tif, 0, strip.data(), thumbLineSize * thumbHeight) < 0) {
+		std::cerr << "Failed to write thumbnail" << std::endl;
+		TIFFClose(tif);
+		return -EINVAL;
+	}
+
 	TIFFWriteDirectory(tif);
 
 	/* Create a new IFD for the RAW image. */
@@ -533,6 +680,7 @@ int DNGWriter::write(const char *filename, const Camera *camera,
 	TIFFSetField(tif, TIFFTAG_SUBFILETYPE, 0);
 	TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, config.size.width);
 	TIFFSetField(tif, TIFFTAG_IMAGELENGTH, config.size.height);
+	TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, rowsPerStrip);
 	TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, info->bitsPerSample);
 	TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_NONE);
 	TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_CFA);
@@ -592,17 +740,21 @@ int DNGWriter::write(const char *filename, const Camera *camera,
 
 	/* Write RAW content. */
 	row = static_cast<const uint8_t *>(data);
-	for (unsigned int y = 0; y < config.size.height; y++) {
-		info->packScanline(&scanline, row, config.size.width);
+	for (unsigned int y = 0; y < config.size.height; y += rowsPerStrip) {
+		unsigned int rows = std::min(rowsPerStrip, config.size.height - y);
+
+		for (unsigned int i = 0; i < rows; i++) {
+			info->packScanline(strip.data() + i * rawLineSize, row,
+					   config.size.width);
+			row += config.stride;
+		}
 
-		if (TIFFWriteScanline(tif, &scanline, y, 0) != 1) {
-			std::cerr << "Failed to write RAW scanline"
-				  << std::endl;
+		if (TIFFWriteRawStrip(tif, y / rowsPerStrip, strip.data(),
+				      rawLineSize * rows) < 0) {
+			std::cerr << "Failed to write RAW strip" << std::endl;
 			TIFFClose(tif);
 			return -EINVAL;
 		}
-
-		row += config.stride;
 	}
 
 	/* Checkpoint the IFD to retrieve its offset, and write it out. */
@@ -0,0 +1,420 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * frame_stream.cpp - Container for long frame captures
+ */
+
+#include "frame_stream.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <libcamera/control_ids.h>
+
+#include "image.h"
+
+/*
+ * The frame stream container stores the frames of a capture session in a
+ * single file, meant to be memory-mapped by readers. All integers are stored in
+ * the native byte order.
+ *
+ * The file starts with a FileHeader, followed by one StreamHeader per stream,
+ * padded to the Alignment. Frame records follow, each made of a FrameHeader,
+ * the serialized request metadata and the frame planes. The metadata and each
+ * plane are padded to the Alignment, so that the pixel data can be accessed in
+ * place. The metadata is stored as a ControlHeader followed by the control
+ * data for each control, padded to 8 bytes.
+ *
+ * When the capture completes, a table of the offsets of all frame records is
+ * written, followed by an IndexTrailer at the very end of the file. Files
+ * without a trailer, for instance when the capture was interrupted, are indexed
+ * by walking the frame records.
+ */
+
+using namespace libcamera;
+
+namespace FrameStream {
+
+namespace {
+
+constexpr char FileMagic[4] = { 'L', 'C', 'F', 'S' };
+constexpr char FrameMagic[4] = { 'L', 'C', 'F', 'R' };
+constexpr char IndexMagic[4] = { 'L', 'C', 'F', 'I' };
+
+constexpr uint8_t Padding[Alignment] = {};
+
+size_t align(size_t size, size_t alignment = Alignment)
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+} /* namespace */
+
+Writer::Writer()
+	: fd_(-1), offset_(0)
+{
+}
+
+Writer::~Writer()
+{
+	close();
+}
+
+int Writer::open(const std::string &filename, const CameraConfiguration &config,
+		 const std::map<const Stream *, std::string> &streamNames)
+{
+	fd_ = ::open(filename.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC,
+		     S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+	if (fd_ < 0) {
+		int ret = -errno;
+		std::cerr << "failed to open file " << filename << ": "
+			  << strerror(-ret) << std::endl;
+		return ret;
+	}
+
+	offset_ = 0;
+	index_.clear();
+	streams_.clear();
+
+	FileHeader header = {};
+	memcpy(header.magic, FileMagic, sizeof(header.magic));
+	header.version = Version;
+	header.numStreams = config.size();
+
+	int ret = writeData(&header, sizeof(header));
+	if (ret < 0)
+		return ret;
+
+	for (const StreamConfiguration &cfg : config) {
+		StreamHeader stream = {};
+
+		auto name = streamNames.find(cfg.stream());
+		if (name != streamNames.end())
+			strncpy(stream.name, name->second.c_str(),
+				sizeof(stream.name) - 1);
+
+		stream.fourcc = cfg.pixelFormat.fourcc();
+		stream.modifier = cfg.pixelFormat.modifier();
+		stream.width = cfg.size.width;
+		stream.height = cfg.size.height;
+		stream.stride = cfg.stride;
+
+		ret = writeData(&stream, sizeof(stream));
+		if (ret < 0)
+			return ret;
+
+		streams_[cfg.stream()] = streams_.size();
+	}
+
+	return writeData(Padding, align(offset_) - offset_);
+}
+
+int Writer::write(const Stream *stream, const FrameBuffer *buffer,
+		  const Image *image, const ControlList &metadata)
+{
+	if (fd_ < 0)
+		return -EBADF;
+
+	auto it = streams_.find(stream);
+	if (it == streams_.end())
+		return -EINVAL;
+
+	/* Serialize the metadata, padded for the planes to be aligned. */
+	std::vector<uint8_t> controls;
+
+	for (const auto &[id, value] : metadata) {
+		Span<const uint8_t> data = value.data();
+
+		ControlHeader control = {};
+		control.id = id;
+		control.type = value.type();
+		control.isArray = value.isArray();
+		control.numElements = value.numElements();
+		control.size = data.size();
+
+		const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&control);
+		controls.insert(controls.end(), bytes, bytes + sizeof(control));
+		controls.insert(controls.end(), data.begin(), data.end());
+		controls.resize(align(controls.size(), 8));
+	}
+
+	controls.resize(align(sizeof(FrameHeader) + controls.size()) - sizeof(FrameHeader));
+
+	FrameHeader header = {};
+	memcpy(header.magic, FrameMagic, sizeof(header.magic));
+	header.stream = it->second;
+	header.sequence = buffer->metadata().sequence;
+	header.timestamp = buffer->metadata().timestamp;
+	header.metadataSize = controls.size();
+	header.numPlanes = std::min<size_t>(buffer->planes().size(), MaxPlanes);
+
+	std::vector<struct iovec> iov;
+	iov.push_back({ &header, sizeof(header) });
+	iov.push_back({ controls.data(), controls.size() });
+
+	size_t size = sizeof(header) + controls.size();
+
+	for (unsigned int i = 0; i < header.numPlanes; ++i) {
+		Span<const uint8_t> data = image->data(i);
+		size_t length = std::min<size_t>(buffer->metadata().planes()[i].bytesused,
+						 data.size());
+
+		header.planeSizes[i] = length;
+		iov.push_back({ const_cast<uint8_t *>(data.data()), length });
+		iov.push_back({ const_cast<uint8_t *>(Padding), align(length) - length });
+		size += align(length);
+	}
+
+	header.size = size;
+
+	ssize_t ret = ::writev(fd_, iov.data(), iov.size());
+	if (ret < 0) {
+		ret = -errno;
+		std::cerr << "write error: " << strerror(-ret) << std::endl;
+		return ret;
+	}
+
+	/*
+	 * Rewind on short writes, to keep the frame records contiguous. The
+	 * partial record is overwritten by the next frame or truncated when
+	 * closing the file.
+	 */
+	if (static_cast<size_t>(ret) != size) {
+		std::cerr << "write error: only " << ret << " bytes written instead of "
+			  << size << std::endl;
+		lseek(fd_, offset_, SEEK_SET);
+		return -EIO;
+	}
+
+	index_.push_back(offset_);
+	offset_ += size;
+
+	return 0;
+}
+
+int Writer::close()
+{
+	if (fd_ < 0)
+		return 0;
+
+	IndexTrailer trailer = {};
+	trailer.indexOffset = offset_;
+	trailer.numFrames = index_.size();
+	memcpy(trailer.magic, IndexMagic, sizeof(trailer.magic));
+
+	int ret = ftruncate(fd_, offset_);
+	if (!ret)
+		ret = writeData(index_.data(), index_.size() * sizeof(index_[0]));
+	if (!ret)
+		ret = writeData(&trailer, sizeof(trailer));
+
+	::close(fd_);
+	fd_ = -1;
+
+	return ret;
+}
+
+int Writer::writeData(const void *data, size_t size)
+{
+	const uint8_t *bytes = static_cast<const uint8_t *>(data);
+
+	while (size) {
+		ssize_t ret = ::write(fd_, bytes, size);
+		if (ret < 0) {
+			ret = -errno;
+			std::cerr << "write error: " << strerror(-ret) << std::endl;
+			return ret;
+		}
+
+		bytes += ret;
+		size -= ret;
+		offset_ += ret;
+	}
+
+	return 0;
+}
+
+Reader::Reader()
+	: data_(nullptr), size_(0)
+{
+}
+
+Reader::~Reader()
+{
+	close();
+}
+
+int Reader::open(const std::string &filename)
+{
+	close();
+
+	int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		int ret = -errno;
+		::close(fd);
+		return ret;
+	}
+
+	size_ = st.st_size;
+	if (size_ < sizeof(FileHeader)) {
+		::close(fd);
+		return -EINVAL;
+	}
+
+	void *data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED) {
+		size_ = 0;
+		return -errno;
+	}
+
+	data_ = static_cast<uint8_t *>(data);
+
+	const FileHeader *header = reinterpret_cast<const FileHeader *>(data_);
+	size_t offset = sizeof(*header);
+
+	if (memcmp(header->magic, FileMagic, sizeof(header->magic)) ||
+	    header->version != Version ||
+	    offset + header->numStreams * sizeof(StreamHeader) > size_) {
+		close();
+		return -EINVAL;
+	}
+
+	for (unsigned int i = 0; i < header->numStreams; ++i) {
+		const StreamHeader *stream =
+			reinterpret_cast<const StreamHeader *>(data_ + offset);
+
+		StreamInfo info;
+		info.name = std::string(stream->name, strnlen(stream->name, sizeof(stream->name)));
+		info.pixelFormat = PixelFormat(stream->fourcc, stream->modifier);
+		info.size = Size(stream->width, stream->height);
+		info.stride = stream->stride;
+		streams_.push_back(std::move(info));
+
+		offset += sizeof(*stream);
+	}
+
+	if (!buildIndex(align(offset))) {
+		close();
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+void Reader::close()
+{
+	if (data_)
+		munmap(data_, size_);
+
+	data_ = nullptr;
+	size_ = 0;
+	streams_.clear();
+	index_.clear();
+}
+
+bool Reader::buildIndex(uint64_t offset)
+{
+	/* Use the index written at the end of the capture if present. */
+	if (size_ >= offset + sizeof(IndexTrailer)) {
+		const IndexTrailer *trailer =
+			reinterpret_cast<const IndexTrailer *>(data_ + size_ - sizeof(IndexTrailer));
+
+		if (!memcmp(trailer->magic, IndexMagic, sizeof(trailer->magic)) &&
+		    trailer->indexOffset + trailer->numFrames * sizeof(uint64_t) +
+		    sizeof(IndexTrailer) == size_) {
+			const uint64_t *index =
+				reinterpret_cast<const uint64_t *>(data_ + trailer->indexOffset);
+			index_.assign(index, index + trailer->numFrames);
+			return true;
+		}
+	}
+
+	/* Otherwise walk the frame records, up to the first incomplete one. */
+	while (offset + sizeof(FrameHeader) <= size_) {
+		const FrameHeader *header =
+			reinterpret_cast<const FrameHeader *>(data_ + offset);
+
+		if (memcmp(header->magic, FrameMagic, sizeof(header->magic)) ||
+		    header->size < sizeof(FrameHeader) || offset + header->size > size_)
+			break;
+
+		index_.push_back(offset);
+		offset += header->size;
+	}
+
+	return true;
+}
+
+int Reader::frame(size_t index, Frame *frame) const
+{
+	if (index >= index_.size())
+		return -EINVAL;
+
+	uint64_t offset = index_[index];
+	if (offset + sizeof(FrameHeader) > size_)
+		return -EINVAL;
+
+	const FrameHeader *header = reinterpret_cast<const FrameHeader *>(data_ + offset);
+	if (memcmp(header->magic, FrameMagic, sizeof(header->magic)) ||
+	    offset + header->size > size_ || header->numPlanes > MaxPlanes ||
+	    sizeof(FrameHeader) + header->metadataSize > header->size)
+		return -EINVAL;
+
+	frame->stream = header->stream;
+	frame->sequence = header->sequence;
+	frame->timestamp = header->timestamp;
+	frame->metadata = ControlList(controls::controls);
+	frame->planes.clear();
+
+	const uint8_t *data = data_ + offset + sizeof(*header);
+	const uint8_t *end = data + header->metadataSize;
+
+	while (data + sizeof(ControlHeader) <= end) {
+		const ControlHeader *control = reinterpret_cast<const ControlHeader *>(data);
+		data += sizeof(*control);
+
+		/* Padding at the end of the metadata. */
+		if (!control->id)
+			break;
+
+		if (data + control->size > end)
+			return -EINVAL;
+
+		ControlValue value;
+		value.reserve(static_cast<ControlType>(control->type),
+			      control->isArray, control->numElements);
+		if (value.data().size() == control->size) {
+			memcpy(value.data().data(), data, control->size);
+			frame->metadata.set(control->id, value);
+		}
+
+		data += align(control->size, 8);
+	}
+
+	data = end;
+	end = data_ + offset + header->size;
+
+	for (unsigned int i = 0; i < header->numPlanes; ++i) {
+		if (data + header->planeSizes[i] > end)
+			return -EINVAL;
+
+		frame->planes.emplace_back(data, header->planeSizes[i]);
+		data += align(header->planeSizes[i]);
+	}
+
+	return 0;
+}
+
+} /* namespace FrameStream */
@@ -0,0 +1,139 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * frame_stream.h - Container for long frame captures
+ */
+
+#pragma once
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <libcamera/base/class.h>
+#include <libcamera/base/span.h>
+
+#include <libcamera/camera.h>
+#include <libcamera/controls.h>
+#include <libcamera/framebuffer.h>
+#include <libcamera/stream.h>
+
+class Image;
+
+namespace FrameStream {
+
+static constexpr unsigned int Version = 1;
+static constexpr unsigned int MaxPlanes = 4;
+/* Alignment of the frame records and of the pixel data in the file. */
+static constexpr unsigned int Alignment = 64;
+
+struct FileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t numStreams;
+	uint32_t reserved;
+};
+
+struct StreamHeader {
+	char name[32];
+	uint32_t fourcc;
+	uint32_t width;
+	uint32_t height;
+	uint32_t stride;
+	uint64_t modifier;
+};
+
+struct FrameHeader {
+	char magic[4];
+	/* Size of the record, including the header, metadata and payload. */
+	uint32_t size;
+	uint32_t stream;
+	uint32_t sequence;
+	uint64_t timestamp;
+	uint32_t metadataSize;
+	uint32_t numPlanes;
+	uint32_t planeSizes[MaxPlanes];
+};
+
+struct ControlHeader {
+	uint32_t id;
+	uint8_t type;
+	uint8_t isArray;
+	uint16_t reserved;
+	uint32_t numElements;
+	uint32_t size;
+};
+
+struct IndexTrailer {
+	uint64_t indexOffset;
+	uint32_t numFrames;
+	char magic[4];
+};
+
+struct StreamInfo {
+	std::string name;
+	libcamera::PixelFormat pixelFormat;
+	libcamera::Size size;
+	unsigned int stride;
+};
+
+struct Frame {
+	unsigned int stream;
+	uint32_t sequence;
+	uint64_t timestamp;
+	libcamera::ControlList metadata;
+	std::vector<libcamera::Span<const uint8_t>> planes;
+};
+
+class Writer
+{
+public:
+	Writer();
+	~Writer();
+
+	int open(const std::string &filename,
+		 const libcamera::CameraConfiguration &config,
+		 const std::map<const libcamera::Stream *, std::string> &streamNames);
+	int write(const libcamera::Stream *stream,
+		  const libcamera::FrameBuffer *buffer, const Image *image,
+		  const libcamera::ControlList &metadata);
+	int close();
+
+private:
+	LIBCAMERA_DISABLE_COPY(Writer)
+
+	int writeData(const void *data, size_t size);
+
+	int fd_;
+	uint64_t offset_;
+	std::map<const libcamera::Stream *, unsigned int> streams_;
+	std::vector<uint64_t> index_;
+};
+
+class Reader
+{
+public:
+	Reader();
+	~Reader();
+
+	int open(const std::string &filename);
+	void close();
+
+	const std::vector<StreamInfo> &streams() const { return streams_; }
+	size_t numFrames() const { return index_.size(); }
+	int frame(size_t index, Frame *frame) const;
+
+private:
+	LIBCAMERA_DISABLE_COPY(Reader)
+
+	bool buildIndex(uint64_t offset);
+
+	uint8_t *data_;
+	size_t size_;
+	std::vector<StreamInfo> streams_;
+	std::vector<uint64_t> index_;
+};
+
+} /* namespace FrameStream */
@@ -0,0 +1,136 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Raspberry Pi Ltd
+ *
+ * pisp_decompress.cpp - Decompression of PiSP compressed raw images
+ */
+
+#include "pisp_decompress.h"
+
+#include <algorithm>
+#include <string.h>
+
+/*
+ * The PiSP compressed raw formats (formats::*_PISP_COMP1) store 16-bit Bayer
+ * samples in 8 bits per pixel. Each line is split in blocks of 8 pixels, each
+ * stored in 8 bytes as two 32-bit little-endian words. The first word encodes
+ * the even pixels of the block and the second word the odd pixels, so that
+ * each word covers 4 samples of the same colour component.
+ *
+ * The two least significant bits of a word select one of four quantisation
+ * modes, the remaining bits hold the quantised samples, either as a base
+ * value with deltas (modes 0 to 2) or as two packed pairs (mode 3).
+ *
+ * The libcamera PiSP pipeline handler compresses raw frames with compression
+ * mode 1 and an offset of 2048, which is added back to the decompressed
+ * samples. The decompressed samples cover the full 16-bit range, regardless
+ * of the sensor bit depth.
+ *
+ * The line stride is a multiple of 8 bytes, and lines are padded to a whole
+ * number of blocks.
+ */
+
+namespace PiSP {
+
+namespace {
+
+constexpr unsigned int CompressionOffset = 2048;
+
+uint16_t dequantise(int q, unsigned int qmode)
+{
+	switch (qmode) {
+	case 0:
+		return q < 320 ? 16 * q : 32 * (q - 160);
+	case 1:
+		return 64 * q;
+	case 2:
+		return 128 * q;
+	default:
+		return q < 94 ? 256 * q : std::min(0xffff, 512 * (q - 47));
+	}
+}
+
+void decompressSubBlock(uint16_t *output, uint32_t word)
+{
+	unsigned int qmode = word & 3;
+	int q[4];
+
+	if (qmode < 3) {
+		int field0 = (word >> 2) & 511;
+		int field1 = (word >> 11) & 127;
+		int field2 = (word >> 18) & 127;
+		int field3 = (word >> 25) & 127;
+
+		if (qmode == 2 && field0 >= 384) {
+			q[1] = field0;
+			q[2] = field1 + 384;
+		} else {
+			q[1] = field1 >= 64 ? field0 : field0 + 64 - field1;
+			q[2] = field1 >= 64 ? field0 + field1 - 64 : field0;
+		}
+
+		int p1 = std::max(0, q[1] - 64);
+		int p2 = std::max(0, q[2] - 64);
+		if (qmode == 2) {
+			p1 = std::min(384, p1);
+			p2 = std::min(384, p2);
+		}
+
+		q[0] = p1 + field2;
+		q[3] = p2 + field3;
+	} else {
+		int pack0 = (word >> 2) & 32767;
+		int pack1 = (word >> 17) & 32767;
+
+		q[0] = (pack0 & 15) + 16 * ((pack0 >> 8) / 11);
+		q[1] = (pack0 >> 4) % 176;
+		q[2] = (pack1 & 15) + 16 * ((pack1 >> 8) / 11);
+		q[3] = (pack1 >> 4) % 176;
+	}
+
+	for (unsigned int i = 0; i < 4; i++) {
+		unsigned int value = dequantise(q[i], qmode) + CompressionOffset;
+		output[2 * i] = std::min(value, 0xffffu);
+	}
+}
+
+} /* namespace */
+
+/**
+ * \brief Decompress one block of a PiSP compressed raw image
+ * \param[out] output The 8 decompressed 16-bit samples
+ * \param[in] input The 8 bytes of compressed data
+ */
+void decompressBlock(uint16_t *output, const uint8_t *input)
+{
+	uint32_t w0 = input[0] | input[1] << 8 | input[2] << 16 |
+		      static_cast<uint32_t>(input[3]) << 24;
+	uint32_t w1 = input[4] | input[5] << 8 | input[6] << 16 |
+		      static_cast<uint32_t>(input[7]) << 24;
+
+	decompressSubBlock(output, w0);
+	decompressSubBlock(output + 1, w1);
+}
+
+/**
+ * \brief Decompress one line of a PiSP compressed raw image
+ * \param[out] output The decompressed 16-bit samples, \a width entries
+ * \param[in] input The compressed line
+ * \param[in] width The line width in pixels
+ */
+void decompressLine(uint16_t *output, const uint8_t *input, unsigned int width)
+{
+	unsigned int x;
+
+	for (x = 0; x + CompressedBlockPixels <= width; x += CompressedBlockPixels)
+		decompressBlock(output + x, input + x);
+
+	if (x < width) {
+		uint16_t block[CompressedBlockPixels];
+
+		decompressBlock(block, input + x);
+		memcpy(output + x, block, (width - x) * sizeof(*block));
+	}
+}
+
+} /* namespace PiSP */
@@ -0,0 +1,19 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Raspberry Pi Ltd
+ *
+ * pisp_decompress.h - Decompression of PiSP compressed raw images
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace PiSP {
+
+static constexpr unsigned int CompressedBlockPixels = 8;
+
+void decompressBlock(uint16_t *output, const uint8_t *input);
+void decompressLine(uint16_t *output, const uint8_t *input, unsigned int width);
+
+} /* namespace PiSP */
@@ -0,0 +1,40 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * sample_stats.cpp - Statistics of timing samples
+ */
+
+#include "sample_stats.h"
+
+#include <algorithm>
+#include <numeric>
+
+uint64_t clockNs(clockid_t clock)
+{
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+SampleStats::SampleStats(std::vector<int64_t> values)
+	: count(values.size())
+{
+	if (values.empty())
+		return;
+
+	std::sort(values.begin(), values.end());
+
+	auto ms = [&](size_t index) {
+		return values[std::min(index, values.size() - 1)] / 1e6;
+	};
+
+	min = ms(0);
+	p50 = ms(values.size() / 2);
+	p90 = ms(values.size() * 90 / 100);
+	p99 = ms(values.size() * 99 / 100);
+	max = ms(values.size() - 1);
+	mean = std::accumulate(values.begin(), values.end(), 0.0) /
+	       values.size() / 1e6;
+}
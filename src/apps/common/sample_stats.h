@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * sample_stats.h - Statistics of timing samples
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+
+uint64_t clockNs(clockid_t clock);
+
+/* Distribution of samples in nanoseconds, reported in milliseconds. */
+struct SampleStats {
+	SampleStats(std::vector<int64_t> values);
+
+	size_t count;
+	double min = 0.0;
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p90 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
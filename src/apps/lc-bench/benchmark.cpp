@@ -0,0 +1,346 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * benchmark.cpp - Capture benchmark with a null sink
+ */
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <time.h>
+
+#include <libcamera/control_ids.h>
+
+#include "../common/sample_stats.h"
+#include "../common/stream_options.h"
+
+#include "json_writer.h"
+
+using namespace libcamera;
+
+namespace {
+
+/* Upper bound of the frame rate, used to size the samples storage. */
+constexpr unsigned int kMaxFrameRate = 240;
+
+double toMs(std::chrono::steady_clock::duration duration)
+{
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+void reportSamples(JsonWriter &json, const std::string &key,
+		   const SampleStats &stats)
+{
+	json.beginObject(key);
+	json.value("count", stats.count);
+	json.value("min", stats.min);
+	json.value("mean", stats.mean);
+	json.value("p50", stats.p50);
+	json.value("p90", stats.p90);
+	json.value("p99", stats.p99);
+	json.value("max", stats.max);
+	json.endObject();
+}
+
+} /* namespace */
+
+/*
+ * The benchmark captures frames from a camera without consuming them. Requests
+ * are requeued directly from the request completion handler, in the camera
+ * manager thread, to measure the performance of libcamera and of the pipeline
+ * handler alone.
+ *
+ * The first frames of the capture are ignored for the frame rate and latency
+ * statistics, to exclude the startup transient. The CPU time is measured for
+ * the whole capture, including the start and stop operations, and averaged
+ * over all the frames captured.
+ */
+Benchmark::Benchmark(std::shared_ptr<Camera> camera)
+	: camera_(std::move(camera)), running_(false), warmup_(0),
+	  completed_(0), duration_(0), startTime_(0), memory_{}
+{
+}
+
+Benchmark::~Benchmark()
+{
+	requests_.clear();
+	allocator_.reset();
+}
+
+int Benchmark::configure(const OptionValue &streams)
+{
+	std::vector<StreamRole> roles = StreamKeyValueParser::roles(streams);
+
+	config_ = camera_->generateConfiguration(roles);
+	if (!config_ || config_->size() != roles.size()) {
+		std::cerr << "Failed to get default stream configuration"
+			  << std::endl;
+		return -EINVAL;
+	}
+
+	int ret = StreamKeyValueParser::updateConfiguration(config_.get(), streams);
+	if (ret)
+		return ret;
+
+	if (config_->validate() == CameraConfiguration::Invalid) {
+		std::cerr << "Failed to create valid camera configuration"
+			  << std::endl;
+		return -EINVAL;
+	}
+
+	ret = camera_->configure(config_.get());
+	if (ret < 0) {
+		std::cerr << "Failed to configure camera" << std::endl;
+		return ret;
+	}
+
+	allocator_ = std::make_unique<FrameBufferAllocator>(camera_);
+
+	unsigned int numBuffers = std::numeric_limits<unsigned int>::max();
+
+	for (StreamConfiguration &cfg : *config_) {
+		ret = allocator_->allocate(cfg.stream());
+		if (ret < 0) {
+			std::cerr << "Failed to allocate buffers" << std::endl;
+			return ret;
+		}
+
+		numBuffers = std::min<unsigned int>(numBuffers, ret);
+	}
+
+	for (unsigned int i = 0; i < numBuffers; ++i) {
+		std::unique_ptr<Request> request = camera_->createRequest(i);
+		if (!request) {
+			std::cerr << "Failed to create request" << std::endl;
+			return -ENOMEM;
+		}
+
+		for (StreamConfiguration &cfg : *config_) {
+			Stream *stream = cfg.stream();
+			ret = request->addBuffer(stream, allocator_->buffers(stream)[i].get());
+			if (ret < 0) {
+				std::cerr << "Failed to add buffer to request"
+					  << std::endl;
+				return ret;
+			}
+		}
+
+		requests_.push_back(std::move(request));
+	}
+
+	return 0;
+}
+
+int Benchmark::run(std::chrono::milliseconds duration, unsigned int warmup)
+{
+	warmup_ = warmup;
+	completed_ = 0;
+	queueTimes_.assign(requests_.size(), 0);
+
+	/* Reserve the samples storage to avoid allocations while capturing. */
+	samples_.clear();
+	samples_.reserve(duration.count() * kMaxFrameRate / 1000 + 1);
+
+	camera_->requestCompleted.connect(this, &Benchmark::requestComplete);
+
+	ProcessStats::resetPeakMemory();
+	threadsStart_ = ProcessStats::threads();
+
+	auto start = std::chrono::steady_clock::now();
+
+	int ret = camera_->start();
+	if (ret) {
+		std::cerr << "Failed to start camera" << std::endl;
+		camera_->requestCompleted.disconnect(this);
+		return ret;
+	}
+
+	startTime_ = std::chrono::steady_clock::now() - start;
+
+	running_ = true;
+
+	for (std::unique_ptr<Request> &request : requests_) {
+		queueTimes_[request->cookie()] = clockNs(CLOCK_MONOTONIC);
+
+		ret = camera_->queueRequest(request.get());
+		if (ret < 0) {
+			std::cerr << "Can't queue request" << std::endl;
+			break;
+		}
+	}
+
+	if (!ret)
+		std::this_thread::sleep_for(duration);
+
+	running_ = false;
+
+	camera_->stop();
+
+	duration_ = std::chrono::steady_clock::now() - start;
+
+	threadsEnd_ = ProcessStats::threads();
+	memory_ = ProcessStats::memory();
+
+	camera_->requestCompleted.disconnect(this);
+
+	return ret;
+}
+
+void Benchmark::requestComplete(Request *request)
+{
+	if (request->status() == Request::RequestCancelled)
+		return;
+
+	const auto sensorTimestamp = request->metadata().get(controls::SensorTimestamp);
+	uint64_t now = clockNs(sensorTimestamp ? CLOCK_BOOTTIME : CLOCK_MONOTONIC);
+	uint64_t completed = clockNs(CLOCK_MONOTONIC);
+
+	if (completed_++ >= warmup_ && samples_.size() < samples_.capacity()) {
+		const FrameMetadata &metadata =
+			request->buffers().begin()->second->metadata();
+		uint64_t timestamp = sensorTimestamp ? *sensorTimestamp
+						     : metadata.timestamp;
+
+		samples_.push_back({
+			metadata.sequence,
+			static_cast<int64_t>(now - timestamp),
+			static_cast<int64_t>(completed - queueTimes_[request->cookie()]),
+			completed,
+		});
+	}
+
+	if (!running_)
+		return;
+
+	request->reuse(Request::ReuseBuffers);
+	queueTimes_[request->cookie()] = clockNs(CLOCK_MONOTONIC);
+	camera_->queueRequest(request);
+}
+
+/* Compute the request rate from the samples after warmup. */
+double Benchmark::requestRate() const
+{
+	if (samples_.size() < 2)
+		return 0.0;
+
+	uint64_t duration = samples_.back().completed - samples_.front().completed;
+	if (!duration)
+		return 0.0;
+
+	return (samples_.size() - 1) * 1e9 / duration;
+}
+
+uint64_t Benchmark::threadCpuTime(pid_t tid) const
+{
+	auto end = threadsEnd_.find(tid);
+	if (end == threadsEnd_.end())
+		return 0;
+
+	auto start = threadsStart_.find(tid);
+	if (start == threadsStart_.end())
+		return end->second.cpuTime;
+
+	return end->second.cpuTime - start->second.cpuTime;
+}
+
+void Benchmark::print() const
+{
+	uint64_t cpuTime = 0;
+	for (const auto &thread : threadsEnd_)
+		cpuTime += threadCpuTime(thread.first);
+
+	std::cerr << std::fixed << std::setprecision(2)
+		  << camera_->id() << ": " << completed_ << " frames, "
+		  << requestRate() << " requests/s, "
+		  << (completed_ ? cpuTime / 1e6 / completed_ : 0.0)
+		  << " ms CPU/frame, peak RSS " << memory_.peakRss << " kB"
+		  << std::endl;
+}
+
+void Benchmark::report(JsonWriter &json) const
+{
+	json.beginObject();
+
+	json.value("camera", camera_->id());
+
+	json.beginArray("streams");
+	for (const StreamConfiguration &cfg : *config_) {
+		json.beginObject();
+		json.value("pixel_format", cfg.pixelFormat.toString());
+		json.value("width", cfg.size.width);
+		json.value("height", cfg.size.height);
+		json.value("stride", cfg.stride);
+		json.value("buffers", cfg.bufferCount);
+		json.endObject();
+	}
+	json.endArray();
+
+	json.value("duration_ms", toMs(duration_));
+	json.value("start_time_ms", toMs(startTime_));
+	json.value("frames", completed_);
+	json.value("warmup_frames", std::min(warmup_, completed_));
+
+	json.value("requests_per_second", requestRate());
+
+	unsigned int dropped = 0;
+	for (size_t i = 1; i < samples_.size(); ++i) {
+		if (samples_[i].sequence > samples_[i - 1].sequence + 1)
+			dropped += samples_[i].sequence - samples_[i - 1].sequence - 1;
+	}
+	json.value("dropped_frames", dropped);
+
+	std::vector<int64_t> sensorLatencies;
+	std::vector<int64_t> queueLatencies;
+	std::vector<int64_t> intervals;
+
+	sensorLatencies.reserve(samples_.size());
+	queueLatencies.reserve(samples_.size());
+
+	for (size_t i = 0; i < samples_.size(); ++i) {
+		sensorLatencies.push_back(samples_[i].sensorLatency);
+		queueLatencies.push_back(samples_[i].queueLatency);
+		if (i)
+			intervals.push_back(samples_[i].completed - samples_[i - 1].completed);
+	}
+
+	json.beginObject("latency_ms");
+	reportSamples(json, "sensor_to_completion", SampleStats(std::move(sensorLatencies)));
+	reportSamples(json, "queue_to_completion", SampleStats(std::move(queueLatencies)));
+	json.endObject();
+
+	reportSamples(json, "completion_interval_ms", SampleStats(std::move(intervals)));
+
+	/* CPU time per thread, for threads alive at the end of the run. */
+	uint64_t cpuTime = 0;
+
+	json.beginObject("cpu");
+	json.beginArray("threads");
+	for (const auto &[tid, thread] : threadsEnd_) {
+		uint64_t time = threadCpuTime(tid);
+		cpuTime += time;
+
+		json.beginObject();
+		json.value("tid", tid);
+		json.value("name", thread.name);
+		json.value("cpu_ms", time / 1e6);
+		json.value("per_frame_us", completed_ ? time / 1e3 / completed_ : 0.0);
+		json.endObject();
+	}
+	json.endArray();
+	json.value("total_ms", cpuTime / 1e6);
+	json.value("per_frame_us", completed_ ? cpuTime / 1e3 / completed_ : 0.0);
+	json.endObject();
+
+	json.beginObject("memory_kb");
+	json.value("rss", memory_.rss);
+	json.value("peak_rss", memory_.peakRss);
+	json.endObject();
+
+	json.endObject();
+}
@@ -0,0 +1,74 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * benchmark.h - Capture benchmark with a null sink
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include <libcamera/camera.h>
+#include <libcamera/framebuffer_allocator.h>
+#include <libcamera/request.h>
+
+#include "../common/options.h"
+
+#include "process_stats.h"
+
+class JsonWriter;
+
+class Benchmark
+{
+public:
+	Benchmark(std::shared_ptr<libcamera::Camera> camera);
+	~Benchmark();
+
+	int configure(const OptionValue &streams);
+	int run(std::chrono::milliseconds duration, unsigned int warmup);
+
+	void print() const;
+	void report(JsonWriter &json) const;
+
+private:
+	struct Sample {
+		uint32_t sequence;
+		/* Sensor timestamp to request completion */
+		int64_t sensorLatency;
+		/* Request queueing to completion */
+		int64_t queueLatency;
+		/* Completion time on the steady clock */
+		uint64_t completed;
+	};
+
+	void requestComplete(libcamera::Request *request);
+
+	double requestRate() const;
+	uint64_t threadCpuTime(pid_t tid) const;
+
+	std::shared_ptr<libcamera::Camera> camera_;
+	std::unique_ptr<libcamera::CameraConfiguration> config_;
+	std::unique_ptr<libcamera::FrameBufferAllocator> allocator_;
+	std::vector<std::unique_ptr<libcamera::Request>> requests_;
+
+	std::atomic<bool> running_;
+	unsigned int warmup_;
+	unsigned int completed_;
+	/* Queueing time of each request, indexed by cookie */
+	std::vector<uint64_t> queueTimes_;
+	std::vector<Sample> samples_;
+
+	std::chrono::steady_clock::duration duration_;
+	std::chrono::steady_clock::duration startTime_;
+	std::map<pid_t, ProcessStats::ThreadStats> threadsStart_;
+	std::map<pid_t, ProcessStats::ThreadStats> threadsEnd_;
+	ProcessStats::MemoryStats memory_;
+};
@@ -0,0 +1,128 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * json_writer.cpp - Minimal streaming JSON writer
+ */
+
+#include "json_writer.h"
+
+#include <cmath>
+#include <iomanip>
+#include <stdio.h>
+
+/*
+ * The writer emits values as they are written, indenting nested objects and
+ * arrays. Keys are ignored for array members. It doesn't validate the
+ * structure, callers are responsible for balancing the begin and end calls.
+ */
+JsonWriter::JsonWriter(std::ostream &out)
+	: out_(out)
+{
+}
+
+JsonWriter::~JsonWriter()
+{
+	out_ << std::endl;
+}
+
+void JsonWriter::beginObject(const std::string &key)
+{
+	prefix(key);
+	out_ << "{";
+	stack_.push_back(false);
+}
+
+void JsonWriter::endObject()
+{
+	end('}');
+}
+
+void JsonWriter::beginArray(const std::string &key)
+{
+	prefix(key);
+	out_ << "[";
+	stack_.push_back(false);
+}
+
+void JsonWriter::endArray()
+{
+	end(']');
+}
+
+void JsonWriter::value(const std::string &key, const std::string &value)
+{
+	prefix(key);
+	writeString(value);
+}
+
+void JsonWriter::end(char delimiter)
+{
+	bool members = stack_.back();
+	stack_.pop_back();
+
+	if (members)
+		out_ << "\n" << std::string(stack_.size() * 2, ' ');
+	out_ << delimiter;
+}
+
+void JsonWriter::prefix(const std::string &key)
+{
+	if (stack_.empty())
+		return;
+
+	if (stack_.back())
+		out_ << ",";
+	stack_.back() = true;
+
+	out_ << "\n" << std::string(stack_.size() * 2, ' ');
+
+	if (!key.empty()) {
+		writeString(key);
+		out_ << ": ";
+	}
+}
+
+void JsonWriter::writeString(const std::string &str)
+{
+	out_ << '"';
+
+	for (char c : str) {
+		switch (c) {
+		case '"':
+			out_ << "\\\"";
+			break;
+		case '\\':
+			out_ << "\\\\";
+			break;
+		case '\n':
+			out_ << "\\n";
+			break;
+		case '\t':
+			out_ << "\\t";
+			break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20) {
+				char buf[8];
+				snprintf(buf, sizeof(buf), "\\u%04x", c);
+				out_ << buf;
+			} else {
+				out_ << c;
+			}
+			break;
+		}
+	}
+
+	out_ << '"';
+}
+
+void JsonWriter::writeDouble(double value)
+{
+	/* JSON has no representation for infinities and NaN. */
+	if (!std::isfinite(value)) {
+		out_ << "null";
+		return;
+	}
+
+	out_ << std::setprecision(6) << value;
+}
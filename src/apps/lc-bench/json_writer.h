@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * json_writer.h - Minimal streaming JSON writer
+ */
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+class JsonWriter
+{
+public:
+	JsonWriter(std::ostream &out);
+	~JsonWriter();
+
+	void beginObject(const std::string &key = {});
+	void endObject();
+
+	void beginArray(const std::string &key = {});
+	void endArray();
+
+	void value(const std::string &key, const std::string &value);
+	void value(const std::string &key, const char *value)
+	{
+		this->value(key, std::string(value));
+	}
+
+	template<typename T,
+		 std::enable_if_t<std::is_arithmetic_v<T>> * = nullptr>
+	void value(const std::string &key, T value)
+	{
+		prefix(key);
+
+		if constexpr (std::is_same_v<T, bool>)
+			out_ << (value ? "true" : "false");
+		else if constexpr (std::is_floating_point_v<T>)
+			writeDouble(value);
+		else
+			out_ << +value;
+	}
+
+private:
+	void end(char delimiter);
+	void prefix(const std::string &key);
+	void writeString(const std::string &str);
+	void writeDouble(double value);
+
+	std::ostream &out_;
+	/* One entry per open object or array, true if it has members. */
+	std::vector<bool> stack_;
+};
@@ -0,0 +1,205 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * main.cpp - lc-bench - The libcamera capture benchmark tool
+ */
+
+#include <errno.h>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libcamera/libcamera.h>
+
+#include "../common/options.h"
+#include "../common/stream_options.h"
+
+#include "benchmark.h"
+#include "json_writer.h"
+
+using namespace libcamera;
+
+enum {
+	OptCamera = 'c',
+	OptDuration = 'd',
+	OptHelp = 'h',
+	OptList = 'l',
+	OptOutput = 'o',
+	OptStream = 's',
+	OptWarmup = 'w',
+};
+
+namespace {
+
+constexpr unsigned int kDefaultDuration = 10;
+constexpr unsigned int kDefaultWarmup = 10;
+
+int parseOptions(int argc, char **argv, StreamKeyValueParser *streamKeyValue,
+		 OptionsParser::Options *options)
+{
+	OptionsParser parser;
+	parser.addOption(OptCamera, OptionString,
+			 "Benchmark a camera, by index or id. Can be repeated to benchmark\n"
+			 "multiple cameras, or the same camera with different configurations.\n"
+			 "Cameras are benchmarked sequentially",
+			 "camera", ArgumentRequired, "camera", true);
+	parser.addOption(OptDuration, OptionInteger,
+			 "Duration of each benchmark run in seconds (default 10)",
+			 "duration", ArgumentRequired, "seconds");
+	parser.addOption(OptHelp, OptionNone, "Display this help message",
+			 "help");
+	parser.addOption(OptList, OptionNone, "List all cameras", "list");
+	parser.addOption(OptOutput, OptionString,
+			 "Write the results in JSON format to a file instead of stdout",
+			 "output", ArgumentRequired, "file");
+	parser.addOption(OptWarmup, OptionInteger,
+			 "Number of frames to exclude from the frame rate and latency\n"
+			 "statistics at the start of each run (default 10)",
+			 "warmup", ArgumentRequired, "frames");
+
+	/* Sub-options of OptCamera: */
+	parser.addOption(OptStream, streamKeyValue,
+			 "Set configuration of a camera stream", "stream", true,
+			 OptCamera);
+
+	*options = parser.parse(argc, argv);
+	if (!options->valid())
+		return -EINVAL;
+
+	if (options->empty() || options->isSet(OptHelp)) {
+		parser.usage();
+		return options->empty() ? -EINVAL : -EINTR;
+	}
+
+	return 0;
+}
+
+std::shared_ptr<Camera> findCamera(CameraManager *cm, const std::string &cameraId)
+{
+	char *endptr;
+	unsigned long index = strtoul(cameraId.c_str(), &endptr, 10);
+	if (*endptr == '\0' && index > 0 && index <= cm->cameras().size())
+		return cm->cameras()[index - 1];
+
+	return cm->get(cameraId);
+}
+
+int benchmarkCamera(CameraManager *cm, const OptionValue &camera,
+		    std::chrono::milliseconds duration, unsigned int warmup,
+		    JsonWriter &json)
+{
+	const std::string &cameraId = camera.toString();
+
+	std::shared_ptr<Camera> cam = findCamera(cm, cameraId);
+	if (!cam) {
+		std::cerr << "Camera " << cameraId << " not found" << std::endl;
+		return -ENODEV;
+	}
+
+	if (cam->acquire()) {
+		std::cerr << "Failed to acquire camera " << cameraId << std::endl;
+		return -EBUSY;
+	}
+
+	int ret;
+
+	{
+		Benchmark benchmark(cam);
+
+		ret = benchmark.configure(camera.children()[OptStream]);
+		if (!ret)
+			ret = benchmark.run(duration, warmup);
+
+		if (!ret) {
+			benchmark.print();
+			benchmark.report(json);
+		}
+	}
+
+	cam->release();
+
+	return ret;
+}
+
+} /* namespace */
+
+int main(int argc, char **argv)
+{
+	StreamKeyValueParser streamKeyValue;
+	OptionsParser::Options options;
+
+	int ret = parseOptions(argc, argv, &streamKeyValue, &options);
+	if (ret == -EINTR)
+		return EXIT_SUCCESS;
+	if (ret < 0)
+		return EXIT_FAILURE;
+
+	unsigned int duration = options.isSet(OptDuration)
+			      ? options[OptDuration].toInteger() : kDefaultDuration;
+	unsigned int warmup = options.isSet(OptWarmup)
+			    ? options[OptWarmup].toInteger() : kDefaultWarmup;
+
+	std::unique_ptr<CameraManager> cm = std::make_unique<CameraManager>();
+
+	ret = cm->start();
+	if (ret) {
+		std::cerr << "Failed to start camera manager: "
+			  << strerror(-ret) << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (options.isSet(OptList)) {
+		std::cout << "Available cameras:" << std::endl;
+
+		unsigned int index = 1;
+		for (const std::shared_ptr<Camera> &cam : cm->cameras())
+			std::cout << index++ << ": " << cam->id() << std::endl;
+	}
+
+	if (!options.isSet(OptCamera)) {
+		cm->stop();
+		return options.isSet(OptList) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	std::ofstream file;
+	if (options.isSet(OptOutput)) {
+		const std::string &filename = options[OptOutput];
+		file.open(filename);
+		if (!file.is_open()) {
+			std::cerr << "Failed to open output file " << filename
+				  << std::endl;
+			cm->stop();
+			return EXIT_FAILURE;
+		}
+	}
+
+	unsigned int failures = 0;
+
+	{
+		JsonWriter json(file.is_open() ? file : std::cout);
+
+		json.beginObject();
+		json.value("libcamera_version", CameraManager::version());
+		json.value("duration_s", duration);
+		json.value("warmup_frames", warmup);
+
+		json.beginArray("runs");
+		for (const OptionValue &camera : options[OptCamera].toArray()) {
+			ret = benchmarkCamera(cm.get(), camera,
+					      std::chrono::seconds(duration),
+					      warmup, json);
+			if (ret)
+				failures++;
+		}
+		json.endArray();
+
+		json.endObject();
+	}
+
+	cm->stop();
+
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * process_stats.cpp - Per-thread CPU time and memory usage of the process
+ */
+
+#include "process_stats.h"
+
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace ProcessStats {
+
+namespace {
+
+/*
+ * Build the CPU-time clock ID of a thread of the current process, as done by
+ * pthread_getcpuclockid() for pthread_t handles. The encoding is part of the
+ * Linux kernel ABI.
+ */
+clockid_t threadClock(pid_t tid)
+{
+	return (~static_cast<clockid_t>(tid) << 3) | 6;
+}
+
+/*
+ * Fall back to the user and system times from /proc, with a clock tick
+ * resolution, if the thread CPU clock can't be read.
+ */
+uint64_t statCpuTime(const std::string &path)
+{
+	std::ifstream file(path + "/stat");
+	std::string line;
+	if (!std::getline(file, line))
+		return 0;
+
+	/* The thread name can contain spaces, skip past it. */
+	size_t pos = line.rfind(')');
+	if (pos == std::string::npos)
+		return 0;
+
+	std::istringstream fields(line.substr(pos + 2));
+	std::string field;
+	uint64_t utime = 0, stime = 0;
+
+	/* utime and stime are the 14th and 15th fields, state is the 3rd. */
+	for (unsigned int i = 3; i <= 15 && fields >> field; ++i) {
+		if (i == 14)
+			utime = strtoull(field.c_str(), nullptr, 10);
+		else if (i == 15)
+			stime = strtoull(field.c_str(), nullptr, 10);
+	}
+
+	return (utime + stime) * 1000000000ULL / sysconf(_SC_CLK_TCK);
+}
+
+} /* namespace */
+
+/*
+ * Sample the CPU time of all the threads of the process. Threads that exit
+ * between two samples are not accounted for, which doesn't matter for
+ * libcamera as its threads live as long as the camera manager.
+ */
+std::map<pid_t, ThreadStats> threads()
+{
+	std::map<pid_t, ThreadStats> stats;
+
+	DIR *dir = opendir("/proc/self/task");
+	if (!dir)
+		return stats;
+
+	while (struct dirent *entry = readdir(dir)) {
+		char *end;
+		pid_t tid = strtol(entry->d_name, &end, 10);
+		if (*end != '\0' || tid <= 0)
+			continue;
+
+		std::string path = std::string("/proc/self/task/") + entry->d_name;
+		ThreadStats &thread = stats[tid];
+
+		std::ifstream comm(path + "/comm");
+		std::getline(comm, thread.name);
+
+		struct timespec ts;
+		if (!clock_gettime(threadClock(tid), &ts))
+			thread.cpuTime = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+		else
+			thread.cpuTime = statCpuTime(path);
+	}
+
+	closedir(dir);
+
+	return stats;
+}
+
+MemoryStats memory()
+{
+	MemoryStats stats = {};
+
+	std::ifstream file("/proc/self/status");
+	std::string line;
+
+	while (std::getline(file, line)) {
+		std::istringstream fields(line);
+		std::string key;
+		uint64_t value;
+
+		if (!(fields >> key >> value))
+			continue;
+
+		if (key == "VmRSS:")
+			stats.rss = value;
+		else if (key == "VmHWM:")
+			stats.peakRss = value;
+	}
+
+	return stats;
+}
+
+/*
+ * Reset the resident set size high-water mark to the current RSS, to measure
+ * the peak memory usage of each benchmark run separately. This is best effort,
+ * the peak then covers the whole process lifetime if it fails.
+ */
+void resetPeakMemory()
+{
+	std::ofstream file("/proc/self/clear_refs");
+	file << "5" << std::endl;
+}
+
+} /* namespace ProcessStats */
@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * process_stats.h - Per-thread CPU time and memory usage of the process
+ */
+
+#pragma once
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+
+namespace ProcessStats {
+
+struct ThreadStats {
+	std::string name;
+	/* CPU time consumed by the thread, in nanoseconds */
+	uint64_t cpuTime;
+};
+
+struct MemoryStats {
+	/* Resident set size and its high-water mark, in kB */
+	uint64_t rss;
+	uint64_t peakRss;
+};
+
+std::map<pid_t, ThreadStats> threads();
+
+MemoryStats memory();
+void resetPeakMemory();
+
+} /* namespace ProcessStats */
@@ -7,6 +7,12 @@
 
 #include "environment.h"
 
+#include <errno.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
 using namespace libcamera;
 
 Environment *Environment::get()
@@ -20,3 +26,64 @@ void Environment::setup(CameraManager *cm, std::string cameraId)
 	cm_ = cm;
 	cameraId_ = cameraId;
 }
+
+/*
+ * Load performance thresholds from a file, to let vendors and integrators
+ * express the performance expected from their platform. The file contains
+ * one "key: value" pair per line, and lines starting with '#' are ignored.
+ * This keeps the file a valid YAML document without requiring a YAML parser.
+ * Thresholds not specified in the file keep their default value.
+ */
+int Environment::loadThresholds(const std::string &file)
+{
+	const std::map<std::string, double *> doubles = {
+		{ "frame-rate-tolerance", &thresholds_.frameRateTolerance },
+		{ "latency-max", &thresholds_.latencyMax },
+		{ "configure-time-max", &thresholds_.configureTimeMax },
+		{ "start-time-max", &thresholds_.startTimeMax },
+		{ "dropped-frames-max", &thresholds_.droppedFramesMax },
+	};
+
+	std::ifstream input(file);
+	if (!input.is_open()) {
+		std::cerr << "Failed to open thresholds file " << file << std::endl;
+		return -ENOENT;
+	}
+
+	std::string line;
+	unsigned int lineNumber = 0;
+
+	while (std::getline(input, line)) {
+		lineNumber++;
+
+		size_t start = line.find_first_not_of(" \t");
+		if (start == std::string::npos || line[start] == '#')
+			continue;
+
+		size_t colon = line.find(':');
+		std::string key = line.substr(start, colon - start);
+		key.erase(key.find_last_not_of(" \t") + 1);
+
+		std::istringstream value(colon != std::string::npos
+					 ? line.substr(colon + 1) : "");
+
+		auto it = doubles.find(key);
+		bool valid;
+
+		if (it != doubles.end())
+			valid = static_cast<bool>(value >> *it->second);
+		else if (key == "soak-duration")
+			valid = static_cast<bool>(value >> thresholds_.soakDuration);
+		else
+			valid = false;
+
+		if (!valid) {
+			std::cerr << file << ":" << lineNumber
+				  << ": invalid threshold '" << line << "'"
+				  << std::endl;
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
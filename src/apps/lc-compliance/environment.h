@@ -7,21 +7,40 @@
 
 #pragma once
 
+#include <string>
+
 #include <libcamera/libcamera.h>
 
+struct PerformanceThresholds {
+	/* Maximum frame rate shortfall, in percent of the requested rate */
+	double frameRateTolerance = 5.0;
+	/* Maximum 99th percentile of the capture latency, in milliseconds */
+	double latencyMax = 100.0;
+	/* Maximum Camera::configure() and Camera::start() times, in ms */
+	double configureTimeMax = 1000.0;
+	double startTimeMax = 1000.0;
+	/* Maximum frames dropped during the soak test, in percent */
+	double droppedFramesMax = 1.0;
+	/* Duration of the soak test, in seconds */
+	unsigned int soakDuration = 30;
+};
+
 class Environment
 {
 public:
 	static Environment *get();
 
 	void setup(libcamera::CameraManager *cm, std::string cameraId);
+	int loadThresholds(const std::string &file);
 
 	const std::string &cameraId() const { return cameraId_; }
 	libcamera::CameraManager *cm() const { return cm_; }
+	const PerformanceThresholds &thresholds() const { return thresholds_; }
 
 private:
 	Environment() = default;
 
 	std::string cameraId_;
 	libcamera::CameraManager *cm_;
+	PerformanceThresholds thresholds_;
 };
@@ -25,6 +25,7 @@ enum {
 	OptList = 'l',
 	OptFilter = 'f',
 	OptHelp = 'h',
+	OptThresholds = 't',
 };
 
 /*
@@ -148,6 +149,9 @@ static int parseOptions(int argc, char **argv, OptionsParser::Options *options)
 			 ArgumentRequired, "filter");
 	parser.addOption(OptHelp, OptionNone, "Display this help message",
 			 "help");
+	parser.addOption(OptThresholds, OptionString,
+			 "Load the performance test thresholds from a file",
+			 "thresholds", ArgumentRequired, "file");
 
 	*options = parser.parse(argc, argv);
 	if (!options->valid())
@@ -172,6 +176,12 @@ int main(int argc, char **argv)
 	if (ret < 0)
 		return EXIT_FAILURE;
 
+	if (options.isSet(OptThresholds)) {
+		ret = Environment::get()->loadThresholds(options[OptThresholds]);
+		if (ret)
+			return EXIT_FAILURE;
+	}
+
 	std::unique_ptr<CameraManager> cm = std::make_unique<CameraManager>();
 
 	/* No need to initialize the camera if we'll just list tests */
@@ -0,0 +1,247 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * performance_test.cpp - Test camera capture performance
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+#include <gtest/gtest.h>
+
+#include "environment.h"
+#include "simple_capture.h"
+
+using namespace libcamera;
+
+namespace {
+
+const std::vector<StreamRole> ROLES = {
+	StreamRole::Raw,
+	StreamRole::StillCapture,
+	StreamRole::VideoRecording,
+	StreamRole::Viewfinder
+};
+
+/* Duration of the frame rate and latency measurements. */
+constexpr std::chrono::seconds kCaptureDuration{ 5 };
+
+double toMs(std::chrono::steady_clock::duration duration)
+{
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+/* Compute the achieved frame rate from the frame timestamps. */
+double frameRate(const std::vector<SimpleCapturePerformance::Sample> &samples)
+{
+	if (samples.size() < 2)
+		return 0.0;
+
+	uint64_t duration = samples.back().timestamp - samples.front().timestamp;
+	if (!duration)
+		return 0.0;
+
+	return (samples.size() - 1) * 1e9 / duration;
+}
+
+} /* namespace */
+
+class Performance : public testing::TestWithParam<StreamRole>
+{
+public:
+	static std::string nameParameters(const testing::TestParamInfo<Performance::ParamType> &info);
+
+protected:
+	void SetUp() override;
+	void TearDown() override;
+
+	std::shared_ptr<Camera> camera_;
+};
+
+void Performance::SetUp()
+{
+	Environment *env = Environment::get();
+
+	camera_ = env->cm()->get(env->cameraId());
+
+	ASSERT_EQ(camera_->acquire(), 0);
+}
+
+void Performance::TearDown()
+{
+	if (!camera_)
+		return;
+
+	camera_->release();
+	camera_.reset();
+}
+
+std::string Performance::nameParameters(const testing::TestParamInfo<Performance::ParamType> &info)
+{
+	std::map<StreamRole, std::string> rolesMap = {
+		{ StreamRole::Raw, "Raw" },
+		{ StreamRole::StillCapture, "StillCapture" },
+		{ StreamRole::VideoRecording, "VideoRecording" },
+		{ StreamRole::Viewfinder, "Viewfinder" }
+	};
+
+	return rolesMap[info.param];
+}
+
+/*
+ * Test the achieved frame rate
+ *
+ * Requests the highest frame rate supported by the camera through the
+ * FrameDurationLimits control, and makes sure the frame rate measured from the
+ * frame timestamps doesn't fall short of it by more than the tolerance.
+ */
+TEST_P(Performance, FrameRate)
+{
+	const PerformanceThresholds &thresholds = Environment::get()->thresholds();
+	StreamRole role = GetParam();
+
+	auto info = camera_->controls().find(&controls::FrameDurationLimits);
+	if (info == camera_->controls().end()) {
+		std::cout << "FrameDurationLimits not supported by camera" << std::endl;
+		GTEST_SKIP();
+	}
+
+	int64_t frameDuration = info->second.min().get<int64_t>();
+	ASSERT_GT(frameDuration, 0) << "Invalid minimum frame duration";
+
+	SimpleCapturePerformance capture(camera_);
+
+	capture.configure(role);
+
+	ControlList controls(controls::controls);
+	controls.set(controls::FrameDurationLimits,
+		     { frameDuration, frameDuration });
+
+	capture.capture(kCaptureDuration, &controls);
+
+	double target = 1e6 / frameDuration;
+	double fps = frameRate(capture.samples());
+
+	RecordProperty("target_fps", std::to_string(target));
+	RecordProperty("fps", std::to_string(fps));
+
+	std::cout << "Frame rate " << fps << " fps (requested " << target
+		  << " fps)" << std::endl;
+
+	EXPECT_GE(fps, target * (1.0 - thresholds.frameRateTolerance / 100))
+		<< "Frame rate too low";
+}
+
+/*
+ * Test the capture latency
+ *
+ * Measures the time between the capture of each frame and the completion of
+ * the corresponding request, and makes sure its 99th percentile stays below
+ * the threshold.
+ */
+TEST_P(Performance, Latency)
+{
+	const PerformanceThresholds &thresholds = Environment::get()->thresholds();
+	StreamRole role = GetParam();
+
+	SimpleCapturePerformance capture(camera_);
+
+	capture.configure(role);
+
+	capture.capture(kCaptureDuration);
+
+	std::vector<int64_t> latencies;
+	for (const auto &sample : capture.samples())
+		latencies.push_back(sample.latency);
+
+	ASSERT_FALSE(latencies.empty()) << "No frame captured";
+
+	std::sort(latencies.begin(), latencies.end());
+
+	double p50 = latencies[latencies.size() / 2] / 1e6;
+	double p99 = latencies[latencies.size() * 99 / 100] / 1e6;
+
+	RecordProperty("latency_p50_ms", std::to_string(p50));
+	RecordProperty("latency_p99_ms", std::to_string(p99));
+
+	std::cout << "Latency p50 " << p50 << " ms, p99 " << p99 << " ms"
+		  << std::endl;
+
+	EXPECT_LE(p99, thresholds.latencyMax) << "Latency too high";
+}
+
+/*
+ * Test the configuration and start time
+ *
+ * Makes sure Camera::configure() and Camera::start() complete within the
+ * thresholds, as they directly impact the time needed to open a camera
+ * application or switch between modes.
+ */
+TEST_P(Performance, StartupTime)
+{
+	const PerformanceThresholds &thresholds = Environment::get()->thresholds();
+	StreamRole role = GetParam();
+
+	SimpleCapturePerformance capture(camera_);
+
+	capture.configure(role);
+
+	capture.capture(std::chrono::milliseconds(500));
+
+	double configureTime = toMs(capture.configureTime());
+	double startTime = toMs(capture.startTime());
+
+	RecordProperty("configure_time_ms", std::to_string(configureTime));
+	RecordProperty("start_time_ms", std::to_string(startTime));
+
+	std::cout << "configure() " << configureTime << " ms, start() "
+		  << startTime << " ms" << std::endl;
+
+	EXPECT_LE(configureTime, thresholds.configureTimeMax)
+		<< "Configuration too slow";
+	EXPECT_LE(startTime, thresholds.startTimeMax) << "Start too slow";
+}
+
+/*
+ * Test dropped frames over a sustained capture
+ *
+ * Captures for the soak duration and counts the frames dropped, detected as
+ * gaps in the frame sequence numbers. Example failure is a pipeline that can't
+ * sustain the frame rate due to buffer starvation or processing overruns.
+ */
+TEST_P(Performance, Soak)
+{
+	const PerformanceThresholds &thresholds = Environment::get()->thresholds();
+	StreamRole role = GetParam();
+
+	SimpleCapturePerformance capture(camera_);
+
+	capture.configure(role);
+
+	capture.capture(std::chrono::seconds(thresholds.soakDuration));
+
+	const auto &samples = capture.samples();
+	ASSERT_GE(samples.size(), 2U) << "Not enough frames captured";
+
+	unsigned int dropped = 0;
+	for (size_t i = 1; i < samples.size(); ++i)
+		dropped += samples[i].sequence - samples[i - 1].sequence - 1;
+
+	unsigned int total = samples.back().sequence - samples.front().sequence + 1;
+	double ratio = dropped * 100.0 / total;
+
+	RecordProperty("frames", std::to_string(samples.size()));
+	RecordProperty("dropped", std::to_string(dropped));
+
+	std::cout << samples.size() << " frames, " << dropped << " dropped ("
+		  << std::setprecision(3) << ratio << " %)" << std::endl;
+
+	EXPECT_LE(ratio, thresholds.droppedFramesMax) << "Too many dropped frames";
+}
+
+INSTANTIATE_TEST_SUITE_P(PerformanceTests,
+			 Performance,
+			 testing::ValuesIn(ROLES),
+			 Performance::nameParameters);
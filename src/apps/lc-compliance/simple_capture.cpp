@@ -5,6 +5,9 @@
  * simple_capture.cpp - Simple capture helper
  */
 
+#include <errno.h>
+#include <time.h>
+
 #include <gtest/gtest.h>
 
 #include "simple_capture.h"
@@ -13,7 +16,8 @@ using namespace libcamera;
 
 SimpleCapture::SimpleCapture(std::shared_ptr<Camera> camera)
 	: loop_(nullptr), camera_(camera),
-	  allocator_(std::make_unique<FrameBufferAllocator>(camera))
+	  allocator_(std::make_unique<FrameBufferAllocator>(camera)),
+	  configureTime_(0), startTime_(0)
 {
 }
 
@@ -36,13 +40,17 @@ void SimpleCapture::configure(StreamRole role)
 		FAIL() << "Configuration not valid";
 	}
 
-	if (camera_->configure(config_.get())) {
+	auto begin = std::chrono::steady_clock::now();
+	int ret = camera_->configure(config_.get());
+	configureTime_ = std::chrono::steady_clock::now() - begin;
+
+	if (ret) {
 		config_.reset();
 		FAIL() << "Failed to configure camera";
 	}
 }
 
-void SimpleCapture::start()
+void SimpleCapture::start(const ControlList *controls)
 {
 	Stream *stream = config_->at(0).stream();
 	int count = allocator_->allocate(stream);
@@ -52,7 +60,11 @@ void SimpleCapture::start()
 
 	camera_->requestCompleted.connect(this, &SimpleCapture::requestComplete);
 
-	ASSERT_EQ(camera_->start(), 0) << "Failed to start camera";
+	auto begin = std::chrono::steady_clock::now();
+	int ret = camera_->start(controls);
+	startTime_ = std::chrono::steady_clock::now() - begin;
+
+	ASSERT_EQ(ret, 0) << "Failed to start camera";
 }
 
 void SimpleCapture::stop()
@@ -188,3 +200,91 @@ void SimpleCaptureUnbalanced::requestComplete(Request *request)
 	if (camera_->queueRequest(request))
 		loop_->exit(-EINVAL);
 }
+
+/* SimpleCapturePerformance */
+
+namespace {
+
+uint64_t clockNs(clockid_t clock)
+{
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+} /* namespace */
+
+SimpleCapturePerformance::SimpleCapturePerformance(std::shared_ptr<Camera> camera)
+	: SimpleCapture(camera)
+{
+}
+
+/*
+ * Capture frames continuously for the given duration, requeuing requests as
+ * soon as they complete, and record the sequence number, timestamp and
+ * latency of every frame. The latency is measured from the SensorTimestamp
+ * metadata to the request completion, or from the buffer timestamp if the
+ * pipeline handler doesn't report the sensor timestamp.
+ */
+void SimpleCapturePerformance::capture(std::chrono::milliseconds duration,
+				       const ControlList *controls)
+{
+	start(controls);
+
+	Stream *stream = config_->at(0).stream();
+	const std::vector<std::unique_ptr<FrameBuffer>> &buffers = allocator_->buffers(stream);
+
+	samples_.clear();
+	samples_.reserve(duration.count() * 240 / 1000);
+	end_ = std::chrono::steady_clock::now() + duration;
+
+	for (const std::unique_ptr<FrameBuffer> &buffer : buffers) {
+		std::unique_ptr<Request> request = camera_->createRequest();
+		ASSERT_TRUE(request) << "Can't create request";
+
+		ASSERT_EQ(request->addBuffer(stream, buffer.get()), 0) << "Can't set buffer for request";
+
+		ASSERT_EQ(camera_->queueRequest(request.get()), 0) << "Failed to queue request";
+
+		requests_.push_back(std::move(request));
+	}
+
+	/* Run capture session, with a watchdog in case frames stop flowing. */
+	loop_ = new EventLoop();
+	loop_->addTimerEvent(duration + std::chrono::seconds(5),
+			     [&]() { loop_->exit(-ETIMEDOUT); });
+	int status = loop_->exec();
+	stop();
+	delete loop_;
+
+	ASSERT_EQ(status, 0) << "Capture timed out";
+}
+
+void SimpleCapturePerformance::requestComplete(Request *request)
+{
+	if (request->status() == Request::RequestCancelled)
+		return;
+
+	const auto sensorTimestamp = request->metadata().get(controls::SensorTimestamp);
+	uint64_t now = clockNs(sensorTimestamp ? CLOCK_BOOTTIME : CLOCK_MONOTONIC);
+
+	const FrameBuffer *buffer = request->buffers().begin()->second;
+	const FrameMetadata &metadata = buffer->metadata();
+
+	if (metadata.status == FrameMetadata::FrameSuccess) {
+		uint64_t timestamp = sensorTimestamp ? *sensorTimestamp
+						     : metadata.timestamp;
+		samples_.push_back({ metadata.sequence, metadata.timestamp,
+				     static_cast<int64_t>(now - timestamp) });
+	}
+
+	if (std::chrono::steady_clock::now() >= end_) {
+		loop_->exit(0);
+		return;
+	}
+
+	request->reuse(Request::ReuseBuffers);
+	if (camera_->queueRequest(request))
+		loop_->exit(-EINVAL);
+}
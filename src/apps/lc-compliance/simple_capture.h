@@ -7,7 +7,10 @@
 
 #pragma once
 
+#include <chrono>
 #include <memory>
+#include <stdint.h>
+#include <vector>
 
 #include <libcamera/libcamera.h>
 
@@ -18,11 +21,14 @@ class SimpleCapture
 public:
 	void configure(libcamera::StreamRole role);
 
+	std::chrono::steady_clock::duration configureTime() const { return configureTime_; }
+	std::chrono::steady_clock::duration startTime() const { return startTime_; }
+
 protected:
 	SimpleCapture(std::shared_ptr<libcamera::Camera> camera);
 	virtual ~SimpleCapture();
 
-	void start();
+	void start(const libcamera::ControlList *controls = nullptr);
 	void stop();
 
 	virtual void requestComplete(libcamera::Request *request) = 0;
@@ -33,6 +39,9 @@ protected:
 	std::unique_ptr<libcamera::FrameBufferAllocator> allocator_;
 	std::unique_ptr<libcamera::CameraConfiguration> config_;
 	std::vector<std::unique_ptr<libcamera::Request>> requests_;
+
+	std::chrono::steady_clock::duration configureTime_;
+	std::chrono::steady_clock::duration startTime_;
 };
 
 class SimpleCaptureBalanced : public SimpleCapture
@@ -64,3 +73,28 @@ private:
 	unsigned int captureCount_;
 	unsigned int captureLimit_;
 };
+
+class SimpleCapturePerformance : public SimpleCapture
+{
+public:
+	struct Sample {
+		uint32_t sequence;
+		/* Frame timestamp, in nanoseconds */
+		uint64_t timestamp;
+		/* Time from capture to request completion, in nanoseconds */
+		int64_t latency;
+	};
+
+	SimpleCapturePerformance(std::shared_ptr<libcamera::Camera> camera);
+
+	void capture(std::chrono::milliseconds duration,
+		     const libcamera::ControlList *controls = nullptr);
+
+	const std::vector<Sample> &samples() const { return samples_; }
+
+private:
+	void requestComplete(libcamera::Request *request) override;
+
+	std::chrono::steady_clock::time_point end_;
+	std::vector<Sample> samples_;
+};
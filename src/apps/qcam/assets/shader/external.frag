@@ -0,0 +1,21 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * external.frag - Fragment shader code for imported dmabuf images
+ */
+
+#extension GL_OES_EGL_image_external : require
+
+#ifdef GL_ES
+precision mediump float;
+#endif
+
+varying vec2 textureOut;
+uniform samplerExternalOES tex_y;
+
+void main(void)
+{
+	/* Format conversion is handled by the sampler. */
+	gl_FragColor = vec4(texture2D(tex_y, textureOut).rgb, 1.0);
+}
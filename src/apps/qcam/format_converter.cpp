@@ -7,8 +7,17 @@
 
 #include "format_converter.h"
 
+#include <algorithm>
 #include <errno.h>
+#include <thread>
 #include <utility>
+#include <vector>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include <QImage>
 
@@ -16,7 +25,7 @@
 
 #include "../common/image.h"
 
-#define RGBSHIFT		8
+#define RGBSHIFT		6
 #ifndef MAX
 #define MAX(a,b)		((a)>(b)?(a):(b))
 #endif
@@ -30,8 +39,32 @@
 #define CLIP(x)			CLAMP(x,0,255)
 #endif
 
+namespace {
+
+/* Maximum number of threads, leaving CPU time for the camera and the UI. */
+constexpr unsigned int kMaxThreads = 4;
+
+/* Minimum number of lines converted by each thread. */
+constexpr unsigned int kMinLinesPerThread = 64;
+
+} /* namespace */
+
+FormatConverter::FormatConverter()
+	: width_(0), height_(0), stride_(0), scale_(1), outWidth_(0),
+	  outHeight_(0)
+{
+	numThreads_ = std::clamp(std::thread::hardware_concurrency(), 1U,
+				 kMaxThreads);
+}
+
+/*
+ * When the scale is larger than 1, the image is downscaled while converting by
+ * skipping pixels and lines, to save CPU time when the viewfinder is smaller
+ * than the frames. Downscaling isn't supported for MJPEG.
+ */
 int FormatConverter::configure(const libcamera::PixelFormat &format,
-			       const QSize &size, unsigned int stride)
+			       const QSize &size, unsigned int stride,
+			       unsigned int scale)
 {
 	switch (format) {
 	case libcamera::formats::NV12:
@@ -178,182 +211,262 @@ int FormatConverter::configure(const libcamera::PixelFormat &format,
 	height_ = size.height();
 	stride_ = stride;
 
+	scale_ = formatFamily_ == MJPEG ? 1 : std::max(scale, 1U);
+	outWidth_ = width_ / scale_;
+	outHeight_ = height_ / scale_;
+
 	return 0;
 }
 
+QSize FormatConverter::outputSize() const
+{
+	return QSize(outWidth_, outHeight_);
+}
+
 void FormatConverter::convert(const Image *src, size_t size, QImage *dst)
 {
-	switch (formatFamily_) {
-	case MJPEG:
+	if (formatFamily_ == MJPEG) {
 		dst->loadFromData(src->data(0).data(), size, "JPEG");
-		break;
-	case RGB:
-		convertRGB(src, dst->bits());
-		break;
-	case YUVPacked:
-		convertYUVPacked(src, dst->bits());
-		break;
-	case YUVSemiPlanar:
-		convertYUVSemiPlanar(src, dst->bits());
-		break;
-	case YUVPlanar:
-		convertYUVPlanar(src, dst->bits());
-		break;
-	};
+		return;
+	}
+
+	unsigned char *bits = dst->bits();
+	unsigned int dstStride = dst->bytesPerLine();
+
+	/*
+	 * Split the image in bands of lines converted concurrently. Small
+	 * images are converted in the calling thread only, as the cost of
+	 * starting threads would outweigh the gain.
+	 */
+	unsigned int numThreads = std::min(numThreads_,
+					   std::max(outHeight_ / kMinLinesPerThread, 1U));
+
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads - 1);
+
+	for (unsigned int i = 1; i < numThreads; ++i)
+		threads.emplace_back(&FormatConverter::convertLines, this, src,
+				     bits, dstStride, outHeight_ * i / numThreads,
+				     outHeight_ * (i + 1) / numThreads);
+
+	convertLines(src, bits, dstStride, 0, outHeight_ / numThreads);
+
+	for (std::thread &thread : threads)
+		thread.join();
 }
 
-static void yuv_to_rgb(int y, int u, int v, int *r, int *g, int *b)
+void FormatConverter::convertLines(const Image *src, unsigned char *dst,
+				   unsigned int dstStride, unsigned int start,
+				   unsigned int end)
 {
-	int c = y - 16;
-	int d = u - 128;
-	int e = v - 128;
-	*r = CLIP(( 298 * c           + 409 * e + 128) >> RGBSHIFT);
-	*g = CLIP(( 298 * c - 100 * d - 208 * e + 128) >> RGBSHIFT);
-	*b = CLIP(( 298 * c + 516 * d           + 128) >> RGBSHIFT);
+	/* Temporary Y, Cb and Cr lines for the YUV formats. */
+	std::vector<unsigned char> buffer(outWidth_ * 3);
+
+	for (unsigned int line = start; line < end; line++) {
+		unsigned char *dstLine = dst + line * dstStride;
+
+		switch (formatFamily_) {
+		case RGB:
+			convertRGB(src, line, dstLine);
+			break;
+		case YUVPacked:
+			convertYUVPacked(src, line, dstLine, buffer.data());
+			break;
+		case YUVSemiPlanar:
+			convertYUVSemiPlanar(src, line, dstLine, buffer.data());
+			break;
+		case YUVPlanar:
+			convertYUVPlanar(src, line, dstLine, buffer.data());
+			break;
+		default:
+			break;
+		};
+	}
 }
 
-void FormatConverter::convertRGB(const Image *srcImage, unsigned char *dst)
+/*
+ * Convert a line of YUV pixels to XRGB8888, with BT.601 limited range
+ * coefficients in 6-bit fixed point. The intermediate values fit in 16 bits,
+ * with the sums saturating only when the result is out of the [0, 255] range
+ * anyway, which allows processing 8 pixels at a time with SIMD instructions.
+ *
+ * The luma gain (1.164 * 64 = 74.5) is computed with a high-half multiply to
+ * preserve its fractional part. The luma offset folds the 16 black level and
+ * the rounding constant.
+ */
+static constexpr int kLumaGain = 19072;
+static constexpr int kLumaOffset = 16 * 149 / 2 - (1 << (RGBSHIFT - 1));
+
+static void yuv_to_rgb_line(const unsigned char *y, const unsigned char *u,
+			    const unsigned char *v, unsigned char *dst,
+			    unsigned int width)
 {
-	const unsigned char *src = srcImage->data(0).data();
-	unsigned int x, y;
-	int r, g, b;
-
-	for (y = 0; y < height_; y++) {
-		for (x = 0; x < width_; x++) {
-			r = src[bpp_ * x + r_pos_];
-			g = src[bpp_ * x + g_pos_];
-			b = src[bpp_ * x + b_pos_];
-
-			dst[4 * x + 0] = b;
-			dst[4 * x + 1] = g;
-			dst[4 * x + 2] = r;
-			dst[4 * x + 3] = 0xff;
-		}
-
-		src += stride_;
-		dst += width_ * 4;
+	unsigned int x = 0;
+
+#if defined(__ARM_NEON)
+	const int16x8_t offsetY = vdupq_n_s16(kLumaOffset);
+	const int16x8_t offsetC = vdupq_n_s16(128);
+
+	for (; x + 8 <= width; x += 8) {
+		int16x8_t c = vreinterpretq_s16_u16(vshll_n_u8(vld1_u8(y + x), 7));
+		int16x8_t d = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u + x))), offsetC);
+		int16x8_t e = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v + x))), offsetC);
+
+		/* (2 * (y << 7) * (74.5 * 256)) >> 16 = y * 74.5 */
+		int16x8_t luma = vsubq_s16(vqdmulhq_n_s16(c, kLumaGain), offsetY);
+		int16x8_t r = vqaddq_s16(luma, vmulq_n_s16(e, 102));
+		int16x8_t g = vqaddq_s16(luma, vmlaq_n_s16(vmulq_n_s16(d, -25), e, -52));
+		int16x8_t b = vqaddq_s16(luma, vmulq_n_s16(d, 129));
+
+		uint8x8x4_t bgra;
+		bgra.val[0] = vqshrun_n_s16(b, RGBSHIFT);
+		bgra.val[1] = vqshrun_n_s16(g, RGBSHIFT);
+		bgra.val[2] = vqshrun_n_s16(r, RGBSHIFT);
+		bgra.val[3] = vdup_n_u8(0xff);
+		vst4_u8(dst + x * 4, bgra);
+	}
+#elif defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xff));
+	const __m128i offsetY = _mm_set1_epi16(kLumaOffset);
+	const __m128i offsetC = _mm_set1_epi16(128);
+
+	for (; x + 8 <= width; x += 8) {
+		__m128i c = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(y + x));
+		__m128i d = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + x));
+		__m128i e = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + x));
+
+		c = _mm_unpacklo_epi8(zero, c);
+		d = _mm_sub_epi16(_mm_unpacklo_epi8(d, zero), offsetC);
+		e = _mm_sub_epi16(_mm_unpacklo_epi8(e, zero), offsetC);
+
+		/* ((y << 8) * (74.5 * 256)) >> 16 = y * 74.5 */
+		__m128i luma = _mm_sub_epi16(_mm_mulhi_epu16(c, _mm_set1_epi16(kLumaGain)),
+					     offsetY);
+		__m128i r = _mm_adds_epi16(luma, _mm_mullo_epi16(e, _mm_set1_epi16(102)));
+		__m128i g = _mm_adds_epi16(luma, _mm_add_epi16(_mm_mullo_epi16(d, _mm_set1_epi16(-25)),
+							       _mm_mullo_epi16(e, _mm_set1_epi16(-52))));
+		__m128i b = _mm_adds_epi16(luma, _mm_mullo_epi16(d, _mm_set1_epi16(129)));
+
+		r = _mm_packus_epi16(_mm_srai_epi16(r, RGBSHIFT), zero);
+		g = _mm_packus_epi16(_mm_srai_epi16(g, RGBSHIFT), zero);
+		b = _mm_packus_epi16(_mm_srai_epi16(b, RGBSHIFT), zero);
+
+		__m128i bg = _mm_unpacklo_epi8(b, g);
+		__m128i ra = _mm_unpacklo_epi8(r, alpha);
+
+		__m128i *out = reinterpret_cast<__m128i *>(dst + x * 4);
+		_mm_storeu_si128(out, _mm_unpacklo_epi16(bg, ra));
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(bg, ra));
+	}
+#endif
+
+	for (; x < width; x++) {
+		int d = u[x] - 128;
+		int e = v[x] - 128;
+		int luma = ((y[x] * 149) >> 1) - kLumaOffset;
+
+		dst[4 * x + 0] = CLIP((luma + 129 * d) >> RGBSHIFT);
+		dst[4 * x + 1] = CLIP((luma - 25 * d - 52 * e) >> RGBSHIFT);
+		dst[4 * x + 2] = CLIP((luma + 102 * e) >> RGBSHIFT);
+		dst[4 * x + 3] = 0xff;
 	}
 }
 
-void FormatConverter::convertYUVPacked(const Image *srcImage, unsigned char *dst)
+void FormatConverter::convertRGB(const Image *srcImage, unsigned int line,
+				 unsigned char *dst)
 {
-	const unsigned char *src = srcImage->data(0).data();
-	unsigned int src_x, src_y, dst_x, dst_y;
-	unsigned int src_stride;
-	unsigned int dst_stride;
-	unsigned int cr_pos;
-	int r, g, b, y, cr, cb;
-
-	cr_pos = (cb_pos_ + 2) % 4;
-	src_stride = stride_;
-	dst_stride = width_ * 4;
-
-	for (src_y = 0, dst_y = 0; dst_y < height_; src_y++, dst_y++) {
-		for (src_x = 0, dst_x = 0; dst_x < width_; ) {
-			cb = src[src_y * src_stride + src_x * 4 + cb_pos_];
-			cr = src[src_y * src_stride + src_x * 4 + cr_pos];
-
-			y = src[src_y * src_stride + src_x * 4 + y_pos_];
-			yuv_to_rgb(y, cb, cr, &r, &g, &b);
-			dst[dst_y * dst_stride + 4 * dst_x + 0] = b;
-			dst[dst_y * dst_stride + 4 * dst_x + 1] = g;
-			dst[dst_y * dst_stride + 4 * dst_x + 2] = r;
-			dst[dst_y * dst_stride + 4 * dst_x + 3] = 0xff;
-			dst_x++;
-
-			y = src[src_y * src_stride + src_x * 4 + y_pos_ + 2];
-			yuv_to_rgb(y, cb, cr, &r, &g, &b);
-			dst[dst_y * dst_stride + 4 * dst_x + 0] = b;
-			dst[dst_y * dst_stride + 4 * dst_x + 1] = g;
-			dst[dst_y * dst_stride + 4 * dst_x + 2] = r;
-			dst[dst_y * dst_stride + 4 * dst_x + 3] = 0xff;
-			dst_x++;
-
-			src_x++;
-		}
+	const unsigned char *src = srcImage->data(0).data()
+				 + line * scale_ * stride_;
+	unsigned int step = bpp_ * scale_;
+
+	for (unsigned int x = 0; x < outWidth_; x++) {
+		dst[4 * x + 0] = src[b_pos_];
+		dst[4 * x + 1] = src[g_pos_];
+		dst[4 * x + 2] = src[r_pos_];
+		dst[4 * x + 3] = 0xff;
+		src += step;
 	}
 }
 
-void FormatConverter::convertYUVPlanar(const Image *srcImage, unsigned char *dst)
+void FormatConverter::convertYUVPacked(const Image *srcImage, unsigned int line,
+				       unsigned char *dst, unsigned char *buffer)
+{
+	const unsigned char *src = srcImage->data(0).data()
+				 + line * scale_ * stride_;
+	unsigned int cr_pos = (cb_pos_ + 2) % 4;
+	unsigned char *line_y = buffer;
+	unsigned char *line_cb = buffer + outWidth_;
+	unsigned char *line_cr = buffer + outWidth_ * 2;
+
+	for (unsigned int x = 0; x < outWidth_; x++) {
+		unsigned int src_x = x * scale_;
+		const unsigned char *pair = src + (src_x / 2) * 4;
+
+		line_y[x] = pair[y_pos_ + (src_x % 2) * 2];
+		line_cb[x] = pair[cb_pos_];
+		line_cr[x] = pair[cr_pos];
+	}
+
+	yuv_to_rgb_line(line_y, line_cb, line_cr, dst, outWidth_);
+}
+
+void FormatConverter::convertYUVPlanar(const Image *srcImage, unsigned int line,
+				       unsigned char *dst, unsigned char *buffer)
 {
 	unsigned int c_stride = stride_ / horzSubSample_;
-	unsigned int c_inc = horzSubSample_ == 1 ? 1 : 0;
-	const unsigned char *src_y = srcImage->data(0).data();
-	const unsigned char *src_cb = srcImage->data(1).data();
-	const unsigned char *src_cr = srcImage->data(2).data();
-	int r, g, b;
+	unsigned int src_line = line * scale_;
+	const unsigned char *src_y = srcImage->data(0).data() + src_line * stride_;
+	const unsigned char *src_cb = srcImage->data(1).data()
+				    + (src_line / vertSubSample_) * c_stride;
+	const unsigned char *src_cr = srcImage->data(2).data()
+				    + (src_line / vertSubSample_) * c_stride;
+	unsigned char *line_cb = buffer + outWidth_;
+	unsigned char *line_cr = buffer + outWidth_ * 2;
 
 	if (nvSwap_)
 		std::swap(src_cb, src_cr);
 
-	for (unsigned int y = 0; y < height_; y++) {
-		const unsigned char *line_y = src_y + y * stride_;
-		const unsigned char *line_cb = src_cb + (y / vertSubSample_) *
-					       c_stride;
-		const unsigned char *line_cr = src_cr + (y / vertSubSample_) *
-					       c_stride;
-
-		for (unsigned int x = 0; x < width_; x += 2) {
-			yuv_to_rgb(*line_y, *line_cb, *line_cr, &r, &g, &b);
-			dst[0] = b;
-			dst[1] = g;
-			dst[2] = r;
-			dst[3] = 0xff;
-			line_y++;
-			line_cb += c_inc;
-			line_cr += c_inc;
-			dst += 4;
-
-			yuv_to_rgb(*line_y, *line_cb, *line_cr, &r, &g, &b);
-			dst[0] = b;
-			dst[1] = g;
-			dst[2] = r;
-			dst[3] = 0xff;
-			line_y++;
-			line_cb += 1;
-			line_cr += 1;
-			dst += 4;
-		}
+	/* Without downscaling, the luma line is used in place. */
+	const unsigned char *line_y = scale_ == 1 ? src_y : buffer;
+
+	for (unsigned int x = 0; x < outWidth_; x++) {
+		unsigned int src_x = x * scale_;
+
+		if (scale_ != 1)
+			buffer[x] = src_y[src_x];
+		line_cb[x] = src_cb[src_x / horzSubSample_];
+		line_cr[x] = src_cr[src_x / horzSubSample_];
 	}
+
+	yuv_to_rgb_line(line_y, line_cb, line_cr, dst, outWidth_);
 }
 
-void FormatConverter::convertYUVSemiPlanar(const Image *srcImage, unsigned char *dst)
+void FormatConverter::convertYUVSemiPlanar(const Image *srcImage, unsigned int line,
+					   unsigned char *dst, unsigned char *buffer)
 {
 	unsigned int c_stride = stride_ * (2 / horzSubSample_);
-	unsigned int c_inc = horzSubSample_ == 1 ? 2 : 0;
 	unsigned int cb_pos = nvSwap_ ? 1 : 0;
 	unsigned int cr_pos = nvSwap_ ? 0 : 1;
-	const unsigned char *src = srcImage->data(0).data();
-	const unsigned char *src_c = srcImage->data(1).data();
-	int r, g, b;
-
-	for (unsigned int y = 0; y < height_; y++) {
-		const unsigned char *src_y = src + y * stride_;
-		const unsigned char *src_cb = src_c + (y / vertSubSample_) *
-					      c_stride + cb_pos;
-		const unsigned char *src_cr = src_c + (y / vertSubSample_) *
-					      c_stride + cr_pos;
-
-		for (unsigned int x = 0; x < width_; x += 2) {
-			yuv_to_rgb(*src_y, *src_cb, *src_cr, &r, &g, &b);
-			dst[0] = b;
-			dst[1] = g;
-			dst[2] = r;
-			dst[3] = 0xff;
-			src_y++;
-			src_cb += c_inc;
-			src_cr += c_inc;
-			dst += 4;
-
-			yuv_to_rgb(*src_y, *src_cb, *src_cr, &r, &g, &b);
-			dst[0] = b;
-			dst[1] = g;
-			dst[2] = r;
-			dst[3] = 0xff;
-			src_y++;
-			src_cb += 2;
-			src_cr += 2;
-			dst += 4;
-		}
+	unsigned int src_line = line * scale_;
+	const unsigned char *src_y = srcImage->data(0).data() + src_line * stride_;
+	const unsigned char *src_c = srcImage->data(1).data()
+				   + (src_line / vertSubSample_) * c_stride;
+	unsigned char *line_cb = buffer + outWidth_;
+	unsigned char *line_cr = buffer + outWidth_ * 2;
+
+	/* Without downscaling, the luma line is used in place. */
+	const unsigned char *line_y = scale_ == 1 ? src_y : buffer;
+
+	for (unsigned int x = 0; x < outWidth_; x++) {
+		unsigned int src_x = x * scale_;
+		const unsigned char *c = src_c + (src_x / horzSubSample_) * 2;
+
+		if (scale_ != 1)
+			buffer[x] = src_y[src_x];
+		line_cb[x] = c[cb_pos];
+		line_cr[x] = c[cr_pos];
 	}
+
+	yuv_to_rgb_line(line_y, line_cb, line_cr, dst, outWidth_);
 }
@@ -19,9 +19,12 @@ class QImage;
 class FormatConverter
 {
 public:
+	FormatConverter();
+
 	int configure(const libcamera::PixelFormat &format, const QSize &size,
-		      unsigned int stride);
+		      unsigned int stride, unsigned int scale = 1);
 
+	QSize outputSize() const;
 	void convert(const Image *src, size_t size, QImage *dst);
 
 private:
@@ -33,16 +36,31 @@ private:
 		YUVSemiPlanar,
 	};
 
-	void convertRGB(const Image *src, unsigned char *dst);
-	void convertYUVPacked(const Image *src, unsigned char *dst);
-	void convertYUVPlanar(const Image *src, unsigned char *dst);
-	void convertYUVSemiPlanar(const Image *src, unsigned char *dst);
+	void convertLines(const Image *src, unsigned char *dst,
+			  unsigned int dstStride, unsigned int start,
+			  unsigned int end);
+
+	void convertRGB(const Image *src, unsigned int line,
+			unsigned char *dst);
+	void convertYUVPacked(const Image *src, unsigned int line,
+			      unsigned char *dst, unsigned char *buffer);
+	void convertYUVPlanar(const Image *src, unsigned int line,
+			      unsigned char *dst, unsigned char *buffer);
+	void convertYUVSemiPlanar(const Image *src, unsigned int line,
+				  unsigned char *dst, unsigned char *buffer);
 
 	libcamera::PixelFormat format_;
 	unsigned int width_;
 	unsigned int height_;
 	unsigned int stride_;
 
+	/* Downscaling factor and output size */
+	unsigned int scale_;
+	unsigned int outWidth_;
+	unsigned int outHeight_;
+
+	unsigned int numThreads_;
+
 	enum FormatFamily formatFamily_;
 
 	/* NV parameters */
@@ -35,6 +35,9 @@ OptionsParser::Options parseOptions(int argc, char *argv[])
 	parser.addOption(OptCamera, OptionString,
 			 "Specify which camera to operate on", "camera",
 			 ArgumentRequired, "camera");
+	parser.addOption(OptDownscale, OptionNone,
+			 "Downscale frames to the viewfinder size when converting them (qt renderer only)",
+			 "downscale");
 	parser.addOption(OptHelp, OptionNone, "Display this help message",
 			 "help");
 	parser.addOption(OptRenderer, OptionString,
@@ -118,6 +118,7 @@ MainWindow::MainWindow(CameraManager *cm, const OptionsParser::Options &options)
 
 	if (renderType == "qt") {
 		ViewFinderQt *viewfinder = new ViewFinderQt(this);
+		viewfinder->setDownscale(options_.isSet(OptDownscale));
 		connect(viewfinder, &ViewFinderQt::renderComplete,
 			this, &MainWindow::renderComplete);
 		viewfinder_ = viewfinder;
@@ -39,6 +39,7 @@ class HotplugEvent;
 
 enum {
 	OptCamera = 'c',
+	OptDownscale = 'd',
 	OptHelp = 'h',
 	OptRenderer = 'r',
 	OptStream = 's',
@@ -8,16 +8,31 @@
 #include "viewfinder_gl.h"
 
 #include <array>
+#include <map>
+#include <string.h>
+#include <vector>
 
 #include <QByteArray>
 #include <QFile>
 #include <QImage>
+#include <QOpenGLContext>
 #include <QStringList>
 
 #include <libcamera/formats.h>
 
+#ifdef HAVE_EGL
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
 #include "../common/image.h"
 
+#ifndef GL_TEXTURE_EXTERNAL_OES
+#define GL_TEXTURE_EXTERNAL_OES 0x8D65
+#endif
+
 static const QList<libcamera::PixelFormat> supportedFormats{
 	/* YUV - packed (single plane) */
 	libcamera::formats::UYVY,
@@ -58,15 +73,78 @@ static const QList<libcamera::PixelFormat> supportedFormats{
 	libcamera::formats::SRGGB12_CSI2P,
 };
 
+/*
+ * When the GL context is backed by EGL and supports the
+ * EGL_EXT_image_dma_buf_import and GL_OES_EGL_image_external extensions, frame
+ * buffers are imported as EGL images and sampled through an external texture,
+ * which avoids copying every frame to the GPU with glTexImage2D(). The format
+ * conversion to RGB is then performed by the GPU sampler, guided by the color
+ * space hints, and a single generic fragment shader is used.
+ *
+ * Each frame buffer is imported the first time it is rendered, and the EGL
+ * image is cached until the viewfinder is stopped or the format changes. Raw
+ * Bayer formats, and formats the EGL implementation fails to import, fall back
+ * to texture uploads and the format-specific shaders.
+ */
+struct ViewFinderGL::EglImport {
+#ifdef HAVE_EGL
+	EGLDisplay display;
+	PFNEGLCREATEIMAGEKHRPROC createImage;
+	PFNEGLDESTROYIMAGEKHRPROC destroyImage;
+	void (*imageTargetTexture2D)(GLenum target, void *image);
+
+	GLuint texture;
+	std::map<libcamera::FrameBuffer *, EGLImageKHR> images;
+#endif
+};
+
+#ifdef HAVE_EGL
+namespace {
+
+bool isRawBayer(const libcamera::PixelFormat &format)
+{
+	switch (format) {
+	case libcamera::formats::SBGGR8:
+	case libcamera::formats::SGBRG8:
+	case libcamera::formats::SGRBG8:
+	case libcamera::formats::SRGGB8:
+	case libcamera::formats::SBGGR10_CSI2P:
+	case libcamera::formats::SGBRG10_CSI2P:
+	case libcamera::formats::SGRBG10_CSI2P:
+	case libcamera::formats::SRGGB10_CSI2P:
+	case libcamera::formats::SBGGR12_CSI2P:
+	case libcamera::formats::SGBRG12_CSI2P:
+	case libcamera::formats::SGRBG12_CSI2P:
+	case libcamera::formats::SRGGB12_CSI2P:
+		return true;
+	default:
+		return false;
+	}
+}
+
+} /* namespace */
+#endif
+
 ViewFinderGL::ViewFinderGL(QWidget *parent)
 	: QOpenGLWidget(parent), buffer_(nullptr),
 	  colorSpace_(libcamera::ColorSpace::Raw), image_(nullptr),
-	  vertexBuffer_(QOpenGLBuffer::VertexBuffer)
+	  vertexBuffer_(QOpenGLBuffer::VertexBuffer),
+	  importState_(ImportUntested)
 {
 }
 
 ViewFinderGL::~ViewFinderGL()
 {
+	clearImportedBuffers();
+
+#ifdef HAVE_EGL
+	if (egl_) {
+		makeCurrent();
+		glDeleteTextures(1, &egl_->texture);
+		doneCurrent();
+	}
+#endif
+
 	removeShader();
 }
 
@@ -102,6 +180,10 @@ int ViewFinderGL::setFormat(const libcamera::PixelFormat &format, const QSize &s
 	size_ = size;
 	stride_ = stride;
 
+	/* Select the render mode again with the first frame. */
+	clearImportedBuffers();
+	importState_ = ImportUntested;
+
 	updateGeometry();
 	return 0;
 }
@@ -113,6 +195,9 @@ void ViewFinderGL::stop()
 		buffer_ = nullptr;
 		image_ = nullptr;
 	}
+
+	/* The buffers are freed when stopping, release their EGL images. */
+	clearImportedBuffers();
 }
 
 QImage ViewFinderGL::getCurrentImage()
@@ -420,9 +505,12 @@ bool ViewFinderGL::createFragmentShader()
 	 */
 	fragmentShader_ = std::make_unique<QOpenGLShader>(QOpenGLShader::Fragment, this);
 
-	QFile file(fragmentShaderFile_);
+	QString fragmentShaderFile = importState_ == ImportEnabled
+				   ? ":external.frag" : fragmentShaderFile_;
+
+	QFile file(fragmentShaderFile);
 	if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-		qWarning() << "Shader" << fragmentShaderFile_ << "not found";
+		qWarning() << "Shader" << fragmentShaderFile << "not found";
 		return false;
 	}
 
@@ -511,6 +599,8 @@ void ViewFinderGL::initializeGL()
 	glEnable(GL_TEXTURE_2D);
 	glDisable(GL_DEPTH_TEST);
 
+	initializeImport();
+
 	static const GLfloat coordinates[2][4][2]{
 		{
 			/* Vertex coordinates */
@@ -539,8 +629,185 @@ void ViewFinderGL::initializeGL()
 	glClearColor(1.0f, 1.0f, 1.0f, 0.0f);
 }
 
+void ViewFinderGL::initializeImport()
+{
+#ifdef HAVE_EGL
+	/* The context may use GLX instead of EGL. */
+	EGLDisplay display = eglGetCurrentDisplay();
+	if (display == EGL_NO_DISPLAY)
+		return;
+
+	const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+	if (!extensions || !strstr(extensions, "EGL_EXT_image_dma_buf_import") ||
+	    !context()->hasExtension("GL_OES_EGL_image_external"))
+		return;
+
+	auto egl = std::make_unique<EglImport>();
+	egl->display = display;
+	egl->createImage = reinterpret_cast<PFNEGLCREATEIMAGEKHRPROC>(
+		eglGetProcAddress("eglCreateImageKHR"));
+	egl->destroyImage = reinterpret_cast<PFNEGLDESTROYIMAGEKHRPROC>(
+		eglGetProcAddress("eglDestroyImageKHR"));
+	egl->imageTargetTexture2D = reinterpret_cast<void (*)(GLenum, void *)>(
+		eglGetProcAddress("glEGLImageTargetTexture2DOES"));
+
+	if (!egl->createImage || !egl->destroyImage || !egl->imageTargetTexture2D)
+		return;
+
+	glGenTextures(1, &egl->texture);
+
+	egl_ = std::move(egl);
+#endif
+}
+
+bool ViewFinderGL::importBuffer([[maybe_unused]] libcamera::FrameBuffer *buffer)
+{
+#ifdef HAVE_EGL
+	if (!egl_ || isRawBayer(format_))
+		return false;
+
+	if (egl_->images.count(buffer))
+		return true;
+
+	const std::vector<libcamera::FrameBuffer::Plane> &planes = buffer->planes();
+	if (planes.empty() || planes.size() > 3)
+		return false;
+
+	static const std::array<std::array<EGLint, 3>, 3> planeAttribs{ {
+		{ EGL_DMA_BUF_PLANE0_FD_EXT, EGL_DMA_BUF_PLANE0_OFFSET_EXT,
+		  EGL_DMA_BUF_PLANE0_PITCH_EXT },
+		{ EGL_DMA_BUF_PLANE1_FD_EXT, EGL_DMA_BUF_PLANE1_OFFSET_EXT,
+		  EGL_DMA_BUF_PLANE1_PITCH_EXT },
+		{ EGL_DMA_BUF_PLANE2_FD_EXT, EGL_DMA_BUF_PLANE2_OFFSET_EXT,
+		  EGL_DMA_BUF_PLANE2_PITCH_EXT },
+	} };
+
+	std::vector<EGLint> attribs = {
+		EGL_WIDTH, size_.width(),
+		EGL_HEIGHT, size_.height(),
+		EGL_LINUX_DRM_FOURCC_EXT, static_cast<EGLint>(format_.fourcc()),
+	};
+
+	for (unsigned int i = 0; i < planes.size(); ++i) {
+		/*
+		 * The chroma planes of semi-planar formats interleave the two
+		 * chroma components.
+		 */
+		unsigned int pitch = stride_;
+		if (i > 0)
+			pitch = planes.size() == 2 ? stride_ * 2 / horzSubSample_
+						   : stride_ / horzSubSample_;
+
+		attribs.insert(attribs.end(), {
+			planeAttribs[i][0], planes[i].fd.get(),
+			planeAttribs[i][1], static_cast<EGLint>(planes[i].offset),
+			planeAttribs[i][2], static_cast<EGLint>(pitch),
+		});
+	}
+
+	if (colorSpace_.ycbcrEncoding != libcamera::ColorSpace::YcbcrEncoding::None) {
+		EGLint encoding;
+
+		switch (colorSpace_.ycbcrEncoding) {
+		case libcamera::ColorSpace::YcbcrEncoding::Rec601:
+		default:
+			encoding = EGL_ITU_REC601_EXT;
+			break;
+		case libcamera::ColorSpace::YcbcrEncoding::Rec709:
+			encoding = EGL_ITU_REC709_EXT;
+			break;
+		case libcamera::ColorSpace::YcbcrEncoding::Rec2020:
+			encoding = EGL_ITU_REC2020_EXT;
+			break;
+		}
+
+		EGLint range = colorSpace_.range == libcamera::ColorSpace::Range::Full
+			     ? EGL_YUV_FULL_RANGE_EXT : EGL_YUV_NARROW_RANGE_EXT;
+
+		attribs.insert(attribs.end(), {
+			EGL_YUV_COLOR_SPACE_HINT_EXT, encoding,
+			EGL_SAMPLE_RANGE_HINT_EXT, range,
+		});
+	}
+
+	attribs.push_back(EGL_NONE);
+
+	EGLImageKHR image = egl_->createImage(egl_->display, EGL_NO_CONTEXT,
+					      EGL_LINUX_DMA_BUF_EXT, nullptr,
+					      attribs.data());
+	if (image == EGL_NO_IMAGE_KHR)
+		return false;
+
+	egl_->images[buffer] = image;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void ViewFinderGL::updateImport()
+{
+	if (importState_ == ImportDisabled)
+		return;
+
+	ImportState state = importBuffer(buffer_) ? ImportEnabled : ImportDisabled;
+	if (state == importState_)
+		return;
+
+	bool modeChanged = state == ImportEnabled || importState_ == ImportEnabled;
+
+	if (importState_ == ImportEnabled)
+		qWarning() << "[ViewFinderGL]:"
+			   << "dmabuf import failed, falling back to uploads";
+
+	importState_ = state;
+
+	/* The fragment shader depends on the render mode, recreate it. */
+	if (modeChanged && fragmentShader_) {
+		shaderProgram_.release();
+		shaderProgram_.removeShader(fragmentShader_.get());
+		fragmentShader_.reset();
+	}
+}
+
+void ViewFinderGL::renderImported()
+{
+#ifdef HAVE_EGL
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_EXTERNAL_OES, egl_->texture);
+	glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	egl_->imageTargetTexture2D(GL_TEXTURE_EXTERNAL_OES,
+				   egl_->images.at(buffer_));
+	shaderProgram_.setUniformValue(textureUniformY_, 0);
+
+	/* The EGL image covers the active portion of the frame only. */
+	shaderProgram_.setUniformValue(textureUniformStrideFactor_, 1.0f);
+#endif
+}
+
+void ViewFinderGL::clearImportedBuffers()
+{
+#ifdef HAVE_EGL
+	if (!egl_)
+		return;
+
+	for (const auto &[buffer, image] : egl_->images)
+		egl_->destroyImage(egl_->display, image);
+
+	egl_->images.clear();
+#endif
+}
+
 void ViewFinderGL::doRender()
 {
+	if (importState_ == ImportEnabled) {
+		renderImported();
+		return;
+	}
+
 	/* Stride of the first plane, in pixels. */
 	unsigned int stridePixels;
 
@@ -809,6 +1076,9 @@ void ViewFinderGL::doRender()
 
 void ViewFinderGL::paintGL()
 {
+	if (image_)
+		updateImport();
+
 	if (!fragmentShader_)
 		if (!createFragmentShader()) {
 			qWarning() << "[ViewFinderGL]:"
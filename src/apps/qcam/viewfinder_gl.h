@@ -56,6 +56,14 @@ protected:
 	QSize sizeHint() const override;
 
 private:
+	enum ImportState {
+		ImportUntested,
+		ImportEnabled,
+		ImportDisabled,
+	};
+
+	struct EglImport;
+
 	bool selectFormat(const libcamera::PixelFormat &format);
 	void selectColorSpace(const libcamera::ColorSpace &colorSpace);
 
@@ -65,6 +73,12 @@ private:
 	void removeShader();
 	void doRender();
 
+	void initializeImport();
+	bool importBuffer(libcamera::FrameBuffer *buffer);
+	void updateImport();
+	void renderImported();
+	void clearImportedBuffers();
+
 	/* Captured image size, format and buffer */
 	libcamera::FrameBuffer *buffer_;
 	libcamera::PixelFormat format_;
@@ -104,5 +118,9 @@ private:
 	GLuint textureUniformBayerFirstRed_;
 	QPointF firstRed_;
 
+	/* Dmabuf import through EGL images, when supported */
+	std::unique_ptr<EglImport> egl_;
+	ImportState importState_;
+
 	QMutex mutex_; /* Prevent concurrent access to image_ */
 };
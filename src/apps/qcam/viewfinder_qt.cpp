@@ -7,6 +7,7 @@
 
 #include "viewfinder_qt.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <stdint.h>
 #include <utility>
@@ -40,7 +41,8 @@ static const QMap<libcamera::PixelFormat, QImage::Format> nativeFormats
 };
 
 ViewFinderQt::ViewFinderQt(QWidget *parent)
-	: QWidget(parent), buffer_(nullptr)
+	: QWidget(parent), stride_(0), downscale_(false), scale_(1),
+	  buffer_(nullptr)
 {
 	icon_ = QIcon(":camera-off.svg");
 }
@@ -80,6 +82,8 @@ int ViewFinderQt::setFormat(const libcamera::PixelFormat &format, const QSize &s
 
 	format_ = format;
 	size_ = size;
+	stride_ = stride;
+	scale_ = 1;
 
 	updateGeometry();
 	return 0;
@@ -113,6 +117,9 @@ void ViewFinderQt::render(libcamera::FrameBuffer *buffer, Image *image)
 			 * Otherwise, convert the format and release the frame
 			 * buffer immediately.
 			 */
+			if (downscale_)
+				updateScale();
+
 			converter_.convert(image, size, &image_);
 		}
 	}
@@ -135,6 +142,30 @@ void ViewFinderQt::stop()
 	update();
 }
 
+/*
+ * Pick the largest integer downscaling factor that keeps the converted image
+ * at least as large as the widget, and reconfigure the converter when it
+ * changes. The image is then scaled up by the paint event if needed, at a
+ * much lower cost than converting pixels that would not be displayed.
+ */
+void ViewFinderQt::updateScale()
+{
+	unsigned int scale = 1;
+
+	if (width() > 0 && height() > 0)
+		scale = std::max(std::min(size_.width() / width(),
+					  size_.height() / height()), 1);
+
+	if (scale == scale_)
+		return;
+
+	if (converter_.configure(format_, size_, stride_, scale) < 0)
+		return;
+
+	scale_ = scale;
+	image_ = QImage(converter_.outputSize(), QImage::Format_RGB32);
+}
+
 QImage ViewFinderQt::getCurrentImage()
 {
 	QMutexLocker locker(&mutex_);
@@ -39,6 +39,8 @@ public:
 
 	QImage getCurrentImage() override;
 
+	void setDownscale(bool enable) { downscale_ = enable; }
+
 Q_SIGNALS:
 	void renderComplete(libcamera::FrameBuffer *buffer);
 
@@ -47,10 +49,17 @@ protected:
 	QSize sizeHint() const override;
 
 private:
+	void updateScale();
+
 	FormatConverter converter_;
 
 	libcamera::PixelFormat format_;
 	QSize size_;
+	unsigned int stride_;
+
+	/* Downscaling to the widget size during format conversion */
+	bool downscale_;
+	unsigned int scale_;
 
 	/* Camera stopped icon */
 	QSize vfSize_;
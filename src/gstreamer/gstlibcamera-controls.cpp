@@ -0,0 +1,358 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * gstlibcamera-controls.cpp - GStreamer Camera Controls
+ */
+
+#include "gstlibcamera-controls.h"
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <libcamera/base/span.h>
+
+#include <libcamera/control_ids.h>
+
+using namespace libcamera;
+
+namespace {
+
+template<typename T>
+struct GValueTraits;
+
+template<>
+struct GValueTraits<bool> {
+	static GType type() { return G_TYPE_BOOLEAN; }
+	static bool get(const GValue *value) { return g_value_get_boolean(value); }
+	static void set(GValue *value, bool v) { g_value_set_boolean(value, v); }
+};
+
+template<>
+struct GValueTraits<int32_t> {
+	static GType type() { return G_TYPE_INT; }
+	static int32_t get(const GValue *value) { return g_value_get_int(value); }
+	static void set(GValue *value, int32_t v) { g_value_set_int(value, v); }
+};
+
+template<>
+struct GValueTraits<int64_t> {
+	static GType type() { return G_TYPE_INT64; }
+	static int64_t get(const GValue *value) { return g_value_get_int64(value); }
+	static void set(GValue *value, int64_t v) { g_value_set_int64(value, v); }
+};
+
+template<>
+struct GValueTraits<float> {
+	static GType type() { return G_TYPE_FLOAT; }
+	static float get(const GValue *value) { return g_value_get_float(value); }
+	static void set(GValue *value, float v) { g_value_set_float(value, v); }
+};
+
+template<typename T>
+bool controlFromGValue(const ControlId *id, const GValue *value,
+		       ControlValue *control)
+{
+	using Traits = GValueTraits<T>;
+
+	if (!id->isArray()) {
+		if (!G_VALUE_HOLDS(value, Traits::type()))
+			return false;
+
+		control->set<T>(Traits::get(value));
+		return true;
+	}
+
+	/* std::vector<bool> can't be stored in a ControlValue. */
+	if constexpr (std::is_same_v<T, bool>) {
+		return false;
+	} else {
+		if (!GST_VALUE_HOLDS_ARRAY(value))
+			return false;
+
+		guint size = gst_value_array_get_size(value);
+		if (id->size() != dynamic_extent && size != id->size())
+			return false;
+
+		std::vector<T> values(size);
+		for (guint i = 0; i < size; i++) {
+			const GValue *element = gst_value_array_get_value(value, i);
+			if (!G_VALUE_HOLDS(element, Traits::type()))
+				return false;
+
+			values[i] = Traits::get(element);
+		}
+
+		control->set(Span<const T>(values));
+		return true;
+	}
+}
+
+template<typename T>
+void controlToGValue(const ControlValue &control, GValue *value)
+{
+	using Traits = GValueTraits<T>;
+
+	if (!control.isArray()) {
+		g_value_init(value, Traits::type());
+		Traits::set(value, control.get<T>());
+		return;
+	}
+
+	g_value_init(value, GST_TYPE_ARRAY);
+
+	for (const T &v : control.get<Span<const T>>()) {
+		GValue element = G_VALUE_INIT;
+
+		g_value_init(&element, Traits::type());
+		Traits::set(&element, v);
+		gst_value_array_append_and_take_value(value, &element);
+	}
+}
+
+bool gvalueToControl(const ControlId *id, const GValue *value,
+		     ControlValue *control)
+{
+	switch (id->type()) {
+	case ControlTypeBool:
+		return controlFromGValue<bool>(id, value, control);
+	case ControlTypeInteger32:
+		return controlFromGValue<int32_t>(id, value, control);
+	case ControlTypeInteger64:
+		return controlFromGValue<int64_t>(id, value, control);
+	case ControlTypeFloat:
+		return controlFromGValue<float>(id, value, control);
+	default:
+		return false;
+	}
+}
+
+/* Initialize and set the uninitialized GValue to the control value. */
+bool controlToGValue(const ControlValue &control, GValue *value)
+{
+	switch (control.type()) {
+	case ControlTypeBool:
+		controlToGValue<bool>(control, value);
+		return true;
+	case ControlTypeInteger32:
+		controlToGValue<int32_t>(control, value);
+		return true;
+	case ControlTypeInteger64:
+		controlToGValue<int64_t>(control, value);
+		return true;
+	case ControlTypeFloat:
+		controlToGValue<float>(control, value);
+		return true;
+	case ControlTypeString:
+		g_value_init(value, G_TYPE_STRING);
+		g_value_set_string(value, control.get<std::string>().c_str());
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Convert a CamelCase control name to a kebab-case property name. */
+std::string propertyName(const std::string &name)
+{
+	std::string property;
+
+	for (char c : name) {
+		if (g_ascii_isupper(c)) {
+			if (!property.empty() && property.back() != '-')
+				property += '-';
+			property += g_ascii_tolower(c);
+		} else if (g_ascii_isalnum(c)) {
+			property += c;
+		} else if (!property.empty() && property.back() != '-') {
+			property += '-';
+		}
+	}
+
+	return property;
+}
+
+GParamSpec *paramSpec(const ControlId *id, const std::string &name,
+		      GParamFlags flags)
+{
+	const gchar *nick = id->name().c_str();
+
+	switch (id->type()) {
+	case ControlTypeBool:
+		return g_param_spec_boolean(name.c_str(), nick, nick, FALSE, flags);
+	case ControlTypeInteger32:
+		return g_param_spec_int(name.c_str(), nick, nick,
+					G_MININT32, G_MAXINT32, 0, flags);
+	case ControlTypeInteger64:
+		return g_param_spec_int64(name.c_str(), nick, nick,
+					  G_MININT64, G_MAXINT64, 0, flags);
+	case ControlTypeFloat:
+		return g_param_spec_float(name.c_str(), nick, nick,
+					  -G_MAXFLOAT, G_MAXFLOAT, 0.0f, flags);
+	default:
+		return nullptr;
+	}
+}
+
+} /* namespace */
+
+/**
+ * \class GstCameraControls
+ * \brief Expose the libcamera controls as GObject properties
+ *
+ * Every boolean and numerical libcamera control is exposed as a property of
+ * the element, named after the control in kebab-case, with arrays exposed as
+ * GstValueArray. The property identifiers are offset by the control numerical
+ * ID, so that they don't depend on the iteration order of the control map.
+ *
+ * Properties can be set in any state. The values are applied to the next
+ * request queued to the camera, and controls not supported by the camera are
+ * ignored with a warning. Instances are protected by the object lock of the
+ * element.
+ */
+
+GstCameraControls::GstCameraControls()
+	: controls_(controls::controls), controlsAcc_(controls::controls)
+{
+}
+
+void GstCameraControls::installProperties(GObjectClass *klass, int lastPropId)
+{
+	for (const auto &[numericId, id] : controls::controls) {
+		std::string name = propertyName(id->name());
+		GParamFlags flags = static_cast<GParamFlags>(G_PARAM_READWRITE |
+							     GST_PARAM_MUTABLE_PLAYING);
+		GParamSpec *spec;
+
+		if (id->isArray()) {
+			/* Boolean arrays can't be stored in a ControlValue. */
+			if (id->type() == ControlTypeBool)
+				continue;
+
+			GParamSpec *element = paramSpec(id, name, G_PARAM_READWRITE);
+			if (!element)
+				continue;
+
+			spec = gst_param_spec_array(name.c_str(), id->name().c_str(),
+						    id->name().c_str(), element, flags);
+		} else {
+			spec = paramSpec(id, name, flags);
+			if (!spec)
+				continue;
+		}
+
+		g_object_class_install_property(klass, lastPropId + numericId, spec);
+	}
+}
+
+bool GstCameraControls::getProperty(guint propId, GValue *value, GParamSpec *pspec)
+{
+	auto iter = controls::controls.find(propId);
+	if (iter == controls::controls.end())
+		return false;
+
+	if (!controlsAcc_.contains(propId)) {
+		g_param_value_set_default(pspec, value);
+		return true;
+	}
+
+	GValue control = G_VALUE_INIT;
+	if (controlToGValue(controlsAcc_.get(propId), &control)) {
+		g_value_copy(&control, value);
+		g_value_unset(&control);
+	}
+
+	return true;
+}
+
+bool GstCameraControls::setProperty(guint propId, const GValue *value,
+				    [[maybe_unused]] GParamSpec *pspec)
+{
+	auto iter = controls::controls.find(propId);
+	if (iter == controls::controls.end())
+		return false;
+
+	const ControlId *id = iter->second;
+	ControlValue control;
+
+	if (!gvalueToControl(id, value, &control)) {
+		GST_WARNING("Invalid value for control %s", id->name().c_str());
+		return true;
+	}
+
+	controls_.set(propId, control);
+	controlsAcc_.set(propId, control);
+
+	return true;
+}
+
+void GstCameraControls::setCamera(const std::shared_ptr<Camera> &cam)
+{
+	capabilities_ = cam->controls();
+}
+
+void GstCameraControls::applyControls(Request *request)
+{
+	if (controls_.empty())
+		return;
+
+	ControlList &controls = request->controls();
+
+	for (const auto &[id, value] : controls_) {
+		if (!capabilities_.count(id)) {
+			GST_WARNING("Control %s is not supported by the camera",
+				    controls::controls.at(id)->name().c_str());
+			continue;
+		}
+
+		controls.set(id, value);
+	}
+
+	controls_.clear();
+}
+
+void GstCameraControls::registerMeta()
+{
+#if GST_CHECK_VERSION(1, 20, 0)
+	static gsize registered = 0;
+
+	if (g_once_init_enter(&registered)) {
+		static const gchar *tags[] = { nullptr };
+
+		gst_meta_register_custom(GST_LIBCAMERA_META_NAME, tags,
+					 nullptr, nullptr, nullptr);
+		g_once_init_leave(&registered, 1);
+	}
+#endif
+}
+
+/*
+ * Attach the request metadata to the buffer, so that downstream elements can
+ * use the values computed by the algorithms instead of estimating them.
+ * Requires GStreamer 1.20 or newer for GstCustomMeta.
+ */
+void GstCameraControls::addMeta([[maybe_unused]] GstBuffer *buffer,
+				[[maybe_unused]] const ControlList &metadata)
+{
+#if GST_CHECK_VERSION(1, 20, 0)
+	GstCustomMeta *meta = gst_buffer_add_custom_meta(buffer, GST_LIBCAMERA_META_NAME);
+	if (!meta)
+		return;
+
+	GstStructure *structure = gst_custom_meta_get_structure(meta);
+
+	for (const auto &[id, value] : metadata) {
+		auto iter = controls::controls.find(id);
+		if (iter == controls::controls.end())
+			continue;
+
+		GValue field = G_VALUE_INIT;
+		if (!controlToGValue(value, &field))
+			continue;
+
+		gst_structure_take_value(structure, iter->second->name().c_str(),
+					 &field);
+	}
+#endif
+}
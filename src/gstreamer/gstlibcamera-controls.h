@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * gstlibcamera-controls.h - GStreamer Camera Controls
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <libcamera/camera.h>
+#include <libcamera/controls.h>
+#include <libcamera/request.h>
+
+#include <gst/gst.h>
+
+/*
+ * Name of the GstCustomMeta carrying the metadata of the completed request on
+ * the buffers, as a GstStructure with one field per control named after the
+ * control.
+ */
+#define GST_LIBCAMERA_META_NAME "GstLibcameraMeta"
+
+class GstCameraControls
+{
+public:
+	GstCameraControls();
+
+	static void installProperties(GObjectClass *klass, int lastPropId);
+
+	bool getProperty(guint propId, GValue *value, GParamSpec *pspec);
+	bool setProperty(guint propId, const GValue *value, GParamSpec *pspec);
+
+	void setCamera(const std::shared_ptr<libcamera::Camera> &cam);
+	void applyControls(libcamera::Request *request);
+
+	static void registerMeta();
+	static void addMeta(GstBuffer *buffer, const libcamera::ControlList &metadata);
+
+private:
+	/* Controls to be applied to the next request. */
+	libcamera::ControlList controls_;
+	/* All controls set through properties, reported by getProperty(). */
+	libcamera::ControlList controlsAcc_;
+
+	libcamera::ControlInfoMap capabilities_;
+};
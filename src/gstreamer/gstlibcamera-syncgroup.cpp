@@ -0,0 +1,174 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * gstlibcamera-syncgroup.cpp - Synchronization of multiple libcamerasrc elements
+ */
+
+#include "gstlibcamera-syncgroup.h"
+
+#include <algorithm>
+#include <map>
+
+#include "gstlibcamera-utils.h"
+
+using namespace libcamera;
+
+/* Time to wait for the other members of a group before starting alone. */
+static constexpr gint64 kStartTimeout = 5 * G_TIME_SPAN_SECOND;
+
+/* Interval between updates of the shared clock offset. */
+static constexpr GstClockTime kOffsetRefreshInterval = GST_SECOND;
+
+G_LOCK_DEFINE_STATIC(groups_lock);
+static std::map<std::string, std::weak_ptr<GstCameraSyncGroup>> groups;
+
+/**
+ * \class GstCameraSyncGroup
+ * \brief Synchronize the cameras of multiple libcamerasrc elements
+ *
+ * Stereo and multi-sensor pipelines use one libcamerasrc element per camera.
+ * Elements whose sync-group property is set to the same name form a group,
+ * joined when the camera is acquired and left when it is released.
+ *
+ * The group synchronizes the elements in two ways. When streaming starts, the
+ * cameras are started back-to-back once all members are ready, instead of
+ * when each streaming thread happens to get there. Then, the buffer
+ * timestamps are computed from the sensor timestamps with a shared mapping
+ * between the monotonic clock and the pipeline clock, instead of a mapping
+ * sampled independently for each frame by each element. Frames captured at
+ * the same time by different cameras thus get the same PTS, up to the sensor
+ * timestamps difference.
+ *
+ * All members of a group must be in the same pipeline, to share the pipeline
+ * clock and base time.
+ */
+
+GstCameraSyncGroup::GstCameraSyncGroup(const std::string &name)
+	: name_(name), members_(0), generation_(0),
+	  clockOffset_(0), offsetUpdated_(GST_CLOCK_TIME_NONE)
+{
+	g_mutex_init(&lock_);
+	g_cond_init(&cond_);
+	g_mutex_init(&offsetLock_);
+}
+
+GstCameraSyncGroup::~GstCameraSyncGroup()
+{
+	G_LOCK(groups_lock);
+
+	/* The group may have been replaced by a new one with the same name. */
+	auto it = groups.find(name_);
+	if (it != groups.end() && it->second.expired())
+		groups.erase(it);
+
+	G_UNLOCK(groups_lock);
+
+	g_mutex_clear(&offsetLock_);
+	g_cond_clear(&cond_);
+	g_mutex_clear(&lock_);
+}
+
+/* Return the group with the given name, creating it if needed. */
+std::shared_ptr<GstCameraSyncGroup> GstCameraSyncGroup::get(const std::string &name)
+{
+	std::shared_ptr<GstCameraSyncGroup> group;
+
+	G_LOCK(groups_lock);
+
+	std::weak_ptr<GstCameraSyncGroup> &entry = groups[name];
+	group = entry.lock();
+	if (!group) {
+		group = std::shared_ptr<GstCameraSyncGroup>(new GstCameraSyncGroup(name));
+		entry = group;
+	}
+
+	G_UNLOCK(groups_lock);
+
+	return group;
+}
+
+void GstCameraSyncGroup::join()
+{
+	GLibLocker lock(&lock_);
+	members_++;
+}
+
+void GstCameraSyncGroup::leave()
+{
+	GLibLocker lock(&lock_);
+	members_--;
+
+	/* The remaining members may now all be ready. */
+	g_cond_broadcast(&cond_);
+}
+
+/* Must be called with lock_ held. */
+void GstCameraSyncGroup::startMembers()
+{
+	GST_INFO("Starting %zu cameras of sync group '%s'", ready_.size(),
+		 name_.c_str());
+
+	for (Member *member : ready_)
+		member->ret = member->camera->start(member->controls);
+
+	ready_.clear();
+	generation_++;
+	g_cond_broadcast(&cond_);
+}
+
+/*
+ * Start the camera of a member of the group. The call blocks until all members
+ * are ready to start, and the last one starts all the cameras. If the other
+ * members don't get ready in time, the camera is started alone.
+ *
+ * Returns the result of Camera::start() for the camera.
+ */
+int GstCameraSyncGroup::start(Camera *camera, const ControlList *controls)
+{
+	GLibLocker lock(&lock_);
+	Member member{ camera, controls, 0 };
+	unsigned int generation = generation_;
+	gint64 deadline = g_get_monotonic_time() + kStartTimeout;
+
+	ready_.push_back(&member);
+
+	while (generation == generation_) {
+		if (ready_.size() >= members_) {
+			startMembers();
+			break;
+		}
+
+		if (!g_cond_wait_until(&cond_, &lock_, deadline)) {
+			if (generation != generation_)
+				break;
+
+			GST_WARNING("Timeout waiting for sync group '%s', starting camera %s alone",
+				    name_.c_str(), camera->id().c_str());
+
+			ready_.erase(std::find(ready_.begin(), ready_.end(), &member));
+			return camera->start(controls);
+		}
+	}
+
+	return member.ret;
+}
+
+/*
+ * Return the offset between the monotonic clock and the pipeline clock, given
+ * the current time of both clocks. The offset is shared by all members and
+ * only refreshed periodically, so that frames with the same sensor timestamp
+ * get the same PTS on all members.
+ */
+GstClockTime GstCameraSyncGroup::clockOffset(GstClockTime sysNow, GstClockTime gstNow)
+{
+	GLibLocker lock(&offsetLock_);
+
+	if (!GST_CLOCK_TIME_IS_VALID(offsetUpdated_) ||
+	    sysNow - offsetUpdated_ >= kOffsetRefreshInterval) {
+		clockOffset_ = sysNow - gstNow;
+		offsetUpdated_ = sysNow;
+	}
+
+	return clockOffset_;
+}
@@ -0,0 +1,63 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * gstlibcamera-syncgroup.h - Synchronization of multiple libcamerasrc elements
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <libcamera/camera.h>
+#include <libcamera/controls.h>
+
+#include <gst/gst.h>
+
+class GstCameraSyncGroup
+{
+public:
+	static std::shared_ptr<GstCameraSyncGroup> get(const std::string &name);
+
+	~GstCameraSyncGroup();
+
+	const std::string &name() const { return name_; }
+
+	void join();
+	void leave();
+
+	int start(libcamera::Camera *camera, const libcamera::ControlList *controls);
+
+	GstClockTime clockOffset(GstClockTime sysNow, GstClockTime gstNow);
+
+private:
+	struct Member {
+		libcamera::Camera *camera;
+		const libcamera::ControlList *controls;
+		int ret;
+	};
+
+	GstCameraSyncGroup(const std::string &name);
+
+	void startMembers();
+
+	std::string name_;
+
+	/* Protects the members below, up to generation_. */
+	GMutex lock_;
+	GCond cond_;
+	unsigned int members_;
+	std::vector<Member *> ready_;
+	unsigned int generation_;
+
+	/*
+	 * Protects the clock offset. It is separate from lock_ as the clock
+	 * offset is used in the request completion handlers, which run in the
+	 * pipeline handler thread that starting the cameras waits for.
+	 */
+	GMutex offsetLock_;
+	GstClockTime clockOffset_;
+	GstClockTime offsetUpdated_;
+};
@@ -8,6 +8,10 @@
 
 #include "gstlibcamera-utils.h"
 
+#include <algorithm>
+#include <map>
+#include <vector>
+
 #include <libcamera/control_ids.h>
 #include <libcamera/formats.h>
 
@@ -330,13 +334,128 @@ bare_structure_from_format(const PixelFormat &format)
 	}
 }
 
+/*
+ * Set a field to the values of a sorted list, as a single value, a stepped
+ * range if the values form an arithmetic progression of more than two values,
+ * or a list otherwise.
+ */
+static void
+structure_set_int_values(GstStructure *s, const gchar *field,
+			 const std::vector<unsigned int> &values)
+{
+	GValue val = G_VALUE_INIT;
+
+	if (values.size() == 1) {
+		gst_structure_set(s, field, G_TYPE_INT, values[0], nullptr);
+		return;
+	}
+
+	unsigned int step = values[1] - values[0];
+	bool progression = values.size() > 2 && step > 0;
+	for (std::size_t i = 2; progression && i < values.size(); i++)
+		progression = values[i] - values[i - 1] == step;
+
+	if (progression) {
+		g_value_init(&val, GST_TYPE_INT_RANGE);
+		gst_value_set_int_range_step(&val, values.front(), values.back(), step);
+		gst_structure_take_value(s, field, &val);
+		return;
+	}
+
+	g_value_init(&val, GST_TYPE_LIST);
+	for (unsigned int value : values) {
+		GValue item = G_VALUE_INIT;
+
+		g_value_init(&item, G_TYPE_INT);
+		g_value_set_int(&item, value);
+		gst_value_list_append_and_take_value(&val, &item);
+	}
+
+	gst_structure_take_value(s, field, &val);
+}
+
+/*
+ * Describe the sizes supported for a pixel format as a list of structures
+ * holding the width and height fields only.
+ *
+ * When the sizes are described by a stepped range, the discrete sizes computed
+ * by StreamFormats from common resolutions are all contained in the range and
+ * are thus omitted. Otherwise, the discrete sizes sharing the same width are
+ * grouped in a single structure.
+ */
+static std::vector<GstStructure *>
+sizes_to_structures(const StreamFormats &formats, const PixelFormat &pixelformat)
+{
+	std::vector<GstStructure *> structures;
+
+	const SizeRange &range = formats.range(pixelformat);
+	if (range.hStep && range.vStep) {
+		GstStructure *s = gst_structure_new_empty("sizes");
+		GValue val = G_VALUE_INIT;
+
+		g_value_init(&val, GST_TYPE_INT_RANGE);
+		gst_value_set_int_range_step(&val, range.min.width, range.max.width, range.hStep);
+		gst_structure_set_value(s, "width", &val);
+		gst_value_set_int_range_step(&val, range.min.height, range.max.height, range.vStep);
+		gst_structure_set_value(s, "height", &val);
+		g_value_unset(&val);
+
+		structures.push_back(s);
+		return structures;
+	}
+
+	std::map<unsigned int, std::vector<unsigned int>> heights;
+	for (const Size &size : formats.sizes(pixelformat))
+		heights[size.width].push_back(size.height);
+
+	for (auto &[width, values] : heights) {
+		GstStructure *s = gst_structure_new("sizes", "width", G_TYPE_INT,
+						    width, nullptr);
+
+		std::sort(values.begin(), values.end());
+		values.erase(std::unique(values.begin(), values.end()), values.end());
+		structure_set_int_values(s, "height", values);
+
+		structures.push_back(s);
+	}
+
+	return structures;
+}
+
+static bool
+structures_equal(const std::vector<GstStructure *> &a,
+		 const std::vector<GstStructure *> &b)
+{
+	if (a.size() != b.size())
+		return false;
+
+	for (std::size_t i = 0; i < a.size(); i++) {
+		if (!gst_structure_is_equal(a[i], b[i]))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Generate compact caps for the formats of a stream. Formats of the same media
+ * type supporting the same sizes are merged in structures with a list of
+ * formats, which keeps the caps small for cameras exposing many formats and
+ * frame sizes, and speeds up negotiation.
+ */
 GstCaps *
 gst_libcamera_stream_formats_to_caps(const StreamFormats &formats)
 {
-	GstCaps *caps = gst_caps_new_empty();
+	struct FormatGroup {
+		GstStructure *bare;
+		std::vector<GstStructure *> sizes;
+		GValue format_list;
+	};
+
+	std::vector<FormatGroup> groups;
 
 	for (PixelFormat pixelformat : formats.pixelformats()) {
-		g_autoptr(GstStructure) bare_s = bare_structure_from_format(pixelformat);
+		GstStructure *bare_s = bare_structure_from_format(pixelformat);
 
 		if (!bare_s) {
 			GST_WARNING("Unsupported DRM format %" GST_FOURCC_FORMAT,
@@ -344,29 +463,58 @@ gst_libcamera_stream_formats_to_caps(const StreamFormats &formats)
 			continue;
 		}
 
-		for (const Size &size : formats.sizes(pixelformat)) {
-			GstStructure *s = gst_structure_copy(bare_s);
-			gst_structure_set(s,
-					  "width", G_TYPE_INT, size.width,
-					  "height", G_TYPE_INT, size.height,
-					  nullptr);
-			gst_caps_append_structure(caps, s);
+		std::vector<GstStructure *> sizes = sizes_to_structures(formats, pixelformat);
+		const GValue *format = gst_structure_get_value(bare_s, "format");
+
+		/* Look for formats of the same media type with the same sizes. */
+		auto group = std::find_if(groups.begin(), groups.end(),
+					  [&](const FormatGroup &g) {
+						  return format && G_IS_VALUE(&g.format_list) &&
+							 gst_structure_has_name(g.bare, gst_structure_get_name(bare_s)) &&
+							 structures_equal(g.sizes, sizes);
+					  });
+		if (group != groups.end()) {
+			gst_value_list_append_value(&group->format_list, format);
+
+			gst_structure_free(bare_s);
+			for (GstStructure *sizes_s : sizes)
+				gst_structure_free(sizes_s);
+			continue;
+		}
+
+		FormatGroup &g = groups.emplace_back();
+		g.bare = bare_s;
+		g.sizes = std::move(sizes);
+		g.format_list = G_VALUE_INIT;
+		if (format) {
+			g_value_init(&g.format_list, GST_TYPE_LIST);
+			gst_value_list_append_value(&g.format_list, format);
 		}
+	}
 
-		const SizeRange &range = formats.range(pixelformat);
-		if (range.hStep && range.vStep) {
-			GstStructure *s = gst_structure_copy(bare_s);
-			GValue val = G_VALUE_INIT;
+	GstCaps *caps = gst_caps_new_empty();
+
+	for (FormatGroup &g : groups) {
+		if (G_IS_VALUE(&g.format_list)) {
+			if (gst_value_list_get_size(&g.format_list) > 1)
+				gst_structure_take_value(g.bare, "format", &g.format_list);
+			else
+				g_value_unset(&g.format_list);
+		}
 
-			g_value_init(&val, GST_TYPE_INT_RANGE);
-			gst_value_set_int_range_step(&val, range.min.width, range.max.width, range.hStep);
-			gst_structure_set_value(s, "width", &val);
-			gst_value_set_int_range_step(&val, range.min.height, range.max.height, range.vStep);
-			gst_structure_set_value(s, "height", &val);
-			g_value_unset(&val);
+		for (GstStructure *sizes_s : g.sizes) {
+			GstStructure *s = gst_structure_copy(g.bare);
 
+			gst_structure_set_value(s, "width",
+						gst_structure_get_value(sizes_s, "width"));
+			gst_structure_set_value(s, "height",
+						gst_structure_get_value(sizes_s, "height"));
 			gst_caps_append_structure(caps, s);
+
+			gst_structure_free(sizes_s);
 		}
+
+		gst_structure_free(g.bare);
 	}
 
 	return caps;
@@ -567,6 +715,50 @@ void gst_libcamera_framerate_to_caps(GstCaps *caps, const GstStructure *element_
 	gst_structure_set(s, "framerate", GST_TYPE_FRACTION, fps_caps_n, fps_caps_d, nullptr);
 }
 
+/*
+ * Update the plane strides and offsets of the video info to the layout of
+ * libcamera buffers, whose first plane has the stream stride and whose planes
+ * are stored contiguously. Returns false if the layout of the format can't be
+ * expressed from the stride alone.
+ */
+bool
+gst_libcamera_video_info_set_stride(GstVideoInfo *info, guint stride)
+{
+	const GstVideoFormatInfo *finfo = info->finfo;
+	gint pstride = GST_VIDEO_FORMAT_INFO_PSTRIDE(finfo, 0);
+
+	if (pstride <= 0 || GST_VIDEO_FORMAT_INFO_IS_TILED(finfo))
+		return false;
+
+	/* Width of the first plane in pixels, including padding. */
+	gint width = stride / pstride;
+	gsize offset = 0;
+
+	for (guint plane = 0; plane < GST_VIDEO_INFO_N_PLANES(info); plane++) {
+		guint comp;
+
+		for (comp = 0; comp < GST_VIDEO_FORMAT_INFO_N_COMPONENTS(finfo); comp++) {
+			if (GST_VIDEO_FORMAT_INFO_PLANE(finfo, comp) == plane)
+				break;
+		}
+
+		gint planeStride = plane == 0
+				 ? stride
+				 : GST_VIDEO_FORMAT_INFO_SCALE_WIDTH(finfo, comp, width) *
+				   GST_VIDEO_FORMAT_INFO_PSTRIDE(finfo, comp);
+		gint height = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT(finfo, comp,
+								 GST_VIDEO_INFO_HEIGHT(info));
+
+		info->stride[plane] = planeStride;
+		info->offset[plane] = offset;
+		offset += static_cast<gsize>(planeStride) * height;
+	}
+
+	info->size = offset;
+
+	return true;
+}
+
 #if !GST_CHECK_VERSION(1, 17, 1)
 gboolean
 gst_task_resume(GstTask *task)
@@ -8,6 +8,9 @@
 
 #include "gstlibcameraallocator.h"
 
+#include <errno.h>
+#include <memory>
+
 #include <libcamera/camera.h>
 #include <libcamera/framebuffer_allocator.h>
 #include <libcamera/stream.h>
@@ -26,6 +29,10 @@ static gboolean gst_libcamera_allocator_release(GstMiniObject *mini_object);
  * This wrapper maintains a count of the outstanding GstMemory (there may be
  * multiple GstMemory per FrameBuffer), and give back the FrameBuffer to the
  * allocator pool when all memory objects have returned.
+ *
+ * Frames added to a running stream by gst_libcamera_allocator_grow() own the
+ * FrameBufferAllocator their FrameBuffer has been allocated from, so that they
+ * can be freed individually.
  */
 
 struct FrameWrap {
@@ -42,6 +49,7 @@ struct FrameWrap {
 	FrameBuffer *buffer_;
 	std::vector<GstMemory *> planes_;
 	gint outstandingPlanes_;
+	std::unique_ptr<FrameBufferAllocator> allocator_;
 };
 
 FrameWrap::FrameWrap(GstAllocator *allocator, FrameBuffer *buffer,
@@ -94,6 +102,7 @@ GQuark FrameWrap::getQuark()
  */
 struct _GstLibcameraAllocator {
 	GstDmaBufAllocator parent;
+	Camera *camera;
 	FrameBufferAllocator *fb_allocator;
 	/*
 	 * A hash table using Stream pointer as key and returning a GQueue of
@@ -189,14 +198,14 @@ gst_libcamera_allocator_class_init(GstLibcameraAllocatorClass *klass)
 
 GstLibcameraAllocator *
 gst_libcamera_allocator_new(std::shared_ptr<Camera> camera,
-			    CameraConfiguration *config_)
+			    const std::vector<Stream *> &streams)
 {
 	auto *self = GST_LIBCAMERA_ALLOCATOR(g_object_new(GST_TYPE_LIBCAMERA_ALLOCATOR,
 							  nullptr));
 
+	self->camera = camera.get();
 	self->fb_allocator = new FrameBufferAllocator(camera);
-	for (StreamConfiguration &streamCfg : *config_) {
-		Stream *stream = streamCfg.stream();
+	for (Stream *stream : streams) {
 		gint ret;
 
 		ret = self->fb_allocator->allocate(stream);
@@ -239,6 +248,84 @@ gst_libcamera_allocator_prepare_buffer(GstLibcameraAllocator *self,
 	return true;
 }
 
+/*
+ * Add one buffer to the pool of a stream. The buffer is allocated from a
+ * DMA-BUF heap, as the number of buffers allocated by the pipeline handler is
+ * fixed, which allows growing the pool while the camera is running.
+ */
+bool
+gst_libcamera_allocator_grow(GstLibcameraAllocator *self, Stream *stream)
+{
+	static const FrameBufferAllocator::Source sources[] = {
+		FrameBufferAllocator::Source::ContiguousHeap,
+		FrameBufferAllocator::Source::SystemHeap,
+	};
+
+	auto fb_allocator =
+		std::make_unique<FrameBufferAllocator>(self->camera->shared_from_this());
+
+	int ret = -ENODEV;
+	for (FrameBufferAllocator::Source source : sources) {
+		ret = fb_allocator->allocate(stream, source, 1);
+		if (ret > 0)
+			break;
+	}
+
+	if (ret <= 0) {
+		GST_WARNING_OBJECT(self, "Failed to allocate buffer: %s",
+				   g_strerror(-ret));
+		return false;
+	}
+
+	auto *frame = new FrameWrap(GST_ALLOCATOR(self),
+				    fb_allocator->buffers(stream)[0].get(), stream);
+	frame->allocator_ = std::move(fb_allocator);
+
+	GLibLocker lock(GST_OBJECT(self));
+
+	auto *pool = reinterpret_cast<GQueue *>(g_hash_table_lookup(self->pools, stream));
+	if (!pool) {
+		delete frame;
+		g_return_val_if_reached(false);
+	}
+
+	g_queue_push_tail(pool, frame);
+
+	return true;
+}
+
+/*
+ * Free one idle buffer previously added by gst_libcamera_allocator_grow().
+ * Returns false if no such buffer is available.
+ */
+bool
+gst_libcamera_allocator_shrink(GstLibcameraAllocator *self, Stream *stream)
+{
+	FrameWrap *frame = nullptr;
+
+	{
+		GLibLocker lock(GST_OBJECT(self));
+
+		auto *pool = reinterpret_cast<GQueue *>(g_hash_table_lookup(self->pools, stream));
+		g_return_val_if_fail(pool, false);
+
+		for (GList *l = pool->head; l; l = l->next) {
+			auto *f = reinterpret_cast<FrameWrap *>(l->data);
+			if (f->allocator_) {
+				frame = f;
+				g_queue_delete_link(pool, l);
+				break;
+			}
+		}
+	}
+
+	if (!frame)
+		return false;
+
+	delete frame;
+	return true;
+}
+
 gsize
 gst_libcamera_allocator_get_pool_size(GstLibcameraAllocator *self,
 				      Stream *stream)
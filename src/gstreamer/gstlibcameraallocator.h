@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include <gst/gst.h>
 #include <gst/allocators/allocators.h>
 
@@ -19,12 +21,18 @@ G_DECLARE_FINAL_TYPE(GstLibcameraAllocator, gst_libcamera_allocator,
 		     GST_LIBCAMERA, ALLOCATOR, GstDmaBufAllocator)
 
 GstLibcameraAllocator *gst_libcamera_allocator_new(std::shared_ptr<libcamera::Camera> camera,
-						   libcamera::CameraConfiguration *config_);
+						   const std::vector<libcamera::Stream *> &streams);
 
 bool gst_libcamera_allocator_prepare_buffer(GstLibcameraAllocator *self,
 					    libcamera::Stream *stream,
 					    GstBuffer *buffer);
 
+bool gst_libcamera_allocator_grow(GstLibcameraAllocator *self,
+				  libcamera::Stream *stream);
+
+bool gst_libcamera_allocator_shrink(GstLibcameraAllocator *self,
+				    libcamera::Stream *stream);
+
 gsize gst_libcamera_allocator_get_pool_size(GstLibcameraAllocator *allocator,
 					    libcamera::Stream *stream);
 
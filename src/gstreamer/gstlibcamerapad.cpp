@@ -8,17 +8,34 @@
 
 #include "gstlibcamerapad.h"
 
+#include <algorithm>
+#include <utility>
+
 #include <libcamera/stream.h>
 
 #include "gstlibcamera-utils.h"
 
 using namespace libcamera;
 
+/*
+ * Maximum number of buffers waiting to be pushed on a pad. When downstream is
+ * too slow to keep up, the oldest buffers are dropped to return them to the
+ * pool, so that the camera keeps being fed with requests.
+ */
+static constexpr guint kMaxPendingBuffers = 2;
+
 struct _GstLibcameraPad {
 	GstPad parent;
 	StreamRole role;
 	GstLibcameraPool *pool;
 	GstClockTime latency;
+	GstClockTime frame_duration;
+
+	/* Protected by the object lock. */
+	GstCaps *formats_caps;
+	GQueue pending_buffers;
+	guint max_pending;
+	bool discont;
 };
 
 enum {
@@ -38,6 +55,7 @@ gst_libcamera_pad_set_property(GObject *object, guint prop_id,
 	switch (prop_id) {
 	case PROP_STREAM_ROLE:
 		self->role = (StreamRole)g_value_get_enum(value);
+		gst_caps_replace(&self->formats_caps, nullptr);
 		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -70,9 +88,21 @@ gst_libcamera_pad_query(GstPad *pad, GstObject *parent, GstQuery *query)
 	if (query->type != GST_QUERY_LATENCY)
 		return gst_pad_query_default(pad, parent, query);
 
-	/* TRUE here means live, we assumes that max latency is the same as min
-	 * as we have no idea that duration of frames. */
-	gst_query_set_latency(query, TRUE, self->latency, self->latency);
+	GstClockTime min, max;
+
+	{
+		GLibLocker lock(GST_OBJECT(self));
+
+		/*
+		 * A frame is available at the earliest one frame duration after
+		 * the start of its exposure, and is then pushed after the
+		 * buffers pending on the pad. TRUE here means live.
+		 */
+		min = std::max(self->latency, self->frame_duration);
+		max = min + self->frame_duration * self->max_pending;
+	}
+
+	gst_query_set_latency(query, TRUE, min, max);
 	return TRUE;
 }
 
@@ -80,6 +110,18 @@ static void
 gst_libcamera_pad_init(GstLibcameraPad *self)
 {
 	GST_PAD_QUERYFUNC(self) = gst_libcamera_pad_query;
+	g_queue_init(&self->pending_buffers);
+	self->max_pending = kMaxPendingBuffers;
+}
+
+static void
+gst_libcamera_pad_finalize(GObject *object)
+{
+	auto *self = GST_LIBCAMERA_PAD(object);
+
+	gst_caps_replace(&self->formats_caps, nullptr);
+
+	G_OBJECT_CLASS(gst_libcamera_pad_parent_class)->finalize(object);
 }
 
 static GType
@@ -116,6 +158,7 @@ gst_libcamera_pad_class_init(GstLibcameraPadClass *klass)
 
 	object_class->set_property = gst_libcamera_pad_set_property;
 	object_class->get_property = gst_libcamera_pad_get_property;
+	object_class->finalize = gst_libcamera_pad_finalize;
 
 	auto *spec = g_param_spec_enum("stream-role", "Stream Role",
 				       "The selected stream role",
@@ -164,10 +207,121 @@ gst_libcamera_pad_get_stream(GstPad *pad)
 	return nullptr;
 }
 
+/*
+ * Return the caps of the formats supported by the stream of the pad. The caps
+ * only depend on the camera and the stream role, they are thus computed once
+ * and cached until the role changes or the cache is cleared when the camera is
+ * closed.
+ */
+GstCaps *
+gst_libcamera_pad_get_formats_caps(GstPad *pad, const StreamFormats &formats)
+{
+	auto *self = GST_LIBCAMERA_PAD(pad);
+
+	{
+		GLibLocker lock(GST_OBJECT(self));
+		if (self->formats_caps)
+			return gst_caps_ref(self->formats_caps);
+	}
+
+	GstCaps *caps = gst_libcamera_stream_formats_to_caps(formats);
+
+	GLibLocker lock(GST_OBJECT(self));
+	gst_caps_replace(&self->formats_caps, caps);
+
+	return caps;
+}
+
 void
-gst_libcamera_pad_set_latency(GstPad *pad, GstClockTime latency)
+gst_libcamera_pad_clear_formats_caps(GstPad *pad)
+{
+	auto *self = GST_LIBCAMERA_PAD(pad);
+	GLibLocker lock(GST_OBJECT(self));
+
+	gst_caps_replace(&self->formats_caps, nullptr);
+}
+
+/*
+ * Update the capture latency and frame duration of the stream. Returns true if
+ * the frame duration has changed, in which case the reported latency changes
+ * significantly and the pipeline latency should be recomputed.
+ */
+bool
+gst_libcamera_pad_set_latency(GstPad *pad, GstClockTime latency,
+			      GstClockTime frame_duration)
 {
 	auto *self = GST_LIBCAMERA_PAD(pad);
 	GLibLocker lock(GST_OBJECT(self));
+	bool changed = frame_duration != self->frame_duration;
+
 	self->latency = latency;
+	self->frame_duration = frame_duration;
+
+	return changed;
+}
+
+void
+gst_libcamera_pad_set_max_pending(GstPad *pad, guint max_pending)
+{
+	auto *self = GST_LIBCAMERA_PAD(pad);
+	GLibLocker lock(GST_OBJECT(self));
+	self->max_pending = max_pending ? max_pending : kMaxPendingBuffers;
+}
+
+void
+gst_libcamera_pad_queue_buffer(GstPad *pad, GstBuffer *buffer)
+{
+	auto *self = GST_LIBCAMERA_PAD(pad);
+	GstBuffer *dropped = nullptr;
+
+	{
+		GLibLocker lock(GST_OBJECT(self));
+
+		if (self->pending_buffers.length >= self->max_pending) {
+			dropped = GST_BUFFER(g_queue_pop_head(&self->pending_buffers));
+			self->discont = true;
+		}
+
+		g_queue_push_tail(&self->pending_buffers, buffer);
+	}
+
+	if (dropped) {
+		GST_DEBUG_OBJECT(self, "Dropping buffer %" GST_PTR_FORMAT, dropped);
+		gst_buffer_unref(dropped);
+	}
+}
+
+GstBuffer *
+gst_libcamera_pad_dequeue_buffer(GstPad *pad, bool *more)
+{
+	auto *self = GST_LIBCAMERA_PAD(pad);
+	GLibLocker lock(GST_OBJECT(self));
+
+	auto *buffer = GST_BUFFER(g_queue_pop_head(&self->pending_buffers));
+	*more = self->pending_buffers.length > 0;
+
+	if (buffer && self->discont) {
+		GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_DISCONT);
+		self->discont = false;
+	}
+
+	return buffer;
+}
+
+void
+gst_libcamera_pad_flush_buffers(GstPad *pad)
+{
+	auto *self = GST_LIBCAMERA_PAD(pad);
+	GQueue buffers = G_QUEUE_INIT;
+
+	{
+		GLibLocker lock(GST_OBJECT(self));
+		std::swap(buffers, self->pending_buffers);
+		self->discont = false;
+	}
+
+	/* Return the buffers to their pool without holding the lock. */
+	GstBuffer *buffer;
+	while ((buffer = GST_BUFFER(g_queue_pop_head(&buffers))))
+		gst_buffer_unref(buffer);
 }
@@ -25,4 +25,18 @@ void gst_libcamera_pad_set_pool(GstPad *pad, GstLibcameraPool *pool);
 
 libcamera::Stream *gst_libcamera_pad_get_stream(GstPad *pad);
 
-void gst_libcamera_pad_set_latency(GstPad *pad, GstClockTime latency);
+GstCaps *gst_libcamera_pad_get_formats_caps(GstPad *pad,
+					   const libcamera::StreamFormats &formats);
+
+void gst_libcamera_pad_clear_formats_caps(GstPad *pad);
+
+bool gst_libcamera_pad_set_latency(GstPad *pad, GstClockTime latency,
+				   GstClockTime frame_duration);
+
+void gst_libcamera_pad_set_max_pending(GstPad *pad, guint max_pending);
+
+void gst_libcamera_pad_queue_buffer(GstPad *pad, GstBuffer *buffer);
+
+GstBuffer *gst_libcamera_pad_dequeue_buffer(GstPad *pad, bool *more);
+
+void gst_libcamera_pad_flush_buffers(GstPad *pad);
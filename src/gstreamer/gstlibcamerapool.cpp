@@ -8,6 +8,12 @@
 
 #include "gstlibcamerapool.h"
 
+#include <algorithm>
+#include <vector>
+
+#include <libcamera/base/shared_fd.h>
+
+#include <libcamera/framebuffer.h>
 #include <libcamera/stream.h>
 
 #include "gstlibcamera-utils.h"
@@ -21,30 +27,312 @@ enum {
 
 static guint signals[N_SIGNALS];
 
+/*
+ * A buffer is freed when at least kSurplusBuffers buffers have been left
+ * unused in the pool for kShrinkAcquisitions consecutive acquisitions.
+ */
+static constexpr guint kSurplusBuffers = 2;
+static constexpr guint kShrinkAcquisitions = 120;
+
 struct _GstLibcameraPool {
 	GstBufferPool parent;
 
 	GstAtomicQueue *queue;
 	GstLibcameraAllocator *allocator;
 	Stream *stream;
+
+	/*
+	 * The layout of the buffers, used to describe libcamera buffers with a
+	 * GstVideoMeta, or to check the layout of buffers imported from a
+	 * downstream pool against the stream stride.
+	 */
+	GstBufferPool *downstream;
+	GstVideoInfo info;
+	bool has_info;
+	guint stride;
+
+	/*
+	 * Pool sizing, protected by the object lock. The pool grows on request
+	 * up to max_buffers, and shrinks by itself down to min_buffers when
+	 * buffers are left unused.
+	 */
+	guint n_buffers;
+	guint min_buffers;
+	guint max_buffers;
+	guint starvations;
+	guint surplus;
 };
 
 G_DEFINE_TYPE(GstLibcameraPool, gst_libcamera_pool, GST_TYPE_BUFFER_POOL)
 
+static GQuark
+gst_libcamera_imported_quark()
+{
+	static gsize imported_quark = 0;
+
+	if (g_once_init_enter(&imported_quark)) {
+		GQuark quark = g_quark_from_string("GstLibcameraImportedFrameBuffer");
+		g_once_init_leave(&imported_quark, quark);
+	}
+
+	return imported_quark;
+}
+
+static GQuark
+gst_libcamera_parent_quark()
+{
+	static gsize parent_quark = 0;
+
+	if (g_once_init_enter(&parent_quark)) {
+		GQuark quark = g_quark_from_string("GstLibcameraParentBuffer");
+		g_once_init_leave(&parent_quark, quark);
+	}
+
+	return parent_quark;
+}
+
+static void
+gst_libcamera_imported_frame_buffer_free(gpointer data)
+{
+	delete reinterpret_cast<FrameBuffer *>(data);
+}
+
+/*
+ * Create a FrameBuffer referencing the dmabufs of a buffer acquired from the
+ * downstream pool. The FrameBuffer is attached to the first memory of the
+ * buffer, and thus reused for as long as the downstream pool keeps the memory
+ * around.
+ */
+static FrameBuffer *
+gst_libcamera_pool_import_buffer(GstLibcameraPool *self, GstBuffer *buffer)
+{
+	GstMemory *mem = gst_buffer_peek_memory(buffer, 0);
+	auto *fb = reinterpret_cast<FrameBuffer *>(gst_mini_object_get_qdata(GST_MINI_OBJECT_CAST(mem),
+									     gst_libcamera_imported_quark()));
+	if (fb)
+		return fb;
+
+	guint n_planes = GST_VIDEO_INFO_N_PLANES(&self->info);
+	const gsize *offsets = self->info.offset;
+	const gint *strides = self->info.stride;
+
+	GstVideoMeta *meta = gst_buffer_get_video_meta(buffer);
+	if (meta) {
+		n_planes = meta->n_planes;
+		offsets = meta->offset;
+		strides = meta->stride;
+	}
+
+	/* libcamera writes the frames with the stride of the stream. */
+	if (strides[0] < 0 || static_cast<guint>(strides[0]) != self->stride) {
+		GST_DEBUG_OBJECT(self, "Buffer stride %d doesn't match stream stride %u",
+				 strides[0], self->stride);
+		return nullptr;
+	}
+
+	gsize size = gst_buffer_get_size(buffer);
+	std::vector<FrameBuffer::Plane> planes;
+	GstMemory *lastMem = nullptr;
+
+	for (guint i = 0; i < n_planes; i++) {
+		guint idx, length;
+		gsize skip;
+
+		if (!gst_buffer_find_memory(buffer, offsets[i], 1, &idx, &length, &skip))
+			return nullptr;
+
+		GstMemory *planeMem = gst_buffer_peek_memory(buffer, idx);
+		if (!gst_is_dmabuf_memory(planeMem)) {
+			GST_DEBUG_OBJECT(self, "Buffer memory isn't a dmabuf");
+			return nullptr;
+		}
+
+		gsize end = i + 1 < n_planes ? offsets[i + 1] : size;
+
+		FrameBuffer::Plane plane;
+		if (planeMem == lastMem) {
+			plane.fd = planes.back().fd;
+		} else {
+			int fd = gst_dmabuf_memory_get_fd(planeMem);
+			plane.fd = SharedFD(fd);
+		}
+		plane.offset = planeMem->offset + skip;
+		plane.length = std::min<gsize>(end - offsets[i], planeMem->size - skip);
+
+		if (!plane.fd.isValid())
+			return nullptr;
+
+		planes.push_back(std::move(plane));
+		lastMem = planeMem;
+	}
+
+	fb = new FrameBuffer(planes);
+	gst_mini_object_set_qdata(GST_MINI_OBJECT_CAST(mem),
+				  gst_libcamera_imported_quark(), fb,
+				  gst_libcamera_imported_frame_buffer_free);
+
+	return fb;
+}
+
+static bool
+gst_libcamera_pool_acquire_downstream(GstLibcameraPool *self, GstBuffer *buffer)
+{
+	GstBufferPoolAcquireParams params = {};
+	GstBuffer *parent;
+
+	params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+	if (gst_buffer_pool_acquire_buffer(self->downstream, &parent, &params) != GST_FLOW_OK)
+		return false;
+
+	if (!gst_libcamera_pool_import_buffer(self, parent)) {
+		gst_buffer_unref(parent);
+		return false;
+	}
+
+	/*
+	 * Share the memories of the downstream buffer, and keep the buffer
+	 * itself alive until the memories are removed in reset_buffer. It then
+	 * returns to the downstream pool with exclusive access to its memories.
+	 */
+	for (guint i = 0; i < gst_buffer_n_memory(parent); i++)
+		gst_buffer_append_memory(buffer, gst_buffer_get_memory(parent, i));
+
+	GstVideoMeta *meta = gst_buffer_get_video_meta(parent);
+	if (meta)
+		gst_buffer_add_video_meta_full(buffer, meta->flags, meta->format,
+					       meta->width, meta->height,
+					       meta->n_planes, meta->offset,
+					       meta->stride);
+
+	gst_mini_object_set_qdata(GST_MINI_OBJECT_CAST(buffer),
+				  gst_libcamera_parent_quark(), parent,
+				  reinterpret_cast<GDestroyNotify>(gst_buffer_unref));
+
+	return true;
+}
+
+/*
+ * Describe the layout of a libcamera buffer, so that downstream doesn't need
+ * to copy the frames to the layout it would otherwise deduce from the caps.
+ * The meta is pooled and only the plane offsets are updated when the buffer
+ * is reused.
+ */
+static void
+gst_libcamera_pool_add_video_meta(GstLibcameraPool *self, GstBuffer *buffer)
+{
+	const GstVideoInfo *info = &self->info;
+	guint n_planes = GST_VIDEO_INFO_N_PLANES(info);
+	gsize offsets[GST_VIDEO_MAX_PLANES];
+
+	/*
+	 * Each plane of the FrameBuffer is wrapped in its own memory, in which
+	 * case a plane starts right after the previous one in the buffer.
+	 */
+	if (gst_buffer_n_memory(buffer) == n_planes) {
+		gsize offset = 0;
+
+		for (guint i = 0; i < n_planes; i++) {
+			offsets[i] = offset;
+			offset += gst_buffer_peek_memory(buffer, i)->size;
+		}
+	} else {
+		std::copy(info->offset, info->offset + n_planes, offsets);
+	}
+
+	GstVideoMeta *meta = gst_buffer_get_video_meta(buffer);
+	if (meta) {
+		std::copy(offsets, offsets + n_planes, meta->offset);
+		return;
+	}
+
+	meta = gst_buffer_add_video_meta_full(buffer, GST_VIDEO_FRAME_FLAG_NONE,
+					      GST_VIDEO_INFO_FORMAT(info),
+					      GST_VIDEO_INFO_WIDTH(info),
+					      GST_VIDEO_INFO_HEIGHT(info),
+					      n_planes, offsets, info->stride);
+	GST_META_FLAG_SET(meta, GST_META_FLAG_POOLED);
+}
+
+/* Free one of the buffers added by gst_libcamera_pool_grow(). */
+static void
+gst_libcamera_pool_shrink(GstLibcameraPool *self)
+{
+	GstBuffer *buf = GST_BUFFER(gst_atomic_queue_pop(self->queue));
+	if (!buf)
+		return;
+
+	if (!gst_libcamera_allocator_shrink(self->allocator, self->stream)) {
+		gst_atomic_queue_push(self->queue, buf);
+		return;
+	}
+
+	gst_buffer_unref(buf);
+
+	GLibLocker lock(GST_OBJECT(self));
+	self->n_buffers--;
+
+	GST_DEBUG_OBJECT(self, "Shrunk pool to %u buffers", self->n_buffers);
+}
+
+/*
+ * Track the buffers left unused in the pool after an acquisition, and free
+ * one buffer when the surplus lasts.
+ */
+static void
+gst_libcamera_pool_track_surplus(GstLibcameraPool *self)
+{
+	guint available = gst_atomic_queue_length(self->queue);
+
+	{
+		GLibLocker lock(GST_OBJECT(self));
+
+		if (available < kSurplusBuffers) {
+			self->surplus = 0;
+			return;
+		}
+
+		if (++self->surplus < kShrinkAcquisitions)
+			return;
+
+		self->surplus = 0;
+
+		if (self->n_buffers <= self->min_buffers)
+			return;
+	}
+
+	gst_libcamera_pool_shrink(self);
+}
+
 static GstFlowReturn
 gst_libcamera_pool_acquire_buffer(GstBufferPool *pool, GstBuffer **buffer,
 				  [[maybe_unused]] GstBufferPoolAcquireParams *params)
 {
 	GstLibcameraPool *self = GST_LIBCAMERA_POOL(pool);
 	GstBuffer *buf = GST_BUFFER(gst_atomic_queue_pop(self->queue));
-	if (!buf)
-		return GST_FLOW_ERROR;
+	bool prepared = false;
 
-	if (!gst_libcamera_allocator_prepare_buffer(self->allocator, self->stream, buf)) {
-		gst_atomic_queue_push(self->queue, buf);
+	if (buf) {
+		prepared = self->downstream
+			 ? gst_libcamera_pool_acquire_downstream(self, buf)
+			 : gst_libcamera_allocator_prepare_buffer(self->allocator, self->stream, buf);
+		if (!prepared)
+			gst_atomic_queue_push(self->queue, buf);
+	}
+
+	if (!prepared) {
+		GLibLocker lock(GST_OBJECT(self));
+		self->starvations++;
+		self->surplus = 0;
 		return GST_FLOW_ERROR;
 	}
 
+	if (!self->downstream) {
+		if (self->has_info)
+			gst_libcamera_pool_add_video_meta(self, buf);
+
+		gst_libcamera_pool_track_surplus(self);
+	}
+
 	*buffer = buf;
 	return GST_FLOW_OK;
 }
@@ -56,6 +344,8 @@ gst_libcamera_pool_reset_buffer(GstBufferPool *pool, GstBuffer *buffer)
 
 	/* Clears all the memories and only pool the GstBuffer objects */
 	gst_buffer_remove_all_memory(buffer);
+	gst_mini_object_set_qdata(GST_MINI_OBJECT_CAST(buffer),
+				  gst_libcamera_parent_quark(), nullptr, nullptr);
 	klass->reset_buffer(pool, buffer);
 	GST_BUFFER_FLAGS(buffer) = 0;
 }
@@ -88,7 +378,12 @@ gst_libcamera_pool_finalize(GObject *object)
 		gst_buffer_unref(buf);
 
 	gst_atomic_queue_unref(self->queue);
-	g_object_unref(self->allocator);
+	g_clear_object(&self->allocator);
+
+	if (self->downstream) {
+		gst_buffer_pool_set_active(self->downstream, FALSE);
+		gst_object_unref(self->downstream);
+	}
 
 	G_OBJECT_CLASS(gst_libcamera_pool_parent_class)->finalize(object);
 }
@@ -112,12 +407,20 @@ gst_libcamera_pool_class_init(GstLibcameraPoolClass *klass)
 }
 
 GstLibcameraPool *
-gst_libcamera_pool_new(GstLibcameraAllocator *allocator, Stream *stream)
+gst_libcamera_pool_new(GstLibcameraAllocator *allocator, Stream *stream,
+		       const GstVideoInfo *info)
 {
 	auto *pool = GST_LIBCAMERA_POOL(g_object_new(GST_TYPE_LIBCAMERA_POOL, nullptr));
 
 	pool->allocator = GST_LIBCAMERA_ALLOCATOR(g_object_ref(allocator));
 	pool->stream = stream;
+	pool->stride = stream->configuration().stride;
+
+	if (info) {
+		pool->info = *info;
+		pool->has_info = gst_libcamera_video_info_set_stride(&pool->info,
+								     pool->stride);
+	}
 
 	gsize pool_size = gst_libcamera_allocator_get_pool_size(allocator, stream);
 	for (gsize i = 0; i < pool_size; i++) {
@@ -125,9 +428,135 @@ gst_libcamera_pool_new(GstLibcameraAllocator *allocator, Stream *stream)
 		gst_atomic_queue_push(pool->queue, buffer);
 	}
 
+	pool->n_buffers = pool_size;
+	pool->min_buffers = pool_size;
+	pool->max_buffers = pool_size;
+
 	return pool;
 }
 
+/*
+ * Create a pool providing buffers acquired from an active downstream pool. The
+ * pool takes a reference to the downstream pool and deactivates it when
+ * finalized. Returns nullptr if the downstream buffers can't be imported as
+ * FrameBuffer for the stream.
+ */
+GstLibcameraPool *
+gst_libcamera_pool_new_imported(GstBufferPool *downstream, Stream *stream,
+				const GstVideoInfo *info, guint stride,
+				guint count)
+{
+	auto *pool = GST_LIBCAMERA_POOL(g_object_new(GST_TYPE_LIBCAMERA_POOL, nullptr));
+
+	pool->downstream = GST_BUFFER_POOL(gst_object_ref(downstream));
+	pool->stream = stream;
+	pool->info = *info;
+	pool->has_info = true;
+	pool->stride = stride;
+
+	/* Check that the downstream buffers can be imported. */
+	GstBuffer *buffer = gst_buffer_new();
+	bool imported = gst_libcamera_pool_acquire_downstream(pool, buffer);
+	gst_buffer_remove_all_memory(buffer);
+	gst_buffer_unref(buffer);
+
+	if (!imported) {
+		/* Leave the downstream pool active for the caller to clean up. */
+		gst_object_unref(pool->downstream);
+		pool->downstream = nullptr;
+		g_object_unref(pool);
+		return nullptr;
+	}
+
+	for (guint i = 0; i < count; i++)
+		gst_atomic_queue_push(pool->queue, gst_buffer_new());
+
+	/* The downstream pool has a fixed size. */
+	pool->n_buffers = count;
+	pool->min_buffers = count;
+	pool->max_buffers = count;
+
+	return pool;
+}
+
+/*
+ * Set the range of buffers the pool can grow and shrink within. A max_buffers
+ * of 0 defaults to twice the initial number of buffers. The limits are ignored
+ * for pools importing downstream buffers.
+ */
+void
+gst_libcamera_pool_set_limits(GstLibcameraPool *self, guint min_buffers,
+			      guint max_buffers)
+{
+	if (self->downstream)
+		return;
+
+	GLibLocker lock(GST_OBJECT(self));
+
+	self->min_buffers = min_buffers;
+	self->max_buffers = max_buffers ? max_buffers : self->n_buffers * 2;
+}
+
+/*
+ * Add one buffer to the pool, typically when the camera starves because
+ * downstream holds on to more buffers than initially allocated. Returns false
+ * if the pool has reached its maximum size or the buffer can't be allocated.
+ *
+ * Must be called from the streaming thread.
+ */
+bool
+gst_libcamera_pool_grow(GstLibcameraPool *self)
+{
+	if (self->downstream)
+		return false;
+
+	{
+		GLibLocker lock(GST_OBJECT(self));
+		if (self->n_buffers >= self->max_buffers)
+			return false;
+	}
+
+	if (!gst_libcamera_allocator_grow(self->allocator, self->stream))
+		return false;
+
+	gst_atomic_queue_push(self->queue, gst_buffer_new());
+
+	GLibLocker lock(GST_OBJECT(self));
+	self->n_buffers++;
+
+	GST_DEBUG_OBJECT(self, "Grown pool to %u buffers", self->n_buffers);
+
+	return true;
+}
+
+guint
+gst_libcamera_pool_get_size(GstLibcameraPool *self)
+{
+	GLibLocker lock(GST_OBJECT(self));
+	return self->n_buffers;
+}
+
+/*
+ * Report the occupancy of the pool, as a structure with the total number of
+ * buffers, the number of buffers available in the pool, the size limits and
+ * the number of times a buffer couldn't be acquired.
+ */
+GstStructure *
+gst_libcamera_pool_get_stats(GstLibcameraPool *self)
+{
+	guint available = gst_atomic_queue_length(self->queue);
+
+	GLibLocker lock(GST_OBJECT(self));
+
+	return gst_structure_new("stats",
+				 "buffers", G_TYPE_UINT, self->n_buffers,
+				 "available", G_TYPE_UINT, available,
+				 "min-buffers", G_TYPE_UINT, self->min_buffers,
+				 "max-buffers", G_TYPE_UINT, self->max_buffers,
+				 "starvations", G_TYPE_UINT, self->starvations,
+				 nullptr);
+}
+
 Stream *
 gst_libcamera_pool_get_stream(GstLibcameraPool *self)
 {
@@ -138,5 +567,11 @@ FrameBuffer *
 gst_libcamera_buffer_get_frame_buffer(GstBuffer *buffer)
 {
 	GstMemory *mem = gst_buffer_peek_memory(buffer, 0);
+
+	auto *fb = reinterpret_cast<FrameBuffer *>(gst_mini_object_get_qdata(GST_MINI_OBJECT_CAST(mem),
+									     gst_libcamera_imported_quark()));
+	if (fb)
+		return fb;
+
 	return gst_libcamera_memory_get_frame_buffer(mem);
 }
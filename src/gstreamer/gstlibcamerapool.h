@@ -14,6 +14,7 @@
 #include "gstlibcameraallocator.h"
 
 #include <gst/gst.h>
+#include <gst/video/video.h>
 
 #include <libcamera/stream.h>
 
@@ -21,7 +22,22 @@
 G_DECLARE_FINAL_TYPE(GstLibcameraPool, gst_libcamera_pool, GST_LIBCAMERA, POOL, GstBufferPool)
 
 GstLibcameraPool *gst_libcamera_pool_new(GstLibcameraAllocator *allocator,
-					 libcamera::Stream *stream);
+					 libcamera::Stream *stream,
+					 const GstVideoInfo *info);
+
+GstLibcameraPool *gst_libcamera_pool_new_imported(GstBufferPool *downstream,
+						  libcamera::Stream *stream,
+						  const GstVideoInfo *info,
+						  guint stride, guint count);
+
+void gst_libcamera_pool_set_limits(GstLibcameraPool *self, guint min_buffers,
+				   guint max_buffers);
+
+bool gst_libcamera_pool_grow(GstLibcameraPool *self);
+
+guint gst_libcamera_pool_get_size(GstLibcameraPool *self);
+
+GstStructure *gst_libcamera_pool_get_stats(GstLibcameraPool *self);
 
 libcamera::Stream *gst_libcamera_pool_get_stream(GstLibcameraPool *self);
 
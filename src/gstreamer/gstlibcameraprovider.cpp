@@ -7,6 +7,7 @@
  */
 
 #include <array>
+#include <memory>
 
 #include "gstlibcameraprovider.h"
 
@@ -140,16 +141,22 @@ gst_libcamera_device_class_init(GstLibcameraDeviceClass *klass)
 	g_object_class_install_property(object_class, PROP_AUTO_FOCUS_MODE, pspec);
 }
 
-static GstDevice *
-gst_libcamera_device_new(const std::shared_ptr<Camera> &camera)
+/*
+ * Compute the caps of a camera. This generates a camera configuration, which
+ * can be slow, and is thus only done once per camera and cached by the
+ * provider.
+ */
+static GstCaps *
+gst_libcamera_camera_get_caps(const std::shared_ptr<Camera> &camera)
 {
 	static const std::array roles{ StreamRole::VideoRecording };
-	g_autoptr(GstCaps) caps = gst_caps_new_empty();
-	const gchar *name = camera->id().c_str();
+	GstCaps *caps = gst_caps_new_empty();
 
 	std::unique_ptr<CameraConfiguration> config = camera->generateConfiguration(roles);
 	if (!config || config->size() != roles.size()) {
-		GST_ERROR("Failed to generate a default configuration for %s", name);
+		GST_ERROR("Failed to generate a default configuration for %s",
+			  camera->id().c_str());
+		gst_caps_unref(caps);
 		return nullptr;
 	}
 
@@ -159,6 +166,14 @@ gst_libcamera_device_new(const std::shared_ptr<Camera> &camera)
 			gst_caps_append(caps, sub_caps);
 	}
 
+	return caps;
+}
+
+static GstDevice *
+gst_libcamera_device_new(const std::shared_ptr<Camera> &camera, GstCaps *caps)
+{
+	const gchar *name = camera->id().c_str();
+
 	return GST_DEVICE(g_object_new(GST_TYPE_LIBCAMERA_DEVICE,
 				       /* \todo Use a unique identifier instead of camera name. */
 				       "name", name,
@@ -168,16 +183,49 @@ gst_libcamera_device_new(const std::shared_ptr<Camera> &camera)
 				       nullptr));
 }
 
+/*
+ * Caps advertised by devices until the caps of the camera have been computed.
+ * They match the template caps of libcamerasrc.
+ */
+#define GST_LIBCAMERA_DEVICE_PLACEHOLDER_CAPS "video/x-raw; image/jpeg; video/x-bayer"
+
 /**
  * \struct _GstLibcameraProvider
  * \brief libcamera GstDeviceProvider implementation
  *
  * This GstFeature is used by GstDeviceMonitor to probe the available
  * libcamera devices. The implementation is private to the plugin.
+ *
+ * When started, the provider tracks the cameras added and removed through
+ * the CameraManager signals. Devices are published immediately, and their
+ * caps are computed in a separate thread, replacing the placeholder caps the
+ * devices are initially created with. The caps of each camera are cached for
+ * the lifetime of the provider.
  */
 
+/* Used for C++ object with destructors. */
+struct GstLibcameraProviderState {
+	GstLibcameraProvider *provider_;
+	std::shared_ptr<CameraManager> cm_;
+
+	void cameraAdded(std::shared_ptr<Camera> camera);
+	void cameraRemoved(std::shared_ptr<Camera> camera);
+};
+
 struct _GstLibcameraProvider {
 	GstDeviceProvider parent;
+
+	GstLibcameraProviderState *state;
+
+	/*
+	 * The lock protects the caps cache and the devices, both hash tables
+	 * using the camera id as key, and the caps_pool pointer.
+	 */
+	GMutex lock;
+	GHashTable *caps_cache;
+	GHashTable *devices;
+
+	GThreadPool *caps_pool;
 };
 
 G_DEFINE_TYPE_WITH_CODE(GstLibcameraProvider, gst_libcamera_provider,
@@ -185,6 +233,154 @@ G_DEFINE_TYPE_WITH_CODE(GstLibcameraProvider, gst_libcamera_provider,
 			GST_DEBUG_CATEGORY_INIT(provider_debug, "libcamera-provider", 0,
 						"libcamera Device Provider"))
 
+/*
+ * Return a new reference to the caps of a camera, computing and caching them
+ * if needed.
+ */
+static GstCaps *
+gst_libcamera_provider_get_caps(GstLibcameraProvider *self,
+				const std::shared_ptr<Camera> &camera)
+{
+	const gchar *id = camera->id().c_str();
+
+	{
+		GLibLocker lock(&self->lock);
+		auto *caps = reinterpret_cast<GstCaps *>(g_hash_table_lookup(self->caps_cache, id));
+		if (caps)
+			return gst_caps_ref(caps);
+	}
+
+	GstCaps *caps = gst_libcamera_camera_get_caps(camera);
+	if (!caps)
+		return nullptr;
+
+	GLibLocker lock(&self->lock);
+	g_hash_table_replace(self->caps_cache, g_strdup(id), gst_caps_ref(caps));
+
+	return caps;
+}
+
+/* Compute the caps of a camera and update its device. Runs in caps_pool. */
+static void
+gst_libcamera_provider_update_caps(gpointer data, gpointer user_data)
+{
+	g_autofree gchar *id = reinterpret_cast<gchar *>(data);
+	GstLibcameraProvider *self = GST_LIBCAMERA_PROVIDER(user_data);
+
+	/* Skip the pending updates when the provider is stopping. */
+	{
+		GLibLocker lock(&self->lock);
+		if (!self->caps_pool)
+			return;
+	}
+
+	std::shared_ptr<Camera> camera = self->state->cm_->get(id);
+	if (!camera)
+		return;
+
+	g_autoptr(GstCaps) caps = gst_libcamera_provider_get_caps(self, camera);
+	if (!caps) {
+		GST_ERROR_OBJECT(self, "Failed to get caps of camera '%s'", id);
+		return;
+	}
+
+#if GST_CHECK_VERSION(1, 16, 0)
+	GLibLocker lock(&self->lock);
+
+	/* The camera may have been removed in the meantime. */
+	auto *old_dev = reinterpret_cast<GstDevice *>(g_hash_table_lookup(self->devices, id));
+	if (!old_dev)
+		return;
+
+	gst_object_ref(old_dev);
+
+	GstDevice *dev = gst_libcamera_device_new(camera, caps);
+	g_hash_table_replace(self->devices, g_strdup(id), gst_object_ref(dev));
+	gst_device_provider_device_changed(GST_DEVICE_PROVIDER(self), dev, old_dev);
+
+	gst_object_unref(old_dev);
+#endif
+}
+
+static void
+gst_libcamera_provider_add_camera(GstLibcameraProvider *self,
+				  const std::shared_ptr<Camera> &camera)
+{
+	const gchar *id = camera->id().c_str();
+	g_autoptr(GstCaps) caps = nullptr;
+	bool update = false;
+
+	GST_INFO_OBJECT(self, "Found camera '%s'", id);
+
+	{
+		GLibLocker lock(&self->lock);
+		if (g_hash_table_contains(self->devices, id))
+			return;
+
+		auto *cached = reinterpret_cast<GstCaps *>(g_hash_table_lookup(self->caps_cache, id));
+		if (cached)
+			caps = gst_caps_ref(cached);
+	}
+
+#if GST_CHECK_VERSION(1, 16, 0)
+	/* Publish the device now and update it once its caps are known. */
+	if (!caps) {
+		caps = gst_caps_from_string(GST_LIBCAMERA_DEVICE_PLACEHOLDER_CAPS);
+		update = true;
+	}
+#else
+	/* Devices can't be updated, compute the caps synchronously. */
+	if (!caps)
+		caps = gst_libcamera_provider_get_caps(self, camera);
+	if (!caps) {
+		GST_ERROR_OBJECT(self, "Failed to add camera '%s'", id);
+		return;
+	}
+#endif
+
+	GLibLocker lock(&self->lock);
+
+	if (g_hash_table_contains(self->devices, id))
+		return;
+
+	GstDevice *dev = gst_libcamera_device_new(camera, caps);
+	g_hash_table_insert(self->devices, g_strdup(id), gst_object_ref(dev));
+	gst_device_provider_device_add(GST_DEVICE_PROVIDER(self), dev);
+
+	if (update && self->caps_pool)
+		g_thread_pool_push(self->caps_pool, g_strdup(id), nullptr);
+}
+
+static void
+gst_libcamera_provider_remove_camera(GstLibcameraProvider *self,
+				     const std::shared_ptr<Camera> &camera)
+{
+	const gchar *id = camera->id().c_str();
+
+	GST_INFO_OBJECT(self, "Camera '%s' removed", id);
+
+	GLibLocker lock(&self->lock);
+
+	auto *dev = reinterpret_cast<GstDevice *>(g_hash_table_lookup(self->devices, id));
+	if (!dev)
+		return;
+
+	gst_device_provider_device_remove(GST_DEVICE_PROVIDER(self), dev);
+	g_hash_table_remove(self->devices, id);
+}
+
+/* Called from the CameraManager thread. */
+void GstLibcameraProviderState::cameraAdded(std::shared_ptr<Camera> camera)
+{
+	gst_libcamera_provider_add_camera(provider_, camera);
+}
+
+/* Called from the CameraManager thread. */
+void GstLibcameraProviderState::cameraRemoved(std::shared_ptr<Camera> camera)
+{
+	gst_libcamera_provider_remove_camera(provider_, camera);
+}
+
 static GList *
 gst_libcamera_provider_probe(GstDeviceProvider *provider)
 {
@@ -195,10 +391,9 @@ gst_libcamera_provider_probe(GstDeviceProvider *provider)
 
 	GST_INFO_OBJECT(self, "Probing cameras using libcamera");
 
-	/* \todo Move the CameraMananger start()/stop() calls into
-	 * GstDeviceProvider start()/stop() virtual function when CameraMananger
-	 * gains monitoring support. Meanwhile we need to cycle start()/stop()
-	 * to ensure every probe() calls return the latest list.
+	/*
+	 * The CameraManager is only kept alive while the provider is started.
+	 * Otherwise, get it for each probe() call to return the latest list.
 	 */
 	cm = gst_libcamera_get_camera_manager(ret);
 	if (ret) {
@@ -210,13 +405,15 @@ gst_libcamera_provider_probe(GstDeviceProvider *provider)
 	for (const std::shared_ptr<Camera> &camera : cm->cameras()) {
 		GST_INFO_OBJECT(self, "Found camera '%s'", camera->id().c_str());
 
-		GstDevice *dev = gst_libcamera_device_new(camera);
-		if (!dev) {
+		g_autoptr(GstCaps) caps = gst_libcamera_provider_get_caps(self, camera);
+		if (!caps) {
 			GST_ERROR_OBJECT(self, "Failed to add camera '%s'",
 					 camera->id().c_str());
+			g_list_free_full(devices, gst_object_unref);
 			return nullptr;
 		}
 
+		GstDevice *dev = gst_libcamera_device_new(camera, caps);
 		devices = g_list_append(devices,
 					g_object_ref_sink(dev));
 	}
@@ -224,21 +421,110 @@ gst_libcamera_provider_probe(GstDeviceProvider *provider)
 	return devices;
 }
 
+static gboolean
+gst_libcamera_provider_start(GstDeviceProvider *provider)
+{
+	GstLibcameraProvider *self = GST_LIBCAMERA_PROVIDER(provider);
+	GstLibcameraProviderState *state = self->state;
+	gint ret;
+
+	GST_INFO_OBJECT(self, "Monitoring cameras using libcamera");
+
+	state->cm_ = gst_libcamera_get_camera_manager(ret);
+	if (ret) {
+		GST_ERROR_OBJECT(self, "Failed to start the camera manager: %s",
+				 g_strerror(-ret));
+		state->cm_.reset();
+		return FALSE;
+	}
+
+	self->caps_pool = g_thread_pool_new(gst_libcamera_provider_update_caps,
+					    self, 1, FALSE, nullptr);
+
+	/*
+	 * Connect the signals before listing the cameras to avoid missing any.
+	 * Cameras reported twice are ignored.
+	 */
+	state->cm_->cameraAdded.connect(state, &GstLibcameraProviderState::cameraAdded);
+	state->cm_->cameraRemoved.connect(state, &GstLibcameraProviderState::cameraRemoved);
+
+	for (const std::shared_ptr<Camera> &camera : state->cm_->cameras())
+		gst_libcamera_provider_add_camera(self, camera);
+
+	return TRUE;
+}
+
+static void
+gst_libcamera_provider_stop(GstDeviceProvider *provider)
+{
+	GstLibcameraProvider *self = GST_LIBCAMERA_PROVIDER(provider);
+	GstLibcameraProviderState *state = self->state;
+
+	state->cm_->cameraAdded.disconnect(state);
+	state->cm_->cameraRemoved.disconnect(state);
+
+	/* Skip the pending caps updates and wait for the current one. */
+	GThreadPool *caps_pool;
+	{
+		GLibLocker lock(&self->lock);
+		caps_pool = self->caps_pool;
+		self->caps_pool = nullptr;
+	}
+
+	g_thread_pool_free(caps_pool, FALSE, TRUE);
+
+	/* GstDeviceProvider releases the devices after stop() returns. */
+	{
+		GLibLocker lock(&self->lock);
+		g_hash_table_remove_all(self->devices);
+	}
+
+	state->cm_.reset();
+}
+
 static void
 gst_libcamera_provider_init(GstLibcameraProvider *self)
 {
 	GstDeviceProvider *provider = GST_DEVICE_PROVIDER(self);
 
+	self->state = new GstLibcameraProviderState();
+	self->state->provider_ = self;
+
+	g_mutex_init(&self->lock);
+	self->caps_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+						 reinterpret_cast<GDestroyNotify>(gst_caps_unref));
+	self->devices = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+					      gst_object_unref);
+
 	/* Avoid devices being duplicated. */
 	gst_device_provider_hide_provider(provider, "v4l2deviceprovider");
 }
 
+static void
+gst_libcamera_provider_finalize(GObject *object)
+{
+	GstLibcameraProvider *self = GST_LIBCAMERA_PROVIDER(object);
+	gpointer klass = gst_libcamera_provider_parent_class;
+
+	g_hash_table_unref(self->devices);
+	g_hash_table_unref(self->caps_cache);
+	g_mutex_clear(&self->lock);
+	delete self->state;
+
+	G_OBJECT_CLASS(klass)->finalize(object);
+}
+
 static void
 gst_libcamera_provider_class_init(GstLibcameraProviderClass *klass)
 {
 	GstDeviceProviderClass *provider_class = GST_DEVICE_PROVIDER_CLASS(klass);
+	GObjectClass *object_class = G_OBJECT_CLASS(klass);
 
 	provider_class->probe = gst_libcamera_provider_probe;
+	provider_class->start = gst_libcamera_provider_start;
+	provider_class->stop = gst_libcamera_provider_stop;
+
+	object_class->finalize = gst_libcamera_provider_finalize;
 
 	gst_device_provider_class_set_metadata(provider_class,
 					       "libcamera Device Provider",
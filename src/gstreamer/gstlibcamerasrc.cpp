@@ -15,18 +15,17 @@
  *    + Evaluate if a single streaming thread is fine
  *  - Add application driven request (snapshot)
  *  - Add framerate control
- *  - Add buffer importation support
  *
  *  Requires new libcamera API:
  *  - Add framerate negotiation support
  *  - Add colorimetry support
  *  - Add timestamp support
  *  - Use unique names to select the camera devices
- *  - Add GstVideoMeta support (strides and offsets)
  */
 
 #include "gstlibcamerasrc.h"
 
+#include <algorithm>
 #include <atomic>
 #include <queue>
 #include <vector>
@@ -40,6 +39,8 @@
 #include "gstlibcameraallocator.h"
 #include "gstlibcamerapad.h"
 #include "gstlibcamerapool.h"
+#include "gstlibcamera-controls.h"
+#include "gstlibcamera-syncgroup.h"
 #include "gstlibcamera-utils.h"
 
 using namespace libcamera;
@@ -58,11 +59,13 @@ struct RequestWrap {
 	std::map<Stream *, GstBuffer *> buffers_;
 
 	GstClockTime latency_;
+	GstClockTime frameDuration_;
 	GstClockTime pts_;
 };
 
 RequestWrap::RequestWrap(std::unique_ptr<Request> request)
-	: request_(std::move(request)), latency_(0), pts_(GST_CLOCK_TIME_NONE)
+	: request_(std::move(request)), latency_(0), frameDuration_(0),
+	  pts_(GST_CLOCK_TIME_NONE)
 {
 }
 
@@ -129,9 +132,25 @@ struct GstLibcameraSrcState {
 	ControlList initControls_;
 	guint group_id_;
 
+	/*
+	 * Combined flow return of the pad tasks, reported to the streaming
+	 * task when it isn't GST_FLOW_OK.
+	 */
+	std::atomic<GstFlowReturn> flowReturn_;
+
+	/* Maximum number of queued requests, 0 if unlimited. */
+	unsigned int maxQueuedRequests_;
+
+	/* Protected by the object lock of the element. */
+	GstCameraControls controls_;
+
+	/* The sync group joined by the element, if any. */
+	std::shared_ptr<GstCameraSyncGroup> syncGroup_;
+
 	int queueRequest();
 	void requestCompleted(Request *request);
 	int processRequest();
+	int processFlowReturn(GstFlowReturn ret);
 	void clearRequests();
 };
 
@@ -142,7 +161,11 @@ struct _GstLibcameraSrc {
 	GstTask *task;
 
 	gchar *camera_name;
+	gchar *sync_group;
 	controls::AfModeEnum auto_focus_mode = controls::AfModeManual;
+	gboolean low_latency;
+	guint min_buffers;
+	guint max_buffers;
 
 	std::atomic<GstEvent *> pending_eos;
 
@@ -155,12 +178,30 @@ enum {
 	PROP_0,
 	PROP_CAMERA_NAME,
 	PROP_AUTO_FOCUS_MODE,
+	PROP_LOW_LATENCY,
+	PROP_MIN_BUFFERS,
+	PROP_MAX_BUFFERS,
+	PROP_POOL_STATS,
+	PROP_SYNC_GROUP,
+	PROP_LAST,
 };
 
 G_DEFINE_TYPE_WITH_CODE(GstLibcameraSrc, gst_libcamera_src, GST_TYPE_ELEMENT,
 			GST_DEBUG_CATEGORY_INIT(source_debug, "libcamerasrc", 0,
 						"libcamera Source"))
 
+/*
+ * Number of requests queued in low-latency mode when the pipeline depth isn't
+ * reported by the camera.
+ */
+static constexpr unsigned int kLowLatencyQueuedRequests = 2;
+
+/*
+ * Number of requests queued to the camera below which running out of buffers
+ * is considered as starvation, and the buffer pool is grown.
+ */
+static constexpr unsigned int kStarvationQueuedRequests = 2;
+
 #define TEMPLATE_CAPS GST_STATIC_CAPS("video/x-raw; image/jpeg; video/x-bayer")
 
 /* For the simple case, we have a src pad that is always present. */
@@ -173,9 +214,55 @@ GstStaticPadTemplate request_src_template = {
 	"src_%u", GST_PAD_SRC, GST_PAD_REQUEST, TEMPLATE_CAPS
 };
 
+/*
+ * Push the buffers queued on a pad. The task is started for each buffer queued
+ * by processRequest(), and pauses itself when no buffer is left.
+ */
+static void
+gst_libcamera_src_pad_task_run(gpointer user_data)
+{
+	GstPad *srcpad = GST_PAD(user_data);
+	GstLibcameraSrc *self = GST_LIBCAMERA_SRC(GST_PAD_PARENT(srcpad));
+
+	/*
+	 * As for the streaming task, pause first and resume if more buffers are
+	 * pending after this iteration. gst_pad_start_task() is called after
+	 * queuing a buffer, which makes this race-free.
+	 */
+	gst_pad_pause_task(srcpad);
+
+	bool more;
+	GstBuffer *buffer = gst_libcamera_pad_dequeue_buffer(srcpad, &more);
+	if (!buffer)
+		return;
+
+	GstFlowReturn ret = gst_pad_push(srcpad, buffer);
+
+	{
+		GLibLocker lock(GST_OBJECT(self));
+		ret = gst_flow_combiner_update_pad_flow(self->flow_combiner,
+							srcpad, ret);
+	}
+
+	/* Let the streaming task handle errors, EOS and renegotiation. */
+	if (ret != GST_FLOW_OK) {
+		self->state->flowReturn_ = ret;
+		gst_task_resume(self->task);
+	}
+
+	if (more)
+		gst_task_resume(GST_PAD_TASK(srcpad));
+}
+
 /* Must be called with stream_lock held. */
 int GstLibcameraSrcState::queueRequest()
 {
+	if (maxQueuedRequests_) {
+		GLibLocker locker(&lock_);
+		if (queuedRequests_.size() >= maxQueuedRequests_)
+			return -ENOBUFS;
+	}
+
 	std::unique_ptr<Request> request = cam_->createRequest();
 	if (!request)
 		return -ENOMEM;
@@ -183,6 +270,16 @@ int GstLibcameraSrcState::queueRequest()
 	std::unique_ptr<RequestWrap> wrap =
 		std::make_unique<RequestWrap>(std::move(request));
 
+	/*
+	 * If downstream holds on to so many buffers that the camera is about
+	 * to run out of requests, grow the pools instead of dropping frames.
+	 */
+	bool starving;
+	{
+		GLibLocker locker(&lock_);
+		starving = queuedRequests_.size() < kStarvationQueuedRequests;
+	}
+
 	for (GstPad *srcpad : srcpads_) {
 		Stream *stream = gst_libcamera_pad_get_stream(srcpad);
 		GstLibcameraPool *pool = gst_libcamera_pad_get_pool(srcpad);
@@ -191,6 +288,9 @@ int GstLibcameraSrcState::queueRequest()
 
 		ret = gst_buffer_pool_acquire_buffer(GST_BUFFER_POOL(pool),
 						     &buffer, nullptr);
+		if (ret != GST_FLOW_OK && starving && gst_libcamera_pool_grow(pool))
+			ret = gst_buffer_pool_acquire_buffer(GST_BUFFER_POOL(pool),
+							     &buffer, nullptr);
 		if (ret != GST_FLOW_OK) {
 			/*
 			 * RequestWrap has ownership of the request, and we
@@ -202,6 +302,11 @@ int GstLibcameraSrcState::queueRequest()
 		wrap->attachBuffer(stream, buffer);
 	}
 
+	{
+		GLibLocker lock(GST_OBJECT(src_));
+		controls_.applyControls(wrap->request_.get());
+	}
+
 	GST_TRACE_OBJECT(src_, "Requesting buffers");
 	cam_->queueRequest(wrap->request_.get());
 
@@ -242,12 +347,24 @@ GstLibcameraSrcState::requestCompleted(Request *request)
 		/* \todo Need to expose which reference clock the timestamp relates to. */
 		GstClockTime sys_now = g_get_monotonic_time() * 1000;
 
-		/* Deduced from: sys_now - sys_base_time == gst_now - gst_base_time */
-		GstClockTime sys_base_time = sys_now - (gst_now - gst_base_time);
+		/*
+		 * Deduced from: sys_now - sys_base_time == gst_now - gst_base_time
+		 *
+		 * The offset between the clocks is shared by the members of a
+		 * sync group, for frames captured together to get the same PTS.
+		 */
+		GstClockTime clock_offset = syncGroup_
+					  ? syncGroup_->clockOffset(sys_now, gst_now)
+					  : sys_now - gst_now;
+		GstClockTime sys_base_time = clock_offset + gst_base_time;
 		wrap->pts_ = timestamp - sys_base_time;
 		wrap->latency_ = sys_now - timestamp;
 	}
 
+	const auto frameDuration = request->metadata().get(controls::FrameDuration);
+	if (frameDuration)
+		wrap->frameDuration_ = *frameDuration * GST_USECOND;
+
 	{
 		GLibLocker locker(&lock_);
 		completedRequests_.push(std::move(wrap));
@@ -256,7 +373,13 @@ GstLibcameraSrcState::requestCompleted(Request *request)
 	gst_task_resume(src_->task);
 }
 
-/* Must be called with stream_lock held. */
+/*
+ * Hand the buffers of one completed request to the pads. The buffers are
+ * pushed downstream by the task of each pad, so that a slow downstream element
+ * on one pad doesn't delay the other pads or the queuing of new requests.
+ *
+ * Must be called with stream_lock held.
+ */
 int GstLibcameraSrcState::processRequest()
 {
 	std::unique_ptr<RequestWrap> wrap;
@@ -277,8 +400,7 @@ int GstLibcameraSrcState::processRequest()
 	if (!wrap)
 		return -ENOBUFS;
 
-	GstFlowReturn ret = GST_FLOW_OK;
-	gst_flow_combiner_reset(src_->flow_combiner);
+	bool latencyChanged = false;
 
 	for (GstPad *srcpad : srcpads_) {
 		Stream *stream = gst_libcamera_pad_get_stream(srcpad);
@@ -288,7 +410,8 @@ int GstLibcameraSrcState::processRequest()
 
 		if (GST_CLOCK_TIME_IS_VALID(wrap->pts_)) {
 			GST_BUFFER_PTS(buffer) = wrap->pts_;
-			gst_libcamera_pad_set_latency(srcpad, wrap->latency_);
+			latencyChanged |= gst_libcamera_pad_set_latency(srcpad, wrap->latency_,
+									wrap->frameDuration_);
 		} else {
 			GST_BUFFER_PTS(buffer) = 0;
 		}
@@ -296,11 +419,30 @@ int GstLibcameraSrcState::processRequest()
 		GST_BUFFER_OFFSET(buffer) = fb->metadata().sequence;
 		GST_BUFFER_OFFSET_END(buffer) = fb->metadata().sequence;
 
-		ret = gst_pad_push(srcpad, buffer);
-		ret = gst_flow_combiner_update_pad_flow(src_->flow_combiner,
-							srcpad, ret);
+		GstCameraControls::addMeta(buffer, wrap->request_->metadata());
+
+		gst_libcamera_pad_queue_buffer(srcpad, buffer);
+		gst_pad_start_task(srcpad, gst_libcamera_src_pad_task_run,
+				   srcpad, nullptr);
 	}
 
+	if (latencyChanged)
+		gst_element_post_message(GST_ELEMENT(src_),
+					 gst_message_new_latency(GST_OBJECT(src_)));
+
+	return err;
+}
+
+/*
+ * Handle a flow return reported by the pad tasks. Returns -EPIPE if streaming
+ * has to stop.
+ *
+ * Must be called with stream_lock held.
+ */
+int GstLibcameraSrcState::processFlowReturn(GstFlowReturn ret)
+{
+	int err = 0;
+
 	switch (ret) {
 	case GST_FLOW_OK:
 		break;
@@ -325,8 +467,10 @@ int GstLibcameraSrcState::processRequest()
 		g_autoptr(GstEvent) eos = gst_event_new_eos();
 		guint32 seqnum = gst_util_seqnum_next();
 		gst_event_set_seqnum(eos, seqnum);
-		for (GstPad *srcpad : srcpads_)
+		for (GstPad *srcpad : srcpads_) {
+			gst_libcamera_pad_flush_buffers(srcpad);
 			gst_pad_push_event(srcpad, gst_event_ref(eos));
+		}
 
 		err = -EPIPE;
 		break;
@@ -370,10 +514,13 @@ gst_libcamera_src_open(GstLibcameraSrc *self)
 	}
 
 	g_autofree gchar *camera_name = nullptr;
+	g_autofree gchar *sync_group = nullptr;
 	{
 		GLibLocker lock(GST_OBJECT(self));
 		if (self->camera_name)
 			camera_name = g_strdup(self->camera_name);
+		if (self->sync_group)
+			sync_group = g_strdup(self->sync_group);
 	}
 
 	if (camera_name) {
@@ -406,13 +553,89 @@ gst_libcamera_src_open(GstLibcameraSrc *self)
 
 	cam->requestCompleted.connect(self->state, &GstLibcameraSrcState::requestCompleted);
 
+	{
+		GLibLocker lock(GST_OBJECT(self));
+		self->state->controls_.setCamera(cam);
+	}
+
 	/* No need to lock here, we didn't start our threads yet. */
 	self->state->cm_ = cm;
 	self->state->cam_ = cam;
 
+	if (sync_group) {
+		GST_INFO_OBJECT(self, "Joining sync group '%s'", sync_group);
+		self->state->syncGroup_ = GstCameraSyncGroup::get(sync_group);
+		self->state->syncGroup_->join();
+	}
+
 	return true;
 }
 
+/*
+ * Use the buffer pool proposed by downstream in the allocation query for a
+ * stream if its buffers are dmabufs with the layout libcamera produces. This
+ * avoids copies or imports downstream when linking to encoders or display
+ * sinks. Returns nullptr if the buffers should be allocated by libcamera
+ * instead.
+ *
+ * Must be called with stream_lock held.
+ */
+static GstLibcameraPool *
+gst_libcamera_src_import_pool(GstLibcameraSrc *self, GstQuery *query,
+			      const GstVideoInfo *info,
+			      const StreamConfiguration &stream_cfg)
+{
+	if (!gst_query_get_n_allocation_pools(query))
+		return nullptr;
+
+	GstBufferPool *downstream = nullptr;
+	guint size, min, max;
+	gst_query_parse_nth_allocation_pool(query, 0, &downstream, &size, &min, &max);
+	if (!downstream)
+		return nullptr;
+
+	guint count = std::max(stream_cfg.bufferCount, min);
+	if (max)
+		count = std::min(count, max);
+
+	GstCaps *caps;
+	gst_query_parse_allocation(query, &caps, nullptr);
+
+	GstStructure *config = gst_buffer_pool_get_config(downstream);
+	gst_buffer_pool_config_set_params(config, caps,
+					  std::max<guint>(size, GST_VIDEO_INFO_SIZE(info)),
+					  count, count);
+	if (gst_query_find_allocation_meta(query, GST_VIDEO_META_API_TYPE, nullptr) &&
+	    gst_buffer_pool_has_option(downstream, GST_BUFFER_POOL_OPTION_VIDEO_META))
+		gst_buffer_pool_config_add_option(config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+
+	if (!gst_buffer_pool_set_config(downstream, config) ||
+	    !gst_buffer_pool_set_active(downstream, TRUE)) {
+		GST_DEBUG_OBJECT(self, "Failed to configure downstream pool %" GST_PTR_FORMAT,
+				 downstream);
+		gst_object_unref(downstream);
+		return nullptr;
+	}
+
+	GstLibcameraPool *pool = gst_libcamera_pool_new_imported(downstream,
+								 stream_cfg.stream(),
+								 info, stream_cfg.stride,
+								 count);
+	if (!pool) {
+		GST_DEBUG_OBJECT(self, "Can't import buffers from downstream pool %" GST_PTR_FORMAT,
+				 downstream);
+		gst_buffer_pool_set_active(downstream, FALSE);
+		gst_object_unref(downstream);
+		return nullptr;
+	}
+
+	GST_INFO_OBJECT(self, "Importing %u buffers from downstream pool %" GST_PTR_FORMAT,
+			count, downstream);
+	gst_object_unref(downstream);
+
+	return pool;
+}
+
 /* Must be called with stream_lock held. */
 static bool
 gst_libcamera_src_negotiate(GstLibcameraSrc *self)
@@ -426,7 +649,8 @@ gst_libcamera_src_negotiate(GstLibcameraSrc *self)
 		StreamConfiguration &stream_cfg = state->config_->at(i);
 
 		/* Retrieve the supported caps. */
-		g_autoptr(GstCaps) filter = gst_libcamera_stream_formats_to_caps(stream_cfg.formats());
+		g_autoptr(GstCaps) filter = gst_libcamera_pad_get_formats_caps(srcpad,
+									       stream_cfg.formats());
 		g_autoptr(GstCaps) caps = gst_pad_peer_query_caps(srcpad, filter);
 		if (gst_caps_is_empty(caps))
 			return false;
@@ -471,20 +695,99 @@ gst_libcamera_src_negotiate(GstLibcameraSrc *self)
 	if (self->allocator)
 		g_clear_object(&self->allocator);
 
-	self->allocator = gst_libcamera_allocator_new(state->cam_, state->config_.get());
+	/*
+	 * Import the buffers from downstream where possible, and allocate them
+	 * with libcamera for the other streams.
+	 */
+	std::vector<GstLibcameraPool *> pools(state->srcpads_.size(), nullptr);
+	std::vector<GstVideoInfo> infos(state->srcpads_.size());
+	std::vector<bool> raw(state->srcpads_.size(), false);
+	std::vector<guint> downstream_min(state->srcpads_.size(), 0);
+	std::vector<guint> downstream_max(state->srcpads_.size(), 0);
+	std::vector<Stream *> allocated;
+
+	for (gsize i = 0; i < state->srcpads_.size(); i++) {
+		GstPad *srcpad = state->srcpads_[i];
+		const StreamConfiguration &stream_cfg = state->config_->at(i);
+
+		g_autoptr(GstCaps) caps = gst_pad_get_current_caps(srcpad);
+		g_autoptr(GstQuery) query = caps ? gst_query_new_allocation(caps, TRUE) : nullptr;
+		if (!query || !gst_pad_peer_query(srcpad, query)) {
+			allocated.push_back(stream_cfg.stream());
+			continue;
+		}
+
+		/* Size the pool for the buffers downstream holds on to. */
+		if (gst_query_get_n_allocation_pools(query))
+			gst_query_parse_nth_allocation_pool(query, 0, nullptr, nullptr,
+							    &downstream_min[i],
+							    &downstream_max[i]);
+
+		/* Only raw video has a layout that can be described to downstream. */
+		raw[i] = gst_video_info_from_caps(&infos[i], caps);
+		if (!raw[i]) {
+			allocated.push_back(stream_cfg.stream());
+			continue;
+		}
+
+		if (!gst_query_find_allocation_meta(query, GST_VIDEO_META_API_TYPE, nullptr) &&
+		    stream_cfg.stride != static_cast<guint>(GST_VIDEO_INFO_PLANE_STRIDE(&infos[i], 0)))
+			GST_WARNING_OBJECT(srcpad,
+					   "Downstream doesn't support GstVideoMeta, stride %u may not be honoured",
+					   stream_cfg.stride);
+
+		pools[i] = gst_libcamera_src_import_pool(self, query, &infos[i],
+							 stream_cfg);
+		if (!pools[i])
+			allocated.push_back(stream_cfg.stream());
+	}
+
+	self->allocator = gst_libcamera_allocator_new(state->cam_, allocated);
 	if (!self->allocator) {
+		for (GstLibcameraPool *pool : pools) {
+			if (pool)
+				g_object_unref(pool);
+		}
+
 		GST_ELEMENT_ERROR(self, RESOURCE, NO_SPACE_LEFT,
 				  ("Failed to allocate memory"),
 				  ("gst_libcamera_allocator_new() failed."));
 		return false;
 	}
 
+	guint min_buffers, max_buffers;
+	{
+		GLibLocker lock(GST_OBJECT(self));
+		min_buffers = self->min_buffers;
+		max_buffers = self->max_buffers;
+	}
+
 	for (gsize i = 0; i < state->srcpads_.size(); i++) {
 		GstPad *srcpad = state->srcpads_[i];
 		const StreamConfiguration &stream_cfg = state->config_->at(i);
 
-		GstLibcameraPool *pool = gst_libcamera_pool_new(self->allocator,
-								stream_cfg.stream());
+		GstLibcameraPool *pool = pools[i];
+		if (!pool) {
+			pool = gst_libcamera_pool_new(self->allocator,
+						      stream_cfg.stream(),
+						      raw[i] ? &infos[i] : nullptr);
+
+			gst_libcamera_pool_set_limits(pool, min_buffers,
+						      max_buffers ? max_buffers
+								  : downstream_max[i]);
+
+			/*
+			 * Start with enough buffers for the camera and for
+			 * downstream, the pool then adapts to starvation.
+			 */
+			guint target = std::max(stream_cfg.bufferCount + downstream_min[i],
+						min_buffers);
+			for (guint n = gst_libcamera_pool_get_size(pool); n < target; n++) {
+				if (!gst_libcamera_pool_grow(pool))
+					break;
+			}
+		}
+
 		g_signal_connect_swapped(pool, "buffer-notify",
 					 G_CALLBACK(gst_task_resume), self->task);
 
@@ -519,12 +822,20 @@ gst_libcamera_src_task_run(gpointer user_data)
 
 	g_autoptr(GstEvent) event = self->pending_eos.exchange(nullptr);
 	if (event) {
-		for (GstPad *srcpad : state->srcpads_)
+		for (GstPad *srcpad : state->srcpads_) {
+			gst_libcamera_pad_flush_buffers(srcpad);
 			gst_pad_push_event(srcpad, gst_event_ref(event));
+		}
 
 		return;
 	}
 
+	/* Handle the flow returns reported by the pad tasks. */
+	if (state->processFlowReturn(state->flowReturn_.exchange(GST_FLOW_OK))) {
+		gst_task_stop(self->task);
+		return;
+	}
+
 	/* Check if a srcpad requested a renegotiation. */
 	bool reconfigure = false;
 	for (GstPad *srcpad : state->srcpads_) {
@@ -542,6 +853,14 @@ gst_libcamera_src_task_run(gpointer user_data)
 		state->cam_->stop();
 		state->clearRequests();
 
+		for (GstPad *srcpad : state->srcpads_)
+			gst_libcamera_pad_flush_buffers(srcpad);
+
+		{
+			GLibLocker lock(GST_OBJECT(self));
+			gst_flow_combiner_reset(self->flow_combiner);
+		}
+
 		if (!gst_libcamera_src_negotiate(self)) {
 			GST_ELEMENT_FLOW_ERROR(self, GST_FLOW_NOT_NEGOTIATED);
 			gst_task_stop(self->task);
@@ -584,19 +903,9 @@ gst_libcamera_src_task_run(gpointer user_data)
 	 * requests are ready for processing.
 	 */
 	ret = state->processRequest();
-	switch (ret) {
-	case 0:
+	if (ret == 0) {
 		/* Another completed request is available, resume the task. */
 		doResume = true;
-		break;
-
-	case -EPIPE:
-		gst_task_stop(self->task);
-		return;
-
-	case -ENOBUFS:
-	default:
-		break;
 	}
 
 	/* Resume the task for another iteration if needed. */
@@ -647,8 +956,35 @@ gst_libcamera_src_task_enter(GstTask *task, [[maybe_unused]] GThread *thread,
 		return;
 	}
 
+	gboolean low_latency;
+	{
+		GLibLocker lock(GST_OBJECT(self));
+		low_latency = self->low_latency;
+	}
+
+	/*
+	 * In low-latency mode, only queue as many requests as the pipeline
+	 * needs to capture all frames, and only keep the most recent buffer
+	 * pending on the pads.
+	 */
+	state->maxQueuedRequests_ = 0;
+	if (low_latency) {
+		const ControlInfoMap &infoMap = state->cam_->controls();
+		auto depth = infoMap.find(&controls::draft::PipelineDepth);
+
+		state->maxQueuedRequests_ = depth != infoMap.end()
+					  ? depth->second.max().get<int32_t>()
+					  : kLowLatencyQueuedRequests;
+
+		GST_INFO_OBJECT(self, "Limiting queued requests to %u",
+				state->maxQueuedRequests_);
+	}
+
 	self->flow_combiner = gst_flow_combiner_new();
+	state->flowReturn_ = GST_FLOW_OK;
 	for (GstPad *srcpad : state->srcpads_) {
+		gst_libcamera_pad_set_max_pending(srcpad, low_latency ? 1 : 0);
+
 		gst_flow_combiner_add_pad(self->flow_combiner, srcpad);
 
 		/* Send an open segment event with time format. */
@@ -669,7 +1005,10 @@ gst_libcamera_src_task_enter(GstTask *task, [[maybe_unused]] GThread *thread,
 		}
 	}
 
-	ret = state->cam_->start(&state->initControls_);
+	if (state->syncGroup_)
+		ret = state->syncGroup_->start(state->cam_.get(), &state->initControls_);
+	else
+		ret = state->cam_->start(&state->initControls_);
 	if (ret) {
 		GST_ELEMENT_ERROR(self, RESOURCE, SETTINGS,
 				  ("Failed to start the camera: %s", g_strerror(-ret)),
@@ -694,8 +1033,12 @@ gst_libcamera_src_task_leave([[maybe_unused]] GstTask *task,
 
 	{
 		GLibRecLocker locker(&self->stream_lock);
-		for (GstPad *srcpad : state->srcpads_)
+		for (GstPad *srcpad : state->srcpads_) {
+			/* The pad tasks never take the stream_lock. */
+			gst_pad_stop_task(srcpad);
+			gst_libcamera_pad_flush_buffers(srcpad);
 			gst_libcamera_pad_set_pool(srcpad, nullptr);
+		}
 	}
 
 	g_clear_object(&self->allocator);
@@ -713,6 +1056,18 @@ gst_libcamera_src_close(GstLibcameraSrc *self)
 
 	state->config_.reset();
 
+	if (state->syncGroup_) {
+		state->syncGroup_->leave();
+		state->syncGroup_.reset();
+	}
+
+	/* The cached caps of the pads are specific to the camera. */
+	{
+		GLibRecLocker locker(&self->stream_lock);
+		for (GstPad *srcpad : state->srcpads_)
+			gst_libcamera_pad_clear_formats_caps(srcpad);
+	}
+
 	ret = state->cam_->release();
 	if (ret) {
 		GST_ELEMENT_WARNING(self, RESOURCE, BUSY,
@@ -739,19 +1094,60 @@ gst_libcamera_src_set_property(GObject *object, guint prop_id,
 	case PROP_AUTO_FOCUS_MODE:
 		self->auto_focus_mode = static_cast<controls::AfModeEnum>(g_value_get_enum(value));
 		break;
+	case PROP_LOW_LATENCY:
+		self->low_latency = g_value_get_boolean(value);
+		break;
+	case PROP_MIN_BUFFERS:
+		self->min_buffers = g_value_get_uint(value);
+		break;
+	case PROP_MAX_BUFFERS:
+		self->max_buffers = g_value_get_uint(value);
+		break;
+	case PROP_SYNC_GROUP:
+		g_free(self->sync_group);
+		self->sync_group = g_value_dup_string(value);
+		break;
 	default:
-		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+		if (!self->state->controls_.setProperty(prop_id - PROP_LAST, value, pspec))
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 		break;
 	}
 }
 
+/* Collect the statistics of the buffer pools of all pads. */
+static GstStructure *
+gst_libcamera_src_get_pool_stats(GstLibcameraSrc *self)
+{
+	GLibRecLocker lock(&self->stream_lock);
+	GstStructure *stats = gst_structure_new_empty("pool-stats");
+
+	for (GstPad *srcpad : self->state->srcpads_) {
+		GstLibcameraPool *pool = gst_libcamera_pad_get_pool(srcpad);
+		if (!pool)
+			continue;
+
+		g_autoptr(GstStructure) pool_stats = gst_libcamera_pool_get_stats(pool);
+		gst_structure_set(stats, GST_PAD_NAME(srcpad), GST_TYPE_STRUCTURE,
+				  pool_stats, nullptr);
+	}
+
+	return stats;
+}
+
 static void
 gst_libcamera_src_get_property(GObject *object, guint prop_id, GValue *value,
 			       GParamSpec *pspec)
 {
-	GLibLocker lock(GST_OBJECT(object));
 	GstLibcameraSrc *self = GST_LIBCAMERA_SRC(object);
 
+	/* The stream_lock must be taken before the object lock. */
+	if (prop_id == PROP_POOL_STATS) {
+		g_value_take_boxed(value, gst_libcamera_src_get_pool_stats(self));
+		return;
+	}
+
+	GLibLocker lock(GST_OBJECT(object));
+
 	switch (prop_id) {
 	case PROP_CAMERA_NAME:
 		g_value_set_string(value, self->camera_name);
@@ -759,8 +1155,21 @@ gst_libcamera_src_get_property(GObject *object, guint prop_id, GValue *value,
 	case PROP_AUTO_FOCUS_MODE:
 		g_value_set_enum(value, static_cast<gint>(self->auto_focus_mode));
 		break;
+	case PROP_LOW_LATENCY:
+		g_value_set_boolean(value, self->low_latency);
+		break;
+	case PROP_MIN_BUFFERS:
+		g_value_set_uint(value, self->min_buffers);
+		break;
+	case PROP_MAX_BUFFERS:
+		g_value_set_uint(value, self->max_buffers);
+		break;
+	case PROP_SYNC_GROUP:
+		g_value_set_string(value, self->sync_group);
+		break;
 	default:
-		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+		if (!self->state->controls_.getProperty(prop_id - PROP_LAST, value, pspec))
+			G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 		break;
 	}
 }
@@ -845,6 +1254,7 @@ gst_libcamera_src_finalize(GObject *object)
 	g_clear_object(&self->task);
 	g_mutex_clear(&self->state->lock_);
 	g_free(self->camera_name);
+	g_free(self->sync_group);
 	delete self->state;
 
 	return klass->finalize(object);
@@ -963,4 +1373,53 @@ gst_libcamera_src_class_init(GstLibcameraSrcClass *klass)
 				 static_cast<gint>(controls::AfModeManual),
 				 G_PARAM_WRITABLE);
 	g_object_class_install_property(object_class, PROP_AUTO_FOCUS_MODE, spec);
+
+	spec = g_param_spec_boolean("low-latency", "Low Latency",
+				    "Limit the queued requests and pending buffers "
+				    "to minimize the capture latency.", FALSE,
+				    (GParamFlags)(GST_PARAM_MUTABLE_READY
+						  | G_PARAM_READWRITE
+						  | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(object_class, PROP_LOW_LATENCY, spec);
+
+	spec = g_param_spec_uint("min-buffers", "Minimum Buffers",
+				 "Minimum number of buffers per stream the pool "
+				 "shrinks to when buffers are unused.",
+				 0, G_MAXUINT, 0,
+				 (GParamFlags)(GST_PARAM_MUTABLE_READY
+					       | G_PARAM_READWRITE
+					       | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(object_class, PROP_MIN_BUFFERS, spec);
+
+	spec = g_param_spec_uint("max-buffers", "Maximum Buffers",
+				 "Maximum number of buffers per stream the pool "
+				 "grows to when the camera starves (0 = the "
+				 "downstream maximum, or twice the initial number "
+				 "of buffers).",
+				 0, G_MAXUINT, 0,
+				 (GParamFlags)(GST_PARAM_MUTABLE_READY
+					       | G_PARAM_READWRITE
+					       | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(object_class, PROP_MAX_BUFFERS, spec);
+
+	spec = g_param_spec_boxed("pool-stats", "Pool Statistics",
+				  "Occupancy of the buffer pool of each pad, "
+				  "keyed by pad name.",
+				  GST_TYPE_STRUCTURE,
+				  (GParamFlags)(G_PARAM_READABLE
+						| G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(object_class, PROP_POOL_STATS, spec);
+
+	spec = g_param_spec_string("sync-group", "Sync Group",
+				   "Name of a group of elements in the same pipeline "
+				   "whose cameras are started together and whose "
+				   "buffers are timestamped with a shared clock mapping.",
+				   nullptr,
+				   (GParamFlags)(GST_PARAM_MUTABLE_READY
+						 | G_PARAM_READWRITE
+						 | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(object_class, PROP_SYNC_GROUP, spec);
+
+	GstCameraControls::installProperties(object_class, PROP_LAST);
+	GstCameraControls::registerMeta();
 }
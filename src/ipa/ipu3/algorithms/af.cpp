@@ -17,12 +17,18 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <linux/videodev2.h>
 
 #include <libcamera/base/log.h>
 
 #include <libcamera/ipa/core_ipa_interface.h>
 
+#include "libcamera/internal/yaml_parser.h"
+
 #include "libipa/histogram.h"
 
 /**
@@ -106,11 +112,33 @@ static struct ipu3_uapi_af_filter_config afFilterConfigDefault = {
  * blurred one. Therefore, if an image with the highest contrast can be
  * found through the scan, the position of the len indicates to a clearest
  * image.
+ *
+ * The statistics can optionally be processed on a worker thread to keep
+ * them off the critical path of the IPA, at the cost of one frame of latency.
+ * This is enabled by the 'async' tuning parameter.
  */
 Af::Af()
 	: focus_(0), bestFocus_(0), currentVariance_(0.0), previousVariance_(0.0),
-	  coarseCompleted_(false), fineCompleted_(false)
+	  coarseCompleted_(false), fineCompleted_(false), async_(false),
+	  asyncVariance_{ 0.0, 0.0 }
+{
+}
+
+Af::~Af()
 {
+	afWaitAsync();
+}
+
+/**
+ * \copydoc libcamera::ipa::Algorithm::init
+ */
+int Af::init([[maybe_unused]] IPAContext &context, const YamlObject &tuningData)
+{
+	async_ = tuningData["async"].get<bool>(false);
+	if (async_)
+		workers_ = std::make_unique<ipa::WorkerPool>(1);
+
+	return 0;
 }
 
 /**
@@ -178,6 +206,9 @@ int Af::configure(IPAContext &context, const IPAConfigInfo &configInfo)
 	/* The stable AF value flag. if it is true, the AF should be in a stable state. */
 	context.activeState.af.stable = false;
 
+	/* Drop the variance computed for the previous configuration. */
+	afWaitAsync();
+
 	return 0;
 }
 
@@ -359,21 +390,97 @@ void Af::afIgnoreFrameReset()
  */
 double Af::afEstimateVariance(Span<const y_table_item_t> y_items, bool isY1)
 {
-	uint32_t total = 0;
-	double mean;
-	double var_sum = 0;
+	uint64_t total = 0;
+	uint64_t squares = 0;
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	/*
+	 * Accumulate four items at a time. The Y1 value is stored in the low
+	 * half of each 32-bit item and the Y2 value in the high half.
+	 */
+	const __m128i mask = _mm_set1_epi32(0xffff);
+	__m128i sum32 = _mm_setzero_si128();
+	__m128i squares64 = _mm_setzero_si128();
+
+	for (; i + 4 <= y_items.size(); i += 4) {
+		__m128i items = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&y_items[i]));
+		__m128i y = isY1 ? _mm_and_si128(items, mask)
+				 : _mm_srli_epi32(items, 16);
+
+		sum32 = _mm_add_epi32(sum32, y);
+		squares64 = _mm_add_epi64(squares64, _mm_mul_epu32(y, y));
+		y = _mm_srli_epi64(y, 32);
+		squares64 = _mm_add_epi64(squares64, _mm_mul_epu32(y, y));
+	}
 
-	for (auto y : y_items)
-		total += isY1 ? y.y1_avg : y.y2_avg;
+	/* The grid has at most 768 cells, the 32-bit sums can't overflow. */
+	alignas(16) uint32_t sums[4];
+	alignas(16) uint64_t sumsSquares[2];
+	_mm_store_si128(reinterpret_cast<__m128i *>(sums), sum32);
+	_mm_store_si128(reinterpret_cast<__m128i *>(sumsSquares), squares64);
 
-	mean = total / y_items.size();
+	total = static_cast<uint64_t>(sums[0]) + sums[1] + sums[2] + sums[3];
+	squares = sumsSquares[0] + sumsSquares[1];
+#endif
 
-	for (auto y : y_items) {
-		double avg = isY1 ? y.y1_avg : y.y2_avg;
-		var_sum += pow(avg - mean, 2);
+	for (; i < y_items.size(); i++) {
+		uint64_t y = isY1 ? y_items[i].y1_avg : y_items[i].y2_avg;
+		total += y;
+		squares += y * y;
 	}
 
-	return var_sum / y_items.size();
+	/*
+	 * Compute the variance around the integer mean from the sums in a
+	 * single pass. All terms are integers below 2^53 and are thus
+	 * represented exactly.
+	 */
+	double count = y_items.size();
+	double mean = total / y_items.size();
+	double var_sum = squares - 2 * mean * total + count * mean * mean;
+
+	return var_sum / count;
+}
+
+/**
+ * \brief Estimate the variance on the worker thread
+ * \param[in] y_items The AF filter data set from the IPU3 statistics buffer
+ *
+ * Submit the statistics to the worker pool and retrieve the variance computed
+ * from the statistics of the previous frame, storing it in currentVariance_.
+ * Both the Y1 and Y2 variances are computed by the job, so that the one used
+ * is selected by the scan state at the time the result is consumed.
+ *
+ * \return True if a variance is available, false otherwise
+ */
+bool Af::afEstimateVarianceAsync(Span<const y_table_item_t> y_items)
+{
+	bool finished = asyncResult_.valid();
+	if (finished) {
+		asyncResult_.wait();
+		currentVariance_ = asyncVariance_[coarseCompleted_ ? 1 : 0];
+	}
+
+	/* asyncItems_ is not touched by process() until the job completes. */
+	asyncItems_.assign(y_items.begin(), y_items.end());
+	asyncResult_ = workers_->submit([this] {
+		asyncVariance_[0] = afEstimateVariance(asyncItems_, true);
+		asyncVariance_[1] = afEstimateVariance(asyncItems_, false);
+	});
+
+	return finished;
+}
+
+/**
+ * \brief Wait for the pending variance estimation and drop its result
+ */
+void Af::afWaitAsync()
+{
+	if (!asyncResult_.valid())
+		return;
+
+	asyncResult_.wait();
+	asyncResult_ = {};
 }
 
 /**
@@ -440,8 +547,16 @@ void Af::process(IPAContext &context, [[maybe_unused]] const uint32_t frame,
 	 * Calculate the mean and the variance of AF statistics for a given grid.
 	 * For coarse: y1 are used.
 	 * For fine: y2 results are used.
+	 *
+	 * In asynchronous mode, the variance of the previous frame is used,
+	 * and there's nothing to do until the first one is available.
 	 */
-	currentVariance_ = afEstimateVariance(y_items, !coarseCompleted_);
+	if (async_) {
+		if (!afEstimateVarianceAsync(y_items))
+			return;
+	} else {
+		currentVariance_ = afEstimateVariance(y_items, !coarseCompleted_);
+	}
 
 	if (!context.activeState.af.stable) {
 		afCoarseScan(context);
@@ -454,6 +569,16 @@ void Af::process(IPAContext &context, [[maybe_unused]] const uint32_t frame,
 	}
 }
 
+/**
+ * \copydoc libcamera::ipa::Algorithm::processAccess
+ *
+ * The auto-focus only updates its own state.
+ */
+std::optional<Af::StateAccess> Af::processAccess() const
+{
+	return StateAccess{ {}, { "af" } };
+}
+
 REGISTER_IPA_ALGORITHM(Af, "Af")
 
 } /* namespace ipa::ipu3::algorithms */
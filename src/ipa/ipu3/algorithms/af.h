@@ -7,12 +7,18 @@
 
 #pragma once
 
+#include <future>
+#include <memory>
+#include <vector>
+
 #include <linux/intel-ipu3.h>
 
 #include <libcamera/base/utils.h>
 
 #include <libcamera/geometry.h>
 
+#include "libipa/worker_pool.h"
+
 #include "algorithm.h"
 
 namespace libcamera {
@@ -28,8 +34,9 @@ class Af : public Algorithm
 	} y_table_item_t;
 public:
 	Af();
-	~Af() = default;
+	~Af();
 
+	int init(IPAContext &context, const YamlObject &tuningData) override;
 	int configure(IPAContext &context, const IPAConfigInfo &configInfo) override;
 	void prepare(IPAContext &context, const uint32_t frame,
 		     IPAFrameContext &frameContext,
@@ -38,6 +45,7 @@ public:
 		     IPAFrameContext &frameContext,
 		     const ipu3_uapi_stats_3a *stats,
 		     ControlList &metadata) override;
+	std::optional<StateAccess> processAccess() const override;
 
 private:
 	void afCoarseScan(IPAContext &context);
@@ -46,7 +54,9 @@ private:
 	void afReset(IPAContext &context);
 	bool afNeedIgnoreFrame();
 	void afIgnoreFrameReset();
-	double afEstimateVariance(Span<const y_table_item_t> y_items, bool isY1);
+	static double afEstimateVariance(Span<const y_table_item_t> y_items, bool isY1);
+	bool afEstimateVarianceAsync(Span<const y_table_item_t> y_items);
+	void afWaitAsync();
 
 	bool afIsOutOfFocus(IPAContext &context);
 
@@ -66,6 +76,13 @@ private:
 	bool coarseCompleted_;
 	/* If the fine scan completes, it is set to true. */
 	bool fineCompleted_;
+
+	/* Estimate the variance on a worker thread, one frame late. */
+	bool async_;
+	std::unique_ptr<ipa::WorkerPool> workers_;
+	std::future<void> asyncResult_;
+	std::vector<y_table_item_t> asyncItems_;
+	double asyncVariance_[2];
 };
 
 } /* namespace ipa::ipu3::algorithms */
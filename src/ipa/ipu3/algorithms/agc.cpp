@@ -113,7 +113,7 @@ int Agc::configure(IPAContext &context,
  * \return The mean value of the top 2% of the histogram
  */
 double Agc::measureBrightness(const ipu3_uapi_stats_3a *stats,
-			      const ipu3_uapi_grid_config &grid) const
+			      const ipu3_uapi_grid_config &grid)
 {
 	/* Initialise the histogram array */
 	uint32_t hist[knumHistogramBins] = { 0 };
@@ -139,7 +139,8 @@ double Agc::measureBrightness(const ipu3_uapi_stats_3a *stats,
 	}
 
 	/* Estimate the quantile mean of the top 2% of the histogram. */
-	return Histogram(Span<uint32_t>(hist)).interQuantileMean(0.98, 1.0);
+	histogram_.update(hist);
+	return histogram_.interQuantileMean(0.98, 1.0);
 }
 
 /**
@@ -380,6 +381,17 @@ void Agc::process(IPAContext &context, [[maybe_unused]] const uint32_t frame,
 
 }
 
+/**
+ * \copydoc libcamera::ipa::Algorithm::processAccess
+ *
+ * The AGC reads the sensor settings of the frame and the AWB gains, and only
+ * updates its own state.
+ */
+std::optional<Agc::StateAccess> Agc::processAccess() const
+{
+	return StateAccess{ { "sensor", "awb" }, { "agc" } };
+}
+
 REGISTER_IPA_ALGORITHM(Agc, "Agc")
 
 } /* namespace ipa::ipu3::algorithms */
@@ -13,6 +13,8 @@
 
 #include <libcamera/geometry.h>
 
+#include "libipa/histogram.h"
+
 #include "algorithm.h"
 
 namespace libcamera {
@@ -32,10 +34,11 @@ public:
 		     IPAFrameContext &frameContext,
 		     const ipu3_uapi_stats_3a *stats,
 		     ControlList &metadata) override;
+	std::optional<StateAccess> processAccess() const override;
 
 private:
 	double measureBrightness(const ipu3_uapi_stats_3a *stats,
-				 const ipu3_uapi_grid_config &grid) const;
+				 const ipu3_uapi_grid_config &grid);
 	utils::Duration filterExposure(utils::Duration currentExposure);
 	void computeExposure(IPAContext &context, IPAFrameContext &frameContext,
 			     double yGain, double iqMeanGain);
@@ -55,6 +58,8 @@ private:
 	utils::Duration filteredExposure_;
 
 	uint32_t stride_;
+
+	Histogram histogram_;
 };
 
 } /* namespace ipa::ipu3::algorithms */
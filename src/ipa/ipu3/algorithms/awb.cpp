@@ -9,6 +9,12 @@
 #include <algorithm>
 #include <cmath>
 
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <libcamera/base/log.h>
 
 #include <libcamera/control_ids.h>
@@ -44,32 +50,157 @@ static constexpr double kMaxCellSaturationRatio = 0.8;
  */
 static constexpr uint32_t kMinCellsPerZoneRatio = 255 * 90 / 100;
 
+namespace {
+
+struct CellSums {
+	uint32_t green;
+	uint32_t red;
+	uint32_t blue;
+	uint32_t counted;
+};
+
+/*
+ * Accumulate the averages of the non-saturated cells in a horizontal run of
+ * \a count cells. The green value of a cell is the average of its Gr and Gb
+ * values. Sums are accumulated on 16 bits, \a count must thus be lower than
+ * 256.
+ *
+ * The SIMD implementations expand each 8 bytes cell to 16-bit lanes, and
+ * accumulate the green, red and blue values and the cell count in lanes 0 to 3,
+ * masked by the cell saturation ratio.
+ */
+CellSums accumulateCells(const ipu3_uapi_awb_set_item *cells, unsigned int count)
+{
+	static_assert(sizeof(ipu3_uapi_awb_set_item) == 8);
+
+	unsigned int i = 0;
+
+#if defined(__ARM_NEON)
+	static const uint16_t greenLane[8] = { 0xffff, 0, 0, 0, 0, 0, 0, 0 };
+	static const uint16_t redBlueLanes[8] = { 0, 0xffff, 0xffff, 0, 0, 0, 0, 0 };
+	static const uint16_t countLane[8] = { 0, 0, 0, 1, 0, 0, 0, 0 };
+
+	const uint16x8_t greenMask = vld1q_u16(greenLane);
+	const uint16x8_t redBlueMask = vld1q_u16(redBlueLanes);
+	const uint16x8_t one = vld1q_u16(countLane);
+	const uint16x8_t limit = vdupq_n_u16(kMinCellsPerZoneRatio);
+	uint16x8_t acc = vdupq_n_u16(0);
+
+	/* Lanes 0 to 7 contain Gr, R, B, Gb, sat_ratio and padding. */
+	auto accumulate = [&](uint16x8_t cell) {
+		uint16x8_t valid = vcleq_u16(cell, limit);
+		valid = vdupq_lane_u16(vget_high_u16(valid), 0);
+
+		uint16x8_t green = vshrq_n_u16(vaddq_u16(cell, vextq_u16(cell, cell, 3)), 1);
+		uint16x8_t value = vbslq_u16(greenMask, green, vandq_u16(cell, redBlueMask));
+		value = vorrq_u16(value, one);
+
+		acc = vaddq_u16(acc, vandq_u16(value, valid));
+	};
+
+	for (; i + 2 <= count; i += 2) {
+		uint8x16_t data = vld1q_u8(reinterpret_cast<const uint8_t *>(&cells[i]));
+		accumulate(vmovl_u8(vget_low_u8(data)));
+		accumulate(vmovl_u8(vget_high_u8(data)));
+	}
+
+	if (i < count) {
+		accumulate(vmovl_u8(vld1_u8(reinterpret_cast<const uint8_t *>(&cells[i]))));
+		i++;
+	}
+
+	return {
+		vgetq_lane_u16(acc, 0),
+		vgetq_lane_u16(acc, 1),
+		vgetq_lane_u16(acc, 2),
+		vgetq_lane_u16(acc, 3),
+	};
+#elif defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i greenMask = _mm_set_epi16(0, 0, 0, 0, 0, 0, 0, -1);
+	const __m128i redBlueMask = _mm_set_epi16(0, 0, 0, 0, 0, -1, -1, 0);
+	const __m128i one = _mm_set_epi16(0, 0, 0, 0, 1, 0, 0, 0);
+	const __m128i limit = _mm_set1_epi16(kMinCellsPerZoneRatio + 1);
+	__m128i acc = zero;
+
+	/* Lanes 0 to 7 contain Gr, R, B, Gb, sat_ratio and padding. */
+	auto accumulate = [&](__m128i cell) {
+		__m128i valid = _mm_cmplt_epi16(cell, limit);
+		valid = _mm_shufflehi_epi16(valid, _MM_SHUFFLE(0, 0, 0, 0));
+		valid = _mm_unpackhi_epi64(valid, valid);
+
+		__m128i green = _mm_srli_epi16(_mm_add_epi16(cell, _mm_srli_epi64(cell, 48)), 1);
+		__m128i value = _mm_or_si128(_mm_and_si128(green, greenMask),
+					     _mm_and_si128(cell, redBlueMask));
+		value = _mm_or_si128(value, one);
+
+		acc = _mm_add_epi16(acc, _mm_and_si128(value, valid));
+	};
+
+	for (; i + 2 <= count; i += 2) {
+		__m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&cells[i]));
+		accumulate(_mm_unpacklo_epi8(data, zero));
+		accumulate(_mm_unpackhi_epi8(data, zero));
+	}
+
+	if (i < count) {
+		__m128i data = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(&cells[i]));
+		accumulate(_mm_unpacklo_epi8(data, zero));
+		i++;
+	}
+
+	return {
+		static_cast<uint16_t>(_mm_extract_epi16(acc, 0)),
+		static_cast<uint16_t>(_mm_extract_epi16(acc, 1)),
+		static_cast<uint16_t>(_mm_extract_epi16(acc, 2)),
+		static_cast<uint16_t>(_mm_extract_epi16(acc, 3)),
+	};
+#else
+	CellSums sums = {};
+
+	for (; i < count; i++) {
+		const ipu3_uapi_awb_set_item &cell = cells[i];
+
+		if (cell.sat_ratio > kMinCellsPerZoneRatio)
+			continue;
+
+		sums.green += (cell.Gr_avg + cell.Gb_avg) / 2;
+		sums.red += cell.R_avg;
+		sums.blue += cell.B_avg;
+		sums.counted++;
+	}
+
+	return sums;
+#endif
+}
+
+} /* namespace */
+
 /**
- * \struct Accumulator
- * \brief RGB statistics for a given zone
+ * \struct AwbZoneStats
+ * \brief RGB statistics for all zones
  *
- * Accumulate red, green and blue values for each non-saturated item over a
- * zone. Items can for instance be pixels, but also the average of groups of
- * pixels, depending on who uses the accumulator.
- * \todo move this description and structure into a common header
+ * Accumulate red, green and blue values for each non-saturated cell over each
+ * zone. The statistics are stored as one array per component, indexed by zone,
+ * to allow the accumulation to be vectorized.
  *
- * Zones which are saturated beyond the threshold defined in
+ * Cells which are saturated beyond the threshold defined in
  * ipu3_uapi_awb_config_s are not included in the average.
  *
- * \var Accumulator::counted
- * \brief Number of unsaturated cells used to calculate the sums
+ * \var AwbZoneStats::kNumZones
+ * \brief Number of zones
  *
- * \var Accumulator::sum
- * \brief A structure containing the average red, green and blue sums
+ * \var AwbZoneStats::counted
+ * \brief Number of unsaturated cells used to calculate the sums, per zone
  *
- * \var Accumulator::sum.red
- * \brief Sum of the average red values of each unsaturated cell in the zone
+ * \var AwbZoneStats::red
+ * \brief Sum of the average red values of each unsaturated cell, per zone
  *
- * \var Accumulator::sum.green
- * \brief Sum of the average green values of each unsaturated cell in the zone
+ * \var AwbZoneStats::green
+ * \brief Sum of the average green values of each unsaturated cell, per zone
  *
- * \var Accumulator::sum.blue
- * \brief Sum of the average blue values of each unsaturated cell in the zone
+ * \var AwbZoneStats::blue
+ * \brief Sum of the average blue values of each unsaturated cell, per zone
  */
 
 /**
@@ -336,14 +467,14 @@ void Awb::generateZones()
 {
 	zones_.clear();
 
-	for (unsigned int i = 0; i < kAwbStatsSizeX * kAwbStatsSizeY; i++) {
+	for (unsigned int i = 0; i < AwbZoneStats::kNumZones; i++) {
 		RGB zone;
-		double counted = awbStats_[i].counted;
+		double counted = awbStats_.counted[i];
 		if (counted >= cellsPerZoneThreshold_) {
-			zone.G = awbStats_[i].sum.green / counted;
+			zone.G = awbStats_.green[i] / counted;
 			if (zone.G >= kMinGreenLevelInZone) {
-				zone.R = awbStats_[i].sum.red / counted;
-				zone.B = awbStats_[i].sum.blue / counted;
+				zone.R = awbStats_.red[i] / counted;
+				zone.B = awbStats_.blue[i] / counted;
 				zones_.push_back(zone);
 			}
 		}
@@ -353,54 +484,43 @@ void Awb::generateZones()
 /* Translate the IPU3 statistics into the default statistics zone array */
 void Awb::generateAwbStats(const ipu3_uapi_stats_3a *stats)
 {
+	const ipu3_uapi_awb_set_item *cells = stats->awb_raw_buffer.meta_data;
+
 	/*
 	 * Generate a (kAwbStatsSizeX x kAwbStatsSizeY) array from the IPU3 grid which is
 	 * (grid.width x grid.height).
+	 *
+	 * Use cells which have less than 90% saturation as an initial means to
+	 * include otherwise bright cells which are not fully saturated. The
+	 * cells of each line are accumulated one zone at a time.
+	 *
+	 * \todo The 90% saturation rate may require further empirical
+	 * measurements and optimisation during camera tuning phases.
 	 */
 	for (unsigned int cellY = 0; cellY < kAwbStatsSizeY * cellsPerZoneY_; cellY++) {
-		for (unsigned int cellX = 0; cellX < kAwbStatsSizeX * cellsPerZoneX_; cellX++) {
-			uint32_t cellPosition = cellY * stride_ + cellX;
-			uint32_t zoneX = cellX / cellsPerZoneX_;
-			uint32_t zoneY = cellY / cellsPerZoneY_;
+		const ipu3_uapi_awb_set_item *line = cells + cellY * stride_;
+		uint32_t zoneY = cellY / cellsPerZoneY_;
 
+		for (unsigned int zoneX = 0; zoneX < kAwbStatsSizeX; zoneX++) {
 			uint32_t awbZonePosition = zoneY * kAwbStatsSizeX + zoneX;
 
-			/* Cast the initial IPU3 structure to simplify the reading */
-			const ipu3_uapi_awb_set_item *currentCell =
-				reinterpret_cast<const ipu3_uapi_awb_set_item *>(
-					&stats->awb_raw_buffer.meta_data[cellPosition]
-				);
-
-			/*
-			 * Use cells which have less than 90%
-			 * saturation as an initial means to include
-			 * otherwise bright cells which are not fully
-			 * saturated.
-			 *
-			 * \todo The 90% saturation rate may require
-			 * further empirical measurements and
-			 * optimisation during camera tuning phases.
-			 */
-			if (currentCell->sat_ratio <= kMinCellsPerZoneRatio) {
-				/* The cell is not saturated, use the current cell */
-				awbStats_[awbZonePosition].counted++;
-				uint32_t greenValue = currentCell->Gr_avg + currentCell->Gb_avg;
-				awbStats_[awbZonePosition].sum.green += greenValue / 2;
-				awbStats_[awbZonePosition].sum.red += currentCell->R_avg;
-				awbStats_[awbZonePosition].sum.blue += currentCell->B_avg;
-			}
+			CellSums sums = accumulateCells(line + zoneX * cellsPerZoneX_,
+							cellsPerZoneX_);
+
+			awbStats_.counted[awbZonePosition] += sums.counted;
+			awbStats_.green[awbZonePosition] += sums.green;
+			awbStats_.red[awbZonePosition] += sums.red;
+			awbStats_.blue[awbZonePosition] += sums.blue;
 		}
 	}
 }
 
 void Awb::clearAwbStats()
 {
-	for (unsigned int i = 0; i < kAwbStatsSizeX * kAwbStatsSizeY; i++) {
-		awbStats_[i].sum.blue = 0;
-		awbStats_[i].sum.red = 0;
-		awbStats_[i].sum.green = 0;
-		awbStats_[i].counted = 0;
-	}
+	awbStats_.counted.fill(0);
+	awbStats_.red.fill(0);
+	awbStats_.green.fill(0);
+	awbStats_.blue.fill(0);
 }
 
 void Awb::awbGreyWorld()
@@ -498,6 +618,16 @@ void Awb::process(IPAContext &context, [[maybe_unused]] const uint32_t frame,
 		     context.activeState.awb.temperatureK);
 }
 
+/**
+ * \copydoc libcamera::ipa::Algorithm::processAccess
+ *
+ * The AWB only updates its own state.
+ */
+std::optional<Awb::StateAccess> Awb::processAccess() const
+{
+	return StateAccess{ {}, { "awb" } };
+}
+
 REGISTER_IPA_ALGORITHM(Awb, "Awb")
 
 } /* namespace ipa::ipu3::algorithms */
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <array>
 #include <vector>
 
 #include <linux/intel-ipu3.h>
@@ -23,13 +24,13 @@ namespace ipa::ipu3::algorithms {
 static constexpr uint32_t kAwbStatsSizeX = 16;
 static constexpr uint32_t kAwbStatsSizeY = 12;
 
-struct Accumulator {
-	unsigned int counted;
-	struct {
-		uint64_t red;
-		uint64_t green;
-		uint64_t blue;
-	} sum;
+struct AwbZoneStats {
+	static constexpr unsigned int kNumZones = kAwbStatsSizeX * kAwbStatsSizeY;
+
+	std::array<uint32_t, kNumZones> counted;
+	std::array<uint32_t, kNumZones> red;
+	std::array<uint32_t, kNumZones> green;
+	std::array<uint32_t, kNumZones> blue;
 };
 
 class Awb : public Algorithm
@@ -46,6 +47,7 @@ public:
 		     IPAFrameContext &frameContext,
 		     const ipu3_uapi_stats_3a *stats,
 		     ControlList &metadata) override;
+	std::optional<StateAccess> processAccess() const override;
 
 private:
 	/* \todo Make these structs available to all the ISPs ? */
@@ -80,7 +82,7 @@ private:
 	static constexpr uint16_t gainValue(double gain);
 
 	std::vector<RGB> zones_;
-	Accumulator awbStats_[kAwbStatsSizeX * kAwbStatsSizeY];
+	AwbZoneStats awbStats_;
 	AwbStatus asyncResults_;
 
 	uint32_t stride_;
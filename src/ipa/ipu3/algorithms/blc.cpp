@@ -66,6 +66,16 @@ void BlackLevelCorrection::prepare([[maybe_unused]] IPAContext &context,
 	params->use.obgrid_param = 1;
 }
 
+/**
+ * \copydoc libcamera::ipa::Algorithm::processAccess
+ *
+ * The black level correction doesn't process statistics.
+ */
+std::optional<BlackLevelCorrection::StateAccess> BlackLevelCorrection::processAccess() const
+{
+	return StateAccess{ {}, {} };
+}
+
 REGISTER_IPA_ALGORITHM(BlackLevelCorrection, "BlackLevelCorrection")
 
 } /* namespace ipa::ipu3::algorithms */
@@ -21,6 +21,7 @@ public:
 	void prepare(IPAContext &context, const uint32_t frame,
 		     IPAFrameContext &frameContext,
 		     ipu3_uapi_params *params) override;
+	std::optional<StateAccess> processAccess() const override;
 };
 
 } /* namespace ipa::ipu3::algorithms */
@@ -113,6 +113,16 @@ void ToneMapping::process(IPAContext &context, [[maybe_unused]] const uint32_t f
 	context.activeState.toneMapping.gamma = gamma_;
 }
 
+/**
+ * \copydoc libcamera::ipa::Algorithm::processAccess
+ *
+ * The tone mapping only updates its own state.
+ */
+std::optional<ToneMapping::StateAccess> ToneMapping::processAccess() const
+{
+	return StateAccess{ {}, { "toneMapping" } };
+}
+
 REGISTER_IPA_ALGORITHM(ToneMapping, "ToneMapping")
 
 } /* namespace ipa::ipu3::algorithms */
@@ -25,6 +25,7 @@ public:
 		     IPAFrameContext &frameContext,
 		     const ipu3_uapi_stats_3a *stats,
 		     ControlList &metadata) override;
+	std::optional<StateAccess> processAccess() const override;
 
 private:
 	double gamma_;
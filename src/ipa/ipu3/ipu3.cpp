@@ -12,6 +12,7 @@
 #include <map>
 #include <memory>
 #include <stdint.h>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -186,10 +187,13 @@ private:
 
 	/* Local parameter storage */
 	struct IPAContext context_;
+
+	/* Per-frame metadata, reused for every frame */
+	ControlList metadata_;
 };
 
 IPAIPU3::IPAIPU3()
-	: context_({ {}, {}, { kMaxFrameContexts } })
+	: context_({ {}, {}, { kMaxFrameContexts } }), metadata_(controls::controls)
 {
 }
 
@@ -346,6 +350,8 @@ int IPAIPU3::init(const IPASettings &settings,
 	if (ret)
 		return ret;
 
+	enableConcurrency(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+
 	/* Initialize controls. */
 	updateControls(sensorInfo, sensorControls, ipaControls);
 
@@ -600,10 +606,13 @@ void IPAIPU3::processStatsBuffer(const uint32_t frame,
 	frameContext.sensor.exposure = sensorControls.get(V4L2_CID_EXPOSURE).get<int32_t>();
 	frameContext.sensor.gain = camHelper_->gain(sensorControls.get(V4L2_CID_ANALOGUE_GAIN).get<int32_t>());
 
-	ControlList metadata(controls::controls);
+	/*
+	 * Reuse the metadata list across frames, clearing it keeps its storage
+	 * allocated.
+	 */
+	metadata_.clear();
 
-	for (auto const &algo : algorithms())
-		algo->process(context_, frame, frameContext, stats, metadata);
+	process(context_, frame, frameContext, stats, metadata_);
 
 	setControls(frame);
 
@@ -615,7 +624,7 @@ void IPAIPU3::processStatsBuffer(const uint32_t frame,
 	 * likely want to avoid putting platform specific metadata in.
 	 */
 
-	metadataReady.emit(frame, metadata);
+	metadataReady.emit(frame, metadata_);
 }
 
 /**
@@ -133,6 +133,36 @@ namespace ipa {
  * such that the algorithms use up to date state as required.
  */
 
+/**
+ * \struct Algorithm::StateAccess
+ * \brief The IPA state accessed by an algorithm
+ *
+ * The state is identified by names chosen by the IPA module, typically the
+ * names of the members of the IPA context and frame context, such as "agc" or
+ * "awb".
+ *
+ * \var Algorithm::StateAccess::reads
+ * \brief The state read by the algorithm
+ *
+ * \var Algorithm::StateAccess::writes
+ * \brief The state written by the algorithm
+ */
+
+/**
+ * \fn Algorithm::processAccess()
+ * \brief Declare the IPA state accessed by process()
+ *
+ * Algorithms that declare the state their process() function reads and writes
+ * can be run concurrently with the algorithms next to them in the list, when
+ * neither writes state that the other reads or writes. Such algorithms must not
+ * set the same metadata controls, and must only write to the members of the
+ * IPA context and frame context that they declare. Algorithms that don't
+ * declare their state access, which is the default, are always run on their
+ * own.
+ *
+ * \return The state accessed by process(), or std::nullopt if unknown
+ */
+
 /**
  * \class AlgorithmFactory
  * \brief Registration of Algorithm classes and creation of instances
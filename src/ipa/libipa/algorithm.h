@@ -7,8 +7,10 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 #include <libcamera/controls.h>
 
@@ -24,6 +26,11 @@ class Algorithm
 public:
 	using Module = _Module;
 
+	struct StateAccess {
+		std::vector<std::string> reads;
+		std::vector<std::string> writes;
+	};
+
 	virtual ~Algorithm() {}
 
 	virtual int init([[maybe_unused]] typename Module::Context &context,
@@ -59,6 +66,11 @@ public:
 			     [[maybe_unused]] ControlList &metadata)
 	{
 	}
+
+	virtual std::optional<StateAccess> processAccess() const
+	{
+		return std::nullopt;
+	}
 };
 
 template<typename _Module>
@@ -58,24 +58,18 @@ namespace ipa {
  */
 uint32_t CameraSensorHelper::gainCode(double gain) const
 {
-	const AnalogueGainConstants &k = gainConstants_;
-
-	switch (gainType_) {
-	case AnalogueGainLinear:
-		ASSERT(k.linear.m0 == 0 || k.linear.m1 == 0);
-
-		return (k.linear.c0 - k.linear.c1 * gain) /
-		       (k.linear.m1 * gain - k.linear.m0);
-
-	case AnalogueGainExponential:
-		ASSERT(k.exp.a != 0 && k.exp.m != 0);
-
-		return std::log2(gain / k.exp.a) / k.exp.m;
+	if (const auto *model = std::get_if<AnalogueGainLinear>(&gain_)) {
+		validate(*model);
+		return model->gainCode(gain);
+	}
 
-	default:
-		ASSERT(false);
-		return 0;
+	if (const auto *model = std::get_if<AnalogueGainExp>(&gain_)) {
+		validate(*model);
+		return model->gainCode(gain);
 	}
+
+	ASSERT(false);
+	return 0;
 }
 
 /**
@@ -90,38 +84,99 @@ uint32_t CameraSensorHelper::gainCode(double gain) const
  */
 double CameraSensorHelper::gain(uint32_t gainCode) const
 {
-	const AnalogueGainConstants &k = gainConstants_;
-	double gain = static_cast<double>(gainCode);
+	if (const auto *model = std::get_if<AnalogueGainLinear>(&gain_)) {
+		validate(*model);
+		return model->gain(gainCode);
+	}
+
+	if (const auto *model = std::get_if<AnalogueGainExp>(&gain_)) {
+		validate(*model);
+		return model->gain(gainCode);
+	}
 
-	switch (gainType_) {
-	case AnalogueGainLinear:
-		ASSERT(k.linear.m0 == 0 || k.linear.m1 == 0);
+	ASSERT(false);
+	return 0.0;
+}
+
+/**
+ * \brief Compute gain codes for multiple analogue gain absolute values
+ * \param[in] gains The real gains
+ * \param[out] gainCodes The gain codes to pass to V4L2
+ *
+ * This function is equivalent to calling gainCode() for each element of
+ * \a gains, but resolves the gain model once for all values, allowing the
+ * conversion loop to be inlined. It is meant for algorithms that evaluate
+ * multiple candidate gains, such as when searching for the best
+ * exposure and gain split.
+ *
+ * The \a gains and \a gainCodes spans shall have the same size.
+ */
+void CameraSensorHelper::gainCodes(Span<const double> gains,
+				   Span<uint32_t> gainCodes) const
+{
+	ASSERT(gains.size() == gainCodes.size());
 
-		return (k.linear.m0 * gain + k.linear.c0) /
-		       (k.linear.m1 * gain + k.linear.c1);
+	auto convert = [&](const auto &model) {
+		validate(model);
+		for (size_t i = 0; i < gains.size(); ++i)
+			gainCodes[i] = model.gainCode(gains[i]);
+	};
 
-	case AnalogueGainExponential:
-		ASSERT(k.exp.a != 0 && k.exp.m != 0);
+	if (const auto *model = std::get_if<AnalogueGainLinear>(&gain_))
+		return convert(*model);
 
-		return k.exp.a * std::exp2(k.exp.m * gain);
+	if (const auto *model = std::get_if<AnalogueGainExp>(&gain_))
+		return convert(*model);
 
-	default:
-		ASSERT(false);
-		return 0.0;
-	}
+	/* Helpers that implement custom conversions override gainCode(). */
+	for (size_t i = 0; i < gains.size(); ++i)
+		gainCodes[i] = gainCode(gains[i]);
 }
 
 /**
- * \enum CameraSensorHelper::AnalogueGainType
- * \brief The gain calculation modes as defined by the MIPI CCS
+ * \brief Compute the real gains for multiple V4L2 subdev control gain codes
+ * \param[in] gainCodes The V4L2 subdev control gains
+ * \param[out] gains The real gains
+ *
+ * This function is the counterpart of gainCodes(), and is equivalent to
+ * calling gain() for each element of \a gainCodes.
  *
- * Describes the image sensor analogue gain capabilities.
- * Two modes are possible, depending on the sensor: Linear and Exponential.
+ * The \a gainCodes and \a gains spans shall have the same size.
  */
+void CameraSensorHelper::gains(Span<const uint32_t> gainCodes,
+			       Span<double> gains) const
+{
+	ASSERT(gains.size() == gainCodes.size());
+
+	auto convert = [&](const auto &model) {
+		validate(model);
+		for (size_t i = 0; i < gainCodes.size(); ++i)
+			gains[i] = model.gain(gainCodes[i]);
+	};
+
+	if (const auto *model = std::get_if<AnalogueGainLinear>(&gain_))
+		return convert(*model);
+
+	if (const auto *model = std::get_if<AnalogueGainExp>(&gain_))
+		return convert(*model);
+
+	for (size_t i = 0; i < gainCodes.size(); ++i)
+		gains[i] = gain(gainCodes[i]);
+}
+
+void CameraSensorHelper::validate(const AnalogueGainLinear &model)
+{
+	ASSERT(model.m0 == 0 || model.m1 == 0);
+}
+
+void CameraSensorHelper::validate(const AnalogueGainExp &model)
+{
+	ASSERT(model.a != 0 && model.m != 0);
+}
 
 /**
- * \var CameraSensorHelper::AnalogueGainLinear
- * \brief Gain is computed using linear gain estimation
+ * \struct CameraSensorHelper::AnalogueGainLinear
+ * \brief Analogue gain constants for the linear gain model
  *
  * The relationship between the integer gain parameter and the resulting gain
  * multiplier is given by the following equation:
@@ -136,11 +191,41 @@ double CameraSensorHelper::gain(uint32_t gainCode) const
  * The full Gain equation therefore reduces to either:
  *
  * \f$gain=\frac{c0}{m1x+c1}\f$ or \f$\frac{m0x+c0}{c1}\f$
+ *
+ * \var CameraSensorHelper::AnalogueGainLinear::m0
+ * \brief Constant used in the linear gain coding/decoding
+ *
+ * \note Either m0 or m1 shall be zero.
+ *
+ * \var CameraSensorHelper::AnalogueGainLinear::c0
+ * \brief Constant used in the linear gain coding/decoding
+ *
+ * \var CameraSensorHelper::AnalogueGainLinear::m1
+ * \brief Constant used in the linear gain coding/decoding
+ *
+ * \note Either m0 or m1 shall be zero.
+ *
+ * \var CameraSensorHelper::AnalogueGainLinear::c1
+ * \brief Constant used in the linear gain coding/decoding
+ */
+
+/**
+ * \fn CameraSensorHelper::AnalogueGainLinear::gainCode()
+ * \brief Compute the gain code for a gain with the linear model
+ * \param[in] gain The real gain
+ * \return The gain code
  */
 
 /**
- * \var CameraSensorHelper::AnalogueGainExponential
- * \brief Gain is expressed using an exponential model
+ * \fn CameraSensorHelper::AnalogueGainLinear::gain()
+ * \brief Compute the gain for a gain code with the linear model
+ * \param[in] gainCode The gain code
+ * \return The real gain
+ */
+
+/**
+ * \struct CameraSensorHelper::AnalogueGainExp
+ * \brief Analogue gain constants for the exponential gain model
  *
  * The relationship between the integer gain parameter and the resulting gain
  * multiplier is given by the following equation:
@@ -156,65 +241,39 @@ double CameraSensorHelper::gain(uint32_t gainCode) const
  *
  * When the gain is expressed in dB, 'a' is equal to 1 and 'm' to
  * \f$log_{2}{10^{\frac{1}{20}}}\f$.
- */
-
-/**
- * \struct CameraSensorHelper::AnalogueGainLinearConstants
- * \brief Analogue gain constants for the linear gain model
- *
- * \var CameraSensorHelper::AnalogueGainLinearConstants::m0
- * \brief Constant used in the linear gain coding/decoding
- *
- * \note Either m0 or m1 shall be zero.
- *
- * \var CameraSensorHelper::AnalogueGainLinearConstants::c0
- * \brief Constant used in the linear gain coding/decoding
- *
- * \var CameraSensorHelper::AnalogueGainLinearConstants::m1
- * \brief Constant used in the linear gain coding/decoding
- *
- * \note Either m0 or m1 shall be zero.
- *
- * \var CameraSensorHelper::AnalogueGainLinearConstants::c1
- * \brief Constant used in the linear gain coding/decoding
- */
-
-/**
- * \struct CameraSensorHelper::AnalogueGainExpConstants
- * \brief Analogue gain constants for the exponential gain model
  *
- * \var CameraSensorHelper::AnalogueGainExpConstants::a
+ * \var CameraSensorHelper::AnalogueGainExp::a
  * \brief Constant used in the exponential gain coding/decoding
  *
- * \var CameraSensorHelper::AnalogueGainExpConstants::m
+ * \var CameraSensorHelper::AnalogueGainExp::m
  * \brief Constant used in the exponential gain coding/decoding
  */
 
 /**
- * \struct CameraSensorHelper::AnalogueGainConstants
- * \brief Analogue gain model constants
- *
- * This union stores the constants used to calculate the analogue gain. The
- * CameraSensorHelper::gainType_ variable selects which union member is valid.
- *
- * \var CameraSensorHelper::AnalogueGainConstants::linear
- * \brief Constants for the linear gain model
- *
- * \var CameraSensorHelper::AnalogueGainConstants::exp
- * \brief Constants for the exponential gain model
+ * \fn CameraSensorHelper::AnalogueGainExp::gainCode()
+ * \brief Compute the gain code for a gain with the exponential model
+ * \param[in] gain The real gain
+ * \return The gain code
  */
 
 /**
- * \var CameraSensorHelper::gainType_
- * \brief The analogue gain model type
+ * \fn CameraSensorHelper::AnalogueGainExp::gain()
+ * \brief Compute the gain for a gain code with the exponential model
+ * \param[in] gainCode The gain code
+ * \return The real gain
  */
 
 /**
- * \var CameraSensorHelper::gainConstants_
- * \brief The analogue gain parameters used for calculation
+ * \var CameraSensorHelper::gain_
+ * \brief The analogue gain model and its sensor-specific constants
  *
  * The analogue gain is calculated through a formula, and its parameters are
- * sensor specific. Use this variable to store the values at init time.
+ * sensor specific. Subclasses store the gain model with its constants at init
+ * time. The gain models, as defined by the MIPI CCS, are implemented inline,
+ * and the model is resolved once per call to gainCodes() and gains().
+ *
+ * Subclasses that implement a custom gain conversion by overriding gainCode()
+ * and gain() shall leave the model unset.
  */
 
 /**
@@ -400,8 +459,7 @@ class CameraSensorHelperImx219 : public CameraSensorHelper
 public:
 	CameraSensorHelperImx219()
 	{
-		gainType_ = AnalogueGainLinear;
-		gainConstants_.linear = { 0, 256, -1, 256 };
+		gain_ = AnalogueGainLinear{ 0, 256, -1, 256 };
 	}
 };
 REGISTER_CAMERA_SENSOR_HELPER("imx219", CameraSensorHelperImx219)
@@ -411,8 +469,7 @@ class CameraSensorHelperImx258 : public CameraSensorHelper
 public:
 	CameraSensorHelperImx258()
 	{
-		gainType_ = AnalogueGainLinear;
-		gainConstants_.linear = { 0, 512, -1, 512 };
+		gain_ = AnalogueGainLinear{ 0, 512, -1, 512 };
 	}
 };
 REGISTER_CAMERA_SENSOR_HELPER("imx258", CameraSensorHelperImx258)
@@ -422,8 +479,7 @@ class CameraSensorHelperImx290 : public CameraSensorHelper
 public:
 	CameraSensorHelperImx290()
 	{
-		gainType_ = AnalogueGainExponential;
-		gainConstants_.exp = { 1.0, expGainDb(0.3) };
+		gain_ = AnalogueGainExp{ 1.0, expGainDb(0.3) };
 	}
 };
 REGISTER_CAMERA_SENSOR_HELPER("imx290", CameraSensorHelperImx290)
@@ -433,8 +489,7 @@ class CameraSensorHelperImx296 : public CameraSensorHelper
 public:
 	CameraSensorHelperImx296()
 	{
-		gainType_ = AnalogueGainExponential;
-		gainConstants_.exp = { 1.0, expGainDb(0.1) };
+		gain_ = AnalogueGainExp{ 1.0, expGainDb(0.1) };
 	}
 };
 REGISTER_CAMERA_SENSOR_HELPER("imx296", CameraSensorHelperImx296)
@@ -449,12 +504,31 @@ class CameraSensorHelperImx477 : public CameraSensorHelper
 public:
 	CameraSensorHelperImx477()
 	{
-		gainType_ = AnalogueGainLinear;
-		gainConstants_.linear = { 0, 1024, -1, 1024 };
+		gain_ = AnalogueGainLinear{ 0, 1024, -1, 1024 };
 	}
 };
 REGISTER_CAMERA_SENSOR_HELPER("imx477", CameraSensorHelperImx477)
 
+class CameraSensorHelperImx519 : public CameraSensorHelper
+{
+public:
+	CameraSensorHelperImx519()
+	{
+		gain_ = AnalogueGainLinear{ 0, 1024, -1, 1024 };
+	}
+};
+REGISTER_CAMERA_SENSOR_HELPER("imx519", CameraSensorHelperImx519)
+
+class CameraSensorHelperImx708 : public CameraSensorHelper
+{
+public:
+	CameraSensorHelperImx708()
+	{
+		gain_ = AnalogueGainLinear{ 0, 1024, -1, 1024 };
+	}
+};
+REGISTER_CAMERA_SENSOR_HELPER("imx708", CameraSensorHelperImx708)
+
 class CameraSensorHelperOv2685 : public CameraSensorHelper
 {
 public:
@@ -464,8 +538,7 @@ public:
 		 * The Sensor Manual doesn't appear to document the gain model.
 		 * This has been validated with some empirical testing only.
 		 */
-		gainType_ = AnalogueGainLinear;
-		gainConstants_.linear = { 1, 0, 0, 128 };
+		gain_ = AnalogueGainLinear{ 1, 0, 0, 128 };
 	}
 };
 REGISTER_CAMERA_SENSOR_HELPER("ov2685", CameraSensorHelperOv2685)
@@ -475,8 +548,7 @@ class CameraSensorHelperOv2740 : public CameraSensorHelper
 public:
 	CameraSensorHelperOv2740()
 	{
-		gainType_ = AnalogueGainLinear;
-		gainConstants_.linear = { 1, 0, 0, 128 };
+		gain_ = AnalogueGainLinear{ 1, 0, 0, 128 };
 	}
 };
 REGISTER_CAMERA_SENSOR_HELPER("ov2740", CameraSensorHelperOv2740)
@@ -486,8 +558,7 @@ class CameraSensorHelperOv4689 : public CameraSensorHelper
 public:
 	CameraSensorHelperOv4689()
 	{
-		gainType_ = AnalogueGainLinear;
-		gainConstants_.linear = { 1, 0, 0, 128 };
+		gain_ = AnalogueGainLinear{ 1, 0, 0, 128 };
 	}
 };
 REGISTER_CAMERA_SENSOR_HELPER("ov4689", CameraSensorHelperOv4689)
@@ -497,8 +568,7 @@ class CameraSensorHelperOv5640 : public CameraSensorHelper
 public:
 	CameraSensorHelperOv5640()
 	{
-		gainType_ = AnalogueGainLinear;
-		gainConstants_.linear = { 1, 0, 0, 16 };
+		gain_ = AnalogueGainLinear{ 1, 0, 0, 16 };
 	}
 };
 REGISTER_CAMERA_SENSOR_HELPER("ov5640", CameraSensorHelperOv5640)
@@ -508,8 +578,7 @@ class CameraSensorHelperOv5647 : public CameraSensorHelper
 public:
 	CameraSensorHelperOv5647()
 	{
-		gainType_ = AnalogueGainLinear;
-		gainConstants_.linear = { 1, 0, 0, 16 };
+		gain_ = AnalogueGainLinear{ 1, 0, 0, 16 };
 	}
 };
 REGISTER_CAMERA_SENSOR_HELPER("ov5647", CameraSensorHelperOv5647)
@@ -519,8 +588,7 @@ class CameraSensorHelperOv5670 : public CameraSensorHelper
 public:
 	CameraSensorHelperOv5670()
 	{
-		gainType_ = AnalogueGainLinear;
-		gainConstants_.linear = { 1, 0, 0, 128 };
+		gain_ = AnalogueGainLinear{ 1, 0, 0, 128 };
 	}
 };
 REGISTER_CAMERA_SENSOR_HELPER("ov5670", CameraSensorHelperOv5670)
@@ -530,8 +598,7 @@ class CameraSensorHelperOv5675 : public CameraSensorHelper
 public:
 	CameraSensorHelperOv5675()
 	{
-		gainType_ = AnalogueGainLinear;
-		gainConstants_.linear = { 1, 0, 0, 128 };
+		gain_ = AnalogueGainLinear{ 1, 0, 0, 128 };
 	}
 };
 REGISTER_CAMERA_SENSOR_HELPER("ov5675", CameraSensorHelperOv5675)
@@ -541,8 +608,7 @@ class CameraSensorHelperOv5693 : public CameraSensorHelper
 public:
 	CameraSensorHelperOv5693()
 	{
-		gainType_ = AnalogueGainLinear;
-		gainConstants_.linear = { 1, 0, 0, 16 };
+		gain_ = AnalogueGainLinear{ 1, 0, 0, 16 };
 	}
 };
 REGISTER_CAMERA_SENSOR_HELPER("ov5693", CameraSensorHelperOv5693)
@@ -552,8 +618,7 @@ class CameraSensorHelperOv64a40 : public CameraSensorHelper
 public:
 	CameraSensorHelperOv64a40()
 	{
-		gainType_ = AnalogueGainLinear;
-		gainConstants_.linear = { 1, 0, 0, 128 };
+		gain_ = AnalogueGainLinear{ 1, 0, 0, 128 };
 	}
 };
 REGISTER_CAMERA_SENSOR_HELPER("ov64a40", CameraSensorHelperOv64a40)
@@ -563,15 +628,13 @@ class CameraSensorHelperOv8858 : public CameraSensorHelper
 public:
 	CameraSensorHelperOv8858()
 	{
-		gainType_ = AnalogueGainLinear;
-
 		/*
 		 * \todo Validate the selected 1/128 step value as it differs
 		 * from what the sensor manual describes.
 		 *
 		 * See: https://patchwork.linuxtv.org/project/linux-media/patch/20221106171129.166892-2-nicholas@rothemail.net/#142267
 		 */
-		gainConstants_.linear = { 1, 0, 0, 128 };
+		gain_ = AnalogueGainLinear{ 1, 0, 0, 128 };
 	}
 };
 REGISTER_CAMERA_SENSOR_HELPER("ov8858", CameraSensorHelperOv8858)
@@ -581,19 +644,27 @@ class CameraSensorHelperOv8865 : public CameraSensorHelper
 public:
 	CameraSensorHelperOv8865()
 	{
-		gainType_ = AnalogueGainLinear;
-		gainConstants_.linear = { 1, 0, 0, 128 };
+		gain_ = AnalogueGainLinear{ 1, 0, 0, 128 };
 	}
 };
 REGISTER_CAMERA_SENSOR_HELPER("ov8865", CameraSensorHelperOv8865)
 
+class CameraSensorHelperOv9281 : public CameraSensorHelper
+{
+public:
+	CameraSensorHelperOv9281()
+	{
+		gain_ = AnalogueGainLinear{ 1, 0, 0, 16 };
+	}
+};
+REGISTER_CAMERA_SENSOR_HELPER("ov9281", CameraSensorHelperOv9281)
+
 class CameraSensorHelperOv13858 : public CameraSensorHelper
 {
 public:
 	CameraSensorHelperOv13858()
 	{
-		gainType_ = AnalogueGainLinear;
-		gainConstants_.linear = { 1, 0, 0, 128 };
+		gain_ = AnalogueGainLinear{ 1, 0, 0, 128 };
 	}
 };
 REGISTER_CAMERA_SENSOR_HELPER("ov13858", CameraSensorHelperOv13858)
@@ -9,11 +9,14 @@
 
 #include <stdint.h>
 
+#include <cmath>
 #include <memory>
 #include <string>
+#include <variant>
 #include <vector>
 
 #include <libcamera/base/class.h>
+#include <libcamera/base/span.h>
 
 namespace libcamera {
 
@@ -28,34 +31,57 @@ public:
 	virtual uint32_t gainCode(double gain) const;
 	virtual double gain(uint32_t gainCode) const;
 
-protected:
-	enum AnalogueGainType {
-		AnalogueGainLinear,
-		AnalogueGainExponential,
-	};
+	void gainCodes(Span<const double> gains, Span<uint32_t> gainCodes) const;
+	void gains(Span<const uint32_t> gainCodes, Span<double> gains) const;
 
-	struct AnalogueGainLinearConstants {
+protected:
+	struct AnalogueGainLinear {
 		int16_t m0;
 		int16_t c0;
 		int16_t m1;
 		int16_t c1;
+
+		uint32_t gainCode(double gain) const
+		{
+			/*
+			 * Either m0 or m1 is zero, split the computation to
+			 * minimize rounding errors when truncating the result.
+			 */
+			if (m0 == 0)
+				return c0 / (m1 * gain) - static_cast<double>(c1) / m1;
+
+			return (c1 * gain - c0) / m0;
+		}
+
+		double gain(uint32_t gainCode) const
+		{
+			double code = static_cast<double>(gainCode);
+			return (m0 * code + c0) / (m1 * code + c1);
+		}
 	};
 
-	struct AnalogueGainExpConstants {
+	struct AnalogueGainExp {
 		double a;
 		double m;
-	};
 
-	union AnalogueGainConstants {
-		AnalogueGainLinearConstants linear;
-		AnalogueGainExpConstants exp;
+		uint32_t gainCode(double gain) const
+		{
+			return std::log2(gain / a) / m;
+		}
+
+		double gain(uint32_t gainCode) const
+		{
+			return a * std::exp2(m * static_cast<double>(gainCode));
+		}
 	};
 
-	AnalogueGainType gainType_;
-	AnalogueGainConstants gainConstants_;
+	std::variant<std::monostate, AnalogueGainLinear, AnalogueGainExp> gain_;
 
 private:
 	LIBCAMERA_DISABLE_COPY_AND_MOVE(CameraSensorHelper)
+
+	static void validate(const AnalogueGainLinear &model);
+	static void validate(const AnalogueGainExp &model);
 };
 
 class CameraSensorHelperFactoryBase
@@ -84,6 +84,18 @@ namespace ipa {
  * queuing more in-flight requests to the IPA module than the queue size. If an
  * overflow condition is detected, the queue will log a fatal error.
  *
+ * The queue can be accessed concurrently from two threads without external
+ * locking, typically with requests being queued on one thread and statistics
+ * processed on another. Initialisation of a context is claimed atomically, so
+ * alloc() and get() calls racing for the same frame initialise it only once,
+ * and the caller that loses the race waits for the initialisation to complete.
+ * Each context is aligned to a cache line to avoid false sharing between
+ * threads working on different frames. The queue only orders the
+ * initialisation of the contexts: data stored in a context by one thread after
+ * alloc() returns must still be handed over to other threads by the IPA module,
+ * as happens naturally when the next operation on the frame is triggered by a
+ * message from the first thread.
+ *
  * IPA module-specific frame context implementations shall inherit from the
  * FrameContext base class to support the minimum required features for a
  * FrameContext.
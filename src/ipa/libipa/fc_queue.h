@@ -7,7 +7,10 @@
 
 #pragma once
 
+#include <atomic>
+#include <stddef.h>
 #include <stdint.h>
+#include <thread>
 #include <vector>
 
 #include <libcamera/base/log.h>
@@ -32,85 +35,134 @@ class FCQueue
 {
 public:
 	FCQueue(unsigned int size)
-		: contexts_(size)
+		: slots_(size)
 	{
 	}
 
 	void clear()
 	{
-		for (FrameContext &ctx : contexts_)
-			ctx.frame = 0;
+		for (Slot &slot : slots_) {
+			slot.context.frame = 0;
+			slot.state.store(0, std::memory_order_release);
+		}
 	}
 
 	FrameContext &alloc(const uint32_t frame)
 	{
-		FrameContext &frameContext = contexts_[frame % contexts_.size()];
-
-		/*
-		 * Do not re-initialise if a get() call has already fetched this
-		 * frame context to preseve the context.
-		 *
-		 * \todo If the the sequence number of the context to initialise
-		 * is smaller than the sequence number of the queue slot to use,
-		 * it means that we had a serious request underrun and more
-		 * frames than the queue size has been produced since the last
-		 * time the application has queued a request. Does this deserve
-		 * an error condition ?
-		 */
-		if (frame != 0 && frame <= frameContext.frame)
-			LOG(FCQueue, Warning)
-				<< "Frame " << frame << " already initialised";
-		else
-			init(frameContext, frame);
-
-		return frameContext;
+		Slot &slot = slots_[frame % slots_.size()];
+
+		while (true) {
+			uint64_t state = waitReady(slot);
+			uint32_t current = state >> 1;
+
+			/*
+			 * Do not re-initialise if a get() call has already
+			 * fetched this frame context to preseve the context.
+			 *
+			 * \todo If the the sequence number of the context to
+			 * initialise is smaller than the sequence number of the
+			 * queue slot to use, it means that we had a serious
+			 * request underrun and more frames than the queue size
+			 * has been produced since the last time the application
+			 * has queued a request. Does this deserve an error
+			 * condition ?
+			 */
+			if (frame != 0 && frame <= current) {
+				LOG(FCQueue, Warning)
+					<< "Frame " << frame << " already initialised";
+				return slot.context;
+			}
+
+			if (tryInit(slot, state, frame))
+				return slot.context;
+		}
 	}
 
 	FrameContext &get(uint32_t frame)
 	{
-		FrameContext &frameContext = contexts_[frame % contexts_.size()];
-
-		/*
-		 * If the IPA algorithms try to access a frame context slot which
-		 * has been already overwritten by a newer context, it means the
-		 * frame context queue has overflowed and the desired context
-		 * has been forever lost. The pipeline handler shall avoid
-		 * queueing more requests to the IPA than the frame context
-		 * queue size.
-		 */
-		if (frame < frameContext.frame)
-			LOG(FCQueue, Fatal) << "Frame context for " << frame
-					    << " has been overwritten by "
-					    << frameContext.frame;
-
-		if (frame == frameContext.frame)
-			return frameContext;
-
-		/*
-		 * The frame context has been retrieved before it was
-		 * initialised through the initialise() call. This indicates an
-		 * algorithm attempted to access a Frame context before it was
-		 * queued to the IPA. Controls applied for this request may be
-		 * left unhandled.
-		 *
-		 * \todo Set an error flag for per-frame control errors.
-		 */
-		LOG(FCQueue, Warning)
-			<< "Obtained an uninitialised FrameContext for " << frame;
-
-		init(frameContext, frame);
-
-		return frameContext;
+		Slot &slot = slots_[frame % slots_.size()];
+
+		while (true) {
+			uint64_t state = waitReady(slot);
+			uint32_t current = state >> 1;
+
+			/*
+			 * If the IPA algorithms try to access a frame context
+			 * slot which has been already overwritten by a newer
+			 * context, it means the frame context queue has
+			 * overflowed and the desired context has been forever
+			 * lost. The pipeline handler shall avoid queueing more
+			 * requests to the IPA than the frame context queue size.
+			 */
+			if (frame < current)
+				LOG(FCQueue, Fatal) << "Frame context for " << frame
+						    << " has been overwritten by "
+						    << current;
+
+			if (frame == current)
+				return slot.context;
+
+			if (!tryInit(slot, state, frame))
+				continue;
+
+			/*
+			 * The frame context has been retrieved before it was
+			 * initialised through the initialise() call. This
+			 * indicates an algorithm attempted to access a Frame
+			 * context before it was queued to the IPA. Controls
+			 * applied for this request may be left unhandled.
+			 *
+			 * \todo Set an error flag for per-frame control errors.
+			 */
+			LOG(FCQueue, Warning)
+				<< "Obtained an uninitialised FrameContext for " << frame;
+
+			return slot.context;
+		}
 	}
 
 private:
-	void init(FrameContext &frameContext, const uint32_t frame)
+	/*
+	 * Keep each context on its own cache lines, so that threads working on
+	 * different frames don't contend for them.
+	 */
+	static constexpr std::size_t kCacheLineSize = 64;
+
+	/* The slot state holds the frame number, shifted left by one. */
+	static constexpr uint64_t kBusy = 1;
+
+	struct alignas(kCacheLineSize) Slot {
+		std::atomic<uint64_t> state{ 0 };
+		FrameContext context{};
+	};
+
+	static uint64_t waitReady(Slot &slot)
 	{
-		frameContext = {};
-		frameContext.frame = frame;
+		uint64_t state = slot.state.load(std::memory_order_acquire);
+		while (state & kBusy) {
+			std::this_thread::yield();
+			state = slot.state.load(std::memory_order_acquire);
+		}
+
+		return state;
+	}
+
+	static bool tryInit(Slot &slot, uint64_t state, const uint32_t frame)
+	{
+		uint64_t busy = (static_cast<uint64_t>(frame) << 1) | kBusy;
+		if (!slot.state.compare_exchange_strong(state, busy,
+							std::memory_order_acquire))
+			return false;
+
+		slot.context = {};
+		slot.context.frame = frame;
+
+		slot.state.store(static_cast<uint64_t>(frame) << 1,
+				 std::memory_order_release);
+		return true;
 	}
 
-	std::vector<FrameContext> contexts_;
+	std::vector<Slot> slots_;
 };
 
 } /* namespace ipa */
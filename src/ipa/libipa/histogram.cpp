@@ -28,16 +28,42 @@ namespace ipa {
  * specified bin. It can be used to find quantiles and averages between quantiles.
  */
 
+/**
+ * \fn Histogram::Histogram()
+ * \brief Create an empty histogram
+ *
+ * The histogram has no bins until it is populated with update().
+ */
+
 /**
  * \brief Create a cumulative histogram
  * \param[in] data A pre-sorted histogram to be passed
  */
 Histogram::Histogram(Span<const uint32_t> data)
 {
-	cumulative_.reserve(data.size());
-	cumulative_.push_back(0);
-	for (const uint32_t &value : data)
-		cumulative_.push_back(cumulative_.back() + value);
+	update(data);
+}
+
+/**
+ * \brief Replace the histogram contents
+ * \param[in] data A pre-sorted histogram to be passed
+ *
+ * The cumulative frequencies are recomputed in place, reusing the storage of
+ * the previous contents. Algorithms that measure a histogram on every frame
+ * should keep a Histogram instance and update it, to avoid reallocating it.
+ */
+void Histogram::update(Span<const uint32_t> data)
+{
+	cumulative_.resize(data.size() + 1);
+
+	uint64_t *cumulative = cumulative_.data();
+	uint64_t sum = 0;
+
+	cumulative[0] = 0;
+	for (size_t i = 0; i < data.size(); i++) {
+		sum += data[i];
+		cumulative[i + 1] = sum;
+	}
 }
 
 /**
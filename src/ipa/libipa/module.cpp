@@ -97,6 +97,38 @@ namespace ipa {
  * \return 0 on success, or a negative error code on failure
  */
 
+/**
+ * \fn Module::enableConcurrency()
+ * \brief Run independent algorithms concurrently in process()
+ * \param[in] maxWorkers The maximum number of threads to create, in addition
+ * to the IPA module thread
+ *
+ * Consecutive algorithms that declare, through Algorithm::processAccess(), that
+ * they don't depend on each other's state are run concurrently by process()
+ * once this function has been called. No more threads than can be kept busy
+ * are created, and none if no algorithms can run concurrently.
+ *
+ * This function shall be called after createAlgorithms().
+ */
+
+/**
+ * \fn Module::process()
+ * \brief Process ISP statistics with all the algorithms
+ * \param[in] context The shared IPA context
+ * \param[in] frame The frame context sequence number
+ * \param[in] frameContext The current frame's context
+ * \param[in] stats The IPA statistics and ISP results
+ * \param[out] metadata Metadata for the frame, to be filled by the algorithms
+ * \param[in] filter A function selecting the algorithms to run, all of them if
+ * empty
+ *
+ * This function calls Algorithm::process() for each algorithm, in the order
+ * they have been created. If concurrency has been enabled with
+ * enableConcurrency(), consecutive independent algorithms run concurrently,
+ * each filling a separate metadata list that is merged into \a metadata in
+ * the algorithms order.
+ */
+
 /**
  * \fn Module::registerAlgorithm()
  * \brief Add an algorithm factory class to the list of available algorithms
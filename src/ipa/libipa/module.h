@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <functional>
 #include <list>
 #include <memory>
 #include <string>
@@ -18,6 +20,7 @@
 #include "libcamera/internal/yaml_parser.h"
 
 #include "algorithm.h"
+#include "worker_pool.h"
 
 namespace libcamera {
 
@@ -62,15 +65,126 @@ public:
 			}
 		}
 
+		buildProcessSchedule();
+
 		return 0;
 	}
 
+	void enableConcurrency(unsigned int maxWorkers)
+	{
+		size_t maxStageSize = 0;
+		for (const auto &stage : processStages_)
+			maxStageSize = std::max(maxStageSize, stage.size());
+
+		unsigned int workers = maxStageSize > 1
+				     ? std::min<unsigned int>(maxWorkers, maxStageSize - 1)
+				     : 0;
+		if (workers)
+			workers_ = std::make_unique<WorkerPool>(workers);
+		else
+			workers_.reset();
+
+		LOG(IPAModuleAlgo, Debug)
+			<< "Processing algorithms with " << workers
+			<< " worker threads";
+	}
+
+	void process(Context &context, const uint32_t frame,
+		     FrameContext &frameContext, const Stats *stats,
+		     ControlList &metadata,
+		     const std::function<bool(const Algorithm<Module> &)> &filter = {})
+	{
+		std::vector<Algorithm<Module> *> algos;
+		std::vector<ControlList> lists;
+		std::vector<std::function<void()>> tasks;
+
+		for (const auto &stage : processStages_) {
+			algos.clear();
+			for (Algorithm<Module> *algo : stage) {
+				if (!filter || filter(*algo))
+					algos.push_back(algo);
+			}
+
+			if (!workers_ || algos.size() < 2) {
+				for (Algorithm<Module> *algo : algos)
+					algo->process(context, frame, frameContext,
+						      stats, metadata);
+				continue;
+			}
+
+			/*
+			 * Give each algorithm its own metadata list, and merge
+			 * them in the algorithms order once they're all done.
+			 */
+			lists.assign(algos.size(), metadata);
+			tasks.clear();
+			for (size_t i = 0; i < algos.size(); i++) {
+				lists[i].clear();
+				tasks.push_back([&, i] {
+					algos[i]->process(context, frame, frameContext,
+							  stats, lists[i]);
+				});
+			}
+
+			workers_->run(tasks);
+
+			for (ControlList &list : lists)
+				metadata.merge(std::move(list));
+		}
+	}
+
 	static void registerAlgorithm(AlgorithmFactoryBase<Module> *factory)
 	{
 		factories().push_back(factory);
 	}
 
 private:
+	static bool accessConflicts(const std::optional<typename Algorithm<Module>::StateAccess> &a,
+				    const std::optional<typename Algorithm<Module>::StateAccess> &b)
+	{
+		if (!a || !b)
+			return true;
+
+		auto intersects = [](const std::vector<std::string> &x,
+				     const std::vector<std::string> &y) {
+			return std::any_of(x.begin(), x.end(), [&y](const std::string &key) {
+				return std::find(y.begin(), y.end(), key) != y.end();
+			});
+		};
+
+		return intersects(a->writes, b->reads) || intersects(a->writes, b->writes) ||
+		       intersects(a->reads, b->writes);
+	}
+
+	void buildProcessSchedule()
+	{
+		/*
+		 * Group consecutive algorithms that don't conflict with each
+		 * other in stages. The stages run one after the other, so an
+		 * algorithm still sees the results of the conflicting
+		 * algorithms listed before it.
+		 */
+		processStages_.clear();
+		std::vector<std::optional<typename Algorithm<Module>::StateAccess>> stageAccess;
+
+		for (const auto &algo : algorithms_) {
+			auto access = algo->processAccess();
+			bool conflicts = processStages_.empty() ||
+					 std::any_of(stageAccess.begin(), stageAccess.end(),
+						     [&access](const auto &other) {
+							     return accessConflicts(access, other);
+						     });
+
+			if (conflicts) {
+				processStages_.emplace_back();
+				stageAccess.clear();
+			}
+
+			processStages_.back().push_back(algo.get());
+			stageAccess.push_back(std::move(access));
+		}
+	}
+
 	int createAlgorithm(Context &context, const YamlObject &data)
 	{
 		const auto &[name, algoData] = *data.asDict().begin();
@@ -117,6 +231,9 @@ private:
 	}
 
 	std::list<std::unique_ptr<Algorithm<Module>>> algorithms_;
+
+	std::vector<std::vector<Algorithm<Module> *>> processStages_;
+	std::unique_ptr<WorkerPool> workers_;
 };
 
 } /* namespace ipa */
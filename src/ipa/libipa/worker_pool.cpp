@@ -0,0 +1,184 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas On Board
+ *
+ * worker_pool.cpp - Threads to run IPA algorithms concurrently
+ */
+
+#include "worker_pool.h"
+
+#include <algorithm>
+
+/**
+ * \file worker_pool.h
+ * \brief Threads to run IPA algorithms concurrently
+ */
+
+namespace libcamera {
+
+namespace ipa {
+
+/**
+ * \class WorkerPool
+ * \brief A small set of threads that run batches of tasks and background jobs
+ *
+ * The WorkerPool runs batches of independent tasks concurrently, with the
+ * calling thread taking part in the work. It is meant for short, per-frame
+ * work such as running the algorithms of an IPA module that don't depend on
+ * each other, and is used by the Module class for that purpose.
+ *
+ * The pool also runs background jobs, submitted with submit(), for algorithms
+ * that spread an expensive calculation over several frames. Batch tasks take
+ * precedence over background jobs, as the caller of run() waits for them.
+ * Multiple threads may use the same pool concurrently.
+ */
+
+/**
+ * \brief Construct a worker pool
+ * \param[in] workers The number of threads to create, in addition to the
+ * thread calling run()
+ */
+WorkerPool::WorkerPool(unsigned int workers)
+	: exit_(false)
+{
+	for (unsigned int i = 0; i < workers; i++)
+		threads_.emplace_back(&WorkerPool::worker, this);
+}
+
+/**
+ * \brief Destroy the worker pool
+ *
+ * Background jobs that have been submitted but haven't started yet are run
+ * before the worker threads exit, as their submitters may wait for them.
+ */
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		exit_ = true;
+	}
+	workCondition_.notify_all();
+
+	for (std::thread &thread : threads_)
+		thread.join();
+}
+
+/**
+ * \fn WorkerPool::workers()
+ * \brief Retrieve the number of worker threads
+ * \return The number of threads in the pool, not counting the caller of run()
+ */
+
+/**
+ * \brief Run a batch of tasks and wait for them to complete
+ * \param[in] tasks The tasks to run
+ *
+ * The tasks are run in an unspecified order, concurrently with each other, by
+ * the worker threads and the calling thread. The function returns when all the
+ * tasks have completed.
+ */
+void WorkerPool::run(Span<const std::function<void()>> tasks)
+{
+	unsigned int pending = tasks.size();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (const std::function<void()> &task : tasks)
+			tasks_.push_back({ &task, &pending });
+	}
+	workCondition_.notify_all();
+
+	/*
+	 * Take part in the work, and wait for the workers to complete. Only
+	 * run tasks from this batch, the others belong to other callers.
+	 */
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true) {
+		auto it = std::find_if(tasks_.begin(), tasks_.end(),
+				       [&](const Task &task) {
+					       return task.pending == &pending;
+				       });
+		if (it == tasks_.end())
+			break;
+
+		const std::function<void()> *func = it->func;
+		tasks_.erase(it);
+
+		lock.unlock();
+		(*func)();
+		lock.lock();
+
+		pending--;
+	}
+
+	doneCondition_.wait(lock, [&] { return pending == 0; });
+}
+
+/**
+ * \brief Run a job in the background
+ * \param[in] job The job to run
+ *
+ * The \a job is run by one of the worker threads once no batch task is
+ * pending. Jobs are started in submission order. If the pool has no worker
+ * thread, the job is run synchronously by the caller.
+ *
+ * The caller shall keep the resources used by the job alive until it
+ * completes, typically by waiting on the returned future before destroying
+ * them.
+ *
+ * \return A future that becomes ready when the job completes
+ */
+std::future<void> WorkerPool::submit(std::function<void()> job)
+{
+	std::packaged_task<void()> task(std::move(job));
+	std::future<void> future = task.get_future();
+
+	if (threads_.empty()) {
+		task();
+		return future;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back(std::move(task));
+	}
+	workCondition_.notify_one();
+
+	return future;
+}
+
+void WorkerPool::worker()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+
+	while (true) {
+		workCondition_.wait(lock, [this] {
+			return exit_ || !tasks_.empty() || !jobs_.empty();
+		});
+
+		if (!tasks_.empty()) {
+			Task task = tasks_.front();
+			tasks_.pop_front();
+
+			lock.unlock();
+			(*task.func)();
+			lock.lock();
+
+			if (--*task.pending == 0)
+				doneCondition_.notify_all();
+		} else if (!jobs_.empty()) {
+			std::packaged_task<void()> job = std::move(jobs_.front());
+			jobs_.pop_front();
+
+			lock.unlock();
+			job();
+			lock.lock();
+		} else {
+			return;
+		}
+	}
+}
+
+} /* namespace ipa */
+
+} /* namespace libcamera */
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas On Board
+ *
+ * worker_pool.h - Threads to run IPA algorithms concurrently
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <libcamera/base/class.h>
+#include <libcamera/base/span.h>
+
+namespace libcamera {
+
+namespace ipa {
+
+class WorkerPool
+{
+public:
+	WorkerPool(unsigned int workers);
+	~WorkerPool();
+
+	unsigned int workers() const { return threads_.size(); }
+
+	void run(Span<const std::function<void()>> tasks);
+	std::future<void> submit(std::function<void()> job);
+
+private:
+	LIBCAMERA_DISABLE_COPY_AND_MOVE(WorkerPool)
+
+	struct Task {
+		const std::function<void()> *func;
+		unsigned int *pending;
+	};
+
+	void worker();
+
+	std::vector<std::thread> threads_;
+
+	std::mutex mutex_;
+	std::condition_variable workCondition_;
+	std::condition_variable doneCondition_;
+	std::deque<Task> tasks_;
+	std::deque<std::packaged_task<void()>> jobs_;
+	bool exit_;
+};
+
+} /* namespace ipa */
+
+} /* namespace libcamera */
@@ -59,7 +59,7 @@ static constexpr double kEvGainTarget = 0.5;
 static constexpr double kRelativeLuminanceTarget = 0.4;
 
 Agc::Agc()
-	: frameCount_(0), numCells_(0), numHistBins_(0), filteredExposure_(0s)
+	: frameCount_(0), numHistBins_(0), filteredExposure_(0s)
 {
 	supportsRaw_ = true;
 }
@@ -83,16 +83,13 @@ int Agc::configure(IPAContext &context, const IPACameraSensorInfo &configInfo)
 
 	/*
 	 * According to the RkISP1 documentation:
-	 * - versions < V12 have RKISP1_CIF_ISP_AE_MEAN_MAX_V10 entries,
-	 * - versions >= V12 have RKISP1_CIF_ISP_AE_MEAN_MAX_V12 entries.
+	 * - versions < V12 have RKISP1_CIF_ISP_HIST_BIN_N_MAX_V10 entries,
+	 * - versions >= V12 have RKISP1_CIF_ISP_HIST_BIN_N_MAX_V12 entries.
 	 */
-	if (context.configuration.hw.revision < RKISP1_V12) {
-		numCells_ = RKISP1_CIF_ISP_AE_MEAN_MAX_V10;
+	if (context.configuration.hw.revision < RKISP1_V12)
 		numHistBins_ = RKISP1_CIF_ISP_HIST_BIN_N_MAX_V10;
-	} else {
-		numCells_ = RKISP1_CIF_ISP_AE_MEAN_MAX_V12;
+	else
 		numHistBins_ = RKISP1_CIF_ISP_HIST_BIN_N_MAX_V12;
-	}
 
 	/*
 	 * Define the measurement window for AGC as a centered rectangle
@@ -182,6 +179,7 @@ void Agc::prepare(IPAContext &context, const uint32_t frame,
 	params->module_en_update |= RKISP1_CIF_ISP_MODULE_AEC;
 
 	/* Configure histogram. */
+	params->meas.hst_config = {};
 	params->meas.hst_config.meas_window = context.configuration.agc.measureWindow;
 	/* Produce the luminance histogram. */
 	params->meas.hst_config.mode = RKISP1_CIF_ISP_HISTOGRAM_MODE_Y_HISTOGRAM;
@@ -318,7 +316,7 @@ void Agc::computeExposure(IPAContext &context, IPAFrameContext &frameContext,
 
 /**
  * \brief Estimate the relative luminance of the frame with a given gain
- * \param[in] ae The RkISP1 statistics and ISP results
+ * \param[in] stats The decoded statistics of the frame
  * \param[in] gain The gain to apply to the frame
  *
  * This function estimates the average relative luminance of the frame that
@@ -342,28 +340,28 @@ void Agc::computeExposure(IPAContext &context, IPAFrameContext &frameContext,
  *
  * \return The relative luminance
  */
-double Agc::estimateLuminance(const rkisp1_cif_isp_ae_stat *ae,
-			      double gain)
+double Agc::estimateLuminance(const IPAStatistics &stats, double gain)
 {
+	const float *means = stats.ae.means.data();
+	unsigned int numCells = stats.ae.numCells;
 	double ySum = 0.0;
 
 	/* Sum the averages, saturated to 255. */
-	for (unsigned int aeCell = 0; aeCell < numCells_; aeCell++)
-		ySum += std::min(ae->exp_mean[aeCell] * gain, 255.0);
+	for (unsigned int aeCell = 0; aeCell < numCells; aeCell++)
+		ySum += std::min(means[aeCell] * gain, 255.0);
 
 	/* \todo Weight with the AWB gains */
 
-	return ySum / numCells_ / 255;
+	return ySum / numCells / 255;
 }
 
 /**
  * \brief Estimate the mean value of the top 2% of the histogram
- * \param[in] hist The histogram statistics computed by the ImgU
+ * \param[in] histogram The cumulative histogram computed by the ISP
  * \return The mean value of the top 2% of the histogram
  */
-double Agc::measureBrightness(const rkisp1_cif_isp_hist_stat *hist) const
+double Agc::measureBrightness(const Histogram &histogram)
 {
-	Histogram histogram{ Span<const uint32_t>(hist->hist_bins, numHistBins_) };
 	/* Estimate the quantile mean of the top 2% of the histogram. */
 	return histogram.interQuantileMean(0.98, 1.0);
 }
@@ -412,13 +410,9 @@ void Agc::process(IPAContext &context, [[maybe_unused]] const uint32_t frame,
 	 * we receive), but is important in manual mode.
 	 */
 
-	const rkisp1_cif_isp_stat *params = &stats->params;
 	ASSERT(stats->meas_type & RKISP1_CIF_ISP_STAT_AUTOEXP);
 
-	const rkisp1_cif_isp_ae_stat *ae = &params->ae;
-	const rkisp1_cif_isp_hist_stat *hist = &params->hist;
-
-	double iqMean = measureBrightness(hist);
+	double iqMean = measureBrightness(context.stats.hist.histogram);
 	double iqMeanGain = kEvGainTarget * numHistBins_ / iqMean;
 
 	/*
@@ -432,7 +426,7 @@ void Agc::process(IPAContext &context, [[maybe_unused]] const uint32_t frame,
 	double yTarget = kRelativeLuminanceTarget;
 
 	for (unsigned int i = 0; i < 8; i++) {
-		double yValue = estimateLuminance(ae, yGain);
+		double yValue = estimateLuminance(context.stats, yGain);
 		double extra_gain = std::min(10.0, yTarget / (yValue + .001));
 
 		yGain *= extra_gain;
@@ -449,6 +443,17 @@ void Agc::process(IPAContext &context, [[maybe_unused]] const uint32_t frame,
 	fillMetadata(context, frameContext, metadata);
 }
 
+/**
+ * \copydoc libcamera::ipa::Algorithm::processAccess
+ *
+ * The AGC reads the sensor settings and the decoded statistics of the frame,
+ * and only updates its own state.
+ */
+std::optional<Agc::StateAccess> Agc::processAccess() const
+{
+	return StateAccess{ { "sensor", "stats" }, { "agc" } };
+}
+
 REGISTER_IPA_ALGORITHM(Agc, "Agc")
 
 } /* namespace ipa::rkisp1::algorithms */
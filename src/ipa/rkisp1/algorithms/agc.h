@@ -13,6 +13,8 @@
 
 #include <libcamera/geometry.h>
 
+#include "libipa/histogram.h"
+
 #include "algorithm.h"
 
 namespace libcamera {
@@ -37,19 +39,19 @@ public:
 		     IPAFrameContext &frameContext,
 		     const rkisp1_stat_buffer *stats,
 		     ControlList &metadata) override;
+	std::optional<StateAccess> processAccess() const override;
 
 private:
 	void computeExposure(IPAContext &Context, IPAFrameContext &frameContext,
 			     double yGain, double iqMeanGain);
 	utils::Duration filterExposure(utils::Duration exposureValue);
-	double estimateLuminance(const rkisp1_cif_isp_ae_stat *ae, double gain);
-	double measureBrightness(const rkisp1_cif_isp_hist_stat *hist) const;
+	double estimateLuminance(const IPAStatistics &stats, double gain);
+	double measureBrightness(const Histogram &histogram);
 	void fillMetadata(IPAContext &context, IPAFrameContext &frameContext,
 			  ControlList &metadata);
 
 	uint64_t frameCount_;
 
-	uint32_t numCells_;
 	uint32_t numHistBins_;
 
 	utils::Duration filteredExposure_;
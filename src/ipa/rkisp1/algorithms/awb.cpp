@@ -35,7 +35,7 @@ LOG_DEFINE_CATEGORY(RkISP1Awb)
 constexpr double kMeanMinThreshold = 2.0;
 
 Awb::Awb()
-	: rgbMode_(false)
+	: rgbMode_(false), gainConfig_{}
 {
 }
 
@@ -64,6 +64,8 @@ int Awb::configure(IPAContext &context,
 
 	context.configuration.awb.enabled = true;
 
+	gainConfig_ = {};
+
 	return 0;
 }
 
@@ -120,19 +122,29 @@ void Awb::prepare(IPAContext &context, const uint32_t frame,
 		frameContext.awb.gains.blue = context.activeState.awb.gains.automatic.blue;
 	}
 
-	params->others.awb_gain_config.gain_green_b = 256 * frameContext.awb.gains.green;
-	params->others.awb_gain_config.gain_blue = 256 * frameContext.awb.gains.blue;
-	params->others.awb_gain_config.gain_red = 256 * frameContext.awb.gains.red;
-	params->others.awb_gain_config.gain_green_r = 256 * frameContext.awb.gains.green;
-
-	/* Update the gains. */
-	params->module_cfg_update |= RKISP1_CIF_ISP_MODULE_AWB_GAIN;
+	rkisp1_cif_isp_awb_gain_config gainConfig;
+	gainConfig.gain_green_b = 256 * frameContext.awb.gains.green;
+	gainConfig.gain_blue = 256 * frameContext.awb.gains.blue;
+	gainConfig.gain_red = 256 * frameContext.awb.gains.red;
+	gainConfig.gain_green_r = 256 * frameContext.awb.gains.green;
+
+	/* Update the gains only when the register values change. */
+	if (frame == 0 ||
+	    gainConfig.gain_green_b != gainConfig_.gain_green_b ||
+	    gainConfig.gain_blue != gainConfig_.gain_blue ||
+	    gainConfig.gain_red != gainConfig_.gain_red ||
+	    gainConfig.gain_green_r != gainConfig_.gain_green_r) {
+		params->others.awb_gain_config = gainConfig;
+		params->module_cfg_update |= RKISP1_CIF_ISP_MODULE_AWB_GAIN;
+		gainConfig_ = gainConfig;
+	}
 
 	/* If we have already set the AWB measurement parameters, return. */
 	if (frame > 0)
 		return;
 
 	rkisp1_cif_isp_awb_meas_config &awb_config = params->meas.awb_meas_config;
+	awb_config = {};
 
 	/* Configure the measure window for AWB. */
 	awb_config.awb_wnd = context.configuration.awb.measureWindow;
@@ -208,25 +220,24 @@ uint32_t Awb::estimateCCT(double red, double green, double blue)
 void Awb::process(IPAContext &context,
 		  [[maybe_unused]] const uint32_t frame,
 		  IPAFrameContext &frameContext,
-		  const rkisp1_stat_buffer *stats,
+		  [[maybe_unused]] const rkisp1_stat_buffer *stats,
 		  ControlList &metadata)
 {
-	const rkisp1_cif_isp_stat *params = &stats->params;
-	const rkisp1_cif_isp_awb_stat *awb = &params->awb;
+	const auto &awb = context.stats.awb;
 	IPAActiveState &activeState = context.activeState;
 	double greenMean;
 	double redMean;
 	double blueMean;
 
 	if (rgbMode_) {
-		greenMean = awb->awb_mean[0].mean_y_or_g;
-		redMean = awb->awb_mean[0].mean_cr_or_r;
-		blueMean = awb->awb_mean[0].mean_cb_or_b;
+		greenMean = awb.meanYOrG;
+		redMean = awb.meanCrOrR;
+		blueMean = awb.meanCbOrB;
 	} else {
 		/* Get the YCbCr mean values */
-		double yMean = awb->awb_mean[0].mean_y_or_g;
-		double cbMean = awb->awb_mean[0].mean_cb_or_b;
-		double crMean = awb->awb_mean[0].mean_cr_or_r;
+		double yMean = awb.meanYOrG;
+		double cbMean = awb.meanCbOrB;
+		double crMean = awb.meanCrOrR;
 
 		/*
 		 * Convert from YCbCr to RGB.
@@ -322,6 +333,17 @@ void Awb::process(IPAContext &context,
 		<< frameContext.awb.temperatureK << "K";
 }
 
+/**
+ * \copydoc libcamera::ipa::Algorithm::processAccess
+ *
+ * The AWB reads the decoded statistics of the frame, and only updates its own
+ * state.
+ */
+std::optional<Awb::StateAccess> Awb::processAccess() const
+{
+	return StateAccess{ { "stats" }, { "awb" } };
+}
+
 REGISTER_IPA_ALGORITHM(Awb, "Awb")
 
 } /* namespace ipa::rkisp1::algorithms */
@@ -30,11 +30,13 @@ public:
 		     IPAFrameContext &frameContext,
 		     const rkisp1_stat_buffer *stats,
 		     ControlList &metadata) override;
+	std::optional<StateAccess> processAccess() const override;
 
 private:
 	uint32_t estimateCCT(double red, double green, double blue);
 
 	bool rgbMode_;
+	rkisp1_cif_isp_awb_gain_config gainConfig_;
 };
 
 } /* namespace ipa::rkisp1::algorithms */
@@ -76,6 +76,7 @@ void BlackLevelCorrection::prepare([[maybe_unused]] IPAContext &context,
 	if (!tuningParameters_)
 		return;
 
+	params->others.bls_config = {};
 	params->others.bls_config.enable_auto = 0;
 	params->others.bls_config.fixed_val.r = blackLevelRed_;
 	params->others.bls_config.fixed_val.gr = blackLevelGreenR_;
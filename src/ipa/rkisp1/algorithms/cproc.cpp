@@ -95,6 +95,7 @@ void ColorProcessing::prepare([[maybe_unused]] IPAContext &context,
 	if (!frameContext.cproc.update)
 		return;
 
+	params->others.cproc_config = {};
 	params->others.cproc_config.brightness = frameContext.cproc.brightness;
 	params->others.cproc_config.contrast = frameContext.cproc.contrast;
 	params->others.cproc_config.sat = frameContext.cproc.saturation;
@@ -12,6 +12,7 @@
 #include <numeric>
 
 #include <libcamera/base/log.h>
+#include <libcamera/base/span.h>
 #include <libcamera/base/utils.h>
 
 #include "libcamera/internal/yaml_parser.h"
@@ -40,16 +41,32 @@ namespace ipa::rkisp1::algorithms {
 
 LOG_DEFINE_CATEGORY(RkISP1Lsc)
 
+/*
+ * Colour temperatures are quantized before selecting the tables, to bound the
+ * number of interpolated tables that need to be cached. The most recently
+ * used interpolated tables are kept, as the colour temperature usually moves
+ * slowly.
+ */
+static constexpr uint32_t kCtQuantum = 10;
+static constexpr unsigned int kCacheSize = 8;
+
+/*
+ * The LSC block is only reprogrammed when a sample of the selected tables
+ * differs from the applied tables by at least this amount, in units of
+ * 1/1024.
+ */
+static constexpr unsigned int kUpdateThreshold = 2;
+
 static std::vector<double> parseSizes(const YamlObject &tuningData,
 				      const char *prop)
 {
-	std::vector<double> sizes =
-		tuningData[prop].getList<double>().value_or(std::vector<double>{});
-	if (sizes.size() != RKISP1_CIF_ISP_LSC_SECTORS_TBL_SIZE) {
+	const YamlObject &yamlSizes = tuningData[prop];
+	std::vector<double> sizes(RKISP1_CIF_ISP_LSC_SECTORS_TBL_SIZE);
+	if (!yamlSizes.getList(Span<double>(sizes))) {
 		LOG(RkISP1Lsc, Error)
 			<< "Invalid '" << prop << "' values: expected "
 			<< RKISP1_CIF_ISP_LSC_SECTORS_TBL_SIZE
-			<< " elements, got " << sizes.size();
+			<< " numbers, got " << yamlSizes.size() << " elements";
 		return {};
 	}
 
@@ -76,13 +93,13 @@ static std::vector<uint16_t> parseTable(const YamlObject &tuningData,
 	static constexpr unsigned int kLscNumSamples =
 		RKISP1_CIF_ISP_LSC_SAMPLES_MAX * RKISP1_CIF_ISP_LSC_SAMPLES_MAX;
 
-	std::vector<uint16_t> table =
-		tuningData[prop].getList<uint16_t>().value_or(std::vector<uint16_t>{});
-	if (table.size() != kLscNumSamples) {
+	const YamlObject &yamlTable = tuningData[prop];
+	std::vector<uint16_t> table(kLscNumSamples);
+	if (!yamlTable.getList(Span<uint16_t>(table))) {
 		LOG(RkISP1Lsc, Error)
 			<< "Invalid '" << prop << "' values: expected "
 			<< kLscNumSamples
-			<< " elements, got " << table.size();
+			<< " integers, got " << yamlTable.size() << " elements";
 		return {};
 	}
 
@@ -181,6 +198,10 @@ int LensShadingCorrection::configure(IPAContext &context,
 		yGrad_[i] = std::round(32768 / ySizes_[i]);
 	}
 
+	/* Make sure the tables are programmed for the first frame. */
+	lastCt_ = { 0, 0 };
+	applied_ = {};
+
 	context.configuration.lsc.enabled = true;
 	return 0;
 }
@@ -193,6 +214,8 @@ void LensShadingCorrection::setParameters(rkisp1_params_cfg *params)
 	memcpy(config.y_grad_tbl, yGrad_, sizeof(config.y_grad_tbl));
 	memcpy(config.x_size_tbl, xSizes_, sizeof(config.x_size_tbl));
 	memcpy(config.y_size_tbl, ySizes_, sizeof(config.y_size_tbl));
+	config.config_width = 0;
+	config.config_height = 0;
 
 	params->module_en_update |= RKISP1_CIF_ISP_MODULE_LSC;
 	params->module_ens |= RKISP1_CIF_ISP_MODULE_LSC;
@@ -211,7 +234,7 @@ void LensShadingCorrection::copyTable(rkisp1_cif_isp_lsc_config &config,
 /*
  * Interpolate LSC parameters based on color temperature value.
  */
-void LensShadingCorrection::interpolateTable(rkisp1_cif_isp_lsc_config &config,
+void LensShadingCorrection::interpolateTable(Components &set,
 					     const Components &set0,
 					     const Components &set1,
 					     const uint32_t ct)
@@ -219,27 +242,99 @@ void LensShadingCorrection::interpolateTable(rkisp1_cif_isp_lsc_config &config,
 	double coeff0 = (set1.ct - ct) / static_cast<double>(set1.ct - set0.ct);
 	double coeff1 = (ct - set0.ct) / static_cast<double>(set1.ct - set0.ct);
 
-	for (unsigned int i = 0; i < RKISP1_CIF_ISP_LSC_SAMPLES_MAX; ++i) {
-		for (unsigned int j = 0; j < RKISP1_CIF_ISP_LSC_SAMPLES_MAX; ++j) {
-			unsigned int sample = i * RKISP1_CIF_ISP_LSC_SAMPLES_MAX + j;
+	auto interpolate = [&](std::vector<uint16_t> &table,
+			       const std::vector<uint16_t> &table0,
+			       const std::vector<uint16_t> &table1) {
+		table.resize(table0.size());
+		for (unsigned int i = 0; i < table0.size(); ++i)
+			table[i] = table0[i] * coeff0 + table1[i] * coeff1;
+	};
+
+	set.ct = ct;
+	interpolate(set.r, set0.r, set1.r);
+	interpolate(set.gr, set0.gr, set1.gr);
+	interpolate(set.gb, set0.gb, set1.gb);
+	interpolate(set.b, set0.b, set1.b);
+}
 
-			config.r_data_tbl[i][j] =
-				set0.r[sample] * coeff0 +
-				set1.r[sample] * coeff1;
+/*
+ * Select the tables for a color temperature, rounding to the nearest set or
+ * interpolating between the neighbouring sets. Interpolated tables are cached.
+ */
+const LensShadingCorrection::Components &
+LensShadingCorrection::tableForCt(uint32_t ct)
+{
+	/*
+	 * The color temperature matches exactly one of the available LSC tables.
+	 */
+	auto iter = sets_.find(ct);
+	if (iter != sets_.end())
+		return iter->second;
 
-			config.gr_data_tbl[i][j] =
-				set0.gr[sample] * coeff0 +
-				set1.gr[sample] * coeff1;
+	/* No shortcuts left; we need to round or interpolate */
+	iter = sets_.upper_bound(ct);
+	const Components &set1 = iter->second;
+	const Components &set0 = (--iter)->second;
+	uint32_t ct0 = set0.ct;
+	uint32_t ct1 = set1.ct;
+	uint32_t diff0 = ct - ct0;
+	uint32_t diff1 = ct1 - ct;
+	static constexpr double kThreshold = 0.1;
+	float threshold = kThreshold * (ct1 - ct0);
 
-			config.gb_data_tbl[i][j] =
-				set0.gb[sample] * coeff0 +
-				set1.gb[sample] * coeff1;
+	if (diff0 < threshold || diff1 < threshold) {
+		const Components &set = diff0 < diff1 ? set0 : set1;
+		LOG(RkISP1Lsc, Debug) << "using LSC table for " << set.ct;
+		return set;
+	}
 
-			config.b_data_tbl[i][j] =
-				set0.b[sample] * coeff0 +
-				set1.b[sample] * coeff1;
-		}
+	auto cached = std::find_if(cache_.begin(), cache_.end(),
+				   [ct](const Components &set) {
+					   return set.ct == ct;
+				   });
+	if (cached != cache_.end()) {
+		cache_.splice(cache_.begin(), cache_, cached);
+		return cache_.front();
 	}
+
+	/*
+	 * ct is not within 10% of the difference between the neighbouring
+	 * color temperatures, so we need to interpolate. Recycle the least
+	 * recently used entry when the cache is full.
+	 */
+	LOG(RkISP1Lsc, Debug)
+		<< "ct is " << ct << ", interpolating between "
+		<< ct0 << " and " << ct1;
+
+	if (cache_.size() < kCacheSize)
+		cache_.emplace_front();
+	else
+		cache_.splice(cache_.begin(), cache_, std::prev(cache_.end()));
+
+	interpolateTable(cache_.front(), set0, set1, ct);
+	return cache_.front();
+}
+
+/*
+ * Check if the tables differ significantly from the applied tables.
+ */
+bool LensShadingCorrection::tableChanged(const Components &set) const
+{
+	if (applied_.r.empty())
+		return true;
+
+	auto changed = [](const std::vector<uint16_t> &table,
+			  const std::vector<uint16_t> &applied) {
+		for (unsigned int i = 0; i < table.size(); ++i) {
+			if (std::abs(table[i] - applied[i]) >=
+			    static_cast<int>(kUpdateThreshold))
+				return true;
+		}
+		return false;
+	};
+
+	return changed(set.r, applied_.r) || changed(set.gr, applied_.gr) ||
+	       changed(set.gb, applied_.gb) || changed(set.b, applied_.b);
 }
 
 /**
@@ -270,6 +365,7 @@ void LensShadingCorrection::prepare(IPAContext &context,
 	}
 
 	uint32_t ct = context.activeState.awb.temperatureK;
+	ct = (ct + kCtQuantum / 2) / kCtQuantum * kCtQuantum;
 	ct = std::clamp(ct, sets_.cbegin()->first, sets_.crbegin()->first);
 
 	/*
@@ -294,45 +390,21 @@ void LensShadingCorrection::prepare(IPAContext &context,
 	    (lastCt_.adjusted <= ct && ct <= lastCt_.original))
 		return;
 
-	setParameters(params);
+	const Components &set = tableForCt(ct);
+	lastCt_ = { ct, set.ct };
 
 	/*
-	 * The color temperature matches exactly one of the available LSC tables.
+	 * Skip reprogramming the LSC when the tables are close enough to the
+	 * applied ones. The comparison is against the applied tables, not the
+	 * tables selected for the previous frame, so small changes can't
+	 * accumulate.
 	 */
-	if (sets_.count(ct)) {
-		copyTable(config, sets_[ct]);
-		lastCt_ = { ct, ct };
+	if (!tableChanged(set))
 		return;
-	}
 
-	/* No shortcuts left; we need to round or interpolate */
-	auto iter = sets_.upper_bound(ct);
-	const Components &set1 = iter->second;
-	const Components &set0 = (--iter)->second;
-	uint32_t ct0 = set0.ct;
-	uint32_t ct1 = set1.ct;
-	uint32_t diff0 = ct - ct0;
-	uint32_t diff1 = ct1 - ct;
-	static constexpr double kThreshold = 0.1;
-	float threshold = kThreshold * (ct1 - ct0);
-
-	if (diff0 < threshold || diff1 < threshold) {
-		const Components &set = diff0 < diff1 ? set0 : set1;
-		LOG(RkISP1Lsc, Debug) << "using LSC table for " << set.ct;
-		copyTable(config, set);
-		lastCt_ = { ct, set.ct };
-		return;
-	}
-
-	/*
-	 * ct is not within 10% of the difference between the neighbouring
-	 * color temperatures, so we need to interpolate.
-	 */
-	LOG(RkISP1Lsc, Debug)
-		<< "ct is " << ct << ", interpolating between "
-		<< ct0 << " and " << ct1;
-	interpolateTable(config, set0, set1, ct);
-	lastCt_ = { ct, ct };
+	setParameters(params);
+	copyTable(config, set);
+	applied_ = set;
 }
 
 REGISTER_IPA_ALGORITHM(LensShadingCorrection, "LensShadingCorrection")
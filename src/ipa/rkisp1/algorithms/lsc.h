@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <list>
 #include <map>
 
 #include "algorithm.h"
@@ -38,11 +39,14 @@ private:
 
 	void setParameters(rkisp1_params_cfg *params);
 	void copyTable(rkisp1_cif_isp_lsc_config &config, const Components &set0);
-	void interpolateTable(rkisp1_cif_isp_lsc_config &config,
-			      const Components &set0, const Components &set1,
-			      const uint32_t ct);
+	void interpolateTable(Components &set, const Components &set0,
+			      const Components &set1, const uint32_t ct);
+	const Components &tableForCt(uint32_t ct);
+	bool tableChanged(const Components &set) const;
 
 	std::map<uint32_t, Components> sets_;
+	std::list<Components> cache_;
+	Components applied_;
 	std::vector<double> xSize_;
 	std::vector<double> ySize_;
 	uint16_t xGrad_[RKISP1_CIF_ISP_LSC_SECTORS_TBL_SIZE];
@@ -333,6 +333,57 @@ namespace libcamera::ipa::rkisp1 {
  * \brief Analogue gain multiplier
  */
 
+/**
+ * \struct IPAStatistics
+ * \brief Statistics of the frame being processed, decoded for the algorithms
+ *
+ * The statistics buffer produced by the ISP is decoded once per frame by the
+ * IPA module before running the process() function of the algorithms, which
+ * then read the decoded values instead of parsing the raw rkisp1_stat_buffer
+ * themselves. The structure is reused for every frame, to avoid reallocating
+ * its storage.
+ *
+ * The decoded statistics are not updated in raw capture mode, when the ISP is
+ * bypassed and no statistics buffer is provided. Algorithms shall check the
+ * statistics buffer passed to their process() function before reading them.
+ */
+
+/**
+ * \var IPAStatistics::ae
+ * \brief Auto-exposure statistics
+ *
+ * \var IPAStatistics::ae.means
+ * \brief Mean luminance of the auto-exposure cells, in the [0, 255] range
+ *
+ * \var IPAStatistics::ae.numCells
+ * \brief Number of valid entries in the \a means array
+ */
+
+/**
+ * \var IPAStatistics::hist
+ * \brief Histogram statistics
+ *
+ * \var IPAStatistics::hist.histogram
+ * \brief Cumulative histogram of the frame
+ */
+
+/**
+ * \var IPAStatistics::awb
+ * \brief Auto white balance statistics
+ *
+ * The AWB means are measured in the RGB or YCbCr space depending on the mode
+ * configured by the AWB algorithm.
+ *
+ * \var IPAStatistics::awb.meanYOrG
+ * \brief Mean of the Y or G component
+ *
+ * \var IPAStatistics::awb.meanCbOrB
+ * \brief Mean of the Cb or B component
+ *
+ * \var IPAStatistics::awb.meanCrOrR
+ * \brief Mean of the Cr or R component
+ */
+
 /**
  * \struct IPAContext
  * \brief Global IPA context data shared between all algorithms
@@ -345,6 +396,9 @@ namespace libcamera::ipa::rkisp1 {
  *
  * \var IPAContext::frameContexts
  * \brief Ring buffer of per-frame contexts
+ *
+ * \var IPAContext::stats
+ * \brief The decoded statistics of the frame being processed
  */
 
 } /* namespace libcamera::ipa::rkisp1 */
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <array>
+
 #include <linux/rkisp1-config.h>
 
 #include <libcamera/base/utils.h>
@@ -15,6 +17,7 @@
 #include <libcamera/geometry.h>
 
 #include <libipa/fc_queue.h>
+#include <libipa/histogram.h>
 
 namespace libcamera {
 
@@ -142,11 +145,30 @@ struct IPAFrameContext : public FrameContext {
 	} sensor;
 };
 
+struct IPAStatistics {
+	struct {
+		std::array<float, RKISP1_CIF_ISP_AE_MEAN_MAX> means;
+		unsigned int numCells;
+	} ae;
+
+	struct {
+		Histogram histogram;
+	} hist;
+
+	struct {
+		double meanYOrG;
+		double meanCbOrB;
+		double meanCrOrR;
+	} awb;
+};
+
 struct IPAContext {
 	IPASessionConfiguration configuration;
 	IPAActiveState activeState;
 
 	FCQueue<IPAFrameContext> frameContexts;
+
+	IPAStatistics stats;
 };
 
 } /* namespace ipa::rkisp1 */
@@ -6,10 +6,18 @@
  */
 
 #include <algorithm>
+#include <bitset>
 #include <math.h>
 #include <queue>
 #include <stdint.h>
 #include <string.h>
+#include <thread>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include <linux/rkisp1-config.h>
 #include <linux/v4l2-controls.h>
@@ -75,6 +83,7 @@ private:
 			    const ControlInfoMap &sensorControls,
 			    ControlInfoMap *ipaControls);
 	void setControls(unsigned int frame);
+	void decodeStats(const rkisp1_stat_buffer *stats);
 
 	std::map<unsigned int, FrameBuffer> buffers_;
 	std::map<unsigned int, MappedFrameBuffer> mappedBuffers_;
@@ -83,6 +92,7 @@ private:
 
 	/* revision-specific data */
 	rkisp1_cif_isp_version hwRevision_;
+	unsigned int hwAeMeanMax_;
 	unsigned int hwHistBinNMax_;
 	unsigned int hwGammaOutMaxSamples_;
 	unsigned int hwHistogramWeightGridsSize_;
@@ -92,6 +102,9 @@ private:
 
 	/* Local parameter storage */
 	struct IPAContext context_;
+
+	/* Per-frame metadata, reused for every frame */
+	ControlList metadata_;
 };
 
 namespace {
@@ -108,10 +121,45 @@ const ControlInfoMap::Map rkisp1Controls{
 	{ &controls::draft::NoiseReductionMode, ControlInfo(controls::draft::NoiseReductionModeValues) },
 };
 
+/* Convert an array of 8-bit unsigned values to floats, 16 values at a time. */
+void convertMeans(const uint8_t *src, float *dst, unsigned int count)
+{
+	unsigned int i = 0;
+
+#if defined(__ARM_NEON)
+	for (; i + 16 <= count; i += 16) {
+		uint8x16_t v = vld1q_u8(src + i);
+		uint16x8_t lo = vmovl_u8(vget_low_u8(v));
+		uint16x8_t hi = vmovl_u8(vget_high_u8(v));
+
+		vst1q_f32(dst + i, vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo))));
+		vst1q_f32(dst + i + 4, vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo))));
+		vst1q_f32(dst + i + 8, vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi))));
+		vst1q_f32(dst + i + 12, vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi))));
+	}
+#elif defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; i + 16 <= count; i += 16) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+		__m128i lo = _mm_unpacklo_epi8(v, zero);
+		__m128i hi = _mm_unpackhi_epi8(v, zero);
+
+		_mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+		_mm_storeu_ps(dst + i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+		_mm_storeu_ps(dst + i + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+		_mm_storeu_ps(dst + i + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+	}
+#endif
+
+	for (; i < count; i++)
+		dst[i] = src[i];
+}
+
 } /* namespace */
 
 IPARkISP1::IPARkISP1()
-	: context_({ {}, {}, { kMaxFrameContexts } })
+	: context_({ {}, {}, { kMaxFrameContexts } }), metadata_(controls::controls)
 {
 }
 
@@ -128,11 +176,13 @@ int IPARkISP1::init(const IPASettings &settings, unsigned int hwRevision,
 	/* \todo Add support for other revisions */
 	switch (hwRevision) {
 	case RKISP1_V10:
+		hwAeMeanMax_ = RKISP1_CIF_ISP_AE_MEAN_MAX_V10;
 		hwHistBinNMax_ = RKISP1_CIF_ISP_HIST_BIN_N_MAX_V10;
 		hwGammaOutMaxSamples_ = RKISP1_CIF_ISP_GAMMA_OUT_MAX_SAMPLES_V10;
 		hwHistogramWeightGridsSize_ = RKISP1_CIF_ISP_HISTOGRAM_WEIGHT_GRIDS_SIZE_V10;
 		break;
 	case RKISP1_V12:
+		hwAeMeanMax_ = RKISP1_CIF_ISP_AE_MEAN_MAX_V12;
 		hwHistBinNMax_ = RKISP1_CIF_ISP_HIST_BIN_N_MAX_V12;
 		hwGammaOutMaxSamples_ = RKISP1_CIF_ISP_GAMMA_OUT_MAX_SAMPLES_V12;
 		hwHistogramWeightGridsSize_ = RKISP1_CIF_ISP_HISTOGRAM_WEIGHT_GRIDS_SIZE_V12;
@@ -191,6 +241,8 @@ int IPARkISP1::init(const IPASettings &settings, unsigned int hwRevision,
 	if (ret)
 		return ret;
 
+	enableConcurrency(std::max(std::thread::hardware_concurrency(), 1u) - 1);
+
 	/* Initialize controls. */
 	updateControls(sensorInfo, sensorControls, ipaControls);
 
@@ -331,12 +383,24 @@ void IPARkISP1::fillParamsBuffer(const uint32_t frame, const uint32_t bufferId)
 		reinterpret_cast<rkisp1_params_cfg *>(
 			mappedBuffers_.at(bufferId).planes()[0].data());
 
-	/* Prepare parameters buffer. */
-	memset(params, 0, sizeof(*params));
+	/*
+	 * Prepare parameters buffer. The driver only applies the blocks
+	 * flagged in the update masks, and algorithms fully initialize the
+	 * blocks they flag, so clearing the masks is enough to reuse the
+	 * buffer without touching the configuration of unchanged blocks.
+	 */
+	params->module_en_update = 0;
+	params->module_ens = 0;
+	params->module_cfg_update = 0;
 
 	for (auto const &algo : algorithms())
 		algo->prepare(context_, frame, frameContext, params);
 
+	LOG(IPARkISP1, Debug)
+		<< "Frame " << frame << ": updating "
+		<< std::bitset<32>(params->module_cfg_update).count()
+		<< " ISP blocks";
+
 	paramsBufferReady.emit(frame);
 }
 
@@ -359,18 +423,23 @@ void IPARkISP1::processStatsBuffer(const uint32_t frame, const uint32_t bufferId
 	frameContext.sensor.gain =
 		camHelper_->gain(sensorControls.get(V4L2_CID_ANALOGUE_GAIN).get<int32_t>());
 
-	ControlList metadata(controls::controls);
+	/*
+	 * Reuse the metadata list across frames, clearing it keeps its storage
+	 * allocated.
+	 */
+	metadata_.clear();
+
+	if (stats)
+		decodeStats(stats);
 
-	for (auto const &a : algorithms()) {
-		Algorithm *algo = static_cast<Algorithm *>(a.get());
-		if (algo->disabled_)
-			continue;
-		algo->process(context_, frame, frameContext, stats, metadata);
-	}
+	process(context_, frame, frameContext, stats, metadata_,
+		[](const libcamera::ipa::Algorithm<Module> &algo) {
+			return !static_cast<const Algorithm &>(algo).disabled_;
+		});
 
 	setControls(frame);
 
-	metadataReady.emit(frame, metadata);
+	metadataReady.emit(frame, metadata_);
 }
 
 void IPARkISP1::updateControls(const IPACameraSensorInfo &sensorInfo,
@@ -449,6 +518,28 @@ void IPARkISP1::setControls(unsigned int frame)
 	setSensorControls.emit(frame, ctrls);
 }
 
+/*
+ * Decode the statistics buffer once for all algorithms. The AE means are
+ * converted to floating point and the histogram is cumulated, as the AGC
+ * otherwise walks over the raw values for every iteration of its luminance
+ * estimation.
+ */
+void IPARkISP1::decodeStats(const rkisp1_stat_buffer *stats)
+{
+	const rkisp1_cif_isp_stat *params = &stats->params;
+	IPAStatistics &decoded = context_.stats;
+
+	convertMeans(params->ae.exp_mean, decoded.ae.means.data(), hwAeMeanMax_);
+	decoded.ae.numCells = hwAeMeanMax_;
+
+	decoded.hist.histogram.update({ params->hist.hist_bins, hwHistBinNMax_ });
+
+	const rkisp1_cif_isp_awb_meas &mean = params->awb.awb_mean[0];
+	decoded.awb.meanYOrG = mean.mean_y_or_g;
+	decoded.awb.meanCbOrB = mean.mean_cb_or_b;
+	decoded.awb.meanCrOrR = mean.mean_cr_or_r;
+}
+
 } /* namespace ipa::rkisp1 */
 
 /*
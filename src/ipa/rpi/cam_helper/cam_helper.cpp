@@ -42,8 +42,18 @@ CamHelper *CamHelper::create(std::string const &camName)
 	 * initialisers.
 	 */
 	for (auto &p : camHelpers()) {
-		if (camName.find(p.first) != std::string::npos)
-			return p.second();
+		if (camName.find(p.first) == std::string::npos)
+			continue;
+
+		CamHelper *helper = p.second();
+
+		/*
+		 * Share the analogue gain model with the libipa camera sensor
+		 * helpers, for CamHelpers that don't implement their own.
+		 */
+		helper->sensorHelper_ = ipa::CameraSensorHelperFactoryBase::create(p.first);
+
+		return helper;
 	}
 
 	return nullptr;
@@ -64,6 +74,33 @@ void CamHelper::prepare(Span<const uint8_t> buffer,
 	parseEmbeddedData(buffer, metadata);
 }
 
+/*
+ * Parse an embedded data buffer as soon as it is available, before the
+ * corresponding image is ready. The result is consumed by parseEmbeddedData()
+ * when prepare() is called for the same buffer, keeping the register parsing
+ * off the per-frame critical path.
+ */
+void CamHelper::preparseEmbeddedData(Span<const uint8_t> buffer)
+{
+	if (buffer.empty())
+		return;
+
+	Metadata parsedMetadata;
+	if (parseRegisters(buffer, parsedMetadata))
+		preparsed_[buffer.data()] = std::move(parsedMetadata);
+	else
+		preparsed_[buffer.data()] = std::nullopt;
+}
+
+/*
+ * Drop the preparsed embedded data, to be called when the buffers are unmapped
+ * or when streaming restarts.
+ */
+void CamHelper::discardEmbeddedData()
+{
+	preparsed_.clear();
+}
+
 void CamHelper::process([[maybe_unused]] StatisticsPtr &stats,
 			[[maybe_unused]] Metadata &metadata)
 {
@@ -156,6 +193,18 @@ void CamHelper::setCameraMode(const CameraMode &mode)
 	}
 }
 
+uint32_t CamHelper::gainCode(double gain) const
+{
+	ASSERT(sensorHelper_);
+	return sensorHelper_->gainCode(gain);
+}
+
+double CamHelper::gain(uint32_t gainCode) const
+{
+	ASSERT(sensorHelper_);
+	return sensorHelper_->gain(gainCode);
+}
+
 void CamHelper::getDelays(int &exposureDelay, int &gainDelay,
 			  int &vblankDelay, int &hblankDelay) const
 {
@@ -169,6 +218,19 @@ void CamHelper::getDelays(int &exposureDelay, int &gainDelay,
 	hblankDelay = 2;
 }
 
+unsigned int CamHelper::lensDelay() const
+{
+	/*
+	 * The number of frames between writing a new lens position at frame
+	 * start and the first frame exposed entirely with the lens settled at
+	 * that position. The exposure of the next frame has usually already
+	 * started when the frame start event is received, so a typical VCM
+	 * needs two frames. Modules with a faster or slower lens driver, or
+	 * with a longer settling time, should over-ride this function.
+	 */
+	return 2;
+}
+
 bool CamHelper::sensorEmbeddedDataPresent() const
 {
 	return false;
@@ -215,18 +277,24 @@ unsigned int CamHelper::mistrustFramesModeSwitch() const
 void CamHelper::parseEmbeddedData(Span<const uint8_t> buffer,
 				  Metadata &metadata)
 {
-	MdParser::RegisterMap registers;
 	Metadata parsedMetadata;
 
 	if (buffer.empty())
 		return;
 
-	if (parser_->parse(buffer, registers) != MdParser::Status::OK) {
-		LOG(IPARPI, Error) << "Embedded data buffer parsing failed";
+	auto it = preparsed_.find(buffer.data());
+	if (it != preparsed_.end()) {
+		std::optional<Metadata> preparsed = std::move(it->second);
+		preparsed_.erase(it);
+
+		if (!preparsed)
+			return;
+
+		parsedMetadata = std::move(*preparsed);
+	} else if (!parseRegisters(buffer, parsedMetadata)) {
 		return;
 	}
 
-	populateMetadata(registers, parsedMetadata);
 	metadata.merge(parsedMetadata);
 
 	/*
@@ -235,8 +303,8 @@ void CamHelper::parseEmbeddedData(Span<const uint8_t> buffer,
 	 * Fetch it first in case any other fields were set meaningfully.
 	 */
 	DeviceStatus deviceStatus, parsedDeviceStatus;
-	if (metadata.get("device.status", deviceStatus) ||
-	    parsedMetadata.get("device.status", parsedDeviceStatus)) {
+	if (metadata.get(DeviceStatusTag, deviceStatus) ||
+	    parsedMetadata.get(DeviceStatusTag, parsedDeviceStatus)) {
 		LOG(IPARPI, Error) << "DeviceStatus not found";
 		return;
 	}
@@ -250,7 +318,21 @@ void CamHelper::parseEmbeddedData(Span<const uint8_t> buffer,
 
 	LOG(IPARPI, Debug) << "Metadata updated - " << deviceStatus;
 
-	metadata.set("device.status", deviceStatus);
+	metadata.set(DeviceStatusTag, deviceStatus);
+}
+
+bool CamHelper::parseRegisters(Span<const uint8_t> buffer,
+			       Metadata &metadata) const
+{
+	MdParser::RegisterMap registers;
+
+	if (parser_->parse(buffer, registers) != MdParser::Status::OK) {
+		LOG(IPARPI, Error) << "Embedded data buffer parsing failed";
+		return false;
+	}
+
+	populateMetadata(registers, metadata);
+	return true;
 }
 
 void CamHelper::populateMetadata([[maybe_unused]] const MdParser::RegisterMap &registers,
@@ -6,7 +6,9 @@
  */
 #pragma once
 
+#include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 
@@ -20,6 +22,8 @@
 
 #include "libcamera/internal/v4l2_videodevice.h"
 
+#include "libipa/camera_sensor_helper.h"
+
 namespace RPiController {
 
 /*
@@ -34,7 +38,8 @@ namespace RPiController {
  *
  * The ability to convert between number of lines of exposure and actual
  * exposure time, and to convert between the sensor's gain codes and actual
- * gains.
+ * gains. Unless a helper overrides them, gain conversions use the analogue
+ * gain model of the libipa CameraSensorHelper registered under the same name.
  *
  * A function to return the number of frames of delay between updating exposure,
  * analogue gain and vblanking, and for the changes to take effect. For many
@@ -78,6 +83,8 @@ public:
 	void setCameraMode(const CameraMode &mode);
 	virtual void prepare(libcamera::Span<const uint8_t> buffer,
 			     Metadata &metadata);
+	void preparseEmbeddedData(libcamera::Span<const uint8_t> buffer);
+	void discardEmbeddedData();
 	virtual void process(StatisticsPtr &stats, Metadata &metadata);
 	virtual uint32_t exposureLines(const libcamera::utils::Duration exposure,
 				       const libcamera::utils::Duration lineLength) const;
@@ -89,10 +96,11 @@ public:
 	libcamera::utils::Duration hblankToLineLength(uint32_t hblank) const;
 	uint32_t lineLengthToHblank(const libcamera::utils::Duration &duration) const;
 	libcamera::utils::Duration lineLengthPckToDuration(uint32_t lineLengthPck) const;
-	virtual uint32_t gainCode(double gain) const = 0;
-	virtual double gain(uint32_t gainCode) const = 0;
+	virtual uint32_t gainCode(double gain) const;
+	virtual double gain(uint32_t gainCode) const;
 	virtual void getDelays(int &exposureDelay, int &gainDelay,
 			       int &vblankDelay, int &hblankDelay) const;
+	virtual unsigned int lensDelay() const;
 	virtual bool sensorEmbeddedDataPresent() const;
 	virtual double getModeSensitivity(const CameraMode &mode) const;
 	virtual unsigned int hideFramesStartup() const;
@@ -110,11 +118,23 @@ protected:
 	CameraMode mode_;
 
 private:
+	bool parseRegisters(libcamera::Span<const uint8_t> buffer,
+			    Metadata &metadata) const;
+
 	/*
 	 * Smallest difference between the frame length and integration time,
 	 * in units of lines.
 	 */
 	unsigned int frameIntegrationDiff_;
+
+	/* The libipa helper implementing the sensor analogue gain model. */
+	std::unique_ptr<libcamera::ipa::CameraSensorHelper> sensorHelper_;
+
+	/*
+	 * Embedded data parsed ahead of prepare(), indexed by buffer memory.
+	 * An empty entry records a parsing failure.
+	 */
+	std::map<const uint8_t *, std::optional<Metadata>> preparsed_;
 };
 
 /*
@@ -42,8 +42,6 @@ class CamHelperImx219 : public CamHelper
 {
 public:
 	CamHelperImx219();
-	uint32_t gainCode(double gain) const override;
-	double gain(uint32_t gainCode) const override;
 	unsigned int mistrustFramesModeSwitch() const override;
 	bool sensorEmbeddedDataPresent() const override;
 
@@ -67,16 +65,6 @@ CamHelperImx219::CamHelperImx219()
 {
 }
 
-uint32_t CamHelperImx219::gainCode(double gain) const
-{
-	return (uint32_t)(256 - 256 / gain);
-}
-
-double CamHelperImx219::gain(uint32_t gainCode) const
-{
-	return 256.0 / (256 - gainCode);
-}
-
 unsigned int CamHelperImx219::mistrustFramesModeSwitch() const
 {
 	/*
@@ -104,7 +92,7 @@ void CamHelperImx219::populateMetadata(const MdParser::RegisterMap &registers,
 	deviceStatus.analogueGain = gain(registers.at(gainReg));
 	deviceStatus.frameLength = registers.at(frameLengthHiReg) * 256 + registers.at(frameLengthLoReg);
 
-	metadata.set("device.status", deviceStatus);
+	metadata.set(DeviceStatusTag, deviceStatus);
 }
 
 static CamHelper *create()
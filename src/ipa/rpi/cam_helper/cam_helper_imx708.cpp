@@ -48,8 +48,6 @@ class CamHelperImx708 : public CamHelper
 {
 public:
 	CamHelperImx708();
-	uint32_t gainCode(double gain) const override;
-	double gain(uint32_t gain_code) const override;
 	void prepare(libcamera::Span<const uint8_t> buffer, Metadata &metadata) override;
 	void process(StatisticsPtr &stats, Metadata &metadata) override;
 	std::pair<uint32_t, uint32_t> getBlanking(Duration &exposure, Duration minFrameDuration,
@@ -95,16 +93,6 @@ CamHelperImx708::CamHelperImx708()
 {
 }
 
-uint32_t CamHelperImx708::gainCode(double gain) const
-{
-	return static_cast<uint32_t>(1024 - 1024 / gain);
-}
-
-double CamHelperImx708::gain(uint32_t gain_code) const
-{
-	return 1024.0 / (1024 - gain_code);
-}
-
 void CamHelperImx708::prepare(libcamera::Span<const uint8_t> buffer, Metadata &metadata)
 {
 	MdParser::RegisterMap registers;
@@ -112,7 +100,7 @@ void CamHelperImx708::prepare(libcamera::Span<const uint8_t> buffer, Metadata &m
 
 	LOG(IPARPI, Debug) << "Embedded buffer size: " << buffer.size();
 
-	if (metadata.get("device.status", deviceStatus)) {
+	if (metadata.get(DeviceStatusTag, deviceStatus)) {
 		LOG(IPARPI, Error) << "DeviceStatus not found from DelayedControls";
 		return;
 	}
@@ -154,10 +142,10 @@ void CamHelperImx708::prepare(libcamera::Span<const uint8_t> buffer, Metadata &m
 	if (deviceStatus.frameLength > frameLengthMax) {
 		DeviceStatus parsedDeviceStatus;
 
-		metadata.get("device.status", parsedDeviceStatus);
+		metadata.get(DeviceStatusTag, parsedDeviceStatus);
 		parsedDeviceStatus.shutterSpeed = deviceStatus.shutterSpeed;
 		parsedDeviceStatus.frameLength = deviceStatus.frameLength;
-		metadata.set("device.status", parsedDeviceStatus);
+		metadata.set(DeviceStatusTag, parsedDeviceStatus);
 
 		LOG(IPARPI, Debug) << "Metadata updated for long exposure: "
 				   << parsedDeviceStatus;
@@ -261,7 +249,7 @@ void CamHelperImx708::populateMetadata(const MdParser::RegisterMap &registers,
 	deviceStatus.frameLength = registers.at(frameLengthHiReg) * 256 + registers.at(frameLengthLoReg);
 	deviceStatus.sensorTemperature = std::clamp<int8_t>(registers.at(temperatureReg), -20, 80);
 
-	metadata.set("device.status", deviceStatus);
+	metadata.set(DeviceStatusTag, deviceStatus);
 }
 
 bool CamHelperImx708::parsePdafData(const uint8_t *ptr, size_t len,
@@ -15,8 +15,6 @@ class CamHelperOv5647 : public CamHelper
 {
 public:
 	CamHelperOv5647();
-	uint32_t gainCode(double gain) const override;
-	double gain(uint32_t gainCode) const override;
 	void getDelays(int &exposureDelay, int &gainDelay,
 		       int &vblankDelay, int &hblankDelay) const override;
 	unsigned int hideFramesStartup() const override;
@@ -42,16 +40,6 @@ CamHelperOv5647::CamHelperOv5647()
 {
 }
 
-uint32_t CamHelperOv5647::gainCode(double gain) const
-{
-	return static_cast<uint32_t>(gain * 16.0);
-}
-
-double CamHelperOv5647::gain(uint32_t gainCode) const
-{
-	return static_cast<double>(gainCode) / 16.0;
-}
-
 void CamHelperOv5647::getDelays(int &exposureDelay, int &gainDelay,
 				int &vblankDelay, int &hblankDelay) const
 {
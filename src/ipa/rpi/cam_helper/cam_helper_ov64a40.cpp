@@ -16,8 +16,6 @@ class CamHelperOv64a40 : public CamHelper
 {
 public:
 	CamHelperOv64a40();
-	uint32_t gainCode(double gain) const override;
-	double gain(uint32_t gainCode) const override;
 	void getDelays(int &exposureDelay, int &gainDelay,
 		       int &vblankDelay, int &hblankDelay) const override;
 	double getModeSensitivity(const CameraMode &mode) const override;
@@ -35,16 +33,6 @@ CamHelperOv64a40::CamHelperOv64a40()
 {
 }
 
-uint32_t CamHelperOv64a40::gainCode(double gain) const
-{
-	return static_cast<uint32_t>(gain * 128.0);
-}
-
-double CamHelperOv64a40::gain(uint32_t gainCode) const
-{
-	return static_cast<double>(gainCode) / 128.0;
-}
-
 void CamHelperOv64a40::getDelays(int &exposureDelay, int &gainDelay,
 				 int &vblankDelay, int &hblankDelay) const
 {
@@ -15,8 +15,6 @@ class CamHelperOv9281 : public CamHelper
 {
 public:
 	CamHelperOv9281();
-	uint32_t gainCode(double gain) const override;
-	double gain(uint32_t gainCode) const override;
 	void getDelays(int &exposureDelay, int &gainDelay,
 		       int &vblankDelay, int &hblankDelay) const override;
 
@@ -38,16 +36,6 @@ CamHelperOv9281::CamHelperOv9281()
 {
 }
 
-uint32_t CamHelperOv9281::gainCode(double gain) const
-{
-	return static_cast<uint32_t>(gain * 16.0);
-}
-
-double CamHelperOv9281::gain(uint32_t gainCode) const
-{
-	return static_cast<double>(gainCode) / 16.0;
-}
-
 void CamHelperOv9281::getDelays(int &exposureDelay, int &gainDelay,
 				int &vblankDelay, int &hblankDelay) const
 {
@@ -6,9 +6,10 @@
  */
 #pragma once
 
+#include <array>
 #include <initializer_list>
-#include <map>
 #include <optional>
+#include <stdexcept>
 #include <stdint.h>
 
 #include <libcamera/base/span.h>
@@ -60,7 +61,63 @@ namespace RPiController {
 class MdParser
 {
 public:
-	using RegisterMap = std::map<uint32_t, uint32_t>;
+	/* Maximum number of registers a parser can be asked to find. */
+	static constexpr unsigned int MaxRegisters = 16;
+
+	/*
+	 * Register values found by a parser. The handful of registers a sensor
+	 * reports are stored in a flat array, so filling and looking up the map
+	 * on every frame never allocates memory.
+	 */
+	class RegisterMap
+	{
+	public:
+		RegisterMap()
+			: size_(0)
+		{
+		}
+
+		void clear()
+		{
+			size_ = 0;
+		}
+
+		unsigned int size() const
+		{
+			return size_;
+		}
+
+		void set(uint32_t reg, uint32_t value)
+		{
+			for (unsigned int i = 0; i < size_; i++) {
+				if (regs_[i] == reg) {
+					values_[i] = value;
+					return;
+				}
+			}
+
+			if (size_ == MaxRegisters)
+				throw std::length_error("RegisterMap full");
+
+			regs_[size_] = reg;
+			values_[size_++] = value;
+		}
+
+		uint32_t at(uint32_t reg) const
+		{
+			for (unsigned int i = 0; i < size_; i++) {
+				if (regs_[i] == reg)
+					return values_[i];
+			}
+
+			throw std::out_of_range("Register not found");
+		}
+
+	private:
+		std::array<uint32_t, MaxRegisters> regs_;
+		std::array<uint32_t, MaxRegisters> values_;
+		unsigned int size_;
+	};
 
 	/*
 	 * Parser status codes:
@@ -127,8 +184,6 @@ public:
 			       RegisterMap &registers) override;
 
 private:
-	/* Maps register address to offset in the buffer. */
-	using OffsetMap = std::map<uint32_t, std::optional<uint32_t>>;
 
 	/*
 	 * Note that error codes > 0 are regarded as non-fatal; codes < 0
@@ -149,7 +204,13 @@ private:
 
 	ParseStatus findRegs(libcamera::Span<const uint8_t> buffer);
 
-	OffsetMap offsets_;
+	/*
+	 * Addresses of the requested registers, and their offsets in the
+	 * buffer once found, stored at the same index.
+	 */
+	std::array<uint32_t, MaxRegisters> registers_;
+	std::array<std::optional<uint32_t>, MaxRegisters> offsets_;
+	unsigned int numRegisters_;
 };
 
 } /* namespace RPi */
@@ -5,6 +5,8 @@
  * md_parser_smia.cpp - SMIA specification based embedded data parser
  */
 
+#include <algorithm>
+
 #include <libcamera/base/log.h>
 #include "md_parser.h"
 
@@ -28,9 +30,16 @@ constexpr unsigned int RegValue = 0x5a;
 constexpr unsigned int RegSkip = 0x55;
 
 MdParserSmia::MdParserSmia(std::initializer_list<uint32_t> registerList)
+	: numRegisters_(0)
 {
-	for (auto r : registerList)
-		offsets_[r] = {};
+	for (uint32_t r : registerList) {
+		auto end = registers_.begin() + numRegisters_;
+		if (std::find(registers_.begin(), end, r) != end)
+			continue;
+
+		ASSERT(numRegisters_ < MaxRegisters);
+		registers_[numRegisters_++] = r;
+	}
 }
 
 MdParser::Status MdParserSmia::parse(libcamera::Span<const uint8_t> buffer,
@@ -43,8 +52,7 @@ MdParser::Status MdParserSmia::parse(libcamera::Span<const uint8_t> buffer,
 		 */
 		ASSERT(bitsPerPixel_);
 
-		for (const auto &kv : offsets_)
-			offsets_[kv.first] = {};
+		offsets_.fill({});
 
 		ParseStatus ret = findRegs(buffer);
 		/*
@@ -61,12 +69,12 @@ MdParser::Status MdParserSmia::parse(libcamera::Span<const uint8_t> buffer,
 
 	/* Populate the register values requested. */
 	registers.clear();
-	for (const auto &[reg, offset] : offsets_) {
-		if (!offset) {
+	for (unsigned int i = 0; i < numRegisters_; i++) {
+		if (!offsets_[i]) {
 			reset_ = true;
 			return NOTFOUND;
 		}
-		registers[reg] = buffer[offset.value()];
+		registers.set(registers_[i], buffer[*offsets_[i]]);
 	}
 
 	return OK;
@@ -74,7 +82,7 @@ MdParser::Status MdParserSmia::parse(libcamera::Span<const uint8_t> buffer,
 
 MdParserSmia::ParseStatus MdParserSmia::findRegs(libcamera::Span<const uint8_t> buffer)
 {
-	ASSERT(offsets_.size());
+	ASSERT(numRegisters_);
 
 	if (buffer[0] != LineStart)
 		return NoLineStart;
@@ -133,12 +141,13 @@ MdParserSmia::ParseStatus MdParserSmia::findRegs(libcamera::Span<const uint8_t>
 			else if (tag == RegSkip)
 				regNum++;
 			else if (tag == RegValue) {
-				auto reg = offsets_.find(regNum);
+				auto end = registers_.begin() + numRegisters_;
+				auto reg = std::find(registers_.begin(), end, regNum);
 
-				if (reg != offsets_.end()) {
-					offsets_[regNum] = currentOffset - 1;
+				if (reg != end) {
+					offsets_[reg - registers_.begin()] = currentOffset - 1;
 
-					if (++regsDone == offsets_.size())
+					if (++regsDone == numRegisters_)
 						return ParseOk;
 				}
 				regNum++;
@@ -138,6 +138,7 @@ int32_t IpaBase::init(const IPASettings &settings, const InitParams &params, Ini
 	result->sensorConfig.exposureDelay = exposureDelay;
 	result->sensorConfig.vblankDelay = vblankDelay;
 	result->sensorConfig.hblankDelay = hblankDelay;
+	result->sensorConfig.lensDelay = helper_->lensDelay();
 	result->sensorConfig.sensorMetadata = sensorMetadata;
 
 	/* Load the tuning file for this sensor. */
@@ -280,6 +281,9 @@ void IpaBase::start(const ControlList &controls, StartResult *result)
 
 	controller_.switchMode(mode_, &metadata);
 
+	/* Embedded data parsed before stopping is stale. */
+	helper_->discardEmbeddedData();
+
 	/* Reset the frame lengths queue state. */
 	lastTimeout_ = 0s;
 	frameLengths_.clear();
@@ -290,7 +294,7 @@ void IpaBase::start(const ControlList &controls, StartResult *result)
 	agcStatus.shutterTime = 0.0s;
 	agcStatus.analogueGain = 0.0;
 
-	metadata.get("agc.status", agcStatus);
+	metadata.get(RPiController::AgcStatusTag, agcStatus);
 	if (agcStatus.shutterTime && agcStatus.analogueGain) {
 		ControlList ctrls(sensorCtrls_);
 		applyAGC(&agcStatus, ctrls);
@@ -368,6 +372,16 @@ void IpaBase::unmapBuffers(const std::vector<unsigned int> &ids)
 
 		buffers_.erase(id);
 	}
+
+	helper_->discardEmbeddedData();
+}
+
+void IpaBase::parseEmbeddedData(uint32_t bufferId)
+{
+	auto it = buffers_.find(bufferId);
+	ASSERT(it != buffers_.end());
+
+	helper_->preparseEmbeddedData(it->second.planes()[0]);
 }
 
 void IpaBase::prepareIsp(const PrepareParams &params)
@@ -408,8 +422,8 @@ void IpaBase::prepareIsp(const PrepareParams &params)
 	AgcStatus agcStatus;
 	bool hdrChange = false;
 	RPiController::Metadata &delayedMetadata = rpiMetadata_[params.delayContext];
-	if (!delayedMetadata.get<AgcStatus>("agc.status", agcStatus)) {
-		rpiMetadata.set("agc.delayed_status", agcStatus);
+	if (!delayedMetadata.get<AgcStatus>(RPiController::AgcStatusTag, agcStatus)) {
+		rpiMetadata.set(RPiController::AgcDelayedStatusTag, agcStatus);
 		hdrChange = agcStatus.hdr.mode != hdrStatus_.mode;
 		hdrStatus_ = agcStatus.hdr;
 	}
@@ -485,7 +499,7 @@ void IpaBase::processStats(const ProcessParams &params)
 		controller_.process(statistics, &rpiMetadata);
 
 		struct AgcStatus agcStatus;
-		if (rpiMetadata.get("agc.status", agcStatus) == 0) {
+		if (rpiMetadata.get(RPiController::AgcStatusTag, agcStatus) == 0) {
 			ControlList ctrls(sensorCtrls_);
 			applyAGC(&agcStatus, ctrls);
 			setDelayedControls.emit(ctrls, ipaContext);
@@ -1273,7 +1287,7 @@ void IpaBase::fillDeviceStatus(const ControlList &sensorControls, unsigned int i
 
 	LOG(IPARPI, Debug) << "Metadata - " << deviceStatus;
 
-	rpiMetadata_[ipaContext].set("device.status", deviceStatus);
+	rpiMetadata_[ipaContext].set(RPiController::DeviceStatusTag, deviceStatus);
 }
 
 void IpaBase::reportMetadata(unsigned int ipaContext)
@@ -1286,7 +1300,7 @@ void IpaBase::reportMetadata(unsigned int ipaContext)
 	 * processed can be extracted and placed into the libcamera metadata
 	 * buffer, where an application could query it.
 	 */
-	DeviceStatus *deviceStatus = rpiMetadata.getLocked<DeviceStatus>("device.status");
+	DeviceStatus *deviceStatus = rpiMetadata.getLocked<DeviceStatus>(RPiController::DeviceStatusTag);
 	if (deviceStatus) {
 		libcameraMetadata_.set(controls::ExposureTime,
 				       deviceStatus->shutterSpeed.get<std::micro>());
@@ -1299,24 +1313,24 @@ void IpaBase::reportMetadata(unsigned int ipaContext)
 			libcameraMetadata_.set(controls::LensPosition, *deviceStatus->lensPosition);
 	}
 
-	AgcPrepareStatus *agcPrepareStatus = rpiMetadata.getLocked<AgcPrepareStatus>("agc.prepare_status");
+	AgcPrepareStatus *agcPrepareStatus = rpiMetadata.getLocked<AgcPrepareStatus>(RPiController::AgcPrepareStatusTag);
 	if (agcPrepareStatus) {
 		libcameraMetadata_.set(controls::AeLocked, agcPrepareStatus->locked);
 		libcameraMetadata_.set(controls::DigitalGain, agcPrepareStatus->digitalGain);
 	}
 
-	LuxStatus *luxStatus = rpiMetadata.getLocked<LuxStatus>("lux.status");
+	LuxStatus *luxStatus = rpiMetadata.getLocked<LuxStatus>(RPiController::LuxStatusTag);
 	if (luxStatus)
 		libcameraMetadata_.set(controls::Lux, luxStatus->lux);
 
-	AwbStatus *awbStatus = rpiMetadata.getLocked<AwbStatus>("awb.status");
+	AwbStatus *awbStatus = rpiMetadata.getLocked<AwbStatus>(RPiController::AwbStatusTag);
 	if (awbStatus) {
 		libcameraMetadata_.set(controls::ColourGains, { static_cast<float>(awbStatus->gainR),
 								static_cast<float>(awbStatus->gainB) });
 		libcameraMetadata_.set(controls::ColourTemperature, awbStatus->temperatureK);
 	}
 
-	BlackLevelStatus *blackLevelStatus = rpiMetadata.getLocked<BlackLevelStatus>("black_level.status");
+	BlackLevelStatus *blackLevelStatus = rpiMetadata.getLocked<BlackLevelStatus>(RPiController::BlackLevelStatusTag);
 	if (blackLevelStatus)
 		libcameraMetadata_.set(controls::SensorBlackLevels,
 				       { static_cast<int32_t>(blackLevelStatus->blackLevelR),
@@ -1349,7 +1363,7 @@ void IpaBase::reportMetadata(unsigned int ipaContext)
 		libcameraMetadata_.set(controls::FocusFoM, focusFoM);
 	}
 
-	CcmStatus *ccmStatus = rpiMetadata.getLocked<CcmStatus>("ccm.status");
+	CcmStatus *ccmStatus = rpiMetadata.getLocked<CcmStatus>(RPiController::CcmStatusTag);
 	if (ccmStatus) {
 		float m[9];
 		for (unsigned int i = 0; i < 9; i++)
@@ -1357,7 +1371,7 @@ void IpaBase::reportMetadata(unsigned int ipaContext)
 		libcameraMetadata_.set(controls::ColourCorrectionMatrix, m);
 	}
 
-	const AfStatus *afStatus = rpiMetadata.getLocked<AfStatus>("af.status");
+	const AfStatus *afStatus = rpiMetadata.getLocked<AfStatus>(RPiController::AfStatusTag);
 	if (afStatus) {
 		int32_t s, p;
 		switch (afStatus->state) {
@@ -1394,7 +1408,7 @@ void IpaBase::reportMetadata(unsigned int ipaContext)
 	 * delayed_status to be available, we use the HDR status that came out of the
 	 * switchMode call.
 	 */
-	const AgcStatus *agcStatus = rpiMetadata.getLocked<AgcStatus>("agc.delayed_status");
+	const AgcStatus *agcStatus = rpiMetadata.getLocked<AgcStatus>(RPiController::AgcDelayedStatusTag);
 	const HdrStatus &hdrStatus = agcStatus ? agcStatus->hdr : hdrStatus_;
 	if (!hdrStatus.mode.empty() && hdrStatus.mode != "Off") {
 		int32_t hdrMode = controls::HdrModeOff;
@@ -45,6 +45,7 @@ public:
 	void mapBuffers(const std::vector<IPABuffer> &buffers) override;
 	void unmapBuffers(const std::vector<unsigned int> &ids) override;
 
+	void parseEmbeddedData(uint32_t bufferId) override;
 	void prepareIsp(const PrepareParams &params) override;
 	void processStats(const ProcessParams &params) override;
 
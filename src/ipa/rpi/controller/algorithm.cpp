@@ -32,6 +32,16 @@ void Algorithm::process([[maybe_unused]] StatisticsPtr &stats,
 {
 }
 
+std::optional<Algorithm::MetadataAccess> Algorithm::prepareAccess() const
+{
+	return std::nullopt;
+}
+
+unsigned int Algorithm::processInterval() const
+{
+	return 1;
+}
+
 /* For registering algorithms with the system: */
 
 namespace {
@@ -14,6 +14,8 @@
 #include <string>
 #include <memory>
 #include <map>
+#include <optional>
+#include <vector>
 
 #include "libcamera/internal/yaml_parser.h"
 
@@ -26,6 +28,17 @@ namespace RPiController {
 class Algorithm
 {
 public:
+	/*
+	 * The image metadata read and written by prepare(). Algorithms that
+	 * declare it may be prepared concurrently with other algorithms they
+	 * don't share metadata with, from a different thread. Algorithms that
+	 * don't declare it are always prepared on their own, in order.
+	 */
+	struct MetadataAccess {
+		std::vector<std::string> reads;
+		std::vector<std::string> writes;
+	};
+
 	Algorithm(Controller *controller)
 		: controller_(controller)
 	{
@@ -37,6 +50,14 @@ public:
 	virtual void switchMode(CameraMode const &cameraMode, Metadata *metadata);
 	virtual void prepare(Metadata *imageMetadata);
 	virtual void process(StatisticsPtr &stats, Metadata *imageMetadata);
+	virtual std::optional<MetadataAccess> prepareAccess() const;
+	/*
+	 * The number of frames between process() calls that the algorithm can
+	 * cope with while the scene is stable, 1 meaning every frame. Algorithms
+	 * should only return more than 1 once they have converged. The
+	 * controller snaps back to every frame as soon as the scene changes.
+	 */
+	virtual unsigned int processInterval() const;
 	Metadata &getGlobalMetadata() const
 	{
 		return controller_->getGlobalMetadata();
@@ -49,6 +70,23 @@ public:
 	{
 		return controller_->getHardwareConfig();
 	}
+	libcamera::ipa::WorkerPool &getWorkerPool() const
+	{
+		return controller_->getWorkerPool();
+	}
+	/*
+	 * Retrieve the configuration shared by all the instances of this
+	 * algorithm that read the same tuning file, building it with
+	 * build(Config &) for the first one. The key distinguishes multiple
+	 * configurations of the same algorithm.
+	 */
+	template<typename Config, typename Func>
+	int readConfig(std::shared_ptr<const Config> &config, Func &&build,
+		       const std::string &key = {})
+	{
+		return controller_->readConfig(std::string(name()) + key, config,
+					       std::forward<Func>(build));
+	}
 
 private:
 	Controller *controller_;
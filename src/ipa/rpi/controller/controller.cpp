@@ -5,7 +5,13 @@
  * controller.cpp - ISP controller
  */
 
+#include <algorithm>
 #include <assert.h>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 #include <libcamera/base/file.h>
 #include <libcamera/base/log.h>
@@ -21,6 +27,65 @@ using namespace std::literals::chrono_literals;
 
 LOG_DEFINE_CATEGORY(RPiController)
 
+namespace {
+
+/*
+ * Maximum number of threads shared by the controllers, in addition to the IPA
+ * threads, to prepare algorithms concurrently and run asynchronous
+ * calculations.
+ */
+constexpr unsigned int MaxWorkers = 3;
+
+/*
+ * Handing algorithms over to worker threads costs a few tens of microseconds,
+ * only do so when it saves more than that.
+ */
+constexpr double MinConcurrentSavingUs = 50.0;
+
+/* Number of frames between reports of the process() costs. */
+constexpr unsigned int ProcessReportFrames = 600;
+
+bool accessConflicts(const std::optional<Algorithm::MetadataAccess> &a,
+		     const std::optional<Algorithm::MetadataAccess> &b)
+{
+	if (!a || !b)
+		return true;
+
+	auto intersects = [](const std::vector<std::string> &x,
+			     const std::vector<std::string> &y) {
+		return std::any_of(x.begin(), x.end(), [&y](const std::string &key) {
+			return std::find(y.begin(), y.end(), key) != y.end();
+		});
+	};
+
+	return intersects(a->writes, b->reads) || intersects(a->writes, b->writes) ||
+	       intersects(a->reads, b->writes);
+}
+
+std::shared_ptr<ipa::WorkerPool> sharedWorkerPool()
+{
+	static std::mutex mutex;
+	static std::weak_ptr<ipa::WorkerPool> pool;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::shared_ptr<ipa::WorkerPool> p = pool.lock();
+	if (p)
+		return p;
+
+	unsigned int cores = std::thread::hardware_concurrency();
+	unsigned int numWorkers = std::clamp(cores > 1 ? cores - 1 : 1, 1u, MaxWorkers);
+
+	p = std::make_shared<ipa::WorkerPool>(numWorkers);
+	pool = p;
+
+	LOG(RPiController, Debug) << "Started " << numWorkers << " worker threads";
+
+	return p;
+}
+
+} /* namespace */
+
 static const std::map<std::string, Controller::HardwareConfig> HardwareConfigMap = {
 	{
 		"bcm2835",
@@ -75,26 +140,69 @@ static const std::map<std::string, Controller::HardwareConfig> HardwareConfigMap
 	},
 };
 
-Controller::Controller()
-	: switchModeCalled_(false)
+TuningData::TuningData(std::unique_ptr<YamlObject> root)
+	: root_(std::move(root))
 {
 }
 
-Controller::~Controller() {}
-
-int Controller::read(char const *filename)
+std::shared_ptr<TuningData> TuningData::load(const std::string &filename)
 {
+	/*
+	 * The cache only holds weak references, the tuning data is released
+	 * when the last controller using it is destroyed.
+	 */
+	static std::mutex mutex;
+	static std::map<std::string, std::weak_ptr<TuningData>> cache;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto it = cache.begin(); it != cache.end();) {
+		if (it->second.expired())
+			it = cache.erase(it);
+		else
+			++it;
+	}
+
+	auto it = cache.find(filename);
+	if (it != cache.end()) {
+		LOG(RPiController, Debug)
+			<< "Sharing tuning data from '" << filename << "'";
+		return it->second.lock();
+	}
+
 	File file(filename);
 	if (!file.open(File::OpenModeFlag::ReadOnly)) {
 		LOG(RPiController, Warning)
 			<< "Failed to open tuning file '" << filename << "'";
-		return -EINVAL;
+		return nullptr;
 	}
 
 	std::unique_ptr<YamlObject> root = YamlParser::parse(file);
 	if (!root)
+		return nullptr;
+
+	auto data = std::make_shared<TuningData>(std::move(root));
+	cache[filename] = data;
+
+	return data;
+}
+
+Controller::Controller()
+	: switchModeCalled_(false), workerPool_(sharedWorkerPool()),
+	  processFrames_(0)
+{
+}
+
+Controller::~Controller() {}
+
+int Controller::read(char const *filename)
+{
+	tuning_ = TuningData::load(filename);
+	if (!tuning_)
 		return -EINVAL;
 
+	const YamlObject *root = &tuning_->root();
+
 	double version = (*root)["version"].get<double>(1.0);
 	target_ = (*root)["target"].get<std::string>("bcm2835");
 
@@ -122,6 +230,12 @@ int Controller::read(char const *filename)
 				if (ret)
 					return ret;
 			}
+
+		if (root->contains("scene_stability")) {
+			int ret = stability_.read((*root)["scene_stability"]);
+			if (ret)
+				return ret;
+		}
 	} else {
 		LOG(RPiController, Error)
 			<< "Unrecognised version " << version
@@ -154,6 +268,76 @@ void Controller::initialise()
 {
 	for (auto &algo : algorithms_)
 		algo->initialise();
+
+	buildPrepareSchedule();
+
+	processCost_.assign(algorithms_.size(), {});
+	processFrames_ = 0;
+}
+
+void Controller::buildPrepareSchedule()
+{
+	std::vector<std::optional<Algorithm::MetadataAccess>> access;
+	std::vector<unsigned int> stageOf;
+
+	prepareStages_.clear();
+	prepareCost_.assign(algorithms_.size(), 0.0);
+
+	/*
+	 * Place each algorithm in the stage after the last algorithm it
+	 * depends on, among the algorithms listed before it in the tuning
+	 * file. This preserves the tuning file order between dependent
+	 * algorithms.
+	 */
+	for (unsigned int i = 0; i < algorithms_.size(); i++) {
+		access.push_back(algorithms_[i]->prepareAccess());
+
+		unsigned int stage = 0;
+		for (unsigned int j = 0; j < i; j++) {
+			if (accessConflicts(access[j], access[i]))
+				stage = std::max(stage, stageOf[j] + 1);
+		}
+
+		stageOf.push_back(stage);
+		if (stage >= prepareStages_.size())
+			prepareStages_.resize(stage + 1);
+		prepareStages_[stage].push_back(i);
+	}
+
+	for (const auto &stage : prepareStages_) {
+		if (stage.size() < 2)
+			continue;
+
+		std::string names;
+		for (unsigned int index : stage)
+			names += std::string(" ") + algorithms_[index]->name();
+		LOG(RPiController, Debug) << "Independent prepare stage:" << names;
+	}
+}
+
+void Controller::prepareAlgorithm(unsigned int index, Metadata *imageMetadata)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	algorithms_[index]->prepare(imageMetadata);
+
+	std::chrono::duration<double, std::micro> time =
+		std::chrono::steady_clock::now() - start;
+	prepareCost_[index] = 0.9 * prepareCost_[index] + 0.1 * time.count();
+}
+
+void Controller::prepareConcurrently(const std::vector<unsigned int> &stage,
+				     Metadata *imageMetadata)
+{
+	std::vector<std::function<void()>> tasks;
+	tasks.reserve(stage.size());
+
+	for (unsigned int index : stage)
+		tasks.emplace_back([this, index, imageMetadata] {
+			prepareAlgorithm(index, imageMetadata);
+		});
+
+	workerPool_->run(tasks);
 }
 
 void Controller::switchMode(CameraMode const &cameraMode, Metadata *metadata)
@@ -161,20 +345,103 @@ void Controller::switchMode(CameraMode const &cameraMode, Metadata *metadata)
 	for (auto &algo : algorithms_)
 		algo->switchMode(cameraMode, metadata);
 	switchModeCalled_ = true;
+
+	/* Start again from a clean slate, the scene will look different. */
+	stability_.reset();
+	for (ProcessCost &cost : processCost_)
+		cost.sinceRun = 0;
 }
 
 void Controller::prepare(Metadata *imageMetadata)
 {
 	assert(switchModeCalled_);
-	for (auto &algo : algorithms_)
-		algo->prepare(imageMetadata);
+
+	for (const auto &stage : prepareStages_) {
+		/*
+		 * Prepare independent algorithms concurrently when the time
+		 * saved, the stage cost beyond its most expensive algorithm,
+		 * outweighs the cost of waking up the workers.
+		 */
+		double total = 0.0, longest = 0.0;
+		for (unsigned int index : stage) {
+			total += prepareCost_[index];
+			longest = std::max(longest, prepareCost_[index]);
+		}
+
+		if (stage.size() > 1 && workerPool_->workers() &&
+		    total - longest > MinConcurrentSavingUs) {
+			prepareConcurrently(stage, imageMetadata);
+			continue;
+		}
+
+		for (unsigned int index : stage)
+			prepareAlgorithm(index, imageMetadata);
+	}
 }
 
 void Controller::process(StatisticsPtr stats, Metadata *imageMetadata)
 {
 	assert(switchModeCalled_);
-	for (auto &algo : algorithms_)
-		algo->process(stats, imageMetadata);
+
+	/*
+	 * While the scene is stable, algorithms that have converged may only
+	 * be run every few frames. They all run again as soon as it changes.
+	 */
+	bool stable = stats && stability_.update(*stats);
+
+	for (unsigned int i = 0; i < algorithms_.size(); i++) {
+		ProcessCost &cost = processCost_[i];
+		unsigned int interval = stable ? algorithms_[i]->processInterval() : 1;
+
+		if (cost.sinceRun + 1 < interval) {
+			cost.sinceRun++;
+			cost.skipped++;
+			continue;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+
+		algorithms_[i]->process(stats, imageMetadata);
+
+		std::chrono::duration<double, std::micro> time =
+			std::chrono::steady_clock::now() - start;
+		cost.time += time.count();
+		cost.runs++;
+		cost.sinceRun = 0;
+	}
+
+	if (++processFrames_ >= ProcessReportFrames)
+		reportProcessCost();
+}
+
+void Controller::reportProcessCost()
+{
+	/*
+	 * The time saved by skipped calls is estimated from the average cost
+	 * of the calls that did run.
+	 */
+	std::stringstream report;
+	for (unsigned int i = 0; i < algorithms_.size(); i++) {
+		ProcessCost &cost = processCost_[i];
+		double average = cost.runs ? cost.time / cost.runs : 0.0;
+
+		report << " " << algorithms_[i]->name() << " " << cost.runs
+		       << "x" << static_cast<unsigned int>(average) << "us";
+		if (cost.skipped)
+			report << " (" << cost.skipped << " skipped, "
+			       << static_cast<unsigned int>(average * cost.skipped)
+			       << "us saved)";
+
+		cost.time = 0.0;
+		cost.runs = 0;
+		cost.skipped = 0;
+	}
+
+	LOG(RPiController, Debug)
+		<< "process() cost over " << processFrames_ << " frames:"
+		<< report.str();
+
+	processFrames_ = 0;
 }
 
 Metadata &Controller::getGlobalMetadata()
@@ -218,3 +485,8 @@ const Controller::HardwareConfig &Controller::getHardwareConfig() const
 	ASSERT(cfg != HardwareConfigMap.end());
 	return cfg->second;
 }
+
+ipa::WorkerPool &Controller::getWorkerPool() const
+{
+	return *workerPool_;
+}
@@ -12,15 +12,21 @@
  * convenient manner.
  */
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 
 #include <libcamera/base/utils.h>
 #include "libcamera/internal/yaml_parser.h"
 
+#include "libipa/worker_pool.h"
+
 #include "camera_mode.h"
 #include "device_status.h"
 #include "metadata.h"
+#include "scene_stability.h"
 #include "statistics.h"
 
 namespace RPiController {
@@ -28,6 +34,57 @@ namespace RPiController {
 class Algorithm;
 typedef std::unique_ptr<Algorithm> AlgorithmPtr;
 
+/*
+ * The parsed contents of a tuning file, shared by the controllers of all the
+ * cameras that use the same file within the IPA process. Besides the YAML
+ * tree, it holds the immutable configuration objects that algorithms build
+ * from it, so that large tables (calibrations, priors, curves) exist only once
+ * however many cameras use them. Per-camera mutable state stays in the
+ * algorithms.
+ */
+class TuningData
+{
+public:
+	TuningData(std::unique_ptr<libcamera::YamlObject> root);
+
+	static std::shared_ptr<TuningData> load(const std::string &filename);
+
+	const libcamera::YamlObject &root() const { return *root_; }
+
+	/*
+	 * Return the configuration object stored under key, building it with
+	 * build(Config &) if it doesn't exist yet. The object is only stored if
+	 * build() succeeds.
+	 */
+	template<typename Config, typename Func>
+	int config(const std::string &key, std::shared_ptr<const Config> &config,
+		   Func &&build)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		auto it = configs_.find(key);
+		if (it != configs_.end()) {
+			config = std::static_pointer_cast<const Config>(it->second);
+			return 0;
+		}
+
+		auto newConfig = std::make_shared<Config>();
+		int ret = build(*newConfig);
+		if (ret)
+			return ret;
+
+		configs_[key] = newConfig;
+		config = std::move(newConfig);
+		return 0;
+	}
+
+private:
+	std::unique_ptr<libcamera::YamlObject> root_;
+
+	std::mutex mutex_;
+	std::map<std::string, std::shared_ptr<const void>> configs_;
+};
+
 /*
  * The Controller holds a pointer to some global_metadata, which is how
  * different controllers and control algorithms within them can exchange
@@ -62,6 +119,14 @@ public:
 	Algorithm *getAlgorithm(std::string const &name) const;
 	const std::string &getTarget() const;
 	const HardwareConfig &getHardwareConfig() const;
+	libcamera::ipa::WorkerPool &getWorkerPool() const;
+
+	template<typename Config, typename Func>
+	int readConfig(const std::string &key, std::shared_ptr<const Config> &config,
+		       Func &&build)
+	{
+		return tuning_->config(key, config, std::forward<Func>(build));
+	}
 
 protected:
 	int createAlgorithm(const std::string &name, const libcamera::YamlObject &params);
@@ -71,7 +136,41 @@ protected:
 	bool switchModeCalled_;
 
 private:
+	void buildPrepareSchedule();
+	void prepareAlgorithm(unsigned int index, Metadata *imageMetadata);
+	void prepareConcurrently(const std::vector<unsigned int> &stage,
+				 Metadata *imageMetadata);
+	void reportProcessCost();
+
+	std::shared_ptr<TuningData> tuning_;
 	std::string target_;
+
+	/*
+	 * Algorithms are prepared in stages, each holding algorithms that
+	 * don't depend on each other's metadata. Stages are run in order.
+	 */
+	std::vector<std::vector<unsigned int>> prepareStages_;
+	/* Average prepare() time of each algorithm, in microseconds. */
+	std::vector<double> prepareCost_;
+
+	/*
+	 * Threads shared by all the controllers in the process, that prepare
+	 * independent algorithms concurrently and run the asynchronous
+	 * calculations of algorithms such as AWB and ALSC.
+	 */
+	std::shared_ptr<libcamera::ipa::WorkerPool> workerPool_;
+
+	SceneStability stability_;
+
+	/* process() accounting, reported every few hundred frames. */
+	struct ProcessCost {
+		double time = 0.0; /* total time in microseconds */
+		unsigned int runs = 0;
+		unsigned int skipped = 0;
+		unsigned int sinceRun = 0; /* frames skipped since last run */
+	};
+	std::vector<ProcessCost> processCost_;
+	unsigned int processFrames_;
 };
 
 } /* namespace RPiController */
@@ -9,14 +9,135 @@
 /* A simple class for carrying arbitrary metadata, for example about an image. */
 
 #include <any>
+#include <array>
+#include <bitset>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <string.h>
 
 #include <libcamera/base/thread_annotations.h>
 
+struct AfStatus;
+struct AgcPrepareStatus;
+struct AgcStatus;
+struct AlscStatus;
+struct AwbStatus;
+struct BlackLevelStatus;
+struct CacStatus;
+struct CcmStatus;
+struct CdnStatus;
+struct ContrastStatus;
+struct DenoiseStatus;
+struct DeviceStatus;
+struct DpcStatus;
+struct GeqStatus;
+struct LuxStatus;
+struct NoiseStatus;
+struct SaturationStatus;
+struct SdnStatus;
+struct SharpenStatus;
+struct StitchStatus;
+struct TdnStatus;
+struct TonemapStatus;
+
 namespace RPiController {
 
+/*
+ * Metadata produced and consumed by the in-tree algorithms every frame is
+ * stored in fixed slots, accessed through typed tags without any string
+ * comparison or heap allocation once the slot storage has been created.
+ * Other metadata, for instance from out-of-tree algorithms, is stored in a
+ * string-keyed map. The string-keyed accessors also reach the slots, by the
+ * name of their tag.
+ */
+enum class MetadataSlot : unsigned int {
+	AfStatus,
+	AgcDelayedStatus,
+	AgcPrepareStatus,
+	AgcStatus,
+	AlscStatus,
+	AwbStatus,
+	BlackLevelStatus,
+	CacStatus,
+	CcmStatus,
+	CdnStatus,
+	ContrastStatus,
+	DenoiseStatus,
+	DeviceStatus,
+	DpcStatus,
+	GeqStatus,
+	LuxStatus,
+	NoiseStatus,
+	SaturationStatus,
+	SdnStatus,
+	SharpenStatus,
+	StitchStatus,
+	TdnStatus,
+	TonemapStatus,
+	Count,
+};
+
+template<typename T>
+struct MetadataTag {
+	using Type = T;
+
+	const char *name;
+	MetadataSlot slot;
+};
+
+inline constexpr MetadataTag<AfStatus> AfStatusTag{ "af.status", MetadataSlot::AfStatus };
+inline constexpr MetadataTag<AgcStatus> AgcDelayedStatusTag{ "agc.delayed_status", MetadataSlot::AgcDelayedStatus };
+inline constexpr MetadataTag<AgcPrepareStatus> AgcPrepareStatusTag{ "agc.prepare_status", MetadataSlot::AgcPrepareStatus };
+inline constexpr MetadataTag<AgcStatus> AgcStatusTag{ "agc.status", MetadataSlot::AgcStatus };
+inline constexpr MetadataTag<AlscStatus> AlscStatusTag{ "alsc.status", MetadataSlot::AlscStatus };
+inline constexpr MetadataTag<AwbStatus> AwbStatusTag{ "awb.status", MetadataSlot::AwbStatus };
+inline constexpr MetadataTag<BlackLevelStatus> BlackLevelStatusTag{ "black_level.status", MetadataSlot::BlackLevelStatus };
+inline constexpr MetadataTag<CacStatus> CacStatusTag{ "cac.status", MetadataSlot::CacStatus };
+inline constexpr MetadataTag<CcmStatus> CcmStatusTag{ "ccm.status", MetadataSlot::CcmStatus };
+inline constexpr MetadataTag<CdnStatus> CdnStatusTag{ "cdn.status", MetadataSlot::CdnStatus };
+inline constexpr MetadataTag<ContrastStatus> ContrastStatusTag{ "contrast.status", MetadataSlot::ContrastStatus };
+inline constexpr MetadataTag<DenoiseStatus> DenoiseStatusTag{ "denoise.status", MetadataSlot::DenoiseStatus };
+inline constexpr MetadataTag<DeviceStatus> DeviceStatusTag{ "device.status", MetadataSlot::DeviceStatus };
+inline constexpr MetadataTag<DpcStatus> DpcStatusTag{ "dpc.status", MetadataSlot::DpcStatus };
+inline constexpr MetadataTag<GeqStatus> GeqStatusTag{ "geq.status", MetadataSlot::GeqStatus };
+inline constexpr MetadataTag<LuxStatus> LuxStatusTag{ "lux.status", MetadataSlot::LuxStatus };
+inline constexpr MetadataTag<NoiseStatus> NoiseStatusTag{ "noise.status", MetadataSlot::NoiseStatus };
+inline constexpr MetadataTag<SaturationStatus> SaturationStatusTag{ "saturation.status", MetadataSlot::SaturationStatus };
+inline constexpr MetadataTag<SdnStatus> SdnStatusTag{ "sdn.status", MetadataSlot::SdnStatus };
+inline constexpr MetadataTag<SharpenStatus> SharpenStatusTag{ "sharpen.status", MetadataSlot::SharpenStatus };
+inline constexpr MetadataTag<StitchStatus> StitchStatusTag{ "stitch.status", MetadataSlot::StitchStatus };
+inline constexpr MetadataTag<TdnStatus> TdnStatusTag{ "tdn.status", MetadataSlot::TdnStatus };
+inline constexpr MetadataTag<TonemapStatus> TonemapStatusTag{ "tonemap.status", MetadataSlot::TonemapStatus };
+
+/* The tag names, indexed by slot, for the string-keyed accessors. */
+inline constexpr std::array<const char *, static_cast<unsigned int>(MetadataSlot::Count)> MetadataSlotNames{
+	AfStatusTag.name,
+	AgcDelayedStatusTag.name,
+	AgcPrepareStatusTag.name,
+	AgcStatusTag.name,
+	AlscStatusTag.name,
+	AwbStatusTag.name,
+	BlackLevelStatusTag.name,
+	CacStatusTag.name,
+	CcmStatusTag.name,
+	CdnStatusTag.name,
+	ContrastStatusTag.name,
+	DenoiseStatusTag.name,
+	DeviceStatusTag.name,
+	DpcStatusTag.name,
+	GeqStatusTag.name,
+	LuxStatusTag.name,
+	NoiseStatusTag.name,
+	SaturationStatusTag.name,
+	SdnStatusTag.name,
+	SharpenStatusTag.name,
+	StitchStatusTag.name,
+	TdnStatusTag.name,
+	TonemapStatusTag.name,
+};
+
 class LIBCAMERA_TSA_CAPABILITY("mutex") Metadata
 {
 public:
@@ -25,27 +146,55 @@ public:
 	Metadata(Metadata const &other)
 	{
 		std::scoped_lock otherLock(other.mutex_);
-		data_ = other.data_;
+		copyFrom(other);
 	}
 
 	Metadata(Metadata &&other)
 	{
 		std::scoped_lock otherLock(other.mutex_);
-		data_ = std::move(other.data_);
-		other.data_.clear();
+		moveFrom(other);
+	}
+
+	template<typename T, typename U>
+	void set(MetadataTag<T> const &tag, U const &value)
+	{
+		std::scoped_lock lock(mutex_);
+		setLocked(tag, value);
+	}
+
+	template<typename T>
+	int get(MetadataTag<T> const &tag, T &value) const
+	{
+		std::scoped_lock lock(mutex_);
+		const Slot<T> *slot = findSlot<T>(index(tag.slot));
+		if (!slot)
+			return -1;
+		value = slot->value;
+		return 0;
 	}
 
 	template<typename T>
 	void set(std::string const &tag, T const &value)
 	{
 		std::scoped_lock lock(mutex_);
-		data_[tag] = value;
+		setLocked(tag, value);
 	}
 
 	template<typename T>
 	int get(std::string const &tag, T &value) const
 	{
 		std::scoped_lock lock(mutex_);
+		int i = slotIndex(tag);
+		if (i >= 0) {
+			if (!valid_[i])
+				return -1;
+			const Slot<T> *slot = findSlot<T>(i);
+			if (!slot)
+				throw std::bad_any_cast();
+			value = slot->value;
+			return 0;
+		}
+
 		auto it = data_.find(tag);
 		if (it == data_.end())
 			return -1;
@@ -56,27 +205,35 @@ public:
 	void clear()
 	{
 		std::scoped_lock lock(mutex_);
+		/* Keep the slot storage to reuse it for the next frame. */
+		valid_.reset();
 		data_.clear();
 	}
 
 	Metadata &operator=(Metadata const &other)
 	{
 		std::scoped_lock lock(mutex_, other.mutex_);
-		data_ = other.data_;
+		copyFrom(other);
 		return *this;
 	}
 
 	Metadata &operator=(Metadata &&other)
 	{
 		std::scoped_lock lock(mutex_, other.mutex_);
-		data_ = std::move(other.data_);
-		other.data_.clear();
+		moveFrom(other);
 		return *this;
 	}
 
 	void merge(Metadata &other)
 	{
 		std::scoped_lock lock(mutex_, other.mutex_);
+		for (unsigned int i = 0; i < NumSlots; i++) {
+			if (valid_[i] || !other.valid_[i])
+				continue;
+			std::swap(slots_[i], other.slots_[i]);
+			valid_[i] = true;
+			other.valid_[i] = false;
+		}
 		data_.merge(other.data_);
 	}
 
@@ -87,16 +244,40 @@ public:
 		 * If the metadata key exists, ignore this item and copy only
 		 * unique key/value pairs.
 		 */
+		for (unsigned int i = 0; i < NumSlots; i++) {
+			if (!valid_[i] && other.valid_[i])
+				copySlot(i, other);
+		}
 		data_.insert(other.data_.begin(), other.data_.end());
 	}
 
 	template<typename T>
-	T *getLocked(std::string const &tag)
+	T *getLocked(MetadataTag<T> const &tag)
 	{
 		/*
 		 * This allows in-place access to the Metadata contents,
 		 * for which you should be holding the lock.
 		 */
+		Slot<T> *slot = findSlot<T>(index(tag.slot));
+		return slot ? &slot->value : nullptr;
+	}
+
+	template<typename T, typename U>
+	void setLocked(MetadataTag<T> const &tag, U const &value)
+	{
+		/* Use this only if you're holding the lock yourself. */
+		storeSlot<T>(index(tag.slot), value);
+	}
+
+	template<typename T>
+	T *getLocked(std::string const &tag)
+	{
+		int i = slotIndex(tag);
+		if (i >= 0) {
+			Slot<T> *slot = findSlot<T>(i);
+			return slot ? &slot->value : nullptr;
+		}
+
 		auto it = data_.find(tag);
 		if (it == data_.end())
 			return nullptr;
@@ -106,8 +287,11 @@ public:
 	template<typename T>
 	void setLocked(std::string const &tag, T const &value)
 	{
-		/* Use this only if you're holding the lock yourself. */
-		data_[tag] = value;
+		int i = slotIndex(tag);
+		if (i >= 0)
+			storeSlot<T>(i, value);
+		else
+			data_[tag] = value;
 	}
 
 	/*
@@ -120,7 +304,109 @@ public:
 	void unlock() LIBCAMERA_TSA_RELEASE() { mutex_.unlock(); }
 
 private:
+	static constexpr unsigned int NumSlots =
+		static_cast<unsigned int>(MetadataSlot::Count);
+
+	class SlotBase
+	{
+	public:
+		virtual ~SlotBase() = default;
+		virtual const void *type() const = 0;
+		virtual std::unique_ptr<SlotBase> clone() const = 0;
+		virtual void assign(SlotBase const &other) = 0;
+	};
+
+	template<typename T>
+	class Slot : public SlotBase
+	{
+	public:
+		/* A unique address per type, cheaper to compare than typeid. */
+		static constexpr char typeId = 0;
+
+		Slot(T const &v)
+			: value(v)
+		{
+		}
+
+		const void *type() const override { return &typeId; }
+
+		std::unique_ptr<SlotBase> clone() const override
+		{
+			return std::make_unique<Slot<T>>(value);
+		}
+
+		void assign(SlotBase const &other) override
+		{
+			value = static_cast<Slot<T> const &>(other).value;
+		}
+
+		T value;
+	};
+
+	static constexpr unsigned int index(MetadataSlot slot)
+	{
+		return static_cast<unsigned int>(slot);
+	}
+
+	static int slotIndex(std::string const &tag)
+	{
+		for (unsigned int i = 0; i < NumSlots; i++) {
+			if (!strcmp(MetadataSlotNames[i], tag.c_str()))
+				return i;
+		}
+		return -1;
+	}
+
+	template<typename T>
+	Slot<T> *findSlot(unsigned int i) const
+	{
+		if (!valid_[i] || slots_[i]->type() != &Slot<T>::typeId)
+			return nullptr;
+		return static_cast<Slot<T> *>(slots_[i].get());
+	}
+
+	template<typename T, typename U>
+	void storeSlot(unsigned int i, U const &value)
+	{
+		/* Reuse the slot storage when it holds the right type. */
+		if (slots_[i] && slots_[i]->type() == &Slot<T>::typeId)
+			static_cast<Slot<T> *>(slots_[i].get())->value = value;
+		else
+			slots_[i] = std::make_unique<Slot<T>>(value);
+		valid_[i] = true;
+	}
+
+	void copySlot(unsigned int i, Metadata const &other)
+	{
+		if (slots_[i] && slots_[i]->type() == other.slots_[i]->type())
+			slots_[i]->assign(*other.slots_[i]);
+		else
+			slots_[i] = other.slots_[i]->clone();
+		valid_[i] = true;
+	}
+
+	void copyFrom(Metadata const &other)
+	{
+		for (unsigned int i = 0; i < NumSlots; i++) {
+			if (other.valid_[i])
+				copySlot(i, other);
+		}
+		valid_ = other.valid_;
+		data_ = other.data_;
+	}
+
+	void moveFrom(Metadata &other)
+	{
+		std::swap(slots_, other.slots_);
+		valid_ = other.valid_;
+		other.valid_.reset();
+		data_ = std::move(other.data_);
+		other.data_.clear();
+	}
+
 	mutable std::mutex mutex_;
+	std::array<std::unique_ptr<SlotBase>, NumSlots> slots_;
+	std::bitset<NumSlots> valid_;
 	std::map<std::string, std::any> data_;
 };
 
@@ -77,6 +77,14 @@ double Pwl::eval(double x, int *spanPtr, bool updateSpan) const
 		       (points_[span + 1].x - points_[span].x);
 }
 
+void Pwl::eval(libcamera::Span<const double> x, libcamera::Span<double> y) const
+{
+	assert(x.size() == y.size());
+	int span = -1;
+	for (size_t i = 0; i < x.size(); i++)
+		y[i] = eval(x[i], &span);
+}
+
 int Pwl::findSpan(double x, int span) const
 {
 	/*
@@ -260,6 +268,40 @@ Pwl &Pwl::operator*=(double d)
 	return *this;
 }
 
+PwlLut::PwlLut(Pwl const &pwl, unsigned int size)
+	: PwlLut(pwl, pwl.domain(), size)
+{
+}
+
+PwlLut::PwlLut(Pwl const &pwl, Pwl::Interval const &domain, unsigned int size)
+{
+	/* We need at least one interval to interpolate within. */
+	size = std::max(size, 2u);
+	double step = domain.len() / (size - 1);
+
+	start_ = domain.start;
+	scale_ = step > 0 ? 1 / step : 0;
+	/*
+	 * Stop just short of the final entry so that the last interval is
+	 * used, with a fraction of (almost) one, at the end of the domain.
+	 */
+	maxPos_ = std::nextafter(static_cast<double>(size - 1), 0.0);
+
+	std::vector<double> x(size);
+	for (unsigned int i = 0; i < size; i++)
+		x[i] = std::min(domain.start + i * step, domain.end);
+	/* Outside the Pwl's own domain, extend it linearly. */
+	table_.resize(size);
+	pwl.eval(x, table_);
+}
+
+void PwlLut::eval(libcamera::Span<const double> x, libcamera::Span<double> y) const
+{
+	assert(x.size() == y.size());
+	for (size_t i = 0; i < x.size(); i++)
+		y[i] = eval(x[i]);
+}
+
 void Pwl::debug(FILE *fp) const
 {
 	fprintf(fp, "Pwl {\n");
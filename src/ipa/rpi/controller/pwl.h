@@ -6,10 +6,13 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <functional>
 #include <math.h>
 #include <vector>
 
+#include <libcamera/base/span.h>
+
 #include "libcamera/internal/yaml_parser.h"
 
 namespace RPiController {
@@ -72,6 +75,11 @@ public:
 	 */
 	double eval(double x, int *spanPtr = nullptr,
 		    bool updateSpan = true) const;
+	/*
+	 * Evaluate Pwl at many points, carrying the "span" from one to the
+	 * next, which is cheapest when the x values are sorted.
+	 */
+	void eval(libcamera::Span<const double> x, libcamera::Span<double> y) const;
 	/*
 	 * Find perpendicular closest to xy, starting from span+1 so you can
 	 * call it repeatedly to check for multiple closest points (set span to
@@ -124,4 +132,35 @@ private:
 	std::vector<Point> points_;
 };
 
+/*
+ * A Pwl "compiled" into a table of values at evenly spaced points over a fixed
+ * domain, so that evaluating it needs no search, only linear interpolation
+ * between two table entries. Inputs outside the domain are clipped to it. The
+ * result is only exact where the Pwl's control points fall on table entries,
+ * so the table should be large enough for the curve in question.
+ */
+class PwlLut
+{
+public:
+	PwlLut() {}
+	PwlLut(Pwl const &pwl, unsigned int size);
+	PwlLut(Pwl const &pwl, Pwl::Interval const &domain, unsigned int size);
+	bool empty() const { return table_.empty(); }
+	double eval(double x) const
+	{
+		double pos = std::clamp((x - start_) * scale_, 0.0, maxPos_);
+		unsigned int i = pos;
+		double frac = pos - i;
+		return table_[i] + frac * (table_[i + 1] - table_[i]);
+	}
+	void eval(libcamera::Span<const double> x, libcamera::Span<double> y) const;
+
+private:
+	double start_;
+	double scale_;
+	/* position of the last interval, so that table_[i + 1] always exists */
+	double maxPos_;
+	std::vector<double> table_;
+};
+
 } /* namespace RPiController */
@@ -24,25 +24,74 @@ public:
 		uint32_t uncounted;
 	};
 
+	/*
+	 * A region reader extracts a region from statistics stored in another
+	 * layout, such as a hardware statistics buffer.
+	 */
+	using Reader = Region (*)(const void *data, unsigned int index);
+
 	RegionStats()
-		: size_({}), numFloating_(0), default_({})
+		: size_({}), numFloating_(0), default_({}), data_(nullptr),
+		  reader_(nullptr)
+	{
+	}
+
+	/* Copies always own their regions, even when copying a view. */
+	RegionStats(const RegionStats &other)
+		: size_(other.size_), numFloating_(other.numFloating_),
+		  regions_(other.regions()), default_(other.default_),
+		  data_(nullptr), reader_(nullptr)
+	{
+	}
+
+	RegionStats &operator=(const RegionStats &other)
 	{
+		if (this == &other)
+			return *this;
+
+		size_ = other.size_;
+		numFloating_ = other.numFloating_;
+		regions_ = other.regions();
+		data_ = nullptr;
+		reader_ = nullptr;
+
+		return *this;
 	}
 
 	void init(const libcamera::Size &size, unsigned int numFloating = 0)
 	{
 		size_ = size;
 		numFloating_ = numFloating;
+		data_ = nullptr;
+		reader_ = nullptr;
 		regions_.clear();
 		regions_.resize(size_.width * size_.height + numFloating_);
 	}
 
 	void init(unsigned int num)
 	{
-		size_ = libcamera::Size(num, 1);
-		numFloating_ = 0;
+		init(libcamera::Size(num, 1));
+	}
+
+	/*
+	 * Initialise the statistics as a view over externally stored data.
+	 * Regions are read on access, without being copied. The data must
+	 * remain valid for as long as the view is accessed, or until the view
+	 * is modified, which turns it into a copy.
+	 */
+	void initView(const libcamera::Size &size, unsigned int numFloating,
+		      const void *data, Reader reader)
+	{
+		size_ = size;
+		numFloating_ = numFloating;
+		data_ = data;
+		reader_ = reader;
 		regions_.clear();
-		regions_.resize(num);
+	}
+
+	bool isView() const
+	{
+		return reader_ != nullptr;
 	}
 
 	unsigned int numRegions() const
@@ -79,45 +128,94 @@ public:
 		set(numRegions() + index, region);
 	}
 
-	const Region &get(unsigned int index) const
+	Region get(unsigned int index) const
 	{
 		if (index >= numRegions())
 			return default_;
 		return get_(index);
 	}
 
-	const Region &get(const libcamera::Point &pos) const
+	Region get(const libcamera::Point &pos) const
 	{
 		return get(pos.y * size_.width + pos.x);
 	}
 
-	const Region &getFloating(unsigned int index) const
+	Region getFloating(unsigned int index) const
 	{
 		if (index >= numFloatingRegions())
 			return default_;
 		return get_(numRegions() + index);
 	}
 
-	typename std::vector<Region>::iterator begin() { return regions_.begin(); }
-	typename std::vector<Region>::iterator end() { return regions_.end(); }
-	typename std::vector<Region>::const_iterator begin() const { return regions_.begin(); }
-	typename std::vector<Region>::const_iterator end() const { return regions_.end(); }
+	/* Iterating over a view copies its regions first. */
+	typename std::vector<Region>::iterator begin()
+	{
+		materialise();
+		return regions_.begin();
+	}
+
+	typename std::vector<Region>::iterator end()
+	{
+		materialise();
+		return regions_.end();
+	}
+
+	typename std::vector<Region>::const_iterator begin() const
+	{
+		materialise();
+		return regions_.begin();
+	}
+
+	typename std::vector<Region>::const_iterator end() const
+	{
+		materialise();
+		return regions_.end();
+	}
 
 private:
+	std::vector<Region> regions() const
+	{
+		if (!reader_)
+			return regions_;
+
+		std::vector<Region> regions(numRegions() + numFloating_);
+		for (unsigned int i = 0; i < regions.size(); i++)
+			regions[i] = reader_(data_, i);
+
+		return regions;
+	}
+
+	void materialise() const
+	{
+		if (!reader_)
+			return;
+
+		regions_ = regions();
+		data_ = nullptr;
+		reader_ = nullptr;
+	}
+
 	void set_(unsigned int index, const Region &region)
 	{
+		materialise();
 		regions_[index] = region;
 	}
 
-	const Region &get_(unsigned int index) const
+	Region get_(unsigned int index) const
 	{
+		if (reader_)
+			return reader_(data_, index);
 		return regions_[index];
 	}
 
 	libcamera::Size size_;
 	unsigned int numFloating_;
-	std::vector<Region> regions_;
+	mutable std::vector<Region> regions_;
 	Region default_;
+
+	/* The external data and its reader, when the statistics are a view. */
+	mutable const void *data_;
+	mutable Reader reader_;
 };
 
 } /* namespace RPiController */
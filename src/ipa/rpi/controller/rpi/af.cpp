@@ -7,8 +7,10 @@
 
 #include "af.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <math.h>
+#include <mutex>
 #include <stdlib.h>
 
 #include <libcamera/base/log.h>
@@ -195,6 +197,8 @@ Af::Af(Controller *controller)
 	 * statistics, but these are plausible upper bounds.
 	 */
 	phaseWeights_.w.reserve(16 * 12);
+	pdafConf_.reserve(16 * 12);
+	pdafPhase_.reserve(16 * 12);
 	contrastWeights_.w.reserve(getHardwareConfig().focusRegions.width *
 				   getHardwareConfig().focusRegions.height);
 	scanData_.reserve(32);
@@ -301,6 +305,19 @@ void Af::computeWeights(RegionWeights *wgts, unsigned rows, unsigned cols)
 			}
 		}
 	}
+
+	/*
+	 * Windows usually cover a small part of the image, list the cells
+	 * they touch so that per-frame accumulation can skip the others.
+	 */
+	wgts->cells.clear();
+	wgts->cellWeights.clear();
+	for (unsigned i = 0; i < wgts->w.size(); ++i) {
+		if (wgts->w[i]) {
+			wgts->cells.push_back(i);
+			wgts->cellWeights.push_back(wgts->w[i]);
+		}
+	}
 }
 
 void Af::invalidateWeights()
@@ -318,22 +335,35 @@ bool Af::getPhase(PdafRegions const &regions, double &phase, double &conf)
 		computeWeights(&phaseWeights_, size.height, size.width);
 	}
 
+	/* Gather the PDAF data of the weighted cells into flat arrays. */
+	const std::vector<unsigned> &cells = phaseWeights_.cells;
+	const unsigned numCells = cells.size();
+	pdafConf_.resize(numCells);
+	pdafPhase_.resize(numCells);
+	for (unsigned i = 0; i < numCells; ++i) {
+		const PdafData &data = regions.get(cells[i]).val;
+		pdafConf_[i] = data.conf;
+		pdafPhase_[i] = data.phase;
+	}
+
+	/*
+	 * Accumulate without branches, cells below the confidence threshold
+	 * get a zero weight, so that the compiler can vectorize the loop.
+	 */
+	const uint32_t *weights = phaseWeights_.cellWeights.data();
+	const uint32_t *confs = pdafConf_.data();
+	const int32_t *phases = pdafPhase_.data();
+	const uint32_t confThresh = cfg_.confThresh;
+	const uint32_t confClip = cfg_.confClip;
+	const uint32_t confOffset = confThresh >> 2;
 	uint32_t sumWc = 0;
 	int64_t sumWcp = 0;
-	for (unsigned i = 0; i < regions.numRegions(); ++i) {
-		unsigned w = phaseWeights_.w[i];
-		if (w) {
-			const PdafData &data = regions.get(i).val;
-			unsigned c = data.conf;
-			if (c >= cfg_.confThresh) {
-				if (c > cfg_.confClip)
-					c = cfg_.confClip;
-				c -= (cfg_.confThresh >> 2);
-				sumWc += w * c;
-				c -= (cfg_.confThresh >> 2);
-				sumWcp += (int64_t)(w * c) * (int64_t)data.phase;
-			}
-		}
+	for (unsigned i = 0; i < numCells; ++i) {
+		uint32_t w = confs[i] >= confThresh ? weights[i] : 0;
+		uint32_t c = std::min(confs[i], confClip) - confOffset;
+		sumWc += w * c;
+		c -= confOffset;
+		sumWcp += (int64_t)(w * c) * (int64_t)phases[i];
 	}
 
 	if (0 < phaseWeights_.sum && phaseWeights_.sum <= sumWc) {
@@ -357,9 +387,11 @@ double Af::getContrast(const FocusRegions &focusStats)
 		computeWeights(&contrastWeights_, size.height, size.width);
 	}
 
+	const std::vector<unsigned> &cells = contrastWeights_.cells;
+	const std::vector<uint32_t> &weights = contrastWeights_.cellWeights;
 	uint64_t sumWc = 0;
-	for (unsigned i = 0; i < focusStats.numRegions(); ++i)
-		sumWc += contrastWeights_.w[i] * focusStats.get(i).val;
+	for (unsigned i = 0; i < cells.size(); ++i)
+		sumWc += weights[i] * focusStats.get(cells[i]).val;
 
 	return (contrastWeights_.sum > 0) ? ((double)sumWc / (double)contrastWeights_.sum) : 0.0;
 }
@@ -625,14 +657,19 @@ void Af::prepare(Metadata *imageMetadata)
 
 	if (initted_) {
 		/* Get PDAF from the embedded metadata, and run AF algorithm core */
-		PdafRegions regions;
 		double phase = 0.0, conf = 0.0;
 		double oldFt = ftarget_;
 		double oldFs = fsmooth_;
 		ScanState oldSs = scanState_;
 		uint32_t oldSt = stepCount_;
-		if (imageMetadata->get("pdaf.regions", regions) == 0)
-			getPhase(regions, phase, conf);
+		{
+			/* Read the regions in place rather than copying them. */
+			std::scoped_lock lock(*imageMetadata);
+			const PdafRegions *regions =
+				imageMetadata->getLocked<PdafRegions>("pdaf.regions");
+			if (regions)
+				getPhase(*regions, phase, conf);
+		}
 		doAF(prevContrast_, phase, conf);
 		updateLensPosition();
 		LOG(RPiAf, Debug) << std::fixed << std::setprecision(2)
@@ -660,7 +697,7 @@ void Af::prepare(Metadata *imageMetadata)
 		status.state = reportState_;
 	status.lensSetting = initted_ ? std::optional<int>(cfg_.map.eval(fsmooth_))
 				      : std::nullopt;
-	imageMetadata->set("af.status", status);
+	imageMetadata->set(AfStatusTag, status);
 }
 
 void Af::process(StatisticsPtr &stats, [[maybe_unused]] Metadata *imageMetadata)
@@ -119,6 +119,9 @@ private:
 		unsigned cols;
 		uint32_t sum;
 		std::vector<uint16_t> w;
+		/* Indices and weights of the cells with a non-zero weight */
+		std::vector<unsigned> cells;
+		std::vector<uint32_t> cellWeights;
 
 		RegionWeights()
 			: rows(0), cols(0), sum(0), w() {}
@@ -149,6 +152,9 @@ private:
 	bool useWindows_;
 	RegionWeights phaseWeights_;
 	RegionWeights contrastWeights_;
+	/* PDAF data of the weighted cells, gathered for accumulation */
+	std::vector<uint32_t> pdafConf_;
+	std::vector<int32_t> pdafPhase_;
 
 	/* Working state. */
 	ScanState scanState_;
@@ -40,15 +40,13 @@ int Agc::read(const libcamera::YamlObject &params)
 	if (!params.contains("channels")) {
 		LOG(RPiAgc, Debug) << "Single channel only";
 		channelTotalExposures_.resize(1, 0s);
-		channelData_.emplace_back();
-		return channelData_.back().channel.read(params, getHardwareConfig());
+		return readChannel(params, {});
 	}
 
 	const auto &channels = params["channels"].asList();
 	for (auto ch = channels.begin(); ch != channels.end(); ch++) {
 		LOG(RPiAgc, Debug) << "Read AGC channel";
-		channelData_.emplace_back();
-		int ret = channelData_.back().channel.read(*ch, getHardwareConfig());
+		int ret = readChannel(*ch, "/channel" + std::to_string(channelData_.size()));
 		if (ret)
 			return ret;
 	}
@@ -64,6 +62,20 @@ int Agc::read(const libcamera::YamlObject &params)
 	return 0;
 }
 
+int Agc::readChannel(const libcamera::YamlObject &params, const std::string &key)
+{
+	std::shared_ptr<const AgcConfig> config;
+	int ret = readConfig(config, [&](AgcConfig &c) {
+		return AgcChannel::readConfig(c, params, getHardwareConfig());
+	}, key);
+	if (ret)
+		return ret;
+
+	channelData_.emplace_back();
+	channelData_.back().channel.setConfig(std::move(config));
+	return 0;
+}
+
 int Agc::checkChannel(unsigned int channelIndex) const
 {
 	if (channelIndex >= channelData_.size()) {
@@ -219,18 +231,18 @@ void Agc::switchMode(CameraMode const &cameraMode,
 		LOG(RPiAgc, Debug) << "switchMode for channel " << channelIndex;
 		channelData_[channelIndex].channel.switchMode(cameraMode, metadata);
 		if (channelIndex == activeChannels_[0])
-			metadata->get("agc.status", status);
+			metadata->get(AgcStatusTag, status);
 	}
 
 	status.channel = activeChannels_[0];
-	metadata->set("agc.status", status);
+	metadata->set(AgcStatusTag, status);
 	index_ = 0;
 }
 
 static void getDelayedChannelIndex(Metadata *metadata, const char *message, unsigned int &channelIndex)
 {
 	std::unique_lock<RPiController::Metadata> lock(*metadata);
-	AgcStatus *status = metadata->getLocked<AgcStatus>("agc.delayed_status");
+	AgcStatus *status = metadata->getLocked<AgcStatus>(AgcDelayedStatusTag);
 	if (status)
 		channelIndex = status->channel;
 	else {
@@ -243,7 +255,7 @@ static libcamera::utils::Duration
 setCurrentChannelIndexGetExposure(Metadata *metadata, const char *message, unsigned int channelIndex)
 {
 	std::unique_lock<RPiController::Metadata> lock(*metadata);
-	AgcStatus *status = metadata->getLocked<AgcStatus>("agc.status");
+	AgcStatus *status = metadata->getLocked<AgcStatus>(AgcStatusTag);
 	libcamera::utils::Duration dur = 0s;
 
 	if (status) {
@@ -299,12 +311,17 @@ void Agc::process(StatisticsPtr &stats, Metadata *imageMetadata)
 	 */
 	LOG(RPiAgc, Debug) << "Save DeviceStatus and stats for channel " << statsIndex;
 	DeviceStatus deviceStatus;
-	if (imageMetadata->get<DeviceStatus>("device.status", deviceStatus) == 0)
+	if (imageMetadata->get<DeviceStatus>(DeviceStatusTag, deviceStatus) == 0)
 		channelData_[statsIndex].deviceStatus = deviceStatus;
 	else
 		/* Every frame should have a DeviceStatus. */
 		LOG(RPiAgc, Error) << "process: no device status found";
-	channelData_[statsIndex].statistics = stats;
+	/*
+	 * The stats may only be valid for this frame, so cache a copy when they
+	 * may be needed for a later frame.
+	 */
+	channelData_[statsIndex].statistics =
+		activeChannels_.size() > 1 ? retainStatistics(stats) : nullptr;
 
 	/*
 	 * Finally fetch the most recent DeviceStatus and stats for the new channel, if both
@@ -312,7 +329,9 @@ void Agc::process(StatisticsPtr &stats, Metadata *imageMetadata)
 	 * which channel this is.
 	 */
 	StatisticsPtr *statsPtr = &stats;
-	if (channelData.statistics && channelData.deviceStatus) {
+	if (statsIndex == channelIndex) {
+		LOG(RPiAgc, Debug) << "process: using stats from this image";
+	} else if (channelData.statistics && channelData.deviceStatus) {
 		deviceStatus = *channelData.deviceStatus;
 		statsPtr = &channelData.statistics;
 	} else {
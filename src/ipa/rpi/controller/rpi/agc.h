@@ -48,6 +48,7 @@ public:
 	void setActiveChannels(const std::vector<unsigned int> &activeChannels) override;
 
 private:
+	int readChannel(const libcamera::YamlObject &params, const std::string &key);
 	int checkChannel(unsigned int channel) const;
 	std::vector<AgcChannelData> channelData_;
 	std::vector<unsigned int> activeChannels_;
@@ -10,6 +10,12 @@
 #include <algorithm>
 #include <tuple>
 
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <libcamera/base/log.h>
 
 #include "../awb_status.h"
@@ -283,36 +289,50 @@ AgcChannel::AgcChannel()
 	status_.ev = ev_;
 }
 
-int AgcChannel::read(const libcamera::YamlObject &params,
-		     const Controller::HardwareConfig &hardwareConfig)
+int AgcChannel::readConfig(AgcConfig &config, const libcamera::YamlObject &params,
+			   const Controller::HardwareConfig &hardwareConfig)
 {
-	int ret = config_.read(params);
+	int ret = config.read(params);
 	if (ret)
 		return ret;
 
 	const Size &size = hardwareConfig.agcZoneWeights;
-	for (auto const &modes : config_.meteringModes) {
+	for (auto const &modes : config.meteringModes) {
 		if (modes.second.weights.size() != size.width * size.height) {
 			LOG(RPiAgc, Error) << "AgcMeteringMode: Incorrect number of weights";
 			return -EINVAL;
 		}
 	}
 
+	/*
+	 * Make sure the default modes exist, as the config can't be modified
+	 * once it is shared.
+	 */
+	config.meteringModes[config.defaultMeteringMode];
+	config.exposureModes[config.defaultExposureMode];
+	config.constraintModes[config.defaultConstraintMode];
+
+	return 0;
+}
+
+void AgcChannel::setConfig(std::shared_ptr<const AgcConfig> config)
+{
+	config_ = std::move(config);
+
 	/*
 	 * Set the config's defaults (which are the first ones it read) as our
 	 * current modes, until someone changes them.  (they're all known to
 	 * exist at this point)
 	 */
-	meteringModeName_ = config_.defaultMeteringMode;
-	meteringMode_ = &config_.meteringModes[meteringModeName_];
-	exposureModeName_ = config_.defaultExposureMode;
-	exposureMode_ = &config_.exposureModes[exposureModeName_];
-	constraintModeName_ = config_.defaultConstraintMode;
-	constraintMode_ = &config_.constraintModes[constraintModeName_];
+	meteringModeName_ = config_->defaultMeteringMode;
+	meteringMode_ = &config_->meteringModes.at(meteringModeName_);
+	exposureModeName_ = config_->defaultExposureMode;
+	exposureMode_ = &config_->exposureModes.at(exposureModeName_);
+	constraintModeName_ = config_->defaultConstraintMode;
+	constraintMode_ = &config_->constraintModes.at(constraintModeName_);
 	/* Set up the "last shutter/gain" values, in case AGC starts "disabled". */
-	status_.shutterTime = config_.defaultExposureTime;
-	status_.analogueGain = config_.defaultAnalogueGain;
-	return 0;
+	status_.shutterTime = config_->defaultExposureTime;
+	status_.analogueGain = config_->defaultAnalogueGain;
 }
 
 void AgcChannel::disableAuto()
@@ -336,7 +356,7 @@ unsigned int AgcChannel::getConvergenceFrames() const
 	if (fixedShutter_ && fixedAnalogueGain_)
 		return 0;
 	else
-		return config_.convergenceFrames;
+		return config_->convergenceFrames;
 }
 
 std::vector<double> const &AgcChannel::getWeights() const
@@ -345,8 +365,8 @@ std::vector<double> const &AgcChannel::getWeights() const
 	 * In case someone calls setMeteringMode and then this before the
 	 * algorithm has run and updated the meteringMode_ pointer.
 	 */
-	auto it = config_.meteringModes.find(meteringModeName_);
-	if (it == config_.meteringModes.end())
+	auto it = config_->meteringModes.find(meteringModeName_);
+	if (it == config_->meteringModes.end())
 		return meteringMode_->weights;
 	return it->second.weights;
 }
@@ -454,8 +474,8 @@ void AgcChannel::switchMode(CameraMode const &cameraMode,
 		 */
 
 		/* Equivalent of divideUpExposure. */
-		filtered_.shutter = fixedShutter ? fixedShutter : config_.defaultExposureTime;
-		filtered_.analogueGain = fixedAnalogueGain_ ? fixedAnalogueGain_ : config_.defaultAnalogueGain;
+		filtered_.shutter = fixedShutter ? fixedShutter : config_->defaultExposureTime;
+		filtered_.analogueGain = fixedAnalogueGain_ ? fixedAnalogueGain_ : config_->defaultAnalogueGain;
 	}
 
 	writeAndFinish(metadata, false);
@@ -470,7 +490,7 @@ void AgcChannel::prepare(Metadata *imageMetadata)
 	/* Fetch the AWB status now because AWB also sets it in the prepare method. */
 	fetchAwbStatus(imageMetadata);
 
-	if (!imageMetadata->get("agc.delayed_status", delayedStatus))
+	if (!imageMetadata->get(AgcDelayedStatusTag, delayedStatus))
 		totalExposureValue = delayedStatus.totalExposureValue;
 
 	prepareStatus.digitalGain = 1.0;
@@ -479,7 +499,7 @@ void AgcChannel::prepare(Metadata *imageMetadata)
 	if (status_.totalExposureValue) {
 		/* Process has run, so we have meaningful values. */
 		DeviceStatus deviceStatus;
-		if (imageMetadata->get("device.status", deviceStatus) == 0) {
+		if (imageMetadata->get(DeviceStatusTag, deviceStatus) == 0) {
 			Duration actualExposure = deviceStatus.shutterSpeed *
 						  deviceStatus.analogueGain;
 			if (actualExposure) {
@@ -499,7 +519,7 @@ void AgcChannel::prepare(Metadata *imageMetadata)
 			}
 		} else
 			LOG(RPiAgc, Warning) << "AgcChannel: no device metadata";
-		imageMetadata->set("agc.prepare_status", prepareStatus);
+		imageMetadata->set(AgcPrepareStatusTag, prepareStatus);
 	}
 }
 
@@ -596,8 +616,8 @@ void AgcChannel::housekeepConfig()
 	 * they've changed.
 	 */
 	if (meteringModeName_ != status_.meteringMode) {
-		auto it = config_.meteringModes.find(meteringModeName_);
-		if (it == config_.meteringModes.end()) {
+		auto it = config_->meteringModes.find(meteringModeName_);
+		if (it == config_->meteringModes.end()) {
 			LOG(RPiAgc, Warning) << "No metering mode " << meteringModeName_;
 			meteringModeName_ = status_.meteringMode;
 		} else {
@@ -606,8 +626,8 @@ void AgcChannel::housekeepConfig()
 		}
 	}
 	if (exposureModeName_ != status_.exposureMode) {
-		auto it = config_.exposureModes.find(exposureModeName_);
-		if (it == config_.exposureModes.end()) {
+		auto it = config_->exposureModes.find(exposureModeName_);
+		if (it == config_->exposureModes.end()) {
 			LOG(RPiAgc, Warning) << "No exposure profile " << exposureModeName_;
 			exposureModeName_ = status_.exposureMode;
 		} else {
@@ -616,8 +636,8 @@ void AgcChannel::housekeepConfig()
 		}
 	}
 	if (constraintModeName_ != status_.constraintMode) {
-		auto it = config_.constraintModes.find(constraintModeName_);
-		if (it == config_.constraintModes.end()) {
+		auto it = config_->constraintModes.find(constraintModeName_);
+		if (it == config_->constraintModes.end()) {
 			LOG(RPiAgc, Warning) << "No constraint list " << constraintModeName_;
 			constraintModeName_ = status_.constraintMode;
 		} else {
@@ -641,15 +661,67 @@ void AgcChannel::fetchCurrentExposure(DeviceStatus const &deviceStatus)
 
 void AgcChannel::fetchAwbStatus(Metadata *imageMetadata)
 {
-	if (imageMetadata->get("awb.status", awb_) != 0)
+	if (imageMetadata->get(AwbStatusTag, awb_) != 0)
 		LOG(RPiAgc, Debug) << "No AWB status found";
 }
 
-static double computeInitialY(StatisticsPtr &stats, AwbStatus const &awb,
-			      std::vector<double> &weights, double gain)
+/*
+ * Prepare the region sums for computeInitialY(). The sums of the three colour
+ * channels of all regions are stored in a single flat array, pre-multiplied by
+ * the luminance coefficients and, if needed, the AWB gains. The saturation
+ * limit of each entry is scaled in the same way, so that the mean Y for a given
+ * gain reduces to a sum of min(sum * gain, limit) over the whole array, which
+ * we evaluate with SIMD instructions where available.
+ */
+void AgcChannel::prepareRegionY(StatisticsPtr &stats)
 {
 	constexpr uint64_t maxVal = 1 << Statistics::NormalisationFactorPow2;
 
+	regionY_.sums.clear();
+	regionY_.limits.clear();
+	regionY_.pixelSum = 0;
+
+	unsigned int numRegions = stats->agcRegions.numRegions();
+	if (!numRegions)
+		return;
+
+	ASSERT(meteringMode_->weights.size() == numRegions);
+
+	double coeffs[3] = { .299, .587, .114 };
+	if (stats->agcStatsPos == Statistics::AgcStatsPos::PreWb) {
+		coeffs[0] *= awb_.gainR;
+		coeffs[1] *= awb_.gainG;
+		coeffs[2] *= awb_.gainB;
+	}
+
+	/* Pad the arrays to a multiple of the vector size with zeros. */
+	unsigned int size = (numRegions * 3 + 3) & ~3;
+	regionY_.sums.reserve(size);
+	regionY_.limits.reserve(size);
+
+	/*
+	 * Note that the weights are applied by the IPA to the statistics directly,
+	 * before they are given to us here.
+	 */
+	for (unsigned int i = 0; i < numRegions; i++) {
+		const auto &region = stats->agcRegions.get(i);
+		const uint64_t sums[3] = { region.val.rSum, region.val.gSum, region.val.bSum };
+		const double limit = static_cast<double>(maxVal - 1) * region.counted;
+
+		for (unsigned int c = 0; c < 3; c++) {
+			regionY_.sums.push_back(sums[c] * coeffs[c]);
+			regionY_.limits.push_back(limit * coeffs[c]);
+		}
+
+		regionY_.pixelSum += region.counted;
+	}
+
+	regionY_.sums.resize(size, 0.0f);
+	regionY_.limits.resize(size, 0.0f);
+}
+
+double AgcChannel::computeInitialY(StatisticsPtr &stats, double gain) const
+{
 	/*
 	 * If we have no AGC region stats, but do have a a Y histogram, use that
 	 * directly to caluclate the mean Y value of the image.
@@ -671,35 +743,49 @@ static double computeInitialY(StatisticsPtr &stats, AwbStatus const &awb,
 		return ySum / hist.total() / hist.bins();
 	}
 
-	ASSERT(weights.size() == stats->agcRegions.numRegions());
-
-	/*
-	 * Note that the weights are applied by the IPA to the statistics directly,
-	 * before they are given to us here.
-	 */
-	double rSum = 0, gSum = 0, bSum = 0, pixelSum = 0;
-	for (unsigned int i = 0; i < stats->agcRegions.numRegions(); i++) {
-		auto &region = stats->agcRegions.get(i);
-		rSum += std::min<double>(region.val.rSum * gain, (maxVal - 1) * region.counted);
-		gSum += std::min<double>(region.val.gSum * gain, (maxVal - 1) * region.counted);
-		bSum += std::min<double>(region.val.bSum * gain, (maxVal - 1) * region.counted);
-		pixelSum += region.counted;
-	}
-	if (pixelSum == 0.0) {
+	if (regionY_.pixelSum == 0.0) {
 		LOG(RPiAgc, Warning) << "computeInitialY: pixelSum is zero";
 		return 0;
 	}
 
-	double ySum;
-	/* Factor in the AWB correction if needed. */
-	if (stats->agcStatsPos == Statistics::AgcStatsPos::PreWb) {
-		ySum = rSum * awb.gainR * .299 +
-		       gSum * awb.gainG * .587 +
-		       bSum * awb.gainB * .114;
-	} else
-		ySum = rSum * .299 + gSum * .587 + bSum * .114;
+	const float *sums = regionY_.sums.data();
+	const float *limits = regionY_.limits.data();
+	const unsigned int size = regionY_.sums.size();
+	const float g = gain;
+	float acc[4];
 
-	return ySum / pixelSum / (1 << 16);
+#if defined(__ARM_NEON)
+	float32x4_t vgain = vdupq_n_f32(g);
+	float32x4_t vacc = vdupq_n_f32(0.0f);
+
+	for (unsigned int i = 0; i < size; i += 4) {
+		float32x4_t y = vmulq_f32(vld1q_f32(sums + i), vgain);
+		vacc = vaddq_f32(vacc, vminq_f32(y, vld1q_f32(limits + i)));
+	}
+
+	vst1q_f32(acc, vacc);
+#elif defined(__SSE2__)
+	__m128 vgain = _mm_set1_ps(g);
+	__m128 vacc = _mm_setzero_ps();
+
+	for (unsigned int i = 0; i < size; i += 4) {
+		__m128 y = _mm_mul_ps(_mm_loadu_ps(sums + i), vgain);
+		vacc = _mm_add_ps(vacc, _mm_min_ps(y, _mm_loadu_ps(limits + i)));
+	}
+
+	_mm_storeu_ps(acc, vacc);
+#else
+	std::fill(std::begin(acc), std::end(acc), 0.0f);
+
+	for (unsigned int i = 0; i < size; i += 4) {
+		for (unsigned int j = 0; j < 4; j++)
+			acc[j] += std::min(sums[i + j] * g, limits[i + j]);
+	}
+#endif
+
+	double ySum = static_cast<double>(acc[0]) + acc[1] + acc[2] + acc[3];
+
+	return ySum / regionY_.pixelSum / (1 << 16);
 }
 
 /*
@@ -712,7 +798,7 @@ static double computeInitialY(StatisticsPtr &stats, AwbStatus const &awb,
 
 static constexpr double EvGainYTargetLimit = 0.9;
 
-static double constraintComputeGain(AgcConstraint &c, const Histogram &h, double lux,
+static double constraintComputeGain(const AgcConstraint &c, const Histogram &h, double lux,
 				    double evGain, double &targetY)
 {
 	targetY = c.yTarget.eval(c.yTarget.domain().clip(lux));
@@ -726,24 +812,26 @@ void AgcChannel::computeGain(StatisticsPtr &statistics, Metadata *imageMetadata,
 {
 	struct LuxStatus lux = {};
 	lux.lux = 400; /* default lux level to 400 in case no metadata found */
-	if (imageMetadata->get("lux.status", lux) != 0)
+	if (imageMetadata->get(LuxStatusTag, lux) != 0)
 		LOG(RPiAgc, Warning) << "No lux level found";
 	const Histogram &h = statistics->yHist;
-	double evGain = status_.ev * config_.baseEv;
+	double evGain = status_.ev * config_->baseEv;
 	/*
 	 * The initial gain and target_Y come from some of the regions. After
 	 * that we consider the histogram constraints.
 	 */
-	targetY = config_.yTarget.eval(config_.yTarget.domain().clip(lux.lux));
+	targetY = config_->yTarget.eval(config_->yTarget.domain().clip(lux.lux));
 	targetY = std::min(EvGainYTargetLimit, targetY * evGain);
 
 	/*
 	 * Do this calculation a few times as brightness increase can be
 	 * non-linear when there are saturated regions.
 	 */
+	prepareRegionY(statistics);
+
 	gain = 1.0;
 	for (int i = 0; i < 8; i++) {
-		double initialY = computeInitialY(statistics, awb_, meteringMode_->weights, gain);
+		double initialY = computeInitialY(statistics, gain);
 		double extraGain = std::min(10.0, targetY / (initialY + .001));
 		gain *= extraGain;
 		LOG(RPiAgc, Debug) << "Initial Y " << initialY << " target " << targetY
@@ -752,7 +840,7 @@ void AgcChannel::computeGain(StatisticsPtr &statistics, Metadata *imageMetadata,
 			break;
 	}
 
-	for (auto &c : *constraintMode_) {
+	for (const auto &c : *constraintMode_) {
 		double newTargetY;
 		double newGain = constraintComputeGain(c, h, lux.lux, evGain, newTargetY);
 		LOG(RPiAgc, Debug) << "Constraint has target_Y "
@@ -768,7 +856,7 @@ void AgcChannel::computeGain(StatisticsPtr &statistics, Metadata *imageMetadata,
 		}
 	}
 	LOG(RPiAgc, Debug) << "Final gain " << gain << " (target_Y " << targetY << " ev "
-			   << status_.ev << " base_ev " << config_.baseEv
+			   << status_.ev << " base_ev " << config_->baseEv
 			   << ")";
 }
 
@@ -812,7 +900,7 @@ bool AgcChannel::applyChannelConstraints(const AgcChannelTotalExposures &channel
 	LOG(RPiAgc, Debug)
 		<< "Total exposure before channel constraints " << filtered_.totalExposure;
 
-	for (const auto &constraint : config_.channelConstraints) {
+	for (const auto &constraint : config_->channelConstraints) {
 		LOG(RPiAgc, Debug)
 			<< "Check constraint: channel " << constraint.channel << " bound "
 			<< (constraint.bound == AgcChannelConstraint::Bound::UPPER ? "UPPER" : "LOWER")
@@ -864,11 +952,11 @@ bool AgcChannel::applyDigitalGain(double gain, double targetY, bool channelBound
 	 * below).
 	 */
 	bool desaturate = false;
-	if (config_.desaturate)
+	if (config_->desaturate)
 		desaturate = !channelBound &&
-			     targetY > config_.fastReduceThreshold && gain < sqrt(targetY);
+			     targetY > config_->fastReduceThreshold && gain < sqrt(targetY);
 	if (desaturate)
-		dg /= config_.fastReduceThreshold;
+		dg /= config_->fastReduceThreshold;
 	LOG(RPiAgc, Debug) << "Digital gain " << dg << " desaturate? " << desaturate;
 	filtered_.totalExposureNoDG = filtered_.totalExposure / dg;
 	LOG(RPiAgc, Debug) << "Target totalExposureNoDG " << filtered_.totalExposureNoDG;
@@ -877,15 +965,15 @@ bool AgcChannel::applyDigitalGain(double gain, double targetY, bool channelBound
 
 void AgcChannel::filterExposure()
 {
-	double speed = config_.speed;
-	double stableRegion = config_.stableRegion;
+	double speed = config_->speed;
+	double stableRegion = config_->stableRegion;
 
 	/*
 	 * AGC adapts instantly if both shutter and gain are directly specified
 	 * or we're in the startup phase.
 	 */
 	if ((status_.fixedShutter && status_.fixedAnalogueGain) ||
-	    frameCount_ <= config_.startupFrames)
+	    frameCount_ <= config_->startupFrames)
 		speed = 1.0;
 	if (!filtered_.totalExposure) {
 		filtered_.totalExposure = target_.totalExposure;
@@ -984,7 +1072,7 @@ void AgcChannel::writeAndFinish(Metadata *imageMetadata, bool desaturate)
 	 * Write to metadata as well, in case anyone wants to update the camera
 	 * immediately.
 	 */
-	imageMetadata->set("agc.status", status_);
+	imageMetadata->set(AgcStatusTag, status_);
 	LOG(RPiAgc, Debug) << "Output written, total exposure requested is "
 			   << filtered_.totalExposure;
 	LOG(RPiAgc, Debug) << "Camera exposure update: shutter time " << filtered_.shutter
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -83,8 +84,9 @@ class AgcChannel
 {
 public:
 	AgcChannel();
-	int read(const libcamera::YamlObject &params,
-		 const Controller::HardwareConfig &hardwareConfig);
+	static int readConfig(AgcConfig &config, const libcamera::YamlObject &params,
+			      const Controller::HardwareConfig &hardwareConfig);
+	void setConfig(std::shared_ptr<const AgcConfig> config);
 	unsigned int getConvergenceFrames() const;
 	std::vector<double> const &getWeights() const;
 	void setEv(double ev);
@@ -104,10 +106,12 @@ public:
 
 private:
 	bool updateLockStatus(DeviceStatus const &deviceStatus);
-	AgcConfig config_;
+	std::shared_ptr<const AgcConfig> config_;
 	void housekeepConfig();
 	void fetchCurrentExposure(DeviceStatus const &deviceStatus);
 	void fetchAwbStatus(Metadata *imageMetadata);
+	void prepareRegionY(StatisticsPtr &stats);
+	double computeInitialY(StatisticsPtr &stats, double gain) const;
 	void computeGain(StatisticsPtr &statistics, Metadata *imageMetadata,
 			 double &gain, double &targetY);
 	void computeTargetExposure(double gain);
@@ -118,12 +122,18 @@ private:
 	void writeAndFinish(Metadata *imageMetadata, bool desaturate);
 	libcamera::utils::Duration limitShutter(libcamera::utils::Duration shutter);
 	double limitGain(double gain) const;
-	AgcMeteringMode *meteringMode_;
-	AgcExposureMode *exposureMode_;
-	AgcConstraintMode *constraintMode_;
+	const AgcMeteringMode *meteringMode_;
+	const AgcExposureMode *exposureMode_;
+	const AgcConstraintMode *constraintMode_;
 	CameraMode mode_;
 	uint64_t frameCount_;
 	AwbStatus awb_;
+	struct RegionY {
+		std::vector<float> sums; /* luminance weighted colour sums */
+		std::vector<float> limits; /* saturation limits of the sums */
+		double pixelSum;
+	};
+	RegionY regionY_;
 	struct ExposureValues {
 		ExposureValues();
 
@@ -6,6 +6,7 @@
  */
 
 #include <algorithm>
+#include <cmath>
 #include <functional>
 #include <math.h>
 #include <numeric>
@@ -27,21 +28,22 @@ LOG_DEFINE_CATEGORY(RPiAlsc)
 
 static const double InsufficientData = -1.0;
 
+/*
+ * Calibration tables are cached for colour temperatures rounded to this many
+ * Kelvin, which is far finer than the calibrations themselves.
+ */
+static const int CalTableCtQuantum = 10;
+static const unsigned int CalTableCacheSize = 8;
+
 Alsc::Alsc(Controller *controller)
 	: Algorithm(controller)
 {
-	asyncAbort_ = asyncStart_ = asyncStarted_ = asyncFinished_ = false;
-	asyncThread_ = std::thread(std::bind(&Alsc::asyncFunc, this));
 }
 
 Alsc::~Alsc()
 {
-	{
-		std::lock_guard<std::mutex> lock(mutex_);
-		asyncAbort_ = true;
-	}
-	asyncSignal_.notify_one();
-	asyncThread_.join();
+	/* The calculation refers to us, so it must not outlive us. */
+	waitForAysncThread();
 }
 
 char const *Alsc::name() const
@@ -88,13 +90,8 @@ static int readLut(Array2D<double> &lut, const libcamera::YamlObject &params)
 		return -EINVAL;
 	}
 
-	int num = 0;
-	for (const auto &p : params.asList()) {
-		auto value = p.get<double>();
-		if (!value)
-			return -EINVAL;
-		lut[num++] = *value;
-	}
+	if (!params.getList(Span<double>(lut.ptr(), lut.size())))
+		return -EINVAL;
 
 	return 0;
 }
@@ -126,14 +123,10 @@ static int readCalibrations(std::vector<AlscCalibration> &calibrations,
 				return -EINVAL;
 			}
 
-			int num = 0;
 			calibration.table.resize(size);
-			for (const auto &elem : table.asList()) {
-				value = elem.get<double>();
-				if (!value)
-					return -EINVAL;
-				calibration.table[num++] = *value;
-			}
+			if (!table.getList(Span<double>(calibration.table.ptr(),
+							calibration.table.size())))
+				return -EINVAL;
 
 			calibrations.push_back(std::move(calibration));
 			LOG(RPiAlsc, Debug)
@@ -143,51 +136,61 @@ static int readCalibrations(std::vector<AlscCalibration> &calibrations,
 	return 0;
 }
 
-int Alsc::read(const libcamera::YamlObject &params)
+int AlscConfig::read(const libcamera::YamlObject &params,
+		     const libcamera::Size &size)
 {
-	config_.tableSize = getHardwareConfig().awbRegions;
-	config_.framePeriod = params["frame_period"].get<uint16_t>(12);
-	config_.startupFrames = params["startup_frames"].get<uint16_t>(10);
-	config_.speed = params["speed"].get<double>(0.05);
+	tableSize = size;
+	framePeriod = params["frame_period"].get<uint16_t>(12);
+	startupFrames = params["startup_frames"].get<uint16_t>(10);
+	stableInterval = params["stable_interval"].get<unsigned int>(4);
+	speed = params["speed"].get<double>(0.05);
 	double sigma = params["sigma"].get<double>(0.01);
-	config_.sigmaCr = params["sigma_Cr"].get<double>(sigma);
-	config_.sigmaCb = params["sigma_Cb"].get<double>(sigma);
-	config_.minCount = params["min_count"].get<double>(10.0);
-	config_.minG = params["min_G"].get<uint16_t>(50);
-	config_.omega = params["omega"].get<double>(1.3);
-	config_.nIter = params["n_iter"].get<uint32_t>(config_.tableSize.width + config_.tableSize.height);
-	config_.luminanceStrength =
+	sigmaCr = params["sigma_Cr"].get<double>(sigma);
+	sigmaCb = params["sigma_Cb"].get<double>(sigma);
+	minCount = params["min_count"].get<double>(10.0);
+	minG = params["min_G"].get<uint16_t>(50);
+	omega = params["omega"].get<double>(1.3);
+	nIter = params["n_iter"].get<uint32_t>(tableSize.width + tableSize.height);
+	luminanceStrength =
 		params["luminance_strength"].get<double>(1.0);
 
-	config_.luminanceLut.resize(config_.tableSize, 1.0);
+	luminanceLut.resize(tableSize, 1.0);
 	int ret = 0;
 
 	if (params.contains("corner_strength"))
-		ret = generateLut(config_.luminanceLut, params);
+		ret = generateLut(luminanceLut, params);
 	else if (params.contains("luminance_lut"))
-		ret = readLut(config_.luminanceLut, params["luminance_lut"]);
+		ret = readLut(luminanceLut, params["luminance_lut"]);
 	else
 		LOG(RPiAlsc, Warning)
 			<< "no luminance table - assume unity everywhere";
 	if (ret)
 		return ret;
 
-	ret = readCalibrations(config_.calibrationsCr, params, "calibrations_Cr",
-			       config_.tableSize);
+	ret = readCalibrations(calibrationsCr, params, "calibrations_Cr",
+			       tableSize);
 	if (ret)
 		return ret;
-	ret = readCalibrations(config_.calibrationsCb, params, "calibrations_Cb",
-			       config_.tableSize);
+	ret = readCalibrations(calibrationsCb, params, "calibrations_Cb",
+			       tableSize);
 	if (ret)
 		return ret;
 
-	config_.defaultCt = params["default_ct"].get<double>(4500.0);
-	config_.threshold = params["threshold"].get<double>(1e-3);
-	config_.lambdaBound = params["lambda_bound"].get<double>(0.05);
+	defaultCt = params["default_ct"].get<double>(4500.0);
+	threshold = params["threshold"].get<double>(1e-3);
+	lambdaBound = params["lambda_bound"].get<double>(0.05);
+	floatSolver = params["float_solver"].get<bool>(false);
 
 	return 0;
 }
 
+int Alsc::read(const libcamera::YamlObject &params)
+{
+	return readConfig(config_, [&](AlscConfig &config) {
+		return config.read(params, getHardwareConfig().awbRegions);
+	});
+}
+
 static double getCt(Metadata *metadata, double defaultCt);
 static void getCalTable(double ct, std::vector<AlscCalibration> const &calibrations,
 			Array2D<double> &calTable);
@@ -206,41 +209,35 @@ void Alsc::initialise()
 {
 	frameCount2_ = frameCount_ = framePhase_ = 0;
 	firstTime_ = true;
-	ct_ = config_.defaultCt;
+	ct_ = config_->defaultCt;
 
-	const size_t XY = config_.tableSize.width * config_.tableSize.height;
+	const size_t XY = config_->tableSize.width * config_->tableSize.height;
 
 	for (auto &r : syncResults_)
-		r.resize(config_.tableSize);
+		r.resize(config_->tableSize);
 	for (auto &r : prevSyncResults_)
-		r.resize(config_.tableSize);
+		r.resize(config_->tableSize);
 	for (auto &r : asyncResults_)
-		r.resize(config_.tableSize);
+		r.resize(config_->tableSize);
 
-	luminanceTable_.resize(config_.tableSize);
-	asyncLambdaR_.resize(config_.tableSize);
-	asyncLambdaB_.resize(config_.tableSize);
+	luminanceTable_.resize(config_->tableSize);
+	asyncLambdaR_.resize(config_->tableSize);
+	asyncLambdaB_.resize(config_->tableSize);
 	/* The lambdas are initialised in the SwitchMode. */
-	lambdaR_.resize(config_.tableSize);
-	lambdaB_.resize(config_.tableSize);
+	lambdaR_.resize(config_->tableSize);
+	lambdaB_.resize(config_->tableSize);
 
 	/* Temporaries for the computations, but sensible to allocate this up-front! */
 	for (auto &c : tmpC_)
-		c.resize(config_.tableSize);
+		c.resize(config_->tableSize);
 	for (auto &m : tmpM_)
 		m.resize(XY);
 }
 
 void Alsc::waitForAysncThread()
 {
-	if (asyncStarted_) {
-		asyncStarted_ = false;
-		std::unique_lock<std::mutex> lock(mutex_);
-		syncSignal_.wait(lock, [&] {
-			return asyncFinished_;
-		});
-		asyncFinished_ = false;
-	}
+	if (asyncResult_.valid())
+		asyncResult_.get();
 }
 
 static bool compareModes(CameraMode const &cm0, CameraMode const &cm1)
@@ -284,12 +281,14 @@ void Alsc::switchMode(CameraMode const &cameraMode,
 	waitForAysncThread();
 
 	cameraMode_ = cameraMode;
+	/* The cached calibration tables were resampled for the old mode. */
+	calTableCache_.clear();
 
 	/*
 	 * We must resample the luminance table like we do the others, but it's
 	 * fixed so we can simply do it up front here.
 	 */
-	resampleCalTable(config_.luminanceLut, cameraMode_, luminanceTable_);
+	resampleCalTable(config_->luminanceLut, cameraMode_, luminanceTable_);
 
 	if (resetTables) {
 		/*
@@ -301,26 +300,57 @@ void Alsc::switchMode(CameraMode const &cameraMode,
 		 */
 		std::fill(lambdaR_.begin(), lambdaR_.end(), 1.0);
 		std::fill(lambdaB_.begin(), lambdaB_.end(), 1.0);
-		Array2D<double> &calTableR = tmpC_[0], &calTableB = tmpC_[1], &calTableTmp = tmpC_[2];
-		getCalTable(ct_, config_.calibrationsCr, calTableTmp);
-		resampleCalTable(calTableTmp, cameraMode_, calTableR);
-		getCalTable(ct_, config_.calibrationsCb, calTableTmp);
-		resampleCalTable(calTableTmp, cameraMode_, calTableB);
-		compensateLambdasForCal(calTableR, lambdaR_, asyncLambdaR_);
-		compensateLambdasForCal(calTableB, lambdaB_, asyncLambdaB_);
+		const CalTables &calTables = getCalTables(ct_);
+		compensateLambdasForCal(calTables.r, lambdaR_, asyncLambdaR_);
+		compensateLambdasForCal(calTables.b, lambdaB_, asyncLambdaB_);
 		addLuminanceToTables(syncResults_, asyncLambdaR_, 1.0, asyncLambdaB_,
-				     luminanceTable_, config_.luminanceStrength);
+				     luminanceTable_, config_->luminanceStrength);
 		prevSyncResults_ = syncResults_;
-		framePhase_ = config_.framePeriod; /* run the algo again asap */
+		framePhase_ = config_->framePeriod; /* run the algo again asap */
 		firstTime_ = false;
 	}
 }
 
+const Alsc::CalTables &Alsc::getCalTables(double ct)
+{
+	int key = std::lround(ct / CalTableCtQuantum) * CalTableCtQuantum;
+
+	auto it = std::find_if(calTableCache_.begin(), calTableCache_.end(),
+			       [key](const CalTables &tables) { return tables.ct == key; });
+	if (it != calTableCache_.end()) {
+		calTableCache_.splice(calTableCache_.begin(), calTableCache_, it);
+		return calTableCache_.front();
+	}
+
+	if (calTableCache_.size() < CalTableCacheSize) {
+		calTableCache_.emplace_front();
+		calTableCache_.front().r.resize(config_->tableSize);
+		calTableCache_.front().b.resize(config_->tableSize);
+	} else {
+		/* Recycle the least recently used entry. */
+		calTableCache_.splice(calTableCache_.begin(), calTableCache_,
+				      std::prev(calTableCache_.end()));
+	}
+
+	/*
+	 * Fetch the new calibrations (if any) for this CT. Resample them in
+	 * case the camera mode is not full-frame.
+	 */
+	CalTables &tables = calTableCache_.front();
+	Array2D<double> &calTableTmp = tmpC_[4];
+	tables.ct = key;
+	getCalTable(key, config_->calibrationsCr, calTableTmp);
+	resampleCalTable(calTableTmp, cameraMode_, tables.r);
+	getCalTable(key, config_->calibrationsCb, calTableTmp);
+	resampleCalTable(calTableTmp, cameraMode_, tables.b);
+
+	return tables;
+}
+
 void Alsc::fetchAsyncResults()
 {
 	LOG(RPiAlsc, Debug) << "Fetch ALSC results";
-	asyncFinished_ = false;
-	asyncStarted_ = false;
+	asyncResult_.get();
 	syncResults_ = asyncResults_;
 }
 
@@ -328,7 +358,7 @@ double getCt(Metadata *metadata, double defaultCt)
 {
 	AwbStatus awbStatus;
 	awbStatus.temperatureK = defaultCt; /* in case nothing found */
-	if (metadata->get("awb.status", awbStatus) != 0)
+	if (metadata->get(AwbStatusTag, awbStatus) != 0)
 		LOG(RPiAlsc, Debug) << "no AWB results found, using "
 				    << awbStatus.temperatureK;
 	else
@@ -372,12 +402,7 @@ void Alsc::restartAsync(StatisticsPtr &stats, Metadata *imageMetadata)
 	 */
 	copyStats(statistics_, stats, prevSyncResults_);
 	framePhase_ = 0;
-	asyncStarted_ = true;
-	{
-		std::lock_guard<std::mutex> lock(mutex_);
-		asyncStart_ = true;
-	}
-	asyncSignal_.notify_one();
+	asyncResult_ = getWorkerPool().submit([this] { doAlsc(); });
 }
 
 void Alsc::prepare(Metadata *imageMetadata)
@@ -386,18 +411,16 @@ void Alsc::prepare(Metadata *imageMetadata)
 	 * Count frames since we started, and since we last poked the async
 	 * thread.
 	 */
-	if (frameCount_ < (int)config_.startupFrames)
+	if (frameCount_ < (int)config_->startupFrames)
 		frameCount_++;
-	double speed = frameCount_ < (int)config_.startupFrames
+	double speed = frameCount_ < (int)config_->startupFrames
 			       ? 1.0
-			       : config_.speed;
+			       : config_->speed;
 	LOG(RPiAlsc, Debug)
 		<< "frame count " << frameCount_ << " speed " << speed;
-	{
-		std::unique_lock<std::mutex> lock(mutex_);
-		if (asyncStarted_ && asyncFinished_)
-			fetchAsyncResults();
-	}
+	if (asyncResult_.valid() &&
+	    asyncResult_.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		fetchAsyncResults();
 	/* Apply IIR filter to results and program into the pipeline. */
 	for (unsigned int j = 0; j < syncResults_.size(); j++) {
 		for (unsigned int i = 0; i < syncResults_[j].size(); i++)
@@ -408,12 +431,12 @@ void Alsc::prepare(Metadata *imageMetadata)
 	status.r = prevSyncResults_[0].data();
 	status.g = prevSyncResults_[1].data();
 	status.b = prevSyncResults_[2].data();
-	imageMetadata->set("alsc.status", status);
+	imageMetadata->set(AlscStatusTag, status);
 	/*
 	 * Put the results in the global metadata as well. This will be used by
 	 * AWB to factor in the colour shading correction.
 	 */
-	getGlobalMetadata().set("alsc.status", status);
+	getGlobalMetadata().set(AlscStatusTag, status);
 }
 
 void Alsc::process(StatisticsPtr &stats, Metadata *imageMetadata)
@@ -422,37 +445,21 @@ void Alsc::process(StatisticsPtr &stats, Metadata *imageMetadata)
 	 * Count frames since we started, and since we last poked the async
 	 * thread.
 	 */
-	if (framePhase_ < (int)config_.framePeriod)
+	if (framePhase_ < (int)config_->framePeriod)
 		framePhase_++;
-	if (frameCount2_ < (int)config_.startupFrames)
+	if (frameCount2_ < (int)config_->startupFrames)
 		frameCount2_++;
 	LOG(RPiAlsc, Debug) << "frame_phase " << framePhase_;
-	if (framePhase_ >= (int)config_.framePeriod ||
-	    frameCount2_ < (int)config_.startupFrames) {
-		if (asyncStarted_ == false)
+	if (framePhase_ >= (int)config_->framePeriod ||
+	    frameCount2_ < (int)config_->startupFrames) {
+		if (!asyncResult_.valid())
 			restartAsync(stats, imageMetadata);
 	}
 }
 
-void Alsc::asyncFunc()
+unsigned int Alsc::processInterval() const
 {
-	while (true) {
-		{
-			std::unique_lock<std::mutex> lock(mutex_);
-			asyncSignal_.wait(lock, [&] {
-				return asyncStart_ || asyncAbort_;
-			});
-			asyncStart_ = false;
-			if (asyncAbort_)
-				break;
-		}
-		doAlsc();
-		{
-			std::lock_guard<std::mutex> lock(mutex_);
-			asyncFinished_ = true;
-		}
-		syncSignal_.notify_one();
-	}
+	return frameCount2_ < (int)config_->startupFrames ? 1 : config_->stableInterval;
 }
 
 void getCalTable(double ct, std::vector<AlscCalibration> const &calibrations,
@@ -782,6 +789,85 @@ static void runMatrixIterations(const Array2D<double> &C,
 	reaverage(lambda);
 }
 
+/*
+ * Single-precision equivalent of runMatrixIterations(). The zones are updated
+ * in red-black (checkerboard) order: every neighbour of a "red" zone is
+ * "black" and vice versa, so all the zones of one colour can be updated
+ * independently of each other, which lets the compiler vectorise the inner
+ * loop. Over-relaxation is applied to each zone as it is updated.
+ *
+ * Like the double-precision version, this starts from the lambdas left by the
+ * previous run, which normally leaves only a few iterations to do.
+ */
+static void runMatrixIterationsFloat(const Array2D<double> &C,
+				     Array2D<double> &lambda,
+				     const SparseArray<double> &W,
+				     SparseArray<double> &M, AlscSolverBuffers &buffers,
+				     double omega, unsigned int nIter,
+				     double threshold, double lambdaBound)
+{
+	const unsigned int X = C.dimensions().width;
+	const unsigned int Y = C.dimensions().height;
+	const unsigned int PX = X + 2;
+	const Size paddedSize(PX, Y + 2);
+
+	if (buffers.paddedSize != paddedSize) {
+		buffers.paddedSize = paddedSize;
+		for (auto &m : buffers.m)
+			m.assign(paddedSize.width * paddedSize.height, 0.0f);
+		buffers.lambda.assign(paddedSize.width * paddedSize.height, 0.0f);
+	}
+
+	constructM(C, W, M);
+	for (unsigned int y = 0; y < Y; y++) {
+		for (unsigned int x = 0; x < X; x++) {
+			unsigned int i = y * X + x;
+			unsigned int p = (y + 1) * PX + x + 1;
+			for (unsigned int k = 0; k < 4; k++)
+				buffers.m[k][p] = M[i][k];
+			buffers.lambda[p] = lambda[i];
+		}
+	}
+
+	const float *m0 = buffers.m[0].data();
+	const float *m1 = buffers.m[1].data();
+	const float *m2 = buffers.m[2].data();
+	const float *m3 = buffers.m[3].data();
+	float *l = buffers.lambda.data();
+	const float w = omega;
+	const float min = 1 - lambdaBound, max = 1 + lambdaBound;
+
+	unsigned int iter;
+	for (iter = 0; iter < nIter; iter++) {
+		float maxDiff = 0;
+		for (unsigned int colour = 0; colour < 2; colour++) {
+			for (unsigned int y = 0; y < Y; y++) {
+				unsigned int row = (y + 1) * PX + 1;
+				for (unsigned int x = (y + colour) & 1; x < X; x += 2) {
+					unsigned int p = row + x;
+					float gs = m0[p] * l[p - PX] + m1[p] * l[p + 1] +
+						   m2[p] * l[p + PX] + m3[p] * l[p - 1];
+					float v = std::clamp(l[p] + w * (gs - l[p]), min, max);
+					maxDiff = std::max(maxDiff, std::abs(v - l[p]));
+					l[p] = v;
+				}
+			}
+		}
+		if (maxDiff < threshold) {
+			LOG(RPiAlsc, Debug)
+				<< "Stop after " << iter + 1 << " iterations";
+			break;
+		}
+	}
+
+	for (unsigned int y = 0; y < Y; y++) {
+		for (unsigned int x = 0; x < X; x++)
+			lambda[y * X + x] = l[(y + 1) * PX + x + 1];
+	}
+	/* We're going to normalise the lambdas so the total average is 1. */
+	reaverage(lambda);
+}
+
 static void addLuminanceRb(Array2D<double> &result, const Array2D<double> &lambda,
 			   const Array2D<double> &luminanceLut,
 			   double luminanceStrength)
@@ -813,23 +899,20 @@ void addLuminanceToTables(std::array<Array2D<double>, 3> &results,
 
 void Alsc::doAlsc()
 {
-	Array2D<double> &cr = tmpC_[0], &cb = tmpC_[1], &calTableR = tmpC_[2],
-			&calTableB = tmpC_[3], &calTableTmp = tmpC_[4];
+	Array2D<double> &cr = tmpC_[0], &cb = tmpC_[1];
 	SparseArray<double> &wr = tmpM_[0], &wb = tmpM_[1], &M = tmpM_[2];
 
 	/*
 	 * Calculate our R/B ("Cr"/"Cb") colour statistics, and assess which are
 	 * usable.
 	 */
-	calculateCrCb(statistics_, cr, cb, config_.minCount, config_.minG);
+	calculateCrCb(statistics_, cr, cb, config_->minCount, config_->minG);
 	/*
-	 * Fetch the new calibrations (if any) for this CT. Resample them in
-	 * case the camera mode is not full-frame.
+	 * Fetch the calibrations for this CT, which are usually unchanged
+	 * from the last run.
 	 */
-	getCalTable(ct_, config_.calibrationsCr, calTableTmp);
-	resampleCalTable(calTableTmp, cameraMode_, calTableR);
-	getCalTable(ct_, config_.calibrationsCb, calTableTmp);
-	resampleCalTable(calTableTmp, cameraMode_, calTableB);
+	const CalTables &calTables = getCalTables(ct_);
+	const Array2D<double> &calTableR = calTables.r, &calTableB = calTables.b;
 	/*
 	 * You could print out the cal tables for this image here, if you're
 	 * tuning the algorithm...
@@ -839,13 +922,22 @@ void Alsc::doAlsc()
 	applyCalTable(calTableR, cr);
 	applyCalTable(calTableB, cb);
 	/* Compute weights between zones. */
-	computeW(cr, config_.sigmaCr, wr);
-	computeW(cb, config_.sigmaCb, wb);
+	computeW(cr, config_->sigmaCr, wr);
+	computeW(cb, config_->sigmaCb, wb);
 	/* Run Gauss-Seidel iterations over the resulting matrix, for R and B. */
-	runMatrixIterations(cr, lambdaR_, wr, M, config_.omega, config_.nIter,
-			    config_.threshold, config_.lambdaBound);
-	runMatrixIterations(cb, lambdaB_, wb, M, config_.omega, config_.nIter,
-			    config_.threshold, config_.lambdaBound);
+	if (config_->floatSolver) {
+		runMatrixIterationsFloat(cr, lambdaR_, wr, M, solver_, config_->omega,
+					 config_->nIter, config_->threshold,
+					 config_->lambdaBound);
+		runMatrixIterationsFloat(cb, lambdaB_, wb, M, solver_, config_->omega,
+					 config_->nIter, config_->threshold,
+					 config_->lambdaBound);
+	} else {
+		runMatrixIterations(cr, lambdaR_, wr, M, config_->omega, config_->nIter,
+				    config_->threshold, config_->lambdaBound);
+		runMatrixIterations(cb, lambdaB_, wb, M, config_->omega, config_->nIter,
+				    config_->threshold, config_->lambdaBound);
+	}
 	/*
 	 * Fold the calibrated gains into our final lambda values. (Note that on
 	 * the next run, we re-start with the lambda values that don't have the
@@ -856,7 +948,7 @@ void Alsc::doAlsc()
 	/* Fold in the luminance table at the appropriate strength. */
 	addLuminanceToTables(asyncResults_, asyncLambdaR_, 1.0,
 			     asyncLambdaB_, luminanceTable_,
-			     config_.luminanceStrength);
+			     config_->luminanceStrength);
 }
 
 /* Register algorithm with the system. */
@@ -7,9 +7,9 @@
 #pragma once
 
 #include <array>
-#include <mutex>
-#include <condition_variable>
-#include <thread>
+#include <future>
+#include <list>
+#include <memory>
 #include <vector>
 
 #include <libcamera/geometry.h>
@@ -76,16 +76,30 @@ private:
 template<typename T>
 using SparseArray = std::vector<std::array<T, 4>>;
 
+/*
+ * Working storage for the single-precision solver. The matrix coefficients are
+ * kept as one array per neighbour, and all the arrays have a border of one
+ * zone all round so that no zone needs special treatment at the edges.
+ */
+struct AlscSolverBuffers {
+	libcamera::Size paddedSize;
+	std::array<std::vector<float>, 4> m;
+	std::vector<float> lambda;
+};
+
 struct AlscCalibration {
 	double ct;
 	Array2D<double> table;
 };
 
 struct AlscConfig {
+	int read(const libcamera::YamlObject &params, const libcamera::Size &size);
 	/* Only repeat the ALSC calculation every "this many" frames */
 	uint16_t framePeriod;
 	/* number of initial frames for which speed taken as 1.0 (maximum) */
 	uint16_t startupFrames;
+	/* process() only every "this many" frames once converged and stable */
+	unsigned int stableInterval;
 	/* IIR filter speed applied to algorithm results */
 	double speed;
 	double sigmaCr;
@@ -101,6 +115,7 @@ struct AlscConfig {
 	double defaultCt; /* colour temperature if no metadata found */
 	double threshold; /* iteration termination threshold */
 	double lambdaBound; /* upper/lower bound for lambda from a value of 1 */
+	bool floatSolver; /* use the single-precision red-black solver */
 	libcamera::Size tableSize;
 };
 
@@ -115,32 +130,22 @@ public:
 	int read(const libcamera::YamlObject &params) override;
 	void prepare(Metadata *imageMetadata) override;
 	void process(StatisticsPtr &stats, Metadata *imageMetadata) override;
+	unsigned int processInterval() const override;
 
 private:
-	/* configuration is read-only, and available to both threads */
-	AlscConfig config_;
+	/*
+	 * configuration is read-only, available to both threads, and shared
+	 * with the other cameras using the same tuning file
+	 */
+	std::shared_ptr<const AlscConfig> config_;
 	bool firstTime_;
 	CameraMode cameraMode_;
 	Array2D<double> luminanceTable_;
-	std::thread asyncThread_;
-	void asyncFunc(); /* asynchronous thread function */
-	std::mutex mutex_;
-	/* condvar for async thread to wait on */
-	std::condition_variable asyncSignal_;
-	/* condvar for synchronous thread to wait on */
-	std::condition_variable syncSignal_;
-	/* for sync thread to check  if async thread finished (requires mutex) */
-	bool asyncFinished_;
-	/* for async thread to check if it's been told to run (requires mutex) */
-	bool asyncStart_;
-	/* for async thread to check if it's been told to quit (requires mutex) */
-	bool asyncAbort_;
-
 	/*
 	 * The following are only for the synchronous thread to use:
-	 * for sync thread to note its has asked async thread to run
+	 * completion of the asynchronous calculation, valid while one is running
 	 */
-	bool asyncStarted_;
+	std::future<void> asyncResult_;
 	/* counts up to framePeriod before restarting the async thread */
 	int framePhase_;
 	/* counts up to startupFrames */
@@ -150,6 +155,17 @@ private:
 	std::array<Array2D<double>, 3> syncResults_;
 	std::array<Array2D<double>, 3> prevSyncResults_;
 	void waitForAysncThread();
+	/*
+	 * Calibration tables interpolated for a (quantised) colour temperature
+	 * and resampled for the current camera mode, most recently used first.
+	 */
+	struct CalTables {
+		int ct;
+		Array2D<double> r;
+		Array2D<double> b;
+	};
+	std::list<CalTables> calTableCache_;
+	const CalTables &getCalTables(double ct);
 	/*
 	 * The following are for the asynchronous thread to use, though the main
 	 * thread can set/reset them if the async thread is known to be idle:
@@ -169,6 +185,7 @@ private:
 	/* Temporaries for the computations */
 	std::array<Array2D<double>, 5> tmpC_;
 	std::array<SparseArray<double>, 3> tmpM_;
+	AlscSolverBuffers solver_;
 };
 
 } /* namespace RPiController */
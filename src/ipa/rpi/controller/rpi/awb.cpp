@@ -5,7 +5,9 @@
  * awb.cpp - AWB control algorithm
  */
 
+#include <algorithm>
 #include <assert.h>
+#include <cmath>
 #include <functional>
 
 #include <libcamera/base/log.h>
@@ -22,6 +24,19 @@ LOG_DEFINE_CATEGORY(RPiAwb)
 
 #define NAME "rpi.awb"
 
+/*
+ * Interpolated priors are cached for lux levels rounded to this many steps
+ * per doubling of the lux, far finer than the priors are normally tuned.
+ */
+constexpr double PriorLuxStepsPerOctave = 16.0;
+constexpr unsigned int PriorCacheSize = 8;
+
+/*
+ * Number of candidate gains evaluated together in each pass over the zones.
+ * This is a fixed size so that the compiler can vectorise across candidates.
+ */
+constexpr unsigned int Delta2Batch = 16;
+
 /*
  * todo - the locking in this algorithm needs some tidying up as has been done
  * elsewhere (ALSC and AGC).
@@ -95,6 +110,7 @@ int AwbConfig::read(const libcamera::YamlObject &params)
 	bayes = params["bayes"].get<int>(1);
 	framePeriod = params["frame_period"].get<uint16_t>(10);
 	startupFrames = params["startup_frames"].get<uint16_t>(10);
+	stableInterval = params["stable_interval"].get<unsigned int>(4);
 	convergenceFrames = params["convergence_frames"].get<unsigned int>(3);
 	speed = params["speed"].get<double>(0.05);
 
@@ -172,20 +188,15 @@ int AwbConfig::read(const libcamera::YamlObject &params)
 Awb::Awb(Controller *controller)
 	: AwbAlgorithm(controller)
 {
-	asyncAbort_ = asyncStart_ = asyncStarted_ = asyncFinished_ = false;
 	mode_ = nullptr;
 	manualR_ = manualB_ = 0.0;
-	asyncThread_ = std::thread(std::bind(&Awb::asyncFunc, this));
 }
 
 Awb::~Awb()
 {
-	{
-		std::lock_guard<std::mutex> lock(mutex_);
-		asyncAbort_ = true;
-	}
-	asyncSignal_.notify_one();
-	asyncThread_.join();
+	/* The calculation refers to us, so it must not outlive us. */
+	if (asyncResult_.valid())
+		asyncResult_.wait();
 }
 
 char const *Awb::name() const
@@ -195,7 +206,9 @@ char const *Awb::name() const
 
 int Awb::read(const libcamera::YamlObject &params)
 {
-	return config_.read(params);
+	return readConfig(config_, [&](AwbConfig &config) {
+		return config.read(params);
+	});
 }
 
 void Awb::initialise()
@@ -206,11 +219,11 @@ void Awb::initialise()
 	 * just in case the first few frames don't have anything meaningful in
 	 * them.
 	 */
-	if (!config_.ctR.empty() && !config_.ctB.empty()) {
-		syncResults_.temperatureK = config_.ctR.domain().clip(4000);
-		syncResults_.gainR = 1.0 / config_.ctR.eval(syncResults_.temperatureK);
+	if (!config_->ctR.empty() && !config_->ctB.empty()) {
+		syncResults_.temperatureK = config_->ctR.domain().clip(4000);
+		syncResults_.gainR = 1.0 / config_->ctR.eval(syncResults_.temperatureK);
 		syncResults_.gainG = 1.0;
-		syncResults_.gainB = 1.0 / config_.ctB.eval(syncResults_.temperatureK);
+		syncResults_.gainB = 1.0 / config_->ctB.eval(syncResults_.temperatureK);
 	} else {
 		/* random values just to stop the world blowing up */
 		syncResults_.temperatureK = 4500;
@@ -250,7 +263,7 @@ unsigned int Awb::getConvergenceFrames() const
 	if (!isAutoEnabled())
 		return 0;
 	else
-		return config_.convergenceFrames;
+		return config_->convergenceFrames;
 }
 
 void Awb::setMode(std::string const &modeName)
@@ -271,10 +284,10 @@ void Awb::setManualGains(double manualR, double manualB)
 		syncResults_.gainR = prevSyncResults_.gainR = manualR_;
 		syncResults_.gainG = prevSyncResults_.gainG = 1.0;
 		syncResults_.gainB = prevSyncResults_.gainB = manualB_;
-		if (config_.bayes) {
+		if (config_->bayes) {
 			/* Also estimate the best corresponding colour temperature from the curves. */
-			double ctR = config_.ctRInverse.eval(config_.ctRInverse.domain().clip(1 / manualR_));
-			double ctB = config_.ctBInverse.eval(config_.ctBInverse.domain().clip(1 / manualB_));
+			double ctR = config_->ctRInverse.eval(config_->ctRInverse.domain().clip(1 / manualR_));
+			double ctB = config_->ctBInverse.eval(config_->ctBInverse.domain().clip(1 / manualB_));
 			prevSyncResults_.temperatureK = (ctR + ctB) / 2;
 			syncResults_.temperatureK = prevSyncResults_.temperatureK;
 		}
@@ -285,7 +298,7 @@ void Awb::switchMode([[maybe_unused]] CameraMode const &cameraMode,
 		     Metadata *metadata)
 {
 	/* Let other algorithms know the current white balance values. */
-	metadata->set("awb.status", prevSyncResults_);
+	metadata->set(AwbStatusTag, prevSyncResults_);
 }
 
 bool Awb::isAutoEnabled() const
@@ -296,8 +309,7 @@ bool Awb::isAutoEnabled() const
 void Awb::fetchAsyncResults()
 {
 	LOG(RPiAwb, Debug) << "Fetch AWB results";
-	asyncFinished_ = false;
-	asyncStarted_ = false;
+	asyncResult_.get();
 	/*
 	 * It's possible manual gains could be set even while the async
 	 * thread was running, so only copy the results if still in auto mode.
@@ -309,40 +321,36 @@ void Awb::fetchAsyncResults()
 void Awb::restartAsync(StatisticsPtr &stats, double lux)
 {
 	LOG(RPiAwb, Debug) << "Starting AWB calculation";
-	/* this makes a new reference which belongs to the asynchronous thread */
-	statistics_ = stats;
+	/*
+	 * this makes a new reference which belongs to the asynchronous thread,
+	 * copying the statistics if they are only valid for this frame
+	 */
+	statistics_ = retainStatistics(stats);
 	/* store the mode as it could technically change */
-	auto m = config_.modes.find(modeName_);
-	mode_ = m != config_.modes.end()
+	auto m = config_->modes.find(modeName_);
+	mode_ = m != config_->modes.end()
 			? &m->second
-			: (mode_ == nullptr ? config_.defaultMode : mode_);
+			: (mode_ == nullptr ? config_->defaultMode : mode_);
 	lux_ = lux;
 	framePhase_ = 0;
-	asyncStarted_ = true;
 	size_t len = modeName_.copy(asyncResults_.mode,
 				    sizeof(asyncResults_.mode) - 1);
 	asyncResults_.mode[len] = '\0';
-	{
-		std::lock_guard<std::mutex> lock(mutex_);
-		asyncStart_ = true;
-	}
-	asyncSignal_.notify_one();
+	asyncResult_ = getWorkerPool().submit([this] { doAwb(); });
 }
 
 void Awb::prepare(Metadata *imageMetadata)
 {
-	if (frameCount_ < (int)config_.startupFrames)
+	if (frameCount_ < (int)config_->startupFrames)
 		frameCount_++;
-	double speed = frameCount_ < (int)config_.startupFrames
+	double speed = frameCount_ < (int)config_->startupFrames
 			       ? 1.0
-			       : config_.speed;
+			       : config_->speed;
 	LOG(RPiAwb, Debug)
 		<< "frame_count " << frameCount_ << " speed " << speed;
-	{
-		std::unique_lock<std::mutex> lock(mutex_);
-		if (asyncStarted_ && asyncFinished_)
-			fetchAsyncResults();
-	}
+	if (asyncResult_.valid() &&
+	    asyncResult_.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		fetchAsyncResults();
 	/* Finally apply IIR filter to results and put into metadata. */
 	memcpy(prevSyncResults_.mode, syncResults_.mode,
 	       sizeof(prevSyncResults_.mode));
@@ -354,7 +362,7 @@ void Awb::prepare(Metadata *imageMetadata)
 				 (1.0 - speed) * prevSyncResults_.gainG;
 	prevSyncResults_.gainB = speed * syncResults_.gainB +
 				 (1.0 - speed) * prevSyncResults_.gainB;
-	imageMetadata->set("awb.status", prevSyncResults_);
+	imageMetadata->set(AwbStatusTag, prevSyncResults_);
 	LOG(RPiAwb, Debug)
 		<< "Using AWB gains r " << prevSyncResults_.gainR << " g "
 		<< prevSyncResults_.gainG << " b "
@@ -364,44 +372,28 @@ void Awb::prepare(Metadata *imageMetadata)
 void Awb::process(StatisticsPtr &stats, Metadata *imageMetadata)
 {
 	/* Count frames since we last poked the async thread. */
-	if (framePhase_ < (int)config_.framePeriod)
+	if (framePhase_ < (int)config_->framePeriod)
 		framePhase_++;
 	LOG(RPiAwb, Debug) << "frame_phase " << framePhase_;
 	/* We do not restart the async thread if we're not in auto mode. */
 	if (isAutoEnabled() &&
-	    (framePhase_ >= (int)config_.framePeriod ||
-	     frameCount_ < (int)config_.startupFrames)) {
+	    (framePhase_ >= (int)config_->framePeriod ||
+	     frameCount_ < (int)config_->startupFrames)) {
 		/* Update any settings and any image metadata that we need. */
 		struct LuxStatus luxStatus = {};
 		luxStatus.lux = 400; /* in case no metadata */
-		if (imageMetadata->get("lux.status", luxStatus) != 0)
+		if (imageMetadata->get(LuxStatusTag, luxStatus) != 0)
 			LOG(RPiAwb, Debug) << "No lux metadata found";
 		LOG(RPiAwb, Debug) << "Awb lux value is " << luxStatus.lux;
 
-		if (asyncStarted_ == false)
+		if (!asyncResult_.valid())
 			restartAsync(stats, luxStatus.lux);
 	}
 }
 
-void Awb::asyncFunc()
+unsigned int Awb::processInterval() const
 {
-	while (true) {
-		{
-			std::unique_lock<std::mutex> lock(mutex_);
-			asyncSignal_.wait(lock, [&] {
-				return asyncStart_ || asyncAbort_;
-			});
-			asyncStart_ = false;
-			if (asyncAbort_)
-				break;
-		}
-		doAwb();
-		{
-			std::lock_guard<std::mutex> lock(mutex_);
-			asyncFinished_ = true;
-		}
-		syncSignal_.notify_one();
-	}
+	return frameCount_ < (int)config_->startupFrames ? 1 : config_->stableInterval;
 }
 
 static void generateStats(std::vector<Awb::RGB> &zones,
@@ -412,7 +404,7 @@ static void generateStats(std::vector<Awb::RGB> &zones,
 
 	for (unsigned int i = 0; i < stats->awbRegions.numRegions(); i++) {
 		Awb::RGB zone;
-		auto &region = stats->awbRegions.get(i);
+		const auto &region = stats->awbRegions.get(i);
 		if (region.counted >= minPixels) {
 			zone.G = region.val.gSum / region.counted;
 			if (zone.G < minG)
@@ -420,7 +412,7 @@ static void generateStats(std::vector<Awb::RGB> &zones,
 			zone.R = region.val.rSum / region.counted;
 			zone.B = region.val.bSum / region.counted;
 			/* Factor in the ALSC applied colour shading correction if required. */
-			const AlscStatus *alscStatus = globalMetadata.getLocked<AlscStatus>("alsc.status");
+			const AlscStatus *alscStatus = globalMetadata.getLocked<AlscStatus>(AlscStatusTag);
 			if (stats->colourStatsPos == Statistics::ColourStatsPos::PreLsc && alscStatus) {
 				zone.R *= alscStatus->r[i];
 				zone.G *= alscStatus->g[i];
@@ -438,60 +430,104 @@ void Awb::prepareStats()
 	 * LSC has already been applied to the stats in this pipeline, so stop
 	 * any LSC compensation.  We also ignore config_.fast in this version.
 	 */
-	generateStats(zones_, statistics_, config_.minPixels,
-		      config_.minG, getGlobalMetadata());
+	generateStats(zones_, statistics_, config_->minPixels,
+		      config_->minG, getGlobalMetadata());
 	/*
 	 * apply sensitivities, so values appear to come from our "canonical"
 	 * sensor.
 	 */
 	for (auto &zone : zones_) {
-		zone.R *= config_.sensitivityR;
-		zone.B *= config_.sensitivityB;
+		zone.R *= config_->sensitivityR;
+		zone.B *= config_->sensitivityB;
 	}
 }
 
-double Awb::computeDelta2Sum(double gainR, double gainB)
+void Awb::computeDelta2Sums(std::vector<Pwl::Point> const &gains,
+			    std::vector<double> &delta2Sums)
 {
 	/*
 	 * Compute the sum of the squared colour error (non-greyness) as it
-	 * appears in the log likelihood equation.
+	 * appears in the log likelihood equation, for each pair of R and B
+	 * gains. Rather than walking the zones once per candidate, walk them
+	 * once per batch of candidates, accumulating each candidate separately
+	 * so that the inner loop vectorises.
 	 */
-	double delta2Sum = 0;
-	for (auto &z : zones_) {
-		double deltaR = gainR * z.R - 1 - config_.whitepointR;
-		double deltaB = gainB * z.B - 1 - config_.whitepointB;
-		double delta2 = deltaR * deltaR + deltaB * deltaB;
-		/* LOG(RPiAwb, Debug) << "deltaR " << deltaR << " deltaB " << deltaB << " delta2 " << delta2; */
-		delta2 = std::min(delta2, config_.deltaLimit);
-		delta2Sum += delta2;
+	const float offsetR = 1 + config_->whitepointR;
+	const float offsetB = 1 + config_->whitepointB;
+	const float deltaLimit = config_->deltaLimit;
+	const size_t numZones = zoneR_.size();
+
+	delta2Sums.resize(gains.size());
+
+	for (size_t first = 0; first < gains.size(); first += Delta2Batch) {
+		size_t count = std::min<size_t>(gains.size() - first, Delta2Batch);
+		float gainR[Delta2Batch] = {}, gainB[Delta2Batch] = {};
+		float sums[Delta2Batch] = {};
+
+		for (size_t k = 0; k < count; k++) {
+			gainR[k] = gains[first + k].x;
+			gainB[k] = gains[first + k].y;
+		}
+
+		for (size_t i = 0; i < numZones; i++) {
+			const float zoneR = zoneR_[i], zoneB = zoneB_[i];
+			for (unsigned int k = 0; k < Delta2Batch; k++) {
+				float deltaR = gainR[k] * zoneR - offsetR;
+				float deltaB = gainB[k] * zoneB - offsetB;
+				float delta2 = deltaR * deltaR + deltaB * deltaB;
+				sums[k] += std::min(delta2, deltaLimit);
+			}
+		}
+
+		for (size_t k = 0; k < count; k++)
+			delta2Sums[first + k] = sums[k];
 	}
-	return delta2Sum;
 }
 
-Pwl Awb::interpolatePrior()
+const Pwl &Awb::interpolatePrior()
 {
 	/*
 	 * Interpolate the prior log likelihood function for our current lux
 	 * value.
 	 */
-	if (lux_ <= config_.priors.front().lux)
-		return config_.priors.front().prior;
-	else if (lux_ >= config_.priors.back().lux)
-		return config_.priors.back().prior;
-	else {
-		int idx = 0;
-		/* find which two we lie between */
-		while (config_.priors[idx + 1].lux < lux_)
-			idx++;
-		double lux0 = config_.priors[idx].lux,
-		       lux1 = config_.priors[idx + 1].lux;
-		return Pwl::combine(config_.priors[idx].prior,
-				    config_.priors[idx + 1].prior,
-				    [&](double /*x*/, double y0, double y1) {
-					    return y0 + (y1 - y0) *
-							(lux_ - lux0) / (lux1 - lux0);
-				    });
+	if (lux_ <= config_->priors.front().lux)
+		return config_->priors.front().prior;
+	else if (lux_ >= config_->priors.back().lux)
+		return config_->priors.back().prior;
+
+	/*
+	 * The lux level changes a little on every frame even in stable
+	 * lighting, so look the prior up by a quantised lux.
+	 */
+	int key = std::lround(std::log2(lux_) * PriorLuxStepsPerOctave);
+	auto it = std::find_if(priorCache_.begin(), priorCache_.end(),
+			       [key](const auto &entry) { return entry.first == key; });
+	if (it != priorCache_.end()) {
+		priorCache_.splice(priorCache_.begin(), priorCache_, it);
+		return priorCache_.front().second;
 	}
+
+	double lux = std::clamp(std::exp2(key / PriorLuxStepsPerOctave),
+				config_->priors.front().lux,
+				config_->priors.back().lux);
+	int idx = 0;
+	/* find which two we lie between */
+	while (config_->priors[idx + 1].lux < lux)
+		idx++;
+	double lux0 = config_->priors[idx].lux,
+	       lux1 = config_->priors[idx + 1].lux;
+	Pwl prior = Pwl::combine(config_->priors[idx].prior,
+				 config_->priors[idx + 1].prior,
+				 [&](double /*x*/, double y0, double y1) {
+					 return y0 + (y1 - y0) *
+						     (lux - lux0) / (lux1 - lux0);
+				 });
+
+	priorCache_.emplace_front(key, std::move(prior));
+	if (priorCache_.size() > PriorCacheSize)
+		priorCache_.pop_back();
+
+	return priorCache_.front().second;
 }
 
 static double interpolateQuadatric(Pwl::Point const &a, Pwl::Point const &b,
@@ -516,29 +552,35 @@ static double interpolateQuadatric(Pwl::Point const &a, Pwl::Point const &b,
 double Awb::coarseSearch(Pwl const &prior)
 {
 	points_.clear(); /* assume doesn't deallocate memory */
+	gains_.clear();
 	size_t bestPoint = 0;
 	double t = mode_->ctLo;
 	int spanR = 0, spanB = 0;
-	/* Step down the CT curve evaluating log likelihood. */
+	/* Step down the CT curve collecting the gains to evaluate. */
 	while (true) {
-		double r = config_.ctR.eval(t, &spanR);
-		double b = config_.ctB.eval(t, &spanB);
-		double gainR = 1 / r, gainB = 1 / b;
-		double delta2Sum = computeDelta2Sum(gainR, gainB);
+		double r = config_->ctR.eval(t, &spanR);
+		double b = config_->ctB.eval(t, &spanB);
+		points_.push_back(Pwl::Point(t, 0));
+		gains_.push_back(Pwl::Point(1 / r, 1 / b));
+		if (t == mode_->ctHi)
+			break;
+		/* for even steps along the r/b curve scale them by the current t */
+		t = std::min(t + t / 10 * config_->coarseStep, mode_->ctHi);
+	}
+	/* Now evaluate the log likelihood of all of them. */
+	computeDelta2Sums(gains_, delta2Sums_);
+	for (size_t i = 0; i < points_.size(); i++) {
+		t = points_[i].x;
 		double priorLogLikelihood = prior.eval(prior.domain().clip(t));
-		double finalLogLikelihood = delta2Sum - priorLogLikelihood;
+		double finalLogLikelihood = delta2Sums_[i] - priorLogLikelihood;
 		LOG(RPiAwb, Debug)
-			<< "t: " << t << " gain R " << gainR << " gain B "
-			<< gainB << " delta2_sum " << delta2Sum
+			<< "t: " << t << " gain R " << gains_[i].x << " gain B "
+			<< gains_[i].y << " delta2_sum " << delta2Sums_[i]
 			<< " prior " << priorLogLikelihood << " final "
 			<< finalLogLikelihood;
-		points_.push_back(Pwl::Point(t, finalLogLikelihood));
-		if (points_.back().y < points_[bestPoint].y)
-			bestPoint = points_.size() - 1;
-		if (t == mode_->ctHi)
-			break;
-		/* for even steps along the r/b curve scale them by the current t */
-		t = std::min(t + t / 10 * config_.coarseStep, mode_->ctHi);
+		points_[i].y = finalLogLikelihood;
+		if (points_[i].y < points_[bestPoint].y)
+			bestPoint = i;
 	}
 	t = points_[bestPoint].x;
 	LOG(RPiAwb, Debug) << "Coarse search found CT " << t;
@@ -562,14 +604,14 @@ double Awb::coarseSearch(Pwl const &prior)
 void Awb::fineSearch(double &t, double &r, double &b, Pwl const &prior)
 {
 	int spanR = -1, spanB = -1;
-	config_.ctR.eval(t, &spanR);
-	config_.ctB.eval(t, &spanB);
-	double step = t / 10 * config_.coarseStep * 0.1;
+	config_->ctR.eval(t, &spanR);
+	config_->ctB.eval(t, &spanB);
+	double step = t / 10 * config_->coarseStep * 0.1;
 	int nsteps = 5;
-	double rDiff = config_.ctR.eval(t + nsteps * step, &spanR) -
-		       config_.ctR.eval(t - nsteps * step, &spanR);
-	double bDiff = config_.ctB.eval(t + nsteps * step, &spanB) -
-		       config_.ctB.eval(t - nsteps * step, &spanB);
+	double rDiff = config_->ctR.eval(t + nsteps * step, &spanR) -
+		       config_->ctR.eval(t - nsteps * step, &spanR);
+	double bDiff = config_->ctB.eval(t + nsteps * step, &spanB) -
+		       config_->ctB.eval(t - nsteps * step, &spanB);
 	Pwl::Point transverse(bDiff, -rDiff);
 	if (transverse.len2() < 1e-6)
 		return;
@@ -579,7 +621,7 @@ void Awb::fineSearch(double &t, double &r, double &b, Pwl const &prior)
 	 */
 	transverse = transverse / transverse.len();
 	double bestLogLikelihood = 0, bestT = 0, bestR = 0, bestB = 0;
-	double transverseRange = config_.transverseNeg + config_.transversePos;
+	double transverseRange = config_->transverseNeg + config_->transversePos;
 	const int maxNumDeltas = 12;
 	/* a transverse step approximately every 0.01 r/b units */
 	int numDeltas = floor(transverseRange * 100 + 0.5) + 1;
@@ -589,28 +631,33 @@ void Awb::fineSearch(double &t, double &r, double &b, Pwl const &prior)
 	 * large.
 	 */
 	nsteps += numDeltas;
+	/* the best point off the curve found at each step, and its prior */
+	std::vector<Pwl::Point> bestRb;
+	std::vector<double> priors;
 	for (int i = -nsteps; i <= nsteps; i++) {
 		double tTest = t + i * step;
 		double priorLogLikelihood =
 			prior.eval(prior.domain().clip(tTest));
-		double rCurve = config_.ctR.eval(tTest, &spanR);
-		double bCurve = config_.ctB.eval(tTest, &spanB);
+		double rCurve = config_->ctR.eval(tTest, &spanR);
+		double bCurve = config_->ctB.eval(tTest, &spanB);
 		/* x will be distance off the curve, y the log likelihood there */
 		Pwl::Point points[maxNumDeltas];
 		int bestPoint = 0;
 		/* Take some measurements transversely *off* the CT curve. */
+		gains_.clear();
 		for (int j = 0; j < numDeltas; j++) {
-			points[j].x = -config_.transverseNeg +
+			points[j].x = -config_->transverseNeg +
 				      (transverseRange * j) / (numDeltas - 1);
 			Pwl::Point rbTest = Pwl::Point(rCurve, bCurve) +
 					    transverse * points[j].x;
-			double rTest = rbTest.x, bTest = rbTest.y;
-			double gainR = 1 / rTest, gainB = 1 / bTest;
-			double delta2Sum = computeDelta2Sum(gainR, gainB);
-			points[j].y = delta2Sum - priorLogLikelihood;
+			gains_.push_back(Pwl::Point(1 / rbTest.x, 1 / rbTest.y));
+		}
+		computeDelta2Sums(gains_, delta2Sums_);
+		for (int j = 0; j < numDeltas; j++) {
+			points[j].y = delta2Sums_[j] - priorLogLikelihood;
 			LOG(RPiAwb, Debug)
-				<< "At t " << tTest << " r " << rTest << " b "
-				<< bTest << ": " << points[j].y;
+				<< "At t " << tTest << " r " << 1 / gains_[j].x
+				<< " b " << 1 / gains_[j].y << ": " << points[j].y;
 			if (points[j].y < points[bestPoint].y)
 				bestPoint = j;
 		}
@@ -619,14 +666,22 @@ void Awb::fineSearch(double &t, double &r, double &b, Pwl const &prior)
 		 * now let's do a quadratic interpolation for the best result.
 		 */
 		bestPoint = std::max(1, std::min(bestPoint, numDeltas - 2));
-		Pwl::Point rbTest = Pwl::Point(rCurve, bCurve) +
-					transverse * interpolateQuadatric(points[bestPoint - 1],
-									points[bestPoint],
-									points[bestPoint + 1]);
-		double rTest = rbTest.x, bTest = rbTest.y;
-		double gainR = 1 / rTest, gainB = 1 / bTest;
-		double delta2Sum = computeDelta2Sum(gainR, gainB);
-		double finalLogLikelihood = delta2Sum - priorLogLikelihood;
+		bestRb.push_back(Pwl::Point(rCurve, bCurve) +
+				 transverse * interpolateQuadatric(points[bestPoint - 1],
+								   points[bestPoint],
+								   points[bestPoint + 1]));
+		priors.push_back(priorLogLikelihood);
+	}
+	/* Evaluate the best point from each step together, and pick the best. */
+	gains_.clear();
+	for (const Pwl::Point &rb : bestRb)
+		gains_.push_back(Pwl::Point(1 / rb.x, 1 / rb.y));
+	computeDelta2Sums(gains_, delta2Sums_);
+	for (int i = -nsteps; i <= nsteps; i++) {
+		unsigned int idx = i + nsteps;
+		double tTest = t + i * step;
+		double rTest = bestRb[idx].x, bTest = bestRb[idx].y;
+		double finalLogLikelihood = delta2Sums_[idx] - priors[idx];
 		LOG(RPiAwb, Debug)
 			<< "Finally "
 			<< tTest << " r " << rTest << " b " << bTest << ": "
@@ -644,11 +699,16 @@ void Awb::fineSearch(double &t, double &r, double &b, Pwl const &prior)
 void Awb::awbBayes()
 {
 	/*
-	 * May as well divide out G to save computeDelta2Sum from doing it over
+	 * May as well divide out G to save computeDelta2Sums from doing it over
 	 * and over.
 	 */
-	for (auto &z : zones_)
+	zoneR_.clear();
+	zoneB_.clear();
+	for (auto &z : zones_) {
 		z.R = z.R / (z.G + 1), z.B = z.B / (z.G + 1);
+		zoneR_.push_back(z.R);
+		zoneB_.push_back(z.B);
+	}
 	/*
 	 * Get the current prior, and scale according to how many zones are
 	 * valid... not entirely sure about this.
@@ -659,8 +719,8 @@ void Awb::awbBayes()
 		LOG(RPiAwb, Debug) << "(" << x << "," << y << ")";
 	});
 	double t = coarseSearch(prior);
-	double r = config_.ctR.eval(t);
-	double b = config_.ctB.eval(t);
+	double r = config_->ctR.eval(t);
+	double b = config_->ctB.eval(t);
 	LOG(RPiAwb, Debug)
 		<< "After coarse search: r " << r << " b " << b << " (gains r "
 		<< 1 / r << " b " << 1 / b << ")";
@@ -682,9 +742,9 @@ void Awb::awbBayes()
 	 * the ones needed by *this* sensor.
 	 */
 	asyncResults_.temperatureK = t;
-	asyncResults_.gainR = 1.0 / r * config_.sensitivityR;
+	asyncResults_.gainR = 1.0 / r * config_->sensitivityR;
 	asyncResults_.gainG = 1.0;
-	asyncResults_.gainB = 1.0 / b * config_.sensitivityB;
+	asyncResults_.gainB = 1.0 / b * config_->sensitivityB;
 }
 
 void Awb::awbGrey()
@@ -725,8 +785,8 @@ void Awb::doAwb()
 {
 	prepareStats();
 	LOG(RPiAwb, Debug) << "Valid zones: " << zones_.size();
-	if (zones_.size() > config_.minRegions) {
-		if (config_.bayes)
+	if (zones_.size() > config_->minRegions) {
+		if (config_->bayes)
 			awbBayes();
 		else
 			awbGrey();
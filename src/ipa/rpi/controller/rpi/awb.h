@@ -6,9 +6,9 @@
  */
 #pragma once
 
-#include <mutex>
-#include <condition_variable>
-#include <thread>
+#include <future>
+#include <list>
+#include <memory>
 
 #include "../awb_algorithm.h"
 #include "../pwl.h"
@@ -38,6 +38,8 @@ struct AwbConfig {
 	uint16_t framePeriod;
 	/* number of initial frames for which speed taken as 1.0 (maximum) */
 	uint16_t startupFrames;
+	/* process() only every "this many" frames once converged and stable */
+	unsigned int stableInterval;
 	unsigned int convergenceFrames; /* approx number of frames to converge */
 	double speed; /* IIR filter speed applied to algorithm results */
 	bool fast; /* "fast" mode uses a 16x16 rather than 32x32 grid */
@@ -103,6 +105,7 @@ public:
 	void switchMode(CameraMode const &cameraMode, Metadata *metadata) override;
 	void prepare(Metadata *imageMetadata) override;
 	void process(StatisticsPtr &stats, Metadata *imageMetadata) override;
+	unsigned int processInterval() const override;
 	struct RGB {
 		RGB(double r = 0, double g = 0, double b = 0)
 			: R(r), G(g), B(b)
@@ -119,26 +122,12 @@ public:
 private:
 	bool isAutoEnabled() const;
 	/* configuration is read-only, and available to both threads */
-	AwbConfig config_;
-	std::thread asyncThread_;
-	void asyncFunc(); /* asynchronous thread function */
-	std::mutex mutex_;
-	/* condvar for async thread to wait on */
-	std::condition_variable asyncSignal_;
-	/* condvar for synchronous thread to wait on */
-	std::condition_variable syncSignal_;
-	/* for sync thread to check  if async thread finished (requires mutex) */
-	bool asyncFinished_;
-	/* for async thread to check if it's been told to run (requires mutex) */
-	bool asyncStart_;
-	/* for async thread to check if it's been told to quit (requires mutex) */
-	bool asyncAbort_;
-
+	std::shared_ptr<const AwbConfig> config_;
 	/*
 	 * The following are only for the synchronous thread to use:
-	 * for sync thread to note its has asked async thread to run
+	 * completion of the asynchronous calculation, valid while one is running
 	 */
-	bool asyncStarted_;
+	std::future<void> asyncResult_;
 	/* counts up to framePeriod before restarting the async thread */
 	int framePhase_;
 	int frameCount_; /* counts up to startup_frames */
@@ -153,19 +142,28 @@ private:
 	/* copy out the results from the async thread so that it can be restarted */
 	void fetchAsyncResults();
 	StatisticsPtr statistics_;
-	AwbMode *mode_;
+	const AwbMode *mode_;
 	double lux_;
 	AwbStatus asyncResults_;
 	void doAwb();
 	void awbBayes();
 	void awbGrey();
 	void prepareStats();
-	double computeDelta2Sum(double gainR, double gainB);
-	Pwl interpolatePrior();
+	void computeDelta2Sums(std::vector<Pwl::Point> const &gains,
+			       std::vector<double> &delta2Sums);
+	const Pwl &interpolatePrior();
+	/* interpolated priors by quantised lux, most recently used first */
+	std::list<std::pair<int, Pwl>> priorCache_;
 	double coarseSearch(Pwl const &prior);
 	void fineSearch(double &t, double &r, double &b, Pwl const &prior);
 	std::vector<RGB> zones_;
+	/* zone R/G and B/G ratios as separate arrays, for the Bayesian search */
+	std::vector<float> zoneR_;
+	std::vector<float> zoneB_;
 	std::vector<Pwl::Point> points_;
+	/* candidate gains, and their colour errors, for the Bayesian search */
+	std::vector<Pwl::Point> gains_;
+	std::vector<double> delta2Sums_;
 	/* manual r setting */
 	double manualR_;
 	/* manual b setting */
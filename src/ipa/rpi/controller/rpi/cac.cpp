@@ -96,7 +96,12 @@ int Cac::read(const libcamera::YamlObject &params)
 void Cac::prepare(Metadata *imageMetadata)
 {
 	if (config_.enabled)
-		imageMetadata->set("cac.status", cacStatus_);
+		imageMetadata->set(CacStatusTag, cacStatus_);
+}
+
+std::optional<Algorithm::MetadataAccess> Cac::prepareAccess() const
+{
+	return MetadataAccess{ {}, { "cac.status" } };
 }
 
 // Register algorithm with the system.
@@ -114,9 +114,9 @@ void Ccm::initialise()
 }
 
 template<typename T>
-static bool getLocked(Metadata *metadata, std::string const &tag, T &value)
+static bool getLocked(Metadata *metadata, MetadataTag<T> const &tag, T &value)
 {
-	T *ptr = metadata->getLocked<T>(tag);
+	T *ptr = metadata->getLocked(tag);
 	if (ptr == nullptr)
 		return false;
 	value = *ptr;
@@ -159,8 +159,8 @@ void Ccm::prepare(Metadata *imageMetadata)
 	{
 		/* grab mutex just once to get everything */
 		std::lock_guard<Metadata> lock(*imageMetadata);
-		awbOk = getLocked(imageMetadata, "awb.status", awb);
-		luxOk = getLocked(imageMetadata, "lux.status", lux);
+		awbOk = getLocked(imageMetadata, AwbStatusTag, awb);
+		luxOk = getLocked(imageMetadata, LuxStatusTag, lux);
 	}
 	if (!awbOk)
 		LOG(RPiCcm, Warning) << "no colour temperature found";
@@ -187,7 +187,7 @@ void Ccm::prepare(Metadata *imageMetadata)
 		<< " " << ccmStatus.matrix[5] << "     "
 		<< ccmStatus.matrix[6] << " " << ccmStatus.matrix[7]
 		<< " " << ccmStatus.matrix[8];
-	imageMetadata->set("ccm.status", ccmStatus);
+	imageMetadata->set(CcmStatusTag, ccmStatus);
 }
 
 /* Register algorithm with the system. */
@@ -29,7 +29,8 @@ LOG_DEFINE_CATEGORY(RPiContrast)
 #define NAME "rpi.contrast"
 
 Contrast::Contrast(Controller *controller)
-	: ContrastAlgorithm(controller), brightness_(0.0), contrast_(1.0)
+	: ContrastAlgorithm(controller), brightness_(0.0), contrast_(1.0),
+	  ceApplied_(-1.0)
 {
 }
 
@@ -38,22 +39,35 @@ char const *Contrast::name() const
 	return NAME;
 }
 
-int Contrast::read(const libcamera::YamlObject &params)
+int ContrastConfig::read(const libcamera::YamlObject &params)
 {
 	// enable adaptive enhancement by default
-	config_.ceEnable = params["ce_enable"].get<int>(1);
-	ceEnable_ = config_.ceEnable;
+	ceEnable = params["ce_enable"].get<int>(1);
 	// the point near the bottom of the histogram to move
-	config_.loHistogram = params["lo_histogram"].get<double>(0.01);
+	loHistogram = params["lo_histogram"].get<double>(0.01);
 	// where in the range to try and move it to
-	config_.loLevel = params["lo_level"].get<double>(0.015);
+	loLevel = params["lo_level"].get<double>(0.015);
 	// but don't move by more than this
-	config_.loMax = params["lo_max"].get<double>(500);
+	loMax = params["lo_max"].get<double>(500);
 	// equivalent values for the top of the histogram...
-	config_.hiHistogram = params["hi_histogram"].get<double>(0.95);
-	config_.hiLevel = params["hi_level"].get<double>(0.95);
-	config_.hiMax = params["hi_max"].get<double>(2000);
-	return config_.gammaCurve.read(params["gamma_curve"]);
+	hiHistogram = params["hi_histogram"].get<double>(0.95);
+	hiLevel = params["hi_level"].get<double>(0.95);
+	hiMax = params["hi_max"].get<double>(2000);
+	// only recompute every few frames when the scene is stable
+	stableInterval = params["stable_interval"].get<unsigned int>(4);
+	return gammaCurve.read(params["gamma_curve"]);
+}
+
+int Contrast::read(const libcamera::YamlObject &params)
+{
+	int ret = readConfig(config_, [&](ContrastConfig &config) {
+		return config.read(params);
+	});
+	if (ret)
+		return ret;
+
+	ceEnable_ = config_->ceEnable;
+	return 0;
 }
 
 void Contrast::setBrightness(double brightness)
@@ -73,7 +87,7 @@ void Contrast::enableCe(bool enable)
 
 void Contrast::restoreCe()
 {
-	ceEnable_ = config_.ceEnable;
+	ceEnable_ = config_->ceEnable;
 }
 
 void Contrast::initialise()
@@ -84,12 +98,27 @@ void Contrast::initialise()
 	 */
 	status_.brightness = brightness_;
 	status_.contrast = contrast_;
-	status_.gammaCurve = config_.gammaCurve;
+	status_.gammaCurve = config_->gammaCurve;
 }
 
 void Contrast::prepare(Metadata *imageMetadata)
 {
-	imageMetadata->set("contrast.status", status_);
+	imageMetadata->set(ContrastStatusTag, status_);
+}
+
+std::optional<Algorithm::MetadataAccess> Contrast::prepareAccess() const
+{
+	return MetadataAccess{ {}, { "contrast.status" } };
+}
+
+unsigned int Contrast::processInterval() const
+{
+	/* Apply manual changes without delay. */
+	if (brightness_ != status_.brightness || contrast_ != status_.contrast ||
+	    ceEnable_ != ceApplied_)
+		return 1;
+
+	return config_->stableInterval;
 }
 
 Pwl computeStretchCurve(Histogram const &histogram,
@@ -160,10 +189,10 @@ void Contrast::process(StatisticsPtr &stats,
 	 * ways: 1. Adjust the gamma curve so as to pull the start of the
 	 * histogram down, and possibly push the end up.
 	 */
-	Pwl gammaCurve = config_.gammaCurve;
+	Pwl gammaCurve = config_->gammaCurve;
 	if (ceEnable_) {
-		if (config_.loMax != 0 || config_.hiMax != 0)
-			gammaCurve = computeStretchCurve(histogram, config_).compose(gammaCurve);
+		if (config_->loMax != 0 || config_->hiMax != 0)
+			gammaCurve = computeStretchCurve(histogram, *config_).compose(gammaCurve);
 		/*
 		 * We could apply other adjustments (e.g. partial equalisation)
 		 * based on the histogram...?
@@ -182,6 +211,7 @@ void Contrast::process(StatisticsPtr &stats,
 	status_.brightness = brightness_;
 	status_.contrast = contrast_;
 	status_.gammaCurve = std::move(gammaCurve);
+	ceApplied_ = ceEnable_;
 }
 
 /* Register algorithm with the system. */
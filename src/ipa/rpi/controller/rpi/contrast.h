@@ -6,6 +6,7 @@
  */
 #pragma once
 
+#include <memory>
 #include <mutex>
 
 #include "../contrast_algorithm.h"
@@ -19,6 +20,8 @@ namespace RPiController {
  */
 
 struct ContrastConfig {
+	int read(const libcamera::YamlObject &params);
+
 	bool ceEnable;
 	double loHistogram;
 	double loLevel;
@@ -26,6 +29,7 @@ struct ContrastConfig {
 	double hiHistogram;
 	double hiLevel;
 	double hiMax;
+	unsigned int stableInterval;
 	Pwl gammaCurve;
 };
 
@@ -41,14 +45,17 @@ public:
 	void restoreCe() override;
 	void initialise() override;
 	void prepare(Metadata *imageMetadata) override;
+	std::optional<MetadataAccess> prepareAccess() const override;
 	void process(StatisticsPtr &stats, Metadata *imageMetadata) override;
+	unsigned int processInterval() const override;
 
 private:
-	ContrastConfig config_;
+	std::shared_ptr<const ContrastConfig> config_;
 	double brightness_;
 	double contrast_;
 	ContrastStatus status_;
 	double ceEnable_;
+	double ceApplied_;
 };
 
 } /* namespace RPiController */
@@ -113,7 +113,7 @@ void Denoise::prepare(Metadata *imageMetadata)
 {
 	struct NoiseStatus noiseStatus = {};
 	noiseStatus.noiseSlope = 3.0; // in case no metadata
-	if (imageMetadata->get("noise.status", noiseStatus) != 0)
+	if (imageMetadata->get(NoiseStatusTag, noiseStatus) != 0)
 		LOG(RPiDenoise, Warning) << "no noise profile found";
 
 	LOG(RPiDenoise, Debug)
@@ -130,7 +130,7 @@ void Denoise::prepare(Metadata *imageMetadata)
 		sdn.noiseConstant2 = noiseStatus.noiseConstant * currentConfig_->sdnDeviation2;
 		sdn.noiseSlope2 = noiseStatus.noiseSlope * currentSdnDeviation2_;
 		sdn.strength = currentSdnStrength_;
-		imageMetadata->set("sdn.status", sdn);
+		imageMetadata->set(SdnStatusTag, sdn);
 		LOG(RPiDenoise, Debug)
 			<< "const " << sdn.noiseConstant
 			<< " slope " << sdn.noiseSlope
@@ -150,7 +150,7 @@ void Denoise::prepare(Metadata *imageMetadata)
 		tdn.noiseConstant = noiseStatus.noiseConstant * currentConfig_->tdnDeviation;
 		tdn.noiseSlope = noiseStatus.noiseSlope * currentConfig_->tdnDeviation;
 		tdn.threshold = currentConfig_->tdnThreshold;
-		imageMetadata->set("tdn.status", tdn);
+		imageMetadata->set(TdnStatusTag, tdn);
 		LOG(RPiDenoise, Debug)
 			<< "programmed tdn threshold " << tdn.threshold
 			<< " constant " << tdn.noiseConstant
@@ -161,13 +161,18 @@ void Denoise::prepare(Metadata *imageMetadata)
 		struct CdnStatus cdn;
 		cdn.threshold = currentConfig_->cdnDeviation * noiseStatus.noiseSlope + noiseStatus.noiseConstant;
 		cdn.strength = currentConfig_->cdnStrength;
-		imageMetadata->set("cdn.status", cdn);
+		imageMetadata->set(CdnStatusTag, cdn);
 		LOG(RPiDenoise, Debug)
 			<< "programmed cdn threshold " << cdn.threshold
 			<< " strength " << cdn.strength;
 	}
 }
 
+std::optional<Algorithm::MetadataAccess> Denoise::prepareAccess() const
+{
+	return MetadataAccess{ { "noise.status" }, { "sdn.status", "tdn.status", "cdn.status" } };
+}
+
 void Denoise::setMode(DenoiseMode mode)
 {
 	// We only distinguish between off and all other modes.
@@ -48,7 +48,12 @@ void Dpc::prepare(Metadata *imageMetadata)
 	/* Should we vary this with lux level or analogue gain? TBD. */
 	dpcStatus.strength = config_.strength;
 	LOG(RPiDpc, Debug) << "strength " << dpcStatus.strength;
-	imageMetadata->set("dpc.status", dpcStatus);
+	imageMetadata->set(DpcStatusTag, dpcStatus);
+}
+
+std::optional<Algorithm::MetadataAccess> Dpc::prepareAccess() const
+{
+	return MetadataAccess{ {}, { "dpc.status" } };
 }
 
 /* Register algorithm with the system. */
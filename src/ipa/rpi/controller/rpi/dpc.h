@@ -24,6 +24,7 @@ public:
 	char const *name() const override;
 	int read(const libcamera::YamlObject &params) override;
 	void prepare(Metadata *imageMetadata) override;
+	std::optional<MetadataAccess> prepareAccess() const override;
 
 private:
 	DpcConfig config_;
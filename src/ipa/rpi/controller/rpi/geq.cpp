@@ -57,11 +57,11 @@ void Geq::prepare(Metadata *imageMetadata)
 {
 	LuxStatus luxStatus = {};
 	luxStatus.lux = 400;
-	if (imageMetadata->get("lux.status", luxStatus))
+	if (imageMetadata->get(LuxStatusTag, luxStatus))
 		LOG(RPiGeq, Warning) << "no lux data found";
 	DeviceStatus deviceStatus;
 	deviceStatus.analogueGain = 1.0; /* in case not found */
-	if (imageMetadata->get("device.status", deviceStatus))
+	if (imageMetadata->get(DeviceStatusTag, deviceStatus))
 		LOG(RPiGeq, Warning)
 			<< "no device metadata - use analogue gain of 1x";
 	GeqStatus geqStatus = {};
@@ -78,7 +78,12 @@ void Geq::prepare(Metadata *imageMetadata)
 		<< geqStatus.slope << " (analogue gain "
 		<< deviceStatus.analogueGain << " lux "
 		<< luxStatus.lux << ")";
-	imageMetadata->set("geq.status", geqStatus);
+	imageMetadata->set(GeqStatusTag, geqStatus);
+}
+
+std::optional<Algorithm::MetadataAccess> Geq::prepareAccess() const
+{
+	return MetadataAccess{ { "lux.status", "device.status" }, { "geq.status" } };
 }
 
 /* Register algorithm with the system. */
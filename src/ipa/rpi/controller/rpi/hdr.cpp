@@ -50,6 +50,9 @@ void HdrConfig::read(const libcamera::YamlObject &params, const std::string &mod
 		spatialGainCurve.append(0.06, 1.0); /* maybe make this programmable? */
 		spatialGainCurve.append(1.0, 1.0);
 	}
+	/* Steps of 0.001 over the usual domain of [0, 1]. */
+	if (!spatialGainCurve.empty())
+		spatialGainLut = PwlLut(spatialGainCurve, 1001);
 
 	diffusion = params["diffusion"].get<unsigned int>(3);
 	/* Clip to an arbitrary limit just to stop typos from killing the system! */
@@ -154,7 +157,7 @@ std::vector<unsigned int> Hdr::getChannels() const
 void Hdr::updateAgcStatus(Metadata *metadata)
 {
 	std::scoped_lock lock(*metadata);
-	AgcStatus *agcStatus = metadata->getLocked<AgcStatus>("agc.status");
+	AgcStatus *agcStatus = metadata->getLocked<AgcStatus>(AgcStatusTag);
 	if (agcStatus) {
 		HdrConfig &hdrConfig = config_[status_.mode];
 		auto it = hdrConfig.channelMap.find(agcStatus->channel);
@@ -177,7 +180,7 @@ void Hdr::switchMode([[maybe_unused]] CameraMode const &cameraMode, Metadata *me
 void Hdr::prepare(Metadata *imageMetadata)
 {
 	AgcStatus agcStatus;
-	if (!imageMetadata->get<AgcStatus>("agc.delayed_status", agcStatus))
+	if (!imageMetadata->get<AgcStatus>(AgcDelayedStatusTag, agcStatus))
 		delayedStatus_ = agcStatus.hdr;
 
 	auto it = config_.find(delayedStatus_.mode);
@@ -192,7 +195,7 @@ void Hdr::prepare(Metadata *imageMetadata)
 		return;
 
 	AlscStatus alscStatus{}; /* some compilers seem to require the braces */
-	if (imageMetadata->get<AlscStatus>("alsc.status", alscStatus)) {
+	if (imageMetadata->get<AlscStatus>(AlscStatusTag, alscStatus)) {
 		LOG(RPiHdr, Warning) << "No ALSC status";
 		return;
 	}
@@ -204,7 +207,7 @@ void Hdr::prepare(Metadata *imageMetadata)
 		alscStatus.g[i] *= gains[i];
 		alscStatus.b[i] *= gains[i];
 	}
-	imageMetadata->set("alsc.status", alscStatus);
+	imageMetadata->set(AlscStatusTag, alscStatus);
 }
 
 bool Hdr::updateTonemap([[maybe_unused]] StatisticsPtr &stats, HdrConfig &config)
@@ -343,14 +346,14 @@ void Hdr::updateGains(StatisticsPtr &stats, HdrConfig &config)
 		return;
 
 	for (unsigned int i = 0; i < numRegions_; i++) {
-		auto &region = stats->awbRegions.get(i);
+		const auto &region = stats->awbRegions.get(i);
 		unsigned int counted = region.counted;
 		counted += (counted == 0); /* avoid div by zero */
 		double r = region.val.rSum / counted;
 		double g = region.val.gSum / counted;
 		double b = region.val.bSum / counted;
 		double brightness = std::max({ r, g, b }) / 65535;
-		gains_[0][i] = config.spatialGainCurve.eval(brightness);
+		gains_[0][i] = config.spatialGainLut.eval(brightness);
 	}
 
 	/* Ping-pong between the two gains_ buffers. */
@@ -369,7 +372,7 @@ void Hdr::process(StatisticsPtr &stats, Metadata *imageMetadata)
 	 * case delayedStatus_ should be right.
 	 */
 	AgcStatus agcStatus;
-	if (!imageMetadata->get<AgcStatus>("agc.delayed_status", agcStatus))
+	if (!imageMetadata->get<AgcStatus>(AgcDelayedStatusTag, agcStatus))
 		delayedStatus_ = agcStatus.hdr;
 
 	auto it = config_.find(delayedStatus_.mode);
@@ -394,7 +397,7 @@ void Hdr::process(StatisticsPtr &stats, Metadata *imageMetadata)
 		tonemapStatus.strength = config.strength;
 		tonemapStatus.tonemap = tonemap_;
 
-		imageMetadata->set("tonemap.status", tonemapStatus);
+		imageMetadata->set(TonemapStatusTag, tonemapStatus);
 	}
 
 	if (config.stitchEnable) {
@@ -405,7 +408,7 @@ void Hdr::process(StatisticsPtr &stats, Metadata *imageMetadata)
 		stitchStatus.motionThreshold = config.motionThreshold;
 		stitchStatus.thresholdLo = config.thresholdLo;
 
-		imageMetadata->set("stitch.status", stitchStatus);
+		imageMetadata->set(StitchStatusTag, stitchStatus);
 	}
 }
 
@@ -27,6 +27,7 @@ struct HdrConfig {
 
 	/* Lens shading related parameters. */
 	Pwl spatialGainCurve; /* Brightness to gain curve for different image regions. */
+	PwlLut spatialGainLut; /* The same curve, for evaluating on every region. */
 	unsigned int diffusion; /* How much to diffuse the gain spatially. */
 
 	/* Tonemap related parameters. */
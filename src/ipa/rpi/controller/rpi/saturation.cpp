@@ -46,7 +46,7 @@ void Saturation::prepare(Metadata *imageMetadata)
 	saturation.shiftR = config_.shiftR;
 	saturation.shiftG = config_.shiftG;
 	saturation.shiftB = config_.shiftB;
-	imageMetadata->set("saturation.status", saturation);
+	imageMetadata->set(SaturationStatusTag, saturation);
 }
 
 // Register algorithm with the system.
@@ -81,7 +81,12 @@ void Sharpen::prepare(Metadata *imageMetadata)
 	status.limit = limit_ / modeFactor_ * userStrengthSqrt;
 	/* Finally, report any application-supplied parameters that were used. */
 	status.userStrength = userStrength_;
-	imageMetadata->set("sharpen.status", status);
+	imageMetadata->set(SharpenStatusTag, status);
+}
+
+std::optional<Algorithm::MetadataAccess> Sharpen::prepareAccess() const
+{
+	return MetadataAccess{ {}, { "sharpen.status" } };
 }
 
 /* Register algorithm with the system. */
@@ -0,0 +1,129 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Copyright (C) 2026, Raspberry Pi Ltd
+ *
+ * scene_stability.cpp - detect when the scene stops changing
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <errno.h>
+
+#include <libcamera/base/log.h>
+
+#include "scene_stability.h"
+
+using namespace RPiController;
+using namespace libcamera;
+
+LOG_DECLARE_CATEGORY(RPiController)
+
+SceneStability::SceneStability()
+	: luminanceThreshold_(0.04), colourThreshold_(0.02), stableFrames_(8),
+	  enabled_(true), valid_(false), unchangedCount_(0), stable_(false)
+{
+}
+
+int SceneStability::read(const libcamera::YamlObject &params)
+{
+	enabled_ = params["enable"].get<bool>(true);
+	luminanceThreshold_ = params["luminance_threshold"].get<double>(0.04);
+	colourThreshold_ = params["colour_threshold"].get<double>(0.02);
+	stableFrames_ = params["stable_frames"].get<unsigned int>(8);
+	if (luminanceThreshold_ <= 0 || colourThreshold_ <= 0) {
+		LOG(RPiController, Error)
+			<< "SceneStability: thresholds must be > 0";
+		return -EINVAL;
+	}
+	return 0;
+}
+
+void SceneStability::reset()
+{
+	valid_ = false;
+	unchangedCount_ = 0;
+	stable_ = false;
+}
+
+bool SceneStability::update(const Statistics &stats)
+{
+	if (!enabled_)
+		return false;
+
+	computeSignature(stats, current_);
+	if (!valid_ || changed(reference_, current_)) {
+		std::swap(reference_, current_);
+		valid_ = true;
+		unchangedCount_ = 0;
+	} else if (unchangedCount_ < stableFrames_)
+		unchangedCount_++;
+
+	bool stable = unchangedCount_ >= stableFrames_;
+	if (stable != stable_)
+		LOG(RPiController, Debug)
+			<< "Scene " << (stable ? "stable" : "changed");
+	stable_ = stable;
+	return stable_;
+}
+
+void SceneStability::computeSignature(const Statistics &stats,
+				      Signature &signature) const
+{
+	const RgbyRegions &regions = stats.awbRegions;
+	double gSum = 0, count = 0;
+
+	signature.chroma.resize(regions.numRegions() * 2);
+	for (unsigned int i = 0; i < regions.numRegions(); i++) {
+		/* Read regions one by one so as not to copy statistics views. */
+		auto region = regions.get(i);
+		if (!region.counted || !region.val.gSum) {
+			signature.chroma[i * 2] = -1.0;
+			signature.chroma[i * 2 + 1] = -1.0;
+			continue;
+		}
+		signature.chroma[i * 2] =
+			static_cast<double>(region.val.rSum) / region.val.gSum;
+		signature.chroma[i * 2 + 1] =
+			static_cast<double>(region.val.bSum) / region.val.gSum;
+		gSum += region.val.gSum;
+		count += region.counted;
+	}
+
+	/* Not all platforms fill in the luminance histogram. */
+	const Histogram &histogram = stats.yHist;
+	if (histogram.bins() && histogram.total())
+		signature.luminance = histogram.interBinMean(0, histogram.bins()) /
+				      histogram.bins();
+	else
+		signature.luminance = count ? gSum / count / (1 << Statistics::NormalisationFactorPow2)
+					    : 0.0;
+}
+
+bool SceneStability::changed(const Signature &a, const Signature &b) const
+{
+	/* A dark scene is compared in absolute terms, to ignore noise. */
+	double luminance = std::max(a.luminance, 0.05);
+	if (std::abs(a.luminance - b.luminance) > luminanceThreshold_ * luminance)
+		return true;
+
+	/* A change of region layout (e.g. mode switch) is always a change. */
+	if (a.chroma.size() != b.chroma.size())
+		return true;
+
+	double diff = 0;
+	unsigned int num = 0;
+	for (unsigned int i = 0; i < a.chroma.size(); i++) {
+		if (a.chroma[i] < 0 || b.chroma[i] < 0) {
+			/* A region becoming (in)valid is a change of its own. */
+			if ((a.chroma[i] < 0) != (b.chroma[i] < 0)) {
+				diff += 1.0;
+				num++;
+			}
+			continue;
+		}
+		diff += std::abs(a.chroma[i] - b.chroma[i]);
+		num++;
+	}
+
+	return num && diff / num > colourThreshold_;
+}
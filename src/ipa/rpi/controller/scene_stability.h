@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Copyright (C) 2026, Raspberry Pi Ltd
+ *
+ * scene_stability.h - detect when the scene stops changing
+ */
+#pragma once
+
+#include <vector>
+
+#include "libcamera/internal/yaml_parser.h"
+
+#include "statistics.h"
+
+namespace RPiController {
+
+/*
+ * Compare the statistics of each frame with those of the frame where the scene
+ * last changed, using the mean luminance and the colour ratios of the AWB
+ * regions. The scene is reported as stable once it hasn't changed for a number
+ * of frames, and as unstable again as soon as a change is detected. Comparing
+ * against a reference rather than the previous frame catches slow drifts too.
+ */
+class SceneStability
+{
+public:
+	SceneStability();
+	int read(const libcamera::YamlObject &params);
+	void reset();
+	bool update(const Statistics &stats);
+	bool stable() const { return stable_; }
+
+private:
+	struct Signature {
+		double luminance;
+		/* R/G and B/G of each AWB region, negative when invalid */
+		std::vector<double> chroma;
+	};
+
+	void computeSignature(const Statistics &stats, Signature &signature) const;
+	bool changed(const Signature &a, const Signature &b) const;
+
+	/* relative change of the mean luminance that counts as a change */
+	double luminanceThreshold_;
+	/* mean absolute change of the region colour ratios that does too */
+	double colourThreshold_;
+	/* frames without change before the scene is deemed stable */
+	unsigned int stableFrames_;
+	bool enabled_;
+
+	Signature reference_;
+	Signature current_;
+	bool valid_;
+	unsigned int unchangedCount_;
+	bool stable_;
+};
+
+} /* namespace RPiController */
@@ -71,8 +71,31 @@ struct Statistics {
 
 	/* Region based focus FoM. */
 	FocusRegions focusRegions;
+
+	/*
+	 * Region statistics may be views over the hardware statistics buffer,
+	 * which are only valid until the buffer is returned to the pipeline
+	 * handler at the end of the frame.
+	 */
+	bool isView() const
+	{
+		return agcRegions.isView() || awbRegions.isView() ||
+		       focusRegions.isView();
+	}
 };
 
 using StatisticsPtr = std::shared_ptr<Statistics>;
 
+/*
+ * Return statistics that can be kept beyond the current frame, copying them
+ * if they refer to the hardware statistics buffer.
+ */
+inline StatisticsPtr retainStatistics(const StatisticsPtr &stats)
+{
+	if (!stats || !stats->isView())
+		return stats;
+
+	return std::make_shared<Statistics>(*stats);
+}
+
 } /* namespace RPiController */
@@ -80,17 +80,20 @@ int generateLut(const RPiController::Pwl &pwl, uint32_t *lut, std::size_t lutSiz
 	if (pwl.empty())
 		return -EINVAL;
 
-	int lastY = 0;
+	std::vector<double> xs(lutSize), ys(lutSize);
 	for (unsigned int i = 0; i < lutSize; i++) {
-		int x, y;
 		if (i < 32)
-			x = i * 512;
+			xs[i] = i * 512;
 		else if (i < 48)
-			x = (i - 32) * 1024 + 16384;
+			xs[i] = (i - 32) * 1024 + 16384;
 		else
-			x = std::min(65535u, (i - 48) * 2048 + 32768);
+			xs[i] = std::min(65535u, (i - 48) * 2048 + 32768);
+	}
+	pwl.eval(xs, ys);
 
-		y = pwl.eval(x);
+	int lastY = 0;
+	for (unsigned int i = 0; i < lutSize; i++) {
+		int y = ys[i];
 		if (y < 0 || (i && y < lastY)) {
 			LOG(IPARPI, Error)
 				<< "Malformed PWL for Gamma, disabling!";
@@ -191,6 +194,33 @@ void resampleTable(double *dest, int destW, int destH, double const *src,
 	}
 }
 
+/*
+ * Readers for the region statistics views over the hardware statistics
+ * buffer, see platformProcessStats().
+ */
+RPiController::RgbyRegions::Region readAwbRegion(const void *data, unsigned int index)
+{
+	const pisp_awb_statistics_zone &zone =
+		static_cast<const pisp_statistics *>(data)->awb.zones[index];
+
+	return { { zone.R_sum, zone.G_sum, zone.B_sum }, zone.counted, 0 };
+}
+
+RPiController::RgbyRegions::Region readAgcRegion(const void *data, unsigned int index)
+{
+	const pisp_agc_statistics_zone &zone =
+		static_cast<const pisp_statistics *>(data)->agc.floating[index];
+
+	return { { 0, 0, 0, zone.Y_sum }, zone.counted, 0 };
+}
+
+RPiController::FocusRegions::Region readFocusRegion(const void *data, unsigned int index)
+{
+	const pisp_statistics *stats = static_cast<const pisp_statistics *>(data);
+
+	return { stats->cdaf.foms[index] >> 20, 0, 0 };
+}
+
 } /* namespace */
 
 using ::libpisp::BackEnd;
@@ -343,8 +373,8 @@ void IpaPiSP::platformPrepareIsp([[maybe_unused]] const PrepareParams &params,
 	global.rgb_enables &= ~(PISP_BE_RGB_ENABLE_GAMMA + PISP_BE_RGB_ENABLE_CCM +
 				PISP_BE_RGB_ENABLE_SHARPEN + PISP_BE_RGB_ENABLE_SAT_CONTROL);
 
-	NoiseStatus *noiseStatus = rpiMetadata.getLocked<NoiseStatus>("noise.status");
-	AgcPrepareStatus *agcPrepareStatus = rpiMetadata.getLocked<AgcPrepareStatus>("agc.prepare_status");
+	NoiseStatus *noiseStatus = rpiMetadata.getLocked<NoiseStatus>(RPiController::NoiseStatusTag);
+	AgcPrepareStatus *agcPrepareStatus = rpiMetadata.getLocked<AgcPrepareStatus>(RPiController::AgcPrepareStatusTag);
 
 	{
 		/* All Frontend config goes first, we do not want to hold the FE lock for long! */
@@ -354,11 +384,11 @@ void IpaPiSP::platformPrepareIsp([[maybe_unused]] const PrepareParams &params,
 			applyFocusStats(noiseStatus);
 
 		BlackLevelStatus *blackLevelStatus =
-			rpiMetadata.getLocked<BlackLevelStatus>("black_level.status");
+			rpiMetadata.getLocked<BlackLevelStatus>(RPiController::BlackLevelStatusTag);
 		if (blackLevelStatus)
 			applyBlackLevel(blackLevelStatus, global);
 
-		AwbStatus *awbStatus = rpiMetadata.getLocked<AwbStatus>("awb.status");
+		AwbStatus *awbStatus = rpiMetadata.getLocked<AwbStatus>(RPiController::AwbStatusTag);
 		if (awbStatus && agcPrepareStatus) {
 			/* Applies digital gain as well. */
 			applyWBG(awbStatus, agcPrepareStatus, global);
@@ -368,66 +398,66 @@ void IpaPiSP::platformPrepareIsp([[maybe_unused]] const PrepareParams &params,
 		}
 	}
 
-	CacStatus *cacStatus = rpiMetadata.getLocked<CacStatus>("cac.status");
+	CacStatus *cacStatus = rpiMetadata.getLocked<CacStatus>(RPiController::CacStatusTag);
 	if (cacStatus)
 		applyCAC(cacStatus, global);
 
 	ContrastStatus *contrastStatus =
-		rpiMetadata.getLocked<ContrastStatus>("contrast.status");
+		rpiMetadata.getLocked<ContrastStatus>(RPiController::ContrastStatusTag);
 	if (contrastStatus)
 		applyContrast(contrastStatus, global);
 
-	CcmStatus *ccmStatus = rpiMetadata.getLocked<CcmStatus>("ccm.status");
+	CcmStatus *ccmStatus = rpiMetadata.getLocked<CcmStatus>(RPiController::CcmStatusTag);
 	if (ccmStatus)
 		applyCCM(ccmStatus, global);
 
-	AlscStatus *alscStatus = rpiMetadata.getLocked<AlscStatus>("alsc.status");
+	AlscStatus *alscStatus = rpiMetadata.getLocked<AlscStatus>(RPiController::AlscStatusTag);
 	if (alscStatus)
 		applyLensShading(alscStatus, global);
 
-	DpcStatus *dpcStatus = rpiMetadata.getLocked<DpcStatus>("dpc.status");
+	DpcStatus *dpcStatus = rpiMetadata.getLocked<DpcStatus>(RPiController::DpcStatusTag);
 	if (dpcStatus)
 		applyDPC(dpcStatus, global);
 
-	SdnStatus *sdnStatus = rpiMetadata.getLocked<SdnStatus>("sdn.status");
+	SdnStatus *sdnStatus = rpiMetadata.getLocked<SdnStatus>(RPiController::SdnStatusTag);
 	if (sdnStatus)
 		applySdn(sdnStatus, global);
 
-	DeviceStatus *deviceStatus = rpiMetadata.getLocked<DeviceStatus>("device.status");
-	TdnStatus *tdnStatus = rpiMetadata.getLocked<TdnStatus>("tdn.status");
+	DeviceStatus *deviceStatus = rpiMetadata.getLocked<DeviceStatus>(RPiController::DeviceStatusTag);
+	TdnStatus *tdnStatus = rpiMetadata.getLocked<TdnStatus>(RPiController::TdnStatusTag);
 	if (tdnStatus && deviceStatus)
 		applyTdn(tdnStatus, deviceStatus, global);
 
-	CdnStatus *cdnStatus = rpiMetadata.getLocked<CdnStatus>("cdn.status");
+	CdnStatus *cdnStatus = rpiMetadata.getLocked<CdnStatus>(RPiController::CdnStatusTag);
 	if (cdnStatus)
 		applyCdn(cdnStatus, global);
 
-	GeqStatus *geqStatus = rpiMetadata.getLocked<GeqStatus>("geq.status");
+	GeqStatus *geqStatus = rpiMetadata.getLocked<GeqStatus>(RPiController::GeqStatusTag);
 	if (geqStatus)
 		applyGeq(geqStatus, global);
 
 	SaturationStatus *saturationStatus =
-		rpiMetadata.getLocked<SaturationStatus>("saturation.status");
+		rpiMetadata.getLocked<SaturationStatus>(RPiController::SaturationStatusTag);
 	if (saturationStatus)
 		applySaturation(saturationStatus, global);
 
-	SharpenStatus *sharpenStatus = rpiMetadata.getLocked<SharpenStatus>("sharpen.status");
+	SharpenStatus *sharpenStatus = rpiMetadata.getLocked<SharpenStatus>(RPiController::SharpenStatusTag);
 	if (sharpenStatus)
 		applySharpen(sharpenStatus, global);
 
-	StitchStatus *stitchStatus = rpiMetadata.getLocked<StitchStatus>("stitch.status");
+	StitchStatus *stitchStatus = rpiMetadata.getLocked<StitchStatus>(RPiController::StitchStatusTag);
 	if (stitchStatus) {
 		/*
 		 * Note that it's the *delayed* AGC status that contains the HDR mode/channel
 		 * info that pertains to this frame!
 		 */
-		AgcStatus *agcStatus = rpiMetadata.getLocked<AgcStatus>("agc.delayed_status");
+		AgcStatus *agcStatus = rpiMetadata.getLocked<AgcStatus>(RPiController::AgcDelayedStatusTag);
 		/* prepareIsp() will fetch this value. Maybe pass it back differently? */
 		stitchSwapBuffers_ = applyStitch(stitchStatus, deviceStatus, agcStatus, global);
 	} else
 		lastStitchHdrStatus_ = HdrStatus();
 
-	TonemapStatus *tonemapStatus = rpiMetadata.getLocked<TonemapStatus>("tonemap.status");
+	TonemapStatus *tonemapStatus = rpiMetadata.getLocked<TonemapStatus>(RPiController::TonemapStatusTag);
 	if (tonemapStatus)
 		applyTonemap(tonemapStatus, global);
 
@@ -437,7 +467,7 @@ void IpaPiSP::platformPrepareIsp([[maybe_unused]] const PrepareParams &params,
 	lastExposure_ = deviceStatus->shutterSpeed * deviceStatus->analogueGain;
 
 	/* Lens control */
-	const AfStatus *afStatus = rpiMetadata.getLocked<AfStatus>("af.status");
+	const AfStatus *afStatus = rpiMetadata.getLocked<AfStatus>(RPiController::AfStatusTag);
 	if (afStatus) {
 		ControlList lensctrls(lensCtrls_);
 		applyAF(afStatus, lensctrls);
@@ -452,7 +482,6 @@ RPiController::StatisticsPtr IpaPiSP::platformProcessStats(Span<uint8_t> mem)
 
 	const pisp_statistics *stats = reinterpret_cast<pisp_statistics *>(mem.data());
 
-	unsigned int i;
 	StatisticsPtr statistics =
 		std::make_unique<Statistics>(Statistics::AgcStatsPos::PostWb,
 					     Statistics::ColourStatsPos::PreLsc);
@@ -461,23 +490,21 @@ RPiController::StatisticsPtr IpaPiSP::platformProcessStats(Span<uint8_t> mem)
 	statistics->yHist = RPiController::Histogram(stats->agc.histogram,
 						     PISP_AGC_STATS_NUM_BINS);
 
-	statistics->awbRegions.init({ PISP_AWB_STATS_SIZE, PISP_AWB_STATS_SIZE });
-	for (i = 0; i < statistics->awbRegions.numRegions(); i++)
-		statistics->awbRegions.set(i, { { stats->awb.zones[i].R_sum,
-						  stats->awb.zones[i].G_sum,
-						  stats->awb.zones[i].B_sum },
-						stats->awb.zones[i].counted, 0 });
+	/*
+	 * The region statistics are read directly from the stats buffer, which
+	 * stays mapped and is not returned to the pipeline handler before the
+	 * algorithms have processed the frame. Algorithms that keep statistics
+	 * for later frames copy them with retainStatistics().
+	 */
+	statistics->awbRegions.initView({ PISP_AWB_STATS_SIZE, PISP_AWB_STATS_SIZE }, 0,
+					stats, readAwbRegion);
 
 	/* AGC region sums only get collected on floating zones. */
-	statistics->agcRegions.init({ 0, 0 }, PISP_FLOATING_STATS_NUM_ZONES);
-	for (i = 0; i < statistics->agcRegions.numRegions(); i++)
-		statistics->agcRegions.setFloating(i,
-						   { { 0, 0, 0, stats->agc.floating[i].Y_sum },
-						     stats->agc.floating[i].counted, 0 });
-
-	statistics->focusRegions.init({ PISP_CDAF_STATS_SIZE, PISP_CDAF_STATS_SIZE });
-	for (i = 0; i < statistics->focusRegions.numRegions(); i++)
-		statistics->focusRegions.set(i, { stats->cdaf.foms[i] >> 20, 0, 0 });
+	statistics->agcRegions.initView({ 0, 0 }, PISP_FLOATING_STATS_NUM_ZONES,
+					stats, readAgcRegion);
+
+	statistics->focusRegions.initView({ PISP_CDAF_STATS_SIZE, PISP_CDAF_STATS_SIZE }, 0,
+					  stats, readFocusRegion);
 
 	if (statsMetadataOutput_) {
 		Span<const uint8_t> statsSpan(reinterpret_cast<const uint8_t *>(stats),
@@ -0,0 +1,266 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * soft_simple.cpp - Simple pipeline software converter Image Processing Algorithm module
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <errno.h>
+#include <memory>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <linux/v4l2-controls.h>
+
+#include <libcamera/base/log.h>
+#include <libcamera/base/shared_fd.h>
+#include <libcamera/base/span.h>
+
+#include <libcamera/controls.h>
+#include <libcamera/ipa/ipa_interface.h>
+#include <libcamera/ipa/ipa_module_info.h>
+#include <libcamera/ipa/soft_ipa_interface.h>
+
+#include "libcamera/internal/converter/software_statistics.h"
+
+#include "libipa/camera_sensor_helper.h"
+#include "libipa/histogram.h"
+
+namespace libcamera {
+
+LOG_DEFINE_CATEGORY(IPASoft)
+
+using namespace ipa;
+
+namespace {
+
+/*
+ * The software converter subtracts a black level of 1/16 of the raw range,
+ * which maps to the first 4 bins of the statistics histogram.
+ */
+constexpr double kBlackLevelBins = SoftwareStatistics::kHistogramBins / 16.0;
+
+/*
+ * Target mean level of the image after black level subtraction, relative to
+ * the white level. This corresponds to a mid-grey after gamma correction.
+ */
+constexpr double kTargetLevel = 0.18;
+
+/* Do not adjust the exposure when the error is below this threshold. */
+constexpr double kTolerance = 0.05;
+
+/*
+ * Number of frames to skip after updating the sensor controls, to let the new
+ * controls take effect before measuring the result. Without delayed controls,
+ * this is an approximation of the sensor control latency.
+ */
+constexpr unsigned int kFramesToSettle = 2;
+
+} /* namespace */
+
+class IPASoftSimple : public soft::IPASoftInterface
+{
+public:
+	IPASoftSimple();
+	~IPASoftSimple();
+
+	int init(const IPASettings &settings, const SharedFD &fdStats,
+		 const ControlInfoMap &sensorControls) override;
+	int configure(const ControlInfoMap &sensorControls) override;
+
+	int start() override;
+	void stop() override;
+
+	void processStats(uint32_t frame, const ControlList &sensorControls) override;
+
+private:
+	double gain(int32_t code) const;
+	int32_t gainCode(double gain) const;
+
+	SharedFD fdStats_;
+	const SoftwareStatistics *stats_;
+	std::unique_ptr<CameraSensorHelper> camHelper_;
+	ControlInfoMap sensorControls_;
+
+	int32_t minExposure_;
+	int32_t maxExposure_;
+	int32_t minGainCode_;
+	int32_t maxGainCode_;
+	double minGain_;
+	double maxGain_;
+
+	unsigned int ignoreUpdates_;
+	Histogram histogram_;
+};
+
+IPASoftSimple::IPASoftSimple()
+	: stats_(nullptr), ignoreUpdates_(0)
+{
+}
+
+IPASoftSimple::~IPASoftSimple()
+{
+	if (stats_)
+		munmap(const_cast<SoftwareStatistics *>(stats_),
+		       sizeof(SoftwareStatistics));
+}
+
+int IPASoftSimple::init(const IPASettings &settings, const SharedFD &fdStats,
+			const ControlInfoMap &sensorControls)
+{
+	camHelper_ = CameraSensorHelperFactoryBase::create(settings.sensorModel);
+	if (!camHelper_)
+		LOG(IPASoft, Warning)
+			<< "Failed to create camera sensor helper for "
+			<< settings.sensorModel << ", assuming linear gain";
+
+	fdStats_ = fdStats;
+	if (!fdStats_.isValid()) {
+		LOG(IPASoft, Error) << "Invalid statistics handle";
+		return -ENODEV;
+	}
+
+	void *mem = mmap(nullptr, sizeof(SoftwareStatistics), PROT_READ,
+			 MAP_SHARED, fdStats_.get(), 0);
+	if (mem == MAP_FAILED) {
+		int ret = -errno;
+		LOG(IPASoft, Error)
+			<< "Unable to map statistics: " << strerror(-ret);
+		return ret;
+	}
+
+	stats_ = static_cast<const SoftwareStatistics *>(mem);
+
+	return configure(sensorControls);
+}
+
+int IPASoftSimple::configure(const ControlInfoMap &sensorControls)
+{
+	const auto itExp = sensorControls.find(V4L2_CID_EXPOSURE);
+	const auto itGain = sensorControls.find(V4L2_CID_ANALOGUE_GAIN);
+	if (itExp == sensorControls.end() || itGain == sensorControls.end()) {
+		LOG(IPASoft, Error) << "Sensor doesn't support exposure and gain controls";
+		return -EINVAL;
+	}
+
+	sensorControls_ = sensorControls;
+
+	minExposure_ = std::max(itExp->second.min().get<int32_t>(), 1);
+	maxExposure_ = itExp->second.max().get<int32_t>();
+	minGainCode_ = std::max(itGain->second.min().get<int32_t>(), 1);
+	maxGainCode_ = itGain->second.max().get<int32_t>();
+	minGain_ = gain(minGainCode_);
+	maxGain_ = gain(maxGainCode_);
+
+	LOG(IPASoft, Debug)
+		<< "Exposure " << minExposure_ << "-" << maxExposure_
+		<< ", gain " << minGain_ << "-" << maxGain_;
+
+	return 0;
+}
+
+int IPASoftSimple::start()
+{
+	ignoreUpdates_ = 0;
+
+	return 0;
+}
+
+void IPASoftSimple::stop()
+{
+}
+
+/*
+ * Compute the exposure and gain that bring the mean luminance of the frame to
+ * the target level, and apply them to the sensor. The exposure time is
+ * increased first to keep the noise low, and the gain is only raised when the
+ * maximum exposure time is reached.
+ */
+void IPASoftSimple::processStats([[maybe_unused]] uint32_t frame,
+				 const ControlList &sensorControls)
+{
+	if (ignoreUpdates_ > 0) {
+		--ignoreUpdates_;
+		return;
+	}
+
+	histogram_.update(stats_->histogram);
+	if (!histogram_.total())
+		return;
+
+	double mean = histogram_.interQuantileMean(0.02, 0.98);
+	double level = (mean - kBlackLevelBins) /
+		       (histogram_.bins() - kBlackLevelBins);
+	level = std::max(level, 1e-3);
+
+	/* Limit the change per update to avoid oscillations. */
+	double factor = std::clamp(kTargetLevel / level, 0.5, 2.0);
+	if (std::abs(factor - 1.0) < kTolerance)
+		return;
+
+	int32_t exposure = sensorControls.get(V4L2_CID_EXPOSURE).get<int32_t>();
+	int32_t code = sensorControls.get(V4L2_CID_ANALOGUE_GAIN).get<int32_t>();
+	double total = std::max(exposure, 1) * gain(code) * factor;
+
+	double newExposure = std::clamp(total / minGain_,
+					static_cast<double>(minExposure_),
+					static_cast<double>(maxExposure_));
+	double newGain = std::clamp(total / newExposure, minGain_, maxGain_);
+
+	ControlList ctrls(sensorControls_);
+	ctrls.set(V4L2_CID_EXPOSURE, static_cast<int32_t>(std::lround(newExposure)));
+	ctrls.set(V4L2_CID_ANALOGUE_GAIN, gainCode(newGain));
+
+	LOG(IPASoft, Debug)
+		<< "Mean level " << level << ", exposure " << exposure
+		<< " -> " << newExposure << ", gain " << gain(code)
+		<< " -> " << newGain;
+
+	setSensorControls.emit(ctrls);
+
+	ignoreUpdates_ = kFramesToSettle;
+}
+
+/*
+ * Convert between gain codes and gain values with the camera sensor helper,
+ * or assume a linear gain model relative to the minimum gain code when no
+ * helper is available for the sensor.
+ */
+double IPASoftSimple::gain(int32_t code) const
+{
+	if (camHelper_)
+		return camHelper_->gain(code);
+
+	return static_cast<double>(code) / minGainCode_;
+}
+
+int32_t IPASoftSimple::gainCode(double gain) const
+{
+	int32_t code = camHelper_ ? static_cast<int32_t>(camHelper_->gainCode(gain))
+				  : static_cast<int32_t>(std::lround(gain * minGainCode_));
+
+	return std::clamp(code, minGainCode_, maxGainCode_);
+}
+
+/*
+ * External IPA module interface
+ */
+
+extern "C" {
+const struct IPAModuleInfo ipaModuleInfo = {
+	IPA_MODULE_API_VERSION,
+	0,
+	"SimplePipelineHandler",
+	"simple",
+};
+
+IPAInterface *ipaCreate()
+{
+	return new IPASoftSimple();
+}
+}
+
+} /* namespace libcamera */
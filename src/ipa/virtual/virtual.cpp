@@ -0,0 +1,110 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * virtual.cpp - Virtual Image Processing Algorithm module
+ */
+
+#include <libcamera/ipa/virtual_ipa_interface.h>
+
+#include <map>
+
+#include <libcamera/base/log.h>
+
+#include <libcamera/control_ids.h>
+
+#include <libcamera/ipa/ipa_interface.h>
+#include <libcamera/ipa/ipa_module_info.h>
+
+namespace libcamera {
+
+LOG_DEFINE_CATEGORY(IPAVirtual)
+
+/*
+ * The virtual IPA doesn't run any algorithm. It mimics the request and frame
+ * bookkeeping of real IPA modules, to measure the cost of the IPA interface
+ * and IPC in benchmarks.
+ */
+class IPAVirtual : public ipa::virt::IPAVirtualInterface
+{
+public:
+	int init(const IPASettings &settings) override;
+	int start() override;
+	void stop() override;
+
+	int configure(const std::map<unsigned int, IPAStream> &streamConfig) override;
+
+	void queueRequest(uint32_t frame, const ControlList &controls) override;
+	void processFrame(uint32_t frame, int64_t timestamp) override;
+
+private:
+	/* Exposure time and gain reported for all frames. */
+	static constexpr int32_t kExposureTime = 10000;
+	static constexpr float kAnalogueGain = 1.0f;
+
+	std::map<uint32_t, ControlList> frameControls_;
+};
+
+int IPAVirtual::init(const IPASettings &settings)
+{
+	LOG(IPAVirtual, Debug)
+		<< "Initializing virtual IPA for sensor " << settings.sensorModel;
+
+	return 0;
+}
+
+int IPAVirtual::start()
+{
+	return 0;
+}
+
+void IPAVirtual::stop()
+{
+	frameControls_.clear();
+}
+
+int IPAVirtual::configure(const std::map<unsigned int, IPAStream> &streamConfig)
+{
+	for (const auto &[id, stream] : streamConfig)
+		LOG(IPAVirtual, Debug)
+			<< "Stream " << id << ": " << stream.size << "-"
+			<< PixelFormat(stream.pixelFormat);
+
+	return 0;
+}
+
+void IPAVirtual::queueRequest(uint32_t frame, const ControlList &controls)
+{
+	frameControls_[frame] = controls;
+}
+
+void IPAVirtual::processFrame(uint32_t frame, [[maybe_unused]] int64_t timestamp)
+{
+	ControlList metadata(controls::controls);
+	metadata.set(controls::ExposureTime, kExposureTime);
+	metadata.set(controls::AnalogueGain, kAnalogueGain);
+
+	frameControls_.erase(frame);
+
+	frameProcessed.emit(frame, metadata);
+}
+
+/*
+ * External IPA module interface
+ */
+
+extern "C" {
+const struct IPAModuleInfo ipaModuleInfo = {
+	IPA_MODULE_API_VERSION,
+	0,
+	"PipelineHandlerVirtual",
+	"virtual",
+};
+
+IPAInterface *ipaCreate()
+{
+	return new IPAVirtual();
+}
+}
+
+} /* namespace libcamera */
@@ -7,6 +7,7 @@
 
 #include <libcamera/base/bound_method.h>
 #include <libcamera/base/message.h>
+#include <libcamera/base/message_pool.h>
 #include <libcamera/base/object.h>
 #include <libcamera/base/semaphore.h>
 #include <libcamera/base/thread.h>
@@ -50,6 +51,30 @@ namespace libcamera {
  * blocks until the receiver signals the completion of the invocation.
  */
 
+/*
+ * Argument packs and bound methods for queued invocations are allocated from
+ * the message pool, along with the InvokeMessage that carries them.
+ */
+void *BoundMethodPackBase::allocate(std::size_t size)
+{
+	return MessagePool::allocate(size);
+}
+
+void BoundMethodPackBase::deallocate(void *ptr)
+{
+	MessagePool::deallocate(ptr);
+}
+
+void *BoundMethodBase::operator new(std::size_t size)
+{
+	return MessagePool::allocate(size);
+}
+
+void BoundMethodBase::operator delete(void *ptr)
+{
+	MessagePool::deallocate(ptr);
+}
+
 /**
  * \brief Invoke the bound method with packed arguments
  * \param[in] pack Packed arguments
@@ -68,18 +93,7 @@ namespace libcamera {
 bool BoundMethodBase::activatePack(std::shared_ptr<BoundMethodPackBase> pack,
 				   bool deleteMethod)
 {
-	ConnectionType type = connectionType_;
-	if (type == ConnectionTypeAuto) {
-		if (Thread::current() == object_->thread())
-			type = ConnectionTypeDirect;
-		else
-			type = ConnectionTypeQueued;
-	} else if (type == ConnectionTypeBlocking) {
-		if (Thread::current() == object_->thread())
-			type = ConnectionTypeDirect;
-	}
-
-	switch (type) {
+	switch (resolveConnectionType()) {
 	case ConnectionTypeDirect:
 	default:
 		invokePack(pack.get());
@@ -107,4 +121,76 @@ bool BoundMethodBase::activatePack(std::shared_ptr<BoundMethodPackBase> pack,
 	}
 }
 
+/**
+ * \brief Invoke the bound method with arguments shared between bound methods
+ * \param[in] pack Packed arguments
+ * \param[in] type The connection type, as returned by resolveConnectionType()
+ *
+ * This function is similar to activatePack(), but the \a pack is shared
+ * between all the bound methods activated by a signal emission and is only
+ * accessed to read the arguments. Its type is BoundMethodPack<void, Args...>
+ * regardless of the return type of the bound method, and the return value of
+ * the bound method is discarded.
+ *
+ * Sharing the arguments pack avoids copying the arguments once for every
+ * bound method. As direct invocations don't need to pack the arguments at
+ * all, callers should only create a pack for the other connection types.
+ */
+void BoundMethodBase::activateSharedPack(const std::shared_ptr<BoundMethodPackBase> &pack,
+					 ConnectionType type)
+{
+	switch (type) {
+	case ConnectionTypeDirect:
+	default:
+		invokeSharedPack(pack.get());
+		break;
+
+	case ConnectionTypeQueued: {
+		std::unique_ptr<Message> msg =
+			std::make_unique<InvokeMessage>(this, pack, nullptr, false, true);
+		object_->postMessage(std::move(msg));
+		break;
+	}
+
+	case ConnectionTypeBlocking: {
+		Semaphore semaphore;
+
+		std::unique_ptr<Message> msg =
+			std::make_unique<InvokeMessage>(this, pack, &semaphore, false, true);
+		object_->postMessage(std::move(msg));
+
+		semaphore.acquire();
+		break;
+	}
+	}
+}
+
+/**
+ * \brief Resolve the connection type for an invocation from the current thread
+ *
+ * The ConnectionTypeAuto and ConnectionTypeBlocking connection types depend on
+ * whether the bound method is invoked from the thread of its object. This
+ * function resolves them for the current thread.
+ *
+ * This function shall only be called for bound methods that have an object.
+ *
+ * \return The connection type, either ConnectionTypeDirect,
+ * ConnectionTypeQueued or ConnectionTypeBlocking
+ */
+ConnectionType BoundMethodBase::resolveConnectionType() const
+{
+	ConnectionType type = connectionType_;
+	if (type == ConnectionTypeAuto) {
+		if (Thread::current() == object_->thread())
+			type = ConnectionTypeDirect;
+		else
+			type = ConnectionTypeQueued;
+	} else if (type == ConnectionTypeBlocking) {
+		if (Thread::current() == object_->thread())
+			type = ConnectionTypeDirect;
+	}
+
+	return type;
+}
+
 } /* namespace libcamera */
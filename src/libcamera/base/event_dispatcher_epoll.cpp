@@ -0,0 +1,396 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * event_dispatcher_epoll.cpp - Epoll-based event dispatcher
+ */
+
+#include <libcamera/base/event_dispatcher_epoll.h>
+
+#include <array>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <libcamera/base/event_notifier.h>
+#include <libcamera/base/log.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/timer.h>
+
+/**
+ * \file base/event_dispatcher_epoll.h
+ */
+
+namespace libcamera {
+
+LOG_DECLARE_CATEGORY(Event)
+
+namespace {
+
+const char *notifierType(EventNotifier::Type type)
+{
+	if (type == EventNotifier::Read)
+		return "read";
+	if (type == EventNotifier::Write)
+		return "write";
+	if (type == EventNotifier::Exception)
+		return "exception";
+
+	return "";
+}
+
+constexpr unsigned int kMaxEvents = 32;
+
+} /* namespace */
+
+/**
+ * \class EventDispatcherEpoll
+ * \brief An epoll-based event dispatcher
+ *
+ * The EventDispatcherEpoll keeps a persistent epoll set that is only updated
+ * when event notifiers are registered, unregistered or change type. Timers are
+ * backed by a single timerfd armed to the earliest timer deadline, and the
+ * dispatcher is interrupted through an eventfd. The cost of processing events
+ * thus scales with the number of ready file descriptors instead of the total
+ * number of monitored file descriptors.
+ */
+
+EventDispatcherEpoll::EventDispatcherEpoll()
+	: processingEvents_(false)
+{
+	/*
+	 * Create the epoll, event and timer fds. Failures are fatal as the
+	 * dispatcher can't operate without them.
+	 */
+	epollfd_ = UniqueFD(epoll_create1(EPOLL_CLOEXEC));
+	if (!epollfd_.isValid())
+		LOG(Event, Fatal) << "Unable to create epoll fd";
+
+	eventfd_ = UniqueFD(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+	if (!eventfd_.isValid())
+		LOG(Event, Fatal) << "Unable to create eventfd";
+
+	/*
+	 * The utils::clock is a std::chrono::steady_clock, which is backed by
+	 * CLOCK_MONOTONIC on Linux. Timer deadlines can thus be programmed in
+	 * the timerfd as absolute times.
+	 */
+	timerfd_ = UniqueFD(timerfd_create(CLOCK_MONOTONIC,
+					   TFD_CLOEXEC | TFD_NONBLOCK));
+	if (!timerfd_.isValid())
+		LOG(Event, Fatal) << "Unable to create timerfd";
+
+	for (const UniqueFD *fd : { &eventfd_, &timerfd_ }) {
+		struct epoll_event event = {};
+		event.events = EPOLLIN;
+		event.data.fd = fd->get();
+
+		if (epoll_ctl(epollfd_.get(), EPOLL_CTL_ADD, fd->get(), &event) < 0)
+			LOG(Event, Fatal)
+				<< "Unable to add fd " << fd->get()
+				<< " to epoll set: " << strerror(errno);
+	}
+}
+
+EventDispatcherEpoll::~EventDispatcherEpoll()
+{
+}
+
+void EventDispatcherEpoll::registerEventNotifier(EventNotifier *notifier)
+{
+	EventNotifierSetEpoll &set = notifiers_[notifier->fd()];
+	EventNotifier::Type type = notifier->type();
+
+	if (set.notifiers[type] && set.notifiers[type] != notifier) {
+		LOG(Event, Warning)
+			<< "Ignoring duplicate " << notifierType(type)
+			<< " notifier for fd " << notifier->fd();
+		return;
+	}
+
+	set.notifiers[type] = notifier;
+
+	updateNotifierSet(notifier->fd(), set);
+}
+
+void EventDispatcherEpoll::unregisterEventNotifier(EventNotifier *notifier)
+{
+	auto iter = notifiers_.find(notifier->fd());
+	if (iter == notifiers_.end())
+		return;
+
+	EventNotifierSetEpoll &set = iter->second;
+	EventNotifier::Type type = notifier->type();
+
+	if (!set.notifiers[type])
+		return;
+
+	if (set.notifiers[type] != notifier) {
+		LOG(Event, Warning)
+			<< notifierType(type) << " notifier for fd "
+			<< notifier->fd() << " is not registered";
+		return;
+	}
+
+	set.notifiers[type] = nullptr;
+
+	updateNotifierSet(notifier->fd(), set);
+
+	if (!set.empty())
+		return;
+
+	/*
+	 * Don't race with event processing if this function is called from an
+	 * event notifier. The notifiers_ entry will be erased by
+	 * processEvents().
+	 */
+	if (processingEvents_) {
+		staleNotifiers_.push_back(notifier->fd());
+		return;
+	}
+
+	notifiers_.erase(iter);
+}
+
+void EventDispatcherEpoll::registerTimer(Timer *timer)
+{
+	timers_.push(timer);
+}
+
+void EventDispatcherEpoll::unregisterTimer(Timer *timer)
+{
+	timers_.remove(timer);
+}
+
+void EventDispatcherEpoll::processEvents()
+{
+	std::array<struct epoll_event, kMaxEvents> events;
+	int ret;
+
+	Thread::current()->dispatchMessages();
+
+	armTimer();
+
+	/* Wait for events and process notifiers and timers. */
+	do {
+		ret = epoll_wait(epollfd_.get(), events.data(), events.size(), -1);
+	} while (ret == -1 && errno == EINTR);
+
+	if (ret < 0) {
+		ret = -errno;
+		LOG(Event, Warning) << "epoll_wait() failed with " << strerror(-ret);
+	} else if (ret > 0) {
+		processingEvents_ = true;
+
+		for (int i = 0; i < ret; ++i) {
+			const struct epoll_event &event = events[i];
+
+			if (event.data.fd == eventfd_.get())
+				processInterrupt();
+			else if (event.data.fd == timerfd_.get())
+				processTimerfd();
+			else
+				processNotifiers(event);
+		}
+
+		processingEvents_ = false;
+
+		/*
+		 * Erase the notifiers_ entries that have been emptied by event
+		 * notifiers while processing events.
+		 */
+		for (int fd : staleNotifiers_) {
+			auto iter = notifiers_.find(fd);
+			if (iter != notifiers_.end() && iter->second.empty())
+				notifiers_.erase(iter);
+		}
+
+		staleNotifiers_.clear();
+	}
+
+	processTimers();
+}
+
+void EventDispatcherEpoll::interrupt()
+{
+	uint64_t value = 1;
+	ssize_t ret = write(eventfd_.get(), &value, sizeof(value));
+	if (ret != sizeof(value)) {
+		if (ret < 0)
+			ret = -errno;
+		LOG(Event, Error)
+			<< "Failed to interrupt event dispatcher ("
+			<< ret << ")";
+	}
+}
+
+uint32_t EventDispatcherEpoll::EventNotifierSetEpoll::events() const
+{
+	uint32_t events = 0;
+
+	if (notifiers[EventNotifier::Read])
+		events |= EPOLLIN;
+	if (notifiers[EventNotifier::Write])
+		events |= EPOLLOUT;
+	if (notifiers[EventNotifier::Exception])
+		events |= EPOLLPRI;
+
+	return events;
+}
+
+bool EventDispatcherEpoll::EventNotifierSetEpoll::empty() const
+{
+	return !notifiers[0] && !notifiers[1] && !notifiers[2];
+}
+
+void EventDispatcherEpoll::updateNotifierSet(int fd, EventNotifierSetEpoll &set)
+{
+	uint32_t events = set.events();
+	if (events == set.registered)
+		return;
+
+	struct epoll_event event = {};
+	event.events = events;
+	event.data.fd = fd;
+
+	int op = !set.registered ? EPOLL_CTL_ADD
+		: events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+	int ret = epoll_ctl(epollfd_.get(), op, fd, &event);
+
+	/*
+	 * The kernel removes file descriptors from the epoll set automatically
+	 * when they get closed. If the fd has been closed and reused without
+	 * the notifiers being unregistered first, the kernel state doesn't
+	 * match ours. Retry with the operation matching the kernel state.
+	 */
+	if (ret < 0 && errno == ENOENT && op == EPOLL_CTL_MOD) {
+		op = EPOLL_CTL_ADD;
+		ret = epoll_ctl(epollfd_.get(), op, fd, &event);
+	} else if (ret < 0 && errno == EEXIST && op == EPOLL_CTL_ADD) {
+		op = EPOLL_CTL_MOD;
+		ret = epoll_ctl(epollfd_.get(), op, fd, &event);
+	}
+
+	if (ret < 0 && op == EPOLL_CTL_DEL) {
+		/* The fd has been closed already, nothing to remove. */
+		set.registered = 0;
+		return;
+	}
+
+	if (ret < 0) {
+		ret = -errno;
+		LOG(Event, Warning)
+			<< "Disabling notifiers due to invalid file descriptor "
+			<< fd << ": " << strerror(-ret);
+
+		set.notifiers[0] = set.notifiers[1] = set.notifiers[2] = nullptr;
+		set.registered = 0;
+		return;
+	}
+
+	set.registered = events;
+}
+
+void EventDispatcherEpoll::armTimer()
+{
+	utils::time_point deadline = !timers_.empty()
+				   ? timers_.top()->deadline()
+				   : utils::time_point();
+
+	if (deadline == armedDeadline_)
+		return;
+
+	/* A zero it_value disarms the timer when no timer is registered. */
+	struct itimerspec spec = {};
+	if (!timers_.empty())
+		spec.it_value = utils::duration_to_timespec(deadline.time_since_epoch());
+
+	if (timerfd_settime(timerfd_.get(), TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
+		LOG(Event, Error)
+			<< "Failed to arm timer: " << strerror(errno);
+		return;
+	}
+
+	armedDeadline_ = deadline;
+}
+
+void EventDispatcherEpoll::processInterrupt()
+{
+	uint64_t value;
+	ssize_t ret = read(eventfd_.get(), &value, sizeof(value));
+	if (ret != sizeof(value)) {
+		if (ret < 0)
+			ret = -errno;
+		LOG(Event, Error)
+			<< "Failed to process interrupt (" << ret << ")";
+	}
+}
+
+void EventDispatcherEpoll::processTimerfd()
+{
+	/*
+	 * The timerfd is disarmed once it expires. Reset the armed deadline to
+	 * force rearming in the next iteration.
+	 */
+	armedDeadline_ = utils::time_point();
+
+	uint64_t value;
+	ssize_t ret = read(timerfd_.get(), &value, sizeof(value));
+	if (ret != sizeof(value) && !(ret < 0 && errno == EAGAIN)) {
+		if (ret < 0)
+			ret = -errno;
+		LOG(Event, Error)
+			<< "Failed to process timer expiration (" << ret << ")";
+	}
+}
+
+void EventDispatcherEpoll::processNotifiers(const struct epoll_event &event)
+{
+	static const struct {
+		EventNotifier::Type type;
+		uint32_t events;
+	} types[] = {
+		{ EventNotifier::Read, EPOLLIN },
+		{ EventNotifier::Write, EPOLLOUT },
+		{ EventNotifier::Exception, EPOLLPRI },
+	};
+
+	auto iter = notifiers_.find(event.data.fd);
+	if (iter == notifiers_.end())
+		return;
+
+	EventNotifierSetEpoll &set = iter->second;
+
+	for (const auto &type : types) {
+		EventNotifier *notifier = set.notifiers[type.type];
+
+		if (notifier && event.events & type.events)
+			notifier->activated.emit();
+	}
+
+	/* Erase the notifiers_ entry if it is now empty. */
+	if (set.empty())
+		notifiers_.erase(iter);
+}
+
+void EventDispatcherEpoll::processTimers()
+{
+	utils::time_point now = utils::clock::now();
+
+	while (!timers_.empty()) {
+		Timer *timer = timers_.top();
+		if (timer->deadline() > now)
+			break;
+
+		timers_.pop();
+		timer->stop();
+		timer->timeout.emit();
+	}
+}
+
+} /* namespace libcamera */
@@ -7,16 +7,24 @@
 
 #include <libcamera/base/log.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <list>
+#include <memory>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/types.h>
 #include <syslog.h>
+#include <thread>
 #include <time.h>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <libcamera/logging.h>
 
@@ -51,7 +59,52 @@
  * log file by setting the LIBCAMERA_LOG_FILE environment variable to the name
  * of the file. The file must be writable and is truncated if it exists. If any
  * error occurs when opening the file, the file is ignored and the log is output
- * to std::cerr.
+ * to std::cerr. Setting the LIBCAMERA_LOG_FORMAT environment variable to
+ * "binary" writes the log file in the binary format described below instead of
+ * text.
+ *
+ * Log messages are written synchronously by default, in the context of the
+ * thread that logs them. Setting the LIBCAMERA_LOG_ASYNC environment variable
+ * to a non-empty value moves writing to a dedicated thread. Messages are then
+ * queued to a bounded per-thread buffer, and messages that don't fit in the
+ * buffer are dropped and accounted for in the log. Fatal messages are always
+ * written synchronously, after all queued messages.
+ */
+
+/**
+ * \page log-binary Binary Log Format
+ *
+ * The binary log format stores log messages in compact records that are cheap
+ * to produce and to parse. Category names and source locations are written
+ * once, in definition records, and messages refer to them by numerical ID.
+ * The utils/decode-log.py script converts binary logs to text.
+ *
+ * All fields are stored in the byte order of the host that produced the log.
+ * The file starts with a header:
+ *
+ * - u32 magic, 0x4c42434c ("LCBL" when stored in little-endian)
+ * - u16 version, currently 1
+ * - u16 reserved, set to 0
+ * - u64 realtime, the CLOCK_REALTIME time at file creation in nanoseconds
+ * - u64 monotonic, the log clock time at file creation in nanoseconds
+ *
+ * The header is followed by records, each starting with
+ *
+ * - u16 type, the record type
+ * - u16 reserved, set to 0
+ * - u32 size, the size of the record payload in bytes
+ *
+ * and followed by a payload whose content depends on the record type:
+ *
+ * - Category definition (1): u32 ID followed by the category name
+ * - Location definition (2): u32 ID followed by the "file:line" location
+ * - Message (3): u64 timestamp in nanoseconds, u32 thread ID, u32 category ID,
+ *   u32 location ID, u16 severity, u16 prefix size, followed by the prefix and
+ *   the message text
+ * - Text (4): free-form text, such as backtraces
+ *
+ * Strings are not null-terminated, and message texts don't include the
+ * trailing newline. Decoders shall skip records of unknown types.
  */
 
 /**
@@ -97,6 +150,23 @@ static const char *log_severity_name(LogSeverity severity)
 		return "UNKWN";
 }
 
+/**
+ * \brief A log message ready to be written to a log output
+ *
+ * The LogEntry structure stores all the information from a LogMessage needed
+ * to format the message, to allow formatting and writing it outside of the
+ * context of the thread that logged it.
+ */
+struct LogEntry {
+	utils::time_point timestamp;
+	pid_t tid;
+	LogSeverity severity;
+	const LogCategory *category;
+	std::string fileInfo;
+	std::string prefix;
+	std::string msg;
+};
+
 /**
  * \brief Log output
  *
@@ -105,33 +175,59 @@ static const char *log_severity_name(LogSeverity severity)
 class LogOutput
 {
 public:
-	LogOutput(const char *path, bool color);
+	LogOutput(const char *path, LoggingTarget target, bool color);
 	LogOutput(std::ostream *stream, bool color);
 	LogOutput();
 	~LogOutput();
 
 	bool isValid() const;
-	void write(const LogMessage &msg);
+	void write(const LogEntry &entry);
 	void write(const std::string &msg);
 
 private:
+	enum BinaryRecordType : uint16_t {
+		BinaryRecordCategory = 1,
+		BinaryRecordLocation = 2,
+		BinaryRecordMessage = 3,
+		BinaryRecordText = 4,
+	};
+
 	void writeSyslog(LogSeverity severity, const std::string &msg);
 	void writeStream(const std::string &msg);
 
+	void writeBinaryHeader();
+	void writeBinary(const LogEntry &entry);
+	void writeBinary(const std::string &msg);
+	static void appendBinaryRecord(std::string *buffer, BinaryRecordType type,
+				       const std::string &payload);
+
 	std::ostream *stream_;
 	LoggingTarget target_;
 	bool color_;
+
+	Mutex mutex_;
+	std::unordered_map<const LogCategory *, uint32_t> categoryIds_
+		LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	std::unordered_map<std::string, uint32_t> locationIds_
+		LIBCAMERA_TSA_GUARDED_BY(mutex_);
 };
 
 /**
  * \brief Construct a log output based on a file
  * \param[in] path Full path to log file
- * \param[in] color True to output colored messages
+ * \param[in] target The file format, LoggingTargetFile or
+ * LoggingTargetBinaryFile
+ * \param[in] color True to output colored messages, ignored for binary files
  */
-LogOutput::LogOutput(const char *path, bool color)
-	: target_(LoggingTargetFile), color_(color)
+LogOutput::LogOutput(const char *path, LoggingTarget target, bool color)
+	: target_(target), color_(color && target == LoggingTargetFile)
 {
-	stream_ = new std::ofstream(path);
+	if (target_ == LoggingTargetBinaryFile) {
+		stream_ = new std::ofstream(path, std::ios::binary);
+		writeBinaryHeader();
+	} else {
+		stream_ = new std::ofstream(path);
+	}
 }
 
 /**
@@ -157,6 +253,7 @@ LogOutput::~LogOutput()
 {
 	switch (target_) {
 	case LoggingTargetFile:
+	case LoggingTargetBinaryFile:
 		delete stream_;
 		break;
 	case LoggingTargetSyslog:
@@ -175,6 +272,7 @@ bool LogOutput::isValid() const
 {
 	switch (target_) {
 	case LoggingTargetFile:
+	case LoggingTargetBinaryFile:
 		return stream_->good();
 	case LoggingTargetStream:
 		return stream_ != nullptr;
@@ -203,9 +301,9 @@ constexpr const char *kColorBrightWhite = "\033[1;37m";
 
 /**
  * \brief Write message to log output
- * \param[in] msg Message to write
+ * \param[in] entry Message to write
  */
-void LogOutput::write(const LogMessage &msg)
+void LogOutput::write(const LogEntry &entry)
 {
 	static const char *const severityColors[] = {
 		kColorBrightCyan,
@@ -220,7 +318,7 @@ void LogOutput::write(const LogMessage &msg)
 	const char *prefixColor = color_ ? kColorGreen : "";
 	const char *resetColor = color_ ? kColorReset : "";
 	const char *severityColor = "";
-	LogSeverity severity = msg.severity();
+	LogSeverity severity = entry.severity;
 	std::string str;
 
 	if (color_) {
@@ -233,24 +331,27 @@ void LogOutput::write(const LogMessage &msg)
 	switch (target_) {
 	case LoggingTargetSyslog:
 		str = std::string(log_severity_name(severity)) + " "
-		    + msg.category().name() + " " + msg.fileInfo() + " ";
-		if (!msg.prefix().empty())
-			str += msg.prefix() + ": ";
-		str += msg.msg();
+		    + entry.category->name() + " " + entry.fileInfo + " ";
+		if (!entry.prefix.empty())
+			str += entry.prefix + ": ";
+		str += entry.msg;
 		writeSyslog(severity, str);
 		break;
 	case LoggingTargetStream:
 	case LoggingTargetFile:
-		str = "[" + utils::time_point_to_string(msg.timestamp()) + "] ["
-		    + std::to_string(Thread::currentId()) + "] "
+		str = "[" + utils::time_point_to_string(entry.timestamp) + "] ["
+		    + std::to_string(entry.tid) + "] "
 		    + severityColor + log_severity_name(severity) + " "
-		    + categoryColor + msg.category().name() + " "
-		    + fileColor + msg.fileInfo() + " ";
-		if (!msg.prefix().empty())
-			str += prefixColor + msg.prefix() + ": ";
-		str += resetColor + msg.msg();
+		    + categoryColor + entry.category->name() + " "
+		    + fileColor + entry.fileInfo + " ";
+		if (!entry.prefix.empty())
+			str += prefixColor + entry.prefix + ": ";
+		str += resetColor + entry.msg;
 		writeStream(str);
 		break;
+	case LoggingTargetBinaryFile:
+		writeBinary(entry);
+		break;
 	default:
 		break;
 	}
@@ -270,6 +371,9 @@ void LogOutput::write(const std::string &str)
 	case LoggingTargetFile:
 		writeStream(str);
 		break;
+	case LoggingTargetBinaryFile:
+		writeBinary(str);
+		break;
 	default:
 		break;
 	}
@@ -286,6 +390,439 @@ void LogOutput::writeStream(const std::string &str)
 	stream_->flush();
 }
 
+namespace {
+
+template<typename T>
+void appendBinary(std::string *buffer, T value)
+{
+	buffer->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+uint64_t toNanoseconds(utils::time_point time)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+} /* namespace */
+
+void LogOutput::appendBinaryRecord(std::string *buffer, BinaryRecordType type,
+				   const std::string &payload)
+{
+	appendBinary<uint16_t>(buffer, type);
+	appendBinary<uint16_t>(buffer, 0);
+	appendBinary<uint32_t>(buffer, payload.size());
+	buffer->append(payload);
+}
+
+void LogOutput::writeBinaryHeader()
+{
+	struct timespec realtime;
+	clock_gettime(CLOCK_REALTIME, &realtime);
+	utils::time_point monotonic = utils::clock::now();
+
+	std::string header;
+	appendBinary<uint32_t>(&header, 0x4c42434c);
+	appendBinary<uint16_t>(&header, 1);
+	appendBinary<uint16_t>(&header, 0);
+	appendBinary<uint64_t>(&header, realtime.tv_sec * 1000000000ULL + realtime.tv_nsec);
+	appendBinary<uint64_t>(&header, toNanoseconds(monotonic));
+
+	writeStream(header);
+}
+
+void LogOutput::writeBinary(const LogEntry &entry)
+{
+	std::string buffer;
+	std::string payload;
+
+	MutexLocker locker(mutex_);
+
+	/* Define the category and location on first use. */
+	auto category = categoryIds_.try_emplace(entry.category,
+						 categoryIds_.size());
+	if (category.second) {
+		appendBinary<uint32_t>(&payload, category.first->second);
+		payload += entry.category->name();
+		appendBinaryRecord(&buffer, BinaryRecordCategory, payload);
+	}
+
+	auto location = locationIds_.try_emplace(entry.fileInfo,
+						 locationIds_.size());
+	if (location.second) {
+		payload.clear();
+		appendBinary<uint32_t>(&payload, location.first->second);
+		payload += entry.fileInfo;
+		appendBinaryRecord(&buffer, BinaryRecordLocation, payload);
+	}
+
+	/* Strip the trailing newline, the decoder adds it back. */
+	size_t size = entry.msg.size();
+	if (size && entry.msg[size - 1] == '\n')
+		size--;
+
+	size_t prefixSize = std::min<size_t>(entry.prefix.size(), UINT16_MAX);
+
+	payload.clear();
+	appendBinary<uint64_t>(&payload, toNanoseconds(entry.timestamp));
+	appendBinary<uint32_t>(&payload, entry.tid);
+	appendBinary<uint32_t>(&payload, category.first->second);
+	appendBinary<uint32_t>(&payload, location.first->second);
+	appendBinary<uint16_t>(&payload, entry.severity);
+	appendBinary<uint16_t>(&payload, prefixSize);
+	payload.append(entry.prefix, 0, prefixSize);
+	payload.append(entry.msg, 0, size);
+	appendBinaryRecord(&buffer, BinaryRecordMessage, payload);
+
+	writeStream(buffer);
+}
+
+void LogOutput::writeBinary(const std::string &str)
+{
+	std::string buffer;
+	appendBinaryRecord(&buffer, BinaryRecordText, str);
+
+	MutexLocker locker(mutex_);
+	writeStream(buffer);
+}
+
+/**
+ * \brief Single-producer single-consumer ring buffer of log entries
+ *
+ * Each thread that logs messages while asynchronous logging is enabled owns a
+ * LogRing. The thread pushes entries to the ring without locking, and the log
+ * writer thread pops them. When the ring is full, entries are dropped and
+ * counted.
+ */
+class LogRing
+{
+public:
+	static constexpr size_t kSize = 512;
+
+	LogRing()
+		: tid_(Thread::currentId()), dropped_(0), orphaned_(false),
+		  head_(0), tail_(0)
+	{
+	}
+
+	bool push(LogEntry &&entry);
+	bool pop(LogEntry *entry);
+	bool empty() const;
+
+	const pid_t tid_;
+	std::atomic<unsigned int> dropped_;
+	std::atomic<bool> orphaned_;
+
+private:
+	std::array<LogEntry, kSize> entries_;
+
+	/* Written by the producer only. */
+	std::atomic<size_t> head_;
+	/* Written by the consumer only. */
+	std::atomic<size_t> tail_;
+};
+
+bool LogRing::push(LogEntry &&entry)
+{
+	size_t head = head_.load(std::memory_order_relaxed);
+	size_t tail = tail_.load(std::memory_order_acquire);
+
+	if (head - tail == kSize) {
+		dropped_.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	entries_[head % kSize] = std::move(entry);
+
+	/*
+	 * The store is sequentially consistent to order it with the load of
+	 * LogAsyncWriter::sleeping_ that follows.
+	 */
+	head_.store(head + 1, std::memory_order_seq_cst);
+
+	return true;
+}
+
+bool LogRing::pop(LogEntry *entry)
+{
+	size_t tail = tail_.load(std::memory_order_relaxed);
+	size_t head = head_.load(std::memory_order_acquire);
+
+	if (head == tail)
+		return false;
+
+	*entry = std::move(entries_[tail % kSize]);
+	tail_.store(tail + 1, std::memory_order_release);
+
+	return true;
+}
+
+bool LogRing::empty() const
+{
+	return head_.load(std::memory_order_seq_cst) ==
+	       tail_.load(std::memory_order_relaxed);
+}
+
+/**
+ * \brief Asynchronous log writer
+ *
+ * The LogAsyncWriter drains the log rings of all threads from a dedicated
+ * thread, and writes the entries to the log output in timestamp order. The
+ * producer threads only take a lock when registering their ring, and when
+ * waking up the writer thread if it is sleeping.
+ */
+class LogAsyncWriter
+{
+public:
+	LogAsyncWriter(const std::shared_ptr<LogOutput> *output);
+	~LogAsyncWriter();
+
+	bool write(LogEntry &&entry);
+	void flush();
+
+private:
+	friend struct LogRingReleaser;
+
+	LogRing *ring();
+	void wake();
+	void run();
+	std::vector<LogEntry> collect() LIBCAMERA_TSA_REQUIRES(mutex_);
+	bool pending() LIBCAMERA_TSA_REQUIRES(mutex_);
+
+	const std::shared_ptr<LogOutput> *output_;
+	std::thread thread_;
+
+	Mutex mutex_;
+	ConditionVariable cv_;
+	std::vector<std::unique_ptr<LogRing>> rings_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	unsigned int flushRequests_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	unsigned int flushed_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	bool exit_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+
+	std::atomic<bool> sleeping_;
+};
+
+namespace {
+
+thread_local LogRing *currentRing = nullptr;
+thread_local bool currentRingReleased = false;
+
+} /* namespace */
+
+/*
+ * Mark the ring of the current thread as orphaned when the thread exits, to let
+ * the writer thread free it once drained. The ring pointer itself is a
+ * trivially destructible thread_local, which guarantees that messages logged
+ * by thread_local destructors that run after the releaser can still safely be
+ * handled, synchronously.
+ */
+struct LogRingReleaser {
+	~LogRingReleaser()
+	{
+		LogRing *ring = currentRing;
+
+		currentRing = nullptr;
+		currentRingReleased = true;
+
+		if (ring)
+			ring->orphaned_.store(true, std::memory_order_release);
+	}
+};
+
+thread_local LogRingReleaser currentRingReleaser;
+
+LogAsyncWriter::LogAsyncWriter(const std::shared_ptr<LogOutput> *output)
+	: output_(output), flushRequests_(0), flushed_(0), exit_(false),
+	  sleeping_(false)
+{
+	thread_ = std::thread(&LogAsyncWriter::run, this);
+}
+
+LogAsyncWriter::~LogAsyncWriter()
+{
+	{
+		MutexLocker locker(mutex_);
+		exit_ = true;
+	}
+
+	cv_.notify_all();
+	thread_.join();
+}
+
+LogRing *LogAsyncWriter::ring()
+{
+	if (currentRing || currentRingReleased)
+		return currentRing;
+
+	/* Odr-use the releaser to ensure it gets constructed. */
+	[[maybe_unused]] LogRingReleaser *releaser = &currentRingReleaser;
+
+	std::unique_ptr<LogRing> ring = std::make_unique<LogRing>();
+	currentRing = ring.get();
+
+	MutexLocker locker(mutex_);
+	rings_.push_back(std::move(ring));
+
+	return currentRing;
+}
+
+/**
+ * \brief Queue a log entry for asynchronous writing
+ * \param[in] entry The log entry
+ *
+ * The entry is dropped if the ring of the calling thread is full.
+ *
+ * \return False if the calling thread can't queue entries and the entry shall
+ * be written synchronously, true otherwise
+ */
+bool LogAsyncWriter::write(LogEntry &&entry)
+{
+	LogRing *ring = this->ring();
+	if (!ring)
+		return false;
+
+	if (!ring->push(std::move(entry)))
+		return true;
+
+	/*
+	 * Either the writer thread sees the new entry before going to sleep,
+	 * or we see it sleeping and wake it.
+	 */
+	if (sleeping_.load(std::memory_order_seq_cst))
+		wake();
+
+	return true;
+}
+
+void LogAsyncWriter::wake()
+{
+	if (!sleeping_.exchange(false))
+		return;
+
+	/*
+	 * Synchronize with the writer thread to avoid notifying it between
+	 * its last check for pending entries and the wait.
+	 */
+	mutex_.lock();
+	mutex_.unlock();
+
+	cv_.notify_all();
+}
+
+/**
+ * \brief Wait until all the entries queued so far have been written
+ */
+void LogAsyncWriter::flush()
+{
+	MutexLocker locker(mutex_);
+
+	unsigned int request = ++flushRequests_;
+	cv_.notify_all();
+
+	cv_.wait(locker, [&]() LIBCAMERA_TSA_REQUIRES(mutex_) {
+		return static_cast<int>(flushed_ - request) >= 0;
+	});
+}
+
+std::vector<LogEntry> LogAsyncWriter::collect()
+{
+	std::vector<LogEntry> entries;
+
+	for (auto iter = rings_.begin(); iter != rings_.end();) {
+		LogRing *ring = iter->get();
+
+		/*
+		 * Check the orphaned flag before draining, the ring can then
+		 * safely be freed once empty.
+		 */
+		bool orphaned = ring->orphaned_.load(std::memory_order_acquire);
+
+		LogEntry entry;
+		while (ring->pop(&entry))
+			entries.push_back(std::move(entry));
+
+		unsigned int dropped = ring->dropped_.exchange(0, std::memory_order_relaxed);
+		if (dropped) {
+			LogEntry &last = entries.emplace_back();
+			last.timestamp = utils::clock::now();
+			last.tid = ring->tid_;
+			last.severity = LogWarning;
+			last.category = &LogCategory::defaultCategory();
+			last.fileInfo = "log.cpp";
+			last.msg = std::to_string(dropped)
+				 + " log messages dropped\n";
+		}
+
+		if (orphaned)
+			iter = rings_.erase(iter);
+		else
+			++iter;
+	}
+
+	std::stable_sort(entries.begin(), entries.end(),
+			 [](const LogEntry &a, const LogEntry &b) {
+				 return a.timestamp < b.timestamp;
+			 });
+
+	return entries;
+}
+
+bool LogAsyncWriter::pending()
+{
+	for (const std::unique_ptr<LogRing> &ring : rings_) {
+		if (!ring->empty() || ring->orphaned_.load(std::memory_order_relaxed))
+			return true;
+	}
+
+	return false;
+}
+
+void LogAsyncWriter::run()
+{
+	MutexLocker locker(mutex_);
+
+	while (true) {
+		unsigned int request = flushRequests_;
+		std::vector<LogEntry> entries = collect();
+
+		locker.unlock();
+
+		if (!entries.empty()) {
+			std::shared_ptr<LogOutput> output = std::atomic_load(output_);
+			if (output) {
+				for (const LogEntry &entry : entries)
+					output->write(entry);
+			}
+		}
+
+		locker.lock();
+
+		if (flushed_ != request) {
+			flushed_ = request;
+			cv_.notify_all();
+		}
+
+		if (!entries.empty() || flushRequests_ != request)
+			continue;
+
+		if (exit_)
+			break;
+
+		sleeping_.store(true, std::memory_order_seq_cst);
+
+		if (pending()) {
+			sleeping_.store(false, std::memory_order_relaxed);
+			continue;
+		}
+
+		cv_.wait(locker, [&]() LIBCAMERA_TSA_REQUIRES(mutex_) {
+			return !sleeping_.load(std::memory_order_relaxed) ||
+			       exit_ || flushRequests_ != request;
+		});
+
+		sleeping_.store(false, std::memory_order_relaxed);
+	}
+}
+
 /**
  * \brief Message logger
  *
@@ -302,6 +839,7 @@ public:
 	void backtrace();
 
 	int logSetFile(const char *path, bool color);
+	int logSetBinaryFile(const char *path);
 	int logSetStream(std::ostream *stream, bool color);
 	int logSetTarget(LoggingTarget target);
 	void logSetLevel(const char *category, const char *level);
@@ -311,6 +849,7 @@ private:
 
 	void parseLogFile();
 	void parseLogLevels();
+	void parseLogAsync();
 	static LogSeverity parseLogLevel(const std::string &level);
 
 	friend LogCategory;
@@ -323,6 +862,7 @@ private:
 	std::list<std::pair<std::string, LogSeverity>> levels_;
 
 	std::shared_ptr<LogOutput> output_;
+	std::unique_ptr<LogAsyncWriter> asyncWriter_;
 };
 
 bool Logger::destroyed_ = false;
@@ -342,6 +882,9 @@ bool Logger::destroyed_ = false;
  * \var LoggingTargetStream
  * \brief Log to stream
  * \sa Logger::logSetStream
+ * \var LoggingTargetBinaryFile
+ * \brief Log to file in the binary log format
+ * \sa Logger::logSetBinaryFile
  */
 
 /**
@@ -367,6 +910,24 @@ int logSetFile(const char *path, bool color)
 	return Logger::instance()->logSetFile(path, color);
 }
 
+/**
+ * \brief Direct logging to a file in the binary log format
+ * \param[in] path Full path to the log file
+ *
+ * This function directs the log output to the file identified by \a path, like
+ * logSetFile(), but writes messages in the compact \ref log-binary
+ * "binary log format" instead of text. The utils/decode-log.py script converts
+ * the file to text.
+ *
+ * If the function returns an error, the log target is not changed.
+ *
+ * \return Zero on success, or a negative error code otherwise
+ */
+int logSetBinaryFile(const char *path)
+{
+	return Logger::instance()->logSetBinaryFile(path);
+}
+
 /**
  * \brief Direct logging to a stream
  * \param[in] stream Stream to send log output to
@@ -401,8 +962,9 @@ int logSetStream(std::ostream *stream, bool color)
  * log target, if any, is closed, and all new log messages will be written to
  * the new log destination.
  *
- * LoggingTargetFile and LoggingTargetStream are not valid values for \a target.
- * Use logSetFile() and logSetStream() instead, respectively.
+ * LoggingTargetFile, LoggingTargetStream and LoggingTargetBinaryFile are not
+ * valid values for \a target. Use logSetFile(), logSetStream() and
+ * logSetBinaryFile() instead, respectively.
  *
  * If the function returns an error, the log file is not changed.
  *
@@ -437,6 +999,9 @@ Logger::~Logger()
 {
 	destroyed_ = true;
 
+	/* Write all pending messages before the categories get deleted. */
+	asyncWriter_.reset();
+
 	for (LogCategory *category : categories_)
 		delete category;
 }
@@ -462,14 +1027,29 @@ Logger *Logger::instance()
 /**
  * \brief Write a message to the configured logger output
  * \param[in] msg The message object
+ *
+ * When asynchronous logging is enabled, the message is queued to the log
+ * writer thread, except for fatal messages that are written synchronously
+ * after flushing the queued messages.
  */
 void Logger::write(const LogMessage &msg)
 {
+	LogEntry entry{ msg.timestamp(), Thread::currentId(), msg.severity(),
+			&msg.category(), msg.fileInfo(), msg.prefix(), msg.msg() };
+
+	if (asyncWriter_) {
+		if (entry.severity != LogFatal &&
+		    asyncWriter_->write(std::move(entry)))
+			return;
+
+		asyncWriter_->flush();
+	}
+
 	std::shared_ptr<LogOutput> output = std::atomic_load(&output_);
 	if (!output)
 		return;
 
-	output->write(msg);
+	output->write(entry);
 }
 
 /**
@@ -507,7 +1087,26 @@ void Logger::backtrace()
 int Logger::logSetFile(const char *path, bool color)
 {
 	std::shared_ptr<LogOutput> output =
-		std::make_shared<LogOutput>(path, color);
+		std::make_shared<LogOutput>(path, LoggingTargetFile, color);
+	if (!output->isValid())
+		return -EINVAL;
+
+	std::atomic_store(&output_, output);
+	return 0;
+}
+
+/**
+ * \brief Set the binary log file
+ * \param[in] path Full path to the log file
+ *
+ * \sa libcamera::logSetBinaryFile()
+ *
+ * \return Zero on success, or a negative error code otherwise.
+ */
+int Logger::logSetBinaryFile(const char *path)
+{
+	std::shared_ptr<LogOutput> output =
+		std::make_shared<LogOutput>(path, LoggingTargetBinaryFile, false);
 	if (!output->isValid())
 		return -EINVAL;
 
@@ -591,6 +1190,7 @@ Logger::Logger()
 
 	parseLogFile();
 	parseLogLevels();
+	parseLogAsync();
 }
 
 /**
@@ -601,6 +1201,9 @@ Logger::Logger()
  * is set to "syslog", then the logger output will be directed to syslog. Errors
  * are silently ignored and don't affect the logger output (set to std::cerr by
  * default).
+ *
+ * The file is written in text format, unless the LIBCAMERA_LOG_FORMAT
+ * environment variable is set to "binary".
  */
 void Logger::parseLogFile()
 {
@@ -613,6 +1216,12 @@ void Logger::parseLogFile()
 		return;
 	}
 
+	const char *format = utils::secure_getenv("LIBCAMERA_LOG_FORMAT");
+	if (format && !strcmp(format, "binary")) {
+		logSetBinaryFile(file);
+		return;
+	}
+
 	logSetFile(file, false);
 }
 
@@ -665,6 +1274,21 @@ void Logger::parseLogLevels()
 	}
 }
 
+/**
+ * \brief Parse the asynchronous logging mode from the environment
+ *
+ * If the LIBCAMERA_LOG_ASYNC environment variable is set to a non-empty value,
+ * start the log writer thread and write messages asynchronously.
+ */
+void Logger::parseLogAsync()
+{
+	const char *async = utils::secure_getenv("LIBCAMERA_LOG_ASYNC");
+	if (!async || async[0] == '\0')
+		return;
+
+	asyncWriter_ = std::make_unique<LogAsyncWriter>(&output_);
+}
+
 /**
  * \brief Parse a log level string into a LogSeverity
  * \param[in] level The log level string
@@ -1077,10 +1701,18 @@ LogMessage _log(const LogCategory *category, LogSeverity severity,
  * \param[in] category Category (optional)
  * \param[in] severity Severity
  *
- * Return an std::ostream reference to which a message can be logged using the
- * iostream API. The \a category, if specified, sets the message category. When
- * absent the default category is used. The  \a severity controls whether the
- * message is printed or discarded, depending on the log level for the category.
+ * Expand to an expression to which a message can be logged using the iostream
+ * API. The \a category, if specified, sets the message category. When absent
+ * the default category is used. The  \a severity controls whether the message
+ * is printed or discarded, depending on the log level for the category.
+ *
+ * The log level is checked before creating the message. When the message is
+ * discarded, the operands of the stream operators are not evaluated, and
+ * expressions with side effects shall thus not be logged.
+ *
+ * Messages with a severity lower than the LIBCAMERA_LOG_MIN_SEVERITY macro are
+ * removed at compile time. The macro defaults to LogDebug, and is set by the
+ * log_level build option.
  *
  * If the severity is set to Fatal, execution is aborted and the program
  * terminates immediately after printing the message.
@@ -8,6 +8,7 @@
 #include <libcamera/base/message.h>
 
 #include <libcamera/base/log.h>
+#include <libcamera/base/message_pool.h>
 #include <libcamera/base/signal.h>
 
 /**
@@ -59,7 +60,7 @@ std::atomic_uint Message::nextUserType_{ Message::UserMessage };
  * \param[in] type The message type
  */
 Message::Message(Message::Type type)
-	: type_(type)
+	: type_(type), receiver_(nullptr), next_(nullptr)
 {
 }
 
@@ -79,6 +80,29 @@ Message::~Message()
  * \return The message receiver
  */
 
+/**
+ * \brief Allocate memory for a message
+ * \param[in] size The allocation size in bytes
+ *
+ * Messages are allocated from the MessagePool of the calling thread, to avoid
+ * allocating memory from the system for every message posted in steady state.
+ *
+ * \return A pointer to the allocated memory
+ */
+void *Message::operator new(std::size_t size)
+{
+	return MessagePool::allocate(size);
+}
+
+/**
+ * \brief Free memory allocated for a message
+ * \param[in] ptr The memory to free
+ */
+void Message::operator delete(void *ptr)
+{
+	MessagePool::deallocate(ptr);
+}
+
 /**
  * \brief Reserve and register a custom user-defined message type
  *
@@ -123,12 +147,16 @@ Message::Type Message::registerMessageType()
  * \param[in] semaphore The semaphore used to signal message delivery
  * \param[in] deleteMethod True to delete the \a method when the message is
  * destroyed
+ * \param[in] sharedPack True if the \a pack is shared between multiple bound
+ * methods (see BoundMethodBase::activateSharedPack())
  */
 InvokeMessage::InvokeMessage(BoundMethodBase *method,
 			     std::shared_ptr<BoundMethodPackBase> pack,
-			     Semaphore *semaphore, bool deleteMethod)
-	: Message(Message::InvokeMessage), method_(method), pack_(pack),
-	  semaphore_(semaphore), deleteMethod_(deleteMethod)
+			     Semaphore *semaphore, bool deleteMethod,
+			     bool sharedPack)
+	: Message(Message::InvokeMessage), method_(method), pack_(std::move(pack)),
+	  semaphore_(semaphore), deleteMethod_(deleteMethod),
+	  sharedPack_(sharedPack)
 {
 }
 
@@ -150,7 +178,10 @@ InvokeMessage::~InvokeMessage()
  */
 void InvokeMessage::invoke()
 {
-	method_->invokePack(pack_.get());
+	if (sharedPack_)
+		method_->invokeSharedPack(pack_.get());
+	else
+		method_->invokePack(pack_.get());
 }
 
 /**
@@ -0,0 +1,325 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * message_pool.cpp - Per-thread memory pool for messages
+ */
+
+#include <libcamera/base/message_pool.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+/**
+ * \file base/message_pool.h
+ * \brief Per-thread memory pool for messages
+ */
+
+namespace libcamera {
+
+namespace {
+
+constexpr std::array<size_t, 4> kBlockSizes = { 64, 128, 256, 512 };
+constexpr unsigned int kSystemBlock = kBlockSizes.size();
+
+class BlockCache;
+
+struct alignas(std::max_align_t) BlockHeader {
+	BlockCache *cache;
+	BlockHeader *next;
+	unsigned int sizeClass;
+};
+
+class BlockCache
+{
+public:
+	BlockCache()
+		: stats_{}, refs_(1), remote_(nullptr), free_{}
+	{
+	}
+
+	void *allocate(unsigned int sizeClass);
+	void deallocate(BlockHeader *block);
+	void deallocateRemote(BlockHeader *block);
+	void release();
+
+	MessagePool::Statistics stats_;
+
+private:
+	void reclaim();
+	void destroy();
+	void unref();
+
+	/* One reference per allocated block, plus one for the owner thread. */
+	std::atomic<unsigned int> refs_;
+	/* Blocks freed by other threads, pending reclaim by the owner. */
+	std::atomic<BlockHeader *> remote_;
+	/* Free blocks, per size class, only accessed by the owner thread. */
+	std::array<BlockHeader *, kBlockSizes.size()> free_;
+};
+
+/*
+ * The thread-local variables are trivially destructible, so they can be
+ * accessed safely from other thread-local destructors. The cache is released by
+ * the destructor of the releaser, which is instantiated with the cache.
+ */
+thread_local BlockCache *currentCache = nullptr;
+thread_local bool currentCacheReleased = false;
+
+struct BlockCacheReleaser {
+	~BlockCacheReleaser()
+	{
+		BlockCache *cache = currentCache;
+
+		currentCache = nullptr;
+		currentCacheReleased = true;
+
+		if (cache)
+			cache->release();
+	}
+};
+
+thread_local BlockCacheReleaser currentCacheReleaser;
+
+BlockCache *threadCache()
+{
+	if (!currentCache && !currentCacheReleased) {
+		/* Odr-use the releaser to ensure it gets constructed. */
+		[[maybe_unused]] BlockCacheReleaser *releaser = &currentCacheReleaser;
+		currentCache = new BlockCache();
+	}
+
+	return currentCache;
+}
+
+BlockHeader *allocateBlock(BlockCache *cache, unsigned int sizeClass, size_t size)
+{
+	BlockHeader *block =
+		static_cast<BlockHeader *>(::operator new(sizeof(BlockHeader) + size));
+	block->cache = cache;
+	block->next = nullptr;
+	block->sizeClass = sizeClass;
+
+	return block;
+}
+
+void *BlockCache::allocate(unsigned int sizeClass)
+{
+	BlockHeader *block = free_[sizeClass];
+	if (!block) {
+		reclaim();
+		block = free_[sizeClass];
+	}
+
+	if (block) {
+		free_[sizeClass] = block->next;
+	} else {
+		block = allocateBlock(this, sizeClass, kBlockSizes[sizeClass]);
+		stats_.systemAllocations++;
+	}
+
+	stats_.allocations++;
+	refs_.fetch_add(1, std::memory_order_relaxed);
+
+	return block + 1;
+}
+
+void BlockCache::deallocate(BlockHeader *block)
+{
+	block->next = free_[block->sizeClass];
+	free_[block->sizeClass] = block;
+
+	/* The owner holds a reference, this can't drop the last one. */
+	refs_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void BlockCache::deallocateRemote(BlockHeader *block)
+{
+	BlockHeader *head = remote_.load(std::memory_order_relaxed);
+
+	do {
+		block->next = head;
+	} while (!remote_.compare_exchange_weak(head, block,
+						std::memory_order_release,
+						std::memory_order_relaxed));
+
+	unref();
+}
+
+void BlockCache::release()
+{
+	for (BlockHeader *&head : free_) {
+		while (head) {
+			BlockHeader *block = head;
+			head = block->next;
+			::operator delete(block);
+		}
+	}
+
+	BlockHeader *block = remote_.exchange(nullptr, std::memory_order_acquire);
+	while (block) {
+		BlockHeader *next = block->next;
+		::operator delete(block);
+		block = next;
+	}
+
+	/*
+	 * Blocks still in use will be pushed to the remote list when freed,
+	 * the last one will destroy the cache.
+	 */
+	unref();
+}
+
+void BlockCache::reclaim()
+{
+	BlockHeader *block = remote_.exchange(nullptr, std::memory_order_acquire);
+
+	while (block) {
+		BlockHeader *next = block->next;
+		block->next = free_[block->sizeClass];
+		free_[block->sizeClass] = block;
+		block = next;
+	}
+}
+
+void BlockCache::unref()
+{
+	if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		destroy();
+}
+
+void BlockCache::destroy()
+{
+	BlockHeader *block = remote_.exchange(nullptr, std::memory_order_acquire);
+	while (block) {
+		BlockHeader *next = block->next;
+		::operator delete(block);
+		block = next;
+	}
+
+	delete this;
+}
+
+} /* namespace */
+
+/**
+ * \class MessagePool
+ * \brief Per-thread memory pool for small, short-lived objects
+ *
+ * Queued method invocations and signal emissions allocate an InvokeMessage
+ * and a pack of arguments for every call. The MessagePool recycles the memory
+ * of those objects to avoid hitting the system allocator in steady state.
+ *
+ * Every thread has its own pool, with free lists for a few block size
+ * classes. Allocations are served from the pool of the calling thread.
+ * Blocks freed by the thread that allocated them are returned to its free
+ * lists directly, blocks freed by other threads are returned to the
+ * allocating pool through a lock-free list and reclaimed when the free lists
+ * run empty. Allocations larger than the largest size class are forwarded to
+ * the system allocator.
+ *
+ * When a thread exits its pool is released. Memory still in use remains valid,
+ * and is returned to the system when freed.
+ */
+
+/**
+ * \struct MessagePool::Statistics
+ * \brief Allocation statistics for a thread
+ *
+ * \var MessagePool::Statistics::allocations
+ * \brief Number of blocks allocated from the pool of the thread
+ *
+ * \var MessagePool::Statistics::systemAllocations
+ * \brief Number of allocations that couldn't be served from the free lists
+ * and required allocating memory from the system
+ *
+ * \var MessagePool::Statistics::remoteFrees
+ * \brief Number of blocks freed by the thread to the pool of another thread
+ */
+
+/**
+ * \brief Allocate memory from the pool of the calling thread
+ * \param[in] size The allocation size in bytes
+ *
+ * The returned memory is suitably aligned for any object type whose alignment
+ * doesn't exceed alignof(std::max_align_t).
+ *
+ * \context This function is \threadsafe.
+ *
+ * \return A pointer to the allocated memory
+ */
+void *MessagePool::allocate(size_t size)
+{
+	unsigned int sizeClass = 0;
+	while (sizeClass < kBlockSizes.size() && size > kBlockSizes[sizeClass])
+		sizeClass++;
+
+	BlockCache *cache = threadCache();
+
+	if (sizeClass == kSystemBlock || !cache) {
+		if (cache) {
+			cache->stats_.allocations++;
+			cache->stats_.systemAllocations++;
+		}
+
+		return allocateBlock(nullptr, kSystemBlock, size) + 1;
+	}
+
+	return cache->allocate(sizeClass);
+}
+
+/**
+ * \brief Free memory allocated with allocate()
+ * \param[in] ptr The memory to free
+ *
+ * The memory may be freed from any thread.
+ *
+ * \context This function is \threadsafe.
+ */
+void MessagePool::deallocate(void *ptr)
+{
+	if (!ptr)
+		return;
+
+	BlockHeader *block = static_cast<BlockHeader *>(ptr) - 1;
+	BlockCache *owner = block->cache;
+
+	if (!owner) {
+		::operator delete(block);
+		return;
+	}
+
+	BlockCache *cache = currentCache;
+	if (owner == cache) {
+		owner->deallocate(block);
+		return;
+	}
+
+	if (cache)
+		cache->stats_.remoteFrees++;
+
+	owner->deallocateRemote(block);
+}
+
+/**
+ * \brief Retrieve the allocation statistics of the calling thread
+ *
+ * The statistics are accumulated from the first allocation performed by the
+ * calling thread. They can be
+ * compared between two points in time to verify that a code path doesn't
+ * allocate memory from the system.
+ *
+ * \return The allocation statistics of the calling thread
+ */
+MessagePool::Statistics MessagePool::statistics()
+{
+	BlockCache *cache = currentCache;
+	if (!cache)
+		return {};
+
+	return cache->stats_;
+}
+
+} /* namespace libcamera */
@@ -7,6 +7,11 @@
 
 #include <libcamera/base/semaphore.h>
 
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
 /**
  * \file base/semaphore.h
  * \brief General-purpose counting semaphore
@@ -14,6 +19,39 @@
 
 namespace libcamera {
 
+namespace {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) &&
+	      std::atomic<uint32_t>::is_always_lock_free,
+	      "Futexes require lock-free 32-bit atomics");
+
+void futexWait(std::atomic<uint32_t> *word, uint32_t expected)
+{
+	/*
+	 * EAGAIN (the value has changed) and EINTR are expected, the caller
+	 * rechecks the value in both cases.
+	 */
+	syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT_PRIVATE,
+		expected, nullptr, nullptr, 0);
+}
+
+void futexWakeAll(std::atomic<uint32_t> *word)
+{
+	syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE_PRIVATE,
+		INT_MAX, nullptr, nullptr, 0);
+}
+
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || (defined(__arm__) && __ARM_ARCH >= 7)
+	asm volatile("yield" ::: "memory");
+#endif
+}
+
+} /* namespace */
+
 /**
  * \class Semaphore
  * \brief General-purpose counting semaphore
@@ -24,6 +62,14 @@ namespace libcamera {
  * acquire a number of resources, and blocks if not enough resources are
  * available until they get released. The release() function releases a number
  * of resources, waking up any consumer blocked on an acquire() call.
+ *
+ * The semaphore is implemented with atomic operations on the resource count,
+ * and uses a futex to block and wake up consumers. Acquiring and releasing
+ * resources thus doesn't involve any system call when no consumer is blocked.
+ *
+ * When resources are expected to be released shortly, the cost of blocking
+ * and waking up consumers can be avoided by spinning for a short time before
+ * blocking, see setSpinCount().
  */
 
 /**
@@ -31,7 +77,7 @@ namespace libcamera {
  * \param[in] n The resource count
  */
 Semaphore::Semaphore(unsigned int n)
-	: available_(n)
+	: state_(n & kCountMask), spinCount_(0)
 {
 }
 
@@ -41,8 +87,7 @@ Semaphore::Semaphore(unsigned int n)
  */
 unsigned int Semaphore::available()
 {
-	MutexLocker locker(mutex_);
-	return available_;
+	return state_.load(std::memory_order_acquire) & kCountMask;
 }
 
 /**
@@ -55,11 +100,41 @@ unsigned int Semaphore::available()
  */
 void Semaphore::acquire(unsigned int n)
 {
-	MutexLocker locker(mutex_);
-	cv_.wait(locker, [&]() LIBCAMERA_TSA_REQUIRES(mutex_) {
-		return available_ >= n;
-	});
-	available_ -= n;
+	unsigned int spins = spinCount_.load(std::memory_order_relaxed);
+
+	for (unsigned int i = 0; i < spins; ++i) {
+		if (tryAcquire(n))
+			return;
+
+		cpuRelax();
+	}
+
+	uint32_t state = state_.load(std::memory_order_relaxed);
+
+	while (true) {
+		if ((state & kCountMask) >= n) {
+			if (state_.compare_exchange_weak(state, state - n,
+							 std::memory_order_acquire,
+							 std::memory_order_relaxed))
+				return;
+			continue;
+		}
+
+		/*
+		 * Flag the presence of waiters before blocking, for release()
+		 * to wake us up. The futex wait returns immediately if the
+		 * state has changed in the meantime.
+		 */
+		if (!(state & kWaiters)) {
+			if (!state_.compare_exchange_weak(state, state | kWaiters,
+							  std::memory_order_relaxed))
+				continue;
+			state |= kWaiters;
+		}
+
+		futexWait(&state_, state);
+		state = state_.load(std::memory_order_relaxed);
+	}
 }
 
 /**
@@ -75,11 +150,15 @@ void Semaphore::acquire(unsigned int n)
  */
 bool Semaphore::tryAcquire(unsigned int n)
 {
-	MutexLocker locker(mutex_);
-	if (available_ < n)
-		return false;
+	uint32_t state = state_.load(std::memory_order_relaxed);
+
+	do {
+		if ((state & kCountMask) < n)
+			return false;
+	} while (!state_.compare_exchange_weak(state, state - n,
+					       std::memory_order_acquire,
+					       std::memory_order_relaxed));
 
-	available_ -= n;
 	return true;
 }
 
@@ -93,12 +172,44 @@ bool Semaphore::tryAcquire(unsigned int n)
  */
 void Semaphore::release(unsigned int n)
 {
-	{
-		MutexLocker locker(mutex_);
-		available_ += n;
-	}
+	uint32_t state = state_.load(std::memory_order_relaxed);
 
-	cv_.notify_all();
+	/*
+	 * Update the count and clear the waiters flag in a single operation.
+	 * A consumer may destroy the semaphore as soon as it acquires the
+	 * resources, the semaphore must thus not be accessed afterwards. The
+	 * futex wake only uses the address and is safe.
+	 */
+	while (!state_.compare_exchange_weak(state, ((state & kCountMask) + n) & kCountMask,
+					     std::memory_order_release,
+					     std::memory_order_relaxed))
+		;
+
+	/*
+	 * Consumers may wait for different resource counts, wake them all and
+	 * let them check if enough resources are available. The ones that
+	 * still need to wait set the waiters flag again.
+	 */
+	if (state & kWaiters)
+		futexWakeAll(&state_);
+}
+
+/**
+ * \brief Set the number of spin iterations before blocking
+ * \param[in] count The number of spin iterations
+ *
+ * When a call to acquire() can't be satisfied immediately, the semaphore spins
+ * for up to \a count iterations, checking if resources have been released,
+ * before blocking. Spinning avoids the latency of blocking and waking up the
+ * consumer when the resources are released within a short time, but wastes
+ * CPU time otherwise. It should only be enabled for short waits on systems
+ * with multiple CPUs.
+ *
+ * The default spin count is 0, which blocks immediately.
+ */
+void Semaphore::setSpinCount(unsigned int count)
+{
+	spinCount_.store(count, std::memory_order_relaxed);
 }
 
 } /* namespace libcamera */
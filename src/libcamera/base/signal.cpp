@@ -63,10 +63,10 @@ void SignalBase::disconnect(std::function<bool(SlotList::iterator &)> match)
 	}
 }
 
-SignalBase::SlotList SignalBase::slots()
+std::vector<BoundMethodBase *> SignalBase::slots()
 {
 	MutexLocker locker(signalsLock);
-	return slots_;
+	return { slots_.begin(), slots_.end() };
 }
 
 /**
@@ -198,6 +198,12 @@ SignalBase::SlotList SignalBase::slots()
  * of the arguments (when passed by pointer or reference), the modification is
  * thus visible to all subsequently called slots.
  *
+ * For slots bound to an Object, the arguments are copied once per emission
+ * into a reference-counted pack shared by all those slots, unless some of the
+ * arguments are passed by non-const reference. Queued invocations thus don't
+ * copy the arguments for every receiver, and only carry a reference to the
+ * shared pack.
+ *
  * This function is not \threadsafe, but thread-safety is guaranteed against
  * concurrent connect() and disconnect() calls.
  */
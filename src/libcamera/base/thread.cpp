@@ -8,17 +8,25 @@
 #include <libcamera/base/thread.h>
 
 #include <atomic>
-#include <list>
+#include <map>
+#include <optional>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <vector>
 
 #include <libcamera/base/event_dispatcher.h>
+#include <libcamera/base/event_dispatcher_epoll.h>
 #include <libcamera/base/event_dispatcher_poll.h>
 #include <libcamera/base/log.h>
 #include <libcamera/base/message.h>
 #include <libcamera/base/mutex.h>
 #include <libcamera/base/object.h>
+#include <libcamera/base/utils.h>
 
 /**
  * \page thread Thread Support
@@ -115,23 +123,144 @@ class ThreadMain;
 
 /**
  * \brief A queue of posted messages
+ *
+ * Messages are posted to the queue from any thread by pushing them to a
+ * lock-free intrusive stack, the inbox, without taking any lock. The inbox is
+ * collected by the consumer into an ordered list of pending messages,
+ * protected by the queue mutex. As producers never take the mutex, it is
+ * only contended by removeMessages() and moveObject().
  */
 class MessageQueue
 {
 public:
+	~MessageQueue();
+
+	bool post(Message *msg);
+	bool collect();
+	void unlink(Message *prev, Message *msg);
+
 	/**
-	 * \brief List of queued Message instances
+	 * \brief Protects the list of pending messages
 	 */
-	std::list<std::unique_ptr<Message>> list_;
+	Mutex mutex_;
 	/**
-	 * \brief Protects the \ref list_
+	 * \brief Stack of posted messages not collected yet, in reverse order
 	 */
-	Mutex mutex_;
+	std::atomic<Message *> inbox_ = nullptr;
+	/**
+	 * \brief First message in the list of pending messages
+	 */
+	Message *head_ = nullptr;
 	/**
-	 * \brief The recursion level for recursive Thread::dispatchMessages()
-	 * calls
+	 * \brief Last message in the list of pending messages
 	 */
-	unsigned int recursion_ = 0;
+	Message *tail_ = nullptr;
+	/**
+	 * \brief Number of messages unlinked from the list of pending messages
+	 */
+	unsigned int unlinked_ = 0;
+};
+
+MessageQueue::~MessageQueue()
+{
+	MutexLocker locker(mutex_);
+
+	collect();
+
+	while (head_) {
+		Message *msg = head_;
+		head_ = msg->next_;
+		delete msg;
+	}
+}
+
+/**
+ * \brief Post a message to the inbox
+ * \param[in] msg The message
+ *
+ * This function may be called from any thread without locking.
+ *
+ * \return True if the inbox was empty, false otherwise
+ */
+bool MessageQueue::post(Message *msg)
+{
+	Message *head = inbox_.load(std::memory_order_relaxed);
+
+	do {
+		msg->next_ = head;
+	} while (!inbox_.compare_exchange_weak(head, msg,
+					       std::memory_order_release,
+					       std::memory_order_relaxed));
+
+	return !head;
+}
+
+/**
+ * \brief Move all messages from the inbox to the list of pending messages
+ * \return True if messages have been collected, false if the inbox was empty
+ */
+bool MessageQueue::collect()
+{
+	Message *msg = inbox_.exchange(nullptr, std::memory_order_acquire);
+	if (!msg)
+		return false;
+
+	/* Reverse the stack to restore the posting order. */
+	Message *last = msg;
+	Message *first = nullptr;
+
+	while (msg) {
+		Message *next = msg->next_;
+		msg->next_ = first;
+		first = msg;
+		msg = next;
+	}
+
+	if (tail_)
+		tail_->next_ = first;
+	else
+		head_ = first;
+	tail_ = last;
+
+	return true;
+}
+
+/**
+ * \brief Remove a message from the list of pending messages
+ * \param[in] prev The message preceding \a msg in the list, or nullptr
+ * \param[in] msg The message
+ */
+void MessageQueue::unlink(Message *prev, Message *msg)
+{
+	if (prev)
+		prev->next_ = msg->next_;
+	else
+		head_ = msg->next_;
+
+	if (tail_ == msg)
+		tail_ = prev;
+
+	msg->next_ = nullptr;
+	unlinked_++;
+}
+
+/**
+ * \brief Scheduling policy and priority of a thread
+ */
+struct SchedulingParameters {
+	int policy;
+	int priority;
+};
+
+/**
+ * \brief Thread parameters configured through the environment
+ */
+struct ThreadConfig {
+	std::string pattern;
+	std::optional<SchedulingParameters> scheduling;
+	std::optional<cpu_set_t> affinity;
+
+	bool matches(const std::string &name) const;
 };
 
 /**
@@ -151,12 +280,19 @@ private:
 	friend class Thread;
 	friend class ThreadMain;
 
+	int applyParameters() LIBCAMERA_TSA_REQUIRES(mutex_);
+
 	Thread *thread_;
+	std::string name_;
 	bool running_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
 	pid_t tid_;
 
 	Mutex mutex_;
 
+	std::optional<pthread_t> handle_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	std::optional<SchedulingParameters> scheduling_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	std::optional<cpu_set_t> affinity_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+
 	std::atomic<EventDispatcher *> dispatcher_;
 
 	ConditionVariable cv_;
@@ -203,9 +339,230 @@ ThreadData *ThreadData::current()
 	ThreadData *data = mainThread.data_;
 	data->tid_ = syscall(SYS_gettid);
 	currentThreadData = data;
+
+	MutexLocker locker(data->mutex_);
+	data->handle_ = pthread_self();
+
 	return data;
 }
 
+/**
+ * \brief Apply the scheduling parameters and CPU affinity to the thread
+ *
+ * The parameters are applied only if the underlying thread exists, otherwise
+ * they will be applied when the thread starts.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int ThreadData::applyParameters()
+{
+	if (!handle_)
+		return 0;
+
+	int ret = 0;
+
+	if (affinity_) {
+		int err = pthread_setaffinity_np(*handle_, sizeof(*affinity_),
+						 &*affinity_);
+		if (err) {
+			LOG(Thread, Warning)
+				<< "Failed to set CPU affinity of thread '"
+				<< name_ << "': " << strerror(err);
+			ret = -err;
+		}
+	}
+
+	if (scheduling_) {
+		struct sched_param param = {};
+		param.sched_priority = scheduling_->priority;
+
+		int err = pthread_setschedparam(*handle_, scheduling_->policy,
+						&param);
+		if (err) {
+			LOG(Thread, Warning)
+				<< "Failed to set scheduling policy of thread '"
+				<< name_ << "': " << strerror(err);
+			ret = -err;
+		}
+	}
+
+	return ret;
+}
+
+static bool validateSchedulingParameters(const SchedulingParameters &params)
+{
+	int min = sched_get_priority_min(params.policy);
+	int max = sched_get_priority_max(params.policy);
+	if (min < 0 || max < 0) {
+		LOG(Thread, Error)
+			<< "Invalid scheduling policy " << params.policy;
+		return false;
+	}
+
+	if (params.priority < min || params.priority > max) {
+		LOG(Thread, Error)
+			<< "Invalid priority " << params.priority
+			<< ", must be in the range [" << min << ", " << max << "]";
+		return false;
+	}
+
+	return true;
+}
+
+static int parseCpuList(const std::string &list, cpu_set_t *cpuset)
+{
+	CPU_ZERO(cpuset);
+
+	for (const std::string &range : utils::split(list, ",")) {
+		const char *str = range.c_str();
+		char *end;
+
+		unsigned long first = strtoul(str, &end, 10);
+		if (end == str)
+			return -EINVAL;
+
+		unsigned long last = first;
+		if (*end == '-') {
+			str = end + 1;
+			last = strtoul(str, &end, 10);
+			if (end == str)
+				return -EINVAL;
+		}
+
+		if (*end != '\0' || first > last || last >= CPU_SETSIZE)
+			return -EINVAL;
+
+		for (unsigned long cpu = first; cpu <= last; ++cpu)
+			CPU_SET(cpu, cpuset);
+	}
+
+	return 0;
+}
+
+static std::optional<ThreadConfig> parseThreadConfig(const std::string &entry)
+{
+	static const std::map<std::string, int> policies = {
+		{ "other", SCHED_OTHER },
+		{ "batch", SCHED_BATCH },
+		{ "idle", SCHED_IDLE },
+		{ "fifo", SCHED_FIFO },
+		{ "rr", SCHED_RR },
+	};
+
+	ThreadConfig config;
+	std::optional<int> policy;
+	std::optional<int> priority;
+	bool first = true;
+
+	for (const std::string &field : utils::split(entry, ":")) {
+		if (first) {
+			config.pattern = field;
+			first = false;
+			continue;
+		}
+
+		size_t pos = field.find('=');
+		if (pos == std::string::npos)
+			return std::nullopt;
+
+		const std::string key = field.substr(0, pos);
+		const std::string value = field.substr(pos + 1);
+
+		if (key == "cpus") {
+			cpu_set_t cpuset;
+			if (parseCpuList(value, &cpuset) < 0)
+				return std::nullopt;
+			config.affinity = cpuset;
+		} else if (key == "policy") {
+			auto iter = policies.find(value);
+			if (iter == policies.end())
+				return std::nullopt;
+			policy = iter->second;
+		} else if (key == "priority") {
+			char *end;
+			long prio = strtol(value.c_str(), &end, 10);
+			if (value.empty() || *end != '\0')
+				return std::nullopt;
+			priority = prio;
+		} else {
+			return std::nullopt;
+		}
+	}
+
+	if (config.pattern.empty())
+		return std::nullopt;
+
+	/* A priority is meaningless without a scheduling policy. */
+	if (priority && !policy)
+		return std::nullopt;
+
+	if (policy) {
+		SchedulingParameters params{ *policy, priority.value_or(0) };
+		if (!validateSchedulingParameters(params))
+			return std::nullopt;
+		config.scheduling = params;
+	}
+
+	return config;
+}
+
+/**
+ * \brief Retrieve the thread configuration from the environment
+ *
+ * The LIBCAMERA_THREAD_CONFIG environment variable is parsed on first use. It
+ * contains a semicolon-separated list of entries, each made of a thread name
+ * pattern followed by colon-separated key=value parameters.
+ *
+ * \return The list of valid thread configuration entries
+ */
+static const std::vector<ThreadConfig> &threadConfigs()
+{
+	static const std::vector<ThreadConfig> configs = []() {
+		std::vector<ThreadConfig> result;
+
+		const char *env = utils::secure_getenv("LIBCAMERA_THREAD_CONFIG");
+		if (!env)
+			return result;
+
+		for (const std::string &entry : utils::split(env, ";")) {
+			if (entry.empty())
+				continue;
+
+			std::optional<ThreadConfig> config = parseThreadConfig(entry);
+			if (!config) {
+				LOG(Thread, Warning)
+					<< "Invalid thread configuration '"
+					<< entry << "'";
+				continue;
+			}
+
+			result.push_back(std::move(*config));
+		}
+
+		return result;
+	}();
+
+	return configs;
+}
+
+/**
+ * \brief Check if the configuration entry applies to a thread
+ * \param[in] name The thread name
+ *
+ * The pattern matches the name exactly, or matches all names starting with
+ * the pattern prefix if the pattern ends with a '*' wildcard.
+ *
+ * \return True if the entry applies to the thread \a name, false otherwise
+ */
+bool ThreadConfig::matches(const std::string &name) const
+{
+	if (pattern.back() == '*')
+		return name.compare(0, pattern.size() - 1, pattern, 0,
+				    pattern.size() - 1) == 0;
+
+	return name == pattern;
+}
+
 /**
  * \class Thread
  * \brief A thread of execution
@@ -218,6 +575,15 @@ ThreadData *ThreadData::current()
  * sent to the objects living in the thread. This behaviour can be modified by
  * overriding the run() function.
  *
+ * \section thread-params Thread Parameters
+ *
+ * Threads can be given a name at construction time, and their scheduling
+ * policy and CPU affinity can be controlled with setSchedulingPolicy() and
+ * setThreadAffinity(). Users can additionally override the parameters of named
+ * threads through the LIBCAMERA_THREAD_CONFIG environment variable, to pin
+ * latency-sensitive threads (such as the camera manager or IPA threads) to
+ * dedicated CPUs or run them with a real-time policy.
+ *
  * \section thread-stop Stopping Threads
  *
  * Threads can't be forcibly stopped. Instead, a thread user first requests the
@@ -262,11 +628,19 @@ ThreadData *ThreadData::current()
 
 /**
  * \brief Create a thread
+ * \param[in] name The thread name
+ *
+ * The thread \a name is used to identify the thread in the system (as
+ * reported by tools such as top or ps) and to select the thread parameters
+ * configured through the LIBCAMERA_THREAD_CONFIG environment variable. The
+ * system limits thread names to 15 characters, longer names are truncated
+ * when applied to the underlying thread.
  */
-Thread::Thread()
+Thread::Thread(const std::string &name)
 {
 	data_ = new ThreadData;
 	data_->thread_ = this;
+	data_->name_ = name;
 }
 
 Thread::~Thread()
@@ -275,6 +649,90 @@ Thread::~Thread()
 	delete data_;
 }
 
+/**
+ * \brief Retrieve the thread name
+ * \return The thread name, or an empty string if the thread has no name
+ */
+const std::string &Thread::name() const
+{
+	return data_->name_;
+}
+
+/**
+ * \brief Set the scheduling policy and priority of the thread
+ * \param[in] policy The scheduling policy (SCHED_OTHER, SCHED_FIFO, ...)
+ * \param[in] priority The static scheduling priority
+ *
+ * This function sets the scheduling \a policy and \a priority of the thread,
+ * as defined by sched(7). The \a priority shall be within the range supported
+ * by the \a policy, which is [1, 99] for the SCHED_FIFO and SCHED_RR real-time
+ * policies and 0 for the other policies.
+ *
+ * If the thread is running the parameters are applied immediately, otherwise
+ * they are stored and applied when the thread starts. Parameters configured
+ * through the LIBCAMERA_THREAD_CONFIG environment variable take precedence
+ * over the ones set with this function before the thread starts.
+ *
+ * Selecting a real-time policy usually requires the CAP_SYS_NICE capability or
+ * an appropriate RLIMIT_RTPRIO limit. Failures to apply the parameters to a
+ * thread being started are logged but don't prevent the thread from running.
+ *
+ * \context This function is \threadsafe.
+ *
+ * \return 0 on success or a negative error code otherwise
+ * \retval -EINVAL The policy or priority is invalid
+ * \retval -EPERM The caller has no permission to set the parameters
+ */
+int Thread::setSchedulingPolicy(int policy, int priority)
+{
+	SchedulingParameters params{ policy, priority };
+	if (!validateSchedulingParameters(params))
+		return -EINVAL;
+
+	MutexLocker locker(data_->mutex_);
+	data_->scheduling_ = params;
+
+	return data_->applyParameters();
+}
+
+/**
+ * \brief Set the CPU affinity of the thread
+ * \param[in] cpus The list of CPUs the thread is allowed to run on
+ *
+ * This function restricts execution of the thread to the given \a cpus. As for
+ * setSchedulingPolicy(), the affinity is applied immediately if the thread is
+ * running, or when the thread starts otherwise.
+ *
+ * \context This function is \threadsafe.
+ *
+ * \return 0 on success or a negative error code otherwise
+ * \retval -EINVAL The list of CPUs is empty or contains an invalid CPU
+ */
+int Thread::setThreadAffinity(Span<const unsigned int> cpus)
+{
+	const unsigned int numCpus = std::thread::hardware_concurrency();
+
+	if (cpus.empty())
+		return -EINVAL;
+
+	cpu_set_t cpuset;
+	CPU_ZERO(&cpuset);
+
+	for (unsigned int cpu : cpus) {
+		if (cpu >= CPU_SETSIZE || (numCpus && cpu >= numCpus)) {
+			LOG(Thread, Error) << "Invalid CPU " << cpu;
+			return -EINVAL;
+		}
+
+		CPU_SET(cpu, &cpuset);
+	}
+
+	MutexLocker locker(data_->mutex_);
+	data_->affinity_ = cpuset;
+
+	return data_->applyParameters();
+}
+
 /**
  * \brief Start the thread
  */
@@ -317,6 +775,27 @@ void Thread::startThread()
 	data_->tid_ = syscall(SYS_gettid);
 	currentThreadData = data_;
 
+	if (!data_->name_.empty())
+		pthread_setname_np(pthread_self(),
+				   data_->name_.substr(0, 15).c_str());
+
+	{
+		MutexLocker locker(data_->mutex_);
+
+		for (const ThreadConfig &config : threadConfigs()) {
+			if (!config.matches(data_->name_))
+				continue;
+
+			if (config.scheduling)
+				data_->scheduling_ = config.scheduling;
+			if (config.affinity)
+				data_->affinity_ = config.affinity;
+		}
+
+		data_->handle_ = pthread_self();
+		data_->applyParameters();
+	}
+
 	run();
 }
 
@@ -379,6 +858,7 @@ void Thread::finishThread()
 
 	data_->mutex_.lock();
 	data_->running_ = false;
+	data_->handle_.reset();
 	data_->mutex_.unlock();
 
 	finished.emit();
@@ -495,12 +975,40 @@ pid_t Thread::currentId()
 	return data->tid_;
 }
 
+static EventDispatcher *createEventDispatcher()
+{
+#if LIBCAMERA_EVENT_DISPATCHER_EPOLL
+	bool epoll = true;
+#else
+	bool epoll = false;
+#endif
+
+	const char *type = utils::secure_getenv("LIBCAMERA_EVENT_DISPATCHER");
+	if (type && !strcmp(type, "epoll"))
+		epoll = true;
+	else if (type && !strcmp(type, "poll"))
+		epoll = false;
+	else if (type && type[0] != '\0')
+		LOG(Thread, Warning)
+			<< "Unknown event dispatcher '" << type << "'";
+
+	if (epoll)
+		return new EventDispatcherEpoll();
+
+	return new EventDispatcherPoll();
+}
+
 /**
  * \brief Retrieve the event dispatcher
  *
  * This function retrieves the internal event dispatcher for the thread. The
  * returned event dispatcher is valid until the thread is destroyed.
  *
+ * The event dispatcher is created on first use. Its backend defaults to the
+ * one selected at build time through the event_dispatcher option, and can be
+ * overridden by setting the LIBCAMERA_EVENT_DISPATCHER environment variable to
+ * "poll" or "epoll".
+ *
  * \context This function is \threadsafe.
  *
  * \return Pointer to the event dispatcher
@@ -508,7 +1016,7 @@ pid_t Thread::currentId()
 EventDispatcher *Thread::eventDispatcher()
 {
 	if (!data_->dispatcher_.load(std::memory_order_relaxed))
-		data_->dispatcher_.store(new EventDispatcherPoll(),
+		data_->dispatcher_.store(createEventDispatcher(),
 					 std::memory_order_release);
 
 	return data_->dispatcher_.load(std::memory_order_relaxed);
@@ -542,10 +1050,19 @@ void Thread::postMessage(std::unique_ptr<Message> msg, Object *receiver)
 
 	ASSERT(data_ == receiver->thread()->data_);
 
-	MutexLocker locker(data_->messages_.mutex_);
-	data_->messages_.list_.push_back(std::move(msg));
+	/*
+	 * Account for the message before publishing it, the consumer may
+	 * dispatch it as soon as it is posted.
+	 */
 	receiver->pendingMessages_++;
-	locker.unlock();
+
+	/*
+	 * Only wake up the thread when the inbox transitions from empty to
+	 * non-empty, the thread will collect all messages posted in the
+	 * meantime in one go.
+	 */
+	if (!data_->messages_.post(msg.release()))
+		return;
 
 	EventDispatcher *dispatcher =
 		data_->dispatcher_.load(std::memory_order_acquire);
@@ -563,31 +1080,44 @@ void Thread::removeMessages(Object *receiver)
 {
 	ASSERT(data_ == receiver->thread()->data_);
 
-	MutexLocker locker(data_->messages_.mutex_);
+	MessageQueue &queue = data_->messages_;
+
+	MutexLocker locker(queue.mutex_);
 	if (!receiver->pendingMessages_)
 		return;
 
-	std::vector<std::unique_ptr<Message>> toDelete;
-	for (std::unique_ptr<Message> &msg : data_->messages_.list_) {
-		if (!msg)
-			continue;
-		if (msg->receiver_ != receiver)
-			continue;
+	queue.collect();
 
-		/*
-		 * Move the message to the pending deletion list to delete it
-		 * after releasing the lock. The messages list element will
-		 * contain a null pointer, and will be removed when dispatching
-		 * messages.
-		 */
-		toDelete.push_back(std::move(msg));
-		receiver->pendingMessages_--;
+	/*
+	 * Move the messages to a pending deletion list to delete them after
+	 * releasing the lock.
+	 */
+	Message *toDelete = nullptr;
+	Message *prev = nullptr;
+
+	for (Message *msg = queue.head_; msg; ) {
+		Message *next = msg->next_;
+
+		if (msg->receiver_ == receiver) {
+			queue.unlink(prev, msg);
+			msg->next_ = toDelete;
+			toDelete = msg;
+			receiver->pendingMessages_--;
+		} else {
+			prev = msg;
+		}
+
+		msg = next;
 	}
 
 	ASSERT(!receiver->pendingMessages_);
 	locker.unlock();
 
-	toDelete.clear();
+	while (toDelete) {
+		Message *msg = toDelete;
+		toDelete = msg->next_;
+		delete msg;
+	}
 }
 
 /**
@@ -610,25 +1140,40 @@ void Thread::dispatchMessages(Message::Type type)
 {
 	ASSERT(data_ == ThreadData::current());
 
-	++data_->messages_.recursion_;
+	MessageQueue &queue = data_->messages_;
 
-	MutexLocker locker(data_->messages_.mutex_);
+	MutexLocker locker(queue.mutex_);
 
-	std::list<std::unique_ptr<Message>> &messages = data_->messages_.list_;
+	Message *prev = nullptr;
+	Message *msg = queue.head_;
 
-	for (std::unique_ptr<Message> &msg : messages) {
-		if (!msg)
+	while (true) {
+		/*
+		 * When reaching the end of the pending messages list, collect
+		 * the messages posted in the meantime and resume from there.
+		 */
+		if (!msg) {
+			if (!queue.collect())
+				break;
+
+			msg = prev ? prev->next_ : queue.head_;
 			continue;
+		}
 
-		if (type != Message::Type::None && msg->type() != type)
+		if (type != Message::Type::None && msg->type() != type) {
+			prev = msg;
+			msg = msg->next_;
 			continue;
+		}
 
 		/*
-		 * Move the message, setting the entry in the list to null. It
-		 * will cause recursive calls to ignore the entry, and the erase
-		 * loop at the end of the function to delete it from the list.
+		 * Unlink the message from the list before delivering it, to
+		 * cause recursive calls to ignore it.
 		 */
-		std::unique_ptr<Message> message = std::move(msg);
+		queue.unlink(prev, msg);
+		unsigned int unlinked = queue.unlinked_;
+
+		std::unique_ptr<Message> message(msg);
 
 		Object *receiver = message->receiver_;
 		ASSERT(data_ == receiver->thread()->data_);
@@ -638,20 +1183,16 @@ void Thread::dispatchMessages(Message::Type type)
 		receiver->message(message.get());
 		message.reset();
 		locker.lock();
-	}
 
-	/*
-	 * If the recursion level is 0, erase all null messages in the list. We
-	 * can't do so during recursion, as it would invalidate the iterator of
-	 * the outer calls.
-	 */
-	if (!--data_->messages_.recursion_) {
-		for (auto iter = messages.begin(); iter != messages.end(); ) {
-			if (!*iter)
-				iter = messages.erase(iter);
-			else
-				++iter;
-		}
+		/*
+		 * If messages have been unlinked by recursive calls or by
+		 * removeMessages(), prev may not be valid anymore. Restart from
+		 * the head of the list in that case.
+		 */
+		if (queue.unlinked_ != unlinked)
+			prev = nullptr;
+
+		msg = prev ? prev->next_ : queue.head_;
 	}
 }
 
@@ -664,6 +1205,10 @@ void Thread::moveObject(Object *object)
 	ThreadData *currentData = object->thread_->data_;
 	ThreadData *targetData = data_;
 
+	/*
+	 * Lock the target queue too, to prevent the target thread from
+	 * collecting the moved messages before the object's thread is updated.
+	 */
 	MutexLocker lockerFrom(currentData->messages_.mutex_, std::defer_lock);
 	MutexLocker lockerTo(targetData->messages_.mutex_, std::defer_lock);
 	std::lock(lockerFrom, lockerTo);
@@ -676,19 +1221,27 @@ void Thread::moveObject(Object *object, ThreadData *currentData,
 {
 	/* Move pending messages to the message queue of the new thread. */
 	if (object->pendingMessages_) {
-		unsigned int movedMessages = 0;
+		MessageQueue &queue = currentData->messages_;
+		bool wakeup = false;
 
-		for (std::unique_ptr<Message> &msg : currentData->messages_.list_) {
-			if (!msg)
-				continue;
-			if (msg->receiver_ != object)
-				continue;
+		queue.collect();
+
+		Message *prev = nullptr;
+
+		for (Message *msg = queue.head_; msg; ) {
+			Message *next = msg->next_;
+
+			if (msg->receiver_ == object) {
+				queue.unlink(prev, msg);
+				wakeup |= targetData->messages_.post(msg);
+			} else {
+				prev = msg;
+			}
 
-			targetData->messages_.list_.push_back(std::move(msg));
-			movedMessages++;
+			msg = next;
 		}
 
-		if (movedMessages) {
+		if (wakeup) {
 			EventDispatcher *dispatcher =
 				targetData->dispatcher_.load(std::memory_order_acquire);
 			if (dispatcher)
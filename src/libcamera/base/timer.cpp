@@ -53,7 +53,7 @@ LOG_DEFINE_CATEGORY(Timer)
  * \param[in] parent The parent Object
  */
 Timer::Timer(Object *parent)
-	: Object(parent), running_(false)
+	: Object(parent), running_(false), queueIndex_(kNotQueued)
 {
 }
 
@@ -88,15 +88,19 @@ void Timer::start(std::chrono::steady_clock::time_point deadline)
 	if (!assertThreadBound("Timer can't be started from another thread"))
 		return;
 
+	/*
+	 * Unregister the timer before updating the deadline, as event
+	 * dispatchers order running timers by deadline.
+	 */
+	if (isRunning())
+		unregisterTimer();
+
 	deadline_ = deadline;
 
 	LOG(Timer, Debug)
 		<< "Starting timer " << this << ": deadline "
 		<< utils::time_point_to_string(deadline_);
 
-	if (isRunning())
-		unregisterTimer();
-
 	registerTimer();
 }
 
@@ -0,0 +1,166 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * timer_queue.cpp - Deadline-ordered timer queue
+ */
+
+#include <libcamera/base/timer_queue.h>
+
+#include <utility>
+
+#include <libcamera/base/timer.h>
+
+/**
+ * \file base/timer_queue.h
+ * \brief Deadline-ordered timer queue
+ */
+
+namespace libcamera {
+
+/**
+ * \class TimerQueue
+ * \brief A priority queue of timers ordered by deadline
+ *
+ * The TimerQueue stores running timers for event dispatchers. It is
+ * implemented as a binary min-heap keyed on the timer deadline, with the heap
+ * position of each timer stored in the timer itself. Inserting and removing
+ * timers thus run in O(log n) time, and retrieving the timer with the earliest
+ * deadline runs in constant time.
+ *
+ * Timers with identical deadlines are ordered by insertion order.
+ *
+ * The deadline of a timer is sampled when the timer is pushed to the queue.
+ * Timers must be removed from the queue before their deadline is modified.
+ */
+
+/**
+ * \brief Construct an empty timer queue
+ */
+TimerQueue::TimerQueue()
+	: sequence_(0)
+{
+}
+
+/**
+ * \brief Add a \a timer to the queue
+ * \param[in] timer The timer
+ *
+ * The \a timer must not already be stored in a queue.
+ */
+void TimerQueue::push(Timer *timer)
+{
+	heap_.push_back({ timer->deadline(), sequence_++, timer });
+	timer->queueIndex_ = heap_.size() - 1;
+	siftUp(heap_.size() - 1);
+}
+
+/**
+ * \brief Remove a \a timer from the queue
+ * \param[in] timer The timer
+ *
+ * If the \a timer isn't stored in the queue this function performs no
+ * operation.
+ */
+void TimerQueue::remove(Timer *timer)
+{
+	size_t index = timer->queueIndex_;
+	if (index >= heap_.size() || heap_[index].timer != timer)
+		return;
+
+	erase(index);
+}
+
+/**
+ * \brief Remove the timer with the earliest deadline from the queue
+ *
+ * The queue must not be empty.
+ */
+void TimerQueue::pop()
+{
+	erase(0);
+}
+
+/**
+ * \fn TimerQueue::top()
+ * \brief Retrieve the timer with the earliest deadline
+ * \return The timer with the earliest deadline, or nullptr if the queue is
+ * empty
+ */
+
+/**
+ * \fn TimerQueue::empty()
+ * \brief Check if the queue is empty
+ * \return True if the queue contains no timer, false otherwise
+ */
+
+/**
+ * \fn TimerQueue::size()
+ * \brief Retrieve the number of timers in the queue
+ * \return The number of timers in the queue
+ */
+
+void TimerQueue::place(size_t index, const Entry &entry)
+{
+	heap_[index] = entry;
+	entry.timer->queueIndex_ = index;
+}
+
+void TimerQueue::siftUp(size_t index)
+{
+	Entry entry = heap_[index];
+
+	while (index > 0) {
+		size_t parent = (index - 1) / 2;
+		if (!(entry < heap_[parent]))
+			break;
+
+		place(index, heap_[parent]);
+		index = parent;
+	}
+
+	place(index, entry);
+}
+
+void TimerQueue::siftDown(size_t index)
+{
+	Entry entry = heap_[index];
+	size_t size = heap_.size();
+
+	while (true) {
+		size_t child = index * 2 + 1;
+		if (child >= size)
+			break;
+
+		if (child + 1 < size && heap_[child + 1] < heap_[child])
+			child++;
+
+		if (!(heap_[child] < entry))
+			break;
+
+		place(index, heap_[child]);
+		index = child;
+	}
+
+	place(index, entry);
+}
+
+void TimerQueue::erase(size_t index)
+{
+	heap_[index].timer->queueIndex_ = Timer::kNotQueued;
+
+	Entry last = heap_.back();
+	heap_.pop_back();
+
+	if (index == heap_.size())
+		return;
+
+	place(index, last);
+
+	if (index > 0 && heap_[index] < heap_[(index - 1) / 2])
+		siftUp(index);
+	else
+		siftDown(index);
+}
+
+} /* namespace libcamera */
@@ -8,9 +8,9 @@
 #include "libcamera/internal/bayer_format.h"
 
 #include <algorithm>
-#include <map>
+#include <array>
+#include <iterator>
 #include <sstream>
-#include <unordered_map>
 
 #include <linux/media-bus-format.h>
 
@@ -65,128 +65,120 @@ namespace libcamera {
 
 namespace {
 
-/* Define a slightly arbitrary ordering so that we can use a std::map. */
-struct BayerFormatComparator {
-	constexpr bool operator()(const BayerFormat &lhs, const BayerFormat &rhs) const
-	{
-		if (lhs.bitDepth < rhs.bitDepth)
-			return true;
-		else if (lhs.bitDepth > rhs.bitDepth)
-			return false;
-
-		if (lhs.order < rhs.order)
-			return true;
-		else if (lhs.order > rhs.order)
-			return false;
-
-		if (lhs.packing < rhs.packing)
-			return true;
-		else
-			return false;
-	}
-};
+/*
+ * The conversion tables are computed at compile time. The bayerFormats table is
+ * the single source for the BayerFormat, PixelFormat and V4L2PixelFormat
+ * conversions. BayerFormat lookups are direct indexed, and PixelFormat and
+ * V4L2PixelFormat lookups use a binary search in sorted indexes.
+ */
 
-struct Formats {
+struct BayerFormatEntry {
+	BayerFormat bayer;
 	PixelFormat pixelFormat;
-	V4L2PixelFormat v4l2Format;
+	uint32_t v4l2Format;
 };
 
-const std::map<BayerFormat, Formats, BayerFormatComparator> bayerToFormat{
+constexpr BayerFormatEntry bayerFormats[] = {
 	{ { BayerFormat::BGGR, 8, BayerFormat::Packing::None },
-		{ formats::SBGGR8, V4L2PixelFormat(V4L2_PIX_FMT_SBGGR8) } },
+	  formats::SBGGR8, V4L2_PIX_FMT_SBGGR8 },
 	{ { BayerFormat::GBRG, 8, BayerFormat::Packing::None },
-		{ formats::SGBRG8, V4L2PixelFormat(V4L2_PIX_FMT_SGBRG8) } },
+	  formats::SGBRG8, V4L2_PIX_FMT_SGBRG8 },
 	{ { BayerFormat::GRBG, 8, BayerFormat::Packing::None },
-		{ formats::SGRBG8, V4L2PixelFormat(V4L2_PIX_FMT_SGRBG8) } },
+	  formats::SGRBG8, V4L2_PIX_FMT_SGRBG8 },
 	{ { BayerFormat::RGGB, 8, BayerFormat::Packing::None },
-		{ formats::SRGGB8, V4L2PixelFormat(V4L2_PIX_FMT_SRGGB8) } },
+	  formats::SRGGB8, V4L2_PIX_FMT_SRGGB8 },
 	{ { BayerFormat::BGGR, 10, BayerFormat::Packing::None },
-		{ formats::SBGGR10, V4L2PixelFormat(V4L2_PIX_FMT_SBGGR10) } },
+	  formats::SBGGR10, V4L2_PIX_FMT_SBGGR10 },
 	{ { BayerFormat::GBRG, 10, BayerFormat::Packing::None },
-		{ formats::SGBRG10, V4L2PixelFormat(V4L2_PIX_FMT_SGBRG10) } },
+	  formats::SGBRG10, V4L2_PIX_FMT_SGBRG10 },
 	{ { BayerFormat::GRBG, 10, BayerFormat::Packing::None },
-		{ formats::SGRBG10, V4L2PixelFormat(V4L2_PIX_FMT_SGRBG10) } },
+	  formats::SGRBG10, V4L2_PIX_FMT_SGRBG10 },
 	{ { BayerFormat::RGGB, 10, BayerFormat::Packing::None },
-		{ formats::SRGGB10, V4L2PixelFormat(V4L2_PIX_FMT_SRGGB10) } },
+	  formats::SRGGB10, V4L2_PIX_FMT_SRGGB10 },
 	{ { BayerFormat::BGGR, 10, BayerFormat::Packing::CSI2 },
-		{ formats::SBGGR10_CSI2P, V4L2PixelFormat(V4L2_PIX_FMT_SBGGR10P) } },
+	  formats::SBGGR10_CSI2P, V4L2_PIX_FMT_SBGGR10P },
 	{ { BayerFormat::GBRG, 10, BayerFormat::Packing::CSI2 },
-		{ formats::SGBRG10_CSI2P, V4L2PixelFormat(V4L2_PIX_FMT_SGBRG10P) } },
+	  formats::SGBRG10_CSI2P, V4L2_PIX_FMT_SGBRG10P },
 	{ { BayerFormat::GRBG, 10, BayerFormat::Packing::CSI2 },
-		{ formats::SGRBG10_CSI2P, V4L2PixelFormat(V4L2_PIX_FMT_SGRBG10P) } },
+	  formats::SGRBG10_CSI2P, V4L2_PIX_FMT_SGRBG10P },
 	{ { BayerFormat::RGGB, 10, BayerFormat::Packing::CSI2 },
-		{ formats::SRGGB10_CSI2P, V4L2PixelFormat(V4L2_PIX_FMT_SRGGB10P) } },
+	  formats::SRGGB10_CSI2P, V4L2_PIX_FMT_SRGGB10P },
 	{ { BayerFormat::BGGR, 10, BayerFormat::Packing::IPU3 },
-		{ formats::SBGGR10_IPU3, V4L2PixelFormat(V4L2_PIX_FMT_IPU3_SBGGR10) } },
+	  formats::SBGGR10_IPU3, V4L2_PIX_FMT_IPU3_SBGGR10 },
 	{ { BayerFormat::GBRG, 10, BayerFormat::Packing::IPU3 },
-		{ formats::SGBRG10_IPU3, V4L2PixelFormat(V4L2_PIX_FMT_IPU3_SGBRG10) } },
+	  formats::SGBRG10_IPU3, V4L2_PIX_FMT_IPU3_SGBRG10 },
 	{ { BayerFormat::GRBG, 10, BayerFormat::Packing::IPU3 },
-		{ formats::SGRBG10_IPU3, V4L2PixelFormat(V4L2_PIX_FMT_IPU3_SGRBG10) } },
+	  formats::SGRBG10_IPU3, V4L2_PIX_FMT_IPU3_SGRBG10 },
 	{ { BayerFormat::RGGB, 10, BayerFormat::Packing::IPU3 },
-		{ formats::SRGGB10_IPU3, V4L2PixelFormat(V4L2_PIX_FMT_IPU3_SRGGB10) } },
+	  formats::SRGGB10_IPU3, V4L2_PIX_FMT_IPU3_SRGGB10 },
 	{ { BayerFormat::BGGR, 12, BayerFormat::Packing::None },
-		{ formats::SBGGR12, V4L2PixelFormat(V4L2_PIX_FMT_SBGGR12) } },
+	  formats::SBGGR12, V4L2_PIX_FMT_SBGGR12 },
 	{ { BayerFormat::GBRG, 12, BayerFormat::Packing::None },
-		{ formats::SGBRG12, V4L2PixelFormat(V4L2_PIX_FMT_SGBRG12) } },
+	  formats::SGBRG12, V4L2_PIX_FMT_SGBRG12 },
 	{ { BayerFormat::GRBG, 12, BayerFormat::Packing::None },
-		{ formats::SGRBG12, V4L2PixelFormat(V4L2_PIX_FMT_SGRBG12) } },
+	  formats::SGRBG12, V4L2_PIX_FMT_SGRBG12 },
 	{ { BayerFormat::RGGB, 12, BayerFormat::Packing::None },
-		{ formats::SRGGB12, V4L2PixelFormat(V4L2_PIX_FMT_SRGGB12) } },
+	  formats::SRGGB12, V4L2_PIX_FMT_SRGGB12 },
 	{ { BayerFormat::BGGR, 12, BayerFormat::Packing::CSI2 },
-		{ formats::SBGGR12_CSI2P, V4L2PixelFormat(V4L2_PIX_FMT_SBGGR12P) } },
+	  formats::SBGGR12_CSI2P, V4L2_PIX_FMT_SBGGR12P },
 	{ { BayerFormat::GBRG, 12, BayerFormat::Packing::CSI2 },
-		{ formats::SGBRG12_CSI2P, V4L2PixelFormat(V4L2_PIX_FMT_SGBRG12P) } },
+	  formats::SGBRG12_CSI2P, V4L2_PIX_FMT_SGBRG12P },
 	{ { BayerFormat::GRBG, 12, BayerFormat::Packing::CSI2 },
-		{ formats::SGRBG12_CSI2P, V4L2PixelFormat(V4L2_PIX_FMT_SGRBG12P) } },
+	  formats::SGRBG12_CSI2P, V4L2_PIX_FMT_SGRBG12P },
 	{ { BayerFormat::RGGB, 12, BayerFormat::Packing::CSI2 },
-		{ formats::SRGGB12_CSI2P, V4L2PixelFormat(V4L2_PIX_FMT_SRGGB12P) } },
+	  formats::SRGGB12_CSI2P, V4L2_PIX_FMT_SRGGB12P },
 	{ { BayerFormat::BGGR, 14, BayerFormat::Packing::None },
-		{ formats::SBGGR14, V4L2PixelFormat(V4L2_PIX_FMT_SBGGR14) } },
+	  formats::SBGGR14, V4L2_PIX_FMT_SBGGR14 },
 	{ { BayerFormat::GBRG, 14, BayerFormat::Packing::None },
-		{ formats::SGBRG14, V4L2PixelFormat(V4L2_PIX_FMT_SGBRG14) } },
+	  formats::SGBRG14, V4L2_PIX_FMT_SGBRG14 },
 	{ { BayerFormat::GRBG, 14, BayerFormat::Packing::None },
-		{ formats::SGRBG14, V4L2PixelFormat(V4L2_PIX_FMT_SGRBG14) } },
+	  formats::SGRBG14, V4L2_PIX_FMT_SGRBG14 },
 	{ { BayerFormat::RGGB, 14, BayerFormat::Packing::None },
-		{ formats::SRGGB14, V4L2PixelFormat(V4L2_PIX_FMT_SRGGB14) } },
+	  formats::SRGGB14, V4L2_PIX_FMT_SRGGB14 },
 	{ { BayerFormat::BGGR, 14, BayerFormat::Packing::CSI2 },
-		{ formats::SBGGR14_CSI2P, V4L2PixelFormat(V4L2_PIX_FMT_SBGGR14P) } },
+	  formats::SBGGR14_CSI2P, V4L2_PIX_FMT_SBGGR14P },
 	{ { BayerFormat::GBRG, 14, BayerFormat::Packing::CSI2 },
-		{ formats::SGBRG14_CSI2P, V4L2PixelFormat(V4L2_PIX_FMT_SGBRG14P) } },
+	  formats::SGBRG14_CSI2P, V4L2_PIX_FMT_SGBRG14P },
 	{ { BayerFormat::GRBG, 14, BayerFormat::Packing::CSI2 },
-		{ formats::SGRBG14_CSI2P, V4L2PixelFormat(V4L2_PIX_FMT_SGRBG14P) } },
+	  formats::SGRBG14_CSI2P, V4L2_PIX_FMT_SGRBG14P },
 	{ { BayerFormat::RGGB, 14, BayerFormat::Packing::CSI2 },
-		{ formats::SRGGB14_CSI2P, V4L2PixelFormat(V4L2_PIX_FMT_SRGGB14P) } },
+	  formats::SRGGB14_CSI2P, V4L2_PIX_FMT_SRGGB14P },
 	{ { BayerFormat::BGGR, 16, BayerFormat::Packing::None },
-		{ formats::SBGGR16, V4L2PixelFormat(V4L2_PIX_FMT_SBGGR16) } },
+	  formats::SBGGR16, V4L2_PIX_FMT_SBGGR16 },
 	{ { BayerFormat::GBRG, 16, BayerFormat::Packing::None },
-		{ formats::SGBRG16, V4L2PixelFormat(V4L2_PIX_FMT_SGBRG16) } },
+	  formats::SGBRG16, V4L2_PIX_FMT_SGBRG16 },
 	{ { BayerFormat::GRBG, 16, BayerFormat::Packing::None },
-		{ formats::SGRBG16, V4L2PixelFormat(V4L2_PIX_FMT_SGRBG16) } },
+	  formats::SGRBG16, V4L2_PIX_FMT_SGRBG16 },
 	{ { BayerFormat::RGGB, 16, BayerFormat::Packing::None },
-		{ formats::SRGGB16, V4L2PixelFormat(V4L2_PIX_FMT_SRGGB16) } },
+	  formats::SRGGB16, V4L2_PIX_FMT_SRGGB16 },
 	{ { BayerFormat::BGGR, 16, BayerFormat::Packing::PISP1 },
-		{ formats::BGGR16_PISP_COMP1, V4L2PixelFormat(V4L2_PIX_FMT_PISP_COMP1_BGGR) } },
+	  formats::BGGR16_PISP_COMP1, V4L2_PIX_FMT_PISP_COMP1_BGGR },
 	{ { BayerFormat::GBRG, 16, BayerFormat::Packing::PISP1 },
-		{ formats::GBRG16_PISP_COMP1, V4L2PixelFormat(V4L2_PIX_FMT_PISP_COMP1_GBRG) } },
+	  formats::GBRG16_PISP_COMP1, V4L2_PIX_FMT_PISP_COMP1_GBRG },
 	{ { BayerFormat::GRBG, 16, BayerFormat::Packing::PISP1 },
-		{ formats::GRBG16_PISP_COMP1, V4L2PixelFormat(V4L2_PIX_FMT_PISP_COMP1_GRBG) } },
+	  formats::GRBG16_PISP_COMP1, V4L2_PIX_FMT_PISP_COMP1_GRBG },
 	{ { BayerFormat::RGGB, 16, BayerFormat::Packing::PISP1 },
-		{ formats::RGGB16_PISP_COMP1, V4L2PixelFormat(V4L2_PIX_FMT_PISP_COMP1_RGGB) } },
+	  formats::RGGB16_PISP_COMP1, V4L2_PIX_FMT_PISP_COMP1_RGGB },
 	{ { BayerFormat::MONO, 8, BayerFormat::Packing::None },
-		{ formats::R8, V4L2PixelFormat(V4L2_PIX_FMT_GREY) } },
+	  formats::R8, V4L2_PIX_FMT_GREY },
 	{ { BayerFormat::MONO, 10, BayerFormat::Packing::None },
-		{ formats::R10, V4L2PixelFormat(V4L2_PIX_FMT_Y10) } },
+	  formats::R10, V4L2_PIX_FMT_Y10 },
 	{ { BayerFormat::MONO, 10, BayerFormat::Packing::CSI2 },
-		{ formats::R10_CSI2P, V4L2PixelFormat(V4L2_PIX_FMT_Y10P) } },
+	  formats::R10_CSI2P, V4L2_PIX_FMT_Y10P },
 	{ { BayerFormat::MONO, 12, BayerFormat::Packing::None },
-		{ formats::R12, V4L2PixelFormat(V4L2_PIX_FMT_Y12) } },
+	  formats::R12, V4L2_PIX_FMT_Y12 },
 	{ { BayerFormat::MONO, 16, BayerFormat::Packing::None },
-		{ formats::R16, V4L2PixelFormat(V4L2_PIX_FMT_Y16) } },
+	  formats::R16, V4L2_PIX_FMT_Y16 },
 	{ { BayerFormat::MONO, 16, BayerFormat::Packing::PISP1 },
-		{ formats::MONO_PISP_COMP1, V4L2PixelFormat(V4L2_PIX_FMT_PISP_COMP1_MONO) } },
+	  formats::MONO_PISP_COMP1, V4L2_PIX_FMT_PISP_COMP1_MONO },
+};
+
+struct MbusCodeEntry {
+	unsigned int mbusCode;
+	BayerFormat bayer;
 };
 
-const std::unordered_map<unsigned int, BayerFormat> mbusCodeToBayer{
+constexpr MbusCodeEntry mbusCodes[] = {
 	{ MEDIA_BUS_FMT_SBGGR8_1X8, { BayerFormat::BGGR, 8, BayerFormat::Packing::None } },
 	{ MEDIA_BUS_FMT_SGBRG8_1X8, { BayerFormat::GBRG, 8, BayerFormat::Packing::None } },
 	{ MEDIA_BUS_FMT_SGRBG8_1X8, { BayerFormat::GRBG, 8, BayerFormat::Packing::None } },
@@ -219,16 +211,190 @@ const std::unordered_map<unsigned int, BayerFormat> mbusCodeToBayer{
 	{ MEDIA_BUS_FMT_SGBRG16_1X16, { BayerFormat::GBRG, 16, BayerFormat::Packing::None } },
 	{ MEDIA_BUS_FMT_SGRBG16_1X16, { BayerFormat::GRBG, 16, BayerFormat::Packing::None } },
 	{ MEDIA_BUS_FMT_SRGGB16_1X16, { BayerFormat::RGGB, 16, BayerFormat::Packing::None } },
-	{ MEDIA_BUS_FMT_SBGGR16_1X16, { BayerFormat::BGGR, 16, BayerFormat::Packing::PISP1 } },
-	{ MEDIA_BUS_FMT_SGBRG16_1X16, { BayerFormat::GBRG, 16, BayerFormat::Packing::PISP1 } },
-	{ MEDIA_BUS_FMT_SGRBG16_1X16, { BayerFormat::GRBG, 16, BayerFormat::Packing::PISP1 } },
-	{ MEDIA_BUS_FMT_SRGGB16_1X16, { BayerFormat::RGGB, 16, BayerFormat::Packing::PISP1 } },
 	{ MEDIA_BUS_FMT_Y8_1X8, { BayerFormat::MONO, 8, BayerFormat::Packing::None } },
 	{ MEDIA_BUS_FMT_Y10_1X10, { BayerFormat::MONO, 10, BayerFormat::Packing::None } },
 	{ MEDIA_BUS_FMT_Y12_1X12, { BayerFormat::MONO, 12, BayerFormat::Packing::None } },
 	{ MEDIA_BUS_FMT_Y16_1X16, { BayerFormat::MONO, 16, BayerFormat::Packing::None } },
 };
 
+/* Sort an array at compile time, using an insertion sort. */
+template<typename T, size_t N, typename Compare>
+constexpr std::array<T, N> sortArray(const T (&entries)[N], Compare comp)
+{
+	std::array<T, N> array{};
+
+	for (size_t i = 0; i < N; ++i) {
+		size_t j = i;
+
+		for (; j > 0 && comp(entries[i], array[j - 1]); --j)
+			array[j] = array[j - 1];
+
+		array[j] = entries[i];
+	}
+
+	return array;
+}
+
+template<typename T, size_t N, typename Compare>
+constexpr bool isStrictlySorted(const std::array<T, N> &array, Compare comp)
+{
+	for (size_t i = 1; i < N; ++i) {
+		if (!comp(array[i - 1], array[i]))
+			return false;
+	}
+
+	return true;
+}
+
+constexpr unsigned int kNumOrders = BayerFormat::MONO + 1;
+constexpr unsigned int kNumBitDepths = 5;
+constexpr unsigned int kNumPackings = static_cast<unsigned int>(BayerFormat::Packing::PISP2) + 1;
+constexpr unsigned int kNumSlots = kNumOrders * kNumBitDepths * kNumPackings;
+constexpr uint8_t kInvalidIndex = 0xff;
+
+static_assert(std::size(bayerFormats) < kInvalidIndex);
+
+/*
+ * Compute the slot of a BayerFormat in the direct index, for bit depths
+ * between 8 and 16 bits in steps of 2 bits.
+ */
+constexpr unsigned int bayerFormatSlot(const BayerFormat &format)
+{
+	unsigned int packing = static_cast<unsigned int>(format.packing);
+
+	if (format.order >= kNumOrders || packing >= kNumPackings ||
+	    format.bitDepth < 8 || format.bitDepth > 16 || format.bitDepth % 2)
+		return kNumSlots;
+
+	unsigned int depth = (format.bitDepth - 8) / 2;
+
+	return (format.order * kNumBitDepths + depth) * kNumPackings + packing;
+}
+
+constexpr bool validateBayerFormats()
+{
+	std::array<bool, kNumSlots> used{};
+
+	for (const BayerFormatEntry &entry : bayerFormats) {
+		unsigned int slot = bayerFormatSlot(entry.bayer);
+		if (slot >= kNumSlots || used[slot])
+			return false;
+
+		used[slot] = true;
+	}
+
+	return true;
+}
+
+static_assert(validateBayerFormats(),
+	      "Bayer formats must be unique and have a supported bit depth");
+
+constexpr std::array<uint8_t, kNumSlots> buildBayerIndex()
+{
+	std::array<uint8_t, kNumSlots> index{};
+
+	for (uint8_t &entry : index)
+		entry = kInvalidIndex;
+
+	for (size_t i = 0; i < std::size(bayerFormats); ++i)
+		index[bayerFormatSlot(bayerFormats[i].bayer)] = i;
+
+	return index;
+}
+
+constexpr std::array<uint8_t, kNumSlots> bayerIndex = buildBayerIndex();
+
+struct FormatKey {
+	uint32_t fourcc;
+	uint64_t modifier;
+
+	constexpr bool operator<(const FormatKey &other) const
+	{
+		if (fourcc != other.fourcc)
+			return fourcc < other.fourcc;
+		return modifier < other.modifier;
+	}
+
+	constexpr bool operator==(const FormatKey &other) const
+	{
+		return fourcc == other.fourcc && modifier == other.modifier;
+	}
+};
+
+struct FormatIndexEntry {
+	FormatKey key;
+	uint8_t index;
+};
+
+using FormatIndex = std::array<FormatIndexEntry, std::size(bayerFormats)>;
+
+constexpr bool compareIndexEntries(const FormatIndexEntry &lhs,
+				   const FormatIndexEntry &rhs)
+{
+	return lhs.key < rhs.key;
+}
+
+template<typename KeyFunc>
+constexpr FormatIndex buildFormatIndex(KeyFunc key)
+{
+	FormatIndexEntry entries[std::size(bayerFormats)] = {};
+
+	for (size_t i = 0; i < std::size(bayerFormats); ++i)
+		entries[i] = { key(bayerFormats[i]), static_cast<uint8_t>(i) };
+
+	return sortArray(entries, compareIndexEntries);
+}
+
+constexpr FormatIndex pixelFormatIndex =
+	buildFormatIndex([](const BayerFormatEntry &entry) {
+		return FormatKey{ entry.pixelFormat.fourcc(),
+				  entry.pixelFormat.modifier() };
+	});
+
+constexpr FormatIndex v4l2FormatIndex =
+	buildFormatIndex([](const BayerFormatEntry &entry) {
+		return FormatKey{ entry.v4l2Format, 0 };
+	});
+
+static_assert(isStrictlySorted(pixelFormatIndex, compareIndexEntries),
+	      "Pixel formats must be unique");
+static_assert(isStrictlySorted(v4l2FormatIndex, compareIndexEntries),
+	      "V4L2 pixel formats must be unique");
+
+constexpr bool compareMbusCodes(const MbusCodeEntry &lhs, const MbusCodeEntry &rhs)
+{
+	return lhs.mbusCode < rhs.mbusCode;
+}
+
+constexpr std::array<MbusCodeEntry, std::size(mbusCodes)> mbusCodeIndex =
+	sortArray(mbusCodes, compareMbusCodes);
+
+static_assert(isStrictlySorted(mbusCodeIndex, compareMbusCodes),
+	      "Media bus codes must be unique");
+
+const BayerFormatEntry *findBayerFormat(const BayerFormat &format)
+{
+	unsigned int slot = bayerFormatSlot(format);
+	if (slot >= kNumSlots || bayerIndex[slot] == kInvalidIndex)
+		return nullptr;
+
+	return &bayerFormats[bayerIndex[slot]];
+}
+
+const BayerFormatEntry *findBayerFormat(const FormatIndex &index,
+					const FormatKey &key)
+{
+	auto it = std::lower_bound(index.begin(), index.end(), key,
+				   [](const FormatIndexEntry &entry,
+				      const FormatKey &k) {
+					   return entry.key < k;
+				   });
+	if (it == index.end() || !(it->key == key))
+		return nullptr;
+
+	return &bayerFormats[it->index];
+}
+
 } /* namespace */
 
 /**
@@ -252,13 +418,17 @@ const std::unordered_map<unsigned int, BayerFormat> mbusCodeToBayer{
  */
 const BayerFormat &BayerFormat::fromMbusCode(unsigned int mbusCode)
 {
-	static BayerFormat empty;
-
-	const auto it = mbusCodeToBayer.find(mbusCode);
-	if (it == mbusCodeToBayer.end())
+	static const BayerFormat empty;
+
+	auto it = std::lower_bound(mbusCodeIndex.begin(), mbusCodeIndex.end(),
+				   mbusCode,
+				   [](const MbusCodeEntry &entry, unsigned int code) {
+					   return entry.mbusCode < code;
+				   });
+	if (it == mbusCodeIndex.end() || it->mbusCode != mbusCode)
 		return empty;
-	else
-		return it->second;
+
+	return it->bayer;
 }
 
 /**
@@ -338,9 +508,9 @@ std::ostream &operator<<(std::ostream &out, const BayerFormat &f)
  */
 V4L2PixelFormat BayerFormat::toV4L2PixelFormat() const
 {
-	const auto it = bayerToFormat.find(*this);
-	if (it != bayerToFormat.end())
-		return it->second.v4l2Format;
+	const BayerFormatEntry *entry = findBayerFormat(*this);
+	if (entry)
+		return V4L2PixelFormat(entry->v4l2Format);
 
 	return V4L2PixelFormat();
 }
@@ -352,12 +522,10 @@ V4L2PixelFormat BayerFormat::toV4L2PixelFormat() const
  */
 BayerFormat BayerFormat::fromV4L2PixelFormat(V4L2PixelFormat v4l2Format)
 {
-	auto it = std::find_if(bayerToFormat.begin(), bayerToFormat.end(),
-			       [v4l2Format](const auto &i) {
-				       return i.second.v4l2Format == v4l2Format;
-			       });
-	if (it != bayerToFormat.end())
-		return it->first;
+	const BayerFormatEntry *entry =
+		findBayerFormat(v4l2FormatIndex, { v4l2Format.fourcc(), 0 });
+	if (entry)
+		return entry->bayer;
 
 	return BayerFormat();
 }
@@ -368,9 +536,9 @@ BayerFormat BayerFormat::fromV4L2PixelFormat(V4L2PixelFormat v4l2Format)
  */
 PixelFormat BayerFormat::toPixelFormat() const
 {
-	const auto it = bayerToFormat.find(*this);
-	if (it != bayerToFormat.end())
-		return it->second.pixelFormat;
+	const BayerFormatEntry *entry = findBayerFormat(*this);
+	if (entry)
+		return entry->pixelFormat;
 
 	return PixelFormat();
 }
@@ -381,12 +549,10 @@ PixelFormat BayerFormat::toPixelFormat() const
  */
 BayerFormat BayerFormat::fromPixelFormat(PixelFormat format)
 {
-	const auto it = std::find_if(bayerToFormat.begin(), bayerToFormat.end(),
-				     [format](const auto &i) {
-					     return i.second.pixelFormat == format;
-				     });
-	if (it != bayerToFormat.end())
-		return it->first;
+	const BayerFormatEntry *entry =
+		findBayerFormat(pixelFormatIndex, { format.fourcc(), format.modifier() });
+	if (entry)
+		return entry->bayer;
 
 	return BayerFormat();
 }
@@ -17,6 +17,7 @@
 #include <libcamera/color_space.h>
 #include <libcamera/framebuffer_allocator.h>
 #include <libcamera/request.h>
+#include <libcamera/request_pool.h>
 #include <libcamera/stream.h>
 
 #include "libcamera/internal/camera.h"
@@ -24,6 +25,7 @@
 #include "libcamera/internal/formats.h"
 #include "libcamera/internal/pipeline_handler.h"
 #include "libcamera/internal/request.h"
+#include "libcamera/internal/tracepoints.h"
 
 /**
  * \file libcamera/camera.h
@@ -291,7 +293,9 @@ bool SensorConfiguration::isValid() const
  * \brief Create an empty camera configuration
  */
 CameraConfiguration::CameraConfiguration()
-	: orientation(Orientation::Rotate0), config_({})
+	: orientation(Orientation::Rotate0),
+	  requestOrder(RequestOrder::Submission), maxQueuedRequests(0),
+	  internalBufferCount(0), config_({})
 {
 }
 
@@ -554,6 +558,72 @@ CameraConfiguration::Status CameraConfiguration::validateColorSpaces(ColorSpaceF
  * By default the orientation field is set to Orientation::Rotate0.
  */
 
+/**
+ * \enum CameraConfiguration::RequestOrder
+ * \brief Order in which completed requests are signalled to the application
+ * \var CameraConfiguration::RequestOrder::Submission
+ * Requests complete in the order they have been queued
+ * \var CameraConfiguration::RequestOrder::Completion
+ * Requests complete as soon as the pipeline handler has finished processing
+ * them, regardless of the order they have been queued
+ */
+
+/**
+ * \var CameraConfiguration::requestOrder
+ * \brief The order in which requests complete
+ *
+ * By default, the Camera::requestCompleted signal is emitted for requests in
+ * the order they have been queued. When a pipeline handler finishes processing
+ * requests out of order, for instance when streams have different processing
+ * latencies, a request that has completed is held until all the requests queued
+ * before it complete.
+ *
+ * Applications that don't depend on the completion order can set this field to
+ * RequestOrder::Completion to receive requests as soon as they complete. The
+ * Request::sequence() value can then be used to restore the submission order if
+ * needed.
+ *
+ * The validate() function doesn't modify this field. By default it is set to
+ * RequestOrder::Submission.
+ */
+
+/**
+ * \var CameraConfiguration::maxQueuedRequests
+ * \brief The maximum number of requests queued to the device
+ *
+ * Requests queued to the camera are passed to the device until this number of
+ * requests are in flight. Additional requests wait in the camera until a
+ * request completes. Applications optimizing for latency, such as preview,
+ * can lower the number of requests in flight to reduce the delay between
+ * queuing a request with new controls and capturing the frame they apply to.
+ * Applications optimizing for throughput, such as recording, can raise it to
+ * absorb scheduling jitter.
+ *
+ * A value of 0 selects the pipeline handler default. The value is capped by
+ * the pipeline handler when the camera is configured to the number of requests
+ * the device can handle, which may depend on the internalBufferCount.
+ *
+ * The validate() function doesn't modify this field. By default it is set to
+ * 0.
+ */
+
+/**
+ * \var CameraConfiguration::internalBufferCount
+ * \brief The number of buffers allocated internally by the pipeline handler
+ *
+ * Pipeline handlers allocate internal buffers, such as ISP parameters and
+ * statistics buffers, or raw frame buffers for memory-to-memory processing.
+ * This field selects how many of those buffers are allocated per internal
+ * stream, trading memory usage for the number of frames that can be processed
+ * concurrently.
+ *
+ * A value of 0 selects the pipeline handler default, which is tuned to the
+ * memory cost of the internal buffers. The validate() function caps the value
+ * to a pipeline-specific maximum. Support for this field is pipeline-specific,
+ * pipeline handlers that don't support it ignore it and allocate their default
+ * number of internal buffers. By default it is set to 0.
+ */
+
 /**
  * \var CameraConfiguration::config_
  * \brief The vector of stream configurations
@@ -576,7 +646,10 @@ CameraConfiguration::Status CameraConfiguration::validateColorSpaces(ColorSpaceF
  * \param[in] pipe The pipeline handler responsible for the camera device
  */
 Camera::Private::Private(PipelineHandler *pipe)
-	: requestSequence_(0), pipe_(pipe->shared_from_this()),
+	: requestSequence_(0),
+	  requestOrder_(CameraConfiguration::RequestOrder::Submission),
+	  framesDropped_(0), maxQueuedRequests_(pipe->maxQueuedRequestsDevice()),
+	  pipe_(pipe->shared_from_this()),
 	  disconnected_(false), state_(CameraAvailable)
 {
 }
@@ -601,10 +674,11 @@ Camera::Private::~Private()
 
 /**
  * \var Camera::Private::queuedRequests_
- * \brief The list of queued and not yet completed requests
+ * \brief The queue of queued and not yet completed requests
  *
- * This list tracks requests queued in order to ensure completion of all
- * requests when the pipeline handler is stopped.
+ * This queue tracks requests queued in order to ensure completion of all
+ * requests when the pipeline handler is stopped, and to complete requests in
+ * submission order.
  *
  * \sa PipelineHandler::queueRequest(), PipelineHandler::stop(),
  * PipelineHandler::completeRequest()
@@ -642,6 +716,120 @@ Camera::Private::~Private()
  * over a single capture session.
  */
 
+/**
+ * \var Camera::Private::requestOrder_
+ * \brief The order in which requests complete
+ *
+ * The request order is set from the CameraConfiguration::requestOrder field
+ * when the camera is configured.
+ */
+
+/**
+ * \var Camera::Private::maxQueuedRequests_
+ * \brief The maximum number of requests queued to the device
+ *
+ * The value is set from the CameraConfiguration::maxQueuedRequests field
+ * before calling PipelineHandler::configure(), capped to
+ * PipelineHandler::maxQueuedRequestsDevice(). Pipeline handlers may lower it
+ * further in their configure() implementation, for instance to the number of
+ * internal buffers they have allocated.
+ */
+
+/**
+ * \brief Check if a request can be queued to the camera
+ * \param[in] request The request
+ * \param[in] from The name of the calling function, for logging purpose
+ *
+ * This function performs the state and request checks documented in
+ * Camera::queueRequest().
+ *
+ * \return 0 if the request can be queued, or a negative error code otherwise
+ */
+int Camera::Private::validateRequest(Request *request, const char *from) const
+{
+	int ret = isAccessAllowed(CameraRunning, false, from);
+	if (ret < 0)
+		return ret;
+
+	/* Requests can only be queued to the camera that created them. */
+	if (request->_d()->camera() != _o<Camera>()) {
+		LOG(Camera, Error) << "Request was not created by this camera";
+		return -EXDEV;
+	}
+
+	if (request->status() != Request::RequestPending) {
+		LOG(Camera, Error) << request->toString() << " is not valid";
+		return -EINVAL;
+	}
+
+	/*
+	 * The camera state may change until the end of the function. No locking
+	 * is however needed as PipelineHandler::queueRequest() will handle
+	 * this.
+	 */
+
+	if (request->buffers().empty()) {
+		LOG(Camera, Error) << "Request contains no buffers";
+		return -EINVAL;
+	}
+
+	for (auto const &it : request->buffers()) {
+		const Stream *stream = it.first;
+
+		if (activeStreams_.find(stream) == activeStreams_.end()) {
+			LOG(Camera, Error) << "Invalid request";
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * \var Camera::Private::nextFrame_
+ * \brief The sequence number of the frame the next request queued to the
+ * device will be applied to
+ *
+ * Pipeline handlers that support frame-accurate request scheduling shall set
+ * this member to the sequence number of the first frame when starting the
+ * camera, and report the start of each frame with
+ * PipelineHandler::frameStarted(). The value is incremented automatically for
+ * every request queued to the device, and reset to std::nullopt when the camera
+ * is stopped.
+ *
+ * When the value is std::nullopt, request target frames are ignored.
+ *
+ * \sa Request::setTargetSequence()
+ */
+
+/**
+ * \var Camera::Private::framesDropped_
+ * \brief The number of frames dropped since the last completed request
+ *
+ * The value is updated by PipelineHandler::framesDropped(), and reported in
+ * the metadata of the next completed request.
+ */
+
+/**
+ * \var Camera::Private::startTime_
+ * \brief The time at which the camera was started
+ *
+ * The value is set by Camera::start(), and reset by the pipeline handler when
+ * the first request completes successfully, to measure the first frame
+ * latency. It is std::nullopt once the first frame has been captured, or when
+ * the camera isn't running.
+ */
+
+/**
+ * \var Camera::Private::frameTiming_
+ * \brief The frame timing model of the camera
+ *
+ * The model is updated by the pipeline handler with the SensorTimestamp and
+ * FrameDuration metadata of each completed request, and reset when the camera
+ * is stopped. Pipeline handlers can use it to predict when the next frames
+ * will start.
+ */
+
 static const char *const camera_state_names[] = {
 	"Available",
 	"Acquired",
@@ -655,6 +843,10 @@ bool Camera::Private::isAcquired() const
 	return state_.load(std::memory_order_acquire) != CameraAvailable;
 }
 
+/**
+ * \brief Check if the camera is running
+ * \return True if the camera is in the Running state, false otherwise
+ */
 bool Camera::Private::isRunning() const
 {
 	return state_.load(std::memory_order_acquire) == CameraRunning;
@@ -880,6 +1072,32 @@ const std::string &Camera::id() const
  * completed
  */
 
+/**
+ * \var Camera::metadataAvailable
+ * \brief Signal emitted when metadata for a request queued to the camera is
+ * available
+ *
+ * Pipeline handlers produce metadata for a request progressively. Metadata
+ * that is known as soon as a frame has been captured, such as the sensor
+ * timestamp and the exposure time applied to the sensor, is typically
+ * available a frame earlier than the metadata computed by the IPA from the
+ * frame statistics.
+ *
+ * This signal is emitted every time a new subset of the request metadata
+ * becomes available, with the ControlList containing that subset only. The
+ * metadata is also merged into the Request::metadata() list, which contains
+ * the complete metadata when the requestCompleted signal is emitted.
+ *
+ * Combined with the bufferCompleted signal, this allows latency-sensitive
+ * applications to start processing buffers before the request completes.
+ * Applications that don't need early access to metadata can ignore this signal
+ * and wait for requestCompleted.
+ *
+ * Pipeline handlers are not required to emit this signal. A control reported
+ * early may be reported again later with a more accurate value, in which case
+ * the latest value is stored in the request metadata.
+ */
+
 /**
  * \var Camera::requestCompleted
  * \brief Signal emitted when a request queued to the camera has completed
@@ -930,12 +1148,13 @@ void Camera::disconnect()
 	disconnected.emit();
 }
 
-int Camera::exportFrameBuffers(Stream *stream,
-			       std::vector<std::unique_ptr<FrameBuffer>> *buffers)
+int Camera::canAllocateFrameBuffers(Stream *stream, bool allowRunning) const
 {
-	Private *const d = _d();
+	const Private *const d = _d();
 
-	int ret = d->isAccessAllowed(Private::CameraConfigured);
+	int ret = allowRunning
+		? d->isAccessAllowed(Private::CameraConfigured, Private::CameraRunning)
+		: d->isAccessAllowed(Private::CameraConfigured);
 	if (ret < 0)
 		return ret;
 
@@ -945,6 +1164,18 @@ int Camera::exportFrameBuffers(Stream *stream,
 	if (d->activeStreams_.find(stream) == d->activeStreams_.end())
 		return -EINVAL;
 
+	return 0;
+}
+
+int Camera::exportFrameBuffers(Stream *stream,
+			       std::vector<std::unique_ptr<FrameBuffer>> *buffers)
+{
+	Private *const d = _d();
+
+	int ret = canAllocateFrameBuffers(stream);
+	if (ret < 0)
+		return ret;
+
 	return d->pipe_->invokeMethod(&PipelineHandler::exportFrameBuffers,
 				      ConnectionTypeBlocking, this, stream,
 				      buffers);
@@ -1182,6 +1413,16 @@ int Camera::configure(CameraConfiguration *config)
 
 	LOG(Camera, Info) << msg.str();
 
+	d->maxQueuedRequests_ = d->pipe_->maxQueuedRequestsDevice();
+	if (config->maxQueuedRequests) {
+		if (config->maxQueuedRequests > d->maxQueuedRequests_)
+			LOG(Camera, Warning)
+				<< "Limiting queued requests to "
+				<< d->maxQueuedRequests_;
+		else
+			d->maxQueuedRequests_ = config->maxQueuedRequests;
+	}
+
 	ret = d->pipe_->invokeMethod(&PipelineHandler::configure,
 				     ConnectionTypeBlocking, this, config);
 	if (ret)
@@ -1201,6 +1442,8 @@ int Camera::configure(CameraConfiguration *config)
 		d->activeStreams_.insert(stream);
 	}
 
+	d->requestOrder_ = config->requestOrder;
+
 	d->setState(Private::CameraConfigured);
 
 	return 0;
@@ -1244,6 +1487,64 @@ std::unique_ptr<Request> Camera::createRequest(uint64_t cookie)
 	return request;
 }
 
+/**
+ * \brief Create a pool of requests bound to capture buffers
+ * \param[in] buffers The buffers for each stream
+ *
+ * This function creates a RequestPool with one request per buffer in the
+ * \a buffers vectors. The i-th request of the pool contains the i-th buffer of
+ * each stream, and its cookie is set to i. All streams must have the same
+ * number of buffers.
+ *
+ * The requests are created and populated once, and are recycled through
+ * RequestPool::acquire() and RequestPool::release() without allocating memory.
+ *
+ * \context This function is \threadsafe. It may only be called when the camera
+ * is in the Configured or Running state as defined in \ref camera_operation.
+ *
+ * \return The request pool, or nullptr on error
+ */
+std::unique_ptr<RequestPool>
+Camera::createRequestPool(const std::map<const Stream *, std::vector<FrameBuffer *>> &buffers)
+{
+	if (buffers.empty()) {
+		LOG(Camera, Error) << "No buffers for the request pool";
+		return nullptr;
+	}
+
+	size_t count = buffers.begin()->second.size();
+	for (const auto &[stream, streamBuffers] : buffers) {
+		if (streamBuffers.size() != count || !count) {
+			LOG(Camera, Error)
+				<< "Streams must have the same non-zero number of buffers";
+			return nullptr;
+		}
+	}
+
+	std::vector<std::unique_ptr<Request>> requests;
+	requests.reserve(count);
+
+	for (size_t i = 0; i < count; ++i) {
+		std::unique_ptr<Request> request = createRequest(i);
+		if (!request)
+			return nullptr;
+
+		for (const auto &[stream, streamBuffers] : buffers) {
+			int ret = request->addBuffer(stream, streamBuffers[i]);
+			if (ret < 0) {
+				LOG(Camera, Error)
+					<< "Failed to add buffer " << i
+					<< " to the request pool";
+				return nullptr;
+			}
+		}
+
+		requests.push_back(std::move(request));
+	}
+
+	return std::unique_ptr<RequestPool>(new RequestPool(std::move(requests)));
+}
+
 /**
  * \brief Queue a request to the camera
  * \param[in] request The request to queue to the camera
@@ -1271,41 +1572,10 @@ int Camera::queueRequest(Request *request)
 {
 	Private *const d = _d();
 
-	int ret = d->isAccessAllowed(Private::CameraRunning);
+	int ret = d->validateRequest(request);
 	if (ret < 0)
 		return ret;
 
-	/* Requests can only be queued to the camera that created them. */
-	if (request->_d()->camera() != this) {
-		LOG(Camera, Error) << "Request was not created by this camera";
-		return -EXDEV;
-	}
-
-	if (request->status() != Request::RequestPending) {
-		LOG(Camera, Error) << request->toString() << " is not valid";
-		return -EINVAL;
-	}
-
-	/*
-	 * The camera state may change until the end of the function. No locking
-	 * is however needed as PipelineHandler::queueRequest() will handle
-	 * this.
-	 */
-
-	if (request->buffers().empty()) {
-		LOG(Camera, Error) << "Request contains no buffers";
-		return -EINVAL;
-	}
-
-	for (auto const &it : request->buffers()) {
-		const Stream *stream = it.first;
-
-		if (d->activeStreams_.find(stream) == d->activeStreams_.end()) {
-			LOG(Camera, Error) << "Invalid request";
-			return -EINVAL;
-		}
-	}
-
 	d->pipe_->invokeMethod(&PipelineHandler::queueRequest,
 			       ConnectionTypeQueued, request);
 
@@ -1342,10 +1612,14 @@ int Camera::start(const ControlList *controls)
 
 	ASSERT(d->requestSequence_ == 0);
 
+	d->startTime_ = utils::clock::now();
+
 	ret = d->pipe_->invokeMethod(&PipelineHandler::start,
 				     ConnectionTypeBlocking, this, controls);
-	if (ret)
+	if (ret) {
+		d->startTime_.reset();
 		return ret;
+	}
 
 	d->setState(Private::CameraRunning);
 
@@ -1384,6 +1658,8 @@ int Camera::stop()
 
 	LOG(Camera, Debug) << "Stopping capture";
 
+	LIBCAMERA_TRACEPOINT(camera_stop_begin, id().c_str());
+
 	d->setState(Private::CameraStopping);
 
 	d->pipe_->invokeMethod(&PipelineHandler::stop, ConnectionTypeBlocking,
@@ -1393,6 +1669,8 @@ int Camera::stop()
 
 	d->setState(Private::CameraConfigured);
 
+	LIBCAMERA_TRACEPOINT(camera_stop_end, id().c_str());
+
 	return 0;
 }
 
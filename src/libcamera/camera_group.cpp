@@ -0,0 +1,253 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * camera_group.cpp - Synchronized capture from multiple cameras
+ */
+
+#include <libcamera/camera_group.h>
+
+#include <algorithm>
+#include <errno.h>
+
+#include <libcamera/base/log.h>
+
+#include <libcamera/camera.h>
+#include <libcamera/control_ids.h>
+#include <libcamera/request.h>
+
+#include "libcamera/internal/camera.h"
+#include "libcamera/internal/pipeline_handler.h"
+#include "libcamera/internal/request.h"
+
+/**
+ * \file camera_group.h
+ * \brief Synchronized capture from multiple cameras
+ */
+
+namespace libcamera {
+
+LOG_DECLARE_CATEGORY(Camera)
+
+/**
+ * \class CameraGroup
+ * \brief Coordinate capture from multiple cameras handled by the same pipeline
+ *
+ * Applications such as stereo or depth estimation capture frames from multiple
+ * sensors that must be started together, and need to process the frames
+ * captured at the same time together. The CameraGroup groups cameras handled
+ * by the same pipeline handler, and coordinates starting and stopping them and
+ * queuing requests to them.
+ *
+ * Camera groups are created by CameraManager::createGroup(). The cameras must
+ * be acquired and configured individually before starting the group with
+ * start(). Requests are then queued to all cameras at once with
+ * queueRequests(), which passes them to the pipeline handler in a single
+ * operation. No request for another camera queued concurrently can be
+ * interleaved with them, and they are processed by the pipeline handler in the
+ * same iteration of its event loop.
+ *
+ * When all the requests queued in one queueRequests() call have completed, the
+ * requestsCompleted signal is emitted. The timestampSkew() function reports
+ * how well the frames captured by the requests are aligned in time, to let
+ * applications detect frames that were not captured together, for instance
+ * when a sensor drops a frame.
+ *
+ * Hardware synchronization of the sensors, when supported by the platform, is
+ * the responsibility of the pipeline handler.
+ */
+
+CameraGroup::CameraGroup(const std::vector<std::shared_ptr<Camera>> &cameras)
+	: cameras_(cameras)
+{
+	for (const std::shared_ptr<Camera> &camera : cameras_)
+		camera->requestCompleted.connect(this, &CameraGroup::requestComplete);
+}
+
+/**
+ * \brief Destroy the camera group
+ *
+ * The group must be stopped before being destroyed. The cameras are not
+ * released.
+ */
+CameraGroup::~CameraGroup()
+{
+	for (const std::shared_ptr<Camera> &camera : cameras_)
+		camera->requestCompleted.disconnect(this);
+}
+
+/**
+ * \fn CameraGroup::cameras()
+ * \brief Retrieve the cameras in the group
+ * \return The cameras in the group, in the order they were passed to
+ * CameraManager::createGroup()
+ */
+
+/**
+ * \brief Start capture from all cameras in the group
+ * \param[in] controls Controls to be applied before starting the cameras
+ *
+ * The cameras are started one after the other in the group order, with the
+ * same \a controls. If any camera fails to start, the cameras already started
+ * are stopped.
+ *
+ * \context This function may only be called when all cameras are in the
+ * Configured state as defined in \ref camera_operation.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int CameraGroup::start(const ControlList *controls)
+{
+	for (auto it = cameras_.begin(); it != cameras_.end(); ++it) {
+		int ret = (*it)->start(controls);
+		if (ret < 0) {
+			LOG(Camera, Error)
+				<< "Failed to start camera " << (*it)->id();
+
+			while (it != cameras_.begin())
+				(*--it)->stop();
+
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Stop capture from all cameras in the group
+ *
+ * The cameras are stopped in the reverse group order. All pending requests
+ * are cancelled, and the requestsCompleted signal is emitted for them before
+ * this function returns.
+ *
+ * \return 0 on success or the first error returned by Camera::stop()
+ */
+int CameraGroup::stop()
+{
+	int ret = 0;
+
+	for (auto it = cameras_.rbegin(); it != cameras_.rend(); ++it) {
+		int err = (*it)->stop();
+		if (err < 0 && !ret)
+			ret = err;
+	}
+
+	std::lock_guard<std::mutex> locker(mutex_);
+	batches_.clear();
+
+	return ret;
+}
+
+/**
+ * \brief Queue requests to all cameras in the group
+ * \param[in] requests The requests, one per camera in the group order
+ *
+ * Each request must have been created by the camera at the same index in the
+ * group, and satisfy the requirements of Camera::queueRequest(). All requests
+ * are validated before any of them is queued, so either all requests are
+ * queued or none is.
+ *
+ * Applications shall handle completion of the requests through the
+ * requestsCompleted signal, and must not reuse an individual request when the
+ * Camera::requestCompleted signal is emitted for it.
+ *
+ * \return 0 on success or a negative error code otherwise
+ * \retval -EINVAL The number of requests doesn't match the group size, or a
+ * request is invalid
+ * \retval -EXDEV A request wasn't created by the corresponding camera
+ */
+int CameraGroup::queueRequests(Span<Request *const> requests)
+{
+	if (requests.size() != cameras_.size()) {
+		LOG(Camera, Error)
+			<< "Expected " << cameras_.size() << " requests, got "
+			<< requests.size();
+		return -EINVAL;
+	}
+
+	for (unsigned int i = 0; i < cameras_.size(); ++i) {
+		int ret = cameras_[i]->_d()->validateRequest(requests[i]);
+		if (ret < 0)
+			return ret;
+	}
+
+	std::vector<Request *> batch(requests.begin(), requests.end());
+
+	{
+		std::lock_guard<std::mutex> locker(mutex_);
+		batches_.push_back({ batch, static_cast<unsigned int>(batch.size()) });
+	}
+
+	PipelineHandler *pipe = cameras_.front()->_d()->pipe();
+	pipe->invokeMethod(&PipelineHandler::queueRequests,
+			   ConnectionTypeQueued, batch);
+
+	return 0;
+}
+
+/**
+ * \brief Compute the time skew between the frames captured by requests
+ * \param[in] requests The completed requests
+ *
+ * The skew is the difference between the latest and earliest
+ * controls::SensorTimestamp reported in the metadata of the \a requests. As
+ * all cameras report timestamps against the same clock, it measures how well
+ * the frames are aligned in time.
+ *
+ * \return The skew in nanoseconds, or -ENODATA if a request doesn't report a
+ * sensor timestamp
+ */
+int64_t CameraGroup::timestampSkew(Span<Request *const> requests)
+{
+	int64_t min = INT64_MAX;
+	int64_t max = INT64_MIN;
+
+	for (Request *request : requests) {
+		const auto timestamp = request->metadata().get(controls::SensorTimestamp);
+		if (!timestamp)
+			return -ENODATA;
+
+		min = std::min(min, *timestamp);
+		max = std::max(max, *timestamp);
+	}
+
+	return requests.empty() ? 0 : max - min;
+}
+
+void CameraGroup::requestComplete(Request *request)
+{
+	std::vector<Request *> requests;
+
+	{
+		std::lock_guard<std::mutex> locker(mutex_);
+
+		auto it = std::find_if(batches_.begin(), batches_.end(),
+				       [request](const Batch &batch) {
+					       return std::find(batch.requests.begin(),
+								batch.requests.end(),
+								request) != batch.requests.end();
+				       });
+		if (it == batches_.end())
+			return;
+
+		if (--it->pending)
+			return;
+
+		requests = std::move(it->requests);
+		batches_.erase(it);
+	}
+
+	requestsCompleted.emit(requests);
+}
+
+/**
+ * \var CameraGroup::requestsCompleted
+ * \brief Signal emitted when all requests queued together have completed
+ *
+ * The signal is emitted with the requests passed to queueRequests(), in the
+ * group order, once all of them have completed. As the requests complete in
+ * the pipeline handler thread, the signal is emitted in that thread.
+ */
+
+} /* namespace libcamera */
@@ -134,6 +134,17 @@ int CameraLens::validateLensDriver()
  * \return The lens model name
  */
 
+/**
+ * \fn CameraLens::device()
+ * \brief Retrieve the lens V4L2 subdevice
+ *
+ * The subdevice is exposed to let pipeline handlers schedule lens movements
+ * synchronously with the sensor frame timing, for instance through
+ * DelayedControls.
+ *
+ * \return The V4L2 subdevice for the lens
+ */
+
 std::string CameraLens::logPrefix() const
 {
 	return "'" + entity_->name() + "'";
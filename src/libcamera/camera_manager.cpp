@@ -7,15 +7,22 @@
 
 #include "libcamera/internal/camera_manager.h"
 
+#include <algorithm>
+#include <string.h>
+
 #include <libcamera/base/log.h>
 #include <libcamera/base/utils.h>
 
 #include <libcamera/camera.h>
+#include <libcamera/camera_group.h>
 #include <libcamera/property_ids.h>
 
 #include "libcamera/internal/camera.h"
 #include "libcamera/internal/device_enumerator.h"
+#include "libcamera/internal/media_device.h"
+#include "libcamera/internal/metrics.h"
 #include "libcamera/internal/pipeline_handler.h"
+#include "libcamera/internal/tracepoints.h"
 
 /**
  * \file libcamera/camera_manager.h
@@ -35,8 +42,10 @@ namespace libcamera {
 LOG_DEFINE_CATEGORY(Camera)
 
 CameraManager::Private::Private()
-	: initialized_(false)
+	: Thread("CameraManager"), initialized_(false), matched_(false)
 {
+	const char *threads = utils::secure_getenv("LIBCAMERA_PIPELINE_THREADS");
+	threadedPipelines_ = threads && strcmp(threads, "0");
 }
 
 int CameraManager::Private::start()
@@ -109,7 +118,34 @@ void CameraManager::Private::createPipelineHandlers()
 	const std::vector<PipelineHandlerFactoryBase *> &factories =
 		PipelineHandlerFactoryBase::factories();
 
+	/*
+	 * Only match pipeline handlers while media devices added since the
+	 * last run remain unclaimed. Devices that were present during the
+	 * previous runs have already been tried against all pipeline handlers,
+	 * and a pipeline handler that needs them along with a new device will
+	 * claim the new device as well.
+	 */
+	stopPipelineThreads(false);
+
+	std::vector<std::shared_ptr<MediaDevice>> added = enumerator_->takeAddedDevices();
+	auto unclaimed = [&added]() {
+		return std::any_of(added.begin(), added.end(),
+				   [](const std::shared_ptr<MediaDevice> &media) {
+					   return !media->busy();
+				   });
+	};
+
 	for (const PipelineHandlerFactoryBase *factory : factories) {
+		/*
+		 * Try all pipeline handlers during the first run, as some of
+		 * them, such as the virtual pipeline handler, create cameras
+		 * without any media device.
+		 */
+		if (matched_ && !unclaimed()) {
+			LOG(Camera, Debug) << "All new media devices claimed";
+			break;
+		}
+
 		LOG(Camera, Debug)
 			<< "Found registered pipeline handler '"
 			<< factory->name() << "'";
@@ -119,14 +155,78 @@ void CameraManager::Private::createPipelineHandlers()
 		 */
 		while (1) {
 			std::shared_ptr<PipelineHandler> pipe = factory->create(o);
-			if (!pipe->match(enumerator_.get()))
+			std::unique_ptr<Thread> thread;
+
+			/*
+			 * When running pipeline handlers in their own thread,
+			 * move the handler to the thread before matching, so
+			 * that the devices, event notifiers and timers it
+			 * creates are bound to that thread. The camera manager
+			 * thread blocks until the match completes, which keeps
+			 * the device enumerator accesses serialized.
+			 */
+			if (threadedPipelines_) {
+				thread = std::make_unique<Thread>("Pipeline-" + factory->name());
+				thread->start();
+				pipe->moveToThread(thread.get());
+			}
+
+			LIBCAMERA_TRACEPOINT(pipeline_match_begin, factory->name().c_str());
+			bool matched = thread
+				     ? pipe->invokeMethod(&PipelineHandler::match,
+							  ConnectionTypeBlocking,
+							  enumerator_.get())
+				     : pipe->match(enumerator_.get());
+			LIBCAMERA_TRACEPOINT(pipeline_match_end, factory->name().c_str(), matched);
+			if (!matched) {
+				/*
+				 * Stop the thread before destroying the pipeline
+				 * handler, and destroy the handler before the
+				 * thread it is bound to.
+				 */
+				if (thread) {
+					thread->exit();
+					thread->wait();
+				}
+
+				pipe.reset();
 				break;
+			}
+
+			if (thread)
+				pipelineThreads_.push_back({ std::move(thread), pipe });
 
 			LOG(Camera, Debug)
 				<< "Pipeline handler \"" << factory->name()
 				<< "\" matched";
 		}
 	}
+
+	matched_ = true;
+
+	/* Cameras have been created, spare IPA proxy workers are now idle. */
+	ipaManager_.releaseSpareWorkers();
+}
+
+/*
+ * Stop the threads of pipeline handlers. Threads of all pipeline handlers are
+ * stopped if \a all is true, otherwise only the threads of pipeline handlers
+ * that have been destroyed, typically after all their cameras have been
+ * unplugged, are stopped. Deferred deletions pending in the threads are
+ * processed before they stop.
+ */
+void CameraManager::Private::stopPipelineThreads(bool all)
+{
+	for (auto it = pipelineThreads_.begin(); it != pipelineThreads_.end();) {
+		if (!all && !it->pipe.expired()) {
+			++it;
+			continue;
+		}
+
+		it->thread->exit();
+		it->thread->wait();
+		it = pipelineThreads_.erase(it);
+	}
 }
 
 void CameraManager::Private::cleanup()
@@ -147,6 +247,12 @@ void CameraManager::Private::cleanup()
 
 	dispatchMessages(Message::Type::DeferredDelete);
 
+	/*
+	 * Cameras created by pipeline handlers running in their own thread
+	 * are deleted from that thread, stop the threads only now.
+	 */
+	stopPipelineThreads(true);
+
 	enumerator_.reset(nullptr);
 }
 
@@ -161,11 +267,13 @@ void CameraManager::Private::cleanup()
  * Device numbers from the SystemDevices property are used by the V4L2
  * compatibility layer to map V4L2 device nodes to Camera instances.
  *
- * \context This function shall be called from the CameraManager thread.
+ * \context This function shall be called from the thread of the pipeline
+ * handler, which is the CameraManager thread unless pipeline handlers run in
+ * their own thread.
  */
 void CameraManager::Private::addCamera(std::shared_ptr<Camera> camera)
 {
-	ASSERT(Thread::current() == this);
+	ASSERT(Thread::current() == this || threadedPipelines_);
 
 	MutexLocker locker(mutex_);
 
@@ -195,11 +303,13 @@ void CameraManager::Private::addCamera(std::shared_ptr<Camera> camera)
  * camera manager. Unregistered cameras won't be reported anymore by the
  * cameras() and get() calls, but references may still exist in applications.
  *
- * \context This function shall be called from the CameraManager thread.
+ * \context This function shall be called from the thread of the pipeline
+ * handler, which is the CameraManager thread unless pipeline handlers run in
+ * their own thread.
  */
 void CameraManager::Private::removeCamera(std::shared_ptr<Camera> camera)
 {
-	ASSERT(Thread::current() == this);
+	ASSERT(Thread::current() == this || threadedPipelines_);
 
 	MutexLocker locker(mutex_);
 
@@ -238,6 +348,12 @@ void CameraManager::Private::removeCamera(std::shared_ptr<Camera> camera)
  * will enumerate all the cameras present in the system, which can then be
  * listed with list() and retrieved with get().
  *
+ * Pipeline handlers run in the CameraManager thread by default. When the
+ * LIBCAMERA_PIPELINE_THREADS environment variable is set, each pipeline handler
+ * instance runs in a thread of its own instead, with its own event loop, so
+ * that events from different cameras are processed in parallel and a slow
+ * pipeline handler doesn't delay the others.
+ *
  * Cameras are shared through std::shared_ptr<>, ensuring that a camera will
  * stay valid until the last reference is released without requiring any special
  * action from the application. Once the application has released all the
@@ -353,6 +469,72 @@ std::shared_ptr<Camera> CameraManager::get(const std::string &id)
 	return nullptr;
 }
 
+/**
+ * \brief Create a group of cameras for synchronized capture
+ * \param[in] cameras The cameras to group
+ *
+ * All \a cameras must be handled by the same pipeline handler, as requests are
+ * queued to them in a single operation. A camera can't be part of the same
+ * group multiple times. The group references the cameras, but doesn't acquire
+ * them.
+ *
+ * \context This function is \threadsafe.
+ *
+ * \return The camera group, or nullptr if the cameras can't be grouped
+ */
+std::unique_ptr<CameraGroup>
+CameraManager::createGroup(const std::vector<std::shared_ptr<Camera>> &cameras)
+{
+	if (cameras.empty()) {
+		LOG(Camera, Error) << "Can't create an empty camera group";
+		return nullptr;
+	}
+
+	PipelineHandler *pipe = cameras.front()->_d()->pipe();
+
+	for (auto it = cameras.begin(); it != cameras.end(); ++it) {
+		const std::shared_ptr<Camera> &camera = *it;
+
+		if (camera->_d()->pipe() != pipe) {
+			LOG(Camera, Error)
+				<< "Camera " << camera->id()
+				<< " isn't handled by the same pipeline handler";
+			return nullptr;
+		}
+
+		if (std::find(cameras.begin(), it, camera) != it) {
+			LOG(Camera, Error)
+				<< "Camera " << camera->id()
+				<< " is present multiple times";
+			return nullptr;
+		}
+	}
+
+	return std::unique_ptr<CameraGroup>(new CameraGroup(cameras));
+}
+
+/**
+ * \brief Retrieve a snapshot of the libcamera performance metrics
+ *
+ * libcamera maintains performance metrics, such as the number of requests
+ * processed or the latency of buffer dequeuing, that are cheap enough to be
+ * always enabled. This function returns their current value, for applications
+ * to export performance telemetry. The metrics are global to the process, they
+ * are not reset when the camera manager is stopped or when cameras are
+ * reconfigured.
+ *
+ * The names and meaning of the metrics are not part of the libcamera API, and
+ * may change between libcamera versions.
+ *
+ * \context This function is \threadsafe.
+ *
+ * \return The value of all performance metrics
+ */
+MetricsSnapshot CameraManager::metrics() const
+{
+	return metrics::snapshot();
+}
+
 /**
  * \var CameraManager::cameraAdded
  * \brief Notify of a new camera added to the system
@@ -363,9 +545,10 @@ std::shared_ptr<Camera> CameraManager::get(const std::string &id)
  * connected to the system. When the signal is emitted the new camera is already
  * available from the list of cameras().
  *
- * The signal is emitted from the CameraManager thread. Applications shall
- * minimize the time spent in the signal handler and shall in particular not
- * perform any blocking operation.
+ * The signal is emitted from the CameraManager thread, or from the thread of the
+ * pipeline handler when pipeline handlers run in their own thread. Applications
+ * shall minimize the time spent in the signal handler and shall in particular
+ * not perform any blocking operation.
  */
 
 /**
@@ -376,9 +559,10 @@ std::shared_ptr<Camera> CameraManager::get(const std::string &id)
  * signal is emitted the camera is not available from the list of cameras()
  * anymore.
  *
- * The signal is emitted from the CameraManager thread. Applications shall
- * minimize the time spent in the signal handler and shall in particular not
- * perform any blocking operation.
+ * The signal is emitted from the CameraManager thread, or from the thread of the
+ * pipeline handler when pipeline handlers run in their own thread. Applications
+ * shall minimize the time spent in the signal handler and shall in particular
+ * not perform any blocking operation.
  */
 
 /**
@@ -143,6 +143,26 @@ int CameraSensor::init()
 	auto last = std::unique(sizes_.begin(), sizes_.end());
 	sizes_.erase(last, sizes_.end());
 
+	/*
+	 * Precompute the table of sensor modes, sorted by media bus code and
+	 * size, to speed up format selection at configuration time.
+	 */
+	for (const auto &[code, ranges] : formats_) {
+		unsigned int bitDepth = BayerFormat::fromMbusCode(code).bitDepth;
+
+		for (const SizeRange &range : ranges)
+			modes_.push_back({ code, range.max, bitDepth,
+					   static_cast<double>(range.max.width) /
+					   range.max.height });
+	}
+
+	std::sort(modes_.begin(), modes_.end(),
+		  [](const Mode &a, const Mode &b) {
+			  if (a.mbusCode != b.mbusCode)
+				  return a.mbusCode < b.mbusCode;
+			  return a.size < b.size;
+		  });
+
 	/*
 	 * VIMC is a bit special, as it does not yet support all the mandatory
 	 * requirements regular sensors have to respect.
@@ -601,17 +621,63 @@ std::vector<Size> CameraSensor::sizes(unsigned int mbusCode) const
 {
 	std::vector<Size> sizes;
 
-	const auto &format = formats_.find(mbusCode);
-	if (format == formats_.end())
-		return sizes;
+	for (const Mode &mode : modes(mbusCode))
+		sizes.push_back(mode.size);
 
-	const std::vector<SizeRange> &ranges = format->second;
-	std::transform(ranges.begin(), ranges.end(), std::back_inserter(sizes),
-		       [](const SizeRange &range) { return range.max; });
+	return sizes;
+}
 
-	std::sort(sizes.begin(), sizes.end());
+/**
+ * \struct CameraSensor::Mode
+ * \brief A sensor mode, made of a media bus code and a frame size
+ *
+ * The mode table is computed when the sensor is initialized, and caches the
+ * properties pipeline handlers need to select the sensor output format, to
+ * avoid recomputing them every time a configuration is validated.
+ *
+ * \var CameraSensor::Mode::mbusCode
+ * \brief The media bus code
+ *
+ * \var CameraSensor::Mode::size
+ * \brief The frame size
+ *
+ * \var CameraSensor::Mode::bitDepth
+ * \brief The bit depth for Bayer and monochrome media bus codes, 0 otherwise
+ *
+ * \var CameraSensor::Mode::aspectRatio
+ * \brief The aspect ratio of the frame size, computed as width / height
+ */
 
-	return sizes;
+/**
+ * \fn CameraSensor::modes() const
+ * \brief Retrieve all the modes supported by the camera sensor
+ *
+ * Modes are sorted by increasing media bus code, and by increasing size for
+ * each media bus code.
+ *
+ * \return The supported sensor modes
+ */
+
+/**
+ * \brief Retrieve the modes supported by the camera sensor for a media bus code
+ * \param[in] mbusCode The media bus code for which modes are requested
+ *
+ * \return The supported modes for \a mbusCode sorted by increasing size, or an
+ * empty span if the media bus code isn't supported
+ */
+Span<const CameraSensor::Mode> CameraSensor::modes(unsigned int mbusCode) const
+{
+	auto first = std::lower_bound(modes_.begin(), modes_.end(), mbusCode,
+				      [](const Mode &mode, unsigned int code) {
+					      return mode.mbusCode < code;
+				      });
+	auto last = std::upper_bound(first, modes_.end(), mbusCode,
+				     [](unsigned int code, const Mode &mode) {
+					     return code < mode.mbusCode;
+				     });
+
+	return { modes_.data() + (first - modes_.begin()),
+		 static_cast<size_t>(last - first) };
 }
 
 /**
@@ -737,17 +803,13 @@ V4L2SubdeviceFormat CameraSensor::getFormat(const std::vector<unsigned int> &mbu
 	uint32_t bestCode = 0;
 
 	for (unsigned int code : mbusCodes) {
-		const auto formats = formats_.find(code);
-		if (formats == formats_.end())
-			continue;
-
-		for (const SizeRange &range : formats->second) {
-			const Size &sz = range.max;
+		for (const Mode &mode : modes(code)) {
+			const Size &sz = mode.size;
 
 			if (sz.width < size.width || sz.height < size.height)
 				continue;
 
-			float ratio = static_cast<float>(sz.width) / sz.height;
+			float ratio = static_cast<float>(mode.aspectRatio);
 			float ratioDiff = fabsf(ratio - desiredRatio);
 			unsigned int area = sz.width * sz.height;
 			unsigned int areaDiff = area - desiredArea;
@@ -31,6 +31,23 @@ namespace libcamera {
 
 LOG_DEFINE_CATEGORY(Serializer)
 
+namespace {
+
+/*
+ * Interval, in number of packets, at which a full ControlList is serialized
+ * when delta encoding is enabled. This bounds the number of packets lost when
+ * the peer fails to decode a delta-encoded packet.
+ */
+constexpr uint32_t kDeltaFullListInterval = 32;
+
+uint32_t nextSequence(uint32_t sequence)
+{
+	/* Sequence number 0 is reserved for packets without delta encoding. */
+	return sequence + 1 ? sequence + 1 : 1;
+}
+
+} /* namespace */
+
 /**
  * \class ControlSerializer
  * \brief Serializer and deserializer for control-related classes
@@ -83,6 +100,25 @@ LOG_DEFINE_CATEGORY(Serializer)
  * that time. A reset of the serializer invalidates all ControlList and
  * ControlInfoMap that have been previously deserialized. The caller shall thus
  * proceed with care to avoid stale references.
+ *
+ * To reduce the amount of data transferred for control lists that change
+ * little between consecutive serializations, such as per-frame metadata, the
+ * serializer supports delta encoding of ControlList instances. When enabled
+ * with setDeltaEncoding(), the serializer advertises support for delta encoding
+ * in all the packets it produces. Once it has deserialized a packet from a peer
+ * that advertises the same capability, it encodes each ControlList relative to
+ * the previous list serialized for the same ControlInfoMap handle and id map
+ * type, and only stores the entries that have been added, modified or removed.
+ * A full list is still serialized when delta encoding wouldn't reduce the
+ * number of entries, and periodically to recover from decoding errors. When
+ * the serializer fails to decode a delta-encoded list because it has missed
+ * the list it was based on, it requests its peer to resynchronize with the
+ * next packet it produces, and the peer then serializes full lists again.
+ *
+ * Delta encoding requires the lists to be deserialized in the same order they
+ * have been serialized, by a single peer serializer. This is guaranteed by the
+ * IPC proxies for isolated IPA modules, which negotiate the capability with the
+ * first messages exchanged at IPA initialization time.
  */
 
 /**
@@ -104,6 +140,7 @@ LOG_DEFINE_CATEGORY(Serializer)
  * \param[in] role The role of the IPC component using the serializer
  */
 ControlSerializer::ControlSerializer(Role role)
+	: deltaEnabled_(false), peerDeltaCapable_(false), resyncRequested_(false)
 {
 	/*
 	 * Initialize the handle numerical space using the role of the
@@ -140,6 +177,84 @@ void ControlSerializer::reset()
 	infoMaps_.clear();
 	controlIds_.clear();
 	controlIdMaps_.clear();
+
+	txBaselines_.clear();
+	rxBaselines_.clear();
+	resyncRequested_ = false;
+}
+
+/**
+ * \brief Enable or disable delta encoding of ControlList instances
+ * \param[in] enable True to enable delta encoding, false to disable it
+ *
+ * Delta encoding is disabled by default. When enabled, the serializer
+ * advertises support for delta-encoded packets to its peer, and
+ * delta-encodes the ControlList instances it serializes once the peer has
+ * advertised support for them as well.
+ *
+ * Delta encoding shall only be enabled when all the ControlList packets
+ * produced by the serializer are deserialized, in order, by a single peer
+ * ControlSerializer.
+ */
+void ControlSerializer::setDeltaEncoding(bool enable)
+{
+	deltaEnabled_ = enable;
+
+	if (!enable)
+		txBaselines_.clear();
+}
+
+const ControlValue *ControlSerializer::DeltaBaseline::find(unsigned int id) const
+{
+	auto iter = std::lower_bound(values.begin(), values.end(), id,
+				     [](const auto &entry, unsigned int key) {
+					     return entry.first < key;
+				     });
+	if (iter == values.end() || iter->first != id)
+		return nullptr;
+
+	return &iter->second;
+}
+
+void ControlSerializer::DeltaBaseline::update(const ControlList &list,
+					      uint32_t seq)
+{
+	/*
+	 * Assign the values in place to reuse the storage of the previous
+	 * baseline, and sort them by id for lookup.
+	 */
+	values.resize(list.size());
+
+	auto iter = values.begin();
+	for (const auto &ctrl : list)
+		*iter++ = ctrl;
+
+	std::sort(values.begin(), values.end(),
+		  [](const auto &a, const auto &b) { return a.first < b.first; });
+
+	sequence = seq;
+}
+
+uint32_t ControlSerializer::headerFlags() const
+{
+	if (!deltaEnabled_)
+		return 0;
+
+	return IPA_CONTROLS_FLAG_DELTA_CAPABLE |
+	       (resyncRequested_ ? IPA_CONTROLS_FLAG_RESYNC : 0);
+}
+
+void ControlSerializer::parseHeaderFlags(uint32_t flags)
+{
+	if (flags & IPA_CONTROLS_FLAG_DELTA_CAPABLE)
+		peerDeltaCapable_ = true;
+
+	/*
+	 * The peer has missed the baseline of a delta-encoded list. Drop all
+	 * baselines to serialize full lists until they are re-established.
+	 */
+	if (flags & IPA_CONTROLS_FLAG_RESYNC)
+		txBaselines_.clear();
 }
 
 size_t ControlSerializer::binarySize(const ControlValue &value)
@@ -177,7 +292,8 @@ size_t ControlSerializer::binarySize(const ControlInfoMap &infoMap)
  * \param[in] list The control list
  *
  * Compute and return the size in bytes required to store the serialized
- * ControlList.
+ * ControlList. When delta encoding is enabled, the serialized list may be
+ * smaller than the returned size.
  *
  * \return The size in bytes required to store the serialized ControlList
  */
@@ -254,6 +370,8 @@ int ControlSerializer::serialize(const ControlInfoMap &infoMap,
 	hdr.size = sizeof(hdr) + entriesSize + valuesSize;
 	hdr.data_offset = sizeof(hdr) + entriesSize;
 	hdr.id_map_type = idMapType;
+	hdr.flags = headerFlags();
+	hdr.sequence = 0;
 
 	buffer.write(&hdr);
 
@@ -294,6 +412,7 @@ int ControlSerializer::serialize(const ControlInfoMap &infoMap,
 	 * deserialize control lists.
 	 */
 	infoMapHandles_[&infoMap] = hdr.handle;
+	resyncRequested_ = false;
 
 	return 0;
 }
@@ -306,6 +425,11 @@ int ControlSerializer::serialize(const ControlInfoMap &infoMap,
  * Serialize the \a list into the \a buffer using the serialization format
  * defined by the IPA context interface in ipa_controls.h.
  *
+ * When delta encoding is in use, only the differences with the previously
+ * serialized list are stored, and the number of bytes written to the \a buffer
+ * may be smaller than binarySize(). The caller can use the buffer offset to
+ * retrieve the actual size.
+ *
  * \return 0 on success, a negative error code otherwise
  * \retval -ENOENT The ControlList is related to an unknown ControlInfoMap
  * \retval -ENOSPC Not enough space is available in the buffer
@@ -340,44 +464,117 @@ int ControlSerializer::serialize(const ControlList &list,
 	else
 		idMapType = IPA_CONTROL_ID_MAP_V4L2;
 
-	size_t entriesSize = list.size() * sizeof(struct ipa_control_value_entry);
+	/*
+	 * Encode the list relative to the previous list serialized with the
+	 * same handle and id map type if the peer supports delta encoding.
+	 * Fall back to a full list if that doesn't reduce the number of
+	 * entries, or periodically to allow the peer to recover from errors.
+	 */
+	DeltaBaseline *baseline = nullptr;
+	uint32_t sequence = 0;
+	bool delta = false;
+
+	unsigned int numEntries = list.size();
 	size_t valuesSize = 0;
-	for (const auto &ctrl : list)
-		valuesSize += binarySize(ctrl.second);
+
+	if (deltaEnabled_ && peerDeltaCapable_) {
+		baseline = &txBaselines_[{ infoMapHandle, idMapType }];
+		sequence = nextSequence(baseline->sequence);
+
+		if (baseline->sequence && sequence % kDeltaFullListInterval) {
+			numEntries = 0;
+
+			for (const auto &[id, value] : list) {
+				const ControlValue *prev = baseline->find(id);
+				if (prev && *prev == value)
+					continue;
+
+				numEntries++;
+				valuesSize += binarySize(value);
+			}
+
+			for (const auto &ctrl : baseline->values) {
+				if (!list.contains(ctrl.first))
+					numEntries++;
+			}
+
+			delta = numEntries < list.size();
+		}
+	}
+
+	if (!delta) {
+		numEntries = list.size();
+		valuesSize = 0;
+		for (const auto &ctrl : list)
+			valuesSize += binarySize(ctrl.second);
+	}
+
+	size_t entriesSize = numEntries * sizeof(struct ipa_control_value_entry);
 
 	/* Prepare the packet header. */
 	struct ipa_controls_header hdr;
 	hdr.version = IPA_CONTROLS_FORMAT_VERSION;
 	hdr.handle = infoMapHandle;
-	hdr.entries = list.size();
+	hdr.entries = numEntries;
 	hdr.size = sizeof(hdr) + entriesSize + valuesSize;
 	hdr.data_offset = sizeof(hdr) + entriesSize;
 	hdr.id_map_type = idMapType;
+	hdr.flags = headerFlags() | (delta ? IPA_CONTROLS_FLAG_DELTA : 0);
+	hdr.sequence = sequence;
 
 	buffer.write(&hdr);
 
 	ByteStreamBuffer entries = buffer.carveOut(entriesSize);
 	ByteStreamBuffer values = buffer.carveOut(valuesSize);
 
-	/* Serialize all entries. */
+	/* Serialize all entries, skipping the unchanged ones for deltas. */
 	for (const auto &ctrl : list) {
 		unsigned int id = ctrl.first;
 		const ControlValue &value = ctrl.second;
 
+		if (delta) {
+			const ControlValue *prev = baseline->find(id);
+			if (prev && *prev == value)
+				continue;
+		}
+
 		struct ipa_control_value_entry entry;
 		entry.id = id;
 		entry.type = value.type();
 		entry.is_array = value.isArray();
 		entry.count = value.numElements();
 		entry.offset = values.offset();
+		entry.flags = 0;
 		entries.write(&entry);
 
 		store(value, values);
 	}
 
+	/* Serialize the controls removed since the previous list. */
+	if (delta) {
+		for (const auto &ctrl : baseline->values) {
+			if (list.contains(ctrl.first))
+				continue;
+
+			struct ipa_control_value_entry entry;
+			entry.id = ctrl.first;
+			entry.type = ControlTypeNone;
+			entry.is_array = false;
+			entry.count = 0;
+			entry.offset = values.offset();
+			entry.flags = IPA_CONTROL_VALUE_ENTRY_REMOVED;
+			entries.write(&entry);
+		}
+	}
+
 	if (buffer.overflow())
 		return -ENOSPC;
 
+	if (baseline)
+		baseline->update(list, sequence);
+
+	resyncRequested_ = false;
+
 	return 0;
 }
 
@@ -432,6 +629,8 @@ ControlInfoMap ControlSerializer::deserialize<ControlInfoMap>(ByteStreamBuffer &
 		return {};
 	}
 
+	parseHeaderFlags(hdr->flags);
+
 	auto iter = infoMaps_.find(hdr->handle);
 	if (iter != infoMaps_.end()) {
 		LOG(Serializer, Debug) << "Use cached ControlInfoMap";
@@ -552,6 +751,8 @@ ControlList ControlSerializer::deserialize<ControlList>(ByteStreamBuffer &buffer
 		return {};
 	}
 
+	parseHeaderFlags(hdr->flags);
+
 	ByteStreamBuffer entries = buffer.carveOut(hdr->data_offset - sizeof(*hdr));
 	ByteStreamBuffer values = buffer.carveOut(hdr->size - hdr->data_offset);
 
@@ -601,6 +802,29 @@ ControlList ControlSerializer::deserialize<ControlList>(ByteStreamBuffer &buffer
 		}
 	}
 
+	/*
+	 * Delta-encoded lists require the baseline of the previous list in the
+	 * same sequence to be available. If it is missing, the list can't be
+	 * reconstructed, request the peer to send full lists again.
+	 */
+	const DeltaBaselineKey key{ hdr->handle, hdr->id_map_type };
+	const bool delta = hdr->flags & IPA_CONTROLS_FLAG_DELTA;
+	const DeltaBaseline *baseline = nullptr;
+
+	if (delta) {
+		auto iter = rxBaselines_.find(key);
+		if (!hdr->sequence || iter == rxBaselines_.end() ||
+		    nextSequence(iter->second.sequence) != hdr->sequence) {
+			LOG(Serializer, Error)
+				<< "Can't deserialize ControlList: missing delta baseline";
+			rxBaselines_.erase(key);
+			resyncRequested_ = true;
+			return {};
+		}
+
+		baseline = &iter->second;
+	}
+
 	/*
 	 * \todo When available, initialize the list with the ControlInfoMap
 	 * so that controls can be validated against their limits.
@@ -608,6 +832,7 @@ ControlList ControlSerializer::deserialize<ControlList>(ByteStreamBuffer &buffer
 	 * idmap only.
 	 */
 	ControlList ctrls(*idMap);
+	std::vector<unsigned int> removed;
 
 	for (unsigned int i = 0; i < hdr->entries; ++i) {
 		const struct ipa_control_value_entry *entry =
@@ -617,6 +842,11 @@ ControlList ControlSerializer::deserialize<ControlList>(ByteStreamBuffer &buffer
 			return {};
 		}
 
+		if (delta && entry->flags & IPA_CONTROL_VALUE_ENTRY_REMOVED) {
+			removed.push_back(entry->id);
+			continue;
+		}
+
 		if (entry->offset != values.offset()) {
 			LOG(Serializer, Error)
 				<< "Bad data, entry offset mismatch (entry "
@@ -628,6 +858,25 @@ ControlList ControlSerializer::deserialize<ControlList>(ByteStreamBuffer &buffer
 			  loadControlValue(values, entry->is_array, entry->count));
 	}
 
+	/* Apply the changes to the baseline to reconstruct the full list. */
+	if (delta) {
+		ControlList full(*idMap);
+
+		for (const auto &[id, value] : baseline->values) {
+			if (ctrls.contains(id) ||
+			    std::find(removed.begin(), removed.end(), id) != removed.end())
+				continue;
+
+			full.set(id, value);
+		}
+
+		full.merge(std::move(ctrls));
+		ctrls = std::move(full);
+	}
+
+	if (hdr->sequence)
+		rxBaselines_[key].update(ctrls, hdr->sequence);
+
 	return ctrls;
 }
 
@@ -7,6 +7,7 @@
 
 #include <libcamera/controls.h>
 
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 #include <string>
@@ -87,10 +88,16 @@ static constexpr size_t ControlValueSize[] = {
 /**
  * \class ControlValue
  * \brief Abstract type representing the value of a control
+ *
+ * Values up to 40 bytes in size are stored inline in the ControlValue
+ * instance, larger values are stored in memory allocated on the heap. The
+ * inline storage covers all scalar types as well as small fixed-size arrays,
+ * such as a Rectangle or a 3x3 matrix of floats, which are commonly set for
+ * every frame and thus don't cause any memory allocation.
  */
 
 /** \todo Revisit the ControlValue layout when stabilizing the ABI */
-static_assert(sizeof(ControlValue) == 16, "Invalid size of ControlValue class");
+static_assert(sizeof(ControlValue) == 48, "Invalid size of ControlValue class");
 
 /**
  * \brief Construct an empty ControlValue.
@@ -137,6 +144,24 @@ ControlValue::ControlValue(const ControlValue &other)
 	*this = other;
 }
 
+/**
+ * \brief Construct a ControlValue by moving the content of \a other
+ * \param[in] other The ControlValue to move content from
+ *
+ * The heap storage of \a other, if any, is transferred to the new instance
+ * without any memory allocation or copy. The \a other value is left empty.
+ */
+ControlValue::ControlValue(ControlValue &&other) noexcept
+	: type_(other.type_), isArray_(other.isArray_),
+	  numElements_(other.numElements_)
+{
+	memcpy(value_, other.value_, sizeof(value_));
+
+	other.type_ = ControlTypeNone;
+	other.isArray_ = false;
+	other.numElements_ = 0;
+}
+
 /**
  * \brief Replace the content of the ControlValue with a copy of the content
  * of \a other
@@ -150,6 +175,35 @@ ControlValue &ControlValue::operator=(const ControlValue &other)
 	return *this;
 }
 
+/**
+ * \brief Replace the content of the ControlValue by moving the content of
+ * \a other
+ * \param[in] other The ControlValue to move content from
+ *
+ * The heap storage of \a other, if any, is transferred to this instance
+ * without any memory allocation or copy. The \a other value is left empty.
+ *
+ * \return The ControlValue with its content replaced with the one of \a other
+ */
+ControlValue &ControlValue::operator=(ControlValue &&other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	release();
+
+	type_ = other.type_;
+	isArray_ = other.isArray_;
+	numElements_ = other.numElements_;
+	memcpy(value_, other.value_, sizeof(value_));
+
+	other.type_ = ControlTypeNone;
+	other.isArray_ = false;
+	other.numElements_ = 0;
+
+	return *this;
+}
+
 /**
  * \fn ControlValue::type()
  * \brief Retrieve the data type of the value
@@ -385,11 +439,14 @@ void ControlValue::reserve(ControlType type, bool isArray, std::size_t numElemen
  */
 
 /**
- * \fn ControlId::ControlId(unsigned int id, const std::string &name, ControlType type)
+ * \fn ControlId::ControlId(unsigned int id, const std::string &name,
+ * ControlType type, std::size_t size)
  * \brief Construct a ControlId instance
  * \param[in] id The control numerical ID
  * \param[in] name The control name
  * \param[in] type The control data type
+ * \param[in] size The number of elements of an array control, 0 for scalars,
+ * or dynamic_extent for variable-size arrays
  */
 
 /**
@@ -410,6 +467,24 @@ void ControlValue::reserve(ControlType type, bool isArray, std::size_t numElemen
  * \return The control data type
  */
 
+/**
+ * \fn bool ControlId::isArray() const
+ * \brief Check if the control is an array control
+ * \return True if the control values are arrays, false otherwise
+ */
+
+/**
+ * \fn std::size_t ControlId::size() const
+ * \brief Retrieve the number of elements of an array control
+ *
+ * The size is 0 for scalar controls, and dynamic_extent for array
+ * controls whose number of elements is variable. ControlId instances created
+ * at runtime, for instance when deserializing a ControlInfoMap, don't carry
+ * the size and are reported as scalar controls.
+ *
+ * \return The number of elements of the control values
+ */
+
 /**
  * \fn bool operator==(unsigned int lhs, const ControlId &rhs)
  * \brief Compare a ControlId with a control numerical ID
@@ -629,6 +704,10 @@ std::string ControlInfo::toString() const
  * providing access to the mapped elements using numerical ID keys, in addition
  * to the features of the standard unsorted map. All ControlId keys in the map
  * must appear in the ControlIdMap.
+ *
+ * As the map is immutable, a sorted index of numerical IDs is built at
+ * construction time. Lookups by numerical ID use the index and don't need to
+ * go through the ControlIdMap.
  */
 
 /**
@@ -637,10 +716,29 @@ std::string ControlInfo::toString() const
  */
 
 /**
- * \fn ControlInfoMap::ControlInfoMap(const ControlInfoMap &other)
  * \brief Copy constructor, construct a ControlInfoMap from a copy of \a other
  * \param[in] other The other ControlInfoMap
  */
+ControlInfoMap::ControlInfoMap(const ControlInfoMap &other)
+	: Map(other), idmap_(other.idmap_)
+{
+	buildIndex();
+}
+
+/**
+ * \brief Move constructor, construct a ControlInfoMap by moving \a other
+ * \param[in] other The other ControlInfoMap
+ *
+ * Moving the map doesn't invalidate iterators to its elements, the index is
+ * moved along with it. Upon return the \a other map is empty.
+ */
+ControlInfoMap::ControlInfoMap(ControlInfoMap &&other)
+	: Map(std::move(other)), idmap_(other.idmap_),
+	  index_(std::move(other.index_))
+{
+	other.Map::clear();
+	other.index_.clear();
+}
 
 /**
  * \brief Construct a ControlInfoMap from an initializer list
@@ -652,6 +750,7 @@ ControlInfoMap::ControlInfoMap(std::initializer_list<Map::value_type> init,
 	: Map(init), idmap_(&idmap)
 {
 	ASSERT(validate());
+	buildIndex();
 }
 
 /**
@@ -666,14 +765,48 @@ ControlInfoMap::ControlInfoMap(Map &&info, const ControlIdMap &idmap)
 	: Map(std::move(info)), idmap_(&idmap)
 {
 	ASSERT(validate());
+	buildIndex();
 }
 
 /**
- * \fn ControlInfoMap &ControlInfoMap::operator=(const ControlInfoMap &other)
  * \brief Copy assignment operator, replace the contents with a copy of \a other
  * \param[in] other The other ControlInfoMap
  * \return A reference to the ControlInfoMap
  */
+ControlInfoMap &ControlInfoMap::operator=(const ControlInfoMap &other)
+{
+	if (this == &other)
+		return *this;
+
+	Map::operator=(other);
+	idmap_ = other.idmap_;
+	buildIndex();
+
+	return *this;
+}
+
+/**
+ * \brief Move assignment operator, replace the contents with those of \a other
+ * \param[in] other The other ControlInfoMap
+ *
+ * Upon return the \a other map is empty.
+ *
+ * \return A reference to the ControlInfoMap
+ */
+ControlInfoMap &ControlInfoMap::operator=(ControlInfoMap &&other)
+{
+	if (this == &other)
+		return *this;
+
+	Map::operator=(std::move(other));
+	idmap_ = other.idmap_;
+	index_ = std::move(other.index_);
+
+	other.Map::clear();
+	other.index_.clear();
+
+	return *this;
+}
 
 bool ControlInfoMap::validate()
 {
@@ -715,6 +848,38 @@ bool ControlInfoMap::validate()
 	return true;
 }
 
+/*
+ * The map is immutable once constructed, build a sorted index of numerical
+ * IDs to speed up lookups, and avoid going through the idmap and the map's
+ * hash table for every access by numerical ID.
+ */
+void ControlInfoMap::buildIndex()
+{
+	index_.clear();
+	index_.reserve(Map::size());
+
+	for (auto iter = Map::begin(); iter != Map::end(); ++iter)
+		index_.emplace_back(iter->first->id(), iter);
+
+	std::sort(index_.begin(), index_.end(),
+		  [](const auto &a, const auto &b) {
+			  return a.first < b.first;
+		  });
+}
+
+ControlInfoMap::ControlInfoMapIndex::const_iterator
+ControlInfoMap::indexOf(unsigned int id) const
+{
+	auto iter = std::lower_bound(index_.begin(), index_.end(), id,
+				     [](const auto &entry, unsigned int key) {
+					     return entry.first < key;
+				     });
+	if (iter == index_.end() || iter->first != id)
+		return index_.end();
+
+	return iter;
+}
+
 /**
  * \brief Access specified element by numerical ID
  * \param[in] id The numerical ID
@@ -746,15 +911,7 @@ const ControlInfoMap::mapped_type &ControlInfoMap::at(unsigned int id) const
  */
 ControlInfoMap::size_type ControlInfoMap::count(unsigned int id) const
 {
-	if (!idmap_)
-		return 0;
-
-	/*
-	 * The ControlInfoMap and its idmap have a 1:1 mapping between their
-	 * entries, we can thus just count the matching entries in idmap to
-	 * avoid an additional lookup.
-	 */
-	return idmap_->count(id);
+	return indexOf(id) != index_.end() ? 1 : 0;
 }
 
 /**
@@ -765,14 +922,11 @@ ControlInfoMap::size_type ControlInfoMap::count(unsigned int id) const
  */
 ControlInfoMap::iterator ControlInfoMap::find(unsigned int id)
 {
-	if (!idmap_)
+	auto iter = indexOf(id);
+	if (iter == index_.end())
 		return end();
 
-	auto iter = idmap_->find(id);
-	if (iter == idmap_->end())
-		return end();
-
-	return find(iter->second);
+	return iter->second;
 }
 
 /**
@@ -783,14 +937,11 @@ ControlInfoMap::iterator ControlInfoMap::find(unsigned int id)
  */
 ControlInfoMap::const_iterator ControlInfoMap::find(unsigned int id) const
 {
-	if (!idmap_)
-		return end();
-
-	auto iter = idmap_->find(id);
-	if (iter == idmap_->end())
+	auto iter = indexOf(id);
+	if (iter == index_.end())
 		return end();
 
-	return find(iter->second);
+	return iter->second;
 }
 
 /**
@@ -815,6 +966,19 @@ ControlInfoMap::const_iterator ControlInfoMap::find(unsigned int id) const
  * Control lists are constructed with a map of all the controls supported by
  * their object, and an optional ControlValidator to further validate the
  * controls.
+ *
+ * Controls are stored in a flat array in the order they are first added to the
+ * list, and iterating over the list visits them in that order. A separate
+ * index sorted by numerical ID is used to look controls up. Clearing the list
+ * retains the memory allocated for both, so that a list reused for every
+ * frame, such as the controls and metadata of a reused Request, doesn't
+ * require any memory allocation for its storage once it has reached its
+ * steady-state size.
+ *
+ * As with a std::vector, adding a control to the list may reallocate the flat
+ * array. This invalidates all iterators, as well as all references to control
+ * values returned by get(). Updating the value of a control already present in
+ * the list doesn't invalidate them.
  */
 
 /**
@@ -854,9 +1018,63 @@ ControlList::ControlList(const ControlInfoMap &infoMap,
 {
 }
 
+/**
+ * \fn ControlList::ControlList(const ControlList &other)
+ * \brief Copy constructor, construct the ControlList with a copy of \a other
+ * \param[in] other The ControlList to copy
+ */
+
+/**
+ * \fn ControlList::ControlList(ControlList &&other)
+ * \brief Move constructor, construct the ControlList by taking over \a other
+ * \param[in] other The ControlList to move
+ */
+
+/**
+ * \brief Copy assignment operator, replace the contents with a copy of \a other
+ * \param[in] other The ControlList to copy
+ *
+ * The memory allocated to store the controls is retained when it is large
+ * enough to store the controls of \a other.
+ *
+ * \return A reference to the ControlList
+ */
+ControlList &ControlList::operator=(const ControlList &other)
+{
+	if (this == &other)
+		return *this;
+
+	validator_ = other.validator_;
+	idmap_ = other.idmap_;
+	infoMap_ = other.infoMap_;
+
+	/*
+	 * The entries can't be copy-assigned as their ID is const, copy
+	 * construct them instead.
+	 */
+	controls_.clear();
+	controls_.reserve(other.controls_.size());
+	for (const auto &entry : other.controls_)
+		controls_.emplace_back(entry);
+
+	index_ = other.index_;
+
+	return *this;
+}
+
+/**
+ * \fn ControlList &ControlList::operator=(ControlList &&other)
+ * \brief Move assignment operator, replace the contents with those of \a other
+ * \param[in] other The ControlList to move
+ * \return A reference to the ControlList
+ */
+
 /**
  * \typedef ControlList::iterator
  * \brief Iterator for the controls contained within the list
+ *
+ * The iterator gives access to the control values, but not to the control
+ * IDs, as modifying an ID would desynchronize the list from its index.
  */
 
 /**
@@ -903,9 +1121,16 @@ ControlList::ControlList(const ControlInfoMap &infoMap,
  */
 
 /**
- * \fn ControlList::clear()
  * \brief Removes all controls from the list
+ *
+ * The memory allocated to store the controls is retained, and is reused when
+ * controls are later added to the list.
  */
+void ControlList::clear()
+{
+	controls_.clear();
+	index_.clear();
+}
 
 /**
  * \brief Merge the \a source into the ControlList
@@ -918,8 +1143,7 @@ ControlList::ControlList(const ControlInfoMap &infoMap,
  * Only control lists created from the same ControlIdMap or ControlInfoMap may
  * be merged. Attempting to do otherwise results in undefined behaviour.
  *
- * \todo Reimplement or implement an overloaded version which internally uses
- * std::unordered_map::merge() and accepts a non-const argument.
+ * \sa merge(ControlList &&source)
  */
 void ControlList::merge(const ControlList &source)
 {
@@ -947,6 +1171,30 @@ void ControlList::merge(const ControlList &source)
 	}
 }
 
+/**
+ * \brief Merge the \a source into the ControlList by moving its contents
+ * \param[in] source The ControlList to merge into this object
+ *
+ * This function behaves as merge(const ControlList &source), but moves the
+ * control values from \a source instead of copying them, avoiding memory
+ * allocations for values stored on the heap. The \a source is cleared.
+ */
+void ControlList::merge(ControlList &&source)
+{
+	for (auto &ctrl : source) {
+		if (contains(ctrl.first)) {
+			const ControlId *id = idmap_->at(ctrl.first);
+			LOG(Controls, Warning)
+				<< "Control " << id->name() << " not overwritten";
+			continue;
+		}
+
+		set(ctrl.first, std::move(ctrl.second));
+	}
+
+	source.clear();
+}
+
 /**
  * \brief Check if the list contains a control with the specified \a id
  * \param[in] id The control numerical ID
@@ -955,7 +1203,7 @@ void ControlList::merge(const ControlList &source)
  */
 bool ControlList::contains(unsigned int id) const
 {
-	return controls_.find(id) != controls_.end();
+	return lookup(id) != nullptr;
 }
 
 /**
@@ -998,6 +1246,8 @@ bool ControlList::contains(unsigned int id) const
  * Use ControlList::contains() to test for the presence of a control in the
  * list before retrieving its value.
  *
+ * The returned reference is invalidated when a control is added to the list.
+ *
  * \return The control value
  */
 const ControlValue &ControlList::get(unsigned int id) const
@@ -1032,6 +1282,23 @@ void ControlList::set(unsigned int id, const ControlValue &value)
 	*val = value;
 }
 
+/**
+ * \brief Set the value of control \a id to \a value by moving it
+ * \param[in] id The control ID
+ * \param[in] value The control value
+ *
+ * This function behaves as set(unsigned int id, const ControlValue &value),
+ * but moves \a value into the list instead of copying it.
+ */
+void ControlList::set(unsigned int id, ControlValue &&value)
+{
+	ControlValue *val = find(id);
+	if (!val)
+		return;
+
+	*val = std::move(value);
+}
+
 /**
  * \fn ControlList::infoMap()
  * \brief Retrieve the ControlInfoMap used to construct the ControlList
@@ -1050,17 +1317,35 @@ void ControlList::set(unsigned int id, const ControlValue &value)
  * nullptr is returned in that case.
  */
 
+ControlList::ControlListIndex::const_iterator
+ControlList::indexOf(unsigned int id) const
+{
+	return std::lower_bound(index_.begin(), index_.end(), id,
+				[](const auto &entry, unsigned int key) {
+					return entry.first < key;
+				});
+}
+
+const ControlValue *ControlList::lookup(unsigned int id) const
+{
+	auto iter = indexOf(id);
+	if (iter == index_.end() || iter->first != id)
+		return nullptr;
+
+	return &controls_[iter->second].second;
+}
+
 const ControlValue *ControlList::find(unsigned int id) const
 {
-	const auto iter = controls_.find(id);
-	if (iter == controls_.end()) {
+	const ControlValue *val = lookup(id);
+	if (!val) {
 		LOG(Controls, Error)
 			<< "Control " << utils::hex(id) << " not found";
 
 		return nullptr;
 	}
 
-	return &iter->second;
+	return val;
 }
 
 ControlValue *ControlList::find(unsigned int id)
@@ -1072,7 +1357,12 @@ ControlValue *ControlList::find(unsigned int id)
 		return nullptr;
 	}
 
-	return &controls_[id];
+	auto iter = indexOf(id);
+	if (iter != index_.end() && iter->first == id)
+		return &controls_[iter->second].second;
+
+	index_.insert(iter, { id, static_cast<unsigned int>(controls_.size()) });
+	return &controls_.emplace_back(id, ControlValue{}).second;
 }
 
 } /* namespace libcamera */
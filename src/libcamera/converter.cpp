@@ -8,6 +8,7 @@
 #include "libcamera/internal/converter.h"
 
 #include <algorithm>
+#include <errno.h>
 
 #include <libcamera/base/log.h>
 
@@ -40,9 +41,14 @@ LOG_DEFINE_CATEGORY(Converter)
  *
  * This searches for the entity implementing the data streaming function in the
  * media graph entities and use its device node as the converter device node.
+ * Converters that are not backed by a device, such as software converters, are
+ * constructed with a null \a media and have an empty device node.
  */
 Converter::Converter(MediaDevice *media)
 {
+	if (!media)
+		return;
+
 	const std::vector<MediaEntity *> &entities = media->entities();
 	auto it = std::find_if(entities.begin(), entities.end(),
 			       [](MediaEntity *entity) {
@@ -147,6 +153,28 @@ Converter::~Converter()
  * \return 0 on success or a negative error code otherwise
  */
 
+/**
+ * \brief Set the crop rectangle applied to the input of an output stream
+ * \param[in] output The output stream index
+ * \param[inout] rect The crop rectangle, in input image pixels
+ *
+ * The crop rectangle selects the part of the input image that is converted to
+ * the output stream indicated by the \a output index, and is scaled to the
+ * output size. The converter may adjust the rectangle to its constraints, and
+ * stores the applied rectangle in \a rect. The crop applies to the buffers
+ * processed after the call, and can be changed while the converter is running.
+ *
+ * The default implementation doesn't support cropping.
+ *
+ * \return 0 on success, -ENOTSUP if the converter doesn't support cropping, or
+ * another negative error code otherwise
+ */
+int Converter::setInputCrop([[maybe_unused]] unsigned int output,
+			    [[maybe_unused]] Rectangle *rect)
+{
+	return -ENOTSUP;
+}
+
 /**
  * \var Converter::inputBufferReady
  * \brief A signal emitted when the input frame buffer completes
@@ -235,6 +263,41 @@ std::unique_ptr<Converter> ConverterFactoryBase::create(MediaDevice *media)
 	return nullptr;
 }
 
+/**
+ * \brief Create an instance of a converter by name
+ * \param[in] name The converter factory name or compatible alias
+ *
+ * This function creates converters that are not backed by a media device, such
+ * as software converters. The converter is constructed with a null media
+ * device.
+ *
+ * \return A new instance of the converter subclass corresponding to \a name,
+ * or null if no factory matches \a name or the converter is not valid
+ */
+std::unique_ptr<Converter> ConverterFactoryBase::create(const std::string &name)
+{
+	const std::vector<ConverterFactoryBase *> &factories =
+		ConverterFactoryBase::factories();
+
+	for (const ConverterFactoryBase *factory : factories) {
+		const std::vector<std::string> &compatibles = factory->compatibles();
+		auto it = std::find(compatibles.begin(), compatibles.end(), name);
+
+		if (it == compatibles.end() && name != factory->name_)
+			continue;
+
+		LOG(Converter, Debug)
+			<< "Creating converter from " << factory->name_
+			<< " factory";
+
+		std::unique_ptr<Converter> converter = factory->createInstance(nullptr);
+		if (converter->isValid())
+			return converter;
+	}
+
+	return nullptr;
+}
+
 /**
  * \brief Add a converter factory to the registry
  * \param[in] factory Factory to use to construct the converter class
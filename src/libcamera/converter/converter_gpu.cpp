@@ -0,0 +1,808 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * converter_gpu.cpp - GPU-based format converter
+ */
+
+#include "libcamera/internal/converter/converter_gpu.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+
+#include <libcamera/base/log.h>
+#include <libcamera/base/shared_fd.h>
+
+#include <libcamera/formats.h>
+#include <libcamera/framebuffer.h>
+#include <libcamera/geometry.h>
+
+#include "libcamera/internal/bayer_format.h"
+#include "libcamera/internal/formats.h"
+#include "libcamera/internal/framebuffer.h"
+
+/**
+ * \file internal/converter/converter_gpu.h
+ * \brief GPU-based format converter
+ */
+
+namespace libcamera {
+
+LOG_DECLARE_CATEGORY(Converter)
+
+namespace {
+
+/*
+ * Output formats are limited to 32-bit RGB formats, which all OpenGL ES
+ * implementations can render to.
+ */
+const std::vector<PixelFormat> kOutputFormats = {
+	formats::ARGB8888,
+	formats::XRGB8888,
+	formats::ABGR8888,
+	formats::XBGR8888,
+};
+
+/* Input formats used when the EGL implementation can't enumerate them. */
+const std::vector<PixelFormat> kDefaultInputFormats = {
+	formats::NV12,
+	formats::YUYV,
+};
+
+/* Many GPUs require render target lines to be aligned to 64 bytes. */
+constexpr unsigned int kStrideAlignment = 64;
+
+constexpr unsigned int kMinSize = 16;
+
+/*
+ * Draw a quad covering the whole viewport without any vertex buffer. The
+ * texture coordinates map the first line of the input to the first line of the
+ * output, as both are stored top-down in memory.
+ */
+const char *kVertexShader = R"(#version 300 es
+const vec2 positions[4] = vec2[](vec2(-1.0, -1.0), vec2(1.0, -1.0),
+				 vec2(-1.0, 1.0), vec2(1.0, 1.0));
+out vec2 texCoord;
+
+void main()
+{
+	vec2 position = positions[gl_VertexID];
+	texCoord = position * 0.5 + 0.5;
+	gl_Position = vec4(position, 0.0, 1.0);
+}
+)";
+
+/*
+ * Formats that the GPU can sample natively, including YUV formats, are
+ * imported as external images. The driver performs colour space conversion,
+ * and scaling uses bilinear filtering.
+ */
+const char *kExternalShader = R"(#version 300 es
+#extension GL_OES_EGL_image_external_essl3 : require
+precision mediump float;
+
+uniform samplerExternalOES tex;
+in vec2 texCoord;
+out vec4 fragColor;
+
+void main()
+{
+	fragColor = vec4(texture(tex, texCoord).rgb, 1.0);
+}
+)";
+
+/*
+ * Raw Bayer images are imported as single-component 8-bit textures, with one
+ * texel per byte. The shader unpacks CSI-2 packed pixels, keeping their 8 most
+ * significant bits, and interpolates the missing colour components bilinearly
+ * from the neighbouring pixels, mirroring the image at its borders to preserve
+ * the Bayer pattern. The image is scaled by picking the nearest input pixel.
+ */
+const char *kBayerShader = R"(#version 300 es
+precision highp float;
+precision highp int;
+
+uniform sampler2D raw;
+uniform ivec2 size;
+uniform vec2 scale;
+uniform ivec2 redPosition;
+uniform bool csi2Packed;
+uniform float blackLevel;
+out vec4 fragColor;
+
+float pixel(ivec2 pos)
+{
+	pos = abs(pos);
+	pos = min(pos, 2 * size - 2 - pos);
+
+	int x = csi2Packed ? pos.x / 4 * 5 + pos.x % 4 : pos.x;
+	return texelFetch(raw, ivec2(x, pos.y), 0).r;
+}
+
+void main()
+{
+	ivec2 pos = ivec2(floor(gl_FragCoord.xy * scale));
+	ivec2 colour = (pos ^ redPosition) & 1;
+
+	float c = pixel(pos);
+	float h = (pixel(pos + ivec2(-1, 0)) + pixel(pos + ivec2(1, 0))) * 0.5;
+	float v = (pixel(pos + ivec2(0, -1)) + pixel(pos + ivec2(0, 1))) * 0.5;
+	float d = (pixel(pos + ivec2(-1, -1)) + pixel(pos + ivec2(1, -1)) +
+		   pixel(pos + ivec2(-1, 1)) + pixel(pos + ivec2(1, 1))) * 0.25;
+	float hv = (h + v) * 0.5;
+
+	vec3 rgb;
+	if (colour == ivec2(0, 0))
+		rgb = vec3(c, hv, d);
+	else if (colour == ivec2(1, 1))
+		rgb = vec3(d, hv, c);
+	else if (colour == ivec2(1, 0))
+		rgb = vec3(h, c, v);
+	else
+		rgb = vec3(v, c, h);
+
+	rgb = clamp((rgb - blackLevel) / (1.0 - blackLevel), 0.0, 1.0);
+	fragColor = vec4(pow(rgb, vec3(1.0 / 2.2)), 1.0);
+}
+)";
+
+bool isBayerInput(const PixelFormat &format)
+{
+	const BayerFormat bayer = BayerFormat::fromPixelFormat(format);
+
+	if (!bayer.isValid() || bayer.order == BayerFormat::MONO)
+		return false;
+
+	return (bayer.bitDepth == 8 && bayer.packing == BayerFormat::Packing::None) ||
+	       (bayer.bitDepth == 10 && bayer.packing == BayerFormat::Packing::CSI2);
+}
+
+bool hasExtension(const char *extensions, const char *name)
+{
+	if (!extensions)
+		return false;
+
+	size_t length = strlen(name);
+
+	for (const char *p = extensions; (p = strstr(p, name)); p += length) {
+		if ((p == extensions || p[-1] == ' ') &&
+		    (p[length] == ' ' || p[length] == '\0'))
+			return true;
+	}
+
+	return false;
+}
+
+} /* namespace */
+
+/*
+ * The Renderer owns the EGL display and context. As an OpenGL ES context can
+ * only be current in one thread, all GPU operations are performed in the
+ * converter thread by the Renderer.
+ */
+class GpuConverter::Renderer : public Object
+{
+public:
+	Renderer(GpuConverter *converter);
+
+	int init();
+	void cleanup();
+
+	const std::vector<PixelFormat> &inputFormats() const { return inputFormats_; }
+
+	int configure(const StreamConfiguration &inputCfg,
+		      const std::vector<StreamConfiguration> &outputCfgs);
+	void process(Job *job);
+	void releaseImages();
+
+private:
+	struct Image {
+		EGLImageKHR image;
+		GLuint texture;
+		GLuint framebuffer;
+	};
+
+	Image *importBuffer(std::map<FrameBuffer *, Image> &cache,
+			    FrameBuffer *buffer, const StreamConfiguration &cfg,
+			    bool output);
+	void destroyImage(Image &image);
+	GLuint createProgram(const char *fragmentSource);
+
+	GpuConverter *converter_;
+
+	EGLDisplay display_;
+	EGLContext context_;
+
+	PFNEGLCREATEIMAGEKHRPROC eglCreateImageKHR_;
+	PFNEGLDESTROYIMAGEKHRPROC eglDestroyImageKHR_;
+	PFNGLEGLIMAGETARGETTEXTURE2DOESPROC glEGLImageTargetTexture2DOES_;
+
+	std::vector<PixelFormat> inputFormats_;
+	GLuint externalProgram_;
+	GLuint bayerProgram_;
+
+	StreamConfiguration inputConfig_;
+	std::vector<StreamConfiguration> outputConfigs_;
+	bool bayer_;
+
+	std::map<FrameBuffer *, Image> inputImages_;
+	std::map<FrameBuffer *, Image> outputImages_;
+};
+
+GpuConverter::Renderer::Renderer(GpuConverter *converter)
+	: converter_(converter), display_(EGL_NO_DISPLAY),
+	  context_(EGL_NO_CONTEXT), externalProgram_(0), bayerProgram_(0),
+	  bayer_(false)
+{
+}
+
+int GpuConverter::Renderer::init()
+{
+	/*
+	 * Use a surfaceless display, as the converter renders to imported
+	 * buffers only and needs no window system.
+	 */
+	const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	if (!hasExtension(clientExtensions, "EGL_EXT_platform_base") ||
+	    !hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+		LOG(Converter, Debug) << "Surfaceless EGL platform not supported";
+		return -ENOTSUP;
+	}
+
+	auto eglGetPlatformDisplayEXT = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+		eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	display_ = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA,
+					    EGL_DEFAULT_DISPLAY, nullptr);
+	if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, nullptr, nullptr)) {
+		LOG(Converter, Debug) << "Failed to initialize EGL display";
+		display_ = EGL_NO_DISPLAY;
+		return -ENODEV;
+	}
+
+	const char *extensions = eglQueryString(display_, EGL_EXTENSIONS);
+	if (!hasExtension(extensions, "EGL_EXT_image_dma_buf_import") ||
+	    !hasExtension(extensions, "EGL_KHR_surfaceless_context")) {
+		LOG(Converter, Debug) << "EGL dmabuf import not supported";
+		return -ENOTSUP;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_ES_API))
+		return -ENOTSUP;
+
+	static const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 0,
+		EGL_NONE
+	};
+
+	context_ = eglCreateContext(display_, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT,
+				    contextAttribs);
+	if (context_ == EGL_NO_CONTEXT) {
+		LOG(Converter, Debug) << "Failed to create OpenGL ES 3.0 context";
+		return -ENODEV;
+	}
+
+	if (!eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, context_))
+		return -ENODEV;
+
+	const char *glExtensions = reinterpret_cast<const char *>(glGetString(GL_EXTENSIONS));
+	if (!hasExtension(glExtensions, "GL_OES_EGL_image")) {
+		LOG(Converter, Debug) << "EGL image textures not supported";
+		return -ENOTSUP;
+	}
+
+	eglCreateImageKHR_ = reinterpret_cast<PFNEGLCREATEIMAGEKHRPROC>(
+		eglGetProcAddress("eglCreateImageKHR"));
+	eglDestroyImageKHR_ = reinterpret_cast<PFNEGLDESTROYIMAGEKHRPROC>(
+		eglGetProcAddress("eglDestroyImageKHR"));
+	glEGLImageTargetTexture2DOES_ = reinterpret_cast<PFNGLEGLIMAGETARGETTEXTURE2DOESPROC>(
+		eglGetProcAddress("glEGLImageTargetTexture2DOES"));
+	if (!eglCreateImageKHR_ || !eglDestroyImageKHR_ ||
+	    !glEGLImageTargetTexture2DOES_)
+		return -ENOTSUP;
+
+	bayerProgram_ = createProgram(kBayerShader);
+	if (!bayerProgram_)
+		return -EINVAL;
+
+	/*
+	 * Sampling YUV and RGB formats requires external images. Without
+	 * support for them, only raw Bayer formats can be converted.
+	 */
+	if (!hasExtension(glExtensions, "GL_OES_EGL_image_external_essl3"))
+		return 0;
+
+	externalProgram_ = createProgram(kExternalShader);
+	if (!externalProgram_)
+		return 0;
+
+	auto eglQueryDmaBufFormatsEXT = reinterpret_cast<PFNEGLQUERYDMABUFFORMATSEXTPROC>(
+		eglGetProcAddress("eglQueryDmaBufFormatsEXT"));
+	EGLint count = 0;
+
+	if (!hasExtension(extensions, "EGL_EXT_image_dma_buf_import_modifiers") ||
+	    !eglQueryDmaBufFormatsEXT ||
+	    !eglQueryDmaBufFormatsEXT(display_, 0, nullptr, &count)) {
+		inputFormats_ = kDefaultInputFormats;
+		return 0;
+	}
+
+	std::vector<EGLint> fourccs(count);
+	eglQueryDmaBufFormatsEXT(display_, count, fourccs.data(), &count);
+
+	for (EGLint fourcc : fourccs) {
+		PixelFormat format(fourcc);
+		const PixelFormatInfo &info = PixelFormatInfo::info(format);
+
+		if (!info.isValid() ||
+		    info.colourEncoding == PixelFormatInfo::ColourEncodingRAW)
+			continue;
+
+		inputFormats_.push_back(format);
+	}
+
+	return 0;
+}
+
+void GpuConverter::Renderer::cleanup()
+{
+	if (display_ == EGL_NO_DISPLAY)
+		return;
+
+	if (context_ != EGL_NO_CONTEXT) {
+		releaseImages();
+
+		glDeleteProgram(bayerProgram_);
+		glDeleteProgram(externalProgram_);
+
+		eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE,
+			       EGL_NO_CONTEXT);
+		eglDestroyContext(display_, context_);
+		context_ = EGL_NO_CONTEXT;
+	}
+
+	eglTerminate(display_);
+	display_ = EGL_NO_DISPLAY;
+}
+
+GLuint GpuConverter::Renderer::createProgram(const char *fragmentSource)
+{
+	const char *sources[] = { kVertexShader, fragmentSource };
+	const GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	GLuint program = glCreateProgram();
+
+	for (unsigned int i = 0; i < 2; ++i) {
+		GLuint shader = glCreateShader(types[i]);
+		glShaderSource(shader, 1, &sources[i], nullptr);
+		glCompileShader(shader);
+
+		GLint status;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (!status) {
+			char log[512];
+			glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+			LOG(Converter, Error) << "Failed to compile shader: " << log;
+
+			glDeleteShader(shader);
+			glDeleteProgram(program);
+			return 0;
+		}
+
+		glAttachShader(program, shader);
+		glDeleteShader(shader);
+	}
+
+	glLinkProgram(program);
+
+	GLint status;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (!status) {
+		char log[512];
+		glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+		LOG(Converter, Error) << "Failed to link program: " << log;
+
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	return program;
+}
+
+int GpuConverter::Renderer::configure(const StreamConfiguration &inputCfg,
+				      const std::vector<StreamConfiguration> &outputCfgs)
+{
+	releaseImages();
+
+	inputConfig_ = inputCfg;
+	outputConfigs_ = outputCfgs;
+	bayer_ = isBayerInput(inputCfg.pixelFormat);
+
+	/*
+	 * All outputs are rendered from the same input, the uniforms that
+	 * don't depend on the output size are thus set once.
+	 */
+	if (!bayer_) {
+		glUseProgram(externalProgram_);
+		glUniform1i(glGetUniformLocation(externalProgram_, "tex"), 0);
+		return 0;
+	}
+
+	const BayerFormat bayer = BayerFormat::fromPixelFormat(inputCfg.pixelFormat);
+	GLint redX = 0;
+	GLint redY = 0;
+
+	switch (bayer.order) {
+	case BayerFormat::BGGR:
+		redX = 1;
+		redY = 1;
+		break;
+	case BayerFormat::GBRG:
+		redY = 1;
+		break;
+	case BayerFormat::GRBG:
+		redX = 1;
+		break;
+	default:
+		break;
+	}
+
+	glUseProgram(bayerProgram_);
+	glUniform1i(glGetUniformLocation(bayerProgram_, "raw"), 0);
+	glUniform2i(glGetUniformLocation(bayerProgram_, "size"),
+		    inputCfg.size.width, inputCfg.size.height);
+	glUniform2i(glGetUniformLocation(bayerProgram_, "redPosition"), redX, redY);
+	glUniform1i(glGetUniformLocation(bayerProgram_, "csi2Packed"),
+		    bayer.packing == BayerFormat::Packing::CSI2);
+	glUniform1f(glGetUniformLocation(bayerProgram_, "blackLevel"), 16.0f / 256.0f);
+
+	return 0;
+}
+
+GpuConverter::Renderer::Image *
+GpuConverter::Renderer::importBuffer(std::map<FrameBuffer *, Image> &cache,
+				     FrameBuffer *buffer,
+				     const StreamConfiguration &cfg, bool output)
+{
+	auto it = cache.find(buffer);
+	if (it != cache.end())
+		return &it->second;
+
+	static const EGLint planeAttribs[][3] = {
+		{ EGL_DMA_BUF_PLANE0_FD_EXT, EGL_DMA_BUF_PLANE0_OFFSET_EXT,
+		  EGL_DMA_BUF_PLANE0_PITCH_EXT },
+		{ EGL_DMA_BUF_PLANE1_FD_EXT, EGL_DMA_BUF_PLANE1_OFFSET_EXT,
+		  EGL_DMA_BUF_PLANE1_PITCH_EXT },
+		{ EGL_DMA_BUF_PLANE2_FD_EXT, EGL_DMA_BUF_PLANE2_OFFSET_EXT,
+		  EGL_DMA_BUF_PLANE2_PITCH_EXT },
+	};
+
+	const bool raw = !output && bayer_;
+	const PixelFormatInfo &info = PixelFormatInfo::info(cfg.pixelFormat);
+	const std::vector<FrameBuffer::Plane> &planes = buffer->planes();
+	std::vector<EGLint> attribs;
+
+	/*
+	 * Raw images are imported as an 8-bit single-component image, with
+	 * one texel per byte.
+	 */
+	attribs.push_back(EGL_WIDTH);
+	attribs.push_back(raw ? cfg.stride : cfg.size.width);
+	attribs.push_back(EGL_HEIGHT);
+	attribs.push_back(cfg.size.height);
+	attribs.push_back(EGL_LINUX_DRM_FOURCC_EXT);
+	attribs.push_back(raw ? formats::R8.fourcc() : cfg.pixelFormat.fourcc());
+
+	unsigned int numPlanes = raw ? 1 : std::min<unsigned int>(info.numPlanes(), 3);
+
+	for (unsigned int i = 0; i < numPlanes; ++i) {
+		/*
+		 * Formats with multiple planes may be stored in a single
+		 * buffer, in which case the planes share the same dmabuf.
+		 */
+		const FrameBuffer::Plane &plane = planes[std::min<size_t>(i, planes.size() - 1)];
+		unsigned int stride = raw || i == 0
+				    ? cfg.stride
+				    : cfg.stride * info.planes[i].bytesPerGroup
+				      / info.planes[0].bytesPerGroup;
+
+		attribs.push_back(planeAttribs[i][0]);
+		attribs.push_back(plane.fd.get());
+		attribs.push_back(planeAttribs[i][1]);
+		attribs.push_back(plane.offset);
+		attribs.push_back(planeAttribs[i][2]);
+		attribs.push_back(stride);
+	}
+
+	attribs.push_back(EGL_NONE);
+
+	Image image = {};
+	image.image = eglCreateImageKHR_(display_, EGL_NO_CONTEXT,
+					 EGL_LINUX_DMA_BUF_EXT, nullptr,
+					 attribs.data());
+	if (image.image == EGL_NO_IMAGE_KHR) {
+		LOG(Converter, Error)
+			<< "Failed to import " << (output ? "output" : "input")
+			<< " buffer: 0x" << std::hex << eglGetError();
+		return nullptr;
+	}
+
+	GLenum target = output || raw ? GL_TEXTURE_2D : GL_TEXTURE_EXTERNAL_OES;
+
+	glGenTextures(1, &image.texture);
+	glBindTexture(target, image.texture);
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, raw ? GL_NEAREST : GL_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, raw ? GL_NEAREST : GL_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glEGLImageTargetTexture2DOES_(target, image.image);
+
+	if (output) {
+		glGenFramebuffers(1, &image.framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, image.framebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+				       GL_TEXTURE_2D, image.texture, 0);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			LOG(Converter, Error) << "Output buffer can't be rendered to";
+			destroyImage(image);
+			return nullptr;
+		}
+	}
+
+	return &cache.emplace(buffer, image).first->second;
+}
+
+void GpuConverter::Renderer::destroyImage(Image &image)
+{
+	if (image.framebuffer)
+		glDeleteFramebuffers(1, &image.framebuffer);
+	if (image.texture)
+		glDeleteTextures(1, &image.texture);
+	if (image.image != EGL_NO_IMAGE_KHR)
+		eglDestroyImageKHR_(display_, image.image);
+}
+
+void GpuConverter::Renderer::releaseImages()
+{
+	for (auto &[buffer, image] : inputImages_)
+		destroyImage(image);
+	for (auto &[buffer, image] : outputImages_)
+		destroyImage(image);
+
+	inputImages_.clear();
+	outputImages_.clear();
+}
+
+void GpuConverter::Renderer::process(Job *job)
+{
+	Image *input = importBuffer(inputImages_, job->input, inputConfig_, false);
+	bool success = input != nullptr;
+
+	for (auto [index, buffer] : job->outputs) {
+		if (!input)
+			break;
+
+		const StreamConfiguration &cfg = outputConfigs_[index];
+		Image *output = importBuffer(outputImages_, buffer, cfg, true);
+		if (!output) {
+			success = false;
+			continue;
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, output->framebuffer);
+		glViewport(0, 0, cfg.size.width, cfg.size.height);
+
+		glActiveTexture(GL_TEXTURE0);
+		if (bayer_) {
+			glBindTexture(GL_TEXTURE_2D, input->texture);
+			glUniform2f(glGetUniformLocation(bayerProgram_, "scale"),
+				    static_cast<float>(inputConfig_.size.width) / cfg.size.width,
+				    static_cast<float>(inputConfig_.size.height) / cfg.size.height);
+		} else {
+			glBindTexture(GL_TEXTURE_EXTERNAL_OES, input->texture);
+		}
+
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	}
+
+	/*
+	 * Wait for rendering to complete before returning the buffers, as the
+	 * output buffers carry no fence.
+	 */
+	glFinish();
+
+	for (auto [index, buffer] : job->outputs) {
+		FrameMetadata &metadata = buffer->_d()->metadata();
+		metadata.status = success ? FrameMetadata::FrameSuccess
+					  : FrameMetadata::FrameError;
+	}
+
+	converter_->finishJob(job);
+}
+
+/**
+ * \class GpuConverter
+ * \brief Format converter running on the GPU
+ *
+ * The GpuConverter class implements a Converter that uses the GPU through
+ * OpenGL ES 3.0, for platforms that have a GPU but no usable memory-to-memory
+ * scaler. Input and output buffers are imported as EGL images from their
+ * dmabufs, without any copy.
+ *
+ * Raw 8-bit and 10-bit CSI-2 packed Bayer images are debayered in a shader,
+ * which also subtracts a fixed black level and applies gamma correction.
+ * Formats that the GPU can sample, such as YUV formats, are converted by the
+ * GPU's external image support. All inputs can be scaled down, and multiple
+ * outputs of different sizes and RGB formats are rendered from each input.
+ *
+ * The converter renders in a dedicated thread that owns the OpenGL ES context.
+ * It uses a surfaceless EGL display, and is only valid when the EGL and OpenGL
+ * ES implementation supports dmabuf import. As the converter is not backed by
+ * any device, it is created by name from the ConverterFactoryBase and ignores
+ * the media device it is given.
+ */
+
+/**
+ * \brief Construct a GpuConverter instance
+ * \param[in] media The media device, unused
+ */
+GpuConverter::GpuConverter(MediaDevice *media)
+	: MemoryConverter(media, "gpu"), thread_("GpuConverter"), valid_(false)
+{
+	renderer_ = std::make_unique<Renderer>(this);
+	renderer_->moveToThread(&thread_);
+
+	/*
+	 * The OpenGL ES context is bound to the thread it is made current in,
+	 * the thread thus runs for the whole lifetime of the converter.
+	 */
+	thread_.start();
+
+	int ret = renderer_->invokeMethod(&Renderer::init, ConnectionTypeBlocking);
+	if (ret < 0) {
+		LOG(Converter, Debug) << "GPU converter not available";
+		return;
+	}
+
+	valid_ = true;
+}
+
+GpuConverter::~GpuConverter()
+{
+	renderer_->invokeMethod(&Renderer::cleanup, ConnectionTypeBlocking);
+
+	thread_.exit();
+	thread_.wait();
+}
+
+/**
+ * \copydoc libcamera::Converter::formats
+ */
+std::vector<PixelFormat> GpuConverter::formats(PixelFormat input)
+{
+	const std::vector<PixelFormat> &inputFormats = renderer_->inputFormats();
+
+	if (!isBayerInput(input) &&
+	    std::find(inputFormats.begin(), inputFormats.end(), input) == inputFormats.end())
+		return {};
+
+	return kOutputFormats;
+}
+
+/**
+ * \copydoc libcamera::Converter::sizes
+ *
+ * The converter can scale images down, but doesn't upscale them. Output sizes
+ * are multiples of 2.
+ */
+SizeRange GpuConverter::sizes(const Size &input)
+{
+	Size max = input.alignedDownTo(2, 2);
+	if (max.width < kMinSize || max.height < kMinSize)
+		return {};
+
+	return SizeRange(Size(kMinSize, kMinSize), max, 2, 2);
+}
+
+/**
+ * \copydoc libcamera::Converter::strideAndFrameSize
+ */
+std::tuple<unsigned int, unsigned int>
+GpuConverter::strideAndFrameSize(const PixelFormat &pixelFormat,
+				 const Size &size)
+{
+	if (std::find(kOutputFormats.begin(), kOutputFormats.end(), pixelFormat) ==
+	    kOutputFormats.end())
+		return std::make_tuple(0, 0);
+
+	const PixelFormatInfo &info = PixelFormatInfo::info(pixelFormat);
+
+	return std::make_tuple(info.stride(size.width, 0, kStrideAlignment),
+			       info.frameSize(size, kStrideAlignment));
+}
+
+/**
+ * \copydoc libcamera::Converter::configure
+ */
+int GpuConverter::configure(const StreamConfiguration &inputCfg,
+			    const std::vector<std::reference_wrapper<StreamConfiguration>> &outputCfgs)
+{
+	outputConfigs_.clear();
+
+	if (outputCfgs.empty() || formats(inputCfg.pixelFormat).empty())
+		return -EINVAL;
+
+	const SizeRange range = sizes(inputCfg.size);
+	std::vector<StreamConfiguration> configs;
+
+	for (const StreamConfiguration &cfg : outputCfgs) {
+		const auto [stride, frameSize] =
+			strideAndFrameSize(cfg.pixelFormat, cfg.size);
+
+		if (!stride || !range.contains(cfg.size) || cfg.stride < stride) {
+			LOG(Converter, Error)
+				<< "Unsupported output configuration "
+				<< cfg.toString() << " for input "
+				<< inputCfg.toString();
+			return -EINVAL;
+		}
+
+		configs.push_back(cfg);
+	}
+
+	int ret = renderer_->invokeMethod(&Renderer::configure,
+					  ConnectionTypeBlocking, inputCfg,
+					  configs);
+	if (ret < 0)
+		return ret;
+
+	outputConfigs_ = std::move(configs);
+
+	return 0;
+}
+
+/**
+ * \copydoc libcamera::Converter::stop
+ *
+ * Frames queued to the converter are processed before this function returns,
+ * and their completion is signalled synchronously. The EGL images imported
+ * from the buffers are released, as the buffers may be freed once the
+ * converter is stopped.
+ */
+void GpuConverter::stop()
+{
+	renderer_->invokeMethod(&Renderer::releaseImages, ConnectionTypeBlocking);
+
+	flushJobs();
+}
+
+/**
+ * \copydoc libcamera::Converter::queueBuffers
+ */
+int GpuConverter::queueBuffers(FrameBuffer *input,
+			       const std::map<unsigned int, FrameBuffer *> &outputs)
+{
+	int ret = validateOutputs(outputs);
+	if (ret)
+		return ret;
+
+	std::unique_ptr<Job> job = std::make_unique<Job>();
+	job->input = input;
+	job->outputs = outputs;
+
+	Job *ptr = pushJob(std::move(job));
+
+	renderer_->invokeMethod(&Renderer::process, ConnectionTypeQueued, ptr);
+
+	return 0;
+}
+
+REGISTER_CONVERTER("gpu", GpuConverter, {})
+
+} /* namespace libcamera */
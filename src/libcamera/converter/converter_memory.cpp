@@ -0,0 +1,238 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * converter_memory.cpp - Base class for converters without a device
+ */
+
+#include "libcamera/internal/converter/converter_memory.h"
+
+#include <errno.h>
+
+#include <libcamera/base/shared_fd.h>
+#include <libcamera/base/unique_fd.h>
+
+#include <libcamera/framebuffer.h>
+
+#include "libcamera/internal/framebuffer.h"
+#include "libcamera/internal/tracepoints.h"
+
+/**
+ * \file internal/converter/converter_memory.h
+ * \brief Base class for converters without a device
+ */
+
+namespace libcamera {
+
+/**
+ * \class MemoryConverter
+ * \brief Base class for converters that process frames in memory
+ *
+ * The MemoryConverter class implements the parts of the Converter interface
+ * shared by converters that are not backed by a device, such as the
+ * SoftwareConverter and GpuConverter. Output buffers are allocated from a DMA
+ * heap, and frames queued to the converter are tracked as jobs that complete
+ * in the order they have been queued, regardless of the order in which they
+ * finish processing.
+ *
+ * Derived classes validate the outputs with validateOutputs() and queue a job
+ * with pushJob() for each frame, and call finishJob() from any thread once the
+ * job has been processed. Jobs are then completed from the thread the
+ * converter has been created in by completeJob(), which derived classes can
+ * extend.
+ */
+
+/**
+ * \struct MemoryConverter::Job
+ * \brief A frame queued to the converter
+ *
+ * Derived classes can extend the job with the data they need to process the
+ * frame.
+ *
+ * \var MemoryConverter::Job::input
+ * \brief The input buffer
+ *
+ * \var MemoryConverter::Job::outputs
+ * \brief The output buffers, indexed by output
+ *
+ * \var MemoryConverter::Job::done
+ * \brief Whether the job has been processed
+ */
+
+/**
+ * \brief Construct a MemoryConverter instance
+ * \param[in] media The media device, unused
+ * \param[in] name The converter name, used for tracing and to name buffers
+ */
+MemoryConverter::MemoryConverter(MediaDevice *media, const std::string &name)
+	: Converter(media),
+	  dmaHeap_(DmaBufAllocator::DmaBufAllocatorFlag::CmaHeap |
+		   DmaBufAllocator::DmaBufAllocatorFlag::SystemHeap),
+	  name_(name)
+{
+}
+
+/**
+ * \copydoc libcamera::Converter::exportBuffers
+ */
+int MemoryConverter::exportBuffers(unsigned int output, unsigned int count,
+				   std::vector<std::unique_ptr<FrameBuffer>> *buffers)
+{
+	if (output >= outputConfigs_.size())
+		return -EINVAL;
+
+	const StreamConfiguration &cfg = outputConfigs_[output];
+
+	for (unsigned int i = 0; i < count; ++i) {
+		std::string name = name_ + "-converter-" + std::to_string(output) +
+				   "-" + std::to_string(i);
+
+		UniqueFD fd = dmaHeap_.alloc(name.c_str(), cfg.frameSize);
+		if (!fd.isValid())
+			return -ENOMEM;
+
+		FrameBuffer::Plane plane;
+		plane.fd = SharedFD(std::move(fd));
+		plane.offset = 0;
+		plane.length = cfg.frameSize;
+
+		buffers->push_back(std::make_unique<FrameBuffer>(std::vector{ plane }));
+	}
+
+	return count;
+}
+
+/**
+ * \copydoc libcamera::Converter::start
+ */
+int MemoryConverter::start()
+{
+	return 0;
+}
+
+/**
+ * \brief Validate the output buffers of a frame
+ * \param[in] outputs The output buffers, indexed by output
+ *
+ * At least one output is required, all outputs must reference a configured
+ * stream and no two outputs can reference the same stream.
+ *
+ * \return 0 if the outputs are valid, -EINVAL otherwise
+ */
+int MemoryConverter::validateOutputs(const std::map<unsigned int, FrameBuffer *> &outputs) const
+{
+	unsigned int mask = 0;
+
+	if (outputs.empty())
+		return -EINVAL;
+
+	for (auto [index, buffer] : outputs) {
+		if (!buffer)
+			return -EINVAL;
+		if (index >= outputConfigs_.size())
+			return -EINVAL;
+		if (mask & (1 << index))
+			return -EINVAL;
+
+		mask |= 1 << index;
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Queue a job
+ * \param[in] job The job
+ *
+ * The \a job input and outputs shall be set by the caller. The job is added
+ * to the queue of jobs to complete, and its ownership is transferred to the
+ * converter.
+ *
+ * \return A pointer to the job, valid until it is completed
+ */
+MemoryConverter::Job *MemoryConverter::pushJob(std::unique_ptr<Job> job)
+{
+	LIBCAMERA_TRACEPOINT(converter_queue, name_.c_str(), job->input,
+			     job->outputs.size());
+
+	job->done = false;
+
+	Job *ptr = job.get();
+	jobs_.push(std::move(job));
+
+	return ptr;
+}
+
+/**
+ * \brief Mark a job as processed
+ * \param[in] job The job
+ *
+ * This function may be called from any thread. The \a job is completed
+ * asynchronously in the thread of the converter, after all the jobs queued
+ * before it.
+ */
+void MemoryConverter::finishJob(Job *job)
+{
+	job->done.store(true, std::memory_order_release);
+	invokeMethod(&MemoryConverter::jobDone, ConnectionTypeQueued);
+}
+
+/**
+ * \brief Complete all queued jobs
+ *
+ * This function completes all jobs synchronously, whether they have been
+ * processed or not. It is meant to be called by the stop() implementation of
+ * derived classes, once processing has been stopped.
+ */
+void MemoryConverter::flushJobs()
+{
+	while (!jobs_.empty()) {
+		std::unique_ptr<Job> job = std::move(jobs_.front());
+		jobs_.pop();
+		completeJob(job.get());
+	}
+}
+
+/**
+ * \brief Complete a job
+ * \param[in] job The job
+ *
+ * Copy the sequence and timestamp of the input buffer to the output buffers,
+ * and signal completion of the output and input buffers. The status of the
+ * output buffers shall be set by the caller. Derived classes that override
+ * this function shall call it to complete the buffers.
+ */
+void MemoryConverter::completeJob(Job *job)
+{
+	const FrameMetadata &inputMetadata = job->input->metadata();
+
+	for (auto [index, buffer] : job->outputs) {
+		FrameMetadata &metadata = buffer->_d()->metadata();
+		metadata.sequence = inputMetadata.sequence;
+		metadata.timestamp = inputMetadata.timestamp;
+		metadata.planes()[0].bytesused = outputConfigs_[index].frameSize;
+
+		LIBCAMERA_TRACEPOINT(converter_done, name_.c_str(), buffer);
+
+		outputBufferReady.emit(buffer);
+	}
+
+	inputBufferReady.emit(job->input);
+}
+
+/*
+ * Complete the jobs at the head of the queue that have been processed. Jobs
+ * may finish out of order, but are completed in the order they have been
+ * queued.
+ */
+void MemoryConverter::jobDone()
+{
+	while (!jobs_.empty() &&
+	       jobs_.front()->done.load(std::memory_order_acquire)) {
+		std::unique_ptr<Job> job = std::move(jobs_.front());
+		jobs_.pop();
+		completeJob(job.get());
+	}
+}
+
+} /* namespace libcamera */
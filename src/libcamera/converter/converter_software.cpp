@@ -0,0 +1,350 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * converter_software.cpp - CPU-based format converter
+ */
+
+#include "libcamera/internal/converter/converter_software.h"
+
+#include <algorithm>
+#include <cmath>
+#include <errno.h>
+#include <string.h>
+
+#include <libcamera/base/log.h>
+#include <libcamera/base/shared_fd.h>
+#include <libcamera/base/utils.h>
+
+#include <libcamera/framebuffer.h>
+#include <libcamera/geometry.h>
+
+#include "libcamera/internal/formats.h"
+#include "libcamera/internal/framebuffer.h"
+
+/**
+ * \file internal/converter/converter_software.h
+ * \brief CPU-based format converter
+ */
+
+namespace libcamera {
+
+LOG_DECLARE_CATEGORY(Converter)
+
+/**
+ * \class SoftwareConverter
+ * \brief Format converter running on the CPU
+ *
+ * The SoftwareConverter class implements a Converter that processes raw Bayer
+ * images on the CPU, for platforms that have no hardware ISP or memory-to-
+ * memory converter. It uses the DebayerCpu class to interpolate the colour
+ * components, subtract the black level, apply white balance gains and gamma
+ * correction, and writes the result to one or more RGB outputs of the same
+ * size.
+ *
+ * Frames are split in horizontal strips processed concurrently by a
+ * ThreadPool, one strip per thread. Frames complete in the order they are
+ * queued, and completion is signalled from the thread the converter has been
+ * created in.
+ *
+ * Statistics are gathered on the raw pixels while debayering, and stored in
+ * shared memory to be consumed by an IPA module. The white balance gains are
+ * computed with a grey world algorithm from the statistics of the previous
+ * frame. As the converter is not backed by any
+ * device, it is created by name from the ConverterFactoryBase and ignores the
+ * media device it is given.
+ */
+
+/**
+ * \brief Construct a SoftwareConverter instance
+ * \param[in] media The media device, unused
+ */
+SoftwareConverter::SoftwareConverter(MediaDevice *media)
+	: MemoryConverter(media, "software"), bitDepth_(0),
+	  stats_("softIsp.stats"), pool_("SoftISP", kMaxThreads)
+{
+	for (unsigned int i = 0; i < gamma_.size(); ++i) {
+		double value = std::pow(i / (gamma_.size() - 1.0), 1.0 / 2.2);
+		gamma_[i] = std::lround(value * 255.0);
+	}
+
+	strips_.resize(pool_.threads());
+}
+
+SoftwareConverter::~SoftwareConverter()
+{
+	pool_.wait();
+}
+
+/**
+ * \fn SoftwareConverter::statistics()
+ * \brief Retrieve the file descriptor of the statistics shared memory
+ *
+ * The shared memory stores a SoftwareStatistics structure, updated with the
+ * statistics of each frame before the statisticsReady signal is emitted.
+ *
+ * \return The file descriptor of the statistics shared memory
+ */
+
+/**
+ * \var SoftwareConverter::statisticsReady
+ * \brief A signal emitted when the statistics for a frame are available
+ *
+ * The signal carries the sequence number of the input frame the statistics
+ * have been computed on.
+ */
+
+/**
+ * \copydoc libcamera::Converter::formats
+ */
+std::vector<PixelFormat> SoftwareConverter::formats(PixelFormat input)
+{
+	if (!DebayerCpu::isSupportedInput(input))
+		return {};
+
+	return DebayerCpu::outputFormats();
+}
+
+/**
+ * \copydoc libcamera::Converter::sizes
+ *
+ * The converter doesn't scale images. As debayering requires even dimensions,
+ * the output size is the input size rounded down to a multiple of 2.
+ */
+SizeRange SoftwareConverter::sizes(const Size &input)
+{
+	return SizeRange(input.alignedDownTo(2, 2));
+}
+
+/**
+ * \copydoc libcamera::Converter::strideAndFrameSize
+ */
+std::tuple<unsigned int, unsigned int>
+SoftwareConverter::strideAndFrameSize(const PixelFormat &pixelFormat,
+				      const Size &size)
+{
+	if (!DebayerCpu::isSupportedOutput(pixelFormat))
+		return std::make_tuple(0, 0);
+
+	const PixelFormatInfo &info = PixelFormatInfo::info(pixelFormat);
+
+	return std::make_tuple(info.stride(size.width, 0, 1),
+			       info.frameSize(size, 1));
+}
+
+/**
+ * \copydoc libcamera::Converter::configure
+ */
+int SoftwareConverter::configure(const StreamConfiguration &inputCfg,
+				 const std::vector<std::reference_wrapper<StreamConfiguration>> &outputCfgs)
+{
+	outputConfigs_.clear();
+
+	if (outputCfgs.empty())
+		return -EINVAL;
+
+	Size size = sizes(inputCfg.size).max;
+
+	for (const StreamConfiguration &cfg : outputCfgs) {
+		const auto [stride, frameSize] =
+			strideAndFrameSize(cfg.pixelFormat, cfg.size);
+
+		if (!stride || cfg.size != size || cfg.stride < stride) {
+			LOG(Converter, Error)
+				<< "Unsupported output configuration "
+				<< cfg.toString() << " for input "
+				<< inputCfg.toString();
+			return -EINVAL;
+		}
+	}
+
+	/*
+	 * Split the image in strips of even height, one per thread. The
+	 * debayering code reads the lines surrounding each strip from the
+	 * input image, so strips are independent of each other.
+	 */
+	unsigned int pairs = size.height / 2;
+	unsigned int numStrips = strips_.size();
+
+	for (unsigned int i = 0; i < numStrips; ++i) {
+		Strip &strip = strips_[i];
+
+		strip.start = pairs * i / numStrips * 2;
+		strip.end = pairs * (i + 1) / numStrips * 2;
+
+		int ret = strip.debayer.configure(inputCfg.pixelFormat, size,
+						  inputCfg.stride);
+		if (ret < 0)
+			return ret;
+	}
+
+	bitDepth_ = BayerFormat::fromPixelFormat(inputCfg.pixelFormat).bitDepth;
+
+	for (const StreamConfiguration &cfg : outputCfgs)
+		outputConfigs_.push_back(cfg);
+
+	gains_ = { 1.0, 1.0, 1.0 };
+	updateTables();
+
+	return 0;
+}
+
+/**
+ * \copydoc libcamera::Converter::stop
+ *
+ * Frames queued to the converter are processed before this function returns,
+ * and their completion is signalled synchronously.
+ */
+void SoftwareConverter::stop()
+{
+	/* Wait for all the strips queued to the pool to be processed. */
+	pool_.wait();
+
+	flushJobs();
+}
+
+/**
+ * \copydoc libcamera::Converter::queueBuffers
+ */
+int SoftwareConverter::queueBuffers(FrameBuffer *input,
+				    const std::map<unsigned int, FrameBuffer *> &outputs)
+{
+	int ret = validateOutputs(outputs);
+	if (ret)
+		return ret;
+
+	std::unique_ptr<Job> job = std::make_unique<Job>();
+	job->input = input;
+	job->outputs = outputs;
+
+	job->maps.reserve(outputs.size() + 1);
+	job->maps.emplace_back(input, MappedFrameBuffer::MapFlag::Read);
+	job->syncers.emplace_back(input->planes()[0].fd,
+				  DmaSyncer::SyncType::Read);
+
+	for (auto [index, buffer] : outputs) {
+		const StreamConfiguration &cfg = outputConfigs_[index];
+
+		job->maps.emplace_back(buffer, MappedFrameBuffer::MapFlag::Write);
+		job->syncers.emplace_back(buffer->planes()[0].fd,
+					  DmaSyncer::SyncType::Write);
+		job->destinations.push_back({ job->maps.back().planes()[0].data(),
+					      cfg.stride, cfg.pixelFormat });
+	}
+
+	for (const MappedFrameBuffer &map : job->maps) {
+		if (!map.isValid()) {
+			LOG(Converter, Error)
+				<< "Failed to map buffer: " << strerror(map.error());
+			return -map.error();
+		}
+	}
+
+	job->tables = tables_;
+	job->stats = {};
+
+	Job *ptr = static_cast<Job *>(pushJob(std::move(job)));
+
+	pool_.queueStrips([this, ptr](unsigned int index, [[maybe_unused]] unsigned int count) {
+		processStrip(ptr, index);
+	}, [this, ptr]() { finishJob(ptr); });
+
+	return 0;
+}
+
+void SoftwareConverter::processStrip(Job *job, unsigned int index)
+{
+	Strip &strip = strips_[index];
+
+	strip.debayer.process(job->maps[0].planes()[0].data(), job->destinations,
+			      strip.start, strip.end, *job->tables,
+			      &job->stats[index]);
+}
+
+void SoftwareConverter::completeJob(MemoryConverter::Job *baseJob)
+{
+	Job *job = static_cast<Job *>(baseJob);
+
+	/* End CPU access before handing the buffers back. */
+	job->syncers.clear();
+	job->maps.clear();
+
+	/* Merge the statistics of all strips in the shared memory. */
+	SoftwareStatistics &stats = *stats_;
+	stats = job->stats[0];
+
+	for (unsigned int i = 1; i < strips_.size(); ++i) {
+		const SoftwareStatistics &strip = job->stats[i];
+
+		for (unsigned int c = 0; c < 3; ++c) {
+			stats.sum[c] += strip.sum[c];
+			stats.count[c] += strip.count[c];
+		}
+
+		for (unsigned int zone = 0; zone < SoftwareStatistics::kNumZones; ++zone) {
+			for (unsigned int c = 0; c < 3; ++c)
+				stats.zoneSums[zone][c] += strip.zoneSums[zone][c];
+			stats.zoneCounts[zone] += strip.zoneCounts[zone];
+		}
+
+		for (unsigned int bin = 0; bin < SoftwareStatistics::kHistogramBins; ++bin)
+			stats.histogram[bin] += strip.histogram[bin];
+	}
+
+	/* Compute the white balance gains with a grey world algorithm. */
+	std::array<double, 3> means;
+	double black = 16 << (bitDepth_ - 8);
+
+	for (unsigned int c = 0; c < 3; ++c) {
+		means[c] = stats.count[c]
+			 ? std::max(static_cast<double>(stats.sum[c]) / stats.count[c] - black, 1.0)
+			 : 1.0;
+	}
+
+	gains_[DebayerCpu::Red] = std::clamp(means[DebayerCpu::Green] / means[DebayerCpu::Red],
+					     0.25, 4.0);
+	gains_[DebayerCpu::Blue] = std::clamp(means[DebayerCpu::Green] / means[DebayerCpu::Blue],
+					      0.25, 4.0);
+	updateTables();
+
+	for (auto [index, buffer] : job->outputs)
+		buffer->_d()->metadata().status = FrameMetadata::FrameSuccess;
+
+	MemoryConverter::completeJob(job);
+
+	statisticsReady.emit(job->input->metadata().sequence);
+}
+
+/*
+ * Compute the lookup tables that map raw pixel values to output values, by
+ * subtracting the black level, applying the white balance gains and
+ * normalizing the result to index the gamma table. Tables are shared with the
+ * jobs in flight, new tables are thus allocated every time.
+ */
+void SoftwareConverter::updateTables()
+{
+	std::shared_ptr<DebayerCpu::Tables> tables =
+		std::make_shared<DebayerCpu::Tables>();
+
+	const unsigned int size = 1 << bitDepth_;
+	const unsigned int black = 16 << (bitDepth_ - 8);
+	const double scale = (gamma_.size() - 1.0) / (size - 1 - black);
+
+	for (unsigned int c = 0; c < 3; ++c) {
+		std::vector<uint8_t> &lut = tables->lut[c];
+		lut.resize(size);
+
+		for (unsigned int value = 0; value < size; ++value) {
+			double index = (static_cast<double>(value) - black) *
+				       gains_[c] * scale;
+			index = std::clamp(index, 0.0, gamma_.size() - 1.0);
+			lut[value] = gamma_[std::lround(index)];
+		}
+	}
+
+	tables_ = std::move(tables);
+}
+
+REGISTER_CONVERTER("software", SoftwareConverter, {})
+
+} /* namespace libcamera */
@@ -19,7 +19,9 @@
 #include <libcamera/geometry.h>
 #include <libcamera/stream.h>
 
+#include "libcamera/internal/framebuffer.h"
 #include "libcamera/internal/media_device.h"
+#include "libcamera/internal/tracepoints.h"
 #include "libcamera/internal/v4l2_videodevice.h"
 
 /**
@@ -36,7 +38,8 @@ LOG_DECLARE_CATEGORY(Converter)
  */
 
 V4L2M2MConverter::Stream::Stream(V4L2M2MConverter *converter, unsigned int index)
-	: converter_(converter), index_(index)
+	: converter_(converter), index_(index), inputBufferCount_(0),
+	  outputBufferCount_(0), queuedInputs_(0), stats_{}
 {
 	m2m_ = std::make_unique<V4L2M2MDevice>(converter->deviceNode());
 
@@ -101,6 +104,20 @@ int V4L2M2MConverter::Stream::configure(const StreamConfiguration &inputCfg,
 	return 0;
 }
 
+/*
+ * The context is ready to accept a job when it has pending jobs and free V4L2
+ * buffers on both queues. Jobs are queued ahead up to the number of buffers,
+ * to keep the device busy while completed jobs are being handled. The input
+ * and output buffers of a job are dequeued separately, free buffers are thus
+ * tracked for each queue.
+ */
+bool V4L2M2MConverter::Stream::isReady() const
+{
+	return !pending_.empty() &&
+	       queuedInputs_ < inputBufferCount_ &&
+	       inFlight_.size() < outputBufferCount_;
+}
+
 int V4L2M2MConverter::Stream::exportBuffers(unsigned int count,
 					    std::vector<std::unique_ptr<FrameBuffer>> *buffers)
 {
@@ -131,28 +148,98 @@ int V4L2M2MConverter::Stream::start()
 		return ret;
 	}
 
+	queuedInputs_ = 0;
+	stats_ = {};
+	startTime_ = utils::clock::now();
+
 	return 0;
 }
 
 void V4L2M2MConverter::Stream::stop()
 {
+	/* Jobs that haven't been queued to the device are cancelled. */
+	while (!pending_.empty()) {
+		auto [input, output] = pending_.front();
+		pending_.pop();
+		cancelJob(input, output);
+	}
+
 	m2m_->capture()->streamOff();
 	m2m_->output()->streamOff();
 	m2m_->capture()->releaseBuffers();
 	m2m_->output()->releaseBuffers();
+
+	inFlight_ = {};
+	queuedInputs_ = 0;
+
+	if (startTime_ != utils::time_point()) {
+		stats_.activeTime += utils::clock::now() - startTime_;
+		startTime_ = {};
+
+		LOG(Converter, Debug)
+			<< stats_.frames << " frames, utilization "
+			<< stats_.utilization() * 100 << "%, average latency "
+			<< (stats_.frames ? stats_.latency.get<std::milli>() / stats_.frames : 0)
+			<< "ms, max queue depth " << stats_.maxQueueDepth;
+	}
+}
+
+int V4L2M2MConverter::Stream::setInputCrop(Rectangle *rect)
+{
+	return m2m_->output()->setSelection(V4L2_SEL_TGT_CROP, rect);
 }
 
-int V4L2M2MConverter::Stream::queueBuffers(FrameBuffer *input, FrameBuffer *output)
+void V4L2M2MConverter::Stream::addJob(FrameBuffer *input, FrameBuffer *output)
 {
+	pending_.emplace(input, output);
+}
+
+void V4L2M2MConverter::Stream::queueJob()
+{
+	auto [input, output] = pending_.front();
+	pending_.pop();
+
 	int ret = m2m_->output()->queueBuffer(input);
-	if (ret < 0)
-		return ret;
+	if (ret < 0) {
+		LOG(Converter, Error)
+			<< "Failed to queue input buffer: " << strerror(-ret);
+		cancelJob(input, output);
+		return;
+	}
+
+	queuedInputs_++;
 
 	ret = m2m_->capture()->queueBuffer(output);
-	if (ret < 0)
-		return ret;
+	if (ret < 0) {
+		/* The input buffer will complete through the device. */
+		LOG(Converter, Error)
+			<< "Failed to queue output buffer: " << strerror(-ret);
+		cancelJob(nullptr, output);
+		return;
+	}
 
-	return 0;
+	inFlight_.push(utils::clock::now());
+	stats_.maxQueueDepth = std::max<unsigned int>(stats_.maxQueueDepth,
+						      inFlight_.size());
+}
+
+void V4L2M2MConverter::Stream::cancelJob(FrameBuffer *input, FrameBuffer *output)
+{
+	output->_d()->cancel();
+	converter_->outputBufferReady.emit(output);
+
+	if (input)
+		releaseInput(input);
+}
+
+V4L2M2MConverter::Statistics V4L2M2MConverter::Stream::statistics() const
+{
+	Statistics stats = stats_;
+
+	if (startTime_ != utils::time_point())
+		stats.activeTime += utils::clock::now() - startTime_;
+
+	return stats;
 }
 
 std::string V4L2M2MConverter::Stream::logPrefix() const
@@ -160,7 +247,7 @@ std::string V4L2M2MConverter::Stream::logPrefix() const
 	return "stream" + std::to_string(index_);
 }
 
-void V4L2M2MConverter::Stream::outputBufferReady(FrameBuffer *buffer)
+void V4L2M2MConverter::Stream::releaseInput(FrameBuffer *buffer)
 {
 	auto it = converter_->queue_.find(buffer);
 	if (it == converter_->queue_.end())
@@ -172,9 +259,45 @@ void V4L2M2MConverter::Stream::outputBufferReady(FrameBuffer *buffer)
 	}
 }
 
+void V4L2M2MConverter::Stream::outputBufferReady(FrameBuffer *buffer)
+{
+	if (queuedInputs_)
+		queuedInputs_--;
+
+	releaseInput(buffer);
+
+	converter_->schedule();
+}
+
 void V4L2M2MConverter::Stream::captureBufferReady(FrameBuffer *buffer)
 {
+	/*
+	 * Contexts share the device and their jobs are executed one at a
+	 * time. The processing time of a job is thus measured from the later
+	 * of the time it was queued and the completion of the previous job on
+	 * any context.
+	 */
+	if (!inFlight_.empty()) {
+		utils::time_point queued = inFlight_.front();
+		inFlight_.pop();
+
+		if (buffer->metadata().status == FrameMetadata::FrameSuccess) {
+			utils::time_point now = utils::clock::now();
+			utils::time_point start = std::max(queued, converter_->lastCompletion_);
+
+			stats_.frames++;
+			stats_.busyTime += now - start;
+			stats_.latency += now - queued;
+			converter_->lastCompletion_ = now;
+		}
+	}
+
+	LIBCAMERA_TRACEPOINT(converter_done, "v4l2_m2m", buffer);
+
 	converter_->outputBufferReady.emit(buffer);
+
+	/* Refill the device with the jobs waiting for a free context. */
+	converter_->schedule();
 }
 
 /* -----------------------------------------------------------------------------
@@ -185,8 +308,53 @@ void V4L2M2MConverter::Stream::captureBufferReady(FrameBuffer *buffer)
  * \class libcamera::V4L2M2MConverter
  * \brief The V4L2 M2M converter implements the converter interface based on
  * V4L2 M2M device.
+ *
+ * Each output stream is handled by a separate context of the M2M device, and
+ * the device executes jobs from the contexts one at a time. To keep the device
+ * busy, jobs are queued ahead to each context up to its number of buffers, and
+ * jobs that can't be queued yet are held by the converter. Held jobs are
+ * submitted as contexts complete previous jobs, one job per context in a
+ * round-robin order, to interleave the contexts in the device job queue.
+ *
+ * The converter measures the share of time each context occupies the device,
+ * reported through statistics().
 */
 
+/**
+ * \struct V4L2M2MConverter::Statistics
+ * \brief Processing statistics of a converter output
+ *
+ * \var V4L2M2MConverter::Statistics::frames
+ * \brief Number of frames successfully processed
+ *
+ * \var V4L2M2MConverter::Statistics::maxQueueDepth
+ * \brief Maximum number of jobs queued to the device at the same time
+ *
+ * \var V4L2M2MConverter::Statistics::busyTime
+ * \brief Accumulated time the device has spent processing frames
+ *
+ * The busy time is estimated from the job completion times, assuming that the
+ * device processes one job at a time.
+ *
+ * \var V4L2M2MConverter::Statistics::latency
+ * \brief Accumulated time between queuing frames and their completion
+ *
+ * \var V4L2M2MConverter::Statistics::activeTime
+ * \brief Accumulated time the converter has been running
+ */
+
+/**
+ * \brief Compute the share of time the device has spent on the output
+ * \return The ratio of the busy time to the active time, in the [0, 1] range
+ */
+double V4L2M2MConverter::Statistics::utilization() const
+{
+	if (activeTime.get<std::nano>() <= 0)
+		return 0.0;
+
+	return std::min(busyTime / activeTime, 1.0);
+}
+
 /**
  * \fn V4L2M2MConverter::V4L2M2MConverter
  * \brief Construct a V4L2M2MConverter instance
@@ -194,7 +362,7 @@ void V4L2M2MConverter::Stream::captureBufferReady(FrameBuffer *buffer)
  */
 
 V4L2M2MConverter::V4L2M2MConverter(MediaDevice *media)
-	: Converter(media)
+	: Converter(media), nextStream_(0)
 {
 	if (deviceNode().empty())
 		return;
@@ -377,6 +545,9 @@ int V4L2M2MConverter::start()
 {
 	int ret;
 
+	nextStream_ = 0;
+	lastCompletion_ = {};
+
 	for (Stream &stream : streams_) {
 		ret = stream.start();
 		if (ret < 0) {
@@ -404,7 +575,6 @@ int V4L2M2MConverter::queueBuffers(FrameBuffer *input,
 				   const std::map<unsigned int, FrameBuffer *> &outputs)
 {
 	unsigned int mask = 0;
-	int ret;
 
 	/*
 	 * Validate the outputs as a sanity check: at least one output is
@@ -425,26 +595,78 @@ int V4L2M2MConverter::queueBuffers(FrameBuffer *input,
 		mask |= 1 << index;
 	}
 
-	/* Queue the input and output buffers to all the streams. */
-	for (auto [index, buffer] : outputs) {
-		ret = streams_[index].queueBuffers(input, buffer);
-		if (ret < 0)
-			return ret;
-	}
-
 	/*
 	 * Add the input buffer to the queue, with the number of streams as a
 	 * reference count. Completion of the input buffer will be signalled by
 	 * the stream that releases the last reference.
 	 */
+	LIBCAMERA_TRACEPOINT(converter_queue, "v4l2_m2m", input, outputs.size());
+
 	queue_.emplace(std::piecewise_construct,
 		       std::forward_as_tuple(input),
 		       std::forward_as_tuple(outputs.size()));
 
+	for (auto [index, buffer] : outputs)
+		streams_[index].addJob(input, buffer);
+
+	schedule();
+
 	return 0;
 }
 
+/**
+ * \copydoc libcamera::Converter::setInputCrop
+ */
+int V4L2M2MConverter::setInputCrop(unsigned int output, Rectangle *rect)
+{
+	if (output >= streams_.size())
+		return -EINVAL;
+
+	return streams_[output].setInputCrop(rect);
+}
+
+/**
+ * \brief Retrieve the processing statistics of an output
+ * \param[in] output The output index
+ *
+ * The statistics are reset when the converter is started, and cover the
+ * current or last capture session.
+ *
+ * \return The statistics of the output, or default statistics if \a output is
+ * not a valid output index
+ */
+V4L2M2MConverter::Statistics V4L2M2MConverter::statistics(unsigned int output) const
+{
+	if (output >= streams_.size())
+		return {};
+
+	return streams_[output].statistics();
+}
+
+/*
+ * Queue held jobs to the device, taking one job from each ready context in
+ * turn, until no context is ready.
+ */
+void V4L2M2MConverter::schedule()
+{
+	unsigned int idle = 0;
+
+	while (!streams_.empty() && idle < streams_.size()) {
+		Stream &stream = streams_[nextStream_];
+		nextStream_ = (nextStream_ + 1) % streams_.size();
+
+		if (!stream.isReady()) {
+			idle++;
+			continue;
+		}
+
+		stream.queueJob();
+		idle = 0;
+	}
+}
+
 static std::initializer_list<std::string> compatibles = {
+	"dw100",
 	"pxp",
 };
 
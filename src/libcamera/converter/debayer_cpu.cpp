@@ -0,0 +1,611 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * debayer_cpu.cpp - CPU implementation of Bayer to RGB conversion
+ */
+
+#include "libcamera/internal/converter/debayer_cpu.h"
+
+#include <errno.h>
+#include <string.h>
+#include <utility>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <libcamera/base/log.h>
+#include <libcamera/base/utils.h>
+
+#include <libcamera/formats.h>
+
+/**
+ * \file internal/converter/debayer_cpu.h
+ * \brief CPU implementation of Bayer to RGB conversion
+ */
+
+namespace libcamera {
+
+LOG_DECLARE_CATEGORY(Converter)
+
+namespace {
+
+/*
+ * Number of pixels of padding on each side of the unpacked lines. The padding
+ * stores the mirrored border pixels, and lets the interpolation kernels load
+ * full vectors past the end of the line. It is a multiple of the vector size
+ * to keep the line data aligned.
+ */
+constexpr unsigned int kPadding = 8;
+
+/* Number of 16-bit pixels processed in one iteration of the vector kernels. */
+constexpr unsigned int kVectorSize = 8;
+
+template<unsigned int Bpp, unsigned int R, unsigned int G, unsigned int B>
+void pack(uint8_t *dst, const uint8_t *r, const uint8_t *g, const uint8_t *b,
+	  unsigned int width)
+{
+	for (unsigned int x = 0; x < width; ++x) {
+		dst[R] = r[x];
+		dst[G] = g[x];
+		dst[B] = b[x];
+		if constexpr (Bpp == 4)
+			dst[3] = 0xff;
+
+		dst += Bpp;
+	}
+}
+
+} /* namespace */
+
+/**
+ * \class DebayerCpu
+ * \brief Convert raw Bayer images to RGB on the CPU
+ *
+ * The DebayerCpu class implements the image processing operations of the
+ * SoftwareConverter. It converts raw Bayer images to RGB with bilinear
+ * interpolation, and applies black level subtraction, white balance gains and
+ * gamma correction through per-colour lookup tables indexed by the raw pixel
+ * values. As the black level and gains are linear operations, applying them
+ * after interpolation is equivalent to applying them to the raw pixels, and
+ * folds the whole colour processing in a single table lookup per colour
+ * component.
+ *
+ * Images are processed one line at a time. Each input line is unpacked to
+ * 16-bit pixels once, and the neighbour averages used by the interpolation are
+ * computed for the whole line with NEON or SSE2 vector instructions when
+ * available, before the lookup tables are applied and the result is packed to
+ * the output format.
+ *
+ * Processing operates on horizontal strips of the image, to let callers split
+ * frames across multiple threads. Lines above and below a strip are read from
+ * the input image, so strips can be processed in any order and concurrently by
+ * different instances of the class, and produce the same result as processing
+ * the whole image in one go. The image borders are handled by mirroring.
+ */
+
+/**
+ * \enum DebayerCpu::Colour
+ * \brief Colour components, used as indices in the tables and statistics
+ * \var DebayerCpu::Red
+ * \brief The red component
+ * \var DebayerCpu::Green
+ * \brief The green component
+ * \var DebayerCpu::Blue
+ * \brief The blue component
+ */
+
+/**
+ * \struct DebayerCpu::Tables
+ * \brief Lookup tables applied to the interpolated pixels
+ *
+ * \var DebayerCpu::Tables::lut
+ * \brief Per-colour tables mapping raw pixel values to 8-bit output values
+ *
+ * Each table must hold one entry per raw pixel value, as reported by
+ * bitDepth().
+ */
+
+/**
+ * \file internal/converter/software_statistics.h
+ * \brief Statistics generated by the software converter
+ */
+
+/**
+ * \struct SoftwareStatistics
+ * \brief Statistics gathered on the raw pixels while debayering
+ *
+ * The statistics are computed by DebayerCpu in the same pass as debayering, on
+ * the unpacked lines, without reading the image a second time. The per-colour
+ * sums cover all pixels. The zone sums and the histogram are computed on a
+ * subsampled grid of 2x2 Bayer quads, taking one quad out of two horizontally
+ * on one line pair out of two.
+ *
+ * The structure is shared with IPA modules and thus doesn't contain any
+ * pointer.
+ *
+ * \var SoftwareStatistics::kGridWidth
+ * \brief Number of zones horizontally
+ *
+ * \var SoftwareStatistics::kGridHeight
+ * \brief Number of zones vertically
+ *
+ * \var SoftwareStatistics::kNumZones
+ * \brief Total number of zones
+ *
+ * \var SoftwareStatistics::kHistogramBins
+ * \brief Number of bins of the luminance histogram
+ *
+ * \var SoftwareStatistics::sum
+ * \brief Per-colour sum of the raw pixel values, indexed by DebayerCpu::Colour
+ *
+ * \var SoftwareStatistics::count
+ * \brief Per-colour number of pixels accumulated in \a sum
+ *
+ * \var SoftwareStatistics::zoneSums
+ * \brief Per-zone sums of the red, green and blue values of the sampled quads
+ *
+ * The green value of a quad is the average of its two green pixels. Zones are
+ * stored in raster scan order.
+ *
+ * \var SoftwareStatistics::zoneCounts
+ * \brief Per-zone number of quads accumulated in \a zoneSums
+ *
+ * \var SoftwareStatistics::histogram
+ * \brief Histogram of the luminance of the sampled quads
+ *
+ * The luminance of a quad is the average of its four raw pixel values. The
+ * histogram covers the full range of raw values, black level included.
+ */
+
+/**
+ * \struct DebayerCpu::Output
+ * \brief Destination of the processed image
+ *
+ * \var DebayerCpu::Output::data
+ * \brief Pointer to the first line of the output image
+ *
+ * \var DebayerCpu::Output::stride
+ * \brief Line stride of the output image in bytes
+ *
+ * \var DebayerCpu::Output::format
+ * \brief Pixel format of the output image
+ */
+
+/**
+ * \brief Check if a pixel format can be converted
+ * \param[in] format The input pixel format
+ *
+ * Supported inputs are 8-, 10- and 12-bit Bayer formats, either unpacked or
+ * packed in the MIPI CSI-2 format.
+ *
+ * \return True if \a format is supported as an input, false otherwise
+ */
+bool DebayerCpu::isSupportedInput(const PixelFormat &format)
+{
+	BayerFormat bayer = BayerFormat::fromPixelFormat(format);
+	if (!bayer.isValid() || bayer.order == BayerFormat::MONO)
+		return false;
+
+	switch (bayer.packing) {
+	case BayerFormat::Packing::None:
+		return bayer.bitDepth == 8 || bayer.bitDepth == 10 ||
+		       bayer.bitDepth == 12;
+	case BayerFormat::Packing::CSI2:
+		return bayer.bitDepth == 10 || bayer.bitDepth == 12;
+	default:
+		return false;
+	}
+}
+
+/**
+ * \brief Check if a pixel format can be produced
+ * \param[in] format The output pixel format
+ * \return True if \a format is supported as an output, false otherwise
+ */
+bool DebayerCpu::isSupportedOutput(const PixelFormat &format)
+{
+	return packFunction(format) != nullptr;
+}
+
+/**
+ * \brief Retrieve the list of supported output pixel formats
+ * \return The list of supported output pixel formats
+ */
+const std::vector<PixelFormat> &DebayerCpu::outputFormats()
+{
+	static const std::vector<PixelFormat> formats = {
+		formats::RGB888,
+		formats::BGR888,
+		formats::XRGB8888,
+		formats::XBGR8888,
+		formats::ARGB8888,
+		formats::ABGR8888,
+	};
+
+	return formats;
+}
+
+DebayerCpu::PackFunction DebayerCpu::packFunction(const PixelFormat &format)
+{
+	/* DRM formats are stored in little-endian order. */
+	switch (format) {
+	case formats::RGB888:
+		return pack<3, 2, 1, 0>;
+	case formats::BGR888:
+		return pack<3, 0, 1, 2>;
+	case formats::XRGB8888:
+	case formats::ARGB8888:
+		return pack<4, 2, 1, 0>;
+	case formats::XBGR8888:
+	case formats::ABGR8888:
+		return pack<4, 0, 1, 2>;
+	default:
+		return nullptr;
+	}
+}
+
+/**
+ * \brief Configure the input format
+ * \param[in] inputFormat The input pixel format
+ * \param[in] size The image size
+ * \param[in] stride The input line stride in bytes
+ *
+ * The image width and height must be even and at least 2 pixels, to preserve
+ * the Bayer pattern parity when mirroring the borders.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int DebayerCpu::configure(const PixelFormat &inputFormat, const Size &size,
+			  unsigned int stride)
+{
+	if (!isSupportedInput(inputFormat)) {
+		LOG(Converter, Error)
+			<< "Unsupported input format " << inputFormat;
+		return -EINVAL;
+	}
+
+	if (size.width < 2 || size.height < 2 || size.width % 2 ||
+	    size.height % 2) {
+		LOG(Converter, Error) << "Unsupported input size " << size;
+		return -EINVAL;
+	}
+
+	bayer_ = BayerFormat::fromPixelFormat(inputFormat);
+
+	unsigned int minStride;
+	if (bayer_.packing == BayerFormat::Packing::CSI2)
+		minStride = bayer_.bitDepth == 10
+			  ? utils::alignUp(size.width, 4) * 5 / 4
+			  : utils::alignUp(size.width, 2) * 3 / 2;
+	else
+		minStride = size.width * (bayer_.bitDepth > 8 ? 2 : 1);
+
+	if (stride < minStride) {
+		LOG(Converter, Error)
+			<< "Input stride " << stride << " too small for "
+			<< size << "-" << inputFormat;
+		return -EINVAL;
+	}
+
+	size_ = size;
+	stride_ = stride;
+
+	/* Colours of the 2x2 Bayer pattern, indexed by BayerFormat::Order. */
+	static constexpr Colour patterns[4][2][2] = {
+		{ { Blue, Green }, { Green, Red } },
+		{ { Green, Blue }, { Red, Green } },
+		{ { Green, Red }, { Blue, Green } },
+		{ { Red, Green }, { Green, Blue } },
+	};
+
+	memcpy(colours_, patterns[bayer_.order], sizeof(colours_));
+
+	/*
+	 * Record the position of each colour in the quad, as the line (top or
+	 * bottom) times two plus the column, to sample the quads independently
+	 * of the Bayer pattern.
+	 */
+	unsigned int greens = 0;
+	for (unsigned int position = 0; position < 4; ++position) {
+		switch (colours_[position >> 1][position & 1]) {
+		case Red:
+			redPosition_ = position;
+			break;
+		case Green:
+			greenPositions_[greens++] = position;
+			break;
+		case Blue:
+			bluePosition_ = position;
+			break;
+		}
+	}
+
+	/* Precompute the zone column of each sampled quad. */
+	zoneColumns_.resize(utils::alignUp(size.width, 4) / 4);
+	for (unsigned int i = 0; i < zoneColumns_.size(); ++i)
+		zoneColumns_[i] = i * 4 * SoftwareStatistics::kGridWidth / size.width;
+
+	unsigned int width = utils::alignUp(size.width, kVectorSize);
+
+	for (std::vector<uint16_t> &line : lines_)
+		line.assign(width + kPadding * 2, 0);
+
+	horizontal_.assign(width, 0);
+	vertical_.assign(width, 0);
+	cross_.assign(width, 0);
+	diagonal_.assign(width, 0);
+
+	for (std::vector<uint8_t> &line : rgb_)
+		line.assign(size.width, 0);
+
+	return 0;
+}
+
+/**
+ * \fn DebayerCpu::bitDepth()
+ * \brief Retrieve the bit depth of the input pixels
+ * \return The number of bits per input pixel
+ */
+
+/**
+ * \brief Process a strip of the image
+ * \param[in] input Pointer to the first line of the input image
+ * \param[in] outputs The output images
+ * \param[in] start The first line of the strip
+ * \param[in] end The line after the last line of the strip
+ * \param[in] tables The lookup tables to apply to the pixels
+ * \param[out] stats The statistics for the strip
+ *
+ * The \a start and \a end lines must be even. The lines of the strip are
+ * written to all \a outputs, whose formats must be supported. The statistics
+ * of the raw pixels in the strip are accumulated in \a stats, which the caller
+ * shall zero-initialize before processing the first strip of a frame.
+ */
+void DebayerCpu::process(const uint8_t *input, Span<const Output> outputs,
+			 unsigned int start, unsigned int end,
+			 const Tables &tables, SoftwareStatistics *stats)
+{
+	std::vector<PackFunction> packers;
+	for (const Output &output : outputs)
+		packers.push_back(packFunction(output.format));
+
+	uint16_t *prev = lines_[0].data() + kPadding;
+	uint16_t *cur = lines_[1].data() + kPadding;
+	uint16_t *next = lines_[2].data() + kPadding;
+
+	unpackLine(input + mirror(static_cast<int>(start) - 1) * stride_, prev);
+	unpackLine(input + start * stride_, cur);
+
+	for (unsigned int y = start; y < end; ++y) {
+		unpackLine(input + mirror(y + 1) * stride_, next);
+
+		const Colour *colours = colours_[y & 1];
+		uint64_t sums[2] = { 0, 0 };
+
+		for (unsigned int x = 0; x < size_.width; x += 2) {
+			sums[0] += cur[x];
+			sums[1] += cur[x + 1];
+		}
+
+		for (unsigned int i = 0; i < 2; ++i) {
+			stats->sum[colours[i]] += sums[i];
+			stats->count[colours[i]] += size_.width / 2;
+		}
+
+		/* Sample the quads of one line pair out of two. */
+		if ((y & 3) == 1)
+			statsQuads(y - 1, prev, cur, stats);
+
+		interpolateLine(prev, cur, next);
+		lookupLine(y, cur, tables);
+
+		for (unsigned int i = 0; i < outputs.size(); ++i)
+			packers[i](outputs[i].data + y * outputs[i].stride,
+				   rgb_[Red].data(), rgb_[Green].data(),
+				   rgb_[Blue].data(), size_.width);
+
+		std::swap(prev, cur);
+		std::swap(cur, next);
+	}
+}
+
+/*
+ * Unpack an input line to 16-bit pixels and mirror the first and last pixels
+ * in the padding. Packed formats are unpacked by whole groups of pixels, which
+ * may write past the end of the line in the padding before it gets mirrored.
+ */
+void DebayerCpu::unpackLine(const uint8_t *src, uint16_t *dst) const
+{
+	const unsigned int width = size_.width;
+
+	if (bayer_.packing == BayerFormat::Packing::CSI2) {
+		if (bayer_.bitDepth == 10) {
+			for (unsigned int x = 0; x < width; x += 4, src += 5) {
+				dst[x + 0] = (src[0] << 2) | ((src[4] >> 0) & 3);
+				dst[x + 1] = (src[1] << 2) | ((src[4] >> 2) & 3);
+				dst[x + 2] = (src[2] << 2) | ((src[4] >> 4) & 3);
+				dst[x + 3] = (src[3] << 2) | ((src[4] >> 6) & 3);
+			}
+		} else {
+			for (unsigned int x = 0; x < width; x += 2, src += 3) {
+				dst[x + 0] = (src[0] << 4) | (src[2] & 0xf);
+				dst[x + 1] = (src[1] << 4) | (src[2] >> 4);
+			}
+		}
+	} else if (bayer_.bitDepth > 8) {
+		memcpy(dst, src, width * sizeof(*dst));
+	} else {
+		for (unsigned int x = 0; x < width; ++x)
+			dst[x] = src[x];
+	}
+
+	dst[-1] = dst[1];
+	dst[width] = dst[width - 2];
+}
+
+/*
+ * Compute the averages of the neighbours of each pixel of the current line:
+ * horizontal and vertical neighbours, the four direct neighbours (the cross),
+ * and the four diagonal neighbours. Every pixel of the interpolated image is
+ * either a raw pixel or one of these averages. Being computed independently
+ * of the Bayer pattern, they map directly to vector operations.
+ *
+ * The sums are computed on 16 bits, which is sufficient for the four 12-bit
+ * values of the cross and diagonal neighbours.
+ */
+void DebayerCpu::interpolateLine(const uint16_t *prev, const uint16_t *cur,
+				 const uint16_t *next)
+{
+	uint16_t *horizontal = horizontal_.data();
+	uint16_t *vertical = vertical_.data();
+	uint16_t *cross = cross_.data();
+	uint16_t *diagonal = diagonal_.data();
+
+#if defined(__ARM_NEON)
+	for (unsigned int x = 0; x < size_.width; x += kVectorSize) {
+		uint16x8_t h = vaddq_u16(vld1q_u16(cur + x - 1),
+					 vld1q_u16(cur + x + 1));
+		uint16x8_t v = vaddq_u16(vld1q_u16(prev + x),
+					 vld1q_u16(next + x));
+		uint16x8_t d = vaddq_u16(vaddq_u16(vld1q_u16(prev + x - 1),
+						   vld1q_u16(prev + x + 1)),
+					 vaddq_u16(vld1q_u16(next + x - 1),
+						   vld1q_u16(next + x + 1)));
+
+		vst1q_u16(horizontal + x, vshrq_n_u16(h, 1));
+		vst1q_u16(vertical + x, vshrq_n_u16(v, 1));
+		vst1q_u16(cross + x, vshrq_n_u16(vaddq_u16(h, v), 2));
+		vst1q_u16(diagonal + x, vshrq_n_u16(d, 2));
+	}
+#elif defined(__SSE2__)
+	auto load = [](const uint16_t *p) {
+		return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+	};
+	auto store = [](uint16_t *p, __m128i value) {
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(p), value);
+	};
+
+	for (unsigned int x = 0; x < size_.width; x += kVectorSize) {
+		__m128i h = _mm_add_epi16(load(cur + x - 1), load(cur + x + 1));
+		__m128i v = _mm_add_epi16(load(prev + x), load(next + x));
+		__m128i d = _mm_add_epi16(_mm_add_epi16(load(prev + x - 1),
+							load(prev + x + 1)),
+					  _mm_add_epi16(load(next + x - 1),
+							load(next + x + 1)));
+
+		store(horizontal + x, _mm_srli_epi16(h, 1));
+		store(vertical + x, _mm_srli_epi16(v, 1));
+		store(cross + x, _mm_srli_epi16(_mm_add_epi16(h, v), 2));
+		store(diagonal + x, _mm_srli_epi16(d, 2));
+	}
+#else
+	for (unsigned int x = 0; x < size_.width; ++x) {
+		const uint16_t *p = prev + x;
+		const uint16_t *c = cur + x;
+		const uint16_t *n = next + x;
+		unsigned int h = c[-1] + c[1];
+		unsigned int v = p[0] + n[0];
+
+		horizontal[x] = h / 2;
+		vertical[x] = v / 2;
+		cross[x] = (h + v) / 4;
+		diagonal[x] = (p[-1] + p[1] + n[-1] + n[1]) / 4;
+	}
+#endif
+}
+
+/*
+ * Select, for each colour component of the pixels at even and odd positions
+ * in the line, the raw pixel or neighbour average that provides the component,
+ * and apply the lookup tables.
+ */
+void DebayerCpu::lookupLine(unsigned int y, const uint16_t *cur,
+			    const Tables &tables)
+{
+	const Colour *colours = colours_[y & 1];
+	const Colour *vColours = colours_[~y & 1];
+	const uint16_t *sources[2][3];
+
+	for (unsigned int i = 0; i < 2; ++i) {
+		Colour colour = colours[i];
+
+		if (colour == Green) {
+			sources[i][Green] = cur;
+			sources[i][colours[i ^ 1]] = horizontal_.data();
+			sources[i][vColours[i]] = vertical_.data();
+		} else {
+			sources[i][colour] = cur;
+			sources[i][Green] = cross_.data();
+			sources[i][colour == Red ? Blue : Red] = diagonal_.data();
+		}
+	}
+
+	const uint8_t *lutR = tables.lut[Red].data();
+	const uint8_t *lutG = tables.lut[Green].data();
+	const uint8_t *lutB = tables.lut[Blue].data();
+	uint8_t *r = rgb_[Red].data();
+	uint8_t *g = rgb_[Green].data();
+	uint8_t *b = rgb_[Blue].data();
+
+	for (unsigned int x = 0; x < size_.width; x += 2) {
+		r[x] = lutR[sources[0][Red][x]];
+		g[x] = lutG[sources[0][Green][x]];
+		b[x] = lutB[sources[0][Blue][x]];
+		r[x + 1] = lutR[sources[1][Red][x + 1]];
+		g[x + 1] = lutG[sources[1][Green][x + 1]];
+		b[x + 1] = lutB[sources[1][Blue][x + 1]];
+	}
+}
+
+/*
+ * Accumulate the zone sums and luminance histogram for the quads of the line
+ * pair starting at line y, taking one quad out of two horizontally.
+ */
+void DebayerCpu::statsQuads(unsigned int y, const uint16_t *top,
+			    const uint16_t *bottom, SoftwareStatistics *stats) const
+{
+	const uint16_t *lines[2] = { top, bottom };
+	const uint16_t *red = lines[redPosition_ >> 1] + (redPosition_ & 1);
+	const uint16_t *green0 = lines[greenPositions_[0] >> 1] + (greenPositions_[0] & 1);
+	const uint16_t *green1 = lines[greenPositions_[1] >> 1] + (greenPositions_[1] & 1);
+	const uint16_t *blue = lines[bluePosition_ >> 1] + (bluePosition_ & 1);
+
+	const unsigned int zoneRow = y * SoftwareStatistics::kGridHeight / size_.height;
+	std::array<uint64_t, 3> *zoneSums = &stats->zoneSums[zoneRow * SoftwareStatistics::kGridWidth];
+	uint32_t *zoneCounts = &stats->zoneCounts[zoneRow * SoftwareStatistics::kGridWidth];
+
+	/* Shift to scale the quad luminance sum to the histogram bins. */
+	const unsigned int shift = bayer_.bitDepth + 2 - 6;
+	static_assert(SoftwareStatistics::kHistogramBins == 1 << 6);
+
+	for (unsigned int x = 0, i = 0; x < size_.width; x += 4, ++i) {
+		unsigned int r = red[x];
+		unsigned int g = green0[x] + green1[x];
+		unsigned int b = blue[x];
+		unsigned int zone = zoneColumns_[i];
+
+		zoneSums[zone][Red] += r;
+		zoneSums[zone][Green] += g / 2;
+		zoneSums[zone][Blue] += b;
+		zoneCounts[zone]++;
+
+		stats->histogram[(r + g + b) >> shift]++;
+	}
+}
+
+unsigned int DebayerCpu::mirror(int y) const
+{
+	const int height = size_.height;
+
+	if (y < 0)
+		return -y;
+	if (y >= height)
+		return 2 * height - 2 - y;
+	return y;
+}
+
+} /* namespace libcamera */
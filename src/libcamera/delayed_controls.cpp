@@ -7,10 +7,13 @@
 
 #include "libcamera/internal/delayed_controls.h"
 
+#include <algorithm>
+
 #include <libcamera/base/log.h>
 
 #include <libcamera/controls.h>
 
+#include "libcamera/internal/tracepoints.h"
 #include "libcamera/internal/v4l2_device.h"
 
 /**
@@ -36,6 +39,11 @@ LOG_DEFINE_CATEGORY(DelayedControls)
  * control depth the controls are guaranteed to take effect for the correct
  * request. The control depth is determined by the control with the greatest
  * delay.
+ *
+ * Devices whose drivers support the Media Controller request API can instead
+ * bundle controls with the buffers of a frame in a MediaRequest, which the
+ * kernel applies atomically. DelayedControls is the fallback for all other
+ * devices.
  */
 
 /**
@@ -73,13 +81,15 @@ LOG_DEFINE_CATEGORY(DelayedControls)
  */
 DelayedControls::DelayedControls(V4L2Device *device,
 				 const std::unordered_map<uint32_t, ControlParams> &controlParams)
-	: device_(device), maxDelay_(0)
+	: device_(device), maxDelay_(0), controls_(device->controls()),
+	  priorityControls_(device->controls())
 {
 	const ControlInfoMap &controls = device_->controls();
 
 	/*
-	 * Create a map of control ids to delays for controls exposed by the
-	 * device.
+	 * Create one slot for each control exposed by the device. The slots
+	 * store the control values in dense ring buffers, and are sorted by
+	 * control id to write controls in a deterministic order.
 	 */
 	for (auto const &param : controlParams) {
 		auto it = controls.find(param.first);
@@ -94,92 +104,110 @@ DelayedControls::DelayedControls(V4L2Device *device,
 
 		const ControlId *id = it->first;
 
-		controlParams_[id] = param.second;
+		slots_.push_back({ id, param.second, {} });
 
 		LOG(DelayedControls, Debug)
-			<< "Set a delay of " << controlParams_[id].delay
-			<< " and priority write flag " << controlParams_[id].priorityWrite
+			<< "Set a delay of " << param.second.delay
+			<< " and priority write flag " << param.second.priorityWrite
 			<< " for " << id->name();
 
-		maxDelay_ = std::max(maxDelay_, controlParams_[id].delay);
+		maxDelay_ = std::max(maxDelay_, param.second.delay);
 	}
 
+	std::sort(slots_.begin(), slots_.end(),
+		  [](const Slot &a, const Slot &b) { return a.id->id() < b.id->id(); });
+
 	reset();
 }
 
 /**
  * \brief Reset state machine
+ * \param[in] cookie The cookie associated with the initial control values
  *
  * Resets the state machine to a starting position based on control values
  * retrieved from the device.
  */
-void DelayedControls::reset()
+void DelayedControls::reset(unsigned int cookie)
 {
 	queueCount_ = 1;
 	writeCount_ = 0;
+	cookies_[0] = cookie;
 
 	/* Retrieve control as reported by the device. */
 	std::vector<uint32_t> ids;
-	for (auto const &param : controlParams_)
-		ids.push_back(param.first->id());
+	for (const Slot &slot : slots_)
+		ids.push_back(slot.id->id());
 
 	ControlList controls = device_->getControls(ids);
 
 	/* Seed the control queue with the controls reported by the device. */
-	values_.clear();
-	for (const auto &ctrl : controls) {
-		const ControlId *id = device_->controls().idmap().at(ctrl.first);
+	for (Slot &slot : slots_) {
+		slot.values.fill(Info());
+
 		/*
 		 * Do not mark this control value as updated, it does not need
 		 * to be written to to device on startup.
 		 */
-		values_[id][0] = Info(ctrl.second, false);
+		if (controls.contains(slot.id->id()))
+			slot.values[0] = Info(controls.get(slot.id->id()), false);
 	}
 }
 
+DelayedControls::Slot *DelayedControls::findSlot(unsigned int id)
+{
+	auto it = std::lower_bound(slots_.begin(), slots_.end(), id,
+				   [](const Slot &slot, unsigned int key) {
+					   return slot.id->id() < key;
+				   });
+	if (it == slots_.end() || it->id->id() != id)
+		return nullptr;
+
+	return &*it;
+}
+
 /**
  * \brief Push a set of controls on the queue
  * \param[in] controls List of controls to add to the device queue
+ * \param[in] cookie An opaque value associated with the controls
  *
  * Push a set of controls to the control queue. This increases the control queue
  * depth by one.
  *
+ * The \a cookie is returned by cookie() for the sequence number the controls
+ * take effect at. Pipeline handlers can use it to associate the controls with
+ * the context they have been computed in, such as an IPA frame context.
+ *
  * \returns true if \a controls are accepted, or false otherwise
  */
-bool DelayedControls::push(const ControlList &controls)
+bool DelayedControls::push(const ControlList &controls, unsigned int cookie)
 {
 	/* Copy state from previous frame. */
-	for (auto &ctrl : values_) {
-		Info &info = ctrl.second[queueCount_];
-		info = values_[ctrl.first][queueCount_ - 1];
+	for (Slot &slot : slots_) {
+		Info &info = slot.values[queueCount_];
+		info = slot.values[queueCount_ - 1];
 		info.updated = false;
 	}
 
 	/* Update with new controls. */
-	const ControlIdMap &idmap = device_->controls().idmap();
 	for (const auto &control : controls) {
-		const auto &it = idmap.find(control.first);
-		if (it == idmap.end()) {
+		Slot *slot = findSlot(control.first);
+		if (!slot) {
 			LOG(DelayedControls, Warning)
-				<< "Unknown control " << control.first;
+				<< "Unknown control " << utils::hex(control.first);
 			return false;
 		}
 
-		const ControlId *id = it->second;
-
-		if (controlParams_.find(id) == controlParams_.end())
-			return false;
-
-		Info &info = values_[id][queueCount_];
+		Info &info = slot->values[queueCount_];
 
 		info = Info(control.second);
 
 		LOG(DelayedControls, Debug)
-			<< "Queuing " << id->name()
+			<< "Queuing " << slot->id->name()
 			<< " to " << info.toString()
 			<< " at index " << queueCount_;
 	}
 
+	cookies_[queueCount_] = cookie;
 	queueCount_++;
 
 	return true;
@@ -205,14 +233,15 @@ ControlList DelayedControls::get(uint32_t sequence)
 	unsigned int index = std::max<int>(0, sequence - maxDelay_);
 
 	ControlList out(device_->controls());
-	for (const auto &ctrl : values_) {
-		const ControlId *id = ctrl.first;
-		const Info &info = ctrl.second[index];
+	for (const Slot &slot : slots_) {
+		const Info &info = slot.values[index];
+		if (info.isNone())
+			continue;
 
-		out.set(id->id(), info);
+		out.set(slot.id->id(), info);
 
 		LOG(DelayedControls, Debug)
-			<< "Reading " << id->name()
+			<< "Reading " << slot.id->name()
 			<< " to " << info.toString()
 			<< " at index " << index;
 	}
@@ -220,6 +249,22 @@ ControlList DelayedControls::get(uint32_t sequence)
 	return out;
 }
 
+/**
+ * \brief Retrieve the cookie of the controls in effect at a sequence number
+ * \param[in] sequence The sequence number
+ *
+ * The same history constraints as for get() apply.
+ *
+ * \return The cookie passed to push() for the controls in effect at
+ * \a sequence number
+ */
+unsigned int DelayedControls::cookie(uint32_t sequence) const
+{
+	unsigned int index = std::max<int>(0, sequence - maxDelay_);
+
+	return cookies_[index];
+}
+
 /**
  * \brief Inform DelayedControls of the start of a new frame
  * \param[in] sequence Sequence number of the frame that started
@@ -228,6 +273,9 @@ ControlList DelayedControls::get(uint32_t sequence)
  * number. Any user of these helpers is responsible to inform the helper about
  * the start of any frame. This can be connected with ease to the start of a
  * exposure (SOE) V4L2 event.
+ *
+ * The control lists written to the device are reused from frame to frame, so
+ * applying controls of scalar types doesn't allocate memory.
  */
 void DelayedControls::applyControls(uint32_t sequence)
 {
@@ -237,38 +285,39 @@ void DelayedControls::applyControls(uint32_t sequence)
 	 * Create control list peeking ahead in the value queue to ensure
 	 * values are set in time to satisfy the sensor delay.
 	 */
-	ControlList out(device_->controls());
-	for (auto &ctrl : values_) {
-		const ControlId *id = ctrl.first;
-		unsigned int delayDiff = maxDelay_ - controlParams_[id].delay;
+	controls_.clear();
+
+	for (Slot &slot : slots_) {
+		unsigned int delayDiff = maxDelay_ - slot.params.delay;
 		unsigned int index = std::max<int>(0, writeCount_ - delayDiff);
-		Info &info = ctrl.second[index];
-
-		if (info.updated) {
-			if (controlParams_[id].priorityWrite) {
-				/*
-				 * This control must be written now, it could
-				 * affect validity of the other controls.
-				 */
-				ControlList priority(device_->controls());
-				priority.set(id->id(), info);
-				device_->setControls(&priority);
-			} else {
-				/*
-				 * Batch up the list of controls and write them
-				 * at the end of the function.
-				 */
-				out.set(id->id(), info);
-			}
-
-			LOG(DelayedControls, Debug)
-				<< "Setting " << id->name()
-				<< " to " << info.toString()
-				<< " at index " << index;
-
-			/* Done with this update, so mark as completed. */
-			info.updated = false;
+		Info &info = slot.values[index];
+
+		if (!info.updated)
+			continue;
+
+		if (slot.params.priorityWrite) {
+			/*
+			 * This control must be written now, it could affect
+			 * validity of the other controls.
+			 */
+			priorityControls_.clear();
+			priorityControls_.set(slot.id->id(), info);
+			device_->setControls(&priorityControls_);
+		} else {
+			/*
+			 * Batch up the list of controls and write them at the
+			 * end of the function.
+			 */
+			controls_.set(slot.id->id(), info);
 		}
+
+		LOG(DelayedControls, Debug)
+			<< "Setting " << slot.id->name()
+			<< " to " << info.toString()
+			<< " at index " << index;
+
+		/* Done with this update, so mark as completed. */
+		info.updated = false;
 	}
 
 	writeCount_ = sequence + 1;
@@ -276,10 +325,12 @@ void DelayedControls::applyControls(uint32_t sequence)
 	while (writeCount_ > queueCount_) {
 		LOG(DelayedControls, Debug)
 			<< "Queue is empty, auto queue no-op.";
-		push({});
+		push({}, cookies_[queueCount_ - 1]);
 	}
 
-	device_->setControls(&out);
+	LIBCAMERA_TRACEPOINT(delayed_controls_apply, sequence, controls_.size());
+
+	device_->setControls(&controls_);
 }
 
 } /* namespace libcamera */
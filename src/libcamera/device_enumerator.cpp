@@ -7,6 +7,7 @@
 
 #include "libcamera/internal/device_enumerator.h"
 
+#include <algorithm>
 #include <string.h>
 
 #include <libcamera/base/log.h>
@@ -14,6 +15,8 @@
 #include "libcamera/internal/device_enumerator_sysfs.h"
 #include "libcamera/internal/device_enumerator_udev.h"
 #include "libcamera/internal/media_device.h"
+#include "libcamera/internal/thread_pool.h"
+#include "libcamera/internal/tracepoints.h"
 
 /**
  * \file device_enumerator.h
@@ -219,7 +222,9 @@ std::unique_ptr<MediaDevice> DeviceEnumerator::createDevice(const std::string &d
 {
 	std::unique_ptr<MediaDevice> media = std::make_unique<MediaDevice>(deviceNode);
 
+	LIBCAMERA_TRACEPOINT(media_device_populate_begin, deviceNode.c_str());
 	int ret = media->populate();
+	LIBCAMERA_TRACEPOINT(media_device_populate_end, deviceNode.c_str(), ret);
 	if (ret < 0) {
 		LOG(DeviceEnumerator, Info)
 			<< "Unable to populate media device " << deviceNode
@@ -234,6 +239,44 @@ std::unique_ptr<MediaDevice> DeviceEnumerator::createDevice(const std::string &d
 	return media;
 }
 
+/**
+ * \brief Create multiple media device instances concurrently
+ * \param[in] deviceNodes Paths to the media devices to create
+ *
+ * Create a media device for each entry of \a deviceNodes as with
+ * createDevice(). Media devices are independent of each other, and querying
+ * their media graph topology dominates the enumeration time on systems with
+ * many media devices. The media devices are thus created concurrently on a
+ * ThreadPool, sized according to the number of CPUs.
+ *
+ * The device enumerator shall then populate and add the media devices from the
+ * calling thread, as for createDevice().
+ *
+ * \return An array of media device instances, in the same order as
+ * \a deviceNodes, with a null pointer for each media device that couldn't be
+ * created
+ */
+std::vector<std::unique_ptr<MediaDevice>>
+DeviceEnumerator::createDevices(const std::vector<std::string> &deviceNodes)
+{
+	std::vector<std::unique_ptr<MediaDevice>> devices(deviceNodes.size());
+
+	if (deviceNodes.size() < 2) {
+		for (unsigned int i = 0; i < deviceNodes.size(); ++i)
+			devices[i] = createDevice(deviceNodes[i]);
+		return devices;
+	}
+
+	/* The calling thread takes part in the work. */
+	ThreadPool pool("DevEnum", deviceNodes.size() - 1);
+	pool.runStrips([&](unsigned int strip, unsigned int count) {
+		for (unsigned int i = strip; i < deviceNodes.size(); i += count)
+			devices[i] = createDevice(deviceNodes[i]);
+	});
+
+	return devices;
+}
+
 /**
 * \var DeviceEnumerator::devicesAdded
 * \brief Notify of new media devices being found
@@ -242,6 +285,10 @@ std::unique_ptr<MediaDevice> DeviceEnumerator::createDevice(const std::string &d
 * the system. It may be emitted for every newly detected device, or once for
 * multiple devices, at the discretion of the device enumerator. Not all device
 * enumerator types may support dynamic detection of new devices.
+*
+* The signal is not emitted for the devices found by enumerate(). The devices
+* added since the last call to takeAddedDevices() can be retrieved with that
+* function.
 */
 
 /**
@@ -259,9 +306,26 @@ void DeviceEnumerator::addDevice(std::unique_ptr<MediaDevice> media)
 		<< "Added device " << media->deviceNode() << ": " << media->driver();
 
 	devices_.push_back(std::move(media));
+	addedDevices_.push_back(devices_.back());
+}
 
-	/* \todo To batch multiple additions, emit with a small delay here. */
-	devicesAdded.emit();
+/**
+ * \brief Notify users of the media devices added to the enumerator
+ *
+ * Emit the devicesAdded signal if media devices have been added with
+ * addDevice() since the last call to takeAddedDevices(). Device enumerators
+ * that support hotplug shall call this function once they have processed a
+ * batch of hotplug events, to avoid matching pipeline handlers for every
+ * single device when multiple devices are plugged at the same time.
+ */
+void DeviceEnumerator::notifyDevicesAdded()
+{
+	bool added = std::any_of(addedDevices_.begin(), addedDevices_.end(),
+				 [](const std::weak_ptr<MediaDevice> &media) {
+					 return !media.expired();
+				 });
+	if (added)
+		devicesAdded.emit();
 }
 
 /**
@@ -291,6 +355,12 @@ void DeviceEnumerator::removeDevice(const std::string &deviceNode)
 		return;
 	}
 
+	addedDevices_.erase(std::remove_if(addedDevices_.begin(), addedDevices_.end(),
+					   [&](const std::weak_ptr<MediaDevice> &added) {
+						   return added.lock() == media;
+					   }),
+			    addedDevices_.end());
+
 	LOG(DeviceEnumerator, Debug)
 		<< "Media device for node " << deviceNode << " removed.";
 
@@ -325,4 +395,30 @@ std::shared_ptr<MediaDevice> DeviceEnumerator::search(const DeviceMatch &dm)
 	return nullptr;
 }
 
+/**
+ * \brief Retrieve the media devices added since the last call
+ *
+ * Media devices are recorded when they are added to the enumerator, either
+ * during enumeration or when hotplugged. This function returns all recorded
+ * media devices that haven't been removed since, and clears the record. It
+ * allows users to only consider the newly added devices when reacting to the
+ * devicesAdded signal.
+ *
+ * \return The media devices added since the last call to this function
+ */
+std::vector<std::shared_ptr<MediaDevice>> DeviceEnumerator::takeAddedDevices()
+{
+	std::vector<std::shared_ptr<MediaDevice>> devices;
+
+	for (const std::weak_ptr<MediaDevice> &media : addedDevices_) {
+		std::shared_ptr<MediaDevice> device = media.lock();
+		if (device)
+			devices.push_back(std::move(device));
+	}
+
+	addedDevices_.clear();
+
+	return devices;
+}
+
 } /* namespace libcamera */
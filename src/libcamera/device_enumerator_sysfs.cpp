@@ -16,6 +16,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <vector>
 
 #include <libcamera/base/log.h>
 
@@ -53,6 +54,8 @@ int DeviceEnumeratorSysfs::enumerate()
 		return -ENODEV;
 	}
 
+	std::vector<std::string> deviceNodes;
+
 	while ((ent = readdir(dir)) != nullptr) {
 		if (strncmp(ent->d_name, "media", 5))
 			continue;
@@ -73,7 +76,10 @@ int DeviceEnumeratorSysfs::enumerate()
 			continue;
 		}
 
-		std::unique_ptr<MediaDevice> media = createDevice(devnode);
+		deviceNodes.push_back(std::move(devnode));
+	}
+
+	for (std::unique_ptr<MediaDevice> &media : createDevices(deviceNodes)) {
 		if (!media)
 			continue;
 
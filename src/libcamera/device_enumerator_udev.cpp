@@ -17,6 +17,7 @@
 #include <sys/ioctl.h>
 #include <sys/sysmacros.h>
 #include <unistd.h>
+#include <vector>
 
 #include <libcamera/base/event_notifier.h>
 #include <libcamera/base/log.h>
@@ -27,13 +28,30 @@ namespace libcamera {
 
 LOG_DECLARE_CATEGORY(DeviceEnumerator)
 
+namespace {
+
+/*
+ * Plugging a hub of cameras generates bursts of udev events. Events are
+ * batched until no new event is received for kBatchDelay, up to a maximum of
+ * kBatchMaxDelay after the first event of the batch, to process all devices of
+ * the burst at once.
+ */
+constexpr std::chrono::milliseconds kBatchDelay{ 100 };
+constexpr std::chrono::milliseconds kBatchMaxDelay{ 1000 };
+
+} /* namespace */
+
 DeviceEnumeratorUdev::DeviceEnumeratorUdev()
 	: udev_(nullptr), monitor_(nullptr), notifier_(nullptr)
 {
+	batchTimer_.timeout.connect(this, &DeviceEnumeratorUdev::processEvents);
 }
 
 DeviceEnumeratorUdev::~DeviceEnumeratorUdev()
 {
+	for (struct udev_device *dev : events_)
+		udev_device_unref(dev);
+
 	delete notifier_;
 
 	if (monitor_)
@@ -70,15 +88,16 @@ int DeviceEnumeratorUdev::init()
 	return 0;
 }
 
-int DeviceEnumeratorUdev::addUdevDevice(struct udev_device *dev)
+int DeviceEnumeratorUdev::addUdevDevice(struct udev_device *dev,
+					std::unique_ptr<MediaDevice> media)
 {
 	const char *subsystem = udev_device_get_subsystem(dev);
 	if (!subsystem)
 		return -ENODEV;
 
 	if (!strcmp(subsystem, "media")) {
-		std::unique_ptr<MediaDevice> media =
-			createDevice(udev_device_get_devnode(dev));
+		if (!media)
+			media = createDevice(udev_device_get_devnode(dev));
 		if (!media)
 			return -ENODEV;
 
@@ -122,6 +141,8 @@ int DeviceEnumeratorUdev::enumerate()
 {
 	struct udev_enumerate *udev_enum = nullptr;
 	struct udev_list_entry *ents, *ent;
+	std::vector<struct udev_device *> devices;
+	std::vector<std::string> mediaNodes;
 	int ret;
 
 	udev_enum = udev_enumerate_new(udev_);
@@ -170,12 +191,41 @@ int DeviceEnumeratorUdev::enumerate()
 			continue;
 		}
 
-		if (addUdevDevice(dev) < 0)
-			LOG(DeviceEnumerator, Warning)
-				<< "Failed to add device for '"
-				<< syspath << "', skipping";
+		const char *subsystem = udev_device_get_subsystem(dev);
+		if (subsystem && !strcmp(subsystem, "media"))
+			mediaNodes.push_back(devnode);
 
-		udev_device_unref(dev);
+		devices.push_back(dev);
+	}
+
+	/*
+	 * Create the media devices concurrently, and add all devices in
+	 * enumeration order, as media devices may depend on the video4linux
+	 * devices that follow them.
+	 */
+	{
+		std::vector<std::unique_ptr<MediaDevice>> media = createDevices(mediaNodes);
+		auto next = media.begin();
+
+		for (struct udev_device *dev : devices) {
+			const char *subsystem = udev_device_get_subsystem(dev);
+			int err;
+
+			if (subsystem && !strcmp(subsystem, "media")) {
+				std::unique_ptr<MediaDevice> device = std::move(*next++);
+				err = device ? addUdevDevice(dev, std::move(device)) : -ENODEV;
+			} else {
+				err = addUdevDevice(dev);
+			}
+
+			if (err < 0)
+				LOG(DeviceEnumerator, Warning)
+					<< "Failed to add device for '"
+					<< udev_device_get_syspath(dev)
+					<< "', skipping";
+
+			udev_device_unref(dev);
+		}
 	}
 
 done:
@@ -331,22 +381,80 @@ int DeviceEnumeratorUdev::addV4L2Device(dev_t devnum)
 
 void DeviceEnumeratorUdev::udevNotify()
 {
-	struct udev_device *dev = udev_monitor_receive_device(monitor_);
-	std::string_view action(udev_device_get_action(dev));
-	std::string_view deviceNode(udev_device_get_devnode(dev));
+	auto now = std::chrono::steady_clock::now();
+
+	if (events_.empty())
+		batchStart_ = now;
+
+	/* Drain all pending events from the monitor. */
+	while (struct udev_device *dev = udev_monitor_receive_device(monitor_))
+		events_.push_back(dev);
+
+	if (events_.empty())
+		return;
+
+	auto deadline = batchStart_ + kBatchMaxDelay;
+	if (now >= deadline) {
+		batchTimer_.stop();
+		processEvents();
+		return;
+	}
+
+	batchTimer_.start(std::min<std::chrono::milliseconds>(
+		kBatchDelay,
+		std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now)));
+}
+
+void DeviceEnumeratorUdev::processEvents()
+{
+	std::vector<struct udev_device *> events = std::move(events_);
+	events_.clear();
 
-	LOG(DeviceEnumerator, Debug)
-		<< action << " device " << deviceNode;
+	/*
+	 * Create the media devices added in the batch concurrently, as done in
+	 * enumerate(), and process the events in order.
+	 */
+	std::vector<std::string> mediaNodes;
 
-	if (action == "add") {
-		addUdevDevice(dev);
-	} else if (action == "remove") {
+	for (struct udev_device *dev : events) {
+		std::string_view action(udev_device_get_action(dev));
 		const char *subsystem = udev_device_get_subsystem(dev);
-		if (subsystem && !strcmp(subsystem, "media"))
-			removeDevice(std::string(deviceNode));
+		const char *devnode = udev_device_get_devnode(dev);
+
+		if (action == "add" && subsystem && !strcmp(subsystem, "media") &&
+		    devnode)
+			mediaNodes.push_back(devnode);
+	}
+
+	std::vector<std::unique_ptr<MediaDevice>> media = createDevices(mediaNodes);
+	auto next = media.begin();
+
+	for (struct udev_device *dev : events) {
+		std::string_view action(udev_device_get_action(dev));
+		const char *subsystem = udev_device_get_subsystem(dev);
+		const char *devnode = udev_device_get_devnode(dev);
+		bool isMedia = subsystem && !strcmp(subsystem, "media");
+
+		LOG(DeviceEnumerator, Debug)
+			<< action << " device " << (devnode ? devnode : "");
+
+		if (action == "add") {
+			if (isMedia && devnode) {
+				std::unique_ptr<MediaDevice> device = std::move(*next++);
+				if (device)
+					addUdevDevice(dev, std::move(device));
+			} else if (!isMedia) {
+				addUdevDevice(dev);
+			}
+		} else if (action == "remove") {
+			if (isMedia && devnode)
+				removeDevice(std::string(devnode));
+		}
+
+		udev_device_unref(dev);
 	}
 
-	udev_device_unref(dev);
+	notifyDevicesAdded();
 }
 
 } /* namespace libcamera */
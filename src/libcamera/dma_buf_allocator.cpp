@@ -0,0 +1,268 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * dma_buf_allocator.cpp - DMA-BUF heap allocator
+ */
+
+#include "libcamera/internal/dma_buf_allocator.h"
+
+#include <array>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <linux/dma-buf.h>
+#include <linux/dma-heap.h>
+
+#include <libcamera/base/log.h>
+
+/**
+ * \file dma_buf_allocator.h
+ * \brief DMA-BUF heap allocator
+ */
+
+namespace libcamera {
+
+LOG_DEFINE_CATEGORY(DmaBufAllocator)
+
+namespace {
+
+struct DmaBufAllocatorInfo {
+	DmaBufAllocator::DmaBufAllocatorFlag type;
+	const char *deviceNodeName;
+};
+
+/*
+ * /dev/dma_heap/linux,cma is the CMA heap, which allocates physically
+ * contiguous memory from a carveout.
+ *
+ * Annoyingly, should the CMA heap size be specified on the kernel command line
+ * instead of DT, the heap gets named "reserved" instead.
+ */
+constexpr std::array<DmaBufAllocatorInfo, 4> providerInfos = { {
+	{ DmaBufAllocator::DmaBufAllocatorFlag::CmaHeap, "/dev/dma_heap/linux,cma" },
+	{ DmaBufAllocator::DmaBufAllocatorFlag::CmaHeap, "/dev/dma_heap/reserved" },
+	{ DmaBufAllocator::DmaBufAllocatorFlag::SystemHeap, "/dev/dma_heap/system" },
+	{ DmaBufAllocator::DmaBufAllocatorFlag::SystemUncachedHeap, "/dev/dma_heap/system-uncached" },
+} };
+
+} /* namespace */
+
+/**
+ * \class DmaBufAllocator
+ * \brief Helper class for DMA-BUF heap allocations
+ *
+ * DMA heaps are kernel devices that provide an API to allocate memory from
+ * different pools called "heaps", wrap each allocated piece of memory in a
+ * DMA-BUF object, and return the DMA-BUF file descriptor to userspace. The
+ * resulting buffers can be imported by any device that supports DMA-BUF, such
+ * as GPUs, displays or video encoders, without copies.
+ *
+ * The DmaBufAllocator class wraps the DMA heaps API. It is constructed with the
+ * types of heaps it can allocate from, and uses the first available heap in
+ * the order of the DmaBufAllocatorFlag values.
+ */
+
+/**
+ * \enum DmaBufAllocator::DmaBufAllocatorFlag
+ * \brief Type of the DMA-BUF provider
+ * \var DmaBufAllocator::DmaBufAllocatorFlag::CmaHeap
+ * \brief Allocate physically contiguous memory from the CMA heap
+ * \var DmaBufAllocator::DmaBufAllocatorFlag::SystemHeap
+ * \brief Allocate cached memory from the system heap
+ * \var DmaBufAllocator::DmaBufAllocatorFlag::SystemUncachedHeap
+ * \brief Allocate uncached memory from the system heap
+ */
+
+/**
+ * \typedef DmaBufAllocator::DmaBufAllocatorFlags
+ * \brief A bitwise combination of DmaBufAllocator::DmaBufAllocatorFlag values
+ */
+
+/**
+ * \brief Construct a DmaBufAllocator of a given type
+ * \param[in] type The types of heaps to allocate from
+ *
+ * The DmaBufAllocator opens the first heap available in the system among the
+ * heaps selected by \a type. Construction succeeds even when no heap is
+ * available, users shall check the validity of the allocator with isValid().
+ */
+DmaBufAllocator::DmaBufAllocator(DmaBufAllocatorFlags type)
+{
+	for (const auto &info : providerInfos) {
+		if (!(type & info.type))
+			continue;
+
+		int ret = ::open(info.deviceNodeName, O_RDWR | O_CLOEXEC, 0);
+		if (ret < 0) {
+			ret = errno;
+			LOG(DmaBufAllocator, Debug)
+				<< "Failed to open " << info.deviceNodeName << ": "
+				<< strerror(ret);
+			continue;
+		}
+
+		LOG(DmaBufAllocator, Debug) << "Using " << info.deviceNodeName;
+		providerHandle_ = UniqueFD(ret);
+		break;
+	}
+
+	if (!providerHandle_.isValid())
+		LOG(DmaBufAllocator, Error) << "Could not open any dma-buf provider";
+}
+
+/**
+ * \brief Destroy the DmaBufAllocator instance
+ */
+DmaBufAllocator::~DmaBufAllocator() = default;
+
+/**
+ * \fn DmaBufAllocator::isValid()
+ * \brief Check if the DmaBufAllocator instance is valid
+ * \return True if the DmaBufAllocator is valid, false otherwise
+ */
+
+/**
+ * \brief Allocate a DMA-BUF from the DmaBufAllocator
+ * \param[in] name The name to set for the allocated buffer
+ * \param[in] size The size of the buffer to allocate
+ *
+ * Allocates a DMA-BUF with read/write access.
+ *
+ * If the allocation fails, return an invalid UniqueFD.
+ *
+ * \return The UniqueFD of the allocated buffer
+ */
+UniqueFD DmaBufAllocator::alloc(const char *name, std::size_t size)
+{
+	int ret;
+
+	if (!name)
+		return {};
+
+	struct dma_heap_allocation_data alloc = {};
+
+	alloc.len = size;
+	alloc.fd_flags = O_CLOEXEC | O_RDWR;
+
+	ret = ::ioctl(providerHandle_.get(), DMA_HEAP_IOCTL_ALLOC, &alloc);
+	if (ret < 0) {
+		LOG(DmaBufAllocator, Error)
+			<< "dma-heap allocation failure for " << name;
+		return {};
+	}
+
+	UniqueFD allocFd(alloc.fd);
+	ret = ::ioctl(allocFd.get(), DMA_BUF_SET_NAME, name);
+	if (ret < 0) {
+		LOG(DmaBufAllocator, Error)
+			<< "dma-heap naming failure for " << name;
+		return {};
+	}
+
+	return allocFd;
+}
+
+/**
+ * \class DmaSyncer
+ * \brief Helper class for dma-buf's synchronization
+ *
+ * This class wraps a userspace dma-buf's synchronization process with an
+ * object's lifetime.
+ *
+ * It's used when the user needs to access a dma-buf with CPU, mostly mapped
+ * with MappedFrameBuffer, so that the buffer is synchronized between CPU and
+ * ISP. As mappings are cached for the lifetime of the FrameBuffer, creating a
+ * DmaSyncer for the duration of each CPU access is cheap compared to mapping
+ * the buffer.
+ */
+
+/**
+ * \enum DmaSyncer::SyncType
+ * \brief Read and/or write access via the CPU map
+ * \var DmaSyncer::Read
+ * \brief Indicates that the mapped dma-buf will be read by the client via the
+ * CPU map
+ * \var DmaSyncer::Write
+ * \brief Indicates that the mapped dm-buf will be written by the client via the
+ * CPU map
+ * \var DmaSyncer::ReadWrite
+ * \brief Indicates that the mapped dma-buf will be read and written by the
+ * client via the CPU map
+ */
+
+/**
+ * \brief Construct a DmaSyncer with a dma-buf's fd and the access type
+ * \param[in] fd The dma-buf's file descriptor to synchronize
+ * \param[in] type Read and/or write access via the CPU map
+ *
+ * The CPU access starts when the DmaSyncer is constructed, and ends when it is
+ * destroyed.
+ */
+DmaSyncer::DmaSyncer(SharedFD fd, SyncType type)
+	: fd_(std::move(fd))
+{
+	switch (type) {
+	case SyncType::Read:
+		flags_ = DMA_BUF_SYNC_READ;
+		break;
+	case SyncType::Write:
+		flags_ = DMA_BUF_SYNC_WRITE;
+		break;
+	case SyncType::ReadWrite:
+		flags_ = DMA_BUF_SYNC_RW;
+		break;
+	}
+
+	sync(DMA_BUF_SYNC_START);
+}
+
+/**
+ * \fn DmaSyncer::DmaSyncer(DmaSyncer &&other)
+ * \brief Move constructor
+ * \param[in] other The other DmaSyncer
+ */
+
+/**
+ * \fn DmaSyncer::operator=(DmaSyncer &&other)
+ * \brief Move assignment operator
+ * \param[in] other The other DmaSyncer
+ * \return A reference to this DmaSyncer
+ */
+
+/**
+ * \brief Destroy the DmaSyncer and end the CPU access
+ */
+DmaSyncer::~DmaSyncer()
+{
+	/*
+	 * DmaSyncer might be moved and left with an empty SharedFD.
+	 */
+	if (fd_.isValid())
+		sync(DMA_BUF_SYNC_END);
+}
+
+void DmaSyncer::sync(uint64_t step)
+{
+	struct dma_buf_sync sync = {
+		.flags = flags_ | step
+	};
+
+	int ret;
+	do {
+		ret = ioctl(fd_.get(), DMA_BUF_IOCTL_SYNC, &sync);
+	} while (ret && (errno == EINTR || errno == EAGAIN));
+
+	if (ret) {
+		ret = errno;
+		LOG(DmaBufAllocator, Error)
+			<< "Unable to sync dma fd: " << fd_.get()
+			<< ", err: " << strerror(ret)
+			<< ", flags: " << sync.flags;
+	}
+}
+
+} /* namespace libcamera */
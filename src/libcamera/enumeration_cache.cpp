@@ -0,0 +1,445 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * enumeration_cache.cpp - Persistent cache of device enumeration results
+ */
+
+#include "libcamera/internal/enumeration_cache.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <libcamera/base/log.h>
+#include <libcamera/base/utils.h>
+
+#include "libcamera/internal/media_device.h"
+
+/**
+ * \file enumeration_cache.h
+ * \brief Persistent cache of device enumeration results
+ */
+
+namespace libcamera {
+
+LOG_DEFINE_CATEGORY(EnumerationCache)
+
+namespace {
+
+/*
+ * Version of the cache file format. Increment it when the format changes to
+ * invalidate all existing cache files.
+ */
+constexpr unsigned int kCacheFormatVersion = 1;
+
+constexpr char kCacheMagic[] = "libcamera-enumeration-cache";
+
+/* 64-bit FNV-1a, stable across builds and platforms. */
+class Hasher
+{
+public:
+	Hasher &operator<<(const std::string &str)
+	{
+		for (unsigned char c : str)
+			update(c);
+		/* Terminate strings to separate consecutive fields. */
+		update(0);
+		return *this;
+	}
+
+	Hasher &operator<<(uint32_t value)
+	{
+		for (unsigned int i = 0; i < 4; ++i)
+			update((value >> (i * 8)) & 0xff);
+		return *this;
+	}
+
+	uint64_t value() const { return hash_; }
+
+private:
+	void update(uint8_t byte)
+	{
+		hash_ ^= byte;
+		hash_ *= 0x100000001b3ULL;
+	}
+
+	uint64_t hash_ = 0xcbf29ce484222325ULL;
+};
+
+} /* namespace */
+
+/**
+ * \class CacheFile
+ * \brief Helpers to store cache files in the libcamera cache directory
+ *
+ * Different parts of libcamera cache the results of slow operations in files,
+ * to speed up subsequent runs. Caching is disabled by default, and is enabled
+ * by setting the LIBCAMERA_CACHE_DIR environment variable to the directory
+ * where cache files are stored. The directory is created when the first cache
+ * file is written, its parent must exist.
+ *
+ * Cache files may be read and written by multiple processes concurrently.
+ * They are replaced atomically by write(), readers thus always see a complete
+ * file.
+ */
+
+/**
+ * \brief Check if caching is enabled
+ * \return True if the LIBCAMERA_CACHE_DIR environment variable is set, false
+ * otherwise
+ */
+bool CacheFile::enabled()
+{
+	const char *dir = utils::secure_getenv("LIBCAMERA_CACHE_DIR");
+	return dir && *dir;
+}
+
+/**
+ * \brief Retrieve the path of a cache file
+ * \param[in] name The file name
+ *
+ * The \a name shall not contain any directory separator. Parts of the name
+ * that come from external sources, such as device names, should be passed
+ * through sanitize().
+ *
+ * \return The full path to the cache file, or an empty string if caching is
+ * disabled
+ */
+std::string CacheFile::path(const std::string &name)
+{
+	if (!enabled())
+		return {};
+
+	return std::string(utils::secure_getenv("LIBCAMERA_CACHE_DIR")) + "/" + name;
+}
+
+/**
+ * \brief Turn a string into a safe file name component
+ * \param[in] name The string
+ * \return The \a name with all characters except alphanumerics and '-'
+ * replaced with '_'
+ */
+std::string CacheFile::sanitize(const std::string &name)
+{
+	std::string result = name;
+
+	for (char &c : result) {
+		if (!isalnum(static_cast<unsigned char>(c)) && c != '-')
+			c = '_';
+	}
+
+	return result;
+}
+
+/**
+ * \brief Replace the contents of a cache file
+ * \param[in] path The path of the cache file, as returned by path()
+ * \param[in] data The file contents
+ *
+ * The \a data is written to a temporary file in the cache directory, which
+ * is then renamed to \a path. This replaces the cache file atomically, as
+ * multiple processes may access it concurrently. The cache directory is
+ * created if it doesn't exist.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int CacheFile::write(const std::string &path, Span<const uint8_t> data)
+{
+	std::string dir = utils::dirname(path);
+	if (mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST)
+		return -errno;
+
+	std::string tmpPath = path + ".XXXXXX";
+	int fd = mkstemp(tmpPath.data());
+	if (fd < 0)
+		return -errno;
+
+	const uint8_t *ptr = data.data();
+	size_t left = data.size();
+	int ret = 0;
+
+	while (left) {
+		ssize_t written = ::write(fd, ptr, left);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			ret = -errno;
+			break;
+		}
+
+		ptr += written;
+		left -= written;
+	}
+
+	::close(fd);
+
+	if (!ret && rename(tmpPath.c_str(), path.c_str()) < 0)
+		ret = -errno;
+
+	if (ret)
+		unlink(tmpPath.c_str());
+
+	return ret;
+}
+
+/**
+ * \class EnumerationCache
+ * \brief Persistent cache of the formats enumerated on a media device
+ *
+ * Enumerating the formats supported by subdevices requires one
+ * VIDIOC_SUBDEV_ENUM_FRAME_SIZE ioctl call per media bus code and frame size,
+ * which for sensors exposing many formats can account for a significant part
+ * of camera startup time, especially when the sensor driver needs to power up
+ * the device to handle the calls. The EnumerationCache stores the results of
+ * the enumeration in a file to skip it on subsequent runs.
+ *
+ * The cache is stored with CacheFile, and is thus disabled unless the
+ * LIBCAMERA_CACHE_DIR environment variable is set. One cache file is created
+ * per media device, named after the driver and model of the device, and its
+ * bus information or serial number to tell identical devices apart.
+ *
+ * Each cache file is tagged with a key that hashes the media device driver
+ * name, model, kernel version, hardware revision and the full media graph
+ * topology, except for the link enabled state that is runtime configuration.
+ * When the key of the media device doesn't match the key stored in the cache
+ * file, for instance after a kernel upgrade or when a different device with
+ * the same driver is plugged, the cache contents are discarded and the
+ * enumeration results are stored anew.
+ *
+ * The cache only stores data that drivers report as static. Users must not
+ * cache formats that depend on runtime configuration, such as formats on source
+ * pads of subdevices that depend on the format of their sink pads.
+ *
+ * All functions of this class are thread-safe.
+ */
+
+/**
+ * \typedef EnumerationCache::Formats
+ * \brief A map of media bus codes to the frame sizes they support
+ */
+
+/**
+ * \brief Create the enumeration cache for a media device
+ * \param[in] media The media device
+ *
+ * The media device must be populated. The existing cache file for the device,
+ * if any, is loaded and validated against the media device.
+ *
+ * \return The enumeration cache, or nullptr if the cache is disabled
+ */
+std::unique_ptr<EnumerationCache> EnumerationCache::create(const MediaDevice &media)
+{
+	std::string name = CacheFile::sanitize(media.driver()) + "-" +
+			   CacheFile::sanitize(media.model());
+
+	const std::string &instance = !media.busInfo().empty()
+				    ? media.busInfo() : media.serial();
+	if (!instance.empty())
+		name += "-" + CacheFile::sanitize(instance);
+
+	std::string path = CacheFile::path(name + ".cache");
+	if (path.empty())
+		return nullptr;
+
+	std::unique_ptr<EnumerationCache> cache{
+		new EnumerationCache(path, topologyKey(media))
+	};
+	cache->load();
+
+	return cache;
+}
+
+EnumerationCache::EnumerationCache(const std::string &path, uint64_t key)
+	: path_(path), key_(key), dirty_(false)
+{
+}
+
+/**
+ * \fn EnumerationCache::key()
+ * \brief Retrieve the key identifying the media device hardware and topology
+ * \return The cache key
+ */
+
+/**
+ * \brief Retrieve the cached formats for an entity pad
+ * \param[in] entity The media entity ID
+ * \param[in] pad The pad index
+ * \return The cached formats, or std::nullopt if no formats are cached for the
+ * pad
+ */
+std::optional<EnumerationCache::Formats>
+EnumerationCache::formats(unsigned int entity, unsigned int pad) const
+{
+	MutexLocker locker(mutex_);
+
+	auto it = formats_.find({ entity, pad });
+	if (it == formats_.end())
+		return std::nullopt;
+
+	return it->second;
+}
+
+/**
+ * \brief Store the formats enumerated on an entity pad
+ * \param[in] entity The media entity ID
+ * \param[in] pad The pad index
+ * \param[in] formats The enumerated formats
+ *
+ * The formats are written to the cache file immediately, as enumeration
+ * results are stored once per pad only and applications may not terminate
+ * cleanly.
+ */
+void EnumerationCache::setFormats(unsigned int entity, unsigned int pad,
+				  const Formats &formats)
+{
+	MutexLocker locker(mutex_);
+
+	formats_[{ entity, pad }] = formats;
+	dirty_ = true;
+
+	flush();
+}
+
+void EnumerationCache::load()
+{
+	std::ifstream file(path_);
+	if (!file.is_open())
+		return;
+
+	MutexLocker locker(mutex_);
+
+	std::string line;
+	std::string magic;
+	unsigned int version = 0;
+	uint64_t key = 0;
+
+	if (std::getline(file, line)) {
+		std::istringstream header(line);
+		header >> magic >> version >> std::hex >> key;
+	}
+
+	if (magic != kCacheMagic || version != kCacheFormatVersion ||
+	    key != key_) {
+		LOG(EnumerationCache, Debug)
+			<< "Discarding stale cache " << path_;
+		dirty_ = true;
+		return;
+	}
+
+	while (std::getline(file, line)) {
+		std::istringstream stream(line);
+		unsigned int entity, pad, code, count;
+
+		stream >> entity >> pad >> code >> count;
+		if (!stream || !count) {
+			LOG(EnumerationCache, Warning)
+				<< "Discarding corrupted cache " << path_;
+			formats_.clear();
+			dirty_ = true;
+			return;
+		}
+
+		std::vector<SizeRange> &sizes = formats_[{ entity, pad }][code];
+		sizes.clear();
+
+		for (unsigned int i = 0; i < count; ++i) {
+			SizeRange range;
+
+			stream >> range.min.width >> range.min.height
+			       >> range.max.width >> range.max.height
+			       >> range.hStep >> range.vStep;
+			sizes.push_back(range);
+		}
+
+		if (!stream) {
+			LOG(EnumerationCache, Warning)
+				<< "Discarding corrupted cache " << path_;
+			formats_.clear();
+			dirty_ = true;
+			return;
+		}
+	}
+
+	LOG(EnumerationCache, Debug)
+		<< "Loaded " << formats_.size() << " pads from " << path_;
+}
+
+int EnumerationCache::flush()
+{
+	if (!dirty_)
+		return 0;
+
+	std::ostringstream data;
+
+	data << kCacheMagic << " " << kCacheFormatVersion << " "
+	     << std::hex << key_ << std::dec << "\n";
+
+	for (const auto &[id, formats] : formats_) {
+		for (const auto &[code, sizes] : formats) {
+			data << id.first << " " << id.second << " " << code
+			     << " " << sizes.size();
+
+			for (const SizeRange &range : sizes)
+				data << " " << range.min.width << " " << range.min.height
+				     << " " << range.max.width << " " << range.max.height
+				     << " " << range.hStep << " " << range.vStep;
+
+			data << "\n";
+		}
+	}
+
+	std::string contents = data.str();
+	int ret = CacheFile::write(path_, { reinterpret_cast<const uint8_t *>(contents.data()),
+					    contents.size() });
+	if (ret) {
+		LOG(EnumerationCache, Warning)
+			<< "Failed to write " << path_ << ": " << strerror(-ret);
+		return ret;
+	}
+
+	dirty_ = false;
+	return 0;
+}
+
+uint64_t EnumerationCache::topologyKey(const MediaDevice &media)
+{
+	Hasher hasher;
+
+	hasher << kCacheFormatVersion
+	       << media.driver() << media.model()
+	       << media.version() << media.hwRevision();
+
+	for (const MediaEntity *entity : media.entities()) {
+		hasher << entity->id() << entity->name() << entity->function()
+		       << entity->flags()
+		       << static_cast<uint32_t>(entity->pads().size());
+
+		for (const MediaPad *pad : entity->pads()) {
+			hasher << pad->index() << pad->flags();
+
+			/*
+			 * Only hash links from their source pad to avoid
+			 * hashing them twice, and skip the enabled flag.
+			 */
+			for (const MediaLink *link : pad->links()) {
+				if (link->source() != pad)
+					continue;
+
+				hasher << link->sink()->entity()->id()
+				       << link->sink()->index()
+				       << (link->flags() & ~MEDIA_LNK_FL_ENABLED);
+			}
+		}
+	}
+
+	return hasher.value();
+}
+
+} /* namespace libcamera */
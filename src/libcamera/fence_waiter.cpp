@@ -0,0 +1,234 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * fence_waiter.cpp - Wait for multiple fences with a single event notifier
+ */
+
+#include "libcamera/internal/fence_waiter.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+
+#include <libcamera/base/event_notifier.h>
+#include <libcamera/base/log.h>
+
+#include <libcamera/fence.h>
+#include <libcamera/framebuffer.h>
+
+#include "libcamera/internal/framebuffer.h"
+#include "libcamera/internal/request.h"
+
+/**
+ * \file fence_waiter.h
+ * \brief Wait for multiple fences with a single event notifier
+ */
+
+namespace libcamera {
+
+LOG_DECLARE_CATEGORY(Request)
+
+/**
+ * \class FenceWaiter
+ * \brief Wait for the fences of multiple requests
+ *
+ * Waiting for a fence with a dedicated EventNotifier requires registering and
+ * unregistering the notifier with the event dispatcher of the thread for every
+ * fence, and waiting for request preparation timeouts with a dedicated Timer
+ * similarly requires registering and unregistering the timer.
+ *
+ * The FenceWaiter instead groups all fences in an epoll set, monitored by a
+ * single EventNotifier that stays registered with the event dispatcher for the
+ * lifetime of the waiter. Adding and removing a fence only modifies the epoll
+ * set. Request preparation timeouts are handled by a single Timer that is only
+ * restarted when the earliest deadline changes.
+ *
+ * When a fence is signalled, the FenceWaiter notifies the request that the
+ * buffer belongs to with Request::Private::fenceSignalled(). When a timeout
+ * expires, it notifies the request with Request::Private::timeout().
+ *
+ * The FenceWaiter is bound to the thread it is created in, and all its
+ * functions shall be called from that thread.
+ */
+
+/**
+ * \brief Construct a FenceWaiter
+ *
+ * The waiter is invalid if the epoll set can't be created.
+ */
+FenceWaiter::FenceWaiter()
+{
+	epollFd_ = UniqueFD(epoll_create1(EPOLL_CLOEXEC));
+	if (!epollFd_.isValid()) {
+		int ret = errno;
+		LOG(Request, Error)
+			<< "Failed to create fence epoll set: " << strerror(ret);
+		return;
+	}
+
+	notifier_ = std::make_unique<EventNotifier>(epollFd_.get(),
+						    EventNotifier::Read);
+	notifier_->activated.connect(this, &FenceWaiter::fencesReady);
+
+	timer_.timeout.connect(this, &FenceWaiter::timeout);
+}
+
+FenceWaiter::~FenceWaiter()
+{
+	/* All requests shall have completed their preparation. */
+	ASSERT(deadlines_.empty());
+}
+
+/**
+ * \fn FenceWaiter::isValid()
+ * \brief Check if the FenceWaiter is valid
+ * \return True if the FenceWaiter is valid, false otherwise
+ */
+
+/**
+ * \brief Wait for the fence of a buffer
+ * \param[in] buffer The buffer
+ *
+ * The \a buffer shall contain a fence, and be associated with a request.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int FenceWaiter::add(FrameBuffer *buffer)
+{
+	const Fence *fence = buffer->_d()->fence();
+	ASSERT(fence);
+
+	struct epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.ptr = buffer;
+
+	if (epoll_ctl(epollFd_.get(), EPOLL_CTL_ADD, fence->fd().get(), &event) < 0) {
+		int ret = -errno;
+		LOG(Request, Error)
+			<< "Failed to wait for fence: " << strerror(-ret);
+		return ret;
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Stop waiting for the fence of a buffer
+ * \param[in] buffer The buffer
+ *
+ * This function shall be called before the fence is released from the
+ * \a buffer.
+ */
+void FenceWaiter::remove(FrameBuffer *buffer)
+{
+	const Fence *fence = buffer->_d()->fence();
+	ASSERT(fence);
+
+	epoll_ctl(epollFd_.get(), EPOLL_CTL_DEL, fence->fd().get(), nullptr);
+}
+
+/**
+ * \brief Start the preparation timeout for a request
+ * \param[in] request The request
+ * \param[in] timeout The timeout duration
+ */
+void FenceWaiter::startTimeout(Request::Private *request,
+			       std::chrono::milliseconds timeout)
+{
+	utils::time_point deadline = utils::clock::now() + timeout;
+
+	/*
+	 * Requests are usually prepared with the same timeout, in which case
+	 * the deadline goes to the back of the queue.
+	 */
+	auto it = std::upper_bound(deadlines_.begin(), deadlines_.end(), deadline,
+				   [](const utils::time_point &value, const auto &entry) {
+					   return value < entry.first;
+				   });
+	bool first = it == deadlines_.begin();
+
+	deadlines_.emplace(it, deadline, request);
+
+	if (first)
+		updateTimer();
+}
+
+/**
+ * \brief Stop the preparation timeout for a request
+ * \param[in] request The request
+ */
+void FenceWaiter::stopTimeout(Request::Private *request)
+{
+	auto it = std::find_if(deadlines_.begin(), deadlines_.end(),
+			       [request](const auto &entry) {
+				       return entry.second == request;
+			       });
+	if (it == deadlines_.end())
+		return;
+
+	bool first = it == deadlines_.begin();
+
+	deadlines_.erase(it);
+
+	if (first)
+		updateTimer();
+}
+
+void FenceWaiter::fencesReady()
+{
+	/*
+	 * Retrieve signalled fences one at a time, as handling a fence may
+	 * complete the request and let the application reuse its buffers,
+	 * which would invalidate other pending events.
+	 */
+	while (true) {
+		struct epoll_event event;
+
+		int ret = epoll_wait(epollFd_.get(), &event, 1, 0);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+
+			ret = errno;
+			LOG(Request, Error)
+				<< "Failed to wait for fences: " << strerror(ret);
+			return;
+		}
+
+		if (!ret)
+			return;
+
+		FrameBuffer *buffer = static_cast<FrameBuffer *>(event.data.ptr);
+
+		remove(buffer);
+		buffer->request()->_d()->fenceSignalled(buffer);
+	}
+}
+
+void FenceWaiter::timeout()
+{
+	utils::time_point now = utils::clock::now();
+
+	while (!deadlines_.empty() && deadlines_.front().first <= now) {
+		Request::Private *request = deadlines_.front().second;
+		deadlines_.pop_front();
+
+		request->timeout();
+	}
+
+	updateTimer();
+}
+
+void FenceWaiter::updateTimer()
+{
+	if (deadlines_.empty()) {
+		timer_.stop();
+		return;
+	}
+
+	timer_.start(deadlines_.front().first);
+}
+
+} /* namespace libcamera */
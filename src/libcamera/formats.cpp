@@ -9,6 +9,8 @@
 
 #include <algorithm>
 #include <errno.h>
+#include <utility>
+#include <vector>
 
 #include <libcamera/base/log.h>
 #include <libcamera/base/utils.h>
@@ -148,9 +150,9 @@ namespace {
 
 const PixelFormatInfo pixelFormatInfoInvalid{};
 
-const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
+const PixelFormatInfo pixelFormatInfo[] = {
 	/* RGB formats. */
-	{ formats::RGB565, {
+	{
 		.name = "RGB565",
 		.format = formats::RGB565,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_RGB565), },
@@ -159,8 +161,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 3, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::RGB565_BE, {
+	},
+	{
 		.name = "RGB565_BE",
 		.format = formats::RGB565_BE,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_RGB565X), },
@@ -169,8 +171,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 3, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::BGR888, {
+	},
+	{
 		.name = "BGR888",
 		.format = formats::BGR888,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_RGB24), },
@@ -179,8 +181,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 3, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::RGB888, {
+	},
+	{
 		.name = "RGB888",
 		.format = formats::RGB888,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_BGR24), },
@@ -189,8 +191,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 3, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::XRGB8888, {
+	},
+	{
 		.name = "XRGB8888",
 		.format = formats::XRGB8888,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_XBGR32), },
@@ -199,8 +201,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::XBGR8888, {
+	},
+	{
 		.name = "XBGR8888",
 		.format = formats::XBGR8888,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_RGBX32), },
@@ -209,8 +211,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::RGBX8888, {
+	},
+	{
 		.name = "RGBX8888",
 		.format = formats::RGBX8888,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_BGRX32), },
@@ -219,8 +221,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::BGRX8888, {
+	},
+	{
 		.name = "BGRX8888",
 		.format = formats::BGRX8888,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_XRGB32), },
@@ -229,8 +231,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::ABGR8888, {
+	},
+	{
 		.name = "ABGR8888",
 		.format = formats::ABGR8888,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_RGBA32), },
@@ -239,8 +241,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::ARGB8888, {
+	},
+	{
 		.name = "ARGB8888",
 		.format = formats::ARGB8888,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_ABGR32), },
@@ -249,8 +251,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::BGRA8888, {
+	},
+	{
 		.name = "BGRA8888",
 		.format = formats::BGRA8888,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_ARGB32), },
@@ -259,8 +261,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::RGBA8888, {
+	},
+	{
 		.name = "RGBA8888",
 		.format = formats::RGBA8888,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_BGRA32), },
@@ -269,8 +271,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::BGR161616, {
+	},
+	{
 		.name = "BGR161616",
 		.format = formats::BGR161616,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_RGB48), },
@@ -279,8 +281,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 3, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::RGB161616, {
+	},
+	{
 		.name = "RGB161616",
 		.format = formats::RGB161616,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_BGR48), },
@@ -289,10 +291,10 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 3, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
+	},
 
 	/* YUV packed formats. */
-	{ formats::YUYV, {
+	{
 		.name = "YUYV",
 		.format = formats::YUYV,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_YUYV), },
@@ -301,8 +303,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::YVYU, {
+	},
+	{
 		.name = "YVYU",
 		.format = formats::YVYU,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_YVYU), },
@@ -311,8 +313,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::UYVY, {
+	},
+	{
 		.name = "UYVY",
 		.format = formats::UYVY,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_UYVY), },
@@ -321,8 +323,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::VYUY, {
+	},
+	{
 		.name = "VYUY",
 		.format = formats::VYUY,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_VYUY), },
@@ -331,8 +333,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::AVUY8888, {
+	},
+	{
 		.name = "AVUY8888",
 		.format = formats::AVUY8888,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_YUVA32), },
@@ -341,8 +343,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::XVUY8888, {
+	},
+	{
 		.name = "XVUY8888",
 		.format = formats::XVUY8888,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_YUVX32), },
@@ -351,10 +353,10 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
+	},
 
 	/* YUV planar formats. */
-	{ formats::NV12, {
+	{
 		.name = "NV12",
 		.format = formats::NV12,
 		.v4l2Formats = {
@@ -366,8 +368,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 2, 1 }, { 2, 2 }, { 0, 0 } }},
-	} },
-	{ formats::NV21, {
+	},
+	{
 		.name = "NV21",
 		.format = formats::NV21,
 		.v4l2Formats = {
@@ -379,8 +381,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 2, 1 }, { 2, 2 }, { 0, 0 } }},
-	} },
-	{ formats::NV16, {
+	},
+	{
 		.name = "NV16",
 		.format = formats::NV16,
 		.v4l2Formats = {
@@ -392,8 +394,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 2, 1 }, { 2, 1 }, { 0, 0 } }},
-	} },
-	{ formats::NV61, {
+	},
+	{
 		.name = "NV61",
 		.format = formats::NV61,
 		.v4l2Formats = {
@@ -405,8 +407,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 2, 1 }, { 2, 1 }, { 0, 0 } }},
-	} },
-	{ formats::NV24, {
+	},
+	{
 		.name = "NV24",
 		.format = formats::NV24,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_NV24), },
@@ -415,8 +417,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 1, 1 }, { 2, 1 }, { 0, 0 } }},
-	} },
-	{ formats::NV42, {
+	},
+	{
 		.name = "NV42",
 		.format = formats::NV42,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_NV42), },
@@ -425,8 +427,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 1, 1 }, { 2, 1 }, { 0, 0 } }},
-	} },
-	{ formats::YUV420, {
+	},
+	{
 		.name = "YUV420",
 		.format = formats::YUV420,
 		.v4l2Formats = {
@@ -438,8 +440,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 2, 1 }, { 1, 2 }, { 1, 2 } }},
-	} },
-	{ formats::YVU420, {
+	},
+	{
 		.name = "YVU420",
 		.format = formats::YVU420,
 		.v4l2Formats = {
@@ -451,8 +453,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 2, 1 }, { 1, 2 }, { 1, 2 } }},
-	} },
-	{ formats::YUV422, {
+	},
+	{
 		.name = "YUV422",
 		.format = formats::YUV422,
 		.v4l2Formats = {
@@ -464,8 +466,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 2, 1 }, { 1, 1 }, { 1, 1 } }},
-	} },
-	{ formats::YVU422, {
+	},
+	{
 		.name = "YVU422",
 		.format = formats::YVU422,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_YVU422M), },
@@ -474,8 +476,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 2, 1 }, { 1, 1 }, { 1, 1 } }},
-	} },
-	{ formats::YUV444, {
+	},
+	{
 		.name = "YUV444",
 		.format = formats::YUV444,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_YUV444M), },
@@ -484,8 +486,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 1, 1 }, { 1, 1 }, { 1, 1 } }},
-	} },
-	{ formats::YVU444, {
+	},
+	{
 		.name = "YVU444",
 		.format = formats::YVU444,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_YVU444M), },
@@ -494,10 +496,10 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 1, 1 }, { 1, 1 }, { 1, 1 } }},
-	} },
+	},
 
 	/* Greyscale formats. */
-	{ formats::R8, {
+	{
 		.name = "R8",
 		.format = formats::R8,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_GREY), },
@@ -506,8 +508,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 1, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::R10, {
+	},
+	{
 		.name = "R10",
 		.format = formats::R10,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_Y10), },
@@ -516,8 +518,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 2, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::R10_CSI2P, {
+	},
+	{
 		.name = "R10_CSI2P",
 		.format = formats::R10_CSI2P,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_Y10P), },
@@ -526,8 +528,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 4,
 		.planes = {{ { 5, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::R12, {
+	},
+	{
 		.name = "R12",
 		.format = formats::R12,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_Y12), },
@@ -536,8 +538,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 2, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::R16, {
+	},
+	{
 		.name = "R16",
 		.format = formats::R16,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_Y16), },
@@ -546,8 +548,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 2, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::MONO_PISP_COMP1, {
+	},
+	{
 		.name = "MONO_PISP_COMP1",
 		.format = formats::MONO_PISP_COMP1,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_PISP_COMP1_MONO), },
@@ -556,10 +558,10 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 2, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
+	},
 
 	/* Bayer formats. */
-	{ formats::SBGGR8, {
+	{
 		.name = "SBGGR8",
 		.format = formats::SBGGR8,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SBGGR8), },
@@ -568,8 +570,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 2, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGBRG8, {
+	},
+	{
 		.name = "SGBRG8",
 		.format = formats::SGBRG8,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SGBRG8), },
@@ -578,8 +580,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 2, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGRBG8, {
+	},
+	{
 		.name = "SGRBG8",
 		.format = formats::SGRBG8,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SGRBG8), },
@@ -588,8 +590,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 2, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SRGGB8, {
+	},
+	{
 		.name = "SRGGB8",
 		.format = formats::SRGGB8,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SRGGB8), },
@@ -598,8 +600,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 2, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SBGGR10, {
+	},
+	{
 		.name = "SBGGR10",
 		.format = formats::SBGGR10,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SBGGR10), },
@@ -608,8 +610,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGBRG10, {
+	},
+	{
 		.name = "SGBRG10",
 		.format = formats::SGBRG10,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SGBRG10), },
@@ -618,8 +620,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGRBG10, {
+	},
+	{
 		.name = "SGRBG10",
 		.format = formats::SGRBG10,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SGRBG10), },
@@ -628,8 +630,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SRGGB10, {
+	},
+	{
 		.name = "SRGGB10",
 		.format = formats::SRGGB10,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SRGGB10), },
@@ -638,8 +640,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SBGGR10_CSI2P, {
+	},
+	{
 		.name = "SBGGR10_CSI2P",
 		.format = formats::SBGGR10_CSI2P,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SBGGR10P), },
@@ -648,8 +650,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 4,
 		.planes = {{ { 5, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGBRG10_CSI2P, {
+	},
+	{
 		.name = "SGBRG10_CSI2P",
 		.format = formats::SGBRG10_CSI2P,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SGBRG10P), },
@@ -658,8 +660,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 4,
 		.planes = {{ { 5, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGRBG10_CSI2P, {
+	},
+	{
 		.name = "SGRBG10_CSI2P",
 		.format = formats::SGRBG10_CSI2P,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SGRBG10P), },
@@ -668,8 +670,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 4,
 		.planes = {{ { 5, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SRGGB10_CSI2P, {
+	},
+	{
 		.name = "SRGGB10_CSI2P",
 		.format = formats::SRGGB10_CSI2P,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SRGGB10P), },
@@ -678,8 +680,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 4,
 		.planes = {{ { 5, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SBGGR12, {
+	},
+	{
 		.name = "SBGGR12",
 		.format = formats::SBGGR12,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SBGGR12), },
@@ -688,8 +690,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGBRG12, {
+	},
+	{
 		.name = "SGBRG12",
 		.format = formats::SGBRG12,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SGBRG12), },
@@ -698,8 +700,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGRBG12, {
+	},
+	{
 		.name = "SGRBG12",
 		.format = formats::SGRBG12,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SGRBG12), },
@@ -708,8 +710,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SRGGB12, {
+	},
+	{
 		.name = "SRGGB12",
 		.format = formats::SRGGB12,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SRGGB12), },
@@ -718,8 +720,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SBGGR12_CSI2P, {
+	},
+	{
 		.name = "SBGGR12_CSI2P",
 		.format = formats::SBGGR12_CSI2P,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SBGGR12P), },
@@ -728,8 +730,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 3, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGBRG12_CSI2P, {
+	},
+	{
 		.name = "SGBRG12_CSI2P",
 		.format = formats::SGBRG12_CSI2P,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SGBRG12P), },
@@ -738,8 +740,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 3, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGRBG12_CSI2P, {
+	},
+	{
 		.name = "SGRBG12_CSI2P",
 		.format = formats::SGRBG12_CSI2P,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SGRBG12P), },
@@ -748,8 +750,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 3, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SRGGB12_CSI2P, {
+	},
+	{
 		.name = "SRGGB12_CSI2P",
 		.format = formats::SRGGB12_CSI2P,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SRGGB12P), },
@@ -758,8 +760,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 3, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SBGGR14, {
+	},
+	{
 		.name = "SBGGR14",
 		.format = formats::SBGGR14,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SBGGR14), },
@@ -768,8 +770,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGBRG14, {
+	},
+	{
 		.name = "SGBRG14",
 		.format = formats::SGBRG14,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SGBRG14), },
@@ -778,8 +780,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGRBG14, {
+	},
+	{
 		.name = "SGRBG14",
 		.format = formats::SGRBG14,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SGRBG14), },
@@ -788,8 +790,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SRGGB14, {
+	},
+	{
 		.name = "SRGGB14",
 		.format = formats::SRGGB14,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SRGGB14), },
@@ -798,8 +800,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SBGGR14_CSI2P, {
+	},
+	{
 		.name = "SBGGR14_CSI2P",
 		.format = formats::SBGGR14_CSI2P,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SBGGR14P), },
@@ -808,8 +810,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 4,
 		.planes = {{ { 7, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGBRG14_CSI2P, {
+	},
+	{
 		.name = "SGBRG14_CSI2P",
 		.format = formats::SGBRG14_CSI2P,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SGBRG14P), },
@@ -818,8 +820,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 4,
 		.planes = {{ { 7, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGRBG14_CSI2P, {
+	},
+	{
 		.name = "SGRBG14_CSI2P",
 		.format = formats::SGRBG14_CSI2P,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SGRBG14P), },
@@ -828,8 +830,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 4,
 		.planes = {{ { 7, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SRGGB14_CSI2P, {
+	},
+	{
 		.name = "SRGGB14_CSI2P",
 		.format = formats::SRGGB14_CSI2P,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SRGGB14P), },
@@ -838,8 +840,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 4,
 		.planes = {{ { 7, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SBGGR16, {
+	},
+	{
 		.name = "SBGGR16",
 		.format = formats::SBGGR16,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SBGGR16), },
@@ -848,8 +850,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGBRG16, {
+	},
+	{
 		.name = "SGBRG16",
 		.format = formats::SGBRG16,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SGBRG16), },
@@ -858,8 +860,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGRBG16, {
+	},
+	{
 		.name = "SGRBG16",
 		.format = formats::SGRBG16,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SGRBG16), },
@@ -868,8 +870,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SRGGB16, {
+	},
+	{
 		.name = "SRGGB16",
 		.format = formats::SRGGB16,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_SRGGB16), },
@@ -878,8 +880,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 4, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SBGGR10_IPU3, {
+	},
+	{
 		.name = "SBGGR10_IPU3",
 		.format = formats::SBGGR10_IPU3,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_IPU3_SBGGR10), },
@@ -889,8 +891,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		/* \todo remember to double this in the ipu3 pipeline handler */
 		.pixelsPerGroup = 25,
 		.planes = {{ { 32, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGBRG10_IPU3, {
+	},
+	{
 		.name = "SGBRG10_IPU3",
 		.format = formats::SGBRG10_IPU3,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_IPU3_SGBRG10), },
@@ -899,8 +901,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 25,
 		.planes = {{ { 32, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SGRBG10_IPU3, {
+	},
+	{
 		.name = "SGRBG10_IPU3",
 		.format = formats::SGRBG10_IPU3,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_IPU3_SGRBG10), },
@@ -909,8 +911,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 25,
 		.planes = {{ { 32, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::SRGGB10_IPU3, {
+	},
+	{
 		.name = "SRGGB10_IPU3",
 		.format = formats::SRGGB10_IPU3,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_IPU3_SRGGB10), },
@@ -919,8 +921,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 25,
 		.planes = {{ { 32, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::BGGR16_PISP_COMP1, {
+	},
+	{
 		.name = "BGGR16_PISP_COMP1",
 		.format = formats::BGGR16_PISP_COMP1,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_PISP_COMP1_BGGR), },
@@ -929,8 +931,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 2, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::GBRG16_PISP_COMP1, {
+	},
+	{
 		.name = "GBRG16_PISP_COMP1",
 		.format = formats::GBRG16_PISP_COMP1,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_PISP_COMP1_GBRG), },
@@ -939,8 +941,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 2, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::GRBG16_PISP_COMP1, {
+	},
+	{
 		.name = "GRBG16_PISP_COMP1",
 		.format = formats::GRBG16_PISP_COMP1,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_PISP_COMP1_GRBG), },
@@ -949,8 +951,8 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 2, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
-	{ formats::RGGB16_PISP_COMP1, {
+	},
+	{
 		.name = "RGGB16_PISP_COMP1",
 		.format = formats::RGGB16_PISP_COMP1,
 		.v4l2Formats = { V4L2PixelFormat(V4L2_PIX_FMT_PISP_COMP1_RGGB), },
@@ -959,9 +961,9 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = true,
 		.pixelsPerGroup = 2,
 		.planes = {{ { 2, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
+	},
 	/* Compressed formats. */
-	{ formats::MJPEG, {
+	{
 		.name = "MJPEG",
 		.format = formats::MJPEG,
 		.v4l2Formats = {
@@ -973,9 +975,68 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
 		.packed = false,
 		.pixelsPerGroup = 1,
 		.planes = {{ { 1, 1 }, { 0, 0 }, { 0, 0 } }},
-	} },
+	},
 };
 
+/*
+ * Sorted indexes of the pixel format information table, by PixelFormat and by
+ * V4L2 4CC, to look up formats with a binary search. The indexes are built on
+ * first use, to avoid depending on the order of static initialization.
+ */
+class PixelFormatIndex
+{
+public:
+	PixelFormatIndex()
+	{
+		for (const PixelFormatInfo &info : pixelFormatInfo) {
+			formats_.push_back({ info.format, &info });
+
+			for (const V4L2PixelFormat &v4l2Format : info.v4l2Formats)
+				v4l2Formats_.push_back({ v4l2Format.fourcc(), &info });
+		}
+
+		std::sort(formats_.begin(), formats_.end(),
+			  [](const auto &a, const auto &b) { return a.first < b.first; });
+		std::stable_sort(v4l2Formats_.begin(), v4l2Formats_.end(),
+				 [](const auto &a, const auto &b) { return a.first < b.first; });
+	}
+
+	const PixelFormatInfo *find(const PixelFormat &format) const
+	{
+		return lookup(formats_, format);
+	}
+
+	const PixelFormatInfo *find(const V4L2PixelFormat &format) const
+	{
+		return lookup(v4l2Formats_, format.fourcc());
+	}
+
+private:
+	template<typename Key>
+	static const PixelFormatInfo *
+	lookup(const std::vector<std::pair<Key, const PixelFormatInfo *>> &index,
+	       const Key &key)
+	{
+		auto iter = std::lower_bound(index.begin(), index.end(), key,
+					     [](const auto &entry, const Key &k) {
+						     return entry.first < k;
+					     });
+		if (iter == index.end() || iter->first != key)
+			return nullptr;
+
+		return iter->second;
+	}
+
+	std::vector<std::pair<PixelFormat, const PixelFormatInfo *>> formats_;
+	std::vector<std::pair<uint32_t, const PixelFormatInfo *>> v4l2Formats_;
+};
+
+const PixelFormatIndex &pixelFormatIndex()
+{
+	static const PixelFormatIndex index;
+	return index;
+}
+
 } /* namespace */
 
 /**
@@ -992,15 +1053,15 @@ const std::map<PixelFormat, PixelFormatInfo> pixelFormatInfo{
  */
 const PixelFormatInfo &PixelFormatInfo::info(const PixelFormat &format)
 {
-	const auto iter = pixelFormatInfo.find(format);
-	if (iter == pixelFormatInfo.end()) {
+	const PixelFormatInfo *info = pixelFormatIndex().find(format);
+	if (!info) {
 		LOG(Formats, Warning)
 			<< "Unsupported pixel format "
 			<< utils::hex(format.fourcc());
 		return pixelFormatInfoInvalid;
 	}
 
-	return iter->second;
+	return *info;
 }
 
 /**
@@ -1011,15 +1072,11 @@ const PixelFormatInfo &PixelFormatInfo::info(const PixelFormat &format)
  */
 const PixelFormatInfo &PixelFormatInfo::info(const V4L2PixelFormat &format)
 {
-	PixelFormat pixelFormat = format.toPixelFormat(false);
-	if (!pixelFormat.isValid())
-		return pixelFormatInfoInvalid;
-
-	const auto iter = pixelFormatInfo.find(pixelFormat);
-	if (iter == pixelFormatInfo.end())
+	const PixelFormatInfo *info = pixelFormatIndex().find(format);
+	if (!info)
 		return pixelFormatInfoInvalid;
 
-	return iter->second;
+	return *info;
 }
 
 /**
@@ -1030,9 +1087,9 @@ const PixelFormatInfo &PixelFormatInfo::info(const V4L2PixelFormat &format)
  */
 const PixelFormatInfo &PixelFormatInfo::info(const std::string &name)
 {
-	for (const auto &info : pixelFormatInfo) {
-		if (info.second.name == name)
-			return info.second;
+	for (const PixelFormatInfo &info : pixelFormatInfo) {
+		if (info.name == name)
+			return info;
 	}
 
 	return pixelFormatInfoInvalid;
@@ -0,0 +1,205 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * frame_timing.cpp - Camera frame timing model
+ */
+
+#include "libcamera/internal/frame_timing.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * \file frame_timing.h
+ * \brief Camera frame timing model
+ */
+
+namespace libcamera {
+
+namespace {
+
+/*
+ * Average the measurements over a window of about 16 frames. This smooths the
+ * timestamp jitter while following frame rate changes within half a second at
+ * 30fps.
+ */
+constexpr unsigned int kMaxSamples = 16;
+
+/*
+ * The sensor and system clocks differ by a few hundred ppm at most. Larger
+ * deviations from the reported frame duration come from a frame duration
+ * reported for the wrong frame while it changes, ignore them to update the
+ * clock ratio.
+ */
+constexpr double kMaxClockDeviation = 0.1;
+
+/*
+ * Don't update the model from gaps of more than 8 frames, the number of frames
+ * they span is unreliable.
+ */
+constexpr unsigned int kMaxFrameGap = 8;
+
+} /* namespace */
+
+/**
+ * \class FrameTiming
+ * \brief Predict the start time of the next frames of a camera
+ *
+ * Pipeline handlers report the time at which each frame starts in the
+ * controls::SensorTimestamp metadata, and the duration the sensor has been
+ * programmed with for the frame, computed from its blanking intervals, in the
+ * controls::FrameDuration metadata. Neither is enough to predict when the next
+ * frames will start: the sensor timing doesn't account for the drift between
+ * the sensor and system clocks, and timestamp deltas lag frame duration
+ * changes and include the capture jitter.
+ *
+ * The FrameTiming class fuses both sources of information. When the frame
+ * duration is known, it measures the ratio between the timestamp deltas and
+ * the reported durations, and scales the duration of the last frame by that
+ * ratio to predict the next frame start. Frame duration changes are thus
+ * reflected immediately. Otherwise it averages the timestamp deltas.
+ *
+ * Gaps in the timestamps caused by dropped frames are accounted for using the
+ * number of dropped frames reported by the pipeline handler. When the frame
+ * duration is known, gaps are also detected from the timestamps, to handle
+ * drops that the pipeline handler doesn't report. Without a frame duration, the
+ * timestamps can't tell a gap from a frame rate change, and every delta that
+ * isn't explained by reported drops is considered as a single frame.
+ *
+ * The prediction lets pipeline handlers schedule work just in time for the
+ * next frame, such as the preparation of ISP parameters, and lets applications
+ * pace their processing without extra buffering.
+ */
+
+FrameTiming::FrameTiming()
+{
+	reset();
+}
+
+/**
+ * \brief Reset the model
+ *
+ * Pipeline handlers shall reset the model when the camera is stopped, as the
+ * timestamps of the next capture session are not related to the previous
+ * ones.
+ */
+void FrameTiming::reset()
+{
+	lastTimestamp_.reset();
+	lastDuration_ = 0;
+	samples_ = 0;
+	scale_ = 1.0;
+	interval_ = 0.0;
+	jitter_ = 0.0;
+}
+
+/**
+ * \brief Add a frame to the model
+ * \param[in] timestamp The frame start time, in nanoseconds
+ * \param[in] frameDuration The frame duration, in microseconds
+ * \param[in] framesDropped The number of frames dropped since the last frame
+ *
+ * The \a timestamp is typically the controls::SensorTimestamp of the frame,
+ * the \a frameDuration its controls::FrameDuration, if reported by the
+ * pipeline handler, and \a framesDropped its controls::draft::FramesDropped.
+ * Frames shall be added in capture order, frames older than the last added
+ * frame are ignored.
+ */
+void FrameTiming::addFrame(int64_t timestamp, std::optional<int64_t> frameDuration,
+			   unsigned int framesDropped)
+{
+	if (lastTimestamp_ && timestamp <= *lastTimestamp_)
+		return;
+
+	if (lastTimestamp_) {
+		const int64_t delta = timestamp - *lastTimestamp_;
+		const double expected = frameInterval();
+		unsigned int frames = framesDropped + 1;
+
+		/*
+		 * The interval expected from the frame duration follows frame
+		 * rate changes, use it to detect unreported drops.
+		 */
+		if (lastDuration_ && expected > 0)
+			frames = std::max<unsigned int>(std::lround(delta / expected),
+							frames);
+
+		if (frames <= kMaxFrameGap) {
+			const double interval = static_cast<double>(delta) / frames;
+
+			samples_ = std::min(samples_ + 1, kMaxSamples);
+			const double weight = 1.0 / samples_;
+
+			if (lastDuration_) {
+				const double scale = interval / lastDuration_;
+				if (std::abs(scale - 1.0) <= kMaxClockDeviation)
+					scale_ += weight * (scale - scale_);
+			}
+
+			if (expected > 0)
+				jitter_ += weight * (std::abs(delta - frames * expected) - jitter_);
+
+			interval_ += weight * (interval - interval_);
+		}
+	}
+
+	lastTimestamp_ = timestamp;
+	lastDuration_ = frameDuration && *frameDuration > 0 ? *frameDuration * 1000 : 0;
+}
+
+/**
+ * \brief Check if the model can predict frame start times
+ *
+ * Predictions require at least one frame with a known duration, or two
+ * frames.
+ *
+ * \return True if the model can predict frame start times, false otherwise
+ */
+bool FrameTiming::isValid() const
+{
+	return lastTimestamp_ && frameInterval() > 0;
+}
+
+/**
+ * \brief Retrieve the predicted interval between the last frame and the next
+ * \return The predicted frame interval in nanoseconds, or 0 if unknown
+ */
+int64_t FrameTiming::frameInterval() const
+{
+	if (lastDuration_)
+		return std::llround(lastDuration_ * scale_);
+
+	return std::llround(interval_);
+}
+
+/**
+ * \fn FrameTiming::jitter()
+ * \brief Retrieve the frame start time jitter
+ *
+ * The jitter is the mean absolute difference between the frame start times
+ * and their predictions. Pipeline handlers that schedule work just in time for
+ * a frame should use it as a safety margin.
+ *
+ * \return The frame start time jitter in nanoseconds
+ */
+
+/**
+ * \brief Predict the start time of a future frame
+ * \param[in] frames The number of frames after the last added frame
+ *
+ * The prediction assumes that the frame duration stays constant after the last
+ * frame. It is expressed in the clock of the timestamps passed to addFrame().
+ *
+ * \return The predicted frame start time in nanoseconds, or std::nullopt if the
+ * model is not valid
+ */
+std::optional<int64_t> FrameTiming::frameStart(unsigned int frames) const
+{
+	if (!isValid())
+		return std::nullopt;
+
+	return *lastTimestamp_ + frames * frameInterval();
+}
+
+} /* namespace libcamera */
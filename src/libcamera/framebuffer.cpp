@@ -12,6 +12,7 @@
 
 #include <libcamera/base/log.h>
 #include <libcamera/base/shared_fd.h>
+#include <libcamera/base/utils.h>
 
 /**
  * \file libcamera/framebuffer.h
@@ -154,6 +155,20 @@ FrameBuffer::Private::~Private()
  * \return True if the planes are stored contiguously in memory, false otherwise
  */
 
+/**
+ * \fn FrameBuffer::Private::inodes()
+ * \brief Retrieve the dmabuf identity of the frame buffer planes
+ *
+ * The same dmabuf may be imported through different file descriptors, and a
+ * file descriptor number may be reused for a different dmabuf once closed.
+ * The inode of the dmabuf is the only stable identity. It is looked up once
+ * when the FrameBuffer is constructed, and cached for the lifetime of the
+ * buffer.
+ *
+ * \return The dmabuf inode of each plane, or 0 for planes whose identity could
+ * not be determined
+ */
+
 /**
  * \fn FrameBuffer::Private::fence()
  * \brief Retrieve a const pointer to the Fence
@@ -207,6 +222,36 @@ FrameBuffer::Private::~Private()
  * \return Dynamic metadata for the frame contained in the buffer
  */
 
+/**
+ * \brief Retrieve the cached CPU mapping of the buffer
+ *
+ * The mapping is created by the first MappedFrameBuffer constructed for the
+ * buffer, and is shared by all subsequent MappedFrameBuffer instances to avoid
+ * mapping and unmapping the buffer memory for every frame. This function is
+ * thread-safe.
+ *
+ * \return The cached mapping, or nullptr if the buffer hasn't been mapped yet
+ */
+std::shared_ptr<FrameBufferMapping> FrameBuffer::Private::mapping() const
+{
+	MutexLocker locker(mappingLock_);
+	return mapping_;
+}
+
+/**
+ * \brief Cache a CPU mapping of the buffer
+ * \param[in] mapping The mapping
+ *
+ * The previously cached mapping, if any, is replaced. It stays valid until all
+ * MappedFrameBuffer instances that use it are destroyed. The cached mapping is
+ * released when the FrameBuffer is destroyed. This function is thread-safe.
+ */
+void FrameBuffer::Private::setMapping(std::shared_ptr<FrameBufferMapping> mapping) const
+{
+	MutexLocker locker(mappingLock_);
+	mapping_ = std::move(mapping);
+}
+
 /**
  * \class FrameBuffer
  * \brief Frame buffer data and its associated dynamic metadata
@@ -288,7 +333,7 @@ ino_t fileDescriptorInode(const SharedFD &fd)
 	int ret = fstat(fd.get(), &st);
 	if (ret < 0) {
 		ret = -errno;
-		LOG(Buffer, Fatal)
+		LOG(Buffer, Warning)
 			<< "Failed to fstat() fd: " << strerror(-ret);
 		return 0;
 	}
@@ -315,11 +360,21 @@ FrameBuffer::FrameBuffer(const std::vector<Plane> &planes, unsigned int cookie)
 FrameBuffer::FrameBuffer(std::unique_ptr<Private> d)
 	: Extensible(std::move(d))
 {
+	std::vector<ino_t> &inodes = _d()->inodes_;
+	inodes.reserve(_d()->planes_.size());
+
+	for (const auto &plane : _d()->planes_) {
+		/* Planes sharing a file descriptor share the dmabuf. */
+		if (!inodes.empty() && plane.fd == _d()->planes_[0].fd)
+			inodes.push_back(inodes[0]);
+		else
+			inodes.push_back(fileDescriptorInode(plane.fd));
+	}
+
 	unsigned int offset = 0;
 	bool isContiguous = true;
-	ino_t inode = 0;
 
-	for (const auto &plane : _d()->planes_) {
+	for (const auto &[i, plane] : utils::enumerate(_d()->planes_)) {
 		ASSERT(plane.offset != Plane::kInvalidOffset);
 
 		if (plane.offset != offset) {
@@ -331,13 +386,10 @@ FrameBuffer::FrameBuffer(std::unique_ptr<Private> d)
 		 * Two different dmabuf file descriptors may still refer to the
 		 * same dmabuf instance. Check this using inodes.
 		 */
-		if (plane.fd != _d()->planes_[0].fd) {
-			if (!inode)
-				inode = fileDescriptorInode(_d()->planes_[0].fd);
-			if (fileDescriptorInode(plane.fd) != inode) {
-				isContiguous = false;
-				break;
-			}
+		if (plane.fd != _d()->planes_[0].fd &&
+		    (!inodes[i] || inodes[i] != inodes[0])) {
+			isContiguous = false;
+			break;
 		}
 
 		offset += plane.length;
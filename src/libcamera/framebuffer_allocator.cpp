@@ -7,14 +7,25 @@
 
 #include <libcamera/framebuffer_allocator.h>
 
+#include <algorithm>
+#include <array>
 #include <errno.h>
+#include <limits.h>
+#include <linux/mempolicy.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include <libcamera/base/log.h>
+#include <libcamera/base/shared_fd.h>
+#include <libcamera/base/utils.h>
 
 #include <libcamera/camera.h>
 #include <libcamera/framebuffer.h>
 #include <libcamera/stream.h>
 
+#include "libcamera/internal/dma_buf_allocator.h"
+#include "libcamera/internal/formats.h"
 #include "libcamera/internal/pipeline_handler.h"
 
 /**
@@ -26,6 +37,68 @@ namespace libcamera {
 
 LOG_DEFINE_CATEGORY(Allocator)
 
+namespace {
+
+/*
+ * Scoped preferred NUMA node for the memory allocations of the calling thread.
+ * The DMA-BUF system heaps allocate pages according to the memory policy of
+ * the allocating thread, the previous policy is restored on destruction.
+ */
+class NumaNodePreference
+{
+public:
+	NumaNodePreference(int node)
+		: active_(false)
+	{
+		if (node < 0)
+			return;
+
+		if (static_cast<unsigned int>(node) >= kMaxNodes) {
+			LOG(Allocator, Warning) << "Invalid NUMA node " << node;
+			return;
+		}
+
+		int ret = syscall(SYS_get_mempolicy, &mode_, nodes_.data(),
+				  kMaxNodes, nullptr, 0UL);
+		if (ret < 0) {
+			LOG(Allocator, Warning)
+				<< "Failed to get memory policy: " << strerror(errno);
+			return;
+		}
+
+		std::array<unsigned long, kMaskSize> nodes{};
+		nodes[node / kBitsPerLong] = 1UL << (node % kBitsPerLong);
+
+		ret = syscall(SYS_set_mempolicy, MPOL_PREFERRED, nodes.data(),
+			      kMaxNodes + 1);
+		if (ret < 0) {
+			LOG(Allocator, Warning)
+				<< "Failed to prefer NUMA node " << node << ": "
+				<< strerror(errno);
+			return;
+		}
+
+		active_ = true;
+	}
+
+	~NumaNodePreference()
+	{
+		if (active_)
+			syscall(SYS_set_mempolicy, mode_, nodes_.data(), kMaxNodes + 1);
+	}
+
+private:
+	static constexpr unsigned int kMaxNodes = 1024;
+	static constexpr unsigned int kBitsPerLong = sizeof(unsigned long) * CHAR_BIT;
+	static constexpr unsigned int kMaskSize = kMaxNodes / kBitsPerLong;
+
+	bool active_;
+	int mode_;
+	std::array<unsigned long, kMaskSize> nodes_;
+};
+
+} /* namespace */
+
 /**
  * \class FrameBufferAllocator
  * \brief FrameBuffer allocator for applications
@@ -50,10 +123,50 @@ LOG_DEFINE_CATEGORY(Allocator)
  * buffers are not deleted while they are in use (part of a Request that has
  * been queued and hasn't completed yet).
  *
+ * Buffers are allocated by default from the devices associated with the
+ * stream by the pipeline handler. Applications that need buffers with specific
+ * memory properties, for instance physically contiguous buffers to be imported
+ * by a video encoder or a display controller, can instead allocate them from a
+ * DMA-BUF heap by specifying the buffer Source.
+ *
  * Usage of the FrameBufferAllocator is optional, if all buffers for a camera
  * are provided externally applications shall not use this class.
  */
 
+/**
+ * \enum FrameBufferAllocator::Source
+ * \brief The memory source to allocate buffers from
+ * \var FrameBufferAllocator::Source::Device
+ * \brief Allocate buffers from the devices used by the pipeline handler
+ * \var FrameBufferAllocator::Source::ContiguousHeap
+ * \brief Allocate physically contiguous buffers from the CMA DMA-BUF heap
+ * \var FrameBufferAllocator::Source::SystemHeap
+ * \brief Allocate cached buffers from the system DMA-BUF heap
+ * \var FrameBufferAllocator::Source::UncachedSystemHeap
+ * \brief Allocate uncached buffers from the system DMA-BUF heap
+ */
+
+/**
+ * \struct FrameBufferAllocator::Hints
+ * \brief Memory placement hints for buffer allocation
+ *
+ * Hints tune where the memory of the buffers allocated from a DMA-BUF heap is
+ * placed. They are best effort, and are ignored when they can't be honoured.
+ * Buffers allocated from Source::Device are allocated by the kernel drivers,
+ * and are not affected by the hints.
+ *
+ * Whether buffers are cached for CPU access is selected by the memory Source.
+ * Streams whose buffers are accessed by the CPU should use cached memory.
+ *
+ * \var FrameBufferAllocator::Hints::numaNode
+ * \brief The preferred NUMA node, or -1 to use the system memory policy
+ *
+ * On systems with multiple NUMA nodes, placing buffers on the node of the CPUs
+ * that process them (for instance an encoder or a post-processing thread)
+ * avoids cross-node memory traffic. This only applies to the system heaps, as
+ * the contiguous heap allocates memory from a dedicated area.
+ */
+
 /**
  * \brief Construct a FrameBufferAllocator serving a camera
  * \param[in] camera The camera
@@ -68,6 +181,18 @@ FrameBufferAllocator::~FrameBufferAllocator()
 	buffers_.clear();
 }
 
+/**
+ * \fn FrameBufferAllocator::setHints()
+ * \brief Set the memory placement hints for subsequent allocations
+ * \param[in] hints The memory placement hints
+ */
+
+/**
+ * \fn FrameBufferAllocator::hints()
+ * \brief Retrieve the memory placement hints
+ * \return The memory placement hints
+ */
+
 /**
  * \brief Allocate buffers for a configured stream
  * \param[in] stream The stream to allocate buffers for
@@ -103,6 +228,185 @@ int FrameBufferAllocator::allocate(Stream *stream)
 	return ret;
 }
 
+/**
+ * \brief Allocate buffers for a configured stream from a memory source
+ * \param[in] stream The stream to allocate buffers for
+ * \param[in] source The memory source to allocate buffers from
+ *
+ * Allocate buffers suitable for capturing frames from the \a stream, from the
+ * memory \a source. Allocating from Source::Device is equivalent to
+ * allocate(Stream *stream).
+ *
+ * Buffers allocated from a DMA-BUF heap are sized according to the pixel
+ * format, size, stride and frame size of the stream configuration, and the
+ * number of buffers is given by the configuration bufferCount. All planes of a
+ * buffer are stored in a single DMA-BUF. Buffers allocated from a cached heap
+ * require CPU cache synchronization with the DMA_BUF_IOCTL_SYNC ioctl when
+ * accessed by the CPU.
+ *
+ * \return The number of allocated buffers on success or a negative error code
+ * otherwise
+ * \retval -EACCES The camera is not in a state where buffers can be allocated
+ * \retval -EINVAL The \a stream does not belong to the camera or the stream is
+ * not part of the active camera configuration
+ * \retval -EBUSY Buffers are already allocated for the \a stream
+ * \retval -ENODEV The DMA-BUF heap corresponding to \a source isn't available
+ * \retval -ENOMEM Buffer allocation failed
+ */
+int FrameBufferAllocator::allocate(Stream *stream, Source source)
+{
+	if (source == Source::Device)
+		return allocate(stream);
+
+	return allocate(stream, source, stream->configuration().bufferCount);
+}
+
+/**
+ * \brief Allocate a given number of buffers for a stream from a DMA-BUF heap
+ * \param[in] stream The stream to allocate buffers for
+ * \param[in] source The DMA-BUF heap to allocate buffers from
+ * \param[in] count The number of buffers to allocate
+ *
+ * This function behaves as allocate(Stream *stream, Source source), but
+ * allocates \a count buffers instead of the configuration bufferCount. As the
+ * devices of the pipeline handler are not involved, buffers can also be
+ * allocated while the camera is running, for instance to add buffers to a
+ * stream that runs out of them. Additional buffers for the same stream require
+ * a separate FrameBufferAllocator instance.
+ *
+ * The number of buffers allocated from Source::Device is decided by the
+ * pipeline handler, and the function returns -EINVAL for that source.
+ *
+ * \return The number of allocated buffers on success or a negative error code
+ * otherwise
+ * \retval -EACCES The camera is not in a state where buffers can be allocated
+ * \retval -EINVAL The \a stream does not belong to the camera, the stream is
+ * not part of the active camera configuration, or \a source is Source::Device
+ * \retval -EBUSY Buffers are already allocated for the \a stream
+ * \retval -ENODEV The DMA-BUF heap corresponding to \a source isn't available
+ * \retval -ENOMEM Buffer allocation failed
+ */
+int FrameBufferAllocator::allocate(Stream *stream, Source source,
+				   unsigned int count)
+{
+	if (source == Source::Device)
+		return -EINVAL;
+
+	const auto &[it, inserted] = buffers_.try_emplace(stream);
+
+	if (!inserted) {
+		LOG(Allocator, Error) << "Buffers already allocated for stream";
+		return -EBUSY;
+	}
+
+	int ret = allocateFromHeap(stream, source, count, &it->second);
+	if (ret < 0)
+		buffers_.erase(it);
+
+	return ret;
+}
+
+int FrameBufferAllocator::allocateFromHeap(Stream *stream, Source source,
+					   unsigned int count,
+					   std::vector<std::unique_ptr<FrameBuffer>> *buffers)
+{
+	int ret = camera_->canAllocateFrameBuffers(stream, true);
+	if (ret < 0) {
+		if (ret == -EINVAL)
+			LOG(Allocator, Error)
+				<< "Stream is not part of " << camera_->id()
+				<< " active configuration";
+		return ret;
+	}
+
+	DmaBufAllocator::DmaBufAllocatorFlag type;
+
+	switch (source) {
+	case Source::ContiguousHeap:
+		type = DmaBufAllocator::DmaBufAllocatorFlag::CmaHeap;
+		break;
+	case Source::SystemHeap:
+		type = DmaBufAllocator::DmaBufAllocatorFlag::SystemHeap;
+		break;
+	case Source::UncachedSystemHeap:
+	default:
+		type = DmaBufAllocator::DmaBufAllocatorFlag::SystemUncachedHeap;
+		break;
+	}
+
+	DmaBufAllocator allocator(type);
+	if (!allocator.isValid())
+		return -ENODEV;
+
+	/*
+	 * Compute the plane layout from the stream configuration. The stride is
+	 * given for the first plane only, compute the stride of the other
+	 * planes by taking the horizontal subsampling factor into account, as
+	 * done by V4L2VideoDevice for single-planar buffers. Formats without a
+	 * PixelFormatInfo, such as metadata formats, use a single plane of
+	 * frameSize bytes.
+	 */
+	const StreamConfiguration &cfg = stream->configuration();
+	const PixelFormatInfo &info = PixelFormatInfo::info(cfg.pixelFormat);
+	std::vector<unsigned int> lengths;
+
+	if (info.isValid() && cfg.stride) {
+		for (unsigned int i = 0; i < info.numPlanes(); ++i) {
+			unsigned int stride = cfg.stride
+					    * info.planes[i].bytesPerGroup
+					    / info.planes[0].bytesPerGroup;
+			lengths.push_back(info.planeSize(cfg.size.height, i, stride));
+		}
+	} else {
+		lengths.push_back(cfg.frameSize);
+	}
+
+	size_t size = 0;
+	for (unsigned int length : lengths)
+		size += length;
+	size = std::max<size_t>(size, cfg.frameSize);
+
+	if (!size || !count) {
+		LOG(Allocator, Error) << "Invalid stream configuration "
+				      << cfg.toString();
+		return -EINVAL;
+	}
+
+	/*
+	 * The system heaps allocate the pages when the buffer is allocated,
+	 * prefer the hinted NUMA node for the duration of the allocations.
+	 */
+	NumaNodePreference numaNode(source != Source::ContiguousHeap
+				    ? hints_.numaNode : -1);
+
+	for (unsigned int i = 0; i < count; ++i) {
+		std::string name = "libcamera-" + camera_->id() + "-" +
+				   std::to_string(i);
+		SharedFD fd(allocator.alloc(name.c_str(), size));
+		if (!fd.isValid()) {
+			buffers->clear();
+			return -ENOMEM;
+		}
+
+		std::vector<FrameBuffer::Plane> planes;
+		unsigned int offset = 0;
+
+		for (unsigned int length : lengths) {
+			FrameBuffer::Plane plane;
+			plane.fd = fd;
+			plane.offset = offset;
+			plane.length = length;
+			planes.push_back(std::move(plane));
+
+			offset += length;
+		}
+
+		buffers->push_back(std::make_unique<FrameBuffer>(planes));
+	}
+
+	return buffers->size();
+}
+
 /**
  * \brief Free buffers previously allocated for a \a stream
  * \param[in] stream The stream
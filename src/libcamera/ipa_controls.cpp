@@ -71,6 +71,30 @@
  * data section, and after the data section. They shall be ignored when parsing
  * the packet.
  *
+ * ControlList packets may optionally be delta-encoded relative to the previous
+ * ControlList packet sent for the same ControlInfoMap handle and id map type.
+ * Packets that take part in delta encoding carry a non-zero
+ * ipa_controls_header::sequence number, incremented by one for every packet
+ * (skipping 0 on wrap-around). A packet with the IPA_CONTROLS_FLAG_DELTA flag
+ * set only contains the entries that have been added or whose value has
+ * changed since the packet with the previous sequence number, as well as
+ * entries for the controls that have been removed. The latter have the
+ * IPA_CONTROL_VALUE_ENTRY_REMOVED flag set, and have no associated data in the
+ * data section. A packet without the IPA_CONTROLS_FLAG_DELTA flag always
+ * contains the full list, and resets the baseline for the following delta
+ * packets.
+ *
+ * Delta-encoded packets shall only be sent to a receiver that has advertised
+ * support for them by setting the IPA_CONTROLS_FLAG_DELTA_CAPABLE flag in the
+ * packets it sends, and shall be parsed in the same order they have been
+ * produced.
+ *
+ * A receiver that gets a delta-encoded packet whose baseline it hasn't
+ * received shall discard the packet, and set the IPA_CONTROLS_FLAG_RESYNC flag
+ * in the next packet it sends. Upon reception of that flag, the sender shall
+ * send a full list as the next packet for every ControlInfoMap handle and id
+ * map type.
+ *
  * The following diagram describes the layout of the ControlInfoMap packet.
  *
  * ~~~~
@@ -138,6 +162,28 @@ namespace libcamera {
  * \brief The current control serialization format version
  */
 
+/**
+ * \def IPA_CONTROLS_FLAG_DELTA_CAPABLE
+ * \brief The packet sender supports parsing delta-encoded ControlList packets
+ */
+
+/**
+ * \def IPA_CONTROLS_FLAG_DELTA
+ * \brief The ControlList packet is delta-encoded relative to the previous
+ * packet in the same sequence
+ */
+
+/**
+ * \def IPA_CONTROLS_FLAG_RESYNC
+ * \brief The packet sender has missed the baseline of a delta-encoded
+ * ControlList packet, and requests full ControlList packets
+ */
+
+/**
+ * \def IPA_CONTROL_VALUE_ENTRY_REMOVED
+ * \brief The control has been removed from a delta-encoded ControlList packet
+ */
+
 /**
  * \var ipa_controls_id_map_type
  * \brief Enumerates the different control id map types
@@ -182,8 +228,11 @@ namespace libcamera {
  * Offset in bytes from the beginning of the packet of the data section start
  * \var ipa_controls_header::id_map_type
  * The id map type as defined by the ipa_controls_id_map_type enumeration
- * \var ipa_controls_header::reserved
- * Reserved for future extensions
+ * \var ipa_controls_header::flags
+ * Packet flags, a combination of the IPA_CONTROLS_FLAG_* values
+ * \var ipa_controls_header::sequence
+ * For ControlList packets that take part in delta encoding, the packet
+ * sequence number. Set to 0 otherwise.
  */
 
 static_assert(sizeof(ipa_controls_header) == 32,
@@ -203,8 +252,8 @@ static_assert(sizeof(ipa_controls_header) == 32,
  * \var ipa_control_value_entry::offset
  * The offset in bytes from the beginning of the data section to the control
  * value data (shall be a multiple of 8 bytes).
- * \var ipa_control_value_entry::padding
- * Padding bytes (shall be set to 0)
+ * \var ipa_control_value_entry::flags
+ * Entry flags, a combination of the IPA_CONTROL_VALUE_ENTRY_* values
  */
 
 static_assert(sizeof(ipa_control_value_entry) == 16,
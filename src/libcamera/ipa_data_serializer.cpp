@@ -48,6 +48,19 @@ namespace {
  * generated IPA proxies.
  */
 
+/**
+ * \fn template<typename T> void writePOD(std::vector<uint8_t> &vec, size_t pos, T val)
+ * \brief Overwrite a POD in a byte vector, in little-endian order
+ * \tparam T Type of POD to write
+ * \param[in] vec Byte vector to write to
+ * \param[in] pos Index in \a vec to start writing at
+ * \param[in] val Value to write
+ *
+ * This function is meant to be used by the IPA data serializer, and the
+ * generated IPA proxies, to backpatch a size appended with appendPOD() once the
+ * data it describes has been serialized in place.
+ */
+
 /**
  * \fn template<typename T> T readPOD(std::vector<uint8_t>::iterator it, size_t pos,
  * 				      std::vector<uint8_t>::iterator end)
@@ -102,6 +115,28 @@ namespace {
  * of \a data
  */
 
+/**
+ * \fn template<typename T> IPADataSerializer<T>::serialize(
+ * 	const T &data,
+ * 	std::vector<uint8_t> &dataVec,
+ * 	std::vector<SharedFD> &fdsVec,
+ * 	ControlSerializer *cs = nullptr)
+ * \brief Serialize an object at the end of a byte vector and fd vector
+ * \tparam T Type of object to serialize
+ * \param[in] data Object to serialize
+ * \param[inout] dataVec Byte vector to append the serialized data to
+ * \param[inout] fdsVec Fd vector to append the serialized fds to
+ * \param[in] cs ControlSerializer
+ *
+ * This version of serialize() writes the serialized form of \a data directly
+ * at the end of \a dataVec and \a fdsVec, without going through intermediate
+ * vectors. It allows serializing nested objects and IPC messages with a single
+ * copy of the data.
+ *
+ * \a cs is only necessary if the object type \a T or its members contain
+ * ControlList or ControlInfoMap.
+ */
+
 /**
  * \fn template<typename T> IPADataSerializer<T>::deserialize(
  * 	const std::vector<uint8_t> &data,
@@ -201,6 +236,15 @@ IPADataSerializer<type>::serialize(const type &data,			\
 }									\
 									\
 template<>								\
+void IPADataSerializer<type>::serialize(const type &data,		\
+					std::vector<uint8_t> &dataVec,	\
+					[[maybe_unused]] std::vector<SharedFD> &fdsVec, \
+					[[maybe_unused]] ControlSerializer *cs) \
+{									\
+	appendPOD<type>(dataVec, data);					\
+}									\
+									\
+template<>								\
 type IPADataSerializer<type>::deserialize(std::vector<uint8_t>::const_iterator dataBegin, \
 					  std::vector<uint8_t>::const_iterator dataEnd, \
 					  [[maybe_unused]] ControlSerializer *cs) \
@@ -258,6 +302,16 @@ IPADataSerializer<std::string>::serialize(const std::string &data,
 	return { { data.cbegin(), data.end() }, {} };
 }
 
+template<>
+void
+IPADataSerializer<std::string>::serialize(const std::string &data,
+					  std::vector<uint8_t> &dataVec,
+					  [[maybe_unused]] std::vector<SharedFD> &fdsVec,
+					  [[maybe_unused]] ControlSerializer *cs)
+{
+	dataVec.insert(dataVec.end(), data.cbegin(), data.cend());
+}
+
 template<>
 std::string
 IPADataSerializer<std::string>::deserialize(const std::vector<uint8_t> &data,
@@ -307,51 +361,75 @@ IPADataSerializer<std::string>::deserialize(std::vector<uint8_t>::const_iterator
  * be used. The serialized ControlInfoMap will have zero length.
  */
 template<>
-std::tuple<std::vector<uint8_t>, std::vector<SharedFD>>
-IPADataSerializer<ControlList>::serialize(const ControlList &data, ControlSerializer *cs)
+void
+IPADataSerializer<ControlList>::serialize(const ControlList &data,
+					  std::vector<uint8_t> &dataVec,
+					  [[maybe_unused]] std::vector<SharedFD> &fdsVec,
+					  ControlSerializer *cs)
 {
 	if (!cs)
 		LOG(IPADataSerializer, Fatal)
 			<< "ControlSerializer not provided for serialization of ControlList";
 
-	size_t size;
-	std::vector<uint8_t> infoData;
+	/*
+	 * The ControlInfoMap and ControlList are serialized directly at the
+	 * end of the byte vector, after the two sizes.
+	 */
+	size_t sizePos = dataVec.size();
+	size_t infoSize = 0;
 	int ret;
 
 	/*
 	 * \todo Revisit this opportunistic serialization of the
 	 * ControlInfoMap, as it could be fragile
 	 */
-	if (data.infoMap() && !cs->isCached(*data.infoMap())) {
-		size = cs->binarySize(*data.infoMap());
-		infoData.resize(size);
-		ByteStreamBuffer buffer(infoData.data(), infoData.size());
+	if (data.infoMap() && !cs->isCached(*data.infoMap()))
+		infoSize = cs->binarySize(*data.infoMap());
+
+	size_t listSize = cs->binarySize(data);
+
+	dataVec.resize(sizePos + 8 + infoSize + listSize);
+	uint8_t *infoData = dataVec.data() + sizePos + 8;
+	uint8_t *listData = infoData + infoSize;
+
+	if (infoSize) {
+		ByteStreamBuffer buffer(infoData, infoSize);
 		ret = cs->serialize(*data.infoMap(), buffer);
 
 		if (ret < 0 || buffer.overflow()) {
 			LOG(IPADataSerializer, Error) << "Failed to serialize ControlList's ControlInfoMap";
-			return { {}, {} };
+			dataVec.resize(sizePos);
+			return;
 		}
 	}
 
-	size = cs->binarySize(data);
-	std::vector<uint8_t> listData(size);
-	ByteStreamBuffer buffer(listData.data(), listData.size());
+	ByteStreamBuffer buffer(listData, listSize);
 	ret = cs->serialize(data, buffer);
 
 	if (ret < 0 || buffer.overflow()) {
 		LOG(IPADataSerializer, Error) << "Failed to serialize ControlList";
-		return { {}, {} };
+		dataVec.resize(sizePos);
+		return;
 	}
 
+	/* Delta-encoded lists may be smaller than the binarySize() estimate. */
+	listSize = buffer.offset();
+	dataVec.resize(sizePos + 8 + infoSize + listSize);
+
+	writePOD<uint32_t>(dataVec, sizePos, infoSize);
+	writePOD<uint32_t>(dataVec, sizePos + 4, listSize);
+}
+
+template<>
+std::tuple<std::vector<uint8_t>, std::vector<SharedFD>>
+IPADataSerializer<ControlList>::serialize(const ControlList &data, ControlSerializer *cs)
+{
 	std::vector<uint8_t> dataVec;
-	dataVec.reserve(8 + infoData.size() + listData.size());
-	appendPOD<uint32_t>(dataVec, infoData.size());
-	appendPOD<uint32_t>(dataVec, listData.size());
-	dataVec.insert(dataVec.end(), infoData.begin(), infoData.end());
-	dataVec.insert(dataVec.end(), listData.begin(), listData.end());
+	std::vector<SharedFD> fdsVec;
+
+	serialize(data, dataVec, fdsVec, cs);
 
-	return { dataVec, {} };
+	return { std::move(dataVec), {} };
 }
 
 template<>
@@ -431,29 +509,42 @@ IPADataSerializer<ControlList>::deserialize(std::vector<uint8_t>::const_iterator
  * X bytes - Serialized ControlInfoMap (using ControlSerializer)
  */
 template<>
-std::tuple<std::vector<uint8_t>, std::vector<SharedFD>>
+void
 IPADataSerializer<ControlInfoMap>::serialize(const ControlInfoMap &map,
+					     std::vector<uint8_t> &dataVec,
+					     [[maybe_unused]] std::vector<SharedFD> &fdsVec,
 					     ControlSerializer *cs)
 {
 	if (!cs)
 		LOG(IPADataSerializer, Fatal)
 			<< "ControlSerializer not provided for serialization of ControlInfoMap";
 
+	size_t sizePos = dataVec.size();
 	size_t size = cs->binarySize(map);
-	std::vector<uint8_t> infoData(size);
-	ByteStreamBuffer buffer(infoData.data(), infoData.size());
+
+	dataVec.resize(sizePos + 4 + size);
+	writePOD<uint32_t>(dataVec, sizePos, size);
+
+	ByteStreamBuffer buffer(dataVec.data() + sizePos + 4, size);
 	int ret = cs->serialize(map, buffer);
 
 	if (ret < 0 || buffer.overflow()) {
 		LOG(IPADataSerializer, Error) << "Failed to serialize ControlInfoMap";
-		return { {}, {} };
+		dataVec.resize(sizePos);
 	}
+}
 
+template<>
+std::tuple<std::vector<uint8_t>, std::vector<SharedFD>>
+IPADataSerializer<ControlInfoMap>::serialize(const ControlInfoMap &map,
+					     ControlSerializer *cs)
+{
 	std::vector<uint8_t> dataVec;
-	appendPOD<uint32_t>(dataVec, infoData.size());
-	dataVec.insert(dataVec.end(), infoData.begin(), infoData.end());
+	std::vector<SharedFD> fdsVec;
+
+	serialize(map, dataVec, fdsVec, cs);
 
-	return { dataVec, {} };
+	return { std::move(dataVec), {} };
 }
 
 template<>
@@ -521,13 +612,11 @@ IPADataSerializer<ControlInfoMap>::deserialize(std::vector<uint8_t>::const_itera
  * and it will be recursively consumed as necessary.
  */
 template<>
-std::tuple<std::vector<uint8_t>, std::vector<SharedFD>>
-IPADataSerializer<SharedFD>::serialize(const SharedFD &data,
-				       [[maybe_unused]] ControlSerializer *cs)
+void IPADataSerializer<SharedFD>::serialize(const SharedFD &data,
+					    std::vector<uint8_t> &dataVec,
+					    std::vector<SharedFD> &fdsVec,
+					    [[maybe_unused]] ControlSerializer *cs)
 {
-	std::vector<uint8_t> dataVec;
-	std::vector<SharedFD> fdVec;
-
 	/*
 	 * Store as uint32_t to prepare for conversion from validity flag
 	 * to index, and for alignment.
@@ -535,10 +624,20 @@ IPADataSerializer<SharedFD>::serialize(const SharedFD &data,
 	appendPOD<uint32_t>(dataVec, data.isValid());
 
 	if (data.isValid())
-		fdVec.push_back(data);
+		fdsVec.push_back(data);
+}
 
+template<>
+std::tuple<std::vector<uint8_t>, std::vector<SharedFD>>
+IPADataSerializer<SharedFD>::serialize(const SharedFD &data,
+				       [[maybe_unused]] ControlSerializer *cs)
+{
+	std::vector<uint8_t> dataVec;
+	std::vector<SharedFD> fdVec;
+
+	serialize(data, dataVec, fdVec);
 
-	return { dataVec, fdVec };
+	return { std::move(dataVec), std::move(fdVec) };
 }
 
 template<>
@@ -572,6 +671,19 @@ SharedFD IPADataSerializer<SharedFD>::deserialize(const std::vector<uint8_t> &da
  * 4 bytes - uint32_t Offset
  * 4 bytes - uint32_t Length
  */
+template<>
+void
+IPADataSerializer<FrameBuffer::Plane>::serialize(const FrameBuffer::Plane &data,
+						 std::vector<uint8_t> &dataVec,
+						 std::vector<SharedFD> &fdsVec,
+						 [[maybe_unused]] ControlSerializer *cs)
+{
+	IPADataSerializer<SharedFD>::serialize(data.fd, dataVec, fdsVec);
+
+	appendPOD<uint32_t>(dataVec, data.offset);
+	appendPOD<uint32_t>(dataVec, data.length);
+}
+
 template<>
 std::tuple<std::vector<uint8_t>, std::vector<SharedFD>>
 IPADataSerializer<FrameBuffer::Plane>::serialize(const FrameBuffer::Plane &data,
@@ -580,17 +692,9 @@ IPADataSerializer<FrameBuffer::Plane>::serialize(const FrameBuffer::Plane &data,
 	std::vector<uint8_t> dataVec;
 	std::vector<SharedFD> fdsVec;
 
-	std::vector<uint8_t> fdBuf;
-	std::vector<SharedFD> fdFds;
-	std::tie(fdBuf, fdFds) =
-		IPADataSerializer<SharedFD>::serialize(data.fd);
-	dataVec.insert(dataVec.end(), fdBuf.begin(), fdBuf.end());
-	fdsVec.insert(fdsVec.end(), fdFds.begin(), fdFds.end());
-
-	appendPOD<uint32_t>(dataVec, data.offset);
-	appendPOD<uint32_t>(dataVec, data.length);
+	serialize(data, dataVec, fdsVec);
 
-	return { dataVec, fdsVec };
+	return { std::move(dataVec), std::move(fdsVec) };
 }
 
 template<>
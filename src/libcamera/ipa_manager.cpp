@@ -9,7 +9,9 @@
 
 #include <algorithm>
 #include <dirent.h>
+#include <optional>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 
 #include <libcamera/base/file.h>
@@ -89,6 +91,13 @@ LOG_DEFINE_CATEGORY(IPAManager)
  * returned to the pipeline handler, and all interactions with the IPA context
  * go the same interface regardless of process isolation.
  *
+ * Modules are discovered when the manager is constructed, but are only parsed
+ * when a pipeline handler requests a module, in the search order, until a
+ * matching module is found. Pipeline handlers that don't create cameras thus
+ * don't incur the cost of parsing modules. Signature verification results are
+ * cached for the lifetime of the manager, and are invalidated when the module
+ * file is modified.
+ *
  * In all cases the data passed to the IPAInterface member functions is
  * serialized to Plain Old Data, either for the purpose of passing it to the IPA
  * context plain C API, or to transmit the data to the isolated process through
@@ -104,6 +113,7 @@ IPAManager *IPAManager::self_ = nullptr;
  * CameraManager.
  */
 IPAManager::IPAManager()
+	: nextModuleFile_(0)
 {
 	if (self_)
 		LOG(IPAManager, Fatal)
@@ -114,6 +124,9 @@ IPAManager::IPAManager()
 		LOG(IPAManager, Warning) << "Public key not valid";
 #endif
 
+	const char *prewarm = utils::secure_getenv("LIBCAMERA_IPA_PREWARM_WORKERS");
+	prewarmWorkers_ = prewarm && strcmp(prewarm, "0");
+
 	unsigned int ipaCount = 0;
 
 	/* User-specified paths take precedence. */
@@ -159,6 +172,11 @@ IPAManager::IPAManager()
 
 IPAManager::~IPAManager()
 {
+	MutexLocker locker(mutex_);
+
+	/* Terminate the spare proxy workers before deleting the modules. */
+	spareWorkers_.clear();
+
 	for (IPAModule *module : modules_)
 		delete module;
 
@@ -213,17 +231,18 @@ void IPAManager::parseDir(const char *libDir, unsigned int maxDepth,
 }
 
 /**
- * \brief Load IPA modules from a directory
+ * \brief Add the IPA modules in a directory to the search list
  * \param[in] libDir The directory to search for IPA modules
  * \param[in] maxDepth The maximum depth of sub-directories to search
  *
- * This function tries to create an IPAModule instance for every shared object
- * found in \a libDir, and skips invalid IPA modules.
+ * This function adds every shared object found in \a libDir to the list of
+ * candidate IPA modules. The shared objects are only parsed, and invalid IPA
+ * modules skipped, when a module is requested by a pipeline handler.
  *
  * Sub-directories are searched up to a depth of \a maxDepth. A \a maxDepth
  * value of 0 only searches the directory specified in \a libDir.
  *
- * \return Number of modules loaded by this call
+ * \return Number of candidate modules found by this call
  */
 unsigned int IPAManager::addDir(const char *libDir, unsigned int maxDepth)
 {
@@ -234,21 +253,10 @@ unsigned int IPAManager::addDir(const char *libDir, unsigned int maxDepth)
 	/* Ensure a stable ordering of modules. */
 	std::sort(files.begin(), files.end());
 
-	unsigned int count = 0;
-	for (const std::string &file : files) {
-		IPAModule *ipaModule = new IPAModule(file);
-		if (!ipaModule->isValid()) {
-			delete ipaModule;
-			continue;
-		}
-
-		LOG(IPAManager, Debug) << "Loaded IPA module '" << file << "'";
-
-		modules_.push_back(ipaModule);
-		count++;
-	}
+	MutexLocker locker(mutex_);
+	moduleFiles_.insert(moduleFiles_.end(), files.begin(), files.end());
 
-	return count;
+	return files.size();
 }
 
 /**
@@ -256,15 +264,39 @@ unsigned int IPAManager::addDir(const char *libDir, unsigned int maxDepth)
  * \param[in] pipe The pipeline handler
  * \param[in] minVersion Minimum acceptable version of IPA module
  * \param[in] maxVersion Maximum acceptable version of IPA module
+ *
+ * The modules parsed by previous calls are searched first. If none of them
+ * matches, the remaining candidate modules are parsed in the search order
+ * until a matching module is found, which preserves the precedence of the
+ * search paths.
  */
 IPAModule *IPAManager::module(PipelineHandler *pipe, uint32_t minVersion,
 			      uint32_t maxVersion)
 {
+	MutexLocker locker(mutex_);
+
 	for (IPAModule *module : modules_) {
 		if (module->match(pipe, minVersion, maxVersion))
 			return module;
 	}
 
+	while (nextModuleFile_ < moduleFiles_.size()) {
+		const std::string &file = moduleFiles_[nextModuleFile_++];
+
+		IPAModule *ipaModule = new IPAModule(file);
+		if (!ipaModule->isValid()) {
+			delete ipaModule;
+			continue;
+		}
+
+		LOG(IPAManager, Debug) << "Loaded IPA module '" << file << "'";
+
+		modules_.push_back(ipaModule);
+
+		if (ipaModule->match(pipe, minVersion, maxVersion))
+			return ipaModule;
+	}
+
 	return nullptr;
 }
 
@@ -279,6 +311,94 @@ IPAModule *IPAManager::module(PipelineHandler *pipe, uint32_t minVersion,
  * found or if the IPA proxy fails to initialize
  */
 
+/**
+ * \brief Create an IPC pipe to a proxy worker process for an isolated IPA
+ * \param[in] ipam The IPA module to run in the proxy worker
+ * \param[in] workerPath The path to the proxy worker executable
+ * \param[in] transport The IPC transport
+ *
+ * Starting a proxy worker involves executing a new process that then loads
+ * the IPA module, which delays the creation of isolated IPAs compared to
+ * IPAs running in the libcamera process. To hide that latency when the
+ * LIBCAMERA_IPA_PREWARM_WORKERS environment variable is set to a non-zero
+ * value, the IPAManager starts a spare proxy worker for the same IPA module
+ * every time one is handed out. The spare worker loads the IPA module in the
+ * background, and is returned by the next call for the same module, worker and
+ * transport, for instance when the pipeline handler creates the next camera.
+ * Spare workers that are still unused when camera enumeration completes are
+ * terminated by releaseSpareWorkers().
+ *
+ * Each proxy worker still hosts a single IPA instance, to preserve isolation
+ * between cameras.
+ *
+ * \return The IPC pipe, which may not be connected if the proxy worker failed
+ * to start
+ */
+std::unique_ptr<IPCPipeUnixSocket>
+IPAManager::createIPCPipe(const IPAModule *ipam, const std::string &workerPath,
+			  IPCPipeUnixSocket::Transport transport)
+{
+	WorkerId id{ ipam->path(), workerPath, transport };
+	std::unique_ptr<IPCPipeUnixSocket> ipc;
+
+	{
+		MutexLocker locker(self_->mutex_);
+
+		auto it = self_->spareWorkers_.find(id);
+		if (it != self_->spareWorkers_.end()) {
+			ipc = std::move(it->second);
+			self_->spareWorkers_.erase(it);
+		}
+	}
+
+	/* Fall back to starting a worker if the spare one has died. */
+	if (ipc && ipc->isConnected()) {
+		LOG(IPAManager, Debug)
+			<< "Using prestarted proxy worker for " << ipam->path();
+	} else {
+		ipc = std::make_unique<IPCPipeUnixSocket>(ipam->path().c_str(),
+							  workerPath.c_str(),
+							  transport);
+		if (!ipc->isConnected())
+			return ipc;
+	}
+
+	if (!self_->prewarmWorkers_)
+		return ipc;
+
+	auto spare = std::make_unique<IPCPipeUnixSocket>(ipam->path().c_str(),
+							 workerPath.c_str(),
+							 transport);
+	if (spare->isConnected()) {
+		MutexLocker locker(self_->mutex_);
+		self_->spareWorkers_[id] = std::move(spare);
+	}
+
+	return ipc;
+}
+
+/**
+ * \brief Terminate the spare proxy workers
+ *
+ * Spare proxy workers only speed up the creation of the cameras of a pipeline
+ * handler during enumeration. This function is called by the camera manager
+ * once enumeration completes, to avoid keeping idle processes around.
+ */
+void IPAManager::releaseSpareWorkers()
+{
+	std::map<WorkerId, std::unique_ptr<IPCPipeUnixSocket>> spares;
+
+	{
+		MutexLocker locker(mutex_);
+		spares = std::move(spareWorkers_);
+		spareWorkers_.clear();
+	}
+
+	if (!spares.empty())
+		LOG(IPAManager, Debug)
+			<< "Terminating " << spares.size() << " spare proxy workers";
+}
+
 #if HAVE_IPA_PUBKEY
 /**
  * \fn IPAManager::pubKey()
@@ -303,6 +423,33 @@ bool IPAManager::isSignatureValid([[maybe_unused]] IPAModule *ipa) const
 		return false;
 	}
 
+	/*
+	 * Verifying the signature requires hashing the whole module. Cache the
+	 * result, keyed by the identity of the file, to avoid verifying the
+	 * same module multiple times. A file replaced or modified on disk gets
+	 * a different identity and is verified again.
+	 */
+	auto fileId = [](const std::string &path) -> std::optional<FileId> {
+		struct stat st;
+		if (stat(path.c_str(), &st) < 0)
+			return std::nullopt;
+
+		return FileId{ st.st_dev, st.st_ino, st.st_mtim.tv_sec,
+			       st.st_mtim.tv_nsec, st.st_size };
+	};
+
+	std::optional<FileId> id = fileId(ipa->path());
+	if (!id)
+		return false;
+
+	{
+		MutexLocker locker(mutex_);
+
+		auto it = signatures_.find(*id);
+		if (it != signatures_.end())
+			return it->second;
+	}
+
 	File file{ ipa->path() };
 	if (!file.open(File::OpenModeFlag::ReadOnly))
 		return false;
@@ -317,6 +464,12 @@ bool IPAManager::isSignatureValid([[maybe_unused]] IPAModule *ipa) const
 		<< "IPA module " << ipa->path() << " signature is "
 		<< (valid ? "valid" : "not valid");
 
+	/* Only cache the result if the file hasn't changed while verifying. */
+	if (fileId(ipa->path()) == id) {
+		MutexLocker locker(mutex_);
+		signatures_[*id] = valid;
+	}
+
 	return valid;
 #else
 	return false;
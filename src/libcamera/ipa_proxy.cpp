@@ -214,6 +214,33 @@ std::string IPAProxy::resolvePath(const std::string &file) const
 	return std::string();
 }
 
+/**
+ * \brief Retrieve the IPC transport to use for isolated IPA modules
+ *
+ * Isolated IPA modules communicate with the proxy through a Unix socket, which
+ * copies every message payload through the kernel. Payloads can alternatively
+ * be transported through a shared memory ring, using the socket only for
+ * notifications and file descriptor passing. The transport is selected by the
+ * LIBCAMERA_IPA_IPC_TRANSPORT environment variable, set to "socket" (the
+ * default) or "shm".
+ *
+ * \return The IPC transport
+ */
+IPCPipeUnixSocket::Transport IPAProxy::ipcTransport() const
+{
+	const char *transport = utils::secure_getenv("LIBCAMERA_IPA_IPC_TRANSPORT");
+	if (!transport || !strcmp(transport, "socket"))
+		return IPCPipeUnixSocket::Transport::Socket;
+
+	if (!strcmp(transport, "shm"))
+		return IPCPipeUnixSocket::Transport::SharedMemory;
+
+	LOG(IPAProxy, Warning)
+		<< "Unknown IPC transport '" << transport << "', using socket";
+
+	return IPCPipeUnixSocket::Transport::Socket;
+}
+
 /**
  * \var IPAProxy::valid_
  * \brief Flag to indicate if the IPAProxy instance is valid
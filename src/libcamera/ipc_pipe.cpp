@@ -118,6 +118,62 @@ IPCUnixSocket::Payload IPCMessage::payload() const
 	return payload;
 }
 
+/**
+ * \brief Send the IPCMessage through an IPCUnixSocket
+ * \param[in] socket The socket to send the message through
+ *
+ * This function sends the message header and data to \a socket as a single
+ * payload, without copying them to an intermediate IPCUnixSocket payload as
+ * payload() does.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int IPCMessage::send(IPCUnixSocket &socket) const
+{
+	std::vector<int32_t> fds = rawFds();
+	std::array<Span<const uint8_t>, 2> data = buffers();
+
+	return socket.send(data, fds);
+}
+
+/**
+ * \brief Queue the IPCMessage to be sent in a batch through an IPCUnixSocket
+ * \param[in] socket The socket to queue the message on
+ *
+ * This function queues the message header and data on \a socket with
+ * IPCUnixSocket::queue(), without copying them to an intermediate
+ * IPCUnixSocket payload.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int IPCMessage::queue(IPCUnixSocket &socket) const
+{
+	std::vector<int32_t> fds = rawFds();
+	std::array<Span<const uint8_t>, 2> data = buffers();
+
+	return socket.queue(data, fds);
+}
+
+std::array<Span<const uint8_t>, 2> IPCMessage::buffers() const
+{
+	return {
+		Span<const uint8_t>{ reinterpret_cast<const uint8_t *>(&header_),
+				     sizeof(header_) },
+		Span<const uint8_t>{ data_ },
+	};
+}
+
+std::vector<int32_t> IPCMessage::rawFds() const
+{
+	std::vector<int32_t> fds;
+	fds.reserve(fds_.size());
+
+	for (const SharedFD &fd : fds_)
+		fds.push_back(fd.get());
+
+	return fds;
+}
+
 /**
  * \fn IPCMessage::header()
  * \brief Returns a reference to the header
@@ -153,8 +209,8 @@ IPCUnixSocket::Payload IPCMessage::payload() const
  * \brief IPC message pipe for IPA isolation
  *
  * Virtual class to model an IPC message pipe for use by IPA proxies for IPA
- * isolation. sendSync() and sendAsync() must be implemented, and the recvMessage
- * signal must be emitted whenever new data is available.
+ * isolation. sendSync(), sendAsync() and sendCall() must be implemented, and
+ * the recvMessage signal must be emitted whenever new data is available.
  */
 
 /**
@@ -204,6 +260,35 @@ IPCPipe::~IPCPipe()
  * \return Zero on success, negative error code otherwise
  */
 
+/**
+ * \typedef IPCPipe::ReplyHandler
+ * \brief Function called to complete a call sent with sendCall()
+ *
+ * The handler receives the result of the call in \a ret, 0 on success or a
+ * negative error code otherwise, and the reply in \a reply. The reply is only
+ * valid during the execution of the handler, and is empty if the call failed.
+ */
+
+/**
+ * \fn IPCPipe::sendCall()
+ * \brief Send a message over IPC without waiting for the reply
+ * \param[in] in Data to send
+ * \param[in] handler Function to call when the reply is received
+ *
+ * This function sends a message that expects a reply, as sendSync() does, but
+ * returns immediately after sending the message instead of waiting for the
+ * reply. The \a handler is called from the event loop when the reply is
+ * received or when the call times out.
+ *
+ * Replies are matched to calls through the cookie of the message header.
+ * Multiple calls may be in flight simultaneously, as long as their cookies are
+ * unique. Handlers of calls still in flight when the pipe is destroyed are not
+ * called.
+ *
+ * \return Zero if the message has been sent, negative error code otherwise. The
+ * \a handler is not called if the message can't be sent.
+ */
+
 /**
  * \var IPCPipe::recv
  * \brief Signal to be emitted when a message is received over IPC
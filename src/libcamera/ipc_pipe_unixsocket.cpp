@@ -7,6 +7,8 @@
 
 #include "libcamera/internal/ipc_pipe_unixsocket.h"
 
+#include <algorithm>
+#include <string.h>
 #include <vector>
 
 #include <libcamera/base/event_dispatcher.h>
@@ -24,9 +26,19 @@ namespace libcamera {
 
 LOG_DECLARE_CATEGORY(IPCPipe)
 
+/*
+ * Size of the shared memory ring for each direction. This is large enough to
+ * hold several per-frame messages in flight.
+ */
+static constexpr size_t kSharedMemoryRingSize = 256 * 1024;
+
+/* Maximum time to wait for the reply to a call. */
+static constexpr std::chrono::milliseconds kCallTimeout = 2000ms;
+
 IPCPipeUnixSocket::IPCPipeUnixSocket(const char *ipaModulePath,
-				     const char *ipaProxyWorkerPath)
-	: IPCPipe()
+				     const char *ipaProxyWorkerPath,
+				     Transport transport)
+	: IPCPipe(), flushPending_(false)
 {
 	std::vector<int> fds;
 	std::vector<std::string> args;
@@ -39,6 +51,16 @@ IPCPipeUnixSocket::IPCPipeUnixSocket(const char *ipaModulePath,
 		return;
 	}
 	socket_->readyRead.connect(this, &IPCPipeUnixSocket::readyRead);
+	callTimer_.timeout.connect(this, &IPCPipeUnixSocket::callTimeout);
+
+	if (transport == Transport::SharedMemory) {
+		int ret = socket_->enableSharedMemory(kSharedMemoryRingSize);
+		if (ret)
+			LOG(IPCPipe, Warning)
+				<< "Failed to enable shared memory transport, using socket: "
+				<< strerror(-ret);
+	}
+
 	args.push_back(std::to_string(fd.get()));
 	fds.push_back(fd.get());
 
@@ -50,18 +72,24 @@ IPCPipeUnixSocket::IPCPipeUnixSocket(const char *ipaModulePath,
 		return;
 	}
 
+	/* The pipe can't be used anymore once the worker has exited. */
+	proc_->finished.connect(this, [this](enum Process::ExitStatus, int) {
+		connected_ = false;
+	});
+
 	connected_ = true;
 }
 
 IPCPipeUnixSocket::~IPCPipeUnixSocket()
 {
+	flush();
 }
 
 int IPCPipeUnixSocket::sendSync(const IPCMessage &in, IPCMessage *out)
 {
 	IPCUnixSocket::Payload response;
 
-	int ret = call(in.payload(), &response, in.header().cookie);
+	int ret = call(in, &response);
 	if (ret) {
 		LOG(IPCPipe, Error) << "Failed to call sync";
 		return ret;
@@ -75,12 +103,23 @@ int IPCPipeUnixSocket::sendSync(const IPCMessage &in, IPCMessage *out)
 
 int IPCPipeUnixSocket::sendAsync(const IPCMessage &data)
 {
-	int ret = socket_->send(data.payload());
+	/*
+	 * Coalesce asynchronous calls issued back-to-back in the same event
+	 * loop iteration, and send them in a single message when returning to
+	 * the event loop. Synchronous calls flush the batch first, preserving
+	 * ordering.
+	 */
+	int ret = data.queue(*socket_);
 	if (ret) {
 		LOG(IPCPipe, Error) << "Failed to call async";
 		return ret;
 	}
 
+	if (!flushPending_) {
+		flushPending_ = true;
+		invokeMethod(&IPCPipeUnixSocket::flush, ConnectionTypeQueued);
+	}
+
 	return 0;
 }
 
@@ -103,6 +142,13 @@ void IPCPipeUnixSocket::readyRead()
 
 	auto callData = callData_.find(ipcMessage.header().cookie);
 	if (callData != callData_.end()) {
+		if (callData->second.handler) {
+			ReplyHandler handler = std::move(callData->second.handler);
+			callData_.erase(callData);
+			handler(0, ipcMessage);
+			return;
+		}
+
 		*callData->second.response = std::move(payload);
 		callData->second.done = true;
 		return;
@@ -112,23 +158,94 @@ void IPCPipeUnixSocket::readyRead()
 	recv.emit(ipcMessage);
 }
 
-int IPCPipeUnixSocket::call(const IPCUnixSocket::Payload &message,
-			    IPCUnixSocket::Payload *response, uint32_t cookie)
+int IPCPipeUnixSocket::sendCall(const IPCMessage &in, ReplyHandler handler)
+{
+	utils::time_point deadline = utils::clock::now() + kCallTimeout;
+	uint32_t cookie = in.header().cookie;
+
+	const auto result = callData_.insert({ cookie, { nullptr, false, std::move(handler), deadline } });
+	if (!result.second) {
+		LOG(IPCPipe, Error) << "Call with cookie " << cookie << " already in flight";
+		return -EBUSY;
+	}
+
+	int ret = in.send(*socket_);
+	if (ret) {
+		LOG(IPCPipe, Error) << "Failed to send call";
+		callData_.erase(result.first);
+		return ret;
+	}
+
+	/*
+	 * Deadlines are monotonic, a running timer thus already expires
+	 * before this call's deadline.
+	 */
+	if (!callTimer_.isRunning())
+		callTimer_.start(deadline);
+
+	return 0;
+}
+
+void IPCPipeUnixSocket::callTimeout()
+{
+	utils::time_point now = utils::clock::now();
+	std::vector<ReplyHandler> expired;
+	utils::time_point next = utils::time_point::max();
+
+	for (auto it = callData_.begin(); it != callData_.end();) {
+		CallData &data = it->second;
+
+		if (!data.handler) {
+			++it;
+			continue;
+		}
+
+		if (data.deadline <= now) {
+			expired.push_back(std::move(data.handler));
+			it = callData_.erase(it);
+			continue;
+		}
+
+		next = std::min(next, data.deadline);
+		++it;
+	}
+
+	if (next != utils::time_point::max())
+		callTimer_.start(next);
+
+	for (ReplyHandler &handler : expired) {
+		LOG(IPCPipe, Error) << "Call timeout!";
+		handler(-ETIMEDOUT, IPCMessage());
+	}
+}
+
+void IPCPipeUnixSocket::flush()
+{
+	flushPending_ = false;
+
+	int ret = socket_->flush();
+	if (ret)
+		LOG(IPCPipe, Error) << "Failed to flush async calls";
+}
+
+int IPCPipeUnixSocket::call(const IPCMessage &message,
+			    IPCUnixSocket::Payload *response)
 {
+	uint32_t cookie = message.header().cookie;
 	Timer timeout;
 	int ret;
 
-	const auto result = callData_.insert({ cookie, { response, false } });
+	const auto result = callData_.insert({ cookie, { response, false, {}, {} } });
 	const auto &iter = result.first;
 
-	ret = socket_->send(message);
+	ret = message.send(*socket_);
 	if (ret) {
 		callData_.erase(iter);
 		return ret;
 	}
 
 	/* \todo Make this less dangerous, see IPCPipe::sendSync() */
-	timeout.start(2000ms);
+	timeout.start(kCallTimeout);
 	while (!iter->second.done) {
 		if (!timeout.isRunning()) {
 			LOG(IPCPipe, Error) << "Call timeout!";
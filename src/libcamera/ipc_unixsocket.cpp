@@ -7,14 +7,22 @@
 
 #include "libcamera/internal/ipc_unixsocket.h"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <fcntl.h>
+#include <limits.h>
+#include <new>
 #include <poll.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <libcamera/base/event_notifier.h>
 #include <libcamera/base/log.h>
+#include <libcamera/base/span.h>
 
 /**
  * \file ipc_unixsocket.h
@@ -25,6 +33,265 @@ namespace libcamera {
 
 LOG_DEFINE_CATEGORY(IPCUnixSocket)
 
+namespace {
+
+/* The message payload is stored in the shared memory ring. */
+constexpr uint8_t HeaderFlagRing = 1 << 0;
+/* The message carries the shared memory ring file descriptor. */
+constexpr uint8_t HeaderFlagRingSetup = 1 << 1;
+/* The message payload is a batch of several payloads. */
+constexpr uint8_t HeaderFlagBatch = 1 << 2;
+
+/*
+ * Maximum size of a batch of payloads. Larger payloads are sent individually
+ * to avoid copying them into the batch.
+ */
+constexpr size_t kMaxBatchSize = 16 * 1024;
+
+/*
+ * Each payload in a batch is prefixed with its size and its number of file
+ * descriptors. The file descriptors of all payloads are concatenated.
+ */
+struct BatchEntry {
+	uint32_t data;
+	uint32_t fds;
+};
+
+} /* namespace */
+
+/*
+ * The shared memory ring is a memfd-backed memory area that stores two
+ * single-producer, single-consumer byte rings, one for each direction of the
+ * IPC channel. The memory starts with a control page containing the ring size
+ * and the head and tail indices of both rings, followed by the data of the two
+ * rings.
+ *
+ * Both processes keep their own copy of the indices they own (the head for the
+ * producer, the tail for the consumer) and only publish them in shared memory.
+ * Indices read from shared memory are untrusted and are validated before use,
+ * and all accesses to the ring data are masked with the ring size, so that a
+ * misbehaving peer can't cause out-of-bounds accesses.
+ */
+class IPCUnixSocket::SharedRing
+{
+public:
+	static std::unique_ptr<SharedRing> create(size_t size);
+	static std::unique_ptr<SharedRing> map(UniqueFD fd);
+
+	~SharedRing();
+
+	const UniqueFD &fd() const { return fd_; }
+
+	bool write(Span<const Span<const uint8_t>> data);
+	void rollback(size_t size);
+	int read(Span<uint8_t> data);
+
+private:
+	static constexpr uint32_t kMagic = 0x4c435352;
+	static constexpr size_t kControlSize = 4096;
+	static constexpr unsigned int kSeals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+
+	struct Control {
+		alignas(64) std::atomic<uint32_t> head;
+		alignas(64) std::atomic<uint32_t> tail;
+	};
+
+	struct Layout {
+		uint32_t magic;
+		uint32_t size;
+		Control rings[2];
+	};
+
+	static_assert(std::atomic<uint32_t>::is_always_lock_free);
+	static_assert(sizeof(Layout) <= kControlSize);
+
+	SharedRing(UniqueFD fd, void *mem, size_t size, unsigned int tx);
+
+	UniqueFD fd_;
+	void *mem_;
+	uint32_t size_;
+
+	Control *tx_;
+	Control *rx_;
+	uint8_t *txData_;
+	uint8_t *rxData_;
+	uint32_t txHead_;
+	uint32_t rxTail_;
+};
+
+IPCUnixSocket::SharedRing::SharedRing(UniqueFD fd, void *mem, size_t size,
+				      unsigned int tx)
+	: fd_(std::move(fd)), mem_(mem), size_(size), txHead_(0), rxTail_(0)
+{
+	Layout *layout = static_cast<Layout *>(mem_);
+	uint8_t *data = static_cast<uint8_t *>(mem_) + kControlSize;
+
+	tx_ = &layout->rings[tx];
+	rx_ = &layout->rings[!tx];
+	txData_ = data + tx * size_;
+	rxData_ = data + !tx * size_;
+}
+
+IPCUnixSocket::SharedRing::~SharedRing()
+{
+	munmap(mem_, kControlSize + 2 * size_);
+}
+
+/*
+ * Create a new shared memory ring with \a size bytes in each direction, rounded
+ * up to a power of two. The memfd is sealed to prevent the peer from resizing
+ * it.
+ */
+std::unique_ptr<IPCUnixSocket::SharedRing>
+IPCUnixSocket::SharedRing::create(size_t size)
+{
+	if (!size || size > (1U << 30))
+		return nullptr;
+
+	size_t ringSize = 1;
+	while (ringSize < size)
+		ringSize <<= 1;
+
+	UniqueFD fd(memfd_create("libcamera-ipc", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+	if (!fd.isValid()) {
+		LOG(IPCUnixSocket, Error)
+			<< "Failed to create memfd: " << strerror(errno);
+		return nullptr;
+	}
+
+	size_t mapSize = kControlSize + 2 * ringSize;
+	if (ftruncate(fd.get(), mapSize) < 0 ||
+	    fcntl(fd.get(), F_ADD_SEALS, kSeals) < 0) {
+		LOG(IPCUnixSocket, Error)
+			<< "Failed to size memfd: " << strerror(errno);
+		return nullptr;
+	}
+
+	void *mem = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+			 fd.get(), 0);
+	if (mem == MAP_FAILED) {
+		LOG(IPCUnixSocket, Error)
+			<< "Failed to map memfd: " << strerror(errno);
+		return nullptr;
+	}
+
+	Layout *layout = new (mem) Layout{};
+	layout->magic = kMagic;
+	layout->size = ringSize;
+
+	return std::unique_ptr<SharedRing>(new SharedRing(std::move(fd), mem,
+							  ringSize, 0));
+}
+
+/*
+ * Map a shared memory ring created by the peer with create(). The memfd seals
+ * are verified to ensure that the peer can't shrink the memory and cause
+ * faults on access.
+ */
+std::unique_ptr<IPCUnixSocket::SharedRing>
+IPCUnixSocket::SharedRing::map(UniqueFD fd)
+{
+	int seals = fcntl(fd.get(), F_GET_SEALS);
+	if (seals < 0 || (seals & kSeals) != kSeals) {
+		LOG(IPCUnixSocket, Error) << "Shared memory ring isn't sealed";
+		return nullptr;
+	}
+
+	struct stat st;
+	if (fstat(fd.get(), &st) < 0 ||
+	    st.st_size < static_cast<off_t>(kControlSize)) {
+		LOG(IPCUnixSocket, Error) << "Invalid shared memory ring size";
+		return nullptr;
+	}
+
+	void *mem = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			 fd.get(), 0);
+	if (mem == MAP_FAILED) {
+		LOG(IPCUnixSocket, Error)
+			<< "Failed to map memfd: " << strerror(errno);
+		return nullptr;
+	}
+
+	const Layout *layout = static_cast<const Layout *>(mem);
+	uint32_t ringSize = layout->size;
+
+	if (layout->magic != kMagic || !ringSize || (ringSize & (ringSize - 1)) ||
+	    static_cast<off_t>(kControlSize + 2 * static_cast<size_t>(ringSize)) != st.st_size) {
+		LOG(IPCUnixSocket, Error) << "Invalid shared memory ring layout";
+		munmap(mem, st.st_size);
+		return nullptr;
+	}
+
+	return std::unique_ptr<SharedRing>(new SharedRing(std::move(fd), mem,
+							  ringSize, 1));
+}
+
+/*
+ * Write the concatenation of the \a data buffers to the transmit ring. Return
+ * false if not enough space is available, in which case the caller shall send
+ * the data through the socket.
+ */
+bool IPCUnixSocket::SharedRing::write(Span<const Span<const uint8_t>> data)
+{
+	size_t size = 0;
+	for (const Span<const uint8_t> &buffer : data)
+		size += buffer.size();
+
+	if (!size)
+		return true;
+
+	uint32_t used = txHead_ - tx_->tail.load(std::memory_order_acquire);
+	if (used > size_ || size > size_ - used)
+		return false;
+
+	for (const Span<const uint8_t> &buffer : data) {
+		uint32_t offset = txHead_ & (size_ - 1);
+		size_t first = std::min<size_t>(buffer.size(), size_ - offset);
+
+		memcpy(txData_ + offset, buffer.data(), first);
+		memcpy(txData_, buffer.data() + first, buffer.size() - first);
+
+		txHead_ += buffer.size();
+	}
+
+	tx_->head.store(txHead_, std::memory_order_release);
+
+	return true;
+}
+
+/*
+ * Discard the last \a size bytes written to the transmit ring, when the message
+ * that references them couldn't be sent. The peer reads the ring only when it
+ * receives a message, it thus never consumes the discarded data.
+ */
+void IPCUnixSocket::SharedRing::rollback(size_t size)
+{
+	txHead_ -= size;
+	tx_->head.store(txHead_, std::memory_order_release);
+}
+
+/* Read \a data from the receive ring. */
+int IPCUnixSocket::SharedRing::read(Span<uint8_t> data)
+{
+	if (data.empty())
+		return 0;
+
+	uint32_t available = rx_->head.load(std::memory_order_acquire) - rxTail_;
+	if (available > size_ || data.size() > available)
+		return -EPROTO;
+
+	uint32_t offset = rxTail_ & (size_ - 1);
+	size_t first = std::min<size_t>(data.size(), size_ - offset);
+
+	memcpy(data.data(), rxData_ + offset, first);
+	memcpy(data.data() + first, rxData_, data.size() - first);
+
+	rxTail_ += data.size();
+	rx_->tail.store(rxTail_, std::memory_order_release);
+
+	return 0;
+}
+
 /**
  * \struct IPCUnixSocket::Payload
  * \brief Container for an IPC payload
@@ -65,11 +332,24 @@ LOG_DEFINE_CATEGORY(IPCUnixSocket)
  * it to the other side by passing the file descriptor to bind(). At that point
  * the channel is operation and communication is bidirectional and symmmetrical.
  *
+ * By default, message payloads are copied through the socket. To reduce the
+ * number of system calls and data copies, the side that creates the channel
+ * can call enableSharedMemory() to share a memory ring with the remote side.
+ * Payloads are then written directly to shared memory, and the socket only
+ * carries a small notification along with the file descriptors. The remote
+ * side needs no specific action, and enables the shared memory ring
+ * automatically when notified by the peer.
+ *
+ * Payloads can also be coalesced with queue() and sent together in a single
+ * message with flush(), to reduce the number of wakeups of the remote side when
+ * several messages are sent back-to-back. The remote side receives them as
+ * individual payloads, in order.
+ *
  * \context This class is \threadbound.
  */
 
 IPCUnixSocket::IPCUnixSocket()
-	: headerReceived_(false), notifier_(nullptr)
+	: headerReceived_(false), notifier_(nullptr), received_(0)
 {
 }
 
@@ -119,7 +399,8 @@ UniqueFD IPCUnixSocket::create()
  *
  * This function binds the socket instance to an existing IPC channel identified
  * by the file descriptor \a fd. The file descriptor is obtained from the
- * IPCUnixSocket::create() function.
+ * IPCUnixSocket::create() function, or is a connected SOCK_SEQPACKET Unix
+ * socket, which preserves message boundaries as required by the IPC protocol.
  *
  * \return 0 on success or a negative error code otherwise
  */
@@ -148,6 +429,20 @@ void IPCUnixSocket::close()
 	delete notifier_;
 	notifier_ = nullptr;
 
+	for (int32_t fd : headerFds_)
+		::close(fd);
+	headerFds_.clear();
+
+	ring_.reset();
+
+	batchData_.clear();
+	batchFds_.clear();
+	for (const Payload &payload : pending_) {
+		for (int32_t fd : payload.fds)
+			::close(fd);
+	}
+	pending_.clear();
+
 	fd_.reset();
 	headerReceived_ = false;
 }
@@ -161,39 +456,213 @@ bool IPCUnixSocket::isBound() const
 	return fd_.isValid();
 }
 
+/**
+ * \brief Transport message payloads through shared memory
+ * \param[in] size The size of the shared memory ring for each direction, in bytes
+ *
+ * This function creates a shared memory ring of at least \a size bytes for each
+ * direction of the IPC channel, and shares it with the remote side. Subsequent
+ * message payloads are transported through the ring, in both directions, when
+ * they fit in the available space, and through the socket otherwise.
+ *
+ * This function shall be called on the side that has created the channel, and
+ * may only be called once.
+ *
+ * \return 0 on success or a negative error code otherwise
+ * \retval -ENOTCONN The socket is not connected
+ * \retval -EBUSY The shared memory ring is already enabled
+ * \retval -ENOMEM The shared memory ring can't be created
+ */
+int IPCUnixSocket::enableSharedMemory(size_t size)
+{
+	if (!isBound())
+		return -ENOTCONN;
+
+	if (ring_)
+		return -EBUSY;
+
+	std::unique_ptr<SharedRing> ring = SharedRing::create(size);
+	if (!ring)
+		return -ENOMEM;
+
+	Header hdr = {};
+	hdr.fds = 1;
+	hdr.flags = HeaderFlagRingSetup;
+
+	int32_t fd = ring->fd().get();
+	Span<const uint8_t> data{ reinterpret_cast<const uint8_t *>(&hdr), sizeof(hdr) };
+	int ret = sendData({ &data, 1 }, { &fd, 1 });
+	if (ret)
+		return ret;
+
+	ring_ = std::move(ring);
+
+	return 0;
+}
+
 /**
  * \brief Send a message payload
  * \param[in] payload Message payload to send
  *
  * This function queues the message payload for transmission to the other end of
  * the IPC channel. It returns immediately, before the message is delivered to
- * the remote side.
+ * the remote side. Payloads previously queued with queue() are flushed first.
  *
  * \return 0 on success or a negative error code otherwise
  */
 int IPCUnixSocket::send(const Payload &payload)
 {
-	int ret;
+	Span<const uint8_t> data{ payload.data };
+	return send({ &data, 1 }, payload.fds);
+}
 
+/**
+ * \brief Send a message payload gathered from multiple buffers
+ * \param[in] data Buffers containing the message payload data
+ * \param[in] fds File descriptors to send along with the message
+ *
+ * This function sends a message payload made of the concatenation of the
+ * \a data buffers, without copying them into a single buffer first. It
+ * otherwise behaves as send(const Payload &payload).
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int IPCUnixSocket::send(Span<const Span<const uint8_t>> data,
+			Span<const int32_t> fds)
+{
 	if (!isBound())
 		return -ENOTCONN;
 
-	Header hdr = {};
-	hdr.data = payload.data.size();
-	hdr.fds = payload.fds.size();
+	if (payloadSize(data) == 0 && fds.empty())
+		return -EINVAL;
 
-	if (!hdr.data && !hdr.fds)
+	if (fds.size() > UINT8_MAX)
 		return -EINVAL;
 
-	ret = ::send(fd_.get(), &hdr, sizeof(hdr), 0);
-	if (ret < 0) {
-		ret = -errno;
-		LOG(IPCUnixSocket, Error)
-			<< "Failed to send: " << strerror(-ret);
+	int ret = flush();
+	if (ret)
 		return ret;
+
+	return sendPayload(data, fds, 0);
+}
+
+/**
+ * \brief Queue a message payload to be sent in a batch
+ * \param[in] payload Message payload to queue
+ *
+ * This function adds the message payload to the current batch, to be sent
+ * along with other queued payloads in a single message by flush(). The batch is
+ * flushed automatically when it becomes too large, and before any payload sent
+ * with send(), to guarantee ordering. Large payloads are not batched and are
+ * sent immediately. The file descriptors of queued payloads are duplicated, the
+ * caller may close them as soon as this function returns.
+ *
+ * Callers are responsible for calling flush() once they are done queuing
+ * payloads.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int IPCUnixSocket::queue(const Payload &payload)
+{
+	Span<const uint8_t> data{ payload.data };
+	return queue({ &data, 1 }, payload.fds);
+}
+
+/**
+ * \brief Queue a message payload gathered from multiple buffers
+ * \param[in] data Buffers containing the message payload data
+ * \param[in] fds File descriptors to send along with the message
+ *
+ * This function queues a message payload made of the concatenation of the
+ * \a data buffers. It otherwise behaves as queue(const Payload &payload).
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int IPCUnixSocket::queue(Span<const Span<const uint8_t>> data,
+			 Span<const int32_t> fds)
+{
+	if (!isBound())
+		return -ENOTCONN;
+
+	size_t dataSize = payloadSize(data);
+	if (dataSize == 0 && fds.empty())
+		return -EINVAL;
+
+	if (fds.size() > UINT8_MAX)
+		return -EINVAL;
+
+	size_t size = sizeof(BatchEntry) + dataSize;
+	if (size > kMaxBatchSize)
+		return send(data, fds);
+
+	if (batchData_.size() + size > kMaxBatchSize ||
+	    batchFds_.size() + fds.size() > UINT8_MAX) {
+		int ret = flush();
+		if (ret)
+			return ret;
+	}
+
+	/*
+	 * The batch is sent later, the file descriptors may be closed by then.
+	 * Duplicate them to keep them valid until the batch is flushed.
+	 */
+	std::vector<UniqueFD> dups;
+	dups.reserve(fds.size());
+	for (int32_t fd : fds) {
+		UniqueFD dup(fcntl(fd, F_DUPFD_CLOEXEC, 0));
+		if (!dup.isValid()) {
+			int ret = -errno;
+			LOG(IPCUnixSocket, Error)
+				<< "Failed to duplicate fd: " << strerror(-ret);
+			return ret;
+		}
+
+		dups.push_back(std::move(dup));
 	}
 
-	return sendData(payload.data.data(), hdr.data, payload.fds.data(), hdr.fds);
+	BatchEntry entry = {
+		static_cast<uint32_t>(dataSize),
+		static_cast<uint32_t>(fds.size()),
+	};
+
+	const uint8_t *ptr = reinterpret_cast<const uint8_t *>(&entry);
+	batchData_.insert(batchData_.end(), ptr, ptr + sizeof(entry));
+	for (const Span<const uint8_t> &buffer : data)
+		batchData_.insert(batchData_.end(), buffer.begin(), buffer.end());
+	for (UniqueFD &dup : dups)
+		batchFds_.push_back(std::move(dup));
+
+	return 0;
+}
+
+/**
+ * \brief Send all payloads queued with queue()
+ *
+ * This function sends all payloads queued with queue() in a single message. It
+ * returns immediately if no payload is queued.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int IPCUnixSocket::flush()
+{
+	if (batchData_.empty())
+		return 0;
+
+	if (!isBound())
+		return -ENOTCONN;
+
+	std::vector<int32_t> fds;
+	fds.reserve(batchFds_.size());
+	for (const UniqueFD &fd : batchFds_)
+		fds.push_back(fd.get());
+
+	Span<const uint8_t> data{ batchData_ };
+	int ret = sendPayload({ &data, 1 }, fds, HeaderFlagBatch);
+
+	batchData_.clear();
+	batchFds_.clear();
+
+	return ret;
 }
 
 /**
@@ -218,19 +687,30 @@ int IPCUnixSocket::receive(Payload *payload)
 	if (!isBound())
 		return -ENOTCONN;
 
-	if (!headerReceived_)
-		return -EAGAIN;
+	/* Payloads remaining from a batch precede any new message. */
+	if (pending_.empty()) {
+		if (!headerReceived_)
+			return -EAGAIN;
 
-	payload->data.resize(header_.data);
-	payload->fds.resize(header_.fds);
+		bool batch = header_.flags & HeaderFlagBatch;
 
-	int ret = recvData(payload->data.data(), header_.data,
-			   payload->fds.data(), header_.fds);
-	if (ret < 0)
-		return ret;
+		int ret = receivePayload(payload);
+		if (ret < 0)
+			return ret;
 
-	headerReceived_ = false;
-	notifier_->setEnabled(true);
+		if (!batch) {
+			received_++;
+			return 0;
+		}
+
+		ret = splitBatch(*payload);
+		if (ret < 0)
+			return ret;
+	}
+
+	*payload = std::move(pending_.front());
+	pending_.pop_front();
+	received_++;
 
 	return 0;
 }
@@ -240,13 +720,81 @@ int IPCUnixSocket::receive(Payload *payload)
  * \brief A Signal emitted when a message is ready to be read
  */
 
-int IPCUnixSocket::sendData(const void *buffer, size_t length,
-			    const int32_t *fds, unsigned int num)
+/**
+ * \var IPCUnixSocket::disconnected
+ * \brief A Signal emitted when the remote side closes the channel
+ *
+ * The signal is only emitted for connection-oriented sockets, such as
+ * SOCK_SEQPACKET sockets bound with bind(), as datagram sockets don't report
+ * the remote side closing the channel. No message can be received after the
+ * signal is emitted, and the socket should be closed.
+ */
+
+size_t IPCUnixSocket::payloadSize(Span<const Span<const uint8_t>> data)
 {
-	struct iovec iov[1];
-	iov[0].iov_base = const_cast<void *>(buffer);
-	iov[0].iov_len = length;
+	size_t size = 0;
+	for (const Span<const uint8_t> &buffer : data)
+		size += buffer.size();
+
+	return size;
+}
+
+int IPCUnixSocket::sendPayload(Span<const Span<const uint8_t>> data,
+			       Span<const int32_t> fds, uint8_t flags)
+{
+	int ret;
 
+	Header hdr = {};
+	hdr.data = payloadSize(data);
+	hdr.fds = fds.size();
+	hdr.flags = flags;
+
+	Span<const uint8_t> header{ reinterpret_cast<const uint8_t *>(&hdr), sizeof(hdr) };
+
+	/*
+	 * Store the data in the shared memory ring if possible, and send the
+	 * header and file descriptors in a single message.
+	 */
+	if (ring_ && ring_->write(data)) {
+		hdr.flags |= HeaderFlagRing;
+
+		ret = sendData({ &header, 1 }, fds);
+		if (ret < 0)
+			ring_->rollback(hdr.data);
+
+		return ret;
+	}
+
+	ret = ::send(fd_.get(), &hdr, sizeof(hdr), 0);
+	if (ret < 0) {
+		ret = -errno;
+		LOG(IPCUnixSocket, Error)
+			<< "Failed to send: " << strerror(-ret);
+		return ret;
+	}
+
+	return sendData(data, fds);
+}
+
+/**
+ * \var IPCUnixSocket::readyRead
+ * \brief A Signal emitted when a message is ready to be read
+ */
+
+/*
+ * Send the concatenation of the \a data buffers in a single datagram, gathering
+ * them with an I/O vector to avoid copies.
+ */
+int IPCUnixSocket::sendData(Span<const Span<const uint8_t>> data,
+			    Span<const int32_t> fds)
+{
+	struct iovec iov[std::max<size_t>(data.size(), 1)];
+	for (size_t i = 0; i < data.size(); ++i) {
+		iov[i].iov_base = const_cast<uint8_t *>(data[i].data());
+		iov[i].iov_len = data[i].size();
+	}
+
+	unsigned int num = fds.size();
 	char buf[CMSG_SPACE(num * sizeof(uint32_t))];
 	memset(buf, 0, sizeof(buf));
 
@@ -259,12 +807,12 @@ int IPCUnixSocket::sendData(const void *buffer, size_t length,
 	msg.msg_name = nullptr;
 	msg.msg_namelen = 0;
 	msg.msg_iov = iov;
-	msg.msg_iovlen = 1;
+	msg.msg_iovlen = data.size();
 	msg.msg_control = cmsg;
 	msg.msg_controllen = cmsg->cmsg_len;
 	msg.msg_flags = 0;
-	if (fds)
-		memcpy(CMSG_DATA(cmsg), fds, num * sizeof(uint32_t));
+	if (num)
+		memcpy(CMSG_DATA(cmsg), fds.data(), num * sizeof(uint32_t));
 
 	if (sendmsg(fd_.get(), &msg, 0) < 0) {
 		int ret = -errno;
@@ -314,15 +862,167 @@ int IPCUnixSocket::recvData(void *buffer, size_t length,
 	return 0;
 }
 
+int IPCUnixSocket::receivePayload(Payload *payload)
+{
+	payload->data.resize(header_.data);
+
+	if (header_.flags & HeaderFlagRing) {
+		payload->fds = std::move(headerFds_);
+		headerFds_.clear();
+
+		headerReceived_ = false;
+		notifier_->setEnabled(true);
+
+		int ret = ring_ ? ring_->read(payload->data) : -EPROTO;
+		if (ret < 0) {
+			LOG(IPCUnixSocket, Error)
+				<< "Failed to read payload from shared memory";
+			for (int32_t fd : payload->fds)
+				::close(fd);
+			payload->fds.clear();
+		}
+
+		return ret;
+	}
+
+	payload->fds.resize(header_.fds);
+
+	int ret = recvData(payload->data.data(), header_.data,
+			   payload->fds.data(), header_.fds);
+	if (ret < 0)
+		return ret;
+
+	headerReceived_ = false;
+	notifier_->setEnabled(true);
+
+	return 0;
+}
+
+/*
+ * Split a batch into individual payloads, and append them to the pending
+ * payloads. The batch is validated first, and discarded as a whole if
+ * malformed.
+ */
+int IPCUnixSocket::splitBatch(Payload &batch)
+{
+	Span<const uint8_t> data = batch.data;
+	size_t numFds = 0;
+
+	while (!data.empty()) {
+		BatchEntry entry;
+		if (data.size() < sizeof(entry))
+			break;
+
+		memcpy(&entry, data.data(), sizeof(entry));
+		data = data.subspan(sizeof(entry));
+
+		if (entry.data > data.size() || entry.fds > batch.fds.size() - numFds)
+			break;
+
+		data = data.subspan(entry.data);
+		numFds += entry.fds;
+	}
+
+	if (batch.data.empty() || !data.empty() || numFds != batch.fds.size()) {
+		LOG(IPCUnixSocket, Error) << "Malformed batch received";
+		for (int32_t fd : batch.fds)
+			::close(fd);
+		return -EPROTO;
+	}
+
+	data = batch.data;
+	auto fd = batch.fds.begin();
+
+	while (!data.empty()) {
+		BatchEntry entry;
+		memcpy(&entry, data.data(), sizeof(entry));
+		data = data.subspan(sizeof(entry));
+
+		Payload &payload = pending_.emplace_back();
+		payload.data.assign(data.begin(), data.begin() + entry.data);
+		payload.fds.assign(fd, fd + entry.fds);
+
+		data = data.subspan(entry.data);
+		fd += entry.fds;
+	}
+
+	return 0;
+}
+
+int IPCUnixSocket::recvHeader()
+{
+	struct iovec iov[1];
+	iov[0].iov_base = &header_;
+	iov[0].iov_len = sizeof(header_);
+
+	/*
+	 * Headers of payloads stored in the shared memory ring carry the file
+	 * descriptors, reserve space for the maximum number.
+	 */
+	char buf[CMSG_SPACE(UINT8_MAX * sizeof(int32_t))];
+	memset(buf, 0, sizeof(buf));
+
+	struct msghdr msg = {};
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = buf;
+	msg.msg_controllen = sizeof(buf);
+
+	ssize_t ret = recvmsg(fd_.get(), &msg, MSG_CMSG_CLOEXEC);
+	if (ret < 0)
+		return -errno;
+
+	/* Connection-oriented sockets report the remote side closing with EOF. */
+	if (ret == 0)
+		return -ECONNRESET;
+
+	headerFds_.clear();
+
+	for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+	     cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+
+		unsigned int num = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int32_t);
+		const int32_t *fds = reinterpret_cast<const int32_t *>(CMSG_DATA(cmsg));
+		headerFds_.insert(headerFds_.end(), fds, fds + num);
+	}
+
+	if (static_cast<size_t>(ret) != sizeof(header_) ||
+	    (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))) {
+		for (int32_t fd : headerFds_)
+			::close(fd);
+		headerFds_.clear();
+		return -EPROTO;
+	}
+
+	/* Only ring messages carry file descriptors in the header. */
+	unsigned int expected = header_.flags & (HeaderFlagRing | HeaderFlagRingSetup)
+			      ? header_.fds : 0;
+	if (headerFds_.size() != expected) {
+		for (int32_t fd : headerFds_)
+			::close(fd);
+		headerFds_.clear();
+		return -EPROTO;
+	}
+
+	return 0;
+}
+
 void IPCUnixSocket::dataNotifier()
 {
 	int ret;
 
 	if (!headerReceived_) {
 		/* Receive the header. */
-		ret = ::recv(fd_.get(), &header_, sizeof(header_), 0);
+		ret = recvHeader();
+		if (ret == -ECONNRESET) {
+			notifier_->setEnabled(false);
+			disconnected.emit();
+			return;
+		}
+
 		if (ret < 0) {
-			ret = -errno;
 			LOG(IPCUnixSocket, Error)
 				<< "Failed to receive header: " << strerror(-ret);
 			return;
@@ -331,6 +1031,32 @@ void IPCUnixSocket::dataNotifier()
 		headerReceived_ = true;
 	}
 
+	/* Map the shared memory ring created by the peer. */
+	if (header_.flags & HeaderFlagRingSetup) {
+		headerReceived_ = false;
+
+		std::vector<int32_t> fds = std::move(headerFds_);
+		headerFds_.clear();
+
+		if (ring_ || fds.size() != 1) {
+			LOG(IPCUnixSocket, Error)
+				<< "Unexpected shared memory ring setup";
+			for (int32_t fd : fds)
+				::close(fd);
+			return;
+		}
+
+		ring_ = SharedRing::map(UniqueFD(fds[0]));
+		return;
+	}
+
+	/* Payloads stored in the shared memory ring are ready to be read. */
+	if (header_.flags & HeaderFlagRing) {
+		notifier_->setEnabled(false);
+		dispatch();
+		return;
+	}
+
 	/*
 	 * If the payload has arrived, disable the notifier and emit the
 	 * readyRead signal. The notifier will be reenabled by the receive()
@@ -345,7 +1071,24 @@ void IPCUnixSocket::dataNotifier()
 		return;
 
 	notifier_->setEnabled(false);
-	readyRead.emit();
+	dispatch();
+}
+
+/*
+ * Emit the readyRead signal until all available payloads, including those
+ * remaining from a batch, have been received. Stop if a payload isn't received
+ * by the signal handler to avoid looping forever.
+ */
+void IPCUnixSocket::dispatch()
+{
+	while (!pending_.empty() || (headerReceived_ && !notifier_->enabled())) {
+		unsigned int received = received_;
+
+		readyRead.emit();
+
+		if (received_ == received || !isBound())
+			break;
+	}
 }
 
 } /* namespace libcamera */
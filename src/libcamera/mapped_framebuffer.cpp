@@ -10,11 +10,14 @@
 #include <algorithm>
 #include <errno.h>
 #include <map>
+#include <string.h>
 #include <sys/mman.h>
 #include <unistd.h>
 
 #include <libcamera/base/log.h>
 
+#include "libcamera/internal/framebuffer.h"
+
 /**
  * \file libcamera/internal/mapped_framebuffer.h
  * \brief Frame buffer memory mapping support
@@ -168,6 +171,27 @@ MappedBuffer::~MappedBuffer()
  * \brief A bitwise combination of MappedFrameBuffer::MapFlag values
  */
 
+/**
+ * \struct FrameBufferMapping
+ * \brief CPU mapping of the memory of a FrameBuffer
+ *
+ * The FrameBufferMapping stores the memory mappings of all dmabufs backing the
+ * planes of a FrameBuffer. It is created by MappedFrameBuffer and cached in
+ * the FrameBuffer, and the memory is unmapped when the mapping is destroyed.
+ *
+ * \var FrameBufferMapping::prot
+ * \brief The mmap() protection flags of the mappings
+ *
+ * \var FrameBufferMapping::maps
+ * \brief The mapped memory regions, indexed by dmabuf file descriptor
+ */
+
+FrameBufferMapping::~FrameBufferMapping()
+{
+	for (auto &[fd, map] : maps)
+		munmap(map.data(), map.size());
+}
+
 /**
  * \brief Map all planes of a FrameBuffer
  * \param[in] buffer FrameBuffer to be mapped
@@ -176,6 +200,17 @@ MappedBuffer::~MappedBuffer()
  * Construct an object to map a frame buffer for CPU access. The mapping can be
  * made as Read only, Write only or support Read and Write operations by setting
  * the MapFlag flags accordingly.
+ *
+ * Mapping a buffer is a costly operation, as the kernel has to populate the
+ * page tables, and unmapping it requires a TLB flush. To avoid paying this cost
+ * for every frame, the memory mapping is cached in the FrameBuffer and reused
+ * by all MappedFrameBuffer instances for the same buffer, as long as the flags
+ * of the cached mapping cover the requested \a flags. The memory stays mapped
+ * until both the FrameBuffer and all MappedFrameBuffer instances using the
+ * mapping are destroyed.
+ *
+ * Mapping a buffer doesn't synchronize the CPU caches with the device. Users
+ * shall bracket CPU accesses to the mapped memory with a DmaSyncer.
  */
 MappedFrameBuffer::MappedFrameBuffer(const FrameBuffer *buffer, MapFlags flags)
 {
@@ -190,8 +225,37 @@ MappedFrameBuffer::MappedFrameBuffer(const FrameBuffer *buffer, MapFlags flags)
 	if (flags & MapFlag::Write)
 		mmapFlags |= PROT_WRITE;
 
+	const FrameBuffer::Private *data = buffer->_d();
+	std::shared_ptr<FrameBufferMapping> mapping = data->mapping();
+
+	if (!mapping || (mapping->prot & mmapFlags) != mmapFlags) {
+		/*
+		 * Widen the protection flags of the cached mapping, if any, to
+		 * avoid alternating between mappings when the buffer is
+		 * mapped with different flags.
+		 */
+		if (mapping)
+			mmapFlags |= mapping->prot;
+
+		mapping = map(buffer, mmapFlags);
+		if (!mapping)
+			return;
+
+		data->setMapping(mapping);
+	}
+
+	for (const FrameBuffer::Plane &plane : buffer->planes()) {
+		const Span<uint8_t> &map = mapping->maps.at(plane.fd.get());
+		planes_.emplace_back(map.data() + plane.offset, plane.length);
+	}
+
+	mapping_ = std::move(mapping);
+}
+
+std::shared_ptr<FrameBufferMapping>
+MappedFrameBuffer::map(const FrameBuffer *buffer, int prot)
+{
 	struct MappedBufferInfo {
-		uint8_t *address = nullptr;
 		size_t mapLength = 0;
 		size_t dmabufLength = 0;
 	};
@@ -201,7 +265,7 @@ MappedFrameBuffer::MappedFrameBuffer(const FrameBuffer *buffer, MapFlags flags)
 		const int fd = plane.fd.get();
 		if (mappedBuffers.find(fd) == mappedBuffers.end()) {
 			const size_t length = lseek(fd, 0, SEEK_END);
-			mappedBuffers[fd] = MappedBufferInfo{ nullptr, 0, length };
+			mappedBuffers[fd] = MappedBufferInfo{ 0, length };
 		}
 
 		const size_t length = mappedBuffers[fd].dmabufLength;
@@ -212,32 +276,31 @@ MappedFrameBuffer::MappedFrameBuffer(const FrameBuffer *buffer, MapFlags flags)
 					   << "buffer length=" << length
 					   << ", plane offset=" << plane.offset
 					   << ", plane length=" << plane.length;
-			return;
+			return nullptr;
 		}
 		size_t &mapLength = mappedBuffers[fd].mapLength;
 		mapLength = std::max(mapLength,
 				     static_cast<size_t>(plane.offset + plane.length));
 	}
 
-	for (const FrameBuffer::Plane &plane : buffer->planes()) {
-		const int fd = plane.fd.get();
-		auto &info = mappedBuffers[fd];
-		if (!info.address) {
-			void *address = mmap(nullptr, info.mapLength, mmapFlags,
-					     MAP_SHARED, fd, 0);
-			if (address == MAP_FAILED) {
-				error_ = -errno;
-				LOG(Buffer, Error) << "Failed to mmap plane: "
-						   << strerror(-error_);
-				return;
-			}
-
-			info.address = static_cast<uint8_t *>(address);
-			maps_.emplace_back(info.address, info.mapLength);
+	auto mapping = std::make_shared<FrameBufferMapping>();
+	mapping->prot = prot;
+
+	for (const auto &[fd, info] : mappedBuffers) {
+		void *address = mmap(nullptr, info.mapLength, prot,
+				     MAP_SHARED, fd, 0);
+		if (address == MAP_FAILED) {
+			error_ = -errno;
+			LOG(Buffer, Error) << "Failed to mmap plane: "
+					   << strerror(-error_);
+			return nullptr;
 		}
 
-		planes_.emplace_back(info.address + plane.offset, plane.length);
+		mapping->maps[fd] = { static_cast<uint8_t *>(address),
+				      info.mapLength };
 	}
+
+	return mapping;
 }
 
 } /* namespace libcamera */
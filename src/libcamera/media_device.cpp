@@ -7,6 +7,7 @@
 
 #include "libcamera/internal/media_device.h"
 
+#include <algorithm>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdint.h>
@@ -20,6 +21,9 @@
 
 #include <libcamera/base/log.h>
 
+#include "libcamera/internal/enumeration_cache.h"
+#include "libcamera/internal/media_request.h"
+
 /**
  * \file media_device.h
  * \brief Provide a representation of a Linux kernel Media Controller device
@@ -63,7 +67,8 @@ LOG_DEFINE_CATEGORY(MediaDevice)
  * populate() before the media graph can be queried.
  */
 MediaDevice::MediaDevice(const std::string &deviceNode)
-	: deviceNode_(deviceNode), valid_(false), acquired_(false)
+	: deviceNode_(deviceNode), valid_(false), linksSynced_(false),
+	  linkGeneration_(0), acquired_(false)
 {
 }
 
@@ -102,6 +107,8 @@ std::string MediaDevice::logPrefix() const
  */
 bool MediaDevice::acquire()
 {
+	MutexLocker locker(mutex_);
+
 	if (acquired_)
 		return false;
 
@@ -118,6 +125,8 @@ bool MediaDevice::acquire()
  */
 void MediaDevice::release()
 {
+	MutexLocker locker(mutex_);
+
 	close();
 	acquired_ = false;
 }
@@ -136,17 +145,32 @@ void MediaDevice::release()
  * directly, as the base PipelineHandler implementation handles this on the
  * behalf of the specified implementation.
  *
+ * Other users may have modified the media graph links while the device was
+ * unlocked. Once locked, the state of the links is read back from the kernel,
+ * and kept in sync until the device is unlocked. This allows MediaLink to skip
+ * link setup for links whose state doesn't change.
+ *
  * \return True if the device could be locked, false otherwise
  * \sa unlock()
  */
 bool MediaDevice::lock()
 {
+	MutexLocker locker(mutex_);
+
 	if (!fd_.isValid())
 		return false;
 
 	if (lockf(fd_.get(), F_TLOCK, 0))
 		return false;
 
+	linksSynced_ = updateLinks() == 0;
+
+	/*
+	 * The links may have been modified by another process while the
+	 * device was unlocked.
+	 */
+	linkGeneration_++;
+
 	return true;
 }
 
@@ -161,6 +185,10 @@ bool MediaDevice::lock()
  */
 void MediaDevice::unlock()
 {
+	MutexLocker locker(mutex_);
+
+	linksSynced_ = false;
+
 	if (!fd_.isValid())
 		return;
 
@@ -168,12 +196,17 @@ void MediaDevice::unlock()
 }
 
 /**
- * \fn MediaDevice::busy()
  * \brief Check if a device is in use
  * \return true if the device has been claimed for exclusive use, or false if it
  * is available
  * \sa acquire(), release()
  */
+bool MediaDevice::busy() const
+{
+	MutexLocker locker(mutex_);
+
+	return acquired_;
+}
 
 /**
  * \brief Populate the MediaDevice with device information and media objects
@@ -217,6 +250,8 @@ int MediaDevice::populate()
 
 	driver_ = info.driver;
 	model_ = info.model;
+	serial_ = info.serial;
+	busInfo_ = info.bus_info;
 	version_ = info.media_version;
 	hwRevision_ = info.hw_revision;
 
@@ -258,8 +293,10 @@ int MediaDevice::populate()
 	/* Populate entities, pads and links. */
 	if (populateEntities(topology) &&
 	    populatePads(topology) &&
-	    populateLinks(topology))
+	    populateLinks(topology)) {
 		valid_ = true;
+		cache_ = EnumerationCache::create(*this);
+	}
 
 	ret = 0;
 done:
@@ -302,6 +339,23 @@ done:
  * \return The MediaDevice model name
  */
 
+/**
+ * \fn MediaDevice::serial()
+ * \brief Retrieve the media device serial number
+ * \return The MediaDevice serial number, or an empty string if the driver
+ * doesn't report it
+ */
+
+/**
+ * \fn MediaDevice::busInfo()
+ * \brief Retrieve the location of the media device in the system
+ *
+ * The bus information identifies the device instance, for instance the USB
+ * port a device is connected to.
+ *
+ * \return The MediaDevice bus information
+ */
+
 /**
  * \fn MediaDevice::version()
  * \brief Retrieve the media device API version
@@ -426,13 +480,21 @@ MediaLink *MediaDevice::link(const MediaPad *source, const MediaPad *sink)
 
 /**
  * \brief Disable all links in the media device
+ * \param[in] keep Links to leave untouched
  *
  * Disable all the media device links, clearing the MEDIA_LNK_FL_ENABLED flag
- * on links which are not flagged as IMMUTABLE.
+ * on links which are not flagged as IMMUTABLE, with the exception of the links
+ * in \a keep.
+ *
+ * Pipeline handlers that reconfigure the media graph by disabling all links
+ * and enabling the ones they need should pass the latter in \a keep, and
+ * enable them after this function returns. When the device is locked, only
+ * the links whose state changes are then set up, avoiding a link setup ioctl
+ * for every link of the pipeline on each reconfiguration.
  *
  * \return 0 on success or a negative error code otherwise
  */
-int MediaDevice::disableLinks()
+int MediaDevice::disableLinks(Span<MediaLink *const> keep)
 {
 	for (MediaEntity *entity : entities_) {
 		for (MediaPad *pad : entity->pads()) {
@@ -443,6 +505,9 @@ int MediaDevice::disableLinks()
 				if (link->flags() & MEDIA_LNK_FL_IMMUTABLE)
 					continue;
 
+				if (std::find(keep.begin(), keep.end(), link) != keep.end())
+					continue;
+
 				int ret = link->setEnabled(false);
 				if (ret)
 					return ret;
@@ -453,6 +518,60 @@ int MediaDevice::disableLinks()
 	return 0;
 }
 
+/**
+ * \fn MediaDevice::linkGeneration()
+ * \brief Retrieve the link configuration generation counter
+ *
+ * The generation counter is incremented every time the links of the media
+ * graph are modified through MediaLink::setEnabled(), and when the device is
+ * locked as the links may have been modified by other processes while it was
+ * unlocked. Users that store information depending on the link configuration
+ * can compare the counter with the value it had when the information was
+ * stored to detect that it is stale.
+ *
+ * \return The link configuration generation counter
+ */
+
+/**
+ * \brief Allocate a media request
+ *
+ * Allocate a new MediaRequest to bundle controls and buffers for devices of
+ * the media graph, and queue them atomically. The media device must have been
+ * acquired.
+ *
+ * \return The newly allocated request, or nullptr if the device doesn't support
+ * requests or the request can't be allocated
+ */
+std::unique_ptr<MediaRequest> MediaDevice::createRequest()
+{
+	if (!fd_.isValid())
+		return nullptr;
+
+	int fd;
+	int ret = ioctl(fd_.get(), MEDIA_IOC_REQUEST_ALLOC, &fd);
+	if (ret < 0) {
+		ret = -errno;
+		if (ret != -ENOTTY)
+			LOG(MediaDevice, Error)
+				<< "Failed to allocate request: "
+				<< strerror(-ret);
+		return nullptr;
+	}
+
+	return std::make_unique<MediaRequest>(UniqueFD(fd));
+}
+
+/**
+ * \fn MediaDevice::cache()
+ * \brief Retrieve the persistent enumeration cache for the media device
+ *
+ * The cache is created when the media device is populated, if enabled through
+ * the LIBCAMERA_CACHE_DIR environment variable. Refer to the EnumerationCache
+ * documentation for more information.
+ *
+ * \return The enumeration cache, or nullptr if the cache is disabled
+ */
+
 /**
  * \var MediaDevice::disconnected
  * \brief Signal emitted when the media device is disconnected from the system
@@ -505,6 +624,61 @@ int MediaDevice::open()
 void MediaDevice::close()
 {
 	fd_.reset();
+	linksSynced_ = false;
+}
+
+/**
+ * \brief Read the state of the media graph links back from the kernel
+ *
+ * Update the flags of all data links with the values reported by the kernel.
+ * The media device shall be open.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int MediaDevice::updateLinks()
+{
+	struct media_v2_topology topology = {};
+	std::vector<struct media_v2_link> links;
+	__u64 version = -1;
+
+	/* Keep calling G_TOPOLOGY until the version number stays stable. */
+	while (true) {
+		topology.topology_version = 0;
+		topology.num_links = links.size();
+		topology.ptr_links = links.empty()
+				   ? 0 : reinterpret_cast<uintptr_t>(links.data());
+
+		int ret = ioctl(fd_.get(), MEDIA_IOC_G_TOPOLOGY, &topology);
+		if (ret < 0) {
+			ret = -errno;
+			LOG(MediaDevice, Warning)
+				<< "Failed to read links state: " << strerror(-ret);
+			return ret;
+		}
+
+		if (version == topology.topology_version)
+			break;
+
+		links.resize(topology.num_links);
+		version = topology.topology_version;
+	}
+
+	for (const struct media_v2_link &mediaLink : links) {
+		if ((mediaLink.flags & MEDIA_LNK_FL_LINK_TYPE) != MEDIA_LNK_FL_DATA_LINK)
+			continue;
+
+		MediaLink *link = dynamic_cast<MediaLink *>(object(mediaLink.id));
+		if (!link) {
+			LOG(MediaDevice, Warning)
+				<< "Media graph topology changed, link "
+				<< mediaLink.id << " not found";
+			return -ENODEV;
+		}
+
+		link->flags_ = mediaLink.flags;
+	}
+
+	return 0;
 }
 
 /**
@@ -566,6 +740,7 @@ void MediaDevice::clear()
 
 	objects_.clear();
 	entities_.clear();
+	cache_.reset();
 	valid_ = false;
 }
 
@@ -833,6 +1008,8 @@ int MediaDevice::setupLink(const MediaLink *link, unsigned int flags)
 		<< sink->entity()->name() << "["
 		<< sink->index() << "]: " << flags;
 
+	linkGeneration_++;
+
 	return 0;
 }
 
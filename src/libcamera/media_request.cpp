@@ -0,0 +1,165 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * media_request.cpp - Media request
+ */
+
+#include "libcamera/internal/media_request.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+#include <linux/media.h>
+
+#include <libcamera/base/event_notifier.h>
+#include <libcamera/base/log.h>
+
+/**
+ * \file media_request.h
+ * \brief Media Controller request
+ */
+
+namespace libcamera {
+
+LOG_DECLARE_CATEGORY(MediaDevice)
+
+/**
+ * \class MediaRequest
+ * \brief A Media Controller request bundling controls and buffers
+ *
+ * The Media Controller request API allows grouping V4L2 control values and
+ * buffers for multiple devices of a media graph in a single request, which is
+ * then queued to the kernel atomically with a single system call. The kernel
+ * applies all the controls of the request to the frame captured into the
+ * request's buffers, which removes the need to time control writes with the
+ * frame start events.
+ *
+ * Requests are allocated by MediaDevice::createRequest(), and populated by
+ * passing them to V4L2Device::setControls() and V4L2VideoDevice::queueBuffer().
+ * They are then queued with queue(). The completed signal is emitted when the
+ * kernel has completed the request, after which it can be recycled with
+ * reinit().
+ *
+ * Not all drivers support requests. When MediaDevice::createRequest() fails,
+ * pipeline handlers shall fall back to DelayedControls to apply controls at
+ * frame start.
+ */
+
+/**
+ * \enum MediaRequest::Status
+ * \brief The request status
+ * \var MediaRequest::Status::Idle
+ * \brief The request is being populated and hasn't been queued
+ * \var MediaRequest::Status::Queued
+ * \brief The request has been queued to the kernel
+ * \var MediaRequest::Status::Complete
+ * \brief The request has been completed by the kernel
+ */
+
+/**
+ * \brief Construct a MediaRequest from a request file descriptor
+ * \param[in] fd The request file descriptor, as returned by
+ * MEDIA_IOC_REQUEST_ALLOC
+ */
+MediaRequest::MediaRequest(UniqueFD fd)
+	: fd_(std::move(fd)), status_(Status::Idle)
+{
+	notifier_ = std::make_unique<EventNotifier>(fd_.get(),
+						    EventNotifier::Exception);
+	notifier_->setEnabled(false);
+	notifier_->activated.connect(this, &MediaRequest::requestComplete);
+}
+
+MediaRequest::~MediaRequest() = default;
+
+/**
+ * \fn MediaRequest::fd()
+ * \brief Retrieve the request file descriptor
+ *
+ * The file descriptor is used to associate controls and buffers with the
+ * request.
+ *
+ * \return The request file descriptor
+ */
+
+/**
+ * \fn MediaRequest::status()
+ * \brief Retrieve the request status
+ * \return The request status
+ */
+
+/**
+ * \brief Queue the request to the kernel
+ *
+ * Queue the request with all the controls and buffers that have been
+ * associated with it. The completed signal is emitted when the kernel
+ * completes the request.
+ *
+ * \return 0 on success or a negative error code otherwise
+ * \retval -EBUSY The request has already been queued
+ */
+int MediaRequest::queue()
+{
+	if (status_ != Status::Idle)
+		return -EBUSY;
+
+	if (::ioctl(fd_.get(), MEDIA_REQUEST_IOC_QUEUE) < 0) {
+		int ret = -errno;
+		LOG(MediaDevice, Error)
+			<< "Failed to queue request: " << strerror(-ret);
+		return ret;
+	}
+
+	status_ = Status::Queued;
+	notifier_->setEnabled(true);
+
+	return 0;
+}
+
+/**
+ * \brief Reinitialize the request for reuse
+ *
+ * Drop all the controls and buffers associated with the request, to populate
+ * it again. A queued request can't be reinitialized until it completes.
+ *
+ * \return 0 on success or a negative error code otherwise
+ * \retval -EBUSY The request is queued
+ */
+int MediaRequest::reinit()
+{
+	if (status_ == Status::Queued)
+		return -EBUSY;
+
+	if (::ioctl(fd_.get(), MEDIA_REQUEST_IOC_REINIT) < 0) {
+		int ret = -errno;
+		LOG(MediaDevice, Error)
+			<< "Failed to reinit request: " << strerror(-ret);
+		return ret;
+	}
+
+	status_ = Status::Idle;
+
+	return 0;
+}
+
+/**
+ * \var MediaRequest::completed
+ * \brief Signal emitted when the kernel completes the request
+ */
+
+void MediaRequest::requestComplete()
+{
+	/*
+	 * The request file descriptor keeps signalling POLLPRI until the
+	 * request is reinitialized, disable the notifier to avoid busy
+	 * looping.
+	 */
+	notifier_->setEnabled(false);
+	status_ = Status::Complete;
+
+	completed.emit(this);
+}
+
+} /* namespace libcamera */
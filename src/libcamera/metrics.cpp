@@ -0,0 +1,498 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * metrics.cpp - Lightweight performance metrics
+ */
+
+#include "libcamera/internal/metrics.h"
+
+#include <algorithm>
+#include <array>
+#include <list>
+#include <string>
+
+#include <libcamera/base/mutex.h>
+#include <libcamera/base/thread_annotations.h>
+
+/**
+ * \file metrics.h
+ * \brief Performance metrics snapshot
+ */
+
+/**
+ * \file internal/metrics.h
+ * \brief Lightweight performance metrics
+ *
+ * libcamera maintains a set of always-on performance metrics, independent of
+ * tracing and logging, that applications can retrieve with
+ * CameraManager::metrics() to export performance telemetry.
+ *
+ * Metrics are declared as static objects with a unique name, and updated from
+ * any thread. Counters and histograms are stored in per-thread shards, updated
+ * without atomic read-modify-write operations or locks, and aggregated when a
+ * snapshot is taken. The values accumulated by threads that exit are retained.
+ * Gauges represent a current value, and are stored in a single atomic
+ * variable.
+ */
+
+namespace libcamera {
+
+namespace {
+
+constexpr unsigned int kMaxSlots = 1024;
+constexpr unsigned int kInvalidSlot = ~0U;
+
+/* Default histogram bounds, for latencies in microseconds. */
+constexpr std::initializer_list<uint64_t> kLatencyBounds = {
+	100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000,
+	250000, 1000000,
+};
+
+struct Shard {
+	std::array<std::atomic<uint64_t>, kMaxSlots> slots{};
+};
+
+class MetricsRegistry
+{
+public:
+	static MetricsRegistry *instance();
+
+	MetricsRegistry()
+		: nextSlot_(0), retired_{}
+	{
+	}
+
+	unsigned int addCounter(const char *name);
+	unsigned int addHistogram(const char *name, const std::vector<uint64_t> &bounds);
+	void addGauge(const char *name, const MetricGauge *gauge);
+	void removeGauge(const MetricGauge *gauge);
+
+	Shard *createShard();
+	void releaseShard(Shard *shard);
+
+	MetricsSnapshot snapshot();
+
+private:
+	struct Counter {
+		std::string name;
+		unsigned int slot;
+	};
+
+	struct Gauge {
+		std::string name;
+		const MetricGauge *gauge;
+	};
+
+	struct Histogram {
+		std::string name;
+		std::vector<uint64_t> bounds;
+		unsigned int slot;
+	};
+
+	unsigned int allocate(unsigned int count)
+		LIBCAMERA_TSA_REQUIRES(mutex_);
+	uint64_t value(unsigned int slot) const
+		LIBCAMERA_TSA_REQUIRES(mutex_);
+
+	Mutex mutex_;
+
+	unsigned int nextSlot_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	std::vector<Counter> counters_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	std::vector<Gauge> gauges_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	std::vector<Histogram> histograms_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+
+	std::list<Shard *> shards_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	/* Values accumulated by the threads that have exited */
+	std::array<uint64_t, kMaxSlots> retired_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+};
+
+/*
+ * The registry is never destroyed, as metrics can be updated by threads that
+ * outlive static destructors.
+ */
+MetricsRegistry *MetricsRegistry::instance()
+{
+	static MetricsRegistry *registry = new MetricsRegistry();
+	return registry;
+}
+
+unsigned int MetricsRegistry::allocate(unsigned int count)
+{
+	if (nextSlot_ + count > kMaxSlots)
+		return kInvalidSlot;
+
+	unsigned int slot = nextSlot_;
+	nextSlot_ += count;
+
+	return slot;
+}
+
+unsigned int MetricsRegistry::addCounter(const char *name)
+{
+	MutexLocker locker(mutex_);
+
+	unsigned int slot = allocate(1);
+	if (slot != kInvalidSlot)
+		counters_.push_back({ name, slot });
+
+	return slot;
+}
+
+unsigned int MetricsRegistry::addHistogram(const char *name,
+					   const std::vector<uint64_t> &bounds)
+{
+	MutexLocker locker(mutex_);
+
+	/* One slot per bucket, including the overflow bucket, and the sum. */
+	unsigned int slot = allocate(bounds.size() + 2);
+	if (slot != kInvalidSlot)
+		histograms_.push_back({ name, bounds, slot });
+
+	return slot;
+}
+
+void MetricsRegistry::addGauge(const char *name, const MetricGauge *gauge)
+{
+	MutexLocker locker(mutex_);
+	gauges_.push_back({ name, gauge });
+}
+
+void MetricsRegistry::removeGauge(const MetricGauge *gauge)
+{
+	MutexLocker locker(mutex_);
+
+	gauges_.erase(std::remove_if(gauges_.begin(), gauges_.end(),
+				     [&](const Gauge &g) { return g.gauge == gauge; }),
+		      gauges_.end());
+}
+
+Shard *MetricsRegistry::createShard()
+{
+	Shard *shard = new Shard();
+
+	MutexLocker locker(mutex_);
+	shards_.push_back(shard);
+
+	return shard;
+}
+
+void MetricsRegistry::releaseShard(Shard *shard)
+{
+	{
+		MutexLocker locker(mutex_);
+
+		for (unsigned int i = 0; i < nextSlot_; ++i)
+			retired_[i] += shard->slots[i].load(std::memory_order_relaxed);
+
+		shards_.remove(shard);
+	}
+
+	delete shard;
+}
+
+uint64_t MetricsRegistry::value(unsigned int slot) const
+{
+	uint64_t value = retired_[slot];
+
+	for (const Shard *shard : shards_)
+		value += shard->slots[slot].load(std::memory_order_relaxed);
+
+	return value;
+}
+
+MetricsSnapshot MetricsRegistry::snapshot()
+{
+	MetricsSnapshot snapshot;
+
+	MutexLocker locker(mutex_);
+
+	/* Metrics registered multiple times with the same name are merged. */
+	for (const Counter &counter : counters_)
+		snapshot.counters[counter.name] += value(counter.slot);
+
+	for (const Gauge &gauge : gauges_)
+		snapshot.gauges[gauge.name] += gauge.gauge->value();
+
+	for (const Histogram &histogram : histograms_) {
+		auto [it, inserted] = snapshot.histograms.try_emplace(histogram.name);
+		MetricsSnapshot::Histogram &out = it->second;
+
+		if (inserted) {
+			out.bounds = histogram.bounds;
+			out.buckets.resize(histogram.bounds.size() + 1);
+			out.count = 0;
+			out.sum = 0;
+		} else if (out.bounds != histogram.bounds) {
+			continue;
+		}
+
+		for (unsigned int i = 0; i < out.buckets.size(); ++i) {
+			uint64_t count = value(histogram.slot + i);
+			out.buckets[i] += count;
+			out.count += count;
+		}
+
+		out.sum += value(histogram.slot + out.buckets.size());
+	}
+
+	return snapshot;
+}
+
+/*
+ * The thread-local variables are trivially destructible, so they can be
+ * accessed safely from other thread-local destructors. The shard is released
+ * by the destructor of the releaser, which is instantiated with the shard.
+ * Updates from a thread after its shard has been released are dropped.
+ */
+thread_local Shard *currentShard = nullptr;
+thread_local bool currentShardReleased = false;
+
+struct ShardReleaser {
+	~ShardReleaser()
+	{
+		Shard *shard = currentShard;
+
+		currentShard = nullptr;
+		currentShardReleased = true;
+
+		if (shard)
+			MetricsRegistry::instance()->releaseShard(shard);
+	}
+};
+
+thread_local ShardReleaser currentShardReleaser;
+
+void increment(unsigned int slot, uint64_t value)
+{
+	if (slot == kInvalidSlot)
+		return;
+
+	if (!currentShard) {
+		if (currentShardReleased)
+			return;
+
+		/* Odr-use the releaser to ensure it gets constructed. */
+		[[maybe_unused]] ShardReleaser *releaser = &currentShardReleaser;
+		currentShard = MetricsRegistry::instance()->createShard();
+	}
+
+	/*
+	 * Only the owner thread writes to its shard, a read-modify-write
+	 * sequence is enough. The atomic accesses guarantee that snapshots
+	 * read consistent values.
+	 */
+	std::atomic<uint64_t> &cell = currentShard->slots[slot];
+	cell.store(cell.load(std::memory_order_relaxed) + value,
+		   std::memory_order_relaxed);
+}
+
+} /* namespace */
+
+/**
+ * \struct MetricsSnapshot
+ * \brief Values of all the performance metrics at a point in time
+ *
+ * Metrics are identified by their name. Counters only increase over the
+ * lifetime of the process, gauges report a current value, and histograms count
+ * samples in fixed buckets.
+ *
+ * \var MetricsSnapshot::counters
+ * \brief The value of all counters
+ *
+ * \var MetricsSnapshot::gauges
+ * \brief The value of all gauges
+ *
+ * \var MetricsSnapshot::histograms
+ * \brief The value of all histograms
+ */
+
+/**
+ * \struct MetricsSnapshot::Histogram
+ * \brief Value of a histogram metric
+ *
+ * \var MetricsSnapshot::Histogram::bounds
+ * \brief The inclusive upper bounds of the buckets, in increasing order
+ *
+ * \var MetricsSnapshot::Histogram::buckets
+ * \brief The number of samples in each bucket
+ *
+ * The buckets vector has one more entry than the bounds vector, for the
+ * samples larger than the last bound.
+ *
+ * \var MetricsSnapshot::Histogram::count
+ * \brief The total number of samples
+ *
+ * \var MetricsSnapshot::Histogram::sum
+ * \brief The sum of all samples
+ */
+
+/**
+ * \class MetricCounter
+ * \brief A monotonically increasing counter metric
+ *
+ * Counters are typically used to count events, such as completed requests.
+ */
+
+/**
+ * \brief Construct a counter
+ * \param[in] name The counter name
+ */
+MetricCounter::MetricCounter(const char *name)
+	: slot_(MetricsRegistry::instance()->addCounter(name))
+{
+}
+
+/**
+ * \brief Increase the counter
+ * \param[in] value The amount to add to the counter
+ *
+ * \context This function is \threadsafe.
+ */
+void MetricCounter::add(uint64_t value)
+{
+	increment(slot_, value);
+}
+
+/**
+ * \class MetricGauge
+ * \brief A metric that reports a current value
+ *
+ * Gauges are typically used to report levels, such as the number of requests
+ * in flight. They are stored in a single atomic variable instead of per-thread
+ * shards, as their value can be set.
+ */
+
+/**
+ * \brief Construct a gauge
+ * \param[in] name The gauge name
+ */
+MetricGauge::MetricGauge(const char *name)
+	: value_(0)
+{
+	MetricsRegistry::instance()->addGauge(name, this);
+}
+
+MetricGauge::~MetricGauge()
+{
+	MetricsRegistry::instance()->removeGauge(this);
+}
+
+/**
+ * \fn MetricGauge::set()
+ * \brief Set the gauge value
+ * \param[in] value The new value
+ *
+ * \context This function is \threadsafe.
+ */
+
+/**
+ * \fn MetricGauge::add()
+ * \brief Add \a delta to the gauge value
+ * \param[in] delta The value to add, may be negative
+ *
+ * \context This function is \threadsafe.
+ */
+
+/**
+ * \fn MetricGauge::value()
+ * \brief Retrieve the gauge value
+ * \return The gauge value
+ */
+
+/**
+ * \class MetricHistogram
+ * \brief A metric that counts samples in fixed buckets
+ *
+ * Histograms are typically used to record latency distributions. Each bucket
+ * counts the samples smaller than or equal to its bound and larger than the
+ * bound of the previous bucket. An additional bucket counts the samples larger
+ * than the last bound.
+ */
+
+/**
+ * \brief Construct a histogram with the default bounds
+ * \param[in] name The histogram name
+ *
+ * The default bounds are suitable for latencies expressed in microseconds,
+ * from 100µs to 1s.
+ */
+MetricHistogram::MetricHistogram(const char *name)
+	: MetricHistogram(name, kLatencyBounds)
+{
+}
+
+/**
+ * \brief Construct a histogram
+ * \param[in] name The histogram name
+ * \param[in] bounds The upper bounds of the buckets, in increasing order
+ */
+MetricHistogram::MetricHistogram(const char *name,
+				 std::initializer_list<uint64_t> bounds)
+	: bounds_(bounds)
+{
+	slot_ = MetricsRegistry::instance()->addHistogram(name, bounds_);
+}
+
+/**
+ * \brief Record a sample
+ * \param[in] value The sample value
+ *
+ * \context This function is \threadsafe.
+ */
+void MetricHistogram::record(uint64_t value)
+{
+	if (slot_ == kInvalidSlot)
+		return;
+
+	unsigned int bucket = std::lower_bound(bounds_.begin(), bounds_.end(), value)
+			    - bounds_.begin();
+
+	increment(slot_ + bucket, 1);
+	increment(slot_ + bounds_.size() + 1, value);
+}
+
+/**
+ * \fn MetricHistogram::bounds()
+ * \brief Retrieve the upper bounds of the histogram buckets
+ * \return The histogram buckets upper bounds
+ */
+
+/**
+ * \class MetricTimer
+ * \brief Record the lifetime of a scope in a histogram
+ *
+ * The timer records the time elapsed between its construction and destruction
+ * in microseconds in the histogram.
+ */
+
+/**
+ * \fn MetricTimer::MetricTimer()
+ * \brief Start a timer
+ * \param[in] histogram The histogram to record the duration in
+ */
+
+MetricTimer::~MetricTimer()
+{
+	auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+		utils::clock::now() - start_);
+	histogram_.record(duration.count());
+}
+
+namespace metrics {
+
+/**
+ * \brief Retrieve a snapshot of all the performance metrics
+ *
+ * \context This function is \threadsafe.
+ *
+ * \return The value of all metrics
+ */
+MetricsSnapshot snapshot()
+{
+	return MetricsRegistry::instance()->snapshot();
+}
+
+} /* namespace metrics */
+
+} /* namespace libcamera */
@@ -40,25 +40,20 @@ class PipelineHandlerISI;
 class ISICameraData : public Camera::Private
 {
 public:
-	ISICameraData(PipelineHandler *ph)
+	ISICameraData(PipelineHandler *ph, unsigned int numStreams)
 		: Camera::Private(ph)
 	{
 		/*
-		 * \todo Assume 2 channels only for now, as that's the number of
-		 * available channels on i.MX8MP.
+		 * Create one stream per ISI channel, channels are allocated
+		 * dynamically to the streams of all cameras at configure time.
 		 */
-		streams_.resize(2);
+		streams_.resize(numStreams);
 	}
 
 	PipelineHandlerISI *pipe();
 
 	int init();
 
-	unsigned int pipeIndex(const Stream *stream)
-	{
-		return stream - &*streams_.begin();
-	}
-
 	unsigned int getRawMediaBusFormat(PixelFormat *pixelFormat) const;
 	unsigned int getYuvMediaBusFormat(const PixelFormat &pixelFormat) const;
 	unsigned int getMediaBusFormat(PixelFormat *pixelFormat) const;
@@ -69,6 +64,7 @@ public:
 	std::vector<Stream> streams_;
 
 	std::vector<Stream *> enabledStreams_;
+	std::map<const Stream *, unsigned int> streamPipes_;
 
 	unsigned int xbarSink_;
 };
@@ -86,14 +82,26 @@ public:
 	static const std::map<PixelFormat, unsigned int> formatsMap_;
 
 	V4L2SubdeviceFormat sensorFormat_;
+	std::vector<unsigned int> pipes_;
+	bool chained_ = false;
 
 private:
+	/*
+	 * Maximum ISI input width of a single channel. Wider inputs require
+	 * chaining the channel with the next one to use its line buffer.
+	 */
+	static constexpr unsigned int kMaxUnchainedWidth = 2048;
+
+	static std::vector<unsigned int>
+	allocatePipes(std::vector<bool> available, unsigned int count,
+		      bool chained);
+
 	CameraConfiguration::Status
 	validateRaw(std::set<Stream *> &availableStreams, const Size &maxResolution);
 	CameraConfiguration::Status
 	validateYuv(std::set<Stream *> &availableStreams, const Size &maxResolution);
 
-	const ISICameraData *data_;
+	ISICameraData *data_;
 };
 
 class PipelineHandlerISI : public PipelineHandler
@@ -112,8 +120,11 @@ public:
 
 	int start(Camera *camera, const ControlList *controls) override;
 
+	std::vector<bool> availablePipes(const ISICameraData *data) const;
+
 protected:
 	void stopDevice(Camera *camera) override;
+	void releaseDevice(Camera *camera) override;
 
 	int queueRequestDevice(Camera *camera, Request *request) override;
 
@@ -124,6 +135,14 @@ private:
 	struct Pipe {
 		std::unique_ptr<V4L2Subdevice> isi;
 		std::unique_ptr<V4L2VideoDevice> capture;
+
+		/*
+		 * The camera that the pipe is allocated to, and whether it
+		 * carries a stream or lends its line buffer to the previous
+		 * pipe through chaining.
+		 */
+		const ISICameraData *owner = nullptr;
+		bool active = false;
 	};
 
 	ISICameraData *cameraData(Camera *camera)
@@ -132,6 +151,7 @@ private:
 	}
 
 	Pipe *pipeFromStream(Camera *camera, const Stream *stream);
+	void releasePipes(const ISICameraData *data);
 
 	StreamConfiguration generateYUVConfiguration(Camera *camera,
 						     const Size &size);
@@ -500,26 +520,33 @@ CameraConfiguration::Status ISICameraConfiguration::validate()
 	if (config_.empty())
 		return Invalid;
 
-	/* Cap the number of streams to the number of available ISI pipes. */
-	if (config_.size() > availableStreams.size()) {
-		config_.resize(availableStreams.size());
+	/*
+	 * Cap the number of streams to the number of ISI pipes not used by
+	 * other cameras.
+	 */
+	const std::vector<bool> available = data_->pipe()->availablePipes(data_);
+	unsigned int numPipes = std::count(available.begin(), available.end(), true);
+	if (!numPipes) {
+		LOG(ISI, Error) << "All ISI pipes are in use by other cameras";
+		return Invalid;
+	}
+
+	if (config_.size() > numPipes) {
+		config_.resize(numPipes);
 		status = Adjusted;
 	}
 
 	/*
-	 * If more than a single stream is requested, the maximum allowed input
-	 * image width is 2048. Cap the maximum image size accordingly.
-	 *
-	 * \todo The (size > 1) check only applies to i.MX8MP which has 2 ISI
-	 * channels. SoCs with more channels than the i.MX8MP are capable of
-	 * supporting more streams with input width > 2048 by chaining
-	 * successive channels together. Define a policy for channels allocation
-	 * to fully support other SoCs.
+	 * Input images wider than the line buffer of a single ISI channel
+	 * require chaining each stream's channel with the next one. Cap the
+	 * maximum image size if not enough pairs of adjacent pipes are
+	 * available.
 	 */
 	CameraSensor *sensor = data_->sensor_.get();
 	Size maxResolution = sensor->resolution();
-	if (config_.size() > 1)
-		maxResolution.width = std::min(2048U, maxResolution.width);
+	if (maxResolution.width > kMaxUnchainedWidth &&
+	    allocatePipes(available, config_.size(), true).empty())
+		maxResolution.width = kMaxUnchainedWidth;
 
 	/* Validate streams according to the format of the first one. */
 	const PixelFormatInfo info = PixelFormatInfo::info(config_[0].pixelFormat);
@@ -600,9 +627,67 @@ CameraConfiguration::Status ISICameraConfiguration::validate()
 
 	LOG(ISI, Debug) << "Selected sensor format: " << sensorFormat_;
 
+	chained_ = bestSize.width > kMaxUnchainedWidth;
+	pipes_ = allocatePipes(available, config_.size(), chained_);
+	if (pipes_.empty()) {
+		LOG(ISI, Error) << "Unable to allocate ISI pipes";
+		return Invalid;
+	}
+
 	return status;
 }
 
+/*
+ * Select the ISI pipes for \a count streams among the \a available ones.
+ * Chained streams use a pair of adjacent pipes, and are allocated from the
+ * lowest pipes. Other streams use the pipes that can't be part of a pair
+ * first, and then the highest pipes, to preserve pairs of adjacent pipes for
+ * chaining as much as possible. Return an empty vector if the streams can't
+ * be allocated.
+ */
+std::vector<unsigned int>
+ISICameraConfiguration::allocatePipes(std::vector<bool> available,
+				      unsigned int count, bool chained)
+{
+	std::vector<unsigned int> pipes;
+	const unsigned int numPipes = available.size();
+
+	if (chained) {
+		for (unsigned int i = 0; i + 1 < numPipes && pipes.size() < count; ++i) {
+			if (!available[i] || !available[i + 1])
+				continue;
+
+			pipes.push_back(i);
+			available[i] = false;
+			available[i + 1] = false;
+		}
+	} else {
+		auto isolated = [&](unsigned int i) {
+			return (i == 0 || !available[i - 1]) &&
+			       (i + 1 == numPipes || !available[i + 1]);
+		};
+
+		for (unsigned int i = 0; i < numPipes && pipes.size() < count; ++i) {
+			if (available[i] && isolated(i)) {
+				pipes.push_back(i);
+				available[i] = false;
+			}
+		}
+
+		for (unsigned int i = numPipes; i-- > 0 && pipes.size() < count;) {
+			if (available[i]) {
+				pipes.push_back(i);
+				available[i] = false;
+			}
+		}
+	}
+
+	if (pipes.size() < count)
+		return {};
+
+	return pipes;
+}
+
 /* -----------------------------------------------------------------------------
  * Pipeline Handler
  */
@@ -817,18 +902,47 @@ int PipelineHandlerISI::configure(Camera *camera, CameraConfiguration *c)
 	sensorSrc->links()[0]->setEnabled(true);
 
 	/*
-	 * Reset the crossbar switch routing and enable one route for each
-	 * requested stream configuration.
+	 * Allocate the pipes selected at validation time to the camera,
+	 * replacing the ones it used previously. The pipes may have been
+	 * allocated to another camera since the configuration was validated.
+	 */
+	releasePipes(data);
+
+	for (unsigned int index : camConfig->pipes_) {
+		unsigned int last = index + (camConfig->chained_ ? 1 : 0);
+		for (unsigned int i = index; i <= last; ++i) {
+			if (i >= pipes_.size() || pipes_[i].owner) {
+				LOG(ISI, Error) << "ISI pipe " << i << " is not available";
+				releasePipes(data);
+				return -EBUSY;
+			}
+
+			pipes_[i].owner = data;
+			pipes_[i].active = i == index;
+		}
+	}
+
+	data->streamPipes_.clear();
+	for (const auto &[idx, config] : utils::enumerate(*c))
+		data->streamPipes_[config.stream()] = camConfig->pipes_[idx];
+
+	/*
+	 * Program the crossbar switch routing with one route for each stream
+	 * of all cameras, to preserve the routes of the other cameras.
 	 *
-	 * \todo Handle concurrent usage of multiple cameras by adjusting the
-	 * routing table instead of resetting it.
+	 * \todo The routing table can't be changed while a camera is
+	 * streaming, all cameras must thus be configured before starting any
+	 * of them.
 	 */
 	V4L2Subdevice::Routing routing = {};
 	unsigned int xbarFirstSource = crossbar_->entity()->pads().size() / 2 + 1;
 
-	for (const auto &[idx, config] : utils::enumerate(*c)) {
+	for (const auto &[idx, pipe] : utils::enumerate(pipes_)) {
+		if (!pipe.owner || !pipe.active)
+			continue;
+
 		struct v4l2_subdev_route route = {
-			.sink_pad = data->xbarSink_,
+			.sink_pad = pipe.owner->xbarSink_,
 			.sink_stream = 0,
 			.source_pad = static_cast<uint32_t>(xbarFirstSource + idx),
 			.source_stream = 0,
@@ -956,6 +1070,11 @@ void PipelineHandlerISI::stopDevice(Camera *camera)
 	}
 }
 
+void PipelineHandlerISI::releaseDevice(Camera *camera)
+{
+	releasePipes(cameraData(camera));
+}
+
 int PipelineHandlerISI::queueRequestDevice(Camera *camera, Request *request)
 {
 	for (auto &[stream, buffer] : request->buffers()) {
@@ -1061,7 +1180,7 @@ bool PipelineHandlerISI::match(DeviceEnumerator *enumerator)
 
 		/* Create the camera data. */
 		std::unique_ptr<ISICameraData> data =
-			std::make_unique<ISICameraData>(this);
+			std::make_unique<ISICameraData>(this, pipes_.size());
 
 		data->sensor_ = std::make_unique<CameraSensor>(sensor);
 		data->csis_ = std::make_unique<V4L2Subdevice>(csi);
@@ -1094,11 +1213,37 @@ PipelineHandlerISI::Pipe *PipelineHandlerISI::pipeFromStream(Camera *camera,
 							     const Stream *stream)
 {
 	ISICameraData *data = cameraData(camera);
-	unsigned int pipeIndex = data->pipeIndex(stream);
+	auto iter = data->streamPipes_.find(stream);
+
+	ASSERT(iter != data->streamPipes_.end());
+	ASSERT(iter->second < pipes_.size());
+
+	return &pipes_[iter->second];
+}
 
-	ASSERT(pipeIndex < pipes_.size());
+/*
+ * Return the pipes that can be allocated to the camera \a data, either
+ * because they are free or because they are already allocated to it.
+ */
+std::vector<bool> PipelineHandlerISI::availablePipes(const ISICameraData *data) const
+{
+	std::vector<bool> available;
 
-	return &pipes_[pipeIndex];
+	for (const Pipe &pipe : pipes_)
+		available.push_back(!pipe.owner || pipe.owner == data);
+
+	return available;
+}
+
+void PipelineHandlerISI::releasePipes(const ISICameraData *data)
+{
+	for (Pipe &pipe : pipes_) {
+		if (pipe.owner != data)
+			continue;
+
+		pipe.owner = nullptr;
+		pipe.active = false;
+	}
 }
 
 void PipelineHandlerISI::bufferReady(FrameBuffer *buffer)
@@ -59,6 +59,7 @@ public:
 	FrameBuffer *queueBuffer(Request *request, FrameBuffer *rawBuffer);
 	void tryReturnBuffer(FrameBuffer *buffer);
 	Signal<FrameBuffer *> &bufferReady() { return output_->bufferReady; }
+	unsigned int lastFrameDrops() const { return output_->lastFrameDrops(); }
 	Signal<uint32_t> &frameStart() { return csi2_->frameStart; }
 
 	Signal<> bufferAvailable;
@@ -19,74 +19,122 @@ namespace libcamera {
 LOG_DECLARE_CATEGORY(IPU3)
 
 IPU3Frames::IPU3Frames()
+	: nextPipe_(0)
 {
 }
 
-void IPU3Frames::init(const std::vector<std::unique_ptr<FrameBuffer>> &paramBuffers,
-		      const std::vector<std::unique_ptr<FrameBuffer>> &statBuffers)
+/*
+ * Size the frame information pool for \a capacity frames in flight. Frames are
+ * stored at the index of their sequence number modulo the capacity: as
+ * requests complete in order, the frames in flight always have consecutive
+ * sequence numbers, and the capacity shall thus be at least the maximum number
+ * of queued requests.
+ */
+void IPU3Frames::init(unsigned int capacity)
 {
+	clear();
+
+	frameInfo_.resize(capacity);
+	for (Info &info : frameInfo_)
+		info.request = nullptr;
+}
+
+/*
+ * Add the parameters and statistics buffers of an ImgU pipe. Frames are
+ * distributed to the pipes in a round-robin fashion, in the order they have
+ * been added, and the Info::pipe field identifies the pipe of a frame.
+ */
+void IPU3Frames::addPipe(const std::vector<std::unique_ptr<FrameBuffer>> &paramBuffers,
+			 const std::vector<std::unique_ptr<FrameBuffer>> &statBuffers)
+{
+	Pipe &pipe = pipes_.emplace_back();
+
 	for (const std::unique_ptr<FrameBuffer> &buffer : paramBuffers)
-		availableParamBuffers_.push(buffer.get());
+		pipe.availableParamBuffers.push_back(buffer.get());
 
 	for (const std::unique_ptr<FrameBuffer> &buffer : statBuffers)
-		availableStatBuffers_.push(buffer.get());
-
-	frameInfo_.clear();
+		pipe.availableStatBuffers.push_back(buffer.get());
 }
 
 void IPU3Frames::clear()
 {
-	availableParamBuffers_ = {};
-	availableStatBuffers_ = {};
+	pipes_.clear();
+	nextPipe_ = 0;
+
+	frameInfo_.clear();
 }
 
 IPU3Frames::Info *IPU3Frames::create(Request *request)
 {
 	unsigned int id = request->sequence();
 
-	if (availableParamBuffers_.empty()) {
-		LOG(IPU3, Debug) << "Parameters buffer underrun";
+	if (frameInfo_.empty())
 		return nullptr;
+
+	Info &info = frameInfo_[id % frameInfo_.size()];
+	if (info.request) {
+		LOG(IPU3, Error)
+			<< "Frame " << info.id << " still in flight, can't track frame "
+			<< id;
+		return nullptr;
+	}
+
+	/*
+	 * Use the next pipe in round-robin order, or the first following one
+	 * that has buffers available.
+	 */
+	unsigned int index;
+	Pipe *pipe = nullptr;
+
+	for (unsigned int i = 0; i < pipes_.size(); ++i) {
+		index = (nextPipe_ + i) % pipes_.size();
+
+		if (pipes_[index].availableParamBuffers.empty() ||
+		    pipes_[index].availableStatBuffers.empty())
+			continue;
+
+		pipe = &pipes_[index];
+		break;
 	}
 
-	if (availableStatBuffers_.empty()) {
-		LOG(IPU3, Debug) << "Statistics buffer underrun";
+	if (!pipe) {
+		LOG(IPU3, Debug) << "Parameters or statistics buffer underrun";
 		return nullptr;
 	}
 
-	FrameBuffer *paramBuffer = availableParamBuffers_.front();
-	FrameBuffer *statBuffer = availableStatBuffers_.front();
+	nextPipe_ = (index + 1) % pipes_.size();
+
+	FrameBuffer *paramBuffer = pipe->availableParamBuffers.back();
+	FrameBuffer *statBuffer = pipe->availableStatBuffers.back();
 
 	paramBuffer->_d()->setRequest(request);
 	statBuffer->_d()->setRequest(request);
 
-	availableParamBuffers_.pop();
-	availableStatBuffers_.pop();
-
-	/* \todo Remove the dynamic allocation of Info */
-	std::unique_ptr<Info> info = std::make_unique<Info>();
-
-	info->id = id;
-	info->request = request;
-	info->rawBuffer = nullptr;
-	info->paramBuffer = paramBuffer;
-	info->statBuffer = statBuffer;
-	info->paramDequeued = false;
-	info->metadataProcessed = false;
+	pipe->availableParamBuffers.pop_back();
+	pipe->availableStatBuffers.pop_back();
 
-	frameInfo_[id] = std::move(info);
+	info.id = id;
+	info.request = request;
+	info.pipe = index;
+	info.rawBuffer = nullptr;
+	info.paramBuffer = paramBuffer;
+	info.statBuffer = statBuffer;
+	info.effectiveSensorControls.clear();
+	info.paramDequeued = false;
+	info.metadataProcessed = false;
 
-	return frameInfo_[id].get();
+	return &info;
 }
 
 void IPU3Frames::remove(IPU3Frames::Info *info)
 {
 	/* Return params and stat buffer for reuse. */
-	availableParamBuffers_.push(info->paramBuffer);
-	availableStatBuffers_.push(info->statBuffer);
+	Pipe &pipe = pipes_[info->pipe];
+	pipe.availableParamBuffers.push_back(info->paramBuffer);
+	pipe.availableStatBuffers.push_back(info->statBuffer);
 
-	/* Delete the extended frame information. */
-	frameInfo_.erase(info->id);
+	/* Release the frame information slot. */
+	info->request = nullptr;
 }
 
 bool IPU3Frames::tryComplete(IPU3Frames::Info *info)
@@ -111,10 +159,11 @@ bool IPU3Frames::tryComplete(IPU3Frames::Info *info)
 
 IPU3Frames::Info *IPU3Frames::find(unsigned int id)
 {
-	const auto &itInfo = frameInfo_.find(id);
-
-	if (itInfo != frameInfo_.end())
-		return itInfo->second.get();
+	if (!frameInfo_.empty()) {
+		Info &info = frameInfo_[id % frameInfo_.size()];
+		if (info.request && info.id == id)
+			return &info;
+	}
 
 	LOG(IPU3, Fatal) << "Can't find tracking information for frame " << id;
 
@@ -123,8 +172,11 @@ IPU3Frames::Info *IPU3Frames::find(unsigned int id)
 
 IPU3Frames::Info *IPU3Frames::find(FrameBuffer *buffer)
 {
-	for (auto const &itInfo : frameInfo_) {
-		Info *info = itInfo.second.get();
+	for (Info &slot : frameInfo_) {
+		if (!slot.request)
+			continue;
+
+		Info *info = &slot;
 
 		for (auto const itBuffers : info->request->buffers())
 			if (itBuffers.second == buffer)
@@ -7,9 +7,7 @@
 
 #pragma once
 
-#include <map>
 #include <memory>
-#include <queue>
 #include <vector>
 
 #include <libcamera/base/signal.h>
@@ -31,6 +29,7 @@ public:
 	struct Info {
 		unsigned int id;
 		Request *request;
+		unsigned int pipe;
 
 		FrameBuffer *rawBuffer;
 		FrameBuffer *paramBuffer;
@@ -44,8 +43,9 @@ public:
 
 	IPU3Frames();
 
-	void init(const std::vector<std::unique_ptr<FrameBuffer>> &paramBuffers,
-		  const std::vector<std::unique_ptr<FrameBuffer>> &statBuffers);
+	void init(unsigned int capacity);
+	void addPipe(const std::vector<std::unique_ptr<FrameBuffer>> &paramBuffers,
+		     const std::vector<std::unique_ptr<FrameBuffer>> &statBuffers);
 	void clear();
 
 	Info *create(Request *request);
@@ -58,10 +58,15 @@ public:
 	Signal<> bufferAvailable;
 
 private:
-	std::queue<FrameBuffer *> availableParamBuffers_;
-	std::queue<FrameBuffer *> availableStatBuffers_;
+	struct Pipe {
+		std::vector<FrameBuffer *> availableParamBuffers;
+		std::vector<FrameBuffer *> availableStatBuffers;
+	};
+
+	std::vector<Pipe> pipes_;
+	unsigned int nextPipe_;
 
-	std::map<unsigned int, std::unique_ptr<Info>> frameInfo_;
+	std::vector<Info> frameInfo_;
 };
 
 } /* namespace libcamera */
@@ -8,12 +8,16 @@
 #include "imgu.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <limits>
+#include <map>
+#include <tuple>
 
 #include <linux/media-bus-format.h>
 
 #include <libcamera/base/log.h>
+#include <libcamera/base/mutex.h>
 #include <libcamera/base/utils.h>
 
 #include <libcamera/formats.h>
@@ -53,8 +57,6 @@ const std::vector<float> gdcScalingFactors = {
 	14.25, 14.5, 14.75, 15, 15.25, 15.5, 15.75, 16,
 };
 
-std::vector<ImgUDevice::PipeConfig> pipeConfigs;
-
 struct FOV {
 	float w;
 	float h;
@@ -69,6 +71,51 @@ struct FOV {
 	}
 };
 
+FOV calcFOV(const Size &in, const ImgUDevice::PipeConfig &pipe)
+{
+	FOV fov{};
+
+	float inW = static_cast<float>(in.width);
+	float inH = static_cast<float>(in.height);
+	float ifCropW = static_cast<float>(in.width - pipe.iif.width);
+	float ifCropH = static_cast<float>(in.height - pipe.iif.height);
+	float gdcCropW = static_cast<float>(pipe.bds.width - pipe.gdc.width) * pipe.bds_sf;
+	float gdcCropH = static_cast<float>(pipe.bds.height - pipe.gdc.height) * pipe.bds_sf;
+
+	fov.w = (inW - (ifCropW + gdcCropW)) / inW;
+	fov.h = (inH - (ifCropH + gdcCropH)) / inH;
+
+	return fov;
+}
+
+/*
+ * Keep track of the candidate configuration with the largest field of view.
+ * When multiple candidates have the same field of view, the first one found
+ * wins.
+ */
+struct PipeConfigSearch {
+	PipeConfigSearch(const Size &in)
+		: input(in), found(false)
+	{
+	}
+
+	void add(const ImgUDevice::PipeConfig &config)
+	{
+		FOV candidateFov = calcFOV(input, config);
+		if (found && !candidateFov.isLarger(fov))
+			return;
+
+		best = config;
+		fov = candidateFov;
+		found = true;
+	}
+
+	const Size &input;
+	ImgUDevice::PipeConfig best;
+	FOV fov;
+	bool found;
+};
+
 /* Approximate a scaling factor sf to the closest one available in a range. */
 float findScaleFactor(float sf, const std::vector<float> &range,
 		      bool roundDown = false)
@@ -105,76 +152,80 @@ bool isSameRatio(const Size &in, const Size &out)
 	return true;
 }
 
-void calculateBDSHeight(ImgUDevice::Pipe *pipe, const Size &iif, const Size &gdc,
+/*
+ * Divide a size by a BDS scaling factor, returning the quotient if it is an
+ * integer, or 0 otherwise. Scaling factors are multiples of 1/32, so the test
+ * can be performed exactly with integer arithmetic.
+ */
+unsigned int bdsDivide(unsigned int size, float bdsSF)
+{
+	unsigned int num = size * 32;
+	unsigned int den = static_cast<unsigned int>(bdsSF * 32);
+
+	return num % den ? 0 : num / den;
+}
+
+void calculateBDSHeight(PipeConfigSearch &search, ImgUDevice::Pipe *pipe,
+			const Size &iif, const Size &gdc,
 			unsigned int bdsWidth, float bdsSF)
 {
 	unsigned int minIFHeight = iif.height - ImgUDevice::kIFMaxCropHeight;
 	unsigned int minBDSHeight = gdc.height + ImgUDevice::kFilterHeight * 2;
 	unsigned int ifHeight;
-	float bdsHeight;
 
 	if (!isSameRatio(pipe->input, gdc)) {
-		unsigned int foundIfHeight = 0;
 		float estIFHeight = (iif.width * gdc.height) /
 				    static_cast<float>(gdc.width);
 		estIFHeight = std::clamp<float>(estIFHeight, minIFHeight, iif.height);
 
-		ifHeight = utils::alignUp(estIFHeight, ImgUDevice::kIFAlignHeight);
-		while (ifHeight >= minIFHeight && ifHeight <= iif.height &&
-		       ifHeight / bdsSF >= minBDSHeight) {
-
-			float height = ifHeight / bdsSF;
-			if (std::fmod(height, 1.0) == 0) {
-				unsigned int bdsIntHeight = static_cast<unsigned int>(height);
-
-				if (!(bdsIntHeight % ImgUDevice::kBDSAlignHeight)) {
-					foundIfHeight = ifHeight;
-					bdsHeight = height;
-					break;
-				}
-			}
+		auto valid = [&](unsigned int height) {
+			return height >= minIFHeight && height <= iif.height &&
+			       height / bdsSF >= minBDSHeight;
+		};
 
-			ifHeight -= ImgUDevice::kIFAlignHeight;
-		}
+		auto matches = [&](unsigned int height) {
+			unsigned int bdsIntHeight = bdsDivide(height, bdsSF);
+			return bdsIntHeight &&
+			       !(bdsIntHeight % ImgUDevice::kBDSAlignHeight);
+		};
+
+		/*
+		 * Search for the closest suitable IF height above the
+		 * estimate first, and below it only if none is found, as a
+		 * match above takes precedence.
+		 */
+		unsigned int foundIfHeight = 0;
 
 		ifHeight = utils::alignUp(estIFHeight, ImgUDevice::kIFAlignHeight);
-		while (ifHeight >= minIFHeight && ifHeight <= iif.height &&
-		       ifHeight / bdsSF >= minBDSHeight) {
-
-			float height = ifHeight / bdsSF;
-			if (std::fmod(height, 1.0) == 0) {
-				unsigned int bdsIntHeight = static_cast<unsigned int>(height);
-
-				if (!(bdsIntHeight % ImgUDevice::kBDSAlignHeight)) {
-					foundIfHeight = ifHeight;
-					bdsHeight = height;
-					break;
-				}
+		for (; valid(ifHeight); ifHeight += ImgUDevice::kIFAlignHeight) {
+			if (matches(ifHeight)) {
+				foundIfHeight = ifHeight;
+				break;
 			}
+		}
 
-			ifHeight += ImgUDevice::kIFAlignHeight;
+		ifHeight = utils::alignUp(estIFHeight, ImgUDevice::kIFAlignHeight);
+		for (; !foundIfHeight && valid(ifHeight); ifHeight -= ImgUDevice::kIFAlignHeight) {
+			if (matches(ifHeight))
+				foundIfHeight = ifHeight;
 		}
 
 		if (foundIfHeight) {
-			unsigned int bdsIntHeight = static_cast<unsigned int>(bdsHeight);
+			unsigned int bdsIntHeight = bdsDivide(foundIfHeight, bdsSF);
 
-			pipeConfigs.push_back({ bdsSF, { iif.width, foundIfHeight },
-						{ bdsWidth, bdsIntHeight }, gdc });
+			search.add({ bdsSF, { iif.width, foundIfHeight },
+				     { bdsWidth, bdsIntHeight }, gdc });
 			return;
 		}
 	} else {
 		ifHeight = utils::alignUp(iif.height, ImgUDevice::kIFAlignHeight);
 		while (ifHeight >= minIFHeight && ifHeight / bdsSF >= minBDSHeight) {
+			unsigned int bdsIntHeight = bdsDivide(ifHeight, bdsSF);
 
-			bdsHeight = ifHeight / bdsSF;
-			if (std::fmod(ifHeight, 1.0) == 0 && std::fmod(bdsHeight, 1.0) == 0) {
-				unsigned int bdsIntHeight = static_cast<unsigned int>(bdsHeight);
-
-				if (!(ifHeight % ImgUDevice::kIFAlignHeight) &&
-				    !(bdsIntHeight % ImgUDevice::kBDSAlignHeight)) {
-					pipeConfigs.push_back({ bdsSF, { iif.width, ifHeight },
-								{ bdsWidth, bdsIntHeight }, gdc });
-				}
+			if (bdsIntHeight && !(ifHeight % ImgUDevice::kIFAlignHeight) &&
+			    !(bdsIntHeight % ImgUDevice::kBDSAlignHeight)) {
+				search.add({ bdsSF, { iif.width, ifHeight },
+					     { bdsWidth, bdsIntHeight }, gdc });
 			}
 
 			ifHeight -= ImgUDevice::kIFAlignHeight;
@@ -182,44 +233,40 @@ void calculateBDSHeight(ImgUDevice::Pipe *pipe, const Size &iif, const Size &gdc
 	}
 }
 
-void calculateBDS(ImgUDevice::Pipe *pipe, const Size &iif, const Size &gdc, float bdsSF)
+void calculateBDS(PipeConfigSearch &search, ImgUDevice::Pipe *pipe,
+		  const Size &iif, const Size &gdc, float bdsSF)
 {
 	unsigned int minBDSWidth = gdc.width + ImgUDevice::kFilterWidth * 2;
 	unsigned int minBDSHeight = gdc.height + ImgUDevice::kFilterHeight * 2;
 
-	float sf = bdsSF;
-	while (sf <= ImgUDevice::kBDSSfMax && sf >= ImgUDevice::kBDSSfMin) {
-		float bdsWidth = static_cast<float>(iif.width) / sf;
-		float bdsHeight = static_cast<float>(iif.height) / sf;
-
-		if (std::fmod(bdsWidth, 1.0) == 0 &&
-		    std::fmod(bdsHeight, 1.0) == 0) {
-			unsigned int bdsIntWidth = static_cast<unsigned int>(bdsWidth);
-			unsigned int bdsIntHeight = static_cast<unsigned int>(bdsHeight);
-			if (!(bdsIntWidth % ImgUDevice::kBDSAlignWidth) && bdsWidth >= minBDSWidth &&
-			    !(bdsIntHeight % ImgUDevice::kBDSAlignHeight) && bdsHeight >= minBDSHeight)
-				calculateBDSHeight(pipe, iif, gdc, bdsIntWidth, sf);
-		}
+	auto tryScaleFactor = [&](float sf) {
+		unsigned int bdsIntWidth = bdsDivide(iif.width, sf);
+		unsigned int bdsIntHeight = bdsDivide(iif.height, sf);
 
-		sf += ImgUDevice::kBDSSfStep;
-	}
+		if (bdsIntWidth && bdsIntHeight &&
+		    !(bdsIntWidth % ImgUDevice::kBDSAlignWidth) && bdsIntWidth >= minBDSWidth &&
+		    !(bdsIntHeight % ImgUDevice::kBDSAlignHeight) && bdsIntHeight >= minBDSHeight)
+			calculateBDSHeight(search, pipe, iif, gdc, bdsIntWidth, sf);
+	};
 
-	sf = bdsSF;
-	while (sf <= ImgUDevice::kBDSSfMax && sf >= ImgUDevice::kBDSSfMin) {
-		float bdsWidth = static_cast<float>(iif.width) / sf;
-		float bdsHeight = static_cast<float>(iif.height) / sf;
-
-		if (std::fmod(bdsWidth, 1.0) == 0 &&
-		    std::fmod(bdsHeight, 1.0) == 0) {
-			unsigned int bdsIntWidth = static_cast<unsigned int>(bdsWidth);
-			unsigned int bdsIntHeight = static_cast<unsigned int>(bdsHeight);
-			if (!(bdsIntWidth % ImgUDevice::kBDSAlignWidth) && bdsWidth >= minBDSWidth &&
-			    !(bdsIntHeight % ImgUDevice::kBDSAlignHeight) && bdsHeight >= minBDSHeight)
-				calculateBDSHeight(pipe, iif, gdc, bdsIntWidth, sf);
-		}
+	/*
+	 * The BDS output size decreases when the scaling factor increases, so
+	 * stop searching upwards as soon as it becomes smaller than the
+	 * minimum. The initial scaling factor is only evaluated once, as
+	 * evaluating it again can't produce a better candidate.
+	 */
+	for (float sf = bdsSF; sf <= ImgUDevice::kBDSSfMax && sf >= ImgUDevice::kBDSSfMin;
+	     sf += ImgUDevice::kBDSSfStep) {
+		if (iif.width / sf < minBDSWidth || iif.height / sf < minBDSHeight)
+			break;
 
-		sf -= ImgUDevice::kBDSSfStep;
+		tryScaleFactor(sf);
 	}
+
+	for (float sf = bdsSF - ImgUDevice::kBDSSfStep;
+	     sf <= ImgUDevice::kBDSSfMax && sf >= ImgUDevice::kBDSSfMin;
+	     sf -= ImgUDevice::kBDSSfStep)
+		tryScaleFactor(sf);
 }
 
 Size calculateGDC(ImgUDevice::Pipe *pipe)
@@ -254,22 +301,15 @@ Size calculateGDC(ImgUDevice::Pipe *pipe)
 	return gdc;
 }
 
-FOV calcFOV(const Size &in, const ImgUDevice::PipeConfig &pipe)
-{
-	FOV fov{};
-
-	float inW = static_cast<float>(in.width);
-	float inH = static_cast<float>(in.height);
-	float ifCropW = static_cast<float>(in.width - pipe.iif.width);
-	float ifCropH = static_cast<float>(in.height - pipe.iif.height);
-	float gdcCropW = static_cast<float>(pipe.bds.width - pipe.gdc.width) * pipe.bds_sf;
-	float gdcCropH = static_cast<float>(pipe.bds.height - pipe.gdc.height) * pipe.bds_sf;
-
-	fov.w = (inW - (ifCropW + gdcCropW)) / inW;
-	fov.h = (inH - (ifCropH + gdcCropH)) / inH;
+/*
+ * Configurations are validated and applied repeatedly with the same sizes, cache
+ * the result of the search.
+ */
+constexpr unsigned int kPipeConfigCacheSize = 32;
 
-	return fov;
-}
+Mutex pipeConfigCacheMutex;
+std::map<std::tuple<Size, Size, Size>, ImgUDevice::PipeConfig> pipeConfigCache
+	LIBCAMERA_TSA_GUARDED_BY(pipeConfigCacheMutex);
 
 } /* namespace */
 
@@ -383,8 +423,6 @@ int ImgUDevice::init(MediaDevice *media, unsigned int index)
  */
 ImgUDevice::PipeConfig ImgUDevice::calculatePipeConfig(Pipe *pipe)
 {
-	pipeConfigs.clear();
-
 	LOG(IPU3, Debug) << "Calculating pipe configuration for: ";
 	LOG(IPU3, Debug) << "input: " << pipe->input;
 	LOG(IPU3, Debug) << "main: " << pipe->main;
@@ -401,12 +439,26 @@ ImgUDevice::PipeConfig ImgUDevice::calculatePipeConfig(Pipe *pipe)
 		return {};
 	}
 
+	auto key = std::make_tuple(pipe->input, pipe->main, pipe->viewfinder);
+
+	{
+		MutexLocker locker(pipeConfigCacheMutex);
+
+		auto it = pipeConfigCache.find(key);
+		if (it != pipeConfigCache.end()) {
+			LOG(IPU3, Debug) << "Using cached pipe configuration";
+			return it->second;
+		}
+	}
+
 	Size gdc = calculateGDC(pipe);
 
 	float bdsSF = static_cast<float>(in.width) / gdc.width;
 	float sf = findScaleFactor(bdsSF, bdsScalingFactors, true);
 
-	/* Populate the configurations vector by scaling width and height. */
+	PipeConfigSearch search(in);
+
+	/* Search the configurations by scaling width and height. */
 	unsigned int ifWidth = utils::alignUp(in.width, ImgUDevice::kIFAlignWidth);
 	unsigned int ifHeight = utils::alignUp(in.height, ImgUDevice::kIFAlignHeight);
 	unsigned int minIfWidth = in.width - ImgUDevice::kIFMaxCropWidth;
@@ -414,7 +466,7 @@ ImgUDevice::PipeConfig ImgUDevice::calculatePipeConfig(Pipe *pipe)
 	while (ifWidth >= minIfWidth) {
 		while (ifHeight >= minIfHeight) {
 			Size iif{ ifWidth, ifHeight };
-			calculateBDS(pipe, iif, gdc, sf);
+			calculateBDS(search, pipe, iif, gdc, sf);
 			ifHeight -= ImgUDevice::kIFAlignHeight;
 		}
 
@@ -433,37 +485,30 @@ ImgUDevice::PipeConfig ImgUDevice::calculatePipeConfig(Pipe *pipe)
 		 */
 		while (ifWidth >= minIfWidth) {
 			Size iif{ ifWidth, ifHeight };
-			calculateBDS(pipe, iif, gdc, sf);
+			calculateBDS(search, pipe, iif, gdc, sf);
 			ifWidth -= ImgUDevice::kIFAlignWidth;
 		}
 
 		ifHeight -= ImgUDevice::kIFAlignHeight;
 	}
 
-	if (pipeConfigs.size() == 0) {
+	if (!search.found) {
 		LOG(IPU3, Error) << "Failed to calculate pipe configuration";
 		return {};
 	}
 
-	FOV bestFov = calcFOV(pipe->input, pipeConfigs[0]);
-	unsigned int bestIndex = 0;
-	unsigned int p = 0;
-	for (auto pipeConfig : pipeConfigs) {
-		FOV fov = calcFOV(pipe->input, pipeConfig);
-		if (fov.isLarger(bestFov)) {
-			bestFov = fov;
-			bestIndex = p;
-		}
+	LOG(IPU3, Debug) << "Computed pipe configuration: ";
+	LOG(IPU3, Debug) << "IF: " << search.best.iif;
+	LOG(IPU3, Debug) << "BDS: " << search.best.bds;
+	LOG(IPU3, Debug) << "GDC: " << search.best.gdc;
 
-		++p;
-	}
+	MutexLocker locker(pipeConfigCacheMutex);
 
-	LOG(IPU3, Debug) << "Computed pipe configuration: ";
-	LOG(IPU3, Debug) << "IF: " << pipeConfigs[bestIndex].iif;
-	LOG(IPU3, Debug) << "BDS: " << pipeConfigs[bestIndex].bds;
-	LOG(IPU3, Debug) << "GDC: " << pipeConfigs[bestIndex].gdc;
+	if (pipeConfigCache.size() >= kPipeConfigCacheSize)
+		pipeConfigCache.clear();
+	pipeConfigCache[key] = search.best;
 
-	return pipeConfigs[bestIndex];
+	return search.best;
 }
 
 /**
@@ -657,28 +702,17 @@ int ImgUDevice::start()
 {
 	int ret;
 
-	/* Start the ImgU video devices. */
-	ret = output_->streamOn();
-	if (ret) {
-		LOG(IPU3, Error) << "Failed to start ImgU output";
-		return ret;
-	}
-
-	ret = viewfinder_->streamOn();
-	if (ret) {
-		LOG(IPU3, Error) << "Failed to start ImgU viewfinder";
-		return ret;
-	}
-
-	ret = param_->streamOn();
-	if (ret) {
-		LOG(IPU3, Error) << "Failed to start ImgU param";
-		return ret;
-	}
+	/*
+	 * Start the ImgU output and capture video devices concurrently. The
+	 * input is started last, as it triggers processing.
+	 */
+	std::array<V4L2VideoDevice *, 4> devices = {
+		output_.get(), viewfinder_.get(), param_.get(), stat_.get(),
+	};
 
-	ret = stat_->streamOn();
+	ret = V4L2VideoDevice::streamOn(devices);
 	if (ret) {
-		LOG(IPU3, Error) << "Failed to start ImgU stat";
+		LOG(IPU3, Error) << "Failed to start ImgU video devices";
 		return ret;
 	}
 
@@ -693,75 +727,79 @@ int ImgUDevice::start()
 
 int ImgUDevice::stop()
 {
-	int ret;
-
-	ret = output_->streamOff();
-	ret |= viewfinder_->streamOff();
-	ret |= param_->streamOff();
-	ret |= stat_->streamOff();
-	ret |= input_->streamOff();
+	/* Stop all video devices concurrently to minimize the stop latency. */
+	std::array<V4L2VideoDevice *, 5> devices = {
+		output_.get(), viewfinder_.get(), param_.get(), stat_.get(),
+		input_.get(),
+	};
 
-	return ret;
+	return V4L2VideoDevice::streamOff(devices);
 }
 
 /**
- * \brief Enable or disable a single link on the ImgU instance
- *
- * This function assumes the media device associated with the ImgU instance
- * is open.
- *
- * \return 0 on success or a negative error code otherwise
+ * \brief Retrieve a single link on the ImgU instance
+ * \return The link, or nullptr if the link can't be found
  */
-int ImgUDevice::linkSetup(const std::string &source, unsigned int sourcePad,
-			  const std::string &sink, unsigned int sinkPad,
-			  bool enable)
+MediaLink *ImgUDevice::link(const std::string &source, unsigned int sourcePad,
+			    const std::string &sink, unsigned int sinkPad) const
 {
 	MediaLink *link = media_->link(source, sourcePad, sink, sinkPad);
-	if (!link) {
+	if (!link)
 		LOG(IPU3, Error)
 			<< "Failed to get link: '" << source << "':"
 			<< sourcePad << " -> '" << sink << "':" << sinkPad;
-		return -ENODEV;
-	}
 
-	return link->setEnabled(enable);
+	return link;
 }
 
 /**
- * \brief Enable or disable all media links in the ImgU instance to prepare
- * for capture operations
- *
- * \todo This function will probably be removed or changed once links will be
- * enabled or disabled selectively.
- *
- * \return 0 on success or a negative error code otherwise
+ * \brief Retrieve all media links in the ImgU instance
+ * \return The links, or an empty vector if any link can't be found
  */
-int ImgUDevice::enableLinks(bool enable)
+std::vector<MediaLink *> ImgUDevice::links() const
 {
 	std::string viewfinderName = name_ + " viewfinder";
 	std::string paramName = name_ + " parameters";
 	std::string outputName = name_ + " output";
 	std::string statName = name_ + " 3a stat";
 	std::string inputName = name_ + " input";
-	int ret;
 
-	ret = linkSetup(inputName, 0, name_, PAD_INPUT, enable);
-	if (ret)
-		return ret;
+	std::vector<MediaLink *> links = {
+		link(inputName, 0, name_, PAD_INPUT),
+		link(name_, PAD_OUTPUT, outputName, 0),
+		link(name_, PAD_VF, viewfinderName, 0),
+		link(paramName, 0, name_, PAD_PARAM),
+		link(name_, PAD_STAT, statName, 0),
+	};
 
-	ret = linkSetup(name_, PAD_OUTPUT, outputName, 0, enable);
-	if (ret)
-		return ret;
+	if (std::find(links.begin(), links.end(), nullptr) != links.end())
+		return {};
 
-	ret = linkSetup(name_, PAD_VF, viewfinderName, 0, enable);
-	if (ret)
-		return ret;
+	return links;
+}
 
-	ret = linkSetup(paramName, 0, name_, PAD_PARAM, enable);
-	if (ret)
-		return ret;
+/**
+ * \brief Enable or disable all media links in the ImgU instance to prepare
+ * for capture operations
+ *
+ * \todo This function will probably be removed or changed once links will be
+ * enabled or disabled selectively.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int ImgUDevice::enableLinks(bool enable)
+{
+	std::vector<MediaLink *> imguLinks = links();
+	if (imguLinks.empty())
+		return -ENODEV;
+
+	for (MediaLink *link : imguLinks) {
+		int ret = link->setEnabled(enable);
+		if (ret)
+			return ret;
+	}
 
-	return linkSetup(name_, PAD_STAT, statName, 0, enable);
+	return 0;
 }
 
 } /* namespace libcamera */
@@ -9,6 +9,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "libcamera/internal/v4l2_subdevice.h"
 #include "libcamera/internal/v4l2_videodevice.h"
@@ -90,6 +91,7 @@ public:
 	int start();
 	int stop();
 
+	std::vector<MediaLink *> links() const;
 	int enableLinks(bool enable);
 
 	std::unique_ptr<V4L2Subdevice> imgu_;
@@ -109,9 +111,8 @@ private:
 	static constexpr unsigned int PAD_VF = 3;
 	static constexpr unsigned int PAD_STAT = 4;
 
-	int linkSetup(const std::string &source, unsigned int sourcePad,
-		      const std::string &sink, unsigned int sinkPad,
-		      bool enable);
+	MediaLink *link(const std::string &source, unsigned int sourcePad,
+			const std::string &sink, unsigned int sinkPad) const;
 
 	int configureVideoDevice(V4L2VideoDevice *dev, unsigned int pad,
 				 const StreamConfiguration &cfg,
@@ -7,6 +7,7 @@
 
 #include <algorithm>
 #include <iomanip>
+#include <map>
 #include <memory>
 #include <queue>
 #include <vector>
@@ -51,12 +52,16 @@ class IPU3CameraData : public Camera::Private
 {
 public:
 	IPU3CameraData(PipelineHandler *pipe)
-		: Camera::Private(pipe)
+		: Camera::Private(pipe), imgu_(nullptr), otherImgu_(nullptr),
+		  internalBufferCount_(0)
 	{
 	}
 
 	int loadIPA();
 
+	void connectImgU(ImgUDevice *imgu);
+	void disconnectImgU(ImgUDevice *imgu);
+
 	void imguOutputBufferReady(FrameBuffer *buffer);
 	void cio2BufferReady(FrameBuffer *buffer);
 	void paramBufferReady(FrameBuffer *buffer);
@@ -67,12 +72,16 @@ public:
 
 	CIO2Device cio2_;
 	ImgUDevice *imgu_;
+	ImgUDevice *otherImgu_;
+	/* The ImgU instances that process frames, in round-robin order. */
+	std::vector<ImgUDevice *> imgus_;
 
 	Stream outStream_;
 	Stream vfStream_;
 	Stream rawStream_;
 
 	Rectangle cropRegion_;
+	unsigned int internalBufferCount_;
 
 	std::unique_ptr<DelayedControls> delayedCtrls_;
 	IPU3Frames frameInfos_;
@@ -98,6 +107,7 @@ class IPU3CameraConfiguration : public CameraConfiguration
 public:
 	static constexpr unsigned int kBufferCount = 4;
 	static constexpr unsigned int kMaxStreams = 3;
+	static constexpr unsigned int kMaxInternalBuffers = 16;
 
 	IPU3CameraConfiguration(IPU3CameraData *data);
 
@@ -158,11 +168,15 @@ private:
 	int updateControls(IPU3CameraData *data);
 	int registerCameras();
 
+	int assignImgUs(IPU3CameraData *data);
+
 	int allocateBuffers(Camera *camera);
 	int freeBuffers(Camera *camera);
 
 	ImgUDevice imgu0_;
 	ImgUDevice imgu1_;
+	/* The camera whose frames are processed by each ImgU. */
+	std::map<const ImgUDevice *, IPU3CameraData *> imguUsers_;
 	MediaDevice *cio2MediaDev_;
 	MediaDevice *imguMediaDev_;
 
@@ -381,6 +395,11 @@ CameraConfiguration::Status IPU3CameraConfiguration::validate()
 		}
 	}
 
+	if (internalBufferCount > kMaxInternalBuffers) {
+		internalBufferCount = kMaxInternalBuffers;
+		status = Adjusted;
+	}
+
 	return status;
 }
 
@@ -485,10 +504,13 @@ int PipelineHandlerIPU3::configure(Camera *camera, CameraConfiguration *c)
 	Stream *outStream = &data->outStream_;
 	Stream *vfStream = &data->vfStream_;
 	CIO2Device *cio2 = &data->cio2_;
-	ImgUDevice *imgu = data->imgu_;
 	V4L2DeviceFormat outputFormat;
 	int ret;
 
+	ret = assignImgUs(data);
+	if (ret)
+		return ret;
+
 	/*
 	 * FIXME: enabled links in one ImgU pipe interfere with capture
 	 * operations on the other one. This can be easily triggered by
@@ -516,7 +538,17 @@ int PipelineHandlerIPU3::configure(Camera *camera, CameraConfiguration *c)
 	 * without going through any re-configuration (a sequence that is
 	 * allowed by the Camera state machine) would now fail on the IPU3.
 	 */
-	ret = imguMediaDev_->disableLinks();
+	std::vector<MediaLink *> imguLinks;
+	for (ImgUDevice *imgu : data->imgus_) {
+		std::vector<MediaLink *> links = imgu->links();
+		if (links.empty())
+			return -ENODEV;
+
+		imguLinks.insert(imguLinks.end(), links.begin(), links.end());
+	}
+
+	/* Leave the links we enable below untouched to avoid link setups. */
+	ret = imguMediaDev_->disableLinks(imguLinks);
 	if (ret)
 		return ret;
 
@@ -527,9 +559,11 @@ int PipelineHandlerIPU3::configure(Camera *camera, CameraConfiguration *c)
 	 * stream which is for raw capture, in which case no buffers will
 	 * ever be queued to the ImgU.
 	 */
-	ret = data->imgu_->enableLinks(true);
-	if (ret)
-		return ret;
+	for (ImgUDevice *imgu : data->imgus_) {
+		ret = imgu->enableLinks(true);
+		if (ret)
+			return ret;
+	}
 
 	/*
 	 * Pass the requested stream size to the CIO2 unit and get back the
@@ -544,6 +578,7 @@ int PipelineHandlerIPU3::configure(Camera *camera, CameraConfiguration *c)
 	IPACameraSensorInfo sensorInfo;
 	cio2->sensor()->sensorInfo(&sensorInfo);
 	data->cropRegion_ = sensorInfo.analogCrop;
+	data->internalBufferCount_ = config->internalBufferCount;
 
 	/*
 	 * If the ImgU gets configured, its driver seems to expect that
@@ -559,57 +594,62 @@ int PipelineHandlerIPU3::configure(Camera *camera, CameraConfiguration *c)
 	if (imguConfig.isNull())
 		return 0;
 
-	ret = imgu->configure(imguConfig, &cio2Format);
-	if (ret)
-		return ret;
-
-	/* Apply the format to the configured streams output devices. */
-	StreamConfiguration *mainCfg = nullptr;
-	StreamConfiguration *vfCfg = nullptr;
+	/* All the ImgU instances in use are configured identically. */
+	for (ImgUDevice *imgu : data->imgus_) {
+		V4L2DeviceFormat inputFormat = cio2Format;
+		ret = imgu->configure(imguConfig, &inputFormat);
+		if (ret)
+			return ret;
 
-	for (unsigned int i = 0; i < config->size(); ++i) {
-		StreamConfiguration &cfg = (*config)[i];
-		Stream *stream = cfg.stream();
+		/* Apply the format to the configured streams output devices. */
+		StreamConfiguration *mainCfg = nullptr;
+		StreamConfiguration *vfCfg = nullptr;
+
+		for (unsigned int i = 0; i < config->size(); ++i) {
+			StreamConfiguration &cfg = (*config)[i];
+			Stream *stream = cfg.stream();
+
+			if (stream == outStream) {
+				mainCfg = &cfg;
+				ret = imgu->configureOutput(cfg, &outputFormat);
+				if (ret)
+					return ret;
+			} else if (stream == vfStream) {
+				vfCfg = &cfg;
+				ret = imgu->configureViewfinder(cfg, &outputFormat);
+				if (ret)
+					return ret;
+			}
+		}
 
-		if (stream == outStream) {
-			mainCfg = &cfg;
-			ret = imgu->configureOutput(cfg, &outputFormat);
-			if (ret)
-				return ret;
-		} else if (stream == vfStream) {
-			vfCfg = &cfg;
-			ret = imgu->configureViewfinder(cfg, &outputFormat);
+		/*
+		 * As we need to set format also on the non-active streams, use
+		 * the configuration of the active one for that purpose (there
+		 * should be at least one active stream in the configuration
+		 * request).
+		 */
+		if (!vfCfg) {
+			ret = imgu->configureViewfinder(*mainCfg, &outputFormat);
 			if (ret)
 				return ret;
 		}
-	}
 
-	/*
-	 * As we need to set format also on the non-active streams, use
-	 * the configuration of the active one for that purpose (there should
-	 * be at least one active stream in the configuration request).
-	 */
-	if (!vfCfg) {
-		ret = imgu->configureViewfinder(*mainCfg, &outputFormat);
-		if (ret)
+		/* Apply the "pipe_mode" control to the ImgU subdevice. */
+		ControlList ctrls(imgu->imgu_->controls());
+		/*
+		 * Set the ImgU pipe mode to 'Video' unconditionally to have
+		 * statistics generated.
+		 *
+		 * \todo Figure out what the 'Still Capture' mode is meant for,
+		 * and use it accordingly.
+		 */
+		ctrls.set(V4L2_CID_IPU3_PIPE_MODE,
+			  static_cast<int32_t>(IPU3PipeModeVideo));
+		ret = imgu->imgu_->setControls(&ctrls);
+		if (ret) {
+			LOG(IPU3, Error) << "Unable to set pipe_mode control";
 			return ret;
-	}
-
-	/* Apply the "pipe_mode" control to the ImgU subdevice. */
-	ControlList ctrls(imgu->imgu_->controls());
-	/*
-	 * Set the ImgU pipe mode to 'Video' unconditionally to have statistics
-	 * generated.
-	 *
-	 * \todo Figure out what the 'Still Capture' mode is meant for, and use
-	 * it accordingly.
-	 */
-	ctrls.set(V4L2_CID_IPU3_PIPE_MODE,
-		  static_cast<int32_t>(IPU3PipeModeVideo));
-	ret = imgu->imgu_->setControls(&ctrls);
-	if (ret) {
-		LOG(IPU3, Error) << "Unable to set pipe_mode control";
-		return ret;
+		}
 	}
 
 	ipa::ipu3::IPAConfigInfo configInfo;
@@ -649,6 +689,62 @@ int PipelineHandlerIPU3::exportFrameBuffers(Camera *camera, Stream *stream,
 	return -EINVAL;
 }
 
+/**
+ * \brief Select the ImgU instances that process the frames of a camera
+ * \param[in] data The camera data
+ *
+ * Each camera is associated with one of the two ImgU instances. When the other
+ * instance isn't used by a running camera, use it as well to process every
+ * other frame, which doubles the processing throughput of the pipeline. The
+ * ImgU parameters are fully written for every frame by the IPA, so frames can
+ * be processed by either instance.
+ *
+ * \return 0 on success or a negative error code otherwise
+ * \retval -EBUSY the ImgU of the camera is in use by another running camera
+ */
+int PipelineHandlerIPU3::assignImgUs(IPU3CameraData *data)
+{
+	IPU3CameraData *user = imguUsers_[data->imgu_];
+	if (user && user != data && user->isRunning()) {
+		LOG(IPU3, Error) << "ImgU in use by another camera";
+		return -EBUSY;
+	}
+
+	user = imguUsers_[data->otherImgu_];
+	bool dual = !user || user == data || !user->isRunning();
+
+	data->imgus_ = { data->imgu_ };
+	if (dual)
+		data->imgus_.push_back(data->otherImgu_);
+
+	for (ImgUDevice *imgu : { &imgu0_, &imgu1_ }) {
+		bool used = std::find(data->imgus_.begin(), data->imgus_.end(),
+				      imgu) != data->imgus_.end();
+		IPU3CameraData *&current = imguUsers_[imgu];
+
+		if (used && current != data) {
+			if (current) {
+				current->disconnectImgU(imgu);
+				std::vector<ImgUDevice *> &imgus = current->imgus_;
+				imgus.erase(std::remove(imgus.begin(), imgus.end(), imgu),
+					    imgus.end());
+			}
+
+			data->connectImgU(imgu);
+			current = data;
+		} else if (!used && current == data) {
+			data->disconnectImgU(imgu);
+			current = nullptr;
+		}
+	}
+
+	LOG(IPU3, Debug)
+		<< "Processing frames with " << data->imgus_.size()
+		<< " ImgU instance(s)";
+
+	return 0;
+}
+
 /**
  * \todo Clarify if 'viewfinder' and 'stat' nodes have to be set up and
  * started even if not in use. As of now, if not properly configured and
@@ -660,36 +756,54 @@ int PipelineHandlerIPU3::exportFrameBuffers(Camera *camera, Stream *stream,
 int PipelineHandlerIPU3::allocateBuffers(Camera *camera)
 {
 	IPU3CameraData *data = cameraData(camera);
-	ImgUDevice *imgu = data->imgu_;
 	unsigned int bufferCount;
 	int ret;
 
-	bufferCount = std::max({
-		data->outStream_.configuration().bufferCount,
-		data->vfStream_.configuration().bufferCount,
-		data->rawStream_.configuration().bufferCount,
-	});
-
-	ret = imgu->allocateBuffers(bufferCount);
-	if (ret < 0)
-		return ret;
+	/*
+	 * Allocate as many parameters and statistics buffers as the largest
+	 * number of stream buffers, unless configured explicitly.
+	 */
+	bufferCount = data->internalBufferCount_;
+	if (!bufferCount)
+		bufferCount = std::max({
+			data->outStream_.configuration().bufferCount,
+			data->vfStream_.configuration().bufferCount,
+			data->rawStream_.configuration().bufferCount,
+		});
+
+	for (ImgUDevice *imgu : data->imgus_) {
+		ret = imgu->allocateBuffers(bufferCount);
+		if (ret < 0) {
+			for (ImgUDevice *other : data->imgus_) {
+				if (other == imgu)
+					break;
+				other->freeBuffers();
+			}
+			return ret;
+		}
+	}
 
 	/* Map buffers to the IPA. */
 	unsigned int ipaBufferId = 1;
 
-	for (const std::unique_ptr<FrameBuffer> &buffer : imgu->paramBuffers_) {
-		buffer->setCookie(ipaBufferId++);
-		ipaBuffers_.emplace_back(buffer->cookie(), buffer->planes());
-	}
+	data->frameInfos_.init(data->maxQueuedRequests_);
+
+	for (ImgUDevice *imgu : data->imgus_) {
+		for (const std::unique_ptr<FrameBuffer> &buffer : imgu->paramBuffers_) {
+			buffer->setCookie(ipaBufferId++);
+			ipaBuffers_.emplace_back(buffer->cookie(), buffer->planes());
+		}
 
-	for (const std::unique_ptr<FrameBuffer> &buffer : imgu->statBuffers_) {
-		buffer->setCookie(ipaBufferId++);
-		ipaBuffers_.emplace_back(buffer->cookie(), buffer->planes());
+		for (const std::unique_ptr<FrameBuffer> &buffer : imgu->statBuffers_) {
+			buffer->setCookie(ipaBufferId++);
+			ipaBuffers_.emplace_back(buffer->cookie(), buffer->planes());
+		}
+
+		data->frameInfos_.addPipe(imgu->paramBuffers_, imgu->statBuffers_);
 	}
 
 	data->ipa_->mapBuffers(ipaBuffers_);
 
-	data->frameInfos_.init(imgu->paramBuffers_, imgu->statBuffers_);
 	data->frameInfos_.bufferAvailable.connect(
 		data, &IPU3CameraData::queuePendingRequests);
 
@@ -709,7 +823,8 @@ int PipelineHandlerIPU3::freeBuffers(Camera *camera)
 	data->ipa_->unmapBuffers(ids);
 	ipaBuffers_.clear();
 
-	data->imgu_->freeBuffers();
+	for (ImgUDevice *imgu : data->imgus_)
+		imgu->freeBuffers();
 
 	return 0;
 }
@@ -718,9 +833,14 @@ int PipelineHandlerIPU3::start(Camera *camera, [[maybe_unused]] const ControlLis
 {
 	IPU3CameraData *data = cameraData(camera);
 	CIO2Device *cio2 = &data->cio2_;
-	ImgUDevice *imgu = data->imgu_;
 	int ret;
 
+	/* The ImgU may have been taken over by another camera since configure(). */
+	if (data->imgus_.empty()) {
+		LOG(IPU3, Error) << "No ImgU assigned, camera must be reconfigured";
+		return -EBUSY;
+	}
+
 	/* Disable test pattern mode on the sensor, if any. */
 	ret = cio2->sensor()->setTestPatternMode(
 		controls::draft::TestPatternModeEnum::TestPatternModeOff);
@@ -746,14 +866,17 @@ int PipelineHandlerIPU3::start(Camera *camera, [[maybe_unused]] const ControlLis
 	if (ret)
 		goto error;
 
-	ret = imgu->start();
-	if (ret)
-		goto error;
+	for (ImgUDevice *imgu : data->imgus_) {
+		ret = imgu->start();
+		if (ret)
+			goto error;
+	}
 
 	return 0;
 
 error:
-	imgu->stop();
+	for (ImgUDevice *imgu : data->imgus_)
+		imgu->stop();
 	cio2->stop();
 	data->ipa_->stop();
 	freeBuffers(camera);
@@ -771,7 +894,8 @@ void PipelineHandlerIPU3::stopDevice(Camera *camera)
 
 	data->ipa_->stop();
 
-	ret |= data->imgu_->stop();
+	for (ImgUDevice *imgu : data->imgus_)
+		ret |= imgu->stop();
 	ret |= data->cio2_.stop();
 	if (ret)
 		LOG(IPU3, Warning) << "Failed to stop camera " << camera->id();
@@ -1104,9 +1228,11 @@ int PipelineHandlerIPU3::registerCameras()
 		 * \todo Dynamically assign ImgU and output devices to each
 		 * stream and camera; as of now, limit support to two cameras
 		 * only, and assign imgu0 to the first one and imgu1 to the
-		 * second.
+		 * second. The other ImgU is borrowed when it is idle, see
+		 * assignImgUs().
 		 */
 		data->imgu_ = numCameras ? &imgu1_ : &imgu0_;
+		data->otherImgu_ = numCameras ? &imgu0_ : &imgu1_;
 
 		/*
 		 * Connect video devices' 'bufferReady' signals to their
@@ -1115,21 +1241,13 @@ int PipelineHandlerIPU3::registerCameras()
 		 * Frames produced by the CIO2 unit are passed to the
 		 * associated ImgU input where they get processed and
 		 * returned through the ImgU main and secondary outputs.
+		 * The ImgU signals are connected when the camera is
+		 * configured.
 		 */
 		data->cio2_.bufferReady().connect(data.get(),
 					&IPU3CameraData::cio2BufferReady);
 		data->cio2_.bufferAvailable.connect(
 			data.get(), &IPU3CameraData::queuePendingRequests);
-		data->imgu_->input_->bufferReady.connect(&data->cio2_,
-					&CIO2Device::tryReturnBuffer);
-		data->imgu_->output_->bufferReady.connect(data.get(),
-					&IPU3CameraData::imguOutputBufferReady);
-		data->imgu_->viewfinder_->bufferReady.connect(data.get(),
-					&IPU3CameraData::imguOutputBufferReady);
-		data->imgu_->param_->bufferReady.connect(data.get(),
-					&IPU3CameraData::paramBufferReady);
-		data->imgu_->stat_->bufferReady.connect(data.get(),
-					&IPU3CameraData::statBufferReady);
 
 		/* Create and register the Camera instance. */
 		const std::string &cameraId = cio2->sensor()->id();
@@ -1149,6 +1267,24 @@ int PipelineHandlerIPU3::registerCameras()
 	return numCameras ? 0 : -ENODEV;
 }
 
+void IPU3CameraData::connectImgU(ImgUDevice *imgu)
+{
+	imgu->input_->bufferReady.connect(&cio2_, &CIO2Device::tryReturnBuffer);
+	imgu->output_->bufferReady.connect(this, &IPU3CameraData::imguOutputBufferReady);
+	imgu->viewfinder_->bufferReady.connect(this, &IPU3CameraData::imguOutputBufferReady);
+	imgu->param_->bufferReady.connect(this, &IPU3CameraData::paramBufferReady);
+	imgu->stat_->bufferReady.connect(this, &IPU3CameraData::statBufferReady);
+}
+
+void IPU3CameraData::disconnectImgU(ImgUDevice *imgu)
+{
+	imgu->input_->bufferReady.disconnect(&cio2_);
+	imgu->output_->bufferReady.disconnect(this);
+	imgu->viewfinder_->bufferReady.disconnect(this);
+	imgu->param_->bufferReady.disconnect(this);
+	imgu->stat_->bufferReady.disconnect(this);
+}
+
 int IPU3CameraData::loadIPA()
 {
 	ipa_ = IPAManager::createIPA<ipa::ipu3::IPAProxyIPU3>(pipe(), 1, 1);
@@ -1224,22 +1360,25 @@ void IPU3CameraData::paramsBufferReady(unsigned int id)
 	if (!info)
 		return;
 
+	/* Frames are distributed to the ImgU instances by IPU3Frames. */
+	ImgUDevice *imgu = imgus_[info->pipe];
+
 	/* Queue all buffers from the request aimed for the ImgU. */
 	for (auto it : info->request->buffers()) {
 		const Stream *stream = it.first;
 		FrameBuffer *outbuffer = it.second;
 
 		if (stream == &outStream_)
-			imgu_->output_->queueBuffer(outbuffer);
+			imgu->output_->queueBuffer(outbuffer);
 		else if (stream == &vfStream_)
-			imgu_->viewfinder_->queueBuffer(outbuffer);
+			imgu->viewfinder_->queueBuffer(outbuffer);
 	}
 
 	info->paramBuffer->_d()->metadata().planes()[0].bytesused =
 		sizeof(struct ipu3_uapi_params);
-	imgu_->param_->queueBuffer(info->paramBuffer);
-	imgu_->stat_->queueBuffer(info->statBuffer);
-	imgu_->input_->queueBuffer(info->rawBuffer);
+	imgu->param_->queueBuffer(info->paramBuffer);
+	imgu->stat_->queueBuffer(info->statBuffer);
+	imgu->input_->queueBuffer(info->rawBuffer);
 }
 
 void IPU3CameraData::metadataReady(unsigned int id, const ControlList &metadata)
@@ -1324,6 +1463,8 @@ void IPU3CameraData::cio2BufferReady(FrameBuffer *buffer)
 	request->metadata().set(controls::SensorTimestamp,
 				buffer->metadata().timestamp);
 
+	pipe()->framesDropped(_o<Camera>(), cio2_.lastFrameDrops());
+
 	info->effectiveSensorControls = delayedCtrls_->get(buffer->metadata().sequence);
 
 	if (request->findBuffer(&rawStream_))
@@ -10,11 +10,13 @@
 #include <iomanip>
 #include <memory>
 #include <numeric>
-#include <queue>
+#include <optional>
+#include <vector>
 
 #include <linux/media-bus-format.h>
 #include <linux/rkisp1-config.h>
 
+#include <libcamera/base/file.h>
 #include <libcamera/base/log.h>
 #include <libcamera/base/utils.h>
 
@@ -33,6 +35,7 @@
 
 #include "libcamera/internal/camera.h"
 #include "libcamera/internal/camera_sensor.h"
+#include "libcamera/internal/converter.h"
 #include "libcamera/internal/delayed_controls.h"
 #include "libcamera/internal/device_enumerator.h"
 #include "libcamera/internal/framebuffer.h"
@@ -41,9 +44,12 @@
 #include "libcamera/internal/pipeline_handler.h"
 #include "libcamera/internal/v4l2_subdevice.h"
 #include "libcamera/internal/v4l2_videodevice.h"
+#include "libcamera/internal/yaml_parser.h"
 
 #include "rkisp1_path.h"
 
+using namespace std::chrono_literals;
+
 namespace libcamera {
 
 LOG_DEFINE_CATEGORY(RkISP1)
@@ -59,9 +65,13 @@ struct RkISP1FrameInfo {
 	FrameBuffer *statBuffer;
 	FrameBuffer *mainPathBuffer;
 	FrameBuffer *selfPathBuffer;
+	FrameBuffer *dewarpBuffer;
+
+	std::optional<Rectangle> dewarpCrop;
 
 	bool paramDequeued;
 	bool metadataProcessed;
+	bool sensorMetadataAvailable;
 };
 
 class RkISP1Frames
@@ -69,6 +79,7 @@ class RkISP1Frames
 public:
 	RkISP1Frames(PipelineHandler *pipe);
 
+	void init(unsigned int capacity);
 	RkISP1FrameInfo *create(const RkISP1CameraData *data, Request *request,
 				bool isRaw);
 	int destroy(unsigned int frame);
@@ -80,7 +91,7 @@ public:
 
 private:
 	PipelineHandlerRkISP1 *pipe_;
-	std::map<unsigned int, RkISP1FrameInfo *> frameInfo_;
+	std::vector<RkISP1FrameInfo> frameInfo_;
 };
 
 class RkISP1CameraData : public Camera::Private
@@ -89,27 +100,44 @@ public:
 	RkISP1CameraData(PipelineHandler *pipe, RkISP1MainPath *mainPath,
 			 RkISP1SelfPath *selfPath)
 		: Camera::Private(pipe), frame_(0), frameInfo_(pipe),
-		  mainPath_(mainPath), selfPath_(selfPath)
+		  mainPath_(mainPath), selfPath_(selfPath), dewarper_(nullptr)
 	{
 	}
 
 	PipelineHandlerRkISP1 *pipe();
 	int loadIPA(unsigned int hwRevision);
 
+	bool canDewarp(const StreamConfiguration &cfg) const;
+	Rectangle dewarpCrop(const Rectangle &scalerCrop) const;
+	Rectangle scalerCrop(const Rectangle &dewarpCrop) const;
+
 	Stream mainPathStream_;
 	Stream selfPathStream_;
 	std::unique_ptr<CameraSensor> sensor_;
 	std::unique_ptr<DelayedControls> delayedCtrls_;
 	unsigned int frame_;
+	utils::Duration lineDuration_;
 	std::vector<IPABuffer> ipaBuffers_;
 	RkISP1Frames frameInfo_;
 
 	RkISP1MainPath *mainPath_;
 	RkISP1SelfPath *selfPath_;
 
+	/*
+	 * The dewarper used to post-process the main path, if available and
+	 * enabled in the tuning file, and the area of the sensor pixel array
+	 * captured by the main path and its size when it is in use.
+	 */
+	Converter *dewarper_;
+	Rectangle scalerMaxCrop_;
+	Size dewarpInputSize_;
+	Rectangle dewarpCrop_;
+
 	std::unique_ptr<ipa::rkisp1::IPAProxyRkISP1> ipa_;
 
 private:
+	void loadDewarpConfiguration(const std::string &filename);
+
 	void paramFilled(unsigned int frame);
 	void setSensorControls(unsigned int frame,
 			       const ControlList &sensorControls);
@@ -120,6 +148,8 @@ private:
 class RkISP1CameraConfiguration : public CameraConfiguration
 {
 public:
+	static constexpr unsigned int kMaxInternalBuffers = 16;
+
 	RkISP1CameraConfiguration(Camera *camera, RkISP1CameraData *data);
 
 	Status validate() override;
@@ -156,6 +186,7 @@ public:
 
 	int start(Camera *camera, const ControlList *controls) override;
 	void stopDevice(Camera *camera) override;
+	void releaseDevice(Camera *camera) override;
 
 	int queueRequestDevice(Camera *camera, Request *request) override;
 
@@ -181,8 +212,20 @@ private:
 	void statReady(FrameBuffer *buffer);
 	void frameStart(uint32_t sequence);
 
+	int configureDewarper(RkISP1CameraData *data,
+			      const StreamConfiguration &cfg,
+			      const V4L2SubdeviceFormat &format);
+	void dewarpBuffer(RkISP1CameraData *data, RkISP1FrameInfo *info,
+			  FrameBuffer *buffer);
+	void cancelDewarpBuffer(RkISP1FrameInfo *info, FrameBuffer *buffer);
+	void dewarpInputReady(FrameBuffer *buffer);
+	void dewarpOutputReady(FrameBuffer *buffer);
+
+	int setMetaFormats(Camera *camera);
 	int allocateBuffers(Camera *camera);
 	int freeBuffers(Camera *camera);
+	int allocateDewarpBuffers();
+	void freeDewarpBuffers();
 
 	MediaDevice *media_;
 	std::unique_ptr<V4L2Subdevice> isp_;
@@ -192,14 +235,21 @@ private:
 
 	bool hasSelfPath_;
 	bool isRaw_;
+	unsigned int internalBufferCount_;
 
 	RkISP1MainPath mainPath_;
 	RkISP1SelfPath selfPath_;
 
 	std::vector<std::unique_ptr<FrameBuffer>> paramBuffers_;
 	std::vector<std::unique_ptr<FrameBuffer>> statBuffers_;
-	std::queue<FrameBuffer *> availableParamBuffers_;
-	std::queue<FrameBuffer *> availableStatBuffers_;
+	std::vector<FrameBuffer *> availableParamBuffers_;
+	std::vector<FrameBuffer *> availableStatBuffers_;
+
+	std::unique_ptr<Converter> dewarper_;
+	bool useDewarper_;
+	unsigned int dewarpBufferCount_;
+	std::vector<std::unique_ptr<FrameBuffer>> mainPathBuffers_;
+	std::vector<FrameBuffer *> availableMainPathBuffers_;
 
 	Camera *activeCamera_;
 
@@ -211,13 +261,53 @@ RkISP1Frames::RkISP1Frames(PipelineHandler *pipe)
 {
 }
 
+/*
+ * Frames are stored at the index of their number modulo the pool capacity. As
+ * requests complete in order, the frames in flight have consecutive numbers,
+ * and a capacity equal to the maximum number of queued requests guarantees
+ * that they never collide.
+ */
+void RkISP1Frames::init(unsigned int capacity)
+{
+	clear();
+
+	frameInfo_.resize(capacity);
+	for (RkISP1FrameInfo &info : frameInfo_)
+		info.request = nullptr;
+}
+
 RkISP1FrameInfo *RkISP1Frames::create(const RkISP1CameraData *data, Request *request,
 				      bool isRaw)
 {
 	unsigned int frame = data->frame_;
 
+	if (frameInfo_.empty())
+		return nullptr;
+
+	RkISP1FrameInfo *info = &frameInfo_[frame % frameInfo_.size()];
+	if (info->request) {
+		LOG(RkISP1, Error)
+			<< "Frame " << info->frame << " still in flight, can't track frame "
+			<< frame;
+		return nullptr;
+	}
+
 	FrameBuffer *paramBuffer = nullptr;
 	FrameBuffer *statBuffer = nullptr;
+	FrameBuffer *mainPathBuffer = request->findBuffer(&data->mainPathStream_);
+	FrameBuffer *selfPathBuffer = request->findBuffer(&data->selfPathStream_);
+	FrameBuffer *dewarpBuffer = nullptr;
+
+	/*
+	 * When the dewarper is in use, the main path captures to an internal
+	 * buffer that the dewarper then processes to the request buffer.
+	 */
+	if (pipe_->useDewarper_ && mainPathBuffer) {
+		if (pipe_->availableMainPathBuffers_.empty()) {
+			LOG(RkISP1, Error) << "Main path buffer underrun";
+			return nullptr;
+		}
+	}
 
 	if (!isRaw) {
 		if (pipe_->availableParamBuffers_.empty()) {
@@ -230,28 +320,30 @@ RkISP1FrameInfo *RkISP1Frames::create(const RkISP1CameraData *data, Request *req
 			return nullptr;
 		}
 
-		paramBuffer = pipe_->availableParamBuffers_.front();
-		pipe_->availableParamBuffers_.pop();
+		paramBuffer = pipe_->availableParamBuffers_.back();
+		pipe_->availableParamBuffers_.pop_back();
 
-		statBuffer = pipe_->availableStatBuffers_.front();
-		pipe_->availableStatBuffers_.pop();
+		statBuffer = pipe_->availableStatBuffers_.back();
+		pipe_->availableStatBuffers_.pop_back();
 	}
 
-	FrameBuffer *mainPathBuffer = request->findBuffer(&data->mainPathStream_);
-	FrameBuffer *selfPathBuffer = request->findBuffer(&data->selfPathStream_);
-
-	RkISP1FrameInfo *info = new RkISP1FrameInfo;
+	if (pipe_->useDewarper_ && mainPathBuffer) {
+		dewarpBuffer = mainPathBuffer;
+		mainPathBuffer = pipe_->availableMainPathBuffers_.back();
+		pipe_->availableMainPathBuffers_.pop_back();
+	}
 
 	info->frame = frame;
 	info->request = request;
 	info->paramBuffer = paramBuffer;
 	info->mainPathBuffer = mainPathBuffer;
 	info->selfPathBuffer = selfPathBuffer;
+	info->dewarpBuffer = dewarpBuffer;
+	info->dewarpCrop.reset();
 	info->statBuffer = statBuffer;
 	info->paramDequeued = false;
 	info->metadataProcessed = false;
-
-	frameInfo_[frame] = info;
+	info->sensorMetadataAvailable = false;
 
 	return info;
 }
@@ -262,36 +354,38 @@ int RkISP1Frames::destroy(unsigned int frame)
 	if (!info)
 		return -ENOENT;
 
-	pipe_->availableParamBuffers_.push(info->paramBuffer);
-	pipe_->availableStatBuffers_.push(info->statBuffer);
+	if (info->paramBuffer)
+		pipe_->availableParamBuffers_.push_back(info->paramBuffer);
+	if (info->statBuffer)
+		pipe_->availableStatBuffers_.push_back(info->statBuffer);
 
-	frameInfo_.erase(info->frame);
-
-	delete info;
+	info->request = nullptr;
 
 	return 0;
 }
 
 void RkISP1Frames::clear()
 {
-	for (const auto &entry : frameInfo_) {
-		RkISP1FrameInfo *info = entry.second;
+	for (RkISP1FrameInfo &info : frameInfo_) {
+		if (!info.request)
+			continue;
 
-		pipe_->availableParamBuffers_.push(info->paramBuffer);
-		pipe_->availableStatBuffers_.push(info->statBuffer);
+		if (info.paramBuffer)
+			pipe_->availableParamBuffers_.push_back(info.paramBuffer);
+		if (info.statBuffer)
+			pipe_->availableStatBuffers_.push_back(info.statBuffer);
 
-		delete info;
+		info.request = nullptr;
 	}
-
-	frameInfo_.clear();
 }
 
 RkISP1FrameInfo *RkISP1Frames::find(unsigned int frame)
 {
-	auto itInfo = frameInfo_.find(frame);
-
-	if (itInfo != frameInfo_.end())
-		return itInfo->second;
+	if (!frameInfo_.empty()) {
+		RkISP1FrameInfo *info = &frameInfo_[frame % frameInfo_.size()];
+		if (info->request && info->frame == frame)
+			return info;
+	}
 
 	LOG(RkISP1, Fatal) << "Can't locate info from frame";
 
@@ -300,13 +394,17 @@ RkISP1FrameInfo *RkISP1Frames::find(unsigned int frame)
 
 RkISP1FrameInfo *RkISP1Frames::find(FrameBuffer *buffer)
 {
-	for (auto &itInfo : frameInfo_) {
-		RkISP1FrameInfo *info = itInfo.second;
+	for (RkISP1FrameInfo &slot : frameInfo_) {
+		RkISP1FrameInfo *info = &slot;
+
+		if (!info->request)
+			continue;
 
 		if (info->paramBuffer == buffer ||
 		    info->statBuffer == buffer ||
 		    info->mainPathBuffer == buffer ||
-		    info->selfPathBuffer == buffer)
+		    info->selfPathBuffer == buffer ||
+		    info->dewarpBuffer == buffer)
 			return info;
 	}
 
@@ -317,8 +415,8 @@ RkISP1FrameInfo *RkISP1Frames::find(FrameBuffer *buffer)
 
 RkISP1FrameInfo *RkISP1Frames::find(Request *request)
 {
-	for (auto &itInfo : frameInfo_) {
-		RkISP1FrameInfo *info = itInfo.second;
+	for (RkISP1FrameInfo &slot : frameInfo_) {
+		RkISP1FrameInfo *info = &slot;
 
 		if (info->request == request)
 			return info;
@@ -376,9 +474,79 @@ int RkISP1CameraData::loadIPA(unsigned int hwRevision)
 		return ret;
 	}
 
+	if (pipe()->dewarper_)
+		loadDewarpConfiguration(ipaTuningFile);
+
 	return 0;
 }
 
+/*
+ * The dewarper is used for the camera when the tuning file enables it with a
+ * top-level dewarp section:
+ *
+ * dewarp:
+ *   enable: true
+ */
+void RkISP1CameraData::loadDewarpConfiguration(const std::string &filename)
+{
+	File file(filename);
+	if (!file.open(File::OpenModeFlag::ReadOnly))
+		return;
+
+	std::unique_ptr<YamlObject> root = YamlParser::parse(file);
+	if (!root)
+		return;
+
+	const YamlObject &dewarp = (*root)["dewarp"];
+	if (!dewarp["enable"].get<bool>(false))
+		return;
+
+	dewarper_ = pipe()->dewarper_.get();
+
+	LOG(RkISP1, Debug) << "Using dewarper on the main path";
+}
+
+bool RkISP1CameraData::canDewarp(const StreamConfiguration &cfg) const
+{
+	if (!dewarper_)
+		return false;
+
+	if (PixelFormatInfo::info(cfg.pixelFormat).colourEncoding ==
+	    PixelFormatInfo::ColourEncodingRAW)
+		return false;
+
+	std::vector<PixelFormat> formats = dewarper_->formats(cfg.pixelFormat);
+	return std::find(formats.begin(), formats.end(), cfg.pixelFormat) != formats.end();
+}
+
+/*
+ * Convert a ScalerCrop rectangle, expressed in native sensor coordinates, to a
+ * crop rectangle on the dewarper input. The crop is limited to the area
+ * captured by the main path and to the maximum zoom factor.
+ */
+Rectangle RkISP1CameraData::dewarpCrop(const Rectangle &scalerCrop) const
+{
+	static constexpr unsigned int kMaxZoom = 8;
+
+	Rectangle crop = scalerCrop.translatedBy(-scalerMaxCrop_.topLeft());
+	crop.scaleBy(dewarpInputSize_, scalerMaxCrop_.size());
+
+	Size minSize{ dewarpInputSize_.width / kMaxZoom,
+		      dewarpInputSize_.height / kMaxZoom };
+	Size size = crop.size().expandedTo(minSize.alignedUpTo(2, 2));
+
+	return size.centeredTo(crop.center())
+		   .enclosedIn(Rectangle(dewarpInputSize_));
+}
+
+/* Convert a crop rectangle on the dewarper input to native sensor coordinates. */
+Rectangle RkISP1CameraData::scalerCrop(const Rectangle &dewarpCrop) const
+{
+	Rectangle crop = dewarpCrop.scaledBy(scalerMaxCrop_.size(), dewarpInputSize_);
+	crop.translateBy(scalerMaxCrop_.topLeft());
+	return crop;
+}
+
 void RkISP1CameraData::paramFilled(unsigned int frame)
 {
 	PipelineHandlerRkISP1 *pipe = RkISP1CameraData::pipe();
@@ -410,7 +578,7 @@ void RkISP1CameraData::metadataReady(unsigned int frame, const ControlList &meta
 	if (!info)
 		return;
 
-	info->request->metadata().merge(metadata);
+	pipe()->metadataAvailable(info->request, metadata);
 	info->metadataProcessed = true;
 
 	pipe()->tryCompleteRequest(info);
@@ -508,6 +676,10 @@ CameraConfiguration::Status RkISP1CameraConfiguration::validate()
 	 * the second stream first as the first stream is guaranteed to work
 	 * with whichever path is not used by the second one.
 	 */
+	std::vector<unsigned int> requestedStrides;
+	for (const StreamConfiguration &cfg : config_)
+		requestedStrides.push_back(cfg.stride);
+
 	std::vector<unsigned int> order(config_.size());
 	std::iota(order.begin(), order.end(), 0);
 	if (config_.size() == 2 && fitsAllPaths(config_[0]))
@@ -568,6 +740,27 @@ CameraConfiguration::Status RkISP1CameraConfiguration::validate()
 		return Invalid;
 	}
 
+	/*
+	 * When the main path is processed by the dewarper, the application
+	 * buffers are written by the dewarper. Report its stride and frame size.
+	 */
+	for (unsigned int i = 0; i < config_.size(); ++i) {
+		StreamConfiguration &cfg = config_[i];
+
+		if (cfg.stream() != &data_->mainPathStream_ ||
+		    !data_->canDewarp(cfg))
+			continue;
+
+		std::tie(cfg.stride, cfg.frameSize) =
+			data_->dewarper_->strideAndFrameSize(cfg.pixelFormat,
+							     cfg.size);
+		if (!cfg.stride)
+			return Invalid;
+
+		if (requestedStrides[i] && requestedStrides[i] != cfg.stride)
+			status = Adjusted;
+	}
+
 	/* Select the sensor format. */
 	PixelFormat rawFormat;
 	Size maxSize;
@@ -595,6 +788,11 @@ CameraConfiguration::Status RkISP1CameraConfiguration::validate()
 	if (sensorFormat_.size.isNull())
 		sensorFormat_.size = sensor->resolution();
 
+	if (internalBufferCount > kMaxInternalBuffers) {
+		internalBufferCount = kMaxInternalBuffers;
+		status = Adjusted;
+	}
+
 	return status;
 }
 
@@ -603,7 +801,8 @@ CameraConfiguration::Status RkISP1CameraConfiguration::validate()
  */
 
 PipelineHandlerRkISP1::PipelineHandlerRkISP1(CameraManager *manager)
-	: PipelineHandler(manager), hasSelfPath_(true)
+	: PipelineHandler(manager), hasSelfPath_(true), internalBufferCount_(0),
+	  useDewarper_(false), dewarpBufferCount_(0)
 {
 }
 
@@ -763,6 +962,23 @@ int PipelineHandlerRkISP1::configure(Camera *camera, CameraConfiguration *c)
 	if (!isRaw_)
 		format.mbus_code = MEDIA_BUS_FMT_YUYV8_2X8;
 
+	/*
+	 * Every request queued to the device consumes one parameters and one
+	 * statistics buffer. Allocate as many of them as the largest number of
+	 * stream buffers by default, and limit the number of requests in flight
+	 * accordingly.
+	 */
+	internalBufferCount_ = config->internalBufferCount;
+	if (!internalBufferCount_) {
+		for (const StreamConfiguration &cfg : *config)
+			internalBufferCount_ = std::max(internalBufferCount_,
+							cfg.bufferCount);
+	}
+
+	if (!isRaw_)
+		data->maxQueuedRequests_ = std::min(data->maxQueuedRequests_,
+						    internalBufferCount_);
+
 	LOG(RkISP1, Debug)
 		<< "Configuring ISP output pad with " << format
 		<< " crop " << rect;
@@ -781,10 +997,18 @@ int PipelineHandlerRkISP1::configure(Camera *camera, CameraConfiguration *c)
 		<< " crop " << rect;
 
 	std::map<unsigned int, IPAStream> streamConfig;
+	Size mainPathSize;
+
+	useDewarper_ = false;
 
 	for (const StreamConfiguration &cfg : *config) {
 		if (cfg.stream() == &data->mainPathStream_) {
-			ret = mainPath_.configure(cfg, format);
+			useDewarper_ = data->canDewarp(cfg);
+			if (useDewarper_)
+				ret = configureDewarper(data, cfg, format);
+			else
+				ret = mainPath_.configure(cfg, format);
+			mainPathSize = cfg.size;
 			streamConfig[0] = IPAStream(cfg.pixelFormat,
 						    cfg.size);
 		} else if (hasSelfPath_) {
@@ -799,15 +1023,7 @@ int PipelineHandlerRkISP1::configure(Camera *camera, CameraConfiguration *c)
 			return ret;
 	}
 
-	V4L2DeviceFormat paramFormat;
-	paramFormat.fourcc = V4L2PixelFormat(V4L2_META_FMT_RK_ISP1_PARAMS);
-	ret = param_->setFormat(&paramFormat);
-	if (ret)
-		return ret;
-
-	V4L2DeviceFormat statFormat;
-	statFormat.fourcc = V4L2PixelFormat(V4L2_META_FMT_RK_ISP1_STAT_3A);
-	ret = stat_->setFormat(&statFormat);
+	ret = setMetaFormats(camera);
 	if (ret)
 		return ret;
 
@@ -818,6 +1034,9 @@ int PipelineHandlerRkISP1::configure(Camera *camera, CameraConfiguration *c)
 	if (ret)
 		return ret;
 
+	data->lineDuration_ = ipaConfig.sensorInfo.minLineLength * 1.0s
+			    / ipaConfig.sensorInfo.pixelRate;
+
 	ipaConfig.sensorControls = data->sensor_->controls();
 
 	ret = data->ipa_->configure(ipaConfig, streamConfig, &data->controlInfo_);
@@ -825,6 +1044,75 @@ int PipelineHandlerRkISP1::configure(Camera *camera, CameraConfiguration *c)
 		LOG(RkISP1, Error) << "failed configuring IPA (" << ret << ")";
 		return ret;
 	}
+
+	if (!useDewarper_)
+		return 0;
+
+	/*
+	 * Compute the area of the sensor pixel array captured by the main path,
+	 * as cropped by the resizer, to express the dewarper crop as a
+	 * ScalerCrop in native sensor coordinates.
+	 */
+	const IPACameraSensorInfo &sensorInfo = ipaConfig.sensorInfo;
+	Rectangle mainPathCrop = format.size.boundedToAspectRatio(mainPathSize)
+					    .alignedUpTo(2, 2)
+					    .centeredTo(Rectangle(format.size).center());
+	mainPathCrop.scaleBy(sensorInfo.analogCrop.size(), sensorInfo.outputSize);
+	mainPathCrop.translateBy(sensorInfo.analogCrop.topLeft());
+
+	data->scalerMaxCrop_ = mainPathCrop;
+	data->dewarpInputSize_ = mainPathSize;
+	data->dewarpCrop_ = Rectangle(mainPathSize);
+
+	ControlInfoMap::Map ctrlMap;
+	for (const auto &[id, ctrlInfo] : data->controlInfo_)
+		ctrlMap.emplace(id, ctrlInfo);
+
+	ctrlMap[&controls::ScalerCrop] =
+		ControlInfo(data->scalerCrop(data->dewarpCrop(Rectangle{})),
+			    data->scalerMaxCrop_, data->scalerMaxCrop_);
+
+	data->controlInfo_ = ControlInfoMap(std::move(ctrlMap),
+					    data->controlInfo_.idmap());
+
+	return 0;
+}
+
+/*
+ * Configure the main path to capture to internal buffers with the stream format
+ * and size, and the dewarper to process them to the stream buffers.
+ */
+int PipelineHandlerRkISP1::configureDewarper(RkISP1CameraData *data,
+					     const StreamConfiguration &cfg,
+					     const V4L2SubdeviceFormat &format)
+{
+	/*
+	 * Every request in flight holds a main path buffer until the dewarper
+	 * has processed it.
+	 */
+	StreamConfiguration inputCfg = cfg;
+	inputCfg.stride = 0;
+	inputCfg.bufferCount = std::max(cfg.bufferCount, internalBufferCount_);
+
+	if (mainPath_.validate(data->sensor_.get(), &inputCfg) ==
+	    CameraConfiguration::Invalid)
+		return -EINVAL;
+
+	int ret = mainPath_.configure(inputCfg, format);
+	if (ret)
+		return ret;
+
+	StreamConfiguration outputCfg = cfg;
+	std::vector<std::reference_wrapper<StreamConfiguration>> outputCfgs{ outputCfg };
+
+	ret = dewarper_->configure(inputCfg, outputCfgs);
+	if (ret) {
+		LOG(RkISP1, Error) << "Failed to configure dewarper";
+		return ret;
+	}
+
+	dewarpBufferCount_ = inputCfg.bufferCount;
+
 	return 0;
 }
 
@@ -834,31 +1122,66 @@ int PipelineHandlerRkISP1::exportFrameBuffers([[maybe_unused]] Camera *camera, S
 	RkISP1CameraData *data = cameraData(camera);
 	unsigned int count = stream->configuration().bufferCount;
 
-	if (stream == &data->mainPathStream_)
+	if (stream == &data->mainPathStream_) {
+		if (useDewarper_)
+			return dewarper_->exportBuffers(0, count, buffers);
+
 		return mainPath_.exportBuffers(count, buffers);
+	}
 	else if (hasSelfPath_ && stream == &data->selfPathStream_)
 		return selfPath_.exportBuffers(count, buffers);
 
 	return -EINVAL;
 }
 
+/*
+ * The parameters and statistics buffers are kept allocated across capture
+ * sessions, and V4L2 rejects format changes while buffers are allocated. Only
+ * set the formats of the parameters and statistics video nodes when they
+ * differ from the current ones, after freeing the buffers.
+ */
+int PipelineHandlerRkISP1::setMetaFormats(Camera *camera)
+{
+	const V4L2PixelFormat paramFourcc(V4L2_META_FMT_RK_ISP1_PARAMS);
+	const V4L2PixelFormat statFourcc(V4L2_META_FMT_RK_ISP1_STAT_3A);
+	int ret;
+
+	if (!paramBuffers_.empty() || !statBuffers_.empty()) {
+		V4L2DeviceFormat paramFormat;
+		V4L2DeviceFormat statFormat;
+
+		if (!param_->getFormat(&paramFormat) &&
+		    paramFormat.fourcc == paramFourcc &&
+		    !stat_->getFormat(&statFormat) &&
+		    statFormat.fourcc == statFourcc)
+			return 0;
+
+		freeBuffers(camera);
+	}
+
+	V4L2DeviceFormat paramFormat;
+	paramFormat.fourcc = paramFourcc;
+	ret = param_->setFormat(&paramFormat);
+	if (ret)
+		return ret;
+
+	V4L2DeviceFormat statFormat;
+	statFormat.fourcc = statFourcc;
+	return stat_->setFormat(&statFormat);
+}
+
 int PipelineHandlerRkISP1::allocateBuffers(Camera *camera)
 {
 	RkISP1CameraData *data = cameraData(camera);
 	unsigned int ipaBufferId = 1;
 	int ret;
 
-	unsigned int maxCount = std::max({
-		data->mainPathStream_.configuration().bufferCount,
-		data->selfPathStream_.configuration().bufferCount,
-	});
-
 	if (!isRaw_) {
-		ret = param_->allocateBuffers(maxCount, &paramBuffers_);
+		ret = param_->allocateBuffers(internalBufferCount_, &paramBuffers_);
 		if (ret < 0)
 			goto error;
 
-		ret = stat_->allocateBuffers(maxCount, &statBuffers_);
+		ret = stat_->allocateBuffers(internalBufferCount_, &statBuffers_);
 		if (ret < 0)
 			goto error;
 	}
@@ -867,21 +1190,31 @@ int PipelineHandlerRkISP1::allocateBuffers(Camera *camera)
 		buffer->setCookie(ipaBufferId++);
 		data->ipaBuffers_.emplace_back(buffer->cookie(),
 					       buffer->planes());
-		availableParamBuffers_.push(buffer.get());
+		availableParamBuffers_.push_back(buffer.get());
 	}
 
 	for (std::unique_ptr<FrameBuffer> &buffer : statBuffers_) {
 		buffer->setCookie(ipaBufferId++);
 		data->ipaBuffers_.emplace_back(buffer->cookie(),
 					       buffer->planes());
-		availableStatBuffers_.push(buffer.get());
+		availableStatBuffers_.push_back(buffer.get());
 	}
 
-	data->ipa_->mapBuffers(data->ipaBuffers_);
+	/*
+	 * Don't wait for the IPA to map the buffers, the dewarper buffers can
+	 * be allocated in the meantime. The IPA processes calls in order, the
+	 * buffers are thus mapped by the time it handles start().
+	 */
+	ret = data->ipa_->mapBuffersAsync(data->ipaBuffers_, nullptr);
+	if (ret < 0)
+		goto error;
 
 	return 0;
 
 error:
+	data->ipaBuffers_.clear();
+	availableStatBuffers_.clear();
+	availableParamBuffers_.clear();
 	paramBuffers_.clear();
 	statBuffers_.clear();
 
@@ -892,11 +1225,8 @@ int PipelineHandlerRkISP1::freeBuffers(Camera *camera)
 {
 	RkISP1CameraData *data = cameraData(camera);
 
-	while (!availableStatBuffers_.empty())
-		availableStatBuffers_.pop();
-
-	while (!availableParamBuffers_.empty())
-		availableParamBuffers_.pop();
+	availableStatBuffers_.clear();
+	availableParamBuffers_.clear();
 
 	paramBuffers_.clear();
 	statBuffers_.clear();
@@ -914,18 +1244,60 @@ int PipelineHandlerRkISP1::freeBuffers(Camera *camera)
 	if (stat_->releaseBuffers())
 		LOG(RkISP1, Error) << "Failed to release stat buffers";
 
+	freeDewarpBuffers();
+
 	return 0;
 }
 
+/*
+ * The main path buffers processed by the dewarper depend on the stream format,
+ * they are allocated for each capture session.
+ */
+int PipelineHandlerRkISP1::allocateDewarpBuffers()
+{
+	int ret = mainPath_.exportBuffers(dewarpBufferCount_, &mainPathBuffers_);
+	if (ret < 0)
+		return ret;
+
+	for (std::unique_ptr<FrameBuffer> &buffer : mainPathBuffers_)
+		availableMainPathBuffers_.push_back(buffer.get());
+
+	return 0;
+}
+
+void PipelineHandlerRkISP1::freeDewarpBuffers()
+{
+	availableMainPathBuffers_.clear();
+	mainPathBuffers_.clear();
+}
+
 int PipelineHandlerRkISP1::start(Camera *camera, [[maybe_unused]] const ControlList *controls)
 {
 	RkISP1CameraData *data = cameraData(camera);
 	int ret;
 
-	/* Allocate buffers for internal pipeline usage. */
-	ret = allocateBuffers(camera);
-	if (ret)
-		return ret;
+	/*
+	 * Allocate buffers for internal pipeline usage. The parameters and
+	 * statistics buffers don't depend on the stream formats, keep them
+	 * across capture sessions to speed up switching between
+	 * configurations, and only reallocate them when their number changes.
+	 */
+	unsigned int internalBufferCount = isRaw_ ? 0 : internalBufferCount_;
+	if (paramBuffers_.size() != internalBufferCount) {
+		freeBuffers(camera);
+
+		ret = allocateBuffers(camera);
+		if (ret)
+			return ret;
+	}
+
+	if (useDewarper_) {
+		ret = allocateDewarpBuffers();
+		if (ret) {
+			freeBuffers(camera);
+			return ret;
+		}
+	}
 
 	ret = data->ipa_->start();
 	if (ret) {
@@ -936,35 +1308,48 @@ int PipelineHandlerRkISP1::start(Camera *camera, [[maybe_unused]] const ControlL
 	}
 
 	data->frame_ = 0;
+	data->nextFrame_ = 0;
+	data->frameInfo_.init(data->maxQueuedRequests_);
 
 	if (!isRaw_) {
-		ret = param_->streamOn();
+		/* The parameters and statistics devices are independent. */
+		std::array<V4L2VideoDevice *, 2> devices = {
+			param_.get(), stat_.get(),
+		};
+
+		ret = V4L2VideoDevice::streamOn(devices);
 		if (ret) {
+			V4L2VideoDevice::streamOff(devices);
 			data->ipa_->stop();
 			freeBuffers(camera);
 			LOG(RkISP1, Error)
-				<< "Failed to start parameters " << camera->id();
+				<< "Failed to start parameters and statistics "
+				<< camera->id();
 			return ret;
 		}
+	}
 
-		ret = stat_->streamOn();
+	if (data->mainPath_->isEnabled()) {
+		ret = mainPath_.start();
 		if (ret) {
 			param_->streamOff();
+			stat_->streamOff();
 			data->ipa_->stop();
 			freeBuffers(camera);
-			LOG(RkISP1, Error)
-				<< "Failed to start statistics " << camera->id();
 			return ret;
 		}
 	}
 
-	if (data->mainPath_->isEnabled()) {
-		ret = mainPath_.start();
+	if (useDewarper_) {
+		ret = dewarper_->start();
 		if (ret) {
+			mainPath_.stop();
 			param_->streamOff();
 			stat_->streamOff();
 			data->ipa_->stop();
 			freeBuffers(camera);
+			LOG(RkISP1, Error)
+				<< "Failed to start dewarper " << camera->id();
 			return ret;
 		}
 	}
@@ -972,6 +1357,8 @@ int PipelineHandlerRkISP1::start(Camera *camera, [[maybe_unused]] const ControlL
 	if (hasSelfPath_ && data->selfPath_->isEnabled()) {
 		ret = selfPath_.start();
 		if (ret) {
+			if (useDewarper_)
+				dewarper_->stop();
 			mainPath_.stop();
 			param_->streamOff();
 			stat_->streamOff();
@@ -1000,6 +1387,13 @@ void PipelineHandlerRkISP1::stopDevice(Camera *camera)
 		selfPath_.stop();
 	mainPath_.stop();
 
+	/*
+	 * Stop the dewarper after the main path, to process or cancel the jobs
+	 * for the buffers completed by the main path.
+	 */
+	if (useDewarper_)
+		dewarper_->stop();
+
 	if (!isRaw_) {
 		ret = stat_->streamOff();
 		if (ret)
@@ -1015,11 +1409,16 @@ void PipelineHandlerRkISP1::stopDevice(Camera *camera)
 	ASSERT(data->queuedRequests_.empty());
 	data->frameInfo_.clear();
 
-	freeBuffers(camera);
+	freeDewarpBuffers();
 
 	activeCamera_ = nullptr;
 }
 
+void PipelineHandlerRkISP1::releaseDevice(Camera *camera)
+{
+	freeBuffers(camera);
+}
+
 int PipelineHandlerRkISP1::queueRequestDevice(Camera *camera, Request *request)
 {
 	RkISP1CameraData *data = cameraData(camera);
@@ -1028,6 +1427,12 @@ int PipelineHandlerRkISP1::queueRequestDevice(Camera *camera, Request *request)
 	if (!info)
 		return -ENOENT;
 
+	if (info->dewarpBuffer) {
+		const auto &scalerCrop = request->controls().get(controls::ScalerCrop);
+		if (scalerCrop)
+			info->dewarpCrop = data->dewarpCrop(*scalerCrop);
+	}
+
 	data->ipa_->queueRequest(data->frame_, request->controls());
 	if (isRaw_) {
 		if (info->mainPathBuffer)
@@ -1054,11 +1459,7 @@ int PipelineHandlerRkISP1::initLinks(Camera *camera,
 				     const RkISP1CameraConfiguration &config)
 {
 	RkISP1CameraData *data = cameraData(camera);
-	int ret;
-
-	ret = media_->disableLinks();
-	if (ret < 0)
-		return ret;
+	std::vector<MediaLink *> links;
 
 	/*
 	 * Configure the sensor links: enable the link corresponding to this
@@ -1073,27 +1474,31 @@ int PipelineHandlerRkISP1::initLinks(Camera *camera,
 			<< link->source()->entity()->name()
 			<< "' to ISP";
 
-		ret = link->setEnabled(true);
-		if (ret < 0)
-			return ret;
+		links.push_back(link);
 	}
 
-	if (csi_) {
-		MediaLink *link = isp_->entity()->getPadByIndex(0)->links().at(0);
-
-		ret = link->setEnabled(true);
-		if (ret < 0)
-			return ret;
-	}
+	if (csi_)
+		links.push_back(isp_->entity()->getPadByIndex(0)->links().at(0));
 
 	for (const StreamConfiguration &cfg : config) {
 		if (cfg.stream() == &data->mainPathStream_)
-			ret = data->mainPath_->setEnabled(true);
+			links.push_back(data->mainPath_->link());
 		else if (hasSelfPath_ && cfg.stream() == &data->selfPathStream_)
-			ret = data->selfPath_->setEnabled(true);
+			links.push_back(data->selfPath_->link());
 		else
 			return -EINVAL;
+	}
 
+	/*
+	 * Disable all other links first, and then enable the links we need.
+	 * Links already in the right state are left untouched.
+	 */
+	int ret = media_->disableLinks(links);
+	if (ret < 0)
+		return ret;
+
+	for (MediaLink *link : links) {
+		ret = link->setEnabled(true);
 		if (ret < 0)
 			return ret;
 	}
@@ -1172,6 +1577,19 @@ bool PipelineHandlerRkISP1::match(DeviceEnumerator *enumerator)
 
 	hasSelfPath_ = !!media_->getEntityByName("rkisp1_selfpath");
 
+	/* Locate the optional dewarper, used to post-process the main path. */
+	DeviceMatch dwp("dw100");
+	MediaDevice *dwpMedia = acquireMediaDevice(enumerator, dwp);
+	if (dwpMedia) {
+		dewarper_ = ConverterFactoryBase::create(dwpMedia);
+		if (dewarper_) {
+			dewarper_->inputBufferReady.connect(this, &PipelineHandlerRkISP1::dewarpInputReady);
+			dewarper_->outputBufferReady.connect(this, &PipelineHandlerRkISP1::dewarpOutputReady);
+		} else {
+			LOG(RkISP1, Warning) << "Failed to create dewarper";
+		}
+	}
+
 	/* Create the V4L2 subdevices we will need. */
 	isp_ = V4L2Subdevice::fromEntityName(media_, "rkisp1_isp");
 	if (isp_->open() < 0)
@@ -1214,6 +1632,7 @@ bool PipelineHandlerRkISP1::match(DeviceEnumerator *enumerator)
 		selfPath_.bufferReady().connect(this, &PipelineHandlerRkISP1::bufferReady);
 	stat_->bufferReady.connect(this, &PipelineHandlerRkISP1::statReady);
 	param_->bufferReady.connect(this, &PipelineHandlerRkISP1::paramReady);
+	isp_->frameStart.connect(this, &PipelineHandlerRkISP1::frameStart);
 
 	/*
 	 * Enumerate all sensors connected to the ISP and create one
@@ -1261,21 +1680,45 @@ void PipelineHandlerRkISP1::bufferReady(FrameBuffer *buffer)
 		return;
 
 	const FrameMetadata &metadata = buffer->metadata();
-	Request *request = buffer->request();
+	Request *request = info->request;
 
 	if (metadata.status != FrameMetadata::FrameCancelled) {
+		const ControlList &ctrls =
+			data->delayedCtrls_->get(metadata.sequence);
+
 		/*
-		 * Record the sensor's timestamp in the request metadata.
+		 * Report the metadata known from the sensor as soon as the
+		 * first buffer of the request completes, without waiting for
+		 * the IPA to process the statistics.
 		 *
 		 * \todo The sensor timestamp should be better estimated by connecting
 		 * to the V4L2Device::frameStart signal.
 		 */
-		request->metadata().set(controls::SensorTimestamp,
-					metadata.timestamp);
+		if (!info->sensorMetadataAvailable) {
+			ControlList sensorMetadata(controls::controls);
+
+			sensorMetadata.set(controls::SensorTimestamp,
+					   metadata.timestamp);
+
+			if (ctrls.contains(V4L2_CID_EXPOSURE)) {
+				int32_t exposure = ctrls.get(V4L2_CID_EXPOSURE).get<int32_t>();
+				utils::Duration exposureTime = exposure * data->lineDuration_;
+				sensorMetadata.set(controls::ExposureTime,
+						   exposureTime.get<std::micro>());
+			}
+
+			metadataAvailable(request, sensorMetadata);
+			info->sensorMetadataAvailable = true;
+		}
 
 		if (isRaw_) {
-			const ControlList &ctrls =
-				data->delayedCtrls_->get(metadata.sequence);
+			/*
+			 * Without the ISP, frame drops are detected on the
+			 * main path, which captures the raw frames.
+			 */
+			if (buffer == info->mainPathBuffer)
+				framesDropped(activeCamera_, mainPath_.lastFrameDrops());
+
 			data->ipa_->processStatsBuffer(info->frame, 0, ctrls);
 		}
 	} else {
@@ -1283,10 +1726,68 @@ void PipelineHandlerRkISP1::bufferReady(FrameBuffer *buffer)
 			info->metadataProcessed = true;
 	}
 
+	if (info->dewarpBuffer && buffer == info->mainPathBuffer) {
+		if (metadata.status != FrameMetadata::FrameCancelled)
+			dewarpBuffer(data, info, buffer);
+		else
+			cancelDewarpBuffer(info, buffer);
+
+		return;
+	}
+
 	completeBuffer(request, buffer);
 	tryCompleteRequest(info);
 }
 
+void PipelineHandlerRkISP1::dewarpBuffer(RkISP1CameraData *data,
+					 RkISP1FrameInfo *info,
+					 FrameBuffer *buffer)
+{
+	if (info->dewarpCrop && *info->dewarpCrop != data->dewarpCrop_) {
+		Rectangle crop = *info->dewarpCrop;
+		if (!dewarper_->setInputCrop(0, &crop))
+			data->dewarpCrop_ = crop;
+	}
+
+	ControlList metadata(controls::controls);
+	metadata.set(controls::ScalerCrop, data->scalerCrop(data->dewarpCrop_));
+	metadataAvailable(info->request, metadata);
+
+	int ret = dewarper_->queueBuffers(buffer, { { 0, info->dewarpBuffer } });
+	if (ret < 0) {
+		LOG(RkISP1, Error) << "Failed to queue buffer to the dewarper";
+		cancelDewarpBuffer(info, buffer);
+	}
+}
+
+void PipelineHandlerRkISP1::cancelDewarpBuffer(RkISP1FrameInfo *info,
+					       FrameBuffer *buffer)
+{
+	availableMainPathBuffers_.push_back(buffer);
+
+	info->dewarpBuffer->_d()->cancel();
+	completeBuffer(info->request, info->dewarpBuffer);
+	tryCompleteRequest(info);
+}
+
+void PipelineHandlerRkISP1::dewarpInputReady(FrameBuffer *buffer)
+{
+	availableMainPathBuffers_.push_back(buffer);
+}
+
+void PipelineHandlerRkISP1::dewarpOutputReady(FrameBuffer *buffer)
+{
+	ASSERT(activeCamera_);
+	RkISP1CameraData *data = cameraData(activeCamera_);
+
+	RkISP1FrameInfo *info = data->frameInfo_.find(buffer);
+	if (!info)
+		return;
+
+	completeBuffer(info->request, buffer);
+	tryCompleteRequest(info);
+}
+
 void PipelineHandlerRkISP1::paramReady(FrameBuffer *buffer)
 {
 	ASSERT(activeCamera_);
@@ -1318,10 +1819,24 @@ void PipelineHandlerRkISP1::statReady(FrameBuffer *buffer)
 	if (data->frame_ <= buffer->metadata().sequence)
 		data->frame_ = buffer->metadata().sequence + 1;
 
+	/*
+	 * The ISP produces statistics for every frame it processes, detect
+	 * frame drops on the statistics video device.
+	 */
+	framesDropped(activeCamera_, stat_->lastFrameDrops());
+
 	data->ipa_->processStatsBuffer(info->frame, info->statBuffer->cookie(),
 				       data->delayedCtrls_->get(buffer->metadata().sequence));
 }
 
+void PipelineHandlerRkISP1::frameStart(uint32_t sequence)
+{
+	if (!activeCamera_)
+		return;
+
+	frameStarted(activeCamera_, sequence);
+}
+
 REGISTER_PIPELINE_HANDLER(PipelineHandlerRkISP1)
 
 } /* namespace libcamera */
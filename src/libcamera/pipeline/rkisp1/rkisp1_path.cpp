@@ -7,6 +7,8 @@
 
 #include "rkisp1_path.h"
 
+#include <algorithm>
+
 #include <linux/media-bus-format.h>
 
 #include <libcamera/formats.h>
@@ -56,7 +58,8 @@ const std::map<PixelFormat, uint32_t> formatToMediaBus = {
 
 RkISP1Path::RkISP1Path(const char *name, const Span<const PixelFormat> &formats,
 		       const Size &minResolution, const Size &maxResolution)
-	: name_(name), running_(false), formats_(formats),
+	: name_(name), running_(false), bufferCount_(RKISP1_BUFFER_COUNT),
+	  formats_(formats),
 	  minResolution_(minResolution), maxResolution_(maxResolution),
 	  link_(nullptr)
 {
@@ -301,11 +304,29 @@ CameraConfiguration::Status RkISP1Path::validate(const CameraSensor *sensor,
 
 	cfg->size.boundTo(maxResolution);
 	cfg->size.expandTo(minResolution);
-	cfg->bufferCount = RKISP1_BUFFER_COUNT;
 
+	/*
+	 * Buffers imported from other devices (such as video encoders or
+	 * displays) are typically allocated from pools larger than the default
+	 * buffer count. Accept larger counts to size the V4L2 buffer cache
+	 * accordingly and avoid remapping the dmabufs at every frame.
+	 */
+	cfg->bufferCount = std::clamp(cfg->bufferCount, RKISP1_BUFFER_COUNT,
+				      RKISP1_MAX_BUFFER_COUNT);
+
+	/*
+	 * Pass the stride requested by the application, if any, to the driver.
+	 * This allows importing buffers whose layout is dictated by another
+	 * device. The driver rounds the stride up to the minimum value and
+	 * ignores it when the video node doesn't support custom strides, in
+	 * which case the configuration is adjusted.
+	 */
+	const PixelFormatInfo &info = PixelFormatInfo::info(cfg->pixelFormat);
 	V4L2DeviceFormat format;
 	format.fourcc = video_->toV4L2PixelFormat(cfg->pixelFormat);
 	format.size = cfg->size;
+	format.planesCount = info.numPlanes();
+	format.planes[0].bpl = cfg->stride;
 
 	int ret = video_->tryFormat(&format);
 	if (ret)
@@ -314,6 +335,13 @@ CameraConfiguration::Status RkISP1Path::validate(const CameraSensor *sensor,
 	cfg->stride = format.planes[0].bpl;
 	cfg->frameSize = format.planes[0].size;
 
+	if (reqCfg.stride && cfg->stride != reqCfg.stride) {
+		LOG(RkISP1, Debug)
+			<< "Adjusting " << name_ << " stride from "
+			<< reqCfg.stride << " to " << cfg->stride;
+		status = CameraConfiguration::Adjusted;
+	}
+
 	if (cfg->pixelFormat != reqCfg.pixelFormat || cfg->size != reqCfg.size) {
 		LOG(RkISP1, Debug)
 			<< "Adjusting format from " << reqCfg.toString()
@@ -380,18 +408,23 @@ int RkISP1Path::configure(const StreamConfiguration &config,
 	outputFormat.fourcc = video_->toV4L2PixelFormat(config.pixelFormat);
 	outputFormat.size = config.size;
 	outputFormat.planesCount = info.numPlanes();
+	outputFormat.planes[0].bpl = config.stride;
 
 	ret = video_->setFormat(&outputFormat);
 	if (ret)
 		return ret;
 
 	if (outputFormat.size != config.size ||
-	    outputFormat.fourcc != video_->toV4L2PixelFormat(config.pixelFormat)) {
+	    outputFormat.fourcc != video_->toV4L2PixelFormat(config.pixelFormat) ||
+	    (config.stride && outputFormat.planes[0].bpl != config.stride)) {
 		LOG(RkISP1, Error)
-			<< "Unable to configure capture in " << config.toString();
+			<< "Unable to configure capture in " << config.toString()
+			<< " with stride " << config.stride;
 		return -EINVAL;
 	}
 
+	bufferCount_ = config.bufferCount;
+
 	return 0;
 }
 
@@ -402,8 +435,7 @@ int RkISP1Path::start()
 	if (running_)
 		return -EBUSY;
 
-	/* \todo Make buffer count user configurable. */
-	ret = video_->importBuffers(RKISP1_BUFFER_COUNT);
+	ret = video_->importBuffers(bufferCount_);
 	if (ret)
 		return ret;
 
@@ -37,6 +37,7 @@ public:
 
 	bool init(MediaDevice *media);
 
+	MediaLink *link() const { return link_; }
 	int setEnabled(bool enable) { return link_->setEnabled(enable); }
 	bool isEnabled() const { return link_->flags() & MEDIA_LNK_FL_ENABLED; }
 
@@ -60,14 +61,17 @@ public:
 
 	int queueBuffer(FrameBuffer *buffer) { return video_->queueBuffer(buffer); }
 	Signal<FrameBuffer *> &bufferReady() { return video_->bufferReady; }
+	unsigned int lastFrameDrops() const { return video_->lastFrameDrops(); }
 
 private:
 	void populateFormats();
 
 	static constexpr unsigned int RKISP1_BUFFER_COUNT = 4;
+	static constexpr unsigned int RKISP1_MAX_BUFFER_COUNT = 16;
 
 	const char *name_;
 	bool running_;
+	unsigned int bufferCount_;
 
 	const Span<const PixelFormat> formats_;
 	std::set<PixelFormat> streamFormats_;
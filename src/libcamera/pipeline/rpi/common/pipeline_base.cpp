@@ -7,7 +7,11 @@
 
 #include "pipeline_base.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <set>
+#include <vector>
 
 #include <linux/media-bus-format.h>
 #include <linux/videodev2.h>
@@ -21,6 +25,7 @@
 
 #include "libcamera/internal/camera_lens.h"
 #include "libcamera/internal/ipa_manager.h"
+#include "libcamera/internal/thread_pool.h"
 #include "libcamera/internal/v4l2_subdevice.h"
 
 using namespace std::chrono_literals;
@@ -37,6 +42,17 @@ namespace {
 
 constexpr unsigned int defaultRawBitDepth = 12;
 
+/*
+ * Frontend buffer count tuning: ignore the first frames after starting, and
+ * require enough frames to have a meaningful measurement. The hold time peaks
+ * are forgotten after one to two windows of frames.
+ */
+constexpr unsigned int kFrontendLatencyWarmupFrames = 10;
+constexpr unsigned int kFrontendLatencyMinFrames = 30;
+constexpr unsigned int kFrontendLatencyWindowFrames = 300;
+constexpr unsigned int kMinFrontendBuffers = 2;
+constexpr unsigned int kMaxFrontendBuffers = 16;
+
 PixelFormat mbusCodeToPixelFormat(unsigned int mbus_code,
 				  BayerFormat::Packing packingReq)
 {
@@ -60,6 +76,20 @@ PixelFormat mbusCodeToPixelFormat(unsigned int mbus_code,
 	return pix;
 }
 
+/*
+ * Return the compressed raw format matching a sensor media bus code, or an
+ * invalid format if the code has no compressed equivalent.
+ */
+PixelFormat mbusCodeToCompressedFormat(unsigned int mbus_code)
+{
+	BayerFormat bayer = BayerFormat::fromMbusCode(mbus_code);
+
+	bayer.bitDepth = 16;
+	bayer.packing = BayerFormat::Packing::PISP1;
+
+	return bayer.toPixelFormat();
+}
+
 bool isMonoSensor(std::unique_ptr<CameraSensor> &sensor)
 {
 	unsigned int mbusCode = sensor->mbusCodes()[0];
@@ -300,6 +330,12 @@ CameraConfiguration::Status RPiCameraConfiguration::validate()
 			status = Adjusted;
 	}
 
+	/* The internal buffer count sizes the frontend raw buffer pool. */
+	if (internalBufferCount > kMaxFrontendBuffers) {
+		internalBufferCount = kMaxFrontendBuffers;
+		status = Adjusted;
+	}
+
 	return status;
 }
 
@@ -466,6 +502,15 @@ PipelineHandlerBase::generateConfiguration(Camera *camera, Span<const StreamRole
 
 		std::map<PixelFormat, std::vector<SizeRange>> deviceFormats;
 		if (role == StreamRole::Raw) {
+			/*
+			 * Compressed raw formats are listed when the frontend
+			 * supports them. They store any sensor bit depth in 8
+			 * bits per pixel.
+			 */
+			std::set<PixelFormat> frontendFormats;
+			for (const auto &format : data->rawFormats())
+				frontendFormats.insert(format.first.toPixelFormat());
+
 			/* Translate the MBUS codes to a PixelFormat. */
 			for (const auto &format : data->sensorFormats_) {
 				PixelFormat pf = mbusCodeToPixelFormat(format.first,
@@ -473,6 +518,16 @@ PipelineHandlerBase::generateConfiguration(Camera *camera, Span<const StreamRole
 				if (pf.isValid())
 					deviceFormats.emplace(std::piecewise_construct, std::forward_as_tuple(pf),
 							      std::forward_as_tuple(format.second.begin(), format.second.end()));
+
+				pf = mbusCodeToCompressedFormat(format.first);
+				if (!pf.isValid() || !frontendFormats.count(pf))
+					continue;
+
+				std::vector<SizeRange> &sizes = deviceFormats[pf];
+				for (const Size &sz : format.second) {
+					if (std::find(sizes.begin(), sizes.end(), SizeRange(sz)) == sizes.end())
+						sizes.emplace_back(sz);
+				}
 			}
 		} else {
 			/*
@@ -512,6 +567,8 @@ int PipelineHandlerBase::configure(Camera *camera, CameraConfiguration *config)
 
 	/* Start by freeing all buffers and reset the stream states. */
 	data->freeBuffers();
+	data->resetFrontendLatency();
+	data->internalBufferCount_ = config->internalBufferCount;
 	for (auto const stream : data->streams_)
 		stream->clearFlags(StreamFlag::External);
 
@@ -656,6 +713,13 @@ int PipelineHandlerBase::start(Camera *camera, const ControlList *controls)
 	for (auto const stream : data->streams_)
 		stream->resetBuffers();
 
+	/*
+	 * Reallocate the internal buffers if the measured hold time of the
+	 * frontend buffers calls for a different number of buffers.
+	 */
+	if (data->buffersAllocated_ && data->frontendBuffersChanged())
+		data->freeBuffers();
+
 	if (!data->buffersAllocated_) {
 		/* Allocate buffers for internal pipeline usage. */
 		ret = prepareBuffers(camera);
@@ -681,6 +745,10 @@ int PipelineHandlerBase::start(Camera *camera, const ControlList *controls)
 	 * the IPA.
 	 */
 	data->delayedCtrls_->reset(0);
+	if (data->lensDelayedCtrls_) {
+		data->lensDelayedCtrls_->reset(0);
+		data->pendingLensCtrls_.reset();
+	}
 	data->state_ = CameraData::State::Idle;
 
 	/* Enable SOF event generation. */
@@ -707,8 +775,11 @@ void PipelineHandlerBase::stopDevice(Camera *camera)
 	data->state_ = CameraData::State::Stopped;
 	data->platformStop();
 
+	/* Stop all video devices concurrently to minimize the stop latency. */
+	std::vector<V4L2VideoDevice *> devices;
 	for (auto const stream : data->streams_)
-		stream->dev()->streamOff();
+		devices.push_back(stream->dev());
+	V4L2VideoDevice::streamOff(devices);
 
 	/* Disable SOF event generation. */
 	data->frontendDevice()->setFrameStartEnabled(false);
@@ -767,7 +838,7 @@ int PipelineHandlerBase::queueRequestDevice(Camera *camera, Request *request)
 	}
 
 	/* Push the request to the back of the queue. */
-	data->requestQueue_.push(request);
+	data->requestQueue_.push_back(request);
 	data->handleState();
 
 	return 0;
@@ -809,15 +880,27 @@ int PipelineHandlerBase::registerCamera(std::unique_ptr<RPi::CameraData> &camera
 	 * Setup our delayed control writer with the sensor default
 	 * gain and exposure delays. Mark VBLANK for priority write.
 	 */
-	std::unordered_map<uint32_t, RPi::DelayedControls::ControlParams> params = {
+	std::unordered_map<uint32_t, DelayedControls::ControlParams> params = {
 		{ V4L2_CID_ANALOGUE_GAIN, { result.sensorConfig.gainDelay, false } },
 		{ V4L2_CID_EXPOSURE, { result.sensorConfig.exposureDelay, false } },
 		{ V4L2_CID_HBLANK, { result.sensorConfig.hblankDelay, false } },
 		{ V4L2_CID_VBLANK, { result.sensorConfig.vblankDelay, true } }
 	};
-	data->delayedCtrls_ = std::make_unique<RPi::DelayedControls>(data->sensor_->device(), params);
+	data->delayedCtrls_ = std::make_unique<DelayedControls>(data->sensor_->device(), params);
 	data->sensorMetadata_ = result.sensorConfig.sensorMetadata;
 
+	/*
+	 * Synchronise lens movements with the sensor frame timing, using the
+	 * lens delay reported by the IPA for this camera module.
+	 */
+	CameraLens *lens = data->sensor_->focusLens();
+	if (lens) {
+		std::unordered_map<uint32_t, DelayedControls::ControlParams> lensParams = {
+			{ V4L2_CID_FOCUS_ABSOLUTE, { result.sensorConfig.lensDelay, false } }
+		};
+		data->lensDelayedCtrls_ = std::make_unique<DelayedControls>(lens->device(), lensParams);
+	}
+
 	/* Register initial controls that the Raspberry Pi IPA can handle. */
 	data->controlInfo_ = std::move(result.controlInfo);
 
@@ -914,6 +997,40 @@ void PipelineHandlerBase::mapBuffers(Camera *camera, const BufferMap &buffers, u
 	data->ipa_->mapBuffers(bufferIds);
 }
 
+int PipelineHandlerBase::prepareStreamBuffers(Span<const std::pair<RPi::Stream *, unsigned int>> streams)
+{
+	/*
+	 * Buffer allocation and import on the different video devices are
+	 * independent, and each involves a sequence of ioctls that may take a
+	 * noticeable amount of time. Prepare all streams concurrently on a
+	 * ThreadPool, using the calling thread as one of the workers.
+	 */
+	std::vector<int> results(streams.size());
+
+	auto prepare = [&](unsigned int index) {
+		auto [stream, numBuffers] = streams[index];
+		results[index] = stream->prepareBuffers(numBuffers);
+	};
+
+	if (streams.size() < 2) {
+		for (unsigned int i = 0; i < streams.size(); ++i)
+			prepare(i);
+	} else {
+		ThreadPool pool("RPiBuffers", streams.size() - 1);
+		pool.runStrips([&](unsigned int strip, unsigned int count) {
+			for (unsigned int i = strip; i < streams.size(); i += count)
+				prepare(i);
+		});
+	}
+
+	for (int ret : results) {
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
 int PipelineHandlerBase::queueAllBuffers(Camera *camera)
 {
 	CameraData *data = cameraData(camera);
@@ -969,36 +1086,29 @@ V4L2SubdeviceFormat CameraData::findBestFormat(const Size &req, unsigned int bit
 	constexpr float penaltyAr = 1500.0;
 	constexpr float penaltyBitDepth = 500.0;
 
-	/* Calculate the closest/best mode from the user requested size. */
-	for (const auto &iter : sensorFormats_) {
-		const unsigned int mbusCode = iter.first;
-		const PixelFormat format = mbusCodeToPixelFormat(mbusCode,
-								 BayerFormat::Packing::None);
-		const PixelFormatInfo &info = PixelFormatInfo::info(format);
-
-		for (const Size &size : iter.second) {
-			double reqAr = static_cast<double>(req.width) / req.height;
-			double fmtAr = static_cast<double>(size.width) / size.height;
-
-			/* Score the dimensions for closeness. */
-			score = scoreFormat(req.width, size.width);
-			score += scoreFormat(req.height, size.height);
-			score += penaltyAr * scoreFormat(reqAr, fmtAr);
-
-			/* Add any penalties... this is not an exact science! */
-			score += utils::abs_diff(info.bitsPerPixel, bitDepth) * penaltyBitDepth;
-
-			if (score <= bestScore) {
-				bestScore = score;
-				bestFormat.mbus_code = mbusCode;
-				bestFormat.size = size;
-			}
+	const double reqAr = static_cast<double>(req.width) / req.height;
 
-			LOG(RPI, Debug) << "Format: " << size
-					<< " fmt " << format
-					<< " Score: " << score
-					<< " (best " << bestScore << ")";
+	/* Calculate the closest/best mode from the user requested size. */
+	for (const CameraSensor::Mode &mode : sensor_->modes()) {
+		/* Score the dimensions for closeness. */
+		score = scoreFormat(req.width, mode.size.width);
+		score += scoreFormat(req.height, mode.size.height);
+		score += penaltyAr * scoreFormat(reqAr, mode.aspectRatio);
+
+		/* Add any penalties... this is not an exact science! */
+		score += utils::abs_diff(mode.bitDepth, bitDepth) * penaltyBitDepth;
+
+		if (score <= bestScore) {
+			bestScore = score;
+			bestFormat.mbus_code = mode.mbusCode;
+			bestFormat.size = mode.size;
 		}
+
+		LOG(RPI, Debug) << "Format: " << mode.size
+				<< " fmt " << mbusCodeToPixelFormat(mode.mbusCode,
+								    BayerFormat::Packing::None)
+				<< " Score: " << score
+				<< " (best " << bestScore << ")";
 	}
 
 	return bestFormat;
@@ -1123,6 +1233,7 @@ int CameraData::loadPipelineConfiguration()
 	config_ = {
 		.disableStartupFrameDrops = false,
 		.cameraTimeoutValue = 0,
+		.autoFrontendBuffers = false,
 	};
 
 	/* Initial configuration of the platform, in case no config file is present */
@@ -1164,6 +1275,9 @@ int CameraData::loadPipelineConfiguration()
 	config_.cameraTimeoutValue =
 		phConfig["camera_timeout_value_ms"].get<unsigned int>(config_.cameraTimeoutValue);
 
+	config_.autoFrontendBuffers =
+		phConfig["auto_frontend_buffers"].get<bool>(config_.autoFrontendBuffers);
+
 	if (config_.cameraTimeoutValue) {
 		/* Disable the IPA signal to control timeout and set the user requested value. */
 		ipa_->setCameraTimeout.disconnect();
@@ -1293,10 +1407,21 @@ void CameraData::setLensControls(const ControlList &controls)
 {
 	CameraLens *lens = sensor_->focusLens();
 
-	if (lens && controls.contains(V4L2_CID_FOCUS_ABSOLUTE)) {
-		ControlValue const &focusValue = controls.get(V4L2_CID_FOCUS_ABSOLUTE);
-		lens->setFocusPosition(focusValue.get<int32_t>());
+	if (!lens || !controls.contains(V4L2_CID_FOCUS_ABSOLUTE))
+		return;
+
+	/*
+	 * While streaming, defer the lens movement to the next frame start.
+	 * The IPA may update the lens position several times within a frame,
+	 * only the most recent one is written to the device.
+	 */
+	if (state_ != State::Stopped && lensDelayedCtrls_) {
+		pendingLensCtrls_ = controls;
+		return;
 	}
+
+	ControlValue const &focusValue = controls.get(V4L2_CID_FOCUS_ABSOLUTE);
+	lens->setFocusPosition(focusValue.get<int32_t>());
 }
 
 void CameraData::setSensorControls(ControlList &controls)
@@ -1397,6 +1522,15 @@ void CameraData::frameStarted(uint32_t sequence)
 
 	/* Write any controls for the next frame as soon as we can. */
 	delayedCtrls_->applyControls(sequence);
+
+	if (lensDelayedCtrls_) {
+		if (pendingLensCtrls_) {
+			lensDelayedCtrls_->push(*pendingLensCtrls_, 0);
+			pendingLensCtrls_.reset();
+		}
+
+		lensDelayedCtrls_->applyControls(sequence);
+	}
 }
 
 void CameraData::clearIncompleteRequests()
@@ -1421,12 +1555,15 @@ void CameraData::clearIncompleteRequests()
 		}
 
 		pipe()->completeRequest(request);
-		requestQueue_.pop();
+		requestQueue_.pop_front();
 	}
 }
 
 void CameraData::handleStreamBuffer(FrameBuffer *buffer, RPi::Stream *stream)
 {
+	if (config_.autoFrontendBuffers && stream->dev() == frontendDevice())
+		updateFrontendLatency(buffer);
+
 	/*
 	 * It is possible to be here without a pending request, so check
 	 * that we actually have one to action, otherwise we just return
@@ -1454,6 +1591,118 @@ void CameraData::handleStreamBuffer(FrameBuffer *buffer, RPi::Stream *stream)
 	}
 }
 
+/*
+ * Measure how long frontend raw buffers are held by the pipeline, from the
+ * start of the frame until the buffer is returned to the frontend or to the
+ * application. Together with the frame period, this gives the number of
+ * buffers in use at any time.
+ */
+void CameraData::updateFrontendLatency(const FrameBuffer *buffer)
+{
+	const FrameMetadata &metadata = buffer->metadata();
+	FrontendLatency &latency = frontendLatency_;
+
+	if (metadata.status != FrameMetadata::FrameSuccess)
+		return;
+
+	if (latency.lastTimestamp && metadata.sequence > latency.lastSequence &&
+	    metadata.timestamp > latency.lastTimestamp) {
+		latency.framePeriod = std::chrono::nanoseconds(metadata.timestamp - latency.lastTimestamp) /
+				      (metadata.sequence - latency.lastSequence);
+	}
+
+	latency.lastTimestamp = metadata.timestamp;
+	latency.lastSequence = metadata.sequence;
+
+	if (metadata.sequence < kFrontendLatencyWarmupFrames)
+		return;
+
+	auto now = std::chrono::steady_clock::now().time_since_epoch();
+	utils::Duration hold = now - std::chrono::nanoseconds(metadata.timestamp);
+
+	/*
+	 * Track the maximum hold time over the current and previous windows.
+	 * When the current window is full, it becomes the previous window and
+	 * the peaks of the window before it are dropped.
+	 */
+	if (latency.windowFrames == kFrontendLatencyWindowFrames) {
+		latency.windowHold[0] = latency.windowHold[1];
+		latency.windowHold[1] = {};
+		latency.windowFrames = 0;
+	}
+
+	latency.windowHold[1] = std::max(latency.windowHold[1], hold);
+	latency.windowFrames++;
+	latency.frames++;
+}
+
+std::optional<unsigned int> CameraData::tunedFrontendBuffers() const
+{
+	const FrontendLatency &latency = frontendLatency_;
+
+	if (!config_.autoFrontendBuffers ||
+	    latency.frames < kFrontendLatencyMinFrames || !latency.framePeriod)
+		return std::nullopt;
+
+	/*
+	 * Buffers are in use by the pipeline for the hold time, and one more
+	 * buffer must be queued to the frontend for the next frame.
+	 */
+	unsigned int count = std::ceil(latency.maxHold() / latency.framePeriod) + 1;
+
+	return std::clamp(count, kMinFrontendBuffers, kMaxFrontendBuffers);
+}
+
+/*
+ * Select the total number of frontend raw buffers. The number requested by the
+ * application through CameraConfiguration::internalBufferCount takes
+ * precedence, followed by the tuned value when available, and the platform
+ * default.
+ */
+unsigned int CameraData::frontendBufferTarget(unsigned int defaultCount)
+{
+	if (internalBufferCount_) {
+		frontendBuffers_ = internalBufferCount_;
+		return frontendBuffers_;
+	}
+
+	std::optional<unsigned int> tuned = tunedFrontendBuffers();
+
+	frontendBuffers_ = tuned.value_or(defaultCount);
+
+	if (tuned) {
+		const FrontendLatency &latency = frontendLatency_;
+
+		LOG(RPI, Info)
+			<< "Using " << frontendBuffers_ << " frontend buffers"
+			<< " (default " << defaultCount << "), measured hold time "
+			<< latency.maxHold().get<std::milli>() << "ms, frame period "
+			<< latency.framePeriod.get<std::milli>() << "ms";
+	}
+
+	return frontendBuffers_;
+}
+
+/*
+ * Check if the tuned number of frontend buffers differs from the number of
+ * buffers currently allocated.
+ */
+bool CameraData::frontendBuffersChanged() const
+{
+	if (internalBufferCount_)
+		return false;
+
+	std::optional<unsigned int> tuned = tunedFrontendBuffers();
+
+	return tuned && *tuned != frontendBuffers_;
+}
+
+void CameraData::resetFrontendLatency()
+{
+	frontendLatency_ = {};
+	frontendBuffers_ = 0;
+}
+
 void CameraData::handleState()
 {
 	switch (state_) {
@@ -1497,7 +1746,7 @@ void CameraData::checkRequestCompleted()
 				<< request->sequence();
 
 		pipe()->completeRequest(request);
-		requestQueue_.pop();
+		requestQueue_.pop_front();
 		requestCompleted = true;
 	}
 
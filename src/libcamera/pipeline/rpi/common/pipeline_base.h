@@ -5,21 +5,26 @@
  * pipeline_base.h - Pipeline handler base class for Raspberry Pi devices
  */
 
+#include <algorithm>
+#include <deque>
 #include <map>
 #include <memory>
 #include <optional>
-#include <queue>
 #include <string>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include <libcamera/base/span.h>
+#include <libcamera/base/utils.h>
+
 #include <libcamera/controls.h>
 #include <libcamera/request.h>
 
 #include "libcamera/internal/bayer_format.h"
 #include "libcamera/internal/camera.h"
 #include "libcamera/internal/camera_sensor.h"
+#include "libcamera/internal/delayed_controls.h"
 #include "libcamera/internal/framebuffer.h"
 #include "libcamera/internal/media_device.h"
 #include "libcamera/internal/media_object.h"
@@ -30,7 +35,6 @@
 #include <libcamera/ipa/raspberrypi_ipa_interface.h>
 #include <libcamera/ipa/raspberrypi_ipa_proxy.h>
 
-#include "delayed_controls.h"
 #include "rpi_stream.h"
 
 using namespace std::chrono_literals;
@@ -49,7 +53,8 @@ public:
 	CameraData(PipelineHandler *pipe)
 		: Camera::Private(pipe), state_(State::Stopped),
 		  flipsAlterBayerOrder_(false), dropFrameCount_(0), buffersAllocated_(false),
-		  ispOutputCount_(0), ispOutputTotal_(0)
+		  internalBufferCount_(0), ispOutputCount_(0), ispOutputTotal_(0), frontendLatency_{},
+		  frontendBuffers_(0)
 	{
 	}
 
@@ -76,7 +81,7 @@ public:
 	virtual int platformInitIpa(ipa::RPi::InitParams &params) = 0;
 	virtual int platformConfigureIpa(ipa::RPi::ConfigParams &params) = 0;
 
-	void metadataReady(const ControlList &metadata);
+	virtual void metadataReady(const ControlList &metadata);
 	void setDelayedControls(const ControlList &controls, uint32_t delayContext);
 	void setLensControls(const ControlList &controls);
 	void setSensorControls(ControlList &controls);
@@ -116,6 +121,13 @@ public:
 	std::unique_ptr<DelayedControls> delayedCtrls_;
 	bool sensorMetadata_;
 
+	/*
+	 * Lens movements are written at frame start through a separate
+	 * DelayedControls instance, as the lens is a different device.
+	 */
+	std::unique_ptr<DelayedControls> lensDelayedCtrls_;
+	std::optional<ControlList> pendingLensCtrls_;
+
 	/*
 	 * All the functions in this class are called from a single calling
 	 * thread. So, we do not need to have any mutex to protect access to any
@@ -129,7 +141,7 @@ public:
 		return state_ != State::Stopped && state_ != State::Error;
 	}
 
-	std::queue<Request *> requestQueue_;
+	std::deque<Request *> requestQueue_;
 
 	/* Store the "native" Bayer order (that is, with no transforms applied). */
 	bool flipsAlterBayerOrder_;
@@ -152,6 +164,9 @@ public:
 	/* Have internal buffers been allocated? */
 	bool buffersAllocated_;
 
+	/* Frontend buffer count requested by the application, 0 if unset. */
+	unsigned int internalBufferCount_;
+
 	struct Config {
 		/*
 		 * Override any request from the IPA to drop a number of startup
@@ -163,10 +178,19 @@ public:
 		 * on frame durations.
 		 */
 		unsigned int cameraTimeoutValue;
+		/*
+		 * Size the frontend raw buffer pool from the buffer hold time
+		 * measured while streaming, instead of the platform minimums.
+		 */
+		bool autoFrontendBuffers;
 	};
 
 	Config config_;
 
+	unsigned int frontendBufferTarget(unsigned int defaultCount);
+	bool frontendBuffersChanged() const;
+	void resetFrontendLatency();
+
 protected:
 	void fillRequestMetadata(const ControlList &bufferControls,
 				 Request *request);
@@ -178,6 +202,30 @@ protected:
 
 private:
 	void checkRequestCompleted();
+	void updateFrontendLatency(const FrameBuffer *buffer);
+	std::optional<unsigned int> tunedFrontendBuffers() const;
+
+	/*
+	 * Hold time of the frontend raw buffers, for buffer count tuning. The
+	 * maximum is tracked over two consecutive windows of frames, so that
+	 * old peaks expire.
+	 */
+	struct FrontendLatency {
+		utils::Duration maxHold() const
+		{
+			return std::max(windowHold[0], windowHold[1]);
+		}
+
+		utils::Duration windowHold[2];
+		unsigned int windowFrames;
+		utils::Duration framePeriod;
+		unsigned int frames;
+		uint64_t lastTimestamp;
+		uint32_t lastSequence;
+	};
+
+	FrontendLatency frontendLatency_;
+	unsigned int frontendBuffers_;
 };
 
 class PipelineHandlerBase : public PipelineHandler
@@ -223,6 +271,7 @@ protected:
 			   MediaDevice *backend, MediaEntity *sensorEntity);
 
 	void mapBuffers(Camera *camera, const BufferMap &buffers, unsigned int mask);
+	static int prepareStreamBuffers(Span<const std::pair<RPi::Stream *, unsigned int>> streams);
 
 	virtual int platformRegister(std::unique_ptr<CameraData> &cameraData,
 				     MediaDevice *unicam, MediaDevice *isp) = 0;
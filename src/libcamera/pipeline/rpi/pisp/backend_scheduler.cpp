@@ -0,0 +1,158 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2023, Raspberry Pi Ltd
+ *
+ * backend_scheduler.cpp - Backend job scheduling across PiSP cameras
+ */
+
+#include "backend_scheduler.h"
+
+#include <set>
+
+#include <libcamera/base/log.h>
+
+namespace libcamera {
+
+LOG_DECLARE_CATEGORY(RPI)
+
+/**
+ * \class PiSPBackendScheduler
+ * \brief Schedule Backend jobs of cameras sharing the PiSP Backend
+ *
+ * All cameras share a single Backend. Each camera uses a separate Backend
+ * node group, and the driver processes the jobs queued to the node groups in
+ * turn, regardless of their urgency. A large still capture on one camera can
+ * thus delay the frames of a high frame rate camera.
+ *
+ * When multiple cameras are running, the scheduler holds the Backend jobs of
+ * all cameras and submits them to the driver one at a time. The next job is
+ * selected by camera priority first, and then by earliest deadline. Jobs of a
+ * single camera are always submitted in order. When a single camera is
+ * running, jobs are submitted immediately.
+ *
+ * All pipeline handler instances run in the camera manager thread, the
+ * scheduler is thus not thread-safe.
+ */
+
+/**
+ * \brief Retrieve the scheduler shared by all PiSP cameras
+ * \return The scheduler
+ */
+std::shared_ptr<PiSPBackendScheduler> PiSPBackendScheduler::instance()
+{
+	static std::weak_ptr<PiSPBackendScheduler> scheduler;
+
+	std::shared_ptr<PiSPBackendScheduler> instance = scheduler.lock();
+	if (!instance) {
+		instance = std::shared_ptr<PiSPBackendScheduler>(new PiSPBackendScheduler());
+		scheduler = instance;
+	}
+
+	return instance;
+}
+
+/**
+ * \brief Register a running camera
+ * \param[in] client The camera
+ * \param[in] priority The camera priority, higher values are scheduled first
+ */
+void PiSPBackendScheduler::addClient(const void *client, unsigned int priority)
+{
+	clients_[client] = { priority, 0 };
+}
+
+/**
+ * \brief Unregister a camera when it stops
+ * \param[in] client The camera
+ *
+ * Jobs of the camera that haven't been submitted yet are dropped, and jobs in
+ * flight are not accounted for anymore.
+ */
+void PiSPBackendScheduler::removeClient(const void *client)
+{
+	auto it = clients_.find(client);
+	if (it == clients_.end())
+		return;
+
+	jobsInFlight_ -= it->second.jobsInFlight;
+	clients_.erase(it);
+
+	jobs_.remove_if([client](const Job &job) { return job.client == client; });
+
+	schedule();
+}
+
+/**
+ * \brief Queue a Backend job
+ * \param[in] client The camera
+ * \param[in] deadline The time by which the job should complete, in
+ * nanoseconds on the monotonic clock
+ * \param[in] submit The function that queues the job to the driver
+ */
+void PiSPBackendScheduler::queueJob(const void *client, uint64_t deadline,
+				   Submit submit)
+{
+	ASSERT(clients_.count(client));
+
+	jobs_.push_back({ client, deadline, std::move(submit) });
+	schedule();
+}
+
+/**
+ * \brief Signal completion of a Backend job
+ * \param[in] client The camera
+ */
+void PiSPBackendScheduler::jobDone(const void *client)
+{
+	auto it = clients_.find(client);
+	if (it == clients_.end() || !it->second.jobsInFlight)
+		return;
+
+	it->second.jobsInFlight--;
+	jobsInFlight_--;
+
+	schedule();
+}
+
+void PiSPBackendScheduler::schedule()
+{
+	while (!jobs_.empty()) {
+		if (clients_.size() > 1 && jobsInFlight_ >= kMaxJobsInFlight)
+			return;
+
+		/*
+		 * Only the oldest job of each camera is eligible, select the
+		 * one from the highest priority camera with the earliest
+		 * deadline.
+		 */
+		std::set<const void *> seen;
+		auto next = jobs_.end();
+
+		for (auto it = jobs_.begin(); it != jobs_.end(); ++it) {
+			if (!seen.insert(it->client).second)
+				continue;
+
+			if (next == jobs_.end()) {
+				next = it;
+				continue;
+			}
+
+			unsigned int priority = clients_[it->client].priority;
+			unsigned int nextPriority = clients_[next->client].priority;
+
+			if (priority > nextPriority ||
+			    (priority == nextPriority && it->deadline < next->deadline))
+				next = it;
+		}
+
+		Job job = std::move(*next);
+		jobs_.erase(next);
+
+		clients_[job.client].jobsInFlight++;
+		jobsInFlight_++;
+
+		job.submit();
+	}
+}
+
+} /* namespace libcamera */
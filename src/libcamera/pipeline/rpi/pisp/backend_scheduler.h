@@ -0,0 +1,59 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2023, Raspberry Pi Ltd
+ *
+ * backend_scheduler.h - Backend job scheduling across PiSP cameras
+ */
+
+#pragma once
+
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <stdint.h>
+
+namespace libcamera {
+
+class PiSPBackendScheduler
+{
+public:
+	using Submit = std::function<void()>;
+
+	static std::shared_ptr<PiSPBackendScheduler> instance();
+
+	void addClient(const void *client, unsigned int priority);
+	void removeClient(const void *client);
+
+	void queueJob(const void *client, uint64_t deadline, Submit submit);
+	void jobDone(const void *client);
+
+private:
+	/*
+	 * Jobs submitted to the hardware when the Backend is shared. The job
+	 * being processed can't be preempted, the next one is selected when
+	 * it completes.
+	 */
+	static constexpr unsigned int kMaxJobsInFlight = 1;
+
+	struct Client {
+		unsigned int priority;
+		unsigned int jobsInFlight;
+	};
+
+	struct Job {
+		const void *client;
+		uint64_t deadline;
+		Submit submit;
+	};
+
+	PiSPBackendScheduler() = default;
+
+	void schedule();
+
+	std::map<const void *, Client> clients_;
+	std::list<Job> jobs_;
+	unsigned int jobsInFlight_ = 0;
+};
+
+} /* namespace libcamera */
@@ -10,15 +10,15 @@
 #include <memory>
 #include <mutex>
 #include <numeric>
+#include <optional>
 #include <queue>
 #include <set>
 #include <sstream>
 #include <string>
-#include <sys/ioctl.h>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
-#include <linux/dma-buf.h>
 #include <linux/v4l2-controls.h>
 #include <linux/videodev2.h>
 
@@ -26,6 +26,7 @@
 #include <libcamera/formats.h>
 
 #include "libcamera/internal/device_enumerator.h"
+#include "libcamera/internal/shared_mem_object.h"
 
 #include "libpisp/backend/backend.hpp"
 #include "libpisp/common/logging.hpp"
@@ -36,7 +37,9 @@
 
 #include "../common/pipeline_base.h"
 #include "../common/rpi_stream.h"
-#include "../common/shared_mem_object.h"
+
+#include "backend_scheduler.h"
+#include "post_processor.h"
 
 namespace libcamera {
 
@@ -51,6 +54,9 @@ enum class Cfe : unsigned int { Output0, Embedded, Stats, Config };
 enum class Isp : unsigned int { Input, Output0, Output1, TdnInput, TdnOutput,
 				StitchInput, StitchOutput, Config };
 
+/* Backend frame budget used until the frame period has been measured. */
+constexpr utils::Duration kDefaultFrameBudget = 33333us;
+
 /* Offset for all compressed buffers; mode for TDN and Stitch. */
 constexpr unsigned int DefaultCompressionOffset = 2048;
 constexpr unsigned int DefaultCompressionMode = 1;
@@ -293,315 +299,6 @@ void setupOutputClipping(const V4L2DeviceFormat &v4l2Format,
 	}
 }
 
-int dmabufSyncStart(const SharedFD &fd)
-{
-	struct dma_buf_sync dma_sync {};
-	dma_sync.flags = DMA_BUF_SYNC_START | DMA_BUF_SYNC_RW;
-
-	int ret = ::ioctl(fd.get(), DMA_BUF_IOCTL_SYNC, &dma_sync);
-	if (ret)
-		LOG(RPI, Error) << "failed to lock-sync-write dma buf";
-
-	return ret;
-}
-
-int dmabufSyncEnd(const SharedFD &fd)
-{
-	struct dma_buf_sync dma_sync {};
-	dma_sync.flags = DMA_BUF_SYNC_END | DMA_BUF_SYNC_RW;
-
-	int ret = ::ioctl(fd.get(), DMA_BUF_IOCTL_SYNC, &dma_sync);
-
-	if (ret)
-		LOG(RPI, Error) << "failed to unlock-sync-write dma buf";
-
-	return ret;
-}
-
-void do32BitConversion(void *mem, unsigned int width, unsigned int height,
-		       unsigned int stride)
-{
-	/*
-	 * The arm64 version is actually not that much quicker because the
-	 * vast bulk of the time is spent waiting for memory.
-	 */
-#if __aarch64__
-	for (unsigned int j = 0; j < height; j++) {
-		uint8_t *ptr = (uint8_t *)mem + j * stride;
-		uint64_t count = (width + 15) / 16;
-		uint8_t *dest = ptr + count * 64;
-		uint8_t *src = ptr + count * 48;
-
-		/* Pre-decrement would have been nice. */
-		asm volatile("movi v3.16b, #255 \n"
-				"1: \n"
-				"sub %[src], %[src], #48 \n"
-				"sub %[dest], %[dest], #64 \n"
-				"subs %[count], %[count], #1 \n"
-				"ld3 {v0.16b, v1.16b, v2.16b}, [%[src]] \n"
-				"st4 {v0.16b, v1.16b, v2.16b, v3.16b}, [%[dest]] \n"
-				"b.gt 1b \n"
-				: [count]"+r" (count)
-				: [src]"r" (src), [dest]"r" (dest)
-				: "cc", "v1", "v2", "v3", "v4", "memory"
-				);
-	}
-#else
-	std::vector<uint8_t> incache(3 * width);
-	std::vector<uint8_t> outcache(4 * width);
-
-	memcpy(incache.data(), mem, 3 * width);
-	for (unsigned int j = 0; j < height; j++) {
-		uint8_t *ptr = (uint8_t *)mem + j * stride;
-
-		uint8_t *ptr3 = incache.data();
-		uint8_t *ptr4 = outcache.data();
-		for (unsigned int i = 0; i < width; i++) {
-			*(ptr4++) = *(ptr3++);
-			*(ptr4++) = *(ptr3++);
-			*(ptr4++) = *(ptr3++);
-			*(ptr4++) = 255;
-		}
-
-		if (j < height - 1)
-			memcpy(incache.data(), ptr + stride, 3 * width);
-		memcpy(ptr, outcache.data(), 4 * width);
-	}
-#endif
-}
-
-void downscaleInterleaved3(void *mem, unsigned int height, unsigned int src_width,
-			   unsigned int stride)
-{
-	std::vector<uint8_t> incache(3 * src_width);
-	unsigned int dst_width = src_width / 2;
-	std::vector<uint8_t> outcache(3 * dst_width);
-
-	memcpy(incache.data(), mem, 3 * src_width);
-	for (unsigned int j = 0; j < height; j++) {
-		uint8_t *ptr = (uint8_t *)mem + j * stride;
-
-		uint8_t *src = incache.data(), *dst = outcache.data();
-		for (unsigned int i = 0; i < dst_width; i++, src += 6, dst += 3) {
-			dst[0] = ((int)src[0] + (int)src[3] + 1) >> 1;
-			dst[1] = ((int)src[1] + (int)src[4] + 1) >> 1;
-			dst[2] = ((int)src[2] + (int)src[5] + 1) >> 1;
-		}
-
-		if (j < height - 1)
-			memcpy(incache.data(), ptr + stride, 3 * src_width);
-		memcpy(ptr, outcache.data(), 3 * dst_width);
-	}
-}
-
-void downscaleInterleaved4(void *mem, unsigned int height, unsigned int src_width,
-			   unsigned int stride)
-{
-	std::vector<uint8_t> incache(4 * src_width);
-	unsigned int dst_width = src_width / 2;
-	std::vector<uint8_t> outcache(4 * dst_width);
-
-	memcpy(incache.data(), mem, 4 * src_width);
-	for (unsigned int j = 0; j < height; j++) {
-		uint8_t *ptr = (uint8_t *)mem + j * stride;
-
-		uint8_t *src = incache.data(), *dst = outcache.data();
-		for (unsigned int i = 0; i < dst_width; i++, src += 8, dst += 4) {
-			dst[0] = ((int)src[0] + (int)src[4] + 1) >> 1;
-			dst[1] = ((int)src[1] + (int)src[5] + 1) >> 1;
-			dst[2] = ((int)src[2] + (int)src[6] + 1) >> 1;
-			dst[3] = ((int)src[3] + (int)src[7] + 1) >> 1;
-		}
-
-		if (j < height - 1)
-			memcpy(incache.data(), ptr + stride, 4 * src_width);
-		memcpy(ptr, outcache.data(), 4 * dst_width);
-	}
-}
-
-void downscalePlaneInternal(void *mem, unsigned int height, unsigned int src_width,
-			    unsigned int stride, std::vector<uint8_t> &incache,
-			    std::vector<uint8_t> &outcache)
-{
-	unsigned int dst_width = src_width / 2;
-	memcpy(incache.data(), mem, src_width);
-	for (unsigned int j = 0; j < height; j++) {
-		uint8_t *ptr = (uint8_t *)mem + j * stride;
-
-		uint8_t *src = incache.data(), *dst = outcache.data();
-		for (unsigned int i = 0; i < dst_width; i++, src += 2, dst++)
-			*dst = ((int)src[0] + (int)src[1] + 1) >> 1;
-
-		if (j < height - 1)
-			memcpy(incache.data(), ptr + stride, src_width);
-		memcpy(ptr, outcache.data(), dst_width);
-	}
-}
-
-void downscalePlanar420(void *memY, void *memU, void *memV, unsigned int height,
-			unsigned int src_width, unsigned int stride)
-{
-	std::vector<uint8_t> incache(src_width);
-	std::vector<uint8_t> outcache(src_width / 2);
-
-	downscalePlaneInternal(memY, height, src_width, stride, incache, outcache);
-	downscalePlaneInternal(memU, height / 2, src_width / 2, stride / 2, incache, outcache);
-	downscalePlaneInternal(memV, height / 2, src_width / 2, stride / 2, incache, outcache);
-}
-
-void downscalePlanar422(void *memY, void *memU, void *memV,
-			unsigned int height, unsigned int src_width, unsigned int stride)
-{
-	std::vector<uint8_t> incache(src_width);
-	std::vector<uint8_t> outcache(src_width / 2);
-
-	downscalePlaneInternal(memY, height, src_width, stride, incache, outcache);
-	downscalePlaneInternal(memU, height, src_width / 2, stride / 2, incache, outcache);
-	downscalePlaneInternal(memV, height, src_width / 2, stride / 2, incache, outcache);
-}
-
-void downscaleInterleavedYuyv(void *mem, unsigned int height, unsigned int src_width,
-			      unsigned int stride)
-{
-	std::vector<uint8_t> incache(2 * src_width);
-	unsigned int dst_width = src_width / 2;
-	std::vector<uint8_t> outcache(2 * dst_width);
-
-	memcpy(incache.data(), mem, 2 * src_width);
-	for (unsigned int j = 0; j < height; j++) {
-		uint8_t *ptr = (uint8_t *)mem + j * stride;
-
-		uint8_t *src = incache.data(), *dst = outcache.data();
-		for (unsigned int i = 0; i < dst_width; i++, src += 8, dst += 4) {
-			dst[0] = ((int)src[0] + (int)src[2] + 1) >> 1;
-			dst[1] = ((int)src[1] + (int)src[5] + 1) >> 1;
-			dst[2] = ((int)src[4] + (int)src[6] + 1) >> 1;
-			dst[3] = ((int)src[3] + (int)src[7] + 1) >> 1;
-		}
-
-		if (j < height - 1)
-			memcpy(incache.data(), ptr + stride, 4 * src_width);
-		memcpy(ptr, outcache.data(), 2 * dst_width);
-	}
-}
-
-void downscaleInterleavedUyvy(void *mem, unsigned int height, unsigned int src_width,
-			      unsigned int stride)
-{
-	std::vector<uint8_t> incache(2 * src_width);
-	unsigned int dst_width = src_width / 2;
-	std::vector<uint8_t> outcache(2 * dst_width);
-
-	memcpy(incache.data(), mem, 2 * src_width);
-	for (unsigned int j = 0; j < height; j++) {
-		uint8_t *ptr = (uint8_t *)mem + j * stride;
-
-		uint8_t *src = incache.data(), *dst = outcache.data();
-		for (unsigned int i = 0; i < dst_width; i++, src += 8, dst += 4) {
-			dst[0] = ((int)src[0] + (int)src[4] + 1) >> 1;
-			dst[1] = ((int)src[1] + (int)src[3] + 1) >> 1;
-			dst[2] = ((int)src[2] + (int)src[6] + 1) >> 1;
-			dst[3] = ((int)src[5] + (int)src[7] + 1) >> 1;
-		}
-
-		if (j < height - 1)
-			memcpy(incache.data(), ptr + stride, 4 * src_width);
-		memcpy(ptr, outcache.data(), 2 * dst_width);
-	}
-}
-
-void downscaleInterleaved2Internal(void *mem, unsigned int height, unsigned int src_width,
-				   unsigned int stride, std::vector<uint8_t> &incache,
-				   std::vector<uint8_t> &outcache)
-{
-	unsigned int dst_width = src_width / 2;
-	memcpy(incache.data(), mem, 2 * src_width);
-	for (unsigned int j = 0; j < height; j++) {
-		uint8_t *ptr = (uint8_t *)mem + j * stride;
-
-		uint8_t *src = incache.data(), *dst = outcache.data();
-		for (unsigned int i = 0; i < dst_width; i++, src += 4, dst += 2) {
-			dst[0] = ((int)src[0] + (int)src[2] + 1) >> 1;
-			dst[1] = ((int)src[1] + (int)src[3] + 1) >> 1;
-		}
-
-		if (j < height - 1)
-			memcpy(incache.data(), ptr + stride, 2 * src_width);
-		memcpy(ptr, outcache.data(), 2 * dst_width);
-	}
-}
-
-void downscaleSemiPlanar420(void *memY, void *memUV, unsigned int height,
-			    unsigned int src_width, unsigned int stride)
-{
-	std::vector<uint8_t> incache(src_width);
-	std::vector<uint8_t> outcache(src_width / 2);
-
-	downscalePlaneInternal(memY, height, src_width, stride, incache, outcache);
-	downscaleInterleaved2Internal(memUV, height / 2, src_width / 2, stride,
-				      incache, outcache);
-}
-
-void downscaleStreamBuffer(RPi::Stream *stream, int index)
-{
-	unsigned int downscale = stream->swDownscale();
-	/* Must be a power of 2. */
-	ASSERT((downscale & (downscale - 1)) == 0);
-
-	unsigned int stride = stream->configuration().stride;
-	unsigned int dst_width = stream->configuration().size.width;
-	unsigned int height = stream->configuration().size.height;
-	const PixelFormat &pixFormat = stream->configuration().pixelFormat;
-	const RPi::BufferObject &b = stream->getBuffer(index);
-	void *mem = b.mapped->planes()[0].data();
-	ASSERT(b.mapped);
-
-	/* Do repeated downscale-by-2 in place until we're done. */
-	for (; downscale > 1; downscale >>= 1) {
-		unsigned int src_width = downscale * dst_width;
-
-		if (pixFormat == formats::RGB888 || pixFormat == formats::BGR888) {
-			downscaleInterleaved3(mem, height, src_width, stride);
-		} else if (pixFormat == formats::XRGB8888 || pixFormat == formats::XBGR8888) {
-			/* On some devices these may actually be 24bpp at this point. */
-			if (stream->getFlags() & StreamFlag::Needs32bitConv)
-				downscaleInterleaved3(mem, height, src_width, stride);
-			else
-				downscaleInterleaved4(mem, height, src_width, stride);
-		} else if (pixFormat == formats::YUV420 || pixFormat == formats::YVU420) {
-			/*
-			 * These look "multiplanar" even when they're a single allocation,
-			 * so the following should work for everyone.
-			 */
-			void *mem1 = b.mapped->planes()[1].data();
-			void *mem2 = b.mapped->planes()[2].data();
-			downscalePlanar420(mem, mem1, mem2, height, src_width, stride);
-		} else if (pixFormat == formats::YUV422 || pixFormat == formats::YVU422) {
-			/*
-			 * These look "multiplanar" even when they're a single allocation,
-			 * so the following should work for everyone.
-			 */
-			void *mem1 = b.mapped->planes()[1].data();
-			void *mem2 = b.mapped->planes()[2].data();
-			downscalePlanar422(mem, mem1, mem2, height, src_width, stride);
-		} else if (pixFormat == formats::YUYV || pixFormat == formats::YVYU) {
-			downscaleInterleavedYuyv(mem, height, src_width, stride);
-		} else if (pixFormat == formats::UYVY || pixFormat == formats::VYUY) {
-			downscaleInterleavedUyvy(mem, height, src_width, stride);
-		} else if (pixFormat == formats::NV12 || pixFormat == formats::NV21) {
-			/*
-			 * These look "multiplanar" even when they're a single allocation,
-			 * so the following should work for everyone.
-			 */
-			void *mem1 = b.mapped->planes()[1].data();
-			downscaleSemiPlanar420(mem, mem1, height, src_width, stride);
-		} else {
-			LOG(RPI, Error) << "Sw downscale unsupported for " << pixFormat;
-			ASSERT(0);
-		}
-	}
-}
-
 /* Return largest width of any of these streams (or of the camera input). */
 unsigned int getLargestWidth(const V4L2SubdeviceFormat &sensorFormat,
 			     const std::vector<StreamParams> &outStreams)
@@ -660,6 +357,10 @@ public:
 		/* Initialise internal libpisp logging. */
 		::libpisp::logging_init();
 		LOG(RPI, Info) << "libpisp version " << ::libpisp::version();
+
+		postProcessor_.bufferReady.connect(this, &PiSPCameraData::beOutputComplete);
+
+		beScheduler_ = PiSPBackendScheduler::instance();
 	}
 
 	~PiSPCameraData()
@@ -694,7 +395,9 @@ public:
 	void cfeBufferDequeue(FrameBuffer *buffer);
 	void beInputDequeue(FrameBuffer *buffer);
 	void beOutputDequeue(FrameBuffer *buffer);
+	void beOutputComplete(FrameBuffer *buffer, RPi::Stream *stream);
 
+	void metadataReady(const ControlList &metadata) override;
 	void processStatsComplete(const ipa::RPi::BufferIds &buffers);
 	void prepareIspComplete(const ipa::RPi::BufferIds &buffers, bool stitchSwapBuffers);
 	void setCameraTimeout(uint32_t maxFrameLengthMs);
@@ -706,8 +409,8 @@ public:
 	const libpisp::PiSPVariant &pispVariant_;
 
 	/* Frontend/Backend objects shared with the IPA. */
-	RPi::SharedMemObject<FrontEnd> fe_;
-	RPi::SharedMemObject<BackEnd> be_;
+	SharedMemObject<FrontEnd> fe_;
+	SharedMemObject<BackEnd> be_;
 	bool beEnabled_;
 
 	std::unique_ptr<V4L2Subdevice> csi2Subdev_;
@@ -734,6 +437,16 @@ public:
 		bool disableTdn;
 		/* Don't use BE HDR and free some memory resources. */
 		bool disableHdr;
+		/*
+		 * Priority of the camera when scheduling Backend jobs with
+		 * other cameras. Higher values are scheduled first.
+		 */
+		unsigned int bePriority;
+		/*
+		 * Time allowed to process a frame in the Backend, from the
+		 * start of exposure. Zero selects the measured frame period.
+		 */
+		utils::Duration beFrameBudget;
 	};
 
 	Config config_;
@@ -771,6 +484,24 @@ private:
 
 	std::queue<CfeJob> cfeJobQueue_;
 
+	/*
+	 * The IPA may prepare the next request while the Backend processes
+	 * the current one. Its results are held until the current request
+	 * completes.
+	 */
+	struct Lookahead {
+		enum class State { None, Preparing, Ready };
+
+		State state = State::None;
+		std::optional<ControlList> metadata;
+		ipa::RPi::BufferIds buffers;
+		bool stitchSwapBuffers;
+	};
+
+	Lookahead lookahead_;
+
+	void startIpaPrepare(Request *request, CfeJob &job);
+
 	bool cfeJobComplete() const
 	{
 		if (cfeJobQueue_.empty())
@@ -783,6 +514,12 @@ private:
 				job.buffers.count(&cfe_[Cfe::Embedded]));
 	}
 
+	PiSPPostProcessor postProcessor_;
+
+	std::shared_ptr<PiSPBackendScheduler> beScheduler_;
+	uint64_t lastCfeTimestamp_;
+	utils::Duration framePeriod_;
+
 	std::string last_dump_file_;
 };
 
@@ -873,9 +610,9 @@ bool PipelineHandlerPiSP::match(DeviceEnumerator *enumerator)
 			PiSPCameraData *pisp =
 				static_cast<PiSPCameraData *>(cameraData.get());
 
-			pisp->fe_ = RPi::SharedMemObject<FrontEnd>
+			pisp->fe_ = SharedMemObject<FrontEnd>
 					("pisp_frontend", true, pisp->pispVariant_);
-			pisp->be_ = RPi::SharedMemObject<BackEnd>
+			pisp->be_ = SharedMemObject<BackEnd>
 					("pisp_backend", BackEnd::Config({}), pisp->pispVariant_);
 
 			if (!pisp->fe_.fd().isValid() || !pisp->be_.fd().isValid()) {
@@ -912,14 +649,16 @@ int PipelineHandlerPiSP::prepareBuffers(Camera *camera)
 		}
 	}
 
+	/*
+	 * For CFE, allocate a minimum of 4 buffers as we want to avoid any
+	 * frame drops, unless tuned from the measured buffer hold time.
+	 */
+	const unsigned int minBuffers = data->frontendBufferTarget(4);
+
 	/* Decide how many internal buffers to allocate. */
+	std::vector<std::pair<RPi::Stream *, unsigned int>> streams;
 	for (auto const stream : data->streams_) {
 		unsigned int numBuffers;
-		/*
-		 * For CFE, allocate a minimum of 4 buffers as we want
-		 * to avoid any frame drops.
-		 */
-		constexpr unsigned int minBuffers = 4;
 		if (stream == &data->cfe_[Cfe::Output0]) {
 			/*
 			 * If an application has configured a RAW stream, allocate
@@ -962,11 +701,13 @@ int PipelineHandlerPiSP::prepareBuffers(Camera *camera)
 		LOG(RPI, Debug) << "Preparing " << numBuffers
 				<< " buffers for stream " << stream->name();
 
-		ret = stream->prepareBuffers(numBuffers);
-		if (ret < 0)
-			return ret;
+		streams.emplace_back(stream, numBuffers);
 	}
 
+	ret = prepareStreamBuffers(streams);
+	if (ret < 0)
+		return ret;
+
 	/*
 	 * Store the Framebuffer pointers for convenience as we will ping-pong
 	 * these buffers between the input and output nodes for TDN and Stitch.
@@ -1280,6 +1021,8 @@ int PiSPCameraData::platformPipelineConfigure(const std::unique_ptr<YamlObject>
 		.numCfeConfigQueue = 2,
 		.disableTdn = false,
 		.disableHdr = false,
+		.bePriority = 0,
+		.beFrameBudget = 0s,
 	};
 
 	if (!root)
@@ -1305,6 +1048,9 @@ int PiSPCameraData::platformPipelineConfigure(const std::unique_ptr<YamlObject>
 		phConfig["num_cfe_config_queue"].get<unsigned int>(config_.numCfeConfigQueue);
 	config_.disableTdn = phConfig["disable_tdn"].get<bool>(config_.disableTdn);
 	config_.disableHdr = phConfig["disable_hdr"].get<bool>(config_.disableHdr);
+	config_.bePriority = phConfig["be_priority"].get<unsigned int>(config_.bePriority);
+	config_.beFrameBudget =
+		phConfig["be_frame_budget_ms"].get<double>(0.0) * 1ms;
 
 	if (config_.disableTdn) {
 		LOG(RPI, Info) << "TDN disabled by user config";
@@ -1346,6 +1092,12 @@ bool PiSPCameraData::adjustDeviceFormat(V4L2DeviceFormat &format) const
 {
 	auto it = deviceAdjustTable.find(format.fourcc.fourcc());
 
+	/*
+	 * Backends that support 32-bit RGB outputs write the final format
+	 * directly. Otherwise, the Backend writes 24-bit RGB and the buffers
+	 * are expanded to 32-bit by the software post-processor, at the cost
+	 * of a read-modify-write of the whole frame by the CPU.
+	 */
 	if (pispVariant_.BackendRGB32Supported(0))
 		return false;
 
@@ -1443,6 +1195,11 @@ int PiSPCameraData::platformConfigure(const RPi::RPiCameraConfiguration *rpiConf
 
 		format = outStreams[i].format;
 		bool needs32BitConversion = adjustDeviceFormat(format);
+		if (needs32BitConversion)
+			LOG(RPI, Info)
+				<< "Backend can't write " << outStreams[i].format.fourcc
+				<< " on " << stream->name()
+				<< ", converting from " << format.fourcc << " in software";
 
 		/*
 		 * This pixel format may not be the same as the configured
@@ -1577,6 +1334,12 @@ void PiSPCameraData::platformStart()
 	stitchInputIndex_ = 0;
 
 	cfeJobQueue_ = {};
+	lookahead_ = {};
+	postProcessor_.start();
+
+	lastCfeTimestamp_ = 0;
+	framePeriod_ = 0s;
+	beScheduler_->addClient(this, config_.bePriority);
 
 	for (unsigned int i = 0; i < config_.numCfeConfigQueue; i++)
 		prepareCfe();
@@ -1588,6 +1351,16 @@ void PiSPCameraData::platformStart()
 void PiSPCameraData::platformStop()
 {
 	cfeJobQueue_ = {};
+	lookahead_ = {};
+
+	/* Backend jobs not submitted yet are dropped. */
+	beScheduler_->removeClient(this);
+
+	/*
+	 * Buffers still being post-processed are dropped, they are returned
+	 * along with the other buffers queued to the devices.
+	 */
+	postProcessor_.stop();
 }
 
 void PiSPCameraData::platformFreeBuffers()
@@ -1632,7 +1405,9 @@ void PiSPCameraData::cfeBufferDequeue(FrameBuffer *buffer)
 		 * Lookup the sensor controls used for this frame sequence from
 		 * DelayedControl and queue them along with the frame buffer.
 		 */
-		auto [ctrl, delayContext] = delayedCtrls_->get(buffer->metadata().sequence);
+		uint32_t sequence = buffer->metadata().sequence;
+		ControlList ctrl = delayedCtrls_->get(sequence);
+		unsigned int delayContext = delayedCtrls_->cookie(sequence);
 		/*
 		 * Add the frame timestamp to the ControlList for the IPA to use
 		 * as it does not receive the FrameBuffer object.
@@ -1640,6 +1415,15 @@ void PiSPCameraData::cfeBufferDequeue(FrameBuffer *buffer)
 		ctrl.set(controls::SensorTimestamp, buffer->metadata().timestamp);
 		job.sensorControls = std::move(ctrl);
 		job.delayContext = delayContext;
+
+		/* Track the frame period to schedule the Backend jobs. */
+		uint64_t timestamp = buffer->metadata().timestamp;
+		if (lastCfeTimestamp_ && timestamp > lastCfeTimestamp_)
+			framePeriod_ = std::chrono::nanoseconds(timestamp - lastCfeTimestamp_);
+		lastCfeTimestamp_ = timestamp;
+	} else if (stream == &cfe_[Cfe::Embedded]) {
+		/* Parse the embedded data while waiting for the Bayer frame. */
+		ipa_->parseEmbeddedData(RPi::MaskEmbeddedData | index);
 	} else if (stream == &cfe_[Cfe::Config]) {
 		/* The config buffer can be re-queued back straight away. */
 		handleStreamBuffer(buffer, &cfe_[Cfe::Config]);
@@ -1658,6 +1442,9 @@ void PiSPCameraData::beInputDequeue(FrameBuffer *buffer)
 			<< ", buffer id " << cfe_[Cfe::Output0].getBufferId(buffer)
 			<< ", timestamp: " << buffer->metadata().timestamp;
 
+	/* The Backend job is complete, let the next one run. */
+	beScheduler_->jobDone(this);
+
 	/* The ISP input buffer gets re-queued into CFE. */
 	handleStreamBuffer(buffer, &cfe_[Cfe::Output0]);
 	handleState();
@@ -1686,32 +1473,23 @@ void PiSPCameraData::beOutputDequeue(FrameBuffer *buffer)
 			<< ", buffer id " << index
 			<< ", timestamp: " << buffer->metadata().timestamp;
 
-	bool downscale = stream->swDownscale() > 1;
-	bool needs32bitConv = !!(stream->getFlags() & StreamFlag::Needs32bitConv);
-
-	if (downscale || needs32bitConv)
-		dmabufSyncStart(buffer->planes()[0].fd);
-
-	if (downscale) {
-		/* Further software downscaling must be applied. */
-		downscaleStreamBuffer(stream, index);
+	/*
+	 * Further software downscaling or 24bpp to 32bpp conversion must be
+	 * applied. This is done asynchronously, the buffer is handled when
+	 * the post-processor completes it.
+	 */
+	if (PiSPPostProcessor::needsProcessing(stream)) {
+		postProcessor_.queueBuffer(buffer, stream, index);
+		return;
 	}
 
-	/* Convert 24bpp outputs to 32bpp outputs where necessary. */
-	if (needs32bitConv) {
-		unsigned int stride = stream->configuration().stride;
-		unsigned int width = stream->configuration().size.width;
-		unsigned int height = stream->configuration().size.height;
-
-		const RPi::BufferObject &b = stream->getBuffer(index);
-
-		ASSERT(b.mapped);
-		void *mem = b.mapped->planes()[0].data();
-		do32BitConversion(mem, width, height, stride);
-	}
+	beOutputComplete(buffer, stream);
+}
 
-	if (downscale || needs32bitConv)
-		dmabufSyncEnd(buffer->planes()[0].fd);
+void PiSPCameraData::beOutputComplete(FrameBuffer *buffer, RPi::Stream *stream)
+{
+	if (!isRunning())
+		return;
 
 	handleStreamBuffer(buffer, stream);
 
@@ -1746,6 +1524,20 @@ void PiSPCameraData::setCameraTimeout(uint32_t maxFrameLengthMs)
 	cfe_[Cfe::Output0].dev()->setDequeueTimeout(timeout);
 }
 
+void PiSPCameraData::metadataReady(const ControlList &metadata)
+{
+	if (!isRunning())
+		return;
+
+	/* Hold the metadata of a lookahead request until it is dequeued. */
+	if (lookahead_.state == Lookahead::State::Preparing) {
+		lookahead_.metadata = metadata;
+		return;
+	}
+
+	RPi::CameraData::metadataReady(metadata);
+}
+
 void PiSPCameraData::prepareIspComplete(const ipa::RPi::BufferIds &buffers, bool stitchSwapBuffers)
 {
 	unsigned int embeddedId = buffers.embedded & RPi::MaskID;
@@ -1755,6 +1547,17 @@ void PiSPCameraData::prepareIspComplete(const ipa::RPi::BufferIds &buffers, bool
 	if (!isRunning())
 		return;
 
+	/*
+	 * The Backend is still busy with the current request, queue the job
+	 * once the current request completes.
+	 */
+	if (lookahead_.state == Lookahead::State::Preparing) {
+		lookahead_.state = Lookahead::State::Ready;
+		lookahead_.buffers = buffers;
+		lookahead_.stitchSwapBuffers = stitchSwapBuffers;
+		return;
+	}
+
 	if (sensorMetadata_ && embeddedId) {
 		buffer = cfe_[Cfe::Embedded].getBuffers().at(embeddedId).buffer;
 		handleStreamBuffer(buffer, &cfe_[Cfe::Embedded]);
@@ -2125,20 +1928,25 @@ void PiSPCameraData::prepareBe(uint32_t bufferId, bool stitchSwapBuffers)
 	LOG(RPI, Debug) << "Input re-queue to ISP, buffer id " << bufferId
 			<< ", timestamp: " << buffer->metadata().timestamp;
 
-	isp_[Isp::Input].queueBuffer(buffer);
+	/*
+	 * The buffers are queued to the Backend when the scheduler selects the
+	 * job, with the config buffer last.
+	 */
+	std::vector<std::pair<RPi::Stream *, FrameBuffer *>> jobBuffers;
+	jobBuffers.emplace_back(&isp_[Isp::Input], buffer);
 
 	/* Ping-pong between input/output buffers for the TDN and Stitch nodes. */
 	if (!config_.disableTdn) {
-		isp_[Isp::TdnInput].queueBuffer(tdnBuffers_[tdnInputIndex_]);
-		isp_[Isp::TdnOutput].queueBuffer(tdnBuffers_[tdnInputIndex_ ^ 1]);
+		jobBuffers.emplace_back(&isp_[Isp::TdnInput], tdnBuffers_[tdnInputIndex_]);
+		jobBuffers.emplace_back(&isp_[Isp::TdnOutput], tdnBuffers_[tdnInputIndex_ ^ 1]);
 		tdnInputIndex_ ^= 1;
 	}
 
 	if (!config_.disableHdr) {
 		if (stitchSwapBuffers)
 			stitchInputIndex_ ^= 1;
-		isp_[Isp::StitchInput].queueBuffer(stitchBuffers_[stitchInputIndex_]);
-		isp_[Isp::StitchOutput].queueBuffer(stitchBuffers_[stitchInputIndex_ ^ 1]);
+		jobBuffers.emplace_back(&isp_[Isp::StitchInput], stitchBuffers_[stitchInputIndex_]);
+		jobBuffers.emplace_back(&isp_[Isp::StitchOutput], stitchBuffers_[stitchInputIndex_ ^ 1]);
 	}
 
 	/* Fetch an unused config buffer from the stream .*/
@@ -2168,20 +1976,73 @@ void PiSPCameraData::prepareBe(uint32_t bufferId, bool stitchSwapBuffers)
 		}
 	}
 
-	isp_[Isp::Config].queueBuffer(config.buffer);
+	jobBuffers.emplace_back(&isp_[Isp::Config], config.buffer);
+
+	/*
+	 * The job should complete before the next frame, unless a different
+	 * budget has been configured.
+	 */
+	utils::Duration budget = config_.beFrameBudget;
+	if (!budget)
+		budget = framePeriod_ ? framePeriod_ : kDefaultFrameBudget;
+
+	uint64_t deadline = buffer->metadata().timestamp +
+			    static_cast<uint64_t>(budget.get<std::nano>());
+
+	beScheduler_->queueJob(this, deadline, [jobBuffers = std::move(jobBuffers)]() {
+		for (auto &[stream, b] : jobBuffers)
+			stream->queueBuffer(b);
+	});
 }
 
 void PiSPCameraData::tryRunPipeline()
 {
+	if (state_ == State::Idle && lookahead_.state != Lookahead::State::None) {
+		/*
+		 * The IPA has already been actioned for the request at the
+		 * head of the queue while the previous request was processed.
+		 * Pick up its results, or wait for them.
+		 */
+		state_ = State::Busy;
+
+		if (lookahead_.metadata)
+			RPi::CameraData::metadataReady(*lookahead_.metadata);
+
+		bool ready = lookahead_.state == Lookahead::State::Ready;
+		Lookahead lookahead = std::exchange(lookahead_, {});
+
+		if (ready)
+			prepareIspComplete(lookahead.buffers, lookahead.stitchSwapBuffers);
+
+		return;
+	}
+
 	/* If any of our request or buffer queues are empty, we cannot proceed. */
-	if (state_ != State::Idle || requestQueue_.empty() || !cfeJobComplete())
+	if (requestQueue_.empty() || !cfeJobComplete())
 		return;
 
-	CfeJob &job = cfeJobQueue_.front();
+	if (state_ == State::Idle) {
+		/* Take the first request from the queue and action the IPA. */
+		startIpaPrepare(requestQueue_.front(), cfeJobQueue_.front());
+		return;
+	}
 
-	/* Take the first request from the queue and action the IPA. */
-	Request *request = requestQueue_.front();
+	/*
+	 * Once the Backend job for the current request has been queued, the
+	 * IPA is free to prepare the next request. This overlaps the IPA
+	 * processing with the Backend processing. Dropped frames reuse the
+	 * current request, so don't look ahead while dropping frames.
+	 */
+	if (state_ == State::IpaComplete && !dropFrameCount_ &&
+	    lookahead_.state == Lookahead::State::None &&
+	    requestQueue_.size() > 1 && beEnabled_) {
+		lookahead_.state = Lookahead::State::Preparing;
+		startIpaPrepare(requestQueue_[1], cfeJobQueue_.front());
+	}
+}
 
+void PiSPCameraData::startIpaPrepare(Request *request, CfeJob &job)
+{
 	/* See if a new ScalerCrop value needs to be applied. */
 	applyScalerCrop(request->controls());
 
@@ -2194,7 +2055,8 @@ void PiSPCameraData::tryRunPipeline()
 	fillRequestMetadata(job.sensorControls, request);
 
 	/* Set our state to say the pipeline is active. */
-	state_ = State::Busy;
+	if (state_ == State::Idle)
+		state_ = State::Busy;
 
 	unsigned int bayerId = cfe_[Cfe::Output0].getBufferId(job.buffers[&cfe_[Cfe::Output0]]);
 	unsigned int statsId = cfe_[Cfe::Stats].getBufferId(job.buffers[&cfe_[Cfe::Stats]]);
@@ -2209,7 +2071,7 @@ void PiSPCameraData::tryRunPipeline()
 	params.buffers.bayer = RPi::MaskBayerData | bayerId;
 	params.buffers.stats = RPi::MaskStats | statsId;
 	params.buffers.embedded = 0;
-	params.ipaContext = requestQueue_.front()->sequence();
+	params.ipaContext = request->sequence();
 	params.delayContext = job.delayContext;
 	params.sensorControls = std::move(job.sensorControls);
 	params.requestControls = request->controls();
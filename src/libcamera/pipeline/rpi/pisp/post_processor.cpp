@@ -0,0 +1,467 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2023, Raspberry Pi Ltd
+ *
+ * post_processor.cpp - Software post-processing of PiSP Backend outputs
+ */
+
+#include "post_processor.h"
+
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <libcamera/base/log.h>
+
+#include <libcamera/formats.h>
+#include <libcamera/framebuffer.h>
+
+namespace libcamera {
+
+LOG_DECLARE_CATEGORY(RPI)
+
+using StreamFlag = RPi::Stream::StreamFlag;
+
+namespace {
+
+/*
+ * The row kernels below operate in place on a single line of the image. They
+ * consume the row from left to right and never write past the data they have
+ * already read, so no temporary line buffer is needed. The NEON paths round
+ * exactly like the scalar code ((a + b + 1) >> 1), which handles the tails.
+ */
+
+/* Halve a plane of 8-bit samples, width is the number of source samples. */
+void halvePlane(uint8_t *row, unsigned int width)
+{
+	const uint8_t *src = row;
+	uint8_t *dst = row;
+	unsigned int count = width / 2;
+
+#if defined(__ARM_NEON)
+	for (; count >= 16; count -= 16, src += 32, dst += 16) {
+		uint8x16x2_t in = vld2q_u8(src);
+		vst1q_u8(dst, vrhaddq_u8(in.val[0], in.val[1]));
+	}
+#endif
+
+	for (; count; count--, src += 2, dst++)
+		dst[0] = (src[0] + src[1] + 1) >> 1;
+}
+
+/* Halve a plane of interleaved 2-sample pixels, such as the NV12 UV plane. */
+void halveInterleaved2(uint8_t *row, unsigned int width)
+{
+	const uint8_t *src = row;
+	uint8_t *dst = row;
+	unsigned int count = width / 2;
+
+#if defined(__ARM_NEON)
+	for (; count >= 16; count -= 16, src += 64, dst += 32) {
+		uint8x16x4_t in = vld4q_u8(src);
+		uint8x16x2_t out;
+
+		out.val[0] = vrhaddq_u8(in.val[0], in.val[2]);
+		out.val[1] = vrhaddq_u8(in.val[1], in.val[3]);
+		vst2q_u8(dst, out);
+	}
+#endif
+
+	for (; count; count--, src += 4, dst += 2) {
+		dst[0] = (src[0] + src[2] + 1) >> 1;
+		dst[1] = (src[1] + src[3] + 1) >> 1;
+	}
+}
+
+void halveInterleaved3(uint8_t *row, unsigned int width)
+{
+	const uint8_t *src = row;
+	uint8_t *dst = row;
+	unsigned int count = width / 2;
+
+#if defined(__ARM_NEON)
+	for (; count >= 16; count -= 16, src += 96, dst += 48) {
+		uint8x16x3_t a = vld3q_u8(src);
+		uint8x16x3_t b = vld3q_u8(src + 48);
+		uint8x16x3_t out;
+
+		for (unsigned int c = 0; c < 3; c++) {
+			uint8x16x2_t p = vuzpq_u8(a.val[c], b.val[c]);
+			out.val[c] = vrhaddq_u8(p.val[0], p.val[1]);
+		}
+
+		vst3q_u8(dst, out);
+	}
+#endif
+
+	for (; count; count--, src += 6, dst += 3) {
+		dst[0] = (src[0] + src[3] + 1) >> 1;
+		dst[1] = (src[1] + src[4] + 1) >> 1;
+		dst[2] = (src[2] + src[5] + 1) >> 1;
+	}
+}
+
+void halveInterleaved4(uint8_t *row, unsigned int width)
+{
+	const uint8_t *src = row;
+	uint8_t *dst = row;
+	unsigned int count = width / 2;
+
+#if defined(__ARM_NEON)
+	for (; count >= 16; count -= 16, src += 128, dst += 64) {
+		uint8x16x4_t a = vld4q_u8(src);
+		uint8x16x4_t b = vld4q_u8(src + 64);
+		uint8x16x4_t out;
+
+		for (unsigned int c = 0; c < 4; c++) {
+			uint8x16x2_t p = vuzpq_u8(a.val[c], b.val[c]);
+			out.val[c] = vrhaddq_u8(p.val[0], p.val[1]);
+		}
+
+		vst4q_u8(dst, out);
+	}
+#endif
+
+	for (; count; count--, src += 8, dst += 4) {
+		dst[0] = (src[0] + src[4] + 1) >> 1;
+		dst[1] = (src[1] + src[5] + 1) >> 1;
+		dst[2] = (src[2] + src[6] + 1) >> 1;
+		dst[3] = (src[3] + src[7] + 1) >> 1;
+	}
+}
+
+/*
+ * Halve a row of packed YUV 4:2:2. Each group of 4 bytes holds two pixels,
+ * with the luma samples at offsets y0 and y0 + 2 and the chroma samples at
+ * offsets c0 and c0 + 2.
+ */
+template<unsigned int y0, unsigned int c0>
+void halveYuv422(uint8_t *row, unsigned int width)
+{
+	const uint8_t *src = row;
+	uint8_t *dst = row;
+	unsigned int count = width / 4;
+
+#if defined(__ARM_NEON)
+	for (; count >= 16; count -= 16, src += 128, dst += 64) {
+		uint8x16x4_t a = vld4q_u8(src);
+		uint8x16x4_t b = vld4q_u8(src + 64);
+		uint8x16x4_t out;
+
+		/* Average the two luma samples of each source group. */
+		uint8x16x2_t y = vuzpq_u8(vrhaddq_u8(a.val[y0], a.val[y0 + 2]),
+					  vrhaddq_u8(b.val[y0], b.val[y0 + 2]));
+		out.val[y0] = y.val[0];
+		out.val[y0 + 2] = y.val[1];
+
+		/* Average the chroma samples of consecutive source groups. */
+		for (unsigned int c = c0; c < 4; c += 2) {
+			uint8x16x2_t p = vuzpq_u8(a.val[c], b.val[c]);
+			out.val[c] = vrhaddq_u8(p.val[0], p.val[1]);
+		}
+
+		vst4q_u8(dst, out);
+	}
+#endif
+
+	for (; count; count--, src += 8, dst += 4) {
+		dst[y0] = (src[y0] + src[y0 + 2] + 1) >> 1;
+		dst[y0 + 2] = (src[y0 + 4] + src[y0 + 6] + 1) >> 1;
+		dst[c0] = (src[c0] + src[c0 + 4] + 1) >> 1;
+		dst[c0 + 2] = (src[c0 + 2] + src[c0 + 6] + 1) >> 1;
+	}
+}
+
+/*
+ * Expand a row of 24bpp pixels to 32bpp with an opaque alpha channel, from
+ * right to left. The NEON path processes blocks of 16 pixels, the stride must
+ * thus be large enough to hold the width rounded up to 16 pixels.
+ */
+void expand24To32(uint8_t *row, unsigned int width)
+{
+#if defined(__ARM_NEON)
+	unsigned int count = (width + 15) / 16;
+	const uint8_t *src = row + count * 48;
+	uint8_t *dst = row + count * 64;
+	uint8x16x4_t out;
+
+	out.val[3] = vdupq_n_u8(255);
+
+	for (; count; count--) {
+		src -= 48;
+		dst -= 64;
+
+		uint8x16x3_t in = vld3q_u8(src);
+		out.val[0] = in.val[0];
+		out.val[1] = in.val[1];
+		out.val[2] = in.val[2];
+		vst4q_u8(dst, out);
+	}
+#else
+	const uint8_t *src = row + width * 3;
+	uint8_t *dst = row + width * 4;
+
+	for (unsigned int i = width; i; i--) {
+		src -= 3;
+		dst -= 4;
+
+		dst[3] = 255;
+		dst[2] = src[2];
+		dst[1] = src[1];
+		dst[0] = src[0];
+	}
+#endif
+}
+
+} /* namespace */
+
+/**
+ * \class PiSPPostProcessor
+ * \brief Apply software downscaling and 24bpp to 32bpp conversion to the
+ * PiSP Backend outputs
+ *
+ * The Backend can't downscale by more than a fixed factor, and some devices
+ * can't produce 32bpp RGB formats. The missing processing is applied in place
+ * in the output buffers, in software.
+ *
+ * The rows of the image are independent, and are split in strips processed
+ * by a ThreadPool. Buffers are processed asynchronously, and the bufferReady
+ * signal is emitted in the thread of the post-processor, in the order in
+ * which the buffers have been queued.
+ */
+
+PiSPPostProcessor::PiSPPostProcessor()
+	: frames_(0), cpuTime_(0), latency_(0),
+	  pool_("PiSPPostProc", kMaxThreads)
+{
+}
+
+PiSPPostProcessor::~PiSPPostProcessor()
+{
+	stop();
+}
+
+/**
+ * \brief Check if the buffers of a stream need software post-processing
+ * \param[in] stream The stream
+ * \return True if the buffers of \a stream must be queued to the
+ * post-processor, false otherwise
+ */
+bool PiSPPostProcessor::needsProcessing(const RPi::Stream *stream)
+{
+	return stream->swDownscale() > 1 ||
+	       (stream->getFlags() & StreamFlag::Needs32bitConv);
+}
+
+/**
+ * \brief Start post-processing
+ */
+void PiSPPostProcessor::start()
+{
+	frames_ = 0;
+	cpuTime_ = {};
+	latency_ = {};
+}
+
+/**
+ * \brief Stop post-processing
+ *
+ * Wait for the buffers being processed to complete, and drop all queued jobs
+ * without emitting the bufferReady signal. The caller is responsible for
+ * returning the buffers, as when stopping streaming with buffers still queued
+ * to the device.
+ *
+ * The average cost of the frames processed since the post-processor has been
+ * started is logged, to help comparing with configurations where the Backend
+ * produces the final format directly.
+ */
+void PiSPPostProcessor::stop()
+{
+	using std::chrono::microseconds;
+
+	if (frames_) {
+		LOG(RPI, Info)
+			<< "Software post-processing of " << frames_ << " frames: "
+			<< std::chrono::duration_cast<microseconds>(cpuTime_).count() / frames_
+			<< "us CPU time, "
+			<< std::chrono::duration_cast<microseconds>(latency_).count() / frames_
+			<< "us latency per frame";
+		frames_ = 0;
+	}
+
+	pool_.wait();
+
+	queue_ = {};
+}
+
+/**
+ * \brief Queue a stream buffer for post-processing
+ * \param[in] buffer The buffer
+ * \param[in] stream The stream the buffer belongs to
+ * \param[in] index The buffer index in the stream
+ *
+ * The buffer must be mapped by the stream. If the stream format isn't
+ * supported, the buffer is completed without processing.
+ */
+void PiSPPostProcessor::queueBuffer(FrameBuffer *buffer, RPi::Stream *stream,
+				    unsigned int index)
+{
+	const RPi::BufferObject &b = stream->getBuffer(index);
+	ASSERT(b.mapped);
+
+	std::unique_ptr<Job> job = std::make_unique<Job>();
+	job->buffer = buffer;
+	job->stream = stream;
+
+	if (stream->swDownscale() > 1 &&
+	    !addDownscale(job->operations, stream, b)) {
+		LOG(RPI, Error) << "Sw downscale unsupported for "
+				<< stream->configuration().pixelFormat;
+		job->operations.clear();
+	}
+
+	/* Convert 24bpp outputs to 32bpp outputs where necessary. */
+	if (stream->getFlags() & StreamFlag::Needs32bitConv) {
+		const StreamConfiguration &cfg = stream->configuration();
+
+		job->operations.push_back({ expand24To32,
+					    b.mapped->planes()[0].data(),
+					    cfg.size.width, cfg.size.height,
+					    cfg.stride });
+	}
+
+	if (!job->operations.empty())
+		job->syncer.emplace(buffer->planes()[0].fd);
+
+	job->done = false;
+	job->queued = std::chrono::steady_clock::now();
+	job->cpuTime = 0;
+
+	Job *ptr = job.get();
+	queue_.push(std::move(job));
+
+	pool_.queueStrips([ptr](unsigned int strip, unsigned int count) {
+		processStrip(ptr, strip, count);
+	}, [this, ptr]() {
+		ptr->done.store(true, std::memory_order_release);
+		invokeMethod(&PiSPPostProcessor::jobDone, ConnectionTypeQueued);
+	});
+}
+
+/**
+ * \var PiSPPostProcessor::bufferReady
+ * \brief A signal emitted when a buffer has been processed
+ */
+
+bool PiSPPostProcessor::addDownscale(std::vector<Operation> &operations,
+				     const RPi::Stream *stream,
+				     const RPi::BufferObject &buffer)
+{
+	const StreamConfiguration &cfg = stream->configuration();
+	const PixelFormat &pixFormat = cfg.pixelFormat;
+	unsigned int downscale = stream->swDownscale();
+	unsigned int height = cfg.size.height;
+	unsigned int stride = cfg.stride;
+
+	/* Must be a power of 2. */
+	ASSERT((downscale & (downscale - 1)) == 0);
+
+	/*
+	 * The multi-planar formats look "multiplanar" even when they're a
+	 * single allocation, so the plane pointers work for everyone.
+	 */
+	const auto &planes = buffer.mapped->planes();
+
+	/* Do repeated downscale-by-2 in place until we're done. */
+	for (; downscale > 1; downscale >>= 1) {
+		unsigned int width = downscale * cfg.size.width;
+
+		if (pixFormat == formats::RGB888 || pixFormat == formats::BGR888) {
+			operations.push_back({ halveInterleaved3, planes[0].data(),
+					       width, height, stride });
+		} else if (pixFormat == formats::XRGB8888 || pixFormat == formats::XBGR8888) {
+			/* On some devices these may actually be 24bpp at this point. */
+			if (stream->getFlags() & StreamFlag::Needs32bitConv)
+				operations.push_back({ halveInterleaved3, planes[0].data(),
+						       width, height, stride });
+			else
+				operations.push_back({ halveInterleaved4, planes[0].data(),
+						       width, height, stride });
+		} else if (pixFormat == formats::YUV420 || pixFormat == formats::YVU420 ||
+			   pixFormat == formats::YUV422 || pixFormat == formats::YVU422) {
+			bool is420 = pixFormat == formats::YUV420 ||
+				     pixFormat == formats::YVU420;
+			unsigned int chromaHeight = is420 ? height / 2 : height;
+
+			operations.push_back({ halvePlane, planes[0].data(),
+					       width, height, stride });
+			for (unsigned int i = 1; i < 3; i++)
+				operations.push_back({ halvePlane, planes[i].data(),
+						       width / 2, chromaHeight,
+						       stride / 2 });
+		} else if (pixFormat == formats::YUYV || pixFormat == formats::YVYU) {
+			operations.push_back({ halveYuv422<0, 1>, planes[0].data(),
+					       width, height, stride });
+		} else if (pixFormat == formats::UYVY || pixFormat == formats::VYUY) {
+			operations.push_back({ halveYuv422<1, 0>, planes[0].data(),
+					       width, height, stride });
+		} else if (pixFormat == formats::NV12 || pixFormat == formats::NV21) {
+			operations.push_back({ halvePlane, planes[0].data(),
+					       width, height, stride });
+			operations.push_back({ halveInterleaved2, planes[1].data(),
+					       width / 2, height / 2, stride });
+		} else {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void PiSPPostProcessor::processStrip(Job *job, unsigned int index,
+				     unsigned int count)
+{
+	/*
+	 * Each strip covers the same share of rows of every operation.
+	 * Successive downscale passes on a plane thus only depend on rows
+	 * processed previously for the same strip.
+	 */
+	auto begin = std::chrono::steady_clock::now();
+
+	for (const Operation &op : job->operations) {
+		unsigned int start = op.height * index / count;
+		unsigned int end = op.height * (index + 1) / count;
+
+		for (unsigned int y = start; y < end; y++)
+			op.kernel(op.mem + y * op.stride, op.width);
+	}
+
+	std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - begin;
+	job->cpuTime.fetch_add(elapsed.count(), std::memory_order_relaxed);
+}
+
+/*
+ * Complete the jobs at the head of the queue whose rows have all been
+ * processed. Jobs may finish out of order, but are completed in the order
+ * they have been queued.
+ */
+void PiSPPostProcessor::jobDone()
+{
+	while (!queue_.empty() &&
+	       queue_.front()->done.load(std::memory_order_acquire)) {
+		std::unique_ptr<Job> job = std::move(queue_.front());
+		queue_.pop();
+
+		/* End CPU access before handing the buffer back. */
+		job->syncer.reset();
+
+		frames_++;
+		cpuTime_ += std::chrono::nanoseconds(job->cpuTime.load(std::memory_order_relaxed));
+		latency_ += std::chrono::steady_clock::now() - job->queued;
+
+		bufferReady.emit(job->buffer, job->stream);
+	}
+}
+
+} /* namespace libcamera */
@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2023, Raspberry Pi Ltd
+ *
+ * post_processor.h - Software post-processing of PiSP Backend outputs
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <stdint.h>
+#include <vector>
+
+#include <libcamera/base/object.h>
+#include <libcamera/base/signal.h>
+
+#include "libcamera/internal/dma_buf_allocator.h"
+#include "libcamera/internal/thread_pool.h"
+
+#include "../common/rpi_stream.h"
+
+namespace libcamera {
+
+class FrameBuffer;
+
+class PiSPPostProcessor : public Object
+{
+public:
+	PiSPPostProcessor();
+	~PiSPPostProcessor();
+
+	static bool needsProcessing(const RPi::Stream *stream);
+
+	void start();
+	void stop();
+
+	void queueBuffer(FrameBuffer *buffer, RPi::Stream *stream,
+			 unsigned int index);
+
+	Signal<FrameBuffer *, RPi::Stream *> bufferReady;
+
+private:
+	static constexpr unsigned int kMaxThreads = 4;
+
+	struct Operation {
+		void (*kernel)(uint8_t *row, unsigned int width);
+		uint8_t *mem;
+		unsigned int width;
+		unsigned int height;
+		unsigned int stride;
+	};
+
+	struct Job {
+		FrameBuffer *buffer;
+		RPi::Stream *stream;
+
+		std::vector<Operation> operations;
+		std::optional<DmaSyncer> syncer;
+		std::atomic<bool> done;
+
+		std::chrono::steady_clock::time_point queued;
+		std::atomic<uint64_t> cpuTime;
+	};
+
+	static bool addDownscale(std::vector<Operation> &operations,
+				 const RPi::Stream *stream,
+				 const RPi::BufferObject &buffer);
+
+	static void processStrip(Job *job, unsigned int index, unsigned int count);
+	void jobDone();
+
+	std::queue<std::unique_ptr<Job>> queue_;
+
+	unsigned int frames_;
+	std::chrono::nanoseconds cpuTime_;
+	std::chrono::nanoseconds latency_;
+
+	ThreadPool pool_;
+};
+
+} /* namespace libcamera */
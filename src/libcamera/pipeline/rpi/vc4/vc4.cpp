@@ -12,11 +12,11 @@
 #include <libcamera/formats.h>
 
 #include "libcamera/internal/device_enumerator.h"
+#include "libcamera/internal/dma_buf_allocator.h"
 
 #include "../common/pipeline_base.h"
 #include "../common/rpi_stream.h"
 
-#include "dma_heaps.h"
 
 using namespace std::chrono_literals;
 
@@ -87,7 +87,7 @@ public:
 	RPi::Device<Isp, 4> isp_;
 
 	/* DMAHEAP allocation helper. */
-	RPi::DmaHeap dmaHeap_;
+	DmaBufAllocator dmaHeap_;
 	SharedFD lsTable_;
 
 	struct Config {
@@ -230,7 +230,8 @@ int PipelineHandlerVc4::prepareBuffers(Camera *camera)
 {
 	Vc4CameraData *data = cameraData(camera);
 	unsigned int minUnicamBuffers = data->config_.minUnicamBuffers;
-	unsigned int minTotalUnicamBuffers = data->config_.minTotalUnicamBuffers;
+	unsigned int minTotalUnicamBuffers =
+		data->frontendBufferTarget(data->config_.minTotalUnicamBuffers);
 	unsigned int numRawBuffers = 0, minIspBuffers = 1;
 	int ret;
 
@@ -271,6 +272,7 @@ int PipelineHandlerVc4::prepareBuffers(Camera *camera)
 	}
 
 	/* Decide how many internal buffers to allocate. */
+	std::vector<std::pair<RPi::Stream *, unsigned int>> streams;
 	for (auto const stream : data->streams_) {
 		unsigned int numBuffers;
 		/*
@@ -332,11 +334,13 @@ int PipelineHandlerVc4::prepareBuffers(Camera *camera)
 		LOG(RPI, Debug) << "Preparing " << numBuffers
 				<< " buffers for stream " << stream->name();
 
-		ret = stream->prepareBuffers(numBuffers);
-		if (ret < 0)
-			return ret;
+		streams.emplace_back(stream, numBuffers);
 	}
 
+	ret = prepareStreamBuffers(streams);
+	if (ret < 0)
+		return ret;
+
 	/*
 	 * Pass the stats and embedded data buffers to the IPA. No other
 	 * buffers need to be passed.
@@ -813,7 +817,9 @@ void Vc4CameraData::unicamBufferDequeue(FrameBuffer *buffer)
 		 * Lookup the sensor controls used for this frame sequence from
 		 * DelayedControl and queue them along with the frame buffer.
 		 */
-		auto [ctrl, delayContext] = delayedCtrls_->get(buffer->metadata().sequence);
+		uint32_t sequence = buffer->metadata().sequence;
+		ControlList ctrl = delayedCtrls_->get(sequence);
+		unsigned int delayContext = delayedCtrls_->cookie(sequence);
 		/*
 		 * Add the frame timestamp to the ControlList for the IPA to use
 		 * as it does not receive the FrameBuffer object.
@@ -821,6 +827,8 @@ void Vc4CameraData::unicamBufferDequeue(FrameBuffer *buffer)
 		ctrl.set(controls::SensorTimestamp, buffer->metadata().timestamp);
 		bayerQueue_.push({ buffer, std::move(ctrl), delayContext });
 	} else {
+		/* Parse the embedded data while waiting for the Bayer frame. */
+		ipa_->parseEmbeddedData(RPi::MaskEmbeddedData | index);
 		embeddedQueue_.push(buffer);
 	}
 
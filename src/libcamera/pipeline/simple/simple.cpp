@@ -11,6 +11,7 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <optional>
 #include <queue>
 #include <set>
 #include <string>
@@ -20,18 +21,25 @@
 #include <vector>
 
 #include <linux/media-bus-format.h>
+#include <linux/v4l2-controls.h>
 
 #include <libcamera/base/log.h>
+#include <libcamera/base/utils.h>
 
 #include <libcamera/camera.h>
 #include <libcamera/control_ids.h>
+#include <libcamera/ipa/soft_ipa_interface.h>
+#include <libcamera/ipa/soft_ipa_proxy.h>
 #include <libcamera/request.h>
 #include <libcamera/stream.h>
 
 #include "libcamera/internal/camera.h"
 #include "libcamera/internal/camera_sensor.h"
 #include "libcamera/internal/converter.h"
+#include "libcamera/internal/converter/converter_software.h"
 #include "libcamera/internal/device_enumerator.h"
+#include "libcamera/internal/framebuffer.h"
+#include "libcamera/internal/ipa_manager.h"
 #include "libcamera/internal/media_device.h"
 #include "libcamera/internal/pipeline_handler.h"
 #include "libcamera/internal/v4l2_subdevice.h"
@@ -153,6 +161,13 @@ LOG_DEFINE_CATEGORY(SimplePipeline)
  * the capture video node, and stores the information in the outputFormats and
  * outputSizes of the SimpleCameraData::Configuration structure.
  *
+ * Platforms without a memory-to-memory converter can instead use the software
+ * converter, which debayers raw images on the CPU, when enabled in the list of
+ * supported devices. Raw formats are then converted to RGB with the same
+ * output size as the capture size. The GPU converter can be selected instead
+ * with the LIBCAMERA_SIMPLE_CONVERTER environment variable, to debayer and
+ * scale images with OpenGL ES shaders.
+ *
  * Concurrent Access to Cameras
  * ----------------------------
  *
@@ -185,17 +200,22 @@ struct SimplePipelineInfo {
 	 * and the number of streams it supports.
 	 */
 	std::vector<std::pair<const char *, unsigned int>> converters;
+	/*
+	 * Whether to fall back to the CPU-based software converter when no
+	 * hardware converter is available.
+	 */
+	bool swIspEnabled;
 };
 
 namespace {
 
 static const SimplePipelineInfo supportedDevices[] = {
-	{ "dcmipp", {} },
-	{ "imx7-csi", { { "pxp", 1 } } },
-	{ "j721e-csi2rx", {} },
-	{ "mxc-isi", {} },
-	{ "qcom-camss", {} },
-	{ "sun6i-csi", {} },
+	{ "dcmipp", {}, false },
+	{ "imx7-csi", { { "pxp", 1 } }, false },
+	{ "j721e-csi2rx", {}, false },
+	{ "mxc-isi", {}, false },
+	{ "qcom-camss", {}, true },
+	{ "sun6i-csi", {}, true },
 };
 
 } /* namespace */
@@ -216,6 +236,9 @@ public:
 			 V4L2Subdevice::Whence whence,
 			 Transform transform = Transform::Identity);
 	void bufferReady(FrameBuffer *buffer);
+	void queueCaptures();
+	void cancelCapture(Request *request, FrameBuffer *capture,
+			   const std::map<unsigned int, FrameBuffer *> &outputs);
 
 	unsigned int streamIndex(const Stream *stream) const
 	{
@@ -271,20 +294,49 @@ public:
 
 	std::unique_ptr<Converter> converter_;
 	std::vector<std::unique_ptr<FrameBuffer>> converterBuffers_;
+	unsigned int numConverterBuffers_;
 	bool useConverter_;
 	std::queue<std::map<unsigned int, FrameBuffer *>> converterQueue_;
 
+	/*
+	 * When a stream is captured without conversion alongside converted
+	 * streams, each request is captured to its own buffer: the request
+	 * buffer of the direct stream, or a free internal buffer.
+	 */
+	struct CaptureJob {
+		Request *request;
+		FrameBuffer *capture;
+		std::map<unsigned int, FrameBuffer *> outputs;
+	};
+
+	std::optional<unsigned int> directStream_;
+	std::queue<FrameBuffer *> availableBuffers_;
+	std::queue<CaptureJob> pendingJobs_;
+	std::queue<CaptureJob> captureJobs_;
+
+	std::unique_ptr<ipa::soft::IPAProxySoft> ipa_;
+
 private:
 	void tryPipeline(unsigned int code, const Size &size);
+	void directBufferReady(FrameBuffer *buffer);
 	static std::vector<const MediaPad *> routedSourcePads(MediaPad *sink);
+	int loadIPA(const SharedFD &statistics);
 
 	void converterInputDone(FrameBuffer *buffer);
 	void converterOutputDone(FrameBuffer *buffer);
+	void statisticsReady(uint32_t frame);
+	void setSensorControls(const ControlList &sensorControls);
 };
 
 class SimpleCameraConfiguration : public CameraConfiguration
 {
 public:
+	/*
+	 * Internal buffers store full frames captured from the sensor, cap
+	 * their number to limit memory usage.
+	 */
+	static constexpr unsigned int kMaxInternalBuffers = 8;
+
 	SimpleCameraConfiguration(Camera *camera, SimpleCameraData *data);
 
 	Status validate() override;
@@ -295,6 +347,7 @@ public:
 	}
 
 	bool needConversion() const { return needConversion_; }
+	std::optional<unsigned int> directStream() const { return directStream_; }
 	const Transform &combinedTransform() const { return combinedTransform_; }
 
 private:
@@ -308,6 +361,7 @@ private:
 
 	const SimpleCameraData::Configuration *pipeConfig_;
 	bool needConversion_;
+	std::optional<unsigned int> directStream_;
 	Transform combinedTransform_;
 };
 
@@ -331,6 +385,7 @@ public:
 	V4L2VideoDevice *video(const MediaEntity *entity);
 	V4L2Subdevice *subdev(const MediaEntity *entity);
 	MediaDevice *converter() { return converter_; }
+	bool swIspEnabled() const { return swIspEnabled_; }
 
 protected:
 	int queueRequestDevice(Camera *camera, Request *request) override;
@@ -359,6 +414,7 @@ private:
 	std::map<const MediaEntity *, EntityData> entities_;
 
 	MediaDevice *converter_;
+	bool swIspEnabled_;
 };
 
 /* -----------------------------------------------------------------------------
@@ -368,7 +424,7 @@ private:
 SimpleCameraData::SimpleCameraData(SimplePipelineHandler *pipe,
 				   unsigned int numStreams,
 				   MediaEntity *sensor)
-	: Camera::Private(pipe), streams_(numStreams)
+	: Camera::Private(pipe), streams_(numStreams), numConverterBuffers_(0)
 {
 	int ret;
 
@@ -506,8 +562,49 @@ int SimpleCameraData::init()
 			converter_->inputBufferReady.connect(this, &SimpleCameraData::converterInputDone);
 			converter_->outputBufferReady.connect(this, &SimpleCameraData::converterOutputDone);
 		}
+	} else if (pipe->swIspEnabled()) {
+		/*
+		 * Default to the software converter, which computes statistics
+		 * for auto exposure, and allow selecting the GPU converter to
+		 * offload processing from the CPU.
+		 */
+		const char *name = utils::secure_getenv("LIBCAMERA_SIMPLE_CONVERTER");
+		std::string converterName = name ? name : "software";
+
+		converter_ = ConverterFactoryBase::create(converterName);
+		if (!converter_) {
+			LOG(SimplePipeline, Warning)
+				<< "Failed to create " << converterName
+				<< " converter, disabling format conversion";
+		} else {
+			converter_->inputBufferReady.connect(this, &SimpleCameraData::converterInputDone);
+			converter_->outputBufferReady.connect(this, &SimpleCameraData::converterOutputDone);
+		}
+
+		if (converter_ && converterName == "software") {
+			/*
+			 * The software converter has no hardware ISP to control
+			 * the sensor exposure. Load the IPA module to run auto
+			 * exposure on the statistics it computes.
+			 */
+			SoftwareConverter *swConverter =
+				static_cast<SoftwareConverter *>(converter_.get());
+			swConverter->statisticsReady.connect(this, &SimpleCameraData::statisticsReady);
+
+			ret = loadIPA(swConverter->statistics());
+			if (ret < 0)
+				LOG(SimplePipeline, Warning)
+					<< "Failed to load IPA, disabling auto exposure";
+		}
 	}
 
+	/*
+	 * With a converter, one additional stream can be captured without
+	 * conversion alongside the converted streams. Without a converter,
+	 * only a single stream can be captured.
+	 */
+	streams_.resize(converter_ ? streams_.size() + 1 : 1);
+
 	video_ = pipe->video(entities_.back().entity);
 	ASSERT(video_);
 
@@ -598,14 +695,21 @@ void SimpleCameraData::tryPipeline(unsigned int code, const Size &size)
 		config.captureFormat = pixelFormat;
 		config.captureSize = format.size;
 
-		if (!converter_) {
-			config.outputFormats = { pixelFormat };
-			config.outputSizes = config.captureSize;
-		} else {
+		if (converter_) {
 			config.outputFormats = converter_->formats(pixelFormat);
 			config.outputSizes = converter_->sizes(format.size);
 		}
 
+		/*
+		 * Capture formats that the converter can't process, such as
+		 * non-Bayer formats with the software converter, are captured
+		 * directly.
+		 */
+		if (config.outputFormats.empty()) {
+			config.outputFormats = { pixelFormat };
+			config.outputSizes = config.captureSize;
+		}
+
 		configs_.push_back(config);
 	}
 }
@@ -734,6 +838,13 @@ void SimpleCameraData::bufferReady(FrameBuffer *buffer)
 {
 	SimplePipelineHandler *pipe = SimpleCameraData::pipe();
 
+	pipe->framesDropped(_o<Camera>(), video_->lastFrameDrops());
+
+	if (directStream_) {
+		directBufferReady(buffer);
+		return;
+	}
+
 	/*
 	 * If an error occurred during capture, or if the buffer was cancelled,
 	 * complete the request, even if the converter is in use as there's no
@@ -817,8 +928,134 @@ void SimpleCameraData::bufferReady(FrameBuffer *buffer)
 	pipe->completeRequest(request);
 }
 
+/*
+ * Capture completion handler when a stream is captured without conversion
+ * alongside converted streams. Each captured buffer corresponds to the oldest
+ * capture job, complete the direct stream buffer right away if the request
+ * has no converted stream, or hand the captured buffer to the converter to
+ * produce all the converted streams in a single job.
+ */
+void SimpleCameraData::directBufferReady(FrameBuffer *buffer)
+{
+	SimplePipelineHandler *pipe = SimpleCameraData::pipe();
+
+	ASSERT(!captureJobs_.empty());
+	CaptureJob job = std::move(captureJobs_.front());
+	captureJobs_.pop();
+
+	if (buffer->metadata().status != FrameMetadata::FrameSuccess) {
+		cancelCapture(job.request, job.capture, job.outputs);
+
+		if (buffer->metadata().status != FrameMetadata::FrameCancelled)
+			queueCaptures();
+		return;
+	}
+
+	job.request->metadata().set(controls::SensorTimestamp,
+				    buffer->metadata().timestamp);
+
+	if (job.outputs.empty()) {
+		pipe->completeBuffer(job.request, buffer);
+		pipe->completeRequest(job.request);
+		return;
+	}
+
+	converter_->queueBuffers(buffer, job.outputs);
+}
+
+/*
+ * Queue capture jobs to the video device, assigning internal buffers to the
+ * jobs whose request has no buffer for the direct stream. Jobs wait in the
+ * pending queue until an internal buffer is released by the converter.
+ */
+void SimpleCameraData::queueCaptures()
+{
+	while (!pendingJobs_.empty()) {
+		CaptureJob &job = pendingJobs_.front();
+
+		if (!job.capture) {
+			if (availableBuffers_.empty())
+				return;
+
+			job.capture = availableBuffers_.front();
+			availableBuffers_.pop();
+		}
+
+		int ret = video_->queueBuffer(job.capture);
+		if (ret < 0) {
+			LOG(SimplePipeline, Error)
+				<< "Failed to queue capture buffer: "
+				<< strerror(-ret);
+			cancelCapture(job.request, job.capture, job.outputs);
+		} else {
+			captureJobs_.push(std::move(job));
+		}
+
+		pendingJobs_.pop();
+	}
+}
+
+/*
+ * Complete a request whose capture has failed or has been cancelled,
+ * returning the internal capture buffer, if any, to the free buffers.
+ */
+void SimpleCameraData::cancelCapture(Request *request, FrameBuffer *capture,
+				     const std::map<unsigned int, FrameBuffer *> &outputs)
+{
+	SimplePipelineHandler *pipe = SimpleCameraData::pipe();
+
+	for (const auto &[index, output] : outputs) {
+		output->_d()->cancel();
+		pipe->completeBuffer(request, output);
+	}
+
+	if (capture && capture->request()) {
+		capture->_d()->cancel();
+		pipe->completeBuffer(request, capture);
+	} else if (capture) {
+		availableBuffers_.push(capture);
+	}
+
+	pipe->completeRequest(request);
+}
+
+int SimpleCameraData::loadIPA(const SharedFD &statistics)
+{
+	ipa_ = IPAManager::createIPA<ipa::soft::IPAProxySoft>(pipe(), 0, 0);
+	if (!ipa_)
+		return -ENOENT;
+
+	ipa_->setSensorControls.connect(this, &SimpleCameraData::setSensorControls);
+
+	int ret = ipa_->init(IPASettings{ "", sensor_->model() }, statistics,
+			     sensor_->controls());
+	if (ret < 0) {
+		ipa_.reset();
+		return ret;
+	}
+
+	return 0;
+}
+
 void SimpleCameraData::converterInputDone(FrameBuffer *buffer)
 {
+	if (directStream_) {
+		/*
+		 * Complete the direct stream buffer, or release the internal
+		 * buffer for the next capture jobs.
+		 */
+		Request *request = buffer->request();
+		if (request) {
+			SimplePipelineHandler *pipe = SimpleCameraData::pipe();
+			if (pipe->completeBuffer(request, buffer))
+				pipe->completeRequest(request);
+		} else {
+			availableBuffers_.push(buffer);
+			queueCaptures();
+		}
+		return;
+	}
+
 	/* Queue the input buffer back for capture. */
 	video_->queueBuffer(buffer);
 }
@@ -833,6 +1070,22 @@ void SimpleCameraData::converterOutputDone(FrameBuffer *buffer)
 		pipe->completeRequest(request);
 }
 
+void SimpleCameraData::statisticsReady(uint32_t frame)
+{
+	if (!ipa_)
+		return;
+
+	ControlList sensorControls =
+		sensor_->getControls({ V4L2_CID_EXPOSURE, V4L2_CID_ANALOGUE_GAIN });
+	ipa_->processStats(frame, sensorControls);
+}
+
+void SimpleCameraData::setSensorControls(const ControlList &sensorControls)
+{
+	ControlList controls = sensorControls;
+	sensor_->setControls(&controls);
+}
+
 /* Retrieve all source pads connected to a sink pad through active routes. */
 std::vector<const MediaPad *> SimpleCameraData::routedSourcePads(MediaPad *sink)
 {
@@ -970,47 +1223,78 @@ CameraConfiguration::Status SimpleCameraConfiguration::validate()
 	 * Enable usage of the converter when producing multiple streams, as
 	 * the video capture device can't capture to multiple buffers.
 	 *
-	 * It is possible to produce up to one stream without conversion
-	 * (provided the format and size match), at the expense of more complex
-	 * buffer handling (including allocation of internal buffers to be used
-	 * when a request doesn't contain a buffer for the stream that doesn't
-	 * require any conversion, similar to raw capture use cases). This is
-	 * left as a future improvement.
+	 * Up to one stream can be produced without conversion, when it
+	 * requests the capture format, similar to raw capture use cases. The
+	 * other streams are then produced by the converter from the same
+	 * captured frame. When all streams request conversion but the
+	 * converter can't produce them all, capture the last stream directly.
 	 */
-	needConversion_ = config_.size() > 1;
+	const unsigned int maxDirectIndex =
+		config_.size() < data_->streams_.size() ? config_.size() : config_.size() - 1;
+
+	directStream_.reset();
+	needConversion_ = false;
 
 	for (unsigned int i = 0; i < config_.size(); ++i) {
 		StreamConfiguration &cfg = config_[i];
-
-		/* Adjust the pixel format and size. */
-		auto it = std::find(pipeConfig_->outputFormats.begin(),
-				    pipeConfig_->outputFormats.end(),
-				    cfg.pixelFormat);
-		if (it == pipeConfig_->outputFormats.end())
-			it = pipeConfig_->outputFormats.begin();
-
-		PixelFormat pixelFormat = *it;
-		if (cfg.pixelFormat != pixelFormat) {
-			LOG(SimplePipeline, Debug) << "Adjusting pixel format";
-			cfg.pixelFormat = pixelFormat;
-			status = Adjusted;
+		bool direct = false;
+
+		if (!directStream_) {
+			bool converterScales =
+				std::find(pipeConfig_->outputFormats.begin(),
+					  pipeConfig_->outputFormats.end(),
+					  cfg.pixelFormat) != pipeConfig_->outputFormats.end() &&
+				cfg.size != pipeConfig_->captureSize;
+
+			direct = (cfg.pixelFormat == pipeConfig_->captureFormat &&
+				  !converterScales) ||
+				 i == maxDirectIndex;
 		}
 
-		if (!pipeConfig_->outputSizes.contains(cfg.size)) {
-			LOG(SimplePipeline, Debug)
-				<< "Adjusting size from " << cfg.size
-				<< " to " << pipeConfig_->captureSize;
-			cfg.size = pipeConfig_->captureSize;
-			status = Adjusted;
-		}
+		if (direct) {
+			directStream_ = i;
+
+			if (cfg.pixelFormat != pipeConfig_->captureFormat) {
+				LOG(SimplePipeline, Debug) << "Adjusting pixel format";
+				cfg.pixelFormat = pipeConfig_->captureFormat;
+				status = Adjusted;
+			}
+
+			if (cfg.size != pipeConfig_->captureSize) {
+				LOG(SimplePipeline, Debug)
+					<< "Adjusting size from " << cfg.size
+					<< " to " << pipeConfig_->captureSize;
+				cfg.size = pipeConfig_->captureSize;
+				status = Adjusted;
+			}
+		} else {
+			/* Adjust the pixel format and size. */
+			auto it = std::find(pipeConfig_->outputFormats.begin(),
+					    pipeConfig_->outputFormats.end(),
+					    cfg.pixelFormat);
+			if (it == pipeConfig_->outputFormats.end())
+				it = pipeConfig_->outputFormats.begin();
+
+			PixelFormat pixelFormat = *it;
+			if (cfg.pixelFormat != pixelFormat) {
+				LOG(SimplePipeline, Debug) << "Adjusting pixel format";
+				cfg.pixelFormat = pixelFormat;
+				status = Adjusted;
+			}
+
+			if (!pipeConfig_->outputSizes.contains(cfg.size)) {
+				LOG(SimplePipeline, Debug)
+					<< "Adjusting size from " << cfg.size
+					<< " to " << pipeConfig_->captureSize;
+				cfg.size = pipeConfig_->captureSize;
+				status = Adjusted;
+			}
 
-		/* \todo Create a libcamera core class to group format and size */
-		if (cfg.pixelFormat != pipeConfig_->captureFormat ||
-		    cfg.size != pipeConfig_->captureSize)
 			needConversion_ = true;
+		}
 
 		/* Set the stride, frameSize and bufferCount. */
-		if (needConversion_) {
+		if (!direct) {
 			std::tie(cfg.stride, cfg.frameSize) =
 				data_->converter_->strideAndFrameSize(cfg.pixelFormat,
 								      cfg.size);
@@ -1032,6 +1316,11 @@ CameraConfiguration::Status SimpleCameraConfiguration::validate()
 		cfg.bufferCount = 3;
 	}
 
+	if (internalBufferCount > kMaxInternalBuffers) {
+		internalBufferCount = kMaxInternalBuffers;
+		status = Adjusted;
+	}
+
 	return status;
 }
 
@@ -1040,7 +1329,7 @@ CameraConfiguration::Status SimpleCameraConfiguration::validate()
  */
 
 SimplePipelineHandler::SimplePipelineHandler(CameraManager *manager)
-	: PipelineHandler(manager), converter_(nullptr)
+	: PipelineHandler(manager), converter_(nullptr), swIspEnabled_(false)
 {
 }
 
@@ -1057,9 +1346,17 @@ SimplePipelineHandler::generateConfiguration(Camera *camera, Span<const StreamRo
 	/* Create the formats map. */
 	std::map<PixelFormat, std::vector<SizeRange>> formats;
 
+	const SimpleCameraData::Configuration *rawConfig = nullptr;
+
 	for (const SimpleCameraData::Configuration &cfg : data->configs_) {
 		for (PixelFormat format : cfg.outputFormats)
 			formats[format].push_back(cfg.outputSizes);
+
+		/* The capture format can be produced without conversion. */
+		formats[cfg.captureFormat].push_back(SizeRange(cfg.captureSize));
+
+		if (!rawConfig || rawConfig->captureSize < cfg.captureSize)
+			rawConfig = &cfg;
 	}
 
 	/* Sort the sizes and merge any consecutive overlapping ranges. */
@@ -1089,10 +1386,17 @@ SimplePipelineHandler::generateConfiguration(Camera *camera, Span<const StreamRo
 	 *
 	 * \todo Implement a better way to pick the default format
 	 */
-	for ([[maybe_unused]] StreamRole role : roles) {
+	for (StreamRole role : roles) {
 		StreamConfiguration cfg{ StreamFormats{ formats } };
-		cfg.pixelFormat = formats.begin()->first;
-		cfg.size = formats.begin()->second[0].max;
+
+		if (role == StreamRole::Raw && data->converter_) {
+			/* Capture the largest frame without conversion. */
+			cfg.pixelFormat = rawConfig->captureFormat;
+			cfg.size = rawConfig->captureSize;
+		} else {
+			cfg.pixelFormat = formats.begin()->first;
+			cfg.size = formats.begin()->second[0].max;
+		}
 
 		config->addConfiguration(cfg);
 	}
@@ -1157,14 +1461,28 @@ int SimplePipelineHandler::configure(Camera *camera, CameraConfiguration *c)
 	/* Configure the converter if needed. */
 	std::vector<std::reference_wrapper<StreamConfiguration>> outputCfgs;
 	data->useConverter_ = config->needConversion();
+	data->directStream_.reset();
+	data->numConverterBuffers_ = config->internalBufferCount
+				   ? config->internalBufferCount
+				   : kNumInternalBuffers;
 
+	/*
+	 * Assign the converted streams to the first streams, in the order of
+	 * the converter outputs, and the stream captured without conversion,
+	 * if any, to the last stream.
+	 */
 	for (unsigned int i = 0; i < config->size(); ++i) {
 		StreamConfiguration &cfg = config->at(i);
 
-		cfg.setStream(&data->streams_[i]);
-
-		if (data->useConverter_)
+		if (!data->useConverter_) {
+			cfg.setStream(&data->streams_[0]);
+		} else if (config->directStream() == i) {
+			data->directStream_ = data->streams_.size() - 1;
+			cfg.setStream(&data->streams_.back());
+		} else {
+			cfg.setStream(&data->streams_[outputCfgs.size()]);
 			outputCfgs.push_back(cfg);
+		}
 	}
 
 	if (outputCfgs.empty())
@@ -1174,9 +1492,17 @@ int SimplePipelineHandler::configure(Camera *camera, CameraConfiguration *c)
 	inputCfg.pixelFormat = pipeConfig->captureFormat;
 	inputCfg.size = pipeConfig->captureSize;
 	inputCfg.stride = captureFormat.planes[0].bpl;
-	inputCfg.bufferCount = kNumInternalBuffers;
+	inputCfg.bufferCount = data->numConverterBuffers_;
+
+	ret = data->converter_->configure(inputCfg, outputCfgs);
+	if (ret < 0)
+		return ret;
+
+	/* The sensor control limits may depend on the selected mode. */
+	if (data->ipa_)
+		return data->ipa_->configure(data->sensor_->controls());
 
-	return data->converter_->configure(inputCfg, outputCfgs);
+	return 0;
 }
 
 int SimplePipelineHandler::exportFrameBuffers(Camera *camera, Stream *stream,
@@ -1189,9 +1515,10 @@ int SimplePipelineHandler::exportFrameBuffers(Camera *camera, Stream *stream,
 	 * Export buffers on the converter or capture video node, depending on
 	 * whether the converter is used or not.
 	 */
-	if (data->useConverter_)
-		return data->converter_->exportBuffers(data->streamIndex(stream),
-						       count, buffers);
+	unsigned int index = data->streamIndex(stream);
+
+	if (data->useConverter_ && data->directStream_ != index)
+		return data->converter_->exportBuffers(index, count, buffers);
 	else
 		return data->video_->exportBuffers(count, buffers);
 }
@@ -1210,12 +1537,27 @@ int SimplePipelineHandler::start(Camera *camera, [[maybe_unused]] const ControlL
 		return -EBUSY;
 	}
 
-	if (data->useConverter_) {
+	if (data->directStream_) {
 		/*
-		 * When using the converter allocate a fixed number of internal
+		 * When capturing a stream without conversion alongside the
+		 * converted streams, the video device captures to both
+		 * internal buffers and the direct stream buffers. Export the
+		 * internal buffers and import them along with the stream
 		 * buffers.
 		 */
-		ret = video->allocateBuffers(kNumInternalBuffers,
+		Stream *stream = &data->streams_[*data->directStream_];
+
+		ret = video->exportBuffers(data->numConverterBuffers_,
+					   &data->converterBuffers_);
+		if (ret >= 0)
+			ret = video->importBuffers(data->numConverterBuffers_ +
+						   stream->configuration().bufferCount);
+	} else if (data->useConverter_) {
+		/*
+		 * When using the converter allocate the configured number of
+		 * internal buffers.
+		 */
+		ret = video->allocateBuffers(data->numConverterBuffers_,
 					     &data->converterBuffers_);
 	} else {
 		/* Otherwise, prepare for using buffers from the only stream. */
@@ -1242,9 +1584,24 @@ int SimplePipelineHandler::start(Camera *camera, [[maybe_unused]] const ControlL
 			return ret;
 		}
 
-		/* Queue all internal buffers for capture. */
-		for (std::unique_ptr<FrameBuffer> &buffer : data->converterBuffers_)
-			video->queueBuffer(buffer.get());
+		if (data->ipa_) {
+			ret = data->ipa_->start();
+			if (ret < 0) {
+				stop(camera);
+				return ret;
+			}
+		}
+
+		/*
+		 * Queue all internal buffers for capture, or keep them for the
+		 * capture jobs when capturing a stream without conversion.
+		 */
+		for (std::unique_ptr<FrameBuffer> &buffer : data->converterBuffers_) {
+			if (data->directStream_)
+				data->availableBuffers_.push(buffer.get());
+			else
+				video->queueBuffer(buffer.get());
+		}
 	}
 
 	return 0;
@@ -1255,14 +1612,26 @@ void SimplePipelineHandler::stopDevice(Camera *camera)
 	SimpleCameraData *data = cameraData(camera);
 	V4L2VideoDevice *video = data->video_;
 
-	if (data->useConverter_)
+	if (data->useConverter_) {
 		data->converter_->stop();
 
+		if (data->ipa_)
+			data->ipa_->stop();
+	}
+
 	video->streamOff();
 	video->releaseBuffers();
 
 	video->bufferReady.disconnect(data, &SimpleCameraData::bufferReady);
 
+	/* Complete the requests still waiting for a capture buffer. */
+	while (!data->pendingJobs_.empty()) {
+		SimpleCameraData::CaptureJob &job = data->pendingJobs_.front();
+		data->cancelCapture(job.request, job.capture, job.outputs);
+		data->pendingJobs_.pop();
+	}
+
+	data->availableBuffers_ = {};
 	data->converterBuffers_.clear();
 
 	releasePipeline(data);
@@ -1273,6 +1642,22 @@ int SimplePipelineHandler::queueRequestDevice(Camera *camera, Request *request)
 	SimpleCameraData *data = cameraData(camera);
 	int ret;
 
+	if (data->directStream_) {
+		SimpleCameraData::CaptureJob job{ request, nullptr, {} };
+
+		for (auto &[stream, buffer] : request->buffers()) {
+			unsigned int index = data->streamIndex(stream);
+			if (index == *data->directStream_)
+				job.capture = buffer;
+			else
+				job.outputs.emplace(index, buffer);
+		}
+
+		data->pendingJobs_.push(std::move(job));
+		data->queueCaptures();
+		return 0;
+	}
+
 	std::map<unsigned int, FrameBuffer *> buffers;
 
 	for (auto &[stream, buffer] : request->buffers()) {
@@ -1418,6 +1803,8 @@ bool SimplePipelineHandler::match(DeviceEnumerator *enumerator)
 		}
 	}
 
+	swIspEnabled_ = !converter_ && info->swIspEnabled;
+
 	/* Locate the sensors. */
 	std::vector<MediaEntity *> sensors = locateSensors();
 	if (sensors.empty()) {
@@ -0,0 +1,231 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * uvc_bandwidth.cpp - USB bandwidth accounting for UVC cameras
+ */
+
+#include "uvc_bandwidth.h"
+
+#include <fstream>
+
+#include <libcamera/base/log.h>
+
+namespace libcamera {
+
+LOG_DECLARE_CATEGORY(UVC)
+
+namespace {
+
+unsigned int readSpeed(const std::string &path)
+{
+	std::ifstream file(path + "/speed");
+	if (!file.is_open())
+		return 0;
+
+	/* Low-speed devices report a speed of 1.5, which rounds down to 1. */
+	double speed = 0;
+	file >> speed;
+
+	return static_cast<unsigned int>(speed);
+}
+
+} /* namespace */
+
+/**
+ * \class UVCBus
+ * \brief Track the isochronous bandwidth reserved by UVC cameras on a USB bus
+ *
+ * The USB host controller reserves the bandwidth of isochronous endpoints when
+ * streaming starts, and the uvcvideo driver fails to start streaming when the
+ * bus doesn't have enough bandwidth left. As each camera is handled by a
+ * separate pipeline handler instance, the cameras connected to the same bus
+ * share a UVCBus instance to account for the bandwidth reserved by the other
+ * cameras when selecting a configuration.
+ *
+ * Bandwidth values are expressed in bytes per second, and are estimates: the
+ * exact bandwidth is negotiated by the driver with the device when streaming
+ * starts.
+ */
+
+UVCBus::UVCBus(const std::string &name, uint64_t capacity)
+	: name_(name), capacity_(capacity)
+{
+}
+
+/**
+ * \brief Retrieve the bus of a USB device
+ * \param[in] path The sysfs path of the USB device or interface
+ *
+ * The bus is identified by the USB root hub in the sysfs path of the device.
+ * All callers for devices on the same bus share the same UVCBus instance.
+ *
+ * \return The bus, or nullptr if \a path isn't a USB device
+ */
+std::shared_ptr<UVCBus> UVCBus::fromDevicePath(const std::string &path)
+{
+	static Mutex mutex;
+	static std::map<std::string, std::weak_ptr<UVCBus>> buses;
+
+	/* Locate the root hub, named "usb" followed by the bus number. */
+	std::string::size_type pos = 0;
+	std::string root;
+	std::string name;
+
+	while ((pos = path.find("/usb", pos)) != std::string::npos) {
+		std::string::size_type end = path.find('/', pos + 1);
+		std::string component = path.substr(pos + 1, end - pos - 1);
+
+		if (component.size() > 3 &&
+		    component.find_first_not_of("0123456789", 3) == std::string::npos) {
+			root = path.substr(0, end);
+			name = component;
+			break;
+		}
+
+		pos += 4;
+	}
+
+	if (root.empty())
+		return nullptr;
+
+	MutexLocker locker(mutex);
+
+	std::shared_ptr<UVCBus> bus = buses[root].lock();
+	if (bus)
+		return bus;
+
+	uint64_t capacity = busBandwidth(readSpeed(root));
+	if (!capacity)
+		return nullptr;
+
+	bus = std::shared_ptr<UVCBus>(new UVCBus(name, capacity));
+	buses[root] = bus;
+
+	LOG(UVC, Debug)
+		<< "USB bus " << name << " periodic bandwidth "
+		<< capacity / 1000000.0 << " MB/s";
+
+	return bus;
+}
+
+/**
+ * \fn UVCBus::name()
+ * \brief Retrieve the bus name
+ * \return The name of the root hub of the bus
+ */
+
+/**
+ * \fn UVCBus::capacity()
+ * \brief Retrieve the bandwidth available for isochronous transfers on the bus
+ * \return The bus periodic bandwidth in bytes per second
+ */
+
+/**
+ * \brief Compute the bandwidth available to a camera
+ * \param[in] camera The camera ID
+ * \return The bus bandwidth not reserved by other cameras, in bytes per second
+ */
+uint64_t UVCBus::available(const std::string &camera) const
+{
+	MutexLocker locker(mutex_);
+
+	uint64_t reserved = 0;
+	for (const auto &[id, bandwidth] : reservations_) {
+		if (id != camera)
+			reserved += bandwidth;
+	}
+
+	return reserved < capacity_ ? capacity_ - reserved : 0;
+}
+
+/**
+ * \brief Reserve bandwidth for a camera
+ * \param[in] camera The camera ID
+ * \param[in] bandwidth The bandwidth, in bytes per second
+ *
+ * The reservation replaces any previous reservation for the same camera.
+ */
+void UVCBus::reserve(const std::string &camera, uint64_t bandwidth)
+{
+	MutexLocker locker(mutex_);
+	reservations_[camera] = bandwidth;
+}
+
+/**
+ * \brief Release the bandwidth reserved by a camera
+ * \param[in] camera The camera ID
+ */
+void UVCBus::release(const std::string &camera)
+{
+	MutexLocker locker(mutex_);
+	reservations_.erase(camera);
+}
+
+/**
+ * \brief Compute the maximum bandwidth of a USB device
+ * \param[in] path The sysfs path of the USB interface
+ *
+ * The bandwidth of a UVC camera is limited by the maximum bandwidth of its
+ * video streaming endpoint at the speed at which the device is connected.
+ *
+ * \return The device bandwidth in bytes per second, or 0 if the device speed
+ * is unknown
+ */
+uint64_t UVCBus::deviceBandwidth(const std::string &path)
+{
+	return endpointBandwidth(readSpeed(path + "/.."));
+}
+
+/**
+ * \brief Compute the periodic bandwidth of a USB bus
+ * \param[in] speed The bus speed in Mb/s, as reported by sysfs
+ *
+ * Periodic transfers are limited to 90% of the full-speed frames, 80% of the
+ * high-speed microframes, and 90% of the SuperSpeed bus intervals. SuperSpeed
+ * links use 8b/10b encoding, and SuperSpeedPlus links 128b/132b encoding.
+ *
+ * \return The periodic bandwidth in bytes per second
+ */
+uint64_t UVCBus::busBandwidth(unsigned int speed)
+{
+	uint64_t raw = static_cast<uint64_t>(speed) * 1000000 / 8;
+
+	if (speed < 12)
+		return 0;
+	if (speed < 480)
+		return raw * 9 / 10;
+	if (speed < 5000)
+		return raw * 8 / 10;
+	if (speed < 10000)
+		return raw * 8 / 10 * 9 / 10;
+
+	return raw * 128 / 132 * 9 / 10;
+}
+
+/**
+ * \brief Compute the maximum bandwidth of an isochronous endpoint
+ * \param[in] speed The device speed in Mb/s, as reported by sysfs
+ *
+ * A full-speed endpoint transfers up to 1023 bytes per frame, a high-speed
+ * high-bandwidth endpoint 3 transactions of 1024 bytes per microframe, and a
+ * SuperSpeed endpoint 3 bursts of 16 packets of 1024 bytes per bus interval.
+ * SuperSpeedPlus endpoints are only limited by the bus.
+ *
+ * \return The endpoint bandwidth in bytes per second
+ */
+uint64_t UVCBus::endpointBandwidth(unsigned int speed)
+{
+	if (speed < 12)
+		return 0;
+	if (speed < 480)
+		return 1023 * 1000;
+	if (speed < 5000)
+		return 3 * 1024 * 8000;
+	if (speed < 10000)
+		return 3 * 16 * 1024 * 8000;
+
+	return busBandwidth(speed);
+}
+
+} /* namespace libcamera */
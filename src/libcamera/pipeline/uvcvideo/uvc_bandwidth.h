@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * uvc_bandwidth.h - USB bandwidth accounting for UVC cameras
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+#include <libcamera/base/mutex.h>
+
+namespace libcamera {
+
+class UVCBus
+{
+public:
+	static std::shared_ptr<UVCBus> fromDevicePath(const std::string &path);
+
+	const std::string &name() const { return name_; }
+	uint64_t capacity() const { return capacity_; }
+
+	uint64_t available(const std::string &camera) const;
+	void reserve(const std::string &camera, uint64_t bandwidth);
+	void release(const std::string &camera);
+
+	static uint64_t deviceBandwidth(const std::string &path);
+
+private:
+	UVCBus(const std::string &name, uint64_t capacity);
+
+	static uint64_t busBandwidth(unsigned int speed);
+	static uint64_t endpointBandwidth(unsigned int speed);
+
+	std::string name_;
+	uint64_t capacity_;
+
+	mutable Mutex mutex_;
+	std::map<std::string, uint64_t> reservations_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+};
+
+} /* namespace libcamera */
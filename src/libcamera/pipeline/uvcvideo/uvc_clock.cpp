@@ -0,0 +1,371 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * uvc_clock.cpp - UVC device clock recovery
+ */
+
+#include "uvc_clock.h"
+
+#include <cmath>
+#include <string.h>
+
+namespace libcamera {
+
+namespace {
+
+/* Payload header bmHeaderInfo flags, from the UVC specification. */
+constexpr uint8_t kUvcStreamPts = 1 << 2;
+constexpr uint8_t kUvcStreamScr = 1 << 3;
+
+/*
+ * Size of the struct uvc_meta_buf fields that precede the payload header in
+ * the metadata buffer: the host timestamp (__u64 ns) and the host USB frame
+ * number (__u16 sof).
+ */
+constexpr size_t kMetaHostSize = 10;
+
+/* USB frame numbers are 11-bit counters incremented every millisecond. */
+constexpr unsigned int kSofMask = 0x7ff;
+
+/*
+ * The device SOF is sampled by the device before the payload is sent, while
+ * the host SOF is read when the payload is received. Reject samples where the
+ * two are unreasonably far apart, they are produced by devices that don't
+ * implement the SOF counter correctly.
+ */
+constexpr int64_t kMaxSofDelay = 100;
+
+/*
+ * Keep one sample every 10ms at most, over a window of 64 samples. This spans
+ * a bit more than half a second, which is long enough to average the host
+ * interrupt latency while following drifts of the device clock.
+ */
+constexpr int64_t kSampleInterval = 10;
+constexpr size_t kMaxSamples = 64;
+constexpr size_t kMinSamples = 8;
+
+/* Restart clock recovery after gaps longer than half the SOF period. */
+constexpr uint64_t kMaxGap = 1000000000;
+
+/* Return true if sequence number \a a precedes \a b. */
+bool sequenceBefore(uint32_t a, uint32_t b)
+{
+	return static_cast<int32_t>(a - b) < 0;
+}
+
+template<typename T>
+T read(const uint8_t *data)
+{
+	T value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+} /* namespace */
+
+/**
+ * \class UVCClockRecovery
+ * \brief Convert UVC device presentation timestamps to host timestamps
+ *
+ * UVC devices report in the payload headers the Presentation Time Stamp (PTS)
+ * of the frame, and the Source Clock Reference (SCR) that pairs the device
+ * clock (STC) with the USB frame number (SOF) at which it was sampled. The
+ * uvcvideo driver exposes the payload headers through a metadata video node,
+ * along with the host time and USB frame number at which they have been
+ * received.
+ *
+ * The class fits the device clock to the USB frame number, and the USB frame
+ * number to the host clock, over a sliding window of samples. The PTS is then
+ * converted to the host clock through both relations. This removes the USB
+ * transfer completion jitter from the frame timestamps, and tracks the drift
+ * of the device clock.
+ */
+
+UVCClockRecovery::UVCClockRecovery()
+{
+	reset();
+}
+
+/**
+ * \brief Drop all samples and restart clock recovery
+ */
+void UVCClockRecovery::reset()
+{
+	samples_.clear();
+	valid_ = false;
+	lastTimestamp_ = 0;
+}
+
+/**
+ * \brief Parse the content of a UVC metadata buffer
+ * \param[in] data The metadata buffer content, in the V4L2_META_FMT_UVC format
+ *
+ * Add the SCR of all payload headers stored in the buffer to the clock
+ * recovery samples.
+ *
+ * \return The PTS of the frame, or std::nullopt if the device doesn't report
+ * it
+ */
+std::optional<uint32_t> UVCClockRecovery::parseMetadata(Span<const uint8_t> data)
+{
+	std::optional<uint32_t> pts;
+	size_t offset = 0;
+
+	while (offset + kMetaHostSize + 2 <= data.size()) {
+		const uint8_t *entry = data.data() + offset;
+		const uint8_t length = entry[kMetaHostSize];
+		const uint8_t flags = entry[kMetaHostSize + 1];
+
+		if (length < 2 || offset + kMetaHostSize + length > data.size())
+			break;
+
+		const uint8_t *payload = entry + kMetaHostSize + 2;
+		const uint8_t *end = entry + kMetaHostSize + length;
+
+		if (flags & kUvcStreamPts) {
+			if (payload + 4 > end)
+				break;
+
+			pts = read<uint32_t>(payload);
+			payload += 4;
+		}
+
+		if (flags & kUvcStreamScr) {
+			if (payload + 6 > end)
+				break;
+
+			addSample(read<uint64_t>(entry), read<uint16_t>(entry + 8),
+				  read<uint32_t>(payload), read<uint16_t>(payload + 4));
+		}
+
+		offset += kMetaHostSize + length;
+	}
+
+	return pts;
+}
+
+/**
+ * \brief Add a clock recovery sample
+ * \param[in] timestamp The host time at which the sample has been received
+ * \param[in] hostSof The USB frame number at which the sample has been received
+ * \param[in] stc The device clock value
+ * \param[in] deviceSof The USB frame number at which the device clock has been
+ * sampled
+ */
+void UVCClockRecovery::addSample(uint64_t timestamp, uint16_t hostSof,
+				 uint32_t stc, uint16_t deviceSof)
+{
+	if (lastTimestamp_ && timestamp - lastTimestamp_ > kMaxGap)
+		reset();
+
+	hostSof &= kSofMask;
+	deviceSof &= kSofMask;
+
+	/* Unwrap the host SOF and the device clock. */
+	if (!lastTimestamp_) {
+		hostSof_ = hostSof;
+		stc_ = stc;
+	} else {
+		hostSof_ += (hostSof - lastHostSof_) & kSofMask;
+		stc_ += static_cast<int32_t>(stc - lastStc_);
+	}
+
+	lastTimestamp_ = timestamp;
+	lastHostSof_ = hostSof;
+	lastStc_ = stc;
+
+	/*
+	 * The device and host SOF are sampled from the same bus counter, the
+	 * device SOF can thus be unwrapped relative to the host SOF.
+	 */
+	int64_t delay = (hostSof - deviceSof) & kSofMask;
+	if (delay > kMaxSofDelay)
+		return;
+
+	if (!samples_.empty() &&
+	    hostSof_ - samples_.back().hostSof < kSampleInterval)
+		return;
+
+	samples_.push_back({ static_cast<int64_t>(timestamp), hostSof_,
+			     hostSof_ - delay, stc_ });
+	if (samples_.size() > kMaxSamples)
+		samples_.pop_front();
+
+	update();
+}
+
+/**
+ * \fn UVCClockRecovery::isValid()
+ * \brief Check if enough samples have been collected to convert timestamps
+ * \return True if timestamp() can convert timestamps, false otherwise
+ */
+
+/**
+ * \brief Convert a device presentation timestamp to the host clock
+ * \param[in] pts The device presentation timestamp
+ * \return The host timestamp in nanoseconds, or std::nullopt if clock
+ * recovery hasn't converged yet
+ */
+std::optional<uint64_t> UVCClockRecovery::timestamp(uint32_t pts) const
+{
+	if (!valid_)
+		return std::nullopt;
+
+	/* Unwrap the PTS relative to the last device clock sample. */
+	int64_t stc = stc_ - static_cast<int32_t>(lastStc_ - pts);
+
+	/*
+	 * Both the device and the host sample the SOF counter at a random point
+	 * within the USB frame. The rounding errors of the two conversions thus
+	 * compensate each other on average.
+	 */
+	double sof = stcToSof_.eval(stc - samples_.front().stc);
+	double time = sofToTime_.eval(sof);
+
+	return timeOrigin_ + std::llround(time);
+}
+
+void UVCClockRecovery::update()
+{
+	valid_ = false;
+
+	if (samples_.size() < kMinSamples)
+		return;
+
+	const Sample &first = samples_.front();
+
+	/* Least squares linear regression, relative to the first sample. */
+	auto fit = [&](auto x, auto y, Fit *result) {
+		double mx = 0.0;
+		double my = 0.0;
+
+		for (const Sample &sample : samples_) {
+			mx += x(sample);
+			my += y(sample);
+		}
+
+		mx /= samples_.size();
+		my /= samples_.size();
+
+		double sxx = 0.0;
+		double sxy = 0.0;
+
+		for (const Sample &sample : samples_) {
+			double dx = x(sample) - mx;
+			sxx += dx * dx;
+			sxy += dx * (y(sample) - my);
+		}
+
+		if (sxx == 0.0)
+			return false;
+
+		*result = { mx, my, sxy / sxx };
+		return true;
+	};
+
+	bool ret = fit([&](const Sample &s) { return static_cast<double>(s.stc - first.stc); },
+		       [&](const Sample &s) { return static_cast<double>(s.deviceSof); },
+		       &stcToSof_);
+	if (!ret || stcToSof_.slope <= 0.0)
+		return;
+
+	ret = fit([&](const Sample &s) { return static_cast<double>(s.hostSof); },
+		  [&](const Sample &s) { return static_cast<double>(s.timestamp - first.timestamp); },
+		  &sofToTime_);
+	if (!ret)
+		return;
+
+	timeOrigin_ = first.timestamp;
+	valid_ = true;
+}
+
+/**
+ * \class UVCMetadataMatcher
+ * \brief Pair video frames with the timestamps recovered from their metadata
+ *
+ * The uvcvideo driver completes the metadata buffer of a frame before the
+ * video buffer, and copies the V4L2 sequence number of the video buffer to the
+ * metadata buffer. The buffer timestamps can't be used to pair them, as the
+ * driver rewrites the video buffer timestamp after the metadata buffer has
+ * been completed.
+ *
+ * The class stores the timestamps recovered from the metadata buffers, indexed
+ * by sequence number, until the corresponding video frames are completed.
+ * Sequence numbers are compared modulo 2^32 to handle wrap-around.
+ */
+
+UVCMetadataMatcher::UVCMetadataMatcher()
+{
+	reset();
+}
+
+/**
+ * \brief Drop all the stored timestamps
+ */
+void UVCMetadataMatcher::reset()
+{
+	timestamps_.clear();
+	lastSequence_.reset();
+}
+
+/**
+ * \brief Add the metadata of a frame
+ * \param[in] sequence The V4L2 sequence number of the metadata buffer
+ * \param[in] timestamp The recovered timestamp, if available
+ *
+ * Metadata buffers are expected in increasing sequence number order. A frame
+ * without a recovered \a timestamp still marks the frames that precede it as
+ * ready.
+ */
+void UVCMetadataMatcher::addMetadata(uint32_t sequence,
+				     std::optional<uint64_t> timestamp)
+{
+	if (timestamp)
+		timestamps_.emplace_back(sequence, *timestamp);
+
+	if (!lastSequence_ || sequenceBefore(*lastSequence_, sequence))
+		lastSequence_ = sequence;
+}
+
+/**
+ * \brief Check if the metadata of a frame has been received
+ * \param[in] sequence The V4L2 sequence number of the video frame
+ *
+ * The metadata of a frame is considered as received when a metadata buffer
+ * with the same or a later sequence number has been added. Frames whose
+ * metadata has been dropped are thus not held forever.
+ *
+ * \return True if the metadata of the frame has been received
+ */
+bool UVCMetadataMatcher::ready(uint32_t sequence) const
+{
+	return lastSequence_ && !sequenceBefore(*lastSequence_, sequence);
+}
+
+/**
+ * \brief Retrieve the recovered timestamp of a frame
+ * \param[in] sequence The V4L2 sequence number of the video frame
+ *
+ * Frames are expected to be taken in increasing sequence number order. The
+ * timestamps of the frame and of all the frames that precede it are dropped.
+ *
+ * \return The recovered timestamp of the frame, or std::nullopt if it isn't
+ * available
+ */
+std::optional<uint64_t> UVCMetadataMatcher::take(uint32_t sequence)
+{
+	std::optional<uint64_t> timestamp;
+
+	while (!timestamps_.empty() &&
+	       !sequenceBefore(sequence, timestamps_.front().first)) {
+		if (timestamps_.front().first == sequence)
+			timestamp = timestamps_.front().second;
+
+		timestamps_.pop_front();
+	}
+
+	return timestamp;
+}
+
+} /* namespace libcamera */
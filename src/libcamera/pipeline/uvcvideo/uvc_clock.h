@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * uvc_clock.h - UVC device clock recovery
+ */
+
+#pragma once
+
+#include <deque>
+#include <optional>
+#include <stdint.h>
+#include <utility>
+
+#include <libcamera/base/span.h>
+
+namespace libcamera {
+
+class UVCClockRecovery
+{
+public:
+	UVCClockRecovery();
+
+	void reset();
+
+	std::optional<uint32_t> parseMetadata(Span<const uint8_t> data);
+	void addSample(uint64_t timestamp, uint16_t hostSof, uint32_t stc,
+		       uint16_t deviceSof);
+
+	bool isValid() const { return valid_; }
+	std::optional<uint64_t> timestamp(uint32_t pts) const;
+
+private:
+	struct Sample {
+		int64_t timestamp;
+		int64_t hostSof;
+		int64_t deviceSof;
+		int64_t stc;
+	};
+
+	struct Fit {
+		double eval(double x) const
+		{
+			return y0 + slope * (x - x0);
+		}
+
+		double x0;
+		double y0;
+		double slope;
+	};
+
+	void update();
+
+	std::deque<Sample> samples_;
+	bool valid_;
+
+	uint64_t lastTimestamp_;
+	uint16_t lastHostSof_;
+	uint32_t lastStc_;
+	int64_t hostSof_;
+	int64_t stc_;
+
+	Fit stcToSof_;
+	Fit sofToTime_;
+	int64_t timeOrigin_;
+};
+
+class UVCMetadataMatcher
+{
+public:
+	UVCMetadataMatcher();
+
+	void reset();
+
+	void addMetadata(uint32_t sequence, std::optional<uint64_t> timestamp);
+
+	bool ready(uint32_t sequence) const;
+	std::optional<uint64_t> take(uint32_t sequence);
+
+private:
+	std::deque<std::pair<uint32_t, uint64_t>> timestamps_;
+	std::optional<uint32_t> lastSequence_;
+};
+
+} /* namespace libcamera */
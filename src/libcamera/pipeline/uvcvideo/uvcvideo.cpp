@@ -6,41 +6,94 @@
  */
 
 #include <algorithm>
+#include <dirent.h>
+#include <fcntl.h>
 #include <fstream>
 #include <iomanip>
 #include <math.h>
 #include <memory>
+#include <queue>
+#include <string.h>
+#include <sys/ioctl.h>
 #include <tuple>
 
 #include <libcamera/base/log.h>
+#include <libcamera/base/unique_fd.h>
 #include <libcamera/base/utils.h>
 
 #include <libcamera/camera.h>
 #include <libcamera/control_ids.h>
 #include <libcamera/controls.h>
+#include <libcamera/formats.h>
 #include <libcamera/property_ids.h>
 #include <libcamera/request.h>
 #include <libcamera/stream.h>
 
 #include "libcamera/internal/camera.h"
 #include "libcamera/internal/device_enumerator.h"
+#include "libcamera/internal/formats.h"
+#include "libcamera/internal/framebuffer.h"
+#include "libcamera/internal/mapped_framebuffer.h"
 #include "libcamera/internal/media_device.h"
 #include "libcamera/internal/pipeline_handler.h"
 #include "libcamera/internal/sysfs.h"
 #include "libcamera/internal/v4l2_videodevice.h"
 
+#include "uvc_bandwidth.h"
+#include "uvc_clock.h"
+
 namespace libcamera {
 
+using namespace std::chrono_literals;
+
 LOG_DEFINE_CATEGORY(UVC)
 
+namespace {
+
+/* Frame interval assumed when the device doesn't enumerate frame intervals. */
+constexpr utils::Duration kDefaultFrameInterval = 33.333 * 1ms;
+
+/*
+ * Compression ratio assumed for MJPEG, relative to 16 bits per pixel. Devices
+ * request the isochronous bandwidth for MJPEG based on their own estimate of
+ * the worst case frame size, which is typically in this range.
+ */
+constexpr unsigned int kMjpegCompressionRatio = 4;
+
+/*
+ * Check if the video node at \a path is a memory-to-memory device, without
+ * initializing it fully.
+ */
+bool isM2MDevice(const std::string &path)
+{
+	UniqueFD fd(::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC));
+	if (!fd.isValid())
+		return false;
+
+	V4L2Capability caps;
+	if (ioctl(fd.get(), VIDIOC_QUERYCAP, &caps) < 0)
+		return false;
+
+	return caps.isM2M();
+}
+
+} /* namespace */
+
 class UVCCameraData : public Camera::Private
 {
 public:
 	UVCCameraData(PipelineHandler *pipe)
-		: Camera::Private(pipe)
+		: Camera::Private(pipe), decode_(false), availableOutputs_(0),
+		  deviceBandwidth_(0)
 	{
 	}
 
+	~UVCCameraData()
+	{
+		if (bus_)
+			bus_->release(id_);
+	}
+
 	int init(MediaDevice *media);
 	void addControl(uint32_t cid, const ControlInfo &v4l2info,
 			ControlInfoMap::Map *ctrls);
@@ -48,14 +101,71 @@ public:
 
 	const std::string &id() const { return id_; }
 
+	bool isDecoded(const PixelFormat &pixelFormat) const
+	{
+		return decodedFormat_.isValid() && pixelFormat == decodedFormat_;
+	}
+
+	int openDecoder();
+	void closeDecoder();
+	int configureDecoder(const V4L2DeviceFormat &jpegFormat,
+			     const StreamConfiguration &cfg);
+
+	void startMetadata(unsigned int count);
+	void stopMetadata();
+
+	std::vector<utils::Duration> frameIntervals(const PixelFormat &captureFormat,
+						    const Size &size) const;
+	uint64_t bandwidth(const PixelFormat &captureFormat, const Size &size,
+			   utils::Duration interval) const;
+
 	std::unique_ptr<V4L2VideoDevice> video_;
 	Stream stream_;
 	std::map<PixelFormat, std::vector<SizeRange>> formats_;
 
+	std::unique_ptr<V4L2M2MDevice> decoder_;
+	V4L2PixelFormat decoderInputFormat_;
+	PixelFormat decodedFormat_;
+	std::map<Size, V4L2DeviceFormat> decodedFormats_;
+	bool decode_;
+
+	std::vector<std::unique_ptr<FrameBuffer>> jpegBuffers_;
+	unsigned int availableOutputs_;
+
+	std::unique_ptr<V4L2VideoDevice> metadata_;
+
+	std::shared_ptr<UVCBus> bus_;
+	uint64_t deviceBandwidth_;
+
 private:
+	struct TimestampStats {
+		void add(int64_t latency);
+		int64_t jitter() const;
+
+		unsigned int frames;
+		double mean;
+		double m2;
+	};
+
 	bool generateId();
+	void initDecoder();
+	void initMetadata(MediaDevice *media);
+
+	void jpegBufferReady(FrameBuffer *buffer);
+	void decodedBufferReady(FrameBuffer *buffer);
+	void metadataBufferReady(FrameBuffer *buffer);
+	void completeBuffer(FrameBuffer *buffer);
+	void completePending(bool flush);
 
 	std::string id_;
+
+	std::vector<std::unique_ptr<FrameBuffer>> metadataBuffers_;
+	std::map<const FrameBuffer *, MappedFrameBuffer> metadataMaps_;
+	UVCClockRecovery clock_;
+	UVCMetadataMatcher metadataMatcher_;
+	std::map<uint64_t, uint32_t> decoderSequences_;
+	std::queue<FrameBuffer *> pendingBuffers_;
+	TimestampStats stats_;
 };
 
 class UVCCameraConfiguration : public CameraConfiguration
@@ -65,8 +175,13 @@ public:
 
 	Status validate() override;
 
+	utils::Duration frameInterval() const { return frameInterval_; }
+
 private:
+	bool fitBandwidth(StreamConfiguration &cfg);
+
 	UVCCameraData *data_;
+	utils::Duration frameInterval_;
 };
 
 class PipelineHandlerUVC : public PipelineHandler
@@ -89,10 +204,15 @@ public:
 	bool match(DeviceEnumerator *enumerator) override;
 
 private:
+	void releaseDevice(Camera *camera) override;
+
 	int processControl(ControlList *controls, unsigned int id,
 			   const ControlValue &value);
 	int processControls(UVCCameraData *data, Request *request);
 
+	int startDecoder(UVCCameraData *data, unsigned int count);
+	void stopStreaming(UVCCameraData *data);
+
 	UVCCameraData *cameraData(Camera *camera)
 	{
 		return static_cast<UVCCameraData *>(camera->_d());
@@ -152,16 +272,38 @@ CameraConfiguration::Status UVCCameraConfiguration::validate()
 		status = Adjusted;
 	}
 
+	if (fitBandwidth(cfg))
+		status = Adjusted;
+
 	cfg.bufferCount = 4;
 
+	/*
+	 * Decoded formats are captured in MJPEG and converted by the decoder,
+	 * which determines the stride and frame size.
+	 */
+	const bool decode = data_->isDecoded(cfg.pixelFormat);
+
 	V4L2DeviceFormat format;
-	format.fourcc = data_->video_->toV4L2PixelFormat(cfg.pixelFormat);
+	format.fourcc = data_->video_->toV4L2PixelFormat(decode ? formats::MJPEG
+								: cfg.pixelFormat);
 	format.size = cfg.size;
 
 	int ret = data_->video_->tryFormat(&format);
 	if (ret)
 		return Invalid;
 
+	/*
+	 * The decoder is only opened when configured, use the decoded formats
+	 * recorded when probing it.
+	 */
+	if (decode) {
+		auto it = data_->decodedFormats_.find(cfg.size);
+		if (it == data_->decodedFormats_.end())
+			return Invalid;
+
+		format = it->second;
+	}
+
 	cfg.stride = format.planes[0].bpl;
 	cfg.frameSize = format.planes[0].size;
 
@@ -173,6 +315,112 @@ CameraConfiguration::Status UVCCameraConfiguration::validate()
 	return status;
 }
 
+/*
+ * Select the pixel format and frame interval with the highest frame rate that
+ * fits in the USB bandwidth left by the other cameras on the same bus. When
+ * the requested format doesn't fit at its highest frame rate, MJPEG capture is
+ * preferred over lower frame rates. Return true if the pixel format has been
+ * adjusted.
+ */
+bool UVCCameraConfiguration::fitBandwidth(StreamConfiguration &cfg)
+{
+	frameInterval_ = {};
+
+	if (!data_->bus_)
+		return false;
+
+	struct Option {
+		PixelFormat pixelFormat;
+		utils::Duration interval;
+		uint64_t bandwidth;
+	};
+
+	const StreamFormats &formats = cfg.formats();
+	std::vector<Option> options;
+
+	std::vector<PixelFormat> candidates{ cfg.pixelFormat };
+	for (const PixelFormat &pixelFormat : { data_->decodedFormat_, formats::MJPEG }) {
+		if (!pixelFormat.isValid() || pixelFormat == cfg.pixelFormat)
+			continue;
+
+		const std::vector<Size> sizes = formats.sizes(pixelFormat);
+		if (std::find(sizes.begin(), sizes.end(), cfg.size) != sizes.end())
+			candidates.push_back(pixelFormat);
+	}
+
+	for (const PixelFormat &pixelFormat : candidates) {
+		const PixelFormat captureFormat = data_->isDecoded(pixelFormat)
+						? formats::MJPEG : pixelFormat;
+
+		std::vector<utils::Duration> intervals =
+			data_->frameIntervals(captureFormat, cfg.size);
+		if (intervals.empty())
+			intervals.push_back({});
+
+		for (const utils::Duration &interval : intervals)
+			options.push_back({ pixelFormat, interval,
+					    data_->bandwidth(captureFormat, cfg.size,
+							     interval) });
+	}
+
+	uint64_t available = data_->bus_->available(data_->id());
+	if (data_->deviceBandwidth_)
+		available = std::min(available, data_->deviceBandwidth_);
+
+	/*
+	 * Keep the requested format at its highest frame rate if it fits,
+	 * otherwise pick the fastest option, and the lowest bandwidth option
+	 * if none fits.
+	 */
+	auto interval = [](const Option &option) {
+		return option.interval ? option.interval : kDefaultFrameInterval;
+	};
+
+	const Option *selected = &options.front();
+	if (selected->bandwidth > available) {
+		std::stable_sort(options.begin(), options.end(),
+				 [&](const Option &a, const Option &b) {
+					 return interval(a) < interval(b);
+				 });
+
+		auto iter = std::find_if(options.begin(), options.end(),
+					 [&](const Option &option) {
+						 return option.bandwidth <= available;
+					 });
+		if (iter != options.end()) {
+			selected = &*iter;
+		} else {
+			selected = &*std::min_element(options.begin(), options.end(),
+						      [](const Option &a, const Option &b) {
+							      return a.bandwidth < b.bandwidth;
+						      });
+			LOG(UVC, Warning)
+				<< "No configuration fits in the "
+				<< available / 1000000.0 << " MB/s available on "
+				<< data_->bus_->name();
+		}
+	}
+
+	frameInterval_ = selected->interval;
+
+	LOG(UVC, Debug)
+		<< "Estimated USB bandwidth " << selected->bandwidth / 1000000.0
+		<< " MB/s for " << selected->pixelFormat << " at "
+		<< 1.0 / interval(*selected).get<std::ratio<1>>() << " fps, "
+		<< available / 1000000.0 << " MB/s available on "
+		<< data_->bus_->name();
+
+	if (selected->pixelFormat == cfg.pixelFormat)
+		return false;
+
+	LOG(UVC, Info)
+		<< "Adjusting pixel format from " << cfg.pixelFormat << " to "
+		<< selected->pixelFormat << " to fit in the USB bandwidth";
+
+	cfg.pixelFormat = selected->pixelFormat;
+	return true;
+}
+
 PipelineHandlerUVC::PipelineHandlerUVC(CameraManager *manager)
 	: PipelineHandler(manager)
 {
@@ -209,8 +457,12 @@ int PipelineHandlerUVC::configure(Camera *camera, CameraConfiguration *config)
 	StreamConfiguration &cfg = config->at(0);
 	int ret;
 
+	data->decode_ = data->isDecoded(cfg.pixelFormat);
+	const PixelFormat captureFormat = data->decode_ ? formats::MJPEG
+							: cfg.pixelFormat;
+
 	V4L2DeviceFormat format;
-	format.fourcc = data->video_->toV4L2PixelFormat(cfg.pixelFormat);
+	format.fourcc = data->video_->toV4L2PixelFormat(captureFormat);
 	format.size = cfg.size;
 
 	ret = data->video_->setFormat(&format);
@@ -218,9 +470,40 @@ int PipelineHandlerUVC::configure(Camera *camera, CameraConfiguration *config)
 		return ret;
 
 	if (format.size != cfg.size ||
-	    format.fourcc != data->video_->toV4L2PixelFormat(cfg.pixelFormat))
+	    format.fourcc != data->video_->toV4L2PixelFormat(captureFormat))
 		return -EINVAL;
 
+	if (data->decode_) {
+		ret = data->openDecoder();
+		if (ret)
+			return ret;
+
+		ret = data->configureDecoder(format, cfg);
+		if (ret)
+			return ret;
+	} else {
+		data->closeDecoder();
+	}
+
+	/*
+	 * Apply the frame interval selected to fit in the USB bandwidth, and
+	 * reserve the bandwidth to account for it when configuring the other
+	 * cameras on the bus.
+	 */
+	utils::Duration interval =
+		static_cast<UVCCameraConfiguration *>(config)->frameInterval();
+	if (interval) {
+		ret = data->video_->setFrameInterval(&interval);
+		if (ret == -ENOTSUP)
+			interval = {};
+		else if (ret)
+			return ret;
+	}
+
+	if (data->bus_)
+		data->bus_->reserve(data->id(),
+				    data->bandwidth(captureFormat, cfg.size, interval));
+
 	cfg.setStream(&data->stream_);
 
 	return 0;
@@ -232,6 +515,9 @@ int PipelineHandlerUVC::exportFrameBuffers(Camera *camera, Stream *stream,
 	UVCCameraData *data = cameraData(camera);
 	unsigned int count = stream->configuration().bufferCount;
 
+	if (data->decode_)
+		return data->decoder_->capture()->exportBuffers(count, buffers);
+
 	return data->video_->exportBuffers(count, buffers);
 }
 
@@ -240,24 +526,115 @@ int PipelineHandlerUVC::start(Camera *camera, [[maybe_unused]] const ControlList
 	UVCCameraData *data = cameraData(camera);
 	unsigned int count = data->stream_.configuration().bufferCount;
 
+	/*
+	 * Start the metadata stream first to receive the payload headers of
+	 * the first frames.
+	 */
+	data->startMetadata(count);
+
+	if (data->decode_)
+		return startDecoder(data, count);
+
 	int ret = data->video_->importBuffers(count);
-	if (ret < 0)
+	if (ret < 0) {
+		data->stopMetadata();
 		return ret;
+	}
 
 	ret = data->video_->streamOn();
 	if (ret < 0) {
 		data->video_->releaseBuffers();
+		data->stopMetadata();
+		return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * When decoding, the camera captures MJPEG frames to internal buffers
+ * allocated by the decoder, and the decoder writes the decoded frames to the
+ * request buffers. The internal buffers are allocated on the decoder side, as
+ * the decoder may have memory constraints that the uvcvideo driver doesn't
+ * have.
+ */
+int PipelineHandlerUVC::startDecoder(UVCCameraData *data, unsigned int count)
+{
+	V4L2VideoDevice *jpegInput = data->decoder_->output();
+	V4L2VideoDevice *decoded = data->decoder_->capture();
+
+	int ret = jpegInput->allocateBuffers(count, &data->jpegBuffers_);
+	if (ret < 0)
 		return ret;
+
+	ret = data->video_->importBuffers(count);
+	if (ret < 0)
+		goto error;
+
+	ret = decoded->importBuffers(count);
+	if (ret < 0)
+		goto error;
+
+	data->availableOutputs_ = 0;
+
+	ret = decoded->streamOn();
+	if (ret < 0)
+		goto error;
+
+	ret = jpegInput->streamOn();
+	if (ret < 0)
+		goto error;
+
+	ret = data->video_->streamOn();
+	if (ret < 0)
+		goto error;
+
+	for (std::unique_ptr<FrameBuffer> &buffer : data->jpegBuffers_) {
+		ret = data->video_->queueBuffer(buffer.get());
+		if (ret < 0)
+			goto error;
 	}
 
 	return 0;
+
+error:
+	stopStreaming(data);
+	return ret;
 }
 
 void PipelineHandlerUVC::stopDevice(Camera *camera)
 {
-	UVCCameraData *data = cameraData(camera);
+	stopStreaming(cameraData(camera));
+}
+
+void PipelineHandlerUVC::stopStreaming(UVCCameraData *data)
+{
 	data->video_->streamOff();
+
+	if (data->decode_) {
+		data->decoder_->output()->streamOff();
+		data->decoder_->capture()->streamOff();
+	}
+
 	data->video_->releaseBuffers();
+
+	if (data->decode_) {
+		data->decoder_->output()->releaseBuffers();
+		data->decoder_->capture()->releaseBuffers();
+		data->jpegBuffers_.clear();
+	}
+
+	data->stopMetadata();
+}
+
+void PipelineHandlerUVC::releaseDevice(Camera *camera)
+{
+	UVCCameraData *data = cameraData(camera);
+
+	if (data->bus_)
+		data->bus_->release(data->id());
+
+	data->closeDecoder();
 }
 
 int PipelineHandlerUVC::processControl(ControlList *controls, unsigned int id,
@@ -377,6 +754,15 @@ int PipelineHandlerUVC::queueRequestDevice(Camera *camera, Request *request)
 	if (ret < 0)
 		return ret;
 
+	if (data->decode_) {
+		ret = data->decoder_->capture()->queueBuffer(buffer);
+		if (ret < 0)
+			return ret;
+
+		data->availableOutputs_++;
+		return 0;
+	}
+
 	ret = data->video_->queueBuffer(buffer);
 	if (ret < 0)
 		return ret;
@@ -466,6 +852,12 @@ int UVCCameraData::init(MediaDevice *media)
 		return -EINVAL;
 	}
 
+	initDecoder();
+	initMetadata(media);
+
+	bus_ = UVCBus::fromDevicePath(video_->devicePath());
+	deviceBandwidth_ = UVCBus::deviceBandwidth(video_->devicePath());
+
 	/* Populate the camera properties. */
 	properties_.set(properties::Model, utils::toAscii(media->model()));
 
@@ -697,16 +1089,452 @@ void UVCCameraData::addControl(uint32_t cid, const ControlInfo &v4l2Info,
 	ctrls->emplace(id, info);
 }
 
+/*
+ * Locate a V4L2 memory-to-memory JPEG decoder that outputs NV12. Decoders are
+ * not part of the UVC media graph, and don't necessarily register a media
+ * device, all video nodes are thus inspected. Only memory-to-memory devices
+ * are opened fully. The decoder is closed once probed, and opened again only
+ * when the camera is configured to decode MJPEG.
+ */
+void UVCCameraData::initDecoder()
+{
+	auto mjpeg = formats_.find(formats::MJPEG);
+	if (mjpeg == formats_.end() || formats_.count(formats::NV12))
+		return;
+
+	DIR *dir = opendir("/dev");
+	if (!dir)
+		return;
+
+	struct dirent *ent;
+	while ((ent = readdir(dir)) != nullptr) {
+		if (strncmp(ent->d_name, "video", 5))
+			continue;
+
+		std::string path = std::string("/dev/") + ent->d_name;
+		if (path == video_->deviceNode() || !isM2MDevice(path))
+			continue;
+
+		auto decoder = std::make_unique<V4L2M2MDevice>(path);
+		if (decoder->open() < 0)
+			continue;
+
+		if (!decoder->capture()->caps().isM2M())
+			continue;
+
+		V4L2PixelFormat inputFormat;
+		for (const auto &format : decoder->output()->formats()) {
+			if (format.first == V4L2PixelFormat(V4L2_PIX_FMT_JPEG) ||
+			    format.first == V4L2PixelFormat(V4L2_PIX_FMT_MJPEG)) {
+				inputFormat = format.first;
+				break;
+			}
+		}
+
+		if (!inputFormat.isValid())
+			continue;
+
+		V4L2PixelFormat outputFormat =
+			decoder->capture()->toV4L2PixelFormat(formats::NV12);
+		const V4L2VideoDevice::Formats outputFormats =
+			decoder->capture()->formats();
+		if (!outputFormats.count(outputFormat))
+			continue;
+
+		decoder_ = std::move(decoder);
+		decoderInputFormat_ = inputFormat;
+		break;
+	}
+
+	closedir(dir);
+
+	if (!decoder_)
+		return;
+
+	/*
+	 * Advertise the MJPEG sizes that the decoder can handle, and record
+	 * the decoded formats to validate configurations without opening the
+	 * decoder.
+	 */
+	std::vector<SizeRange> sizes;
+
+	for (const SizeRange &range : mjpeg->second) {
+		V4L2DeviceFormat format;
+		format.fourcc = decoderInputFormat_;
+		format.size = range.max;
+
+		if (decoder_->output()->setFormat(&format) < 0)
+			continue;
+
+		format = {};
+		format.fourcc = decoder_->capture()->toV4L2PixelFormat(formats::NV12);
+		format.size = range.max;
+
+		if (decoder_->capture()->tryFormat(&format) < 0 ||
+		    format.size != range.max)
+			continue;
+
+		sizes.emplace_back(range.max);
+		decodedFormats_[range.max] = format;
+	}
+
+	decoder_->close();
+
+	if (sizes.empty()) {
+		decoder_.reset();
+		decodedFormats_.clear();
+		return;
+	}
+
+	LOG(UVC, Info)
+		<< "Using JPEG decoder " << decoder_->capture()->deviceNode()
+		<< " to produce NV12";
+
+	decodedFormat_ = formats::NV12;
+	formats_[decodedFormat_] = std::move(sizes);
+
+	decoder_->output()->bufferReady.connect(this, &UVCCameraData::jpegBufferReady);
+	decoder_->capture()->bufferReady.connect(this, &UVCCameraData::decodedBufferReady);
+}
+
+int UVCCameraData::openDecoder()
+{
+	if (decoder_->capture()->isOpen())
+		return 0;
+
+	return decoder_->open();
+}
+
+void UVCCameraData::closeDecoder()
+{
+	if (decoder_)
+		decoder_->close();
+}
+
+int UVCCameraData::configureDecoder(const V4L2DeviceFormat &jpegFormat,
+				    const StreamConfiguration &cfg)
+{
+	/*
+	 * Size the compressed buffers according to the camera, as the decoder
+	 * can't know the maximum size of the frames it will receive.
+	 */
+	V4L2DeviceFormat format;
+	format.fourcc = decoderInputFormat_;
+	format.size = jpegFormat.size;
+	format.planes[0].size = jpegFormat.planes[0].size;
+
+	int ret = decoder_->output()->setFormat(&format);
+	if (ret)
+		return ret;
+
+	if (format.fourcc != decoderInputFormat_ || format.size != jpegFormat.size ||
+	    format.planes[0].size < jpegFormat.planes[0].size) {
+		LOG(UVC, Error) << "Unable to configure JPEG decoder input";
+		return -EINVAL;
+	}
+
+	V4L2PixelFormat outputFormat =
+		decoder_->capture()->toV4L2PixelFormat(cfg.pixelFormat);
+
+	format = {};
+	format.fourcc = outputFormat;
+	format.size = cfg.size;
+
+	ret = decoder_->capture()->setFormat(&format);
+	if (ret)
+		return ret;
+
+	if (format.fourcc != outputFormat || format.size != cfg.size ||
+	    format.planes[0].bpl != cfg.stride) {
+		LOG(UVC, Error) << "Unable to configure JPEG decoder output";
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/*
+ * Locate the metadata video node that exposes the UVC payload headers of the
+ * default video node. It belongs to the same USB interface.
+ */
+void UVCCameraData::initMetadata(MediaDevice *media)
+{
+	for (MediaEntity *entity : media->entities()) {
+		if (entity->function() != MEDIA_ENT_F_IO_V4L ||
+		    entity->deviceNode().empty() ||
+		    entity->deviceNode() == video_->deviceNode())
+			continue;
+
+		auto metadata = std::make_unique<V4L2VideoDevice>(entity);
+		if (metadata->open() < 0)
+			continue;
+
+		if (!metadata->caps().isMetaCapture() ||
+		    metadata->devicePath() != video_->devicePath())
+			continue;
+
+		V4L2DeviceFormat format;
+		format.fourcc = V4L2PixelFormat(V4L2_META_FMT_UVC);
+		if (metadata->setFormat(&format) < 0 ||
+		    format.fourcc != V4L2PixelFormat(V4L2_META_FMT_UVC))
+			continue;
+
+		LOG(UVC, Debug)
+			<< "Using UVC metadata from " << metadata->deviceNode();
+
+		metadata_ = std::move(metadata);
+		metadata_->bufferReady.connect(this, &UVCCameraData::metadataBufferReady);
+		break;
+	}
+}
+
+/*
+ * Timestamps are recovered from the device clock when UVC metadata is
+ * available. Failures to start the metadata stream are not fatal, the camera
+ * then falls back to the buffer timestamps.
+ */
+void UVCCameraData::startMetadata(unsigned int count)
+{
+	clock_.reset();
+	metadataMatcher_.reset();
+	decoderSequences_.clear();
+	stats_ = {};
+
+	if (!metadata_)
+		return;
+
+	int ret = metadata_->allocateBuffers(count, &metadataBuffers_);
+	if (ret < 0)
+		goto error;
+
+	for (const std::unique_ptr<FrameBuffer> &buffer : metadataBuffers_) {
+		MappedFrameBuffer map(buffer.get(), MappedFrameBuffer::MapFlag::Read);
+		if (!map.isValid()) {
+			ret = map.error();
+			goto error;
+		}
+
+		metadataMaps_.emplace(buffer.get(), std::move(map));
+	}
+
+	ret = metadata_->streamOn();
+	if (ret < 0)
+		goto error;
+
+	for (const std::unique_ptr<FrameBuffer> &buffer : metadataBuffers_) {
+		ret = metadata_->queueBuffer(buffer.get());
+		if (ret < 0)
+			goto error;
+	}
+
+	return;
+
+error:
+	LOG(UVC, Warning)
+		<< "Failed to start metadata stream, using buffer timestamps: "
+		<< strerror(-ret);
+	stopMetadata();
+}
+
+void UVCCameraData::stopMetadata()
+{
+	if (!metadataBuffers_.empty()) {
+		metadata_->streamOff();
+		metadata_->releaseBuffers();
+		metadataMaps_.clear();
+		metadataBuffers_.clear();
+	}
+
+	/* Complete the buffers still waiting for their metadata. */
+	completePending(true);
+
+	if (stats_.frames)
+		LOG(UVC, Debug)
+			<< "Recovered " << stats_.frames
+			<< " timestamps, USB latency " << stats_.mean / 1000.0
+			<< "us, jitter " << stats_.jitter() / 1000.0 << "us";
+}
+
+std::vector<utils::Duration>
+UVCCameraData::frameIntervals(const PixelFormat &captureFormat,
+			      const Size &size) const
+{
+	return video_->frameIntervals(video_->toV4L2PixelFormat(captureFormat),
+				      size);
+}
+
+/*
+ * Estimate the USB bandwidth required to capture frames in the given format,
+ * size and frame interval, in bytes per second.
+ */
+uint64_t UVCCameraData::bandwidth(const PixelFormat &captureFormat,
+				  const Size &size, utils::Duration interval) const
+{
+	const PixelFormatInfo &info = PixelFormatInfo::info(captureFormat);
+	uint64_t frameSize;
+
+	if (info.isValid() && info.bitsPerPixel)
+		frameSize = info.frameSize(size);
+	else
+		frameSize = size.width * size.height * 2 / kMjpegCompressionRatio;
+
+	if (!interval)
+		interval = kDefaultFrameInterval;
+
+	return frameSize / interval.get<std::ratio<1>>();
+}
+
 void UVCCameraData::bufferReady(FrameBuffer *buffer)
 {
-	Request *request = buffer->request();
+	pipe()->framesDropped(_o<Camera>(), video_->lastFrameDrops());
+
+	if (!decode_) {
+		completeBuffer(buffer);
+		return;
+	}
 
-	/* \todo Use the UVC metadata to calculate a more precise timestamp */
-	request->metadata().set(controls::SensorTimestamp,
-				buffer->metadata().timestamp);
+	const FrameMetadata &metadata = buffer->metadata();
+	if (metadata.status == FrameMetadata::FrameCancelled)
+		return;
+
+	/*
+	 * Decode the frame if a request buffer is available, or drop it and
+	 * return the buffer to the camera otherwise. Corrupted frames are
+	 * dropped too, as decoders may not recover from them.
+	 */
+	if (availableOutputs_ && metadata.status == FrameMetadata::FrameSuccess &&
+	    decoder_->output()->queueBuffer(buffer) == 0) {
+		availableOutputs_--;
+		decoderSequences_[metadata.timestamp] = metadata.sequence;
+		return;
+	}
+
+	pipe()->framesDropped(_o<Camera>(), 1);
+	video_->queueBuffer(buffer);
+}
+
+void UVCCameraData::jpegBufferReady(FrameBuffer *buffer)
+{
+	if (buffer->metadata().status == FrameMetadata::FrameCancelled)
+		return;
+
+	video_->queueBuffer(buffer);
+}
+
+void UVCCameraData::decodedBufferReady(FrameBuffer *buffer)
+{
+	/*
+	 * The decoder copies the timestamp from the compressed frame, but
+	 * numbers the decoded frames itself. Restore the sequence number of
+	 * the captured frame, used to pair it with its metadata.
+	 */
+	FrameMetadata &metadata = buffer->_d()->metadata();
+	auto iter = decoderSequences_.find(metadata.timestamp);
+	if (iter != decoderSequences_.end()) {
+		metadata.sequence = iter->second;
+		decoderSequences_.erase(decoderSequences_.begin(), ++iter);
+	}
+
+	completeBuffer(buffer);
+}
+
+/*
+ * The uvcvideo driver gives the metadata buffer the same sequence number as
+ * the frame it describes, and completes it before the video buffer. Store the
+ * recovered timestamp of the frame, indexed by sequence number.
+ */
+void UVCCameraData::metadataBufferReady(FrameBuffer *buffer)
+{
+	const FrameMetadata &metadata = buffer->metadata();
+	if (metadata.status == FrameMetadata::FrameCancelled)
+		return;
+
+	std::optional<uint64_t> recovered;
+
+	if (metadata.status == FrameMetadata::FrameSuccess) {
+		const MappedFrameBuffer &map = metadataMaps_.at(buffer);
+		Span<const uint8_t> data = map.planes()[0];
+		data = data.first(std::min<size_t>(metadata.planes()[0].bytesused,
+						   data.size()));
+
+		std::optional<uint32_t> pts = clock_.parseMetadata(data);
+		if (pts)
+			recovered = clock_.timestamp(*pts);
+	}
+
+	metadataMatcher_.addMetadata(metadata.sequence, recovered);
+
+	metadata_->queueBuffer(buffer);
+
+	completePending(false);
+}
+
+void UVCCameraData::completeBuffer(FrameBuffer *buffer)
+{
+	pendingBuffers_.push(buffer);
+	completePending(false);
+}
+
+/*
+ * Complete the buffers in order, with the recovered timestamp when available.
+ * A buffer whose metadata hasn't been received yet is held until a later
+ * metadata buffer arrives, or until the metadata stream is stopped when
+ * \a flush is true.
+ */
+void UVCCameraData::completePending(bool flush)
+{
+	while (!pendingBuffers_.empty()) {
+		FrameBuffer *buffer = pendingBuffers_.front();
+		const FrameMetadata &metadata = buffer->metadata();
+		uint64_t timestamp = metadata.timestamp;
+		std::optional<uint64_t> recovered;
+
+		if (!metadataBuffers_.empty() &&
+		    metadata.status == FrameMetadata::FrameSuccess) {
+			if (!flush && !metadataMatcher_.ready(metadata.sequence))
+				break;
+
+			recovered = metadataMatcher_.take(metadata.sequence);
+		}
+
+		pendingBuffers_.pop();
+
+		Request *request = buffer->request();
+
+		if (recovered) {
+			stats_.add(static_cast<int64_t>(timestamp - *recovered));
+			request->metadata().set(controls::draft::SensorTimestampJitter,
+						stats_.jitter());
+			timestamp = *recovered;
+		}
+
+		request->metadata().set(controls::SensorTimestamp, timestamp);
+
+		pipe()->completeBuffer(request, buffer);
+		pipe()->completeRequest(request);
+	}
+}
+
+/*
+ * Track the latency between the recovered timestamps and the buffer
+ * timestamps, whose standard deviation is the jitter removed by clock
+ * recovery.
+ */
+void UVCCameraData::TimestampStats::add(int64_t latency)
+{
+	frames++;
+
+	double delta = latency - mean;
+	mean += delta / frames;
+	m2 += delta * (latency - mean);
+}
+
+int64_t UVCCameraData::TimestampStats::jitter() const
+{
+	if (!frames)
+		return 0;
 
-	pipe()->completeBuffer(request, buffer);
-	pipe()->completeRequest(request);
+	return llround(sqrt(m2 / frames));
 }
 
 REGISTER_PIPELINE_HANDLER(PipelineHandlerUVC)
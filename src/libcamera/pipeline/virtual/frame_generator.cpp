@@ -0,0 +1,160 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * frame_generator.cpp - Synthetic frame generator for the virtual pipeline
+ */
+
+#include "frame_generator.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include <libcamera/base/log.h>
+
+#include <libcamera/framebuffer.h>
+#include <libcamera/request.h>
+#include <libcamera/stream.h>
+
+#include "libcamera/internal/dma_buf_allocator.h"
+#include "libcamera/internal/framebuffer.h"
+#include "libcamera/internal/mapped_framebuffer.h"
+
+namespace libcamera {
+
+LOG_DECLARE_CATEGORY(Virtual)
+
+/**
+ * \class FrameGenerator
+ * \brief Produce frames in the request buffers at a configurable rate
+ *
+ * The frame generator runs in a dedicated thread. It completes the queued
+ * requests in order, one frame duration apart, or as fast as possible when
+ * the frame duration is zero.
+ *
+ * To keep the cost of frame generation out of the measurements, a test
+ * pattern is written the first time a buffer is seen, and only the first line
+ * of the image is updated for every frame.
+ */
+
+FrameGenerator::FrameGenerator()
+	: timer_(this), sequence_(0)
+{
+	timer_.timeout.connect(this, &FrameGenerator::generate);
+}
+
+/**
+ * \brief Queue a request to the generator
+ * \param[in] request The request
+ * \param[in] frameDuration The minimum time since the previous frame
+ */
+void FrameGenerator::queueRequest(Request *request, utils::Duration frameDuration)
+{
+	queue_.push({ request, frameDuration });
+
+	if (!timer_.isRunning())
+		generate();
+}
+
+/**
+ * \brief Stop generating frames
+ * \return The requests that haven't been processed, in queue order
+ */
+std::vector<Request *> FrameGenerator::stop()
+{
+	std::vector<Request *> requests;
+
+	timer_.stop();
+
+	while (!queue_.empty()) {
+		requests.push_back(queue_.front().request);
+		queue_.pop();
+	}
+
+	patterns_.clear();
+	next_ = {};
+	sequence_ = 0;
+
+	return requests;
+}
+
+void FrameGenerator::generate()
+{
+	while (!queue_.empty()) {
+		const Frame &frame = queue_.front();
+		auto now = std::chrono::steady_clock::now();
+
+		if (now < next_) {
+			timer_.start(next_);
+			return;
+		}
+
+		/*
+		 * Schedule the next frame one frame duration after this one,
+		 * without bursting to catch up when requests come in late.
+		 */
+		auto duration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(frame.frameDuration);
+		next_ = std::max(next_ + duration, now);
+
+		uint64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+					     now.time_since_epoch()).count();
+
+		Request *request = frame.request;
+		for (const auto &[stream, buffer] : request->buffers())
+			fill(buffer, stream->configuration(), timestamp);
+
+		sequence_++;
+		queue_.pop();
+
+		frameGenerated.emit(request, timestamp);
+	}
+}
+
+void FrameGenerator::fill(FrameBuffer *buffer, const StreamConfiguration &cfg,
+			  uint64_t timestamp)
+{
+	FrameMetadata &metadata = buffer->_d()->metadata();
+	const std::vector<FrameBuffer::Plane> &planes = buffer->planes();
+
+	metadata.status = FrameMetadata::FrameSuccess;
+	metadata.sequence = sequence_;
+	metadata.timestamp = timestamp;
+
+	Span<FrameMetadata::Plane> metadataPlanes = metadata.planes();
+	for (unsigned int i = 0; i < metadataPlanes.size(); ++i)
+		metadataPlanes[i].bytesused = planes[i].length;
+
+	/* The memory mapping is cached in the buffer, this is cheap. */
+	MappedFrameBuffer map(buffer, MappedFrameBuffer::MapFlag::Write);
+	if (!map.isValid()) {
+		LOG(Virtual, Error) << "Failed to map buffer";
+		return;
+	}
+
+	const std::vector<Span<uint8_t>> &data = map.planes();
+
+	std::vector<DmaSyncer> syncers;
+	for (auto [i, plane] : utils::enumerate(planes)) {
+		if (i == 0 || plane.fd != planes[i - 1].fd)
+			syncers.emplace_back(plane.fd, DmaSyncer::SyncType::Write);
+	}
+
+	if (patterns_.insert(buffer).second) {
+		/* Diagonal gradient on the first plane, neutral chroma. */
+		Span<uint8_t> image = data[0];
+		for (unsigned int y = 0; y < image.size() / cfg.stride; ++y) {
+			uint8_t *line = image.data() + y * cfg.stride;
+			for (unsigned int x = 0; x < cfg.stride; ++x)
+				line[x] = x + y;
+		}
+
+		for (unsigned int i = 1; i < data.size(); ++i)
+			memset(data[i].data(), 0x80, data[i].size());
+	}
+
+	/* Mark the frame sequence on the first line. */
+	memset(data[0].data(), sequence_ & 0xff,
+	       std::min<size_t>(cfg.stride, data[0].size()));
+}
+
+} /* namespace libcamera */
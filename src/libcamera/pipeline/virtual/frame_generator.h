@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * frame_generator.h - Synthetic frame generator for the virtual pipeline
+ */
+
+#pragma once
+
+#include <chrono>
+#include <queue>
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+#include <libcamera/base/object.h>
+#include <libcamera/base/signal.h>
+#include <libcamera/base/timer.h>
+#include <libcamera/base/utils.h>
+
+namespace libcamera {
+
+class FrameBuffer;
+class Request;
+class StreamConfiguration;
+
+class FrameGenerator : public Object
+{
+public:
+	FrameGenerator();
+
+	void queueRequest(Request *request, utils::Duration frameDuration);
+	std::vector<Request *> stop();
+
+	Signal<Request *, uint64_t> frameGenerated;
+
+private:
+	struct Frame {
+		Request *request;
+		utils::Duration frameDuration;
+	};
+
+	void generate();
+	void fill(FrameBuffer *buffer, const StreamConfiguration &cfg,
+		  uint64_t timestamp);
+
+	Timer timer_;
+	std::queue<Frame> queue_;
+	std::chrono::steady_clock::time_point next_;
+	uint32_t sequence_;
+
+	std::set<const FrameBuffer *> patterns_;
+};
+
+} /* namespace libcamera */
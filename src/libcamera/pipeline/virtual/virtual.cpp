@@ -0,0 +1,478 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * virtual.cpp - Pipeline handler for virtual cameras
+ */
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <set>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include <libcamera/base/log.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/utils.h>
+
+#include <libcamera/camera.h>
+#include <libcamera/control_ids.h>
+#include <libcamera/controls.h>
+#include <libcamera/formats.h>
+#include <libcamera/property_ids.h>
+#include <libcamera/request.h>
+#include <libcamera/stream.h>
+
+#include <libcamera/ipa/ipa_interface.h>
+#include <libcamera/ipa/ipa_module_info.h>
+#include <libcamera/ipa/virtual_ipa_interface.h>
+#include <libcamera/ipa/virtual_ipa_proxy.h>
+
+#include "libcamera/internal/camera.h"
+#include "libcamera/internal/dma_buf_allocator.h"
+#include "libcamera/internal/formats.h"
+#include "libcamera/internal/framebuffer.h"
+#include "libcamera/internal/ipa_manager.h"
+#include "libcamera/internal/pipeline_handler.h"
+
+#include "frame_generator.h"
+
+namespace libcamera {
+
+LOG_DEFINE_CATEGORY(Virtual)
+
+using namespace std::chrono_literals;
+
+namespace {
+
+const std::vector<PixelFormat> kFormats = {
+	formats::NV12,
+	formats::YUYV,
+	formats::RGB888,
+	formats::XRGB8888,
+};
+
+const Size kMinSize{ 64, 64 };
+const Size kMaxSize{ 8192, 8192 };
+const Size kDefaultSize{ 1920, 1080 };
+
+constexpr unsigned int kNumStreams = 3;
+constexpr unsigned int kBufferCount = 4;
+
+/*
+ * Frame duration limits, in microseconds. A zero frame duration generates
+ * frames as fast as requests are queued.
+ */
+constexpr int64_t kMaxFrameDuration = 1000000;
+constexpr int64_t kDefaultFrameDuration = 33333;
+
+} /* namespace */
+
+class VirtualCameraData : public Camera::Private
+{
+public:
+	VirtualCameraData(PipelineHandler *pipe);
+
+	void frameGenerated(Request *request, uint64_t timestamp);
+	void frameProcessed(uint32_t frame, const ControlList &metadata);
+	void completeRequest(Request *request);
+	void setFrameDuration(const ControlList &controls);
+
+	unsigned int streamIndex(const Stream *stream) const
+	{
+		return stream - &streams_.front();
+	}
+
+	std::vector<Stream> streams_;
+
+	Thread thread_;
+	FrameGenerator generator_;
+	utils::Duration frameDuration_;
+	uint64_t lastTimestamp_;
+
+	std::unique_ptr<ipa::virt::IPAProxyVirtual> ipa_;
+	std::map<uint32_t, Request *> ipaRequests_;
+
+	DmaBufAllocator dmaHeap_;
+};
+
+class VirtualCameraConfiguration : public CameraConfiguration
+{
+public:
+	VirtualCameraConfiguration() = default;
+
+	Status validate() override;
+};
+
+class PipelineHandlerVirtual : public PipelineHandler
+{
+public:
+	PipelineHandlerVirtual(CameraManager *manager);
+
+	std::unique_ptr<CameraConfiguration> generateConfiguration(Camera *camera,
+								   Span<const StreamRole> roles) override;
+	int configure(Camera *camera, CameraConfiguration *config) override;
+
+	int exportFrameBuffers(Camera *camera, Stream *stream,
+			       std::vector<std::unique_ptr<FrameBuffer>> *buffers) override;
+
+	int start(Camera *camera, const ControlList *controls) override;
+	void stopDevice(Camera *camera) override;
+
+	int queueRequestDevice(Camera *camera, Request *request) override;
+
+	bool match(DeviceEnumerator *enumerator) override;
+
+private:
+	/*
+	 * Virtual cameras don't depend on any device, the pipeline handler
+	 * must only create them once.
+	 */
+	static bool created_;
+
+	VirtualCameraData *cameraData(Camera *camera)
+	{
+		return static_cast<VirtualCameraData *>(camera->_d());
+	}
+};
+
+bool PipelineHandlerVirtual::created_ = false;
+
+VirtualCameraData::VirtualCameraData(PipelineHandler *pipe)
+	: Camera::Private(pipe), streams_(kNumStreams),
+	  frameDuration_(kDefaultFrameDuration * 1us), lastTimestamp_(0),
+	  dmaHeap_(DmaBufAllocator::DmaBufAllocatorFlag::CmaHeap |
+		   DmaBufAllocator::DmaBufAllocatorFlag::SystemHeap)
+{
+	generator_.moveToThread(&thread_);
+
+	/*
+	 * The generator runs in its own thread, deliver its signal to the
+	 * pipeline handler thread.
+	 */
+	generator_.frameGenerated.connect(pipe, [this](Request *request, uint64_t timestamp) {
+		frameGenerated(request, timestamp);
+	});
+}
+
+void VirtualCameraData::frameGenerated(Request *request, uint64_t timestamp)
+{
+	request->metadata().set(controls::SensorTimestamp, timestamp);
+
+	if (lastTimestamp_)
+		request->metadata().set(controls::FrameDuration,
+					static_cast<int64_t>(timestamp - lastTimestamp_) / 1000);
+	lastTimestamp_ = timestamp;
+
+	if (ipa_) {
+		ipaRequests_[request->sequence()] = request;
+		ipa_->processFrame(request->sequence(), timestamp);
+		return;
+	}
+
+	completeRequest(request);
+}
+
+void VirtualCameraData::frameProcessed(uint32_t frame, const ControlList &metadata)
+{
+	auto it = ipaRequests_.find(frame);
+	if (it == ipaRequests_.end())
+		return;
+
+	Request *request = it->second;
+	ipaRequests_.erase(it);
+
+	request->metadata().merge(metadata);
+	completeRequest(request);
+}
+
+void VirtualCameraData::completeRequest(Request *request)
+{
+	PipelineHandler *pipe = Camera::Private::pipe();
+
+	for (const auto &[stream, buffer] : request->buffers())
+		pipe->completeBuffer(request, buffer);
+
+	pipe->completeRequest(request);
+}
+
+void VirtualCameraData::setFrameDuration(const ControlList &controls)
+{
+	const auto &limits = controls.get(controls::FrameDurationLimits);
+	if (!limits)
+		return;
+
+	int64_t duration = std::clamp<int64_t>((*limits)[0], 0, kMaxFrameDuration);
+	frameDuration_ = duration * 1us;
+}
+
+CameraConfiguration::Status VirtualCameraConfiguration::validate()
+{
+	Status status = Valid;
+
+	if (config_.empty())
+		return Invalid;
+
+	if (orientation != Orientation::Rotate0) {
+		orientation = Orientation::Rotate0;
+		status = Adjusted;
+	}
+
+	/* Cap the number of entries to the available streams. */
+	if (config_.size() > kNumStreams) {
+		config_.resize(kNumStreams);
+		status = Adjusted;
+	}
+
+	for (StreamConfiguration &cfg : config_) {
+		if (std::find(kFormats.begin(), kFormats.end(), cfg.pixelFormat) ==
+		    kFormats.end()) {
+			LOG(Virtual, Debug) << "Adjusting format to NV12";
+			cfg.pixelFormat = formats::NV12;
+			status = Adjusted;
+		}
+
+		/* Chroma subsampling requires even sizes. */
+		Size size = cfg.size.boundedTo(kMaxSize)
+				    .expandedTo(kMinSize)
+				    .alignedDownTo(2, 2);
+		if (cfg.size != size) {
+			LOG(Virtual, Debug)
+				<< "Adjusting size from " << cfg.size
+				<< " to " << size;
+			cfg.size = size;
+			status = Adjusted;
+		}
+
+		const PixelFormatInfo &info = PixelFormatInfo::info(cfg.pixelFormat);
+		cfg.stride = info.stride(cfg.size.width, 0, 1);
+		cfg.frameSize = info.frameSize(cfg.size, 1);
+		cfg.bufferCount = kBufferCount;
+	}
+
+	return status;
+}
+
+PipelineHandlerVirtual::PipelineHandlerVirtual(CameraManager *manager)
+	: PipelineHandler(manager)
+{
+}
+
+std::unique_ptr<CameraConfiguration>
+PipelineHandlerVirtual::generateConfiguration([[maybe_unused]] Camera *camera,
+					      Span<const StreamRole> roles)
+{
+	std::unique_ptr<CameraConfiguration> config =
+		std::make_unique<VirtualCameraConfiguration>();
+
+	if (roles.empty())
+		return config;
+
+	std::map<PixelFormat, std::vector<SizeRange>> formats;
+	for (const PixelFormat &format : kFormats)
+		formats[format] = { SizeRange{ kMinSize, kMaxSize, 2, 2 } };
+
+	for (unsigned int i = 0; i < roles.size(); ++i) {
+		StreamConfiguration cfg(formats);
+		cfg.pixelFormat = formats::NV12;
+		cfg.size = kDefaultSize;
+		cfg.bufferCount = kBufferCount;
+
+		config->addConfiguration(cfg);
+	}
+
+	config->validate();
+
+	return config;
+}
+
+int PipelineHandlerVirtual::configure(Camera *camera, CameraConfiguration *config)
+{
+	VirtualCameraData *data = cameraData(camera);
+	std::map<unsigned int, IPAStream> streamConfig;
+
+	for (unsigned int i = 0; i < config->size(); ++i) {
+		StreamConfiguration &cfg = config->at(i);
+
+		cfg.setStream(&data->streams_[i]);
+		streamConfig.emplace(i, IPAStream(cfg.pixelFormat, cfg.size));
+	}
+
+	if (data->ipa_)
+		return data->ipa_->configure(streamConfig);
+
+	return 0;
+}
+
+int PipelineHandlerVirtual::exportFrameBuffers(Camera *camera, Stream *stream,
+					       std::vector<std::unique_ptr<FrameBuffer>> *buffers)
+{
+	VirtualCameraData *data = cameraData(camera);
+	const StreamConfiguration &cfg = stream->configuration();
+	const PixelFormatInfo &info = PixelFormatInfo::info(cfg.pixelFormat);
+	unsigned int count = cfg.bufferCount;
+
+	/* Store all planes contiguously in a single dmabuf. */
+	for (unsigned int i = 0; i < count; ++i) {
+		std::string name = "virtual-" + std::to_string(data->streamIndex(stream)) +
+				   "-" + std::to_string(i);
+
+		UniqueFD fd = data->dmaHeap_.alloc(name.c_str(), cfg.frameSize);
+		if (!fd.isValid())
+			return -ENOMEM;
+
+		SharedFD sharedFd(std::move(fd));
+		std::vector<FrameBuffer::Plane> planes;
+		unsigned int offset = 0;
+
+		for (unsigned int j = 0; j < info.numPlanes(); ++j) {
+			FrameBuffer::Plane plane;
+			plane.fd = sharedFd;
+			plane.offset = offset;
+			plane.length = info.planeSize(cfg.size, j, 1);
+
+			offset += plane.length;
+			planes.push_back(std::move(plane));
+		}
+
+		buffers->push_back(std::make_unique<FrameBuffer>(planes));
+	}
+
+	return count;
+}
+
+int PipelineHandlerVirtual::start(Camera *camera, const ControlList *controls)
+{
+	VirtualCameraData *data = cameraData(camera);
+
+	if (controls)
+		data->setFrameDuration(*controls);
+
+	if (data->ipa_) {
+		int ret = data->ipa_->start();
+		if (ret < 0)
+			return ret;
+	}
+
+	data->lastTimestamp_ = 0;
+	data->thread_.start();
+
+	return 0;
+}
+
+void PipelineHandlerVirtual::stopDevice(Camera *camera)
+{
+	VirtualCameraData *data = cameraData(camera);
+
+	std::vector<Request *> requests =
+		data->generator_.invokeMethod(&FrameGenerator::stop,
+					      ConnectionTypeBlocking);
+
+	data->thread_.exit();
+	data->thread_.wait();
+
+	/* Process the frames generated before the generator stopped. */
+	Thread::current()->dispatchMessages(Message::Type::InvokeMessage);
+
+	if (data->ipa_)
+		data->ipa_->stop();
+
+	/*
+	 * Complete the requests that the IPA hasn't processed, their buffers
+	 * contain valid frames.
+	 */
+	for (const auto &[frame, request] : data->ipaRequests_)
+		data->completeRequest(request);
+	data->ipaRequests_.clear();
+
+	for (Request *request : requests) {
+		for (const auto &[stream, buffer] : request->buffers()) {
+			buffer->_d()->cancel();
+			completeBuffer(request, buffer);
+		}
+
+		completeRequest(request);
+	}
+}
+
+int PipelineHandlerVirtual::queueRequestDevice(Camera *camera, Request *request)
+{
+	VirtualCameraData *data = cameraData(camera);
+
+	data->setFrameDuration(request->controls());
+
+	if (data->ipa_)
+		data->ipa_->queueRequest(request->sequence(), request->controls());
+
+	data->generator_.invokeMethod(&FrameGenerator::queueRequest,
+				      ConnectionTypeQueued, request,
+				      data->frameDuration_);
+
+	return 0;
+}
+
+bool PipelineHandlerVirtual::match([[maybe_unused]] DeviceEnumerator *enumerator)
+{
+	if (created_)
+		return false;
+
+	created_ = true;
+
+	/* Virtual cameras are only created on demand, for benchmarking. */
+	const char *env = utils::secure_getenv("LIBCAMERA_VIRTUAL_CAMERAS");
+	unsigned int count = env ? strtoul(env, nullptr, 10) : 0;
+	if (!count)
+		return false;
+
+	for (unsigned int i = 0; i < count; ++i) {
+		std::unique_ptr<VirtualCameraData> data =
+			std::make_unique<VirtualCameraData>(this);
+
+		if (!data->dmaHeap_.isValid()) {
+			LOG(Virtual, Error) << "No DMA heap available";
+			return false;
+		}
+
+		data->ipa_ = IPAManager::createIPA<ipa::virt::IPAProxyVirtual>(this, 0, 0);
+		if (data->ipa_) {
+			data->ipa_->frameProcessed.connect(data.get(),
+							   &VirtualCameraData::frameProcessed);
+
+			int ret = data->ipa_->init(IPASettings{ "", "virtual" });
+			if (ret < 0) {
+				LOG(Virtual, Error) << "Failed to initialize IPA";
+				return false;
+			}
+		} else {
+			LOG(Virtual, Warning)
+				<< "No matching IPA found, completing frames directly";
+		}
+
+		ControlInfoMap::Map ctrls;
+		ctrls.emplace(&controls::FrameDurationLimits,
+			      ControlInfo{ int64_t{ 0 }, kMaxFrameDuration,
+					   kDefaultFrameDuration });
+		data->controlInfo_ = ControlInfoMap(std::move(ctrls), controls::controls);
+
+		data->properties_.set(properties::Model, "Virtual");
+		data->properties_.set(properties::Location,
+				      properties::CameraLocationExternal);
+
+		std::set<Stream *> streams;
+		for (Stream &stream : data->streams_)
+			streams.insert(&stream);
+
+		std::string id = "Virtual" + std::to_string(i);
+		std::shared_ptr<Camera> camera =
+			Camera::create(std::move(data), id, streams);
+		registerCamera(std::move(camera));
+	}
+
+	return true;
+}
+
+REGISTER_PIPELINE_HANDLER(PipelineHandlerVirtual)
+
+} /* namespace libcamera */
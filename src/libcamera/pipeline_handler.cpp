@@ -16,14 +16,18 @@
 #include <libcamera/base/utils.h>
 
 #include <libcamera/camera.h>
+#include <libcamera/control_ids.h>
 #include <libcamera/framebuffer.h>
 #include <libcamera/property_ids.h>
 
 #include "libcamera/internal/camera.h"
 #include "libcamera/internal/camera_manager.h"
 #include "libcamera/internal/device_enumerator.h"
+#include "libcamera/internal/fence_waiter.h"
+#include "libcamera/internal/frame_timing.h"
 #include "libcamera/internal/framebuffer.h"
 #include "libcamera/internal/media_device.h"
+#include "libcamera/internal/metrics.h"
 #include "libcamera/internal/request.h"
 #include "libcamera/internal/tracepoints.h"
 
@@ -47,6 +51,17 @@ namespace libcamera {
 
 LOG_DEFINE_CATEGORY(Pipeline)
 
+namespace {
+
+MetricCounter requestsQueued("pipeline.requests_queued");
+MetricCounter requestsCompleted("pipeline.requests_completed");
+MetricCounter requestsCancelled("pipeline.requests_cancelled");
+MetricGauge requestsInFlight("pipeline.requests_in_flight");
+MetricCounter framesDroppedCounter("pipeline.frames_dropped");
+MetricHistogram firstFrameLatency("pipeline.first_frame_latency_us");
+
+} /* namespace */
+
 /**
  * \class PipelineHandler
  * \brief Create and manage cameras based on a set of media devices
@@ -58,18 +73,34 @@ LOG_DEFINE_CATEGORY(Pipeline)
  * They implement std::enable_shared_from_this<> in order to create new
  * std::shared_ptr<> in code paths originating from member functions of the
  * PipelineHandler class where only the 'this' pointer is available.
+ *
+ * Pipeline handlers may run in a thread of their own instead of the
+ * CameraManager thread, see CameraManager. All their member functions are then
+ * called from that thread, including match(), and all the objects they create
+ * are bound to it. References to the CameraManager thread in the documentation
+ * of the member functions shall be understood as the pipeline handler thread
+ * in that case.
  */
 
 /**
  * \brief Construct a PipelineHandler instance
  * \param[in] manager The camera manager
+ * \param[in] maxQueuedRequestsDevice The maximum number of requests queued to
+ * the device
+ *
+ * The \a maxQueuedRequestsDevice value limits the number of requests queued
+ * to the device through queueRequestDevice() for each camera. Requests queued
+ * beyond this limit wait until a queued request completes. Applications can
+ * lower the limit with CameraConfiguration::maxQueuedRequests.
  *
  * In order to honour the std::enable_shared_from_this<> contract,
  * PipelineHandler instances shall never be constructed manually, but always
  * through the PipelineHandlerFactoryBase::create() function.
  */
-PipelineHandler::PipelineHandler(CameraManager *manager)
-	: manager_(manager), useCount_(0)
+PipelineHandler::PipelineHandler(CameraManager *manager,
+				 unsigned int maxQueuedRequestsDevice)
+	: manager_(manager), maxQueuedRequestsDevice_(maxQueuedRequestsDevice),
+	  useCount_(0)
 {
 }
 
@@ -328,16 +359,26 @@ void PipelineHandler::unlockMediaDevices()
  */
 void PipelineHandler::stop(Camera *camera)
 {
+	LIBCAMERA_TRACEPOINT(pipeline_stop_device_begin, name(),
+			     camera->id().c_str());
+
 	/* Stop the pipeline handler and let the queued requests complete. */
 	stopDevice(camera);
 
-	/* Cancel and signal as complete all waiting requests. */
+	LIBCAMERA_TRACEPOINT(pipeline_stop_device_end, name(),
+			     camera->id().c_str(), waitingRequests_.size());
+
+	/*
+	 * Cancel and signal as complete all waiting requests. They must go
+	 * through doQueueRequest() to be tracked in the queued requests, which
+	 * completes them immediately as they are cancelled.
+	 */
 	while (!waitingRequests_.empty()) {
 		Request *request = waitingRequests_.front();
 		waitingRequests_.pop();
 
 		request->_d()->cancel();
-		completeRequest(request);
+		doQueueRequest(request);
 	}
 
 	/* Make sure no requests are pending. */
@@ -345,6 +386,10 @@ void PipelineHandler::stop(Camera *camera)
 	ASSERT(data->queuedRequests_.empty());
 
 	data->requestSequence_ = 0;
+	data->nextFrame_.reset();
+	data->framesDropped_ = 0;
+	data->startTime_.reset();
+	data->frameTiming_.reset();
 }
 
 /**
@@ -354,6 +399,10 @@ void PipelineHandler::stop(Camera *camera)
  *
  * This function stops capturing and processing requests immediately. All
  * pending requests are cancelled and complete immediately in an error state.
+ *
+ * Stopping a camera blocks the application, pipeline handlers that stop
+ * multiple video devices should use V4L2VideoDevice::streamOff(Span) to stop
+ * them concurrently.
  */
 
 /**
@@ -414,9 +463,32 @@ void PipelineHandler::queueRequest(Request *request)
 {
 	LIBCAMERA_TRACEPOINT(request_queue, request);
 
+	requestsQueued.add();
+	requestsInFlight.add(1);
+
 	waitingRequests_.push(request);
 
-	request->_d()->prepare(300ms);
+	/* Create the fence waiter in the thread the requests are prepared in. */
+	if (!fenceWaiter_)
+		fenceWaiter_ = std::make_unique<FenceWaiter>();
+
+	request->_d()->prepare(fenceWaiter_.get(), 300ms);
+}
+
+/**
+ * \brief Queue a group of requests
+ * \param[in] requests The requests to queue
+ *
+ * This function queues multiple capture requests, possibly for different
+ * cameras, in one go. It is used by CameraGroup to queue requests atomically
+ * with respect to other requests queued to the pipeline handler.
+ *
+ * \context This function is called from the CameraManager thread.
+ */
+void PipelineHandler::queueRequests(const std::vector<Request *> &requests)
+{
+	for (Request *request : requests)
+		queueRequest(request);
 }
 
 /**
@@ -428,15 +500,18 @@ void PipelineHandler::doQueueRequest(Request *request)
 
 	Camera *camera = request->_d()->camera();
 	Camera::Private *data = camera->_d();
-	data->queuedRequests_.push_back(request);
-
 	request->_d()->sequence_ = data->requestSequence_++;
+	data->queuedRequests_.push(request->_d()->sequence_, request);
 
 	if (request->_d()->cancelled_) {
 		completeRequest(request);
 		return;
 	}
 
+	/* Every request queued to the device consumes one frame. */
+	if (data->nextFrame_)
+		(*data->nextFrame_)++;
+
 	int ret = queueRequestDevice(camera, request);
 	if (ret) {
 		request->_d()->cancel();
@@ -444,11 +519,42 @@ void PipelineHandler::doQueueRequest(Request *request)
 	}
 }
 
+/**
+ * \brief Check if a request must be held to be applied to its target frame
+ */
+bool PipelineHandler::holdRequest(Request *request)
+{
+	const std::optional<uint32_t> &target = request->_d()->targetSequence_;
+	if (!target)
+		return false;
+
+	const std::optional<uint32_t> &next = request->_d()->camera()->_d()->nextFrame_;
+	if (!next) {
+		LOG(Pipeline, Debug)
+			<< "Frame-accurate scheduling not supported, ignoring target frame";
+		return false;
+	}
+
+	/* Compare sequence numbers in a wrap-around-safe way. */
+	int32_t delta = static_cast<int32_t>(*target - *next);
+	if (delta > 0)
+		return true;
+
+	if (delta < 0)
+		LOG(Pipeline, Warning)
+			<< "Request " << request->cookie() << " target frame "
+			<< *target << " missed, next frame is " << *next;
+
+	return false;
+}
+
 /**
  * \brief Queue prepared requests to the device
  *
  * Iterate the list of waiting requests and queue them to the device one
- * by one if they have been prepared.
+ * by one if they have been prepared. Requests are held, along with all the
+ * requests that follow them, until they can be queued in time for their target
+ * frame.
  */
 void PipelineHandler::doQueueRequests()
 {
@@ -457,11 +563,48 @@ void PipelineHandler::doQueueRequests()
 		if (!request->_d()->prepared_)
 			break;
 
-		doQueueRequest(request);
+		if (holdRequest(request))
+			break;
+
+		/* Limit the number of requests in flight in the device. */
+		Camera::Private *data = request->_d()->camera()->_d();
+		if (data->queuedRequests_.size() >= data->maxQueuedRequests_)
+			break;
+
 		waitingRequests_.pop();
+		doQueueRequest(request);
 	}
 }
 
+/**
+ * \brief Notify the start of a frame
+ * \param[in] camera The camera
+ * \param[in] sequence The sequence number of the frame
+ *
+ * Pipeline handlers that support frame-accurate request scheduling shall call
+ * this function when the camera starts capturing the frame identified by
+ * \a sequence. Frames that have started can't be affected by requests queued
+ * to the device anymore, this function thus updates
+ * Camera::Private::nextFrame_ accordingly when frames are captured without
+ * requests, and queues the requests held until their target frame.
+ *
+ * This function has no effect if the pipeline handler hasn't set
+ * Camera::Private::nextFrame_ when starting the camera.
+ *
+ * \context This function shall be called from the CameraManager thread.
+ */
+void PipelineHandler::frameStarted(Camera *camera, uint32_t sequence)
+{
+	std::optional<uint32_t> &next = camera->_d()->nextFrame_;
+	if (!next)
+		return;
+
+	if (static_cast<int32_t>(sequence + 1 - *next) > 0)
+		next = sequence + 1;
+
+	doQueueRequests();
+}
+
 /**
  * \fn PipelineHandler::queueRequestDevice()
  * \brief Queue a request to the device
@@ -503,6 +646,55 @@ bool PipelineHandler::completeBuffer(Request *request, FrameBuffer *buffer)
 	return request->_d()->completeBuffer(buffer);
 }
 
+/**
+ * \brief Signal the availability of metadata for a request
+ * \param[in] request The request the metadata belongs to
+ * \param[in] metadata The metadata
+ *
+ * This function shall be called by pipeline handlers to report metadata for
+ * \a request as soon as it becomes available, without waiting for the request
+ * to complete. The \a metadata is merged into the request metadata and the
+ * Camera::metadataAvailable signal is emitted. Controls already present in
+ * the request metadata are overwritten.
+ *
+ * \context This function shall be called from the CameraManager thread.
+ */
+void PipelineHandler::metadataAvailable(Request *request, const ControlList &metadata)
+{
+	if (metadata.empty())
+		return;
+
+	for (const auto &[id, value] : metadata)
+		request->metadata().set(id, value);
+
+	Camera *camera = request->_d()->camera();
+	camera->metadataAvailable.emit(request, metadata);
+}
+
+/**
+ * \brief Report frames dropped by a camera
+ * \param[in] camera The camera
+ * \param[in] count The number of frames dropped
+ *
+ * Pipeline handlers shall call this function when they detect that frames have
+ * been dropped by the camera, typically from the V4L2 sequence gaps reported by
+ * V4L2VideoDevice::lastFrameDrops() for the device closest to the sensor.
+ * Frames dropped at later stages of the pipeline shall only be reported if
+ * they haven't been reported already for an earlier stage. The frame drops
+ * are reported to applications in the metadata of the next completed request
+ * with the FramesDropped control.
+ *
+ * \context This function shall be called from the CameraManager thread.
+ */
+void PipelineHandler::framesDropped(Camera *camera, unsigned int count)
+{
+	if (!count)
+		return;
+
+	camera->_d()->framesDropped_ += count;
+	framesDroppedCounter.add(count);
+}
+
 /**
  * \brief Signal request completion
  * \param[in] request The request that has completed
@@ -511,29 +703,96 @@ bool PipelineHandler::completeBuffer(Request *request, FrameBuffer *buffer)
  * the request has completed. The request is no longer managed by the pipeline
  * handler and shall not be accessed once this function returns.
  *
- * This function ensures that requests will be returned to the application in
- * submission order, the pipeline handler may call it on any complete request
- * without any ordering constraint.
+ * Unless the camera has been configured with
+ * CameraConfiguration::RequestOrder::Completion, this function ensures that
+ * requests will be returned to the application in submission order. The
+ * pipeline handler may call it on any complete request without any ordering
+ * constraint.
+ *
+ * The SensorTimestamp and FrameDuration metadata of the request, when present,
+ * update the frame timing model of the camera. Its predictions are reported in
+ * the request metadata with the FrameInterval and NextSensorTimestamp
+ * controls. Pipeline handlers shall thus set the request metadata before
+ * completing the request.
  *
  * \context This function shall be called from the CameraManager thread.
  */
 void PipelineHandler::completeRequest(Request *request)
 {
 	Camera *camera = request->_d()->camera();
+	Camera::Private *data = camera->_d();
+	unsigned int framesDropped = 0;
+
+	if (data->framesDropped_ && !request->_d()->cancelled_) {
+		framesDropped = data->framesDropped_;
+		request->metadata().set(controls::draft::FramesDropped,
+					framesDropped);
+		data->framesDropped_ = 0;
+	}
+
+	/*
+	 * Update the frame timing model and report its prediction for the
+	 * frame that follows the request.
+	 */
+	const auto timestamp = request->metadata().get(controls::SensorTimestamp);
+	if (timestamp && !request->_d()->cancelled_) {
+		FrameTiming &timing = data->frameTiming_;
+
+		timing.addFrame(*timestamp,
+				request->metadata().get(controls::FrameDuration),
+				framesDropped);
+
+		/* Requests completed out of order don't update the model. */
+		if (timing.isValid() && *timing.frameStart(0) == *timestamp) {
+			request->metadata().set(controls::draft::FrameInterval,
+						timing.frameInterval());
+			request->metadata().set(controls::draft::NextSensorTimestamp,
+						*timing.frameStart());
+		}
+	}
 
 	request->_d()->complete();
 
-	Camera::Private *data = camera->_d();
+	if (request->status() == Request::RequestCancelled) {
+		requestsCancelled.add();
+	} else {
+		requestsCompleted.add();
 
-	while (!data->queuedRequests_.empty()) {
-		Request *req = data->queuedRequests_.front();
-		if (req->status() == Request::RequestPending)
-			break;
+		/* Measure the latency from Camera::start() to the first frame. */
+		if (data->startTime_) {
+			auto latency = utils::clock::now() - *data->startTime_;
+			firstFrameLatency.record(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+			data->startTime_.reset();
+
+			LOG(Pipeline, Debug)
+				<< "First frame captured in "
+				<< utils::Duration(latency).get<std::milli>() << " ms";
+		}
+	}
+	requestsInFlight.add(-1);
 
-		ASSERT(!req->hasPendingBuffers());
-		data->queuedRequests_.pop_front();
-		camera->requestComplete(req);
+	if (data->requestOrder_ == CameraConfiguration::RequestOrder::Completion) {
+		ASSERT(!request->hasPendingBuffers());
+		data->queuedRequests_.remove(request->sequence());
+		camera->requestComplete(request);
+	} else {
+		while (!data->queuedRequests_.empty()) {
+			Request *req = data->queuedRequests_.front();
+			if (req->status() == Request::RequestPending)
+				break;
+
+			ASSERT(!req->hasPendingBuffers());
+			data->queuedRequests_.pop();
+			camera->requestComplete(req);
+		}
 	}
+
+	/*
+	 * Completing requests may make room for waiting requests. Don't queue
+	 * them when the camera is stopping, stop() cancels them.
+	 */
+	if (data->isRunning())
+		doQueueRequests();
 }
 
 /**
@@ -719,6 +978,12 @@ void PipelineHandler::disconnect()
  * \return The pipeline handler name
  */
 
+/**
+ * \fn PipelineHandler::maxQueuedRequestsDevice()
+ * \brief Retrieve the maximum number of requests queued to the device
+ * \return The maximum number of requests queued to the device per camera
+ */
+
 /**
  * \class PipelineHandlerFactoryBase
  * \brief Base class for pipeline handler factories
@@ -18,6 +18,7 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <utility>
 #include <vector>
 
 #include <libcamera/base/event_notifier.h>
@@ -76,19 +77,34 @@ void ProcessManager::sighandler()
 		return;
 	}
 
-	for (auto it = processes_.begin(); it != processes_.end(); ) {
-		Process *process = *it;
+	/*
+	 * Processes may be registered from other threads when pipeline
+	 * handlers run in their own thread. Collect the processes that have
+	 * died with the lock held, and notify them without the lock to let
+	 * the slots start new processes.
+	 */
+	std::vector<std::pair<Process *, int>> died;
 
-		int wstatus;
-		pid_t pid = waitpid(process->pid_, &wstatus, WNOHANG);
-		if (process->pid_ != pid) {
-			++it;
-			continue;
+	{
+		MutexLocker locker(mutex_);
+
+		for (auto it = processes_.begin(); it != processes_.end(); ) {
+			Process *process = *it;
+
+			int wstatus;
+			pid_t pid = waitpid(process->pid_, &wstatus, WNOHANG);
+			if (process->pid_ != pid) {
+				++it;
+				continue;
+			}
+
+			it = processes_.erase(it);
+			died.emplace_back(process, wstatus);
 		}
+	}
 
-		it = processes_.erase(it);
+	for (const auto &[process, wstatus] : died)
 		process->died(wstatus);
-	}
 }
 
 /**
@@ -101,6 +117,8 @@ void ProcessManager::sighandler()
  */
 void ProcessManager::registerProcess(Process *proc)
 {
+	MutexLocker locker(mutex_);
+
 	processes_.push_back(proc);
 }
 
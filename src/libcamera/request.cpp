@@ -7,6 +7,7 @@
 
 #include "libcamera/internal/request.h"
 
+#include <algorithm>
 #include <map>
 #include <sstream>
 
@@ -20,6 +21,7 @@
 
 #include "libcamera/internal/camera.h"
 #include "libcamera/internal/camera_controls.h"
+#include "libcamera/internal/fence_waiter.h"
 #include "libcamera/internal/framebuffer.h"
 #include "libcamera/internal/tracepoints.h"
 
@@ -79,7 +81,7 @@ bool Request::Private::hasPendingBuffers() const
  * \brief Complete a buffer for the request
  * \param[in] buffer The buffer that has completed
  *
- * A request tracks the status of all buffers it contains through a set of
+ * A request tracks the status of all buffers it contains through a list of
  * pending buffers. This function removes the \a buffer from the set to mark it
  * as complete. All buffers associate with the request shall be marked as
  * complete by calling this function once and once only before reporting the
@@ -90,10 +92,11 @@ bool Request::Private::hasPendingBuffers() const
  */
 bool Request::Private::completeBuffer(FrameBuffer *buffer)
 {
-	LIBCAMERA_TRACEPOINT(request_complete_buffer, this, buffer);
+	LIBCAMERA_TRACEPOINT(request_complete_buffer, _o<Request>(), buffer);
 
-	int ret = pending_.erase(buffer);
-	ASSERT(ret == 1);
+	auto it = std::find(pending_.begin(), pending_.end(), buffer);
+	ASSERT(it != pending_.end());
+	pending_.erase(it);
 
 	buffer->_d()->setRequest(nullptr);
 
@@ -121,13 +124,15 @@ void Request::Private::complete()
 
 	LOG(Request, Debug) << request->toString();
 
-	LIBCAMERA_TRACEPOINT(request_complete, this);
+	LIBCAMERA_TRACEPOINT(request_complete, request);
 }
 
 void Request::Private::doCancelRequest()
 {
 	Request *request = _o<Request>();
 
+	stopWaiting();
+
 	for (FrameBuffer *buffer : pending_) {
 		buffer->_d()->cancel();
 		camera_->bufferCompleted.emit(request, buffer);
@@ -135,8 +140,6 @@ void Request::Private::doCancelRequest()
 
 	cancelled_ = true;
 	pending_.clear();
-	notifiers_.clear();
-	timer_.reset();
 }
 
 /**
@@ -149,7 +152,7 @@ void Request::Private::doCancelRequest()
  */
 void Request::Private::cancel()
 {
-	LIBCAMERA_TRACEPOINT(request_cancel, this);
+	LIBCAMERA_TRACEPOINT(request_cancel, _o<Request>());
 
 	Request *request = _o<Request>();
 	ASSERT(request->status() == RequestPending);
@@ -166,11 +169,11 @@ void Request::Private::cancel()
 void Request::Private::reset()
 {
 	sequence_ = 0;
+	targetSequence_.reset();
 	cancelled_ = false;
 	prepared_ = false;
+	stopWaiting();
 	pending_.clear();
-	notifiers_.clear();
-	timer_.reset();
 }
 
 /*
@@ -185,15 +188,17 @@ void Request::Private::emitPrepareCompleted()
 
 /**
  * \brief Prepare the Request to be queued to the device
+ * \param[in] waiter The fence waiter
  * \param[in] timeout Optional expiration timeout
  *
  * Prepare a Request to be queued to the hardware device by ensuring it is
  * ready for the incoming memory transfers.
  *
  * This currently means waiting on each frame buffer acquire fence to be
- * signalled. An optional expiration timeout can be specified. If not all the
- * fences have been signalled correctly before the timeout expires the Request
- * is cancelled.
+ * signalled. The fences are waited for with the \a waiter, shared by all the
+ * requests of the pipeline handler. An optional expiration timeout can be
+ * specified. If not all the fences have been signalled correctly before the
+ * timeout expires the Request is cancelled.
  *
  * The function immediately emits the prepared signal if all the prepare
  * operations have been completed synchronously. If instead the prepare
@@ -213,41 +218,31 @@ void Request::Private::emitPrepareCompleted()
  * The intended user of this function is the PipelineHandler base class, which
  * 'prepares' a Request before queuing it to the hardware device.
  */
-void Request::Private::prepare(std::chrono::milliseconds timeout)
+void Request::Private::prepare(FenceWaiter *waiter, std::chrono::milliseconds timeout)
 {
-	/* Create and connect one notifier for each synchronization fence. */
+	fenceWaiter_ = waiter;
+
+	/* Wait for each synchronization fence. */
 	for (FrameBuffer *buffer : pending_) {
-		const Fence *fence = buffer->_d()->fence();
-		if (!fence)
+		if (!buffer->_d()->fence())
 			continue;
 
-		std::unique_ptr<EventNotifier> notifier =
-			std::make_unique<EventNotifier>(fence->fd().get(),
-							EventNotifier::Read);
-
-		notifier->activated.connect(this, [this, buffer] {
-							notifierActivated(buffer);
-					    });
+		if (waiter->add(buffer) < 0) {
+			cancel();
+			emitPrepareCompleted();
+			return;
+		}
 
-		notifiers_[buffer] = std::move(notifier);
+		pendingFences_++;
 	}
 
-	if (notifiers_.empty()) {
+	if (!pendingFences_) {
 		emitPrepareCompleted();
 		return;
 	}
 
-	/*
-	 * In case a timeout is specified, create a timer and set it up.
-	 *
-	 * The timer must be created here instead of in the Request constructor,
-	 * in order to be bound to the pipeline handler thread.
-	 */
-	if (timeout != 0ms) {
-		timer_ = std::make_unique<Timer>();
-		timer_->timeout.connect(this, &Request::Private::timeout);
-		timer_->start(timeout);
-	}
+	if (timeout != 0ms)
+		waiter->startTimeout(this, timeout);
 }
 
 /**
@@ -263,35 +258,53 @@ void Request::Private::prepare(std::chrono::milliseconds timeout)
  * if they have failed preparing.
  */
 
-void Request::Private::notifierActivated(FrameBuffer *buffer)
+void Request::Private::fenceSignalled(FrameBuffer *buffer)
 {
+	ASSERT(pendingFences_);
+
 	/* Close the fence if successfully signalled. */
-	ASSERT(buffer);
 	buffer->releaseFence();
 
-	/* Remove the entry from the map and check if other fences are pending. */
-	auto it = notifiers_.find(buffer);
-	ASSERT(it != notifiers_.end());
-	notifiers_.erase(it);
-
 	Request *request = _o<Request>();
 	LOG(Request, Debug)
 		<< "Request " << request->cookie() << " buffer " << buffer
 		<< " fence signalled";
 
-	if (!notifiers_.empty())
+	if (--pendingFences_)
 		return;
 
-	/* All fences completed, delete the timer and emit the prepared signal. */
-	timer_.reset();
+	/* All fences completed, stop the timer and emit the prepared signal. */
+	fenceWaiter_->stopTimeout(this);
+	fenceWaiter_ = nullptr;
 	emitPrepareCompleted();
 }
 
+/*
+ * Stop waiting for the fences that haven't been signalled yet. The fences are
+ * left in the buffers.
+ */
+void Request::Private::stopWaiting()
+{
+	if (!fenceWaiter_)
+		return;
+
+	if (pendingFences_) {
+		for (FrameBuffer *buffer : pending_) {
+			if (buffer->_d()->fence())
+				fenceWaiter_->remove(buffer);
+		}
+
+		fenceWaiter_->stopTimeout(this);
+		pendingFences_ = 0;
+	}
+
+	fenceWaiter_ = nullptr;
+}
+
 void Request::Private::timeout()
 {
 	/* A timeout can only happen if there are fences not yet signalled. */
-	ASSERT(!notifiers_.empty());
-	notifiers_.clear();
+	ASSERT(pendingFences_);
 
 	Request *request = _o<Request>();
 	LOG(Request, Debug) << "Request prepare timeout: " << request->cookie();
@@ -389,7 +402,7 @@ void Request::reuse(ReuseFlag flags)
 		for (auto pair : bufferMap_) {
 			FrameBuffer *buffer = pair.second;
 			buffer->_d()->setRequest(this);
-			_d()->pending_.insert(buffer);
+			_d()->pending_.push_back(buffer);
 		}
 	} else {
 		bufferMap_.clear();
@@ -474,7 +487,7 @@ int Request::addBuffer(const Stream *stream, FrameBuffer *buffer,
 	}
 
 	buffer->_d()->setRequest(this);
-	_d()->pending_.insert(buffer);
+	_d()->pending_.push_back(buffer);
 	bufferMap_[stream] = buffer;
 
 	/*
@@ -544,6 +557,44 @@ uint32_t Request::sequence() const
 	return _d()->sequence_;
 }
 
+/**
+ * \brief Set the frame the request shall be applied to
+ * \param[in] sequence The target frame sequence number
+ *
+ * By default, requests are queued to the device as soon as possible, and their
+ * controls are applied to the first frame the pipeline can apply them to. This
+ * function sets a target frame for the request, identified by the sequence
+ * number reported in FrameMetadata::sequence. The pipeline handler then holds
+ * the request, and all requests queued after it, until the request can be
+ * queued to the device in time for its controls to be applied to the target
+ * frame.
+ *
+ * If the target frame has already passed when the request reaches the front of
+ * the queue, the request is queued immediately. Applications can compare the
+ * target with the sequence number of the completed buffers to detect this
+ * condition.
+ *
+ * Frame-accurate scheduling requires support from the pipeline handler. When
+ * the pipeline handler doesn't support it, the target frame is ignored. The
+ * target frame is reset by reuse().
+ *
+ * Passing std::nullopt removes the target frame.
+ */
+void Request::setTargetSequence(std::optional<uint32_t> sequence)
+{
+	_d()->targetSequence_ = sequence;
+}
+
+/**
+ * \brief Retrieve the frame the request shall be applied to
+ * \return The target frame sequence number, or std::nullopt if the request has
+ * no target frame
+ */
+std::optional<uint32_t> Request::targetSequence() const
+{
+	return _d()->targetSequence_;
+}
+
 /**
  * \fn Request::cookie()
  * \brief Retrieve the cookie set when the request was created
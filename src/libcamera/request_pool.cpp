@@ -0,0 +1,125 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * request_pool.cpp - Pool of reusable capture requests
+ */
+
+#include <libcamera/request_pool.h>
+
+#include <libcamera/base/log.h>
+
+#include <libcamera/request.h>
+
+/**
+ * \file request_pool.h
+ * \brief Pool of reusable capture requests
+ */
+
+namespace libcamera {
+
+/**
+ * \class RequestPool
+ * \brief A fixed-size pool of requests bound to capture buffers
+ *
+ * Most applications capture frames by cycling a fixed set of requests, each
+ * associated with the same buffers for the whole capture session. The
+ * RequestPool implements this pattern: it owns a set of requests created by
+ * Camera::createRequestPool(), each with one buffer per stream added once at
+ * creation time.
+ *
+ * Applications acquire() an idle request, optionally set its controls, queue
+ * it to the camera, and release() it back to the pool once they are done with
+ * the completed request and its buffers. Acquiring a request resets it for
+ * reuse with the same buffers. Neither operation allocates memory, which makes
+ * the pool suitable for capture loops that must not allocate memory in the
+ * steady state.
+ *
+ * The cookie of each request is set to its index in the pool.
+ *
+ * The acquire() and release() functions are thread-safe. The pool must not be
+ * destroyed while requests are queued to the camera.
+ */
+
+RequestPool::RequestPool(std::vector<std::unique_ptr<Request>> requests)
+	: requests_(std::move(requests))
+{
+	free_.reserve(requests_.size());
+
+	/* Hand out requests in index order. */
+	for (auto it = requests_.rbegin(); it != requests_.rend(); ++it)
+		free_.push_back(it->get());
+}
+
+RequestPool::~RequestPool() = default;
+
+/**
+ * \brief Acquire an idle request from the pool
+ *
+ * The request is reset with Request::reuse(Request::ReuseBuffers), and is
+ * ready to be queued to the camera.
+ *
+ * \return An idle request, or nullptr if all requests are in use
+ */
+Request *RequestPool::acquire()
+{
+	Request *request;
+
+	{
+		std::lock_guard<std::mutex> locker(mutex_);
+
+		if (free_.empty())
+			return nullptr;
+
+		request = free_.back();
+		free_.pop_back();
+	}
+
+	request->reuse(Request::ReuseBuffers);
+
+	return request;
+}
+
+/**
+ * \brief Release a request back to the pool
+ * \param[in] request The request
+ *
+ * The \a request shall have been acquired from this pool, and shall not be
+ * queued to the camera. The request metadata and buffers remain accessible
+ * until the request is acquired again.
+ */
+void RequestPool::release(Request *request)
+{
+	ASSERT(request->cookie() < requests_.size() &&
+	       requests_[request->cookie()].get() == request);
+
+	std::lock_guard<std::mutex> locker(mutex_);
+
+	ASSERT(free_.size() < requests_.size());
+	free_.push_back(request);
+}
+
+/**
+ * \fn RequestPool::size()
+ * \brief Retrieve the number of requests in the pool
+ * \return The number of requests in the pool
+ */
+
+/**
+ * \brief Retrieve the number of idle requests in the pool
+ * \return The number of requests that can be acquired
+ */
+unsigned int RequestPool::available() const
+{
+	std::lock_guard<std::mutex> locker(mutex_);
+
+	return free_.size();
+}
+
+/**
+ * \fn RequestPool::requests()
+ * \brief Retrieve all the requests in the pool
+ * \return The requests in the pool, indexed by their cookie
+ */
+
+} /* namespace libcamera */
@@ -0,0 +1,146 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * request_queue.cpp - Ring buffer of in-flight requests
+ */
+
+#include "libcamera/internal/request_queue.h"
+
+#include <utility>
+
+#include <libcamera/base/log.h>
+
+/**
+ * \file request_queue.h
+ * \brief Ring buffer of in-flight requests
+ */
+
+namespace libcamera {
+
+/**
+ * \class RequestQueue
+ * \brief Ring buffer of requests indexed by their sequence number
+ *
+ * The RequestQueue tracks the requests queued to a pipeline handler and not
+ * yet completed. Requests are stored in slots indexed by their sequence
+ * number, which allows both completing requests in submission order from the
+ * front of the queue, and removing requests completed out of order in constant
+ * time.
+ *
+ * Requests must be pushed with consecutive sequence numbers, starting from an
+ * arbitrary value when the queue is empty. The front of the queue is always
+ * the oldest request that hasn't been removed.
+ *
+ * The ring is sized for the expected maximum number of in-flight requests and
+ * doesn't allocate memory as long as that number isn't exceeded. When it is,
+ * the capacity is doubled.
+ */
+
+/**
+ * \brief Construct a RequestQueue
+ * \param[in] capacity The initial capacity, rounded up to a power of two
+ */
+RequestQueue::RequestQueue(unsigned int capacity)
+	: head_(0), tail_(0), size_(0)
+{
+	unsigned int size = 1;
+	while (size < capacity)
+		size <<= 1;
+
+	slots_.resize(size, nullptr);
+}
+
+/**
+ * \fn RequestQueue::empty()
+ * \brief Check if the queue is empty
+ * \return True if the queue contains no request, false otherwise
+ */
+
+/**
+ * \fn RequestQueue::size()
+ * \brief Retrieve the number of requests in the queue
+ * \return The number of requests in the queue
+ */
+
+/**
+ * \brief Add a request at the back of the queue
+ * \param[in] sequence The request sequence number
+ * \param[in] request The request
+ *
+ * The \a sequence must follow the sequence number of the last request pushed
+ * to the queue, unless the queue is empty.
+ */
+void RequestQueue::push(uint32_t sequence, Request *request)
+{
+	if (empty()) {
+		head_ = sequence;
+		tail_ = sequence;
+	}
+
+	ASSERT(sequence == tail_);
+
+	if (tail_ - head_ == slots_.size())
+		grow();
+
+	slot(tail_) = request;
+	tail_++;
+	size_++;
+}
+
+/**
+ * \brief Retrieve the request at the front of the queue
+ * \return The oldest request in the queue, or nullptr if the queue is empty
+ */
+Request *RequestQueue::front() const
+{
+	if (empty())
+		return nullptr;
+
+	return slots_[head_ & (slots_.size() - 1)];
+}
+
+/**
+ * \brief Remove the request at the front of the queue
+ */
+void RequestQueue::pop()
+{
+	ASSERT(!empty());
+
+	remove(head_);
+}
+
+/**
+ * \brief Remove a request from the queue
+ * \param[in] sequence The sequence number of the request to remove
+ */
+void RequestQueue::remove(uint32_t sequence)
+{
+	ASSERT(sequence - head_ < tail_ - head_);
+
+	Request *&request = slot(sequence);
+	ASSERT(request);
+
+	request = nullptr;
+	size_--;
+
+	skipHoles();
+}
+
+void RequestQueue::grow()
+{
+	std::vector<Request *> slots(slots_.size() * 2, nullptr);
+
+	for (uint32_t seq = head_; seq != tail_; ++seq)
+		slots[seq & (slots.size() - 1)] = slot(seq);
+
+	slots_ = std::move(slots);
+}
+
+void RequestQueue::skipHoles()
+{
+	while (head_ != tail_ && !slot(head_))
+		head_++;
+}
+
+} /* namespace libcamera */
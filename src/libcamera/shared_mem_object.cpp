@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2023, Raspberry Pi Ltd
+ *
+ * shared_mem_object.cpp - Helper class for shared memory allocations
+ */
+
+#include "libcamera/internal/shared_mem_object.h"
+
+/**
+ * \file shared_mem_object.h
+ * \brief Helper class for shared memory allocations
+ */
+
+namespace libcamera {
+
+/**
+ * \class SharedMemObject
+ * \brief Helper class to allocate an object in shareable memory
+ * \tparam T The object type
+ *
+ * The SharedMemObject class is a specialised unique pointer that allocates an
+ * object of type \a T in an anonymous memory file. The memory can be shared
+ * with other processes, such as IPA modules, by passing the file descriptor
+ * returned by fd(). The object is constructed in the shared memory and
+ * destroyed when the SharedMemObject is destroyed.
+ *
+ * \a T must not contain pointers or references, as they would not be valid in
+ * the address space of other processes.
+ */
+
+/**
+ * \var SharedMemObject::SIZE
+ * \brief The size of the object stored in shared memory
+ */
+
+/**
+ * \fn SharedMemObject::SharedMemObject()
+ * \brief Construct an empty SharedMemObject
+ */
+
+/**
+ * \fn SharedMemObject::SharedMemObject(const std::string &name, Args &&...args)
+ * \brief Construct a SharedMemObject
+ * \param[in] name The name of the shared memory file
+ * \param[in] args The arguments to construct the object with
+ *
+ * Allocate the shared memory and construct an instance of \a T in it with
+ * \a args. On failure the SharedMemObject is invalid, as reported by the bool
+ * operator.
+ */
+
+/**
+ * \fn SharedMemObject::SharedMemObject(SharedMemObject<T> &&rhs)
+ * \brief Move constructor for SharedMemObject
+ * \param[in] rhs The object to move
+ */
+
+/**
+ * \fn SharedMemObject::~SharedMemObject()
+ * \brief Destroy the object and release the shared memory
+ */
+
+/**
+ * \fn SharedMemObject::operator=(SharedMemObject<T> &&rhs)
+ * \brief Move assignment operator for SharedMemObject
+ * \param[in] rhs The object to move
+ * \return A reference to this SharedMemObject
+ */
+
+/**
+ * \fn SharedMemObject::operator->()
+ * \brief Dereference the stored object
+ * \return Pointer to the stored object
+ */
+
+/**
+ * \fn const T *SharedMemObject::operator->() const
+ * \copydoc SharedMemObject::operator->
+ */
+
+/**
+ * \fn SharedMemObject::operator*()
+ * \brief Dereference the stored object
+ * \return Reference to the stored object
+ */
+
+/**
+ * \fn const T &SharedMemObject::operator*() const
+ * \copydoc SharedMemObject::operator*
+ */
+
+/**
+ * \fn SharedMemObject::fd()
+ * \brief Retrieve the file descriptor of the shared memory
+ * \return The file descriptor of the shared memory
+ */
+
+/**
+ * \fn SharedMemObject::operator bool()
+ * \brief Check if the object is valid
+ * \return True if the object has been allocated successfully
+ */
+
+} /* namespace libcamera */
@@ -83,10 +83,143 @@ LOG_DEFINE_CATEGORY(Stream)
  * size shall be considered to be supported until it has been verified using
  * CameraConfiguration::validate().
  *
- * \todo Review the usage patterns of this class, and cache the computed
- * pixelformats(), sizes() and range() if this would improve performances.
+ * The formats are stored in a vector sorted by pixel format, along with the
+ * discrete sizes and the range computed for each of them at construction time.
+ * The data is immutable and shared between copies of a StreamFormats, making
+ * copies cheap and repeated queries free of any computation.
  */
 
+namespace {
+
+/*
+ * Sizes to try and extract from ranges.
+ * \todo Verify list of resolutions are good, current list compiled
+ * from v4l2 documentation and source code as well as lists of
+ * common frame sizes.
+ */
+constexpr std::array<Size, 53> rangeDiscreteSizes = {
+	Size(160, 120),
+	Size(240, 160),
+	Size(320, 240),
+	Size(400, 240),
+	Size(480, 320),
+	Size(640, 360),
+	Size(640, 480),
+	Size(720, 480),
+	Size(720, 576),
+	Size(768, 480),
+	Size(800, 600),
+	Size(854, 480),
+	Size(960, 540),
+	Size(960, 640),
+	Size(1024, 576),
+	Size(1024, 600),
+	Size(1024, 768),
+	Size(1152, 864),
+	Size(1280, 1024),
+	Size(1280, 1080),
+	Size(1280, 720),
+	Size(1280, 800),
+	Size(1360, 768),
+	Size(1366, 768),
+	Size(1400, 1050),
+	Size(1440, 900),
+	Size(1536, 864),
+	Size(1600, 1200),
+	Size(1600, 900),
+	Size(1680, 1050),
+	Size(1920, 1080),
+	Size(1920, 1200),
+	Size(2048, 1080),
+	Size(2048, 1152),
+	Size(2048, 1536),
+	Size(2160, 1080),
+	Size(2560, 1080),
+	Size(2560, 1440),
+	Size(2560, 1600),
+	Size(2560, 2048),
+	Size(2960, 1440),
+	Size(3200, 1800),
+	Size(3200, 2048),
+	Size(3200, 2400),
+	Size(3440, 1440),
+	Size(3840, 1080),
+	Size(3840, 1600),
+	Size(3840, 2160),
+	Size(3840, 2400),
+	Size(4096, 2160),
+	Size(5120, 2160),
+	Size(5120, 2880),
+	Size(7680, 4320),
+};
+
+} /* namespace */
+
+struct StreamFormats::Format {
+	Format(const PixelFormat &format, const std::vector<SizeRange> &ranges);
+
+	PixelFormat pixelFormat;
+	std::vector<SizeRange> ranges;
+
+	std::vector<Size> sizes;
+	SizeRange range;
+	bool ambiguous;
+};
+
+StreamFormats::Format::Format(const PixelFormat &format,
+			      const std::vector<SizeRange> &sizeRanges)
+	: pixelFormat(format), ranges(sizeRanges), ambiguous(false)
+{
+	/* Try creating a list of discrete sizes. */
+	bool discrete = true;
+	for (const SizeRange &r : ranges) {
+		if (r.min != r.max) {
+			discrete = false;
+			break;
+		}
+		sizes.emplace_back(r.min);
+	}
+
+	/* If discrete not possible generate from range. */
+	if (!discrete) {
+		sizes.clear();
+
+		if (ranges.size() != 1) {
+			ambiguous = true;
+		} else {
+			const SizeRange &limit = ranges.front();
+
+			for (const Size &size : rangeDiscreteSizes)
+				if (limit.contains(size))
+					sizes.push_back(size);
+		}
+	}
+
+	std::sort(sizes.begin(), sizes.end());
+
+	if (ranges.size() == 1) {
+		range = ranges[0];
+		return;
+	}
+
+	range = SizeRange({ UINT_MAX, UINT_MAX }, { 0, 0 });
+	for (const SizeRange &limit : ranges) {
+		if (limit.min < range.min)
+			range.min = limit.min;
+
+		if (limit.max > range.max)
+			range.max = limit.max;
+	}
+
+	range.hStep = 0;
+	range.vStep = 0;
+}
+
+struct StreamFormats::Data {
+	std::vector<Format> formats;
+	std::vector<PixelFormat> pixelFormats;
+};
+
 StreamFormats::StreamFormats()
 {
 }
@@ -96,22 +229,46 @@ StreamFormats::StreamFormats()
  * \param[in] formats A map of pixel formats to a sizes description
  */
 StreamFormats::StreamFormats(const std::map<PixelFormat, std::vector<SizeRange>> &formats)
-	: formats_(formats)
 {
+	auto data = std::make_shared<Data>();
+
+	/* The map is sorted by pixel format, so is the vector. */
+	data->formats.reserve(formats.size());
+	data->pixelFormats.reserve(formats.size());
+
+	for (const auto &[format, ranges] : formats) {
+		data->formats.emplace_back(format, ranges);
+		data->pixelFormats.push_back(format);
+	}
+
+	data_ = std::move(data);
+}
+
+const StreamFormats::Format *StreamFormats::find(const PixelFormat &pixelformat) const
+{
+	if (!data_)
+		return nullptr;
+
+	const std::vector<Format> &formats = data_->formats;
+	auto it = std::lower_bound(formats.begin(), formats.end(), pixelformat,
+				   [](const Format &format, const PixelFormat &value) {
+					   return format.pixelFormat < value;
+				   });
+	if (it == formats.end() || it->pixelFormat != pixelformat)
+		return nullptr;
+
+	return &*it;
 }
 
 /**
  * \brief Retrieve the list of supported pixel formats
  * \return The list of supported pixel formats
  */
-std::vector<PixelFormat> StreamFormats::pixelformats() const
+const std::vector<PixelFormat> &StreamFormats::pixelformats() const
 {
-	std::vector<PixelFormat> formats;
-
-	for (auto const &it : formats_)
-		formats.push_back(it.first);
+	static const std::vector<PixelFormat> empty;
 
-	return formats;
+	return data_ ? data_->pixelFormats : empty;
 }
 
 /**
@@ -128,105 +285,19 @@ std::vector<PixelFormat> StreamFormats::pixelformats() const
  *
  * \return A list of frame sizes or an empty list on error
  */
-std::vector<Size> StreamFormats::sizes(const PixelFormat &pixelformat) const
+const std::vector<Size> &StreamFormats::sizes(const PixelFormat &pixelformat) const
 {
-	/*
-	 * Sizes to try and extract from ranges.
-	 * \todo Verify list of resolutions are good, current list compiled
-	 * from v4l2 documentation and source code as well as lists of
-	 * common frame sizes.
-	 */
-	static const std::array<Size, 53> rangeDiscreteSizes = {
-		Size(160, 120),
-		Size(240, 160),
-		Size(320, 240),
-		Size(400, 240),
-		Size(480, 320),
-		Size(640, 360),
-		Size(640, 480),
-		Size(720, 480),
-		Size(720, 576),
-		Size(768, 480),
-		Size(800, 600),
-		Size(854, 480),
-		Size(960, 540),
-		Size(960, 640),
-		Size(1024, 576),
-		Size(1024, 600),
-		Size(1024, 768),
-		Size(1152, 864),
-		Size(1280, 1024),
-		Size(1280, 1080),
-		Size(1280, 720),
-		Size(1280, 800),
-		Size(1360, 768),
-		Size(1366, 768),
-		Size(1400, 1050),
-		Size(1440, 900),
-		Size(1536, 864),
-		Size(1600, 1200),
-		Size(1600, 900),
-		Size(1680, 1050),
-		Size(1920, 1080),
-		Size(1920, 1200),
-		Size(2048, 1080),
-		Size(2048, 1152),
-		Size(2048, 1536),
-		Size(2160, 1080),
-		Size(2560, 1080),
-		Size(2560, 1440),
-		Size(2560, 1600),
-		Size(2560, 2048),
-		Size(2960, 1440),
-		Size(3200, 1800),
-		Size(3200, 2048),
-		Size(3200, 2400),
-		Size(3440, 1440),
-		Size(3840, 1080),
-		Size(3840, 1600),
-		Size(3840, 2160),
-		Size(3840, 2400),
-		Size(4096, 2160),
-		Size(5120, 2160),
-		Size(5120, 2880),
-		Size(7680, 4320),
-	};
-	std::vector<Size> sizes;
+	static const std::vector<Size> empty;
 
 	/* Make sure pixel format exists. */
-	auto const &it = formats_.find(pixelformat);
-	if (it == formats_.end())
-		return {};
-
-	/* Try creating a list of discrete sizes. */
-	const std::vector<SizeRange> &ranges = it->second;
-	bool discrete = true;
-	for (const SizeRange &range : ranges) {
-		if (range.min != range.max) {
-			discrete = false;
-			break;
-		}
-		sizes.emplace_back(range.min);
-	}
-
-	/* If discrete not possible generate from range. */
-	if (!discrete) {
-		if (ranges.size() != 1) {
-			LOG(Stream, Error) << "Range format is ambiguous";
-			return {};
-		}
-
-		const SizeRange &limit = ranges.front();
-		sizes.clear();
+	const Format *format = find(pixelformat);
+	if (!format)
+		return empty;
 
-		for (const Size &size : rangeDiscreteSizes)
-			if (limit.contains(size))
-				sizes.push_back(size);
-	}
-
-	std::sort(sizes.begin(), sizes.end());
+	if (format->ambiguous)
+		LOG(Stream, Error) << "Range format is ambiguous";
 
-	return sizes;
+	return format->sizes;
 }
 
 /**
@@ -243,28 +314,11 @@ std::vector<Size> StreamFormats::sizes(const PixelFormat &pixelformat) const
  */
 SizeRange StreamFormats::range(const PixelFormat &pixelformat) const
 {
-	auto const it = formats_.find(pixelformat);
-	if (it == formats_.end())
+	const Format *format = find(pixelformat);
+	if (!format)
 		return {};
 
-	const std::vector<SizeRange> &ranges = it->second;
-	if (ranges.size() == 1)
-		return ranges[0];
-
-	LOG(Stream, Debug) << "Building range from discrete sizes";
-	SizeRange range({ UINT_MAX, UINT_MAX }, { 0, 0 });
-	for (const SizeRange &limit : ranges) {
-		if (limit.min < range.min)
-			range.min = limit.min;
-
-		if (limit.max > range.max)
-			range.max = limit.max;
-	}
-
-	range.hStep = 0;
-	range.vStep = 0;
-
-	return range;
+	return format->range;
 }
 
 /**
@@ -0,0 +1,281 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * thread_pool.cpp - Worker threads for CPU-based image processing
+ */
+
+#include "libcamera/internal/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+/**
+ * \file internal/thread_pool.h
+ * \brief Worker threads for CPU-based image processing
+ */
+
+namespace libcamera {
+
+/**
+ * \class ThreadPool
+ * \brief A set of threads that process images in strips
+ *
+ * Processing images on the CPU is usually too slow for a single core, but
+ * splits well in horizontal strips processed concurrently. The ThreadPool
+ * class runs such work on a set of threads sized according to the number of
+ * CPUs.
+ *
+ * Strip tasks are called once per strip with the strip index and the number
+ * of strips, and are expected to process their share of the image. They are
+ * either queued with queueStrips(), to process a frame asynchronously, or run
+ * with runStrips(), with the calling thread taking part in the work. Tasks
+ * that don't split in strips are queued with queue().
+ *
+ * Work is started in the order it has been queued, with the strips queued
+ * with queueStrips() taking precedence. The pool can be used concurrently
+ * from multiple threads, including from its own threads.
+ */
+
+/**
+ * \typedef ThreadPool::Task
+ * \brief A task run by the pool
+ */
+
+/**
+ * \typedef ThreadPool::StripTask
+ * \brief A task that processes one strip of an image
+ *
+ * The task receives the strip \a index and the total strip \a count.
+ */
+
+/**
+ * \brief Construct a ThreadPool and start its threads
+ * \param[in] name The name of the threads, suffixed with their index
+ * \param[in] maxThreads The maximum number of threads
+ *
+ * The pool creates one thread per CPU, with a minimum of one and a maximum
+ * of \a maxThreads.
+ */
+ThreadPool::ThreadPool(const std::string &name, unsigned int maxThreads)
+	: active_(0), stopping_(false)
+{
+	unsigned int numThreads =
+		std::clamp<unsigned int>(std::thread::hardware_concurrency(),
+					 1, std::max(maxThreads, 1U));
+
+	strips_.resize(numThreads);
+
+	for (unsigned int i = 0; i < numThreads; ++i) {
+		workers_.push_back(std::make_unique<Worker>(this, i, name + std::to_string(i)));
+		workers_.back()->start();
+	}
+}
+
+/**
+ * \brief Complete the queued work and stop the threads
+ */
+ThreadPool::~ThreadPool()
+{
+	wait();
+
+	{
+		MutexLocker locker(mutex_);
+		stopping_ = true;
+	}
+	workCondition_.notify_all();
+
+	for (std::unique_ptr<Worker> &worker : workers_)
+		worker->wait();
+}
+
+/**
+ * \fn ThreadPool::threads()
+ * \brief Retrieve the number of threads in the pool
+ * \return The number of threads
+ */
+
+/**
+ * \brief Queue a task
+ * \param[in] task The task
+ *
+ * The \a task is run by one of the threads of the pool.
+ */
+void ThreadPool::queue(Task task)
+{
+	{
+		MutexLocker locker(mutex_);
+		queue_.push_back({ std::move(task), nullptr });
+	}
+	workCondition_.notify_one();
+}
+
+/**
+ * \brief Queue a task to process an image in strips
+ * \param[in] task The strip task
+ * \param[in] done The completion handler
+ *
+ * The \a task is called once per thread of the pool, with strip indices from
+ * 0 to threads() - 1. The strips are processed concurrently. When all of them
+ * have been processed, the \a done handler is called in the thread that
+ * processed the last strip.
+ *
+ * Strips with the same index are always processed by the same thread, in the
+ * order they have been queued. Strip tasks can thus use per-strip resources,
+ * such as scratch buffers, without locking. As the strips of different images
+ * may still be processed concurrently by different threads, the \a done
+ * handlers may be called out of order. Callers that need to complete images in
+ * order shall track them separately.
+ */
+void ThreadPool::queueStrips(StripTask task, Task done)
+{
+	struct Job {
+		StripTask task;
+		Task done;
+		std::atomic<unsigned int> pending;
+	};
+
+	const unsigned int count = threads();
+
+	auto job = std::make_shared<Job>();
+	job->task = std::move(task);
+	job->done = std::move(done);
+	job->pending = count;
+
+	{
+		MutexLocker locker(mutex_);
+
+		for (unsigned int i = 0; i < count; ++i) {
+			strips_[i].push_back([job, i, count]() {
+				job->task(i, count);
+				if (job->pending.fetch_sub(1, std::memory_order_acq_rel) == 1 &&
+				    job->done)
+					job->done();
+			});
+		}
+	}
+	workCondition_.notify_all();
+}
+
+/**
+ * \brief Process an image in strips and wait for completion
+ * \param[in] task The strip task
+ *
+ * The \a task is called once per thread of the pool, plus once for the
+ * calling thread, with strip indices from 0 to threads(). The calling thread
+ * processes the strips that no thread of the pool has started, and the
+ * function returns when all strips have been processed.
+ *
+ * The strips are queued after the work already queued to the pool. As the
+ * calling thread can process all strips by itself, this function can safely
+ * be called from a thread of the pool.
+ */
+void ThreadPool::runStrips(const StripTask &task)
+{
+	const unsigned int count = threads() + 1;
+	std::atomic<unsigned int> pending = count - 1;
+
+	{
+		MutexLocker locker(mutex_);
+
+		for (unsigned int i = 1; i < count; ++i) {
+			queue_.push_back({ [&task, &pending, i, count]() {
+				task(i, count);
+				pending.fetch_sub(1, std::memory_order_release);
+			}, &pending });
+		}
+	}
+	workCondition_.notify_all();
+
+	task(0, count);
+
+	/* Process the strips that haven't been started yet. */
+	MutexLocker locker(mutex_);
+
+	while (true) {
+		auto it = std::find_if(queue_.begin(), queue_.end(),
+				       [&](const Entry &entry) {
+					       return entry.caller == &pending;
+				       });
+		if (it == queue_.end())
+			break;
+
+		Entry entry = std::move(*it);
+		queue_.erase(it);
+
+		runEntry(locker, entry);
+	}
+
+	doneCondition_.wait(locker, [&]() {
+		return pending.load(std::memory_order_acquire) == 0;
+	});
+}
+
+/**
+ * \brief Wait for all the work queued to the pool to complete
+ */
+void ThreadPool::wait()
+{
+	MutexLocker locker(mutex_);
+
+	doneCondition_.wait(locker, [&]() LIBCAMERA_TSA_REQUIRES(mutex_) {
+		return queue_.empty() && !active_ &&
+		       std::all_of(strips_.begin(), strips_.end(),
+				   [](const std::deque<Task> &strips) {
+					   return strips.empty();
+				   });
+	});
+}
+
+void ThreadPool::runEntry(MutexLocker &locker, Entry &entry)
+{
+	active_++;
+
+	locker.unlock();
+	entry.task();
+	locker.lock();
+
+	active_--;
+
+	doneCondition_.notify_all();
+}
+
+void ThreadPool::run(unsigned int index)
+{
+	MutexLocker locker(mutex_);
+	std::deque<Task> &strips = strips_[index];
+
+	while (true) {
+		workCondition_.wait(locker, [&]() LIBCAMERA_TSA_REQUIRES(mutex_) {
+			return stopping_ || !strips.empty() || !queue_.empty();
+		});
+
+		Entry entry;
+
+		if (!strips.empty()) {
+			entry = { std::move(strips.front()), nullptr };
+			strips.pop_front();
+		} else if (!queue_.empty()) {
+			entry = std::move(queue_.front());
+			queue_.pop_front();
+		} else {
+			return;
+		}
+
+		runEntry(locker, entry);
+	}
+}
+
+ThreadPool::Worker::Worker(ThreadPool *pool, unsigned int index,
+			   const std::string &name)
+	: Thread(name), pool_(pool), index_(index)
+{
+}
+
+void ThreadPool::Worker::run()
+{
+	pool_->run(index_);
+}
+
+} /* namespace libcamera */
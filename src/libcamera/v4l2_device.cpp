@@ -7,6 +7,7 @@
 
 #include "libcamera/internal/v4l2_device.h"
 
+#include <algorithm>
 #include <fcntl.h>
 #include <iomanip>
 #include <limits.h>
@@ -25,6 +26,7 @@
 #include <libcamera/base/utils.h>
 
 #include "libcamera/internal/formats.h"
+#include "libcamera/internal/media_request.h"
 #include "libcamera/internal/sysfs.h"
 
 /**
@@ -59,7 +61,7 @@ LOG_DEFINE_CATEGORY(V4L2)
  */
 V4L2Device::V4L2Device(const std::string &deviceNode)
 	: deviceNode_(deviceNode), fdEventNotifier_(nullptr),
-	  frameStartEnabled_(false)
+	  frameStartEnabled_(false), skippedControls_(0), skippedWrites_(0)
 {
 }
 
@@ -143,9 +145,16 @@ void V4L2Device::close()
 	if (!isOpen())
 		return;
 
+	if (skippedControls_)
+		LOG(V4L2, Debug)
+			<< "Skipped " << skippedControls_
+			<< " unchanged control writes, avoided "
+			<< skippedWrites_ << " ioctls";
+
 	delete fdEventNotifier_;
 
 	fd_.reset();
+	values_.clear();
 }
 
 /**
@@ -260,11 +269,24 @@ ControlList V4L2Device::getControls(const std::vector<uint32_t> &ids)
 /**
  * \brief Write controls to the device
  * \param[in] ctrls The list of controls to write
+ * \param[in] request The media request to store the controls in
  *
  * This function writes the value of all controls contained in \a ctrls, and
  * stores the values actually applied to the device in the corresponding
  * \a ctrls entry.
  *
+ * If \a request is not null, the controls are not applied immediately but
+ * stored in the request, and will be applied by the kernel when the request is
+ * processed.
+ *
+ * If all controls have the value they were last written with, the write is
+ * skipped and no ioctl is issued. Controls are never skipped individually, as
+ * writing a control may change the value of other controls. For instance,
+ * sensor drivers clamp the exposure time when a vertical blanking change
+ * shrinks its range. For the same reason, only the values of the controls
+ * written last are remembered. The cache of written values is also dropped
+ * when the control information is updated.
+ *
  * If any control in \a ctrls is not supported by the device, is disabled (i.e.
  * has the V4L2_CTRL_FLAG_DISABLED flag set), is read-only, if any other error
  * occurs during validation of the requested controls, no control is written and
@@ -279,27 +301,40 @@ ControlList V4L2Device::getControls(const std::vector<uint32_t> &ids)
  * \retval -EINVAL One of the control is not supported or not accessible
  * \retval i The index of the control that failed
  */
-int V4L2Device::setControls(ControlList *ctrls)
+int V4L2Device::setControls(ControlList *ctrls, MediaRequest *request)
 {
 	if (ctrls->empty())
 		return 0;
 
-	std::vector<v4l2_ext_control> v4l2Ctrls(ctrls->size());
-	memset(v4l2Ctrls.data(), 0, sizeof(v4l2_ext_control) * ctrls->size());
+	/*
+	 * Skip the write if no control has changed since the last write.
+	 * Controls stored in a request are always written, as they don't
+	 * affect the current value.
+	 */
+	if (!request &&
+	    std::all_of(ctrls->begin(), ctrls->end(), [&](const auto &ctrl) {
+		    const auto cached = values_.find(ctrl.first);
+		    return cached != values_.end() && cached->second == ctrl.second;
+	    })) {
+		skippedControls_ += ctrls->size();
+		skippedWrites_++;
+		return 0;
+	}
+
+	v4l2Ctrls_.clear();
 
-	for (auto [ctrl, i] = std::pair(ctrls->begin(), 0u); i < ctrls->size(); ctrl++, i++) {
-		const unsigned int id = ctrl->first;
+	for (auto &[id, value] : *ctrls) {
 		const auto iter = controls_.find(id);
 		if (iter == controls_.end()) {
 			LOG(V4L2, Error)
 				<< "Control " << utils::hex(id) << " not found";
 			return -EINVAL;
 		}
-		v4l2_ext_control &v4l2Ctrl = v4l2Ctrls[i];
+
+		v4l2_ext_control &v4l2Ctrl = v4l2Ctrls_.emplace_back();
 		v4l2Ctrl.id = id;
 
 		/* Set the v4l2_ext_control value for the write operation. */
-		ControlValue &value = ctrl->second;
 		switch (iter->first->type()) {
 		case ControlTypeInteger32: {
 			if (value.isArray()) {
@@ -340,35 +375,58 @@ int V4L2Device::setControls(ControlList *ctrls)
 	}
 
 	struct v4l2_ext_controls v4l2ExtCtrls = {};
-	v4l2ExtCtrls.which = V4L2_CTRL_WHICH_CUR_VAL;
-	v4l2ExtCtrls.controls = v4l2Ctrls.data();
-	v4l2ExtCtrls.count = v4l2Ctrls.size();
+	v4l2ExtCtrls.controls = v4l2Ctrls_.data();
+	v4l2ExtCtrls.count = v4l2Ctrls_.size();
+
+	if (request) {
+		v4l2ExtCtrls.which = V4L2_CTRL_WHICH_REQUEST_VAL;
+		v4l2ExtCtrls.request_fd = request->fd();
+	} else {
+		v4l2ExtCtrls.which = V4L2_CTRL_WHICH_CUR_VAL;
+	}
 
 	int ret = ioctl(VIDIOC_S_EXT_CTRLS, &v4l2ExtCtrls);
 	if (ret) {
 		unsigned int errorIdx = v4l2ExtCtrls.error_idx;
 
 		/* Generic validation error. */
-		if (errorIdx == 0 || errorIdx >= v4l2Ctrls.size()) {
+		if (errorIdx == 0 || errorIdx >= v4l2Ctrls_.size()) {
 			LOG(V4L2, Error) << "Unable to set controls: "
 					 << strerror(-ret);
 			return -EINVAL;
 		}
 
 		/* A specific control failed. */
-		const unsigned int id = v4l2Ctrls[errorIdx].id;
+		const unsigned int id = v4l2Ctrls_[errorIdx].id;
 		LOG(V4L2, Error) << "Unable to set control " << utils::hex(id)
 				 << ": " << strerror(-ret);
 
-		v4l2Ctrls.resize(errorIdx);
+		v4l2Ctrls_.resize(errorIdx);
 		ret = errorIdx;
 	}
 
-	updateControls(ctrls, v4l2Ctrls);
+	if (std::any_of(v4l2Ctrls_.begin(), v4l2Ctrls_.end(), [&](const auto &ctrl) {
+		    return controlInfo_[ctrl.id].flags & V4L2_CTRL_FLAG_MODIFY_LAYOUT;
+	    }))
+		layoutChanged();
+
+	updateControls(ctrls, v4l2Ctrls_);
+	cacheControls(*ctrls, request);
 
 	return ret;
 }
 
+/**
+ * \fn V4L2Device::layoutChanged()
+ * \brief Notify the device that its buffer layout may have changed
+ *
+ * This function is called by setControls() after writing controls that have
+ * the V4L2_CTRL_FLAG_MODIFY_LAYOUT flag set, such as flips on sensors that
+ * change the Bayer pattern order. Derived classes that store information
+ * depending on the device format can override it to drop that information.
+ * The default implementation does nothing.
+ */
+
 /**
  * \brief Retrieve the v4l2_query_ext_ctrl information for the given control
  * \param[in] id The V4L2 control id
@@ -654,6 +712,7 @@ void V4L2Device::listControls()
 	}
 
 	controls_ = ControlInfoMap(std::move(ctrls), controlIdMap_);
+	v4l2Ctrls_.reserve(controls_.size());
 }
 
 /**
@@ -673,6 +732,9 @@ void V4L2Device::listControls()
  */
 void V4L2Device::updateControlInfo()
 {
+	/* The control limits may have changed, drop the cached values. */
+	values_.clear();
+
 	for (auto &[controlId, info] : controls_) {
 		unsigned int id = controlId->id();
 
@@ -693,6 +755,45 @@ void V4L2Device::updateControlInfo()
 	}
 }
 
+/*
+ * \brief Record the values of controls written to the device
+ * \param[in] ctrls List of V4L2 controls passed to setControls()
+ * \param[in] request The media request the controls have been stored in, if any
+ *
+ * Only scalar controls that keep the value they have been set to are cached.
+ * Controls stored in a request are not cached, as the request may complete at
+ * any time.
+ *
+ * Writing controls may change the value of other controls, the values cached
+ * for previous writes are thus dropped.
+ */
+void V4L2Device::cacheControls(const ControlList &ctrls,
+			       const MediaRequest *request)
+{
+	bool invalidate = false;
+
+	values_.clear();
+
+	for (const v4l2_ext_control &v4l2Ctrl : v4l2Ctrls_) {
+		const unsigned int id = v4l2Ctrl.id;
+		const ControlValue &value = ctrls.get(id);
+		const struct v4l2_query_ext_ctrl &info = controlInfo_[id];
+
+		if (info.flags & V4L2_CTRL_FLAG_UPDATE)
+			invalidate = true;
+
+		if (request || value.isArray() ||
+		    info.flags & (V4L2_CTRL_FLAG_VOLATILE |
+				  V4L2_CTRL_FLAG_EXECUTE_ON_WRITE))
+			continue;
+
+		values_[id] = value;
+	}
+
+	if (invalidate)
+		values_.clear();
+}
+
 /*
  * \brief Update the value of the first \a count V4L2 controls in \a ctrls using
  * values in \a v4l2Ctrls
@@ -926,6 +1027,12 @@ template std::optional<ColorSpace> V4L2Device::toColorSpace(const struct v4l2_mb
 template<typename T>
 int V4L2Device::fromColorSpace(const std::optional<ColorSpace> &colorSpace, T &v4l2Format)
 {
+	/*
+	 * This is a static member function, log through the global _log()
+	 * function instead of Loggable::_log().
+	 */
+	using libcamera::_log;
+
 	v4l2Format.colorspace = V4L2_COLORSPACE_DEFAULT;
 	v4l2Format.xfer_func = V4L2_XFER_FUNC_DEFAULT;
 	v4l2Format.ycbcr_enc = V4L2_YCBCR_ENC_DEFAULT;
@@ -954,7 +1061,7 @@ int V4L2Device::fromColorSpace(const std::optional<ColorSpace> &colorSpace, T &v
 	if (itPrimaries != primariesToV4l2.end()) {
 		v4l2Format.colorspace = itPrimaries->second;
 	} else {
-		libcamera::LOG(V4L2, Warning)
+		LOG(V4L2, Warning)
 			<< "Unrecognised primaries in "
 			<< ColorSpace::toString(colorSpace);
 		ret = -EINVAL;
@@ -964,7 +1071,7 @@ int V4L2Device::fromColorSpace(const std::optional<ColorSpace> &colorSpace, T &v
 	if (itTransfer != transferFunctionToV4l2.end()) {
 		v4l2Format.xfer_func = itTransfer->second;
 	} else {
-		libcamera::LOG(V4L2, Warning)
+		LOG(V4L2, Warning)
 			<< "Unrecognised transfer function in "
 			<< ColorSpace::toString(colorSpace);
 		ret = -EINVAL;
@@ -974,7 +1081,7 @@ int V4L2Device::fromColorSpace(const std::optional<ColorSpace> &colorSpace, T &v
 	if (itYcbcrEncoding != ycbcrEncodingToV4l2.end()) {
 		v4l2Format.ycbcr_enc = itYcbcrEncoding->second;
 	} else {
-		libcamera::LOG(V4L2, Warning)
+		LOG(V4L2, Warning)
 			<< "Unrecognised YCbCr encoding in "
 			<< ColorSpace::toString(colorSpace);
 		ret = -EINVAL;
@@ -984,7 +1091,7 @@ int V4L2Device::fromColorSpace(const std::optional<ColorSpace> &colorSpace, T &v
 	if (itRange != rangeToV4l2.end()) {
 		v4l2Format.quantization = itRange->second;
 	} else {
-		libcamera::LOG(V4L2, Warning)
+		LOG(V4L2, Warning)
 			<< "Unrecognised quantization in "
 			<< ColorSpace::toString(colorSpace);
 		ret = -EINVAL;
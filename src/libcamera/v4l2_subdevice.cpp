@@ -7,6 +7,7 @@
 
 #include "libcamera/internal/v4l2_subdevice.h"
 
+#include <algorithm>
 #include <fcntl.h>
 #include <iomanip>
 #include <regex>
@@ -23,6 +24,7 @@
 #include <libcamera/base/log.h>
 #include <libcamera/base/utils.h>
 
+#include "libcamera/internal/enumeration_cache.h"
 #include "libcamera/internal/formats.h"
 #include "libcamera/internal/media_device.h"
 #include "libcamera/internal/media_object.h"
@@ -332,7 +334,8 @@ std::string V4L2Subdevice::Routing::toString() const
  * path
  */
 V4L2Subdevice::V4L2Subdevice(const MediaEntity *entity)
-	: V4L2Device(entity->deviceNode()), entity_(entity)
+	: V4L2Device(entity->deviceNode()), entity_(entity), linkGeneration_(0),
+	  layoutModified_(false)
 {
 }
 
@@ -351,6 +354,8 @@ int V4L2Subdevice::open()
 	if (ret)
 		return ret;
 
+	invalidateFormats();
+
 	/*
 	 * Try to query the subdev capabilities. The VIDIOC_SUBDEV_QUERYCAP API
 	 * was introduced in kernel v5.8, ENOTTY errors must be ignored to
@@ -395,6 +400,11 @@ int V4L2Subdevice::open()
  * \param[in] target The selection target defined by the V4L2_SEL_TGT_* flags
  * \param[out] rect The retrieved selection rectangle
  *
+ * The V4L2_SEL_TGT_NATIVE_SIZE, V4L2_SEL_TGT_CROP_BOUNDS and
+ * V4L2_SEL_TGT_CROP_DEFAULT targets only change when the configuration of the
+ * subdevice changes. They are memoized and retrieved from the device only the
+ * first time they are queried, until invalidateFormats() is called.
+ *
  * \todo Define a V4L2SelectionTarget enum for the selection target
  *
  * \return 0 on success or a negative error code otherwise
@@ -402,6 +412,20 @@ int V4L2Subdevice::open()
 int V4L2Subdevice::getSelection(unsigned int pad, unsigned int target,
 				Rectangle *rect)
 {
+	bool memoize = target == V4L2_SEL_TGT_NATIVE_SIZE ||
+		       target == V4L2_SEL_TGT_CROP_BOUNDS ||
+		       target == V4L2_SEL_TGT_CROP_DEFAULT;
+
+	if (memoize) {
+		dropStaleFormats();
+
+		auto it = selections_.find({ pad, target });
+		if (it != selections_.end()) {
+			*rect = it->second;
+			return 0;
+		}
+	}
+
 	struct v4l2_subdev_selection sel = {};
 
 	sel.which = V4L2_SUBDEV_FORMAT_ACTIVE;
@@ -422,6 +446,9 @@ int V4L2Subdevice::getSelection(unsigned int pad, unsigned int target,
 	rect->width = sel.r.width;
 	rect->height = sel.r.height;
 
+	if (memoize)
+		selections_[{ pad, target }] = *rect;
+
 	return 0;
 }
 
@@ -431,6 +458,10 @@ int V4L2Subdevice::getSelection(unsigned int pad, unsigned int target,
  * \param[in] target The selection target defined by the V4L2_SEL_TGT_* flags
  * \param[inout] rect The selection rectangle to be applied
  *
+ * Setting a selection rectangle on a subdevice that has sink pads invalidates
+ * the memoized formats and selection rectangles, as they may depend on the
+ * subdevice configuration.
+ *
  * \todo Define a V4L2SelectionTarget enum for the selection target
  *
  * \return 0 on success or a negative error code otherwise
@@ -438,6 +469,9 @@ int V4L2Subdevice::getSelection(unsigned int pad, unsigned int target,
 int V4L2Subdevice::setSelection(unsigned int pad, unsigned int target,
 				Rectangle *rect)
 {
+	if (hasSinkPads())
+		invalidateFormats();
+
 	struct v4l2_subdev_selection sel = {};
 
 	sel.which = V4L2_SUBDEV_FORMAT_ACTIVE;
@@ -472,6 +506,20 @@ int V4L2Subdevice::setSelection(unsigned int pad, unsigned int target,
  * Enumerate all media bus codes and frame sizes supported by the subdevice on
  * a \a pad.
  *
+ * The enumeration results are memoized per pad, and subsequent calls return
+ * the memoized formats without accessing the device. The memoized formats are
+ * invalidated when the configuration of a subdevice that has sink pads changes,
+ * when the routing table changes, when the links of the media graph change,
+ * when controls that modify the layout are written, or when
+ * invalidateFormats() is called.
+ *
+ * For subdevices that have no sink pad, such as camera sensors, the supported
+ * formats don't depend on the configuration of other pads. They are stored in
+ * the media device enumeration cache when enabled, and retrieved from the cache
+ * instead of being enumerated from the device on subsequent calls. The cache is
+ * bypassed once controls that modify the layout have been written, as the
+ * media bus codes then depend on the control values.
+ *
  * \return A list of the supported device formats
  */
 V4L2Subdevice::Formats V4L2Subdevice::formats(unsigned int pad)
@@ -483,6 +531,22 @@ V4L2Subdevice::Formats V4L2Subdevice::formats(unsigned int pad)
 		return {};
 	}
 
+	dropStaleFormats();
+
+	auto it = formats_.find(pad);
+	if (it != formats_.end())
+		return it->second;
+
+	EnumerationCache *cache = hasSinkPads() || layoutModified_
+				? nullptr : entity_->device()->cache();
+	if (cache) {
+		std::optional<Formats> cached = cache->formats(entity_->id(), pad);
+		if (cached) {
+			formats_[pad] = *cached;
+			return std::move(*cached);
+		}
+	}
+
 	for (unsigned int code : enumPadCodes(pad)) {
 		std::vector<SizeRange> sizes = enumPadSizes(pad, code);
 		if (sizes.empty())
@@ -497,9 +561,36 @@ V4L2Subdevice::Formats V4L2Subdevice::formats(unsigned int pad)
 		}
 	}
 
+	if (formats.empty())
+		return formats;
+
+	if (cache)
+		cache->setFormats(entity_->id(), pad, formats);
+
+	formats_[pad] = formats;
+
 	return formats;
 }
 
+/**
+ * \brief Invalidate the memoized formats and selection rectangles
+ *
+ * The formats enumerated by formats() and the selection rectangles of the
+ * targets memoized by getSelection() are stored in the V4L2Subdevice. They are
+ * invalidated automatically when the subdevice format, selection or routing
+ * configuration changes through this class, when the links of the media device
+ * change, and when controls that have the V4L2_CTRL_FLAG_MODIFY_LAYOUT flag are
+ * written. This function shall be called when the configuration is changed by
+ * other means to force the next calls to retrieve the information from the
+ * device.
+ */
+void V4L2Subdevice::invalidateFormats()
+{
+	formats_.clear();
+	selections_.clear();
+	linkGeneration_ = entity_->device()->linkGeneration();
+}
+
 std::optional<ColorSpace> V4L2Subdevice::toColorSpace(const v4l2_mbus_framefmt &format) const
 {
 	/*
@@ -591,6 +682,14 @@ int V4L2Subdevice::setFormat(unsigned int pad, V4L2SubdeviceFormat *format,
 			subdevFmt.format.flags |= V4L2_MBUS_FRAMEFMT_SET_CSC;
 	}
 
+	/*
+	 * The formats supported on the source pads of a subdevice may depend
+	 * on the format of its sink pads.
+	 */
+	if (whence == ActiveFormat &&
+	    entity_->pads()[pad]->flags() & MEDIA_PAD_FL_SINK)
+		invalidateFormats();
+
 	int ret = ioctl(VIDIOC_SUBDEV_S_FMT, &subdevFmt);
 	if (ret) {
 		LOG(V4L2, Error)
@@ -670,6 +769,9 @@ int V4L2Subdevice::setRouting(Routing *routing, Whence whence)
 	if (!caps_.hasStreams())
 		return 0;
 
+	if (whence == ActiveFormat)
+		invalidateFormats();
+
 	struct v4l2_subdev_routing rt = {};
 	rt.which = whence;
 	rt.num_routes = routing->size();
@@ -768,6 +870,30 @@ std::string V4L2Subdevice::logPrefix() const
 	return "'" + entity_->name() + "'";
 }
 
+void V4L2Subdevice::layoutChanged()
+{
+	layoutModified_ = true;
+	invalidateFormats();
+}
+
+/*
+ * Drop the memoized formats and selection rectangles if the links of the
+ * media device have changed since they have been stored.
+ */
+void V4L2Subdevice::dropStaleFormats()
+{
+	if (linkGeneration_ != entity_->device()->linkGeneration())
+		invalidateFormats();
+}
+
+bool V4L2Subdevice::hasSinkPads() const
+{
+	return std::any_of(entity_->pads().begin(), entity_->pads().end(),
+			   [](const MediaPad *pad) {
+				   return pad->flags() & MEDIA_PAD_FL_SINK;
+			   });
+}
+
 std::vector<unsigned int> V4L2Subdevice::enumPadCodes(unsigned int pad)
 {
 	std::vector<unsigned int> codes;
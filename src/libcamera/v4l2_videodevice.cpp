@@ -9,11 +9,14 @@
 
 #include <algorithm>
 #include <array>
+#include <cmath>
 #include <fcntl.h>
 #include <iomanip>
+#include <poll.h>
 #include <sstream>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/time.h>
 #include <unistd.h>
@@ -31,6 +34,10 @@
 #include "libcamera/internal/framebuffer.h"
 #include "libcamera/internal/media_device.h"
 #include "libcamera/internal/media_object.h"
+#include "libcamera/internal/media_request.h"
+#include "libcamera/internal/metrics.h"
+#include "libcamera/internal/thread_pool.h"
+#include "libcamera/internal/tracepoints.h"
 
 /**
  * \file v4l2_videodevice.h
@@ -41,6 +48,16 @@ namespace libcamera {
 
 LOG_DECLARE_CATEGORY(V4L2)
 
+namespace {
+
+MetricHistogram bufferDriverTime("v4l2.buffer_driver_time_us");
+MetricCounter bufferCacheHits("v4l2.buffer_cache_hits");
+MetricCounter bufferCacheMisses("v4l2.buffer_cache_misses");
+MetricCounter framesDroppedNoBuffer("v4l2.frames_dropped_no_buffer");
+MetricCounter framesDroppedSkipped("v4l2.frames_dropped_skipped");
+
+} /* namespace */
+
 /**
  * \struct V4L2Capability
  * \brief struct v4l2_capability object wrapper and helpers
@@ -162,6 +179,14 @@ LOG_DECLARE_CATEGORY(V4L2)
  * index associations to help selecting V4L2 buffers. It tracks, for every
  * entry, if the V4L2 buffer is in use, and offers lookup of the best free V4L2
  * buffer for a set of dmabufs.
+ *
+ * Dmabufs are identified by the inode and offset of their planes, as the same
+ * dmabuf may be imported through different file descriptors, and a file
+ * descriptor number may be reused for a different dmabuf once closed. The
+ * inodes are looked up once per FrameBuffer and cached in the buffer. Buffers
+ * whose dmabuf identity can't be determined never match any entry. Entries
+ * are indexed by a hash table, and free entries are kept in least recently
+ * used order, so both hits and misses are resolved in constant time.
  */
 
 /**
@@ -173,9 +198,12 @@ LOG_DECLARE_CATEGORY(V4L2)
  * buffer import, with buffers added to the cache as they are queued.
  */
 V4L2BufferCache::V4L2BufferCache(unsigned int numEntries)
-	: lastUsedCounter_(1), missCounter_(0)
+	: hits_(0), misses_(0)
 {
 	cache_.resize(numEntries);
+
+	for (unsigned int index = 0; index < numEntries; index++)
+		cache_[index].lru_ = lru_.insert(lru_.end(), index);
 }
 
 /**
@@ -187,18 +215,21 @@ V4L2BufferCache::V4L2BufferCache(unsigned int numEntries)
  * allocated.
  */
 V4L2BufferCache::V4L2BufferCache(const std::vector<std::unique_ptr<FrameBuffer>> &buffers)
-	: lastUsedCounter_(1), missCounter_(0)
+	: hits_(0), misses_(0)
 {
-	for (const std::unique_ptr<FrameBuffer> &buffer : buffers)
-		cache_.emplace_back(true,
-				    lastUsedCounter_.fetch_add(1, std::memory_order_acq_rel),
-				    *buffer.get());
+	cache_.resize(buffers.size());
+
+	for (unsigned int index = 0; index < buffers.size(); index++) {
+		assign(index, key(*buffers[index]));
+		cache_[index].lru_ = lru_.insert(lru_.end(), index);
+	}
 }
 
 V4L2BufferCache::~V4L2BufferCache()
 {
-	if (missCounter_ > cache_.size())
-		LOG(V4L2, Debug) << "Cache misses: " << missCounter_;
+	if (misses_ > cache_.size())
+		LOG(V4L2, Debug)
+			<< "Cache hits: " << hits_ << ", misses: " << misses_;
 }
 
 /**
@@ -206,12 +237,7 @@ V4L2BufferCache::~V4L2BufferCache()
  */
 bool V4L2BufferCache::isEmpty() const
 {
-	for (auto const &entry : cache_) {
-		if (!entry.free_)
-			return false;
-	}
-
-	return true;
+	return lru_.size() == cache_.size();
 }
 
 /**
@@ -221,48 +247,38 @@ bool V4L2BufferCache::isEmpty() const
  * Find the best V4L2 buffer index to be used for the FrameBuffer \a buffer
  * based on previous mappings of frame buffers to V4L2 buffers. If a free V4L2
  * buffer previously used with the same dmabufs as \a buffer is found in the
- * cache, return its index. Otherwise return the index of the first free V4L2
- * buffer and record its association with the dmabufs of \a buffer.
+ * cache, return its index. Otherwise return the index of the least recently
+ * used free V4L2 buffer and record its association with the dmabufs of
+ * \a buffer.
  *
  * \return The index of the best V4L2 buffer, or -ENOENT if no free V4L2 buffer
  * is available
  */
 int V4L2BufferCache::get(const FrameBuffer &buffer)
 {
-	bool hit = false;
-	int use = -1;
-	uint64_t oldest = UINT64_MAX;
-
-	for (unsigned int index = 0; index < cache_.size(); index++) {
-		const Entry &entry = cache_[index];
-
-		if (!entry.free_)
-			continue;
-
-		/* Try to find a cache hit by comparing the planes. */
-		if (entry == buffer) {
-			hit = true;
-			use = index;
-			break;
-		}
-
-		if (entry.lastUsed_ < oldest) {
-			use = index;
-			oldest = entry.lastUsed_;
-		}
+	Key bufferKey = key(buffer);
+	unsigned int index;
+
+	auto it = bufferKey.empty() ? index_.end() : index_.find(bufferKey);
+	if (it != index_.end() && cache_[it->second].free_) {
+		hits_++;
+		bufferCacheHits.add();
+		index = it->second;
+		lru_.erase(cache_[index].lru_);
+	} else {
+		misses_++;
+		bufferCacheMisses.add();
+		if (lru_.empty())
+			return -ENOENT;
+
+		index = lru_.front();
+		lru_.pop_front();
+		assign(index, std::move(bufferKey));
 	}
 
-	if (!hit)
-		missCounter_++;
-
-	if (use < 0)
-		return -ENOENT;
-
-	cache_[use] = Entry(false,
-			    lastUsedCounter_.fetch_add(1, std::memory_order_acq_rel),
-			    buffer);
+	cache_[index].free_ = false;
 
-	return use;
+	return index;
 }
 
 /**
@@ -272,33 +288,95 @@ int V4L2BufferCache::get(const FrameBuffer &buffer)
 void V4L2BufferCache::put(unsigned int index)
 {
 	ASSERT(index < cache_.size());
-	cache_[index].free_ = true;
+
+	Entry &entry = cache_[index];
+	if (entry.free_)
+		return;
+
+	entry.free_ = true;
+	entry.lru_ = lru_.insert(lru_.end(), index);
 }
 
-V4L2BufferCache::Entry::Entry()
-	: free_(true), lastUsed_(0)
+/**
+ * \fn V4L2BufferCache::hits()
+ * \brief Retrieve the number of cache hits
+ *
+ * A cache hit occurs when get() finds a free V4L2 buffer previously used with
+ * the same dmabufs.
+ *
+ * \return The number of cache hits since the cache was created
+ */
+
+/**
+ * \fn V4L2BufferCache::misses()
+ * \brief Retrieve the number of cache misses
+ *
+ * A cache miss occurs when get() has to associate the dmabufs with a different
+ * V4L2 buffer, or fails to find a free V4L2 buffer. A miss count that keeps
+ * growing after the first capture cycle indicates that the buffer pool is
+ * larger than the cache.
+ *
+ * \return The number of cache misses since the cache was created
+ */
+
+std::size_t V4L2BufferCache::KeyHash::operator()(const Key &key) const
 {
+	std::size_t hash = key.size();
+
+	for (const Plane &plane : key) {
+		for (uint64_t value : { static_cast<uint64_t>(plane.inode),
+					static_cast<uint64_t>(plane.offset),
+					static_cast<uint64_t>(plane.length) })
+			hash ^= std::hash<uint64_t>{}(value) + 0x9e3779b9 +
+				(hash << 6) + (hash >> 2);
+	}
+
+	return hash;
 }
 
-V4L2BufferCache::Entry::Entry(bool free, uint64_t lastUsed, const FrameBuffer &buffer)
-	: free_(free), lastUsed_(lastUsed)
+/*
+ * Compute the cache key of \a buffer. An empty key is returned if the dmabuf
+ * identity of any plane is unknown, as the key would otherwise collide with
+ * unrelated buffers.
+ */
+V4L2BufferCache::Key V4L2BufferCache::key(const FrameBuffer &buffer)
 {
-	for (const FrameBuffer::Plane &plane : buffer.planes())
-		planes_.emplace_back(plane);
+	const std::vector<FrameBuffer::Plane> &planes = buffer.planes();
+	const std::vector<ino_t> &inodes = buffer._d()->inodes();
+
+	Key key;
+	key.reserve(planes.size());
+
+	for (const auto &[i, plane] : utils::enumerate(planes)) {
+		if (!inodes[i])
+			return {};
+
+		key.push_back({ inodes[i], plane.offset, plane.length });
+	}
+
+	return key;
 }
 
-bool V4L2BufferCache::Entry::operator==(const FrameBuffer &buffer) const
+void V4L2BufferCache::assign(unsigned int index, Key &&key)
 {
-	const std::vector<FrameBuffer::Plane> &planes = buffer.planes();
+	Entry &entry = cache_[index];
 
-	if (planes_.size() != planes.size())
-		return false;
+	/*
+	 * Drop the previous association of the entry, unless the same dmabufs
+	 * have since been associated with another entry.
+	 */
+	auto it = index_.find(entry.key_);
+	if (it != index_.end() && it->second == index)
+		index_.erase(it);
 
-	for (unsigned int i = 0; i < planes.size(); i++)
-		if (planes_[i].fd != planes[i].fd.get() ||
-		    planes_[i].length != planes[i].length)
-			return false;
-	return true;
+	entry.key_ = std::move(key);
+	if (!entry.key_.empty())
+		index_[entry.key_] = index;
+}
+
+V4L2BufferCache::Entry::Entry()
+	: free_(true)
+{
 }
 
 /**
@@ -535,7 +613,9 @@ std::ostream &operator<<(std::ostream &out, const V4L2DeviceFormat &f)
 V4L2VideoDevice::V4L2VideoDevice(const std::string &deviceNode)
 	: V4L2Device(deviceNode), formatInfo_(nullptr), cache_(nullptr),
 	  fdBufferNotifier_(nullptr), state_(State::Stopped),
-	  watchdogDuration_(0.0)
+	  watchdogDuration_(0.0), statsEnabled_(false),
+	  monotonicTimestamps_(false), queueUnderrun_(false),
+	  lastFrameDrops_(0), tryFormatCacheEnabled_(false)
 {
 	/*
 	 * We default to an MMAP based CAPTURE video device, however this will
@@ -637,6 +717,8 @@ int V4L2VideoDevice::open()
 	if (ret)
 		return ret;
 
+	tryFormatCacheEnabled_ = true;
+
 	return 0;
 }
 
@@ -763,6 +845,12 @@ void V4L2VideoDevice::close()
 
 	formatInfo_ = nullptr;
 
+	tryFormatCacheEnabled_ = false;
+	{
+		MutexLocker locker(tryFormatCacheLock_);
+		tryFormatCache_.clear();
+	}
+
 	V4L2Device::close();
 }
 
@@ -819,16 +907,84 @@ int V4L2VideoDevice::getFormat(V4L2DeviceFormat *format)
  * the format that would be applied. This is equivalent to setFormat(), except
  * that the device configuration is not changed.
  *
+ * Pipeline handlers try formats every time a camera configuration is
+ * validated, and applications often validate the same configurations
+ * repeatedly, for instance during caps negotiation. As the result of
+ * VIDIOC_TRY_FMT only depends on the requested format for devices opened with
+ * open(), the results are cached until the device is closed. Memory-to-memory
+ * devices opened with open(SharedFD, enum v4l2_buf_type) are not cached, as
+ * the formats supported on one queue may depend on the format set on the other
+ * queue.
+ *
+ * \context This function is \threadsafe.
+ *
  * \return 0 on success or a negative error code otherwise
  */
 int V4L2VideoDevice::tryFormat(V4L2DeviceFormat *format)
 {
-	if (caps_.isMeta())
-		return trySetFormatMeta(format, false);
-	else if (caps_.isMultiplanar())
-		return trySetFormatMultiplane(format, false);
-	else
-		return trySetFormatSingleplane(format, false);
+	auto tryFormat = [this](V4L2DeviceFormat *fmt) {
+		if (caps_.isMeta())
+			return trySetFormatMeta(fmt, false);
+		else if (caps_.isMultiplanar())
+			return trySetFormatMultiplane(fmt, false);
+		else
+			return trySetFormatSingleplane(fmt, false);
+	};
+
+	if (!tryFormatCacheEnabled_)
+		return tryFormat(format);
+
+	/* Serialize the requested format to build the cache key. */
+	std::vector<uint32_t> key = {
+		format->fourcc.fourcc(),
+		format->size.width,
+		format->size.height,
+		format->planesCount,
+	};
+
+	for (const V4L2DeviceFormat::Plane &plane : format->planes) {
+		key.push_back(plane.bpl);
+		key.push_back(plane.size);
+	}
+
+	if (format->colorSpace) {
+		const ColorSpace &colorSpace = *format->colorSpace;
+		key.push_back(static_cast<uint32_t>(colorSpace.primaries));
+		key.push_back(static_cast<uint32_t>(colorSpace.transferFunction));
+		key.push_back(static_cast<uint32_t>(colorSpace.ycbcrEncoding));
+		key.push_back(static_cast<uint32_t>(colorSpace.range));
+	}
+
+	{
+		MutexLocker locker(tryFormatCacheLock_);
+
+		auto it = tryFormatCache_.find(key);
+		if (it != tryFormatCache_.end()) {
+			const auto &[ret, result] = it->second;
+			if (!ret)
+				*format = result;
+			return ret;
+		}
+	}
+
+	int ret = tryFormat(format);
+
+	/*
+	 * Don't cache transient errors. Bound the cache size, as applications
+	 * may try an unbounded number of different sizes.
+	 */
+	if (ret && ret != -EINVAL)
+		return ret;
+
+	static constexpr unsigned int kMaxCachedFormats = 64;
+
+	MutexLocker locker(tryFormatCacheLock_);
+	if (tryFormatCache_.size() >= kMaxCachedFormats)
+		tryFormatCache_.clear();
+
+	tryFormatCache_[std::move(key)] = { ret, *format };
+
+	return ret;
 }
 
 /**
@@ -1035,6 +1191,16 @@ int V4L2VideoDevice::trySetFormatSingleplane(V4L2DeviceFormat *format, bool set)
 	pix->pixelformat = format->fourcc;
 	pix->bytesperline = format->planes[0].bpl;
 	pix->field = V4L2_FIELD_NONE;
+
+	/*
+	 * The size of compressed frames can't be computed by memory-to-memory
+	 * decoders, and is set by userspace on their output queue. Drivers
+	 * compute it in all other cases.
+	 */
+	if (bufferType_ == V4L2_BUF_TYPE_VIDEO_OUTPUT &&
+	    !PixelFormatInfo::info(format->fourcc).bitsPerPixel)
+		pix->sizeimage = format->planes[0].size;
+
 	if (format->colorSpace) {
 		fromColorSpace(format->colorSpace, *pix);
 
@@ -1226,6 +1392,122 @@ int V4L2VideoDevice::setSelection(unsigned int target, Rectangle *rect)
 	return 0;
 }
 
+/**
+ * \brief Enumerate the frame intervals supported for a format and size
+ * \param[in] pixelFormat The pixel format
+ * \param[in] size The frame size
+ *
+ * Stepwise and continuous frame interval ranges are reported by their minimum
+ * and maximum values only.
+ *
+ * \return The frame intervals sorted in increasing order, or an empty vector
+ * if the device doesn't report frame intervals
+ */
+std::vector<utils::Duration>
+V4L2VideoDevice::frameIntervals(V4L2PixelFormat pixelFormat, const Size &size)
+{
+	std::vector<utils::Duration> intervals;
+	int ret;
+
+	auto toDuration = [](const struct v4l2_fract &fract) {
+		return utils::Duration(std::chrono::duration<double>(
+			static_cast<double>(fract.numerator) / fract.denominator));
+	};
+
+	for (unsigned int index = 0;; index++) {
+		struct v4l2_frmivalenum frameInterval = {};
+		frameInterval.index = index;
+		frameInterval.pixel_format = pixelFormat;
+		frameInterval.width = size.width;
+		frameInterval.height = size.height;
+
+		ret = ioctl(VIDIOC_ENUM_FRAMEINTERVALS, &frameInterval);
+		if (ret)
+			break;
+
+		switch (frameInterval.type) {
+		case V4L2_FRMIVAL_TYPE_DISCRETE:
+			if (!frameInterval.discrete.denominator)
+				continue;
+
+			intervals.push_back(toDuration(frameInterval.discrete));
+			break;
+
+		case V4L2_FRMIVAL_TYPE_CONTINUOUS:
+		case V4L2_FRMIVAL_TYPE_STEPWISE:
+			if (!frameInterval.stepwise.min.denominator ||
+			    !frameInterval.stepwise.max.denominator)
+				break;
+
+			intervals.push_back(toDuration(frameInterval.stepwise.min));
+			intervals.push_back(toDuration(frameInterval.stepwise.max));
+			break;
+
+		default:
+			LOG(V4L2, Error)
+				<< "Unknown VIDIOC_ENUM_FRAMEINTERVALS type "
+				<< frameInterval.type;
+			return {};
+		}
+
+		if (frameInterval.type != V4L2_FRMIVAL_TYPE_DISCRETE)
+			break;
+	}
+
+	if (ret && ret != -EINVAL && ret != -ENOTTY) {
+		LOG(V4L2, Error)
+			<< "Unable to enumerate frame intervals: "
+			<< strerror(-ret);
+		return {};
+	}
+
+	std::sort(intervals.begin(), intervals.end());
+
+	return intervals;
+}
+
+/**
+ * \brief Set the frame interval
+ * \param[inout] interval The frame interval to be applied
+ *
+ * The frame interval is passed to the driver with a 100ns resolution. On
+ * success \a interval is updated with the frame interval selected by the
+ * driver.
+ *
+ * \return 0 on success or a negative error code otherwise, -ENOTSUP if the
+ * device doesn't support setting the frame interval
+ */
+int V4L2VideoDevice::setFrameInterval(utils::Duration *interval)
+{
+	struct v4l2_streamparm parm = {};
+	parm.type = bufferType_;
+
+	int ret = ioctl(VIDIOC_G_PARM, &parm);
+	if (ret < 0)
+		return ret == -ENOTTY ? -ENOTSUP : ret;
+
+	if (!(parm.parm.capture.capability & V4L2_CAP_TIMEPERFRAME))
+		return -ENOTSUP;
+
+	struct v4l2_fract &timeperframe = parm.parm.capture.timeperframe;
+	timeperframe.numerator = std::lround(interval->get<std::nano>() / 100);
+	timeperframe.denominator = 10000000;
+
+	ret = ioctl(VIDIOC_S_PARM, &parm);
+	if (ret < 0) {
+		LOG(V4L2, Error)
+			<< "Unable to set frame interval: " << strerror(-ret);
+		return ret;
+	}
+
+	if (timeperframe.denominator)
+		*interval = utils::Duration(std::chrono::duration<double>(
+			static_cast<double>(timeperframe.numerator) /
+			timeperframe.denominator));
+
+	return 0;
+}
+
 int V4L2VideoDevice::requestBuffers(unsigned int count,
 				    enum v4l2_memory memoryType)
 {
@@ -1547,6 +1829,7 @@ int V4L2VideoDevice::releaseBuffers()
 /**
  * \brief Queue a buffer to the video device
  * \param[in] buffer The buffer to be queued
+ * \param[in] request The media request to associate the buffer with
  *
  * For capture video devices the \a buffer will be filled with data by the
  * device. For output video devices the \a buffer shall contain valid data and
@@ -1556,12 +1839,16 @@ int V4L2VideoDevice::releaseBuffers()
  * The best available V4L2 buffer is picked for \a buffer using the V4L2 buffer
  * cache.
  *
+ * If \a request is not null, the buffer is stored in the request and only
+ * queued to the device when the request is queued. This requires the device
+ * to support requests.
+ *
  * Note that queueBuffer() will fail if the device is in the process of being
  * stopped from a streaming state through streamOff().
  *
  * \return 0 on success or a negative error code otherwise
  */
-int V4L2VideoDevice::queueBuffer(FrameBuffer *buffer)
+int V4L2VideoDevice::queueBuffer(FrameBuffer *buffer, MediaRequest *request)
 {
 	struct v4l2_plane v4l2Planes[VIDEO_MAX_PLANES] = {};
 	struct v4l2_buffer buf = {};
@@ -1591,6 +1878,11 @@ int V4L2VideoDevice::queueBuffer(FrameBuffer *buffer)
 	buf.memory = memoryType_;
 	buf.field = V4L2_FIELD_NONE;
 
+	if (request) {
+		buf.flags |= V4L2_BUF_FLAG_REQUEST_FD;
+		buf.request_fd = request->fd();
+	}
+
 	bool multiPlanar = V4L2_TYPE_IS_MULTIPLANAR(buf.type);
 	const std::vector<FrameBuffer::Plane> &planes = buffer->planes();
 	const unsigned int numV4l2Planes = format_.planesCount;
@@ -1708,26 +2000,105 @@ int V4L2VideoDevice::queueBuffer(FrameBuffer *buffer)
 
 	queuedBuffers_[buf.index] = buffer;
 
+	queueTimes_[buf.index] = utils::clock::now();
+
+	LIBCAMERA_TRACEPOINT(v4l2_buffer_queue, deviceNode().c_str(), buffer,
+			     buf.index, queuedBuffers_.size());
+
+	return 0;
+}
+
+/**
+ * \brief Queue multiple buffers to the video device
+ * \param[in] buffers The buffers to be queued
+ *
+ * Queue all \a buffers to the device back-to-back, in order. This is
+ * equivalent to calling queueBuffer() for each buffer, and is meant to be used
+ * when multiple buffers become available at once, for instance when catching
+ * up after the pipeline has fallen behind.
+ *
+ * Queuing stops at the first buffer that fails to be queued. The buffers that
+ * precede it in \a buffers stay queued to the device.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int V4L2VideoDevice::queueBuffers(Span<FrameBuffer *const> buffers)
+{
+	for (FrameBuffer *buffer : buffers) {
+		int ret = queueBuffer(buffer);
+		if (ret < 0)
+			return ret;
+	}
+
 	return 0;
 }
 
 /**
  * \brief Slot to handle completed buffer events from the V4L2 video device
  *
- * When this slot is called, a Buffer has become available from the device, and
- * will be emitted through the bufferReady Signal.
+ * When this slot is called, one or more Buffers have become available from the
+ * device, and will be emitted through the bufferReady Signal in the order they
+ * have been dequeued.
+ *
+ * All completed buffers are dequeued in a single activation, to avoid paying
+ * for one notification per buffer when the event loop falls behind.
  *
  * For Capture video devices the FrameBuffer will contain valid data.
  * For Output video devices the FrameBuffer can be considered empty.
  */
 void V4L2VideoDevice::bufferAvailable()
 {
-	FrameBuffer *buffer = dequeueBuffer();
-	if (!buffer)
-		return;
+	/*
+	 * Slots connected to the bufferReady signal may stop the device, in
+	 * which case no buffer is queued anymore. Check before dequeuing the
+	 * next buffer.
+	 */
+	do {
+		FrameBuffer *buffer = dequeueBuffer();
+		if (!buffer)
+			return;
+
+		const FrameMetadata &metadata = buffer->metadata();
+
+		/*
+		 * The buffer timestamp is sampled by the driver when the frame
+		 * completes, measure the delivery latency against it when it
+		 * uses the same clock as utils::clock.
+		 */
+		if (statsEnabled_ && monotonicTimestamps_ &&
+		    metadata.status == FrameMetadata::FrameSuccess) {
+			auto now = utils::clock::now().time_since_epoch();
+			auto timestamp = std::chrono::nanoseconds(metadata.timestamp);
+			stats_.signalLatency.add(now - timestamp);
+		}
+
+		LIBCAMERA_TRACEPOINT(v4l2_buffer_ready, deviceNode().c_str(),
+				     metadata.sequence, metadata.timestamp);
+
+		/* Notify anyone listening to the device. */
+		bufferReady.emit(buffer);
+	} while (!queuedBuffers_.empty() && bufferPending());
+}
 
-	/* Notify anyone listening to the device. */
-	bufferReady.emit(buffer);
+/**
+ * \brief Check if a completed buffer is ready to be dequeued
+ *
+ * The device may have been opened from a blocking file handle, so poll it
+ * instead of relying on VIDIOC_DQBUF returning -EAGAIN.
+ *
+ * \return True if a buffer can be dequeued without blocking, false otherwise
+ */
+bool V4L2VideoDevice::bufferPending() const
+{
+	struct pollfd pfd = {};
+	pfd.fd = fd();
+	pfd.events = V4L2_TYPE_IS_OUTPUT(bufferType_) ? POLLOUT : POLLIN;
+
+	int ret = poll(&pfd, 1, 0);
+	if (ret <= 0)
+		return false;
+
+	return pfd.revents & pfd.events;
 }
 
 /**
@@ -1785,9 +2156,41 @@ FrameBuffer *V4L2VideoDevice::dequeueBuffer()
 
 	cache_->put(buf.index);
 
+	LIBCAMERA_TRACEPOINT(v4l2_buffer_dequeue, deviceNode().c_str(), it->second,
+			     buf.index, buf.sequence, queuedBuffers_.size());
+
+	auto time = queueTimes_.find(buf.index);
+	if (time != queueTimes_.end()) {
+		utils::duration timeInDriver = utils::clock::now() - time->second;
+		queueTimes_.erase(time);
+
+		auto us = std::chrono::duration_cast<std::chrono::microseconds>(timeInDriver);
+		bufferDriverTime.record(us.count());
+		if (statsEnabled_)
+			stats_.timeInDriver.add(timeInDriver);
+	}
+
+	if (statsEnabled_) {
+		size_t depth = queuedBuffers_.size();
+		if (stats_.queueDepth.size() <= depth)
+			stats_.queueDepth.resize(depth + 1);
+		stats_.queueDepth[depth]++;
+
+		monotonicTimestamps_ = (buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK)
+				     == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+	}
+
 	FrameBuffer *buffer = it->second;
 	queuedBuffers_.erase(it);
 
+	/*
+	 * Frames dropped before this buffer are attributed to a buffer
+	 * underrun if the queue ran empty since the previous buffer was
+	 * dequeued.
+	 */
+	bool underrun = queueUnderrun_;
+	queueUnderrun_ = queuedBuffers_.empty();
+
 	if (queuedBuffers_.empty()) {
 		fdBufferNotifier_->setEnabled(false);
 		watchdog_.stop();
@@ -1824,6 +2227,8 @@ FrameBuffer *V4L2VideoDevice::dequeueBuffer()
 	}
 	metadata.sequence -= firstFrame_.value();
 
+	accountFrameDrops(buf.sequence, underrun);
+
 	unsigned int numV4l2Planes = multiPlanar ? buf.length : 1;
 
 	if (numV4l2Planes != buffer->planes().size()) {
@@ -1891,17 +2296,101 @@ FrameBuffer *V4L2VideoDevice::dequeueBuffer()
  * \brief A Signal emitted when a framebuffer completes
  */
 
+/**
+ * \brief Account for the frames dropped before a dequeued buffer
+ * \param[in] sequence The V4L2 sequence number of the dequeued buffer
+ * \param[in] underrun True if the buffer queue ran empty since the previous
+ * buffer was dequeued
+ */
+void V4L2VideoDevice::accountFrameDrops(uint32_t sequence, bool underrun)
+{
+	int32_t gap = lastSequence_
+		    ? static_cast<int32_t>(sequence - *lastSequence_ - 1) : 0;
+	lastSequence_ = sequence;
+
+	if (gap <= 0) {
+		lastFrameDrops_ = 0;
+		return;
+	}
+
+	lastFrameDrops_ = gap;
+
+	if (underrun) {
+		frameDrops_.noBuffer += gap;
+		framesDroppedNoBuffer.add(gap);
+	} else {
+		frameDrops_.skipped += gap;
+		framesDroppedSkipped.add(gap);
+	}
+
+	LOG(V4L2, Debug)
+		<< gap << " frame(s) dropped before sequence " << sequence
+		<< (underrun ? " (no buffer queued)" : " (skipped by the device)");
+}
+
 /**
  * \brief Start the video stream
  * \return 0 on success or a negative error code otherwise
  */
 int V4L2VideoDevice::streamOn()
 {
-	int ret;
+	prepareStreamOn();
+
+	return completeStreamOn(ioctl(VIDIOC_STREAMON, &bufferType_));
+}
+
+/**
+ * \brief Start the video stream of multiple devices concurrently
+ * \param[in] devices The video devices to start
+ *
+ * Starting a video stream may block while the driver powers up and configures
+ * the hardware. This function issues the VIDIOC_STREAMON ioctl for all
+ * \a devices in parallel, from a pool of worker threads. It shall only be used
+ * for devices that don't depend on being started in a particular order.
+ *
+ * Devices that fail to start don't prevent the other devices from being
+ * started. The caller is responsible for stopping the devices that have been
+ * started when an error is returned.
+ *
+ * \return 0 on success or the error code of the last device that failed to
+ * start otherwise
+ */
+int V4L2VideoDevice::streamOn(Span<V4L2VideoDevice *const> devices)
+{
+	for (V4L2VideoDevice *device : devices)
+		device->prepareStreamOn();
+
+	std::vector<int> results = ioctlConcurrent(devices, VIDIOC_STREAMON);
+
+	int ret = 0;
+
+	for (unsigned int i = 0; i < devices.size(); ++i) {
+		int err = devices[i]->completeStreamOn(results[i]);
+		if (err)
+			ret = err;
+	}
+
+	return ret;
+}
 
+/**
+ * \brief Reset the per-stream state before starting streaming
+ */
+void V4L2VideoDevice::prepareStreamOn()
+{
 	firstFrame_.reset();
+	lastSequence_.reset();
+	queueUnderrun_ = false;
+	lastFrameDrops_ = 0;
+}
 
-	ret = ioctl(VIDIOC_STREAMON, &bufferType_);
+/**
+ * \brief Complete starting the stream after the VIDIOC_STREAMON ioctl
+ * \param[in] ret The VIDIOC_STREAMON ioctl return value
+ * \return 0 on success or the negative error code \a ret otherwise
+ */
+int V4L2VideoDevice::completeStreamOn(int ret)
+{
 	if (ret < 0) {
 		LOG(V4L2, Error)
 			<< "Failed to start streaming: " << strerror(-ret);
@@ -1930,15 +2419,114 @@ int V4L2VideoDevice::streamOn()
  */
 int V4L2VideoDevice::streamOff()
 {
-	int ret;
+	if (!prepareStreamOff())
+		return 0;
+
+	return completeStreamOff(ioctl(VIDIOC_STREAMOFF, &bufferType_));
+}
+
+/**
+ * \brief Stop the video stream of multiple devices concurrently
+ * \param[in] devices The video devices to stop
+ *
+ * Stopping a video stream may block until the hardware completes the frame
+ * being processed, and stopping the devices of a pipeline one after the other
+ * accumulates those delays. This function issues the VIDIOC_STREAMOFF ioctl
+ * for all \a devices in parallel, from a pool of worker threads, and then
+ * sends back the buffers queued to each device in the calling thread, in the
+ * order of the \a devices array, as streamOff() does. It shall only be used for
+ * devices that don't depend on being stopped in a particular order.
+ *
+ * Devices that fail to stop are left streaming, and don't prevent the other
+ * devices from being stopped.
+ *
+ * \return 0 on success or the error code of the last device that failed to
+ * stop otherwise
+ */
+int V4L2VideoDevice::streamOff(Span<V4L2VideoDevice *const> devices)
+{
+	std::vector<V4L2VideoDevice *> stopping;
+	stopping.reserve(devices.size());
+
+	for (V4L2VideoDevice *device : devices) {
+		if (device->prepareStreamOff())
+			stopping.push_back(device);
+	}
+
+	std::vector<int> results = ioctlConcurrent(stopping, VIDIOC_STREAMOFF);
+
+	int ret = 0;
+
+	for (unsigned int i = 0; i < stopping.size(); ++i) {
+		int err = stopping[i]->completeStreamOff(results[i]);
+		if (err)
+			ret = err;
+	}
+
+	return ret;
+}
+
+/**
+ * \brief Issue a stream control ioctl on multiple devices concurrently
+ * \param[in] devices The video devices
+ * \param[in] request The ioctl request, VIDIOC_STREAMON or VIDIOC_STREAMOFF
+ *
+ * The ioctls are issued from a ThreadPool, using the calling thread as one of
+ * the workers.
+ *
+ * \return The ioctl return values, in the order of the \a devices array
+ */
+std::vector<int> V4L2VideoDevice::ioctlConcurrent(Span<V4L2VideoDevice *const> devices,
+						  unsigned long request)
+{
+	std::vector<int> results(devices.size());
+
+	auto streamIoctl = [&](unsigned int index) {
+		V4L2VideoDevice *device = devices[index];
+		results[index] = device->ioctl(request, &device->bufferType_);
+	};
+
+	if (devices.size() < 2) {
+		for (unsigned int i = 0; i < devices.size(); ++i)
+			streamIoctl(i);
+		return results;
+	}
 
+	/* The calling thread takes part in the work. */
+	ThreadPool pool("V4L2Stream", devices.size() - 1);
+	pool.runStrips([&](unsigned int strip, unsigned int count) {
+		for (unsigned int i = strip; i < devices.size(); i += count)
+			streamIoctl(i);
+	});
+
+	return results;
+}
+
+/**
+ * \brief Prepare the device to stop streaming
+ * \return True if the device needs to be stopped, false otherwise
+ */
+bool V4L2VideoDevice::prepareStreamOff()
+{
 	if (state_ != State::Streaming && queuedBuffers_.empty())
-		return 0;
+		return false;
 
 	if (watchdogDuration_.count())
 		watchdog_.stop();
 
-	ret = ioctl(VIDIOC_STREAMOFF, &bufferType_);
+	return true;
+}
+
+/**
+ * \brief Complete stopping the stream after the VIDIOC_STREAMOFF ioctl
+ * \param[in] ret The VIDIOC_STREAMOFF ioctl return value
+ *
+ * Send back all queued buffers if the stream has been stopped successfully.
+ *
+ * \return 0 on success or the negative error code \a ret otherwise
+ */
+int V4L2VideoDevice::completeStreamOff(int ret)
+{
 	if (ret < 0) {
 		LOG(V4L2, Error)
 			<< "Failed to stop streaming: " << strerror(-ret);
@@ -1947,7 +2535,8 @@ int V4L2VideoDevice::streamOff()
 
 	state_ = State::Stopping;
 
-	/* Send back all queued buffers. */
+	lastFrameDrops_ = 0;
+
 	for (auto it : queuedBuffers_) {
 		FrameBuffer *buffer = it.second;
 		FrameMetadata &metadata = buffer->_d()->metadata();
@@ -1960,6 +2549,7 @@ int V4L2VideoDevice::streamOff()
 	ASSERT(cache_->isEmpty());
 
 	queuedBuffers_.clear();
+	queueTimes_.clear();
 	fdBufferNotifier_->setEnabled(false);
 	state_ = State::Stopped;
 
@@ -2007,9 +2597,156 @@ void V4L2VideoDevice::watchdogExpired()
 	LOG(V4L2, Warning)
 		<< "Dequeue timer of " << watchdogDuration_ << " has expired!";
 
+	LIBCAMERA_TRACEPOINT(v4l2_dequeue_timeout, deviceNode().c_str(),
+			     queuedBuffers_.size());
+
+	if (statsEnabled_)
+		stats_.watchdogExpirations++;
+
 	dequeueTimeout.emit();
 }
 
+/**
+ * \struct V4L2VideoDevice::Statistics
+ * \brief Buffer queue statistics of a video device
+ *
+ * The statistics help diagnosing buffer underruns before they result in
+ * frame drops. They are collected when enabled with enableStatistics().
+ *
+ * \var V4L2VideoDevice::Statistics::queueDepth
+ * \brief Histogram of the number of buffers left queued in the driver when a
+ * buffer is dequeued
+ *
+ * Each entry counts the number of buffers dequeued while the number of other
+ * buffers queued to the driver was equal to the entry index. A high count for
+ * index 0 indicates that the driver frequently runs out of buffers.
+ *
+ * \var V4L2VideoDevice::Statistics::timeInDriver
+ * \brief Time spent by buffers in the driver, between VIDIOC_QBUF and
+ * VIDIOC_DQBUF
+ *
+ * \var V4L2VideoDevice::Statistics::signalLatency
+ * \brief Latency between buffer completion and bufferReady emission
+ *
+ * The latency is measured from the buffer timestamp set by the driver. It is
+ * only recorded for successfully completed buffers of drivers that use
+ * monotonic timestamps.
+ *
+ * \var V4L2VideoDevice::Statistics::watchdogExpirations
+ * \brief Number of dequeue watchdog timer expirations
+ */
+
+/**
+ * \struct V4L2VideoDevice::Statistics::Latency
+ * \brief Summary of a latency distribution
+ *
+ * \var V4L2VideoDevice::Statistics::Latency::count
+ * \brief Number of samples
+ *
+ * \var V4L2VideoDevice::Statistics::Latency::min
+ * \brief Minimum sample value
+ *
+ * \var V4L2VideoDevice::Statistics::Latency::max
+ * \brief Maximum sample value
+ *
+ * \var V4L2VideoDevice::Statistics::Latency::total
+ * \brief Sum of all samples
+ */
+
+/**
+ * \struct V4L2VideoDevice::FrameDrops
+ * \brief Frame drop counters of a video capture device
+ *
+ * Frame drops are detected as gaps in the sequence numbers of the buffers
+ * dequeued from the device. They are classified based on the state of the
+ * buffer queue: frames dropped while the queue was empty are caused by the
+ * buffers not being queued in time, other frames have been skipped by the
+ * device itself, for instance due to a bus overflow.
+ *
+ * Frame drops are always accounted for, regardless of whether statistics
+ * collection is enabled, and are reset when the video stream is started.
+ *
+ * \var V4L2VideoDevice::FrameDrops::noBuffer
+ * \brief Number of frames dropped while no buffer was queued to the device
+ *
+ * \var V4L2VideoDevice::FrameDrops::skipped
+ * \brief Number of frames skipped by the device while buffers were queued
+ */
+
+/**
+ * \brief Add a sample to the latency distribution
+ * \param[in] value The sample value
+ */
+void V4L2VideoDevice::Statistics::Latency::add(utils::Duration value)
+{
+	if (!count || value < min)
+		min = value;
+	if (!count || value > max)
+		max = value;
+
+	total += value;
+	count++;
+}
+
+/**
+ * \brief Compute the average of the latency distribution
+ * \return The average sample value, or 0 if no sample has been recorded
+ */
+utils::Duration V4L2VideoDevice::Statistics::Latency::average() const
+{
+	if (!count)
+		return utils::Duration(0);
+
+	return total / count;
+}
+
+/**
+ * \brief Enable or disable collection of buffer queue statistics
+ * \param[in] enable True to enable statistics collection, false to disable it
+ *
+ * Statistics collection is disabled by default. Enabling it adds a small
+ * overhead to buffer queuing and dequeuing. Disabling it preserves the
+ * statistics collected so far.
+ *
+ * Tracepoints for buffer queuing, dequeuing, delivery and watchdog expiration,
+ * as well as the global buffer metrics reported by CameraManager::metrics(),
+ * are emitted regardless of whether statistics collection is enabled.
+ */
+void V4L2VideoDevice::enableStatistics(bool enable)
+{
+	statsEnabled_ = enable;
+}
+
+/**
+ * \fn V4L2VideoDevice::frameDrops()
+ * \brief Retrieve the frame drop counters
+ * \return The frames dropped since the video stream was started
+ */
+
+/**
+ * \fn V4L2VideoDevice::lastFrameDrops()
+ * \brief Retrieve the number of frames dropped before the last dequeued buffer
+ *
+ * This function is meant to be called from the bufferReady signal handler to
+ * attribute frame drops to the request the buffer belongs to.
+ *
+ * \return The number of frames dropped between the last two dequeued buffers
+ */
+
+/**
+ * \fn V4L2VideoDevice::statistics()
+ * \brief Retrieve the buffer queue statistics
+ * \return The statistics collected since they were last reset
+ */
+
+/**
+ * \brief Reset the buffer queue statistics
+ */
+void V4L2VideoDevice::resetStatistics()
+{
+	stats_ = {};
+}
+
 /**
  * \brief Create a new video device instance from \a entity in media device
  * \a media
@@ -7,13 +7,20 @@
 
 #include "libcamera/internal/yaml_parser.h"
 
+#include <charconv>
 #include <cstdlib>
 #include <errno.h>
 #include <functional>
+#include <iomanip>
 #include <limits>
+#include <sstream>
+#include <string.h>
 
 #include <libcamera/base/file.h>
 #include <libcamera/base/log.h>
+#include <libcamera/base/utils.h>
+
+#include "libcamera/internal/enumeration_cache.h"
 
 #include <yaml.h>
 
@@ -139,10 +146,30 @@ bool parseSignedInteger(const std::string &str, long min, long max,
 	if (str == "")
 		return false;
 
+	/*
+	 * Try std::from_chars() first, as it is much faster than strtol(). It
+	 * doesn't skip leading whitespace or accept a leading '+' sign, fall
+	 * back to strtol() for those cases.
+	 */
+	const char *last = str.data() + str.size();
+	long value;
+
+	auto [ptr, ec] = std::from_chars(str.data(), last, value);
+	if (ec == std::errc::result_out_of_range)
+		return false;
+
+	if (ec == std::errc() && ptr == last) {
+		if (value < min || value > max)
+			return false;
+
+		*result = value;
+		return true;
+	}
+
 	char *end;
 
 	errno = 0;
-	long value = std::strtol(str.c_str(), &end, 10);
+	value = std::strtol(str.c_str(), &end, 10);
 
 	if ('\0' != *end || errno == ERANGE || value < min || value > max)
 		return false;
@@ -157,6 +184,22 @@ bool parseUnsignedInteger(const std::string &str, unsigned long max,
 	if (str == "")
 		return false;
 
+	/* Fast path, see parseSignedInteger(). */
+	const char *last = str.data() + str.size();
+	unsigned long value;
+
+	auto [ptr, ec] = std::from_chars(str.data(), last, value);
+	if (ec == std::errc::result_out_of_range)
+		return false;
+
+	if (ec == std::errc() && ptr == last) {
+		if (value > max)
+			return false;
+
+		*result = value;
+		return true;
+	}
+
 	/*
 	 * strtoul() accepts strings representing a negative number, in which
 	 * case it negates the converted value. We don't want to silently accept
@@ -170,7 +213,7 @@ bool parseUnsignedInteger(const std::string &str, unsigned long max,
 	char *end;
 
 	errno = 0;
-	unsigned long value = std::strtoul(str.c_str(), &end, 10);
+	value = std::strtoul(str.c_str(), &end, 10);
 
 	if ('\0' != *end || errno == ERANGE || value > max)
 		return false;
@@ -280,10 +323,29 @@ std::optional<double> YamlObject::get() const
 	if (value_ == "")
 		return std::nullopt;
 
+	double value;
+
+#if defined(__cpp_lib_to_chars)
+	/*
+	 * Floating point support in std::from_chars() is only available in
+	 * recent C++ standard libraries. It is locale-independent and doesn't
+	 * accept hexadecimal notation or leading whitespace, fall back to
+	 * utils::strtod() for those cases.
+	 */
+	const char *last = value_.data() + value_.size();
+
+	auto [ptr, ec] = std::from_chars(value_.data(), last, value);
+	if (ec == std::errc::result_out_of_range)
+		return std::nullopt;
+
+	if (ec == std::errc() && ptr == last)
+		return value;
+#endif
+
 	char *end;
 
 	errno = 0;
-	double value = utils::strtod(value_.c_str(), &end);
+	value = utils::strtod(value_.c_str(), &end);
 
 	if ('\0' != *end || errno == ERANGE)
 		return std::nullopt;
@@ -379,6 +441,60 @@ template std::optional<std::vector<Size>> YamlObject::getList<Size>() const;
 
 #endif /* __DOXYGEN__ */
 
+/**
+ * \fn template<typename T> YamlObject::getList<T>(Span<T> values) const
+ * \brief Parse the YamlObject as a list of \a T into a caller-provided buffer
+ * \param[out] values The buffer to store the parsed values
+ *
+ * This function parses the value of the YamlObject as a list of \a T objects,
+ * and stores the values in \a values. The list must contain exactly as many
+ * elements as the size of \a values. Parsing stops at the first element that
+ * can't be parsed as \a T, in which case the contents of \a values are
+ * unspecified.
+ *
+ * Unlike getList<T>(), this function doesn't allocate memory, and is thus
+ * better suited to read large tables, such as lens shading correction tables,
+ * directly into their destination storage.
+ *
+ * \return True if the list has been parsed successfully, false otherwise
+ */
+
+#ifndef __DOXYGEN__
+
+template<typename T,
+	 std::enable_if_t<
+		 std::is_same_v<double, T> ||
+		 std::is_same_v<int8_t, T> ||
+		 std::is_same_v<uint8_t, T> ||
+		 std::is_same_v<int16_t, T> ||
+		 std::is_same_v<uint16_t, T> ||
+		 std::is_same_v<int32_t, T> ||
+		 std::is_same_v<uint32_t, T>> *>
+bool YamlObject::getList(Span<T> values) const
+{
+	if (type_ != Type::List || list_.size() != values.size())
+		return false;
+
+	for (std::size_t i = 0; i < values.size(); ++i) {
+		const auto value = list_[i].value->get<T>();
+		if (!value)
+			return false;
+		values[i] = *value;
+	}
+
+	return true;
+}
+
+template bool YamlObject::getList<double>(Span<double> values) const;
+template bool YamlObject::getList<int8_t>(Span<int8_t> values) const;
+template bool YamlObject::getList<uint8_t>(Span<uint8_t> values) const;
+template bool YamlObject::getList<int16_t>(Span<int16_t> values) const;
+template bool YamlObject::getList<uint16_t>(Span<uint16_t> values) const;
+template bool YamlObject::getList<int32_t>(Span<int32_t> values) const;
+template bool YamlObject::getList<uint32_t>(Span<uint32_t> values) const;
+
+#endif /* __DOXYGEN__ */
+
 /**
  * \fn YamlObject::asDict() const
  * \brief Wrap a dictionary YamlObject in an adapter that exposes iterators
@@ -769,6 +885,306 @@ int YamlParserContext::parseNextYamlObject(YamlObject &yamlObject, EventPtr even
 	}
 }
 
+namespace {
+
+/*
+ * Version of the cache file format. Increment it when the format changes to
+ * invalidate all existing cache files.
+ */
+constexpr uint32_t kCacheFormatVersion = 1;
+
+constexpr char kCacheMagic[8] = { 'l', 'c', 'y', 'a', 'm', 'l', 0, 0 };
+
+/* Native byte order marker, to reject cache files from other platforms. */
+constexpr uint32_t kCacheByteOrder = 0x01020304;
+
+/* Maximum nesting level, to bound recursion on corrupted cache files. */
+constexpr unsigned int kCacheMaxDepth = 64;
+
+struct CacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint64_t sourceSize;
+	uint64_t sourceHash;
+};
+
+/*
+ * Each node is stored as a one byte type followed by a 32-bit length. Values
+ * store the length of their string, followed by the string. Lists store the
+ * number of children, followed by the children. Dictionaries store the number
+ * of children, each child being stored as the length of its key, the key, and
+ * the child node.
+ */
+enum CacheNodeType : uint8_t {
+	CacheNodeValue = 0,
+	CacheNodeList = 1,
+	CacheNodeDictionary = 2,
+};
+
+constexpr size_t kCacheNodeMinSize = sizeof(uint8_t) + sizeof(uint32_t);
+
+/* 64-bit FNV-1a, stable across builds and platforms. */
+uint64_t hashContents(Span<const uint8_t> data)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for (uint8_t byte : data) {
+		hash ^= byte;
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+} /* namespace */
+
+/**
+ * \class YamlObjectCache
+ * \brief Persistent cache of parsed YAML files
+ *
+ * Parsing large YAML files, such as the tuning files of some IPA modules,
+ * takes a significant amount of time in libyaml. The YamlObjectCache stores
+ * the YamlObject tree of parsed files in a compact binary format, and
+ * rebuilds the tree from the cache on subsequent runs without going through
+ * libyaml.
+ *
+ * The cache is stored with CacheFile, and is thus disabled unless the
+ * LIBCAMERA_CACHE_DIR environment variable is set. Cache files are named after a hash of
+ * the YAML file contents, and store the size and hash of the contents they
+ * have been generated from. Any change to the YAML file thus results in a
+ * cache miss, without depending on file timestamps.
+ *
+ * Cache files are validated while being loaded, and parsing falls back to
+ * libyaml when a cache file is invalid.
+ */
+class YamlObjectCache
+{
+public:
+	YamlObjectCache(Span<const uint8_t> source);
+
+	bool enabled() const { return !path_.empty(); }
+
+	std::unique_ptr<YamlObject> load();
+	void store(const YamlObject &root);
+
+private:
+	class Reader
+	{
+	public:
+		Reader(Span<const uint8_t> data)
+			: data_(data), offset_(0)
+		{
+		}
+
+		size_t remaining() const { return data_.size() - offset_; }
+
+		template<typename T>
+		bool read(T *value)
+		{
+			if (remaining() < sizeof(T))
+				return false;
+
+			memcpy(value, data_.data() + offset_, sizeof(T));
+			offset_ += sizeof(T);
+			return true;
+		}
+
+		bool read(std::string *str)
+		{
+			uint32_t length;
+			if (!read(&length) || remaining() < length)
+				return false;
+
+			str->assign(reinterpret_cast<const char *>(data_.data() + offset_),
+				    length);
+			offset_ += length;
+			return true;
+		}
+
+	private:
+		Span<const uint8_t> data_;
+		size_t offset_;
+	};
+
+	static bool readNode(Reader &reader, YamlObject &obj, unsigned int depth);
+	static void writeNode(std::vector<uint8_t> &data, const YamlObject &obj);
+
+	uint64_t sourceSize_;
+	uint64_t sourceHash_;
+	std::string path_;
+};
+
+YamlObjectCache::YamlObjectCache(Span<const uint8_t> source)
+	: sourceSize_(source.size()), sourceHash_(0)
+{
+	if (!CacheFile::enabled())
+		return;
+
+	sourceHash_ = hashContents(source);
+
+	std::ostringstream name;
+	name << "yaml-" << std::hex << std::setw(16) << std::setfill('0')
+	     << sourceHash_ << ".cache";
+	path_ = CacheFile::path(name.str());
+}
+
+std::unique_ptr<YamlObject> YamlObjectCache::load()
+{
+	File file(path_);
+	if (!file.open(File::OpenModeFlag::ReadOnly))
+		return nullptr;
+
+	Span<const uint8_t> data = file.map();
+	if (data.empty())
+		return nullptr;
+
+	Reader reader(data);
+	CacheHeader header;
+
+	if (!reader.read(&header) ||
+	    memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) ||
+	    header.version != kCacheFormatVersion ||
+	    header.byteOrder != kCacheByteOrder ||
+	    header.sourceSize != sourceSize_ ||
+	    header.sourceHash != sourceHash_) {
+		LOG(YamlParser, Debug) << "Discarding stale cache " << path_;
+		return nullptr;
+	}
+
+	std::unique_ptr<YamlObject> root(new YamlObject());
+	if (!readNode(reader, *root, 0) || reader.remaining()) {
+		LOG(YamlParser, Warning) << "Discarding corrupted cache " << path_;
+		return nullptr;
+	}
+
+	return root;
+}
+
+bool YamlObjectCache::readNode(Reader &reader, YamlObject &obj,
+			       unsigned int depth)
+{
+	uint8_t type;
+	if (!reader.read(&type))
+		return false;
+
+	if (type == CacheNodeValue) {
+		obj.type_ = YamlObject::Type::Value;
+		return reader.read(&obj.value_);
+	}
+
+	if ((type != CacheNodeList && type != CacheNodeDictionary) ||
+	    depth >= kCacheMaxDepth)
+		return false;
+
+	uint32_t count;
+	if (!reader.read(&count))
+		return false;
+
+	/* Bound the allocation by the amount of data left. */
+	if (count > reader.remaining() / kCacheNodeMinSize)
+		return false;
+
+	obj.list_.reserve(count);
+
+	if (type == CacheNodeList) {
+		obj.type_ = YamlObject::Type::List;
+
+		for (uint32_t i = 0; i < count; ++i) {
+			auto &elem = obj.list_.emplace_back(std::string{},
+							    std::make_unique<YamlObject>());
+			if (!readNode(reader, *elem.value, depth + 1))
+				return false;
+		}
+
+		return true;
+	}
+
+	obj.type_ = YamlObject::Type::Dictionary;
+
+	for (uint32_t i = 0; i < count; ++i) {
+		std::string key;
+		if (!reader.read(&key))
+			return false;
+
+		auto &elem = obj.list_.emplace_back(std::move(key),
+						    std::make_unique<YamlObject>());
+		if (!readNode(reader, *elem.value, depth + 1))
+			return false;
+	}
+
+	for (const auto &elem : obj.list_)
+		obj.dictionary_.emplace(elem.key, elem.value.get());
+
+	return true;
+}
+
+void YamlObjectCache::store(const YamlObject &root)
+{
+	std::vector<uint8_t> data(sizeof(CacheHeader));
+
+	CacheHeader header;
+	memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+	header.version = kCacheFormatVersion;
+	header.byteOrder = kCacheByteOrder;
+	header.sourceSize = sourceSize_;
+	header.sourceHash = sourceHash_;
+	memcpy(data.data(), &header, sizeof(header));
+
+	writeNode(data, root);
+
+	int ret = CacheFile::write(path_, data);
+	if (ret) {
+		LOG(YamlParser, Warning)
+			<< "Failed to write " << path_ << ": " << strerror(-ret);
+		return;
+	}
+
+	LOG(YamlParser, Debug) << "Stored parsed YAML in " << path_;
+}
+
+void YamlObjectCache::writeNode(std::vector<uint8_t> &data, const YamlObject &obj)
+{
+	auto append = [&data](const void *ptr, size_t size) {
+		const uint8_t *bytes = static_cast<const uint8_t *>(ptr);
+		data.insert(data.end(), bytes, bytes + size);
+	};
+
+	auto appendString = [&append](const std::string &str) {
+		uint32_t length = str.size();
+		append(&length, sizeof(length));
+		append(str.data(), length);
+	};
+
+	uint8_t type;
+	switch (obj.type_) {
+	case YamlObject::Type::Value:
+		type = CacheNodeValue;
+		append(&type, sizeof(type));
+		appendString(obj.value_);
+		return;
+
+	case YamlObject::Type::List:
+		type = CacheNodeList;
+		break;
+
+	case YamlObject::Type::Dictionary:
+	default:
+		type = CacheNodeDictionary;
+		break;
+	}
+
+	uint32_t count = obj.list_.size();
+	append(&type, sizeof(type));
+	append(&count, sizeof(count));
+
+	for (const auto &elem : obj.list_) {
+		if (type == CacheNodeDictionary)
+			appendString(elem.key);
+		writeNode(data, *elem.value);
+	}
+}
+
 #endif /* __DOXYGEN__ */
 
 /**
@@ -829,10 +1245,36 @@ int YamlParserContext::parseNextYamlObject(YamlObject &yamlObject, EventPtr even
  * returns a pointer to a YamlObject corresponding to the root node of the YAML
  * document.
  *
+ * When the LIBCAMERA_CACHE_DIR environment variable is set, the parsed
+ * document is stored in a binary cache file in that directory, and later calls
+ * for a file with identical contents rebuild the YamlObject tree from the cache
+ * instead of parsing the YAML content again.
+ *
  * \return Pointer to result YamlObject on success or nullptr otherwise
  */
 std::unique_ptr<YamlObject> YamlParser::parse(File &file)
 {
+	/*
+	 * Look up the parsed file in the cache when enabled. The file is
+	 * mapped to hash its contents, which doesn't affect the read position
+	 * used by libyaml on a cache miss.
+	 */
+	Span<uint8_t> source = file.map();
+	std::optional<YamlObjectCache> cache;
+
+	if (!source.empty()) {
+		cache.emplace(source);
+		file.unmap(source.data());
+
+		if (!cache->enabled()) {
+			cache.reset();
+		} else if (std::unique_ptr<YamlObject> root = cache->load()) {
+			LOG(YamlParser, Debug)
+				<< "Loaded " << file.fileName() << " from cache";
+			return root;
+		}
+	}
+
 	YamlParserContext context;
 
 	if (context.init(file))
@@ -847,6 +1289,9 @@ std::unique_ptr<YamlObject> YamlParser::parse(File &file)
 		return nullptr;
 	}
 
+	if (cache)
+		cache->store(*root);
+
 	return root;
 }
 
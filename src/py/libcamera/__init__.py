@@ -1,4 +1,9 @@
 # SPDX-License-Identifier: LGPL-2.1-or-later
 # Copyright (C) 2022, Tomi Valkeinen <tomi.valkeinen@ideasonboard.com>
 
+from collections.abc import Mapping as _Mapping
+
 from ._libcamera import *
+
+# ControlList implements the mapping protocol on top of the C++ list
+_Mapping.register(ControlList)
@@ -10,6 +10,7 @@
 #include <sys/eventfd.h>
 #include <system_error>
 #include <unistd.h>
+#include <utility>
 #include <vector>
 
 #include "py_main.h"
@@ -31,6 +32,15 @@ PyCameraManager::PyCameraManager()
 
 	eventFd_ = UniqueFD(fd);
 
+	/*
+	 * Preallocate the completed requests vectors. They are swapped when
+	 * retrieving the ready requests, and their capacity is retained, so
+	 * the request completion handler doesn't need to allocate memory in
+	 * the steady state.
+	 */
+	completedRequests_.reserve(32);
+	readyRequests_.reserve(32);
+
 	int ret = cameraManager_->start();
 	if (ret)
 		throw std::system_error(-ret, std::generic_category(),
@@ -60,29 +70,40 @@ py::list PyCameraManager::cameras()
 	return l;
 }
 
-std::vector<py::object> PyCameraManager::getReadyRequests()
+py::list PyCameraManager::getReadyRequests()
 {
 	int ret = readFd();
 
 	if (ret == -EAGAIN)
-		return std::vector<py::object>();
+		return py::list();
 
 	if (ret != 0)
 		throw std::system_error(-ret, std::generic_category());
 
-	std::vector<py::object> py_reqs;
+	{
+		MutexLocker guard(completedRequestsMutex_);
+		std::swap(readyRequests_, completedRequests_);
+	}
+
+	/* Build the list in place, with all the requests of the batch. */
+	py::list py_reqs(readyRequests_.size());
 
-	for (Request *request : getCompletedRequests()) {
-		py::object o = py::cast(request);
+	for (size_t i = 0; i < readyRequests_.size(); ++i) {
+		py::object o = py::cast(readyRequests_[i]);
 		/* Decrease the ref increased in Camera.queue_request() */
 		o.dec_ref();
-		py_reqs.push_back(o);
+		py_reqs[i] = std::move(o);
 	}
 
+	readyRequests_.clear();
+
 	return py_reqs;
 }
 
-/* Note: Called from another thread */
+/*
+ * Note: Called from another thread, without the GIL held. This must not
+ * access any Python object.
+ */
 void PyCameraManager::handleRequestCompleted(Request *req)
 {
 	pushRequest(req);
@@ -121,11 +142,3 @@ void PyCameraManager::pushRequest(Request *req)
 	MutexLocker guard(completedRequestsMutex_);
 	completedRequests_.push_back(req);
 }
-
-std::vector<Request *> PyCameraManager::getCompletedRequests()
-{
-	std::vector<Request *> v;
-	MutexLocker guard(completedRequestsMutex_);
-	swap(v, completedRequests_);
-	return v;
-}
@@ -26,7 +26,7 @@ public:
 
 	int eventFd() const { return eventFd_.get(); }
 
-	std::vector<pybind11::object> getReadyRequests();
+	pybind11::list getReadyRequests();
 
 	void handleRequestCompleted(Request *req);
 
@@ -37,9 +37,10 @@ private:
 	libcamera::Mutex completedRequestsMutex_;
 	std::vector<Request *> completedRequests_
 		LIBCAMERA_TSA_GUARDED_BY(completedRequestsMutex_);
+	/* Only accessed with the GIL held */
+	std::vector<Request *> readyRequests_;
 
 	void writeFd();
 	int readFd();
 	void pushRequest(Request *req);
-	std::vector<Request *> getCompletedRequests();
 };
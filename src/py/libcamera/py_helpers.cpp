@@ -5,6 +5,8 @@
 
 #include "py_helpers.h"
 
+#include <unordered_map>
+
 #include <libcamera/libcamera.h>
 
 #include <pybind11/functional.h>
@@ -15,6 +17,28 @@ namespace py = pybind11;
 
 using namespace libcamera;
 
+/*
+ * Return the Python object for a ControlId. The objects are created once and
+ * kept alive for the lifetime of the process, so that converting the ids of
+ * metadata for every request doesn't allocate, and so that pybind11 returns the
+ * same object when a ControlId pointer is cast elsewhere. The cache is leaked
+ * on purpose, as the Python objects can't be released after the interpreter
+ * has been finalized.
+ */
+py::object controlIdToPy(const ControlId *id)
+{
+	static auto *cache = new std::unordered_map<const ControlId *, py::object>();
+
+	auto it = cache->find(id);
+	if (it != cache->end())
+		return it->second;
+
+	py::object ob = py::cast(id, py::return_value_policy::reference);
+	cache->emplace(id, ob);
+
+	return ob;
+}
+
 template<typename T>
 static py::object valueOrTuple(const ControlValue &cv)
 {
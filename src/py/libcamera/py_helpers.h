@@ -9,5 +9,6 @@
 
 #include <pybind11/pybind11.h>
 
+pybind11::object controlIdToPy(const libcamera::ControlId *id);
 pybind11::object controlValueToPy(const libcamera::ControlValue &cv);
 libcamera::ControlValue pyToControlValue(const pybind11::object &ob, libcamera::ControlType type);
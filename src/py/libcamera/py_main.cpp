@@ -7,6 +7,7 @@
 
 #include "py_main.h"
 
+#include <functional>
 #include <memory>
 #include <stdexcept>
 #include <string>
@@ -85,11 +86,28 @@ PYBIND11_DECLARE_HOLDER_TYPE(T, PyCameraSmartPtr<T>)
  */
 static std::weak_ptr<PyCameraManager> gCameraManager;
 
+/*
+ * Look up the ControlId of a control stored in a ControlList. Lists created by
+ * libcamera for requests always have an id map, fall back to the libcamera
+ * controls otherwise.
+ */
+static const ControlId *controlListId(const ControlList &list, unsigned int id)
+{
+	const ControlIdMap *idmap = list.idMap() ? list.idMap() : &controls::controls;
+
+	auto it = idmap->find(id);
+	if (it == idmap->end())
+		throw std::runtime_error("Unknown control " + std::to_string(id));
+
+	return it->second;
+}
+
 void init_py_color_space(py::module &m);
 void init_py_controls_generated(py::module &m);
 void init_py_enums(py::module &m);
 void init_py_formats_generated(py::module &m);
 void init_py_geometry(py::module &m);
+void init_py_mapped_framebuffer(py::module &m);
 void init_py_properties_generated(py::module &m);
 void init_py_transform(py::module &m);
 
@@ -115,6 +133,7 @@ PYBIND11_MODULE(_libcamera, m)
 	auto pySensorConfiguration = py::class_<SensorConfiguration>(m, "SensorConfiguration");
 	auto pyCameraConfiguration = py::class_<CameraConfiguration>(m, "CameraConfiguration");
 	auto pyCameraConfigurationStatus = py::enum_<CameraConfiguration::Status>(pyCameraConfiguration, "Status");
+	auto pyCameraConfigurationRequestOrder = py::enum_<CameraConfiguration::RequestOrder>(pyCameraConfiguration, "RequestOrder");
 	auto pyStreamConfiguration = py::class_<StreamConfiguration>(m, "StreamConfiguration");
 	auto pyStreamFormats = py::class_<StreamFormats>(m, "StreamFormats");
 	auto pyFrameBufferAllocator = py::class_<FrameBufferAllocator>(m, "FrameBufferAllocator");
@@ -123,6 +142,7 @@ PYBIND11_MODULE(_libcamera, m)
 	auto pyStream = py::class_<Stream>(m, "Stream");
 	auto pyControlId = py::class_<ControlId>(m, "ControlId");
 	auto pyControlInfo = py::class_<ControlInfo>(m, "ControlInfo");
+	auto pyControlList = py::class_<ControlList>(m, "ControlList");
 	auto pyRequest = py::class_<Request>(m, "Request");
 	auto pyRequestStatus = py::enum_<Request::Status>(pyRequest, "Status");
 	auto pyRequestReuse = py::enum_<Request::ReuseFlag>(pyRequest, "Reuse");
@@ -132,6 +152,7 @@ PYBIND11_MODULE(_libcamera, m)
 	auto pyPixelFormat = py::class_<PixelFormat>(m, "PixelFormat");
 
 	init_py_formats_generated(m);
+	init_py_mapped_framebuffer(m);
 
 	/* Global functions */
 	m.def("log_set_level", &logSetLevel);
@@ -159,12 +180,16 @@ PYBIND11_MODULE(_libcamera, m)
 	pyCamera
 		.def_property_readonly("id", &Camera::id)
 		.def("acquire", [](Camera &self) {
+			py::gil_scoped_release release;
+
 			int ret = self.acquire();
 			if (ret)
 				throw std::system_error(-ret, std::generic_category(),
 							"Failed to acquire camera");
 		})
 		.def("release", [](Camera &self) {
+			py::gil_scoped_release release;
+
 			int ret = self.release();
 			if (ret)
 				throw std::system_error(-ret, std::generic_category(),
@@ -186,7 +211,13 @@ PYBIND11_MODULE(_libcamera, m)
 				controlList.set(id->id(), val);
 			}
 
-			int ret = self.start(&controlList);
+			int ret;
+
+			{
+				py::gil_scoped_release release;
+				ret = self.start(&controlList);
+			}
+
 			if (ret) {
 				self.requestCompleted.disconnect();
 				throw std::system_error(-ret, std::generic_category(),
@@ -195,7 +226,17 @@ PYBIND11_MODULE(_libcamera, m)
 		}, py::arg("controls") = std::unordered_map<const ControlId *, py::object>())
 
 		.def("stop", [](Camera &self) {
-			int ret = self.stop();
+			int ret;
+
+			{
+				/*
+				 * Requests cancelled by stop() are completed
+				 * synchronously, but the completion handler
+				 * doesn't need the GIL.
+				 */
+				py::gil_scoped_release release;
+				ret = self.stop();
+			}
 
 			self.requestCompleted.disconnect();
 
@@ -214,7 +255,13 @@ PYBIND11_MODULE(_libcamera, m)
 		}, py::keep_alive<0, 1>())
 
 		.def("configure", [](Camera &self, CameraConfiguration *config) {
-			int ret = self.configure(config);
+			int ret;
+
+			{
+				py::gil_scoped_release release;
+				ret = self.configure(config);
+			}
+
 			if (ret)
 				throw std::system_error(-ret, std::generic_category(),
 							"Failed to configure camera");
@@ -238,7 +285,13 @@ PYBIND11_MODULE(_libcamera, m)
 
 			py_req.inc_ref();
 
-			int ret = self.queueRequest(req);
+			int ret;
+
+			{
+				py::gil_scoped_release release;
+				ret = self.queueRequest(req);
+			}
+
 			if (ret) {
 				py_req.dec_ref();
 				throw std::system_error(-ret, std::generic_category(),
@@ -329,13 +382,20 @@ PYBIND11_MODULE(_libcamera, m)
 		.def_property_readonly("size", &CameraConfiguration::size)
 		.def_property_readonly("empty", &CameraConfiguration::empty)
 		.def_readwrite("sensor_config", &CameraConfiguration::sensorConfig)
-		.def_readwrite("orientation", &CameraConfiguration::orientation);
+		.def_readwrite("orientation", &CameraConfiguration::orientation)
+		.def_readwrite("request_order", &CameraConfiguration::requestOrder)
+		.def_readwrite("max_queued_requests", &CameraConfiguration::maxQueuedRequests)
+		.def_readwrite("internal_buffer_count", &CameraConfiguration::internalBufferCount);
 
 	pyCameraConfigurationStatus
 		.value("Valid", CameraConfiguration::Valid)
 		.value("Adjusted", CameraConfiguration::Adjusted)
 		.value("Invalid", CameraConfiguration::Invalid);
 
+	pyCameraConfigurationRequestOrder
+		.value("Submission", CameraConfiguration::RequestOrder::Submission)
+		.value("Completion", CameraConfiguration::RequestOrder::Completion);
+
 	pyStreamConfiguration
 		.def("__str__", &StreamConfiguration::toString)
 		.def_property_readonly("stream", &StreamConfiguration::stream,
@@ -408,6 +468,16 @@ PYBIND11_MODULE(_libcamera, m)
 		.def_property_readonly("id", &ControlId::id)
 		.def_property_readonly("name", &ControlId::name)
 		.def_property_readonly("type", &ControlId::type)
+		/*
+		 * ControlId objects are used as dict keys, compare them by
+		 * identity of the underlying C++ object.
+		 */
+		.def("__eq__", [](const ControlId &self, const ControlId &other) {
+			return &self == &other;
+		}, py::is_operator())
+		.def("__hash__", [](const ControlId &self) {
+			return std::hash<const ControlId *>{}(&self);
+		})
 		.def("__str__", [](const ControlId &self) { return self.name(); })
 		.def("__repr__", [](const ControlId &self) {
 			return py::str("libcamera.ControlId({}, {}, {})")
@@ -436,6 +506,91 @@ PYBIND11_MODULE(_libcamera, m)
 				.format(self.toString());
 		});
 
+	/*
+	 * ControlList is exposed as a mapping from ControlId to values that
+	 * refers to the C++ list, without converting all the controls to a dict.
+	 * Values are converted to Python objects only when accessed.
+	 */
+	pyControlList
+		.def("__len__", &ControlList::size)
+		.def("__contains__", [](const ControlList &self, const ControlId &id) {
+			return self.contains(id.id());
+		})
+		.def("__getitem__", [](const ControlList &self, const ControlId &id) {
+			/* get() returns a None value for missing controls. */
+			const ControlValue &cv = self.get(id.id());
+			if (cv.isNone())
+				throw py::key_error(id.name());
+
+			return controlValueToPy(cv);
+		})
+		.def("__setitem__", [](ControlList &self, const ControlId &id, py::object value) {
+			self.set(id.id(), pyToControlValue(value, id.type()));
+		})
+		.def("get", [](const ControlList &self, const ControlId &id, py::object def) {
+			const ControlValue &cv = self.get(id.id());
+			if (cv.isNone())
+				return def;
+
+			return controlValueToPy(cv);
+		}, py::arg("id"), py::arg("default") = py::none())
+		.def("keys", [](const ControlList &self) {
+			py::list l(self.size());
+			size_t i = 0;
+			for (const auto &[id, cv] : self)
+				l[i++] = controlIdToPy(controlListId(self, id));
+			return l;
+		})
+		.def("values", [](const ControlList &self) {
+			py::list l(self.size());
+			size_t i = 0;
+			for (const auto &[id, cv] : self)
+				l[i++] = controlValueToPy(cv);
+			return l;
+		})
+		.def("items", [](const ControlList &self) {
+			py::list l(self.size());
+			size_t i = 0;
+			for (const auto &[id, cv] : self)
+				l[i++] = py::make_tuple(controlIdToPy(controlListId(self, id)),
+							controlValueToPy(cv));
+			return l;
+		})
+		.def("__iter__", [](py::object self) {
+			return py::iter(self.attr("keys")());
+		})
+		.def("__str__", [](const ControlList &self) {
+			std::string str = "{";
+			for (const auto &[id, cv] : self) {
+				if (str.size() > 1)
+					str += ", ";
+				str += controlListId(self, id)->name() + ": " + cv.toString();
+			}
+			return str + "}";
+		})
+		/* Typed accessors for common metadata, None when not reported */
+		.def_property_readonly("sensor_timestamp", [](const ControlList &self) {
+			return self.get(controls::SensorTimestamp);
+		})
+		.def_property_readonly("exposure_time", [](const ControlList &self) {
+			return self.get(controls::ExposureTime);
+		})
+		.def_property_readonly("analogue_gain", [](const ControlList &self) {
+			return self.get(controls::AnalogueGain);
+		})
+		.def_property_readonly("digital_gain", [](const ControlList &self) {
+			return self.get(controls::DigitalGain);
+		})
+		.def_property_readonly("frame_duration", [](const ControlList &self) {
+			return self.get(controls::FrameDuration);
+		})
+		.def_property_readonly("colour_temperature", [](const ControlList &self) {
+			return self.get(controls::ColourTemperature);
+		})
+		.def_property_readonly("lux", [](const ControlList &self) {
+			return self.get(controls::Lux);
+		});
+
 	pyRequest
 		/* \todo Fence is not supported, so we cannot expose addBuffer() directly */
 		.def("add_buffer", [](Request &self, const Stream *stream, FrameBuffer *buffer) {
@@ -448,23 +603,16 @@ PYBIND11_MODULE(_libcamera, m)
 		.def_property_readonly("buffers", &Request::buffers)
 		.def_property_readonly("cookie", &Request::cookie)
 		.def_property_readonly("sequence", &Request::sequence)
+		.def_property("target_sequence", &Request::targetSequence, &Request::setTargetSequence)
 		.def_property_readonly("has_pending_buffers", &Request::hasPendingBuffers)
 		.def("set_control", [](Request &self, const ControlId &id, py::object value) {
 			self.controls().set(id.id(), pyToControlValue(value, id.type()));
 		})
-		.def_property_readonly("metadata", [](Request &self) {
-			/* Convert ControlList to std container */
-
-			std::unordered_map<const ControlId *, py::object> ret;
-
-			for (const auto &[key, cv] : self.metadata()) {
-				const ControlId *id = controls::controls.at(key);
-				py::object ob = controlValueToPy(cv);
-				ret[id] = ob;
-			}
-
-			return ret;
-		})
+		/* The controls and metadata are views on the Request's lists */
+		.def_property_readonly("controls", &Request::controls,
+				       py::return_value_policy::reference_internal)
+		.def_property_readonly("metadata", &Request::metadata,
+				       py::return_value_policy::reference_internal)
 		/*
 		 * \todo As we add a keep_alive to the fb in addBuffers(), we
 		 * can only allow reuse with ReuseBuffers.
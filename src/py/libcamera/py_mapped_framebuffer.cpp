@@ -0,0 +1,179 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * Python bindings - Mapped frame buffers
+ */
+
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <stdint.h>
+#include <system_error>
+#include <vector>
+
+#include <libcamera/framebuffer.h>
+
+#include "libcamera/internal/dma_buf_allocator.h"
+#include "libcamera/internal/mapped_framebuffer.h"
+
+#include <pybind11/pybind11.h>
+
+namespace py = pybind11;
+
+using namespace libcamera;
+
+namespace {
+
+/*
+ * A plane of a mapped frame buffer, exposed to Python through the buffer
+ * protocol and the NumPy array interface, without copying the data. Planes
+ * hold a reference to the memory mapping, so that objects created from them
+ * (memoryviews, NumPy arrays, ...) never point to unmapped memory.
+ */
+class PyMappedPlane
+{
+public:
+	PyMappedPlane(std::shared_ptr<MappedFrameBuffer> mapping,
+		      Span<uint8_t> data, bool writable)
+		: mapping_(std::move(mapping)), data_(data), writable_(writable)
+	{
+	}
+
+	uint8_t *data() const { return data_.data(); }
+	size_t size() const { return data_.size(); }
+	bool writable() const { return writable_; }
+
+private:
+	std::shared_ptr<MappedFrameBuffer> mapping_;
+	Span<uint8_t> data_;
+	bool writable_;
+};
+
+/*
+ * Map the planes of a FrameBuffer for CPU access. The memory mapping itself is
+ * cached in the FrameBuffer by libcamera, so mapping and unmapping the same
+ * buffer for every frame is cheap. The CPU caches are synchronized with the
+ * device using DMA_BUF_IOCTL_SYNC when mapping and unmapping the buffer, so
+ * the planes should only be accessed between mmap() and munmap(), typically
+ * with a context manager.
+ */
+class PyMappedFrameBuffer
+{
+public:
+	PyMappedFrameBuffer(FrameBuffer *buffer, bool write)
+		: buffer_(buffer), write_(write)
+	{
+	}
+
+	FrameBuffer *buffer() const { return buffer_; }
+
+	void mmap()
+	{
+		if (mapping_)
+			throw std::runtime_error("MappedFrameBuffer already mmapped");
+
+		MappedFrameBuffer::MapFlags flags = MappedFrameBuffer::MapFlag::Read;
+		if (write_)
+			flags |= MappedFrameBuffer::MapFlag::Write;
+
+		auto mapping = std::make_shared<MappedFrameBuffer>(buffer_, flags);
+		if (!mapping->isValid())
+			throw std::system_error(-mapping->error(), std::generic_category(),
+						"Failed to map frame buffer");
+
+		/* Start CPU access once for each dmabuf backing the planes. */
+		DmaSyncer::SyncType type = write_ ? DmaSyncer::SyncType::ReadWrite
+						  : DmaSyncer::SyncType::Read;
+		std::set<int> fds;
+
+		for (const FrameBuffer::Plane &plane : buffer_->planes()) {
+			if (fds.insert(plane.fd.get()).second)
+				syncers_.emplace_back(plane.fd, type);
+		}
+
+		for (const Span<uint8_t> &plane : mapping->planes())
+			planes_.emplace_back(mapping, plane, write_);
+
+		mapping_ = std::move(mapping);
+	}
+
+	void munmap()
+	{
+		if (!mapping_)
+			throw std::runtime_error("MappedFrameBuffer not mmapped");
+
+		/* Destroying the syncers ends the CPU access. */
+		syncers_.clear();
+		planes_.clear();
+		mapping_.reset();
+	}
+
+	const std::vector<PyMappedPlane> &planes() const
+	{
+		if (!mapping_)
+			throw std::runtime_error("MappedFrameBuffer not mmapped");
+
+		return planes_;
+	}
+
+private:
+	FrameBuffer *buffer_;
+	bool write_;
+
+	std::shared_ptr<MappedFrameBuffer> mapping_;
+	std::vector<DmaSyncer> syncers_;
+	std::vector<PyMappedPlane> planes_;
+};
+
+} /* namespace */
+
+void init_py_mapped_framebuffer(py::module &m)
+{
+	auto pyMappedFrameBuffer = py::class_<PyMappedFrameBuffer>(m, "MappedFrameBuffer");
+	auto pyMappedPlane = py::class_<PyMappedPlane>(pyMappedFrameBuffer, "Plane",
+						       py::buffer_protocol());
+
+	pyMappedFrameBuffer
+		.def(py::init<FrameBuffer *, bool>(), py::arg("fb"),
+		     py::arg("write") = true, py::keep_alive<1, 2>())
+		.def("mmap", [](py::object self) {
+			self.cast<PyMappedFrameBuffer &>().mmap();
+			return self;
+		})
+		.def("munmap", &PyMappedFrameBuffer::munmap)
+		.def("__enter__", [](py::object self) {
+			self.cast<PyMappedFrameBuffer &>().mmap();
+			return self;
+		})
+		.def("__exit__", [](PyMappedFrameBuffer &self,
+				    [[maybe_unused]] py::args args) {
+			self.munmap();
+		})
+		.def_property_readonly("planes", [](const PyMappedFrameBuffer &self) {
+			py::tuple planes(self.planes().size());
+			for (size_t i = 0; i < self.planes().size(); ++i)
+				planes[i] = py::cast(self.planes()[i]);
+			return planes;
+		})
+		.def_property_readonly("fb", &PyMappedFrameBuffer::buffer,
+				       py::return_value_policy::reference);
+
+	pyMappedPlane
+		.def_buffer([](PyMappedPlane &self) {
+			return py::buffer_info(self.data(), sizeof(uint8_t),
+					       py::format_descriptor<uint8_t>::format(),
+					       1, { self.size() }, { sizeof(uint8_t) },
+					       !self.writable());
+		})
+		.def("__len__", &PyMappedPlane::size)
+		.def_property_readonly("__array_interface__", [](const PyMappedPlane &self) {
+			py::dict interface;
+			interface["version"] = 3;
+			interface["shape"] = py::make_tuple(self.size());
+			interface["typestr"] = "|u1";
+			interface["data"] = py::make_tuple(reinterpret_cast<uintptr_t>(self.data()),
+							   !self.writable());
+			return interface;
+		});
+}
@@ -0,0 +1,100 @@
+# SPDX-License-Identifier: LGPL-2.1-or-later
+# Copyright (C) 2026, Ideas on Board Oy
+
+import asyncio
+import collections
+
+import libcamera
+
+
+class AsyncCameraManager:
+    """Deliver completed requests to an asyncio event loop.
+
+    The camera manager event fd is monitored with loop.add_reader(), so a
+    single event loop can handle the requests of all cameras without polling.
+    Completed requests are retrieved in batches, and can be awaited either as
+    batches with get_ready_requests(), or one by one with 'async for'.
+
+    Only one coroutine may wait for requests at a time. Requests of multiple
+    cameras are delivered in completion order, and can be told apart with
+    their cookie.
+    """
+
+    def __init__(self, cm: libcamera.CameraManager = None):
+        self.cm = cm if cm is not None else libcamera.CameraManager.singleton()
+        self._loop = None
+        self._ready = collections.deque()
+        self._waiter = None
+
+    def start(self):
+        """Start monitoring the camera manager in the running event loop."""
+        if self._loop is not None:
+            raise RuntimeError('AsyncCameraManager already started')
+
+        self._loop = asyncio.get_running_loop()
+        self._loop.add_reader(self.cm.event_fd, self._handle_event)
+
+    def close(self):
+        """Stop monitoring the camera manager and wake up any waiter."""
+        if self._loop is None:
+            return
+
+        self._loop.remove_reader(self.cm.event_fd)
+        self._loop = None
+        self._wake()
+
+    async def __aenter__(self):
+        self.start()
+        return self
+
+    async def __aexit__(self, *exc):
+        self.close()
+
+    def _wake(self):
+        if self._waiter is not None and not self._waiter.done():
+            self._waiter.set_result(None)
+
+    def _handle_event(self):
+        reqs = self.cm.get_ready_requests()
+        if not reqs:
+            return
+
+        self._ready.extend(reqs)
+        self._wake()
+
+    async def _wait(self) -> bool:
+        while not self._ready:
+            if self._loop is None:
+                return False
+
+            if self._waiter is not None:
+                raise RuntimeError('Another coroutine is already waiting for requests')
+
+            self._waiter = self._loop.create_future()
+            try:
+                await self._waiter
+            finally:
+                self._waiter = None
+
+        return True
+
+    async def get_ready_requests(self) -> list[libcamera.Request]:
+        """Wait for at least one completed request, and return all ready ones.
+
+        Returns an empty list if the manager has been closed.
+        """
+        if not await self._wait():
+            return []
+
+        reqs = list(self._ready)
+        self._ready.clear()
+        return reqs
+
+    def __aiter__(self):
+        return self
+
+    async def __anext__(self) -> libcamera.Request:
+        if not await self._wait():
+            raise StopAsyncIteration
+
+        return self._ready.popleft()
@@ -1,4 +1,5 @@
 # SPDX-License-Identifier: LGPL-2.1-or-later
 # Copyright (C) 2022, Tomi Valkeinen <tomi.valkeinen@ideasonboard.com>
 
+from .AsyncCameraManager import AsyncCameraManager
 from .MappedFrameBuffer import MappedFrameBuffer
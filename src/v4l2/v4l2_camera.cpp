@@ -7,19 +7,39 @@
 
 #include "v4l2_camera.h"
 
+#include <algorithm>
 #include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <libcamera/base/log.h>
+#include <libcamera/base/utils.h>
+
+#include <libcamera/control_ids.h>
+
+#include "libcamera/internal/formats.h"
 
 using namespace libcamera;
 
 LOG_DECLARE_CATEGORY(V4L2Compat)
 
 V4L2Camera::V4L2Camera(std::shared_ptr<Camera> camera)
-	: camera_(camera), isRunning_(false), bufferAllocator_(nullptr),
-	  efd_(-1), bufferAvailableCount_(0)
+	: camera_(camera), isRunning_(false), frameDuration_(0),
+	  controls_(controls::controls), bufferAllocator_(nullptr),
+	  latestFrame_(false), latestRequest_(nullptr), efd_(-1),
+	  bufferAvailableCount_(0)
 {
+	/*
+	 * Applications that queue few buffers, or hold them for long, starve
+	 * the camera and drop frames. In latest-frame mode the camera runs at
+	 * its full frame rate on an internal pool of buffers, and the latest
+	 * frame is copied to the V4L2 buffers when they are queued.
+	 */
+	const char *latestFrame = utils::secure_getenv("LIBCAMERA_V4L2_LATEST_FRAME");
+	if (latestFrame && latestFrame[0] != '\0')
+		latestFrame_ = true;
+
 	camera_->requestCompleted.connect(this, &V4L2Camera::requestComplete);
 }
 
@@ -79,25 +99,15 @@ std::vector<V4L2Camera::Buffer> V4L2Camera::completedBuffers()
 	return v;
 }
 
-void V4L2Camera::requestComplete(Request *request)
+void V4L2Camera::completeBuffer(unsigned int index, const FrameMetadata &metadata)
 {
-	if (request->status() == Request::RequestCancelled)
-		return;
-
-	/* We only have one stream at the moment. */
-	bufferLock_.lock();
-	FrameBuffer *buffer = request->buffers().begin()->second;
-	std::unique_ptr<Buffer> metadata =
-		std::make_unique<Buffer>(request->cookie(), buffer->metadata());
-	completedBuffers_.push_back(std::move(metadata));
-	bufferLock_.unlock();
+	completedBuffers_.push_back(std::make_unique<Buffer>(index, metadata));
 
 	uint64_t data = 1;
 	int ret = ::write(efd_, &data, sizeof(data));
 	if (ret != sizeof(data))
 		LOG(V4L2Compat, Error) << "Failed to signal eventfd POLLIN";
 
-	request->reuse();
 	{
 		MutexLocker locker(bufferMutex_);
 		bufferAvailableCount_++;
@@ -105,6 +115,158 @@ void V4L2Camera::requestComplete(Request *request)
 	bufferCV_.notify_all();
 }
 
+void V4L2Camera::requestComplete(Request *request)
+{
+	if (request->status() == Request::RequestCancelled)
+		return;
+
+	if (request->cookie() & kInternalRequest) {
+		internalRequestComplete(request);
+		return;
+	}
+
+	/* We only have one stream at the moment. */
+	FrameBuffer *buffer = request->buffers().begin()->second;
+
+	{
+		MutexLocker locker(bufferLock_);
+		completeBuffer(request->cookie(), buffer->metadata());
+	}
+
+	request->reuse();
+}
+
+/*
+ * Complete the oldest V4L2 buffer queued by the application with the frame
+ * captured by \a request, and queue the request back to the camera right away.
+ * If no V4L2 buffer is queued, hold the request as the latest frame, and queue
+ * back the one it replaces.
+ */
+void V4L2Camera::internalRequestComplete(Request *request)
+{
+	Request *requeue = request;
+
+	{
+		MutexLocker locker(bufferLock_);
+
+		if (!isRunning_)
+			return;
+
+		if (queuedBuffers_.empty()) {
+			std::swap(requeue, latestRequest_);
+		} else {
+			unsigned int index = queuedBuffers_.front();
+			queuedBuffers_.pop_front();
+
+			completeBuffer(index, copyFrame(index, request));
+		}
+	}
+
+	if (!requeue)
+		return;
+
+	requeue->reuse(Request::ReuseBuffers);
+	applyControls(requeue);
+	int ret = camera_->queueRequest(requeue);
+	if (ret < 0 && ret != -EACCES)
+		LOG(V4L2Compat, Error) << "Can't queue internal request";
+}
+
+/*
+ * Queue V4L2 buffer \a index in latest-frame mode. The buffer is completed
+ * right away if a frame has been captured since the last buffer was completed,
+ * or when the next frame is captured otherwise.
+ */
+int V4L2Camera::queueLatest(unsigned int index)
+{
+	Request *request;
+
+	{
+		MutexLocker locker(bufferLock_);
+
+		if (!latestRequest_) {
+			queuedBuffers_.push_back(index);
+			return 0;
+		}
+
+		request = latestRequest_;
+		latestRequest_ = nullptr;
+
+		completeBuffer(index, copyFrame(index, request));
+	}
+
+	request->reuse(Request::ReuseBuffers);
+	applyControls(request);
+	int ret = camera_->queueRequest(request);
+	if (ret < 0) {
+		LOG(V4L2Compat, Error) << "Can't queue internal request";
+		return ret == -EACCES ? -EBUSY : ret;
+	}
+
+	return 0;
+}
+
+FrameBuffer *V4L2Camera::frameBuffer(unsigned int index)
+{
+	if (index < importedBuffers_.size())
+		return importedBuffers_[index].buffer.get();
+
+	Stream *stream = config_->at(0).stream();
+	const std::vector<std::unique_ptr<FrameBuffer>> &buffers =
+		bufferAllocator_->buffers(stream);
+
+	return index < buffers.size() ? buffers[index].get() : nullptr;
+}
+
+const MappedFrameBuffer *V4L2Camera::mapBuffer(const FrameBuffer *buffer)
+{
+	std::unique_ptr<MappedFrameBuffer> &mapped = mappings_[buffer];
+	if (mapped)
+		return mapped.get();
+
+	mapped = std::make_unique<MappedFrameBuffer>(buffer,
+						     MappedFrameBuffer::MapFlag::ReadWrite);
+	if (!mapped->isValid()) {
+		LOG(V4L2Compat, Error) << "Failed to map buffer";
+		mappings_.erase(buffer);
+		return nullptr;
+	}
+
+	return mapped.get();
+}
+
+/*
+ * Copy the frame captured by the internal \a request to V4L2 buffer \a index,
+ * and return the metadata to complete the V4L2 buffer with.
+ */
+FrameMetadata V4L2Camera::copyFrame(unsigned int index, Request *request)
+{
+	const FrameBuffer *src = request->buffers().begin()->second;
+	FrameMetadata result = src->metadata();
+
+	FrameBuffer *dst = frameBuffer(index);
+	const MappedFrameBuffer *srcMap = mapBuffer(src);
+	const MappedFrameBuffer *dstMap = dst ? mapBuffer(dst) : nullptr;
+	if (!srcMap || !dstMap) {
+		result.status = FrameMetadata::FrameError;
+		return result;
+	}
+
+	Span<const FrameMetadata::Plane> metadata = src->metadata().planes();
+	const std::vector<MappedBuffer::Plane> &srcPlanes = srcMap->planes();
+	const std::vector<MappedBuffer::Plane> &dstPlanes = dstMap->planes();
+
+	for (unsigned int i = 0; i < srcPlanes.size() && i < dstPlanes.size(); ++i) {
+		size_t size = std::min<size_t>(srcPlanes[i].size(), dstPlanes[i].size());
+		if (i < metadata.size())
+			size = std::min<size_t>(size, metadata[i].bytesused);
+
+		memcpy(dstPlanes[i].data(), srcPlanes[i].data(), size);
+	}
+
+	return result;
+}
+
 int V4L2Camera::configure(StreamConfiguration *streamConfigOut,
 			  const Size &size, const PixelFormat &pixelformat,
 			  unsigned int bufferCount)
@@ -156,14 +318,8 @@ int V4L2Camera::validateConfiguration(const PixelFormat &pixelFormat,
 	return 0;
 }
 
-int V4L2Camera::allocBuffers(unsigned int count)
+int V4L2Camera::createRequests(unsigned int count)
 {
-	Stream *stream = config_->at(0).stream();
-
-	int ret = bufferAllocator_->allocate(stream);
-	if (ret < 0)
-		return ret;
-
 	for (unsigned int i = 0; i < count; i++) {
 		std::unique_ptr<Request> request = camera_->createRequest(i);
 		if (!request) {
@@ -173,13 +329,111 @@ int V4L2Camera::allocBuffers(unsigned int count)
 		requestPool_.push_back(std::move(request));
 	}
 
-	return ret;
+	return 0;
+}
+
+/*
+ * Allocate the internal pool used in latest-frame mode, sized from the
+ * configuration and thus independent of the number of V4L2 buffers. Each
+ * request keeps its buffer for its whole lifetime.
+ */
+int V4L2Camera::allocInternalBuffers()
+{
+	if (!latestFrame_)
+		return 0;
+
+	Stream *stream = config_->at(0).stream();
+
+	internalAllocator_ = std::make_unique<FrameBufferAllocator>(camera_);
+	int ret = internalAllocator_->allocate(stream);
+	if (ret < 0) {
+		internalAllocator_.reset();
+		return ret;
+	}
+
+	const std::vector<std::unique_ptr<FrameBuffer>> &buffers =
+		internalAllocator_->buffers(stream);
+
+	for (auto [i, buffer] : utils::enumerate(buffers)) {
+		std::unique_ptr<Request> request =
+			camera_->createRequest(kInternalRequest | i);
+		if (!request || request->addBuffer(stream, buffer.get()) < 0) {
+			internalRequests_.clear();
+			internalAllocator_.reset();
+			return -ENOMEM;
+		}
+
+		internalRequests_.push_back(std::move(request));
+	}
+
+	LOG(V4L2Compat, Debug)
+		<< "Latest-frame mode with " << buffers.size()
+		<< " internal buffers";
+
+	return 0;
+}
+
+int V4L2Camera::allocBuffers(unsigned int count)
+{
+	Stream *stream = config_->at(0).stream();
+
+	int ret = bufferAllocator_->allocate(stream);
+	if (ret < 0)
+		return ret;
+
+	ret = createRequests(count);
+	if (ret < 0) {
+		bufferAllocator_->free(stream);
+		return ret;
+	}
+
+	ret = allocInternalBuffers();
+	if (ret < 0) {
+		requestPool_.clear();
+		bufferAllocator_->free(stream);
+		return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * Prepare \a count slots for buffers provided by the application as dmabufs.
+ * The FrameBuffer instances are created when the buffers are queued, as the
+ * dmabuf is only known at that point.
+ */
+int V4L2Camera::importBuffers(unsigned int count)
+{
+	int ret = createRequests(count);
+	if (ret < 0)
+		return ret;
+
+	ret = allocInternalBuffers();
+	if (ret < 0) {
+		requestPool_.clear();
+		return ret;
+	}
+
+	importedBuffers_.resize(count);
+
+	return 0;
 }
 
 void V4L2Camera::freeBuffers()
 {
 	pendingRequests_.clear();
 	requestPool_.clear();
+	internalRequests_.clear();
+	internalAllocator_.reset();
+
+	{
+		MutexLocker locker(bufferLock_);
+		queuedBuffers_.clear();
+		latestRequest_ = nullptr;
+		mappings_.clear();
+	}
+
+	importedBuffers_.clear();
 
 	Stream *stream = config_->at(0).stream();
 	bufferAllocator_->free(stream);
@@ -197,17 +451,88 @@ int V4L2Camera::getBufferFd(unsigned int index)
 	return buffers[index]->planes()[0].fd.get();
 }
 
+/*
+ * Copy up to \a count bytes of the frame captured in buffer \a index to
+ * \a data, starting at byte \a offset of the frame. The planes are read in
+ * sequence, limited to the bytes used in each of them. The buffer is mapped on
+ * first use and the mapping kept until the buffers are freed, to copy frames
+ * directly from the capture buffers with no intermediate copy.
+ *
+ * Return the number of bytes copied, which is 0 when the end of the frame is
+ * reached or the buffer can't be mapped.
+ */
+size_t V4L2Camera::readBuffer(unsigned int index, size_t offset, void *data,
+			      size_t count)
+{
+	const FrameBuffer *buffer = frameBuffer(index);
+	if (!buffer)
+		return 0;
+
+	MutexLocker locker(bufferLock_);
+
+	const MappedFrameBuffer *mapped = mapBuffer(buffer);
+	if (!mapped)
+		return 0;
+
+	/*
+	 * In latest-frame mode the metadata of the V4L2 buffers is not
+	 * updated, the whole planes are read.
+	 */
+	Span<const FrameMetadata::Plane> metadata = buffer->metadata().planes();
+	const std::vector<MappedBuffer::Plane> &planes = mapped->planes();
+	uint8_t *dst = static_cast<uint8_t *>(data);
+	size_t copied = 0;
+
+	for (unsigned int i = 0; i < planes.size(); ++i) {
+		size_t size = planes[i].size();
+		if (!latestFrame_ && i < metadata.size())
+			size = std::min<size_t>(metadata[i].bytesused, size);
+
+		if (offset >= size) {
+			offset -= size;
+			continue;
+		}
+
+		size_t length = std::min(size - offset, count - copied);
+		memcpy(dst + copied, planes[i].data() + offset, length);
+		copied += length;
+		offset = 0;
+
+		if (copied == count)
+			break;
+	}
+
+	return copied;
+}
+
 int V4L2Camera::streamOn()
 {
 	if (isRunning_)
 		return 0;
 
-	int ret = camera_->start();
+	ControlList controls(controls::controls);
+	if (frameDuration_)
+		controls.set(controls::FrameDurationLimits,
+			     { frameDuration_, frameDuration_ });
+
+	{
+		MutexLocker locker(bufferLock_);
+		controls_.clear();
+	}
+
+	int ret = camera_->start(&controls);
 	if (ret < 0)
 		return ret == -EACCES ? -EBUSY : ret;
 
 	isRunning_ = true;
 
+	for (std::unique_ptr<Request> &req : internalRequests_) {
+		req->reuse(Request::ReuseBuffers);
+		ret = camera_->queueRequest(req.get());
+		if (ret < 0)
+			return ret == -EACCES ? -EBUSY : ret;
+	}
+
 	for (Request *req : pendingRequests_) {
 		/* \todo What should we do if this returns -EINVAL? */
 		ret = camera_->queueRequest(req);
@@ -241,19 +566,61 @@ int V4L2Camera::streamOff()
 	}
 	bufferCV_.notify_all();
 
+	MutexLocker locker(bufferLock_);
+	queuedBuffers_.clear();
+	latestRequest_ = nullptr;
+
 	return 0;
 }
 
-int V4L2Camera::qbuf(unsigned int index)
+/*
+ * Set the frame duration to \a duration in µs, or restore the default frame
+ * duration limits when \a duration is 0. The value is applied when starting
+ * the camera, or with the next request queued when the camera is running.
+ */
+void V4L2Camera::setFrameDuration(int64_t duration)
 {
-	if (index >= requestPool_.size()) {
-		LOG(V4L2Compat, Error) << "Invalid index";
-		return -EINVAL;
+	frameDuration_ = duration;
+
+	if (!isRunning_)
+		return;
+
+	int64_t min = duration;
+	int64_t max = duration;
+
+	if (!duration) {
+		const ControlInfoMap &info = camera_->controls();
+		auto it = info.find(&controls::FrameDurationLimits);
+		if (it == info.end())
+			return;
+
+		min = it->second.min().get<int64_t>();
+		max = it->second.max().get<int64_t>();
 	}
+
+	MutexLocker locker(bufferLock_);
+	controls_.set(controls::FrameDurationLimits, { min, max });
+}
+
+void V4L2Camera::applyControls(Request *request)
+{
+	MutexLocker locker(bufferLock_);
+
+	if (controls_.empty())
+		return;
+
+	request->controls().merge(controls_);
+	controls_.clear();
+}
+
+int V4L2Camera::queueBuffer(unsigned int index, FrameBuffer *buffer)
+{
+	if (latestFrame_)
+		return queueLatest(index);
+
 	Request *request = requestPool_[index].get();
 
 	Stream *stream = config_->at(0).stream();
-	FrameBuffer *buffer = bufferAllocator_->buffers(stream)[index].get();
 	int ret = request->addBuffer(stream, buffer);
 	if (ret < 0) {
 		LOG(V4L2Compat, Error) << "Can't set buffer for request";
@@ -265,6 +632,7 @@ int V4L2Camera::qbuf(unsigned int index)
 		return 0;
 	}
 
+	applyControls(request);
 	ret = camera_->queueRequest(request);
 	if (ret < 0) {
 		LOG(V4L2Compat, Error) << "Can't queue request";
@@ -274,6 +642,91 @@ int V4L2Camera::qbuf(unsigned int index)
 	return 0;
 }
 
+int V4L2Camera::qbuf(unsigned int index)
+{
+	if (index >= requestPool_.size()) {
+		LOG(V4L2Compat, Error) << "Invalid index";
+		return -EINVAL;
+	}
+
+	Stream *stream = config_->at(0).stream();
+	const std::vector<std::unique_ptr<FrameBuffer>> &buffers =
+		bufferAllocator_->buffers(stream);
+	if (index >= buffers.size()) {
+		LOG(V4L2Compat, Error) << "No buffer allocated for index " << index;
+		return -EINVAL;
+	}
+
+	return queueBuffer(index, buffers[index].get());
+}
+
+/*
+ * Queue the application dmabuf \a fd of \a length bytes for \a index. The
+ * FrameBuffer wrapping the dmabuf is cached and reused as long as the
+ * application queues the same dmabuf for the same index, the planes are laid
+ * out contiguously in the dmabuf as mandated by the single-planar V4L2 API.
+ */
+int V4L2Camera::qbuf(unsigned int index, int fd, unsigned int length)
+{
+	if (index >= importedBuffers_.size()) {
+		LOG(V4L2Compat, Error) << "Invalid index";
+		return -EINVAL;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		LOG(V4L2Compat, Error) << "Invalid dmabuf fd " << fd;
+		return -EINVAL;
+	}
+
+	ImportedBuffer &imported = importedBuffers_[index];
+	if (imported.buffer && imported.dev == st.st_dev &&
+	    imported.ino == st.st_ino)
+		return queueBuffer(index, imported.buffer.get());
+
+	/* As videobuf2, use the dmabuf size when no length is given. */
+	if (!length) {
+		off_t size = lseek(fd, 0, SEEK_END);
+		length = size > 0 ? size : 0;
+	}
+
+	const StreamConfiguration &cfg = config_->at(0);
+	const PixelFormatInfo &info = PixelFormatInfo::info(cfg.pixelFormat);
+	if (!info.isValid() || length < cfg.frameSize) {
+		LOG(V4L2Compat, Error)
+			<< "dmabuf too small (" << length << " < "
+			<< cfg.frameSize << ")";
+		return -EINVAL;
+	}
+
+	SharedFD dmabuf(fd);
+	if (!dmabuf.isValid())
+		return -EINVAL;
+
+	std::vector<FrameBuffer::Plane> planes(info.numPlanes());
+	unsigned int offset = 0;
+
+	for (unsigned int i = 0; i < planes.size(); ++i) {
+		FrameBuffer::Plane &plane = planes[i];
+
+		plane.fd = dmabuf;
+		plane.offset = offset;
+		plane.length = info.planeSize(cfg.size.height, i, cfg.stride);
+		offset += plane.length;
+	}
+
+	if (imported.buffer) {
+		MutexLocker locker(bufferLock_);
+		mappings_.erase(imported.buffer.get());
+	}
+
+	imported.dev = st.st_dev;
+	imported.ino = st.st_ino;
+	imported.buffer = std::make_unique<FrameBuffer>(planes);
+
+	return queueBuffer(index, imported.buffer.get());
+}
+
 void V4L2Camera::waitForBufferAvailable()
 {
 	MutexLocker locker(bufferMutex_);
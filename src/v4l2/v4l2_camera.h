@@ -8,7 +8,10 @@
 #pragma once
 
 #include <deque>
+#include <map>
+#include <sys/types.h>
 #include <utility>
+#include <vector>
 
 #include <libcamera/base/mutex.h>
 #include <libcamera/base/semaphore.h>
@@ -18,6 +21,8 @@
 #include <libcamera/framebuffer.h>
 #include <libcamera/framebuffer_allocator.h>
 
+#include "libcamera/internal/mapped_framebuffer.h"
+
 class V4L2Camera
 {
 public:
@@ -50,13 +55,24 @@ public:
 				  libcamera::StreamConfiguration *streamConfigOut);
 
 	int allocBuffers(unsigned int count);
+	int importBuffers(unsigned int count);
 	void freeBuffers();
 	int getBufferFd(unsigned int index);
+	size_t readBuffer(unsigned int index, size_t offset, void *data,
+			  size_t count) LIBCAMERA_TSA_EXCLUDES(bufferLock_);
 
 	int streamOn();
 	int streamOff();
 
+	const libcamera::ControlInfoMap &controlInfo() const
+	{
+		return camera_->controls();
+	}
+	int64_t frameDuration() const { return frameDuration_; }
+	void setFrameDuration(int64_t duration) LIBCAMERA_TSA_EXCLUDES(bufferLock_);
+
 	int qbuf(unsigned int index);
+	int qbuf(unsigned int index, int fd, unsigned int length);
 
 	void waitForBufferAvailable() LIBCAMERA_TSA_EXCLUDES(bufferMutex_);
 	bool isBufferAvailable() LIBCAMERA_TSA_EXCLUDES(bufferMutex_);
@@ -64,19 +80,67 @@ public:
 	bool isRunning();
 
 private:
+	struct ImportedBuffer {
+		dev_t dev;
+		ino_t ino;
+		std::unique_ptr<libcamera::FrameBuffer> buffer;
+	};
+
+	/* Cookie of the requests of the internal pool in latest-frame mode. */
+	static constexpr uint64_t kInternalRequest = 1ULL << 63;
+
 	void requestComplete(libcamera::Request *request)
 		LIBCAMERA_TSA_EXCLUDES(bufferLock_);
+	void internalRequestComplete(libcamera::Request *request)
+		LIBCAMERA_TSA_EXCLUDES(bufferLock_);
+	void completeBuffer(unsigned int index,
+			    const libcamera::FrameMetadata &metadata)
+		LIBCAMERA_TSA_REQUIRES(bufferLock_);
+	libcamera::FrameMetadata copyFrame(unsigned int index,
+					   libcamera::Request *request)
+		LIBCAMERA_TSA_REQUIRES(bufferLock_);
+	libcamera::FrameBuffer *frameBuffer(unsigned int index);
+	const libcamera::MappedFrameBuffer *mapBuffer(const libcamera::FrameBuffer *buffer)
+		LIBCAMERA_TSA_REQUIRES(bufferLock_);
+
+	int allocInternalBuffers();
+	void applyControls(libcamera::Request *request)
+		LIBCAMERA_TSA_EXCLUDES(bufferLock_);
+
+	int createRequests(unsigned int count);
+	int queueBuffer(unsigned int index, libcamera::FrameBuffer *buffer);
+	int queueLatest(unsigned int index) LIBCAMERA_TSA_EXCLUDES(bufferLock_);
 
 	std::shared_ptr<libcamera::Camera> camera_;
 	std::unique_ptr<libcamera::CameraConfiguration> config_;
 
 	bool isRunning_;
 
+	/* Frame duration set by the application in µs, 0 for the default. */
+	int64_t frameDuration_;
+	/* Controls to be applied to the next queued request. */
+	libcamera::ControlList controls_ LIBCAMERA_TSA_GUARDED_BY(bufferLock_);
+
 	libcamera::Mutex bufferLock_;
 	libcamera::FrameBufferAllocator *bufferAllocator_;
+	std::vector<ImportedBuffer> importedBuffers_;
 
 	std::vector<std::unique_ptr<libcamera::Request>> requestPool_;
 
+	/*
+	 * In latest-frame mode, the camera captures to an internal pool of
+	 * buffers that are all kept queued, and frames are copied to the V4L2
+	 * buffers queued by the application.
+	 */
+	bool latestFrame_;
+	std::unique_ptr<libcamera::FrameBufferAllocator> internalAllocator_;
+	std::vector<std::unique_ptr<libcamera::Request>> internalRequests_;
+	std::deque<unsigned int> queuedBuffers_ LIBCAMERA_TSA_GUARDED_BY(bufferLock_);
+	libcamera::Request *latestRequest_ LIBCAMERA_TSA_GUARDED_BY(bufferLock_);
+	std::map<const libcamera::FrameBuffer *,
+		 std::unique_ptr<libcamera::MappedFrameBuffer>> mappings_
+		LIBCAMERA_TSA_GUARDED_BY(bufferLock_);
+
 	std::deque<libcamera::Request *> pendingRequests_;
 	std::deque<std::unique_ptr<Buffer>> completedBuffers_
 		LIBCAMERA_TSA_GUARDED_BY(bufferLock_);
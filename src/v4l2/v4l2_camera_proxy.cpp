@@ -23,6 +23,7 @@
 #include <libcamera/base/utils.h>
 
 #include <libcamera/camera.h>
+#include <libcamera/control_ids.h>
 #include <libcamera/formats.h>
 
 #include "libcamera/internal/formats.h"
@@ -40,7 +41,8 @@ LOG_DECLARE_CATEGORY(V4L2Compat)
 V4L2CameraProxy::V4L2CameraProxy(unsigned int index,
 				 std::shared_ptr<Camera> camera)
 	: refcount_(0), index_(index), bufferCount_(0), currentBuf_(0),
-	  vcam_(std::make_unique<V4L2Camera>(camera)), owner_(nullptr)
+	  memory_(V4L2_MEMORY_MMAP), readIo_(false), readPending_(false),
+	  readOffset_(0), vcam_(std::make_unique<V4L2Camera>(camera)), owner_(nullptr)
 {
 	querycap(camera);
 }
@@ -89,6 +91,9 @@ void V4L2CameraProxy::close(V4L2CameraFile *file)
 
 	files_.erase(file);
 
+	if (readIo_ && owner_ == file)
+		readStop();
+
 	release(file);
 
 	if (--refcount_ > 0)
@@ -105,6 +110,12 @@ void *V4L2CameraProxy::mmap(V4L2CameraFile *file, void *addr, size_t length,
 
 	MutexLocker locker(proxyMutex_);
 
+	/* Imported dmabufs are mapped by the application directly. */
+	if (memory_ != V4L2_MEMORY_MMAP) {
+		errno = EINVAL;
+		return MAP_FAILED;
+	}
+
 	/*
 	 * Mimic the videobuf2 behaviour, which requires PROT_READ and
 	 * MAP_SHARED.
@@ -166,6 +177,23 @@ int V4L2CameraProxy::munmap(V4L2CameraFile *file, void *addr, size_t length)
 	return 0;
 }
 
+ssize_t V4L2CameraProxy::read(V4L2CameraFile *file, void *buf, size_t count)
+{
+	LOG(V4L2Compat, Debug)
+		<< "[" << file->description() << "] " << __func__
+		<< "(count=" << count << ")";
+
+	MutexLocker locker(proxyMutex_);
+
+	ssize_t ret = readFrame(file, buf, count, &proxyMutex_);
+	if (ret < 0) {
+		errno = -ret;
+		return -1;
+	}
+
+	return ret;
+}
+
 bool V4L2CameraProxy::validateBufferType(uint32_t type)
 {
 	return type == V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -173,7 +201,7 @@ bool V4L2CameraProxy::validateBufferType(uint32_t type)
 
 bool V4L2CameraProxy::validateMemoryType(uint32_t memory)
 {
-	return memory == V4L2_MEMORY_MMAP;
+	return memory == V4L2_MEMORY_MMAP || memory == V4L2_MEMORY_DMABUF;
 }
 
 void V4L2CameraProxy::setFmtFromConfig(const StreamConfiguration &streamConfig)
@@ -210,6 +238,7 @@ void V4L2CameraProxy::querycap(std::shared_ptr<Camera> camera)
 	capabilities_.version = KERNEL_VERSION(5, 2, 0);
 	capabilities_.device_caps = V4L2_CAP_VIDEO_CAPTURE
 				  | V4L2_CAP_STREAMING
+				  | V4L2_CAP_READWRITE
 				  | V4L2_CAP_EXT_PIX_FORMAT;
 	capabilities_.capabilities = capabilities_.device_caps
 				   | V4L2_CAP_DEVICE_CAPS;
@@ -246,6 +275,42 @@ void V4L2CameraProxy::updateBuffers()
 	}
 }
 
+/*
+ * Retrieve the frame duration limits of the camera in µs. Return false if the
+ * camera doesn't support controlling the frame duration.
+ */
+bool V4L2CameraProxy::frameDurationLimits(int64_t *min, int64_t *max, int64_t *def)
+{
+	const ControlInfoMap &controls = vcam_->controlInfo();
+	auto it = controls.find(&controls::FrameDurationLimits);
+	if (it == controls.end())
+		return false;
+
+	const ControlInfo &info = it->second;
+	*min = info.min().get<int64_t>();
+	*max = info.max().get<int64_t>();
+	*def = info.def().isNone() ? *min : info.def().get<int64_t>();
+
+	return *min > 0 && *max >= *min;
+}
+
+void V4L2CameraProxy::fillParm(struct v4l2_captureparm *parm)
+{
+	memset(parm, 0, sizeof(*parm));
+	parm->readbuffers = kReadBuffers;
+
+	int64_t min, max, def;
+	if (!frameDurationLimits(&min, &max, &def))
+		return;
+
+	int64_t duration = vcam_->frameDuration() ? vcam_->frameDuration() : def;
+	int64_t divisor = std::gcd(duration, static_cast<int64_t>(1000000));
+
+	parm->capability = V4L2_CAP_TIMEPERFRAME;
+	parm->timeperframe.numerator = duration / divisor;
+	parm->timeperframe.denominator = 1000000 / divisor;
+}
+
 int V4L2CameraProxy::vidioc_querycap(V4L2CameraFile *file, struct v4l2_capability *arg)
 {
 	LOG(V4L2Compat, Debug)
@@ -280,6 +345,39 @@ int V4L2CameraProxy::vidioc_enum_framesizes(V4L2CameraFile *file, struct v4l2_fr
 	return 0;
 }
 
+int V4L2CameraProxy::vidioc_enum_frameintervals(V4L2CameraFile *file,
+						struct v4l2_frmivalenum *arg)
+{
+	LOG(V4L2Compat, Debug)
+		<< "[" << file->description() << "] " << __func__ << "()";
+
+	if (arg->index != 0)
+		return -EINVAL;
+
+	V4L2PixelFormat v4l2Format = V4L2PixelFormat(arg->pixel_format);
+	PixelFormat format = v4l2Format.toPixelFormat();
+	const std::vector<Size> &frameSizes = streamConfig_.formats().sizes(format);
+	if (std::find(frameSizes.begin(), frameSizes.end(),
+		      Size(arg->width, arg->height)) == frameSizes.end())
+		return -EINVAL;
+
+	int64_t min, max, def;
+	if (!frameDurationLimits(&min, &max, &def))
+		return -EINVAL;
+
+	/*
+	 * The camera exposes a continuous range of frame durations, with a
+	 * microsecond resolution.
+	 */
+	arg->type = V4L2_FRMIVAL_TYPE_CONTINUOUS;
+	arg->stepwise.min = { static_cast<uint32_t>(min), 1000000 };
+	arg->stepwise.max = { static_cast<uint32_t>(max), 1000000 };
+	arg->stepwise.step = { 1, 1000000 };
+	memset(arg->reserved, 0, sizeof(arg->reserved));
+
+	return 0;
+}
+
 int V4L2CameraProxy::vidioc_enum_fmt(V4L2CameraFile *file, struct v4l2_fmtdesc *arg)
 {
 	LOG(V4L2Compat, Debug)
@@ -357,6 +455,9 @@ int V4L2CameraProxy::vidioc_s_fmt(V4L2CameraFile *file, struct v4l2_format *arg)
 	if (file->priority() < maxPriority())
 		return -EBUSY;
 
+	if (readIo_)
+		return -EBUSY;
+
 	int ret = acquire(file);
 	if (ret < 0)
 		return ret;
@@ -401,6 +502,51 @@ enum v4l2_priority V4L2CameraProxy::maxPriority()
 	return max != files_.end() ? (*max)->priority() : V4L2_PRIORITY_UNSET;
 }
 
+int V4L2CameraProxy::vidioc_g_parm(V4L2CameraFile *file, struct v4l2_streamparm *arg)
+{
+	LOG(V4L2Compat, Debug)
+		<< "[" << file->description() << "] " << __func__ << "()";
+
+	if (!validateBufferType(arg->type))
+		return -EINVAL;
+
+	fillParm(&arg->parm.capture);
+
+	return 0;
+}
+
+int V4L2CameraProxy::vidioc_s_parm(V4L2CameraFile *file, struct v4l2_streamparm *arg)
+{
+	LOG(V4L2Compat, Debug)
+		<< "[" << file->description() << "] " << __func__ << "()";
+
+	if (!validateBufferType(arg->type))
+		return -EINVAL;
+
+	if (file->priority() < maxPriority())
+		return -EBUSY;
+
+	if (!hasOwnership(file) && owner_)
+		return -EBUSY;
+
+	int64_t min, max, def;
+	if (frameDurationLimits(&min, &max, &def)) {
+		const struct v4l2_fract &tpf = arg->parm.capture.timeperframe;
+
+		/* A zero fraction restores the default frame rate. */
+		int64_t duration = 0;
+		if (tpf.numerator && tpf.denominator)
+			duration = std::clamp<int64_t>(tpf.numerator * 1000000ULL / tpf.denominator,
+						       min, max);
+
+		vcam_->setFrameDuration(duration);
+	}
+
+	fillParm(&arg->parm.capture);
+
+	return 0;
+}
+
 int V4L2CameraProxy::vidioc_g_priority(V4L2CameraFile *file, enum v4l2_priority *arg)
 {
 	LOG(V4L2Compat, Debug)
@@ -473,6 +619,151 @@ void V4L2CameraProxy::freeBuffers()
 	bufferCount_ = 0;
 }
 
+/*
+ * Start streaming with the read() I/O method. As videobuf2 does, a small ring
+ * of internal buffers is allocated and queued, and streaming starts on the
+ * first read() call. The file becomes the owner of the proxy until it is
+ * closed.
+ */
+int V4L2CameraProxy::readStart(V4L2CameraFile *file)
+{
+	if (file->priority() < maxPriority())
+		return -EBUSY;
+
+	/* The streaming I/O method is in use. */
+	if (bufferCount_ > 0)
+		return -EBUSY;
+
+	int ret = acquire(file);
+	if (ret < 0)
+		return ret;
+
+	Size size(v4l2PixFormat_.width, v4l2PixFormat_.height);
+	V4L2PixelFormat v4l2Format = V4L2PixelFormat(v4l2PixFormat_.pixelformat);
+	ret = vcam_->configure(&streamConfig_, size,
+			       v4l2Format.toPixelFormat(), kReadBuffers);
+	if (ret < 0) {
+		release(file);
+		return -EINVAL;
+	}
+
+	setFmtFromConfig(streamConfig_);
+
+	ret = vcam_->allocBuffers(streamConfig_.bufferCount);
+	if (ret < 0) {
+		release(file);
+		return ret;
+	}
+
+	memory_ = V4L2_MEMORY_MMAP;
+	bufferCount_ = streamConfig_.bufferCount;
+	buffers_.assign(bufferCount_, {});
+
+	for (unsigned int i = 0; i < bufferCount_; i++) {
+		ret = vcam_->qbuf(i);
+		if (ret < 0)
+			break;
+
+		buffers_[i].index = i;
+		buffers_[i].flags = V4L2_BUF_FLAG_QUEUED;
+	}
+
+	if (ret >= 0)
+		ret = vcam_->streamOn();
+
+	if (ret < 0) {
+		vcam_->streamOff();
+		freeBuffers();
+		release(file);
+		return ret;
+	}
+
+	currentBuf_ = 0;
+	readPending_ = false;
+	readIo_ = true;
+
+	return 0;
+}
+
+void V4L2CameraProxy::readStop()
+{
+	vcam_->streamOff();
+	freeBuffers();
+
+	readPending_ = false;
+	readIo_ = false;
+}
+
+/*
+ * Copy the next frame to \a buf. Frames larger than \a count are returned
+ * over multiple calls, the buffer is queued back to the camera once it has
+ * been fully read. The eventfd is cleared when a new frame is consumed,
+ * keeping poll() in sync with the completed frames.
+ */
+ssize_t V4L2CameraProxy::readFrame(V4L2CameraFile *file, void *buf,
+				   size_t count, Mutex *lock)
+{
+	if (!hasOwnership(file) && owner_)
+		return -EBUSY;
+
+	if (!readIo_) {
+		int ret = readStart(file);
+		if (ret < 0)
+			return ret;
+	}
+
+	if (!count)
+		return 0;
+
+	if (!readPending_) {
+		if (!file->nonBlocking()) {
+			lock->unlock();
+			vcam_->waitForBufferAvailable();
+			lock->lock();
+		} else if (!vcam_->isBufferAvailable()) {
+			return -EAGAIN;
+		}
+
+		/* The file may have been closed by another thread. */
+		if (!readIo_ || !vcam_->isRunning())
+			return -EIO;
+
+		updateBuffers();
+
+		uint64_t data;
+		int ret = V4L2CompatManager::instance()->fops().read(file->efd(), &data,
+								    sizeof(data));
+		if (ret != sizeof(data))
+			LOG(V4L2Compat, Error) << "Failed to clear eventfd POLLIN";
+
+		readPending_ = true;
+		readOffset_ = 0;
+	}
+
+	struct v4l2_buffer &buffer = buffers_[currentBuf_];
+	size_t copied = 0;
+
+	if (!(buffer.flags & V4L2_BUF_FLAG_ERROR))
+		copied = vcam_->readBuffer(currentBuf_, readOffset_, buf,
+					   std::min<size_t>(count,
+							    buffer.bytesused - readOffset_));
+
+	readOffset_ += copied;
+
+	if (!copied || readOffset_ >= buffer.bytesused) {
+		buffer.flags &= ~(V4L2_BUF_FLAG_DONE | V4L2_BUF_FLAG_ERROR);
+
+		int ret = vcam_->qbuf(currentBuf_);
+		if (ret < 0)
+			buffer.flags &= ~V4L2_BUF_FLAG_QUEUED;
+
+		currentBuf_ = (currentBuf_ + 1) % bufferCount_;
+		readPending_ = false;
+	}
+
+	return copied ? static_cast<ssize_t>(copied) : -EIO;
+}
+
 int V4L2CameraProxy::vidioc_reqbufs(V4L2CameraFile *file, struct v4l2_requestbuffers *arg)
 {
 	LOG(V4L2Compat, Debug)
@@ -490,7 +781,10 @@ int V4L2CameraProxy::vidioc_reqbufs(V4L2CameraFile *file, struct v4l2_requestbuf
 	if (!hasOwnership(file) && owner_)
 		return -EBUSY;
 
-	arg->capabilities = V4L2_BUF_CAP_SUPPORTS_MMAP;
+	if (readIo_)
+		return -EBUSY;
+
+	arg->capabilities = V4L2_BUF_CAP_SUPPORTS_MMAP | V4L2_BUF_CAP_SUPPORTS_DMABUF;
 	arg->flags = 0;
 	memset(arg->reserved, 0, sizeof(arg->reserved));
 
@@ -523,19 +817,32 @@ int V4L2CameraProxy::vidioc_reqbufs(V4L2CameraFile *file, struct v4l2_requestbuf
 	arg->count = streamConfig_.bufferCount;
 	bufferCount_ = arg->count;
 
-	ret = vcam_->allocBuffers(arg->count);
+	/*
+	 * DMABUF buffers are provided by the application at qbuf time and
+	 * wrapped in FrameBuffer instances, only MMAP buffers are allocated.
+	 */
+	if (arg->memory == V4L2_MEMORY_DMABUF)
+		ret = vcam_->importBuffers(arg->count);
+	else
+		ret = vcam_->allocBuffers(arg->count);
 	if (ret < 0) {
 		arg->count = 0;
+		bufferCount_ = 0;
 		return ret;
 	}
 
+	memory_ = arg->memory;
+
 	buffers_.resize(arg->count);
 	for (unsigned int i = 0; i < arg->count; i++) {
 		struct v4l2_buffer buf = {};
 		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 		buf.length = v4l2PixFormat_.sizeimage;
-		buf.memory = V4L2_MEMORY_MMAP;
-		buf.m.offset = i * v4l2PixFormat_.sizeimage;
+		buf.memory = memory_;
+		if (memory_ == V4L2_MEMORY_DMABUF)
+			buf.m.fd = -1;
+		else
+			buf.m.offset = i * v4l2PixFormat_.sizeimage;
 		buf.index = i;
 		buf.flags = V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
 
@@ -584,7 +891,7 @@ int V4L2CameraProxy::vidioc_prepare_buf(V4L2CameraFile *file, struct v4l2_buffer
 		return -EINVAL;
 
 	if (!validateBufferType(arg->type) ||
-	    !validateMemoryType(arg->memory))
+	    arg->memory != memory_)
 		return -EINVAL;
 
 	struct v4l2_buffer &buffer = buffers_[arg->index];
@@ -612,19 +919,31 @@ int V4L2CameraProxy::vidioc_qbuf(V4L2CameraFile *file, struct v4l2_buffer *arg)
 	if (buffers_[arg->index].flags & V4L2_BUF_FLAG_QUEUED)
 		return -EINVAL;
 
-	if (!hasOwnership(file))
+	if (!hasOwnership(file) || readIo_)
 		return -EBUSY;
 
 	if (!validateBufferType(arg->type) ||
-	    !validateMemoryType(arg->memory) ||
+	    arg->memory != memory_ ||
 	    arg->index >= bufferCount_)
 		return -EINVAL;
 
-	int ret = vcam_->qbuf(arg->index);
-	if (ret < 0)
-		return ret;
+	struct v4l2_buffer &buf = buffers_[arg->index];
+	int ret;
 
-	buffers_[arg->index].flags |= V4L2_BUF_FLAG_QUEUED;
+	if (memory_ == V4L2_MEMORY_DMABUF) {
+		ret = vcam_->qbuf(arg->index, arg->m.fd, arg->length);
+		if (ret < 0)
+			return ret;
+
+		buf.m.fd = arg->m.fd;
+		buf.length = arg->length;
+	} else {
+		ret = vcam_->qbuf(arg->index);
+		if (ret < 0)
+			return ret;
+	}
+
+	buf.flags |= V4L2_BUF_FLAG_QUEUED;
 
 	arg->flags = buffers_[arg->index].flags;
 
@@ -640,14 +959,14 @@ int V4L2CameraProxy::vidioc_dqbuf(V4L2CameraFile *file, struct v4l2_buffer *arg,
 	if (arg->index >= bufferCount_)
 		return -EINVAL;
 
-	if (!hasOwnership(file))
+	if (!hasOwnership(file) || readIo_)
 		return -EBUSY;
 
 	if (!vcam_->isRunning())
 		return -EINVAL;
 
 	if (!validateBufferType(arg->type) ||
-	    !validateMemoryType(arg->memory))
+	    arg->memory != memory_)
 		return -EINVAL;
 
 	if (!file->nonBlocking()) {
@@ -669,13 +988,15 @@ int V4L2CameraProxy::vidioc_dqbuf(V4L2CameraFile *file, struct v4l2_buffer *arg,
 	struct v4l2_buffer &buf = buffers_[currentBuf_];
 
 	buf.flags &= ~(V4L2_BUF_FLAG_QUEUED | V4L2_BUF_FLAG_DONE | V4L2_BUF_FLAG_PREPARED);
-	buf.length = sizeimage_;
+	if (memory_ == V4L2_MEMORY_MMAP)
+		buf.length = sizeimage_;
 	*arg = buf;
 
 	currentBuf_ = (currentBuf_ + 1) % bufferCount_;
 
 	uint64_t data;
-	int ret = ::read(file->efd(), &data, sizeof(data));
+	int ret = V4L2CompatManager::instance()->fops().read(file->efd(), &data,
+							    sizeof(data));
 	if (ret != sizeof(data))
 		LOG(V4L2Compat, Error) << "Failed to clear eventfd POLLIN";
 
@@ -690,8 +1011,7 @@ int V4L2CameraProxy::vidioc_expbuf(V4L2CameraFile *file, struct v4l2_exportbuffe
 	if (!hasOwnership(file))
 		return -EBUSY;
 
-	/* \todo Verify that the memory type is MMAP when adding DMABUF support */
-	if (!validateBufferType(arg->type))
+	if (!validateBufferType(arg->type) || memory_ != V4L2_MEMORY_MMAP)
 		return -EINVAL;
 
 	if (arg->index >= bufferCount_)
@@ -723,7 +1043,7 @@ int V4L2CameraProxy::vidioc_streamon(V4L2CameraFile *file, int *arg)
 	if (file->priority() < maxPriority())
 		return -EBUSY;
 
-	if (!hasOwnership(file))
+	if (!hasOwnership(file) || readIo_)
 		return -EBUSY;
 
 	if (vcam_->isRunning())
@@ -748,6 +1068,9 @@ int V4L2CameraProxy::vidioc_streamoff(V4L2CameraFile *file, int *arg)
 	if (!hasOwnership(file) && owner_)
 		return -EBUSY;
 
+	if (readIo_)
+		return -EBUSY;
+
 	int ret = vcam_->streamOff();
 
 	for (struct v4l2_buffer &buf : buffers_)
@@ -759,10 +1082,13 @@ int V4L2CameraProxy::vidioc_streamoff(V4L2CameraFile *file, int *arg)
 const std::set<unsigned long> V4L2CameraProxy::supportedIoctls_ = {
 	VIDIOC_QUERYCAP,
 	VIDIOC_ENUM_FRAMESIZES,
+	VIDIOC_ENUM_FRAMEINTERVALS,
 	VIDIOC_ENUM_FMT,
 	VIDIOC_G_FMT,
 	VIDIOC_S_FMT,
 	VIDIOC_TRY_FMT,
+	VIDIOC_G_PARM,
+	VIDIOC_S_PARM,
 	VIDIOC_G_PRIORITY,
 	VIDIOC_S_PRIORITY,
 	VIDIOC_ENUMINPUT,
@@ -815,6 +1141,9 @@ int V4L2CameraProxy::ioctl(V4L2CameraFile *file, unsigned long longRequest, void
 	case VIDIOC_ENUM_FRAMESIZES:
 		ret = vidioc_enum_framesizes(file, static_cast<struct v4l2_frmsizeenum *>(arg));
 		break;
+	case VIDIOC_ENUM_FRAMEINTERVALS:
+		ret = vidioc_enum_frameintervals(file, static_cast<struct v4l2_frmivalenum *>(arg));
+		break;
 	case VIDIOC_ENUM_FMT:
 		ret = vidioc_enum_fmt(file, static_cast<struct v4l2_fmtdesc *>(arg));
 		break;
@@ -827,6 +1156,12 @@ int V4L2CameraProxy::ioctl(V4L2CameraFile *file, unsigned long longRequest, void
 	case VIDIOC_TRY_FMT:
 		ret = vidioc_try_fmt(file, static_cast<struct v4l2_format *>(arg));
 		break;
+	case VIDIOC_G_PARM:
+		ret = vidioc_g_parm(file, static_cast<struct v4l2_streamparm *>(arg));
+		break;
+	case VIDIOC_S_PARM:
+		ret = vidioc_s_parm(file, static_cast<struct v4l2_streamparm *>(arg));
+		break;
 	case VIDIOC_G_PRIORITY:
 		ret = vidioc_g_priority(file, static_cast<enum v4l2_priority *>(arg));
 		break;
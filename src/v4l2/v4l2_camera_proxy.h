@@ -33,11 +33,16 @@ public:
 		   int flags, off64_t offset) LIBCAMERA_TSA_EXCLUDES(proxyMutex_);
 	int munmap(V4L2CameraFile *file, void *addr, size_t length)
 		LIBCAMERA_TSA_EXCLUDES(proxyMutex_);
+	ssize_t read(V4L2CameraFile *file, void *buf, size_t count)
+		LIBCAMERA_TSA_EXCLUDES(proxyMutex_);
 
 	int ioctl(V4L2CameraFile *file, unsigned long request, void *arg)
 		LIBCAMERA_TSA_EXCLUDES(proxyMutex_);
 
 private:
+	/* Number of buffers used internally by the read() I/O method. */
+	static constexpr unsigned int kReadBuffers = 4;
+
 	bool validateBufferType(uint32_t type);
 	bool validateMemoryType(uint32_t memory);
 	void setFmtFromConfig(const libcamera::StreamConfiguration &streamConfig);
@@ -45,14 +50,24 @@ private:
 	int tryFormat(struct v4l2_format *arg);
 	enum v4l2_priority maxPriority();
 	void updateBuffers();
+	bool frameDurationLimits(int64_t *min, int64_t *max, int64_t *def);
+	void fillParm(struct v4l2_captureparm *parm);
 	void freeBuffers();
+	int readStart(V4L2CameraFile *file);
+	void readStop();
+	ssize_t readFrame(V4L2CameraFile *file, void *buf, size_t count,
+			  libcamera::Mutex *lock) LIBCAMERA_TSA_REQUIRES(*lock);
 
 	int vidioc_querycap(V4L2CameraFile *file, struct v4l2_capability *arg);
 	int vidioc_enum_framesizes(V4L2CameraFile *file, struct v4l2_frmsizeenum *arg);
+	int vidioc_enum_frameintervals(V4L2CameraFile *file,
+				       struct v4l2_frmivalenum *arg);
 	int vidioc_enum_fmt(V4L2CameraFile *file, struct v4l2_fmtdesc *arg);
 	int vidioc_g_fmt(V4L2CameraFile *file, struct v4l2_format *arg);
 	int vidioc_s_fmt(V4L2CameraFile *file, struct v4l2_format *arg);
 	int vidioc_try_fmt(V4L2CameraFile *file, struct v4l2_format *arg);
+	int vidioc_g_parm(V4L2CameraFile *file, struct v4l2_streamparm *arg);
+	int vidioc_s_parm(V4L2CameraFile *file, struct v4l2_streamparm *arg);
 	int vidioc_g_priority(V4L2CameraFile *file, enum v4l2_priority *arg);
 	int vidioc_s_priority(V4L2CameraFile *file, enum v4l2_priority *arg);
 	int vidioc_enuminput(V4L2CameraFile *file, struct v4l2_input *arg);
@@ -80,8 +95,18 @@ private:
 	libcamera::StreamConfiguration streamConfig_;
 	unsigned int bufferCount_;
 	unsigned int currentBuf_;
+	uint32_t memory_;
 	unsigned int sizeimage_;
 
+	/*
+	 * Set when streaming with the read() I/O method. readPending_ tells
+	 * if the buffer at currentBuf_ has been partially read, up to
+	 * readOffset_.
+	 */
+	bool readIo_;
+	bool readPending_;
+	size_t readOffset_;
+
 	struct v4l2_capability capabilities_;
 	struct v4l2_pix_format v4l2PixFormat_;
 
@@ -133,4 +133,16 @@ LIBCAMERA_PUBLIC int ioctl(int fd, unsigned long request, ...)
 	return V4L2CompatManager::instance()->ioctl(fd, request, arg);
 }
 
+LIBCAMERA_PUBLIC ssize_t read(int fd, void *buf, size_t count)
+{
+	return V4L2CompatManager::instance()->read(fd, buf, count);
+}
+
+/* _FORTIFY_SOURCE redirects read to __read_chk */
+LIBCAMERA_PUBLIC ssize_t __read_chk(int fd, void *buf, size_t count,
+				    [[maybe_unused]] size_t buflen)
+{
+	return read(fd, buf, count);
+}
+
 }
@@ -41,20 +41,27 @@ void get_symbol(T &func, const char *name)
 } /* namespace */
 
 V4L2CompatManager::V4L2CompatManager()
-	: cm_(nullptr)
+	: cm_(nullptr), slowFds_(0), numMmaps_(0)
 {
+	for (std::atomic<unsigned long> &word : cameraFds_)
+		word.store(0, std::memory_order_relaxed);
+
 	get_symbol(fops_.openat, "openat64");
 	get_symbol(fops_.dup, "dup");
 	get_symbol(fops_.close, "close");
 	get_symbol(fops_.ioctl, "ioctl");
 	get_symbol(fops_.mmap, "mmap64");
 	get_symbol(fops_.munmap, "munmap");
+	get_symbol(fops_.read, "read");
 }
 
 V4L2CompatManager::~V4L2CompatManager()
 {
-	files_.clear();
-	mmaps_.clear();
+	{
+		MutexLocker locker(mutex_);
+		files_.clear();
+		mmaps_.clear();
+	}
 
 	if (cm_) {
 		proxies_.clear();
@@ -98,8 +105,45 @@ V4L2CompatManager *V4L2CompatManager::instance()
 	return &instance;
 }
 
+/*
+ * All the file operations of the process are intercepted, the vast majority of
+ * them on file descriptors unrelated to cameras. Tell them apart with a single
+ * atomic load before taking the lock.
+ */
+bool V4L2CompatManager::isCameraFd(int fd) const
+{
+	if (fd < 0)
+		return false;
+
+	if (static_cast<unsigned int>(fd) >= kFastFds)
+		return slowFds_.load(std::memory_order_acquire) != 0;
+
+	unsigned long word = cameraFds_[fd / kBitsPerWord].load(std::memory_order_acquire);
+	return word & (1UL << (fd % kBitsPerWord));
+}
+
+void V4L2CompatManager::addFile(int fd, std::shared_ptr<V4L2CameraFile> file)
+{
+	MutexLocker locker(mutex_);
+
+	auto [iter, inserted] = files_.insert_or_assign(fd, std::move(file));
+	if (!inserted)
+		return;
+
+	if (static_cast<unsigned int>(fd) >= kFastFds)
+		slowFds_.fetch_add(1, std::memory_order_release);
+	else
+		cameraFds_[fd / kBitsPerWord].fetch_or(1UL << (fd % kBitsPerWord),
+						       std::memory_order_release);
+}
+
 std::shared_ptr<V4L2CameraFile> V4L2CompatManager::cameraFile(int fd)
 {
+	if (!isCameraFd(fd))
+		return nullptr;
+
+	MutexLocker locker(mutex_);
+
 	auto file = files_.find(fd);
 	if (file == files_.end())
 		return nullptr;
@@ -178,9 +222,8 @@ int V4L2CompatManager::openat(int dirfd, const char *path, int oflag, mode_t mod
 		return efd;
 
 	V4L2CameraProxy *proxy = proxies_[ret].get();
-	files_.emplace(efd, std::make_shared<V4L2CameraFile>(dirfd, path, efd,
-							     oflag & O_NONBLOCK,
-							     proxy));
+	addFile(efd, std::make_shared<V4L2CameraFile>(dirfd, path, efd,
+						      oflag & O_NONBLOCK, proxy));
 
 	LOG(V4L2Compat, Debug) << "Opened " << path << " -> fd " << efd;
 	return efd;
@@ -192,18 +235,29 @@ int V4L2CompatManager::dup(int oldfd)
 	if (newfd < 0)
 		return newfd;
 
-	auto file = files_.find(oldfd);
-	if (file != files_.end())
-		files_[newfd] = file->second;
+	std::shared_ptr<V4L2CameraFile> file = cameraFile(oldfd);
+	if (file)
+		addFile(newfd, std::move(file));
 
 	return newfd;
 }
 
 int V4L2CompatManager::close(int fd)
 {
-	auto file = files_.find(fd);
-	if (file != files_.end())
-		files_.erase(file);
+	if (isCameraFd(fd)) {
+		MutexLocker locker(mutex_);
+
+		auto file = files_.find(fd);
+		if (file != files_.end()) {
+			files_.erase(file);
+
+			if (static_cast<unsigned int>(fd) >= kFastFds)
+				slowFds_.fetch_sub(1, std::memory_order_release);
+			else
+				cameraFds_[fd / kBitsPerWord].fetch_and(~(1UL << (fd % kBitsPerWord)),
+									std::memory_order_release);
+		}
+	}
 
 	/* We still need to close the eventfd. */
 	return fops_.close(fd);
@@ -221,23 +275,38 @@ void *V4L2CompatManager::mmap(void *addr, size_t length, int prot, int flags,
 	if (map == MAP_FAILED)
 		return map;
 
-	mmaps_[map] = file;
+	MutexLocker locker(mutex_);
+	if (mmaps_.insert_or_assign(map, file).second)
+		numMmaps_.fetch_add(1, std::memory_order_release);
+
 	return map;
 }
 
 int V4L2CompatManager::munmap(void *addr, size_t length)
 {
-	auto device = mmaps_.find(addr);
-	if (device == mmaps_.end())
+	if (!numMmaps_.load(std::memory_order_acquire))
 		return fops_.munmap(addr, length);
 
-	V4L2CameraFile *file = device->second.get();
+	std::shared_ptr<V4L2CameraFile> file;
 
-	int ret = file->proxy()->munmap(file, addr, length);
+	{
+		MutexLocker locker(mutex_);
+
+		auto device = mmaps_.find(addr);
+		if (device != mmaps_.end())
+			file = device->second;
+	}
+
+	if (!file)
+		return fops_.munmap(addr, length);
+
+	int ret = file->proxy()->munmap(file.get(), addr, length);
 	if (ret < 0)
 		return ret;
 
-	mmaps_.erase(device);
+	MutexLocker locker(mutex_);
+	if (mmaps_.erase(addr))
+		numMmaps_.fetch_sub(1, std::memory_order_release);
 
 	return 0;
 }
@@ -250,3 +319,12 @@ int V4L2CompatManager::ioctl(int fd, unsigned long request, void *arg)
 
 	return file->proxy()->ioctl(file.get(), request, arg);
 }
+
+ssize_t V4L2CompatManager::read(int fd, void *buf, size_t count)
+{
+	std::shared_ptr<V4L2CameraFile> file = cameraFile(fd);
+	if (!file)
+		return fops_.read(fd, buf, count);
+
+	return file->proxy()->read(file.get(), buf, count);
+}
@@ -7,12 +7,17 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <fcntl.h>
+#include <limits.h>
 #include <map>
 #include <memory>
 #include <sys/types.h>
 #include <vector>
 
+#include <libcamera/base/mutex.h>
+
 #include <libcamera/camera_manager.h>
 
 #include "v4l2_camera_proxy.h"
@@ -29,6 +34,7 @@ public:
 		using mmap_func_t = void *(*)(void *addr, size_t length, int prot,
 					      int flags, int fd, off64_t offset);
 		using munmap_func_t = int (*)(void *addr, size_t length);
+		using read_func_t = ssize_t (*)(int fd, void *buf, size_t count);
 
 		openat_func_t openat;
 		dup_func_t dup;
@@ -36,6 +42,7 @@ public:
 		ioctl_func_t ioctl;
 		mmap_func_t mmap;
 		munmap_func_t munmap;
+		read_func_t read;
 	};
 
 	static V4L2CompatManager *instance();
@@ -50,20 +57,40 @@ public:
 		   int fd, off64_t offset);
 	int munmap(void *addr, size_t length);
 	int ioctl(int fd, unsigned long request, void *arg);
+	ssize_t read(int fd, void *buf, size_t count);
 
 private:
 	V4L2CompatManager();
 	~V4L2CompatManager();
 
+	/*
+	 * Camera file descriptors lower than kFastFds are tracked in a bitmap,
+	 * checked without locking. Higher descriptors are counted, and looked
+	 * up in files_ only when at least one exists.
+	 */
+	static constexpr unsigned int kFastFds = 4096;
+	static constexpr unsigned int kBitsPerWord = sizeof(unsigned long) * CHAR_BIT;
+
 	int start();
 	int getCameraIndex(int fd);
-	std::shared_ptr<V4L2CameraFile> cameraFile(int fd);
+	bool isCameraFd(int fd) const;
+	void addFile(int fd, std::shared_ptr<V4L2CameraFile> file)
+		LIBCAMERA_TSA_EXCLUDES(mutex_);
+	std::shared_ptr<V4L2CameraFile> cameraFile(int fd)
+		LIBCAMERA_TSA_EXCLUDES(mutex_);
 
 	FileOperations fops_;
 
 	libcamera::CameraManager *cm_;
 
 	std::vector<std::unique_ptr<V4L2CameraProxy>> proxies_;
-	std::map<int, std::shared_ptr<V4L2CameraFile>> files_;
-	std::map<void *, std::shared_ptr<V4L2CameraFile>> mmaps_;
+	libcamera::Mutex mutex_;
+	std::map<int, std::shared_ptr<V4L2CameraFile>> files_
+		LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	std::map<void *, std::shared_ptr<V4L2CameraFile>> mmaps_
+		LIBCAMERA_TSA_GUARDED_BY(mutex_);
+
+	std::array<std::atomic<unsigned long>, kFastFds / kBitsPerWord> cameraFds_;
+	std::atomic<unsigned int> slowFds_;
+	std::atomic<unsigned int> numMmaps_;
 };
@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * benchmark.cpp - Base class for microbenchmarks
+ */
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+void Benchmark::report(const std::string &name, unsigned int iterations,
+		       unsigned int items, std::vector<double> &samples)
+{
+	std::sort(samples.begin(), samples.end());
+
+	double mean = std::accumulate(samples.begin(), samples.end(), 0.0) /
+		      samples.size();
+	std::string suite = self().substr(self().find_last_of('/') + 1);
+
+	/* The names are controlled by the benchmarks, no escaping is needed. */
+	std::cout << "{\"benchmark\": \"" << suite << "\", "
+		  << "\"case\": \"" << name << "\", "
+		  << "\"iterations\": " << iterations << ", "
+		  << "\"items\": " << items << ", "
+		  << "\"samples\": " << samples.size() << ", "
+		  << "\"min_ns\": " << samples.front() << ", "
+		  << "\"median_ns\": " << samples[samples.size() / 2] << ", "
+		  << "\"mean_ns\": " << mean << ", "
+		  << "\"max_ns\": " << samples.back() << "}"
+		  << std::endl;
+}
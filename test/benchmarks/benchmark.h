@@ -0,0 +1,75 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * benchmark.h - Base class for microbenchmarks
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+/*
+ * Microbenchmarks measure the duration of a function by running it in a loop,
+ * with the number of iterations calibrated to make each sample last long
+ * enough for the clock resolution not to matter. Results are printed to stdout
+ * as one JSON object per line, for consumption by scripts.
+ */
+class Benchmark : public Test
+{
+public:
+	/* Prevent the compiler from optimizing away the computation of value. */
+	template<typename T>
+	static void keep(T &&value)
+	{
+		asm volatile("" : : "g"(&value) : "memory");
+	}
+
+protected:
+	/*
+	 * Measure the duration of func. When each call processes multiple
+	 * items, the results are reported per item.
+	 */
+	template<typename Func>
+	void measure(const std::string &name, Func &&func, unsigned int items = 1)
+	{
+		unsigned int iterations = 1;
+
+		while (iterations < kMaxIterations) {
+			if (sample(func, iterations) >= kMinSampleTime)
+				break;
+			iterations *= 2;
+		}
+
+		std::vector<double> samples;
+		for (unsigned int i = 0; i < kSamples; ++i)
+			samples.push_back(sample(func, iterations) / iterations / items);
+
+		report(name, iterations, items, samples);
+	}
+
+private:
+	static constexpr unsigned int kSamples = 10;
+	static constexpr unsigned int kMaxIterations = 1 << 24;
+	static constexpr double kMinSampleTime = 10e6;
+
+	/* Return the duration of iterations calls to func, in nanoseconds. */
+	template<typename Func>
+	static double sample(Func &func, unsigned int iterations)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		for (unsigned int i = 0; i < iterations; ++i)
+			func();
+
+		auto duration = std::chrono::steady_clock::now() - start;
+		return std::chrono::duration<double, std::nano>(duration).count();
+	}
+
+	void report(const std::string &name, unsigned int iterations,
+		    unsigned int items, std::vector<double> &samples);
+};
@@ -0,0 +1,178 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * controls.cpp - ControlList and ControlSerializer benchmarks
+ */
+
+#include <array>
+#include <iostream>
+#include <stdint.h>
+#include <vector>
+
+#include <libcamera/control_ids.h>
+#include <libcamera/controls.h>
+
+#include "libcamera/internal/byte_stream_buffer.h"
+#include "libcamera/internal/control_serializer.h"
+
+#include "benchmark.h"
+
+using namespace libcamera;
+using namespace std;
+
+class ControlsBenchmark : public Benchmark
+{
+protected:
+	int init() override
+	{
+		infoMap_ = ControlInfoMap({
+			{ &controls::AeEnable, ControlInfo(false, true) },
+			{ &controls::ExposureTime, ControlInfo(1, 1000000) },
+			{ &controls::AnalogueGain, ControlInfo(1.0f, 16.0f) },
+			{ &controls::DigitalGain, ControlInfo(1.0f, 16.0f) },
+			{ &controls::AwbEnable, ControlInfo(false, true) },
+			{ &controls::ColourGains, ControlInfo(0.0f, 32.0f) },
+			{ &controls::ColourTemperature, ControlInfo(2000, 10000) },
+			{ &controls::ColourCorrectionMatrix, ControlInfo(-16.0f, 16.0f) },
+			{ &controls::Brightness, ControlInfo(-1.0f, 1.0f) },
+			{ &controls::Contrast, ControlInfo(0.0f, 32.0f) },
+			{ &controls::Saturation, ControlInfo(0.0f, 32.0f) },
+			{ &controls::Sharpness, ControlInfo(0.0f, 16.0f) },
+			{ &controls::Lux, ControlInfo(0.0f, 100000.0f) },
+			{ &controls::FrameDuration, ControlInfo(INT64_C(1000), INT64_C(1000000000)) },
+			{ &controls::SensorTimestamp, ControlInfo(INT64_C(0), INT64_MAX) },
+			{ &controls::ScalerCrop, ControlInfo(Rectangle{}, Rectangle(0, 0, 4096, 3072)) },
+		}, controls::controls);
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		/* A typical request, with a few controls set by the application. */
+		ControlList request(infoMap_);
+		request.set(controls::AeEnable, false);
+		request.set(controls::ExposureTime, 10000);
+		request.set(controls::AnalogueGain, 2.0f);
+		request.set(controls::Brightness, 0.1f);
+
+		/* Typical per-frame metadata, including array controls. */
+		ControlList metadata(infoMap_);
+		metadata.set(controls::ExposureTime, 10000);
+		metadata.set(controls::AnalogueGain, 2.0f);
+		metadata.set(controls::DigitalGain, 1.0f);
+		metadata.set(controls::ColourGains, { 1.5f, 2.0f });
+		metadata.set(controls::ColourTemperature, 4500);
+		metadata.set(controls::ColourCorrectionMatrix,
+			     { 1.6f, -0.4f, -0.2f, -0.3f, 1.5f, -0.2f, 0.0f, -0.6f, 1.6f });
+		metadata.set(controls::Lux, 400.0f);
+		metadata.set(controls::FrameDuration, INT64_C(33333));
+		metadata.set(controls::SensorTimestamp, INT64_C(123456789000));
+		metadata.set(controls::ScalerCrop, Rectangle(0, 0, 4096, 3072));
+
+		measure("ControlList.set.scalar", [&]() {
+			request.set(controls::ExposureTime, 20000);
+		});
+
+		measure("ControlList.set.array", [&]() {
+			metadata.set(controls::ColourGains, { 1.6f, 1.9f });
+		});
+
+		measure("ControlList.get.scalar", [&]() {
+			keep(metadata.get(controls::ExposureTime));
+		});
+
+		measure("ControlList.get.array", [&]() {
+			keep(metadata.get(controls::ColourCorrectionMatrix));
+		});
+
+		measure("ControlList.get.missing", [&]() {
+			keep(request.get(controls::Sharpness));
+		});
+
+		measure("ControlList.build", [&]() {
+			ControlList list(infoMap_);
+			list.set(controls::AeEnable, false);
+			list.set(controls::ExposureTime, 10000);
+			list.set(controls::AnalogueGain, 2.0f);
+			list.set(controls::Brightness, 0.1f);
+			keep(list);
+		});
+
+		measure("ControlList.copy", [&]() {
+			ControlList list(metadata);
+			keep(list);
+		});
+
+		measure("ControlList.merge", [&]() {
+			ControlList list(request);
+			list.merge(metadata);
+			keep(list);
+		});
+
+		return serialization(request, metadata);
+	}
+
+private:
+	int serialization(const ControlList &request, const ControlList &metadata)
+	{
+		ControlSerializer serializer(ControlSerializer::Role::Proxy);
+		ControlSerializer deserializer(ControlSerializer::Role::Worker);
+
+		/* Lists can only be serialized after their info map. */
+		vector<uint8_t> infoData(ControlSerializer::binarySize(infoMap_));
+		ByteStreamBuffer infoBuffer(infoData.data(), infoData.size());
+		if (serializer.serialize(infoMap_, infoBuffer) < 0) {
+			cerr << "Failed to serialize ControlInfoMap" << endl;
+			return TestFail;
+		}
+
+		ByteStreamBuffer infoIn(const_cast<const uint8_t *>(infoData.data()),
+					infoData.size());
+		if (deserializer.deserialize<ControlInfoMap>(infoIn).empty()) {
+			cerr << "Failed to deserialize ControlInfoMap" << endl;
+			return TestFail;
+		}
+
+		measure("ControlSerializer.binarySize", [&]() {
+			keep(ControlSerializer::binarySize(metadata));
+		});
+
+		const array<pair<const char *, const ControlList *>, 2> lists = { {
+			{ "request", &request },
+			{ "metadata", &metadata },
+		} };
+
+		for (const auto &entry : lists) {
+			const string name = entry.first;
+			const ControlList *list = entry.second;
+			vector<uint8_t> data(ControlSerializer::binarySize(*list));
+
+			measure("ControlSerializer.serialize." + name, [&]() {
+				ByteStreamBuffer buffer(data.data(), data.size());
+				keep(serializer.serialize(*list, buffer));
+			});
+
+			ByteStreamBuffer check(const_cast<const uint8_t *>(data.data()),
+					       data.size());
+			if (deserializer.deserialize<ControlList>(check).size() != list->size()) {
+				cerr << "Failed to deserialize " << name << " ControlList"
+				     << endl;
+				return TestFail;
+			}
+
+			measure("ControlSerializer.deserialize." + name, [&]() {
+				ByteStreamBuffer buffer(const_cast<const uint8_t *>(data.data()),
+							data.size());
+				keep(deserializer.deserialize<ControlList>(buffer));
+			});
+		}
+
+		return TestPass;
+	}
+
+	ControlInfoMap infoMap_;
+};
+
+TEST_REGISTER(ControlsBenchmark)
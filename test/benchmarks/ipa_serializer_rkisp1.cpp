@@ -0,0 +1,127 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * ipa_serializer_rkisp1.cpp - RkISP1 IPA data serializer benchmarks
+ */
+
+#include <iostream>
+#include <stdint.h>
+#include <tuple>
+#include <vector>
+
+#include <libcamera/control_ids.h>
+#include <libcamera/controls.h>
+
+#include <libcamera/ipa/core_ipa_interface.h>
+#include <libcamera/ipa/rkisp1_ipa_interface.h>
+#include <libcamera/ipa/rkisp1_ipa_serializer.h>
+
+#include "libcamera/internal/control_serializer.h"
+#include "libcamera/internal/ipa_data_serializer.h"
+
+#include "benchmark.h"
+
+using namespace libcamera;
+using namespace std;
+
+class IPASerializerRkISP1Benchmark : public Benchmark
+{
+protected:
+	int run() override
+	{
+		IPACameraSensorInfo sensorInfo;
+		sensorInfo.model = "imx219";
+		sensorInfo.bitsPerPixel = 10;
+		sensorInfo.cfaPattern = 0;
+		sensorInfo.activeAreaSize = { 3280, 2464 };
+		sensorInfo.analogCrop = { 0, 0, 3280, 2464 };
+		sensorInfo.outputSize = { 1640, 1232 };
+		sensorInfo.pixelRate = 182400000;
+		sensorInfo.minLineLength = 3448;
+		sensorInfo.maxLineLength = 32767;
+		sensorInfo.minFrameLength = 1320;
+		sensorInfo.maxFrameLength = 65535;
+
+		ControlInfoMap sensorControls({
+			{ &controls::ExposureTime, ControlInfo(1, 1000000) },
+			{ &controls::AnalogueGain, ControlInfo(1.0f, 16.0f) },
+			{ &controls::FrameDuration, ControlInfo(INT64_C(1000), INT64_C(1000000000)) },
+		}, controls::controls);
+
+		/*
+		 * The configure() parameters include a ControlInfoMap, which is
+		 * only serialized once by a ControlSerializer. Measure with a
+		 * new serializer for each call, as at configuration time.
+		 */
+		ipa::rkisp1::IPAConfigInfo configInfo(sensorInfo, sensorControls);
+
+		measure("IPAConfigInfo.serialize", [&]() {
+			ControlSerializer serializer(ControlSerializer::Role::Proxy);
+			keep(IPADataSerializer<ipa::rkisp1::IPAConfigInfo>::serialize(configInfo, &serializer));
+		});
+
+		vector<uint8_t> data;
+		vector<SharedFD> fds;
+		{
+			ControlSerializer serializer(ControlSerializer::Role::Proxy);
+			tie(data, fds) = IPADataSerializer<ipa::rkisp1::IPAConfigInfo>::serialize(configInfo,
+												    &serializer);
+		}
+
+		measure("IPAConfigInfo.deserialize", [&]() {
+			ControlSerializer deserializer(ControlSerializer::Role::Worker);
+			keep(IPADataSerializer<ipa::rkisp1::IPAConfigInfo>::deserialize(data, fds,
+											 &deserializer));
+		});
+
+		measure("IPACameraSensorInfo.serialize", [&]() {
+			keep(IPADataSerializer<IPACameraSensorInfo>::serialize(sensorInfo));
+		});
+
+		tie(data, fds) = IPADataSerializer<IPACameraSensorInfo>::serialize(sensorInfo);
+		if (data.empty()) {
+			cerr << "Failed to serialize IPACameraSensorInfo" << endl;
+			return TestFail;
+		}
+
+		measure("IPACameraSensorInfo.deserialize", [&]() {
+			keep(IPADataSerializer<IPACameraSensorInfo>::deserialize(data, fds));
+		});
+
+		/*
+		 * Per-frame calls take a frame number and a ControlList, which
+		 * the proxy serializes as individual parameters.
+		 */
+		ControlSerializer serializer(ControlSerializer::Role::Proxy);
+		ControlSerializer deserializer(ControlSerializer::Role::Worker);
+
+		ControlList metadata(controls::controls);
+		metadata.set(controls::ExposureTime, 10000);
+		metadata.set(controls::AnalogueGain, 2.0f);
+		metadata.set(controls::ColourGains, { 1.5f, 2.0f });
+		metadata.set(controls::ColourTemperature, 4500);
+		metadata.set(controls::Lux, 400.0f);
+		metadata.set(controls::FrameDuration, INT64_C(33333));
+
+		measure("metadataReady.serialize", [&]() {
+			vector<uint8_t> buffer;
+			vector<SharedFD> bufferFds;
+			IPADataSerializer<uint32_t>::serialize(42, buffer, bufferFds);
+			IPADataSerializer<ControlList>::serialize(metadata, buffer, bufferFds,
+								  &serializer);
+			keep(buffer);
+		});
+
+		vector<uint8_t> list;
+		IPADataSerializer<ControlList>::serialize(metadata, list, fds, &serializer);
+
+		measure("metadataReady.deserialize", [&]() {
+			keep(IPADataSerializer<ControlList>::deserialize(list, &deserializer));
+		});
+
+		return TestPass;
+	}
+};
+
+TEST_REGISTER(IPASerializerRkISP1Benchmark)
@@ -0,0 +1,102 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * ipa_serializer_rpi.cpp - Raspberry Pi IPA data serializer benchmarks
+ */
+
+#include <iostream>
+#include <stdint.h>
+#include <tuple>
+#include <vector>
+
+#include <libcamera/control_ids.h>
+#include <libcamera/controls.h>
+#include <libcamera/geometry.h>
+
+#include <libcamera/ipa/raspberrypi_ipa_interface.h>
+#include <libcamera/ipa/raspberrypi_ipa_serializer.h>
+
+#include "libcamera/internal/control_serializer.h"
+#include "libcamera/internal/ipa_data_serializer.h"
+
+#include "benchmark.h"
+
+using namespace libcamera;
+using namespace std;
+
+class IPASerializerRPiBenchmark : public Benchmark
+{
+protected:
+	int run() override
+	{
+		ControlSerializer serializer(ControlSerializer::Role::Proxy);
+		ControlSerializer deserializer(ControlSerializer::Role::Worker);
+
+		/*
+		 * The parameters of prepareIsp(), sent for every frame. Lists
+		 * without a ControlInfoMap don't require serializing the map
+		 * first, the contents matter less than the size here.
+		 */
+		ipa::RPi::PrepareParams prepare;
+		prepare.buffers = { 1, 2, 3 };
+		prepare.ipaContext = 4;
+		prepare.delayContext = 3;
+
+		prepare.sensorControls = ControlList(controls::controls);
+		prepare.sensorControls.set(controls::ExposureTime, 10000);
+		prepare.sensorControls.set(controls::AnalogueGain, 2.0f);
+		prepare.sensorControls.set(controls::FrameDuration, INT64_C(33333));
+
+		prepare.requestControls = ControlList(controls::controls);
+		prepare.requestControls.set(controls::AeEnable, true);
+		prepare.requestControls.set(controls::AwbEnable, true);
+		prepare.requestControls.set(controls::Brightness, 0.1f);
+		prepare.requestControls.set(controls::ScalerCrop, Rectangle(0, 0, 4056, 3040));
+
+		if (benchmark("PrepareParams", prepare, serializer, deserializer))
+			return TestFail;
+
+		/* The parameters of processStats(), sent for every frame. */
+		ipa::RPi::ProcessParams process;
+		process.buffers = { 1, 2, 3 };
+		process.ipaContext = 4;
+
+		if (benchmark("ProcessParams", process, serializer, deserializer))
+			return TestFail;
+
+		/* The buffer ids of prepareIspComplete(), sent for every frame. */
+		ipa::RPi::BufferIds buffers = { 1, 2, 3 };
+
+		if (benchmark("BufferIds", buffers, serializer, deserializer))
+			return TestFail;
+
+		return TestPass;
+	}
+
+private:
+	template<typename T>
+	int benchmark(const string &name, const T &params,
+		      ControlSerializer &serializer, ControlSerializer &deserializer)
+	{
+		measure(name + ".serialize", [&]() {
+			keep(IPADataSerializer<T>::serialize(params, &serializer));
+		});
+
+		vector<uint8_t> data;
+		vector<SharedFD> fds;
+		tie(data, fds) = IPADataSerializer<T>::serialize(params, &serializer);
+		if (data.empty()) {
+			cerr << "Failed to serialize " << name << endl;
+			return TestFail;
+		}
+
+		measure(name + ".deserialize", [&]() {
+			keep(IPADataSerializer<T>::deserialize(data, fds, &deserializer));
+		});
+
+		return TestPass;
+	}
+};
+
+TEST_REGISTER(IPASerializerRPiBenchmark)
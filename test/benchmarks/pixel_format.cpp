@@ -0,0 +1,81 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * pixel_format.cpp - PixelFormatInfo lookup benchmarks
+ */
+
+#include <iostream>
+#include <string>
+
+#include <libcamera/formats.h>
+#include <libcamera/geometry.h>
+#include <libcamera/pixel_format.h>
+
+#include "libcamera/internal/formats.h"
+#include "libcamera/internal/v4l2_pixelformat.h"
+
+#include "benchmark.h"
+
+using namespace libcamera;
+using namespace std;
+
+class PixelFormatBenchmark : public Benchmark
+{
+protected:
+	int run() override
+	{
+		/*
+		 * Look up formats near the beginning and the end of the
+		 * formats table, to expose lookups that scale with its size.
+		 */
+		const PixelFormat formats[] = {
+			formats::RGB565,
+			formats::NV12,
+			formats::SRGGB10_CSI2P,
+			formats::MJPEG,
+		};
+
+		for (const PixelFormat &format : formats) {
+			const PixelFormatInfo &info = PixelFormatInfo::info(format);
+			if (!info.isValid()) {
+				cerr << "Unknown format " << format << endl;
+				return TestFail;
+			}
+
+			const string name = info.name;
+			const V4L2PixelFormat v4l2Format = info.v4l2Formats[0];
+
+			measure("PixelFormatInfo.info.PixelFormat." + name, [&]() {
+				keep(PixelFormatInfo::info(format));
+			});
+
+			measure("PixelFormatInfo.info.V4L2PixelFormat." + name, [&]() {
+				keep(PixelFormatInfo::info(v4l2Format));
+			});
+
+			measure("PixelFormatInfo.info.name." + name, [&]() {
+				keep(PixelFormatInfo::info(name));
+			});
+
+			measure("PixelFormat.fromString." + name, [&]() {
+				keep(PixelFormat::fromString(name));
+			});
+
+			measure("PixelFormatInfo.frameSize." + name, [&]() {
+				keep(PixelFormatInfo::info(format).frameSize(Size(1920, 1080)));
+			});
+		}
+
+		/* Unknown PixelFormat lookups log a warning, use V4L2 formats. */
+		const V4L2PixelFormat invalid(0xdeadbeef);
+
+		measure("PixelFormatInfo.info.V4L2PixelFormat.invalid", [&]() {
+			keep(PixelFormatInfo::info(invalid));
+		});
+
+		return TestPass;
+	}
+};
+
+TEST_REGISTER(PixelFormatBenchmark)
@@ -0,0 +1,135 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * signal.cpp - Signal emission benchmarks
+ */
+
+#include <libcamera/base/object.h>
+#include <libcamera/base/semaphore.h>
+#include <libcamera/base/signal.h>
+#include <libcamera/base/thread.h>
+
+#include "benchmark.h"
+
+using namespace libcamera;
+using namespace std;
+
+class Receiver
+{
+public:
+	void slot(int value) { sum_ += value; }
+
+	int sum_ = 0;
+};
+
+class ObjectReceiver : public Object
+{
+public:
+	ObjectReceiver(Semaphore *semaphore = nullptr)
+		: semaphore_(semaphore)
+	{
+	}
+
+	void slot(int value)
+	{
+		sum_ += value;
+		if (semaphore_)
+			semaphore_->release();
+	}
+
+	int sum_ = 0;
+
+private:
+	Semaphore *semaphore_;
+};
+
+class SignalBenchmark : public Benchmark
+{
+protected:
+	int run() override
+	{
+		/* Direct connections, with slots called synchronously. */
+		{
+			Signal<int> signal;
+			Receiver receiver;
+			signal.connect(&receiver, &Receiver::slot);
+
+			measure("Signal.emit.direct", [&]() {
+				signal.emit(1);
+			});
+		}
+
+		{
+			Signal<int> signal;
+			ObjectReceiver receiver;
+			signal.connect(&receiver, &ObjectReceiver::slot);
+
+			measure("Signal.emit.direct.Object", [&]() {
+				signal.emit(1);
+			});
+		}
+
+		{
+			Signal<int> signal;
+			Receiver receivers[4];
+			for (Receiver &receiver : receivers)
+				signal.connect(&receiver, &Receiver::slot);
+
+			measure("Signal.emit.direct.4slots", [&]() {
+				signal.emit(1);
+			}, 4);
+		}
+
+		{
+			Signal<int> signal;
+			int sum = 0;
+			Receiver receiver;
+			signal.connect(&receiver, [&](int value) { sum += value; });
+
+			measure("Signal.emit.direct.functor", [&]() {
+				signal.emit(1);
+			});
+
+			keep(sum);
+		}
+
+		/*
+		 * Queued connections, with slots called in the receiver
+		 * thread. Emit signals in batches and wait for all of them to
+		 * be delivered, to measure the throughput without growing the
+		 * message queue. A batch of one measures the latency.
+		 */
+		Semaphore semaphore;
+		ObjectReceiver *receiver = new ObjectReceiver(&semaphore);
+		Thread thread;
+
+		receiver->moveToThread(&thread);
+		thread.start();
+
+		Signal<int> signal;
+		signal.connect(receiver, &ObjectReceiver::slot);
+
+		measure("Signal.emit.queued.latency", [&]() {
+			signal.emit(1);
+			semaphore.acquire();
+		});
+
+		static constexpr unsigned int kBatch = 64;
+
+		measure("Signal.emit.queued.throughput", [&]() {
+			for (unsigned int i = 0; i < kBatch; ++i)
+				signal.emit(1);
+			semaphore.acquire(kBatch);
+		}, kBatch);
+
+		signal.disconnect();
+		receiver->deleteLater();
+		thread.exit(0);
+		thread.wait();
+
+		return TestPass;
+	}
+};
+
+TEST_REGISTER(SignalBenchmark)
@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * thread.cpp - Thread message posting benchmarks
+ */
+
+#include <memory>
+
+#include <libcamera/base/message.h>
+#include <libcamera/base/object.h>
+#include <libcamera/base/semaphore.h>
+#include <libcamera/base/thread.h>
+
+#include "benchmark.h"
+
+using namespace libcamera;
+using namespace std;
+
+class MessageReceiver : public Object
+{
+public:
+	MessageReceiver(Semaphore *semaphore = nullptr)
+		: count_(0), semaphore_(semaphore)
+	{
+	}
+
+	unsigned int call(unsigned int value)
+	{
+		return value + 1;
+	}
+
+	unsigned int count_;
+
+protected:
+	void message(Message *msg) override
+	{
+		if (msg->type() != Message::None) {
+			Object::message(msg);
+			return;
+		}
+
+		count_++;
+		if (semaphore_)
+			semaphore_->release();
+	}
+
+private:
+	Semaphore *semaphore_;
+};
+
+class ThreadBenchmark : public Benchmark
+{
+protected:
+	int run() override
+	{
+		/* Messages posted to and dispatched in the current thread. */
+		{
+			MessageReceiver receiver;
+
+			measure("Thread.postMessage.local", [&]() {
+				receiver.postMessage(make_unique<Message>(Message::None));
+				Thread::current()->dispatchMessages(Message::None);
+			});
+
+			if (!receiver.count_)
+				return TestFail;
+		}
+
+		/* Messages posted to another thread. */
+		Semaphore semaphore;
+		MessageReceiver *receiver = new MessageReceiver(&semaphore);
+		Thread thread;
+
+		receiver->moveToThread(&thread);
+		thread.start();
+
+		measure("Thread.postMessage.latency", [&]() {
+			receiver->postMessage(make_unique<Message>(Message::None));
+			semaphore.acquire();
+		});
+
+		static constexpr unsigned int kBatch = 64;
+
+		measure("Thread.postMessage.throughput", [&]() {
+			for (unsigned int i = 0; i < kBatch; ++i)
+				receiver->postMessage(make_unique<Message>(Message::None));
+			semaphore.acquire(kBatch);
+		}, kBatch);
+
+		/* Synchronous cross-thread calls, as used by IPA threads. */
+		measure("Object.invokeMethod.blocking", [&]() {
+			keep(receiver->invokeMethod(&MessageReceiver::call,
+						    ConnectionTypeBlocking, 1u));
+		});
+
+		receiver->deleteLater();
+		thread.exit(0);
+		thread.wait();
+
+		return TestPass;
+	}
+};
+
+TEST_REGISTER(ThreadBenchmark)
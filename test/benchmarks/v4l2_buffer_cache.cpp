@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * v4l2_buffer_cache.cpp - V4L2BufferCache benchmarks
+ */
+
+#include <iostream>
+#include <memory>
+#include <string.h>
+#include <sys/mman.h>
+#include <vector>
+
+#include <libcamera/base/shared_fd.h>
+#include <libcamera/base/unique_fd.h>
+
+#include <libcamera/framebuffer.h>
+
+#include "libcamera/internal/v4l2_videodevice.h"
+
+#include "benchmark.h"
+
+using namespace libcamera;
+using namespace std;
+
+class V4L2BufferCacheBenchmark : public Benchmark
+{
+protected:
+	int init() override
+	{
+		/*
+		 * The cache identifies buffers by the inode of their planes'
+		 * file descriptors, back them with memfds instead of dmabufs
+		 * to avoid depending on a video device.
+		 */
+		for (unsigned int i = 0; i < kNumBuffers * 2; ++i) {
+			UniqueFD fd(memfd_create("v4l2-buffer-cache", MFD_CLOEXEC));
+			if (!fd.isValid()) {
+				cerr << "Failed to create memfd: "
+				     << strerror(errno) << endl;
+				return TestFail;
+			}
+
+			SharedFD sharedFd(std::move(fd));
+			vector<FrameBuffer::Plane> planes(2);
+			planes[0].fd = sharedFd;
+			planes[0].offset = 0;
+			planes[0].length = 1920 * 1080;
+			planes[1].fd = sharedFd;
+			planes[1].offset = 1920 * 1080;
+			planes[1].length = 1920 * 1080 / 2;
+
+			buffers_.push_back(make_unique<FrameBuffer>(planes));
+		}
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		/*
+		 * With as many buffers as cache entries, every lookup after
+		 * the first cycle hits the cache.
+		 */
+		V4L2BufferCache hitCache(kNumBuffers);
+		unsigned int next = 0;
+
+		measure("V4L2BufferCache.get_put.hit", [&]() {
+			int index = hitCache.get(*buffers_[next]);
+			hitCache.put(index);
+			next = (next + 1) % kNumBuffers;
+		});
+
+		if (hitCache.misses() != kNumBuffers) {
+			cerr << "Unexpected cache misses: " << hitCache.misses()
+			     << endl;
+			return TestFail;
+		}
+
+		/*
+		 * With twice as many buffers as cache entries, cycled in
+		 * order, every lookup misses and evicts an entry.
+		 */
+		V4L2BufferCache missCache(kNumBuffers);
+		next = 0;
+
+		measure("V4L2BufferCache.get_put.miss", [&]() {
+			int index = missCache.get(*buffers_[next]);
+			missCache.put(index);
+			next = (next + 1) % buffers_.size();
+		});
+
+		if (missCache.hits()) {
+			cerr << "Unexpected cache hits: " << missCache.hits()
+			     << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+private:
+	static constexpr unsigned int kNumBuffers = 8;
+
+	vector<unique_ptr<FrameBuffer>> buffers_;
+};
+
+TEST_REGISTER(V4L2BufferCacheBenchmark)
@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * yaml_parser.cpp - YamlParser benchmarks on the IPA tuning files
+ */
+
+#include <algorithm>
+#include <dirent.h>
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include <libcamera/base/file.h>
+#include <libcamera/base/utils.h>
+
+#include "libcamera/internal/yaml_parser.h"
+
+#include "benchmark.h"
+
+using namespace libcamera;
+using namespace std;
+
+class YamlParserBenchmark : public Benchmark
+{
+protected:
+	int init() override
+	{
+		/* Measure parsing, not the parsed object cache. */
+		unsetenv("LIBCAMERA_CACHE_DIR");
+
+		const string root = utils::libcameraSourcePath();
+		if (root.empty()) {
+			cerr << "Tuning files are only available in the source tree"
+			     << endl;
+			return TestSkip;
+		}
+
+		static const vector<pair<string, string>> dataDirs = {
+			{ "ipu3", "src/ipa/ipu3/data" },
+			{ "rkisp1", "src/ipa/rkisp1/data" },
+			{ "rpi.vc4", "src/ipa/rpi/vc4/data" },
+			{ "rpi.pisp", "src/ipa/rpi/pisp/data" },
+		};
+
+		for (const auto &[name, dir] : dataDirs) {
+			vector<string> files = listFiles(root + dir);
+			if (!files.empty())
+				dataDirs_.emplace_back(name, std::move(files));
+		}
+
+		if (dataDirs_.empty()) {
+			cerr << "No tuning files found" << endl;
+			return TestSkip;
+		}
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		for (const auto &[name, files] : dataDirs_) {
+			for (const string &path : files) {
+				if (!parse(path)) {
+					cerr << "Failed to parse " << path << endl;
+					return TestFail;
+				}
+			}
+
+			const vector<string> &paths = files;
+
+			measure("YamlParser.parse." + name, [&]() {
+				for (const string &path : paths)
+					keep(parse(path));
+			}, paths.size());
+		}
+
+		return TestPass;
+	}
+
+private:
+	static unique_ptr<YamlObject> parse(const string &path)
+	{
+		File file(path);
+		if (!file.open(File::OpenModeFlag::ReadOnly))
+			return nullptr;
+
+		return YamlParser::parse(file);
+	}
+
+	static vector<string> listFiles(const string &dirname)
+	{
+		vector<string> files;
+
+		DIR *dir = opendir(dirname.c_str());
+		if (!dir)
+			return files;
+
+		struct dirent *ent;
+		while ((ent = readdir(dir))) {
+			string name = ent->d_name;
+			size_t pos = name.rfind('.');
+			if (pos == string::npos)
+				continue;
+
+			string extension = name.substr(pos);
+			if (extension != ".yaml" && extension != ".json")
+				continue;
+
+			files.push_back(dirname + "/" + name);
+		}
+
+		closedir(dir);
+
+		sort(files.begin(), files.end());
+		return files;
+	}
+
+	vector<pair<string, vector<string>>> dataDirs_;
+};
+
+TEST_REGISTER(YamlParserBenchmark)
@@ -89,6 +89,26 @@ protected:
 			return TestFail;
 		}
 
+		Span<const CameraSensor::Mode> modes =
+			sensor_->modes(MEDIA_BUS_FMT_SBGGR10_1X10);
+		if (modes.empty()) {
+			cerr << "No mode found for SBGGR10_1X10" << endl;
+			return TestFail;
+		}
+
+		for (const CameraSensor::Mode &mode : modes) {
+			if (mode.mbusCode != MEDIA_BUS_FMT_SBGGR10_1X10 ||
+			    mode.bitDepth != 10) {
+				cerr << "Invalid mode for SBGGR10_1X10" << endl;
+				return TestFail;
+			}
+		}
+
+		if (sensor_->modes(0xdeadbeef).size()) {
+			cerr << "Unexpected modes for invalid media bus code" << endl;
+			return TestFail;
+		}
+
 		const Size &resolution = sensor_->resolution();
 		if (resolution != Size(4096, 2160)) {
 			cerr << "Incorrect sensor resolution " << resolution << endl;
@@ -0,0 +1,195 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * camera_group.cpp - Test synchronized capture with a camera group
+ */
+
+#include <iostream>
+
+#include <libcamera/camera_group.h>
+#include <libcamera/framebuffer_allocator.h>
+
+#include <libcamera/base/event_dispatcher.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/timer.h>
+
+#include "camera_test.h"
+#include "test.h"
+
+using namespace libcamera;
+using namespace std;
+using namespace std::chrono_literals;
+
+namespace {
+
+class CameraGroupTest : public CameraTest, public Test
+{
+public:
+	CameraGroupTest()
+		: CameraTest("platform/vimc.0 Sensor B")
+	{
+	}
+
+protected:
+	void requestsComplete(const std::vector<Request *> &requests)
+	{
+		if (requests.size() != 1) {
+			invalidCompletions_++;
+			return;
+		}
+
+		Request *request = requests.front();
+		if (request->status() != Request::RequestComplete)
+			return;
+
+		if (CameraGroup::timestampSkew(requests) != 0)
+			invalidCompletions_++;
+
+		completeRequestsCount_++;
+
+		const Stream *stream = request->buffers().begin()->first;
+		FrameBuffer *buffer = request->buffers().begin()->second;
+
+		request->reuse();
+		request->addBuffer(stream, buffer);
+		group_->queueRequests({ &request, 1 });
+	}
+
+	int init() override
+	{
+		if (status_ != TestPass)
+			return status_;
+
+		config_ = camera_->generateConfiguration({ StreamRole::VideoRecording });
+		if (!config_ || config_->size() != 1) {
+			cout << "Failed to generate default configuration" << endl;
+			return TestFail;
+		}
+
+		allocator_ = make_unique<FrameBufferAllocator>(camera_);
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		/* Invalid groups must be rejected. */
+		if (cm_->createGroup({})) {
+			cout << "Empty camera group created" << endl;
+			return TestFail;
+		}
+
+		if (cm_->createGroup({ camera_, camera_ })) {
+			cout << "Camera group with duplicated cameras created" << endl;
+			return TestFail;
+		}
+
+		group_ = cm_->createGroup({ camera_ });
+		if (!group_ || group_->cameras().size() != 1) {
+			cout << "Failed to create camera group" << endl;
+			return TestFail;
+		}
+
+		if (camera_->acquire()) {
+			cout << "Failed to acquire the camera" << endl;
+			return TestFail;
+		}
+
+		if (camera_->configure(config_.get())) {
+			cout << "Failed to set default configuration" << endl;
+			return TestFail;
+		}
+
+		Stream *stream = config_->at(0).stream();
+
+		if (allocator_->allocate(stream) < 0)
+			return TestFail;
+
+		for (const std::unique_ptr<FrameBuffer> &buffer : allocator_->buffers(stream)) {
+			std::unique_ptr<Request> request = camera_->createRequest();
+			if (!request || request->addBuffer(stream, buffer.get())) {
+				cout << "Failed to create request" << endl;
+				return TestFail;
+			}
+
+			requests_.push_back(std::move(request));
+		}
+
+		/* Queuing requests to a stopped group must fail. */
+		Request *request = requests_.front().get();
+		if (!group_->queueRequests({ &request, 1 })) {
+			cout << "Requests queued to a stopped group" << endl;
+			return TestFail;
+		}
+
+		group_->requestsCompleted.connect(this, &CameraGroupTest::requestsComplete);
+
+		if (group_->start()) {
+			cout << "Failed to start camera group" << endl;
+			return TestFail;
+		}
+
+		/* The number of requests must match the number of cameras. */
+		Request *pair[] = { requests_[0].get(), requests_[1].get() };
+		if (!group_->queueRequests(pair)) {
+			cout << "Mismatched number of requests queued" << endl;
+			return TestFail;
+		}
+
+		for (std::unique_ptr<Request> &req : requests_) {
+			request = req.get();
+			if (group_->queueRequests({ &request, 1 })) {
+				cout << "Failed to queue requests" << endl;
+				return TestFail;
+			}
+		}
+
+		EventDispatcher *dispatcher = Thread::current()->eventDispatcher();
+
+		Timer timer;
+		timer.start(1000ms);
+		while (timer.isRunning())
+			dispatcher->processEvents();
+
+		unsigned int nbuffers = allocator_->buffers(stream).size();
+
+		if (completeRequestsCount_ < nbuffers * 2) {
+			cout << "Failed to capture enough frames (got "
+			     << completeRequestsCount_ << " expected at least "
+			     << nbuffers * 2 << ")" << endl;
+			return TestFail;
+		}
+
+		if (invalidCompletions_) {
+			cout << "Invalid group completions" << endl;
+			return TestFail;
+		}
+
+		if (group_->stop()) {
+			cout << "Failed to stop camera group" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	void cleanup() override
+	{
+		group_.reset();
+		requests_.clear();
+		allocator_.reset();
+	}
+
+	std::unique_ptr<CameraConfiguration> config_;
+	std::unique_ptr<FrameBufferAllocator> allocator_;
+	std::unique_ptr<CameraGroup> group_;
+	std::vector<std::unique_ptr<Request>> requests_;
+
+	unsigned int completeRequestsCount_ = 0;
+	unsigned int invalidCompletions_ = 0;
+};
+
+} /* namespace */
+
+TEST_REGISTER(CameraGroupTest)
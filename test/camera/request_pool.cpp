@@ -0,0 +1,213 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * request_pool.cpp - Test the request pool
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include <libcamera/framebuffer_allocator.h>
+#include <libcamera/request_pool.h>
+
+#include <libcamera/base/event_dispatcher.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/timer.h>
+
+#include "camera_test.h"
+#include "test.h"
+
+using namespace libcamera;
+using namespace std;
+using namespace std::chrono_literals;
+
+/* Count the allocations performed by the current thread. */
+static thread_local unsigned int allocations = 0;
+
+void *operator new(size_t size)
+{
+	allocations++;
+
+	void *ptr = malloc(size ? size : 1);
+	if (!ptr)
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, [[maybe_unused]] size_t size) noexcept
+{
+	free(ptr);
+}
+
+namespace {
+
+class RequestPoolTest : public CameraTest, public Test
+{
+public:
+	RequestPoolTest()
+		: CameraTest("platform/vimc.0 Sensor B")
+	{
+	}
+
+protected:
+	void requestComplete(Request *request)
+	{
+		pool_->release(request);
+
+		if (request->status() != Request::RequestComplete)
+			return;
+
+		completeRequestsCount_++;
+
+		Request *next = pool_->acquire();
+		if (next)
+			camera_->queueRequest(next);
+	}
+
+	int init() override
+	{
+		if (status_ != TestPass)
+			return status_;
+
+		config_ = camera_->generateConfiguration({ StreamRole::VideoRecording });
+		if (!config_ || config_->size() != 1) {
+			cout << "Failed to generate default configuration" << endl;
+			return TestFail;
+		}
+
+		allocator_ = make_unique<FrameBufferAllocator>(camera_);
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		if (camera_->acquire()) {
+			cout << "Failed to acquire the camera" << endl;
+			return TestFail;
+		}
+
+		if (camera_->configure(config_.get())) {
+			cout << "Failed to set default configuration" << endl;
+			return TestFail;
+		}
+
+		Stream *stream = config_->at(0).stream();
+		if (allocator_->allocate(stream) < 0)
+			return TestFail;
+
+		std::map<const Stream *, std::vector<FrameBuffer *>> buffers;
+		for (const std::unique_ptr<FrameBuffer> &buffer : allocator_->buffers(stream))
+			buffers[stream].push_back(buffer.get());
+
+		pool_ = camera_->createRequestPool(buffers);
+		if (!pool_ || pool_->size() != buffers[stream].size()) {
+			cout << "Failed to create request pool" << endl;
+			return TestFail;
+		}
+
+		/* All requests must be bound to their buffer. */
+		for (unsigned int i = 0; i < pool_->size(); ++i) {
+			Request *request = pool_->requests()[i].get();
+			if (request->cookie() != i ||
+			    request->findBuffer(stream) != buffers[stream][i]) {
+				cout << "Invalid request " << i << " in pool" << endl;
+				return TestFail;
+			}
+		}
+
+		/* Recycling requests must not allocate memory. */
+		std::vector<Request *> requests;
+		requests.reserve(pool_->size());
+
+		unsigned int count = allocations;
+
+		for (unsigned int iter = 0; iter < 100; ++iter) {
+			while (Request *request = pool_->acquire())
+				requests.push_back(request);
+
+			for (Request *request : requests)
+				pool_->release(request);
+
+			requests.clear();
+		}
+
+		if (allocations != count) {
+			cout << "Request recycling performed "
+			     << allocations - count << " allocations" << endl;
+			return TestFail;
+		}
+
+		if (pool_->available() != pool_->size()) {
+			cout << "Requests lost by the pool" << endl;
+			return TestFail;
+		}
+
+		/* Capture frames with the pool. */
+		completeRequestsCount_ = 0;
+
+		camera_->requestCompleted.connect(this, &RequestPoolTest::requestComplete);
+
+		if (camera_->start()) {
+			cout << "Failed to start camera" << endl;
+			return TestFail;
+		}
+
+		while (Request *request = pool_->acquire()) {
+			if (camera_->queueRequest(request)) {
+				cout << "Failed to queue request" << endl;
+				return TestFail;
+			}
+		}
+
+		EventDispatcher *dispatcher = Thread::current()->eventDispatcher();
+
+		Timer timer;
+		timer.start(1000ms);
+		while (timer.isRunning())
+			dispatcher->processEvents();
+
+		if (camera_->stop()) {
+			cout << "Failed to stop camera" << endl;
+			return TestFail;
+		}
+
+		if (completeRequestsCount_ < pool_->size() * 2) {
+			cout << "Failed to capture enough frames (got "
+			     << completeRequestsCount_ << " expected at least "
+			     << pool_->size() * 2 << ")" << endl;
+			return TestFail;
+		}
+
+		if (pool_->available() != pool_->size()) {
+			cout << "Requests not returned to the pool" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	void cleanup() override
+	{
+		pool_.reset();
+		allocator_.reset();
+	}
+
+	unsigned int completeRequestsCount_;
+
+	std::unique_ptr<CameraConfiguration> config_;
+	std::unique_ptr<FrameBufferAllocator> allocator_;
+	std::unique_ptr<RequestPool> pool_;
+};
+
+} /* namespace */
+
+TEST_REGISTER(RequestPoolTest)
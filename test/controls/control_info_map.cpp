@@ -75,6 +75,23 @@ protected:
 			return TestFail;
 		}
 
+		/* Test that copied and moved maps can be looked up by ID. */
+		ControlInfoMap copy(infoMap);
+		ControlInfoMap moved(std::move(copy));
+		if (moved.find(controls::Brightness.id()) == moved.end() ||
+		    !copy.empty() || copy.find(controls::Brightness.id()) != copy.end()) {
+			cerr << "Move construction failed" << endl;
+			return TestFail;
+		}
+
+		copy = infoMap;
+		moved = std::move(copy);
+		if (moved.find(controls::Brightness.id()) == moved.end() ||
+		    !copy.empty() || copy.find(controls::Brightness.id()) != copy.end()) {
+			cerr << "Move assignment failed" << endl;
+			return TestFail;
+		}
+
 		/* Test looking up a control on a default-constructed infoMap */
 		const ControlInfoMap emptyInfoMap;
 		if (emptyInfoMap.find(12345) != emptyInfoMap.end()) {
@@ -196,6 +196,42 @@ protected:
 			return TestFail;
 		}
 
+		/* Verify that iteration follows the insertion order. */
+		const unsigned int expected[] = {
+			controls::BRIGHTNESS,
+			controls::SATURATION,
+			controls::CONTRAST,
+		};
+
+		count = 0;
+		for (const auto &[id, value] : mergeList) {
+			if (id != expected[count++]) {
+				cout << "Merged list iteration order is incorrect"
+				     << endl;
+				return TestFail;
+			}
+		}
+
+		/*
+		 * Clear the list and verify that it can be repopulated with a
+		 * different set of controls.
+		 */
+		mergeList.clear();
+
+		if (!mergeList.empty() || mergeList.get(controls::Brightness)) {
+			cout << "Cleared list should be empty" << endl;
+			return TestFail;
+		}
+
+		mergeList.set(controls::Contrast, 1.3f);
+
+		if (mergeList.size() != 1 ||
+		    mergeList.get(controls::Contrast) != 1.3f ||
+		    mergeList.get(controls::Saturation)) {
+			cout << "Failed to reuse cleared list" << endl;
+			return TestFail;
+		}
+
 		return TestPass;
 	}
 };
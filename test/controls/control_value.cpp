@@ -257,6 +257,33 @@ protected:
 			return TestFail;
 		}
 
+		/*
+		 * Move construction and assignment, with values stored inline
+		 * and on the heap.
+		 */
+		std::array<float, 9> matrix{ 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+		std::array<int64_t, 8> large{ 2, 7, 1, 8, 2, 8, 1, 8 };
+
+		for (const ControlValue &source : { ControlValue(Span<float>(matrix)),
+						    ControlValue(Span<int64_t>(large)) }) {
+			ControlValue original = source;
+			ControlValue moved(std::move(original));
+			if (moved != source || !original.isNone() ||
+			    original.numElements() != 0) {
+				cerr << "Control value mismatch after move construction"
+				     << endl;
+				return TestFail;
+			}
+
+			ControlValue assigned{ string };
+			assigned = std::move(moved);
+			if (assigned != source || !moved.isNone()) {
+				cerr << "Control value mismatch after move assignment"
+				     << endl;
+				return TestFail;
+			}
+		}
+
 		return TestPass;
 	}
 };
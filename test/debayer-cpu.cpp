@@ -0,0 +1,180 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * debayer-cpu.cpp - DebayerCpu class tests
+ */
+
+#include <iostream>
+#include <stdint.h>
+#include <vector>
+
+#include <libcamera/formats.h>
+
+#include "libcamera/internal/converter/debayer_cpu.h"
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+
+class DebayerCpuTest : public Test
+{
+protected:
+	static constexpr unsigned int kWidth = 52;
+	static constexpr unsigned int kHeight = 12;
+
+	int run()
+	{
+		if (!DebayerCpu::isSupportedInput(formats::SRGGB10_CSI2P) ||
+		    DebayerCpu::isSupportedInput(formats::NV12)) {
+			cerr << "Invalid supported input formats" << endl;
+			return TestFail;
+		}
+
+		if (testFlatField() != TestPass)
+			return TestFail;
+
+		if (testStrips() != TestPass)
+			return TestFail;
+
+		return TestPass;
+	}
+
+	/*
+	 * Process a flat field in the 10-bit CSI-2 packed format, and check
+	 * that all output pixels have the colour of the field.
+	 */
+	int testFlatField()
+	{
+		static const uint16_t values[2][2] = { { 800, 400 }, { 400, 200 } };
+		unsigned int stride = kWidth * 5 / 4;
+		vector<uint8_t> input(stride * kHeight);
+
+		for (unsigned int y = 0; y < kHeight; ++y) {
+			uint8_t *line = &input[y * stride];
+
+			for (unsigned int x = 0; x < kWidth; ++x) {
+				uint16_t value = values[y & 1][x & 1];
+				uint8_t *group = &line[x / 4 * 5];
+
+				group[x % 4] = value >> 2;
+				group[4] |= (value & 3) << (x % 4 * 2);
+			}
+		}
+
+		DebayerCpu debayer;
+		int ret = debayer.configure(formats::SRGGB10_CSI2P,
+					    { kWidth, kHeight }, stride);
+		if (ret) {
+			cerr << "Failed to configure debayering" << endl;
+			return TestFail;
+		}
+
+		DebayerCpu::Tables tables = identityTables(debayer.bitDepth());
+		SoftwareStatistics stats{};
+		vector<uint8_t> output(kWidth * kHeight * 4);
+		DebayerCpu::Output dest{ output.data(), kWidth * 4,
+					 formats::XRGB8888 };
+
+		debayer.process(input.data(), { &dest, 1 }, 0, kHeight, tables,
+				&stats);
+
+		for (unsigned int i = 0; i < kWidth * kHeight; ++i) {
+			const uint8_t *pixel = &output[i * 4];
+
+			if (pixel[2] != 200 || pixel[1] != 100 || pixel[0] != 50) {
+				cerr << "Invalid colour at pixel " << i << endl;
+				return TestFail;
+			}
+		}
+
+		if (stats.count[DebayerCpu::Green] != kWidth * kHeight / 2 ||
+		    stats.sum[DebayerCpu::Red] != 800ULL * kWidth * kHeight / 4) {
+			cerr << "Invalid statistics" << endl;
+			return TestFail;
+		}
+
+		/*
+		 * One quad out of two is sampled horizontally on one line pair
+		 * out of two, all with a luminance of 450 out of 1023.
+		 */
+		unsigned int quads = (kWidth / 4) * (kHeight / 4);
+		if (stats.histogram[450 * 64 / 1024] != quads) {
+			cerr << "Invalid histogram" << endl;
+			return TestFail;
+		}
+
+		uint64_t zoneRed = 0;
+		uint32_t zoneQuads = 0;
+		for (unsigned int i = 0; i < SoftwareStatistics::kNumZones; ++i) {
+			zoneRed += stats.zoneSums[i][DebayerCpu::Red];
+			zoneQuads += stats.zoneCounts[i];
+		}
+
+		if (zoneQuads != quads || zoneRed != 800ULL * quads) {
+			cerr << "Invalid zone statistics" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	/*
+	 * Process an image with varying content in strips, and check that the
+	 * result matches processing the whole image in one go.
+	 */
+	int testStrips()
+	{
+		vector<uint8_t> input(kWidth * kHeight);
+
+		for (unsigned int i = 0; i < input.size(); ++i)
+			input[i] = (i * 37 + (i / kWidth) * 11) % 256;
+
+		DebayerCpu::Tables tables = identityTables(8);
+		vector<uint8_t> reference(kWidth * kHeight * 3);
+		vector<uint8_t> output(kWidth * kHeight * 3);
+
+		DebayerCpu debayer;
+		if (debayer.configure(formats::SGBRG8, { kWidth, kHeight }, kWidth)) {
+			cerr << "Failed to configure debayering" << endl;
+			return TestFail;
+		}
+
+		SoftwareStatistics stats{};
+		DebayerCpu::Output dest{ reference.data(), kWidth * 3,
+					 formats::RGB888 };
+		debayer.process(input.data(), { &dest, 1 }, 0, kHeight, tables,
+				&stats);
+
+		dest.data = output.data();
+		for (unsigned int start = 0; start < kHeight; start += 4) {
+			DebayerCpu strip;
+			strip.configure(formats::SGBRG8, { kWidth, kHeight }, kWidth);
+			strip.process(input.data(), { &dest, 1 }, start, start + 4,
+				      tables, &stats);
+		}
+
+		if (output != reference) {
+			cerr << "Strip processing doesn't match full image" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	static DebayerCpu::Tables identityTables(unsigned int bitDepth)
+	{
+		DebayerCpu::Tables tables;
+
+		for (vector<uint8_t> &lut : tables.lut) {
+			lut.resize(1 << bitDepth);
+			for (unsigned int i = 0; i < lut.size(); ++i)
+				lut[i] = i >> (bitDepth - 8);
+		}
+
+		return tables;
+	}
+};
+
+TEST_REGISTER(DebayerCpuTest)
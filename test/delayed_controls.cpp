@@ -155,6 +155,55 @@ protected:
 		return TestPass;
 	}
 
+	int singleControlWithCookie()
+	{
+		std::unordered_map<uint32_t, DelayedControls::ControlParams> delays = {
+			{ V4L2_CID_BRIGHTNESS, { 1, false } },
+		};
+		std::unique_ptr<DelayedControls> delayed =
+			std::make_unique<DelayedControls>(dev_.get(), delays);
+		ControlList ctrls;
+
+		/* Reset control to value that will be first in test. */
+		int32_t expected = 4;
+		unsigned int expectedCookie = 1000;
+		ctrls.set(V4L2_CID_BRIGHTNESS, expected);
+		dev_->setControls(&ctrls);
+		delayed->reset(expectedCookie);
+
+		/* Trigger the first frame start event */
+		delayed->applyControls(0);
+
+		/* Test the cookies follow the control values. */
+		for (unsigned int i = 1; i < 100; i++) {
+			int32_t value = 10 + i;
+
+			ctrls.set(V4L2_CID_BRIGHTNESS, value);
+			delayed->push(ctrls, i);
+
+			delayed->applyControls(i);
+
+			ControlList result = delayed->get(i);
+			int32_t brightness = result.get(V4L2_CID_BRIGHTNESS).get<int32_t>();
+			unsigned int cookie = delayed->cookie(i);
+			if (brightness != expected || cookie != expectedCookie) {
+				cerr << "Failed single control with cookie"
+				     << " frame " << i
+				     << " expected " << expected
+				     << " (" << expectedCookie << ")"
+				     << " got " << brightness
+				     << " (" << cookie << ")"
+				     << endl;
+				return TestFail;
+			}
+
+			expected = value;
+			expectedCookie = i;
+		}
+
+		return TestPass;
+	}
+
 	int dualControlsWithDelay()
 	{
 		static const unsigned int maxDelay = 2;
@@ -281,6 +330,11 @@ protected:
 		if (ret)
 			return ret;
 
+		/* Test single control with cookies. */
+		ret = singleControlWithCookie();
+		if (ret)
+			return ret;
+
 		/* Test dual controls with different delays. */
 		ret = dualControlsWithDelay();
 		if (ret)
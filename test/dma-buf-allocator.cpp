@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * dma-buf-allocator.cpp - DmaBufAllocator test
+ */
+
+#include <iostream>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <libcamera/base/unique_fd.h>
+
+#include "libcamera/internal/dma_buf_allocator.h"
+
+#include "test.h"
+
+using namespace libcamera;
+using namespace std;
+
+class DmaBufAllocatorTest : public Test
+{
+protected:
+	int run()
+	{
+		static constexpr size_t kSize = 64 * 1024;
+
+		DmaBufAllocator allocator(DmaBufAllocator::DmaBufAllocatorFlag::CmaHeap |
+					  DmaBufAllocator::DmaBufAllocatorFlag::SystemHeap |
+					  DmaBufAllocator::DmaBufAllocatorFlag::SystemUncachedHeap);
+		if (!allocator.isValid()) {
+			cout << "No DMA-BUF heap available" << endl;
+			return TestSkip;
+		}
+
+		if (allocator.alloc(nullptr, kSize).isValid()) {
+			cerr << "Allocation without a name should fail" << endl;
+			return TestFail;
+		}
+
+		UniqueFD fd = allocator.alloc("test", kSize);
+		if (!fd.isValid()) {
+			cerr << "Failed to allocate buffer" << endl;
+			return TestFail;
+		}
+
+		/* Verify that the buffer can be mapped and accessed. */
+		void *mem = mmap(nullptr, kSize, PROT_READ | PROT_WRITE,
+				 MAP_SHARED, fd.get(), 0);
+		if (mem == MAP_FAILED) {
+			cerr << "Failed to map buffer" << endl;
+			return TestFail;
+		}
+
+		memset(mem, 0x5a, kSize);
+		bool valid = static_cast<uint8_t *>(mem)[kSize - 1] == 0x5a;
+		munmap(mem, kSize);
+
+		if (!valid) {
+			cerr << "Buffer contents mismatch" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+};
+
+TEST_REGISTER(DmaBufAllocatorTest)
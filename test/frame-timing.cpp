@@ -0,0 +1,186 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * frame-timing.cpp - Frame timing model test
+ */
+
+#include <iostream>
+#include <stdint.h>
+#include <stdlib.h>
+#include <utility>
+
+#include "libcamera/internal/frame_timing.h"
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+
+class FrameTimingTest : public Test
+{
+protected:
+	int testDuration()
+	{
+		FrameTiming timing;
+
+		if (timing.isValid() || timing.frameStart()) {
+			cerr << "Empty model should be invalid" << endl;
+			return TestFail;
+		}
+
+		/* A single frame with a known duration is enough to predict. */
+		timing.addFrame(kStart, 33333);
+
+		if (!expect(timing, "first frame", kStart + 33333000, 0))
+			return TestFail;
+
+		/*
+		 * Run the sensor clock 0.1% slower than the system clock, the
+		 * model should converge to the measured interval.
+		 */
+		const int64_t interval = 33366333;
+		int64_t timestamp = kStart;
+
+		for (unsigned int i = 0; i < 64; ++i) {
+			timestamp += interval;
+			timing.addFrame(timestamp, 33333);
+		}
+
+		if (!expect(timing, "clock drift", timestamp + interval, 10))
+			return TestFail;
+
+		/* Dropped frames shouldn't disturb the model. */
+		timestamp += 3 * interval;
+		timing.addFrame(timestamp, 33333);
+
+		if (!expect(timing, "dropped frames", timestamp + interval, 10))
+			return TestFail;
+
+		/* Frame duration changes should be applied immediately. */
+		timestamp += interval;
+		timing.addFrame(timestamp, 66666);
+
+		if (!expect(timing, "duration change", timestamp + 2 * interval, 20))
+			return TestFail;
+
+		/* Frames older than the last one should be ignored. */
+		timing.addFrame(timestamp - interval, 33333);
+
+		if (!expect(timing, "out of order", timestamp + 2 * interval, 20))
+			return TestFail;
+
+		timing.reset();
+
+		if (timing.isValid()) {
+			cerr << "Model should be invalid after reset" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	int testTimestamps()
+	{
+		FrameTiming timing;
+
+		/* Without a frame duration, two frames are needed. */
+		timing.addFrame(kStart);
+
+		if (timing.isValid()) {
+			cerr << "Single frame should be invalid" << endl;
+			return TestFail;
+		}
+
+		/* Add +/- 100µs of jitter to the timestamps. */
+		const int64_t interval = 16666667;
+		int64_t timestamp = kStart;
+
+		for (unsigned int i = 1; i <= 64; ++i) {
+			timestamp = kStart + i * interval + (i % 2 ? 100000 : -100000);
+			timing.addFrame(timestamp);
+		}
+
+		const int64_t next = kStart + 65 * interval;
+
+		if (!expect(timing, "jitter", next, 200000))
+			return TestFail;
+
+		if (timing.jitter() < 100000 || timing.jitter() > 300000) {
+			cerr << "Invalid jitter " << timing.jitter() << endl;
+			return TestFail;
+		}
+
+		/* Reported dropped frames shouldn't disturb the model. */
+		timestamp = kStart + 67 * interval;
+		timing.addFrame(timestamp, std::nullopt, 2);
+
+		if (!expect(timing, "dropped frames", timestamp + interval, 20000))
+			return TestFail;
+
+		return TestPass;
+	}
+
+	int testFrameRateChange()
+	{
+		FrameTiming timing;
+		int64_t timestamp = kStart;
+
+		/*
+		 * Without a frame duration, the model should follow frame rate
+		 * changes, including by integer factors that can't be told
+		 * apart from dropped frames by the timestamps alone.
+		 */
+		for (const auto &[interval, name] : { std::pair{ 33333333, "30fps" },
+						      std::pair{ 66666667, "15fps" },
+						      std::pair{ 50000000, "20fps" } }) {
+			for (unsigned int i = 0; i < 96; ++i) {
+				timestamp += interval;
+				timing.addFrame(timestamp);
+			}
+
+			if (!expect(timing, name, timestamp + interval, 500))
+				return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		if (testDuration() != TestPass)
+			return TestFail;
+
+		if (testTimestamps() != TestPass)
+			return TestFail;
+
+		if (testFrameRateChange() != TestPass)
+			return TestFail;
+
+		return TestPass;
+	}
+
+private:
+	static constexpr int64_t kStart = 1000000000;
+
+	/* Check the next frame start prediction, with a tolerance in µs. */
+	static bool expect(const FrameTiming &timing, const char *name,
+			   int64_t expected, int64_t tolerance)
+	{
+		const auto start = timing.frameStart();
+		if (!start) {
+			cerr << "No prediction for " << name << endl;
+			return false;
+		}
+
+		if (llabs(*start - expected) > tolerance * 1000) {
+			cerr << "Invalid prediction for " << name << ": "
+			     << *start << ", expected " << expected << endl;
+			return false;
+		}
+
+		return true;
+	}
+};
+
+TEST_REGISTER(FrameTimingTest)
@@ -0,0 +1,242 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * gstreamer_benchmark.cpp - GStreamer capture throughput and latency benchmark
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <sys/resource.h>
+#include <vector>
+
+#include <libcamera/libcamera.h>
+
+#include <gst/gst.h>
+
+#include "gstreamer_test.h"
+#include "test.h"
+
+#if !GST_CHECK_VERSION(1, 19, 1)
+static inline GstPad *gst_element_request_pad_simple(GstElement *element,
+						     const gchar *name)
+{
+	return gst_element_get_request_pad(element, name);
+}
+#endif
+
+using namespace libcamera;
+using namespace std;
+
+class GstreamerBenchmark : public GstreamerTest, public Test
+{
+public:
+	GstreamerBenchmark()
+		: GstreamerTest(1)
+	{
+	}
+
+protected:
+	int init() override
+	{
+		if (status_ != TestPass)
+			return status_;
+
+		CameraManager cm;
+		cm.start();
+
+		std::shared_ptr<Camera> camera = cm.get(cameraName_);
+		maxStreams_ = camera ? std::min<unsigned int>(camera->streams().size(),
+							      kMaxStreams)
+				     : 1;
+
+		cm.stop();
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		for (unsigned int numStreams = 1; numStreams <= maxStreams_; ++numStreams) {
+			int ret = benchmark(numStreams);
+			if (ret != TestPass)
+				return ret;
+		}
+
+		return TestPass;
+	}
+
+private:
+	static constexpr unsigned int kMaxStreams = 2;
+	static constexpr GstClockTime kDuration = 5 * GST_SECOND;
+
+	struct StreamStats {
+		GstElement *pipeline;
+		unsigned int buffers;
+		GstClockTime first;
+		GstClockTime last;
+		vector<double> latencies;
+	};
+
+	/*
+	 * Record the arrival of a buffer at the sink. The latency is measured
+	 * from the capture time, as the PTS is computed by libcamerasrc from
+	 * the sensor timestamp.
+	 */
+	static GstPadProbeReturn bufferProbe([[maybe_unused]] GstPad *pad,
+					     GstPadProbeInfo *info,
+					     gpointer userData)
+	{
+		StreamStats *stats = static_cast<StreamStats *>(userData);
+		GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+
+		GstClock *clock = gst_element_get_clock(stats->pipeline);
+		if (!clock)
+			return GST_PAD_PROBE_OK;
+
+		GstClockTime now = gst_clock_get_time(clock) -
+				   gst_element_get_base_time(stats->pipeline);
+		gst_object_unref(clock);
+
+		if (!GST_CLOCK_TIME_IS_VALID(stats->first))
+			stats->first = now;
+		stats->last = now;
+		stats->buffers++;
+
+		if (GST_BUFFER_PTS_IS_VALID(buffer) && now >= GST_BUFFER_PTS(buffer))
+			stats->latencies.push_back(static_cast<double>(now - GST_BUFFER_PTS(buffer)) /
+						   GST_MSECOND);
+
+		return GST_PAD_PROBE_OK;
+	}
+
+	static double cpuTime()
+	{
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+
+		return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+		       usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+	}
+
+	static void report(unsigned int numStreams, unsigned int index,
+			   StreamStats &stats)
+	{
+		cout << numStreams << " streams: stream " << index << ": ";
+
+		if (stats.buffers < 2 || stats.latencies.empty()) {
+			cout << stats.buffers << " buffers" << endl;
+			return;
+		}
+
+		double duration = static_cast<double>(stats.last - stats.first) / GST_SECOND;
+		vector<double> &latencies = stats.latencies;
+		sort(latencies.begin(), latencies.end());
+
+		cout << (stats.buffers - 1) / duration << " fps, latency "
+		     << "p50 " << latencies[latencies.size() / 2] << " ms, "
+		     << "p99 " << latencies[latencies.size() * 99 / 100] << " ms"
+		     << endl;
+	}
+
+	int benchmark(unsigned int numStreams)
+	{
+		g_clear_object(&pipeline_);
+		g_clear_object(&libcameraSrc_);
+
+		if (createPipeline() != TestPass)
+			return TestFail;
+
+		gst_bin_add(GST_BIN(pipeline_), libcameraSrc_);
+
+		vector<unique_ptr<StreamStats>> stats;
+
+		for (unsigned int i = 0; i < numStreams; ++i) {
+			g_autoptr(GError) error = NULL;
+			GstElement *stream =
+				gst_parse_bin_from_description_full("queue ! fakesink name=sink sync=false",
+								    TRUE, NULL,
+								    GST_PARSE_FLAG_FATAL_ERRORS,
+								    &error);
+			if (!stream) {
+				g_printerr("Stream %u could not be created (%s)\n",
+					   i, error->message);
+				return TestFail;
+			}
+
+			gst_bin_add(GST_BIN(pipeline_), stream);
+
+			g_autoptr(GstPad) src_pad = i == 0
+				? gst_element_get_static_pad(libcameraSrc_, "src")
+				: gst_element_request_pad_simple(libcameraSrc_, "src_%u");
+			g_autoptr(GstPad) sink_pad = gst_element_get_static_pad(stream, "sink");
+
+			if (gst_pad_link(src_pad, sink_pad) != GST_PAD_LINK_OK) {
+				g_printerr("Pads could not be linked.\n");
+				return TestFail;
+			}
+
+			stats.push_back(make_unique<StreamStats>());
+			StreamStats *streamStats = stats.back().get();
+			streamStats->pipeline = pipeline_;
+			streamStats->buffers = 0;
+			streamStats->first = GST_CLOCK_TIME_NONE;
+			streamStats->last = GST_CLOCK_TIME_NONE;
+
+			g_autoptr(GstElement) sink = gst_bin_get_by_name(GST_BIN(stream), "sink");
+			g_autoptr(GstPad) probe_pad = gst_element_get_static_pad(sink, "sink");
+			gst_pad_add_probe(probe_pad, GST_PAD_PROBE_TYPE_BUFFER,
+					  bufferProbe, streamStats, nullptr);
+		}
+
+		double cpuStart = cpuTime();
+		gint64 start = g_get_monotonic_time();
+
+		if (startPipeline() != TestPass)
+			return TestFail;
+
+		constexpr GstMessageType msgType =
+			static_cast<GstMessageType>(GST_MESSAGE_ERROR | GST_MESSAGE_EOS);
+
+		g_autoptr(GstBus) bus = gst_element_get_bus(pipeline_);
+		g_autoptr(GstMessage) msg = gst_bus_timed_pop_filtered(bus, kDuration, msgType);
+
+		GstStructure *poolStats = nullptr;
+		g_object_get(libcameraSrc_, "pool-stats", &poolStats, NULL);
+
+		gst_element_set_state(pipeline_, GST_STATE_NULL);
+
+		double cpu = cpuTime() - cpuStart;
+		double elapsed = (g_get_monotonic_time() - start) / 1e6;
+
+		if (msg) {
+			if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR)
+				printError(msg);
+			else
+				g_printerr("Unexpected End-Of-Stream.\n");
+
+			if (poolStats)
+				gst_structure_free(poolStats);
+			return TestFail;
+		}
+
+		for (unsigned int i = 0; i < numStreams; ++i)
+			report(numStreams, i, *stats[i]);
+
+		cout << numStreams << " streams: CPU usage "
+		     << cpu / elapsed * 100 << " %" << endl;
+
+		if (poolStats) {
+			g_autofree gchar *str = gst_structure_to_string(poolStats);
+			cout << numStreams << " streams: " << str << endl;
+			gst_structure_free(poolStats);
+		}
+
+		return TestPass;
+	}
+
+	unsigned int maxStreams_;
+};
+
+TEST_REGISTER(GstreamerBenchmark)
@@ -0,0 +1,92 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * camera_sensor_helper.cpp - Camera sensor helper gain conversion tests
+ */
+
+#include <iostream>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "libipa/camera_sensor_helper.h"
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+using namespace libcamera::ipa;
+
+class CameraSensorHelperTest : public Test
+{
+protected:
+	int testSensor(const string &model, uint32_t maxCode)
+	{
+		unique_ptr<CameraSensorHelper> helper =
+			CameraSensorHelperFactoryBase::create(model);
+		if (!helper) {
+			cerr << "No camera sensor helper for " << model << endl;
+			return TestFail;
+		}
+
+		vector<uint32_t> codes;
+		for (uint32_t code = 0; code <= maxCode; code += 7)
+			codes.push_back(code);
+
+		vector<double> gains(codes.size());
+		helper->gains(codes, gains);
+
+		vector<uint32_t> roundTrip(codes.size());
+		helper->gainCodes(gains, roundTrip);
+
+		for (size_t i = 0; i < codes.size(); ++i) {
+			if (gains[i] != helper->gain(codes[i])) {
+				cerr << model << ": batch gain mismatch for code "
+				     << codes[i] << endl;
+				return TestFail;
+			}
+
+			if (roundTrip[i] != helper->gainCode(gains[i])) {
+				cerr << model << ": batch gain code mismatch for gain "
+				     << gains[i] << endl;
+				return TestFail;
+			}
+
+			/*
+			 * Converting a gain code to a gain and back may be off
+			 * by one due to truncation of the gain code.
+			 */
+			if (roundTrip[i] > codes[i] || roundTrip[i] + 1 < codes[i]) {
+				cerr << model << ": gain code " << codes[i]
+				     << " converted back to " << roundTrip[i] << endl;
+				return TestFail;
+			}
+		}
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		/* Linear gain models with m0 or m1 set to 0. */
+		if (testSensor("imx219", 232) != TestPass)
+			return TestFail;
+
+		if (testSensor("ov5640", 1023) != TestPass)
+			return TestFail;
+
+		/* Exponential gain model. */
+		if (testSensor("imx290", 240) != TestPass)
+			return TestFail;
+
+		/* Custom gain conversion, limited to 15.5x. */
+		if (testSensor("ar0521", 63) != TestPass)
+			return TestFail;
+
+		return TestPass;
+	}
+};
+
+TEST_REGISTER(CameraSensorHelperTest)
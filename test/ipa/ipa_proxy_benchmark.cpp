@@ -0,0 +1,194 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * ipa_proxy_benchmark.cpp - IPA proxy latency and throughput benchmark
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <stdlib.h>
+#include <vector>
+
+#include <libcamera/control_ids.h>
+#include <libcamera/controls.h>
+
+#include <libcamera/ipa/vimc_ipa_proxy.h>
+
+#include "libcamera/internal/control_serializer.h"
+#include "libcamera/internal/ipa_data_serializer.h"
+#include "libcamera/internal/ipa_manager.h"
+#include "libcamera/internal/pipeline_handler.h"
+#include "libcamera/internal/process.h"
+
+#include "test.h"
+
+using namespace libcamera;
+using namespace std;
+
+class IPAProxyBenchmark : public Test
+{
+public:
+	~IPAProxyBenchmark()
+	{
+		ipaManager_.reset();
+	}
+
+protected:
+	int init() override
+	{
+		ipaManager_ = make_unique<IPAManager>();
+
+		const std::vector<PipelineHandlerFactoryBase *> &factories =
+			PipelineHandlerFactoryBase::factories();
+		for (const PipelineHandlerFactoryBase *factory : factories) {
+			if (factory->name() == "PipelineHandlerVimc") {
+				pipe_ = factory->create(nullptr);
+				break;
+			}
+		}
+
+		if (!pipe_) {
+			cerr << "Vimc pipeline not found" << endl;
+			return TestSkip;
+		}
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		/*
+		 * The proxy runs the IPA module in a thread when its signature
+		 * is valid, and isolates it in a separate process otherwise.
+		 * Force isolation through the environment for the second run.
+		 */
+		unsetenv("LIBCAMERA_IPA_FORCE_ISOLATION");
+		int ret = benchmark("thread");
+		if (ret != TestPass)
+			return ret;
+
+		setenv("LIBCAMERA_IPA_FORCE_ISOLATION", "1", 1);
+		ret = benchmark("isolated");
+		unsetenv("LIBCAMERA_IPA_FORCE_ISOLATION");
+
+		return ret;
+	}
+
+private:
+	static constexpr unsigned int kIterations = 1000;
+
+	/*
+	 * Report the latencies and throughput of a call. The \a latencies and
+	 * the \a total duration are expressed in microseconds. The \a bytes
+	 * are the serialized size of the call payload, which is copied once
+	 * per call to the proxy, whether to pass the arguments to the IPA
+	 * thread or to send them to the isolated process.
+	 */
+	static void report(const char *mode, const char *name, size_t bytes,
+			   vector<double> &latencies, double total)
+	{
+		sort(latencies.begin(), latencies.end());
+
+		size_t copied = bytes * latencies.size();
+
+		cout << mode << ": " << name << " " << bytes << " bytes: "
+		     << "p50 " << latencies[latencies.size() / 2] << " us, "
+		     << "p99 " << latencies[latencies.size() * 99 / 100] << " us, "
+		     << latencies.size() / total * 1000000 << " msg/s, "
+		     << copied / total * 1000000 << " B/s serialized, "
+		     << copied << " bytes copied"
+		     << endl;
+	}
+
+	int benchmark(const char *mode)
+	{
+		std::unique_ptr<ipa::vimc::IPAProxyVimc> ipa =
+			IPAManager::createIPA<ipa::vimc::IPAProxyVimc>(pipe_.get(), 0, 0);
+		if (!ipa) {
+			cerr << mode << ": failed to create VIMC IPA interface" << endl;
+			return TestFail;
+		}
+
+		std::string conf = ipa->configurationFile("vimc.conf");
+		Flags<ipa::vimc::TestFlag> inFlags;
+		Flags<ipa::vimc::TestFlag> outFlags;
+		int ret = ipa->init(IPASettings{ conf, "vimc" },
+				    ipa::vimc::IPAOperationInit,
+				    inFlags, &outFlags);
+		if (ret < 0) {
+			cerr << mode << ": IPA interface init() failed" << endl;
+			return TestFail;
+		}
+
+		/*
+		 * Measure the latency of synchronous calls with payloads of
+		 * increasing size. The vimc IPA ignores unknown buffer IDs, so
+		 * unmapBuffers() serves as a synthetic large-payload call.
+		 */
+		for (size_t count : { 0, 1024, 16384 }) {
+			vector<unsigned int> ids(count);
+			iota(ids.begin(), ids.end(), 1000000);
+
+			auto [data, fds] = IPADataSerializer<vector<unsigned int>>::serialize(ids);
+			vector<double> latencies;
+			latencies.reserve(kIterations);
+
+			auto begin = chrono::steady_clock::now();
+
+			for (unsigned int i = 0; i < kIterations; ++i) {
+				auto start = chrono::steady_clock::now();
+				ipa->unmapBuffers(ids);
+				auto duration = chrono::steady_clock::now() - start;
+
+				latencies.push_back(chrono::duration<double, micro>(duration)
+							    .count());
+			}
+
+			auto duration = chrono::steady_clock::now() - begin;
+			report(mode, "unmapBuffers", data.size(), latencies,
+			       chrono::duration<double, micro>(duration).count());
+		}
+
+		/*
+		 * Measure the throughput of asynchronous calls. The latency
+		 * only covers queuing the call. Calls are processed in order,
+		 * so a final synchronous call waits for all of them to
+		 * complete.
+		 */
+		ControlList list(controls::controls);
+		list.set(controls::ExposureTime, 10000);
+		list.set(controls::AnalogueGain, 2.0f);
+		list.set(controls::Brightness, 0.5f);
+
+		vector<double> latencies;
+		latencies.reserve(kIterations);
+
+		auto begin = chrono::steady_clock::now();
+
+		for (unsigned int i = 0; i < kIterations; ++i) {
+			auto start = chrono::steady_clock::now();
+			ipa->queueRequest(i, list);
+			auto duration = chrono::steady_clock::now() - start;
+
+			latencies.push_back(chrono::duration<double, micro>(duration).count());
+		}
+
+		ipa->unmapBuffers({});
+
+		auto duration = chrono::steady_clock::now() - begin;
+		report(mode, "queueRequest", ControlSerializer::binarySize(list), latencies,
+		       chrono::duration<double, micro>(duration).count());
+
+		return TestPass;
+	}
+
+	ProcessManager processManager_;
+
+	std::shared_ptr<PipelineHandler> pipe_;
+	std::unique_ptr<IPAManager> ipaManager_;
+};
+
+TEST_REGISTER(IPAProxyBenchmark)
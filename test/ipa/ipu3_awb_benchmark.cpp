@@ -0,0 +1,109 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * ipu3_awb_benchmark.cpp - IPU3 AWB per-frame processing benchmark
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <linux/intel-ipu3.h>
+
+#include <libcamera/control_ids.h>
+#include <libcamera/controls.h>
+
+#include "algorithms/awb.h"
+#include "ipa_context.h"
+
+#include "test.h"
+
+using namespace libcamera;
+using namespace std;
+
+class IPU3AwbBenchmark : public Test
+{
+protected:
+	int init() override
+	{
+		/*
+		 * Generate a statistics buffer for a 80x48 cells grid, matching
+		 * the grid computed by the IPU3 IPA for a 1280x768 BDS output.
+		 * Cell averages follow smooth gradients, with a sprinkle of
+		 * saturated cells to exercise the cell filtering.
+		 */
+		ipu3_uapi_grid_config &grid = context_.configuration.grid.bdsGrid;
+		grid.width = 80;
+		grid.height = 48;
+		grid.block_width_log2 = 4;
+		grid.block_height_log2 = 4;
+		context_.configuration.grid.stride = 80;
+
+		stats_ = make_unique<ipu3_uapi_stats_3a>();
+		stats_->stats_3a_status.awb_en = 1;
+
+		for (unsigned int y = 0; y < grid.height; y++) {
+			for (unsigned int x = 0; x < grid.width; x++) {
+				ipu3_uapi_awb_set_item &cell =
+					stats_->awb_raw_buffer.meta_data[y * 80 + x];
+
+				cell.Gr_avg = 40 + x + y;
+				cell.Gb_avg = 42 + x + y;
+				cell.R_avg = 30 + 2 * x;
+				cell.B_avg = 25 + 3 * y;
+				cell.sat_ratio = (x * 7 + y * 13) % 31 ? 0 : 255;
+			}
+		}
+
+		if (awb_.configure(context_, {})) {
+			cerr << "Failed to configure AWB" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		ControlList metadata(controls::controls);
+		ipa::ipu3::IPAFrameContext frameContext;
+		vector<double> durations;
+		durations.reserve(kIterations);
+
+		for (unsigned int i = 0; i < kIterations; ++i) {
+			auto start = chrono::steady_clock::now();
+			awb_.process(context_, i, frameContext, stats_.get(), metadata);
+			auto duration = chrono::steady_clock::now() - start;
+
+			durations.push_back(chrono::duration<double, micro>(duration).count());
+		}
+
+		sort(durations.begin(), durations.end());
+
+		cout << "AWB process: p50 " << durations[durations.size() / 2]
+		     << " us, p99 " << durations[durations.size() * 99 / 100]
+		     << " us" << endl;
+
+		/* Sanity check the estimated gains. */
+		const auto &gains = context_.activeState.awb.gains;
+		if (gains.red <= 1.0 || gains.blue <= 1.0) {
+			cerr << "Unexpected AWB gains " << gains.red << ", "
+			     << gains.blue << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+private:
+	static constexpr unsigned int kIterations = 10000;
+
+	ipa::ipu3::IPAContext context_{ {}, {}, { 16 } };
+	ipa::ipu3::algorithms::Awb awb_;
+	unique_ptr<ipu3_uapi_stats_3a> stats_;
+};
+
+TEST_REGISTER(IPU3AwbBenchmark)
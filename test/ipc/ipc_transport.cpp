@@ -0,0 +1,319 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * ipc_transport.cpp - IPC pipe transports test and latency benchmark
+ */
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include <libcamera/base/event_dispatcher.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/timer.h>
+
+#include "libcamera/internal/ipc_pipe.h"
+#include "libcamera/internal/ipc_pipe_unixsocket.h"
+#include "libcamera/internal/process.h"
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+using namespace std::chrono_literals;
+
+enum {
+	CmdExit = 0,
+	CmdEcho = 1,
+	CmdIgnore = 2,
+};
+
+class IPCTransportTestSlave
+{
+public:
+	IPCTransportTestSlave()
+		: exitCode_(EXIT_FAILURE), exit_(false)
+	{
+		dispatcher_ = Thread::current()->eventDispatcher();
+		ipc_.readyRead.connect(this, &IPCTransportTestSlave::readyRead);
+	}
+
+	int run(UniqueFD fd)
+	{
+		if (ipc_.bind(std::move(fd))) {
+			cerr << "Failed to connect to IPC channel" << endl;
+			return EXIT_FAILURE;
+		}
+
+		while (!exit_)
+			dispatcher_->processEvents();
+
+		ipc_.close();
+
+		return exitCode_;
+	}
+
+private:
+	void readyRead()
+	{
+		IPCUnixSocket::Payload message;
+		int ret;
+
+		ret = ipc_.receive(&message);
+		if (ret) {
+			cerr << "Receive message failed: " << ret << endl;
+			stop(EXIT_FAILURE);
+			return;
+		}
+
+		IPCMessage ipcMessage(message);
+
+		switch (ipcMessage.header().cmd) {
+		case CmdExit:
+			stop(EXIT_SUCCESS);
+			break;
+
+		case CmdIgnore:
+			break;
+
+		case CmdEcho: {
+			IPCMessage response(ipcMessage.header());
+			response.data() = ipcMessage.data();
+
+			ret = ipc_.send(response.payload());
+			if (ret < 0) {
+				cerr << "Reply failed" << endl;
+				stop(ret);
+			}
+			break;
+		}
+		}
+	}
+
+	void stop(int code)
+	{
+		exitCode_ = code;
+		exit_ = true;
+	}
+
+	IPCUnixSocket ipc_;
+	EventDispatcher *dispatcher_;
+	int exitCode_;
+	bool exit_;
+};
+
+class IPCTransportTest : public Test
+{
+protected:
+	int echo(IPCPipeUnixSocket *ipc, const vector<uint8_t> &data)
+	{
+		IPCMessage msg({ CmdEcho, cookie_++ });
+		msg.data() = data;
+
+		IPCMessage reply;
+		int ret = ipc->sendSync(msg, &reply);
+		if (ret < 0)
+			return ret;
+
+		return reply.data() == data ? 0 : -EINVAL;
+	}
+
+	int testTransport(IPCPipeUnixSocket::Transport transport, const char *name)
+	{
+		static constexpr unsigned int kIterations = 1000;
+		static constexpr size_t kSizes[] = { 64, 4096, 65536 };
+
+		/*
+		 * Keep the pipe alive until the end of the test, as destroying
+		 * the Process before the child exits would leave a dangling
+		 * pointer in the ProcessManager.
+		 */
+		pipes_.push_back(make_unique<IPCPipeUnixSocket>("", self().c_str(),
+								 transport));
+		IPCPipeUnixSocket *ipc = pipes_.back().get();
+		if (!ipc->isConnected()) {
+			cerr << "Failed to create IPCPipe" << endl;
+			return TestFail;
+		}
+
+		/*
+		 * Verify that payloads of various sizes, including payloads
+		 * that wrap around the end of the shared memory ring, are
+		 * transported intact.
+		 */
+		for (size_t size : { 1, 100, 4000, 200000, 100000, 200000 }) {
+			vector<uint8_t> data(size);
+			for (size_t i = 0; i < size; ++i)
+				data[i] = i * 7;
+
+			if (echo(ipc, data) < 0) {
+				cerr << name << ": payload of " << size
+				     << " bytes corrupted" << endl;
+				return TestFail;
+			}
+		}
+
+		/*
+		 * Verify that back-to-back asynchronous calls, which are
+		 * coalesced in a single message, are all delivered in order.
+		 */
+		static constexpr unsigned int kAsyncCalls = 16;
+		vector<uint32_t> replies;
+
+		ipc->recv.connect(this, [&](const IPCMessage &reply) {
+			replies.push_back(reply.header().cookie);
+		});
+
+		uint32_t firstCookie = cookie_;
+		for (unsigned int i = 0; i < kAsyncCalls; ++i) {
+			IPCMessage msg({ CmdEcho, cookie_++ });
+			msg.data() = { static_cast<uint8_t>(i) };
+
+			if (ipc->sendAsync(msg) < 0) {
+				cerr << name << ": async call failed" << endl;
+				return TestFail;
+			}
+		}
+
+		Timer timeout;
+		timeout.start(2000ms);
+		while (replies.size() < kAsyncCalls && timeout.isRunning())
+			Thread::current()->eventDispatcher()->processEvents();
+
+		ipc->recv.disconnect(this);
+
+		if (replies.size() != kAsyncCalls) {
+			cerr << name << ": received " << replies.size()
+			     << " replies to async calls" << endl;
+			return TestFail;
+		}
+
+		for (unsigned int i = 0; i < kAsyncCalls; ++i) {
+			if (replies[i] != firstCookie + i) {
+				cerr << name << ": async calls reordered" << endl;
+				return TestFail;
+			}
+		}
+
+		/*
+		 * Verify that multiple calls can be in flight simultaneously,
+		 * and that their replies are matched to the right call.
+		 */
+		static constexpr unsigned int kInFlightCalls = 8;
+		unsigned int completed = 0;
+		bool valid = true;
+
+		for (unsigned int i = 0; i < kInFlightCalls; ++i) {
+			IPCMessage msg({ CmdEcho, cookie_++ });
+			msg.data() = vector<uint8_t>(i + 1, static_cast<uint8_t>(i));
+
+			auto handler = [&completed, &valid, i](int result, const IPCMessage &reply) {
+				completed++;
+				if (result < 0 ||
+				    reply.data() != vector<uint8_t>(i + 1, static_cast<uint8_t>(i)))
+					valid = false;
+			};
+
+			if (ipc->sendCall(msg, handler) < 0) {
+				cerr << name << ": failed to send call" << endl;
+				return TestFail;
+			}
+		}
+
+		timeout.start(2000ms);
+		while (completed < kInFlightCalls && timeout.isRunning())
+			Thread::current()->eventDispatcher()->processEvents();
+
+		if (completed != kInFlightCalls || !valid) {
+			cerr << name << ": in-flight calls failed" << endl;
+			return TestFail;
+		}
+
+		/* Verify that calls without a reply time out. */
+		int timeoutResult = 0;
+
+		IPCMessage ignored({ CmdIgnore, cookie_++ });
+		auto timeoutHandler = [&timeoutResult](int result, const IPCMessage &) {
+			timeoutResult = result;
+		};
+
+		if (ipc->sendCall(ignored, timeoutHandler) < 0) {
+			cerr << name << ": failed to send call" << endl;
+			return TestFail;
+		}
+
+		timeout.start(3000ms);
+		while (!timeoutResult && timeout.isRunning())
+			Thread::current()->eventDispatcher()->processEvents();
+
+		if (timeoutResult != -ETIMEDOUT) {
+			cerr << name << ": call didn't time out" << endl;
+			return TestFail;
+		}
+
+		/* Measure the round-trip latency of synchronous calls. */
+		for (size_t size : kSizes) {
+			vector<uint8_t> data(size, 0x5a);
+
+			auto start = chrono::steady_clock::now();
+
+			for (unsigned int i = 0; i < kIterations; ++i) {
+				if (echo(ipc, data) < 0) {
+					cerr << name << ": call failed" << endl;
+					return TestFail;
+				}
+			}
+
+			auto duration = chrono::steady_clock::now() - start;
+			double latency = chrono::duration<double, micro>(duration).count()
+				       / kIterations;
+
+			cout << name << ": " << size << " bytes: "
+			     << latency << " us per call" << endl;
+		}
+
+		IPCMessage msg({ CmdExit, cookie_++ });
+		if (ipc->sendAsync(msg) < 0) {
+			cerr << name << ": failed to call exit" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	int run()
+	{
+		int ret = testTransport(IPCPipeUnixSocket::Transport::Socket, "socket");
+		if (ret != TestPass)
+			return ret;
+
+		return testTransport(IPCPipeUnixSocket::Transport::SharedMemory, "shm");
+	}
+
+private:
+	ProcessManager processManager_;
+	vector<unique_ptr<IPCPipeUnixSocket>> pipes_;
+	uint32_t cookie_ = 0;
+};
+
+/*
+ * Can't use TEST_REGISTER() as single binary needs to act as both client and
+ * server
+ */
+int main(int argc, char **argv)
+{
+	/* IPCPipeUnixSocket passes IPA module path in argv[1] */
+	if (argc == 3) {
+		UniqueFD ipcfd = UniqueFD(std::stoi(argv[2]));
+		IPCTransportTestSlave slave;
+		return slave.run(std::move(ipcfd));
+	}
+
+	IPCTransportTest test;
+	test.setArgs(argc, argv);
+	return test.execute();
+}
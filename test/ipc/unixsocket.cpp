@@ -253,6 +253,33 @@ protected:
 		return 0;
 	}
 
+	int testGather()
+	{
+		IPCUnixSocket::Payload response;
+		int ret;
+
+		/* Send a message gathered from multiple buffers. */
+		const std::vector<uint8_t> cmd = { CMD_REVERSE };
+		const std::vector<uint8_t> first = { 1, 2, 3 };
+		const std::vector<uint8_t> second = { 4, 5 };
+		const std::array<Span<const uint8_t>, 4> data = {
+			Span<const uint8_t>{ cmd },
+			Span<const uint8_t>{ first },
+			Span<const uint8_t>{},
+			Span<const uint8_t>{ second },
+		};
+
+		ret = call(data, {}, &response);
+		if (ret)
+			return ret;
+
+		const std::vector<uint8_t> expected = { CMD_REVERSE, 5, 4, 3, 2, 1 };
+		if (response.data != expected)
+			return TestFail;
+
+		return 0;
+	}
+
 	int testEmptyFail()
 	{
 		IPCUnixSocket::Payload message;
@@ -301,6 +328,49 @@ protected:
 		return 0;
 	}
 
+	int testBatch()
+	{
+		IPCUnixSocket::Payload message, response;
+		int ret;
+
+		/*
+		 * Queue fire and forget messages carrying different numbers of
+		 * fds, and verify that they're delivered in order before the
+		 * message sent with send(). Close the fds right after queuing
+		 * the messages, the socket must keep its own references.
+		 */
+		for (unsigned int num : { 3, 1 }) {
+			IPCUnixSocket::Payload cmp;
+			int size = prepareFDs(&cmp, num);
+			if (size < 0)
+				return size;
+
+			cmp.data.resize(1 + sizeof(size));
+			cmp.data[0] = CMD_LEN_CMP;
+			memcpy(cmp.data.data() + 1, &size, sizeof(size));
+
+			ret = ipc_.queue(cmp);
+
+			for (int32_t fd : cmp.fds)
+				close(fd);
+
+			if (ret)
+				return TestFail;
+		}
+
+		message.data = { CMD_REVERSE, 6, 7, 8 };
+
+		ret = call(message, &response);
+		if (ret)
+			return ret;
+
+		std::reverse(response.data.begin() + 1, response.data.end());
+		if (message.data != response.data)
+			return TestFail;
+
+		return 0;
+	}
+
 	int testFdOrder()
 	{
 		IPCUnixSocket::Payload message, response;
@@ -377,6 +447,12 @@ protected:
 			return TestFail;
 		}
 
+		/* Test sending a message gathered from multiple buffers. */
+		if (testGather()) {
+			cerr << "Gather test failed" << endl;
+			return TestFail;
+		}
+
 		/* Test that an empty message fails. */
 		if (testEmptyFail()) {
 			cerr << "Empty message test failed" << endl;
@@ -395,6 +471,12 @@ protected:
 			return TestFail;
 		}
 
+		/* Test batching messages. */
+		if (testBatch()) {
+			cerr << "Batch test failed" << endl;
+			return TestFail;
+		}
+
 		/* Test order of file descriptors. */
 		if (testFdOrder()) {
 			cerr << "fd order test failed" << endl;
@@ -420,6 +502,14 @@ protected:
 
 private:
 	int call(const IPCUnixSocket::Payload &message, IPCUnixSocket::Payload *response)
+	{
+		Span<const uint8_t> data{ message.data };
+
+		return call({ &data, 1 }, message.fds, response);
+	}
+
+	int call(Span<const Span<const uint8_t>> data, Span<const int32_t> fds,
+		 IPCUnixSocket::Payload *response)
 	{
 		Timer timeout;
 		int ret;
@@ -427,7 +517,7 @@ private:
 		callDone_ = false;
 		callResponse_ = response;
 
-		ret = ipc_.send(message);
+		ret = ipc_.send(data, fds);
 		if (ret)
 			return ret;
 
@@ -0,0 +1,133 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * unixsocket_disconnect.cpp - Unix socket IPC over connected sockets test
+ */
+
+#include <iostream>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <libcamera/base/event_dispatcher.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/timer.h>
+
+#include "libcamera/internal/ipc_unixsocket.h"
+
+#include "test.h"
+
+using namespace libcamera;
+using namespace std;
+using namespace std::chrono_literals;
+
+class UnixSocketDisconnectTest : public Test
+{
+protected:
+	int init()
+	{
+		int sockets[2];
+
+		if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC,
+			       0, sockets)) {
+			cerr << "Failed to create socket pair: " << strerror(errno)
+			     << endl;
+			return TestFail;
+		}
+
+		if (server_.bind(UniqueFD(sockets[0])) ||
+		    client_.bind(UniqueFD(sockets[1]))) {
+			cerr << "Failed to bind sockets" << endl;
+			return TestFail;
+		}
+
+		client_.readyRead.connect(this, &UnixSocketDisconnectTest::readyRead);
+		server_.disconnected.connect(this, &UnixSocketDisconnectTest::disconnected);
+
+		received_ = false;
+		disconnected_ = false;
+
+		return TestPass;
+	}
+
+	int run()
+	{
+		/* Messages, and file descriptors, go through connected sockets. */
+		IPCUnixSocket::Payload message;
+		message.data = { 0xca, 0x3e, 0x2a };
+		message.fds = { STDOUT_FILENO };
+
+		int ret = server_.send(message);
+		if (ret) {
+			cerr << "Failed to send message: " << strerror(-ret) << endl;
+			return TestFail;
+		}
+
+		if (!wait(received_)) {
+			cerr << "Message not received" << endl;
+			return TestFail;
+		}
+
+		if (payload_.data != message.data || payload_.fds.size() != 1) {
+			cerr << "Received message doesn't match" << endl;
+			return TestFail;
+		}
+
+		close(payload_.fds[0]);
+
+		/* Closing the remote side shall be reported, once. */
+		client_.close();
+
+		if (!wait(disconnected_)) {
+			cerr << "Disconnection not reported" << endl;
+			return TestFail;
+		}
+
+		disconnected_ = false;
+		Timer timeout;
+		timeout.start(100ms);
+		while (timeout.isRunning())
+			Thread::current()->eventDispatcher()->processEvents();
+
+		if (disconnected_) {
+			cerr << "Disconnection reported more than once" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+private:
+	bool wait(const bool &flag)
+	{
+		Timer timeout;
+		timeout.start(1s);
+		while (!flag && timeout.isRunning())
+			Thread::current()->eventDispatcher()->processEvents();
+
+		return flag;
+	}
+
+	void readyRead()
+	{
+		if (client_.receive(&payload_))
+			return;
+
+		received_ = true;
+	}
+
+	void disconnected()
+	{
+		disconnected_ = true;
+	}
+
+	IPCUnixSocket server_;
+	IPCUnixSocket client_;
+
+	IPCUnixSocket::Payload payload_;
+	bool received_;
+	bool disconnected_;
+};
+
+TEST_REGISTER(UnixSocketDisconnectTest)
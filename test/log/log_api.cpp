@@ -15,6 +15,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <vector>
 
 #include <libcamera/base/log.h>
 
@@ -107,6 +108,71 @@ protected:
 		return verifyOutput(iss);
 	}
 
+	int testBinaryFile()
+	{
+		int fd = open("/tmp", O_TMPFILE | O_RDWR, S_IRUSR | S_IWUSR);
+		if (fd < 0) {
+			cerr << "Failed to open tmp log file" << endl;
+			return TestFail;
+		}
+
+		char path[32];
+		snprintf(path, sizeof(path), "/proc/self/fd/%u", fd);
+
+		if (logSetBinaryFile(path) < 0) {
+			cerr << "Failed to set binary log file" << endl;
+			close(fd);
+			return TestFail;
+		}
+
+		doLogging();
+
+		vector<uint8_t> data(4096);
+		lseek(fd, 0, SEEK_SET);
+		ssize_t size = read(fd, data.data(), data.size());
+		close(fd);
+
+		if (size < 24) {
+			cerr << "Failed to read binary log file" << endl;
+			return TestFail;
+		}
+
+		uint32_t magic;
+		memcpy(&magic, data.data(), sizeof(magic));
+		if (magic != 0x4c42434c) {
+			cerr << "Invalid binary log magic" << endl;
+			return TestFail;
+		}
+
+		/* Convert the message records to text lines, and verify them. */
+		stringstream log;
+		for (size_t offset = 24; offset + 8 <= static_cast<size_t>(size);) {
+			uint16_t type;
+			uint32_t length;
+			memcpy(&type, &data[offset], sizeof(type));
+			memcpy(&length, &data[offset + 4], sizeof(length));
+			offset += 8;
+
+			if (offset + length > static_cast<size_t>(size)) {
+				cerr << "Truncated binary log record" << endl;
+				return TestFail;
+			}
+
+			/* Skip the fixed-size message fields and the prefix. */
+			if (type == 3 && length >= 24) {
+				uint16_t prefixSize;
+				memcpy(&prefixSize, &data[offset + 22], sizeof(prefixSize));
+				const char *msg = reinterpret_cast<const char *>(&data[offset]);
+				log << string(msg + 24 + prefixSize, length - 24 - prefixSize)
+				    << endl;
+			}
+
+			offset += length;
+		}
+
+		return verifyOutput(log);
+	}
+
 	int testStream()
 	{
 		stringstream log;
@@ -118,6 +184,29 @@ protected:
 		return verifyOutput(log);
 	}
 
+	int testDeferredFormatting()
+	{
+		unsigned int count = 0;
+		auto evaluate = [&count]() { return ++count; };
+
+		logSetTarget(LoggingTargetNone);
+
+		logSetLevel("LogAPITest", "WARN");
+		LOG(LogAPITest, Info) << "bad " << evaluate();
+		if (count != 0) {
+			cout << "Operands of disabled log message evaluated" << endl;
+			return TestFail;
+		}
+
+		LOG(LogAPITest, Warning) << "good " << evaluate();
+		if (count != 1) {
+			cout << "Operands of enabled log message not evaluated" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
 	int testTarget()
 	{
 		logSetTarget(LoggingTargetNone);
@@ -133,16 +222,33 @@ protected:
 		return TestPass;
 	}
 
+	int init() override
+	{
+		/* The test relies on Info messages being compiled in. */
+		if (LIBCAMERA_LOG_MIN_SEVERITY > LogInfo)
+			return TestSkip;
+
+		return TestPass;
+	}
+
 	int run() override
 	{
 		int ret = testFile();
 		if (ret != TestPass)
 			return TestFail;
 
+		ret = testBinaryFile();
+		if (ret != TestPass)
+			return TestFail;
+
 		ret = testStream();
 		if (ret != TestPass)
 			return TestFail;
 
+		ret = testDeferredFormatting();
+		if (ret != TestPass)
+			return TestFail;
+
 		ret = testTarget();
 		if (ret != TestPass)
 			return TestFail;
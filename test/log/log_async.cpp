@@ -0,0 +1,211 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * log_async.cpp - Asynchronous logging test
+ */
+
+#include <chrono>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <libcamera/base/log.h>
+
+#include <libcamera/logging.h>
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+using namespace std::chrono_literals;
+
+LOG_DEFINE_CATEGORY(LogAsyncTest)
+
+class LogAsyncTest : public Test
+{
+protected:
+	static constexpr unsigned int kNumThreads = 4;
+	static constexpr unsigned int kNumMessages = 100;
+	static constexpr unsigned int kNumBurst = 5000;
+
+	int init() override
+	{
+		/* The test relies on Info messages being compiled in. */
+		if (LIBCAMERA_LOG_MIN_SEVERITY > LogInfo)
+			return TestSkip;
+
+		/* The logger reads the environment when first used. */
+		setenv("LIBCAMERA_LOG_ASYNC", "1", 1);
+
+		fd_ = open("/tmp", O_TMPFILE | O_RDWR, S_IRUSR | S_IWUSR);
+		if (fd_ < 0) {
+			cerr << "Failed to open tmp log file" << endl;
+			return TestFail;
+		}
+
+		snprintf(path_, sizeof(path_), "/proc/self/fd/%u", fd_);
+
+		if (logSetFile(path_) < 0) {
+			cerr << "Failed to set log file" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	/*
+	 * Return the number of messages accounted for by a log line, which is
+	 * the number of dropped messages for drop notifications and 1 for all
+	 * other lines.
+	 */
+	static unsigned int messageCount(const string &line)
+	{
+		size_t pos = line.find(" log messages dropped");
+		if (pos == string::npos)
+			return 1;
+
+		size_t start = line.rfind(' ', pos - 1) + 1;
+		return stoul(line.substr(start, pos - start));
+	}
+
+	/*
+	 * Wait until the log contains \a count messages, including the dropped
+	 * ones, and return the log lines.
+	 */
+	vector<string> waitForLines(unsigned int count)
+	{
+		vector<string> lines;
+
+		for (unsigned int i = 0; i < 100; ++i) {
+			lines.clear();
+			unsigned int total = 0;
+
+			ifstream file(path_);
+			string line;
+			while (getline(file, line)) {
+				total += messageCount(line);
+				lines.push_back(line);
+			}
+
+			if (total >= count)
+				break;
+
+			this_thread::sleep_for(10ms);
+		}
+
+		return lines;
+	}
+
+	int testOrdering()
+	{
+		vector<thread> threads;
+
+		for (unsigned int i = 0; i < kNumThreads; ++i) {
+			threads.emplace_back([i]() {
+				for (unsigned int j = 0; j < kNumMessages; ++j)
+					LOG(LogAsyncTest, Info)
+						<< "thread " << i << " message " << j;
+			});
+		}
+
+		for (thread &t : threads)
+			t.join();
+
+		vector<string> lines = waitForLines(kNumThreads * kNumMessages);
+		if (lines.size() != kNumThreads * kNumMessages) {
+			cerr << "Expected " << kNumThreads * kNumMessages
+			     << " log lines, got " << lines.size() << endl;
+			return TestFail;
+		}
+
+		/* Messages from each thread must be written in order. */
+		vector<unsigned int> next(kNumThreads, 0);
+		for (const string &line : lines) {
+			unsigned int thread, message;
+			size_t pos = line.find("thread ");
+			if (pos == string::npos ||
+			    sscanf(line.c_str() + pos, "thread %u message %u",
+				   &thread, &message) != 2 ||
+			    thread >= kNumThreads) {
+				cerr << "Invalid log line '" << line << "'" << endl;
+				return TestFail;
+			}
+
+			if (message != next[thread]) {
+				cerr << "Thread " << thread << ": expected message "
+				     << next[thread] << ", got " << message << endl;
+				return TestFail;
+			}
+
+			next[thread]++;
+		}
+
+		return TestPass;
+	}
+
+	int testDrops()
+	{
+		/* Start from an empty log. */
+		if (ftruncate(fd_, 0) < 0 || logSetFile(path_) < 0) {
+			cerr << "Failed to reset log file" << endl;
+			return TestFail;
+		}
+
+		/*
+		 * Log a burst of messages that likely overflows the ring. All
+		 * messages must be either written or accounted for as dropped.
+		 */
+		thread t([]() {
+			for (unsigned int i = 0; i < kNumBurst; ++i)
+				LOG(LogAsyncTest, Info) << "burst " << i;
+		});
+		t.join();
+
+		vector<string> lines = waitForLines(kNumBurst);
+
+		unsigned int total = 0;
+		for (const string &line : lines)
+			total += messageCount(line);
+
+		if (total != kNumBurst) {
+			cerr << "Expected " << kNumBurst
+			     << " written or dropped messages, got " << total
+			     << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		int ret = testOrdering();
+		if (ret != TestPass)
+			return ret;
+
+		return testDrops();
+	}
+
+	void cleanup() override
+	{
+		logSetTarget(LoggingTargetNone);
+
+		if (fd_ >= 0)
+			close(fd_);
+	}
+
+private:
+	int fd_ = -1;
+	char path_[32];
+};
+
+TEST_REGISTER(LogAsyncTest)
@@ -103,6 +103,24 @@ protected:
 			return TestFail;
 		}
 
+		/* Mappings of the same buffer must share the same memory. */
+		if (rw_map.planes()[0].data() != write_map.planes()[0].data()) {
+			cout << "Buffer mapping not reused" << endl;
+			return TestFail;
+		}
+
+		/* The mapping must be cached across MappedFrameBuffer instances. */
+		const uint8_t *address = rw_map.planes()[0].data();
+		maps.clear();
+
+		{
+			MappedFrameBuffer map1(buffer.get(), MappedFrameBuffer::MapFlag::Read);
+			if (!map1.isValid() || map1.planes()[0].data() != address) {
+				cout << "Buffer mapping not cached" << endl;
+				return TestFail;
+			}
+		}
+
 		return TestPass;
 	}
 
@@ -0,0 +1,134 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * media_device_cache.cpp - Test the persistent enumeration cache
+ */
+
+#include <dirent.h>
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+
+#include "libcamera/internal/enumeration_cache.h"
+#include "libcamera/internal/v4l2_subdevice.h"
+
+#include "media_device_test.h"
+
+using namespace libcamera;
+using namespace std;
+
+class MediaDeviceCacheTest : public MediaDeviceTest
+{
+protected:
+	int init() override
+	{
+		char dir[] = "/tmp/libcamera.cache.XXXXXX";
+		if (!mkdtemp(dir)) {
+			cerr << "Failed to create cache directory" << endl;
+			return TestFail;
+		}
+
+		dir_ = dir;
+		setenv("LIBCAMERA_CACHE_DIR", dir_.c_str(), 1);
+
+		return MediaDeviceTest::init();
+	}
+
+	int run() override
+	{
+		EnumerationCache *cache = media_->cache();
+		if (!cache) {
+			cerr << "Enumeration cache not created" << endl;
+			return TestFail;
+		}
+
+		/* Formats of subdevices without sink pads must be cached. */
+		MediaEntity *entity = media_->getEntityByName("Sensor A");
+		if (!entity) {
+			cerr << "Unable to find media entity 'Sensor A'" << endl;
+			return TestFail;
+		}
+
+		V4L2Subdevice sensor(entity);
+		if (sensor.open()) {
+			cerr << "Unable to open sensor subdevice" << endl;
+			return TestSkip;
+		}
+
+		V4L2Subdevice::Formats formats = sensor.formats(0);
+		if (formats.empty()) {
+			cerr << "Failed to enumerate sensor formats" << endl;
+			return TestFail;
+		}
+
+		if (cache->formats(entity->id(), 0) != formats) {
+			cerr << "Sensor formats not cached" << endl;
+			return TestFail;
+		}
+
+		/* Formats of other subdevices must not be cached. */
+		entity = media_->getEntityByName("Scaler");
+		V4L2Subdevice scaler(entity);
+		if (scaler.open()) {
+			cerr << "Unable to open scaler subdevice" << endl;
+			return TestSkip;
+		}
+
+		if (scaler.formats(1).empty()) {
+			cerr << "Failed to enumerate scaler formats" << endl;
+			return TestFail;
+		}
+
+		if (cache->formats(entity->id(), 1)) {
+			cerr << "Scaler formats shouldn't be cached" << endl;
+			return TestFail;
+		}
+
+		/* A new instance of the media device must load the cache. */
+		MediaDevice media(media_->deviceNode());
+		if (media.populate() || !media.cache()) {
+			cerr << "Failed to populate media device" << endl;
+			return TestFail;
+		}
+
+		if (media.cache()->key() != cache->key()) {
+			cerr << "Cache key mismatch" << endl;
+			return TestFail;
+		}
+
+		entity = media.getEntityByName("Sensor A");
+		if (media.cache()->formats(entity->id(), 0) != formats) {
+			cerr << "Sensor formats not loaded from cache" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	void cleanup() override
+	{
+		unsetenv("LIBCAMERA_CACHE_DIR");
+
+		if (dir_.empty())
+			return;
+
+		DIR *dir = opendir(dir_.c_str());
+		if (dir) {
+			struct dirent *ent;
+			while ((ent = readdir(dir)) != nullptr) {
+				if (ent->d_type == DT_REG)
+					unlink((dir_ + "/" + ent->d_name).c_str());
+			}
+			closedir(dir);
+		}
+
+		rmdir(dir_.c_str());
+	}
+
+private:
+	string dir_;
+};
+
+TEST_REGISTER(MediaDeviceCacheTest)
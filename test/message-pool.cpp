@@ -0,0 +1,132 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * message-pool.cpp - Message pool test
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include <libcamera/base/message_pool.h>
+#include <libcamera/base/object.h>
+#include <libcamera/base/signal.h>
+#include <libcamera/base/thread.h>
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+
+class Receiver : public Object
+{
+public:
+	Receiver()
+		: count_(0)
+	{
+	}
+
+	unsigned int count() const { return count_; }
+
+	void slot([[maybe_unused]] int value, [[maybe_unused]] const std::string &name)
+	{
+		count_++;
+	}
+
+private:
+	std::atomic<unsigned int> count_;
+};
+
+class MessagePoolTest : public Test
+{
+protected:
+	int init()
+	{
+		receiver_.moveToThread(&thread_);
+		signal_.connect(&receiver_, &Receiver::slot);
+
+		return TestPass;
+	}
+
+	bool runBatch()
+	{
+		unsigned int expected = receiver_.count() + 2 * kBatchSize;
+		bool delivered = false;
+
+		/*
+		 * Queue all messages before starting the thread, to make the
+		 * number of messages in flight deterministic.
+		 */
+		for (unsigned int i = 0; i < kBatchSize; ++i) {
+			signal_.emit(i, "signal");
+			receiver_.invokeMethod(&Receiver::slot, ConnectionTypeQueued,
+					       i, "invoke");
+		}
+
+		thread_.start();
+
+		for (unsigned int i = 0; i < 100; ++i) {
+			if (receiver_.count() == expected) {
+				delivered = true;
+				break;
+			}
+			this_thread::sleep_for(chrono::milliseconds(10));
+		}
+
+		/*
+		 * Stop the thread to ensure all messages have been freed before
+		 * checking the statistics.
+		 */
+		thread_.exit(0);
+		thread_.wait();
+
+		return delivered;
+	}
+
+	int run()
+	{
+		/* Warm up the pool. */
+		if (!runBatch()) {
+			cerr << "Failed to deliver first batch" << endl;
+			return TestFail;
+		}
+
+		MessagePool::Statistics before = MessagePool::statistics();
+
+		if (!runBatch()) {
+			cerr << "Failed to deliver second batch" << endl;
+			return TestFail;
+		}
+
+		MessagePool::Statistics after = MessagePool::statistics();
+
+		if (after.allocations - before.allocations < 2 * kBatchSize) {
+			cerr << "Messages not allocated from the pool" << endl;
+			return TestFail;
+		}
+
+		/*
+		 * All blocks used by the second batch should be recycled from
+		 * the first batch.
+		 */
+		if (after.systemAllocations != before.systemAllocations) {
+			cerr << "Steady state performed "
+			     << after.systemAllocations - before.systemAllocations
+			     << " system allocations" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+private:
+	static constexpr unsigned int kBatchSize = 64;
+
+	Thread thread_;
+	Receiver receiver_;
+	Signal<int, const std::string &> signal_;
+};
+
+TEST_REGISTER(MessagePoolTest)
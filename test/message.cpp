@@ -5,10 +5,12 @@
  * message.cpp - Messages test
  */
 
+#include <atomic>
 #include <chrono>
 #include <iostream>
 #include <memory>
 #include <thread>
+#include <vector>
 
 #include <libcamera/base/message.h>
 #include <libcamera/base/object.h>
@@ -93,6 +95,50 @@ private:
 	bool success_;
 };
 
+class SequenceMessage : public Message
+{
+public:
+	SequenceMessage(unsigned int producer, unsigned int sequence)
+		: Message(Message::None), producer_(producer), sequence_(sequence)
+	{
+	}
+
+	unsigned int producer_;
+	unsigned int sequence_;
+};
+
+class SequenceReceiver : public Object
+{
+public:
+	SequenceReceiver(unsigned int producers)
+		: sequences_(producers, 0), count_(0), outOfOrder_(false)
+	{
+	}
+
+	unsigned int count() const { return count_; }
+	bool outOfOrder() const { return outOfOrder_; }
+
+protected:
+	void message(Message *msg)
+	{
+		if (msg->type() != Message::None) {
+			Object::message(msg);
+			return;
+		}
+
+		SequenceMessage *seqMsg = static_cast<SequenceMessage *>(msg);
+		if (sequences_[seqMsg->producer_]++ != seqMsg->sequence_)
+			outOfOrder_ = true;
+
+		count_++;
+	}
+
+private:
+	std::vector<unsigned int> sequences_;
+	std::atomic<unsigned int> count_;
+	std::atomic<bool> outOfOrder_;
+};
+
 class MessageTest : public Test
 {
 protected:
@@ -154,6 +200,48 @@ protected:
 			return TestFail;
 		}
 
+		/*
+		 * Test concurrent posting from multiple threads. All messages
+		 * should be delivered, in order for each producer.
+		 */
+		constexpr unsigned int numProducers = 4;
+		constexpr unsigned int numMessages = 10000;
+
+		SequenceReceiver *seqReceiver = new SequenceReceiver(numProducers);
+		seqReceiver->moveToThread(&thread_);
+
+		std::vector<std::thread> producers;
+		for (unsigned int i = 0; i < numProducers; ++i) {
+			producers.emplace_back([seqReceiver, i]() {
+				for (unsigned int j = 0; j < numMessages; ++j)
+					seqReceiver->postMessage(std::make_unique<SequenceMessage>(i, j));
+			});
+		}
+
+		for (std::thread &producer : producers)
+			producer.join();
+
+		for (unsigned int i = 0; i < 100; ++i) {
+			if (seqReceiver->count() == numProducers * numMessages)
+				break;
+			this_thread::sleep_for(chrono::milliseconds(10));
+		}
+
+		unsigned int count = seqReceiver->count();
+		bool outOfOrder = seqReceiver->outOfOrder();
+		seqReceiver->deleteLater();
+
+		if (count != numProducers * numMessages) {
+			cout << "Received " << count << " messages, expected "
+			     << numProducers * numMessages << endl;
+			return TestFail;
+		}
+
+		if (outOfOrder) {
+			cout << "Messages received out of order" << endl;
+			return TestFail;
+		}
+
 		return TestPass;
 	}
 
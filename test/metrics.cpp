@@ -0,0 +1,100 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * metrics.cpp - Performance metrics test
+ */
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "libcamera/internal/metrics.h"
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+
+namespace {
+
+MetricCounter counter("test.counter");
+MetricCounter duplicateCounter("test.counter");
+MetricGauge gauge("test.gauge");
+MetricHistogram histogram("test.histogram", { 10, 100 });
+
+} /* namespace */
+
+class MetricsTest : public Test
+{
+protected:
+	int run()
+	{
+		/* Update the counter and histogram from multiple threads. */
+		vector<thread> threads;
+
+		for (unsigned int i = 0; i < kNumThreads; ++i) {
+			threads.emplace_back([] {
+				for (unsigned int j = 0; j < kNumIterations; ++j)
+					counter.add();
+
+				histogram.record(5);
+				histogram.record(10);
+				histogram.record(50);
+				histogram.record(1000);
+			});
+		}
+
+		for (thread &t : threads)
+			t.join();
+
+		/* Update from the main thread, which is still running. */
+		duplicateCounter.add(3);
+		gauge.set(10);
+		gauge.add(-4);
+
+		MetricsSnapshot snapshot = metrics::snapshot();
+
+		uint64_t expected = kNumThreads * kNumIterations + 3;
+		if (snapshot.counters["test.counter"] != expected) {
+			cerr << "Invalid counter value "
+			     << snapshot.counters["test.counter"]
+			     << ", expected " << expected << endl;
+			return TestFail;
+		}
+
+		if (snapshot.gauges["test.gauge"] != 6) {
+			cerr << "Invalid gauge value "
+			     << snapshot.gauges["test.gauge"] << endl;
+			return TestFail;
+		}
+
+		auto it = snapshot.histograms.find("test.histogram");
+		if (it == snapshot.histograms.end()) {
+			cerr << "Histogram missing from snapshot" << endl;
+			return TestFail;
+		}
+
+		const MetricsSnapshot::Histogram &h = it->second;
+		const vector<uint64_t> buckets = { 2 * kNumThreads, kNumThreads, kNumThreads };
+
+		if (h.buckets != buckets) {
+			cerr << "Invalid histogram buckets" << endl;
+			return TestFail;
+		}
+
+		if (h.count != 4 * kNumThreads || h.sum != 1065 * kNumThreads) {
+			cerr << "Invalid histogram count " << h.count << " or sum "
+			     << h.sum << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+private:
+	static constexpr unsigned int kNumThreads = 8;
+	static constexpr unsigned int kNumIterations = 10000;
+};
+
+TEST_REGISTER(MetricsTest)
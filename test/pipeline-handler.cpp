@@ -0,0 +1,424 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * pipeline-handler.cpp - Pipeline handler request handling tests
+ */
+
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdint.h>
+#include <tuple>
+#include <vector>
+
+#include <libcamera/base/message.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/utils.h>
+
+#include <libcamera/camera.h>
+#include <libcamera/control_ids.h>
+#include <libcamera/controls.h>
+#include <libcamera/framebuffer.h>
+#include <libcamera/request.h>
+#include <libcamera/stream.h>
+
+#include "libcamera/internal/camera.h"
+#include "libcamera/internal/framebuffer.h"
+#include "libcamera/internal/pipeline_handler.h"
+#include "libcamera/internal/request.h"
+
+#include "test.h"
+
+using namespace libcamera;
+using namespace std;
+
+namespace {
+
+class MockCameraConfiguration : public CameraConfiguration
+{
+public:
+	Status validate() override
+	{
+		return Valid;
+	}
+};
+
+/*
+ * A pipeline handler that captures frames on demand. Each request queued to
+ * the device is applied to the first frame that starts after it has been
+ * queued, and completes with that frame.
+ */
+class MockPipelineHandler : public PipelineHandler
+{
+public:
+	MockPipelineHandler(CameraManager *manager)
+		: PipelineHandler(manager), firstFrame_(0), frame_(0)
+	{
+	}
+
+	bool match([[maybe_unused]] DeviceEnumerator *enumerator) override
+	{
+		return false;
+	}
+
+	std::unique_ptr<CameraConfiguration>
+	generateConfiguration([[maybe_unused]] Camera *camera,
+			      [[maybe_unused]] Span<const StreamRole> roles) override
+	{
+		return nullptr;
+	}
+
+	int configure([[maybe_unused]] Camera *camera,
+		      CameraConfiguration *config) override
+	{
+		config->at(0).setStream(&stream_);
+		return 0;
+	}
+
+	int exportFrameBuffers([[maybe_unused]] Camera *camera,
+			       [[maybe_unused]] Stream *stream,
+			       [[maybe_unused]] std::vector<std::unique_ptr<FrameBuffer>> *buffers) override
+	{
+		return -ENOTSUP;
+	}
+
+	int start(Camera *camera, [[maybe_unused]] const ControlList *controls) override
+	{
+		frame_ = firstFrame_;
+		camera->_d()->nextFrame_ = firstFrame_;
+		return 0;
+	}
+
+	void captureFrame(Camera *camera)
+	{
+		Request *request = nullptr;
+		if (!queue_.empty()) {
+			request = queue_.front();
+			queue_.pop_front();
+		}
+
+		/* Requests queued from now on apply to the next frame. */
+		frameStarted(camera, frame_);
+
+		if (request) {
+			frames_[request->cookie()] = frame_;
+			for (const auto &[stream, buffer] : request->buffers()) {
+				buffer->_d()->metadata().status = FrameMetadata::FrameSuccess;
+				completeBuffer(request, buffer);
+			}
+			completeRequest(request);
+		}
+
+		frame_++;
+	}
+
+	Stream stream_;
+	uint32_t firstFrame_;
+	std::deque<Request *> queue_;
+	std::map<uint64_t, uint32_t> frames_;
+
+protected:
+	int queueRequestDevice([[maybe_unused]] Camera *camera,
+			       Request *request) override
+	{
+		queue_.push_back(request);
+		return 0;
+	}
+
+	void stopDevice([[maybe_unused]] Camera *camera) override
+	{
+		while (!queue_.empty()) {
+			Request *request = queue_.front();
+			queue_.pop_front();
+
+			request->_d()->cancel();
+			completeRequest(request);
+		}
+	}
+
+private:
+	uint32_t frame_;
+};
+
+REGISTER_PIPELINE_HANDLER(MockPipelineHandler)
+
+} /* namespace */
+
+class PipelineHandlerTest : public Test
+{
+protected:
+	int init() override
+	{
+		for (PipelineHandlerFactoryBase *factory : PipelineHandlerFactoryBase::factories()) {
+			if (factory->name() == "MockPipelineHandler") {
+				pipe_ = std::static_pointer_cast<MockPipelineHandler>(factory->create(nullptr));
+				break;
+			}
+		}
+
+		if (!pipe_) {
+			cerr << "Failed to create the mock pipeline handler" << endl;
+			return TestFail;
+		}
+
+		camera_ = Camera::create(std::make_unique<Camera::Private>(pipe_.get()),
+					 "mock", { &pipe_->stream_ });
+		camera_->metadataAvailable.connect(this, &PipelineHandlerTest::metadataAvailable);
+		camera_->requestCompleted.connect(this, &PipelineHandlerTest::requestComplete);
+
+		if (camera_->acquire()) {
+			cerr << "Failed to acquire the camera" << endl;
+			return TestFail;
+		}
+
+		MockCameraConfiguration config;
+		config.addConfiguration(StreamConfiguration());
+
+		if (camera_->configure(&config)) {
+			cerr << "Failed to configure the camera" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		/* Run from the first frame, and right before the sequence wraps around. */
+		for (uint32_t first : { 0U, UINT32_MAX - 2 }) {
+			if (testTargetSequence(first) != TestPass)
+				return TestFail;
+		}
+
+		if (testMetadataAvailable() != TestPass)
+			return TestFail;
+
+		return TestPass;
+	}
+
+	void cleanup() override
+	{
+		if (camera_) {
+			camera_->stop();
+			camera_->release();
+		}
+
+		requests_.clear();
+		buffers_.clear();
+		camera_.reset();
+		pipe_.reset();
+	}
+
+private:
+	int testTargetSequence(uint32_t first)
+	{
+		pipe_->firstFrame_ = first;
+		pipe_->frames_.clear();
+		completed_.clear();
+
+		if (camera_->start()) {
+			cerr << "Failed to start the camera" << endl;
+			return TestFail;
+		}
+
+		/*
+		 * The first request is queued to the device immediately. The
+		 * second one is held until the frame before its target has
+		 * started, along with the request queued after it.
+		 */
+		Request *request0 = queueRequest();
+		Request *request1 = queueRequest(first + 5);
+		Request *request2 = queueRequest();
+
+		if (pipe_->queue_.size() != 1) {
+			cerr << "Request with a target frame not held" << endl;
+			return TestFail;
+		}
+
+		for (unsigned int i = 0; i < 4; ++i)
+			pipe_->captureFrame(camera_.get());
+
+		if (!pipe_->queue_.empty() || completed_.size() != 1) {
+			cerr << "Request queued before its target frame" << endl;
+			return TestFail;
+		}
+
+		pipe_->captureFrame(camera_.get());
+
+		if (pipe_->queue_.size() != 2) {
+			cerr << "Held requests not queued in time" << endl;
+			return TestFail;
+		}
+
+		/* A request whose target frame has passed is queued immediately. */
+		Request *request3 = queueRequest(first + 2);
+
+		if (pipe_->queue_.size() != 3) {
+			cerr << "Request with a missed target frame held" << endl;
+			return TestFail;
+		}
+
+		for (unsigned int i = 0; i < 3; ++i)
+			pipe_->captureFrame(camera_.get());
+
+		const std::vector<std::pair<Request *, uint32_t>> expected = {
+			{ request0, first },
+			{ request1, first + 5 },
+			{ request2, first + 6 },
+			{ request3, first + 7 },
+		};
+
+		if (completed_.size() != expected.size()) {
+			cerr << "Invalid number of completed requests "
+			     << completed_.size() << endl;
+			return TestFail;
+		}
+
+		for (const auto &[index, entry] : utils::enumerate(expected)) {
+			const auto &[request, frame] = entry;
+
+			if (completed_[index] != request) {
+				cerr << "Request " << request->cookie()
+				     << " completed out of order" << endl;
+				return TestFail;
+			}
+
+			if (pipe_->frames_[request->cookie()] != frame) {
+				cerr << "Request " << request->cookie()
+				     << " applied to frame "
+				     << pipe_->frames_[request->cookie()]
+				     << ", expected " << frame << endl;
+				return TestFail;
+			}
+		}
+
+		/* Held requests are cancelled when the camera is stopped. */
+		Request *request4 = queueRequest(first + 100);
+
+		camera_->stop();
+
+		if (completed_.size() != expected.size() + 1 ||
+		    completed_.back() != request4 ||
+		    request4->status() != Request::RequestCancelled) {
+			cerr << "Held request not cancelled at stop time" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	int testMetadataAvailable()
+	{
+		completed_.clear();
+		metadata_.clear();
+
+		if (camera_->start()) {
+			cerr << "Failed to start the camera" << endl;
+			return TestFail;
+		}
+
+		Request *request = queueRequest();
+
+		/* Metadata is reported before the request completes. */
+		ControlList metadata(controls::controls);
+		metadata.set(controls::SensorTimestamp, 1000);
+		metadata.set(controls::ExposureTime, 10000);
+		pipe_->metadataAvailable(request, metadata);
+
+		/* Empty metadata is not reported. */
+		pipe_->metadataAvailable(request, ControlList(controls::controls));
+
+		/* Later metadata overwrites the values reported earlier. */
+		metadata.clear();
+		metadata.set(controls::ExposureTime, 20000);
+		metadata.set(controls::AnalogueGain, 2.0f);
+		pipe_->metadataAvailable(request, metadata);
+
+		if (metadata_.size() != 2) {
+			cerr << "Invalid number of metadata signals "
+			     << metadata_.size() << endl;
+			return TestFail;
+		}
+
+		for (const auto &[req, list, status] : metadata_) {
+			if (req != request || status != Request::RequestPending) {
+				cerr << "Metadata not reported early" << endl;
+				return TestFail;
+			}
+		}
+
+		/* Each signal carries the newly available metadata only. */
+		const ControlList &first = std::get<1>(metadata_[0]);
+		const ControlList &second = std::get<1>(metadata_[1]);
+
+		if (first.size() != 2 || first.get(controls::ExposureTime) != 10000 ||
+		    second.size() != 2 || second.get(controls::SensorTimestamp) ||
+		    second.get(controls::ExposureTime) != 20000) {
+			cerr << "Invalid metadata in signal" << endl;
+			return TestFail;
+		}
+
+		pipe_->captureFrame(camera_.get());
+
+		if (completed_.size() != 1 || completed_[0] != request) {
+			cerr << "Request not completed" << endl;
+			return TestFail;
+		}
+
+		/* The request metadata accumulates all the reported metadata. */
+		const ControlList &result = request->metadata();
+
+		if (result.get(controls::SensorTimestamp) != 1000 ||
+		    result.get(controls::ExposureTime) != 20000 ||
+		    result.get(controls::AnalogueGain) != 2.0f) {
+			cerr << "Invalid request metadata" << endl;
+			return TestFail;
+		}
+
+		camera_->stop();
+
+		return TestPass;
+	}
+
+	Request *queueRequest(std::optional<uint32_t> target = std::nullopt)
+	{
+		std::unique_ptr<FrameBuffer> buffer =
+			std::make_unique<FrameBuffer>(std::vector<FrameBuffer::Plane>{});
+		std::unique_ptr<Request> request = camera_->createRequest(requests_.size());
+
+		request->addBuffer(&pipe_->stream_, buffer.get());
+		request->setTargetSequence(target);
+		camera_->queueRequest(request.get());
+
+		/* Requests are queued to the pipeline handler asynchronously. */
+		Thread::current()->dispatchMessages(Message::Type::InvokeMessage);
+
+		buffers_.push_back(std::move(buffer));
+		requests_.push_back(std::move(request));
+
+		return requests_.back().get();
+	}
+
+	void metadataAvailable(Request *request, const ControlList &metadata)
+	{
+		metadata_.emplace_back(request, metadata, request->status());
+	}
+
+	void requestComplete(Request *request)
+	{
+		completed_.push_back(request);
+	}
+
+	std::shared_ptr<MockPipelineHandler> pipe_;
+	std::shared_ptr<Camera> camera_;
+
+	std::vector<std::unique_ptr<FrameBuffer>> buffers_;
+	std::vector<std::unique_ptr<Request>> requests_;
+	std::vector<std::tuple<Request *, ControlList, Request::Status>> metadata_;
+	std::vector<Request *> completed_;
+};
+
+TEST_REGISTER(PipelineHandlerTest)
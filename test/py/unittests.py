@@ -3,9 +3,11 @@
 # SPDX-License-Identifier: GPL-2.0-or-later
 # Copyright (C) 2022, Tomi Valkeinen <tomi.valkeinen@ideasonboard.com>
 
+import asyncio
 from collections import defaultdict
 import gc
 import libcamera as libcam
+import libcamera.utils
 import selectors
 import typing
 import unittest
@@ -162,6 +164,56 @@ class AllocatorTestMethods(CameraTesterBase):
         self.assertIsDead(wr_streamconfig)
 
 
+class MappedFrameBufferMethods(CameraTesterBase):
+    def test_mapped_buffer(self):
+        cam = self.cam
+
+        camconfig = cam.generate_configuration([libcam.StreamRole.StillCapture])
+        cam.configure(camconfig)
+
+        stream = camconfig.at(0).stream
+
+        allocator = libcam.FrameBufferAllocator(cam)
+        num_bufs = allocator.allocate(stream)
+        self.assertTrue(num_bufs > 0)
+
+        buffer = allocator.buffers(stream)[0]
+
+        with libcam.MappedFrameBuffer(buffer) as mfb:
+            self.assertEqual(len(mfb.planes), len(buffer.planes))
+
+            plane = mfb.planes[0]
+            mv = memoryview(plane)
+            self.assertFalse(mv.readonly)
+            self.assertEqual(mv.nbytes, buffer.planes[0].length)
+            self.assertEqual(len(plane), buffer.planes[0].length)
+
+            interface = plane.__array_interface__
+            self.assertEqual(interface['shape'], (buffer.planes[0].length,))
+            self.assertEqual(interface['typestr'], '|u1')
+
+            mv[0:4] = b'\x01\x02\x03\x04'
+
+        # The memoryview keeps the mapping alive after munmap().
+        self.assertEqual(bytes(mv[0:4]), b'\x01\x02\x03\x04')
+        mv.release()
+
+        # The data is accessed in place, without copies.
+        with libcam.MappedFrameBuffer(buffer, write=False) as mfb:
+            mv = memoryview(mfb.planes[0])
+            self.assertTrue(mv.readonly)
+            self.assertEqual(bytes(mv[0:4]), b'\x01\x02\x03\x04')
+            mv.release()
+
+        mfb = libcam.MappedFrameBuffer(buffer)
+        with self.assertRaises(RuntimeError):
+            mfb.planes
+        mfb.mmap()
+        with self.assertRaises(RuntimeError):
+            mfb.mmap()
+        mfb.munmap()
+
+
 class SimpleCaptureMethods(CameraTesterBase):
     def test_blocking(self):
         cm = self.cm
@@ -298,6 +350,73 @@ class SimpleCaptureMethods(CameraTesterBase):
 
         cam.stop()
 
+    def test_asyncio(self):
+        cm = self.cm
+        cam = self.cam
+
+        camconfig = cam.generate_configuration([libcam.StreamRole.StillCapture])
+        self.assertTrue(camconfig.size == 1)
+
+        streamconfig = camconfig.at(0)
+
+        cam.configure(camconfig)
+
+        stream = streamconfig.stream
+
+        allocator = libcam.FrameBufferAllocator(cam)
+        num_bufs = allocator.allocate(stream)
+        self.assertTrue(num_bufs > 0)
+
+        reqs = []
+        for i in range(num_bufs):
+            req = cam.create_request(i)
+            self.assertIsNotNone(req)
+
+            req.add_buffer(stream, allocator.buffers(stream)[i])
+            req.controls[libcam.controls.Brightness] = 0.5
+            self.assertIn(libcam.controls.Brightness, req.controls)
+
+            reqs.append(req)
+
+        async def capture():
+            ready = []
+
+            async with libcamera.utils.AsyncCameraManager(cm) as acm:
+                cam.start()
+
+                for req in reqs:
+                    cam.queue_request(req)
+
+                async for req in acm:
+                    ready.append(req)
+                    if len(ready) == num_bufs:
+                        break
+
+            return ready
+
+        ready = asyncio.run(asyncio.wait_for(capture(), timeout=5))
+
+        self.assertTrue(len(ready) == num_bufs)
+
+        for i, req in enumerate(ready):
+            self.assertTrue(i == req.cookie)
+
+            metadata = req.metadata
+            self.assertIsInstance(metadata, libcam.ControlList)
+            self.assertIn(libcam.controls.SensorTimestamp, metadata)
+            self.assertEqual(len(metadata), len(metadata.items()))
+            self.assertEqual(dict(metadata.items())[libcam.controls.SensorTimestamp],
+                             metadata[libcam.controls.SensorTimestamp])
+            self.assertEqual(metadata.sensor_timestamp,
+                             metadata[libcam.controls.SensorTimestamp])
+            self.assertIsNone(metadata.get(libcam.controls.AfState))
+
+        reqs = None
+        ready = None
+        gc.collect()
+
+        cam.stop()
+
 
 # Recursively expand slist's objects into olist, using seen to track already
 # processed objects.
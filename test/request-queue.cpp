@@ -0,0 +1,82 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * request-queue.cpp - RequestQueue tests
+ */
+
+#include <iostream>
+#include <stdint.h>
+
+#include "libcamera/internal/request_queue.h"
+
+#include "test.h"
+
+using namespace libcamera;
+using namespace std;
+
+class RequestQueueTest : public Test
+{
+protected:
+	/* The queue never dereferences requests, use fake pointers. */
+	static Request *request(uint32_t sequence)
+	{
+		return reinterpret_cast<Request *>(static_cast<uintptr_t>(sequence) + 1);
+	}
+
+	int run() override
+	{
+		/* Start close to the wrap-around point and grow the ring. */
+		RequestQueue queue(4);
+		const uint32_t first = UINT32_MAX - 1;
+
+		for (uint32_t seq = first; seq != first + 8; ++seq)
+			queue.push(seq, request(seq));
+
+		if (queue.size() != 8 || queue.front() != request(first)) {
+			cerr << "Invalid queue after push" << endl;
+			return TestFail;
+		}
+
+		/* Out-of-order removal must not change the front. */
+		queue.remove(first + 3);
+		queue.remove(first + 1);
+
+		if (queue.size() != 6 || queue.front() != request(first)) {
+			cerr << "Invalid queue after out-of-order removal" << endl;
+			return TestFail;
+		}
+
+		/* Popping the front must skip removed requests. */
+		queue.pop();
+		if (queue.front() != request(first + 2)) {
+			cerr << "Removed request not skipped" << endl;
+			return TestFail;
+		}
+
+		queue.pop();
+		if (queue.front() != request(first + 4)) {
+			cerr << "Removed request not skipped" << endl;
+			return TestFail;
+		}
+
+		while (!queue.empty())
+			queue.pop();
+
+		if (queue.size() != 0 || queue.front()) {
+			cerr << "Queue not empty" << endl;
+			return TestFail;
+		}
+
+		/* An empty queue accepts any sequence number. */
+		queue.push(0, request(0));
+		if (queue.front() != request(0)) {
+			cerr << "Invalid queue after restart" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+};
+
+TEST_REGISTER(RequestQueueTest)
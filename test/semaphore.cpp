@@ -0,0 +1,176 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * semaphore.cpp - Semaphore test and blocking invocation benchmark
+ */
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include <libcamera/base/object.h>
+#include <libcamera/base/semaphore.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/utils.h>
+
+#include "test.h"
+
+using namespace libcamera;
+using namespace std;
+using namespace std::chrono_literals;
+
+class EchoObject : public Object
+{
+public:
+	int echo(int value)
+	{
+		return value;
+	}
+};
+
+class SemaphoreTest : public Test
+{
+protected:
+	static constexpr unsigned int kNumIterations = 10000;
+
+	int testBasic()
+	{
+		Semaphore semaphore(2);
+
+		if (semaphore.available() != 2) {
+			cerr << "Invalid initial resource count" << endl;
+			return TestFail;
+		}
+
+		if (semaphore.tryAcquire(3) || !semaphore.tryAcquire(2) ||
+		    semaphore.tryAcquire()) {
+			cerr << "Invalid tryAcquire() result" << endl;
+			return TestFail;
+		}
+
+		semaphore.release(3);
+		semaphore.acquire(3);
+
+		if (semaphore.available() != 0) {
+			cerr << "Invalid resource count after acquire" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	int testBlocking()
+	{
+		Semaphore semaphore;
+		bool acquired = false;
+
+		/* Acquire two resources, released one at a time. */
+		thread t([&]() {
+			semaphore.acquire(2);
+			acquired = true;
+		});
+
+		this_thread::sleep_for(50ms);
+		semaphore.release();
+		this_thread::sleep_for(50ms);
+
+		if (semaphore.available() != 1) {
+			cerr << "Resource acquired before being available" << endl;
+			t.detach();
+			return TestFail;
+		}
+
+		semaphore.release();
+		t.join();
+
+		if (!acquired || semaphore.available() != 0) {
+			cerr << "Failed to acquire released resources" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	/* Measure the round-trip latency of a semaphore ping-pong. */
+	chrono::nanoseconds pingPong(unsigned int spinCount)
+	{
+		Semaphore ping;
+		Semaphore pong;
+
+		ping.setSpinCount(spinCount);
+		pong.setSpinCount(spinCount);
+
+		thread t([&]() {
+			for (unsigned int i = 0; i < kNumIterations; ++i) {
+				ping.acquire();
+				pong.release();
+			}
+		});
+
+		utils::time_point start = utils::clock::now();
+
+		for (unsigned int i = 0; i < kNumIterations; ++i) {
+			ping.release();
+			pong.acquire();
+		}
+
+		utils::time_point end = utils::clock::now();
+
+		t.join();
+
+		return (end - start) / kNumIterations;
+	}
+
+	int testInvokeLatency()
+	{
+		Thread thread;
+		EchoObject object;
+
+		object.moveToThread(&thread);
+		thread.start();
+
+		utils::time_point start = utils::clock::now();
+
+		for (unsigned int i = 0; i < kNumIterations; ++i) {
+			int ret = object.invokeMethod(&EchoObject::echo,
+						      ConnectionTypeBlocking, i);
+			if (ret != static_cast<int>(i)) {
+				cerr << "Invalid blocking call return value" << endl;
+				thread.exit();
+				thread.wait();
+				return TestFail;
+			}
+		}
+
+		utils::time_point end = utils::clock::now();
+
+		thread.exit();
+		thread.wait();
+
+		cout << "Blocking invokeMethod() round-trip: "
+		     << chrono::duration_cast<chrono::nanoseconds>(end - start).count() / kNumIterations
+		     << " ns" << endl;
+
+		return TestPass;
+	}
+
+	int run()
+	{
+		int ret = testBasic();
+		if (ret != TestPass)
+			return ret;
+
+		ret = testBlocking();
+		if (ret != TestPass)
+			return ret;
+
+		cout << "Semaphore ping-pong round-trip: "
+		     << pingPong(0).count() << " ns (blocking), ";
+		cout << pingPong(100).count() << " ns (spinning)" << endl;
+
+		return testInvokeLatency();
+	}
+};
+
+TEST_REGISTER(SemaphoreTest)
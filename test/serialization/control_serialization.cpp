@@ -6,6 +6,7 @@
  */
 
 #include <iostream>
+#include <vector>
 
 #include <libcamera/camera.h>
 #include <libcamera/control_ids.h>
@@ -169,6 +170,129 @@ protected:
 			return TestFail;
 		}
 
+		return testDelta();
+	}
+
+private:
+	std::vector<uint8_t> serialize(ControlSerializer &serializer,
+				       const ControlList &list)
+	{
+		std::vector<uint8_t> data(serializer.binarySize(list));
+		ByteStreamBuffer buffer(data.data(), data.size());
+
+		if (serializer.serialize(list, buffer) || buffer.overflow())
+			return {};
+
+		data.resize(buffer.offset());
+		return data;
+	}
+
+	ControlList deserialize(ControlSerializer &deserializer,
+				const std::vector<uint8_t> &data)
+	{
+		ByteStreamBuffer buffer(data.data(), data.size());
+		return deserializer.deserialize<ControlList>(buffer);
+	}
+
+	int testDelta()
+	{
+		ControlSerializer serializer(ControlSerializer::Role::Proxy);
+		ControlSerializer deserializer(ControlSerializer::Role::Worker);
+
+		serializer.setDeltaEncoding(true);
+		deserializer.setDeltaEncoding(true);
+
+		ControlList list(controls::controls);
+		list.set(controls::Brightness, 0.5f);
+		list.set(controls::Contrast, 1.2f);
+		list.set(controls::Saturation, 0.2f);
+		list.set(controls::ExposureTime, 10000);
+
+		/*
+		 * Exchange lists in both directions to negotiate delta
+		 * encoding, and serialize a full list that will serve as the
+		 * baseline.
+		 */
+		deserialize(deserializer, serialize(serializer, list));
+		deserialize(serializer, serialize(deserializer, list));
+
+		std::vector<uint8_t> fullData = serialize(serializer, list);
+		ControlList newList = deserialize(deserializer, fullData);
+		if (!equals(list, newList)) {
+			cerr << "Deserialized baseline list doesn't match original"
+			     << endl;
+			return TestFail;
+		}
+
+		/* Modify one control and verify that only the delta is sent. */
+		list.set(controls::ExposureTime, 20000);
+
+		std::vector<uint8_t> deltaData = serialize(serializer, list);
+		if (deltaData.empty() || deltaData.size() >= fullData.size()) {
+			cerr << "Delta-encoded list isn't smaller than the full list"
+			     << endl;
+			return TestFail;
+		}
+
+		newList = deserialize(deserializer, deltaData);
+		if (!equals(list, newList)) {
+			cerr << "Deserialized delta list doesn't match original"
+			     << endl;
+			return TestFail;
+		}
+
+		/* Remove and add controls. */
+		ControlList otherList(controls::controls);
+		otherList.set(controls::Brightness, 0.5f);
+		otherList.set(controls::Saturation, 0.2f);
+		otherList.set(controls::ExposureTime, 20000);
+		otherList.set(controls::AnalogueGain, 2.0f);
+
+		newList = deserialize(deserializer, serialize(serializer, otherList));
+		if (!equals(otherList, newList)) {
+			cerr << "Deserialized list with removed controls doesn't match original"
+			     << endl;
+			return TestFail;
+		}
+
+		/*
+		 * Drop a delta-encoded list, and verify that the next one
+		 * fails to deserialize.
+		 */
+		otherList.set(controls::AnalogueGain, 3.0f);
+		serialize(serializer, otherList);
+
+		otherList.set(controls::AnalogueGain, 4.0f);
+		newList = deserialize(deserializer, serialize(serializer, otherList));
+		if (!newList.empty()) {
+			cerr << "Delta-encoded list without baseline should have failed"
+			     << endl;
+			return TestFail;
+		}
+
+		/*
+		 * The deserializer requests a resync with the next packet it
+		 * sends, after which the serializer sends a full list.
+		 */
+		deserialize(serializer, serialize(deserializer, list));
+
+		otherList.set(controls::AnalogueGain, 5.0f);
+		newList = deserialize(deserializer, serialize(serializer, otherList));
+		if (!equals(otherList, newList)) {
+			cerr << "Deserialized list after resync doesn't match original"
+			     << endl;
+			return TestFail;
+		}
+
+		/* Delta encoding resumes after the resync. */
+		otherList.set(controls::AnalogueGain, 6.0f);
+		deltaData = serialize(serializer, otherList);
+		newList = deserialize(deserializer, deltaData);
+		if (!equals(otherList, newList) || deltaData.size() >= fullData.size()) {
+			cerr << "Delta encoding not resumed after resync" << endl;
+			return TestFail;
+		}
+
 		return TestPass;
 	}
 };
@@ -51,6 +51,12 @@ public:
 		value_ = value;
 	}
 
+	int slotReturn(int value)
+	{
+		slot(value);
+		return value;
+	}
+
 private:
 	Status status_;
 	int value_;
@@ -64,6 +70,14 @@ protected:
 		receiver_ = new SignalReceiver();
 		signal_.connect(receiver_, &SignalReceiver::slot);
 
+		/*
+		 * Connect a second receiver, with a slot returning a value, to
+		 * test that the arguments shared between the slots are
+		 * delivered correctly to both.
+		 */
+		returnReceiver_ = new SignalReceiver();
+		signal_.connect(returnReceiver_, &SignalReceiver::slotReturn);
+
 		return TestPass;
 	}
 
@@ -90,6 +104,8 @@ protected:
 		 */
 		receiver_->reset();
 		receiver_->moveToThread(&thread_);
+		returnReceiver_->reset();
+		returnReceiver_->moveToThread(&thread_);
 
 		thread_.start();
 
@@ -114,18 +130,26 @@ protected:
 			return TestFail;
 		}
 
+		if (returnReceiver_->status() != SignalReceiver::SignalReceived ||
+		    returnReceiver_->value() != 42) {
+			cout << "Signal not received correctly by second receiver" << endl;
+			return TestFail;
+		}
+
 		return TestPass;
 	}
 
 	void cleanup()
 	{
 		receiver_->deleteLater();
+		returnReceiver_->deleteLater();
 		thread_.exit(0);
 		thread_.wait();
 	}
 
 private:
 	SignalReceiver *receiver_;
+	SignalReceiver *returnReceiver_;
 	Thread thread_;
 
 	Signal<int> signal_;
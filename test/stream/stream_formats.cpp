@@ -94,6 +94,29 @@ protected:
 			      Size(2560, 2048), Size(3200, 2048), }))
 			return TestFail;
 
+		/* Test ranges generated from discrete sizes */
+		SizeRange generated = discrete.range(PixelFormat(2));
+		if (generated.min != Size(300, 300) || generated.max != Size(400, 400) ||
+		    generated.hStep || generated.vStep) {
+			cout << "Failed generated range " << generated << endl;
+			return TestFail;
+		}
+
+		/* Test unknown pixel formats */
+		if (!discrete.sizes(PixelFormat(3)).empty() ||
+		    !discrete.range(PixelFormat(3)).max.isNull()) {
+			cout << "Failed unknown pixel format" << endl;
+			return TestFail;
+		}
+
+		/* Test that copies share the same data */
+		StreamFormats copy = range;
+		if (&copy.sizes(PixelFormat(2)) != &range.sizes(PixelFormat(2)) ||
+		    copy.pixelformats() != range.pixelformats()) {
+			cout << "Failed copy" << endl;
+			return TestFail;
+		}
+
 		return TestPass;
 	}
 };
@@ -0,0 +1,146 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * thread-pool.cpp - Thread pool test
+ */
+
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+#include <libcamera/base/semaphore.h>
+#include <libcamera/base/thread.h>
+
+#include "libcamera/internal/thread_pool.h"
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+
+class ThreadPoolTest : public Test
+{
+protected:
+	int testQueue()
+	{
+		ThreadPool pool("TestPool", 4);
+		atomic<unsigned int> count = 0;
+
+		for (unsigned int i = 0; i < 100; ++i)
+			pool.queue([&]() { count++; });
+
+		pool.wait();
+
+		if (count != 100) {
+			cerr << "Ran " << count << " tasks, expected 100" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	int testQueueStrips()
+	{
+		ThreadPool pool("TestPool", 4);
+		vector<unsigned int> strips(pool.threads());
+		vector<Thread *> threads(pool.threads());
+		atomic<unsigned int> failures = 0;
+		Semaphore done;
+
+		/*
+		 * Strips with the same index must be processed by the same
+		 * thread, the counters are thus not atomic.
+		 */
+		for (unsigned int frame = 0; frame < 10; ++frame) {
+			pool.queueStrips([&](unsigned int index, unsigned int count) {
+				if (count != strips.size() || index >= count) {
+					failures++;
+					return;
+				}
+
+				if (!threads[index])
+					threads[index] = Thread::current();
+				else if (threads[index] != Thread::current())
+					failures++;
+
+				strips[index]++;
+			}, [&]() { done.release(); });
+		}
+
+		pool.wait();
+
+		if (!done.tryAcquire(10)) {
+			cerr << "Strip jobs didn't complete" << endl;
+			return TestFail;
+		}
+
+		if (failures) {
+			cerr << failures << " strips processed with invalid parameters"
+			     << " or by the wrong thread" << endl;
+			return TestFail;
+		}
+
+		for (unsigned int i = 0; i < strips.size(); ++i) {
+			if (strips[i] != 10) {
+				cerr << "Strip " << i << " processed " << strips[i]
+				     << " times, expected 10" << endl;
+				return TestFail;
+			}
+		}
+
+		return TestPass;
+	}
+
+	int testRunStrips()
+	{
+		ThreadPool pool("TestPool", 4);
+		const unsigned int numStrips = pool.threads() + 1;
+		atomic<unsigned int> failures = 0;
+
+		/*
+		 * Run strips from within the pool, with all threads busy. The
+		 * callers must process the strips by themselves.
+		 */
+		for (unsigned int i = 0; i < pool.threads(); ++i) {
+			pool.queue([&]() {
+				vector<atomic<bool>> strips(numStrips);
+
+				pool.runStrips([&](unsigned int index, unsigned int count) {
+					if (count == numStrips && index < count)
+						strips[index] = true;
+				});
+
+				for (const atomic<bool> &strip : strips) {
+					if (!strip)
+						failures++;
+				}
+			});
+		}
+
+		pool.wait();
+
+		if (failures) {
+			cerr << failures << " strips not processed" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		if (testQueue() != TestPass)
+			return TestFail;
+
+		if (testQueueStrips() != TestPass)
+			return TestFail;
+
+		if (testRunStrips() != TestPass)
+			return TestFail;
+
+		return TestPass;
+	}
+};
+
+TEST_REGISTER(ThreadPoolTest)
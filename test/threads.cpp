@@ -9,6 +9,8 @@
 #include <iostream>
 #include <memory>
 #include <pthread.h>
+#include <sched.h>
+#include <string.h>
 #include <thread>
 #include <time.h>
 
@@ -66,6 +68,31 @@ private:
 	bool &cancelled_;
 };
 
+class ParamsThread : public Thread
+{
+public:
+	ParamsThread(const std::string &name)
+		: Thread(name)
+	{
+		CPU_ZERO(&affinity_);
+	}
+
+	std::string systemName_;
+	cpu_set_t affinity_;
+	int policy_ = -1;
+
+protected:
+	void run()
+	{
+		char name[16] = {};
+		pthread_getname_np(pthread_self(), name, sizeof(name));
+		systemName_ = name;
+
+		sched_getaffinity(0, sizeof(affinity_), &affinity_);
+		policy_ = sched_getscheduler(0);
+	}
+};
+
 class ThreadTest : public Test
 {
 protected:
@@ -165,6 +192,49 @@ protected:
 			return TestFail;
 		}
 
+		/* Test the thread name, scheduling policy and CPU affinity. */
+		std::unique_ptr<ParamsThread> params =
+			std::make_unique<ParamsThread>("ThreadTestWithLongName");
+
+		if (params->name() != "ThreadTestWithLongName") {
+			cout << "Invalid thread name " << params->name() << endl;
+			return TestFail;
+		}
+
+		if (params->setSchedulingPolicy(SCHED_OTHER, 1) != -EINVAL ||
+		    params->setThreadAffinity({}) != -EINVAL) {
+			cout << "Invalid thread parameters not rejected" << endl;
+			return TestFail;
+		}
+
+		const unsigned int cpus[] = { 0 };
+		if (params->setSchedulingPolicy(SCHED_BATCH) < 0 ||
+		    params->setThreadAffinity(cpus) < 0) {
+			cout << "Failed to set thread parameters" << endl;
+			return TestFail;
+		}
+
+		params->start();
+		params->wait();
+
+		if (params->systemName_ != "ThreadTestWithL") {
+			cout << "Invalid system thread name "
+			     << params->systemName_ << endl;
+			return TestFail;
+		}
+
+		if (params->policy_ != SCHED_BATCH) {
+			cout << "Invalid scheduling policy " << params->policy_
+			     << endl;
+			return TestFail;
+		}
+
+		if (CPU_COUNT(&params->affinity_) != 1 ||
+		    !CPU_ISSET(0, &params->affinity_)) {
+			cout << "Invalid CPU affinity" << endl;
+			return TestFail;
+		}
+
 		return TestPass;
 	}
 
@@ -0,0 +1,185 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * timer-queue.cpp - Timer queue test and benchmark
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <libcamera/base/timer.h>
+#include <libcamera/base/timer_queue.h>
+#include <libcamera/base/utils.h>
+
+#include "test.h"
+
+using namespace libcamera;
+using namespace std;
+using namespace std::chrono_literals;
+
+/*
+ * Reference implementation matching the sorted list previously used by the
+ * event dispatchers.
+ */
+class TimerList
+{
+public:
+	void push(Timer *timer)
+	{
+		for (auto iter = timers_.begin(); iter != timers_.end(); ++iter) {
+			if ((*iter)->deadline() > timer->deadline()) {
+				timers_.insert(iter, timer);
+				return;
+			}
+		}
+
+		timers_.push_back(timer);
+	}
+
+	void remove(Timer *timer)
+	{
+		for (auto iter = timers_.begin(); iter != timers_.end(); ++iter) {
+			if (*iter == timer) {
+				timers_.erase(iter);
+				return;
+			}
+
+			if ((*iter)->deadline() > timer->deadline())
+				break;
+		}
+	}
+
+	Timer *top() const { return timers_.empty() ? nullptr : timers_.front(); }
+	void pop() { timers_.pop_front(); }
+	bool empty() const { return timers_.empty(); }
+
+private:
+	std::list<Timer *> timers_;
+};
+
+class TimerQueueTest : public Test
+{
+protected:
+	int init()
+	{
+		std::mt19937 gen(42);
+		std::uniform_int_distribution<int> dist(0, 1000000);
+		utils::time_point now = utils::clock::now();
+
+		for (unsigned int i = 0; i < kNumTimers; ++i) {
+			std::unique_ptr<Timer> timer = std::make_unique<Timer>();
+			/* Use a coarse granularity to exercise identical deadlines. */
+			timer->start(now + std::chrono::microseconds(dist(gen) / 100 * 100) + 1h);
+			timer->stop();
+			timers_.push_back(std::move(timer));
+		}
+
+		return TestPass;
+	}
+
+	template<typename Queue>
+	int testOrdering(const char *name)
+	{
+		Queue queue;
+
+		for (const std::unique_ptr<Timer> &timer : timers_)
+			queue.push(timer.get());
+
+		/* Remove every third timer. */
+		for (unsigned int i = 0; i < timers_.size(); i += 3)
+			queue.remove(timers_[i].get());
+
+		/* Removing a timer that isn't queued must be a no-op. */
+		queue.remove(timers_[0].get());
+
+		std::vector<Timer *> expected;
+		for (unsigned int i = 0; i < timers_.size(); ++i) {
+			if (i % 3)
+				expected.push_back(timers_[i].get());
+		}
+
+		std::stable_sort(expected.begin(), expected.end(),
+				 [](const Timer *a, const Timer *b) {
+					 return a->deadline() < b->deadline();
+				 });
+
+		for (Timer *timer : expected) {
+			if (queue.top() != timer) {
+				cerr << name << ": timers popped in wrong order" << endl;
+				return TestFail;
+			}
+
+			queue.pop();
+		}
+
+		if (!queue.empty()) {
+			cerr << name << ": queue not empty after popping all timers" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	template<typename Queue>
+	std::chrono::microseconds benchmark()
+	{
+		Queue queue;
+
+		utils::time_point start = utils::clock::now();
+
+		/*
+		 * Simulate timers being rearmed by continuously removing and
+		 * re-adding them, and popping expired timers.
+		 */
+		for (const std::unique_ptr<Timer> &timer : timers_)
+			queue.push(timer.get());
+
+		for (unsigned int i = 0; i < timers_.size(); ++i) {
+			Timer *timer = timers_[(i * 7) % timers_.size()].get();
+			queue.remove(timer);
+			queue.push(timer);
+		}
+
+		while (!queue.empty())
+			queue.pop();
+
+		utils::time_point end = utils::clock::now();
+
+		return std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+	}
+
+	int run()
+	{
+		if (testOrdering<TimerList>("list") != TestPass)
+			return TestFail;
+
+		if (testOrdering<TimerQueue>("queue") != TestPass)
+			return TestFail;
+
+		std::chrono::microseconds listTime = benchmark<TimerList>();
+		std::chrono::microseconds queueTime = benchmark<TimerQueue>();
+
+		cout << kNumTimers << " timers: list " << listTime.count()
+		     << "us, queue " << queueTime.count() << "us" << endl;
+
+		return TestPass;
+	}
+
+	void cleanup()
+	{
+		timers_.clear();
+	}
+
+private:
+	static constexpr unsigned int kNumTimers = 4096;
+
+	std::vector<std::unique_ptr<Timer>> timers_;
+};
+
+TEST_REGISTER(TimerQueueTest)
@@ -0,0 +1,114 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * uvc_metadata.cpp - UVC metadata pairing test
+ */
+
+#include <iostream>
+#include <optional>
+#include <stdint.h>
+
+#include <libcamera/framebuffer.h>
+
+#include "uvc_clock.h"
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+
+class UVCMetadataTest : public Test
+{
+protected:
+	/*
+	 * Pair frames starting at sequence number \a first. The metadata
+	 * buffers carry the timestamps set by the driver when the frames are
+	 * received, while the video buffer timestamps are rewritten later by
+	 * the driver clock update. They thus never match.
+	 */
+	int testPairing(uint32_t first)
+	{
+		UVCMetadataMatcher matcher;
+
+		for (uint32_t i = 0; i < 8; ++i) {
+			FrameMetadata meta{};
+			meta.sequence = first + i;
+			meta.timestamp = 1000000 * i;
+
+			FrameMetadata video{};
+			video.sequence = first + i;
+			video.timestamp = meta.timestamp + 1234;
+
+			if (matcher.ready(video.sequence)) {
+				cerr << "Frame " << video.sequence
+				     << " ready before its metadata" << endl;
+				return TestFail;
+			}
+
+			/* Metadata of frame 3 is lost, frame 5 has no PTS. */
+			if (i != 3)
+				matcher.addMetadata(meta.sequence,
+						    i != 5 ? std::optional<uint64_t>(meta.timestamp + 500)
+							   : std::nullopt);
+
+			if (i == 3)
+				continue;
+
+			if (!matcher.ready(video.sequence)) {
+				cerr << "Frame " << video.sequence
+				     << " not ready after its metadata" << endl;
+				return TestFail;
+			}
+
+			std::optional<uint64_t> recovered = matcher.take(video.sequence);
+			std::optional<uint64_t> expected;
+			if (i != 5)
+				expected = meta.timestamp + 500;
+
+			if (recovered != expected) {
+				cerr << "Frame " << video.sequence
+				     << " paired with the wrong metadata" << endl;
+				return TestFail;
+			}
+		}
+
+		return TestPass;
+	}
+
+	int testDroppedMetadata()
+	{
+		UVCMetadataMatcher matcher;
+
+		/*
+		 * The metadata of frame 1 is lost. The frame is ready when the
+		 * metadata of frame 2 arrives, without a recovered timestamp.
+		 */
+		matcher.addMetadata(0, 100);
+		matcher.addMetadata(2, 300);
+
+		if (matcher.take(0) != 100 || !matcher.ready(1) ||
+		    matcher.take(1) || matcher.take(2) != 300) {
+			cerr << "Frame without metadata not handled" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		/* Run from the first frame, and across sequence wrap-around. */
+		for (uint32_t first : { 0U, UINT32_MAX - 3 }) {
+			if (testPairing(first) != TestPass)
+				return TestFail;
+		}
+
+		if (testDroppedMetadata() != TestPass)
+			return TestFail;
+
+		return TestPass;
+	}
+};
+
+TEST_REGISTER(UVCMetadataTest)
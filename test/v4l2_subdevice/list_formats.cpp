@@ -68,6 +68,25 @@ int ListFormatsTest::run()
 	for (unsigned int code : utils::map_keys(formats))
 		printFormats(1, code, formats[code]);
 
+	/*
+	 * Enumeration results are memoized, verify that subsequent calls, with
+	 * and without invalidation, return the same formats.
+	 */
+	if (scaler_->formats(1) != formats) {
+		cerr << "Memoized formats on pad 1 of subdevice "
+		     << scaler_->entity()->name() << " don't match" << endl;
+		return TestFail;
+	}
+
+	scaler_->invalidateFormats();
+
+	if (scaler_->formats(1) != formats) {
+		cerr << "Formats on pad 1 of subdevice "
+		     << scaler_->entity()->name()
+		     << " changed after invalidation" << endl;
+		return TestFail;
+	}
+
 	/* List format on a non-existing pad, format vector shall be empty. */
 	formats = scaler_->formats(2);
 	if (!formats.empty()) {
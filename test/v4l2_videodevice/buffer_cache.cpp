@@ -200,6 +200,14 @@ public:
 		if (testSequential(&cacheFromBuffers, buffers) != TestPass)
 			return TestFail;
 
+		if (cacheFromBuffers.misses() != 0 ||
+		    cacheFromBuffers.hits() != numBuffers * 100) {
+			std::cout << "Pre-populated cache reported "
+				  << cacheFromBuffers.misses() << " misses"
+				  << std::endl;
+			return TestFail;
+		}
+
 		if (testRandom(&cacheFromBuffers, buffers) != TestPass)
 			return TestFail;
 
@@ -215,6 +223,14 @@ public:
 		if (testSequential(&cacheFromNumbers, buffers) != TestPass)
 			return TestFail;
 
+		/* Only the first use of each buffer should miss. */
+		if (cacheFromNumbers.misses() != numBuffers) {
+			std::cout << "Cache reported " << cacheFromNumbers.misses()
+				  << " misses, expected " << numBuffers
+				  << std::endl;
+			return TestFail;
+		}
+
 		if (testRandom(&cacheFromNumbers, buffers) != TestPass)
 			return TestFail;
 
@@ -49,6 +49,7 @@ protected:
 		}
 
 		capture_->bufferReady.connect(this, &CaptureAsyncTest::receiveBuffer);
+		capture_->enableStatistics(true);
 
 		for (const std::unique_ptr<FrameBuffer> &buffer : buffers_) {
 			if (capture_->queueBuffer(buffer.get())) {
@@ -84,6 +85,21 @@ protected:
 		if (ret)
 			return TestFail;
 
+		/* Every dequeued buffer must be accounted for in the statistics. */
+		const V4L2VideoDevice::Statistics &stats = capture_->statistics();
+		uint64_t dequeued = 0;
+		for (uint64_t count : stats.queueDepth)
+			dequeued += count;
+
+		if (stats.timeInDriver.count < frames || dequeued != stats.timeInDriver.count) {
+			std::cout << "Inconsistent buffer statistics" << std::endl;
+			return TestFail;
+		}
+
+		std::cout << "Time in driver: average "
+			  << stats.timeInDriver.average().get<std::milli>() << " ms, max "
+			  << stats.timeInDriver.max.get<std::milli>() << " ms" << std::endl;
+
 		return TestPass;
 	}
 
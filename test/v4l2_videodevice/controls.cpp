@@ -134,6 +134,71 @@ protected:
 			return TestFail;
 		}
 
+		/*
+		 * Test that writing unchanged controls, which are skipped,
+		 * succeeds and preserves their values.
+		 */
+		ControlList unchanged(infoMap);
+		unchanged.set(V4L2_CID_BRIGHTNESS, brightness.min());
+
+		for (unsigned int i = 0; i < 2; i++) {
+			ret = capture_->setControls(&unchanged);
+			if (ret) {
+				cerr << "Failed to set unchanged controls" << endl;
+				return TestFail;
+			}
+		}
+
+		ctrls = capture_->getControls({ V4L2_CID_BRIGHTNESS });
+		if (ctrls.get(V4L2_CID_BRIGHTNESS) != brightness.min() ||
+		    unchanged.get(V4L2_CID_BRIGHTNESS) != brightness.min()) {
+			cerr << "Unchanged controls modified when set" << endl;
+			return TestFail;
+		}
+
+		/*
+		 * Test that writing other controls drops the cached values, as
+		 * writing a control can modify other controls. Simulate the
+		 * modification through a second instance of the device.
+		 */
+		ControlList other(infoMap);
+		other.set(V4L2_CID_CONTRAST, contrast.min());
+
+		ret = capture_->setControls(&other);
+		if (ret) {
+			cerr << "Failed to set other controls" << endl;
+			return TestFail;
+		}
+
+		V4L2VideoDevice device(capture_->deviceNode());
+		if (device.open()) {
+			cerr << "Failed to open second device instance" << endl;
+			return TestFail;
+		}
+
+		ControlList modified(device.controls());
+		modified.set(V4L2_CID_BRIGHTNESS, brightness.max());
+
+		ret = device.setControls(&modified);
+		device.close();
+		if (ret) {
+			cerr << "Failed to modify controls" << endl;
+			return TestFail;
+		}
+
+		unchanged.set(V4L2_CID_BRIGHTNESS, brightness.min());
+		ret = capture_->setControls(&unchanged);
+		if (ret) {
+			cerr << "Failed to set controls after modification" << endl;
+			return TestFail;
+		}
+
+		ctrls = capture_->getControls({ V4L2_CID_BRIGHTNESS });
+		if (ctrls.get(V4L2_CID_BRIGHTNESS) != brightness.min()) {
+			cerr << "Controls not written after other controls" << endl;
+			return TestFail;
+		}
+
 		return TestPass;
 	}
 };
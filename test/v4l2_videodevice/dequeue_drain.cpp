@@ -0,0 +1,103 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * libcamera V4L2 dequeue draining test
+ */
+
+#include <iostream>
+#include <unistd.h>
+#include <vector>
+
+#include <libcamera/base/event_dispatcher.h>
+#include <libcamera/base/thread.h>
+
+#include <libcamera/framebuffer.h>
+
+#include "v4l2_videodevice_test.h"
+
+using namespace libcamera;
+
+class DequeueDrainTest : public V4L2VideoDeviceTest
+{
+public:
+	DequeueDrainTest()
+		: V4L2VideoDeviceTest("vimc", "Raw Capture 0") {}
+
+protected:
+	int run()
+	{
+		constexpr unsigned int bufferCount = 8;
+
+		EventDispatcher *dispatcher = Thread::current()->eventDispatcher();
+
+		int ret = capture_->allocateBuffers(bufferCount, &buffers_);
+		if (ret < 0) {
+			std::cout << "Failed to allocate buffers" << std::endl;
+			return TestFail;
+		}
+
+		capture_->bufferReady.connect(this, &DequeueDrainTest::receiveBuffer);
+
+		std::vector<FrameBuffer *> buffers;
+		for (const std::unique_ptr<FrameBuffer> &buffer : buffers_)
+			buffers.push_back(buffer.get());
+
+		if (capture_->queueBuffers(buffers)) {
+			std::cout << "Failed to queue buffers" << std::endl;
+			return TestFail;
+		}
+
+		ret = capture_->streamOn();
+		if (ret < 0) {
+			std::cout << "Failed to start streaming" << std::endl;
+			return TestFail;
+		}
+
+		/*
+		 * Let the device complete multiple buffers without processing
+		 * events, and verify that they are all delivered, in order,
+		 * from a single notification.
+		 */
+		usleep(500000);
+		dispatcher->processEvents();
+
+		ret = capture_->streamOff();
+		if (ret < 0) {
+			std::cout << "Failed to stop streaming" << std::endl;
+			return TestFail;
+		}
+
+		/* Stopping the stream cancels the remaining buffers. */
+		if (completed_.size() < 2) {
+			std::cout << "Only " << completed_.size()
+				  << " buffers dequeued in one activation"
+				  << std::endl;
+			return TestFail;
+		}
+
+		for (unsigned int i = 1; i < completed_.size(); i++) {
+			if (completed_[i] <= completed_[i - 1]) {
+				std::cout << "Buffers dequeued out of order"
+					  << std::endl;
+				return TestFail;
+			}
+		}
+
+		return TestPass;
+	}
+
+private:
+	void receiveBuffer(FrameBuffer *buffer)
+	{
+		const FrameMetadata &metadata = buffer->metadata();
+		if (metadata.status != FrameMetadata::FrameSuccess)
+			return;
+
+		completed_.push_back(metadata.sequence);
+	}
+
+	std::vector<unsigned int> completed_;
+};
+
+TEST_REGISTER(DequeueDrainTest)
@@ -49,6 +49,28 @@ protected:
 			return TestFail;
 		}
 
+		/* Repeated tries of the same format must return the same result. */
+		V4L2DeviceFormat tryFormat = {};
+		tryFormat.fourcc = format.fourcc;
+		tryFormat.size = { 640, 480 };
+
+		V4L2DeviceFormat cachedFormat = tryFormat;
+
+		if (capture_->tryFormat(&tryFormat) ||
+		    capture_->tryFormat(&cachedFormat)) {
+			cerr << "Failed to try format" << endl;
+			return TestFail;
+		}
+
+		if (cachedFormat.toString() != tryFormat.toString() ||
+		    cachedFormat.planesCount != tryFormat.planesCount ||
+		    cachedFormat.planes[0].bpl != tryFormat.planes[0].bpl ||
+		    cachedFormat.planes[0].size != tryFormat.planes[0].size) {
+			cerr << "Cached format " << cachedFormat
+			     << " differs from tried format " << tryFormat << endl;
+			return TestFail;
+		}
+
 		std::vector<std::pair<uint32_t, const char *>> formats{
 			{ V4L2_PIX_FMT_YUYV, "YUYV" },
 			{ 0, "<INVALID>" },
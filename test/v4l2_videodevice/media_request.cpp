@@ -0,0 +1,154 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, Ideas on Board Oy
+ *
+ * media_request.cpp - Media request test
+ */
+
+#include <iostream>
+#include <memory>
+
+#include <libcamera/base/event_dispatcher.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/timer.h>
+
+#include <libcamera/framebuffer.h>
+
+#include "libcamera/internal/media_device.h"
+#include "libcamera/internal/media_request.h"
+
+#include "v4l2_videodevice_test.h"
+
+using namespace std;
+using namespace libcamera;
+using namespace std::chrono_literals;
+
+class MediaRequestTest : public V4L2VideoDeviceTest
+{
+public:
+	MediaRequestTest()
+		: V4L2VideoDeviceTest("vivid", "vivid-000-vid-cap"),
+		  completed_(false), frames_(0)
+	{
+	}
+
+protected:
+	int run()
+	{
+		if (!media_->acquire())
+			return TestFail;
+
+		int ret = runRequest();
+
+		media_->release();
+
+		return ret;
+	}
+
+private:
+	int brightness()
+	{
+		ControlList ctrls = capture_->getControls({ V4L2_CID_BRIGHTNESS });
+		return ctrls.get(V4L2_CID_BRIGHTNESS).get<int32_t>();
+	}
+
+	int runRequest()
+	{
+		EventDispatcher *dispatcher = Thread::current()->eventDispatcher();
+
+		std::unique_ptr<MediaRequest> request = media_->createRequest();
+		if (!request) {
+			cout << "Media requests not supported" << endl;
+			return TestSkip;
+		}
+
+		/* Store a brightness value in the request. */
+		const ControlInfo &info =
+			capture_->controls().find(V4L2_CID_BRIGHTNESS)->second;
+		int32_t initial = brightness();
+		int32_t value = initial != info.min().get<int32_t>()
+			      ? info.min().get<int32_t>()
+			      : info.max().get<int32_t>();
+
+		ControlList ctrls(capture_->controls());
+		ctrls.set(V4L2_CID_BRIGHTNESS, value);
+		if (capture_->setControls(&ctrls, request.get())) {
+			cerr << "Failed to store controls in request" << endl;
+			return TestFail;
+		}
+
+		if (brightness() != initial) {
+			cerr << "Request controls applied before queuing" << endl;
+			return TestFail;
+		}
+
+		/* Bundle a buffer with the controls and queue the request. */
+		int ret = capture_->allocateBuffers(1, &buffers_);
+		if (ret < 0) {
+			cerr << "Failed to allocate buffers" << endl;
+			return TestFail;
+		}
+
+		capture_->bufferReady.connect(this, &MediaRequestTest::receiveBuffer);
+		request->completed.connect(this, &MediaRequestTest::requestComplete);
+
+		if (capture_->queueBuffer(buffers_[0].get(), request.get())) {
+			cerr << "Failed to queue buffer in request" << endl;
+			return TestFail;
+		}
+
+		if (capture_->streamOn()) {
+			cerr << "Failed to start streaming" << endl;
+			return TestFail;
+		}
+
+		if (request->queue()) {
+			cerr << "Failed to queue request" << endl;
+			return TestFail;
+		}
+
+		Timer timeout;
+		timeout.start(2000ms);
+		while (timeout.isRunning() && (!completed_ || !frames_))
+			dispatcher->processEvents();
+
+		capture_->streamOff();
+
+		if (!completed_ || !frames_) {
+			cerr << "Request didn't complete" << endl;
+			return TestFail;
+		}
+
+		if (request->status() != MediaRequest::Status::Complete) {
+			cerr << "Invalid request status" << endl;
+			return TestFail;
+		}
+
+		if (brightness() != value) {
+			cerr << "Request controls not applied" << endl;
+			return TestFail;
+		}
+
+		if (request->reinit()) {
+			cerr << "Failed to reinit request" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	void receiveBuffer([[maybe_unused]] FrameBuffer *buffer)
+	{
+		frames_++;
+	}
+
+	void requestComplete([[maybe_unused]] MediaRequest *request)
+	{
+		completed_ = true;
+	}
+
+	bool completed_;
+	unsigned int frames_;
+};
+
+TEST_REGISTER(MediaRequestTest)
@@ -6,8 +6,11 @@
  */
 
 #include <array>
+#include <dirent.h>
 #include <iostream>
 #include <map>
+#include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <unistd.h>
 
@@ -73,6 +76,73 @@ protected:
 		if (!createFile(invalidYaml, invalidYamlFile_))
 			return TestFail;
 
+		cacheDir_ = "/tmp/libcamera.test.XXXXXX";
+		if (!mkdtemp(&cacheDir_.front()))
+			return TestFail;
+
+		return TestPass;
+	}
+
+	std::string cacheFile()
+	{
+		DIR *dir = opendir(cacheDir_.c_str());
+		if (!dir)
+			return {};
+
+		std::string name;
+		struct dirent *ent;
+
+		while ((ent = readdir(dir))) {
+			if (!strncmp(ent->d_name, "yaml-", 5)) {
+				name = cacheDir_ + "/" + ent->d_name;
+				break;
+			}
+		}
+
+		closedir(dir);
+		return name;
+	}
+
+	int testCache()
+	{
+		setenv("LIBCAMERA_CACHE_DIR", cacheDir_.c_str(), 1);
+
+		File file{ testYamlFile_ };
+		if (!file.open(File::OpenModeFlag::ReadOnly)) {
+			cerr << "Fail to open test YAML file" << std::endl;
+			return TestFail;
+		}
+
+		/* The first parse populates the cache. */
+		std::unique_ptr<YamlObject> root = YamlParser::parse(file);
+		if (!root) {
+			cerr << "Fail to parse test YAML file with cache" << std::endl;
+			return TestFail;
+		}
+
+		std::string cachePath = cacheFile();
+		if (cachePath.empty()) {
+			cerr << "YAML cache file not created" << std::endl;
+			return TestFail;
+		}
+
+		/* A corrupted cache file must fall back to parsing the YAML. */
+		if (truncate(cachePath.c_str(), 32) < 0) {
+			cerr << "Fail to corrupt YAML cache file" << std::endl;
+			return TestFail;
+		}
+
+		file.close();
+		if (!file.open(File::OpenModeFlag::ReadOnly))
+			return TestFail;
+
+		root = YamlParser::parse(file);
+		if (!root || (*root)["string"].get<std::string>("") != "libcamera") {
+			cerr << "Fail to parse test YAML file with corrupted cache"
+			     << std::endl;
+			return TestFail;
+		}
+
 		return TestPass;
 	}
 
@@ -294,6 +364,13 @@ protected:
 			return TestFail;
 		}
 
+		/*
+		 * Populate the cache, the rest of the test then operates on
+		 * the YamlObject tree loaded from the cache.
+		 */
+		if (testCache() != TestPass)
+			return TestFail;
+
 		/* Test YAML file */
 		file.close();
 		file.setFileName(testYamlFile_);
@@ -547,6 +624,19 @@ protected:
 			return TestFail;
 		}
 
+		std::array<int32_t, 2> array;
+		if (!firstElement.getList(Span<int32_t>(array)) ||
+		    array[0] != 1 || array[1] != 2) {
+			cerr << "getList() failed to fill correct span" << std::endl;
+			return TestFail;
+		}
+
+		std::array<int32_t, 3> largeArray;
+		if (firstElement.getList(Span<int32_t>(largeArray))) {
+			cerr << "getList() didn't fail on size mismatch" << std::endl;
+			return TestFail;
+		}
+
 		auto &secondElement = level2Obj[1];
 		if (!secondElement.isDictionary() ||
 		    !secondElement.contains("one") ||
@@ -564,11 +654,17 @@ protected:
 	{
 		unlink(testYamlFile_.c_str());
 		unlink(invalidYamlFile_.c_str());
+
+		std::string cachePath;
+		while (!(cachePath = cacheFile()).empty())
+			unlink(cachePath.c_str());
+		rmdir(cacheDir_.c_str());
 	}
 
 private:
 	std::string testYamlFile_;
 	std::string invalidYamlFile_;
+	std::string cacheDir_;
 };
 
 TEST_REGISTER(YamlParserTest)
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0-or-later
+# Copyright (C) 2026, Ideas on Board Oy
+#
+# decode-log.py - Convert a libcamera binary log file to text
+
+import argparse
+import datetime
+import struct
+import sys
+
+
+MAGIC = 0x4c42434c
+VERSION = 1
+
+RECORD_CATEGORY = 1
+RECORD_LOCATION = 2
+RECORD_MESSAGE = 3
+RECORD_TEXT = 4
+
+SEVERITIES = ['DEBUG', ' INFO', ' WARN', 'ERROR', 'FATAL']
+
+
+def format_monotonic(nsecs):
+    secs = nsecs // 1000000000
+    return '%u:%02u:%02u.%09u' % (secs // 3600, (secs // 60) % 60, secs % 60,
+                                  nsecs % 1000000000)
+
+
+def format_realtime(nsecs):
+    time = datetime.datetime.fromtimestamp(nsecs / 1000000000)
+    return time.strftime('%Y-%m-%d %H:%M:%S') + '.%09u' % (nsecs % 1000000000)
+
+
+class LogDecoder(object):
+    def __init__(self, data, realtime):
+        self.__data = data
+        self.__realtime = realtime
+        self.__categories = {}
+        self.__locations = {}
+
+    def __timestamp(self, nsecs):
+        if self.__realtime:
+            return format_realtime(nsecs - self.__monotonic + self.__realtime_base)
+        else:
+            return format_monotonic(nsecs)
+
+    def __message(self, payload):
+        timestamp, tid, category, location, severity, prefix_size = \
+            struct.unpack_from(self.__endian + 'QIIIHH', payload)
+        offset = struct.calcsize(self.__endian + 'QIIIHH')
+
+        prefix = payload[offset:offset + prefix_size].decode(errors='replace')
+        msg = payload[offset + prefix_size:].decode(errors='replace')
+
+        if severity < len(SEVERITIES):
+            severity = SEVERITIES[severity]
+        else:
+            severity = 'UNKWN'
+
+        line = '[%s] [%u] %s %s %s ' % (self.__timestamp(timestamp), tid, severity,
+                                        self.__categories.get(category, '<unknown>'),
+                                        self.__locations.get(location, '<unknown>'))
+        if prefix:
+            line += prefix + ': '
+        line += msg
+
+        return line + '\n'
+
+    def decode(self, output):
+        data = self.__data
+
+        if len(data) < 24:
+            raise RuntimeError('File too short')
+
+        if struct.unpack_from('<I', data)[0] == MAGIC:
+            self.__endian = '<'
+        elif struct.unpack_from('>I', data)[0] == MAGIC:
+            self.__endian = '>'
+        else:
+            raise RuntimeError('Invalid magic, not a libcamera binary log')
+
+        _, version, _, self.__realtime_base, self.__monotonic = \
+            struct.unpack_from(self.__endian + 'IHHQQ', data)
+        if version != VERSION:
+            raise RuntimeError('Unsupported version %u' % version)
+
+        offset = 24
+        while offset + 8 <= len(data):
+            type, _, size = struct.unpack_from(self.__endian + 'HHI', data, offset)
+            offset += 8
+
+            payload = data[offset:offset + size]
+            offset += size
+
+            if len(payload) != size:
+                sys.stderr.write('Truncated record at end of file\n')
+                break
+
+            if type == RECORD_CATEGORY or type == RECORD_LOCATION:
+                id = struct.unpack_from(self.__endian + 'I', payload)[0]
+                name = payload[4:].decode(errors='replace')
+                if type == RECORD_CATEGORY:
+                    self.__categories[id] = name
+                else:
+                    self.__locations[id] = name
+            elif type == RECORD_MESSAGE:
+                output.write(self.__message(payload))
+            elif type == RECORD_TEXT:
+                output.write(payload.decode(errors='replace'))
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(
+        description='Convert a libcamera binary log file to text')
+    parser.add_argument('-r', '--realtime', action='store_true',
+                        help='Print timestamps as wall clock time')
+    parser.add_argument('-o', '--output', type=str,
+                        help='Output file name, defaults to standard output')
+    parser.add_argument('input', type=str,
+                        help='Binary log file name')
+    args = parser.parse_args(argv[1:])
+
+    with open(args.input, 'rb') as f:
+        data = f.read()
+
+    if args.output:
+        output = open(args.output, 'w')
+    else:
+        output = sys.stdout
+
+    try:
+        LogDecoder(data, args.realtime).decode(output)
+    except RuntimeError as e:
+        sys.stderr.write('%s: %s\n' % (args.input, e))
+        return 1
+    finally:
+        if args.output:
+            output.close()
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
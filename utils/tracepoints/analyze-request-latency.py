@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0-or-later
+# Copyright (C) 2026, Ideas on Board Oy
+#
+# analyze-request-latency.py - Per-stage request latency from libcamera lttng traces
+
+import argparse
+import bt2
+import statistics as stats
+import sys
+
+
+class Stages:
+    def __init__(self):
+        # stage name -> samples[] in ns
+        self.samples = {}
+
+    def add(self, stage, begin, end):
+        if begin is None or end is None or end < begin:
+            return
+        self.samples.setdefault(stage, []).append(end - begin)
+
+    def print(self):
+        rows = [['stage', 'count', 'min', 'mean', 'p50', 'p99', 'max']]
+
+        for stage, v in self.samples.items():
+            v = sorted(v)
+            rows.append([stage, str(len(v))] + [f'{x / 1000:.1f}' for x in [
+                v[0], stats.mean(v), v[len(v) // 2], v[len(v) * 99 // 100], v[-1]]])
+
+        widths = [max([len(row[i]) for row in rows]) for i in range(len(rows[0]))]
+
+        print('Latencies in microseconds')
+        for row in rows:
+            fmt = [row[i].rjust(widths[i]) for i in range(1, len(row))]
+            print(row[0].ljust(widths[0]), *fmt)
+
+
+class RequestTracker:
+    """Track requests through the pipeline, keyed by the Request pointer.
+
+    Request objects are reused by applications, the state of a request is
+    reset when it is queued.
+    """
+
+    def __init__(self, stages):
+        self.stages = stages
+        # request -> {event -> timestamp}
+        self.requests = {}
+
+    def event(self, name, fields, ts):
+        request = fields['request']
+        if not request:
+            return
+
+        if name == 'request_queue':
+            self.requests[request] = {'queue': ts}
+            return
+
+        state = self.requests.get(request)
+        if state is None:
+            return
+
+        if name == 'request_device_queue':
+            state['device_queue'] = ts
+            self.stages.add('request: queue -> device queue', state.get('queue'), ts)
+
+        elif name == 'v4l2_buffer_queue':
+            node = fields['device_node']
+            state[f'qbuf:{node}'] = ts
+            self.stages.add(f'{node}: device queue -> qbuf', state.get('device_queue'), ts)
+
+        elif name == 'v4l2_buffer_dequeue':
+            node = fields['device_node']
+            state[f'dqbuf:{node}'] = ts
+            state['last_dqbuf'] = ts
+            self.stages.add(f'{node}: qbuf -> dqbuf', state.get(f'qbuf:{node}'), ts)
+
+        elif name == 'converter_done':
+            state['last_dqbuf'] = ts
+
+        elif name == 'request_complete':
+            self.stages.add('request: last buffer -> complete', state.get('last_dqbuf'), ts)
+            self.stages.add('request: queue -> complete', state.get('queue'), ts)
+            del self.requests[request]
+
+
+class FrameTracker:
+    """Track per-frame stages keyed by frame sequence numbers.
+
+    This covers the IPA calls and events, the converters whose input buffers
+    are internal to the pipeline handler, and the delayed controls.
+    """
+
+    def __init__(self, stages):
+        self.stages = stages
+        # (ipa, frame) -> (function, timestamp) of the most recent call
+        self.ipa_calls = {}
+        # (converter, sequence) -> timestamp
+        self.converter_jobs = {}
+        # sequence -> timestamp
+        self.frame_starts = {}
+
+    def event(self, name, fields, ts):
+        if name == 'ipa_frame_call':
+            key = (fields['ipa_name'], fields['frame'])
+            self.ipa_calls[key] = (fields['function_name'], ts)
+
+        elif name == 'ipa_frame_event':
+            ipa = fields['ipa_name']
+            call = self.ipa_calls.get((ipa, fields['frame']))
+            if call:
+                self.stages.add(f'ipa {ipa}: {call[0]} -> {fields["function_name"]}',
+                                call[1], ts)
+
+        elif name == 'converter_queue':
+            key = (fields['converter_name'], fields['sequence'])
+            self.converter_jobs[key] = ts
+
+        elif name == 'converter_done':
+            key = (fields['converter_name'], fields['sequence'])
+            self.stages.add(f'converter {key[0]}: queue -> done',
+                            self.converter_jobs.get(key), ts)
+
+        elif name == 'delayed_controls_apply':
+            self.frame_starts[fields['sequence']] = ts
+
+        elif name == 'v4l2_buffer_dequeue':
+            start = self.frame_starts.get(fields['sequence'])
+            self.stages.add(f'{fields["device_node"]}: frame start -> dqbuf', start, ts)
+
+        # Bound the memory usage on long traces.
+        for table in [self.ipa_calls, self.converter_jobs, self.frame_starts]:
+            if len(table) > 1024:
+                for key in list(table)[:512]:
+                    del table[key]
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(
+            description='Compute per-stage latencies of requests and frames from libcamera traces')
+    parser.add_argument('trace_path', type=str,
+                        help='Path to lttng trace (eg. ~/lttng-traces/demo-20201029-184003)')
+    args = parser.parse_args(argv[1:])
+
+    stages = Stages()
+    requests = RequestTracker(stages)
+    frames = FrameTracker(stages)
+
+    traces = bt2.TraceCollectionMessageIterator(args.trace_path)
+    for msg in traces:
+        if type(msg) is not bt2._EventMessageConst:
+            continue
+
+        provider, _, name = msg.event.name.partition(':')
+        if provider != 'libcamera':
+            continue
+
+        fields = msg.event.payload_field
+        ts = msg.default_clock_snapshot.ns_from_origin
+
+        if 'request' in fields:
+            requests.event(name, fields, ts)
+
+        frames.event(name, fields, ts)
+
+    stages.print()
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))